@@ -798,7 +798,7 @@ int opt_loglevel(void *optctx, const char *opt, const char *arg)
     int i;
 
     tail = strstr(arg, "repeat");
-    av_log_set_flags(tail ? 0 : AV_LOG_SKIP_REPEATED);
+    av_log_set_flags(tail ? 0 : AV_LOG_SKIP_REPEATED | AV_LOG_RATE_LIMIT);
     if (tail == arg)
         arg += 6 + (arg[6]=='+');
     if(tail && !*arg)
@@ -52,6 +52,7 @@
 #include "libavutil/dict.h"
 #include "libavutil/mathematics.h"
 #include "libavutil/pixdesc.h"
+#include "libavutil/profile.h"
 #include "libavutil/avstring.h"
 #include "libavutil/libm.h"
 #include "libavutil/imgutils.h"
@@ -101,6 +102,7 @@
 #include "ffmpeg.h"
 #include "cmdutils.h"
 
+#include "libavutil/atomic.h"
 #include "libavutil/avassert.h"
 
 const char program_name[] = "ffmpeg";
@@ -138,6 +140,25 @@ static uint8_t *subtitle_out;
 #if HAVE_PTHREADS
 /* signal to input threads that they should exit; set by the main thread */
 static int transcoding_finished;
+
+/* Serializes everything but the actual decoding, encoding and filtering once
+ * worker threads are running: the main thread holds it while transcoding,
+ * the worker threads hold it while muxing and updating the stream states. */
+static pthread_mutex_t transcode_lock = PTHREAD_MUTEX_INITIALIZER;
+static int transcode_lock_held;
+
+/* must be a power of 2 */
+#define INPUT_RING_SIZE 8
+
+#define ENCODE_QUEUE_SIZE 8
+#define FILTER_QUEUE_SIZE 8
+
+/* a frame waiting to be sent to a filtergraph running in its own thread */
+typedef struct QueuedFilterFrame {
+    InputFilter *ifilter;
+    AVFrame     *frame;     /* NULL signals EOF */
+    int          flags;     /* av_buffersrc_add_frame_flags() flags */
+} QueuedFilterFrame;
 #endif
 
 #define DEFAULT_PASS_LOGFILENAME_PREFIX "ffmpeg2pass"
@@ -164,6 +185,82 @@ static int restore_tty;
 
 static void free_input_threads(void);
 
+/* Wait until the thread running fg, if any, has processed every queued frame,
+ * so that the graph can be accessed directly. */
+static void wait_filtergraph_idle(FilterGraph *fg)
+{
+#if HAVE_PTHREADS
+    while (fg->fifo && (av_fifo_size(fg->fifo) || fg->busy))
+        pthread_cond_wait(&fg->cond, &transcode_lock);
+#endif
+}
+
+/* Return the start time of a stage timed for -benchmark_report. */
+static int64_t stage_start(void)
+{
+    return benchmark_report ? av_gettime() : 0;
+}
+
+static void stage_end(StageStats *stats, int64_t start, int count)
+{
+    if (benchmark_report) {
+        stats->time  += av_gettime() - start;
+        stats->count += count;
+    }
+}
+
+/* Account for an item queued to the thread running a stage, ahead of which
+ * depth items are already waiting. */
+static void stage_queue(StageStats *stats, int depth)
+{
+    stats->nb_queued++;
+    stats->queue_sum += depth;
+    stats->queue_max  = FFMAX(stats->queue_max, depth);
+}
+
+/*
+ * Send frame to the buffer source of ifilter, with the semantics of
+ * av_buffersrc_add_frame_flags(), or queue it if the filtergraph runs in its
+ * own thread. A NULL frame signals EOF.
+ */
+static int send_filter_frame(InputFilter *ifilter, AVFrame *frame, int flags)
+{
+#if HAVE_PTHREADS
+    FilterGraph *fg = ifilter->graph;
+
+    if (fg->fifo) {
+        QueuedFilterFrame q = { ifilter, NULL, flags & ~AV_BUFFERSRC_FLAG_KEEP_REF };
+
+        if (frame) {
+            if (!(q.frame = av_frame_alloc()))
+                return AVERROR(ENOMEM);
+            if (flags & AV_BUFFERSRC_FLAG_KEEP_REF) {
+                int ret = av_frame_ref(q.frame, frame);
+                if (ret < 0) {
+                    av_frame_free(&q.frame);
+                    return ret;
+                }
+            } else
+                av_frame_move_ref(q.frame, frame);
+        }
+
+        while (!av_fifo_space(fg->fifo))
+            pthread_cond_wait(&fg->cond, &transcode_lock);
+        stage_queue(&fg->filter_stats, av_fifo_size(fg->fifo) / sizeof(q));
+        av_fifo_generic_write(fg->fifo, &q, sizeof(q), NULL);
+        pthread_cond_signal(&fg->cond);
+        return 0;
+    }
+#endif
+    {
+        int64_t start = stage_start();
+        int ret = frame ? av_buffersrc_add_frame_flags(ifilter->filter, frame, flags) :
+                          av_buffersrc_add_ref(ifilter->filter, NULL, 0);
+        stage_end(&ifilter->graph->filter_stats, start, !!frame);
+        return ret;
+    }
+}
+
 
 /* sub2video hack:
    Convert subtitles to video with alpha to insert them in filter graphs.
@@ -222,9 +319,9 @@ static void sub2video_push_ref(InputStream *ist, int64_t pts)
     av_assert1(frame->data[0]);
     ist->sub2video.last_pts = frame->pts = pts;
     for (i = 0; i < ist->nb_filters; i++)
-        av_buffersrc_add_frame_flags(ist->filters[i]->filter, frame,
-                                     AV_BUFFERSRC_FLAG_KEEP_REF |
-                                     AV_BUFFERSRC_FLAG_PUSH);
+        send_filter_frame(ist->filters[i], frame,
+                          AV_BUFFERSRC_FLAG_KEEP_REF |
+                          AV_BUFFERSRC_FLAG_PUSH);
 }
 
 static void sub2video_update(InputStream *ist, AVSubtitle *sub)
@@ -284,8 +381,10 @@ static void sub2video_heartbeat(InputStream *ist, int64_t pts)
             continue;
         if (pts2 >= ist2->sub2video.end_pts || !ist2->sub2video.frame->data[0])
             sub2video_update(ist2, NULL);
-        for (j = 0, nb_reqs = 0; j < ist2->nb_filters; j++)
+        for (j = 0, nb_reqs = 0; j < ist2->nb_filters; j++) {
+            wait_filtergraph_idle(ist2->filters[j]->graph);
             nb_reqs += av_buffersrc_get_nb_failed_requests(ist2->filters[j]->filter);
+        }
         if (nb_reqs)
             sub2video_push_ref(ist2, pts2);
     }
@@ -296,7 +395,7 @@ static void sub2video_flush(InputStream *ist)
     int i;
 
     for (i = 0; i < ist->nb_filters; i++)
-        av_buffersrc_add_ref(ist->filters[i]->filter, NULL, 0);
+        send_filter_frame(ist->filters[i], NULL, 0);
 }
 
 /* end of sub2video hack */
@@ -496,6 +595,7 @@ static void exit_program(void)
     if (vstats_file)
         fclose(vstats_file);
     av_free(vstats_filename);
+    av_freep(&benchmark_report);
 
     av_freep(&input_streams);
     av_freep(&input_files);
@@ -543,10 +643,47 @@ static void update_benchmark(const char *fmt, ...)
     }
 }
 
+static void print_latency_trace(AVPacket *pkt, OutputStream *ost)
+{
+    AVLatencyTrace trace = { { 0 } };
+    AVBPrint buf;
+    uint8_t *sd;
+    int64_t first = 0, prev = 0;
+    int i, size;
+
+    /* the side data is kept split, the muxer would split it anyway */
+    if (av_packet_split_side_data(pkt) < 0)
+        return;
+    sd = av_packet_get_side_data(pkt, AV_PKT_DATA_LATENCY_TRACE, &size);
+    if (!sd)
+        return;
+    memcpy(&trace, sd, FFMIN(size, sizeof(trace)));
+    av_latency_trace_stamp(&trace, AV_LATENCY_MUX);
+
+    av_bprint_init(&buf, 0, 1);
+    av_bprintf(&buf, "latency: stream %d:%d pts_time:%s",
+               ost->file_index, ost->index,
+               av_ts2timestr(pkt->pts, &ost->st->time_base));
+    for (i = 0; i < AV_LATENCY_NB; i++) {
+        if (!trace.stamp[i])
+            continue;
+        if (prev)
+            av_bprintf(&buf, " %s:+%"PRId64, av_latency_stage_name(i),
+                       trace.stamp[i] - prev);
+        else
+            first = trace.stamp[i];
+        prev = trace.stamp[i];
+    }
+    av_bprintf(&buf, " total:%"PRId64" us\n", prev - first);
+    av_log(NULL, AV_LOG_INFO, "%s", buf.str);
+    av_bprint_finalize(&buf, NULL);
+}
+
 static void write_frame(AVFormatContext *s, AVPacket *pkt, OutputStream *ost)
 {
     AVBitStreamFilterContext *bsfc = ost->bitstream_filters;
     AVCodecContext          *avctx = ost->st->codec;
+    int64_t start;
     int ret;
 
     if ((avctx->codec_type == AVMEDIA_TYPE_VIDEO && video_sync_method == VSYNC_DROP) ||
@@ -640,7 +777,12 @@ static void write_frame(AVFormatContext *s, AVPacket *pkt, OutputStream *ost)
               );
     }
 
+    if (trace_latency)
+        print_latency_trace(pkt, ost);
+
+    start = stage_start();
     ret = av_interleaved_write_frame(s, pkt);
+    stage_end(&ost->mux_stats, start, 1);
     if (ret < 0) {
         print_error("av_interleaved_write_frame()", ret);
         exit(1);
@@ -671,27 +813,52 @@ static int check_recording_time(OutputStream *ost)
     return 1;
 }
 
-static void do_audio_out(AVFormatContext *s, OutputStream *ost,
-                         AVFrame *frame)
+#if HAVE_PTHREADS
+/* Return 1 if ost is encoded outside of the main thread. */
+static int encoded_in_thread(OutputStream *ost)
+{
+    return ost->enc_fifo || (ost->filter && ost->filter->graph->fifo);
+}
+#endif
+
+/* Let other threads run while the encoder of ost is busy; nothing but the
+ * encoder context may be touched until encode_lock() is called. */
+static void encode_unlock(OutputStream *ost)
+{
+#if HAVE_PTHREADS
+    if (encoded_in_thread(ost))
+        pthread_mutex_unlock(&transcode_lock);
+#endif
+}
+
+static void encode_lock(OutputStream *ost)
+{
+#if HAVE_PTHREADS
+    if (encoded_in_thread(ost))
+        pthread_mutex_lock(&transcode_lock);
+#endif
+}
+
+static void encode_audio_frame(AVFormatContext *s, OutputStream *ost,
+                               AVFrame *frame)
 {
     AVCodecContext *enc = ost->st->codec;
     AVPacket pkt;
-    int got_packet = 0;
+    int got_packet = 0, ret;
+    int64_t start;
 
     av_init_packet(&pkt);
     pkt.data = NULL;
     pkt.size = 0;
 
-    if (!check_recording_time(ost))
-        return;
-
-    if (frame->pts == AV_NOPTS_VALUE || audio_sync_method < 0)
-        frame->pts = ost->sync_opts;
-    ost->sync_opts = frame->pts + frame->nb_samples;
-
     av_assert0(pkt.size || !pkt.data);
     update_benchmark(NULL);
-    if (avcodec_encode_audio2(enc, &pkt, frame, &got_packet) < 0) {
+    encode_unlock(ost);
+    start = stage_start();
+    ret = avcodec_encode_audio2(enc, &pkt, frame, &got_packet);
+    stage_end(&ost->encode_stats, start, 1);
+    encode_lock(ost);
+    if (ret < 0) {
         av_log(NULL, AV_LOG_FATAL, "Audio encoding failed (avcodec_encode_audio2)\n");
         exit(1);
     }
@@ -719,6 +886,214 @@ static void do_audio_out(AVFormatContext *s, OutputStream *ost,
     }
 }
 
+static void encode_video_frame(AVFormatContext *s, OutputStream *ost,
+                               AVFrame *in_picture)
+{
+    AVCodecContext *enc = ost->st->codec;
+    AVPacket pkt;
+    int got_packet, ret;
+    int64_t pts = in_picture->pts, start;
+
+    av_init_packet(&pkt);
+    pkt.data = NULL;
+    pkt.size = 0;
+
+    if (!ost->frame_aspect_ratio.num)
+        enc->sample_aspect_ratio = in_picture->sample_aspect_ratio;
+
+    if (in_picture->interlaced_frame) {
+        if (enc->codec->id == AV_CODEC_ID_MJPEG)
+            enc->field_order = in_picture->top_field_first ? AV_FIELD_TT:AV_FIELD_BB;
+        else
+            enc->field_order = in_picture->top_field_first ? AV_FIELD_TB:AV_FIELD_BT;
+    } else
+        enc->field_order = AV_FIELD_PROGRESSIVE;
+
+    update_benchmark(NULL);
+    encode_unlock(ost);
+    start = stage_start();
+    ret = avcodec_encode_video2(enc, &pkt, in_picture, &got_packet);
+    stage_end(&ost->encode_stats, start, 1);
+    encode_lock(ost);
+    update_benchmark("encode_video %d.%d", ost->file_index, ost->index);
+    if (ret < 0) {
+        av_log(NULL, AV_LOG_FATAL, "Video encoding failed\n");
+        exit(1);
+    }
+
+    if (got_packet) {
+        int frame_size;
+
+        if (pkt.pts == AV_NOPTS_VALUE && !(enc->codec->capabilities & CODEC_CAP_DELAY))
+            pkt.pts = pts;
+
+        if (pkt.pts != AV_NOPTS_VALUE)
+            pkt.pts = av_rescale_q(pkt.pts, enc->time_base, ost->st->time_base);
+        if (pkt.dts != AV_NOPTS_VALUE)
+            pkt.dts = av_rescale_q(pkt.dts, enc->time_base, ost->st->time_base);
+
+        if (debug_ts) {
+            av_log(NULL, AV_LOG_INFO, "encoder -> type:video "
+                "pkt_pts:%s pkt_pts_time:%s pkt_dts:%s pkt_dts_time:%s\n",
+                av_ts2str(pkt.pts), av_ts2timestr(pkt.pts, &ost->st->time_base),
+                av_ts2str(pkt.dts), av_ts2timestr(pkt.dts, &ost->st->time_base));
+        }
+
+        frame_size = pkt.size;
+        video_size += pkt.size;
+        write_frame(s, &pkt, ost);
+        av_free_packet(&pkt);
+
+        /* if two pass, output log */
+        if (ost->logfile && enc->stats_out) {
+            fprintf(ost->logfile, "%s", enc->stats_out);
+        }
+
+        if (vstats_filename && frame_size)
+            do_video_stats(ost, frame_size);
+    }
+}
+
+#if HAVE_PTHREADS
+static void *encoder_thread(void *arg)
+{
+    OutputStream *ost  = arg;
+    AVFormatContext *s = output_files[ost->file_index]->ctx;
+    AVFrame *frame;
+
+    pthread_mutex_lock(&transcode_lock);
+    for (;;) {
+        while (!av_fifo_size(ost->enc_fifo) && !ost->enc_fifo_eof)
+            pthread_cond_wait(&ost->enc_cond, &transcode_lock);
+        if (!av_fifo_size(ost->enc_fifo))
+            break;
+
+        av_fifo_generic_read(ost->enc_fifo, &frame, sizeof(frame), NULL);
+        pthread_cond_signal(&ost->enc_cond);
+
+        if (ost->st->codec->codec_type == AVMEDIA_TYPE_VIDEO)
+            encode_video_frame(s, ost, frame);
+        else
+            encode_audio_frame(s, ost, frame);
+        av_frame_free(&frame);
+    }
+    pthread_mutex_unlock(&transcode_lock);
+
+    return NULL;
+}
+
+/* Let the encoder threads encode their queued frames and exit.
+ * Called with transcode_lock held. */
+static void free_encoder_threads(void)
+{
+    int i;
+
+    for (i = 0; i < nb_output_streams; i++) {
+        OutputStream *ost = output_streams[i];
+        if (!ost->enc_fifo)
+            continue;
+        ost->enc_fifo_eof = 1;
+        pthread_cond_signal(&ost->enc_cond);
+    }
+
+    pthread_mutex_unlock(&transcode_lock);
+    for (i = 0; i < nb_output_streams; i++)
+        if (output_streams[i]->enc_fifo)
+            pthread_join(output_streams[i]->enc_thread, NULL);
+    pthread_mutex_lock(&transcode_lock);
+
+    for (i = 0; i < nb_output_streams; i++) {
+        OutputStream *ost = output_streams[i];
+        AVFrame *frame;
+
+        if (!ost->enc_fifo)
+            continue;
+
+        while (av_fifo_size(ost->enc_fifo)) {
+            av_fifo_generic_read(ost->enc_fifo, &frame, sizeof(frame), NULL);
+            av_frame_free(&frame);
+        }
+        av_fifo_free(ost->enc_fifo);
+        ost->enc_fifo = NULL;
+        pthread_cond_destroy(&ost->enc_cond);
+    }
+}
+
+static int init_encoder_threads(void)
+{
+    int i, ret;
+
+    if (!encode_threads)
+        return 0;
+
+    for (i = 0; i < nb_output_streams; i++) {
+        OutputStream     *ost = output_streams[i];
+        AVCodecContext   *enc = ost->st->codec;
+        AVOutputFormat *ofmt  = output_files[ost->file_index]->ctx->oformat;
+
+        if (!ost->encoding_needed || !ost->filter)
+            continue;
+        /* raw pictures are passed to the muxer directly, without encoding */
+        if (enc->codec_type == AVMEDIA_TYPE_VIDEO &&
+            (ofmt->flags & AVFMT_RAWPICTURE) && enc->codec->id == AV_CODEC_ID_RAWVIDEO)
+            continue;
+
+        if (!(ost->enc_fifo = av_fifo_alloc(ENCODE_QUEUE_SIZE * sizeof(AVFrame*))))
+            return AVERROR(ENOMEM);
+        pthread_cond_init(&ost->enc_cond, NULL);
+
+        if ((ret = pthread_create(&ost->enc_thread, NULL, encoder_thread, ost))) {
+            av_fifo_free(ost->enc_fifo);
+            ost->enc_fifo = NULL;
+            pthread_cond_destroy(&ost->enc_cond);
+            return AVERROR(ret);
+        }
+    }
+    return 0;
+}
+#endif
+
+/*
+ * Encode frame with the encoder of ost, or queue a reference to it for the
+ * encoder thread of ost, waiting for room in its queue if necessary.
+ */
+static void encode_frame(AVFormatContext *s, OutputStream *ost, AVFrame *frame)
+{
+#if HAVE_PTHREADS
+    if (ost->enc_fifo) {
+        AVFrame *queued = av_frame_clone(frame);
+        if (!queued) {
+            av_log(NULL, AV_LOG_FATAL, "Could not queue frame for encoding\n");
+            exit(1);
+        }
+
+        while (!av_fifo_space(ost->enc_fifo))
+            pthread_cond_wait(&ost->enc_cond, &transcode_lock);
+        stage_queue(&ost->encode_stats, av_fifo_size(ost->enc_fifo) / sizeof(queued));
+        av_fifo_generic_write(ost->enc_fifo, &queued, sizeof(queued), NULL);
+        pthread_cond_signal(&ost->enc_cond);
+        return;
+    }
+#endif
+    if (ost->st->codec->codec_type == AVMEDIA_TYPE_VIDEO)
+        encode_video_frame(s, ost, frame);
+    else
+        encode_audio_frame(s, ost, frame);
+}
+
+static void do_audio_out(AVFormatContext *s, OutputStream *ost,
+                         AVFrame *frame)
+{
+    if (!check_recording_time(ost))
+        return;
+
+    if (frame->pts == AV_NOPTS_VALUE || audio_sync_method < 0)
+        frame->pts = ost->sync_opts;
+    ost->sync_opts = frame->pts + frame->nb_samples;
+
+    encode_frame(s, ost, frame);
+}
+
 static void do_subtitle_out(AVFormatContext *s,
                             OutputStream *ost,
                             InputStream *ist,
@@ -728,7 +1103,7 @@ static void do_subtitle_out(AVFormatContext *s,
     int subtitle_out_size, nb, i;
     AVCodecContext *enc;
     AVPacket pkt;
-    int64_t pts;
+    int64_t pts, start;
 
     if (sub->pts == AV_NOPTS_VALUE) {
         av_log(NULL, AV_LOG_ERROR, "Subtitle packets must have a pts\n");
@@ -765,8 +1140,10 @@ static void do_subtitle_out(AVFormatContext *s,
         sub->start_display_time = 0;
         if (i == 1)
             sub->num_rects = 0;
+        start = stage_start();
         subtitle_out_size = avcodec_encode_subtitle(enc, subtitle_out,
                                                     subtitle_out_max_size, sub);
+        stage_end(&ost->encode_stats, start, 1);
         if (subtitle_out_size < 0) {
             av_log(NULL, AV_LOG_FATAL, "Subtitle encoding failed\n");
             exit(1);
@@ -794,13 +1171,12 @@ static void do_video_out(AVFormatContext *s,
                          OutputStream *ost,
                          AVFrame *in_picture)
 {
-    int ret, format_video_sync;
+    int format_video_sync;
     AVPacket pkt;
     AVCodecContext *enc = ost->st->codec;
     int nb_frames, i;
     double sync_ipts, delta;
     double duration = 0;
-    int frame_size = 0;
     InputStream *ist = NULL;
 
     if (ost->source_index >= 0)
@@ -876,6 +1252,8 @@ static void do_video_out(AVFormatContext *s,
         /* raw pictures are written as AVPicture structure to
            avoid any copies. We support temporarily the older
            method. */
+        if (!ost->frame_aspect_ratio.num)
+            enc->sample_aspect_ratio = in_picture->sample_aspect_ratio;
         enc->coded_frame->interlaced_frame = in_picture->interlaced_frame;
         enc->coded_frame->top_field_first  = in_picture->top_field_first;
         if (enc->coded_frame->interlaced_frame)
@@ -890,21 +1268,13 @@ static void do_video_out(AVFormatContext *s,
         video_size += pkt.size;
         write_frame(s, &pkt, ost);
     } else {
-        int got_packet, forced_keyframe = 0;
+        int forced_keyframe = 0;
         double pts_time;
 
         if (ost->st->codec->flags & (CODEC_FLAG_INTERLACED_DCT|CODEC_FLAG_INTERLACED_ME) &&
             ost->top_field_first >= 0)
             in_picture->top_field_first = !!ost->top_field_first;
 
-        if (in_picture->interlaced_frame) {
-            if (enc->codec->id == AV_CODEC_ID_MJPEG)
-                enc->field_order = in_picture->top_field_first ? AV_FIELD_TT:AV_FIELD_BB;
-            else
-                enc->field_order = in_picture->top_field_first ? AV_FIELD_TB:AV_FIELD_BT;
-        } else
-            enc->field_order = AV_FIELD_PROGRESSIVE;
-
         in_picture->quality = ost->st->codec->global_quality;
         if (!enc->me_threshold)
             in_picture->pict_type = 0;
@@ -943,40 +1313,7 @@ static void do_video_out(AVFormatContext *s,
             av_log(NULL, AV_LOG_DEBUG, "Forced keyframe at time %f\n", pts_time);
         }
 
-        update_benchmark(NULL);
-        ret = avcodec_encode_video2(enc, &pkt, in_picture, &got_packet);
-        update_benchmark("encode_video %d.%d", ost->file_index, ost->index);
-        if (ret < 0) {
-            av_log(NULL, AV_LOG_FATAL, "Video encoding failed\n");
-            exit(1);
-        }
-
-        if (got_packet) {
-            if (pkt.pts == AV_NOPTS_VALUE && !(enc->codec->capabilities & CODEC_CAP_DELAY))
-                pkt.pts = ost->sync_opts;
-
-            if (pkt.pts != AV_NOPTS_VALUE)
-                pkt.pts = av_rescale_q(pkt.pts, enc->time_base, ost->st->time_base);
-            if (pkt.dts != AV_NOPTS_VALUE)
-                pkt.dts = av_rescale_q(pkt.dts, enc->time_base, ost->st->time_base);
-
-            if (debug_ts) {
-                av_log(NULL, AV_LOG_INFO, "encoder -> type:video "
-                    "pkt_pts:%s pkt_pts_time:%s pkt_dts:%s pkt_dts_time:%s\n",
-                    av_ts2str(pkt.pts), av_ts2timestr(pkt.pts, &ost->st->time_base),
-                    av_ts2str(pkt.dts), av_ts2timestr(pkt.dts, &ost->st->time_base));
-            }
-
-            frame_size = pkt.size;
-            video_size += pkt.size;
-            write_frame(s, &pkt, ost);
-            av_free_packet(&pkt);
-
-            /* if two pass, output log */
-            if (ost->logfile && enc->stats_out) {
-                fprintf(ost->logfile, "%s", enc->stats_out);
-            }
-        }
+        encode_frame(s, ost, in_picture);
     }
     ost->sync_opts++;
     /*
@@ -985,9 +1322,6 @@ static void do_video_out(AVFormatContext *s,
      * flush, we need to limit them here, before they go into encoder.
      */
     ost->frame_number++;
-
-    if (vstats_filename && frame_size)
-        do_video_stats(ost, frame_size);
   }
 }
 
@@ -1033,80 +1367,96 @@ static void do_video_stats(OutputStream *ost, int frame_size)
 }
 
 /**
- * Get and encode new output from any of the filtergraphs, without causing
- * activity.
+ * Get and encode new output from the filtergraph output of ost, without
+ * causing activity.
  *
  * @return  0 for success, <0 for severe errors
  */
-static int reap_filters(void)
+static int reap_output_filter(OutputStream *ost)
 {
+    OutputFile    *of = output_files[ost->file_index];
     AVFrame *filtered_frame = NULL;
-    int i;
     int64_t frame_pts;
+    int ret = 0;
 
-    /* Reap all buffers present in the buffer sinks */
-    for (i = 0; i < nb_output_streams; i++) {
-        OutputStream *ost = output_streams[i];
-        OutputFile    *of = output_files[ost->file_index];
-        int ret = 0;
+    if (!ost->filtered_frame && !(ost->filtered_frame = avcodec_alloc_frame())) {
+        return AVERROR(ENOMEM);
+    } else
+        avcodec_get_frame_defaults(ost->filtered_frame);
+    filtered_frame = ost->filtered_frame;
 
-        if (!ost->filter)
-            continue;
+    while (1) {
+        ret = av_buffersink_get_frame_flags(ost->filter->filter, filtered_frame,
+                                           AV_BUFFERSINK_FLAG_NO_REQUEST);
+        if (ret < 0) {
+            if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF) {
+                av_log(NULL, AV_LOG_WARNING,
+                       "Error in av_buffersink_get_frame_flags(): %s\n", av_err2str(ret));
+            }
+            break;
+        }
+        frame_pts = AV_NOPTS_VALUE;
+        if (filtered_frame->pts != AV_NOPTS_VALUE) {
+            filtered_frame->pts = frame_pts = av_rescale_q(filtered_frame->pts,
+                                            ost->filter->filter->inputs[0]->time_base,
+                                            ost->st->codec->time_base) -
+                                av_rescale_q(of->start_time,
+                                            AV_TIME_BASE_Q,
+                                            ost->st->codec->time_base);
+        }
+        //if (ost->source_index >= 0)
+        //    *filtered_frame= *input_streams[ost->source_index]->decoded_frame; //for me_threshold
 
-        if (!ost->filtered_frame && !(ost->filtered_frame = avcodec_alloc_frame())) {
-            return AVERROR(ENOMEM);
-        } else
-            avcodec_get_frame_defaults(ost->filtered_frame);
-        filtered_frame = ost->filtered_frame;
-
-        while (1) {
-            ret = av_buffersink_get_frame_flags(ost->filter->filter, filtered_frame,
-                                               AV_BUFFERSINK_FLAG_NO_REQUEST);
-            if (ret < 0) {
-                if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF) {
-                    av_log(NULL, AV_LOG_WARNING,
-                           "Error in av_buffersink_get_frame_flags(): %s\n", av_err2str(ret));
-                }
+
+        switch (ost->filter->filter->inputs[0]->type) {
+        case AVMEDIA_TYPE_VIDEO:
+            filtered_frame->pts = frame_pts;
+            do_video_out(of->ctx, ost, filtered_frame);
+            break;
+        case AVMEDIA_TYPE_AUDIO:
+            filtered_frame->pts = frame_pts;
+            if (!(ost->st->codec->codec->capabilities & CODEC_CAP_PARAM_CHANGE) &&
+                ost->st->codec->channels != av_frame_get_channels(filtered_frame)) {
+                av_log(NULL, AV_LOG_ERROR,
+                       "Audio filter graph output is not normalized and encoder does not support parameter changes\n");
                 break;
             }
-            frame_pts = AV_NOPTS_VALUE;
-            if (filtered_frame->pts != AV_NOPTS_VALUE) {
-                filtered_frame->pts = frame_pts = av_rescale_q(filtered_frame->pts,
-                                                ost->filter->filter->inputs[0]->time_base,
-                                                ost->st->codec->time_base) -
-                                    av_rescale_q(of->start_time,
-                                                AV_TIME_BASE_Q,
-                                                ost->st->codec->time_base);
-            }
-            //if (ost->source_index >= 0)
-            //    *filtered_frame= *input_streams[ost->source_index]->decoded_frame; //for me_threshold
+            do_audio_out(of->ctx, ost, filtered_frame);
+            break;
+        default:
+            // TODO support subtitle filters
+            av_assert0(0);
+        }
 
+        av_frame_unref(filtered_frame);
+    }
 
-            switch (ost->filter->filter->inputs[0]->type) {
-            case AVMEDIA_TYPE_VIDEO:
-                filtered_frame->pts = frame_pts;
-                if (!ost->frame_aspect_ratio.num)
-                    ost->st->codec->sample_aspect_ratio = filtered_frame->sample_aspect_ratio;
+    return 0;
+}
 
-                do_video_out(of->ctx, ost, filtered_frame);
-                break;
-            case AVMEDIA_TYPE_AUDIO:
-                filtered_frame->pts = frame_pts;
-                if (!(ost->st->codec->codec->capabilities & CODEC_CAP_PARAM_CHANGE) &&
-                    ost->st->codec->channels != av_frame_get_channels(filtered_frame)) {
-                    av_log(NULL, AV_LOG_ERROR,
-                           "Audio filter graph output is not normalized and encoder does not support parameter changes\n");
-                    break;
-                }
-                do_audio_out(of->ctx, ost, filtered_frame);
-                break;
-            default:
-                // TODO support subtitle filters
-                av_assert0(0);
-            }
+/**
+ * Get and encode new output from any of the filtergraphs, without causing
+ * activity.
+ *
+ * @return  0 for success, <0 for severe errors
+ */
+static int reap_filters(void)
+{
+    int i, ret;
 
-            av_frame_unref(filtered_frame);
-        }
+    /* Reap all buffers present in the buffer sinks */
+    for (i = 0; i < nb_output_streams; i++) {
+        OutputStream *ost = output_streams[i];
+
+        if (!ost->filter)
+            continue;
+#if HAVE_PTHREADS
+        /* graphs running in their own thread reap their outputs themselves */
+        if (ost->filter->graph->fifo)
+            continue;
+#endif
+        if ((ret = reap_output_filter(ost)) < 0)
+            return ret;
     }
 
     return 0;
@@ -1330,12 +1680,15 @@ static void flush_encoders(void)
             if (encode) {
                 AVPacket pkt;
                 int got_packet;
+                int64_t start;
                 av_init_packet(&pkt);
                 pkt.data = NULL;
                 pkt.size = 0;
 
                 update_benchmark(NULL);
+                start = stage_start();
                 ret = encode(enc, &pkt, NULL, &got_packet);
+                stage_end(&ost->encode_stats, start, 0);
                 update_benchmark("flush %s %d.%d", desc, ost->file_index, ost->index);
                 if (ret < 0) {
                     av_log(NULL, AV_LOG_FATAL, "%s encoding failed\n", desc);
@@ -1495,12 +1848,31 @@ int guess_input_channel_layout(InputStream *ist)
     return 1;
 }
 
+/* Let other threads run while the decoder of ist is busy; nothing but the
+ * decoder context may be touched until decode_lock() is called. */
+static void decode_unlock(InputStream *ist)
+{
+#if HAVE_PTHREADS
+    if (ist->dec_threaded)
+        pthread_mutex_unlock(&transcode_lock);
+#endif
+}
+
+static void decode_lock(InputStream *ist)
+{
+#if HAVE_PTHREADS
+    if (ist->dec_threaded)
+        pthread_mutex_lock(&transcode_lock);
+#endif
+}
+
 static int decode_audio(InputStream *ist, AVPacket *pkt, int *got_output)
 {
     AVFrame *decoded_frame, *f;
     AVCodecContext *avctx = ist->st->codec;
     int i, ret, err = 0, resample_changed;
     AVRational decoded_frame_tb;
+    int64_t start;
 
     if (!ist->decoded_frame && !(ist->decoded_frame = avcodec_alloc_frame()))
         return AVERROR(ENOMEM);
@@ -1509,7 +1881,11 @@ static int decode_audio(InputStream *ist, AVPacket *pkt, int *got_output)
     decoded_frame = ist->decoded_frame;
 
     update_benchmark(NULL);
+    decode_unlock(ist);
+    start = stage_start();
     ret = avcodec_decode_audio4(avctx, decoded_frame, got_output, pkt);
+    stage_end(&ist->decode_stats, start, *got_output);
+    decode_lock(ist);
     update_benchmark("decode_audio %d.%d", ist->file_index, ist->st->index);
 
     if (ret >= 0 && avctx->sample_rate <= 0) {
@@ -1523,11 +1899,7 @@ static int decode_audio(InputStream *ist, AVPacket *pkt, int *got_output)
     if (!*got_output || ret < 0) {
         if (!pkt->size) {
             for (i = 0; i < ist->nb_filters; i++)
-#if 1
-                av_buffersrc_add_ref(ist->filters[i]->filter, NULL, 0);
-#else
-                av_buffersrc_add_frame(ist->filters[i]->filter, NULL);
-#endif
+                send_filter_frame(ist->filters[i], NULL, 0);
         }
         return ret;
     }
@@ -1578,6 +1950,7 @@ static int decode_audio(InputStream *ist, AVPacket *pkt, int *got_output)
             if (ist_in_filtergraph(filtergraphs[i], ist)) {
                 FilterGraph *fg = filtergraphs[i];
                 int j;
+                wait_filtergraph_idle(fg);
                 if (configure_filtergraph(fg) < 0) {
                     av_log(NULL, AV_LOG_FATAL, "Error reinitializing filters!\n");
                     exit(1);
@@ -1621,8 +1994,7 @@ static int decode_audio(InputStream *ist, AVPacket *pkt, int *got_output)
                 break;
         } else
             f = decoded_frame;
-        err = av_buffersrc_add_frame_flags(ist->filters[i]->filter, f,
-                                     AV_BUFFERSRC_FLAG_PUSH);
+        err = send_filter_frame(ist->filters[i], f, AV_BUFFERSRC_FLAG_PUSH);
         if (err == AVERROR_EOF)
             err = 0; /* ignore */
         if (err < 0)
@@ -1635,12 +2007,29 @@ static int decode_audio(InputStream *ist, AVPacket *pkt, int *got_output)
     return err < 0 ? err : ret;
 }
 
+/* With -skip_dropped, let the decoder skip the non-reference frame in pkt
+ * if all the filters fed by ist would drop it. */
+static void update_skip_frame(InputStream *ist, AVPacket *pkt)
+{
+    AVCodecContext *avctx = ist->st->codec;
+    /* with -r, the buffer sources do not use the stream time base */
+    int i, wanted = !ist->nb_filters || pkt->pts == AV_NOPTS_VALUE ||
+                    ist->framerate.num;
+
+    for (i = 0; i < ist->nb_filters && !wanted; i++)
+        wanted = !ist->filters[i]->filter ||
+                 av_buffersrc_frame_wanted(ist->filters[i]->filter, pkt->pts);
+
+    avctx->skip_frame = wanted ? ist->skip_frame :
+                                 FFMAX(ist->skip_frame, AVDISCARD_NONREF);
+}
+
 static int decode_video(InputStream *ist, AVPacket *pkt, int *got_output)
 {
     AVFrame *decoded_frame, *f;
     void *buffer_to_free = NULL;
     int i, ret = 0, err = 0, resample_changed;
-    int64_t best_effort_timestamp;
+    int64_t best_effort_timestamp, start;
     AVRational *frame_sample_aspect;
 
     if (!ist->decoded_frame && !(ist->decoded_frame = av_frame_alloc()))
@@ -1649,10 +2038,16 @@ static int decode_video(InputStream *ist, AVPacket *pkt, int *got_output)
         return AVERROR(ENOMEM);
     decoded_frame = ist->decoded_frame;
     pkt->dts  = av_rescale_q(ist->dts, AV_TIME_BASE_Q, ist->st->time_base);
+    if (skip_dropped)
+        update_skip_frame(ist, pkt);
 
     update_benchmark(NULL);
+    decode_unlock(ist);
+    start = stage_start();
     ret = avcodec_decode_video2(ist->st->codec,
                                 decoded_frame, got_output, pkt);
+    stage_end(&ist->decode_stats, start, *got_output);
+    decode_lock(ist);
     update_benchmark("decode_video %d.%d", ist->file_index, ist->st->index);
 
     if (*got_output || ret<0 || pkt->size)
@@ -1661,11 +2056,7 @@ static int decode_video(InputStream *ist, AVPacket *pkt, int *got_output)
     if (!*got_output || ret < 0) {
         if (!pkt->size) {
             for (i = 0; i < ist->nb_filters; i++)
-#if 1
-                av_buffersrc_add_ref(ist->filters[i]->filter, NULL, 0);
-#else
-                av_buffersrc_add_frame(ist->filters[i]->filter, NULL);
-#endif
+                send_filter_frame(ist->filters[i], NULL, 0);
         }
         return ret;
     }
@@ -1707,8 +2098,10 @@ static int decode_video(InputStream *ist, AVPacket *pkt, int *got_output)
         ist->resample_pix_fmt = decoded_frame->format;
 
         for (i = 0; i < nb_filtergraphs; i++) {
-            if (ist_in_filtergraph(filtergraphs[i], ist) && ist->reinit_filters &&
-                configure_filtergraph(filtergraphs[i]) < 0) {
+            if (!ist_in_filtergraph(filtergraphs[i], ist) || !ist->reinit_filters)
+                continue;
+            wait_filtergraph_idle(filtergraphs[i]);
+            if (configure_filtergraph(filtergraphs[i]) < 0) {
                 av_log(NULL, AV_LOG_FATAL, "Error reinitializing filters!\n");
                 exit(1);
             }
@@ -1727,7 +2120,7 @@ static int decode_video(InputStream *ist, AVPacket *pkt, int *got_output)
                 break;
         } else
             f = decoded_frame;
-        ret = av_buffersrc_add_frame_flags(ist->filters[i]->filter, f, AV_BUFFERSRC_FLAG_PUSH);
+        ret = send_filter_frame(ist->filters[i], f, AV_BUFFERSRC_FLAG_PUSH);
         if (ret == AVERROR_EOF) {
             ret = 0; /* ignore */
         } else if (ret < 0) {
@@ -1746,9 +2139,12 @@ static int decode_video(InputStream *ist, AVPacket *pkt, int *got_output)
 static int transcode_subtitles(InputStream *ist, AVPacket *pkt, int *got_output)
 {
     AVSubtitle subtitle;
+    int64_t start = stage_start();
     int i, ret = avcodec_decode_subtitle2(ist->st->codec,
                                           &subtitle, got_output, pkt);
 
+    stage_end(&ist->decode_stats, start, *got_output);
+
     if (*got_output || ret<0 || pkt->size)
         decode_error_stat[ret<0] ++;
 
@@ -1932,6 +2328,139 @@ static int output_packet(InputStream *ist, const AVPacket *pkt)
     return 0;
 }
 
+static void report_decode_error(InputStream *ist, int ret)
+{
+    char buf[128];
+    av_strerror(ret, buf, sizeof(buf));
+    av_log(NULL, AV_LOG_ERROR, "Error while decoding stream #%d:%d: %s\n",
+            ist->file_index, ist->st->index, buf);
+    if (exit_on_error)
+        exit(1);
+}
+
+#if HAVE_PTHREADS
+/* Wait until the decoder thread of ist, if any, is done with its packet. */
+static void wait_decoder_idle(InputStream *ist)
+{
+    while (ist->dec_pending)
+        pthread_cond_wait(&ist->dec_cond, &transcode_lock);
+}
+
+static void *decoder_thread(void *arg)
+{
+    InputStream *ist = arg;
+    int ret;
+
+    pthread_mutex_lock(&transcode_lock);
+    for (;;) {
+        while (!ist->dec_pending && !ist->dec_eof)
+            pthread_cond_wait(&ist->dec_cond, &transcode_lock);
+        if (!ist->dec_pending)
+            break;
+
+        ret = output_packet(ist, ist->dec_flush ? NULL : &ist->dec_pkt);
+        av_free_packet(&ist->dec_pkt);
+        ist->dec_pending = 0;
+        pthread_cond_signal(&ist->dec_cond);
+        if (ret < 0)
+            report_decode_error(ist, ret);
+    }
+    pthread_mutex_unlock(&transcode_lock);
+
+    return NULL;
+}
+
+/* Let the decoder threads decode their last packet and exit.
+ * Called with transcode_lock held. */
+static void free_decoder_threads(void)
+{
+    int i;
+
+    for (i = 0; i < nb_input_streams; i++) {
+        InputStream *ist = input_streams[i];
+        if (!ist->dec_threaded)
+            continue;
+        ist->dec_eof = 1;
+        pthread_cond_signal(&ist->dec_cond);
+    }
+
+    pthread_mutex_unlock(&transcode_lock);
+    for (i = 0; i < nb_input_streams; i++)
+        if (input_streams[i]->dec_threaded)
+            pthread_join(input_streams[i]->dec_thread, NULL);
+    pthread_mutex_lock(&transcode_lock);
+
+    for (i = 0; i < nb_input_streams; i++) {
+        InputStream *ist = input_streams[i];
+        if (!ist->dec_threaded)
+            continue;
+        ist->dec_threaded = 0;
+        pthread_cond_destroy(&ist->dec_cond);
+    }
+}
+
+static int init_decoder_threads(void)
+{
+    int i, ret;
+
+    if (!decode_threads)
+        return 0;
+
+    for (i = 0; i < nb_input_streams; i++) {
+        InputStream *ist = input_streams[i];
+        enum AVMediaType type = ist->st->codec->codec_type;
+
+        /* subtitles are cheap to decode and drive sub2video */
+        if (!ist->decoding_needed ||
+            (type != AVMEDIA_TYPE_AUDIO && type != AVMEDIA_TYPE_VIDEO))
+            continue;
+
+        pthread_cond_init(&ist->dec_cond, NULL);
+        if ((ret = pthread_create(&ist->dec_thread, NULL, decoder_thread, ist))) {
+            pthread_cond_destroy(&ist->dec_cond);
+            return AVERROR(ret);
+        }
+        ist->dec_threaded = 1;
+    }
+    return 0;
+}
+#endif
+
+/*
+ * Decode pkt with the decoder of ist, or hand it over to the decoder thread
+ * of ist, which takes ownership of its data. pkt = NULL flushes the decoder
+ * and waits for the flush to complete, so that all the decoded frames have
+ * reached the filtergraphs on return.
+ */
+static int decode_packet(InputStream *ist, AVPacket *pkt)
+{
+#if HAVE_PTHREADS
+    if (ist->dec_threaded) {
+        int ret;
+
+        wait_decoder_idle(ist);
+        av_init_packet(&ist->dec_pkt);
+        ist->dec_pkt.data = NULL;
+        ist->dec_pkt.size = 0;
+        if (pkt) {
+            if ((ret = av_dup_packet(pkt)) < 0)
+                return ret;
+            ist->dec_pkt = *pkt;
+            av_init_packet(pkt);
+            pkt->data = NULL;
+            pkt->size = 0;
+        }
+        ist->dec_flush   = !pkt;
+        ist->dec_pending = 1;
+        pthread_cond_signal(&ist->dec_cond);
+        if (!pkt)
+            wait_decoder_idle(ist);
+        return 0;
+    }
+#endif
+    return output_packet(ist, pkt);
+}
+
 static void print_sdp(void)
 {
     char sdp[16384];
@@ -1974,6 +2503,7 @@ static int init_input_stream(int ist_index, char *error, int error_len)
             return ret;
         }
         assert_avoptions(ist->opts);
+        ist->skip_frame = ist->st->codec->skip_frame;
     }
 
     ist->next_pts = AV_NOPTS_VALUE;
@@ -2615,6 +3145,14 @@ static OutputStream *choose_output(void)
         OutputStream *ost = output_streams[i];
         int64_t opts = av_rescale_q(ost->st->cur_dts, ost->st->time_base,
                                     AV_TIME_BASE_Q);
+#if HAVE_PTHREADS
+        /* the muxer lags behind the encoder threads, use the timestamp of
+         * the next frame to encode so that the choice does not depend on
+         * how far they got */
+        if (ost->enc_fifo)
+            opts = av_rescale_q(ost->sync_opts, ost->st->codec->time_base,
+                                AV_TIME_BASE_Q);
+#endif
         if (!ost->unavailable && !ost->finished && opts < opts_min) {
             opts_min = opts;
             ost_min  = ost;
@@ -2666,6 +3204,7 @@ static int check_keyboard_interaction(int64_t cur_time)
             for (i = 0; i < nb_filtergraphs; i++) {
                 FilterGraph *fg = filtergraphs[i];
                 if (fg->graph) {
+                    wait_filtergraph_idle(fg);
                     if (time < 0) {
                         ret = avfilter_graph_send_command(fg->graph, target, command, arg, buf, sizeof(buf),
                                                           key == 'c' ? AVFILTER_CMD_FLAG_ONE : 0);
@@ -2724,7 +3263,11 @@ static void *input_thread(void *arg)
 
     while (!transcoding_finished && ret >= 0) {
         AVPacket pkt;
+        int pos = f->ring_write;
+        int64_t start = stage_start();
+
         ret = av_read_frame(f->ctx, &pkt);
+        stage_end(&f->demux_stats, start, ret >= 0);
 
         if (ret == AVERROR(EAGAIN)) {
             av_usleep(10000);
@@ -2733,17 +3276,29 @@ static void *input_thread(void *arg)
         } else if (ret < 0)
             break;
 
-        pthread_mutex_lock(&f->fifo_lock);
-        while (!av_fifo_space(f->fifo))
-            pthread_cond_wait(&f->fifo_cond, &f->fifo_lock);
+        if (pos - avpriv_atomic_int_get(&f->ring_read) == INPUT_RING_SIZE) {
+            pthread_mutex_lock(&f->fifo_lock);
+            avpriv_atomic_int_set(&f->ring_waiting, 1);
+            while (pos - avpriv_atomic_int_get(&f->ring_read) == INPUT_RING_SIZE &&
+                   !transcoding_finished)
+                pthread_cond_wait(&f->fifo_cond, &f->fifo_lock);
+            avpriv_atomic_int_set(&f->ring_waiting, 0);
+            pthread_mutex_unlock(&f->fifo_lock);
+        }
+        if (transcoding_finished) {
+            av_free_packet(&pkt);
+            break;
+        }
 
         av_dup_packet(&pkt);
-        av_fifo_generic_write(f->fifo, &pkt, sizeof(pkt), NULL);
-
-        pthread_mutex_unlock(&f->fifo_lock);
+        stage_queue(&f->demux_stats, pos - avpriv_atomic_int_get(&f->ring_read));
+        f->ring[pos & (INPUT_RING_SIZE - 1)] = pkt;
+        /* the barrier in avpriv_atomic_int_get() makes the packet visible
+         * before the new write position */
+        avpriv_atomic_int_set(&f->ring_write, avpriv_atomic_int_get(&f->ring_write) + 1);
     }
 
-    f->finished = 1;
+    avpriv_atomic_int_set(&f->finished, 1);
     return NULL;
 }
 
@@ -2758,27 +3313,20 @@ static void free_input_threads(void)
 
     for (i = 0; i < nb_input_files; i++) {
         InputFile *f = input_files[i];
-        AVPacket pkt;
 
-        if (!f->fifo || f->joined)
+        if (!f->ring || f->joined)
             continue;
 
         pthread_mutex_lock(&f->fifo_lock);
-        while (av_fifo_size(f->fifo)) {
-            av_fifo_generic_read(f->fifo, &pkt, sizeof(pkt), NULL);
-            av_free_packet(&pkt);
-        }
         pthread_cond_signal(&f->fifo_cond);
         pthread_mutex_unlock(&f->fifo_lock);
 
         pthread_join(f->thread, NULL);
         f->joined = 1;
 
-        while (av_fifo_size(f->fifo)) {
-            av_fifo_generic_read(f->fifo, &pkt, sizeof(pkt), NULL);
-            av_free_packet(&pkt);
-        }
-        av_fifo_free(f->fifo);
+        for (; f->ring_read != f->ring_write; f->ring_read++)
+            av_free_packet(&f->ring[f->ring_read & (INPUT_RING_SIZE - 1)]);
+        av_freep(&f->ring);
     }
 }
 
@@ -2792,7 +3340,7 @@ static int init_input_threads(void)
     for (i = 0; i < nb_input_files; i++) {
         InputFile *f = input_files[i];
 
-        if (!(f->fifo = av_fifo_alloc(8*sizeof(AVPacket))))
+        if (!(f->ring = av_malloc(INPUT_RING_SIZE * sizeof(*f->ring))))
             return AVERROR(ENOMEM);
 
         pthread_mutex_init(&f->fifo_lock, NULL);
@@ -2806,28 +3354,40 @@ static int init_input_threads(void)
 
 static int get_input_packet_mt(InputFile *f, AVPacket *pkt)
 {
-    int ret = 0;
+    int end = avpriv_atomic_int_get(&f->ring_write);
+    /* also orders the load of ring_write before the load of the packet */
+    int pos = avpriv_atomic_int_get(&f->ring_read);
+
+    if (pos == end) {
+        if (!avpriv_atomic_int_get(&f->finished))
+            return AVERROR(EAGAIN);
+        /* the thread may have written packets before exiting */
+        if (pos == (end = avpriv_atomic_int_get(&f->ring_write)))
+            return AVERROR_EOF;
+    }
 
-    pthread_mutex_lock(&f->fifo_lock);
+    *pkt = f->ring[pos & (INPUT_RING_SIZE - 1)];
+    /* the packet must be read before its slot is handed back */
+    avpriv_atomic_int_set(&f->ring_read, avpriv_atomic_int_get(&f->ring_read) + 1);
+    pos++;
 
-    if (av_fifo_size(f->fifo)) {
-        av_fifo_generic_read(f->fifo, pkt, sizeof(*pkt), NULL);
+    /* wake the input thread up only once half of the ring is free again,
+     * instead of once per packet */
+    if (end - pos <= INPUT_RING_SIZE / 2 && avpriv_atomic_int_get(&f->ring_waiting)) {
+        pthread_mutex_lock(&f->fifo_lock);
         pthread_cond_signal(&f->fifo_cond);
-    } else {
-        if (f->finished)
-            ret = AVERROR_EOF;
-        else
-            ret = AVERROR(EAGAIN);
+        pthread_mutex_unlock(&f->fifo_lock);
     }
 
-    pthread_mutex_unlock(&f->fifo_lock);
-
-    return ret;
+    return 0;
 }
 #endif
 
 static int get_input_packet(InputFile *f, AVPacket *pkt)
 {
+    int64_t start;
+    int ret;
+
     if (f->rate_emu) {
         int i;
         for (i = 0; i < f->nb_streams; i++) {
@@ -2843,7 +3403,10 @@ static int get_input_packet(InputFile *f, AVPacket *pkt)
     if (nb_input_files > 1)
         return get_input_packet_mt(f, pkt);
 #endif
-    return av_read_frame(f->ctx, pkt);
+    start = stage_start();
+    ret = av_read_frame(f->ctx, pkt);
+    stage_end(&f->demux_stats, start, ret >= 0);
+    return ret;
 }
 
 static int got_eagain(void)
@@ -2897,7 +3460,7 @@ static int process_input(int file_index)
         for (i = 0; i < ifile->nb_streams; i++) {
             ist = input_streams[ifile->ist_index + i];
             if (ist->decoding_needed)
-                output_packet(ist, NULL);
+                decode_packet(ist, NULL);
 
             /* mark all outputs that don't go through lavfi as finished */
             for (j = 0; j < nb_output_streams; j++) {
@@ -2929,6 +3492,11 @@ static int process_input(int file_index)
     if (ist->discard)
         goto discard_packet;
 
+#if HAVE_PTHREADS
+    if (ist->dec_threaded)
+        wait_decoder_idle(ist);
+#endif
+
     if (debug_ts) {
         av_log(NULL, AV_LOG_INFO, "demuxer -> ist_index:%d type:%s "
                "next_dts:%s next_dts_time:%s next_pts:%s next_pts_time:%s pkt_pts:%s pkt_pts_time:%s pkt_dts:%s pkt_dts_time:%s off:%s off_time:%s\n",
@@ -3054,15 +3622,9 @@ static int process_input(int file_index)
 
     sub2video_heartbeat(ist, pkt.pts);
 
-    ret = output_packet(ist, &pkt);
-    if (ret < 0) {
-        char buf[128];
-        av_strerror(ret, buf, sizeof(buf));
-        av_log(NULL, AV_LOG_ERROR, "Error while decoding stream #%d:%d: %s\n",
-                ist->file_index, ist->st->index, buf);
-        if (exit_on_error)
-            exit(1);
-    }
+    ret = decode_packet(ist, &pkt);
+    if (ret < 0)
+        report_decode_error(ist, ret);
 
 discard_packet:
     av_free_packet(&pkt);
@@ -3077,15 +3639,226 @@ discard_packet:
  * @param[out] best_ist  input stream where a frame would allow to continue
  * @return  0 for success, <0 for error
  */
+#if HAVE_PTHREADS
+/* Reap all the outputs of fg. Called with transcode_lock held. */
+static int reap_filtergraph(FilterGraph *fg)
+{
+    int i, ret;
+
+    for (i = 0; i < fg->nb_outputs; i++)
+        if ((ret = reap_output_filter(fg->outputs[i]->ost)) < 0)
+            return ret;
+    return 0;
+}
+
+static void *filtergraph_thread(void *arg)
+{
+    FilterGraph *fg = arg;
+    QueuedFilterFrame q;
+    int64_t start;
+    int i, ret;
+
+    pthread_mutex_lock(&transcode_lock);
+    for (;;) {
+        AVFilterContext *buffersrc;
+
+        while (!av_fifo_size(fg->fifo) && !fg->fifo_eof)
+            pthread_cond_wait(&fg->cond, &transcode_lock);
+        if (!av_fifo_size(fg->fifo))
+            break;
+
+        av_fifo_generic_read(fg->fifo, &q, sizeof(q), NULL);
+        pthread_cond_signal(&fg->cond);
+        fg->busy  = 1;
+        buffersrc = q.ifilter->filter;
+
+        pthread_mutex_unlock(&transcode_lock);
+        start = stage_start();
+        if (q.frame)
+            ret = av_buffersrc_add_frame_flags(buffersrc, q.frame, q.flags);
+        else
+            ret = av_buffersrc_add_ref(buffersrc, NULL, 0);
+        stage_end(&fg->filter_stats, start, !!q.frame);
+        pthread_mutex_lock(&transcode_lock);
+        av_frame_free(&q.frame);
+
+        if (ret < 0 && ret != AVERROR_EOF) {
+            av_log(NULL, AV_LOG_FATAL,
+                   "Failed to inject frame into filter network: %s\n", av_err2str(ret));
+            exit(1);
+        }
+
+        /* pull everything the graph can output without more input, like
+         * transcode_from_filter() does from the main thread */
+        do {
+            if (reap_filtergraph(fg) < 0)
+                exit(1);
+            pthread_mutex_unlock(&transcode_lock);
+            start = stage_start();
+            ret = avfilter_graph_request_oldest(fg->graph);
+            stage_end(&fg->filter_stats, start, 0);
+            pthread_mutex_lock(&transcode_lock);
+        } while (ret >= 0);
+
+        if (ret == AVERROR_EOF) {
+            if (reap_filtergraph(fg) < 0)
+                exit(1);
+            for (i = 0; i < fg->nb_outputs; i++)
+                close_output_stream(fg->outputs[i]->ost);
+        }
+
+        fg->busy = 0;
+        pthread_cond_signal(&fg->cond);
+    }
+    pthread_mutex_unlock(&transcode_lock);
+
+    return NULL;
+}
+
+/* Let the filtergraph threads process their queued frames and exit.
+ * Called with transcode_lock held. */
+static void free_filtergraph_threads(void)
+{
+    int i;
+
+    for (i = 0; i < nb_filtergraphs; i++) {
+        FilterGraph *fg = filtergraphs[i];
+        if (!fg->fifo)
+            continue;
+        fg->fifo_eof = 1;
+        pthread_cond_signal(&fg->cond);
+    }
+
+    pthread_mutex_unlock(&transcode_lock);
+    for (i = 0; i < nb_filtergraphs; i++)
+        if (filtergraphs[i]->fifo)
+            pthread_join(filtergraphs[i]->thread, NULL);
+    pthread_mutex_lock(&transcode_lock);
+
+    for (i = 0; i < nb_filtergraphs; i++) {
+        FilterGraph *fg = filtergraphs[i];
+        QueuedFilterFrame q;
+
+        if (!fg->fifo)
+            continue;
+
+        while (av_fifo_size(fg->fifo)) {
+            av_fifo_generic_read(fg->fifo, &q, sizeof(q), NULL);
+            av_frame_free(&q.frame);
+        }
+        av_fifo_free(fg->fifo);
+        fg->fifo = NULL;
+        pthread_cond_destroy(&fg->cond);
+    }
+}
+
+static int init_filtergraph_threads(void)
+{
+    int i, ret;
+
+    if (!filter_threads)
+        return 0;
+
+    for (i = 0; i < nb_filtergraphs; i++) {
+        FilterGraph *fg = filtergraphs[i];
+
+        /* graphs without inputs are only driven by requests, keep them in
+         * the main loop */
+        if (!fg->nb_inputs)
+            continue;
+
+        if (!(fg->fifo = av_fifo_alloc(FILTER_QUEUE_SIZE * sizeof(QueuedFilterFrame))))
+            return AVERROR(ENOMEM);
+        pthread_cond_init(&fg->cond, NULL);
+
+        if ((ret = pthread_create(&fg->thread, NULL, filtergraph_thread, fg))) {
+            av_fifo_free(fg->fifo);
+            fg->fifo = NULL;
+            pthread_cond_destroy(&fg->cond);
+            return AVERROR(ret);
+        }
+    }
+    return 0;
+}
+
+/* Start the encoder, filtergraph and decoder threads; from then on the main
+ * thread holds transcode_lock until free_transcode_threads(). */
+static int init_transcode_threads(void)
+{
+    int ret;
+
+    if (!encode_threads && !filter_threads && !decode_threads)
+        return 0;
+
+    pthread_mutex_lock(&transcode_lock);
+    transcode_lock_held = 1;
+
+    if ((ret = init_encoder_threads()) < 0)
+        return ret;
+    if ((ret = init_filtergraph_threads()) < 0)
+        return ret;
+    return init_decoder_threads();
+}
+
+static void free_transcode_threads(void)
+{
+    if (!transcode_lock_held)
+        return;
+
+    /* upstream stages first, as they may still queue frames downstream */
+    free_decoder_threads();
+    free_filtergraph_threads();
+    free_encoder_threads();
+
+    pthread_mutex_unlock(&transcode_lock);
+    transcode_lock_held = 0;
+}
+
+/* Select the input of a graph running in its own thread to read from. The
+ * graph itself cannot be queried, so pick the input that is furthest
+ * behind. */
+static int transcode_from_filter_thread(FilterGraph *graph, InputStream **best_ist)
+{
+    int i;
+
+    *best_ist = NULL;
+    for (i = 0; i < graph->nb_inputs; i++) {
+        InputStream *ist = graph->inputs[i]->ist;
+        if (input_files[ist->file_index]->eagain ||
+            input_files[ist->file_index]->eof_reached)
+            continue;
+        if (!*best_ist || ist->pts < (*best_ist)->pts)
+            *best_ist = ist;
+    }
+
+    if (!*best_ist) {
+        /* let the graph finish, it may close its outputs */
+        wait_filtergraph_idle(graph);
+        for (i = 0; i < graph->nb_outputs; i++)
+            graph->outputs[i]->ost->unavailable = 1;
+    }
+
+    return 0;
+}
+#endif
+
 static int transcode_from_filter(FilterGraph *graph, InputStream **best_ist)
 {
     int i, ret;
     int nb_requests, nb_requests_max = 0;
     InputFilter *ifilter;
     InputStream *ist;
+    int64_t start;
+
+#if HAVE_PTHREADS
+    if (graph->fifo)
+        return transcode_from_filter_thread(graph, best_ist);
+#endif
 
     *best_ist = NULL;
+    start = stage_start();
     ret = avfilter_graph_request_oldest(graph->graph);
+    stage_end(&graph->filter_stats, start, 0);
     if (ret >= 0)
         return reap_filters();
 
@@ -3162,6 +3935,110 @@ static int transcode_step(void)
     return reap_filters();
 }
 
+static void report_json_string(AVIOContext *pb, const char *str)
+{
+    avio_w8(pb, '"');
+    for (; str && *str; str++) {
+        unsigned char c = *str;
+        if (c == '"' || c == '\\')
+            avio_printf(pb, "\\%c", c);
+        else if (c < 0x20)
+            avio_printf(pb, "\\u%04x", c);
+        else
+            avio_w8(pb, c);
+    }
+    avio_w8(pb, '"');
+}
+
+static void report_stage(AVIOContext *pb, const char *name,
+                         const StageStats *stats, int64_t wall_time)
+{
+    avio_printf(pb, "\"%s\": { \"time\": %.6f, \"count\": %"PRIu64", "
+                "\"rate\": %.3f, \"queue_max\": %d, \"queue_avg\": %.3f }",
+                name, stats->time / 1000000.0, stats->count,
+                wall_time > 0 ? stats->count * 1000000.0 / wall_time : 0.0,
+                stats->queue_max,
+                stats->nb_queued ? (double)stats->queue_sum / stats->nb_queued : 0.0);
+}
+
+static void report_stream(AVIOContext *pb, AVStream *st)
+{
+    avio_printf(pb, "\"index\": %d, \"type\": ", st->index);
+    report_json_string(pb, av_get_media_type_string(st->codec->codec_type));
+    avio_printf(pb, ", \"codec\": ");
+    report_json_string(pb, avcodec_get_name(st->codec->codec_id));
+}
+
+/* Write the per-stage timings gathered for -benchmark_report as JSON. */
+static void write_benchmark_report(int64_t wall_time)
+{
+    AVIOContext *pb = NULL;
+    const char *url = strcmp(benchmark_report, "-") ? benchmark_report : "pipe:";
+    const AVProfileCounter *c;
+    int i, j, ret;
+
+    ret = avio_open2(&pb, url, AVIO_FLAG_WRITE, &int_cb, NULL);
+    if (ret < 0) {
+        av_log(NULL, AV_LOG_ERROR, "Failed to open benchmark report \"%s\": %s\n",
+               benchmark_report, av_err2str(ret));
+        return;
+    }
+
+    avio_printf(pb, "{\n  \"wall_time\": %.6f,\n  \"inputs\": [", wall_time / 1000000.0);
+    for (i = 0; i < nb_input_files; i++) {
+        InputFile *f = input_files[i];
+        avio_printf(pb, "%s\n    { \"index\": %d, \"url\": ", i ? "," : "", i);
+        report_json_string(pb, f->ctx->filename);
+        avio_printf(pb, ",\n      ");
+        report_stage(pb, "demux", &f->demux_stats, wall_time);
+        avio_printf(pb, ",\n      \"streams\": [");
+        for (j = 0; j < f->nb_streams; j++) {
+            InputStream *ist = input_streams[f->ist_index + j];
+            avio_printf(pb, "%s\n        { ", j ? "," : "");
+            report_stream(pb, ist->st);
+            avio_printf(pb, ", ");
+            report_stage(pb, "decode", &ist->decode_stats, wall_time);
+            avio_printf(pb, " }");
+        }
+        avio_printf(pb, "\n      ] }");
+    }
+    avio_printf(pb, "\n  ],\n  \"filtergraphs\": [");
+    for (i = 0; i < nb_filtergraphs; i++) {
+        FilterGraph *fg = filtergraphs[i];
+        avio_printf(pb, "%s\n    { \"index\": %d, \"simple\": %s, ",
+                    i ? "," : "", i, !fg->graph_desc ? "true" : "false");
+        report_stage(pb, "filter", &fg->filter_stats, wall_time);
+        avio_printf(pb, " }");
+    }
+    avio_printf(pb, "\n  ],\n  \"outputs\": [");
+    for (i = 0; i < nb_output_files; i++) {
+        OutputFile *of = output_files[i];
+        avio_printf(pb, "%s\n    { \"index\": %d, \"url\": ", i ? "," : "", i);
+        report_json_string(pb, of->ctx->filename);
+        avio_printf(pb, ",\n      \"streams\": [");
+        for (j = 0; j < of->ctx->nb_streams; j++) {
+            OutputStream *ost = output_streams[of->ost_index + j];
+            avio_printf(pb, "%s\n        { ", j ? "," : "");
+            report_stream(pb, ost->st);
+            avio_printf(pb, ",\n          ");
+            report_stage(pb, "encode", &ost->encode_stats, wall_time);
+            avio_printf(pb, ",\n          ");
+            report_stage(pb, "mux", &ost->mux_stats, wall_time);
+            avio_printf(pb, " }");
+        }
+        avio_printf(pb, "\n      ] }");
+    }
+    avio_printf(pb, "\n  ],\n  \"counters\": [");
+    for (c = av_profile_next(NULL), i = 0; c; c = av_profile_next(c), i++) {
+        avio_printf(pb, "%s\n    { \"name\": ", i ? "," : "");
+        report_json_string(pb, c->name);
+        avio_printf(pb, ", \"count\": %"PRIu64", \"ticks\": %"PRIu64" }",
+                    c->count, c->time);
+    }
+    avio_printf(pb, "\n  ]\n}\n");
+    avio_close(pb);
+}
+
 /*
  * The following code is the main loop of the file converter
  */
@@ -3182,10 +4059,14 @@ static int transcode(void)
     }
 
     timer_start = av_gettime();
+    if (benchmark_report)
+        av_profile_enable(1);
 
 #if HAVE_PTHREADS
     if ((ret = init_input_threads()) < 0)
         goto fail;
+    if ((ret = init_transcode_threads()) < 0)
+        goto fail;
 #endif
 
     while (!received_sigterm) {
@@ -3213,6 +4094,14 @@ static int transcode(void)
 
         /* dump report by using the output first video and audio streams */
         print_report(0, timer_start, cur_time);
+
+#if HAVE_PTHREADS
+        /* give the worker threads a chance to get the lock */
+        if (transcode_lock_held) {
+            pthread_mutex_unlock(&transcode_lock);
+            pthread_mutex_lock(&transcode_lock);
+        }
+#endif
     }
 #if HAVE_PTHREADS
     free_input_threads();
@@ -3222,9 +4111,12 @@ static int transcode(void)
     for (i = 0; i < nb_input_streams; i++) {
         ist = input_streams[i];
         if (!input_files[ist->file_index]->eof_reached && ist->decoding_needed) {
-            output_packet(ist, NULL);
+            decode_packet(ist, NULL);
         }
     }
+#if HAVE_PTHREADS
+    free_transcode_threads();
+#endif
     flush_encoders();
 
     term_exit();
@@ -3237,6 +4129,8 @@ static int transcode(void)
 
     /* dump report by using the first video and audio streams */
     print_report(1, timer_start, av_gettime());
+    if (benchmark_report)
+        write_benchmark_report(av_gettime() - timer_start);
 
     /* close each encoder */
     for (i = 0; i < nb_output_streams; i++) {
@@ -3261,6 +4155,7 @@ static int transcode(void)
  fail:
 #if HAVE_PTHREADS
     free_input_threads();
+    free_transcode_threads();
 #endif
 
     if (output_streams) {
@@ -3335,7 +4230,7 @@ int main(int argc, char **argv)
 
     setvbuf(stderr,NULL,_IONBF,0); /* win32 runtime needs this */
 
-    av_log_set_flags(AV_LOG_SKIP_REPEATED);
+    av_log_set_flags(AV_LOG_SKIP_REPEATED | AV_LOG_RATE_LIMIT);
     parse_loglevel(argc, argv, options);
 
     if(argc>1 && !strcmp(argv[1], "-d")){
@@ -182,6 +182,15 @@ typedef struct OptionsContext {
     int        nb_apad;
 } OptionsContext;
 
+/* statistics collected for -benchmark_report, one per processing stage */
+typedef struct StageStats {
+    int64_t  time;           /* wall time spent in the stage, in microseconds */
+    uint64_t count;          /* number of packets or frames processed */
+    uint64_t nb_queued;      /* number of items queued to the thread running the stage */
+    uint64_t queue_sum;      /* sum of the queue depths seen when queuing */
+    int      queue_max;      /* largest queue depth seen */
+} StageStats;
+
 typedef struct InputFilter {
     AVFilterContext    *filter;
     struct InputStream *ist;
@@ -210,6 +219,16 @@ typedef struct FilterGraph {
     int          nb_inputs;
     OutputFilter **outputs;
     int         nb_outputs;
+
+    StageStats filter_stats;
+
+#if HAVE_PTHREADS
+    pthread_t thread;           /* thread running this filtergraph */
+    pthread_cond_t cond;        /* signaled whenever fifo is read or written, or the graph becomes idle */
+    AVFifoBuffer *fifo;         /* frames waiting to be sent to the graph; NULL when not threaded */
+    int busy;                   /* the thread is running the graph */
+    int fifo_eof;               /* no more frames will be queued, the thread should exit */
+#endif
 } FilterGraph;
 
 typedef struct InputStream {
@@ -273,6 +292,22 @@ typedef struct InputStream {
     int        nb_filters;
 
     int reinit_filters;
+    enum AVDiscard skip_frame;  /* skip_frame set by the user, see -skip_dropped */
+
+    StageStats decode_stats;
+
+#if HAVE_PTHREADS
+    /* The main thread passes one packet at a time to the decoder thread and
+     * waits for it to be decoded before handling the next packet of this
+     * stream, so that the timestamp checks see the updated stream state. */
+    int dec_threaded;           /* decoded in dec_thread */
+    pthread_t dec_thread;
+    pthread_cond_t dec_cond;    /* signaled whenever dec_pkt is queued or decoded */
+    AVPacket dec_pkt;           /* packet waiting to be decoded */
+    int dec_pending;            /* dec_pkt is waiting to be decoded */
+    int dec_flush;              /* flush the decoder instead of decoding dec_pkt */
+    int dec_eof;                /* no more packets will be queued, the thread should exit */
+#endif
 } InputStream;
 
 typedef struct InputFile {
@@ -287,13 +322,21 @@ typedef struct InputFile {
     int nb_streams_warn;  /* number of streams that the user was warned of */
     int rate_emu;
 
+    StageStats demux_stats;
+
 #if HAVE_PTHREADS
     pthread_t thread;           /* thread reading from this file */
-    int finished;               /* the thread has exited */
+    volatile int finished;      /* the thread has exited */
     int joined;                 /* the thread has been joined */
-    pthread_mutex_t fifo_lock;  /* lock for access to fifo */
-    pthread_cond_t  fifo_cond;  /* the main thread will signal on this cond after reading from fifo */
-    AVFifoBuffer *fifo;         /* demuxed packets are stored here; freed by the main thread */
+    pthread_mutex_t fifo_lock;  /* lock taken by the input thread to sleep on fifo_cond */
+    pthread_cond_t  fifo_cond;  /* the main thread will signal on this cond once it has drained the ring */
+    /* Single-producer/single-consumer ring of demuxed packets: only the input
+     * thread writes packets and ring_write, only the main thread reads them
+     * and updates ring_read. Both counters wrap around. */
+    AVPacket *ring;             /* freed by the main thread */
+    volatile int ring_write;    /* number of packets written */
+    volatile int ring_read;     /* number of packets read */
+    volatile int ring_waiting;  /* the input thread waits for room in the ring */
 #endif
 } InputFile;
 
@@ -367,6 +410,16 @@ typedef struct OutputStream {
     int copy_prior_start;
 
     int keep_pix_fmt;
+
+    StageStats encode_stats;
+    StageStats mux_stats;
+
+#if HAVE_PTHREADS
+    pthread_t enc_thread;       /* thread encoding the frames of this stream */
+    pthread_cond_t enc_cond;    /* signaled whenever enc_fifo is read or written */
+    AVFifoBuffer *enc_fifo;     /* filtered frames waiting to be encoded; NULL when not threaded */
+    int enc_fifo_eof;           /* no more frames will be queued, the thread should exit */
+#endif
 } OutputStream;
 
 typedef struct OutputFile {
@@ -404,12 +457,19 @@ extern int audio_sync_method;
 extern int video_sync_method;
 extern int do_benchmark;
 extern int do_benchmark_all;
+extern char *benchmark_report;
+extern int encode_threads;
+extern int filter_threads;
+extern int decode_threads;
+extern int filter_pipeline;
 extern int do_deinterlace;
 extern int do_hex_dump;
 extern int do_pkt_dump;
 extern int copy_ts;
 extern int copy_tb;
 extern int debug_ts;
+extern int trace_latency;
+extern int skip_dropped;
 extern int exit_on_error;
 extern int print_stats;
 extern int qp_hist;
@@ -74,11 +74,18 @@ int video_sync_method = VSYNC_AUTO;
 int do_deinterlace    = 0;
 int do_benchmark      = 0;
 int do_benchmark_all  = 0;
+char *benchmark_report = NULL;
+int encode_threads    = 0;
+int filter_threads    = 0;
+int decode_threads    = 0;
+int filter_pipeline   = 0;
 int do_hex_dump       = 0;
 int do_pkt_dump       = 0;
 int copy_ts           = 0;
 int copy_tb           = -1;
 int debug_ts          = 0;
+int trace_latency     = 0;
+int skip_dropped      = 0;
 int exit_on_error     = 0;
 int print_stats       = -1;
 int qp_hist           = 0;
@@ -791,6 +798,8 @@ static int open_input_file(OptionsContext *o, const char *filename)
     ic->subtitle_codec_id= subtitle_codec_name ?
         find_codec_or_die(subtitle_codec_name, AVMEDIA_TYPE_SUBTITLE, 0)->id : AV_CODEC_ID_NONE;
     ic->flags |= AVFMT_FLAG_NONBLOCK;
+    if (trace_latency)
+        ic->flags |= AVFMT_FLAG_LATENCY_TRACE;
     ic->interrupt_callback = int_cb;
 
     /* open the input file with generic avformat function */
@@ -1619,6 +1628,8 @@ static int open_output_file(OptionsContext *o, const char *filename)
 
     file_oformat= oc->oformat;
     oc->interrupt_callback = int_cb;
+    if (trace_latency)
+        oc->flags |= AVFMT_FLAG_LATENCY_TRACE;
 
     /* create streams for all unlabeled output pads */
     for (i = 0; i < nb_filtergraphs; i++) {
@@ -2616,6 +2627,18 @@ const OptionDef options[] = {
         "add timings for benchmarking" },
     { "benchmark_all",  OPT_BOOL | OPT_EXPERT,                       { &do_benchmark_all },
       "add timings for each task" },
+    { "benchmark_report", HAS_ARG | OPT_STRING | OPT_EXPERT,          { &benchmark_report },
+      "write a JSON report of the time spent in each stage to file at exit", "file" },
+#if HAVE_PTHREADS
+    { "encode_threads", OPT_BOOL | OPT_EXPERT,                       { &encode_threads },
+      "run the encoder of each filtered output stream in its own thread" },
+    { "filter_threads", OPT_BOOL | OPT_EXPERT,                       { &filter_threads },
+      "run each filtergraph in its own thread" },
+    { "decode_threads", OPT_BOOL | OPT_EXPERT,                       { &decode_threads },
+      "run the decoder of each audio and video input stream in its own thread" },
+#endif
+    { "filter_pipeline", OPT_BOOL | OPT_EXPERT,                      { &filter_pipeline },
+      "run the linear chains of filters of each filtergraph in separate threads" },
     { "progress",       HAS_ARG | OPT_EXPERT,                        { .func_arg = opt_progress },
       "write program-readable progress information", "url" },
     { "stdin",          OPT_BOOL | OPT_EXPERT,                       { &stdin_interaction },
@@ -2694,6 +2717,10 @@ const OptionDef options[] = {
         "extract an attachment into a file", "filename" },
     { "debug_ts",       OPT_BOOL | OPT_EXPERT,                       { &debug_ts },
         "print timestamp debugging info" },
+    { "trace_latency",  OPT_BOOL | OPT_EXPERT,                       { &trace_latency },
+        "print the latency of each muxed packet through each processing stage" },
+    { "skip_dropped",   OPT_BOOL | OPT_EXPERT,                       { &skip_dropped },
+        "do not decode the non-reference frames the filters would drop" },
 
     /* video options */
     { "vframes",      OPT_VIDEO | HAS_ARG  | OPT_PERFILE | OPT_OUTPUT,           { .func_arg = opt_video_frames },
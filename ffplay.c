@@ -123,6 +123,7 @@ typedef struct VideoPicture {
     double pts;             // presentation timestamp for this picture
     int64_t pos;            // byte position in file
     SDL_Overlay *bmp;
+    AVFrame *frame;         // decoded picture, not yet copied to bmp if it has data
     int width, height; /* source height & width */
     int allocated;
     int reallocate;
@@ -811,6 +812,73 @@ static void calculate_display_rect(SDL_Rect *rect, int scr_xleft, int scr_ytop,
     rect->h = FFMAX(height, 1);
 }
 
+static void duplicate_right_border_pixels(SDL_Overlay *bmp) {
+    int i, width, height;
+    Uint8 *p, *maxp;
+    for (i = 0; i < 3; i++) {
+        width  = bmp->w;
+        height = bmp->h;
+        if (i > 0) {
+            width  >>= 1;
+            height >>= 1;
+        }
+        if (bmp->pitches[i] > width) {
+            maxp = bmp->pixels[i] + bmp->pitches[i] * height - 1;
+            for (p = bmp->pixels[i] + width - 1; p < maxp; p += bmp->pitches[i])
+                *(p+1) = *p;
+        }
+    }
+}
+
+/* Copy the decoded picture to the overlay, converting it if it is not
+ * yuv420p. This is done in the main thread when the picture is displayed
+ * first, so that the decoding thread never waits for it and the pictures
+ * dropped for being late are never copied. */
+static void upload_picture(VideoState *is, VideoPicture *vp)
+{
+    AVFrame *frame = vp->frame;
+    AVPicture pict = { { 0 } };
+
+    if (!frame || !frame->data[0])
+        return;
+
+    SDL_LockYUVOverlay(vp->bmp);
+
+    pict.data[0] = vp->bmp->pixels[0];
+    pict.data[1] = vp->bmp->pixels[2];
+    pict.data[2] = vp->bmp->pixels[1];
+
+    pict.linesize[0] = vp->bmp->pitches[0];
+    pict.linesize[1] = vp->bmp->pitches[2];
+    pict.linesize[2] = vp->bmp->pitches[1];
+
+#if !CONFIG_AVFILTER
+    if (frame->format != AV_PIX_FMT_YUV420P) {
+        av_opt_get_int(sws_opts, "sws_flags", 0, &sws_flags);
+        is->img_convert_ctx = sws_getCachedContext(is->img_convert_ctx,
+            vp->width, vp->height, frame->format, vp->width, vp->height,
+            AV_PIX_FMT_YUV420P, sws_flags, NULL, NULL, NULL);
+        if (is->img_convert_ctx == NULL) {
+            av_log(NULL, AV_LOG_FATAL, "Cannot initialize the conversion context\n");
+            exit(1);
+        }
+        sws_scale(is->img_convert_ctx, frame->data, frame->linesize,
+                  0, vp->height, pict.data, pict.linesize);
+    } else
+#endif
+    /* the buffersink only outputs yuv420p, which is the layout of the
+     * overlay, so the planes are copied as they are */
+    av_picture_copy(&pict, (AVPicture *)frame,
+                    AV_PIX_FMT_YUV420P, vp->width, vp->height);
+
+    /* workaround SDL PITCH_WORKAROUND */
+    duplicate_right_border_pixels(vp->bmp);
+    SDL_UnlockYUVOverlay(vp->bmp);
+
+    /* give the buffer back to the decoder */
+    av_frame_unref(frame);
+}
+
 static void video_image_display(VideoState *is)
 {
     VideoPicture *vp;
@@ -821,6 +889,8 @@ static void video_image_display(VideoState *is)
 
     vp = &is->pictq[is->pictq_rindex];
     if (vp->bmp) {
+        upload_picture(is, vp);
+
         if (is->subtitle_st) {
             if (is->subpq_size > 0) {
                 sp = &is->subpq[is->subpq_rindex];
@@ -1020,6 +1090,7 @@ static void stream_close(VideoState *is)
             SDL_FreeYUVOverlay(vp->bmp);
             vp->bmp = NULL;
         }
+        av_frame_free(&vp->frame);
     }
     SDL_DestroyMutex(is->pictq_mutex);
     SDL_DestroyCond(is->pictq_cond);
@@ -1534,24 +1605,6 @@ static void alloc_picture(VideoState *is)
     SDL_UnlockMutex(is->pictq_mutex);
 }
 
-static void duplicate_right_border_pixels(SDL_Overlay *bmp) {
-    int i, width, height;
-    Uint8 *p, *maxp;
-    for (i = 0; i < 3; i++) {
-        width  = bmp->w;
-        height = bmp->h;
-        if (i > 0) {
-            width  >>= 1;
-            height >>= 1;
-        }
-        if (bmp->pitches[i] > width) {
-            maxp = bmp->pixels[i] + bmp->pitches[i] * height - 1;
-            for (p = bmp->pixels[i] + width - 1; p < maxp; p += bmp->pitches[i])
-                *(p+1) = *p;
-        }
-    }
-}
-
 static int queue_picture(VideoState *is, AVFrame *src_frame, double pts, int64_t pos, int serial)
 {
     VideoPicture *vp;
@@ -1614,39 +1667,13 @@ static int queue_picture(VideoState *is, AVFrame *src_frame, double pts, int64_t
 
     /* if the frame is not skipped, then display it */
     if (vp->bmp) {
-        AVPicture pict = { { 0 } };
-
-        /* get a pointer on the bitmap */
-        SDL_LockYUVOverlay (vp->bmp);
-
-        pict.data[0] = vp->bmp->pixels[0];
-        pict.data[1] = vp->bmp->pixels[2];
-        pict.data[2] = vp->bmp->pixels[1];
-
-        pict.linesize[0] = vp->bmp->pitches[0];
-        pict.linesize[1] = vp->bmp->pitches[2];
-        pict.linesize[2] = vp->bmp->pitches[1];
-
-#if CONFIG_AVFILTER
-        // FIXME use direct rendering
-        av_picture_copy(&pict, (AVPicture *)src_frame,
-                        src_frame->format, vp->width, vp->height);
-#else
-        av_opt_get_int(sws_opts, "sws_flags", 0, &sws_flags);
-        is->img_convert_ctx = sws_getCachedContext(is->img_convert_ctx,
-            vp->width, vp->height, src_frame->format, vp->width, vp->height,
-            AV_PIX_FMT_YUV420P, sws_flags, NULL, NULL, NULL);
-        if (is->img_convert_ctx == NULL) {
-            av_log(NULL, AV_LOG_FATAL, "Cannot initialize the conversion context\n");
-            exit(1);
-        }
-        sws_scale(is->img_convert_ctx, src_frame->data, src_frame->linesize,
-                  0, vp->height, pict.data, pict.linesize);
-#endif
-        /* workaround SDL PITCH_WORKAROUND */
-        duplicate_right_border_pixels(vp->bmp);
-        /* update the bitmap content */
-        SDL_UnlockYUVOverlay(vp->bmp);
+        /* keep a reference to the frame, it is copied to the overlay by
+         * upload_picture() */
+        if (!vp->frame && !(vp->frame = av_frame_alloc()))
+            return AVERROR(ENOMEM);
+        av_frame_unref(vp->frame);
+        if (av_frame_ref(vp->frame, src_frame) < 0)
+            return AVERROR(ENOMEM);
 
         vp->pts = pts;
         vp->pos = pos;
@@ -3505,7 +3532,7 @@ int main(int argc, char **argv)
     VideoState *is;
     char dummy_videodriver[] = "SDL_VIDEODRIVER=dummy";
 
-    av_log_set_flags(AV_LOG_SKIP_REPEATED);
+    av_log_set_flags(AV_LOG_SKIP_REPEATED | AV_LOG_RATE_LIMIT);
     parse_loglevel(argc, argv, options);
 
     /* register all codecs, demux and protocols */
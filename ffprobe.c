@@ -52,6 +52,7 @@ static int do_count_frames = 0;
 static int do_count_packets = 0;
 static int do_read_frames  = 0;
 static int do_read_packets = 0;
+static int do_parse_frames = 0;
 static int do_show_chapters = 0;
 static int do_show_error   = 0;
 static int do_show_format  = 0;
@@ -1565,12 +1566,91 @@ static av_always_inline int process_frame(WriterContext *w,
     return got_frame;
 }
 
+/* describe the frame in pkt from the packet and the headers found by
+   the parser, without decoding it */
+static int parse_frame(WriterContext *w, AVFormatContext *fmt_ctx,
+                       AVFrame *frame, AVPacket *pkt,
+                       AVCodecParserContext *parser)
+{
+    AVStream *st = fmt_ctx->streams[pkt->stream_index];
+    AVCodecContext *dec_ctx = st->codec;
+    uint8_t *out;
+    int out_size;
+
+    if (dec_ctx->codec_type != AVMEDIA_TYPE_VIDEO &&
+        dec_ctx->codec_type != AVMEDIA_TYPE_AUDIO)
+        return 0;
+
+    avcodec_get_frame_defaults(frame);
+    frame->key_frame = !!(pkt->flags & AV_PKT_FLAG_KEY);
+    if (parser) {
+        /* so that what the parser does not know is reported as unknown */
+        parser->pict_type = AV_PICTURE_TYPE_NONE;
+        parser->key_frame = -1;
+        parser->duration  = 0;
+        av_parser_parse2(parser, dec_ctx, &out, &out_size,
+                         pkt->data, pkt->size, pkt->pts, pkt->dts, pkt->pos);
+        frame->pict_type   = parser->pict_type;
+        frame->repeat_pict = parser->repeat_pict;
+        if (parser->key_frame >= 0)
+            frame->key_frame = parser->key_frame;
+        else if (parser->pict_type != AV_PICTURE_TYPE_NONE)
+            frame->key_frame = parser->pict_type == AV_PICTURE_TYPE_I;
+        frame->interlaced_frame = parser->field_order > AV_FIELD_PROGRESSIVE;
+        frame->top_field_first  = parser->field_order == AV_FIELD_TT ||
+                                  parser->field_order == AV_FIELD_TB;
+    }
+    frame->pkt_pts = pkt->pts;
+    frame->pkt_dts = pkt->dts;
+    av_frame_set_pkt_duration(frame, pkt->duration);
+    av_frame_set_pkt_pos     (frame, pkt->pos);
+    av_frame_set_pkt_size    (frame, pkt->size);
+    frame->coded_picture_number = nb_streams_frames[pkt->stream_index];
+
+    switch (dec_ctx->codec_type) {
+    case AVMEDIA_TYPE_VIDEO:
+        frame->width               = dec_ctx->width;
+        frame->height              = dec_ctx->height;
+        frame->format              = dec_ctx->pix_fmt;
+        frame->sample_aspect_ratio = dec_ctx->sample_aspect_ratio;
+        break;
+
+    case AVMEDIA_TYPE_AUDIO:
+        frame->format     = dec_ctx->sample_fmt;
+        frame->nb_samples = parser && parser->duration > 0 ? parser->duration :
+                            av_get_audio_frame_duration(dec_ctx, pkt->size);
+        av_frame_set_channels      (frame, dec_ctx->channels);
+        av_frame_set_channel_layout(frame, dec_ctx->channel_layout);
+        break;
+    }
+
+    nb_streams_frames[pkt->stream_index]++;
+    if (do_show_frames)
+        show_frame(w, frame, st, fmt_ctx);
+    return 1;
+}
+
 static void read_packets(WriterContext *w, AVFormatContext *fmt_ctx)
 {
     AVPacket pkt, pkt1;
     AVFrame frame;
+    AVCodecParserContext **parsers = NULL;
     int i = 0;
 
+    if (do_read_frames && do_parse_frames) {
+        parsers = av_calloc(fmt_ctx->nb_streams, sizeof(*parsers));
+        if (!parsers)
+            return;
+        for (i = 0; i < fmt_ctx->nb_streams; i++) {
+            if (!selected_streams[i])
+                continue;
+            parsers[i] = av_parser_init(fmt_ctx->streams[i]->codec->codec_id);
+            if (parsers[i])
+                parsers[i]->flags |= PARSER_FLAG_COMPLETE_FRAMES;
+        }
+        i = 0;
+    }
+
     av_init_packet(&pkt);
 
     while (!av_read_frame(fmt_ctx, &pkt)) {
@@ -1580,13 +1660,22 @@ static void read_packets(WriterContext *w, AVFormatContext *fmt_ctx)
                     show_packet(w, fmt_ctx, &pkt, i++);
                 nb_streams_packets[pkt.stream_index]++;
             }
-            if (do_read_frames) {
+            if (parsers) {
+                parse_frame(w, fmt_ctx, &frame, &pkt, parsers[pkt.stream_index]);
+            } else if (do_read_frames) {
                 pkt1 = pkt;
                 while (pkt1.size && process_frame(w, fmt_ctx, &frame, &pkt1) > 0);
             }
         }
         av_free_packet(&pkt);
     }
+    if (parsers) {
+        for (i = 0; i < fmt_ctx->nb_streams; i++)
+            if (parsers[i])
+                av_parser_close(parsers[i]);
+        av_freep(&parsers);
+        return;
+    }
     av_init_packet(&pkt);
     pkt.data = NULL;
     pkt.size = 0;
@@ -2233,6 +2322,7 @@ static const OptionDef real_options[] = {
     { "show_chapters", 0, {(void*)&opt_show_chapters}, "show chapters info" },
     { "count_frames", OPT_BOOL, {(void*)&do_count_frames}, "count the number of frames per stream" },
     { "count_packets", OPT_BOOL, {(void*)&do_count_packets}, "count the number of packets per stream" },
+    { "parse_frames", OPT_BOOL, {(void*)&do_parse_frames}, "get the frames info from the parsers instead of decoding" },
     { "show_program_version",  0, {(void*)&opt_show_program_version},  "show ffprobe version" },
     { "show_library_versions", 0, {(void*)&opt_show_library_versions}, "show library versions" },
     { "show_versions",         0, {(void*)&opt_show_versions}, "show program and library versions" },
@@ -2269,7 +2359,7 @@ int main(int argc, char **argv)
     char *w_name = NULL, *w_args = NULL;
     int ret, i;
 
-    av_log_set_flags(AV_LOG_SKIP_REPEATED);
+    av_log_set_flags(AV_LOG_SKIP_REPEATED | AV_LOG_RATE_LIMIT);
     atexit(exit_program);
 
     options = real_options;
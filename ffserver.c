@@ -59,10 +59,16 @@
 #if HAVE_POLL_H
 #include <poll.h>
 #endif
+#if HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
 #include <errno.h>
 #include <time.h>
 #include <sys/wait.h>
 #include <signal.h>
+#if HAVE_FLOCK
+#include <sys/file.h>
+#endif
 #if HAVE_DLFCN_H
 #include <dlfcn.h>
 #endif
@@ -115,11 +121,23 @@ static const char *http_state[] = {
 
 #define SYNC_TIMEOUT (10 * 1000)
 
+/* viewers of a shared muxer lagging further behind are disconnected */
+#define MAX_SHARED_CHUNKS 4096
+
 typedef struct RTSPActionServerSetup {
     uint32_t ipaddr;
     char transport_option[512];
 } RTSPActionServerSetup;
 
+/* output of a shared muxer for one packet, sent to all its viewers */
+typedef struct SharedChunk {
+    struct SharedChunk *next;
+    uint8_t *data;
+    int size;
+    int key;    /* viewers may start with this chunk */
+    int refs;   /* number of viewers on this chunk */
+} SharedChunk;
+
 typedef struct {
     int64_t count1, count2;
     int64_t time1, time2;
@@ -131,6 +149,9 @@ typedef struct HTTPContext {
     int fd; /* socket file descriptor */
     struct sockaddr_in from_addr; /* origin */
     struct pollfd *poll_entry; /* used when polling */
+#if HAVE_SYS_EPOLL_H
+    struct pollfd epoll_entry; /* events registered to epoll_fd, if any */
+#endif
     int64_t timeout;
     uint8_t *buffer_ptr, *buffer_end;
     int http_error;
@@ -171,6 +192,13 @@ typedef struct HTTPContext {
     uint8_t *buffer;
     int is_packetized; /* if true, the stream is packetized */
     int packet_stream_index; /* current stream for output in state machine */
+    int pkt_key; /* the last muxed packet starts a keyframe */
+
+    /* shared muxer viewer specific */
+    int shared;   /* if true, data is sent from the shared muxer of the stream */
+    int shared_joined;  /* counted in the viewers of the shared muxer */
+    int shared_started;
+    SharedChunk *chunk; /* chunk being sent, NULL before the first one */
 
     /* RTSP state specific */
     uint8_t *pb_buffer; /* XXX: use that in all the code */
@@ -247,6 +275,13 @@ typedef struct FFStream {
     int multicast_ttl;
     int loop; /* if true, send the stream in loops (only meaningful if file) */
 
+    /* shared muxer, feeding the HTTP viewers of a live stream */
+    int shared_mux;      /* true if the HTTP viewers share one muxer */
+    struct HTTPContext *mux_c; /* muxing context, NULL when no viewers */
+    SharedChunk *first_chunk, *last_chunk;
+    int nb_chunks;
+    int nb_shared_viewers;
+
     /* feed specific */
     int feed_opened;     /* true if someone is writing to the feed */
     int is_feed;         /* true if it is a feed */
@@ -257,6 +292,7 @@ typedef struct FFStream {
     int64_t feed_max_size;      /* maximum storage size, zero means unlimited */
     int64_t feed_write_index;   /* current write position in feed (it wraps around) */
     int64_t feed_size;          /* current size of feed */
+    int worker_fd;              /* to follow the feed written by another worker */
     struct FFStream *next_feed;
 } FFStream;
 
@@ -280,8 +316,10 @@ static void close_connection(HTTPContext *c);
 static int handle_connection(HTTPContext *c);
 static int http_parse_request(HTTPContext *c);
 static int http_send_data(HTTPContext *c);
+static int http_prepare_data(HTTPContext *c);
 static void compute_status(HTTPContext *c);
 static int open_input_stream(HTTPContext *c, const char *info);
+static void shared_leave(HTTPContext *c);
 static int http_start_receive_data(HTTPContext *c);
 static int http_receive_data(HTTPContext *c);
 
@@ -316,12 +354,19 @@ static int need_to_start_children;
 
 /* maximum number of simultaneous HTTP connections */
 static unsigned int nb_max_http_connections = 2000;
+#if HAVE_SYS_EPOLL_H
+static int epoll_fd = -1;
+#endif
 static unsigned int nb_max_connections = 5;
 static unsigned int nb_connections;
 
 static uint64_t max_bandwidth = 1000;
 static uint64_t current_bandwidth;
 
+/* processes accepting connections on the listening sockets */
+static int nb_workers = 1;
+static pid_t master_pid;           /* only set in the forked workers */
+
 static int64_t cur_time;           // Making this global saves on passing it around everywhere
 
 static AVLFG random_state;
@@ -572,6 +617,61 @@ static int socket_open_listen(struct sockaddr_in *my_addr)
     return server_fd;
 }
 
+/* fork the additional workers, which inherit the listening sockets and
+   follow the feeds through their files; returns in every process */
+static void start_workers(void)
+{
+    FFStream *feed;
+    int i;
+
+    for (i = 1; i < nb_workers; i++) {
+        pid_t pid = fork();
+
+        if (pid < 0) {
+            http_log("Unable to create worker: %s\n", strerror(errno));
+            break;
+        }
+        if (!pid) {
+            master_pid = getppid();
+            /* RTSP session ids must not collide between workers */
+            av_lfg_init(&random_state, av_get_random_seed());
+            break;
+        }
+    }
+
+    /* opened after the fork so that file offsets are not shared */
+    for (feed = first_feed; feed; feed = feed->next_feed) {
+        feed->worker_fd = open(feed->feed_filename, O_RDONLY);
+        if (feed->worker_fd >= 0)
+            fcntl(feed->worker_fd, F_SETFD, FD_CLOEXEC);
+    }
+}
+
+/* pick up the packets written by the worker receiving a feed */
+static void refresh_feeds(void)
+{
+    FFStream *feed;
+    HTTPContext *c;
+    int64_t index;
+
+    for (feed = first_feed; feed; feed = feed->next_feed) {
+        if (feed->feed_opened || feed->worker_fd < 0)
+            continue;
+        index = ffm_read_write_index(feed->worker_fd);
+        if (index < FFM_PACKET_SIZE || index == feed->feed_write_index)
+            continue;
+        feed->feed_write_index = index;
+        feed->feed_size = FFMAX(feed->feed_size,
+                                lseek(feed->worker_fd, 0, SEEK_END));
+
+        for(c = first_http_ctx; c != NULL; c = c->next) {
+            if (c->state == HTTPSTATE_WAIT_FEED &&
+                c->stream->feed == feed)
+                c->state = HTTPSTATE_SEND_DATA;
+        }
+    }
+}
+
 /* start all multicast streams */
 static void start_multicast(void)
 {
@@ -629,18 +729,60 @@ static void start_multicast(void)
     }
 }
 
+#if HAVE_SYS_EPOLL_H
+/* Keep the registration of fd to epoll_fd in sync with the poll() events
+ * wanted in entry; data identifies the descriptor in the returned events. */
+static int epoll_update(struct pollfd *entry, int fd, int events, void *data)
+{
+    struct epoll_event ev = { 0 };
+    int op;
+
+    entry->revents = 0;
+    if (entry->events == events)
+        return 0;
+    if (!events)
+        op = EPOLL_CTL_DEL;
+    else
+        op = entry->events ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+    ev.events   = (events & POLLIN  ? EPOLLIN  : 0) |
+                  (events & POLLOUT ? EPOLLOUT : 0);
+    ev.data.ptr = data;
+    if (epoll_ctl(epoll_fd, op, fd, &ev) < 0) {
+        http_log("epoll_ctl failed: %s\n", strerror(errno));
+        return -1;
+    }
+    entry->fd     = fd;
+    entry->events = events;
+    return 0;
+}
+#endif
+
 /* main loop of the http server */
 static int http_server(void)
 {
     int server_fd = 0, rtsp_server_fd = 0;
     int ret, delay, delay1;
-    struct pollfd *poll_table, *poll_entry;
     HTTPContext *c, *c_next;
+#if HAVE_SYS_EPOLL_H
+    /* the listening sockets are identified by the addresses of their entries */
+    struct pollfd server_entry = { 0 }, rtsp_server_entry = { 0 };
+    struct epoll_event *epoll_events;
+    int i;
+#else
+    struct pollfd *poll_table, *poll_entry;
+#endif
 
+#if HAVE_SYS_EPOLL_H
+    if(!(epoll_events = av_mallocz((nb_max_http_connections + 2)*sizeof(*epoll_events)))) {
+        http_log("Impossible to allocate an epoll event table handling %d connections.\n", nb_max_http_connections);
+        return -1;
+    }
+#else
     if(!(poll_table = av_mallocz((nb_max_http_connections + 2)*sizeof(*poll_table)))) {
         http_log("Impossible to allocate a poll table handling %d connections.\n", nb_max_http_connections);
         return -1;
     }
+#endif
 
     if (my_http_addr.sin_port) {
         server_fd = socket_open_listen(&my_http_addr);
@@ -663,9 +805,30 @@ static int http_server(void)
 
     start_children(first_feed);
 
-    start_multicast();
+    if (nb_workers > 1)
+        start_workers();
+
+    /* multicast streams are only sent once */
+    if (!master_pid)
+        start_multicast();
+
+#if HAVE_SYS_EPOLL_H
+    /* each worker needs its own epoll instance */
+    if ((epoll_fd = epoll_create(nb_max_http_connections + 2)) < 0) {
+        http_log("epoll_create failed: %s\n", strerror(errno));
+        return -1;
+    }
+    fcntl(epoll_fd, F_SETFD, FD_CLOEXEC);
+    if (server_fd &&
+        epoll_update(&server_entry, server_fd, POLLIN, &server_entry) < 0)
+        return -1;
+    if (rtsp_server_fd &&
+        epoll_update(&rtsp_server_entry, rtsp_server_fd, POLLIN, &rtsp_server_entry) < 0)
+        return -1;
+#endif
 
     for(;;) {
+#if !HAVE_SYS_EPOLL_H
         poll_entry = poll_table;
         if (server_fd) {
             poll_entry->fd = server_fd;
@@ -677,31 +840,25 @@ static int http_server(void)
             poll_entry->events = POLLIN;
             poll_entry++;
         }
+#endif
 
         /* wait for events on each HTTP handle */
         c = first_http_ctx;
         delay = 1000;
         while (c != NULL) {
-            int fd;
-            fd = c->fd;
+            int events = 0;
             switch(c->state) {
             case HTTPSTATE_SEND_HEADER:
             case RTSPSTATE_SEND_REPLY:
             case RTSPSTATE_SEND_PACKET:
-                c->poll_entry = poll_entry;
-                poll_entry->fd = fd;
-                poll_entry->events = POLLOUT;
-                poll_entry++;
+                events = POLLOUT;
                 break;
             case HTTPSTATE_SEND_DATA_HEADER:
             case HTTPSTATE_SEND_DATA:
             case HTTPSTATE_SEND_DATA_TRAILER:
                 if (!c->is_packetized) {
                     /* for TCP, we output as much as we can (may need to put a limit) */
-                    c->poll_entry = poll_entry;
-                    poll_entry->fd = fd;
-                    poll_entry->events = POLLOUT;
-                    poll_entry++;
+                    events = POLLOUT;
                 } else {
                     /* when ffserver is doing the timing, we work by
                        looking at which packet need to be sent every
@@ -711,34 +868,78 @@ static int http_server(void)
                         delay = delay1;
                 }
                 break;
+            case HTTPSTATE_WAIT_FEED:
+                /* the feed may be received by another worker, which
+                   cannot wake us up */
+                if (nb_workers > 1 && delay > 10)
+                    delay = 10;
+                events = POLLIN;
+                break;
             case HTTPSTATE_WAIT_REQUEST:
             case HTTPSTATE_RECEIVE_DATA:
-            case HTTPSTATE_WAIT_FEED:
             case RTSPSTATE_WAIT_REQUEST:
                 /* need to catch errors */
-                c->poll_entry = poll_entry;
-                poll_entry->fd = fd;
-                poll_entry->events = POLLIN;/* Maybe this will work */
-                poll_entry++;
+                events = POLLIN;/* Maybe this will work */
                 break;
             default:
-                c->poll_entry = NULL;
                 break;
             }
+#if HAVE_SYS_EPOLL_H
+            /* registrations persist, only state changes cost a syscall */
+            if (epoll_update(&c->epoll_entry, c->fd,
+                             c->fd >= 0 ? events : 0, c) < 0)
+                return -1;
+            c->poll_entry = events ? &c->epoll_entry : NULL;
+#else
+            if (events) {
+                c->poll_entry = poll_entry;
+                poll_entry->fd = c->fd;
+                poll_entry->events = events;
+                poll_entry++;
+            } else {
+                c->poll_entry = NULL;
+            }
+#endif
             c = c->next;
         }
 
         /* wait for an event on one connection. We poll at least every
            second to handle timeouts */
         do {
+#if HAVE_SYS_EPOLL_H
+            ret = epoll_wait(epoll_fd, epoll_events, nb_max_http_connections + 2, delay);
+#else
             ret = poll(poll_table, poll_entry - poll_table, delay);
+#endif
             if (ret < 0 && ff_neterrno() != AVERROR(EAGAIN) &&
                 ff_neterrno() != AVERROR(EINTR))
                 return -1;
         } while (ret < 0);
 
+#if HAVE_SYS_EPOLL_H
+        /* only the descriptors with events are visited here */
+        server_entry.revents = rtsp_server_entry.revents = 0;
+        for (i = 0; i < ret; i++) {
+            struct pollfd *entry = epoll_events[i].data.ptr;
+            int ev = epoll_events[i].events;
+            if (entry != &server_entry && entry != &rtsp_server_entry)
+                entry = &((HTTPContext *)entry)->epoll_entry;
+            entry->revents = (ev & EPOLLIN  ? POLLIN  : 0) |
+                             (ev & EPOLLOUT ? POLLOUT : 0) |
+                             (ev & EPOLLERR ? POLLERR : 0) |
+                             (ev & EPOLLHUP ? POLLHUP : 0);
+        }
+#endif
+
         cur_time = av_gettime() / 1000;
 
+        if (nb_workers > 1) {
+            /* stop serving once the master is gone */
+            if (master_pid && getppid() != master_pid)
+                exit(0);
+            refresh_feeds();
+        }
+
         if (need_to_start_children) {
             need_to_start_children = 0;
             start_children(first_feed);
@@ -754,6 +955,13 @@ static int http_server(void)
             }
         }
 
+#if HAVE_SYS_EPOLL_H
+        /* new HTTP or RTSP connection request ? */
+        if (server_entry.revents & POLLIN)
+            new_connection(server_fd, 0);
+        if (rtsp_server_entry.revents & POLLIN)
+            new_connection(rtsp_server_fd, 1);
+#else
         poll_entry = poll_table;
         if (server_fd) {
             /* new HTTP connection request ? */
@@ -766,6 +974,7 @@ static int http_server(void)
             if (poll_entry->revents & POLLIN)
                 new_connection(rtsp_server_fd, 1);
         }
+#endif
     }
 }
 
@@ -812,7 +1021,9 @@ static void new_connection(int server_fd, int is_rtsp)
     fd = accept(server_fd, (struct sockaddr *)&from_addr,
                 &len);
     if (fd < 0) {
-        http_log("error during accept %s\n", strerror(errno));
+        /* all workers are woken up, only one gets the connection */
+        if (ff_neterrno() != AVERROR(EAGAIN))
+            http_log("error during accept %s\n", strerror(errno));
         return;
     }
     ff_socket_nonblock(fd, 1);
@@ -876,6 +1087,11 @@ static void close_connection(HTTPContext *c)
     }
 
     /* remove connection associated resources */
+#if HAVE_SYS_EPOLL_H
+    /* the descriptor may survive close() in the feeder children */
+    if (c->epoll_entry.events)
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, c->fd, NULL);
+#endif
     if (c->fd >= 0)
         closesocket(c->fd);
     if (c->fmt_in) {
@@ -927,6 +1143,9 @@ static void close_connection(HTTPContext *c)
     if (c->stream && !c->post && c->stream->stream_type == STREAM_TYPE_LIVE)
         current_bandwidth -= c->stream->bandwidth;
 
+    if (c->shared_joined)
+        shared_leave(c);
+
     /* signal that there is no feed if we are the feeder socket */
     if (c->state == HTTPSTATE_RECEIVE_DATA && c->stream) {
         c->stream->feed_opened = 0;
@@ -1858,6 +2077,14 @@ static int http_parse_request(HTTPContext *c)
         goto send_error;
     }
 
+    /* live viewers not asking for a particular position share one muxer */
+    if (c->stream->shared_mux && c->stream->feed &&
+        !av_find_info_tag(ratebuf, sizeof(ratebuf), "date", info) &&
+        !av_find_info_tag(ratebuf, sizeof(ratebuf), "buffer", info)) {
+        c->shared = 1;
+        avformat_close_input(&c->fmt_in);
+    }
+
     /* prepare http header */
     c->buffer[0] = 0;
     av_strlcatf(c->buffer, c->buffer_size, "HTTP/1.0 200 OK\r\n");
@@ -2161,6 +2388,25 @@ static void compute_status(HTTPContext *c)
     c->buffer_end = c->pb_buffer + len;
 }
 
+/* take the codec parameters of a feed from the header of its ffm input */
+static void update_feed_codecs(FFStream *feed, AVFormatContext *s)
+{
+    int i;
+
+    if (s->nb_streams != feed->nb_streams)
+        return;
+    for (i = 0; i < s->nb_streams; i++) {
+        AVCodecContext *fc = feed->streams[i]->codec;
+        AVCodecContext *sc = s->streams[i]->codec;
+
+        /* do not touch the codec contexts in use when nothing changed */
+        if (fc->extradata_size != sc->extradata_size ||
+            (sc->extradata_size &&
+             memcmp(fc->extradata, sc->extradata, sc->extradata_size)))
+            avcodec_copy_context(fc, sc);
+    }
+}
+
 static int open_input_stream(HTTPContext *c, const char *info)
 {
     char buf[128];
@@ -2201,6 +2447,10 @@ static int open_input_stream(HTTPContext *c, const char *info)
         return -1;
     }
 
+    /* the worker receiving the feed stores the feeder header in the file */
+    if (c->stream->feed && nb_workers > 1 && !c->stream->feed->feed_opened)
+        update_feed_codecs(c->stream->feed, s);
+
     /* set buffer size */
     if (buf_size > 0) ffio_set_buf_size(s->pb, buf_size);
 
@@ -2230,6 +2480,188 @@ static int open_input_stream(HTTPContext *c, const char *info)
     return 0;
 }
 
+static void shared_unref_chunk(FFStream *stream, SharedChunk **pchunk)
+{
+    SharedChunk *chunk = *pchunk;
+
+    *pchunk = NULL;
+    if (chunk)
+        chunk->refs--;
+    /* free the chunks no viewer needs anymore */
+    while ((chunk = stream->first_chunk) && !chunk->refs) {
+        stream->first_chunk = chunk->next;
+        if (!stream->first_chunk)
+            stream->last_chunk = NULL;
+        stream->nb_chunks--;
+        av_free(chunk->data);
+        av_free(chunk);
+    }
+}
+
+static void shared_mux_close(FFStream *stream)
+{
+    HTTPContext *c = stream->mux_c;
+    SharedChunk *chunk;
+    int i;
+
+    while ((chunk = stream->first_chunk)) {
+        stream->first_chunk = chunk->next;
+        av_free(chunk->data);
+        av_free(chunk);
+    }
+    stream->last_chunk = NULL;
+    stream->nb_chunks  = 0;
+    stream->mux_c = NULL;
+    if (!c)
+        return;
+    if (c->fmt_in) {
+        for(i=0;i<c->fmt_in->nb_streams;i++) {
+            AVStream *st = c->fmt_in->streams[i];
+            if (st->codec->codec)
+                avcodec_close(st->codec);
+        }
+        avformat_close_input(&c->fmt_in);
+    }
+    for(i=0; i<c->fmt_ctx.nb_streams; i++)
+        av_free(c->fmt_ctx.streams[i]);
+    av_freep(&c->fmt_ctx.streams);
+    av_freep(&c->fmt_ctx.priv_data);
+    av_freep(&c->pb_buffer);
+    av_free(c);
+}
+
+/* create the context muxing the packets of stream once for all its viewers;
+   it is not a connection and is driven by the viewers needing data */
+static int shared_mux_open(FFStream *stream)
+{
+    HTTPContext *c;
+
+    if (!(c = av_mallocz(sizeof(HTTPContext))))
+        return -1;
+    c->fd = -1;
+    c->stream = stream;
+    stream->mux_c = c;
+    if (open_input_stream(c, "") < 0)
+        goto fail;
+    c->state = HTTPSTATE_SEND_DATA_HEADER;
+    /* each viewer gets its own copy of the header */
+    if (http_prepare_data(c) < 0)
+        goto fail;
+    av_freep(&c->pb_buffer);
+    return 0;
+fail:
+    shared_mux_close(stream);
+    return -1;
+}
+
+/* mux one more packet into a new chunk; return 1 if the feed needs to be
+   waited for */
+static int shared_mux_read(FFStream *stream)
+{
+    HTTPContext *c = stream->mux_c, *c1;
+    SharedChunk *chunk;
+
+    c->state = HTTPSTATE_SEND_DATA;
+    c->buffer_ptr = c->buffer_end = NULL;
+    /* MaxTime is enforced for each viewer */
+    c->start_time = cur_time;
+    if (http_prepare_data(c) < 0 || c->state == HTTPSTATE_SEND_DATA_TRAILER)
+        return -1;
+    if (c->state == HTTPSTATE_WAIT_FEED)
+        return 1;
+    if (c->buffer_ptr >= c->buffer_end)
+        return 0;
+
+    if (!(chunk = av_mallocz(sizeof(*chunk))))
+        return -1;
+    chunk->data = c->pb_buffer;
+    chunk->size = c->buffer_end - c->buffer_ptr;
+    chunk->key  = c->pkt_key;
+    c->pb_buffer = NULL;
+    if (stream->last_chunk)
+        stream->last_chunk->next = chunk;
+    else
+        stream->first_chunk = chunk;
+    stream->last_chunk = chunk;
+
+    if (++stream->nb_chunks > MAX_SHARED_CHUNKS) {
+        /* drop the viewers holding the oldest chunk */
+        for(c1 = first_http_ctx; c1 != NULL; c1 = c1->next) {
+            if (c1->shared && c1->stream == stream &&
+                c1->chunk == stream->first_chunk) {
+                http_log("Dropping lagging viewer of '%s'\n", stream->filename);
+                shared_unref_chunk(stream, &c1->chunk);
+                c1->buffer_ptr = c1->buffer_end = NULL;
+                c1->state = HTTPSTATE_SEND_DATA_TRAILER;
+            }
+        }
+    }
+    return 0;
+}
+
+static int shared_join(HTTPContext *c)
+{
+    FFStream *stream = c->stream;
+
+    if (!stream->mux_c && shared_mux_open(stream) < 0)
+        return -1;
+    stream->nb_shared_viewers++;
+    c->shared_joined = 1;
+    /* start after the chunks already muxed, on the next keyframe */
+    if ((c->chunk = stream->last_chunk))
+        c->chunk->refs++;
+    c->shared_started = 0;
+    c->start_time = cur_time;
+    return 0;
+}
+
+static void shared_leave(HTTPContext *c)
+{
+    FFStream *stream = c->stream;
+
+    shared_unref_chunk(stream, &c->chunk);
+    if (!--stream->nb_shared_viewers)
+        shared_mux_close(stream);
+}
+
+/* point the output buffer of a viewer to the next chunk to send */
+static int shared_prepare_data(HTTPContext *c)
+{
+    FFStream *stream = c->stream;
+    SharedChunk *next;
+    int ret;
+
+    if (stream->max_time &&
+        stream->max_time + c->start_time - cur_time < 0) {
+        /* We have timed out */
+        c->state = HTTPSTATE_SEND_DATA_TRAILER;
+        return 0;
+    }
+    for (;;) {
+        next = c->chunk ? c->chunk->next : stream->first_chunk;
+        if (!next) {
+            ret = shared_mux_read(stream);
+            if (ret < 0) {
+                c->state = HTTPSTATE_SEND_DATA_TRAILER;
+                return 0;
+            } else if (ret > 0) {
+                c->state = HTTPSTATE_WAIT_FEED;
+                return 1; /* state changed */
+            }
+            continue;
+        }
+        next->refs++;
+        shared_unref_chunk(stream, &c->chunk);
+        c->chunk = next;
+        if (!c->shared_started && !next->key)
+            continue;
+        c->shared_started = 1;
+        c->buffer_ptr = next->data;
+        c->buffer_end = next->data + next->size;
+        return 0;
+    }
+}
+
 /* return the server clock (in us) */
 static int64_t get_server_clock(HTTPContext *c)
 {
@@ -2317,8 +2749,12 @@ static int http_prepare_data(HTTPContext *c)
 
         c->state = HTTPSTATE_SEND_DATA;
         c->last_packet_sent = 0;
+        if (c->shared && shared_join(c) < 0)
+            return -1;
         break;
     case HTTPSTATE_SEND_DATA:
+        if (c->shared)
+            return shared_prepare_data(c);
         /* find a new packet */
         /* read a packet from the input stream */
         if (c->stream->feed)
@@ -2392,6 +2828,9 @@ static int http_prepare_data(HTTPContext *c)
                     AVStream *ist, *ost;
                 send_it:
                     ist = c->fmt_in->streams[source_index];
+                    c->pkt_key = pkt.flags & AV_PKT_FLAG_KEY &&
+                                 (ist->codec->codec_type == AVMEDIA_TYPE_VIDEO ||
+                                  c->stream->nb_streams == 1);
                     /* specific handling for RTP: we use several
                        output stream (one for each RTP
                        connection). XXX: need more abstract handling */
@@ -2463,6 +2902,9 @@ static int http_prepare_data(HTTPContext *c)
         /* last packet test ? */
         if (c->last_packet_sent || c->is_packetized)
             return -1;
+        /* the shared muxer is not ours to finish */
+        if (c->shared)
+            return -1;
         ctx = &c->fmt_ctx;
         /* prepare header */
         if (avio_open_dyn_buf(&ctx->pb) < 0) {
@@ -2620,6 +3062,14 @@ static int http_start_receive_data(HTTPContext *c)
         http_log("Error opening feeder file: %s\n", strerror(errno));
         return -1;
     }
+#if HAVE_FLOCK
+    /* feed_opened is only known to this worker */
+    if (flock(fd, LOCK_EX | LOCK_NB) < 0) {
+        http_log("Feed '%s' is already being written\n", c->stream->feed_filename);
+        close(fd);
+        return -1;
+    }
+#endif
     c->feed_fd = fd;
 
     if (c->stream->truncate) {
@@ -2785,6 +3235,17 @@ static int http_receive_data(HTTPContext *c)
 
             avformat_close_input(&s);
             av_free(pb);
+
+            if (nb_workers > 1) {
+                /* let the other workers find it in place of the config
+                   derived header */
+                lseek(c->feed_fd, 0, SEEK_SET);
+                if (write(c->feed_fd, c->buffer, FFM_PACKET_SIZE) < 0 ||
+                    ffm_write_write_index(c->feed_fd, feed->feed_write_index) < 0) {
+                    http_log("Error writing header to feed file: %s\n", strerror(errno));
+                    goto fail;
+                }
+            }
         }
         c->buffer_ptr = c->buffer;
     }
@@ -4149,6 +4610,14 @@ static int parse_ffconfig(const char *filename)
             } else {
                 nb_max_connections = val;
             }
+        } else if (!av_strcasecmp(cmd, "Workers")) {
+            get_arg(arg, sizeof(arg), &p);
+            val = atoi(arg);
+            if (val < 1 || val > 64) {
+                ERROR("Invalid Workers: %s\n", arg);
+            } else {
+                nb_workers = val;
+            }
         } else if (!av_strcasecmp(cmd, "MaxBandwidth")) {
             int64_t llval;
             get_arg(arg, sizeof(arg), &p);
@@ -4363,6 +4832,9 @@ static int parse_ffconfig(const char *filename)
         } else if (!av_strcasecmp(cmd, "StartSendOnKey")) {
             if (stream)
                 stream->send_on_key = 1;
+        } else if (!av_strcasecmp(cmd, "SharedMuxer")) {
+            if (stream)
+                stream->shared_mux = 1;
         } else if (!av_strcasecmp(cmd, "AudioCodec")) {
             get_arg(arg, sizeof(arg), &p);
             audio_id = opt_audio_codec(arg);
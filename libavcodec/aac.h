@@ -312,6 +312,9 @@ struct AACContext {
     int dmono_mode;      ///< 0->not dmono, 1->use first channel, 2->use second channel
     /** @} */
 
+    int skip_sbr;        ///< decode only the core AAC, at the core sample rate
+    int skip_ps;         ///< do not upmix parametric stereo, output mono
+
     DECLARE_ALIGNED(32, float, temp)[128];
 
     OutputConfiguration oc[2];
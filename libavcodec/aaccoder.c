@@ -69,31 +69,6 @@ static av_always_inline int quant(float coef, const float Q)
     return sqrtf(a * sqrtf(a)) + 0.4054;
 }
 
-static void quantize_bands(int *out, const float *in, const float *scaled,
-                           int size, float Q34, int is_signed, int maxval)
-{
-    int i;
-    double qc;
-    for (i = 0; i < size; i++) {
-        qc = scaled[i] * Q34;
-        out[i] = (int)FFMIN(qc + 0.4054, (double)maxval);
-        if (is_signed && in[i] < 0.0f) {
-            out[i] = -out[i];
-        }
-    }
-}
-
-static void abs_pow34_v(float *out, const float *in, const int size)
-{
-#ifndef USE_REALLY_FULL_SEARCH
-    int i;
-    for (i = 0; i < size; i++) {
-        float a = fabsf(in[i]);
-        out[i] = sqrtf(a * sqrtf(a));
-    }
-#endif /* USE_REALLY_FULL_SEARCH */
-}
-
 static const uint8_t aac_cb_range [12] = {0, 3, 3, 3, 3, 9, 9, 8, 8, 13, 13, 17};
 static const uint8_t aac_cb_maxval[12] = {0, 1, 1, 2, 2, 4, 4, 7, 7, 12, 12, 16};
 
@@ -131,10 +106,10 @@ static av_always_inline float quantize_and_encode_band_cost_template(
         return cost * lambda;
     }
     if (!scaled) {
-        abs_pow34_v(s->scoefs, in, size);
+        s->aacdsp.abs_pow34(s->scoefs, in, size);
         scaled = s->scoefs;
     }
-    quantize_bands(s->qcoefs, in, scaled, size, Q34, !BT_UNSIGNED, maxval);
+    s->aacdsp.quant_bands(s->qcoefs, in, scaled, size, !BT_UNSIGNED, maxval, Q34);
     if (BT_UNSIGNED) {
         off = 0;
     } else {
@@ -271,6 +246,42 @@ static void quantize_and_encode_band(struct AACEncContext *s, PutBitContext *pb,
                                   INFINITY, NULL);
 }
 
+/**
+ * Calculate the number of bits needed to code a band with codebooks cb and
+ * cb+1 (cb being 1, 3, 5, 7 or 9). Both books of such a pair have the same
+ * range and signedness, so the band only has to be quantized once.
+ *
+ * @param bits receives the bits for cb in bits[0] and for cb+1 in bits[1]
+ */
+static void quantize_band_bits_pair(struct AACEncContext *s, const float *in,
+                                    const float *scaled, int size,
+                                    int scale_idx, int cb, int *bits)
+{
+    const int q_idx = POW_SF2_ZERO - scale_idx + SCALE_ONE_POS - SCALE_DIV_512;
+    const float Q34 = ff_aac_pow34sf_tab[q_idx];
+    const int is_signed = cb == 1 || cb == 5;
+    const int dim       = cb < 5 ? 4 : 2;
+    const int range     = aac_cb_range[cb];
+    const int maxval    = aac_cb_maxval[cb];
+    const int off       = is_signed ? maxval : 0;
+    int i, j;
+
+    s->aacdsp.quant_bands(s->qcoefs, in, scaled, size, is_signed, maxval, Q34);
+    bits[0] = bits[1] = 0;
+    for (i = 0; i < size; i += dim) {
+        const int *quants = s->qcoefs + i;
+        int curidx = 0, signbits = 0;
+        for (j = 0; j < dim; j++) {
+            curidx *= range;
+            curidx += quants[j] + off;
+            if (!is_signed)
+                signbits += quants[j] != 0;
+        }
+        bits[0] += ff_aac_spectral_bits[cb-1][curidx] + signbits;
+        bits[1] += ff_aac_spectral_bits[cb  ][curidx] + signbits;
+    }
+}
+
 static float find_max_val(int group_len, int swb_size, const float *scaled) {
     float maxval = 0.0f;
     int w2, i;
@@ -323,7 +334,7 @@ static void encode_window_bands_info(AACEncContext *s, SingleChannelElement *sce
     float next_minrd = INFINITY;
     int next_mincb = 0;
 
-    abs_pow34_v(s->scoefs, sce->coeffs, 1024);
+    s->aacdsp.abs_pow34(s->scoefs, sce->coeffs, 1024);
     start = win*128;
     for (cb = 0; cb < 12; cb++) {
         path[0][cb].cost     = 0.0f;
@@ -423,8 +434,9 @@ static void codebook_trellis_rate(AACEncContext *s, SingleChannelElement *sce,
     int stackrun[120], stackcb[120], stack_len;
     float next_minbits = INFINITY;
     int next_mincb = 0;
+    float cb_bits[12];
 
-    abs_pow34_v(s->scoefs, sce->coeffs, 1024);
+    s->aacdsp.abs_pow34(s->scoefs, sce->coeffs, 1024);
     start = win*128;
     for (cb = 0; cb < 12; cb++) {
         path[0][cb].cost     = run_bits+4;
@@ -466,15 +478,33 @@ static void codebook_trellis_rate(AACEncContext *s, SingleChannelElement *sce,
                 path[swb+1][cb].prev_idx = -1;
                 path[swb+1][cb].run = 0;
             }
+            // with lambda = 0 the cost is just the number of bits, so the paired
+            // codebooks can share one quantization of the band
             for (cb = startcb; cb < 12; cb++) {
-                float cost_stay_here, cost_get_here;
-                float bits = 0.0f;
-                for (w = 0; w < group_len; w++) {
-                    bits += quantize_band_cost(s, sce->coeffs + start + w*128,
-                                               s->scoefs + start + w*128, size,
-                                               sce->sf_idx[(win+w)*16+swb], cb,
-                                               0, INFINITY, NULL);
+                cb_bits[cb] = 0.0f;
+                if ((cb & 1) && cb < 11) {
+                    cb_bits[cb + 1] = 0.0f;
+                    for (w = 0; w < group_len; w++) {
+                        int b[2];
+                        quantize_band_bits_pair(s, sce->coeffs + start + w*128,
+                                                s->scoefs + start + w*128, size,
+                                                sce->sf_idx[(win+w)*16+swb], cb, b);
+                        cb_bits[cb    ] += b[0];
+                        cb_bits[cb + 1] += b[1];
+                    }
+                    cb++;
+                } else {
+                    for (w = 0; w < group_len; w++) {
+                        cb_bits[cb] += quantize_band_cost(s, sce->coeffs + start + w*128,
+                                                          s->scoefs + start + w*128, size,
+                                                          sce->sf_idx[(win+w)*16+swb], cb,
+                                                          0, INFINITY, NULL);
+                    }
                 }
+            }
+            for (cb = startcb; cb < 12; cb++) {
+                float cost_stay_here, cost_get_here;
+                float bits = cb_bits[cb];
                 cost_stay_here = path[swb][cb].cost + bits;
                 cost_get_here  = minbits            + bits + run_bits + 4;
                 if (   run_value_bits[sce->ics.num_windows == 8][path[swb][cb].run]
@@ -612,7 +642,7 @@ static void search_for_quantizers_anmr(AVCodecContext *avctx, AACEncContext *s,
         }
     }
     idx = 1;
-    abs_pow34_v(s->scoefs, sce->coeffs, 1024);
+    s->aacdsp.abs_pow34(s->scoefs, sce->coeffs, 1024);
     for (w = 0; w < sce->ics.num_windows; w += sce->ics.group_len[w]) {
         start = w*128;
         for (g = 0; g < sce->ics.num_swb; g++) {
@@ -755,7 +785,13 @@ static void search_for_quantizers_twoloop(AVCodecContext *avctx,
 
     if (!allz)
         return;
-    abs_pow34_v(s->scoefs, sce->coeffs, 1024);
+    s->aacdsp.abs_pow34(s->scoefs, sce->coeffs, 1024);
+
+    // invalidate the band costs of the previous channel
+    if (!++s->quantize_band_cost_cache_generation) {
+        memset(s->quantize_band_cost_cache, 0, sizeof(s->quantize_band_cost_cache));
+        s->quantize_band_cost_cache_generation = 1;
+    }
 
     for (w = 0; w < sce->ics.num_windows; w += sce->ics.group_len[w]) {
         start = w*128;
@@ -782,6 +818,7 @@ static void search_for_quantizers_twoloop(AVCodecContext *avctx,
                 for (g = 0;  g < sce->ics.num_swb; g++) {
                     const float *coefs = sce->coeffs + start;
                     const float *scaled = s->scoefs + start;
+                    AACQuantizeBandCostCacheEntry *entry;
                     int bits = 0;
                     int cb;
                     float dist = 0.0f;
@@ -791,18 +828,29 @@ static void search_for_quantizers_twoloop(AVCodecContext *avctx,
                         continue;
                     }
                     minscaler = FFMIN(minscaler, sce->sf_idx[w*16+g]);
-                    cb = find_min_book(maxvals[w*16+g], sce->sf_idx[w*16+g]);
-                    for (w2 = 0; w2 < sce->ics.group_len[w]; w2++) {
-                        int b;
-                        dist += quantize_band_cost(s, coefs + w2*128,
-                                                   scaled + w2*128,
-                                                   sce->ics.swb_sizes[g],
-                                                   sce->sf_idx[w*16+g],
-                                                   cb,
-                                                   1.0f,
-                                                   INFINITY,
-                                                   &b);
-                        bits += b;
+                    // the codebook only depends on the band and its scalefactor,
+                    // so the cost can be reused when a scalefactor is revisited
+                    entry = &s->quantize_band_cost_cache[sce->sf_idx[w*16+g]][w*16+g];
+                    if (entry->generation == s->quantize_band_cost_cache_generation) {
+                        dist = entry->dist;
+                        bits = entry->bits;
+                    } else {
+                        cb = find_min_book(maxvals[w*16+g], sce->sf_idx[w*16+g]);
+                        for (w2 = 0; w2 < sce->ics.group_len[w]; w2++) {
+                            int b;
+                            dist += quantize_band_cost(s, coefs + w2*128,
+                                                       scaled + w2*128,
+                                                       sce->ics.swb_sizes[g],
+                                                       sce->sf_idx[w*16+g],
+                                                       cb,
+                                                       1.0f,
+                                                       INFINITY,
+                                                       &b);
+                            bits += b;
+                        }
+                        entry->dist       = dist;
+                        entry->bits       = bits;
+                        entry->generation = s->quantize_band_cost_cache_generation;
                     }
                     dists[w*16+g] = dist - bits;
                     if (prev != -1) {
@@ -936,7 +984,7 @@ static void search_for_quantizers_faac(AVCodecContext *avctx, AACEncContext *s,
         }
     }
     memset(sce->sf_idx, 0, sizeof(sce->sf_idx));
-    abs_pow34_v(s->scoefs, sce->coeffs, 1024);
+    s->aacdsp.abs_pow34(s->scoefs, sce->coeffs, 1024);
     for (w = 0; w < sce->ics.num_windows; w += sce->ics.group_len[w]) {
         start = w*128;
         for (g = 0;  g < sce->ics.num_swb; g++) {
@@ -1076,10 +1124,10 @@ static void search_for_ms(AACEncContext *s, ChannelElement *cpe,
                         S[i] =  M[i]
                               - sce1->coeffs[start+w2*128+i];
                     }
-                    abs_pow34_v(L34, sce0->coeffs+start+w2*128, sce0->ics.swb_sizes[g]);
-                    abs_pow34_v(R34, sce1->coeffs+start+w2*128, sce0->ics.swb_sizes[g]);
-                    abs_pow34_v(M34, M,                         sce0->ics.swb_sizes[g]);
-                    abs_pow34_v(S34, S,                         sce0->ics.swb_sizes[g]);
+                    s->aacdsp.abs_pow34(L34, sce0->coeffs+start+w2*128, sce0->ics.swb_sizes[g]);
+                    s->aacdsp.abs_pow34(R34, sce1->coeffs+start+w2*128, sce0->ics.swb_sizes[g]);
+                    s->aacdsp.abs_pow34(M34, M,                         sce0->ics.swb_sizes[g]);
+                    s->aacdsp.abs_pow34(S34, S,                         sce0->ics.swb_sizes[g]);
                     dist1 += quantize_band_cost(s, sce0->coeffs + start + w2*128,
                                                 L34,
                                                 sce0->ics.swb_sizes[g],
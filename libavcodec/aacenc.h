@@ -27,6 +27,7 @@
 #include "put_bits.h"
 
 #include "aac.h"
+#include "aacencdsp.h"
 #include "audio_frame_queue.h"
 #include "psymodel.h"
 
@@ -51,6 +52,15 @@ typedef struct AACCoefficientsEncoder {
 
 extern AACCoefficientsEncoder ff_aac_coders[];
 
+/**
+ * Memoized cost of coding a window group band with a given scalefactor.
+ */
+typedef struct AACQuantizeBandCostCacheEntry {
+    float dist;                                  ///< rate distortion cost, summed over the windows of the group
+    int bits;                                    ///< number of bits, summed over the windows of the group
+    unsigned generation;                         ///< entry is valid if equal to AACEncContext.quantize_band_cost_cache_generation
+} AACQuantizeBandCostCacheEntry;
+
 /**
  * AAC encoder context
  */
@@ -61,6 +71,7 @@ typedef struct AACEncContext {
     FFTContext mdct1024;                         ///< long (1024 samples) frame transform context
     FFTContext mdct128;                          ///< short (128 samples) frame transform context
     AVFloatDSPContext fdsp;
+    AACEncDSPContext aacdsp;
     float *planar_samples[6];                    ///< saved preprocessed input
 
     int samplerate_index;                        ///< MPEG-4 samplerate index
@@ -75,12 +86,24 @@ typedef struct AACEncContext {
     int last_frame;
     float lambda;
     AudioFrameQueue afq;
-    DECLARE_ALIGNED(16, int,   qcoefs)[96];      ///< quantized coefficients
-    DECLARE_ALIGNED(32, float, scoefs)[1024];    ///< scaled coefficients
 
     struct {
         float *samples;
     } buffer;
+
+    /**
+     * Contexts the channel elements are searched with when slice threading,
+     * one per element. They are copies of this context up to qcoefs, which
+     * get refreshed before each search; the remaining fields are scratch
+     * space private to each of them. Point to this context if unthreaded.
+     */
+    struct AACEncContext **elem_ctx;
+
+    DECLARE_ALIGNED(16, int,   qcoefs)[96];      ///< quantized coefficients
+    DECLARE_ALIGNED(32, float, scoefs)[1024];    ///< scaled coefficients
+
+    unsigned quantize_band_cost_cache_generation;
+    AACQuantizeBandCostCacheEntry quantize_band_cost_cache[256][128]; ///< band costs indexed by [scalefactor][w*16+g]
 } AACEncContext;
 
 extern float ff_aac_pow34sf_tab[428];
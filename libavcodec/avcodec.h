@@ -1020,6 +1020,28 @@ enum AVPacketSideDataType {
      * follow the timestamp specifier of a WebVTT cue.
      */
     AV_PKT_DATA_WEBVTT_SETTINGS,
+
+    /**
+     * The packet data lives in a buffer that was also exported as a DMABUF,
+     * so that it can be imported by other devices without a copy.
+     * @code
+     * u32le file descriptor of the DMABUF
+     * @endcode
+     * The descriptor is owned by the demuxer and stays open until it is
+     * closed; the buffer content is only valid as long as the packet data is
+     * referenced. Only exported by demuxers returning packets which point
+     * straight into the device buffers, and lost when the side data is
+     * merged into the packet, see AVFMT_FLAG_KEEP_SIDE_DATA.
+     */
+    AV_PKT_DATA_DMABUF,
+
+    /**
+     * The data is the AVLatencyTrace struct defined in libavutil/frame.h,
+     * see AVFMT_FLAG_LATENCY_TRACE. Decoders carry it over to the
+     * AV_FRAME_DATA_LATENCY_TRACE side data of the frames they output, and
+     * encoders back from the frames to the packets.
+     */
+    AV_PKT_DATA_LATENCY_TRACE,
 };
 
 /**
@@ -2349,6 +2371,13 @@ typedef struct AVCodecContext {
     /* with a Start Code (it should). H.263 does.   */
     /* mb_nb contains the number of macroblocks     */
     /* encoded in the RTP payload.                  */
+    /* The packets are passed in bitstream order,   */
+    /* also with slice threads, and before the      */
+    /* whole frame is encoded, so that the first    */
+    /* slices can be sent early. For the low        */
+    /* latency, use small rtp_payload_size or more  */
+    /* slices. The frame is not reencoded to fit    */
+    /* the VBV buffer when this is set.             */
     void (*rtp_callback)(struct AVCodecContext *avctx, void *data, int size, int mb_nb);
 
     int rtp_payload_size;   /* The size of the RTP payload: the coder will  */
@@ -2874,6 +2903,61 @@ typedef struct AVCodecContext {
 #define FF_SUB_CHARENC_MODE_AUTOMATIC    0  ///< libavcodec will select the mode itself
 #define FF_SUB_CHARENC_MODE_PRE_DECODER  1  ///< the AVPacket data needs to be recoded to UTF-8 before being fed to the decoder, requires iconv
 
+    /**
+     * Run the slice threading jobs of this context on a worker pool shared
+     * by all the contexts of the process which set this field, instead of
+     * starting thread_count threads for this context only.
+     * The pool has one worker per CPU; thread_count still limits how many
+     * jobs of this context run at the same time.
+     * Frame threading is not affected.
+     * - encoding: Set by user.
+     * - decoding: Set by user.
+     */
+    int thread_pool;
+
+    /**
+     * Maximum number of frames of output delay added by frame threading.
+     * If it is lower than thread_count - 1, fewer frame threads are started
+     * and, with codecs which support it, the remaining threads decode the
+     * slices of each frame in parallel.
+     * 0 means thread_count - 1.
+     * - encoding: unused
+     * - decoding: Set by user.
+     */
+    int frame_thread_delay;
+
+    /**
+     * Allocate the video frames of avcodec_default_get_buffer2() from buffer
+     * pools shared by all the contexts of the process which set this field,
+     * so that contexts decoding pictures of the same size reuse each other's
+     * idle buffers instead of each keeping its own.
+     * - encoding: unused
+     * - decoding: Set by user.
+     */
+    int shared_frame_pool;
+
+    /**
+     * If non NULL, called by the decoder each time more lines at the top of
+     * the picture it is decoding are complete and will not be modified
+     * anymore, so that they can be displayed or processed before the whole
+     * picture is decoded.
+     * Unlike draw_horiz_band(), it is called in decoding order on the
+     * picture being decoded, and works with both frame and slice threading.
+     * When multithreading is used, it is called from the decoding threads,
+     * possibly at the same time for different pictures; for a given picture
+     * and field the number of lines never decreases, but the same number
+     * may be reported several times.
+     * Currently only supported by the H.264 decoder.
+     * - encoding: unused
+     * - decoding: Set by user.
+     * @param frame the picture being decoded, its buffers are the ones of the
+     *              frame output later by the decoder
+     * @param lines number of complete lines, counted in field lines for field
+     *              pictures
+     * @param field 0 for frames and top fields, 1 for bottom fields
+     */
+    void (*decode_progress)(struct AVCodecContext *avctx, const AVFrame *frame,
+                            int lines, int field);
 } AVCodecContext;
 
 AVRational av_codec_get_pkt_timebase         (const AVCodecContext *avctx);
@@ -2990,6 +3074,25 @@ typedef struct AVCodec {
      * Will be called when seeking
      */
     void (*flush)(AVCodecContext *);
+    /**
+     * Decoupled input/output callbacks, see avcodec_send_packet(),
+     * avcodec_receive_frame(), avcodec_send_frame() and
+     * avcodec_receive_packet(), which call them after the generic checks.
+     * A decoder implements either decode or send_packet and receive_frame,
+     * an encoder either encode2 or send_frame and receive_packet; the
+     * other API is emulated on top of the implemented one.
+     * send_packet and send_frame are called once with NULL when draining
+     * starts.
+     */
+    int (*send_packet)(AVCodecContext *avctx, const AVPacket *avpkt);
+    int (*receive_frame)(AVCodecContext *avctx, AVFrame *frame);
+    int (*send_frame)(AVCodecContext *avctx, const AVFrame *frame);
+    int (*receive_packet)(AVCodecContext *avctx, AVPacket *avpkt);
+    /**
+     * Internal codec capabilities.
+     * See FF_CODEC_CAP_* in internal.h
+     */
+    int caps_internal;
 } AVCodec;
 
 /**
@@ -3795,6 +3898,59 @@ int avcodec_decode_subtitle2(AVCodecContext *avctx, AVSubtitle *sub,
                             int *got_sub_ptr,
                             AVPacket *avpkt);
 
+/**
+ * Supply raw packet data as input to a decoder.
+ *
+ * Unlike avcodec_decode_video2() and avcodec_decode_audio4(), the input
+ * and the output are decoupled: after a packet was sent, call
+ * avcodec_receive_frame() until it returns AVERROR(EAGAIN) to get all the
+ * frames it produced, then send the next packet. This works the same for
+ * decoders with frame threading, which return no frame for the first
+ * packets, and for decoders which return several frames per packet.
+ *
+ * The packet is not modified, and is copied only if it is not reference
+ * counted and not entirely consumed at once.
+ *
+ * @param avctx codec context, opened with a video or audio decoder
+ * @param[in] avpkt the input packet, usually a single video frame or
+ *                  several complete audio frames. NULL, or a packet with
+ *                  no data and size 0, starts draining: the delayed frames
+ *                  are then returned by avcodec_receive_frame(), which
+ *                  returns AVERROR_EOF after the last one. Sending another
+ *                  packet then requires avcodec_flush_buffers().
+ *
+ * @return 0 on success, otherwise negative error code:
+ *      AVERROR(EAGAIN):   input is not accepted in the current state, the
+ *                         frames must first be read with
+ *                         avcodec_receive_frame()
+ *      AVERROR_EOF:       the decoder has been flushed, and no new packets
+ *                         can be sent to it
+ *      AVERROR(EINVAL):   codec not opened, it is an encoder, or the packet
+ *                         has data but a size of 0
+ *      other errors:      legitimate decoding errors
+ */
+int avcodec_send_packet(AVCodecContext *avctx, const AVPacket *avpkt);
+
+/**
+ * Return decoded output data from a decoder.
+ *
+ * @param avctx codec context
+ * @param frame set to a reference counted video or audio frame allocated
+ *              by the decoder, regardless of
+ *              AVCodecContext.refcounted_frames. Any reference it held
+ *              before the call is released.
+ *
+ * @return
+ *      0:                 success, a frame was returned
+ *      AVERROR(EAGAIN):   output is not available in this state, more
+ *                         input must be sent
+ *      AVERROR_EOF:       the decoder has been fully flushed, and there
+ *                         will be no more output frames
+ *      AVERROR(EINVAL):   codec not opened, or it is an encoder
+ *      other negative values: legitimate decoding errors
+ */
+int avcodec_receive_frame(AVCodecContext *avctx, AVFrame *frame);
+
 /**
  * @defgroup lavc_parsing Frame parsing
  * @{
@@ -4176,6 +4332,49 @@ int avcodec_encode_video2(AVCodecContext *avctx, AVPacket *avpkt,
 int avcodec_encode_subtitle(AVCodecContext *avctx, uint8_t *buf, int buf_size,
                             const AVSubtitle *sub);
 
+/**
+ * Supply a raw video or audio frame to the encoder. Use
+ * avcodec_receive_packet() to retrieve the buffered output packets.
+ *
+ * @param avctx codec context, opened with a video or audio encoder
+ * @param[in] frame the frame to encode, not modified by the encoder; it
+ *                  may be released by the caller after the call.
+ *                  Audio frames must hold AVCodecContext.frame_size
+ *                  samples, except the last one if the encoder has the
+ *                  CODEC_CAP_SMALL_LAST_FRAME capability, or any number of
+ *                  samples with CODEC_CAP_VARIABLE_FRAME_SIZE.
+ *                  NULL starts draining, after which
+ *                  avcodec_receive_packet() returns the delayed packets and
+ *                  then AVERROR_EOF.
+ *
+ * @return 0 on success, otherwise negative error code:
+ *      AVERROR(EAGAIN):   input is not accepted in the current state, the
+ *                         packets must first be read with
+ *                         avcodec_receive_packet()
+ *      AVERROR_EOF:       the encoder has been flushed, and no new frames
+ *                         can be sent to it
+ *      AVERROR(EINVAL):   codec not opened, or it is a decoder
+ *      AVERROR(ENOMEM):   failed to add the frame to the internal queue
+ *      other errors:      legitimate encoding errors
+ */
+int avcodec_send_frame(AVCodecContext *avctx, const AVFrame *frame);
+
+/**
+ * Read encoded data from the encoder.
+ *
+ * @param avctx codec context
+ * @param avpkt set to a reference counted packet allocated by the
+ *              encoder. Any reference it held before the call is released.
+ * @return 0 on success, otherwise negative error code:
+ *      AVERROR(EAGAIN):   output is not available in the current state,
+ *                         more input must be sent
+ *      AVERROR_EOF:       the encoder has been fully flushed, and there
+ *                         will be no more output packets
+ *      AVERROR(EINVAL):   codec not opened, or it is a decoder
+ *      other errors:      legitimate encoding errors
+ */
+int avcodec_receive_packet(AVCodecContext *avctx, AVPacket *avpkt);
+
 
 /**
  * @}
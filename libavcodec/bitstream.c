@@ -29,6 +29,7 @@
  */
 
 #include "libavutil/avassert.h"
+#include "libavutil/thread.h"
 #include "avcodec.h"
 #include "mathops.h"
 #include "get_bits.h"
@@ -347,3 +348,104 @@ void ff_free_vlc(VLC *vlc)
 {
     av_freep(&vlc->table);
 }
+
+typedef struct VLCCacheEntry {
+    struct VLCCacheEntry *next;
+    int refcount;
+    VLC vlc;
+    int nb_codes;
+    int flags;
+    uint32_t *key;  ///< length, code and symbol of each code
+} VLCCacheEntry;
+
+static VLCCacheEntry *vlc_cache;
+static AVMutex vlc_cache_mutex = AV_MUTEX_INITIALIZER;
+
+int ff_init_vlc_shared(VLC *vlc, int nb_bits, int nb_codes,
+                       const void *bits, int bits_wrap, int bits_size,
+                       const void *codes, int codes_wrap, int codes_size,
+                       const void *symbols, int symbols_wrap, int symbols_size,
+                       int flags)
+{
+    VLCCacheEntry *e;
+    uint32_t *key;
+    int i, ret = 0;
+
+    av_assert0(!(flags & INIT_VLC_USE_NEW_STATIC));
+
+    memset(vlc, 0, sizeof(*vlc));
+
+    key = av_malloc(3 * nb_codes * sizeof(*key));
+    if (!key)
+        return AVERROR(ENOMEM);
+    for (i = 0; i < nb_codes; i++) {
+        GET_DATA(key[3 * i    ], bits,  i, bits_wrap,  bits_size);
+        GET_DATA(key[3 * i + 1], codes, i, codes_wrap, codes_size);
+        if (symbols)
+            GET_DATA(key[3 * i + 2], symbols, i, symbols_wrap, symbols_size)
+        else
+            key[3 * i + 2] = i;
+    }
+
+    ff_mutex_lock(&vlc_cache_mutex);
+    for (e = vlc_cache; e; e = e->next) {
+        if (e->vlc.bits == nb_bits && e->nb_codes == nb_codes &&
+            e->flags == flags &&
+            !memcmp(e->key, key, 3 * nb_codes * sizeof(*key)))
+            break;
+    }
+    if (e) {
+        e->refcount++;
+        av_free(key);
+    } else {
+        e = av_mallocz(sizeof(*e));
+        if (!e) {
+            av_free(key);
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        ret = ff_init_vlc_sparse(&e->vlc, nb_bits, nb_codes,
+                                 bits, bits_wrap, bits_size,
+                                 codes, codes_wrap, codes_size,
+                                 symbols, symbols_wrap, symbols_size, flags);
+        if (ret < 0) {
+            av_free(key);
+            av_free(e);
+            goto end;
+        }
+        e->refcount = 1;
+        e->nb_codes = nb_codes;
+        e->flags    = flags;
+        e->key      = key;
+        e->next     = vlc_cache;
+        vlc_cache   = e;
+    }
+    *vlc = e->vlc;
+end:
+    ff_mutex_unlock(&vlc_cache_mutex);
+    return ret;
+}
+
+void ff_free_vlc_shared(VLC *vlc)
+{
+    VLCCacheEntry **p;
+
+    if (!vlc->table)
+        return;
+
+    ff_mutex_lock(&vlc_cache_mutex);
+    for (p = &vlc_cache; *p; p = &(*p)->next) {
+        VLCCacheEntry *e = *p;
+        if (e->vlc.table == vlc->table) {
+            if (!--e->refcount) {
+                *p = e->next;
+                ff_free_vlc(&e->vlc);
+                av_free(e->key);
+                av_free(e);
+            }
+            break;
+        }
+    }
+    ff_mutex_unlock(&vlc_cache_mutex);
+    vlc->table = NULL;
+}
@@ -27,6 +27,7 @@
 #include <string.h>
 
 #include "libavutil/common.h"
+#include "libavutil/thread.h"
 #include "get_bits.h"
 #include "cabac.h"
 #include "cabac_functions.h"
@@ -137,7 +138,7 @@ void ff_init_cabac_decoder(CABACContext *c, const uint8_t *buf, int buf_size){
     c->range= 0x1FE;
 }
 
-void ff_init_cabac_states(void)
+static av_cold void cabac_init_static_states(void)
 {
     int i, j;
 
@@ -169,6 +170,12 @@ void ff_init_cabac_states(void)
     }
 }
 
+void ff_init_cabac_states(void)
+{
+    static AVOnce init_static_once = AV_ONCE_INIT;
+    ff_thread_once(&init_static_once, cabac_init_static_states);
+}
+
 #ifdef TEST
 #define SIZE 10240
 
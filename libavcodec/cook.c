@@ -188,23 +188,23 @@ static av_cold int init_cook_vlc_tables(COOKContext *q)
 
     result = 0;
     for (i = 0; i < 13; i++) {
-        result |= init_vlc(&q->envelope_quant_index[i], 9, 24,
-                           envelope_quant_index_huffbits[i], 1, 1,
-                           envelope_quant_index_huffcodes[i], 2, 2, 0);
+        result |= init_vlc_shared(&q->envelope_quant_index[i], 9, 24,
+                                  envelope_quant_index_huffbits[i], 1, 1,
+                                  envelope_quant_index_huffcodes[i], 2, 2);
     }
     av_log(q->avctx, AV_LOG_DEBUG, "sqvh VLC init\n");
     for (i = 0; i < 7; i++) {
-        result |= init_vlc(&q->sqvh[i], vhvlcsize_tab[i], vhsize_tab[i],
-                           cvh_huffbits[i], 1, 1,
-                           cvh_huffcodes[i], 2, 2, 0);
+        result |= init_vlc_shared(&q->sqvh[i], vhvlcsize_tab[i], vhsize_tab[i],
+                                  cvh_huffbits[i], 1, 1,
+                                  cvh_huffcodes[i], 2, 2);
     }
 
     for (i = 0; i < q->num_subpackets; i++) {
         if (q->subpacket[i].joint_stereo == 1) {
-            result |= init_vlc(&q->subpacket[i].channel_coupling, 6,
-                               (1 << q->subpacket[i].js_vlc_bits) - 1,
-                               ccpl_huffbits[q->subpacket[i].js_vlc_bits - 2], 1, 1,
-                               ccpl_huffcodes[q->subpacket[i].js_vlc_bits - 2], 2, 2, 0);
+            result |= init_vlc_shared(&q->subpacket[i].channel_coupling, 6,
+                                      (1 << q->subpacket[i].js_vlc_bits) - 1,
+                                      ccpl_huffbits[q->subpacket[i].js_vlc_bits - 2], 1, 1,
+                                      ccpl_huffcodes[q->subpacket[i].js_vlc_bits - 2], 2, 2);
             av_log(q->avctx, AV_LOG_DEBUG, "subpacket %i Joint-stereo VLC used.\n", i);
         }
     }
@@ -310,11 +310,11 @@ static av_cold int cook_decode_close(AVCodecContext *avctx)
 
     /* Free the VLC tables. */
     for (i = 0; i < 13; i++)
-        ff_free_vlc(&q->envelope_quant_index[i]);
+        ff_free_vlc_shared(&q->envelope_quant_index[i]);
     for (i = 0; i < 7; i++)
-        ff_free_vlc(&q->sqvh[i]);
+        ff_free_vlc_shared(&q->sqvh[i]);
     for (i = 0; i < q->num_subpackets; i++)
-        ff_free_vlc(&q->subpacket[i].channel_coupling);
+        ff_free_vlc_shared(&q->subpacket[i].channel_coupling);
 
     av_log(avctx, AV_LOG_DEBUG, "Memory deallocated.\n");
 
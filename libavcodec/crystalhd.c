@@ -912,7 +912,8 @@ static int decode(AVCodecContext *avctx, void *data, int *got_frame, AVPacket *a
                 uint8_t *pout;
                 int psize;
                 int index;
-                H264Context *h = priv->parser->priv_data;
+                H264ParseContext *p = priv->parser->priv_data;
+                H264Context *h = &p->h;
 
                 index = av_parser_parse2(priv->parser, avctx, &pout, &psize,
                                          in_data, len, avctx->pkt->pts,
@@ -33,6 +33,7 @@
 #include "libavutil/intreadwrite.h"
 #include "libavutil/mathematics.h"
 #include "libavutil/samplefmt.h"
+#include "libavutil/thread.h"
 #include "avcodec.h"
 #include "fft.h"
 #include "get_bits.h"
@@ -479,13 +480,9 @@ static const uint16_t dca_vlc_offs[] = {
 
 static av_cold void dca_init_vlcs(void)
 {
-    static int vlcs_initialized = 0;
     int i, j, c = 14;
     static VLC_TYPE dca_table[23622][2];
 
-    if (vlcs_initialized)
-        return;
-
     dca_bitalloc_index.offset = 1;
     dca_bitalloc_index.wrap = 2;
     for (i = 0; i < 5; i++) {
@@ -529,7 +526,6 @@ static av_cold void dca_init_vlcs(void)
                      bitalloc_codes[i][j], 2, 2, INIT_VLC_USE_NEW_STATIC);
             c++;
         }
-    vlcs_initialized = 1;
 }
 
 static inline void get_array(GetBitContext *gb, int *dst, int len, int bits)
@@ -2468,10 +2464,11 @@ static int dca_decode_frame(AVCodecContext *avctx, void *data,
 
 static av_cold int dca_decode_init(AVCodecContext *avctx)
 {
+    static AVOnce init_static_once = AV_ONCE_INIT;
     DCAContext *s = avctx->priv_data;
 
     s->avctx = avctx;
-    dca_init_vlcs();
+    ff_thread_once(&init_static_once, dca_init_vlcs);
 
     avpriv_float_dsp_init(&s->fdsp, avctx->flags & CODEC_FLAG_BITEXACT);
     ff_mdct_init(&s->imdct, 6, 1, 1.0);
@@ -2517,6 +2514,7 @@ AVCodec ff_dca_decoder = {
     .close           = dca_decode_end,
     .long_name       = NULL_IF_CONFIG_SMALL("DCA (DTS Coherent Acoustics)"),
     .capabilities    = CODEC_CAP_CHANNEL_CONF | CODEC_CAP_DR1,
+    .caps_internal   = FF_CODEC_CAP_INIT_THREADSAFE,
     .sample_fmts     = (const enum AVSampleFormat[]) { AV_SAMPLE_FMT_FLTP,
                                                        AV_SAMPLE_FMT_NONE },
     .profiles        = NULL_IF_CONFIG_SMALL(profiles),
@@ -49,4 +49,5 @@ av_cold void ff_dcadsp_init(DCADSPContext *s)
 {
     s->lfe_fir = dca_lfe_fir_c;
     if (ARCH_ARM) ff_dcadsp_init_arm(s);
+    if (ARCH_X86) ff_dcadsp_init_x86(s);
 }
@@ -20,11 +20,16 @@
 #define AVCODEC_DCADSP_H
 
 typedef struct DCADSPContext {
+    /**
+     * Interpolate 2 * decifactor samples from in[-256 / decifactor + 1..0].
+     * decifactor is 32 or 64.
+     */
     void (*lfe_fir)(float *out, const float *in, const float *coefs,
                     int decifactor, float scale);
 } DCADSPContext;
 
 void ff_dcadsp_init(DCADSPContext *s);
 void ff_dcadsp_init_arm(DCADSPContext *s);
+void ff_dcadsp_init_x86(DCADSPContext *s);
 
 #endif /* AVCODEC_DCADSP_H */
@@ -66,5 +66,6 @@ void ff_j_rev_dct1(int16_t *data);
 void ff_fdct_mmx(int16_t *block);
 void ff_fdct_mmxext(int16_t *block);
 void ff_fdct_sse2(int16_t *block);
+void ff_jpeg_fdct_islow_10_sse2(int16_t *block);
 
 #endif /* AVCODEC_DCT_H */
@@ -82,19 +82,19 @@ static int dnxhd_init_vlc(DNXHDContext *ctx, uint32_t cid)
         }
         ctx->cid_table = &ff_dnxhd_cid_table[index];
 
-        ff_free_vlc(&ctx->ac_vlc);
-        ff_free_vlc(&ctx->dc_vlc);
-        ff_free_vlc(&ctx->run_vlc);
-
-        init_vlc(&ctx->ac_vlc, DNXHD_VLC_BITS, 257,
-                 ctx->cid_table->ac_bits, 1, 1,
-                 ctx->cid_table->ac_codes, 2, 2, 0);
-        init_vlc(&ctx->dc_vlc, DNXHD_DC_VLC_BITS, ctx->bit_depth + 4,
-                 ctx->cid_table->dc_bits, 1, 1,
-                 ctx->cid_table->dc_codes, 1, 1, 0);
-        init_vlc(&ctx->run_vlc, DNXHD_VLC_BITS, 62,
-                 ctx->cid_table->run_bits, 1, 1,
-                 ctx->cid_table->run_codes, 2, 2, 0);
+        ff_free_vlc_shared(&ctx->ac_vlc);
+        ff_free_vlc_shared(&ctx->dc_vlc);
+        ff_free_vlc_shared(&ctx->run_vlc);
+
+        init_vlc_shared(&ctx->ac_vlc, DNXHD_VLC_BITS, 257,
+                        ctx->cid_table->ac_bits, 1, 1,
+                        ctx->cid_table->ac_codes, 2, 2);
+        init_vlc_shared(&ctx->dc_vlc, DNXHD_DC_VLC_BITS, ctx->bit_depth + 4,
+                        ctx->cid_table->dc_bits, 1, 1,
+                        ctx->cid_table->dc_codes, 1, 1);
+        init_vlc_shared(&ctx->run_vlc, DNXHD_VLC_BITS, 62,
+                        ctx->cid_table->run_bits, 1, 1,
+                        ctx->cid_table->run_codes, 2, 2);
 
         ff_init_scantable(ctx->dsp.idct_permutation, &ctx->scantable, ff_zigzag_direct);
         ctx->cid = cid;
@@ -405,9 +405,9 @@ static av_cold int dnxhd_decode_close(AVCodecContext *avctx)
 {
     DNXHDContext *ctx = avctx->priv_data;
 
-    ff_free_vlc(&ctx->ac_vlc);
-    ff_free_vlc(&ctx->dc_vlc);
-    ff_free_vlc(&ctx->run_vlc);
+    ff_free_vlc_shared(&ctx->ac_vlc);
+    ff_free_vlc_shared(&ctx->dc_vlc);
+    ff_free_vlc_shared(&ctx->run_vlc);
     return 0;
 }
 
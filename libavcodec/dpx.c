@@ -23,8 +23,13 @@
 #include "libavutil/imgutils.h"
 #include "bytestream.h"
 #include "avcodec.h"
+#include "dpxdsp.h"
 #include "internal.h"
 
+typedef struct DPXDecContext {
+    DPXDSPContext dsp;
+} DPXDecContext;
+
 static unsigned int read32(const uint8_t **ptr, int is_big)
 {
     unsigned int temp;
@@ -52,11 +57,21 @@ static uint16_t read10in32(const uint8_t **ptr, uint32_t * lbuf,
     return *lbuf & 0x3FF;
 }
 
+static av_cold int decode_init(AVCodecContext *avctx)
+{
+    DPXDecContext *s = avctx->priv_data;
+
+    ff_dpxdsp_init(&s->dsp);
+
+    return 0;
+}
+
 static int decode_frame(AVCodecContext *avctx,
                         void *data,
                         int *got_frame,
                         AVPacket *avpkt)
 {
+    DPXDecContext *s   = avctx->priv_data;
     const uint8_t *buf = avpkt->data;
     int buf_size       = avpkt->size;
     AVFrame *const p = data;
@@ -194,6 +209,18 @@ static int decode_frame(AVCodecContext *avctx,
     }
     switch (bits_per_color) {
     case 10:
+        if (elements == 3) {
+            /* one pixel per 32-bit word */
+            for (x = 0; x < avctx->height; x++) {
+                s->dsp.unpack_rgb10[endian](buf, (uint16_t*)ptr[0],
+                                            (uint16_t*)ptr[1],
+                                            (uint16_t*)ptr[2], avctx->width);
+                buf += 4 * avctx->width;
+                for (i = 0; i < 3; i++)
+                    ptr[i] += p->linesize[i];
+            }
+            break;
+        }
         for (x = 0; x < avctx->height; x++) {
             uint16_t *dst[3] = {(uint16_t*)ptr[0],
                                 (uint16_t*)ptr[1],
@@ -261,6 +288,8 @@ AVCodec ff_dpx_decoder = {
     .name           = "dpx",
     .type           = AVMEDIA_TYPE_VIDEO,
     .id             = AV_CODEC_ID_DPX,
+    .priv_data_size = sizeof(DPXDecContext),
+    .init           = decode_init,
     .decode         = decode_frame,
     .long_name      = NULL_IF_CONFIG_SMALL("DPX image"),
     .capabilities   = CODEC_CAP_DR1,
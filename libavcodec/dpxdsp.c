@@ -0,0 +1,60 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h"
+#include "libavutil/attributes.h"
+#include "libavutil/intreadwrite.h"
+#include "dpxdsp.h"
+
+#define DPX_RGB10(suffix, RN16, RN32, WN32)                                    \
+void ff_dpx_unpack_rgb10_ ## suffix(const uint8_t *src, uint16_t *g,           \
+                                    uint16_t *b, uint16_t *r, int width)       \
+{                                                                              \
+    int x;                                                                     \
+                                                                               \
+    for (x = 0; x < width; x++) {                                              \
+        unsigned word = RN32(src + 4 * x);                                     \
+        r[x] =  word >> 22;                                                    \
+        g[x] = (word >> 12) & 0x3FF;                                           \
+        b[x] = (word >>  2) & 0x3FF;                                           \
+    }                                                                          \
+}                                                                              \
+                                                                               \
+void ff_dpx_pack_rgb10_ ## suffix(const uint16_t *g, const uint16_t *b,        \
+                                  const uint16_t *r, uint8_t *dst, int width)  \
+{                                                                              \
+    int x;                                                                     \
+                                                                               \
+    for (x = 0; x < width; x++)                                                \
+        WN32(dst + 4 * x, (RN16(g + x) << 12) | (RN16(b + x) << 2) |           \
+                          ((unsigned)RN16(r + x) << 22));                      \
+}
+
+DPX_RGB10(le, AV_RL16, AV_RL32, AV_WL32)
+DPX_RGB10(be, AV_RB16, AV_RB32, AV_WB32)
+
+av_cold void ff_dpxdsp_init(DPXDSPContext *c)
+{
+    c->unpack_rgb10[0] = ff_dpx_unpack_rgb10_le;
+    c->unpack_rgb10[1] = ff_dpx_unpack_rgb10_be;
+    c->pack_rgb10[0]   = ff_dpx_pack_rgb10_le;
+    c->pack_rgb10[1]   = ff_dpx_pack_rgb10_be;
+
+    if (ARCH_X86)
+        ff_dpxdsp_init_x86(c);
+}
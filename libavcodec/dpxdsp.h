@@ -0,0 +1,53 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVCODEC_DPXDSP_H
+#define AVCODEC_DPXDSP_H
+
+#include <stdint.h>
+
+/**
+ * 10-bit RGB DPX lines, with one pixel per 32-bit word: red in bits 22-31,
+ * green in bits 12-21 and blue in bits 2-11.
+ * The functions are indexed by the endianness of the words, 1 for big
+ * endian.
+ */
+typedef struct DPXDSPContext {
+    /* unpack width words into native endian G, B and R planes */
+    void (*unpack_rgb10[2])(const uint8_t *src, uint16_t *g, uint16_t *b,
+                            uint16_t *r, int width);
+
+    /* pack width samples of G, B and R planes of the same endianness as
+     * the words */
+    void (*pack_rgb10[2])(const uint16_t *g, const uint16_t *b,
+                          const uint16_t *r, uint8_t *dst, int width);
+} DPXDSPContext;
+
+void ff_dpx_unpack_rgb10_le(const uint8_t *src, uint16_t *g, uint16_t *b,
+                            uint16_t *r, int width);
+void ff_dpx_unpack_rgb10_be(const uint8_t *src, uint16_t *g, uint16_t *b,
+                            uint16_t *r, int width);
+void ff_dpx_pack_rgb10_le(const uint16_t *g, const uint16_t *b,
+                          const uint16_t *r, uint8_t *dst, int width);
+void ff_dpx_pack_rgb10_be(const uint16_t *g, const uint16_t *b,
+                          const uint16_t *r, uint8_t *dst, int width);
+
+void ff_dpxdsp_init(DPXDSPContext *c);
+void ff_dpxdsp_init_x86(DPXDSPContext *c);
+
+#endif /* AVCODEC_DPXDSP_H */
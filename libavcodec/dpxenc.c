@@ -23,6 +23,7 @@
 #include "libavutil/intreadwrite.h"
 #include "libavutil/imgutils.h"
 #include "avcodec.h"
+#include "dpxdsp.h"
 #include "internal.h"
 
 typedef struct DPXContext {
@@ -30,6 +31,7 @@ typedef struct DPXContext {
     int bits_per_component;
     int descriptor;
     int planar;
+    DPXDSPContext dsp;
 } DPXContext;
 
 static av_cold int encode_init(AVCodecContext *avctx)
@@ -62,6 +64,8 @@ static av_cold int encode_init(AVCodecContext *avctx)
         return -1;
     }
 
+    ff_dpxdsp_init(&s->dsp);
+
     return 0;
 }
 
@@ -106,23 +110,14 @@ static void encode_gbrp10(AVCodecContext *avctx, const AVPicture *pic, uint8_t *
 {
     DPXContext *s = avctx->priv_data;
     const uint8_t *src[3] = {pic->data[0], pic->data[1], pic->data[2]};
-    int x, y, i;
+    int y, i;
 
     for (y = 0; y < avctx->height; y++) {
-        for (x = 0; x < avctx->width; x++) {
-            int value;
-            if (s->big_endian) {
-                value = (AV_RB16(src[0] + 2*x) << 12)
-                      | (AV_RB16(src[1] + 2*x) << 2)
-                      | ((unsigned)AV_RB16(src[2] + 2*x) << 22);
-            } else {
-                value = (AV_RL16(src[0] + 2*x) << 12)
-                      | (AV_RL16(src[1] + 2*x) << 2)
-                      | ((unsigned)AV_RL16(src[2] + 2*x) << 22);
-            }
-            write32(dst, value);
-            dst += 4;
-        }
+        s->dsp.pack_rgb10[s->big_endian]((const uint16_t*)src[0],
+                                         (const uint16_t*)src[1],
+                                         (const uint16_t*)src[2],
+                                         dst, avctx->width);
+        dst += 4 * avctx->width;
         for (i = 0; i < 3; i++)
             src[i] += pic->linesize[i];
     }
@@ -189,6 +189,13 @@ typedef struct DSPContext {
     qpel_mc_func put_mspel_pixels_tab[8];
 
     me_cmp_func pix_abs[2][4];
+    /**
+     * SAD of a 16xh block against 4 candidate blocks at once, scores[i]
+     * is the SAD against ref[i]. Only set if there is a version faster
+     * than calling sad[0] 4 times, NULL otherwise.
+     */
+    void (*sad16_x4)(uint8_t *blk1/*align 16*/, uint8_t *const ref[4]/*align 1*/,
+                     int line_size, int h, int *scores);
 
     /* huffyuv specific */
     void (*add_bytes)(uint8_t *dst/*align 16*/, uint8_t *src/*align 16*/, int w);
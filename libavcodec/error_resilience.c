@@ -230,10 +230,11 @@ fail:
 /**
  * simple horizontal deblocking filter used for error resilience
  * @param w     width in 8 pixel blocks
- * @param h     height in 8 pixel blocks
+ * @param y0    first row of 8 pixel blocks to filter
+ * @param y1    row of 8 pixel blocks after the last one to filter
  */
 static void h_block_filter(ERContext *s, uint8_t *dst, int w,
-                           int h, int stride, int is_luma)
+                           int y0, int y1, int stride, int is_luma)
 {
     int b_x, b_y, mvx_stride, mvy_stride;
     const uint8_t *cm = ff_cropTbl + MAX_NEG_CROP;
@@ -241,7 +242,7 @@ static void h_block_filter(ERContext *s, uint8_t *dst, int w,
     mvx_stride >>= is_luma;
     mvy_stride *= mvx_stride;
 
-    for (b_y = 0; b_y < h; b_y++) {
+    for (b_y = y0; b_y < y1; b_y++) {
         for (b_x = 0; b_x < w - 1; b_x++) {
             int y;
             int left_status  = s->error_status_table[( b_x      >> is_luma) + (b_y >> is_luma) * s->mb_stride];
@@ -299,9 +300,12 @@ static void h_block_filter(ERContext *s, uint8_t *dst, int w,
  * simple vertical deblocking filter used for error resilience
  * @param w     width in 8 pixel blocks
  * @param h     height in 8 pixel blocks
+ * @param y0    first row of 8 pixel blocks to filter the bottom edge of
+ * @param y1    row of 8 pixel blocks after the last one to filter the
+ *              bottom edge of
  */
 static void v_block_filter(ERContext *s, uint8_t *dst, int w, int h,
-                           int stride, int is_luma)
+                           int y0, int y1, int stride, int is_luma)
 {
     int b_x, b_y, mvx_stride, mvy_stride;
     const uint8_t *cm = ff_cropTbl + MAX_NEG_CROP;
@@ -309,7 +313,7 @@ static void v_block_filter(ERContext *s, uint8_t *dst, int w, int h,
     mvx_stride >>= is_luma;
     mvy_stride *= mvx_stride;
 
-    for (b_y = 0; b_y < h - 1; b_y++) {
+    for (b_y = y0; b_y < FFMIN(y1, h - 1); b_y++) {
         for (b_x = 0; b_x < w; b_x++) {
             int x;
             int top_status    = s->error_status_table[(b_x >> is_luma) +  (b_y      >> is_luma) * s->mb_stride];
@@ -839,9 +843,130 @@ void ff_er_add_slice(ERContext *s, int startx, int starty,
     }
 }
 
-void ff_er_frame_end(ERContext *s)
+/*
+ * The passes below work on independent macroblock rows or planes, and are
+ * run through execute2() so that they are spread over the slice threads.
+ * Each edge of the deblocking filters only touches the 4 pixels on both of
+ * its sides, so the rows can be filtered in any order, but all the
+ * horizontal filtering has to be done before the vertical filtering.
+ */
+
+/* Compute the DC of the blocks of one macroblock row. */
+static int fill_dc_row(AVCodecContext *avctx, void *arg, int mb_y, int threadnr)
+{
+    ERContext *s  = arg;
+    int *linesize = s->cur_pic->f.linesize;
+    int mb_x;
+
+    for (mb_x = 0; mb_x < s->mb_width; mb_x++) {
+        int dc, dcu, dcv, y, n;
+        int16_t *dc_ptr;
+        uint8_t *dest_y, *dest_cb, *dest_cr;
+        const int mb_xy   = mb_x + mb_y * s->mb_stride;
+        const int mb_type = s->cur_pic->mb_type[mb_xy];
+
+        if (IS_INTRA(mb_type) && s->partitioned_frame)
+            continue;
+        // if (error & ER_MV_ERROR)
+        //     continue; // inter data damaged FIXME is this good?
+
+        dest_y  = s->cur_pic->f.data[0] + mb_x * 16 + mb_y * 16 * linesize[0];
+        dest_cb = s->cur_pic->f.data[1] + mb_x *  8 + mb_y *  8 * linesize[1];
+        dest_cr = s->cur_pic->f.data[2] + mb_x *  8 + mb_y *  8 * linesize[2];
+
+        dc_ptr = &s->dc_val[0][mb_x * 2 + mb_y * 2 * s->b8_stride];
+        for (n = 0; n < 4; n++) {
+            dc = 0;
+            for (y = 0; y < 8; y++) {
+                int x;
+                for (x = 0; x < 8; x++)
+                   dc += dest_y[x + (n & 1) * 8 +
+                         (y + (n >> 1) * 8) * linesize[0]];
+            }
+            dc_ptr[(n & 1) + (n >> 1) * s->b8_stride] = (dc + 4) >> 3;
+        }
+
+        dcu = dcv = 0;
+        for (y = 0; y < 8; y++) {
+            int x;
+            for (x = 0; x < 8; x++) {
+                dcu += dest_cb[x + y * linesize[1]];
+                dcv += dest_cr[x + y * linesize[2]];
+            }
+        }
+        s->dc_val[1][mb_x + mb_y * s->mb_stride] = (dcu + 4) >> 3;
+        s->dc_val[2][mb_x + mb_y * s->mb_stride] = (dcv + 4) >> 3;
+    }
+    return 0;
+}
+
+static int guess_dc_plane(AVCodecContext *avctx, void *arg, int plane, int threadnr)
+{
+    ERContext *s = arg;
+
+    if (!plane)
+        guess_dc(s, s->dc_val[0], s->mb_width * 2, s->mb_height * 2, s->b8_stride, 1);
+    else
+        guess_dc(s, s->dc_val[plane], s->mb_width, s->mb_height, s->mb_stride, 0);
+    return 0;
+}
+
+/* Render the damaged intra macroblocks of one row as DC only. */
+static int put_dc_row(AVCodecContext *avctx, void *arg, int mb_y, int threadnr)
+{
+    ERContext *s  = arg;
+    int *linesize = s->cur_pic->f.linesize;
+    int mb_x;
+
+    for (mb_x = 0; mb_x < s->mb_width; mb_x++) {
+        uint8_t *dest_y, *dest_cb, *dest_cr;
+        const int mb_xy   = mb_x + mb_y * s->mb_stride;
+        const int mb_type = s->cur_pic->mb_type[mb_xy];
+        int error         = s->error_status_table[mb_xy];
+
+        if (IS_INTER(mb_type))
+            continue;
+        if (!(error & ER_AC_ERROR))
+            continue; // undamaged
+
+        dest_y  = s->cur_pic->f.data[0] + mb_x * 16 + mb_y * 16 * linesize[0];
+        dest_cb = s->cur_pic->f.data[1] + mb_x *  8 + mb_y *  8 * linesize[1];
+        dest_cr = s->cur_pic->f.data[2] + mb_x *  8 + mb_y *  8 * linesize[2];
+
+        put_dc(s, dest_y, dest_cb, dest_cr, mb_x, mb_y);
+    }
+    return 0;
+}
+
+static int h_block_filter_row(AVCodecContext *avctx, void *arg, int mb_y, int threadnr)
+{
+    ERContext *s  = arg;
+    int *linesize = s->cur_pic->f.linesize;
+    uint8_t **data = s->cur_pic->f.data;
+
+    h_block_filter(s, data[0], s->mb_width * 2, mb_y * 2, mb_y * 2 + 2, linesize[0], 1);
+    h_block_filter(s, data[1], s->mb_width,     mb_y,     mb_y + 1,     linesize[1], 0);
+    h_block_filter(s, data[2], s->mb_width,     mb_y,     mb_y + 1,     linesize[2], 0);
+    return 0;
+}
+
+static int v_block_filter_row(AVCodecContext *avctx, void *arg, int mb_y, int threadnr)
 {
+    ERContext *s  = arg;
     int *linesize = s->cur_pic->f.linesize;
+    uint8_t **data = s->cur_pic->f.data;
+
+    v_block_filter(s, data[0], s->mb_width * 2, s->mb_height * 2,
+                   mb_y * 2, mb_y * 2 + 2, linesize[0], 1);
+    v_block_filter(s, data[1], s->mb_width, s->mb_height,
+                   mb_y, mb_y + 1, linesize[1], 0);
+    v_block_filter(s, data[2], s->mb_width, s->mb_height,
+                   mb_y, mb_y + 1, linesize[2], 0);
+    return 0;
+}
+
+void ff_er_frame_end(ERContext *s)
+{
     int i, mb_x, mb_y, error, error_type, dc_error, mv_error, ac_error;
     int distance;
     int threshold_part[4] = { 100, 100, 100 };
@@ -1162,54 +1287,10 @@ void ff_er_frame_end(ERContext *s)
     if (CONFIG_MPEG_XVMC_DECODER && s->avctx->xvmc_acceleration)
         goto ec_clean;
     /* fill DC for inter blocks */
-    for (mb_y = 0; mb_y < s->mb_height; mb_y++) {
-        for (mb_x = 0; mb_x < s->mb_width; mb_x++) {
-            int dc, dcu, dcv, y, n;
-            int16_t *dc_ptr;
-            uint8_t *dest_y, *dest_cb, *dest_cr;
-            const int mb_xy   = mb_x + mb_y * s->mb_stride;
-            const int mb_type = s->cur_pic->mb_type[mb_xy];
-
-            error = s->error_status_table[mb_xy];
-
-            if (IS_INTRA(mb_type) && s->partitioned_frame)
-                continue;
-            // if (error & ER_MV_ERROR)
-            //     continue; // inter data damaged FIXME is this good?
-
-            dest_y  = s->cur_pic->f.data[0] + mb_x * 16 + mb_y * 16 * linesize[0];
-            dest_cb = s->cur_pic->f.data[1] + mb_x *  8 + mb_y *  8 * linesize[1];
-            dest_cr = s->cur_pic->f.data[2] + mb_x *  8 + mb_y *  8 * linesize[2];
-
-            dc_ptr = &s->dc_val[0][mb_x * 2 + mb_y * 2 * s->b8_stride];
-            for (n = 0; n < 4; n++) {
-                dc = 0;
-                for (y = 0; y < 8; y++) {
-                    int x;
-                    for (x = 0; x < 8; x++)
-                       dc += dest_y[x + (n & 1) * 8 +
-                             (y + (n >> 1) * 8) * linesize[0]];
-                }
-                dc_ptr[(n & 1) + (n >> 1) * s->b8_stride] = (dc + 4) >> 3;
-            }
-
-            dcu = dcv = 0;
-            for (y = 0; y < 8; y++) {
-                int x;
-                for (x = 0; x < 8; x++) {
-                    dcu += dest_cb[x + y * linesize[1]];
-                    dcv += dest_cr[x + y * linesize[2]];
-                }
-            }
-            s->dc_val[1][mb_x + mb_y * s->mb_stride] = (dcu + 4) >> 3;
-            s->dc_val[2][mb_x + mb_y * s->mb_stride] = (dcv + 4) >> 3;
-        }
-    }
+    s->avctx->execute2(s->avctx, fill_dc_row, s, NULL, s->mb_height);
 #if 1
     /* guess DC for damaged blocks */
-    guess_dc(s, s->dc_val[0], s->mb_width*2, s->mb_height*2, s->b8_stride, 1);
-    guess_dc(s, s->dc_val[1], s->mb_width  , s->mb_height  , s->mb_stride, 0);
-    guess_dc(s, s->dc_val[2], s->mb_width  , s->mb_height  , s->mb_stride, 0);
+    s->avctx->execute2(s->avctx, guess_dc_plane, s, NULL, 3);
 #endif
 
     /* filter luma DC */
@@ -1217,44 +1298,15 @@ void ff_er_frame_end(ERContext *s)
 
 #if 1
     /* render DC only intra */
-    for (mb_y = 0; mb_y < s->mb_height; mb_y++) {
-        for (mb_x = 0; mb_x < s->mb_width; mb_x++) {
-            uint8_t *dest_y, *dest_cb, *dest_cr;
-            const int mb_xy   = mb_x + mb_y * s->mb_stride;
-            const int mb_type = s->cur_pic->mb_type[mb_xy];
-
-            error = s->error_status_table[mb_xy];
-
-            if (IS_INTER(mb_type))
-                continue;
-            if (!(error & ER_AC_ERROR))
-                continue; // undamaged
-
-            dest_y  = s->cur_pic->f.data[0] + mb_x * 16 + mb_y * 16 * linesize[0];
-            dest_cb = s->cur_pic->f.data[1] + mb_x *  8 + mb_y *  8 * linesize[1];
-            dest_cr = s->cur_pic->f.data[2] + mb_x *  8 + mb_y *  8 * linesize[2];
-
-            put_dc(s, dest_y, dest_cb, dest_cr, mb_x, mb_y);
-        }
-    }
+    s->avctx->execute2(s->avctx, put_dc_row, s, NULL, s->mb_height);
 #endif
 
     if (s->avctx->error_concealment & FF_EC_DEBLOCK) {
         /* filter horizontal block boundaries */
-        h_block_filter(s, s->cur_pic->f.data[0], s->mb_width * 2,
-                       s->mb_height * 2, linesize[0], 1);
-        h_block_filter(s, s->cur_pic->f.data[1], s->mb_width,
-                       s->mb_height, linesize[1], 0);
-        h_block_filter(s, s->cur_pic->f.data[2], s->mb_width,
-                       s->mb_height, linesize[2], 0);
+        s->avctx->execute2(s->avctx, h_block_filter_row, s, NULL, s->mb_height);
 
         /* filter vertical block boundaries */
-        v_block_filter(s, s->cur_pic->f.data[0], s->mb_width * 2,
-                       s->mb_height * 2, linesize[0], 1);
-        v_block_filter(s, s->cur_pic->f.data[1], s->mb_width,
-                       s->mb_height, linesize[1], 0);
-        v_block_filter(s, s->cur_pic->f.data[2], s->mb_width,
-                       s->mb_height, linesize[2], 0);
+        s->avctx->execute2(s->avctx, v_block_filter_row, s, NULL, s->mb_height);
     }
 
 ec_clean:
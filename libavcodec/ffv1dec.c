@@ -25,6 +25,8 @@
  * FF Video Codec 1 (a lossless codec) decoder
  */
 
+#define CACHED_BITSTREAM_READER 1
+
 #include "libavutil/avassert.h"
 #include "libavutil/crc.h"
 #include "libavutil/opt.h"
@@ -115,6 +115,25 @@ typedef struct FlacEncodeContext {
     unsigned int md5_buffer_size;
     DSPContext dsp;
     FLACDSPContext flac_dsp;
+
+    /**
+     * Frame contexts for frame-parallel encoding with slice threads, NULL if
+     * unthreaded. They are used as a ring: nb_encoded frames ready for output
+     * starting at next_out, followed by nb_queued frames waiting to be
+     * encoded in one batch.
+     */
+    struct FlacEncodeContext **thread_ctx;
+    int nb_thread_ctx;
+    int next_out;
+    int nb_encoded;
+    int nb_queued;
+
+    /* frame context only */
+    int64_t pts;
+    int nb_samples;
+    uint8_t *out_buf;                   ///< encoded frame
+    unsigned int out_buf_size;
+    int out_bytes;                      ///< size of the encoded frame or error code
 } FlacEncodeContext;
 
 
@@ -423,14 +442,43 @@ static av_cold int flac_encode_init(AVCodecContext *avctx)
 
     ret = ff_lpc_init(&s->lpc_ctx, avctx->frame_size,
                       s->options.max_prediction_order, FF_LPC_TYPE_LEVINSON);
+    if (ret < 0)
+        return ret;
 
     ff_dsputil_init(&s->dsp, avctx);
     ff_flacdsp_init(&s->flac_dsp, avctx->sample_fmt,
                     avctx->bits_per_raw_sample);
 
+    /* frames are independent once STREAMINFO is fixed, so with slice
+       threading one batch of frames is encoded in parallel */
+    if (avctx->active_thread_type & FF_THREAD_SLICE && avctx->thread_count > 1) {
+        s->thread_ctx = av_mallocz(avctx->thread_count * sizeof(*s->thread_ctx));
+        if (!s->thread_ctx)
+            return AVERROR(ENOMEM);
+        for (i = 0; i < avctx->thread_count; i++) {
+            FlacEncodeContext *t = av_malloc(sizeof(*t));
+            if (!t)
+                return AVERROR(ENOMEM);
+            memcpy(t, s, sizeof(*t));
+            t->md5ctx        = NULL;
+            t->md5_buffer    = NULL;
+            t->thread_ctx    = NULL;
+            t->nb_thread_ctx = 0;
+            t->out_buf       = NULL;
+            t->out_buf_size  = 0;
+            s->thread_ctx[s->nb_thread_ctx++] = t;
+            ret = ff_lpc_init(&t->lpc_ctx, avctx->frame_size,
+                              s->options.max_prediction_order, FF_LPC_TYPE_LEVINSON);
+            if (ret < 0) {
+                memset(&t->lpc_ctx, 0, sizeof(t->lpc_ctx));
+                return ret;
+            }
+        }
+    }
+
     dprint_compression_options(s);
 
-    return ret;
+    return 0;
 }
 
 
@@ -1178,9 +1226,9 @@ static void write_frame_footer(FlacEncodeContext *s)
 }
 
 
-static int write_frame(FlacEncodeContext *s, AVPacket *avpkt)
+static int write_frame(FlacEncodeContext *s, uint8_t *buf, int buf_size)
 {
-    init_put_bits(&s->pb, avpkt->data, avpkt->size);
+    init_put_bits(&s->pb, buf, buf_size);
     write_frame_header(s);
     write_subframes(s);
     write_frame_footer(s);
@@ -1226,6 +1274,137 @@ static int update_md5_sum(FlacEncodeContext *s, const void *samples)
 }
 
 
+/**
+ * Compress the frame whose samples have been copied into the context.
+ * @return size of the frame in bytes or a negative error code
+ */
+static int compress_frame(FlacEncodeContext *s)
+{
+    int frame_bytes;
+
+    channel_decorrelation(s);
+
+    remove_wasted_bits(s);
+
+    frame_bytes = encode_frame(s);
+
+    /* Fall back on verbatim mode if the compressed frame is larger than it
+       would be if encoded uncompressed. */
+    if (frame_bytes < 0 || frame_bytes > s->max_framesize) {
+        s->frame.verbatim_only = 1;
+        frame_bytes = encode_frame(s);
+        if (frame_bytes < 0)
+            av_log(s->avctx, AV_LOG_ERROR, "Bad frame count\n");
+    }
+    return frame_bytes;
+}
+
+
+static void update_framesize_stats(FlacEncodeContext *s, int out_bytes)
+{
+    if (out_bytes > s->max_encoded_framesize)
+        s->max_encoded_framesize = out_bytes;
+    if (out_bytes < s->min_framesize)
+        s->min_framesize = out_bytes;
+}
+
+
+static int encode_frame_thread(AVCodecContext *avctx, void *arg,
+                               int jobnr, int threadnr)
+{
+    FlacEncodeContext *s = avctx->priv_data;
+    FlacEncodeContext *t = s->thread_ctx[(s->next_out + jobnr) % s->nb_thread_ctx];
+    int frame_bytes;
+
+    frame_bytes = compress_frame(t);
+    if (frame_bytes < 0) {
+        t->out_bytes = frame_bytes;
+        return frame_bytes;
+    }
+    av_fast_malloc(&t->out_buf, &t->out_buf_size, frame_bytes);
+    if (!t->out_buf) {
+        t->out_bytes = AVERROR(ENOMEM);
+        return t->out_bytes;
+    }
+    t->out_bytes = write_frame(t, t->out_buf, frame_bytes);
+    return 0;
+}
+
+
+/**
+ * Frame-parallel encoding: frames are collected in the frame contexts and
+ * compressed in one batch once all of them are filled, then returned in
+ * order while the next batch is collected.
+ */
+static int flac_encode_frame_threaded(AVCodecContext *avctx, AVPacket *avpkt,
+                                      const AVFrame *frame, int *got_packet_ptr)
+{
+    FlacEncodeContext *s = avctx->priv_data;
+    FlacEncodeContext *t;
+    int ret;
+
+    if (!s->nb_encoded && s->nb_queued &&
+        (s->nb_queued == s->nb_thread_ctx || !frame)) {
+        avctx->execute2(avctx, encode_frame_thread, NULL, NULL, s->nb_queued);
+        s->nb_encoded = s->nb_queued;
+        s->nb_queued  = 0;
+    }
+
+    if (s->nb_encoded) {
+        t = s->thread_ctx[s->next_out];
+        s->next_out = (s->next_out + 1) % s->nb_thread_ctx;
+        s->nb_encoded--;
+        if (t->out_bytes < 0)
+            return t->out_bytes;
+
+        if ((ret = ff_alloc_packet2(avctx, avpkt, t->out_bytes)) < 0)
+            return ret;
+        memcpy(avpkt->data, t->out_buf, t->out_bytes);
+        update_framesize_stats(s, t->out_bytes);
+
+        avpkt->pts      = t->pts;
+        avpkt->duration = ff_samples_to_time_base(avctx, t->nb_samples);
+        avpkt->size     = t->out_bytes;
+        *got_packet_ptr = 1;
+    }
+
+    if (!frame) {
+        /* when the last block is reached, update the header in extradata */
+        if (!*got_packet_ptr) {
+            s->max_framesize = s->max_encoded_framesize;
+            av_md5_final(s->md5ctx, s->md5sum);
+            write_streaminfo(s, avctx->extradata);
+        }
+        return 0;
+    }
+
+    /* change max_framesize for small final frame */
+    if (frame->nb_samples < s->frame.blocksize) {
+        s->max_framesize = ff_flac_get_max_frame_size(frame->nb_samples,
+                                                      s->channels,
+                                                      avctx->bits_per_raw_sample);
+    }
+    s->frame.blocksize = frame->nb_samples;
+
+    t = s->thread_ctx[(s->next_out + s->nb_encoded + s->nb_queued) % s->nb_thread_ctx];
+    t->max_framesize = s->max_framesize;
+    t->frame_count   = s->frame_count;
+    t->pts           = frame->pts;
+    t->nb_samples    = frame->nb_samples;
+    init_frame(t, frame->nb_samples);
+    copy_samples(t, frame->data[0]);
+    s->nb_queued++;
+
+    s->frame_count++;
+    s->sample_count += frame->nb_samples;
+    if ((ret = update_md5_sum(s, frame->data[0])) < 0) {
+        av_log(avctx, AV_LOG_ERROR, "Error updating MD5 checksum\n");
+        return ret;
+    }
+    return 0;
+}
+
+
 static int flac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
                              const AVFrame *frame, int *got_packet_ptr)
 {
@@ -1234,6 +1413,9 @@ static int flac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
 
     s = avctx->priv_data;
 
+    if (s->thread_ctx)
+        return flac_encode_frame_threaded(avctx, avpkt, frame, got_packet_ptr);
+
     /* when the last block is reached, update the header in extradata */
     if (!frame) {
         s->max_framesize = s->max_encoded_framesize;
@@ -1253,27 +1435,14 @@ static int flac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
 
     copy_samples(s, frame->data[0]);
 
-    channel_decorrelation(s);
-
-    remove_wasted_bits(s);
-
-    frame_bytes = encode_frame(s);
-
-    /* Fall back on verbatim mode if the compressed frame is larger than it
-       would be if encoded uncompressed. */
-    if (frame_bytes < 0 || frame_bytes > s->max_framesize) {
-        s->frame.verbatim_only = 1;
-        frame_bytes = encode_frame(s);
-        if (frame_bytes < 0) {
-            av_log(avctx, AV_LOG_ERROR, "Bad frame count\n");
-            return frame_bytes;
-        }
-    }
+    frame_bytes = compress_frame(s);
+    if (frame_bytes < 0)
+        return frame_bytes;
 
     if ((ret = ff_alloc_packet2(avctx, avpkt, frame_bytes)) < 0)
         return ret;
 
-    out_bytes = write_frame(s, avpkt);
+    out_bytes = write_frame(s, avpkt->data, avpkt->size);
 
     s->frame_count++;
     s->sample_count += frame->nb_samples;
@@ -1281,10 +1450,7 @@ static int flac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
         av_log(avctx, AV_LOG_ERROR, "Error updating MD5 checksum\n");
         return ret;
     }
-    if (out_bytes > s->max_encoded_framesize)
-        s->max_encoded_framesize = out_bytes;
-    if (out_bytes < s->min_framesize)
-        s->min_framesize = out_bytes;
+    update_framesize_stats(s, out_bytes);
 
     avpkt->pts      = frame->pts;
     avpkt->duration = ff_samples_to_time_base(avctx, frame->nb_samples);
@@ -1298,6 +1464,13 @@ static av_cold int flac_encode_close(AVCodecContext *avctx)
 {
     if (avctx->priv_data) {
         FlacEncodeContext *s = avctx->priv_data;
+        int i;
+        for (i = 0; i < s->nb_thread_ctx; i++) {
+            ff_lpc_end(&s->thread_ctx[i]->lpc_ctx);
+            av_freep(&s->thread_ctx[i]->out_buf);
+            av_freep(&s->thread_ctx[i]);
+        }
+        av_freep(&s->thread_ctx);
         av_freep(&s->md5ctx);
         av_freep(&s->md5_buffer);
         ff_lpc_end(&s->lpc_ctx);
@@ -1349,7 +1522,8 @@ AVCodec ff_flac_encoder = {
     .init           = flac_encode_init,
     .encode2        = flac_encode_frame,
     .close          = flac_encode_close,
-    .capabilities   = CODEC_CAP_SMALL_LAST_FRAME | CODEC_CAP_DELAY | CODEC_CAP_LOSSLESS,
+    .capabilities   = CODEC_CAP_SMALL_LAST_FRAME | CODEC_CAP_DELAY | CODEC_CAP_LOSSLESS |
+                      CODEC_CAP_SLICE_THREADS,
     .sample_fmts    = (const enum AVSampleFormat[]){ AV_SAMPLE_FMT_S16,
                                                      AV_SAMPLE_FMT_S32,
                                                      AV_SAMPLE_FMT_NONE },
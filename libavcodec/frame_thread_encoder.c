@@ -23,6 +23,7 @@
 #include "libavutil/fifo.h"
 #include "libavutil/avassert.h"
 #include "libavutil/imgutils.h"
+#include "libavutil/opt.h"
 #include "avcodec.h"
 #include "internal.h"
 #include "thread.h"
@@ -45,6 +46,19 @@ typedef struct{
     unsigned index;
 } Task;
 
+/**
+ * A closed GOP coded as a whole by one worker, see gop_threading_supported().
+ */
+typedef struct{
+    AVFrame **frames;
+    int nb_frames;
+    int picture_number;     ///< index of frames[0] in the whole stream
+    int64_t prev_pts;       ///< pts of the last frame of the previous GOP
+
+    AVPacket *pkts;
+    int nb_pkts;
+} GopTask;
+
 typedef struct{
     AVCodecContext *parent_avctx;
     pthread_mutex_t buffer_mutex;
@@ -62,8 +76,98 @@ typedef struct{
 
     pthread_t worker[MAX_THREADS];
     int exit;
+
+    int gop_mode;
+    int gop_size;
+    GopTask *gop;           ///< GOP being filled with input frames
+    GopTask *out_gop;       ///< finished GOP whose packets are being returned
+    int out_pkt;
+    int frame_number;
+    int64_t last_pts;
+    int64_t prev_pts;
+
+    /**
+     * Protects the rate control state of the parent context, which is
+     * updated with the size of every returned packet, and rc_frames, the
+     * number of frames accounted in it.
+     */
+    pthread_mutex_t rc_mutex;
+    int rc_frames;
 } ThreadContext;
 
+/**
+ * Closed GOPs of MPEG-1/2 video can be coded independently of each other,
+ * so they are handed out as a whole to the workers.
+ */
+static int gop_threading_supported(AVCodecContext *avctx)
+{
+    return (CONFIG_MPEG1VIDEO_ENCODER || CONFIG_MPEG2VIDEO_ENCODER) &&
+           (avctx->codec_id == AV_CODEC_ID_MPEG1VIDEO ||
+            avctx->codec_id == AV_CODEC_ID_MPEG2VIDEO) &&
+           (avctx->flags & CODEC_FLAG_CLOSED_GOP) &&
+           !(avctx->flags & (CODEC_FLAG_PASS1 | CODEC_FLAG_PASS2));
+}
+
+static void free_gop(ThreadContext *c, GopTask **pgop)
+{
+    GopTask *gop = *pgop;
+    int i;
+
+    if (!gop)
+        return;
+
+    pthread_mutex_lock(&c->buffer_mutex);
+    for (i = 0; i < gop->nb_frames; i++)
+        av_frame_free(&gop->frames[i]);
+    pthread_mutex_unlock(&c->buffer_mutex);
+    for (i = 0; i < gop->nb_pkts; i++)
+        av_free_packet(&gop->pkts[i]);
+    av_freep(&gop->frames);
+    av_freep(&gop->pkts);
+    av_freep(pgop);
+}
+
+static int encode_gop(AVCodecContext *avctx, ThreadContext *c, GopTask *gop)
+{
+    int i, flush, got_packet, ret = 0;
+
+    gop->pkts = av_malloc_array(gop->nb_frames, sizeof(*gop->pkts));
+    if (!gop->pkts)
+        return AVERROR(ENOMEM);
+
+    pthread_mutex_lock(&c->rc_mutex);
+    if (CONFIG_MPEG1VIDEO_ENCODER || CONFIG_MPEG2VIDEO_ENCODER)
+        ff_MPV_encode_gop_start(avctx, c->parent_avctx, gop->picture_number,
+                                gop->nb_frames, gop->prev_pts,
+                                gop->picture_number - c->rc_frames);
+    pthread_mutex_unlock(&c->rc_mutex);
+
+    gop->frames[0]->pict_type = AV_PICTURE_TYPE_I;
+
+    /* The encoder is flushed at the end of the GOP. Its queue may contain
+     * holes, so it is only considered empty once all the frames came out
+     * or after as many calls without output as its delay. */
+    for (i = 0, flush = 0; gop->nb_pkts < gop->nb_frames &&
+                           flush <= avctx->max_b_frames + 1; i++) {
+        AVFrame *frame = i < gop->nb_frames ? gop->frames[i] : NULL;
+        AVPacket pkt = { 0 };
+
+        av_init_packet(&pkt);
+        ret = avcodec_encode_video2(avctx, &pkt, frame, &got_packet);
+        if (ret < 0)
+            return ret;
+        if (got_packet) {
+            av_dup_packet(&pkt);
+            gop->pkts[gop->nb_pkts++] = pkt;
+            flush = 0;
+        } else if (!frame) {
+            flush++;
+        }
+    }
+
+    return 0;
+}
+
 static void * attribute_align_arg worker(void *v){
     AVCodecContext *avctx = v;
     ThreadContext *c = avctx->internal->frame_thread_encoder;
@@ -88,6 +192,24 @@ static void * attribute_align_arg worker(void *v){
         }
         av_fifo_generic_read(c->task_fifo, &task, sizeof(task), NULL);
         pthread_mutex_unlock(&c->task_fifo_mutex);
+        if (c->gop_mode) {
+            GopTask *gop = task.indata;
+            int i;
+
+            ret = encode_gop(avctx, c, gop);
+            pthread_mutex_lock(&c->buffer_mutex);
+            for (i = 0; i < gop->nb_frames; i++)
+                av_frame_free(&gop->frames[i]);
+            pthread_mutex_unlock(&c->buffer_mutex);
+            gop->nb_frames = 0;
+
+            pthread_mutex_lock(&c->finished_task_mutex);
+            c->finished_tasks[task.index].outdata = gop;
+            c->finished_tasks[task.index].return_code = ret;
+            pthread_cond_signal(&c->finished_task_cond);
+            pthread_mutex_unlock(&c->finished_task_mutex);
+            continue;
+        }
         frame = task.indata;
 
         ret = avcodec_encode_video2(avctx, pkt, frame, &got_packet);
@@ -122,7 +244,8 @@ int ff_frame_thread_encoder_init(AVCodecContext *avctx, AVDictionary *options){
 
 
     if(   !(avctx->thread_type & FF_THREAD_FRAME)
-       || !(avctx->codec->capabilities & CODEC_CAP_INTRA_ONLY))
+       || !(avctx->codec->capabilities & CODEC_CAP_INTRA_ONLY ||
+            gop_threading_supported(avctx)))
         return 0;
 
     if(!avctx->thread_count) {
@@ -142,6 +265,12 @@ int ff_frame_thread_encoder_init(AVCodecContext *avctx, AVDictionary *options){
         return AVERROR(ENOMEM);
 
     c->parent_avctx = avctx;
+    c->gop_mode     = !(avctx->codec->capabilities & CODEC_CAP_INTRA_ONLY);
+    /* the worker coding the first GOP needs two frames to derive the
+     * initial dts from the frame duration */
+    c->gop_size     = FFMAX(avctx->gop_size, 2);
+    c->last_pts     =
+    c->prev_pts     = AV_NOPTS_VALUE;
 
     c->task_fifo = av_fifo_alloc(sizeof(Task) * BUFFER_SIZE);
     if(!c->task_fifo)
@@ -150,6 +279,7 @@ int ff_frame_thread_encoder_init(AVCodecContext *avctx, AVDictionary *options){
     pthread_mutex_init(&c->task_fifo_mutex, NULL);
     pthread_mutex_init(&c->finished_task_mutex, NULL);
     pthread_mutex_init(&c->buffer_mutex, NULL);
+    pthread_mutex_init(&c->rc_mutex, NULL);
     pthread_cond_init(&c->task_fifo_cond, NULL);
     pthread_cond_init(&c->finished_task_cond, NULL);
 
@@ -164,6 +294,16 @@ int ff_frame_thread_encoder_init(AVCodecContext *avctx, AVDictionary *options){
         thread_avctx->priv_data = tmpv;
         thread_avctx->internal = NULL;
         memcpy(thread_avctx->priv_data, avctx->priv_data, avctx->codec->priv_data_size);
+        if (avctx->codec->priv_class) {
+            /* the copies must not share the string options with the parent,
+             * they are freed when the options are set again */
+            const AVOption *o = NULL;
+            while ((o = av_opt_next(thread_avctx->priv_data, o))) {
+                char **str = (char **)((uint8_t *)thread_avctx->priv_data + o->offset);
+                if (o->type == AV_OPT_TYPE_STRING && *str && !(*str = av_strdup(*str)))
+                    goto fail;
+            }
+        }
         thread_avctx->thread_count = 1;
         thread_avctx->active_thread_type &= ~FF_THREAD_FRAME;
 
@@ -206,13 +346,140 @@ void ff_frame_thread_encoder_free(AVCodecContext *avctx){
 
     pthread_mutex_destroy(&c->task_fifo_mutex);
     pthread_mutex_destroy(&c->finished_task_mutex);
+    if (c->gop_mode) {
+        Task task;
+
+        while (av_fifo_size(c->task_fifo) > 0) {
+            av_fifo_generic_read(c->task_fifo, &task, sizeof(task), NULL);
+            free_gop(c, (GopTask **)&task.indata);
+        }
+        for (i = 0; i < BUFFER_SIZE; i++)
+            free_gop(c, (GopTask **)&c->finished_tasks[i].outdata);
+        free_gop(c, &c->gop);
+        free_gop(c, &c->out_gop);
+    }
+
     pthread_mutex_destroy(&c->buffer_mutex);
+    pthread_mutex_destroy(&c->rc_mutex);
     pthread_cond_destroy(&c->task_fifo_cond);
     pthread_cond_destroy(&c->finished_task_cond);
     av_fifo_free(c->task_fifo); c->task_fifo = NULL;
     av_freep(&avctx->internal->frame_thread_encoder);
 }
 
+static int submit_gop(ThreadContext *c)
+{
+    GopTask *gop = c->gop;
+    Task task;
+
+    gop->prev_pts = c->prev_pts;
+    c->prev_pts   = gop->frames[gop->nb_frames - 1]->pts;
+
+    task.index  = c->task_index;
+    task.indata = gop;
+    pthread_mutex_lock(&c->task_fifo_mutex);
+    av_fifo_generic_write(c->task_fifo, &task, sizeof(task), NULL);
+    pthread_cond_signal(&c->task_fifo_cond);
+    pthread_mutex_unlock(&c->task_fifo_mutex);
+
+    c->task_index = (c->task_index+1) % BUFFER_SIZE;
+    c->gop = NULL;
+
+    return 0;
+}
+
+static int gop_encode_frame(AVCodecContext *avctx, ThreadContext *c,
+                            AVPacket *pkt, const AVFrame *frame,
+                            int *got_packet_ptr)
+{
+    Task task;
+    int ret;
+
+    if (frame) {
+        AVFrame *new;
+
+        if (!c->gop) {
+            c->gop = av_mallocz(sizeof(*c->gop));
+            if (!c->gop)
+                return AVERROR(ENOMEM);
+            c->gop->frames = av_malloc_array(c->gop_size, sizeof(*c->gop->frames));
+            if (!c->gop->frames) {
+                av_freep(&c->gop);
+                return AVERROR(ENOMEM);
+            }
+            c->gop->picture_number = c->frame_number;
+        }
+
+        /* the frames are kept until their GOP is complete, so they are
+         * always copied */
+        new = av_frame_alloc();
+        if (!new)
+            return AVERROR(ENOMEM);
+        pthread_mutex_lock(&c->buffer_mutex);
+        ret = ff_get_buffer(c->parent_avctx, new, 0);
+        pthread_mutex_unlock(&c->buffer_mutex);
+        if (ret < 0) {
+            av_frame_free(&new);
+            return ret;
+        }
+        av_frame_copy_props(new, frame);
+        av_image_copy(new->data, new->linesize, (const uint8_t **)frame->data, frame->linesize,
+                      avctx->pix_fmt, avctx->width, avctx->height);
+
+        /* the worker coding the GOP does not know the timestamps of the
+         * previous frames, so guess missing ones here */
+        if (new->pts == AV_NOPTS_VALUE)
+            new->pts = c->last_pts != AV_NOPTS_VALUE ? c->last_pts + 1
+                                                     : c->frame_number;
+        c->last_pts = new->pts;
+        c->frame_number++;
+
+        c->gop->frames[c->gop->nb_frames++] = new;
+        if (c->gop->nb_frames == c->gop_size)
+            submit_gop(c);
+    } else if (c->gop) {
+        submit_gop(c);
+    }
+
+    while (!c->out_gop || c->out_pkt == c->out_gop->nb_pkts) {
+        free_gop(c, &c->out_gop);
+
+        if (c->task_index == c->finished_task_index)
+            return 0;
+        if (frame && !c->finished_tasks[c->finished_task_index].outdata &&
+            (c->task_index - c->finished_task_index) % BUFFER_SIZE <= avctx->thread_count)
+            return 0;
+
+        pthread_mutex_lock(&c->finished_task_mutex);
+        while (!c->finished_tasks[c->finished_task_index].outdata) {
+            pthread_cond_wait(&c->finished_task_cond, &c->finished_task_mutex);
+        }
+        task = c->finished_tasks[c->finished_task_index];
+        c->finished_tasks[c->finished_task_index].outdata = NULL;
+        c->finished_task_index = (c->finished_task_index+1) % BUFFER_SIZE;
+        pthread_mutex_unlock(&c->finished_task_mutex);
+
+        c->out_gop = task.outdata;
+        c->out_pkt = 0;
+        if (task.return_code < 0) {
+            free_gop(c, &c->out_gop);
+            return task.return_code;
+        }
+    }
+
+    *pkt = c->out_gop->pkts[c->out_pkt];
+    memset(&c->out_gop->pkts[c->out_pkt++], 0, sizeof(*pkt));
+    *got_packet_ptr = 1;
+
+    pthread_mutex_lock(&c->rc_mutex);
+    if (CONFIG_MPEG1VIDEO_ENCODER || CONFIG_MPEG2VIDEO_ENCODER)
+        ff_MPV_encode_gop_feedback(c->parent_avctx, pkt->size);
+    c->rc_frames++;
+    pthread_mutex_unlock(&c->rc_mutex);
+
+    return 0;
+}
+
 int ff_thread_video_encode_frame(AVCodecContext *avctx, AVPacket *pkt, const AVFrame *frame, int *got_packet_ptr){
     ThreadContext *c = avctx->internal->frame_thread_encoder;
     Task task;
@@ -220,6 +487,9 @@ int ff_thread_video_encode_frame(AVCodecContext *avctx, AVPacket *pkt, const AVF
 
     av_assert1(!*got_packet_ptr);
 
+    if (c->gop_mode)
+        return gop_encode_frame(avctx, c, pkt, frame, got_packet_ptr);
+
     if(frame){
         if(!(avctx->flags & CODEC_FLAG_INPUT_PRESERVED)){
             AVFrame *new = av_frame_alloc();
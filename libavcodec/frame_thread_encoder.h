@@ -24,3 +24,9 @@ int ff_frame_thread_encoder_init(AVCodecContext *avctx, AVDictionary *options);
 void ff_frame_thread_encoder_free(AVCodecContext *avctx);
 int ff_thread_video_encode_frame(AVCodecContext *avctx, AVPacket *pkt, const AVFrame *frame, int *got_packet_ptr);
 
+/* GOP threading hooks, implemented by the MPEG-1/2 video encoder */
+void ff_MPV_encode_gop_start(AVCodecContext *avctx, AVCodecContext *parent,
+                             int picture_number, int nb_frames,
+                             int64_t prev_pts, int frames_in_flight);
+void ff_MPV_encode_gop_feedback(AVCodecContext *parent, int size);
+
@@ -51,11 +51,30 @@
 #define UNCHECKED_BITSTREAM_READER !CONFIG_SAFE_BITSTREAM_READER
 #endif
 
+/*
+ * Cached bitstream reading:
+ * a decoder can "#define CACHED_BITSTREAM_READER 1" before including this
+ * header to read through a 64-bit cache that is refilled 32 bits at a time
+ * when it runs low, instead of loading the bitstream again for every read.
+ * The cached state is not understood by the default reader, so all code
+ * reading from one GetBitContext must be built with the same setting.
+ * Only the big-endian reader supports it.
+ */
+#ifndef CACHED_BITSTREAM_READER
+#define CACHED_BITSTREAM_READER 0
+#endif
+
+#if CACHED_BITSTREAM_READER && defined(BITSTREAM_READER_LE)
+#error "the cached bitstream reader does not support little-endian bitstreams"
+#endif
+
 typedef struct GetBitContext {
     const uint8_t *buffer, *buffer_end;
-    int index;
+    int index;              ///< bit position, or end of the cache for the cached reader
     int size_in_bits;
     int size_in_bits_plus8;
+    uint64_t cache;         ///< cached bits, MSB first (cached reader only)
+    unsigned bits_left;     ///< number of valid bits in cache (cached reader only)
 } GetBitContext;
 
 #define VLC_TYPE int16_t
@@ -116,12 +135,65 @@ typedef struct RL_VLC_ELEM {
  * For examples see get_bits, show_bits, skip_bits, get_vlc.
  */
 
-#ifdef LONG_BITSTREAM_READER
+#if defined(LONG_BITSTREAM_READER) || CACHED_BITSTREAM_READER
 #   define MIN_CACHE_BITS 32
 #else
 #   define MIN_CACHE_BITS 25
 #endif
 
+#if CACHED_BITSTREAM_READER
+
+static inline void refill_32(GetBitContext *s)
+{
+    av_assert2(s->bits_left <= 32);
+#if !UNCHECKED_BITSTREAM_READER
+    /* past the end of the buffer, zeros are shifted in */
+    if (s->index >> 3 < s->buffer_end - s->buffer)
+#endif
+        s->cache |= (uint64_t)AV_RB32(s->buffer + (s->index >> 3)) << (32 - s->bits_left);
+    s->index     += 32;
+    s->bits_left += 32;
+}
+
+/* The local reader names all refer to the cache in the context. A skip must
+ * not exceed the number of bits guaranteed by the last UPDATE_CACHE. */
+#define OPEN_READER(name, gb) av_unused GetBitContext *const name ## _gb = (gb)
+
+#define CLOSE_READER(name, gb) do { } while (0)
+
+#if UNCHECKED_BITSTREAM_READER
+#define HAVE_BITS_REMAINING(name, gb) 1
+#else
+#define HAVE_BITS_REMAINING(name, gb) \
+    (get_bits_count(gb) < (gb)->size_in_bits_plus8)
+#endif
+
+#define UPDATE_CACHE(name, gb)                  \
+    do {                                        \
+        if ((gb)->bits_left < 32)               \
+            refill_32(gb);                      \
+    } while (0)
+
+#define SKIP_CACHE(name, gb, num)               \
+    do {                                        \
+        av_assert2((num) <= (gb)->bits_left);   \
+        (gb)->cache    <<= (num);               \
+        (gb)->bits_left -= (num);               \
+    } while (0)
+
+#define SKIP_COUNTER(name, gb, num) do { } while (0)
+
+#define SKIP_BITS(name, gb, num) SKIP_CACHE(name, gb, num)
+
+#define LAST_SKIP_BITS(name, gb, num) SKIP_CACHE(name, gb, num)
+
+#define SHOW_UBITS(name, gb, num) ((uint32_t)((gb)->cache >> (64 - (num))))
+#define SHOW_SBITS(name, gb, num) ((int32_t)((int64_t)(gb)->cache >> (64 - (num))))
+
+#define GET_CACHE(name, gb) ((uint32_t)((gb)->cache >> 32))
+
+#else /* CACHED_BITSTREAM_READER */
+
 #if UNCHECKED_BITSTREAM_READER
 #define OPEN_READER(name, gb)                   \
     unsigned int name ## _index = (gb)->index;  \
@@ -190,6 +262,33 @@ typedef struct RL_VLC_ELEM {
 
 #define GET_CACHE(name, gb) ((uint32_t) name ## _cache)
 
+#endif /* CACHED_BITSTREAM_READER */
+
+#if CACHED_BITSTREAM_READER
+static inline int get_bits_count(const GetBitContext *s)
+{
+    return s->index - (int)s->bits_left;
+}
+
+static inline void skip_bits_long(GetBitContext *s, int n)
+{
+    if (n >= 0 && n <= s->bits_left) {
+        s->cache    <<= n;
+        s->bits_left -= n;
+    } else {
+        int pos = get_bits_count(s) + n;
+#if !UNCHECKED_BITSTREAM_READER
+        pos = av_clip(pos, 0, s->size_in_bits_plus8);
+#endif
+        s->index     = pos & ~7;
+        s->cache     = 0;
+        s->bits_left = 0;
+        refill_32(s);
+        s->cache    <<= pos & 7;
+        s->bits_left -= pos & 7;
+    }
+}
+#else
 static inline int get_bits_count(const GetBitContext *s)
 {
     return s->index;
@@ -203,7 +302,100 @@ static inline void skip_bits_long(GetBitContext *s, int n)
     s->index += av_clip(n, -s->index, s->size_in_bits_plus8 - s->index);
 #endif
 }
+#endif
 
+#if CACHED_BITSTREAM_READER
+/**
+ * read mpeg1 dc style vlc (sign bit + mantisse with no MSB).
+ * if MSB not set it is negative
+ * @param n length in bits
+ */
+static inline int get_xbits(GetBitContext *s, int n)
+{
+    register int sign;
+    register int32_t cache;
+    av_assert2(n>0 && n<=25);
+    if (n > s->bits_left)
+        refill_32(s);
+    cache = s->cache >> 32;
+    sign  = ~cache >> 31;
+    s->cache    <<= n;
+    s->bits_left -= n;
+    return (NEG_USR32(sign ^ cache, n) ^ sign) - sign;
+}
+
+static inline int get_sbits(GetBitContext *s, int n)
+{
+    register int tmp;
+    av_assert2(n>0 && n<=25);
+    if (n > s->bits_left)
+        refill_32(s);
+    tmp = (int64_t)s->cache >> (64 - n);
+    s->cache    <<= n;
+    s->bits_left -= n;
+    return tmp;
+}
+
+/**
+ * Read 1-32 bits.
+ */
+static inline unsigned int get_bits(GetBitContext *s, int n)
+{
+    register unsigned int tmp;
+    av_assert2(n>0 && n<=32);
+    if (n > s->bits_left)
+        refill_32(s);
+    tmp = s->cache >> (64 - n);
+    s->cache    <<= n;
+    s->bits_left -= n;
+    return tmp;
+}
+
+/**
+ * Show 1-32 bits.
+ */
+static inline unsigned int show_bits(GetBitContext *s, int n)
+{
+    av_assert2(n>0 && n<=32);
+    if (n > s->bits_left)
+        refill_32(s);
+    return s->cache >> (64 - n);
+}
+
+static inline void skip_bits(GetBitContext *s, int n)
+{
+    skip_bits_long(s, n);
+}
+
+static inline unsigned int get_bits1(GetBitContext *s)
+{
+    unsigned int result;
+    if (!s->bits_left)
+        refill_32(s);
+    result = s->cache >> 63;
+    s->cache  <<= 1;
+    s->bits_left--;
+    return result;
+}
+
+static inline unsigned int show_bits1(GetBitContext *s)
+{
+    return show_bits(s, 1);
+}
+
+static inline void skip_bits1(GetBitContext *s)
+{
+    skip_bits(s, 1);
+}
+
+/**
+ * Read 0-32 bits.
+ */
+static inline unsigned int get_bits_long(GetBitContext *s, int n)
+{
+    return n ? get_bits(s, n) : 0;
+}
+#else
 /**
  * read mpeg1 dc style vlc (sign bit + mantisse with no MSB).
  * if MSB not set it is negative
@@ -319,6 +511,7 @@ static inline unsigned int get_bits_long(GetBitContext *s, int n)
 #endif
     }
 }
+#endif /* CACHED_BITSTREAM_READER */
 
 /**
  * Read 0-64 bits.
@@ -395,6 +588,8 @@ static inline int init_get_bits(GetBitContext *s, const uint8_t *buffer,
     s->size_in_bits_plus8 = bit_size + 8;
     s->buffer_end         = buffer + buffer_size;
     s->index              = 0;
+    s->cache              = 0;
+    s->bits_left          = 0;
 
     return ret;
 }
@@ -420,7 +615,7 @@ static inline const uint8_t *align_get_bits(GetBitContext *s)
     int n = -get_bits_count(s) & 7;
     if (n)
         skip_bits(s, n);
-    return s->buffer + (s->index >> 3);
+    return s->buffer + (get_bits_count(s) >> 3);
 }
 
 #define init_vlc(vlc, nb_bits, nb_codes,                \
@@ -439,6 +634,27 @@ int ff_init_vlc_sparse(VLC *vlc, int nb_bits, int nb_codes,
                        int flags);
 void ff_free_vlc(VLC *vlc);
 
+#define init_vlc_shared(vlc, nb_bits, nb_codes,         \
+                        bits, bits_wrap, bits_size,     \
+                        codes, codes_wrap, codes_size)  \
+    ff_init_vlc_shared(vlc, nb_bits, nb_codes,          \
+                       bits, bits_wrap, bits_size,      \
+                       codes, codes_wrap, codes_size,   \
+                       NULL, 0, 0, 0)
+
+/**
+ * Build a VLC like ff_init_vlc_sparse(), but share its table with every
+ * other VLC built from the same codes, in this or any other context.
+ * The table must not be modified and has to be released with
+ * ff_free_vlc_shared().
+ */
+int ff_init_vlc_shared(VLC *vlc, int nb_bits, int nb_codes,
+                       const void *bits, int bits_wrap, int bits_size,
+                       const void *codes, int codes_wrap, int codes_size,
+                       const void *symbols, int symbols_wrap, int symbols_size,
+                       int flags);
+void ff_free_vlc_shared(VLC *vlc);
+
 #define INIT_VLC_LE             2
 #define INIT_VLC_USE_NEW_STATIC 4
 
@@ -311,7 +311,11 @@ static inline int get_ur_golomb_jpegls(GetBitContext *gb, int k, int limit, int
     }else{
         int i;
         for (i = 0; i < limit && SHOW_UBITS(re, gb, 1) == 0; i++) {
+#if CACHED_BITSTREAM_READER
+            if (gb->size_in_bits <= get_bits_count(gb))
+#else
             if (gb->size_in_bits <= re_index)
+#endif
                 return -1;
             LAST_SKIP_BITS(re, gb, 1);
             UPDATE_CACHE(re, gb);
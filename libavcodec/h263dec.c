@@ -649,7 +649,7 @@ retry:
     if ((ret = ff_MPV_frame_start(s, avctx)) < 0)
         return ret;
 
-    if (!s->divx_packed && !avctx->hwaccel)
+    if (!s->divx_packed)
         ff_thread_finish_setup(avctx);
 
     if (CONFIG_MPEG4_VDPAU_DECODER && (s->avctx->codec->capabilities & CODEC_CAP_HWACCEL_VDPAU)) {
@@ -658,6 +658,7 @@ retry:
     }
 
     if (avctx->hwaccel) {
+        ff_thread_hwaccel_lock(avctx);
         if ((ret = avctx->hwaccel->start_frame(avctx, s->gb.buffer, s->gb.buffer_end - s->gb.buffer)) < 0)
             return ret;
     }
@@ -739,9 +740,6 @@ intrax8_decoded:
 
     ff_MPV_frame_end(s);
 
-    if (!s->divx_packed && avctx->hwaccel)
-        ff_thread_finish_setup(avctx);
-
     av_assert1(s->current_picture.f.pict_type == s->current_picture_ptr->f.pict_type);
     av_assert1(s->current_picture.f.pict_type == s->pict_type);
     if (s->pict_type == AV_PICTURE_TYPE_B || s->low_delay) {
@@ -188,6 +188,30 @@ void ff_h264_draw_horiz_band(H264Context *h, int y, int height)
     }
 }
 
+/**
+ * Report that the lines up to y of a picture are complete, to the other frame
+ * threads unless the picture is droppable, and to the user.
+ */
+static void report_progress(H264Context *h, Picture *pic, int y,
+                            int picture_structure, int droppable)
+{
+    AVCodecContext *avctx = h->avctx;
+    int field = picture_structure == PICT_BOTTOM_FIELD;
+
+    if (!droppable)
+        ff_thread_report_progress(&pic->tf, y, field);
+
+    if (avctx->decode_progress) {
+        int pic_height = pic->f.height >> (picture_structure != PICT_FRAME);
+        int lines      = y >= pic_height - 1 ? pic_height : y + 1;
+
+        if (lines > 0) {
+            emms_c();
+            avctx->decode_progress(avctx, &pic->f, lines, field);
+        }
+    }
+}
+
 static void unref_picture(H264Context *h, Picture *pic)
 {
     int off = offsetof(Picture, tf) + sizeof(pic->tf);
@@ -1168,17 +1192,17 @@ static void free_tables(H264Context *h, int free_rbsp)
     }
 }
 
-static void init_dequant8_coeff_table(H264Context *h)
+static void init_dequant8_coeff_table(H264Context *h, H264DequantTables *t)
 {
     int i, j, q, x;
     const int max_qp = 51 + 6 * (h->sps.bit_depth_luma - 8);
 
     for (i = 0; i < 6; i++) {
-        h->dequant8_coeff[i] = h->dequant8_buffer[i];
+        h->dequant8_coeff[i] = t->dequant8[i];
         for (j = 0; j < i; j++)
             if (!memcmp(h->pps.scaling_matrix8[j], h->pps.scaling_matrix8[i],
                         64 * sizeof(uint8_t))) {
-                h->dequant8_coeff[i] = h->dequant8_buffer[j];
+                h->dequant8_coeff[i] = t->dequant8[j];
                 break;
             }
         if (j < i)
@@ -1195,16 +1219,16 @@ static void init_dequant8_coeff_table(H264Context *h)
     }
 }
 
-static void init_dequant4_coeff_table(H264Context *h)
+static void init_dequant4_coeff_table(H264Context *h, H264DequantTables *t)
 {
     int i, j, q, x;
     const int max_qp = 51 + 6 * (h->sps.bit_depth_luma - 8);
     for (i = 0; i < 6; i++) {
-        h->dequant4_coeff[i] = h->dequant4_buffer[i];
+        h->dequant4_coeff[i] = t->dequant4[i];
         for (j = 0; j < i; j++)
             if (!memcmp(h->pps.scaling_matrix4[j], h->pps.scaling_matrix4[i],
                         16 * sizeof(uint8_t))) {
-                h->dequant4_coeff[i] = h->dequant4_buffer[j];
+                h->dequant4_coeff[i] = t->dequant4[j];
                 break;
             }
         if (j < i)
@@ -1221,12 +1245,29 @@ static void init_dequant4_coeff_table(H264Context *h)
     }
 }
 
-static void init_dequant_tables(H264Context *h)
+static int init_dequant_tables(H264Context *h)
 {
+    H264DequantTables *t;
     int i, x;
-    init_dequant4_coeff_table(h);
+
+    /* Other frame threads may still use the current tables. */
+    if (!h->dequant_buf || !av_buffer_is_writable(h->dequant_buf)) {
+        av_buffer_unref(&h->dequant_buf);
+        h->dequant_buf = av_buffer_alloc(sizeof(H264DequantTables));
+        if (!h->dequant_buf) {
+            memset(h->dequant4_coeff, 0, sizeof(h->dequant4_coeff));
+            memset(h->dequant8_coeff, 0, sizeof(h->dequant8_coeff));
+            return AVERROR(ENOMEM);
+        }
+    }
+
+    t = (H264DequantTables *)h->dequant_buf->data;
+    init_dequant4_coeff_table(h, t);
     if (h->pps.transform_8x8_mode)
-        init_dequant8_coeff_table(h);
+        init_dequant8_coeff_table(h, t);
+    else
+        for (i = 0; i < 6; i++)
+            h->dequant8_coeff[i] = t->dequant8[i];
     if (h->sps.transform_bypass) {
         for (i = 0; i < 6; i++)
             for (x = 0; x < 16; x++)
@@ -1236,6 +1277,7 @@ static void init_dequant_tables(H264Context *h)
                 for (x = 0; x < 64; x++)
                     h->dequant8_coeff[i][0][x] = 1 << 6;
     }
+    return 0;
 }
 
 int ff_h264_alloc_tables(H264Context *h)
@@ -1280,8 +1322,8 @@ int ff_h264_alloc_tables(H264Context *h)
             h->mb2br_xy[mb_xy] = 8 * (FMO ? mb_xy : (mb_xy % (2 * h->mb_stride)));
         }
 
-    if (!h->dequant4_coeff[0])
-        init_dequant_tables(h);
+    if (!h->dequant4_coeff[0] && init_dequant_tables(h) < 0)
+        goto fail;
 
     if (!h->DPB) {
         h->DPB = av_mallocz_array(MAX_PICTURE_COUNT, sizeof(*h->DPB));
@@ -1563,19 +1605,30 @@ static void copy_picture_range(Picture **to, Picture **from, int count,
     }
 }
 
-static void copy_parameter_set(void **to, void **from, int count, int size)
+/**
+ * Make the parameter sets of a thread reference those of another one.
+ * Once parsed, parameter sets are only read (SPS.new is cleared before
+ * ff_thread_finish_setup()), so they are shared instead of copied.
+ */
+static int copy_parameter_set(void **to, AVBufferRef **to_refs,
+                              AVBufferRef * const *from_refs, int count)
 {
     int i;
 
     for (i = 0; i < count; i++) {
-        if (to[i] && !from[i])
-            av_freep(&to[i]);
-        else if (from[i] && !to[i])
-            to[i] = av_malloc(size);
+        if (to_refs[i] == from_refs[i])
+            continue;
 
-        if (from[i])
-            memcpy(to[i], from[i], size);
+        av_buffer_unref(&to_refs[i]);
+        to[i] = NULL;
+        if (from_refs[i]) {
+            to_refs[i] = av_buffer_ref(from_refs[i]);
+            if (!to_refs[i])
+                return AVERROR(ENOMEM);
+            to[i] = to_refs[i]->data;
+        }
     }
+    return 0;
 }
 
 static int decode_init_thread_copy(AVCodecContext *avctx)
@@ -1586,6 +1639,9 @@ static int decode_init_thread_copy(AVCodecContext *avctx)
         return 0;
     memset(h->sps_buffers, 0, sizeof(h->sps_buffers));
     memset(h->pps_buffers, 0, sizeof(h->pps_buffers));
+    memset(h->sps_refs, 0, sizeof(h->sps_refs));
+    memset(h->pps_refs, 0, sizeof(h->pps_refs));
+    h->dequant_buf = NULL;
 
     h->context_initialized = 0;
 
@@ -1597,6 +1653,7 @@ static int decode_init_thread_copy(AVCodecContext *avctx)
            (char *)&to->end_field - (char *)&to->start_field)
 
 static int h264_slice_header_init(H264Context *, int);
+static int init_slice_contexts(H264Context *);
 
 static int h264_set_parameter_from_sps(H264Context *h);
 
@@ -1635,11 +1692,13 @@ static int decode_update_thread_context(AVCodecContext *dst,
         h->mb_stride = h1->mb_stride;
         h->b_stride  = h1->b_stride;
         // SPS/PPS
-        copy_parameter_set((void **)h->sps_buffers, (void **)h1->sps_buffers,
-                        MAX_SPS_COUNT, sizeof(SPS));
+        if ((ret = copy_parameter_set((void **)h->sps_buffers, h->sps_refs,
+                                      h1->sps_refs, MAX_SPS_COUNT)) < 0)
+            return ret;
         h->sps = h1->sps;
-        copy_parameter_set((void **)h->pps_buffers, (void **)h1->pps_buffers,
-                        MAX_PPS_COUNT, sizeof(PPS));
+        if ((ret = copy_parameter_set((void **)h->pps_buffers, h->pps_refs,
+                                      h1->pps_refs, MAX_PPS_COUNT)) < 0)
+            return ret;
         h->pps = h1->pps;
 
         if ((err = h264_slice_header_init(h, 1)) < 0) {
@@ -1664,18 +1723,27 @@ static int decode_update_thread_context(AVCodecContext *dst,
 
     if (!inited) {
         for (i = 0; i < MAX_SPS_COUNT; i++)
-            av_freep(h->sps_buffers + i);
+            av_buffer_unref(&h->sps_refs[i]);
 
         for (i = 0; i < MAX_PPS_COUNT; i++)
-            av_freep(h->pps_buffers + i);
+            av_buffer_unref(&h->pps_refs[i]);
+
+        av_buffer_unref(&h->dequant_buf);
 
         memcpy(h, h1, offsetof(H264Context, intra_pcm_ptr));
         memcpy(&h->cabac, &h1->cabac,
                sizeof(H264Context) - offsetof(H264Context, cabac));
         av_assert0((void*)&h->cabac == &h->mb_padding + 1);
 
+        /* the references to the shared state are taken below */
         memset(h->sps_buffers, 0, sizeof(h->sps_buffers));
         memset(h->pps_buffers, 0, sizeof(h->pps_buffers));
+        memset(h->sps_refs, 0, sizeof(h->sps_refs));
+        memset(h->pps_refs, 0, sizeof(h->pps_refs));
+        h->dequant_buf = NULL;
+        /* slice threading contexts are private to each frame thread */
+        memset(&h->thread_context[1], 0,
+               sizeof(h->thread_context) - sizeof(h->thread_context[0]));
 
         memset(&h->er, 0, sizeof(h->er));
         memset(&h->me, 0, sizeof(h->me));
@@ -1702,6 +1770,9 @@ static int decode_update_thread_context(AVCodecContext *dst,
             return AVERROR(ENOMEM);
         }
         context_init(h);
+        if (HAVE_THREADS && dst->active_thread_type & FF_THREAD_SLICE &&
+            (ret = init_slice_contexts(h)) < 0)
+            return ret;
         }
 
         for (i = 0; i < 2; i++) {
@@ -1747,24 +1818,26 @@ static int decode_update_thread_context(AVCodecContext *dst,
     h->is_avc = h1->is_avc;
 
     // SPS/PPS
-    copy_parameter_set((void **)h->sps_buffers, (void **)h1->sps_buffers,
-                       MAX_SPS_COUNT, sizeof(SPS));
+    if ((ret = copy_parameter_set((void **)h->sps_buffers, h->sps_refs,
+                                  h1->sps_refs, MAX_SPS_COUNT)) < 0)
+        return ret;
     h->sps = h1->sps;
-    copy_parameter_set((void **)h->pps_buffers, (void **)h1->pps_buffers,
-                       MAX_PPS_COUNT, sizeof(PPS));
+    if ((ret = copy_parameter_set((void **)h->pps_buffers, h->pps_refs,
+                                  h1->pps_refs, MAX_PPS_COUNT)) < 0)
+        return ret;
     h->pps = h1->pps;
 
-    // Dequantization matrices
-    // FIXME these are big - can they be only copied when PPS changes?
-    copy_fields(h, h1, dequant4_buffer, dequant4_coeff);
-
-    for (i = 0; i < 6; i++)
-        h->dequant4_coeff[i] = h->dequant4_buffer[0] +
-                               (h1->dequant4_coeff[i] - h1->dequant4_buffer[0]);
-
-    for (i = 0; i < 6; i++)
-        h->dequant8_coeff[i] = h->dequant8_buffer[0] +
-                               (h1->dequant8_coeff[i] - h1->dequant8_buffer[0]);
+    // Dequantization matrices, shared with the source thread
+    if (h->dequant_buf != h1->dequant_buf) {
+        av_buffer_unref(&h->dequant_buf);
+        if (h1->dequant_buf) {
+            h->dequant_buf = av_buffer_ref(h1->dequant_buf);
+            if (!h->dequant_buf)
+                return AVERROR(ENOMEM);
+        }
+    }
+    memcpy(h->dequant4_coeff, h1->dequant4_coeff, sizeof(h->dequant4_coeff));
+    memcpy(h->dequant8_coeff, h1->dequant8_coeff, sizeof(h->dequant8_coeff));
 
     h->dequant_coeff_pps = h1->dequant_coeff_pps;
 
@@ -2070,7 +2143,7 @@ static void decode_postinit(H264Context *h, int setup_finished)
         h->sync |= 2;
     }
 
-    if (setup_finished && !h->avctx->hwaccel)
+    if (setup_finished)
         ff_thread_finish_setup(h->avctx);
 }
 
@@ -2830,6 +2903,7 @@ static int field_end(H264Context *h, int in_setup)
     }
 
     if (avctx->hwaccel) {
+        ff_thread_hwaccel_lock(avctx);
         if (avctx->hwaccel->end_frame(avctx) < 0)
             av_log(avctx, AV_LOG_ERROR,
                    "hardware accelerator failed to decode picture\n");
@@ -2856,9 +2930,9 @@ static int field_end(H264Context *h, int in_setup)
         h->er.cur_pic  = h->cur_pic_ptr;
         ff_er_frame_end(&h->er);
     }
-    if (!in_setup && !h->droppable)
-        ff_thread_report_progress(&h->cur_pic_ptr->tf, INT_MAX,
-                                  h->picture_structure == PICT_BOTTOM_FIELD);
+    if (!in_setup)
+        report_progress(h, h->cur_pic_ptr, INT_MAX,
+                        h->picture_structure, h->droppable);
     emms_c();
 
     h->current_slice = 0;
@@ -3095,12 +3169,66 @@ static int init_dimensions(H264Context *h)
     return 0;
 }
 
+/**
+ * Allocate the slice threading contexts 1..slice_context_count-1 of h and
+ * the buffers which are not shared between them.
+ */
+static int init_slice_contexts(H264Context *h)
+{
+    int i;
+
+    for (i = 1; i < h->slice_context_count; i++) {
+        H264Context *c;
+        c = h->thread_context[i] = av_mallocz(sizeof(H264Context));
+        if (!c)
+            return AVERROR(ENOMEM);
+        c->avctx       = h->avctx;
+        if (CONFIG_ERROR_RESILIENCE) {
+            c->dsp         = h->dsp;
+        }
+        c->vdsp        = h->vdsp;
+        c->h264dsp     = h->h264dsp;
+        c->h264qpel    = h->h264qpel;
+        c->h264chroma  = h->h264chroma;
+        c->sps         = h->sps;
+        c->pps         = h->pps;
+        c->pixel_shift = h->pixel_shift;
+        c->cur_chroma_format_idc = h->cur_chroma_format_idc;
+        c->width       = h->width;
+        c->height      = h->height;
+        c->linesize    = h->linesize;
+        c->uvlinesize  = h->uvlinesize;
+        c->chroma_x_shift = h->chroma_x_shift;
+        c->chroma_y_shift = h->chroma_y_shift;
+        c->qscale      = h->qscale;
+        c->droppable   = h->droppable;
+        c->data_partitioning = h->data_partitioning;
+        c->low_delay   = h->low_delay;
+        c->mb_width    = h->mb_width;
+        c->mb_height   = h->mb_height;
+        c->mb_stride   = h->mb_stride;
+        c->mb_num      = h->mb_num;
+        c->flags       = h->flags;
+        c->workaround_bugs = h->workaround_bugs;
+        c->pict_type   = h->pict_type;
+
+        init_scan_tables(c);
+        clone_tables(c, h, i);
+        c->context_initialized = 1;
+    }
+
+    for (i = 1; i < h->slice_context_count; i++)
+        if (context_init(h->thread_context[i]) < 0)
+            return -1;
+
+    return 0;
+}
+
 static int h264_slice_header_init(H264Context *h, int reinit)
 {
     int nb_slices = (HAVE_THREADS &&
                      h->avctx->active_thread_type & FF_THREAD_SLICE) ?
                     h->avctx->thread_count : 1;
-    int i;
 
     h->avctx->sample_aspect_ratio = h->sps.sar;
     av_assert0(h->avctx->sample_aspect_ratio.den);
@@ -3141,55 +3269,15 @@ static int h264_slice_header_init(H264Context *h, int reinit)
     }
     h->slice_context_count = nb_slices;
 
-    if (!HAVE_THREADS || !(h->avctx->active_thread_type & FF_THREAD_SLICE)) {
-        if (context_init(h) < 0) {
-            av_log(h->avctx, AV_LOG_ERROR, "context_init() failed.\n");
-            return -1;
-        }
-    } else {
-        for (i = 1; i < h->slice_context_count; i++) {
-            H264Context *c;
-            c = h->thread_context[i] = av_mallocz(sizeof(H264Context));
-            c->avctx       = h->avctx;
-            if (CONFIG_ERROR_RESILIENCE) {
-                c->dsp         = h->dsp;
-            }
-            c->vdsp        = h->vdsp;
-            c->h264dsp     = h->h264dsp;
-            c->h264qpel    = h->h264qpel;
-            c->h264chroma  = h->h264chroma;
-            c->sps         = h->sps;
-            c->pps         = h->pps;
-            c->pixel_shift = h->pixel_shift;
-            c->cur_chroma_format_idc = h->cur_chroma_format_idc;
-            c->width       = h->width;
-            c->height      = h->height;
-            c->linesize    = h->linesize;
-            c->uvlinesize  = h->uvlinesize;
-            c->chroma_x_shift = h->chroma_x_shift;
-            c->chroma_y_shift = h->chroma_y_shift;
-            c->qscale      = h->qscale;
-            c->droppable   = h->droppable;
-            c->data_partitioning = h->data_partitioning;
-            c->low_delay   = h->low_delay;
-            c->mb_width    = h->mb_width;
-            c->mb_height   = h->mb_height;
-            c->mb_stride   = h->mb_stride;
-            c->mb_num      = h->mb_num;
-            c->flags       = h->flags;
-            c->workaround_bugs = h->workaround_bugs;
-            c->pict_type   = h->pict_type;
-
-            init_scan_tables(c);
-            clone_tables(c, h, i);
-            c->context_initialized = 1;
-        }
+    if (context_init(h) < 0) {
+        av_log(h->avctx, AV_LOG_ERROR, "context_init() failed.\n");
+        return -1;
+    }
 
-        for (i = 0; i < h->slice_context_count; i++)
-            if (context_init(h->thread_context[i]) < 0) {
-                av_log(h->avctx, AV_LOG_ERROR, "context_init() failed.\n");
-                return -1;
-            }
+    if (HAVE_THREADS && h->avctx->active_thread_type & FF_THREAD_SLICE &&
+        init_slice_contexts(h) < 0) {
+        av_log(h->avctx, AV_LOG_ERROR, "context_init() failed.\n");
+        return -1;
     }
 
     h->context_initialized = 1;
@@ -3229,10 +3317,9 @@ static int decode_slice_header(H264Context *h, H264Context *h0)
 
         h0->current_slice = 0;
         if (!h0->first_field) {
-            if (h->cur_pic_ptr && !h->droppable) {
-                ff_thread_report_progress(&h->cur_pic_ptr->tf, INT_MAX,
-                                          h->picture_structure == PICT_BOTTOM_FIELD);
-            }
+            if (h->cur_pic_ptr)
+                report_progress(h, h->cur_pic_ptr, INT_MAX,
+                                h->picture_structure, h->droppable);
             h->cur_pic_ptr = NULL;
         }
     }
@@ -3392,7 +3479,10 @@ static int decode_slice_header(H264Context *h, H264Context *h0)
 
     if (h == h0 && h->dequant_coeff_pps != pps_id) {
         h->dequant_coeff_pps = pps_id;
-        init_dequant_tables(h);
+        if ((ret = init_dequant_tables(h)) < 0) {
+            h->dequant_coeff_pps = -1;
+            return ret;
+        }
     }
 
     h->frame_num = get_bits(&h->gb, h->sps.log2_max_frame_num);
@@ -3463,10 +3553,9 @@ static int decode_slice_header(H264Context *h, H264Context *h0)
             assert(h0->cur_pic_ptr->reference != DELAYED_PIC_REF);
 
             /* Mark old field/frame as completed */
-            if (!last_pic_droppable && h0->cur_pic_ptr->tf.owner == h0->avctx) {
-                ff_thread_report_progress(&h0->cur_pic_ptr->tf, INT_MAX,
-                                          last_pic_structure == PICT_BOTTOM_FIELD);
-            }
+            if (h0->cur_pic_ptr->tf.owner == h0->avctx)
+                report_progress(h0, h0->cur_pic_ptr, INT_MAX,
+                                last_pic_structure, last_pic_droppable);
 
             /* figure out if we have a complementary field pair */
             if (!FIELD_PICTURE(h) || h->picture_structure == last_pic_structure) {
@@ -4256,11 +4345,17 @@ static void decode_finish_row(H264Context *h)
 
     ff_h264_draw_horiz_band(h, top, height);
 
-    if (h->droppable || h->er.error_occurred)
+    if (h->er.error_occurred ||
+        (h->droppable && !h->avctx->decode_progress))
         return;
 
-    ff_thread_report_progress(&h->cur_pic_ptr->tf, top + height - 1,
-                              h->picture_structure == PICT_BOTTOM_FIELD);
+    if (h->defer_progress) {
+        h->deferred_progress = top + height - 1;
+        return;
+    }
+
+    report_progress(h, h->cur_pic_ptr, top + height - 1,
+                    h->picture_structure, h->droppable);
 }
 
 static void er_add_slice(H264Context *h, int startx, int starty,
@@ -4474,11 +4569,23 @@ static int execute_decode_slices(H264Context *h, int context_count)
                 hx->er.error_count = 0;
             }
             hx->x264_build        = h->x264_build;
+            /* rows of later slices may finish before the ones above them */
+            hx->defer_progress    = HAVE_THREADS &&
+                                    (avctx->active_thread_type & FF_THREAD_FRAME ||
+                                     avctx->decode_progress);
+            hx->deferred_progress = -1;
         }
 
         avctx->execute(avctx, decode_slice, h->thread_context,
                        NULL, context_count, sizeof(void *));
 
+        for (i = 1; i < context_count; i++) {
+            hx = h->thread_context[i];
+            if (hx->deferred_progress >= 0)
+                report_progress(hx, hx->cur_pic_ptr, hx->deferred_progress,
+                                hx->picture_structure, hx->droppable);
+        }
+
         /* pull back stuff from slices to master context */
         hx                   = h->thread_context[context_count - 1];
         h->mb_x              = hx->mb_x;
@@ -4705,9 +4812,11 @@ again:
                     if (!(avctx->flags2 & CODEC_FLAG2_CHUNKS))
                         decode_postinit(h, nal_index >= nals_needed);
 
-                    if (h->avctx->hwaccel &&
-                        h->avctx->hwaccel->start_frame(h->avctx, NULL, 0) < 0)
-                        return -1;
+                    if (h->avctx->hwaccel) {
+                        ff_thread_hwaccel_lock(h->avctx);
+                        if (h->avctx->hwaccel->start_frame(h->avctx, NULL, 0) < 0)
+                            return -1;
+                    }
                     if (CONFIG_H264_VDPAU_DECODER &&
                         h->avctx->codec->capabilities & CODEC_CAP_HWACCEL_VDPAU)
                         ff_vdpau_h264_picture_start(h);
@@ -4832,10 +4941,9 @@ again:
 
 end:
     /* clean up */
-    if (h->cur_pic_ptr && !h->droppable) {
-        ff_thread_report_progress(&h->cur_pic_ptr->tf, INT_MAX,
-                                  h->picture_structure == PICT_BOTTOM_FIELD);
-    }
+    if (h->cur_pic_ptr)
+        report_progress(h, h->cur_pic_ptr, INT_MAX,
+                        h->picture_structure, h->droppable);
 
     return buf_index;
 }
@@ -4994,11 +5102,17 @@ av_cold void ff_h264_free_context(H264Context *h)
 
     free_tables(h, 1); // FIXME cleanup init stuff perhaps
 
-    for (i = 0; i < MAX_SPS_COUNT; i++)
-        av_freep(h->sps_buffers + i);
+    for (i = 0; i < MAX_SPS_COUNT; i++) {
+        av_buffer_unref(&h->sps_refs[i]);
+        h->sps_buffers[i] = NULL;
+    }
+
+    for (i = 0; i < MAX_PPS_COUNT; i++) {
+        av_buffer_unref(&h->pps_refs[i]);
+        h->pps_buffers[i] = NULL;
+    }
 
-    for (i = 0; i < MAX_PPS_COUNT; i++)
-        av_freep(h->pps_buffers + i);
+    av_buffer_unref(&h->dequant_buf);
 }
 
 static av_cold int h264_decode_end(AVCodecContext *avctx)
@@ -5061,6 +5175,7 @@ AVCodec ff_h264_decoder = {
     .capabilities          = /*CODEC_CAP_DRAW_HORIZ_BAND |*/ CODEC_CAP_DR1 |
                              CODEC_CAP_DELAY | CODEC_CAP_SLICE_THREADS |
                              CODEC_CAP_FRAME_THREADS,
+    .caps_internal         = FF_CODEC_CAP_INIT_THREADSAFE,
     .flush                 = flush_dpb,
     .long_name             = NULL_IF_CONFIG_SMALL("H.264 / AVC / MPEG-4 AVC / MPEG-4 part 10"),
     .init_thread_copy      = ONLY_IF_THREADS_ENABLED(decode_init_thread_copy),
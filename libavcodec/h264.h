@@ -254,6 +254,14 @@ typedef struct MMCO {
     int long_arg;       ///< index, pic_num, or num long refs depending on opcode
 } MMCO;
 
+/**
+ * Dequantization tables for the scaling matrices of the current PPS.
+ */
+typedef struct H264DequantTables {
+    uint32_t dequant4[6][QP_MAX_NUM + 1][16];
+    uint32_t dequant8[6][QP_MAX_NUM + 1][64];
+} H264DequantTables;
+
 /**
  * H264Context
  */
@@ -364,8 +372,11 @@ typedef struct H264Context {
      */
     PPS pps; // FIXME move to Picture perhaps? (->no) do we need that?
 
-    uint32_t dequant4_buffer[6][QP_MAX_NUM + 1][16]; // FIXME should these be moved down?
-    uint32_t dequant8_buffer[6][QP_MAX_NUM + 1][64];
+    /**
+     * H264DequantTables the dequant*_coeff pointers point into.
+     * Shared between the frame threads until the tables change.
+     */
+    AVBufferRef *dequant_buf;
     uint32_t(*dequant4_coeff[6])[16];
     uint32_t(*dequant8_coeff[6])[64];
 
@@ -494,6 +505,8 @@ typedef struct H264Context {
 
     SPS *sps_buffers[MAX_SPS_COUNT];
     PPS *pps_buffers[MAX_PPS_COUNT];
+    AVBufferRef *sps_refs[MAX_SPS_COUNT]; ///< buffers holding sps_buffers, shared between frame threads
+    AVBufferRef *pps_refs[MAX_PPS_COUNT]; ///< buffers holding pps_buffers, shared between frame threads
 
     int dequant_coeff_pps;      ///< reinit tables when pps changes
 
@@ -571,6 +584,15 @@ typedef struct H264Context {
      */
     int single_decode_warning;
 
+    /**
+     * Set if the decoding progress of this slice context must not be
+     * reported before all slices of the batch are decoded, because it runs
+     * inside a frame thread or the user asked for decode_progress(). The last finished row is stored in
+     * deferred_progress, or -1 if there is none.
+     */
+    int defer_progress;
+    int deferred_progress;
+
     enum AVPictureType pict_type;
 
     int last_slice_type;
@@ -656,6 +678,14 @@ typedef struct H264Context {
     AVBufferPool *ref_index_pool;
 } H264Context;
 
+/**
+ * Private context of the H.264 parser.
+ */
+typedef struct H264ParseContext {
+    ParseContext pc;            ///< first, see PARSER_FLAG_PARSE_CONTEXT
+    H264Context h;
+} H264ParseContext;
+
 extern const uint8_t ff_h264_chroma_qp[7][QP_MAX_NUM + 1]; ///< One chroma qp table for each possible bit depth (8-14).
 extern const uint16_t ff_h264_mb_sizes[4];
 
@@ -31,29 +31,72 @@ typedef struct H264BSFContext {
     int      extradata_parsed;
 } H264BSFContext;
 
-static int alloc_and_copy(uint8_t **poutbuf,          int *poutbuf_size,
-                          const uint8_t *sps_pps, uint32_t sps_pps_size,
-                          const uint8_t *in,      uint32_t in_size) {
-    uint32_t offset = *poutbuf_size;
-    uint8_t nal_header_size = offset ? 3 : 4;
-    void *tmp;
-
-    *poutbuf_size += sps_pps_size+in_size+nal_header_size;
-    tmp = av_realloc(*poutbuf, *poutbuf_size);
-    if (!tmp)
-        return AVERROR(ENOMEM);
-    *poutbuf = tmp;
-    if (sps_pps)
-        memcpy(*poutbuf+offset, sps_pps, sps_pps_size);
-    memcpy(*poutbuf+sps_pps_size+nal_header_size+offset, in, in_size);
-    if (!offset) {
-        AV_WB32(*poutbuf+sps_pps_size, 1);
-    } else {
-        (*poutbuf+offset+sps_pps_size)[0] = (*poutbuf+offset+sps_pps_size)[1] = 0;
-        (*poutbuf+offset+sps_pps_size)[2] = 1;
-    }
+/**
+ * Convert the NAL units of buf to Annex B, prepending the SPS / PPS to the
+ * first IDR NAL unit after a non-IDR picture.
+ * Called once with out set to NULL to get the output size, so that the
+ * output can be allocated once, then again to write it.
+ *
+ * @return the output size, or a negative error code
+ */
+static int convert_units(H264BSFContext *ctx, AVCodecContext *avctx,
+                         uint8_t *out, const uint8_t *buf, int buf_size)
+{
+    const uint8_t *buf_end = buf + buf_size;
+    uint32_t cumul_size = 0;
+    int64_t out_size = 0;
+    int first_idr = ctx->first_idr;
+    int i, nal_size;
+    uint8_t unit_type;
+
+    do {
+        int nal_header_size = out_size ? 3 : 4;
+        int sps_pps_size = 0;
+
+        if (buf + ctx->length_size > buf_end)
+            return AVERROR(EINVAL);
+
+        for (nal_size = 0, i = 0; i<ctx->length_size; i++)
+            nal_size = (nal_size << 8) | buf[i];
+
+        buf += ctx->length_size;
+        unit_type = *buf & 0x1f;
+
+        if (buf + nal_size > buf_end || nal_size < 0)
+            return AVERROR(EINVAL);
+
+        /* prepend only to the first type 5 NAL unit of an IDR picture */
+        if (first_idr && unit_type == 5) {
+            sps_pps_size = avctx->extradata_size;
+            first_idr    = 0;
+        } else if (!first_idr && unit_type == 1) {
+            first_idr = 1;
+        }
+
+        if (out_size + sps_pps_size + nal_header_size + nal_size >
+            INT_MAX - FF_INPUT_BUFFER_PADDING_SIZE)
+            return AVERROR(EINVAL);
+
+        if (out) {
+            uint8_t *p = out + out_size;
+
+            memcpy(p, avctx->extradata, sps_pps_size);
+            p += sps_pps_size;
+            if (nal_header_size == 4)
+                AV_WB32(p, 1);
+            else
+                AV_WB24(p, 1);
+            memcpy(p + nal_header_size, buf, nal_size);
+        }
+        out_size += sps_pps_size + nal_header_size + nal_size;
+
+        buf += nal_size;
+        cumul_size += nal_size + ctx->length_size;
+    } while (cumul_size < buf_size);
 
-    return 0;
+    if (out)
+        ctx->first_idr = first_idr;
+    return out_size;
 }
 
 static int h264_mp4toannexb_filter(AVBitStreamFilterContext *bsfc,
@@ -62,12 +105,7 @@ static int h264_mp4toannexb_filter(AVBitStreamFilterContext *bsfc,
                                    const uint8_t *buf, int      buf_size,
                                    int keyframe) {
     H264BSFContext *ctx = bsfc->priv_data;
-    int i;
-    uint8_t unit_type;
-    int32_t nal_size;
-    uint32_t cumul_size = 0;
-    const uint8_t *buf_end = buf + buf_size;
-    int ret = AVERROR(EINVAL);
+    int ret;
 
     /* nothing to filter */
     if (!avctx->extradata || avctx->extradata_size < 6) {
@@ -137,48 +175,19 @@ pps:
         ctx->extradata_parsed = 1;
     }
 
+    /* the output is written in one go, its size is computed first */
     *poutbuf_size = 0;
     *poutbuf = NULL;
-    do {
-        ret= AVERROR(EINVAL);
-        if (buf + ctx->length_size > buf_end)
-            goto fail;
-
-        for (nal_size = 0, i = 0; i<ctx->length_size; i++)
-            nal_size = (nal_size << 8) | buf[i];
-
-        buf += ctx->length_size;
-        unit_type = *buf & 0x1f;
-
-        if (buf + nal_size > buf_end || nal_size < 0)
-            goto fail;
-
-        /* prepend only to the first type 5 NAL unit of an IDR picture */
-        if (ctx->first_idr && unit_type == 5) {
-            if ((ret=alloc_and_copy(poutbuf, poutbuf_size,
-                               avctx->extradata, avctx->extradata_size,
-                               buf, nal_size)) < 0)
-                goto fail;
-            ctx->first_idr = 0;
-        } else {
-            if ((ret=alloc_and_copy(poutbuf, poutbuf_size,
-                               NULL, 0,
-                               buf, nal_size)) < 0)
-                goto fail;
-            if (!ctx->first_idr && unit_type == 1)
-                ctx->first_idr = 1;
-        }
-
-        buf += nal_size;
-        cumul_size += nal_size + ctx->length_size;
-    } while (cumul_size < buf_size);
+    if ((ret = convert_units(ctx, avctx, NULL, buf, buf_size)) < 0)
+        return ret;
+    *poutbuf = av_malloc(ret + FF_INPUT_BUFFER_PADDING_SIZE);
+    if (!*poutbuf)
+        return AVERROR(ENOMEM);
+    memset(*poutbuf + ret, 0, FF_INPUT_BUFFER_PADDING_SIZE);
+    *poutbuf_size = ret;
+    convert_units(ctx, avctx, *poutbuf, buf, buf_size);
 
     return 1;
-
-fail:
-    av_freep(poutbuf);
-    *poutbuf_size = 0;
-    return ret;
 }
 
 AVBitStreamFilter ff_h264_mp4toannexb_bsf = {
@@ -34,12 +34,13 @@
 #include "internal.h"
 
 
-static int h264_find_frame_end(H264Context *h, const uint8_t *buf,
+static int h264_find_frame_end(H264ParseContext *p, const uint8_t *buf,
                                int buf_size)
 {
+    H264Context *h = &p->h;
     int i, j;
     uint32_t state;
-    ParseContext *pc = &h->parse_context;
+    ParseContext *pc = &p->pc;
     int next_avc= h->is_avc ? 0 : buf_size;
 
 //    mb_addr= pc->mb_addr - 1;
@@ -153,7 +154,8 @@ static inline int parse_nal_units(AVCodecParserContext *s,
                                   AVCodecContext *avctx,
                                   const uint8_t *buf, int buf_size)
 {
-    H264Context *h         = s->priv_data;
+    H264ParseContext *p    = s->priv_data;
+    H264Context *h         = &p->h;
     const uint8_t *buf_end = buf + buf_size;
     unsigned int pps_id;
     unsigned int slice_type;
@@ -366,8 +368,9 @@ static int h264_parse(AVCodecParserContext *s,
                       const uint8_t **poutbuf, int *poutbuf_size,
                       const uint8_t *buf, int buf_size)
 {
-    H264Context *h   = s->priv_data;
-    ParseContext *pc = &h->parse_context;
+    H264ParseContext *p = s->priv_data;
+    H264Context *h      = &p->h;
+    ParseContext *pc    = &p->pc;
     int next;
 
     if (!h->got_first) {
@@ -387,7 +390,7 @@ static int h264_parse(AVCodecParserContext *s,
     if (s->flags & PARSER_FLAG_COMPLETE_FRAMES) {
         next = buf_size;
     } else {
-        next = h264_find_frame_end(h, buf, buf_size);
+        next = h264_find_frame_end(p, buf, buf_size);
 
         if (ff_combine_frame(pc, next, &buf, &buf_size) < 0) {
             *poutbuf      = NULL;
@@ -397,7 +400,7 @@ static int h264_parse(AVCodecParserContext *s,
 
         if (next < 0 && next != END_NOT_FOUND) {
             av_assert1(pc->last_index + next >= 0);
-            h264_find_frame_end(h, &pc->buffer[pc->last_index + next], -next); // update state
+            h264_find_frame_end(p, &pc->buffer[pc->last_index + next], -next); // update state
         }
     }
 
@@ -453,24 +456,25 @@ static int h264_split(AVCodecContext *avctx,
 
 static void close(AVCodecParserContext *s)
 {
-    H264Context *h   = s->priv_data;
-    ParseContext *pc = &h->parse_context;
+    H264ParseContext *p = s->priv_data;
 
-    av_free(pc->buffer);
-    ff_h264_free_context(h);
+    ff_parse_close(s);
+    ff_h264_free_context(&p->h);
 }
 
 static av_cold int init(AVCodecParserContext *s)
 {
-    H264Context *h = s->priv_data;
+    H264ParseContext *p = s->priv_data;
+    H264Context *h      = &p->h;
     h->thread_context[0]   = h;
     h->slice_context_count = 1;
+    s->flags |= PARSER_FLAG_PARSE_CONTEXT;
     return 0;
 }
 
 AVCodecParser ff_h264_parser = {
     .codec_ids      = { AV_CODEC_ID_H264 },
-    .priv_data_size = sizeof(H264Context),
+    .priv_data_size = sizeof(H264ParseContext),
     .parser_init    = init,
     .parser_parse   = h264_parse,
     .parser_close   = close,
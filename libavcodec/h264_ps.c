@@ -329,6 +329,7 @@ int ff_h264_decode_seq_parameter_set(H264Context *h){
     int profile_idc, level_idc, constraint_set_flags = 0;
     unsigned int sps_id;
     int i, log2_max_frame_num_minus4;
+    AVBufferRef *sps_buf;
     SPS *sps;
 
     profile_idc= get_bits(&h->gb, 8);
@@ -346,9 +347,10 @@ int ff_h264_decode_seq_parameter_set(H264Context *h){
         av_log(h->avctx, AV_LOG_ERROR, "sps_id (%d) out of range\n", sps_id);
         return -1;
     }
-    sps= av_mallocz(sizeof(SPS));
-    if(sps == NULL)
-        return -1;
+    sps_buf = av_buffer_allocz(sizeof(SPS));
+    if (!sps_buf)
+        return AVERROR(ENOMEM);
+    sps = (SPS*)sps_buf->data;
 
     sps->time_offset_length = 24;
     sps->profile_idc= profile_idc;
@@ -542,12 +544,13 @@ int ff_h264_decode_seq_parameter_set(H264Context *h){
     }
     sps->new = 1;
 
-    av_free(h->sps_buffers[sps_id]);
+    av_buffer_unref(&h->sps_refs[sps_id]);
+    h->sps_refs[sps_id]    = sps_buf;
     h->sps_buffers[sps_id] = sps;
 
     return 0;
 fail:
-    av_free(sps);
+    av_buffer_unref(&sps_buf);
     return -1;
 }
 
@@ -577,6 +580,7 @@ static int more_rbsp_data_in_pps(H264Context *h, PPS *pps)
 
 int ff_h264_decode_picture_parameter_set(H264Context *h, int bit_length){
     unsigned int pps_id= get_ue_golomb(&h->gb);
+    AVBufferRef *pps_buf;
     PPS *pps;
     SPS *sps;
     int qp_bd_offset;
@@ -587,9 +591,10 @@ int ff_h264_decode_picture_parameter_set(H264Context *h, int bit_length){
         return AVERROR_INVALIDDATA;
     }
 
-    pps= av_mallocz(sizeof(PPS));
-    if(pps == NULL)
-        return -1;
+    pps_buf = av_buffer_allocz(sizeof(PPS));
+    if (!pps_buf)
+        return AVERROR(ENOMEM);
+    pps = (PPS*)pps_buf->data;
     pps->sps_id= get_ue_golomb_31(&h->gb);
     if((unsigned)pps->sps_id>=MAX_SPS_COUNT || h->sps_buffers[pps->sps_id] == NULL){
         av_log(h->avctx, AV_LOG_ERROR, "sps_id out of range\n");
@@ -695,10 +700,11 @@ int ff_h264_decode_picture_parameter_set(H264Context *h, int bit_length){
                );
     }
 
-    av_free(h->pps_buffers[pps_id]);
-    h->pps_buffers[pps_id]= pps;
+    av_buffer_unref(&h->pps_refs[pps_id]);
+    h->pps_refs[pps_id]    = pps_buf;
+    h->pps_buffers[pps_id] = pps;
     return 0;
 fail:
-    av_free(pps);
+    av_buffer_unref(&pps_buf);
     return -1;
 }
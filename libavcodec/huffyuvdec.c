@@ -28,6 +28,8 @@
  * huffyuv decoder
  */
 
+#define CACHED_BITSTREAM_READER 1
+
 #include "avcodec.h"
 #include "get_bits.h"
 #include "huffyuv.h"
@@ -34,6 +34,13 @@
 
 #define FF_SANE_NB_CHANNELS 63U
 
+/**
+ * The codec does not modify any global variables in the init function
+ * other than through ff_thread_once() guarded initializers, so it can
+ * be called without holding the global codec lock.
+ */
+#define FF_CODEC_CAP_INIT_THREADSAFE    (1 << 0)
+
 typedef struct FramePool {
     /**
      * Pools for each data plane. For audio all the planes have the same size,
@@ -41,6 +48,14 @@ typedef struct FramePool {
      */
     AVBufferPool *pools[4];
 
+    /**
+     * Set if the context registered itself as a user of the shared pools,
+     * and if pools[] currently point to shared pools not owned by this
+     * FramePool.
+     */
+    int shared_ref;
+    int shared;
+
     /*
      * Pool parameters
      */
@@ -107,6 +122,34 @@ typedef struct AVCodecInternal {
      * Number of audio samples to skip at the start of the next decoded frame
      */
     int skip_samples;
+
+    /**
+     * Latency traces of the frames queued in the encoder, in the order they
+     * were sent, matched to the output packets by pts.
+     */
+    struct LatencyTraceEntry {
+        int64_t pts;
+        AVLatencyTrace trace;
+    } *latency_traces;
+    int nb_latency_traces;
+
+    /**
+     * State of the send/receive API when it is emulated on top of the
+     * decode() and encode2() callbacks: the packet being decoded, or the
+     * encoded packet not returned yet, and the decoded frame not returned
+     * yet.
+     */
+    AVPacket buffer_pkt;
+    int buffer_pkt_valid;       ///< encoding: buffer_pkt holds a packet
+    AVFrame *buffer_frame;
+    int draining;               ///< NULL input was sent
+    int draining_done;          ///< the emulated decoder returned its last frame
+
+    /**
+     * The old decoding API, emulated on top of the send_packet() and
+     * receive_frame() callbacks, dropped frames and warned about it.
+     */
+    int compat_decode_warned;
 } AVCodecInternal;
 
 struct AVCodecDefault {
@@ -230,4 +273,25 @@ const uint8_t *avpriv_find_start_code(const uint8_t *p,
                                       const uint8_t *end,
                                       uint32_t *state);
 
+/**
+ * Find the first pair of zero bytes in buf, using the fastest
+ * implementation for the CPU.
+ * @return offset of the first byte of the pair, or size if there is none
+ */
+int avpriv_startcode_find_candidate(const uint8_t *buf, int size);
+
+/**
+ * Take over the buffer in which the parser combined its last output frame.
+ * The parser continues in a new buffer, so the frame does not need to be
+ * copied out of it.
+ *
+ * @param data the frame returned by av_parser_parse2()
+ * @param size the size of the frame returned by av_parser_parse2()
+ * @return a reference to the buffer holding data, or NULL if data is not in
+ *         the parser buffer or on allocation failure, in which case the frame
+ *         must be copied as usual
+ */
+AVBufferRef *avpriv_parser_ref_output(AVCodecParserContext *s,
+                                      const uint8_t *data, int size);
+
 #endif /* AVCODEC_INTERNAL_H */
@@ -85,6 +85,9 @@ typedef struct Jpeg2000DecoderContext {
 
     Jpeg2000Tile    *tile;
 
+    struct Jpeg2000CblkJob *cblk_jobs;
+    unsigned int    cblk_jobs_size;
+
     /*options parameters*/
     int             lowres;
     int             reduction_factor;
@@ -1035,13 +1038,51 @@ static void mct_decode(Jpeg2000DecoderContext *s, Jpeg2000Tile *tile)
     }
 }
 
-static int jpeg2000_decode_tile(Jpeg2000DecoderContext *s, Jpeg2000Tile *tile,
-                                AVFrame *picture)
+typedef struct Jpeg2000CblkJob {
+    Jpeg2000Component   *comp;
+    Jpeg2000CodingStyle *codsty;
+    Jpeg2000Band        *band;
+    Jpeg2000Cblk        *cblk;
+    int                  bandpos;
+} Jpeg2000CblkJob;
+
+static void decode_cblk_job(Jpeg2000DecoderContext *s, Jpeg2000CblkJob *job,
+                            Jpeg2000T1Context *t1)
 {
-    int compno, reslevelno, bandno;
+    Jpeg2000Cblk *cblk = job->cblk;
     int x, y;
 
-    uint8_t *line;
+    decode_cblk(s, job->codsty, t1, cblk,
+                cblk->coord[0][1] - cblk->coord[0][0],
+                cblk->coord[1][1] - cblk->coord[1][0],
+                job->bandpos);
+
+    /* Manage band offsets */
+    x = cblk->coord[0][0];
+    y = cblk->coord[1][0];
+
+    if (job->codsty->transform == FF_DWT97)
+        dequantization_float(x, y, cblk, job->comp, t1, job->band);
+    else
+        dequantization_int(x, y, cblk, job->comp, t1, job->band);
+}
+
+static int decode_cblk_thread(AVCodecContext *avctx, void *arg,
+                              int jobnr, int threadnr)
+{
+    Jpeg2000DecoderContext *s = avctx->priv_data;
+    Jpeg2000T1Context t1;
+
+    decode_cblk_job(s, &s->cblk_jobs[jobnr], &t1);
+    return 0;
+}
+
+/* Tier-1 decode and dequantize all code-blocks of a tile. Code-blocks are
+ * independent, so with intra-tile threading they are run as slice jobs. */
+static int jpeg2000_decode_cblks(Jpeg2000DecoderContext *s, Jpeg2000Tile *tile,
+                                 int threaded)
+{
+    int compno, reslevelno, bandno, nb_jobs = 0;
     Jpeg2000T1Context t1;
 
     /* Loop on tile components */
@@ -1067,32 +1108,57 @@ static int jpeg2000_decode_tile(Jpeg2000DecoderContext *s, Jpeg2000Tile *tile,
                 /* Loop on precincts */
                 for (precno = 0; precno < nb_precincts; precno++) {
                     Jpeg2000Prec *prec = band->prec + precno;
+                    int nb_cblks = prec->nb_codeblocks_width * prec->nb_codeblocks_height;
+
+                    if (threaded) {
+                        Jpeg2000CblkJob *jobs = av_fast_realloc(s->cblk_jobs, &s->cblk_jobs_size,
+                                                                (nb_jobs + nb_cblks) * sizeof(*jobs));
+                        if (!jobs)
+                            return AVERROR(ENOMEM);
+                        s->cblk_jobs = jobs;
+                    }
 
                     /* Loop on codeblocks */
-                    for (cblkno = 0; cblkno < prec->nb_codeblocks_width * prec->nb_codeblocks_height; cblkno++) {
-                        int x, y;
-                        Jpeg2000Cblk *cblk = prec->cblk + cblkno;
-                        decode_cblk(s, codsty, &t1, cblk,
-                                    cblk->coord[0][1] - cblk->coord[0][0],
-                                    cblk->coord[1][1] - cblk->coord[1][0],
-                                    bandpos);
-
-                        /* Manage band offsets */
-                        x = cblk->coord[0][0];
-                        y = cblk->coord[1][0];
-
-                        if (codsty->transform == FF_DWT97)
-                            dequantization_float(x, y, cblk, comp, &t1, band);
+                    for (cblkno = 0; cblkno < nb_cblks; cblkno++) {
+                        Jpeg2000CblkJob job = { comp, codsty, band,
+                                                prec->cblk + cblkno, bandpos };
+                        if (threaded)
+                            s->cblk_jobs[nb_jobs++] = job;
                         else
-                            dequantization_int(x, y, cblk, comp, &t1, band);
+                            decode_cblk_job(s, &job, &t1);
                    } /* end cblk */
                 } /*end prec */
             } /* end band */
         } /* end reslevel */
+    } /*end comp */
+
+    if (nb_jobs)
+        s->avctx->execute2(s->avctx, decode_cblk_thread, NULL, NULL, nb_jobs);
+    return 0;
+}
+
+static int jpeg2000_decode_tile(Jpeg2000DecoderContext *s, Jpeg2000Tile *tile,
+                                AVFrame *picture, int threaded)
+{
+    int compno, ret;
+    int x, y;
+
+    uint8_t *line;
+
+    if ((ret = jpeg2000_decode_cblks(s, tile, threaded)) < 0)
+        return ret;
+
+    for (compno = 0; compno < s->ncomponents; compno++) {
+        Jpeg2000Component *comp     = tile->comp + compno;
+        Jpeg2000CodingStyle *codsty = tile->codsty + compno;
+        void *data = codsty->transform == FF_DWT97 ? (void*)comp->f_data : (void*)comp->i_data;
 
         /* inverse DWT */
-        ff_dwt_decode(&comp->dwt, codsty->transform == FF_DWT97 ? (void*)comp->f_data : (void*)comp->i_data);
-    } /*end comp */
+        if (threaded)
+            ff_dwt_decode_thread(&comp->dwt, data, s->avctx);
+        else
+            ff_dwt_decode(&comp->dwt, data);
+    }
 
     /* inverse MCT transformation */
     if (tile->codsty[0].mct)
@@ -1183,6 +1249,14 @@ static int jpeg2000_decode_tile(Jpeg2000DecoderContext *s, Jpeg2000Tile *tile,
     return 0;
 }
 
+static int jpeg2000_decode_tile_thread(AVCodecContext *avctx, void *picture,
+                                       int jobnr, int threadnr)
+{
+    Jpeg2000DecoderContext *s = avctx->priv_data;
+
+    return jpeg2000_decode_tile(s, s->tile + jobnr, picture, 0);
+}
+
 static void jpeg2000_dec_cleanup(Jpeg2000DecoderContext *s)
 {
     int tileno, compno;
@@ -1385,9 +1459,17 @@ static int jpeg2000_decode_frame(AVCodecContext *avctx, void *data,
     if (ret = jpeg2000_read_bitstream_packets(s))
         goto end;
 
-    for (tileno = 0; tileno < s->numXtiles * s->numYtiles; tileno++)
-        if (ret = jpeg2000_decode_tile(s, s->tile + tileno, picture))
-            goto end;
+    if (avctx->active_thread_type & FF_THREAD_SLICE &&
+        s->numXtiles * s->numYtiles >= avctx->thread_count) {
+        /* enough tiles to keep all threads busy on whole tiles */
+        avctx->execute2(avctx, jpeg2000_decode_tile_thread, picture, NULL,
+                        s->numXtiles * s->numYtiles);
+    } else {
+        int threaded = !!(avctx->active_thread_type & FF_THREAD_SLICE);
+        for (tileno = 0; tileno < s->numXtiles * s->numYtiles; tileno++)
+            if (ret = jpeg2000_decode_tile(s, s->tile + tileno, picture, threaded))
+                goto end;
+    }
 
     jpeg2000_dec_cleanup(s);
 
@@ -1399,6 +1481,15 @@ end:
     return ret;
 }
 
+static av_cold int jpeg2000_decode_end(AVCodecContext *avctx)
+{
+    Jpeg2000DecoderContext *s = avctx->priv_data;
+
+    av_freep(&s->cblk_jobs);
+    s->cblk_jobs_size = 0;
+    return 0;
+}
+
 static void jpeg2000_init_static_data(AVCodec *codec)
 {
     ff_jpeg2000_init_tier1_luts();
@@ -1434,7 +1525,8 @@ AVCodec ff_jpeg2000_decoder = {
     .long_name        = NULL_IF_CONFIG_SMALL("JPEG 2000"),
     .type             = AVMEDIA_TYPE_VIDEO,
     .id               = AV_CODEC_ID_JPEG2000,
-    .capabilities     = CODEC_CAP_FRAME_THREADS,
+    .capabilities     = CODEC_CAP_FRAME_THREADS | CODEC_CAP_SLICE_THREADS,
+    .close            = jpeg2000_decode_end,
     .priv_data_size   = sizeof(Jpeg2000DecoderContext),
     .init_static_data = jpeg2000_init_static_data,
     .decode           = jpeg2000_decode_frame,
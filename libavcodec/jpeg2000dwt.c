@@ -27,6 +27,7 @@
 
 #include "libavutil/common.h"
 #include "libavutil/mem.h"
+#include "avcodec.h"
 #include "jpeg2000dwt.h"
 #include "internal.h"
 
@@ -301,24 +302,23 @@ static void sr_1d53(int *p, int i0, int i1)
         p[2 * i + 1] += (p[2 * i] + p[2 * i + 2]) >> 1;
 }
 
-static void dwt_decode53(DWTContext *s, int *t)
+/* Run the horizontal (ver = 0) or vertical (ver = 1) pass of decomposition
+ * level lev on the lines [start, end). */
+static void dwt_decode53_lines(DWTContext *s, int *t, int lev, int ver,
+                               int *line, int start, int end)
 {
-    int lev;
-    int w     = s->linelen[s->ndeclevels - 1][0];
-    int32_t *line = s->i_linebuf;
-    line += 3;
-
-    for (lev = 0; lev < s->ndeclevels; lev++) {
-        int lh = s->linelen[lev][0],
-            lv = s->linelen[lev][1],
-            mh = s->mod[lev][0],
-            mv = s->mod[lev][1],
-            lp;
-        int *l;
-
+    int w  = s->linelen[s->ndeclevels - 1][0];
+    int lh = s->linelen[lev][0],
+        lv = s->linelen[lev][1],
+        mh = s->mod[lev][0],
+        mv = s->mod[lev][1],
+        lp;
+    int *l;
+
+    if (!ver) {
         // HOR_SD
         l = line + mh;
-        for (lp = 0; lp < lv; lp++) {
+        for (lp = start; lp < end; lp++) {
             int i, j = 0;
             // copy with interleaving
             for (i = mh; i < lh; i += 2, j++)
@@ -331,10 +331,10 @@ static void dwt_decode53(DWTContext *s, int *t)
             for (i = 0; i < lh; i++)
                 t[w * lp + i] = l[i];
         }
-
+    } else {
         // VER_SD
         l = line + mv;
-        for (lp = 0; lp < lh; lp++) {
+        for (lp = start; lp < end; lp++) {
             int i, j = 0;
             // copy with interleaving
             for (i = mv; i < lv; i += 2, j++)
@@ -350,6 +350,18 @@ static void dwt_decode53(DWTContext *s, int *t)
     }
 }
 
+static void dwt_decode53(DWTContext *s, int *t)
+{
+    int lev;
+    int32_t *line = s->i_linebuf;
+    line += 3;
+
+    for (lev = 0; lev < s->ndeclevels; lev++) {
+        dwt_decode53_lines(s, t, lev, 0, line, 0, s->linelen[lev][1]);
+        dwt_decode53_lines(s, t, lev, 1, line, 0, s->linelen[lev][0]);
+    }
+}
+
 static void sr_1d97_float(float *p, int i0, int i1)
 {
     int i;
@@ -372,25 +384,21 @@ static void sr_1d97_float(float *p, int i0, int i1)
         p[2 * i + 1] += F_LFTG_ALPHA * (p[2 * i]     + p[2 * i + 2]);
 }
 
-static void dwt_decode97_float(DWTContext *s, float *t)
+static void dwt_decode97_float_lines(DWTContext *s, float *data, int lev,
+                                     int ver, float *line, int start, int end)
 {
-    int lev;
-    int w       = s->linelen[s->ndeclevels - 1][0];
-    float *line = s->f_linebuf;
-    float *data = t;
-    /* position at index O of line range [0-5,w+5] cf. extend function */
-    line += 5;
-
-    for (lev = 0; lev < s->ndeclevels; lev++) {
-        int lh = s->linelen[lev][0],
-            lv = s->linelen[lev][1],
-            mh = s->mod[lev][0],
-            mv = s->mod[lev][1],
-            lp;
-        float *l;
+    int w  = s->linelen[s->ndeclevels - 1][0];
+    int lh = s->linelen[lev][0],
+        lv = s->linelen[lev][1],
+        mh = s->mod[lev][0],
+        mv = s->mod[lev][1],
+        lp;
+    float *l;
+
+    if (!ver) {
         // HOR_SD
         l = line + mh;
-        for (lp = 0; lp < lv; lp++) {
+        for (lp = start; lp < end; lp++) {
             int i, j = 0;
             // copy with interleaving
             for (i = mh; i < lh; i += 2, j++)
@@ -403,10 +411,10 @@ static void dwt_decode97_float(DWTContext *s, float *t)
             for (i = 0; i < lh; i++)
                 data[w * lp + i] = l[i];
         }
-
+    } else {
         // VER_SD
         l = line + mv;
-        for (lp = 0; lp < lh; lp++) {
+        for (lp = start; lp < end; lp++) {
             int i, j = 0;
             // copy with interleaving
             for (i = mv; i < lv; i += 2, j++)
@@ -422,6 +430,19 @@ static void dwt_decode97_float(DWTContext *s, float *t)
     }
 }
 
+static void dwt_decode97_float(DWTContext *s, float *t)
+{
+    int lev;
+    float *line = s->f_linebuf;
+    /* position at index O of line range [0-5,w+5] cf. extend function */
+    line += 5;
+
+    for (lev = 0; lev < s->ndeclevels; lev++) {
+        dwt_decode97_float_lines(s, t, lev, 0, line, 0, s->linelen[lev][1]);
+        dwt_decode97_float_lines(s, t, lev, 1, line, 0, s->linelen[lev][0]);
+    }
+}
+
 static void sr_1d97_int(int32_t *p, int i0, int i1)
 {
     int i;
@@ -444,25 +465,21 @@ static void sr_1d97_int(int32_t *p, int i0, int i1)
         p[2 * i + 1] += (I_LFTG_ALPHA * (p[2 * i]     + p[2 * i + 2]) + (1 << 15)) >> 16;
 }
 
-static void dwt_decode97_int(DWTContext *s, int32_t *t)
+static void dwt_decode97_int_lines(DWTContext *s, int32_t *data, int lev,
+                                   int ver, int32_t *line, int start, int end)
 {
-    int lev;
-    int w       = s->linelen[s->ndeclevels - 1][0];
-    int32_t *line = s->i_linebuf;
-    int32_t *data = t;
-    /* position at index O of line range [0-5,w+5] cf. extend function */
-    line += 5;
-
-    for (lev = 0; lev < s->ndeclevels; lev++) {
-        int lh = s->linelen[lev][0],
-            lv = s->linelen[lev][1],
-            mh = s->mod[lev][0],
-            mv = s->mod[lev][1],
-            lp;
-        int32_t *l;
+    int w  = s->linelen[s->ndeclevels - 1][0];
+    int lh = s->linelen[lev][0],
+        lv = s->linelen[lev][1],
+        mh = s->mod[lev][0],
+        mv = s->mod[lev][1],
+        lp;
+    int32_t *l;
+
+    if (!ver) {
         // HOR_SD
         l = line + mh;
-        for (lp = 0; lp < lv; lp++) {
+        for (lp = start; lp < end; lp++) {
             int i, j = 0;
             // rescale with interleaving
             for (i = mh; i < lh; i += 2, j++)
@@ -475,10 +492,10 @@ static void dwt_decode97_int(DWTContext *s, int32_t *t)
             for (i = 0; i < lh; i++)
                 data[w * lp + i] = l[i];
         }
-
+    } else {
         // VER_SD
         l = line + mv;
-        for (lp = 0; lp < lh; lp++) {
+        for (lp = start; lp < end; lp++) {
             int i, j = 0;
             // rescale with interleaving
             for (i = mv; i < lv; i += 2, j++)
@@ -494,6 +511,19 @@ static void dwt_decode97_int(DWTContext *s, int32_t *t)
     }
 }
 
+static void dwt_decode97_int(DWTContext *s, int32_t *t)
+{
+    int lev;
+    int32_t *line = s->i_linebuf;
+    /* position at index O of line range [0-5,w+5] cf. extend function */
+    line += 5;
+
+    for (lev = 0; lev < s->ndeclevels; lev++) {
+        dwt_decode97_int_lines(s, t, lev, 0, line, 0, s->linelen[lev][1]);
+        dwt_decode97_int_lines(s, t, lev, 1, line, 0, s->linelen[lev][0]);
+    }
+}
+
 int ff_jpeg2000_dwt_init(DWTContext *s, uint16_t border[2][2],
                          int decomp_levels, int type)
 {
@@ -571,8 +601,79 @@ int ff_dwt_decode(DWTContext *s, void *t)
     return 0;
 }
 
+typedef struct DWTThreadArg {
+    DWTContext *s;
+    void *t;
+    int lev, ver;
+    int nb_lines, nb_jobs;
+    int linebuf_size;
+} DWTThreadArg;
+
+static int dwt_decode_lines_thread(AVCodecContext *avctx, void *arg,
+                                   int jobnr, int threadnr)
+{
+    DWTThreadArg *a = arg;
+    DWTContext   *s = a->s;
+    int start = a->nb_lines *  jobnr      / a->nb_jobs;
+    int end   = a->nb_lines * (jobnr + 1) / a->nb_jobs;
+
+    switch (s->type) {
+    case FF_DWT97:
+        dwt_decode97_float_lines(s, a->t, a->lev, a->ver,
+                                 (float *)s->thread_linebuf + threadnr * a->linebuf_size + 5,
+                                 start, end);
+        break;
+    case FF_DWT97_INT:
+        dwt_decode97_int_lines(s, a->t, a->lev, a->ver,
+                               (int32_t *)s->thread_linebuf + threadnr * a->linebuf_size + 5,
+                               start, end);
+        break;
+    case FF_DWT53:
+        dwt_decode53_lines(s, a->t, a->lev, a->ver,
+                           (int32_t *)s->thread_linebuf + threadnr * a->linebuf_size + 3,
+                           start, end);
+        break;
+    }
+    return 0;
+}
+
+int ff_dwt_decode_thread(DWTContext *s, void *t, AVCodecContext *avctx)
+{
+    DWTThreadArg arg = { .s = s, .t = t };
+    int nb_threads = avctx->thread_count;
+
+    if (!(avctx->active_thread_type & FF_THREAD_SLICE) || nb_threads < 2 ||
+        !s->ndeclevels || s->type > FF_DWT97_INT)
+        return ff_dwt_decode(s, t);
+
+    /* the last decomposition level has the longest lines */
+    arg.linebuf_size = FFMAX(s->linelen[s->ndeclevels - 1][0],
+                             s->linelen[s->ndeclevels - 1][1]) + 12;
+    if (s->thread_linebuf_count < nb_threads) {
+        av_freep(&s->thread_linebuf);
+        s->thread_linebuf_count = 0;
+        s->thread_linebuf = av_malloc_array(nb_threads * arg.linebuf_size,
+                                            sizeof(int32_t));
+        if (!s->thread_linebuf)
+            return ff_dwt_decode(s, t);
+        s->thread_linebuf_count = nb_threads;
+    }
+
+    for (arg.lev = 0; arg.lev < s->ndeclevels; arg.lev++) {
+        for (arg.ver = 0; arg.ver < 2; arg.ver++) {
+            arg.nb_lines = s->linelen[arg.lev][!arg.ver];
+            arg.nb_jobs  = FFMIN(nb_threads, arg.nb_lines);
+            avctx->execute2(avctx, dwt_decode_lines_thread, &arg, NULL,
+                            arg.nb_jobs);
+        }
+    }
+    return 0;
+}
+
 void ff_dwt_destroy(DWTContext *s)
 {
     av_freep(&s->f_linebuf);
     av_freep(&s->i_linebuf);
+    av_freep(&s->thread_linebuf);
+    s->thread_linebuf_count = 0;
 }
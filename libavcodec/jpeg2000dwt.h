@@ -29,6 +29,8 @@
 
 #include <stdint.h>
 
+struct AVCodecContext;
+
 #define FF_DWT_MAX_DECLVLS 32 ///< max number of decomposition levels
 
 enum DWTType {
@@ -45,6 +47,8 @@ typedef struct DWTContext {
     uint8_t type;                        ///< 0 for 9/7; 1 for 5/3
     int32_t *i_linebuf;                  ///< int buffer used by transform
     float   *f_linebuf;                  ///< float buffer used by transform
+    void    *thread_linebuf;             ///< one line buffer per slice thread
+    int      thread_linebuf_count;
 } DWTContext;
 
 /**
@@ -60,6 +64,13 @@ int ff_jpeg2000_dwt_init(DWTContext *s, uint16_t border[2][2],
 int ff_dwt_encode(DWTContext *s, void *t);
 int ff_dwt_decode(DWTContext *s, void *t);
 
+/**
+ * Inverse DWT with the lines of each pass spread over the slice threads
+ * of avctx. The output is identical to ff_dwt_decode(); it falls back to
+ * it when slice threading is not active.
+ */
+int ff_dwt_decode_thread(DWTContext *s, void *t, struct AVCodecContext *avctx);
+
 void ff_dwt_destroy(DWTContext *s);
 
 #endif /* AVCODEC_JPEG2000DWT_H */
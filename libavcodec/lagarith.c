@@ -46,13 +46,21 @@ enum LagarithFrameType {
     FRAME_REDUCED_RES   = 11,   /**< reduced resolution YV12 frame */
 };
 
+typedef struct LagarithPlane {
+    uint8_t *dst;
+    int width, height, stride;
+    const uint8_t *src;
+    int src_size;
+    int zeros;                  /**< number of consecutive zero bytes encountered */
+    int zeros_rem;              /**< number of zero bytes remaining to output */
+} LagarithPlane;
+
 typedef struct LagarithContext {
     AVCodecContext *avctx;
     DSPContext dsp;
-    int zeros;                  /**< number of consecutive zero bytes encountered */
-    int zeros_rem;              /**< number of zero bytes remaining to output */
     uint8_t *rgb_planes;
     int rgb_stride;
+    LagarithPlane planes[4];    /**< planes of the current frame, decoded in parallel */
 } LagarithContext;
 
 /**
@@ -307,7 +315,7 @@ static void lag_pred_line_yuy2(LagarithContext *l, uint8_t *buf,
     }
 }
 
-static int lag_decode_line(LagarithContext *l, lag_rac *rac,
+static int lag_decode_line(LagarithPlane *lp, lag_rac *rac,
                            uint8_t *dst, int width, int stride,
                            int esc_count)
 {
@@ -319,11 +327,11 @@ static int lag_decode_line(LagarithContext *l, lag_rac *rac,
 
     /* Output any zeros remaining from the previous run */
 handle_zeros:
-    if (l->zeros_rem) {
-        int count = FFMIN(l->zeros_rem, width - i);
+    if (lp->zeros_rem) {
+        int count = FFMIN(lp->zeros_rem, width - i);
         memset(dst + i, 0, count);
         i += count;
-        l->zeros_rem -= count;
+        lp->zeros_rem -= count;
     }
 
     while (i < width) {
@@ -331,26 +339,28 @@ handle_zeros:
         ret++;
 
         if (dst[i])
-            l->zeros = 0;
+            lp->zeros = 0;
         else
-            l->zeros++;
+            lp->zeros++;
 
         i++;
-        if (l->zeros == esc_count) {
+        if (lp->zeros == esc_count) {
             int index = lag_get_rac(rac);
             ret++;
 
-            l->zeros = 0;
+            lp->zeros = 0;
 
-            l->zeros_rem = lag_calc_zero_run(index);
+            lp->zeros_rem = lag_calc_zero_run(index);
             goto handle_zeros;
         }
     }
     return ret;
 }
 
-static int lag_decode_zero_run_line(LagarithContext *l, uint8_t *dst,
-                                    const uint8_t *src, const uint8_t *src_end,
+static int lag_decode_zero_run_line(LagarithContext *l, LagarithPlane *lp,
+                                    uint8_t *dst,
+                                    const uint8_t *src,
+                                    const uint8_t *src_end,
                                     int width, int esc_count)
 {
     int i = 0;
@@ -362,15 +372,15 @@ static int lag_decode_zero_run_line(LagarithContext *l, uint8_t *dst,
     uint8_t *end = dst + (width - 2);
 
 output_zeros:
-    if (l->zeros_rem) {
-        count = FFMIN(l->zeros_rem, width - i);
+    if (lp->zeros_rem) {
+        count = FFMIN(lp->zeros_rem, width - i);
         if (end - dst < count) {
             av_log(l->avctx, AV_LOG_ERROR, "Too many zeros remaining.\n");
             return AVERROR_INVALIDDATA;
         }
 
         memset(dst, 0, count);
-        l->zeros_rem -= count;
+        lp->zeros_rem -= count;
         dst += count;
     }
 
@@ -388,7 +398,7 @@ output_zeros:
             i += esc_count;
             memcpy(dst, src, i);
             dst += i;
-            l->zeros_rem = lag_calc_zero_run(src[i]);
+            lp->zeros_rem = lag_calc_zero_run(src[i]);
 
             src += i + 1;
             goto output_zeros;
@@ -403,10 +413,14 @@ output_zeros:
 
 
 
-static int lag_decode_arith_plane(LagarithContext *l, uint8_t *dst,
-                                  int width, int height, int stride,
-                                  const uint8_t *src, int src_size)
+static int lag_decode_arith_plane(LagarithContext *l, LagarithPlane *lp)
 {
+    uint8_t *dst       = lp->dst;
+    const uint8_t *src = lp->src;
+    int width          = lp->width;
+    int height         = lp->height;
+    int stride         = lp->stride;
+    int src_size       = lp->src_size;
     int i = 0;
     int read = 0;
     uint32_t length;
@@ -417,7 +431,8 @@ static int lag_decode_arith_plane(LagarithContext *l, uint8_t *dst,
     const uint8_t *src_end = src + src_size;
 
     rac.avctx = l->avctx;
-    l->zeros = 0;
+    lp->zeros     = 0;
+    lp->zeros_rem = 0;
 
     if(src_size < 2)
         return AVERROR_INVALIDDATA;
@@ -440,7 +455,7 @@ static int lag_decode_arith_plane(LagarithContext *l, uint8_t *dst,
         ff_lag_rac_init(&rac, &gb, length - stride);
 
         for (i = 0; i < height; i++)
-            read += lag_decode_line(l, &rac, dst + (i * stride), width,
+            read += lag_decode_line(lp, &rac, dst + (i * stride), width,
                                     stride, esc_count);
 
         if (read > length)
@@ -452,8 +467,9 @@ static int lag_decode_arith_plane(LagarithContext *l, uint8_t *dst,
         if (esc_count > 0) {
             /* Zero run coding only, no range coding. */
             for (i = 0; i < height; i++) {
-                int res = lag_decode_zero_run_line(l, dst + (i * stride), src,
-                                                   src_end, width, esc_count);
+                int res = lag_decode_zero_run_line(l, lp, dst + (i * stride),
+                                                   src, src_end, width,
+                                                   esc_count);
                 if (res < 0)
                     return res;
                 src += res;
@@ -497,6 +513,28 @@ static int lag_decode_arith_plane(LagarithContext *l, uint8_t *dst,
     return 0;
 }
 
+static int lag_decode_plane_thread(AVCodecContext *avctx, void *arg,
+                                   int jobnr, int threadnr)
+{
+    LagarithContext *l = avctx->priv_data;
+
+    return lag_decode_arith_plane(l, &l->planes[jobnr]);
+}
+
+static void lag_set_plane(LagarithContext *l, int plane, uint8_t *dst,
+                          int width, int height, int stride,
+                          const uint8_t *src, int src_size)
+{
+    LagarithPlane *lp = &l->planes[plane];
+
+    lp->dst      = dst;
+    lp->width    = width;
+    lp->height   = height;
+    lp->stride   = stride;
+    lp->src      = src;
+    lp->src_size = src_size;
+}
+
 /**
  * Decode a frame.
  * @param avctx codec context
@@ -597,14 +635,17 @@ static int lag_decode_frame(AVCodecContext *avctx,
 
         if (!l->rgb_planes) {
             l->rgb_stride = FFALIGN(avctx->width, 16);
-            l->rgb_planes = av_malloc(l->rgb_stride * avctx->height * 4 + 16);
+            /* one spare line after each plane absorbs the overrun of
+             * the zero run coder, as the planes are decoded concurrently */
+            l->rgb_planes = av_mallocz(l->rgb_stride * (avctx->height + 1) * 4 + 16);
             if (!l->rgb_planes) {
                 av_log(avctx, AV_LOG_ERROR, "cannot allocate temporary buffer\n");
                 return AVERROR(ENOMEM);
             }
         }
         for (i = 0; i < planes; i++)
-            srcs[i] = l->rgb_planes + (i + 1) * l->rgb_stride * avctx->height - l->rgb_stride;
+            srcs[i] = l->rgb_planes + (i + 1) * l->rgb_stride * avctx->height +
+                      (i - 1) * l->rgb_stride;
         for (i = 0; i < planes; i++)
             if (buf_size <= offs[i]) {
                 av_log(avctx, AV_LOG_ERROR,
@@ -613,13 +654,12 @@ static int lag_decode_frame(AVCodecContext *avctx,
             }
 
         for (i = 0; i < planes; i++)
-            lag_decode_arith_plane(l, srcs[i],
-                                   avctx->width, avctx->height,
-                                   -l->rgb_stride, buf + offs[i],
-                                   buf_size - offs[i]);
+            lag_set_plane(l, i, srcs[i], avctx->width, avctx->height,
+                          -l->rgb_stride, buf + offs[i], buf_size - offs[i]);
+        avctx->execute2(avctx, lag_decode_plane_thread, NULL, NULL, planes);
         dst = p->data[0];
         for (i = 0; i < planes; i++)
-            srcs[i] = l->rgb_planes + i * l->rgb_stride * avctx->height;
+            srcs[i] = l->rgb_planes + i * l->rgb_stride * (avctx->height + 1);
         for (j = 0; j < avctx->height; j++) {
             for (i = 0; i < avctx->width; i++) {
                 uint8_t r, g, b, a;
@@ -656,15 +696,13 @@ static int lag_decode_frame(AVCodecContext *avctx,
             return AVERROR_INVALIDDATA;
         }
 
-        lag_decode_arith_plane(l, p->data[0], avctx->width, avctx->height,
-                               p->linesize[0], buf + offset_ry,
-                               buf_size - offset_ry);
-        lag_decode_arith_plane(l, p->data[1], avctx->width / 2,
-                               avctx->height, p->linesize[1],
-                               buf + offset_gu, buf_size - offset_gu);
-        lag_decode_arith_plane(l, p->data[2], avctx->width / 2,
-                               avctx->height, p->linesize[2],
-                               buf + offset_bv, buf_size - offset_bv);
+        lag_set_plane(l, 0, p->data[0], avctx->width, avctx->height,
+                      p->linesize[0], buf + offset_ry, buf_size - offset_ry);
+        lag_set_plane(l, 1, p->data[1], avctx->width / 2, avctx->height,
+                      p->linesize[1], buf + offset_gu, buf_size - offset_gu);
+        lag_set_plane(l, 2, p->data[2], avctx->width / 2, avctx->height,
+                      p->linesize[2], buf + offset_bv, buf_size - offset_bv);
+        avctx->execute2(avctx, lag_decode_plane_thread, NULL, NULL, 3);
         break;
     case FRAME_ARITH_YV12:
         avctx->pix_fmt = AV_PIX_FMT_YUV420P;
@@ -683,15 +721,13 @@ static int lag_decode_frame(AVCodecContext *avctx,
             return AVERROR_INVALIDDATA;
         }
 
-        lag_decode_arith_plane(l, p->data[0], avctx->width, avctx->height,
-                               p->linesize[0], buf + offset_ry,
-                               buf_size - offset_ry);
-        lag_decode_arith_plane(l, p->data[2], avctx->width / 2,
-                               avctx->height / 2, p->linesize[2],
-                               buf + offset_gu, buf_size - offset_gu);
-        lag_decode_arith_plane(l, p->data[1], avctx->width / 2,
-                               avctx->height / 2, p->linesize[1],
-                               buf + offset_bv, buf_size - offset_bv);
+        lag_set_plane(l, 0, p->data[0], avctx->width, avctx->height,
+                      p->linesize[0], buf + offset_ry, buf_size - offset_ry);
+        lag_set_plane(l, 1, p->data[2], avctx->width / 2, avctx->height / 2,
+                      p->linesize[2], buf + offset_gu, buf_size - offset_gu);
+        lag_set_plane(l, 2, p->data[1], avctx->width / 2, avctx->height / 2,
+                      p->linesize[1], buf + offset_bv, buf_size - offset_bv);
+        avctx->execute2(avctx, lag_decode_plane_thread, NULL, NULL, 3);
         break;
     default:
         av_log(avctx, AV_LOG_ERROR,
@@ -731,6 +767,7 @@ AVCodec ff_lagarith_decoder = {
     .init           = lag_decode_init,
     .close          = lag_decode_end,
     .decode         = lag_decode_frame,
-    .capabilities   = CODEC_CAP_DR1 | CODEC_CAP_FRAME_THREADS,
+    .capabilities   = CODEC_CAP_DR1 | CODEC_CAP_FRAME_THREADS |
+                      CODEC_CAP_SLICE_THREADS,
     .long_name      = NULL_IF_CONFIG_SMALL("Lagarith lossless"),
 };
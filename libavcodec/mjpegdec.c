@@ -60,12 +60,19 @@ static int build_vlc(VLC *vlc, const uint8_t *bits_table,
     if (is_ac)
         huff_sym[0] = 16 * 256;
 
-    return ff_init_vlc_sparse(vlc, 9, nb_codes, huff_size, 1, 1,
+    return ff_init_vlc_shared(vlc, 9, nb_codes, huff_size, 1, 1,
                               huff_code, 2, 2, huff_sym, 2, 2, use_static);
 }
 
 static void build_basic_mjpeg_vlc(MJpegDecodeContext *s)
 {
+    int i;
+
+    for (i = 0; i < 3; i++) {
+        ff_free_vlc_shared(&s->vlcs[i][0]);
+        ff_free_vlc_shared(&s->vlcs[i][1]);
+    }
+
     build_vlc(&s->vlcs[0][0], avpriv_mjpeg_bits_dc_luminance,
               avpriv_mjpeg_val_dc, 12, 0, 0);
     build_vlc(&s->vlcs[0][1], avpriv_mjpeg_bits_dc_chrominance,
@@ -161,6 +168,7 @@ int ff_mjpeg_decode_dht(MJpegDecodeContext *s)
     int len, index, i, class, n, v, code_max;
     uint8_t bits_table[17];
     uint8_t val_table[256];
+    VLC vlc;
     int ret = 0;
 
     len = get_bits(&s->gb, 16) - 2;
@@ -192,18 +200,21 @@ int ff_mjpeg_decode_dht(MJpegDecodeContext *s)
         }
         len -= n;
 
-        /* build VLC and flush previous vlc if present */
-        ff_free_vlc(&s->vlcs[class][index]);
+        /* build VLC and flush previous vlc if present; the new one is
+         * built first so that a repeated table stays in the cache */
         av_log(s->avctx, AV_LOG_DEBUG, "class=%d index=%d nb_codes=%d\n",
                class, index, code_max + 1);
-        if ((ret = build_vlc(&s->vlcs[class][index], bits_table, val_table,
-                             code_max + 1, 0, class > 0)) < 0)
+        ret = build_vlc(&vlc, bits_table, val_table, code_max + 1, 0, class > 0);
+        ff_free_vlc_shared(&s->vlcs[class][index]);
+        s->vlcs[class][index] = vlc;
+        if (ret < 0)
             return ret;
 
         if (class > 0) {
-            ff_free_vlc(&s->vlcs[2][index]);
-            if ((ret = build_vlc(&s->vlcs[2][index], bits_table, val_table,
-                                 code_max + 1, 0, 0)) < 0)
+            ret = build_vlc(&vlc, bits_table, val_table, code_max + 1, 0, 0);
+            ff_free_vlc_shared(&s->vlcs[2][index]);
+            s->vlcs[2][index] = vlc;
+            if (ret < 0)
                 return ret;
         }
     }
@@ -1012,117 +1023,244 @@ static av_always_inline void mjpeg_copy_block(MJpegDecodeContext *s,
     }
 }
 
-static int mjpeg_decode_scan(MJpegDecodeContext *s, int nb_components, int Ah,
-                             int Al, const uint8_t *mb_bitmask,
-                             const AVFrame *reference)
-{
-    int i, mb_x, mb_y;
+typedef struct MJpegScan {
+    int nb_components, Ah, Al;
+    const uint8_t *mb_bitmask;
     uint8_t *data[MAX_COMPONENTS];
     const uint8_t *reference_data[MAX_COMPONENTS];
     int linesize[MAX_COMPONENTS];
+    const uint8_t *start;       ///< first byte of the scan data
+    int first_offset;           ///< index of the first RSTn offset inside the scan
+    int nb_intervals;
+    GetBitContext end_gb;       ///< reader state after the last restart interval
+    int end_restart_count;
+} MJpegScan;
+
+/* decode the MCUs [first, last) of a baseline or progressive DC scan */
+static int mjpeg_decode_mcus(MJpegDecodeContext *s, MJpegScan *sc,
+                             int first, int last)
+{
+    int i, mcu, mb_x, mb_y;
     GetBitContext mb_bitmask_gb;
 
-    if (mb_bitmask)
-        init_get_bits(&mb_bitmask_gb, mb_bitmask, s->mb_width * s->mb_height);
-
-    if (s->flipped && s->avctx->lowres) {
-        av_log(s->avctx, AV_LOG_ERROR, "Can not flip image with lowres\n");
-        s->flipped = 0;
+    if (sc->mb_bitmask) {
+        init_get_bits(&mb_bitmask_gb, sc->mb_bitmask, s->mb_width * s->mb_height);
+        skip_bits_long(&mb_bitmask_gb, first);
     }
 
-    for (i = 0; i < nb_components; i++) {
-        int c   = s->comp_index[i];
-        data[c] = s->picture_ptr->data[c];
-        reference_data[c] = reference ? reference->data[c] : NULL;
-        linesize[c] = s->linesize[c];
-        s->coefs_finished[c] |= 1;
-        if (s->flipped && !(s->avctx->flags & CODEC_FLAG_EMU_EDGE)) {
-            // picture should be flipped upside-down for this codec
-            int offset = (linesize[c] * (s->v_scount[i] *
-                         (8 * s->mb_height - ((s->height / s->v_max) & 7)) - 1));
-            data[c]           += offset;
-            reference_data[c] += offset;
-            linesize[c]       *= -1;
-        }
-    }
+    mb_x = first % s->mb_width;
+    mb_y = first / s->mb_width;
+    for (mcu = first; mcu < last; mcu++) {
+        const int copy_mb = sc->mb_bitmask && !get_bits1(&mb_bitmask_gb);
 
-    for (mb_y = 0; mb_y < s->mb_height; mb_y++) {
-        for (mb_x = 0; mb_x < s->mb_width; mb_x++) {
-            const int copy_mb = mb_bitmask && !get_bits1(&mb_bitmask_gb);
-
-            if (s->restart_interval && !s->restart_count)
-                s->restart_count = s->restart_interval;
+        if (s->restart_interval && !s->restart_count)
+            s->restart_count = s->restart_interval;
 
-            if (get_bits_left(&s->gb) < 0) {
-                av_log(s->avctx, AV_LOG_ERROR, "overread %d\n",
-                       -get_bits_left(&s->gb));
-                return AVERROR_INVALIDDATA;
-            }
-            for (i = 0; i < nb_components; i++) {
-                uint8_t *ptr;
-                int n, h, v, x, y, c, j;
-                int block_offset;
-                n = s->nb_blocks[i];
-                c = s->comp_index[i];
-                h = s->h_scount[i];
-                v = s->v_scount[i];
-                x = 0;
-                y = 0;
-                for (j = 0; j < n; j++) {
-                    block_offset = (((linesize[c] * (v * mb_y + y) * 8) +
-                                     (h * mb_x + x) * 8) >> s->avctx->lowres);
-
-                    if (s->interlaced && s->bottom_field)
-                        block_offset += linesize[c] >> 1;
-                    ptr = data[c] + block_offset;
-                    if (!s->progressive) {
-                        if (copy_mb)
-                            mjpeg_copy_block(s, ptr, reference_data[c] + block_offset,
-                                             linesize[c], s->avctx->lowres);
-
-                        else {
-                            s->dsp.clear_block(s->block);
-                            if (decode_block(s, s->block, i,
-                                             s->dc_index[i], s->ac_index[i],
-                                             s->quant_matrixes[s->quant_index[c]]) < 0) {
-                                av_log(s->avctx, AV_LOG_ERROR,
-                                       "error y=%d x=%d\n", mb_y, mb_x);
-                                return AVERROR_INVALIDDATA;
-                            }
-                            s->dsp.idct_put(ptr, linesize[c], s->block);
-                        }
-                    } else {
-                        int block_idx  = s->block_stride[c] * (v * mb_y + y) +
-                                         (h * mb_x + x);
-                        int16_t *block = s->blocks[c][block_idx];
-                        if (Ah)
-                            block[0] += get_bits1(&s->gb) *
-                                        s->quant_matrixes[s->quant_index[c]][0] << Al;
-                        else if (decode_dc_progressive(s, block, i, s->dc_index[i],
-                                                       s->quant_matrixes[s->quant_index[c]],
-                                                       Al) < 0) {
+        if (get_bits_left(&s->gb) < 0) {
+            av_log(s->avctx, AV_LOG_ERROR, "overread %d\n",
+                   -get_bits_left(&s->gb));
+            return AVERROR_INVALIDDATA;
+        }
+        for (i = 0; i < sc->nb_components; i++) {
+            uint8_t *ptr;
+            int n, h, v, x, y, c, j;
+            int block_offset;
+            n = s->nb_blocks[i];
+            c = s->comp_index[i];
+            h = s->h_scount[i];
+            v = s->v_scount[i];
+            x = 0;
+            y = 0;
+            for (j = 0; j < n; j++) {
+                block_offset = (((sc->linesize[c] * (v * mb_y + y) * 8) +
+                                 (h * mb_x + x) * 8) >> s->avctx->lowres);
+
+                if (s->interlaced && s->bottom_field)
+                    block_offset += sc->linesize[c] >> 1;
+                ptr = sc->data[c] + block_offset;
+                if (!s->progressive) {
+                    if (copy_mb)
+                        mjpeg_copy_block(s, ptr, sc->reference_data[c] + block_offset,
+                                         sc->linesize[c], s->avctx->lowres);
+
+                    else {
+                        s->dsp.clear_block(s->block);
+                        if (decode_block(s, s->block, i,
+                                         s->dc_index[i], s->ac_index[i],
+                                         s->quant_matrixes[s->quant_index[c]]) < 0) {
                             av_log(s->avctx, AV_LOG_ERROR,
                                    "error y=%d x=%d\n", mb_y, mb_x);
                             return AVERROR_INVALIDDATA;
                         }
+                        s->dsp.idct_put(ptr, sc->linesize[c], s->block);
                     }
-                    av_dlog(s->avctx, "mb: %d %d processed\n", mb_y, mb_x);
-                    av_dlog(s->avctx, "%d %d %d %d %d %d %d %d \n",
-                            mb_x, mb_y, x, y, c, s->bottom_field,
-                            (v * mb_y + y) * 8, (h * mb_x + x) * 8);
-                    if (++x == h) {
-                        x = 0;
-                        y++;
+                } else {
+                    int block_idx  = s->block_stride[c] * (v * mb_y + y) +
+                                     (h * mb_x + x);
+                    int16_t *block = s->blocks[c][block_idx];
+                    if (sc->Ah)
+                        block[0] += get_bits1(&s->gb) *
+                                    s->quant_matrixes[s->quant_index[c]][0] << sc->Al;
+                    else if (decode_dc_progressive(s, block, i, s->dc_index[i],
+                                                   s->quant_matrixes[s->quant_index[c]],
+                                                   sc->Al) < 0) {
+                        av_log(s->avctx, AV_LOG_ERROR,
+                               "error y=%d x=%d\n", mb_y, mb_x);
+                        return AVERROR_INVALIDDATA;
                     }
                 }
+                av_dlog(s->avctx, "mb: %d %d processed\n", mb_y, mb_x);
+                av_dlog(s->avctx, "%d %d %d %d %d %d %d %d \n",
+                        mb_x, mb_y, x, y, c, s->bottom_field,
+                        (v * mb_y + y) * 8, (h * mb_x + x) * 8);
+                if (++x == h) {
+                    x = 0;
+                    y++;
+                }
             }
+        }
+
+        handle_rstn(s, sc->nb_components);
 
-            handle_rstn(s, nb_components);
+        if (++mb_x == s->mb_width) {
+            mb_x = 0;
+            mb_y++;
         }
     }
     return 0;
 }
 
+static int mjpeg_decode_restart_interval(AVCodecContext *avctx, void *arg,
+                                         int jobnr, int threadnr)
+{
+    MJpegDecodeContext *s = avctx->priv_data;
+    MJpegDecodeContext *t = &s->thread_ctx[threadnr];
+    MJpegScan *sc = arg;
+    const uint8_t *start, *end;
+    int i, ret;
+
+    start = jobnr ? s->buffer + s->restart_offsets[sc->first_offset + jobnr - 1]
+                  : sc->start;
+    end   = jobnr < sc->nb_intervals - 1
+            ? s->buffer + s->restart_offsets[sc->first_offset + jobnr]
+            : s->gb.buffer + (s->gb.size_in_bits >> 3);
+    init_get_bits8(&t->gb, start, end - start);
+
+    /* every interval after a RSTn marker restarts DC prediction */
+    if (jobnr)
+        for (i = 0; i < sc->nb_components; i++)
+            t->last_dc[i] = 1024;
+    t->restart_count = 0;
+
+    ret = mjpeg_decode_mcus(t, sc, jobnr * s->restart_interval,
+                            FFMIN((jobnr + 1) * s->restart_interval,
+                                  s->mb_width * s->mb_height));
+    if (ret < 0)
+        t->restart_error = ret;
+
+    if (jobnr == sc->nb_intervals - 1) {
+        sc->end_gb = t->gb;
+        sc->end_restart_count = t->restart_count;
+    }
+    return 0;
+}
+
+/**
+ * Check whether the restart intervals of the scan starting at the current
+ * reader position can be decoded independently, and set up sc for it.
+ */
+static int mjpeg_can_decode_intervals(MJpegDecodeContext *s, MJpegScan *sc)
+{
+    int i, pos, nb_mcus = s->mb_width * s->mb_height;
+
+    if (!(s->avctx->active_thread_type & FF_THREAD_SLICE) ||
+        s->avctx->thread_count < 2 || !s->restart_interval ||
+        s->restart_count || s->nb_restart_offsets <= 0 ||
+        s->gb.buffer != s->buffer || get_bits_count(&s->gb) & 7)
+        return 0;
+
+    sc->nb_intervals = (nb_mcus + s->restart_interval - 1) / s->restart_interval;
+    if (sc->nb_intervals < 2)
+        return 0;
+
+    pos       = get_bits_count(&s->gb) >> 3;
+    sc->start = s->buffer + pos;
+    for (i = 0; i < s->nb_restart_offsets && s->restart_offsets[i] <= pos; i++)
+        ;
+    sc->first_offset = i;
+    if (s->nb_restart_offsets - i < sc->nb_intervals - 1)
+        return 0;
+
+    /* the markers have to be numbered consecutively, otherwise the serial
+     * path is needed to stay in sync */
+    for (i = 0; i < sc->nb_intervals - 1; i++) {
+        int offset = s->restart_offsets[sc->first_offset + i];
+        if (s->buffer[offset - 1] != 0xd0 + (i & 7) ||
+            (i && offset <= s->restart_offsets[sc->first_offset + i - 1]))
+            return 0;
+    }
+
+    if (!s->thread_ctx) {
+        s->thread_ctx = av_malloc_array(s->avctx->thread_count, sizeof(*s->thread_ctx));
+        if (!s->thread_ctx)
+            return 0;
+    }
+    return 1;
+}
+
+static int mjpeg_decode_scan(MJpegDecodeContext *s, int nb_components, int Ah,
+                             int Al, const uint8_t *mb_bitmask,
+                             const AVFrame *reference)
+{
+    int i;
+    MJpegScan sc = { 0 };
+
+    if (s->flipped && s->avctx->lowres) {
+        av_log(s->avctx, AV_LOG_ERROR, "Can not flip image with lowres\n");
+        s->flipped = 0;
+    }
+
+    sc.nb_components = nb_components;
+    sc.Ah            = Ah;
+    sc.Al            = Al;
+    sc.mb_bitmask    = mb_bitmask;
+    for (i = 0; i < nb_components; i++) {
+        int c   = s->comp_index[i];
+        sc.data[c] = s->picture_ptr->data[c];
+        sc.reference_data[c] = reference ? reference->data[c] : NULL;
+        sc.linesize[c] = s->linesize[c];
+        s->coefs_finished[c] |= 1;
+        if (s->flipped && !(s->avctx->flags & CODEC_FLAG_EMU_EDGE)) {
+            // picture should be flipped upside-down for this codec
+            int offset = (sc.linesize[c] * (s->v_scount[i] *
+                         (8 * s->mb_height - ((s->height / s->v_max) & 7)) - 1));
+            sc.data[c]           += offset;
+            sc.reference_data[c] += offset;
+            sc.linesize[c]       *= -1;
+        }
+    }
+
+    if (!s->progressive && mjpeg_can_decode_intervals(s, &sc)) {
+        int ret = 0;
+
+        for (i = 0; i < s->avctx->thread_count; i++)
+            s->thread_ctx[i] = *s;
+        s->avctx->execute2(s->avctx, mjpeg_decode_restart_interval, &sc,
+                           NULL, sc.nb_intervals);
+        for (i = 0; i < s->avctx->thread_count; i++)
+            if (s->thread_ctx[i].restart_error < 0)
+                ret = s->thread_ctx[i].restart_error;
+
+        /* continue after the last interval as the serial decoder would */
+        skip_bits_long(&s->gb, (sc.end_gb.buffer - s->gb.buffer) * 8 +
+                               get_bits_count(&sc.end_gb) - get_bits_count(&s->gb));
+        s->restart_count = sc.end_restart_count;
+        return ret;
+    }
+
+    return mjpeg_decode_mcus(s, &sc, 0, s->mb_width * s->mb_height);
+}
+
 static int mjpeg_decode_scan_progressive_ac(MJpegDecodeContext *s, int ss,
                                             int se, int Ah, int Al)
 {
@@ -1550,6 +1688,23 @@ found:
     return val;
 }
 
+/* remember where the entropy-coded segment after a RSTn marker starts */
+static void add_restart_offset(MJpegDecodeContext *s, int offset)
+{
+    int *tmp;
+
+    if (s->nb_restart_offsets < 0)
+        return;
+    tmp = av_fast_realloc(s->restart_offsets, &s->restart_offsets_size,
+                          (s->nb_restart_offsets + 1) * sizeof(*s->restart_offsets));
+    if (!tmp) {
+        s->nb_restart_offsets = -1;
+        return;
+    }
+    s->restart_offsets = tmp;
+    s->restart_offsets[s->nb_restart_offsets++] = offset;
+}
+
 int ff_mjpeg_find_marker(MJpegDecodeContext *s,
                          const uint8_t **buf_ptr, const uint8_t *buf_end,
                          const uint8_t **unescaped_buf_ptr,
@@ -1567,6 +1722,7 @@ int ff_mjpeg_find_marker(MJpegDecodeContext *s,
         const uint8_t *src = *buf_ptr;
         uint8_t *dst = s->buffer;
 
+        s->nb_restart_offsets = 0;
         while (src < buf_end) {
             uint8_t x = *(src++);
 
@@ -1576,9 +1732,10 @@ int ff_mjpeg_find_marker(MJpegDecodeContext *s,
                     while (src < buf_end && x == 0xff)
                         x = *(src++);
 
-                    if (x >= 0xd0 && x <= 0xd7)
+                    if (x >= 0xd0 && x <= 0xd7) {
                         *(dst++) = x;
-                    else if (x)
+                        add_restart_offset(s, dst - s->buffer);
+                    } else if (x)
                         break;
                 }
             }
@@ -1894,10 +2051,13 @@ av_cold int ff_mjpeg_decode_end(AVCodecContext *avctx)
     av_free(s->buffer);
     av_freep(&s->ljpeg_buffer);
     s->ljpeg_buffer_size = 0;
+    av_freep(&s->restart_offsets);
+    s->restart_offsets_size = 0;
+    av_freep(&s->thread_ctx);
 
     for (i = 0; i < 3; i++) {
         for (j = 0; j < 4; j++)
-            ff_free_vlc(&s->vlcs[i][j]);
+            ff_free_vlc_shared(&s->vlcs[i][j]);
     }
     for (i = 0; i < MAX_COMPONENTS; i++) {
         av_freep(&s->blocks[i]);
@@ -1937,7 +2097,7 @@ AVCodec ff_mjpeg_decoder = {
     .close          = ff_mjpeg_decode_end,
     .decode         = ff_mjpeg_decode_frame,
     .flush          = decode_flush,
-    .capabilities   = CODEC_CAP_DR1,
+    .capabilities   = CODEC_CAP_DR1 | CODEC_CAP_SLICE_THREADS,
     .max_lowres     = 3,
     .long_name      = NULL_IF_CONFIG_SMALL("MJPEG (Motion JPEG)"),
     .priv_class     = &mjpegdec_class,
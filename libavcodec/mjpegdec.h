@@ -102,6 +102,11 @@ typedef struct MJpegDecodeContext {
 
     int restart_interval;
     int restart_count;
+    int *restart_offsets;               ///< byte offsets after each RSTn marker of the current scan
+    int nb_restart_offsets;             ///< -1 if the offsets could not be stored
+    unsigned int restart_offsets_size;
+    struct MJpegDecodeContext *thread_ctx; ///< per-thread copies for restart interval decoding
+    int restart_error;
 
     int buggy_avid;
     int cs_itu601;
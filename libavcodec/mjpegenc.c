@@ -396,7 +396,30 @@ void ff_mjpeg_encode_dc(MpegEncContext *s, int val,
     }
 }
 
-static void encode_block(MpegEncContext *s, int16_t *block, int n)
+static av_always_inline void encode_dc(PutBitContext64 *pb, int val,
+                                       const uint8_t *huff_size,
+                                       const uint16_t *huff_code)
+{
+    int mant, nbits;
+
+    if (val == 0) {
+        put_bits64(pb, huff_size[0], huff_code[0]);
+    } else {
+        mant = val;
+        if (val < 0) {
+            val = -val;
+            mant--;
+        }
+
+        nbits= av_log2_16bit(val) + 1;
+
+        put_bits64(pb, huff_size[nbits] + nbits,
+                   (huff_code[nbits] << nbits) | (mant & ((1 << nbits) - 1)));
+    }
+}
+
+static void encode_block(MpegEncContext *s, PutBitContext64 *pb,
+                         int16_t *block, int n)
 {
     int mant, nbits, code, i, j;
     int component, dc, run, last_index, val;
@@ -409,11 +432,11 @@ static void encode_block(MpegEncContext *s, int16_t *block, int n)
     dc = block[0]; /* overflow is impossible */
     val = dc - s->last_dc[component];
     if (n < 4) {
-        ff_mjpeg_encode_dc(s, val, m->huff_size_dc_luminance, m->huff_code_dc_luminance);
+        encode_dc(pb, val, m->huff_size_dc_luminance, m->huff_code_dc_luminance);
         huff_size_ac = m->huff_size_ac_luminance;
         huff_code_ac = m->huff_code_ac_luminance;
     } else {
-        ff_mjpeg_encode_dc(s, val, m->huff_size_dc_chrominance, m->huff_code_dc_chrominance);
+        encode_dc(pb, val, m->huff_size_dc_chrominance, m->huff_code_dc_chrominance);
         huff_size_ac = m->huff_size_ac_chrominance;
         huff_code_ac = m->huff_code_ac_chrominance;
     }
@@ -430,7 +453,7 @@ static void encode_block(MpegEncContext *s, int16_t *block, int n)
             run++;
         } else {
             while (run >= 16) {
-                put_bits(&s->pb, huff_size_ac[0xf0], huff_code_ac[0xf0]);
+                put_bits64(pb, huff_size_ac[0xf0], huff_code_ac[0xf0]);
                 run -= 16;
             }
             mant = val;
@@ -442,49 +465,53 @@ static void encode_block(MpegEncContext *s, int16_t *block, int n)
             nbits= av_log2(val) + 1;
             code = (run << 4) | nbits;
 
-            put_bits(&s->pb, huff_size_ac[code], huff_code_ac[code]);
-
-            put_sbits(&s->pb, nbits, mant);
+            /* the code and the mantissa fit in one write */
+            put_bits64(pb, huff_size_ac[code] + nbits,
+                       (huff_code_ac[code] << nbits) | (mant & ((1 << nbits) - 1)));
             run = 0;
         }
     }
 
     /* output EOB only if not already 64 values */
     if (last_index < 63 || run != 0)
-        put_bits(&s->pb, huff_size_ac[0], huff_code_ac[0]);
+        put_bits64(pb, huff_size_ac[0], huff_code_ac[0]);
 }
 
 void ff_mjpeg_encode_mb(MpegEncContext *s, int16_t block[6][64])
 {
+    PutBitContext64 pb;
     int i;
+
+    init_put_bits64(&pb, &s->pb);
     if (s->chroma_format == CHROMA_444) {
-        encode_block(s, block[0], 0);
-        encode_block(s, block[2], 2);
-        encode_block(s, block[4], 4);
-        encode_block(s, block[8], 8);
-        encode_block(s, block[5], 5);
-        encode_block(s, block[9], 9);
+        encode_block(s, &pb, block[0], 0);
+        encode_block(s, &pb, block[2], 2);
+        encode_block(s, &pb, block[4], 4);
+        encode_block(s, &pb, block[8], 8);
+        encode_block(s, &pb, block[5], 5);
+        encode_block(s, &pb, block[9], 9);
 
         if (16*s->mb_x+8 < s->width) {
-            encode_block(s, block[1], 1);
-            encode_block(s, block[3], 3);
-            encode_block(s, block[6], 6);
-            encode_block(s, block[10], 10);
-            encode_block(s, block[7], 7);
-            encode_block(s, block[11], 11);
+            encode_block(s, &pb, block[1], 1);
+            encode_block(s, &pb, block[3], 3);
+            encode_block(s, &pb, block[6], 6);
+            encode_block(s, &pb, block[10], 10);
+            encode_block(s, &pb, block[7], 7);
+            encode_block(s, &pb, block[11], 11);
         }
     } else {
         for(i=0;i<5;i++) {
-            encode_block(s, block[i], i);
+            encode_block(s, &pb, block[i], i);
         }
         if (s->chroma_format == CHROMA_420) {
-            encode_block(s, block[5], 5);
+            encode_block(s, &pb, block[5], 5);
         } else {
-            encode_block(s, block[6], 6);
-            encode_block(s, block[5], 5);
-            encode_block(s, block[7], 7);
+            encode_block(s, &pb, block[6], 6);
+            encode_block(s, &pb, block[5], 5);
+            encode_block(s, &pb, block[7], 7);
         }
     }
+    sync_put_bits64(&pb, &s->pb);
 
     s->i_tex_bits += get_bits_diff(s);
 }
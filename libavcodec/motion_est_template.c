@@ -410,6 +410,81 @@ if( (y)>(ymax<<(S)) ) av_log(NULL, AV_LOG_ERROR, "%d %d %d %d %d ymax" #v, ymax,
     const int qpel= flags&FLAG_QPEL;\
     const int shift= 1+qpel;\
 
+#define ADD_MV_X4(x,y,new_dir)\
+{\
+    const unsigned key = ((y)<<ME_MAP_MV_BITS) + (x) + map_generation;\
+    const int index= (((y)<<ME_MAP_SHIFT) + (x))&(ME_MAP_SIZE-1);\
+    if(map[index]!=key){\
+        cand[n][0]= x;\
+        cand[n][1]= y;\
+        cand[n][2]= new_dir;\
+        refs[n]= ref + (x) + (y)*stride;\
+        n++;\
+    }\
+}
+
+/**
+ * small_diamond_search() for plain 16x16 SAD, scoring all unvisited
+ * neighbours of the current best vector with one sad16_x4() call.
+ * The neighbours never share a map entry, so scoring them together and
+ * then checking them in the usual order finds the same vector.
+ */
+static int small_diamond_search_x4(MpegEncContext * s, int *best, int dmin,
+                                   int src_index, int ref_index, int const penalty_factor,
+                                   int h, int flags)
+{
+    MotionEstContext * const c= &s->me;
+    const int stride= c->stride;
+    uint8_t * const ref= c->ref[ref_index][0];
+    uint8_t * const src= c->src[src_index][0];
+    int next_dir=-1;
+    LOAD_COMMON
+    LOAD_COMMON2
+    unsigned map_generation = c->map_generation;
+
+    for(;;){
+        int cand[4][3], scores[4], i, n= 0;
+        uint8_t *refs[4];
+        const int dir= next_dir;
+        const int x= best[0];
+        const int y= best[1];
+        next_dir=-1;
+
+        if(dir!=2 && x>xmin) ADD_MV_X4(x-1, y  , 0)
+        if(dir!=3 && y>ymin) ADD_MV_X4(x  , y-1, 1)
+        if(dir!=0 && x<xmax) ADD_MV_X4(x+1, y  , 2)
+        if(dir!=1 && y<ymax) ADD_MV_X4(x  , y+1, 3)
+
+        if(n > 1){
+            for(i=n; i<4; i++)
+                refs[i]= refs[0];
+            s->dsp.sad16_x4(src, refs, stride, h, scores);
+        }else if(n){
+            scores[0]= s->dsp.sad[0](s, src, refs[0], stride, h);
+        }
+
+        for(i=0; i<n; i++){
+            const int mx= cand[i][0];
+            const int my= cand[i][1];
+            const int index= ((my<<ME_MAP_SHIFT) + mx)&(ME_MAP_SIZE-1);
+            int d= scores[i];
+            map[index]= (my<<ME_MAP_MV_BITS) + mx + map_generation;
+            score_map[index]= d;
+            d += (mv_penalty[(mx<<shift)-pred_x] + mv_penalty[(my<<shift)-pred_y])*penalty_factor;
+            if(d<dmin){
+                best[0]=mx;
+                best[1]=my;
+                dmin=d;
+                next_dir= cand[i][2];
+            }
+        }
+
+        if(next_dir==-1){
+            return dmin;
+        }
+    }
+}
+
 static av_always_inline int small_diamond_search(MpegEncContext * s, int *best, int dmin,
                                        int src_index, int ref_index, int const penalty_factor,
                                        int size, int h, int flags)
@@ -433,6 +508,11 @@ static av_always_inline int small_diamond_search(MpegEncContext * s, int *best,
         }
     }
 
+    if(s->dsp.sad16_x4 && cmpf == s->dsp.sad[0] && size == 0
+       && !(flags&(FLAG_CHROMA|FLAG_DIRECT)))
+        return small_diamond_search_x4(s, best, dmin, src_index, ref_index,
+                                       penalty_factor, h, flags);
+
     for(;;){
         int d;
         const int dir= next_dir;
@@ -599,6 +599,8 @@ static void free_duplicate_context(MpegEncContext *s)
     av_freep(&s->me.score_map);
     av_freep(&s->blocks);
     av_freep(&s->ac_val_base);
+    av_freep(&s->rtp_gobs);
+    s->rtp_gobs_size = 0;
     s->block = NULL;
 }
 
@@ -626,6 +628,9 @@ static void backup_duplicate_context(MpegEncContext *bak, MpegEncContext *src)
     COPY(ac_val[0]);
     COPY(ac_val[1]);
     COPY(ac_val[2]);
+    COPY(rtp_gobs);
+    COPY(rtp_gobs_size);
+    COPY(nb_rtp_gobs);
 #undef COPY
 }
 
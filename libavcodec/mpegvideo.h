@@ -239,6 +239,16 @@ typedef struct MotionEstContext{
                                   int size, int h);
 }MotionEstContext;
 
+/**
+ * A GOB / slice encoded by a slice thread, waiting to be passed to
+ * AVCodecContext.rtp_callback.
+ */
+typedef struct RTPGob {
+    uint8_t *data;
+    int size;
+    int mb_nb;
+} RTPGob;
+
 /**
  * MpegEncContext.
  */
@@ -698,6 +708,9 @@ typedef struct MpegEncContext {
     AVTimecode tc;           ///< timecode context
 
     uint8_t *ptr_lastgob;
+    RTPGob *rtp_gobs;        ///< GOBs waiting for rtp_callback, slice threads only
+    unsigned int rtp_gobs_size;
+    int nb_rtp_gobs;
     int swap_uv;             //vcr2 codec is an MPEG-2 variant with U and V swapped
     int16_t (*pblocks[12])[64];
 
@@ -43,6 +43,7 @@
 #include "mjpegenc.h"
 #include "msmpeg4.h"
 #include "faandct.h"
+#include "frame_thread_encoder.h"
 #include "thread.h"
 #include "aandcttab.h"
 #include "flv.h"
@@ -1135,57 +1136,136 @@ static int encode_frame(AVCodecContext *c, AVFrame *frame)
     return ret;
 }
 
+typedef struct BCountContext {
+    AVFrame input[FF_MAX_B_FRAMES + 2];
+    AVCodecContext *c[FF_MAX_B_FRAMES + 1];
+    int64_t rd[FF_MAX_B_FRAMES + 1];
+    int max_b_frames;
+    int p_lambda, b_lambda, lambda2;
+} BCountContext;
+
+/**
+ * Encode the downscaled sequence with jobnr B-frames between the P-frames
+ * and store its rate-distortion cost. Every candidate has its own encoder
+ * context, so the candidates can be tried concurrently.
+ */
+static int estimate_b_count_thread(AVCodecContext *avctx, void *arg,
+                                   int jobnr, int threadnr)
+{
+    BCountContext *b  = arg;
+    AVCodecContext *c = b->c[jobnr];
+    AVFrame frame;
+    int64_t rd = 0;
+    int i, out_size;
+
+    frame           = b->input[0];
+    frame.pict_type = AV_PICTURE_TYPE_I;
+    frame.quality   = 1 * FF_QP2LAMBDA;
+
+    out_size = encode_frame(c, &frame);
+
+    //rd += (out_size * b->lambda2) >> FF_LAMBDA_SHIFT;
+
+    for (i = 0; i < b->max_b_frames + 1; i++) {
+        int is_p = i % (jobnr + 1) == jobnr || i == b->max_b_frames;
+
+        frame           = b->input[i + 1];
+        frame.pict_type = is_p ? AV_PICTURE_TYPE_P : AV_PICTURE_TYPE_B;
+        frame.quality   = is_p ? b->p_lambda : b->b_lambda;
+
+        out_size = encode_frame(c, &frame);
+
+        rd += (out_size * b->lambda2) >> (FF_LAMBDA_SHIFT - 3);
+    }
+
+    /* get the delayed frames */
+    while (out_size > 0) {
+        out_size = encode_frame(c, NULL);
+        rd += (out_size * b->lambda2) >> (FF_LAMBDA_SHIFT - 3);
+    }
+
+    rd += c->error[0] + c->error[1] + c->error[2];
+
+    b->rd[jobnr] = rd;
+
+    return 0;
+}
+
 static int estimate_best_b_count(MpegEncContext *s)
 {
     AVCodec *codec    = avcodec_find_encoder(s->avctx->codec_id);
-    AVCodecContext *c = avcodec_alloc_context3(NULL);
-    AVFrame input[FF_MAX_B_FRAMES + 2];
-    const int scale = s->avctx->brd_scale;
-    int i, j, out_size, p_lambda, b_lambda, lambda2;
+    BCountContext b;
+    const int scale   = s->avctx->brd_scale;
+    const int width   = s->width  >> scale;
+    const int height  = s->height >> scale;
+    int i, j, nb_candidates, ret = 0;
     int64_t best_rd  = INT64_MAX;
     int best_b_count = -1;
 
     av_assert0(scale >= 0 && scale <= 3);
 
+    memset(&b, 0, sizeof(b));
+
     //emms_c();
     //s->next_picture_ptr->quality;
-    p_lambda = s->last_lambda_for[AV_PICTURE_TYPE_P];
+    b.p_lambda = s->last_lambda_for[AV_PICTURE_TYPE_P];
     //p_lambda * FFABS(s->avctx->b_quant_factor) + s->avctx->b_quant_offset;
-    b_lambda = s->last_lambda_for[AV_PICTURE_TYPE_B];
-    if (!b_lambda) // FIXME we should do this somewhere else
-        b_lambda = p_lambda;
-    lambda2  = (b_lambda * b_lambda + (1 << FF_LAMBDA_SHIFT) / 2) >>
-               FF_LAMBDA_SHIFT;
-
-    c->width        = s->width  >> scale;
-    c->height       = s->height >> scale;
-    c->flags        = CODEC_FLAG_QSCALE | CODEC_FLAG_PSNR |
-                      CODEC_FLAG_INPUT_PRESERVED /*| CODEC_FLAG_EMU_EDGE*/;
-    c->flags       |= s->avctx->flags & CODEC_FLAG_QPEL;
-    c->mb_decision  = s->avctx->mb_decision;
-    c->me_cmp       = s->avctx->me_cmp;
-    c->mb_cmp       = s->avctx->mb_cmp;
-    c->me_sub_cmp   = s->avctx->me_sub_cmp;
-    c->pix_fmt      = AV_PIX_FMT_YUV420P;
-    c->time_base    = s->avctx->time_base;
-    c->max_b_frames = s->max_b_frames;
-
-    if (avcodec_open2(c, codec, NULL) < 0)
-        return -1;
+    b.b_lambda = s->last_lambda_for[AV_PICTURE_TYPE_B];
+    if (!b.b_lambda) // FIXME we should do this somewhere else
+        b.b_lambda = b.p_lambda;
+    b.lambda2  = (b.b_lambda * b.b_lambda + (1 << FF_LAMBDA_SHIFT) / 2) >>
+                 FF_LAMBDA_SHIFT;
+    b.max_b_frames = s->max_b_frames;
+
+    for (nb_candidates = 0; nb_candidates < s->max_b_frames + 1; nb_candidates++)
+        if (!s->input_picture[nb_candidates])
+            break;
+
+    /* Opening takes the global codec lock, so it is done here rather than
+     * in the concurrently running jobs. */
+    for (j = 0; j < nb_candidates; j++) {
+        AVCodecContext *c = avcodec_alloc_context3(NULL);
+        if (!c) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+        b.c[j] = c;
+
+        c->width        = width;
+        c->height       = height;
+        c->flags        = CODEC_FLAG_QSCALE | CODEC_FLAG_PSNR |
+                          CODEC_FLAG_INPUT_PRESERVED /*| CODEC_FLAG_EMU_EDGE*/;
+        c->flags       |= s->avctx->flags & CODEC_FLAG_QPEL;
+        c->mb_decision  = s->avctx->mb_decision;
+        c->me_cmp       = s->avctx->me_cmp;
+        c->mb_cmp       = s->avctx->mb_cmp;
+        c->me_sub_cmp   = s->avctx->me_sub_cmp;
+        c->pix_fmt      = AV_PIX_FMT_YUV420P;
+        c->time_base    = s->avctx->time_base;
+        c->max_b_frames = s->max_b_frames;
+
+        if ((ret = avcodec_open2(c, codec, NULL)) < 0)
+            goto fail;
+    }
 
+    /* The downscaled pictures are shared read-only by all candidates. */
     for (i = 0; i < s->max_b_frames + 2; i++) {
-        int ysize = c->width * c->height;
-        int csize = (c->width / 2) * (c->height / 2);
+        int ysize = width * height;
+        int csize = (width / 2) * (height / 2);
         Picture pre_input, *pre_input_ptr = i ? s->input_picture[i - 1] :
                                                 s->next_picture_ptr;
 
-        avcodec_get_frame_defaults(&input[i]);
-        input[i].data[0]     = av_malloc(ysize + 2 * csize);
-        input[i].data[1]     = input[i].data[0] + ysize;
-        input[i].data[2]     = input[i].data[1] + csize;
-        input[i].linesize[0] = c->width;
-        input[i].linesize[1] =
-        input[i].linesize[2] = c->width / 2;
+        avcodec_get_frame_defaults(&b.input[i]);
+        b.input[i].data[0]     = av_mallocz(ysize + 2 * csize);
+        if (!b.input[i].data[0]) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+        b.input[i].data[1]     = b.input[i].data[0] + ysize;
+        b.input[i].data[2]     = b.input[i].data[1] + csize;
+        b.input[i].linesize[0] = width;
+        b.input[i].linesize[1] =
+        b.input[i].linesize[2] = width / 2;
 
         if (pre_input_ptr && (!i || s->input_picture[i - 1])) {
             pre_input = *pre_input_ptr;
@@ -1196,67 +1276,40 @@ static int estimate_best_b_count(MpegEncContext *s)
                 pre_input.f.data[2] += INPLACE_OFFSET;
             }
 
-            s->dsp.shrink[scale](input[i].data[0], input[i].linesize[0],
+            s->dsp.shrink[scale](b.input[i].data[0], b.input[i].linesize[0],
                                  pre_input.f.data[0], pre_input.f.linesize[0],
-                                 c->width,      c->height);
-            s->dsp.shrink[scale](input[i].data[1], input[i].linesize[1],
+                                 width,      height);
+            s->dsp.shrink[scale](b.input[i].data[1], b.input[i].linesize[1],
                                  pre_input.f.data[1], pre_input.f.linesize[1],
-                                 c->width >> 1, c->height >> 1);
-            s->dsp.shrink[scale](input[i].data[2], input[i].linesize[2],
+                                 width >> 1, height >> 1);
+            s->dsp.shrink[scale](b.input[i].data[2], b.input[i].linesize[2],
                                  pre_input.f.data[2], pre_input.f.linesize[2],
-                                 c->width >> 1, c->height >> 1);
+                                 width >> 1, height >> 1);
         }
     }
 
-    for (j = 0; j < s->max_b_frames + 1; j++) {
-        int64_t rd = 0;
-
-        if (!s->input_picture[j])
-            break;
-
-        c->error[0] = c->error[1] = c->error[2] = 0;
-
-        input[0].pict_type = AV_PICTURE_TYPE_I;
-        input[0].quality   = 1 * FF_QP2LAMBDA;
-
-        out_size = encode_frame(c, &input[0]);
-
-        //rd += (out_size * lambda2) >> FF_LAMBDA_SHIFT;
-
-        for (i = 0; i < s->max_b_frames + 1; i++) {
-            int is_p = i % (j + 1) == j || i == s->max_b_frames;
-
-            input[i + 1].pict_type = is_p ?
-                                     AV_PICTURE_TYPE_P : AV_PICTURE_TYPE_B;
-            input[i + 1].quality   = is_p ? p_lambda : b_lambda;
-
-            out_size = encode_frame(c, &input[i + 1]);
+    s->avctx->execute2(s->avctx, estimate_b_count_thread, &b, NULL,
+                       nb_candidates);
 
-            rd += (out_size * lambda2) >> (FF_LAMBDA_SHIFT - 3);
-        }
-
-        /* get the delayed frames */
-        while (out_size) {
-            out_size = encode_frame(c, NULL);
-            rd += (out_size * lambda2) >> (FF_LAMBDA_SHIFT - 3);
-        }
-
-        rd += c->error[0] + c->error[1] + c->error[2];
-
-        if (rd < best_rd) {
-            best_rd = rd;
+    for (j = 0; j < nb_candidates; j++) {
+        if (b.rd[j] < best_rd) {
+            best_rd = b.rd[j];
             best_b_count = j;
         }
     }
 
-    avcodec_close(c);
-    av_freep(&c);
+fail:
+    for (j = 0; j < nb_candidates; j++) {
+        if (b.c[j])
+            avcodec_close(b.c[j]);
+        av_freep(&b.c[j]);
+    }
 
     for (i = 0; i < s->max_b_frames + 2; i++) {
-        av_freep(&input[i].data[0]);
+        av_freep(&b.input[i].data[0]);
     }
 
-    return best_b_count;
+    return ret < 0 ? -1 : best_b_count;
 }
 
 static int select_input_picture(MpegEncContext *s)
@@ -1500,8 +1553,10 @@ vbv_retry:
             RateControlContext *rcc = &s->rc_context;
             int max_size = rcc->buffer_index * avctx->rc_max_available_vbv_use;
 
+            /* the slices already passed to rtp_callback cannot be
+             * encoded again */
             if (put_bits_count(&s->pb) > max_size &&
-                s->lambda < s->avctx->lmax) {
+                s->lambda < s->avctx->lmax && !avctx->rtp_callback) {
                 s->next_lambda = FFMAX(s->lambda + 1, s->lambda *
                                        (s->qscale + 1) / s->qscale);
                 if (s->adaptive_quant) {
@@ -1647,6 +1702,53 @@ vbv_retry:
     return 0;
 }
 
+/**
+ * Prepare a frame threading worker for coding an independent closed GOP.
+ *
+ * The worker only sees every n-th GOP, so its picture counters, timestamps
+ * and bit count are resynchronized with the position of the GOP in the whole
+ * stream. The bit count is taken from the parent context, which accounts for
+ * the GOPs that were already returned; the frames still being coded by other
+ * workers are assumed to hit their target size. The VBV model stays local to
+ * the worker: all GOPs aim at the same size, and resyncing it with the
+ * delayed state of the parent makes the workers oscillate in lockstep.
+ */
+void ff_MPV_encode_gop_start(AVCodecContext *avctx, AVCodecContext *parent,
+                             int picture_number, int nb_frames,
+                             int64_t prev_pts, int frames_in_flight)
+{
+    MpegEncContext *s  = avctx->priv_data;
+    MpegEncContext *ps = parent->priv_data;
+    double frame_duration = av_q2d(avctx->time_base) *
+                            FFMAX(avctx->ticks_per_frame, 1);
+
+    s->input_picture_number = picture_number;
+    s->coded_picture_number = picture_number;
+    if (prev_pts != AV_NOPTS_VALUE) {
+        s->user_specified_pts = prev_pts;
+        s->reordered_pts      = prev_pts;
+    }
+
+    /* the GOP ends when the worker is flushed, never inside it */
+    s->gop_size = nb_frames + s->max_b_frames + 1;
+
+    s->total_bits = ps->total_bits +
+                    (int64_t)(s->bit_rate * frames_in_flight * frame_duration);
+}
+
+/**
+ * Account a packet returned by a frame threading worker in the rate control
+ * state of the parent context. Its VBV model follows the assembled stream and
+ * reports the underflows of the actual output.
+ */
+void ff_MPV_encode_gop_feedback(AVCodecContext *parent, int size)
+{
+    MpegEncContext *ps = parent->priv_data;
+
+    ps->total_bits += 8 * size;
+    ff_vbv_update(ps, 8 * size);
+}
+
 static inline void dct_single_coeff_elimination(MpegEncContext *s,
                                                 int n, int threshold)
 {
@@ -2444,6 +2546,47 @@ static void update_mb_info(MpegEncContext *s, int startcode)
     write_mb_info(s);
 }
 
+/**
+ * Pass a GOB / slice to rtp_callback.
+ * The first slice context sends its GOBs as soon as they are encoded, the
+ * other slice threads queue them until the whole picture is encoded, so that
+ * the callback always gets them in bitstream order, see flush_gobs().
+ */
+static void send_gob(MpegEncContext *s, uint8_t *data, int size, int mb_nb)
+{
+    RTPGob *gob;
+
+    if (!s->start_mb_y || !(s->avctx->active_thread_type & FF_THREAD_SLICE)) {
+        emms_c();
+        s->avctx->rtp_callback(s->avctx, data, size, mb_nb);
+        return;
+    }
+
+    gob = av_fast_realloc(s->rtp_gobs, &s->rtp_gobs_size,
+                          (s->nb_rtp_gobs + 1) * sizeof(*s->rtp_gobs));
+    if (!gob) {
+        /* better out of order than lost */
+        emms_c();
+        s->avctx->rtp_callback(s->avctx, data, size, mb_nb);
+        return;
+    }
+    s->rtp_gobs = gob;
+    gob = &s->rtp_gobs[s->nb_rtp_gobs++];
+    gob->data  = data;
+    gob->size  = size;
+    gob->mb_nb = mb_nb;
+}
+
+static void flush_gobs(MpegEncContext *s)
+{
+    int i;
+
+    for (i = 0; i < s->nb_rtp_gobs; i++)
+        s->avctx->rtp_callback(s->avctx, s->rtp_gobs[i].data,
+                               s->rtp_gobs[i].size, s->rtp_gobs[i].mb_nb);
+    s->nb_rtp_gobs = 0;
+}
+
 static int encode_thread(AVCodecContext *c, void *arg){
     MpegEncContext *s= *(void**)arg;
     int mb_x, mb_y, pdif = 0;
@@ -2592,7 +2735,7 @@ static int encode_thread(AVCodecContext *c, void *arg){
 
                     if (s->avctx->rtp_callback){
                         int number_mb = (mb_y - s->resync_mb_y)*s->mb_width + mb_x - s->resync_mb_x;
-                        s->avctx->rtp_callback(s->avctx, s->ptr_lastgob, current_packet_size, number_mb);
+                        send_gob(s, s->ptr_lastgob, current_packet_size, number_mb);
                     }
                     update_mb_info(s, 1);
 
@@ -3074,8 +3217,7 @@ static int encode_thread(AVCodecContext *c, void *arg){
         int number_mb = (mb_y - s->resync_mb_y)*s->mb_width - s->resync_mb_x;
         pdif = put_bits_ptr(&s->pb) - s->ptr_lastgob;
         /* Call the RTP callback to send the last GOB */
-        emms_c();
-        s->avctx->rtp_callback(s->avctx, s->ptr_lastgob, pdif, number_mb);
+        send_gob(s, s->ptr_lastgob, pdif, number_mb);
     }
 
     return 0;
@@ -3414,6 +3556,7 @@ static int encode_picture(MpegEncContext *s, int picture_number)
     }
     s->avctx->execute(s->avctx, encode_thread, &s->thread_context[0], NULL, context_count, sizeof(void*));
     for(i=1; i<context_count; i++){
+        flush_gobs(s->thread_context[i]);
         merge_context_after_encode(s, s->thread_context[i]);
     }
     emms_c();
@@ -70,8 +70,8 @@ static const AVClass *codec_child_class_next(const AVClass *prev)
 static AVClassCategory get_category(void *ptr)
 {
     AVCodecContext* avctx = ptr;
-    if(avctx->codec && avctx->codec->decode) return AV_CLASS_CATEGORY_DECODER;
-    else                                     return AV_CLASS_CATEGORY_ENCODER;
+    if(avctx->codec && av_codec_is_decoder(avctx->codec)) return AV_CLASS_CATEGORY_DECODER;
+    else                                                  return AV_CLASS_CATEGORY_ENCODER;
 }
 
 static const AVClass av_codec_context_class = {
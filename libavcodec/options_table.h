@@ -377,6 +377,9 @@ static const AVOption options[]={
 {"do_nothing",  NULL, 0, AV_OPT_TYPE_CONST, {.i64 = FF_SUB_CHARENC_MODE_DO_NOTHING},  INT_MIN, INT_MAX, S|D, "sub_charenc_mode"},
 {"auto",        NULL, 0, AV_OPT_TYPE_CONST, {.i64 = FF_SUB_CHARENC_MODE_AUTOMATIC},   INT_MIN, INT_MAX, S|D, "sub_charenc_mode"},
 {"pre_decoder", NULL, 0, AV_OPT_TYPE_CONST, {.i64 = FF_SUB_CHARENC_MODE_PRE_DECODER}, INT_MIN, INT_MAX, S|D, "sub_charenc_mode"},
+{"thread_pool", "run slice threads on a worker pool shared by all contexts", OFFSET(thread_pool), AV_OPT_TYPE_INT, {.i64 = 0 }, 0, 1, V|A|E|D},
+{"frame_thread_delay", "maximum number of frames of delay added by frame threading", OFFSET(frame_thread_delay), AV_OPT_TYPE_INT, {.i64 = 0 }, 0, INT_MAX, V|D},
+{"shared_frame_pool", "allocate frames from buffer pools shared by all contexts", OFFSET(shared_frame_pool), AV_OPT_TYPE_INT, {.i64 = 0 }, 0, 1, V|D},
 {"refcounted_frames", NULL, OFFSET(refcounted_frames), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1, A|V|D },
 {NULL},
 };
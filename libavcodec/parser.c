@@ -22,7 +22,9 @@
 
 #include <string.h>
 
+#include "internal.h"
 #include "parser.h"
+#include "libavutil/buffer.h"
 #include "libavutil/mem.h"
 
 static AVCodecParser *av_first_parser = NULL;
@@ -71,6 +73,8 @@ AVCodecParserContext *av_parser_init(int codec_id)
         if (ret != 0)
             goto err_out;
     }
+    if (parser->parser_close == ff_parse_close)
+        s->flags |= PARSER_FLAG_PARSE_CONTEXT;
     s->key_frame = -1;
     s->convergence_duration = 0;
     s->dts_sync_point       = INT_MIN;
@@ -283,6 +287,36 @@ void ff_parse_close(AVCodecParserContext *s)
     av_freep(&pc->buffer);
 }
 
+AVBufferRef *avpriv_parser_ref_output(AVCodecParserContext *s,
+                                      const uint8_t *data, int size)
+{
+    ParseContext *pc = s->priv_data;
+    AVBufferRef *ref;
+    uint8_t *buffer;
+
+    if (!(s->flags & PARSER_FLAG_PARSE_CONTEXT) || !pc->buffer ||
+        pc->index || data < pc->buffer ||
+        data + size > pc->buffer + pc->overread_index)
+        return NULL;
+
+    /* the next frame starts in a new buffer of the same size, with only the
+     * bytes already read from it */
+    buffer = av_malloc(pc->buffer_size);
+    if (!buffer)
+        return NULL;
+    ref = av_buffer_create(pc->buffer, pc->buffer_size,
+                           av_buffer_default_free, NULL, 0);
+    if (!ref) {
+        av_free(buffer);
+        return NULL;
+    }
+    if (pc->overread > 0)
+        memcpy(buffer, pc->buffer + pc->overread_index, pc->overread);
+    pc->buffer         = buffer;
+    pc->overread_index = 0;
+    return ref;
+}
+
 /*************************/
 
 int ff_mpeg4video_split(AVCodecContext *avctx,
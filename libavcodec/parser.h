@@ -39,6 +39,14 @@ typedef struct ParseContext{
 
 #define END_NOT_FOUND (-100)
 
+/**
+ * Set in AVCodecParserContext.flags for the parsers whose private context
+ * starts with their ParseContext, so that the frames combined in its buffer
+ * can be referenced instead of copied, see avpriv_parser_ref_output().
+ * av_parser_init() sets it for the parsers closed with ff_parse_close().
+ */
+#define PARSER_FLAG_PARSE_CONTEXT 0x4000
+
 /**
  * Combine the (truncated) bitstream to a complete frame.
  * @return -1 if no complete frame could be created,
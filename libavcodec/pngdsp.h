@@ -32,6 +32,17 @@ typedef struct PNGDSPContext {
     /* this might write to dst[w] */
     void (*add_paeth_prediction)(uint8_t *dst, uint8_t *src,
                                  uint8_t *top, int w, int bpp);
+
+    /* filters for encoding, starting at the second pixel of a row;
+     * dst must not overlap src or top */
+    void (*sub_avg_prediction)(uint8_t *dst, const uint8_t *src,
+                               const uint8_t *top, int w, int bpp);
+    void (*sub_paeth_prediction)(uint8_t *dst, const uint8_t *src,
+                                 const uint8_t *top, int w, int bpp);
+
+    /* sum of the absolute values of the bytes taken as signed, the cost
+     * of a filtered row for the filter type heuristic */
+    int (*filter_cost)(const uint8_t *buf, int size);
 } PNGDSPContext;
 
 void ff_pngdsp_init(PNGDSPContext *dsp);
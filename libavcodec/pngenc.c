@@ -23,6 +23,7 @@
 #include "bytestream.h"
 #include "dsputil.h"
 #include "png.h"
+#include "pngdsp.h"
 
 #include "libavutil/avassert.h"
 #include "libavutil/opt.h"
@@ -38,6 +39,7 @@
 typedef struct PNGEncContext {
     AVClass *class;
     DSPContext dsp;
+    PNGDSPContext pngdsp;
 
     uint8_t *bytestream;
     uint8_t *bytestream_start;
@@ -91,34 +93,7 @@ static void png_get_interlaced_row(uint8_t *dst, int row_size,
     }
 }
 
-static void sub_png_paeth_prediction(uint8_t *dst, uint8_t *src, uint8_t *top, int w, int bpp)
-{
-    int i;
-    for(i = 0; i < w; i++) {
-        int a, b, c, p, pa, pb, pc;
-
-        a = src[i - bpp];
-        b = top[i];
-        c = top[i - bpp];
-
-        p = b - c;
-        pc = a - c;
-
-        pa = abs(p);
-        pb = abs(pc);
-        pc = abs(p + pc);
-
-        if (pa <= pb && pa <= pc)
-            p = a;
-        else if (pb <= pc)
-            p = b;
-        else
-            p = c;
-        dst[i] = src[i] - p;
-    }
-}
-
-static void png_filter_row(DSPContext *dsp, uint8_t *dst, int filter_type,
+static void png_filter_row(PNGEncContext *s, uint8_t *dst, int filter_type,
                            uint8_t *src, uint8_t *top, int size, int bpp)
 {
     int i;
@@ -128,22 +103,21 @@ static void png_filter_row(DSPContext *dsp, uint8_t *dst, int filter_type,
         memcpy(dst, src, size);
         break;
     case PNG_FILTER_VALUE_SUB:
-        dsp->diff_bytes(dst, src, src-bpp, size);
+        s->dsp.diff_bytes(dst, src, src-bpp, size);
         memcpy(dst, src, bpp);
         break;
     case PNG_FILTER_VALUE_UP:
-        dsp->diff_bytes(dst, src, top, size);
+        s->dsp.diff_bytes(dst, src, top, size);
         break;
     case PNG_FILTER_VALUE_AVG:
         for(i = 0; i < bpp; i++)
             dst[i] = src[i] - (top[i] >> 1);
-        for(; i < size; i++)
-            dst[i] = src[i] - ((src[i-bpp] + top[i]) >> 1);
+        s->pngdsp.sub_avg_prediction(dst+i, src+i, top+i, size-i, bpp);
         break;
     case PNG_FILTER_VALUE_PAETH:
         for(i = 0; i < bpp; i++)
             dst[i] = src[i] - top[i];
-        sub_png_paeth_prediction(dst+i, src+i, top+i, size-i, bpp);
+        s->pngdsp.sub_paeth_prediction(dst+i, src+i, top+i, size-i, bpp);
         break;
     }
 }
@@ -156,15 +130,12 @@ static uint8_t *png_choose_filter(PNGEncContext *s, uint8_t *dst,
     if(!top && pred)
         pred = PNG_FILTER_VALUE_SUB;
     if(pred == PNG_FILTER_VALUE_MIXED) {
-        int i;
         int cost, bcost = INT_MAX;
         uint8_t *buf1 = dst, *buf2 = dst + size + 16;
         for(pred=0; pred<5; pred++) {
-            png_filter_row(&s->dsp, buf1+1, pred, src, top, size, bpp);
+            png_filter_row(s, buf1+1, pred, src, top, size, bpp);
             buf1[0] = pred;
-            cost = 0;
-            for(i=0; i<=size; i++)
-                cost += abs((int8_t)buf1[i]);
+            cost = s->pngdsp.filter_cost(buf1, size + 1);
             if(cost < bcost) {
                 bcost = cost;
                 FFSWAP(uint8_t*, buf1, buf2);
@@ -172,7 +143,7 @@ static uint8_t *png_choose_filter(PNGEncContext *s, uint8_t *dst,
         }
         return buf2;
     } else {
-        png_filter_row(&s->dsp, dst+1, pred, src, top, size, bpp);
+        png_filter_row(s, dst+1, pred, src, top, size, bpp);
         dst[0] = pred;
         return dst;
     }
@@ -461,6 +432,7 @@ static av_cold int png_enc_init(AVCodecContext *avctx){
     avcodec_get_frame_defaults(&s->picture);
     avctx->coded_frame= &s->picture;
     ff_dsputil_init(&s->dsp, avctx);
+    ff_pngdsp_init(&s->pngdsp);
 
     s->filter_type = av_clip(avctx->prediction_method, PNG_FILTER_VALUE_NONE, PNG_FILTER_VALUE_MIXED);
     if(avctx->pix_fmt == AV_PIX_FMT_MONOBLACK)
@@ -70,6 +70,23 @@ static void prores_fdct_c(const uint16_t *src, int linesize, int16_t *block)
     }
     ff_jpeg_fdct_islow_10(block);
 }
+
+static int prores_quantize_c(int16_t *dst, const int16_t *src,
+                             const int16_t *qmat, int nb_blocks)
+{
+    int i, j, level, error = 0;
+
+    for (i = 0; i < nb_blocks; i++, src += 64, dst += 64) {
+        dst[0] = src[0] / qmat[0];
+        for (j = 1; j < 64; j++) {
+            level   = src[j] / qmat[j];
+            dst[j]  = level;
+            error  += FFABS(src[j]) - FFABS(level) * qmat[j];
+        }
+    }
+
+    return error;
+}
 #endif
 
 av_cold void ff_proresdsp_init(ProresDSPContext *dsp, AVCodecContext *avctx)
@@ -77,15 +94,20 @@ av_cold void ff_proresdsp_init(ProresDSPContext *dsp, AVCodecContext *avctx)
 #if CONFIG_PRORES_DECODER | CONFIG_PRORES_LGPL_DECODER
     dsp->idct_put = prores_idct_put_c;
     dsp->idct_permutation_type = FF_NO_IDCT_PERM;
+#endif
+#if CONFIG_PRORES_KS_ENCODER
+    dsp->fdct                 = prores_fdct_c;
+    dsp->quantize             = prores_quantize_c;
+    dsp->dct_permutation_type = FF_NO_IDCT_PERM;
+#endif
 
     if (ARCH_X86) ff_proresdsp_x86_init(dsp, avctx);
 
+#if CONFIG_PRORES_DECODER | CONFIG_PRORES_LGPL_DECODER
     ff_init_scantable_permutation(dsp->idct_permutation,
                                   dsp->idct_permutation_type);
 #endif
 #if CONFIG_PRORES_KS_ENCODER
-    dsp->fdct                 = prores_fdct_c;
-    dsp->dct_permutation_type = FF_NO_IDCT_PERM;
     ff_init_scantable_permutation(dsp->dct_permutation,
                                   dsp->dct_permutation_type);
 #endif
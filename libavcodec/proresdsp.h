@@ -35,6 +35,12 @@ typedef struct ProresDSPContext {
     uint8_t dct_permutation[64];
     void (* idct_put) (uint16_t *out, int linesize, int16_t *block, const int16_t *qmat);
     void (* fdct) (const uint16_t *src, int linesize, int16_t *block);
+    /**
+     * Quantize nb_blocks 8x8 blocks, rounding towards zero.
+     * @return sum of the absolute quantization errors of the AC coefficients
+     */
+    int  (* quantize) (int16_t *dst, const int16_t *src, const int16_t *qmat,
+                       int nb_blocks);
 } ProresDSPContext;
 
 void ff_proresdsp_init(ProresDSPContext *dsp, AVCodecContext *avctx);
@@ -180,16 +180,21 @@ struct TrellisNode {
 #define MAX_STORED_Q 16
 
 typedef struct ProresThreadData {
-    DECLARE_ALIGNED(16, int16_t, blocks)[MAX_PLANES][64 * 4 * MAX_MBS_PER_SLICE];
+    int16_t *blocks[MAX_PLANES];    ///< coefficients of a row of slices, 256 per MB
+    DECLARE_ALIGNED(16, int16_t, levels)[64 * 4 * MAX_MBS_PER_SLICE];
     DECLARE_ALIGNED(16, uint16_t, emu_buf)[16 * 16];
     int16_t custom_q[64];
     struct TrellisNode *nodes;
 } ProresThreadData;
 
+typedef struct ProresRowData {
+    uint8_t *buf;                   ///< coded slices of the row
+    unsigned int buf_size;
+    int size;                       ///< coded size or a negative error code
+} ProresRowData;
+
 typedef struct ProresContext {
     AVClass *class;
-    DECLARE_ALIGNED(16, int16_t, blocks)[MAX_PLANES][64 * 4 * MAX_MBS_PER_SLICE];
-    DECLARE_ALIGNED(16, uint16_t, emu_buf)[16*16];
     int16_t quants[MAX_STORED_Q][64];
     int16_t custom_q[64];
     const uint8_t *quant_mat;
@@ -218,8 +223,10 @@ typedef struct ProresContext {
     const struct prores_profile *profile_info;
 
     int *slice_q;
+    int *slice_sizes;
 
     ProresThreadData *tdata;
+    ProresRowData *rows;
 } ProresContext;
 
 static void get_slice_data(ProresContext *ctx, const uint16_t *src,
@@ -382,10 +389,9 @@ static void encode_dcs(PutBitContext *pb, int16_t *blocks,
     }
 }
 
-static void encode_acs(PutBitContext *pb, int16_t *blocks,
+static void encode_acs(PutBitContext *pb, const int16_t *levels,
                        int blocks_per_slice,
-                       int plane_size_factor,
-                       const uint8_t *scan, const int16_t *qmat)
+                       int plane_size_factor, const uint8_t *scan)
 {
     int idx, i;
     int run, level, run_cb, lev_cb;
@@ -398,7 +404,7 @@ static void encode_acs(PutBitContext *pb, int16_t *blocks,
 
     for (i = 1; i < 64; i++) {
         for (idx = scan[i]; idx < max_coeffs; idx += 64) {
-            level = blocks[idx] / qmat[scan[i]];
+            level = levels[idx];
             if (level) {
                 abs_level = FFABS(level);
                 encode_vlc_codeword(pb, ff_prores_ac_codebook[run_cb], run);
@@ -417,8 +423,8 @@ static void encode_acs(PutBitContext *pb, int16_t *blocks,
 }
 
 static int encode_slice_plane(ProresContext *ctx, PutBitContext *pb,
-                              const uint16_t *src, int linesize,
                               int mbs_per_slice, int16_t *blocks,
+                              int16_t *levels,
                               int blocks_per_mb, int plane_size_factor,
                               const int16_t *qmat)
 {
@@ -427,9 +433,10 @@ static int encode_slice_plane(ProresContext *ctx, PutBitContext *pb,
     saved_pos = put_bits_count(pb);
     blocks_per_slice = mbs_per_slice * blocks_per_mb;
 
+    ctx->dsp.quantize(levels, blocks, qmat, blocks_per_slice);
     encode_dcs(pb, blocks, blocks_per_slice, qmat[0]);
-    encode_acs(pb, blocks, blocks_per_slice, plane_size_factor,
-               ctx->scantable.permutated, qmat);
+    encode_acs(pb, levels, blocks_per_slice, plane_size_factor,
+               ctx->scantable.permutated);
     flush_put_bits(pb);
 
     return (put_bits_count(pb) - saved_pos) >> 3;
@@ -470,9 +477,7 @@ static void put_alpha_run(PutBitContext *pb, int run)
 
 // todo alpha quantisation for high quants
 static int encode_alpha_plane(ProresContext *ctx, PutBitContext *pb,
-                              const uint16_t *src, int linesize,
-                              int mbs_per_slice, uint16_t *blocks,
-                              int quant)
+                              int mbs_per_slice, uint16_t *blocks)
 {
     const int abits = ctx->alpha_bits;
     const int mask  = (1 << abits) - 1;
@@ -502,40 +507,22 @@ static int encode_alpha_plane(ProresContext *ctx, PutBitContext *pb,
     return (put_bits_count(pb) - saved_pos) >> 3;
 }
 
-static int encode_slice(AVCodecContext *avctx, const AVFrame *pic,
-                        PutBitContext *pb,
-                        int sizes[4], int x, int y, int quant,
-                        int mbs_per_slice)
+static void load_slice(AVCodecContext *avctx, const AVFrame *pic,
+                       ProresThreadData *td, int x, int y, int mbs_per_slice)
 {
     ProresContext *ctx = avctx->priv_data;
     int i, xp, yp;
-    int total_size = 0;
     const uint16_t *src;
-    int slice_width_factor = av_log2(mbs_per_slice);
     int num_cblocks, pwidth, linesize, line_add;
-    int plane_factor, is_chroma;
-    uint16_t *qmat;
+    int is_chroma;
 
     if (ctx->pictures_per_frame == 1)
         line_add = 0;
     else
         line_add = ctx->cur_picture_idx ^ !pic->top_field_first;
 
-    if (ctx->force_quant) {
-        qmat = ctx->quants[0];
-    } else if (quant < MAX_STORED_Q) {
-        qmat = ctx->quants[quant];
-    } else {
-        qmat = ctx->custom_q;
-        for (i = 0; i < 64; i++)
-            qmat[i] = ctx->quant_mat[i] * quant;
-    }
-
     for (i = 0; i < ctx->num_planes; i++) {
-        is_chroma    = (i == 1 || i == 2);
-        plane_factor = slice_width_factor + 2;
-        if (is_chroma)
-            plane_factor += ctx->chroma_factor - 3;
+        is_chroma = (i == 1 || i == 2);
         if (!is_chroma || ctx->chroma_factor == CFACTOR_Y444) {
             xp          = x << 4;
             yp          = y << 4;
@@ -555,19 +542,56 @@ static int encode_slice(AVCodecContext *avctx, const AVFrame *pic,
         if (i < 3) {
             get_slice_data(ctx, src, linesize, xp, yp,
                            pwidth, avctx->height / ctx->pictures_per_frame,
-                           ctx->blocks[0], ctx->emu_buf,
+                           td->blocks[i] + x * 256, td->emu_buf,
                            mbs_per_slice, num_cblocks, is_chroma);
-            sizes[i] = encode_slice_plane(ctx, pb, src, linesize,
-                                          mbs_per_slice, ctx->blocks[0],
-                                          num_cblocks, plane_factor,
-                                          qmat);
         } else {
             get_alpha_data(ctx, src, linesize, xp, yp,
                            pwidth, avctx->height / ctx->pictures_per_frame,
-                           ctx->blocks[0], mbs_per_slice, ctx->alpha_bits);
-            sizes[i] = encode_alpha_plane(ctx, pb, src, linesize,
-                                          mbs_per_slice, ctx->blocks[0],
-                                          quant);
+                           td->blocks[i] + x * 256, mbs_per_slice,
+                           ctx->alpha_bits);
+        }
+    }
+}
+
+static int encode_slice(AVCodecContext *avctx, PutBitContext *pb,
+                        int sizes[4], int x, int quant,
+                        int mbs_per_slice, ProresThreadData *td)
+{
+    ProresContext *ctx = avctx->priv_data;
+    int i;
+    int total_size = 0;
+    int slice_width_factor = av_log2(mbs_per_slice);
+    int num_cblocks, plane_factor, is_chroma;
+    uint16_t *qmat;
+
+    if (ctx->force_quant) {
+        qmat = ctx->quants[0];
+    } else if (quant < MAX_STORED_Q) {
+        qmat = ctx->quants[quant];
+    } else {
+        qmat = td->custom_q;
+        for (i = 0; i < 64; i++)
+            qmat[i] = ctx->quant_mat[i] * quant;
+    }
+
+    for (i = 0; i < ctx->num_planes; i++) {
+        is_chroma    = (i == 1 || i == 2);
+        plane_factor = slice_width_factor + 2;
+        if (is_chroma)
+            plane_factor += ctx->chroma_factor - 3;
+        if (!is_chroma || ctx->chroma_factor == CFACTOR_Y444)
+            num_cblocks = 4;
+        else
+            num_cblocks = 2;
+
+        if (i < 3) {
+            sizes[i] = encode_slice_plane(ctx, pb, mbs_per_slice,
+                                          td->blocks[i] + x * 256, td->levels,
+                                          num_cblocks, plane_factor,
+                                          qmat);
+        } else {
+            sizes[i] = encode_alpha_plane(ctx, pb, mbs_per_slice,
+                                          td->blocks[i] + x * 256);
         }
         total_size += sizes[i];
     }
@@ -627,9 +651,8 @@ static int estimate_dcs(int *error, int16_t *blocks, int blocks_per_slice,
     return bits;
 }
 
-static int estimate_acs(int *error, int16_t *blocks, int blocks_per_slice,
-                        int plane_size_factor,
-                        const uint8_t *scan, const int16_t *qmat)
+static int estimate_acs(const int16_t *levels, int blocks_per_slice,
+                        int plane_size_factor, const uint8_t *scan)
 {
     int idx, i;
     int run, level, run_cb, lev_cb;
@@ -643,8 +666,7 @@ static int estimate_acs(int *error, int16_t *blocks, int blocks_per_slice,
 
     for (i = 1; i < 64; i++) {
         for (idx = scan[i]; idx < max_coeffs; idx += 64) {
-            level   = blocks[idx] / qmat[scan[i]];
-            *error += FFABS(blocks[idx]) % qmat[scan[i]];
+            level = levels[idx];
             if (level) {
                 abs_level = FFABS(level);
                 bits += estimate_vlc(ff_prores_ac_codebook[run_cb], run);
@@ -663,20 +685,21 @@ static int estimate_acs(int *error, int16_t *blocks, int blocks_per_slice,
     return bits;
 }
 
-static int estimate_slice_plane(ProresContext *ctx, int *error, int plane,
-                                const uint16_t *src, int linesize,
+static int estimate_slice_plane(ProresContext *ctx, int *error,
+                                int16_t *blocks, int16_t *levels,
                                 int mbs_per_slice,
                                 int blocks_per_mb, int plane_size_factor,
-                                const int16_t *qmat, ProresThreadData *td)
+                                const int16_t *qmat)
 {
     int blocks_per_slice;
     int bits;
 
     blocks_per_slice = mbs_per_slice * blocks_per_mb;
 
-    bits  = estimate_dcs(error, td->blocks[plane], blocks_per_slice, qmat[0]);
-    bits += estimate_acs(error, td->blocks[plane], blocks_per_slice,
-                         plane_size_factor, ctx->scantable.permutated, qmat);
+    *error += ctx->dsp.quantize(levels, blocks, qmat, blocks_per_slice);
+    bits  = estimate_dcs(error, blocks, blocks_per_slice, qmat[0]);
+    bits += estimate_acs(levels, blocks_per_slice,
+                         plane_size_factor, ctx->scantable.permutated);
 
     return FFALIGN(bits, 8);
 }
@@ -698,9 +721,7 @@ static int est_alpha_diff(int cur, int prev, int abits)
 }
 
 static int estimate_alpha_plane(ProresContext *ctx, int *error,
-                                const uint16_t *src, int linesize,
-                                int mbs_per_slice, int quant,
-                                int16_t *blocks)
+                                int mbs_per_slice, int16_t *blocks)
 {
     const int abits = ctx->alpha_bits;
     const int mask  = (1 << abits) - 1;
@@ -741,15 +762,14 @@ static int estimate_alpha_plane(ProresContext *ctx, int *error,
     return bits;
 }
 
-static int find_slice_quant(AVCodecContext *avctx, const AVFrame *pic,
-                            int trellis_node, int x, int y, int mbs_per_slice,
+static int find_slice_quant(AVCodecContext *avctx,
+                            int trellis_node, int x, int mbs_per_slice,
                             ProresThreadData *td)
 {
     ProresContext *ctx = avctx->priv_data;
-    int i, q, pq, xp, yp;
-    const uint16_t *src;
+    int i, q, pq;
     int slice_width_factor = av_log2(mbs_per_slice);
-    int num_cblocks[MAX_PLANES], pwidth;
+    int num_cblocks[MAX_PLANES];
     int plane_factor[MAX_PLANES], is_chroma[MAX_PLANES];
     const int min_quant = ctx->profile_info->min_quant;
     const int max_quant = ctx->profile_info->max_quant;
@@ -758,12 +778,7 @@ static int find_slice_quant(AVCodecContext *avctx, const AVFrame *pic,
     int slice_bits[TRELLIS_WIDTH], slice_score[TRELLIS_WIDTH];
     int overquant;
     uint16_t *qmat;
-    int linesize[4], line_add;
 
-    if (ctx->pictures_per_frame == 1)
-        line_add = 0;
-    else
-        line_add = ctx->cur_picture_idx ^ !pic->top_field_first;
     mbs = x + mbs_per_slice;
 
     for (i = 0; i < ctx->num_planes; i++) {
@@ -771,32 +786,10 @@ static int find_slice_quant(AVCodecContext *avctx, const AVFrame *pic,
         plane_factor[i] = slice_width_factor + 2;
         if (is_chroma[i])
             plane_factor[i] += ctx->chroma_factor - 3;
-        if (!is_chroma[i] || ctx->chroma_factor == CFACTOR_Y444) {
-            xp             = x << 4;
-            yp             = y << 4;
+        if (!is_chroma[i] || ctx->chroma_factor == CFACTOR_Y444)
             num_cblocks[i] = 4;
-            pwidth         = avctx->width;
-        } else {
-            xp             = x << 3;
-            yp             = y << 4;
+        else
             num_cblocks[i] = 2;
-            pwidth         = avctx->width >> 1;
-        }
-
-        linesize[i] = pic->linesize[i] * ctx->pictures_per_frame;
-        src = (const uint16_t*)(pic->data[i] + yp * linesize[i] +
-                                line_add * pic->linesize[i]) + xp;
-
-        if (i < 3) {
-            get_slice_data(ctx, src, linesize[i], xp, yp,
-                           pwidth, avctx->height / ctx->pictures_per_frame,
-                           td->blocks[i], td->emu_buf,
-                           mbs_per_slice, num_cblocks[i], is_chroma[i]);
-        } else {
-            get_alpha_data(ctx, src, linesize[i], xp, yp,
-                           pwidth, avctx->height / ctx->pictures_per_frame,
-                           td->blocks[i], mbs_per_slice, ctx->alpha_bits);
-        }
     }
 
     for (q = min_quant; q < max_quant + 2; q++) {
@@ -809,15 +802,15 @@ static int find_slice_quant(AVCodecContext *avctx, const AVFrame *pic,
         bits  = 0;
         error = 0;
         for (i = 0; i < ctx->num_planes - !!ctx->alpha_bits; i++) {
-            bits += estimate_slice_plane(ctx, &error, i,
-                                         src, linesize[i],
+            bits += estimate_slice_plane(ctx, &error,
+                                         td->blocks[i] + x * 256, td->levels,
                                          mbs_per_slice,
                                          num_cblocks[i], plane_factor[i],
-                                         ctx->quants[q], td);
+                                         ctx->quants[q]);
         }
         if (ctx->alpha_bits)
-            bits += estimate_alpha_plane(ctx, &error, src, linesize[3],
-                                         mbs_per_slice, q, td->blocks[3]);
+            bits += estimate_alpha_plane(ctx, &error, mbs_per_slice,
+                                         td->blocks[3] + x * 256);
         if (bits > 65000 * 8) {
             error = SCORE_LIMIT;
             break;
@@ -841,15 +834,15 @@ static int find_slice_quant(AVCodecContext *avctx, const AVFrame *pic,
                     qmat[i] = ctx->quant_mat[i] * q;
             }
             for (i = 0; i < ctx->num_planes - !!ctx->alpha_bits; i++) {
-                bits += estimate_slice_plane(ctx, &error, i,
-                                             src, linesize[i],
-                                             mbs_per_slice,
+                bits += estimate_slice_plane(ctx, &error,
+                                             td->blocks[i] + x * 256,
+                                             td->levels, mbs_per_slice,
                                              num_cblocks[i], plane_factor[i],
-                                             qmat, td);
+                                             qmat);
             }
             if (ctx->alpha_bits)
-                bits += estimate_alpha_plane(ctx, &error, src, linesize[3],
-                                             mbs_per_slice, q, td->blocks[3]);
+                bits += estimate_alpha_plane(ctx, &error, mbs_per_slice,
+                                             td->blocks[3] + x * 256);
             if (bits <= ctx->bits_per_mb * mbs_per_slice)
                 break;
         }
@@ -898,25 +891,75 @@ static int find_slice_quant(AVCodecContext *avctx, const AVFrame *pic,
     return pq;
 }
 
-static int find_quant_thread(AVCodecContext *avctx, void *arg,
+static int encode_row_thread(AVCodecContext *avctx, void *arg,
                              int jobnr, int threadnr)
 {
     ProresContext *ctx = avctx->priv_data;
     ProresThreadData *td = ctx->tdata + threadnr;
+    ProresRowData *row = ctx->rows + jobnr;
+    const AVFrame *pic = avctx->coded_frame;
     int mbs_per_slice = ctx->mbs_per_slice;
-    int x, y = jobnr, mb, q = 0;
+    int slice_hdr_size = 2 + 2 * (ctx->num_planes - 1);
+    int *slice_q = ctx->slice_q + jobnr * ctx->slices_width;
+    int x, y = jobnr, mb, i, q = 0;
+    int sizes[4] = { 0 };
+    int slice_size, max_slice_size;
+    uint8_t *buf, *slice_hdr;
+    PutBitContext pb;
 
     for (x = mb = 0; x < ctx->mb_width; x += mbs_per_slice, mb++) {
         while (ctx->mb_width - x < mbs_per_slice)
             mbs_per_slice >>= 1;
-        q = find_slice_quant(avctx, avctx->coded_frame,
-                             (mb + 1) * TRELLIS_WIDTH, x, y,
-                             mbs_per_slice, td);
+        load_slice(avctx, pic, td, x, y, mbs_per_slice);
+        if (ctx->force_quant)
+            slice_q[mb] = ctx->force_quant;
+        else
+            q = find_slice_quant(avctx, (mb + 1) * TRELLIS_WIDTH, x,
+                                 mbs_per_slice, td);
     }
 
-    for (x = ctx->slices_width - 1; x >= 0; x--) {
-        ctx->slice_q[x + y * ctx->slices_width] = td->nodes[q].quant;
-        q = td->nodes[q].prev_node;
+    if (!ctx->force_quant) {
+        for (x = ctx->slices_width - 1; x >= 0; x--) {
+            slice_q[x] = td->nodes[q].quant;
+            q = td->nodes[q].prev_node;
+        }
+    }
+
+    // the slices are coded from the cached coefficients into a per-row
+    // buffer, which is grown by the largest possible slice size each time:
+    // no code word is longer than 37 bits, so no coefficient costs more
+    // than 10 bytes with its run and sign
+    row->size     = 0;
+    mbs_per_slice = ctx->mbs_per_slice;
+    for (x = mb = 0; x < ctx->mb_width; x += mbs_per_slice, mb++) {
+        while (ctx->mb_width - x < mbs_per_slice)
+            mbs_per_slice >>= 1;
+
+        max_slice_size = slice_hdr_size +
+                         ctx->num_planes * mbs_per_slice * 256 * 10;
+        buf = av_fast_realloc(row->buf, &row->buf_size,
+                              row->size + max_slice_size);
+        if (!buf) {
+            row->size = AVERROR(ENOMEM);
+            return row->size;
+        }
+        row->buf = buf;
+        buf     += row->size;
+
+        bytestream_put_byte(&buf, slice_hdr_size << 3);
+        slice_hdr = buf;
+        buf += slice_hdr_size - 1;
+        init_put_bits(&pb, buf, (max_slice_size - slice_hdr_size) * 8);
+        encode_slice(avctx, &pb, sizes, x, slice_q[mb], mbs_per_slice, td);
+
+        bytestream_put_byte(&slice_hdr, slice_q[mb]);
+        slice_size = slice_hdr_size + sizes[ctx->num_planes - 1];
+        for (i = 0; i < ctx->num_planes - 1; i++) {
+            bytestream_put_be16(&slice_hdr, sizes[i]);
+            slice_size += sizes[i];
+        }
+        ctx->slice_sizes[y * ctx->slices_width + mb] = slice_size;
+        row->size += slice_size;
     }
 
     return 0;
@@ -926,13 +969,10 @@ static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
                         const AVFrame *pic, int *got_packet)
 {
     ProresContext *ctx = avctx->priv_data;
-    uint8_t *orig_buf, *buf, *slice_hdr, *slice_sizes, *tmp;
+    uint8_t *orig_buf, *buf, *slice_sizes, *tmp;
     uint8_t *picture_size_pos;
-    PutBitContext pb;
-    int x, y, i, mb, q = 0;
-    int sizes[4] = { 0 };
-    int slice_hdr_size = 2 + 2 * (ctx->num_planes - 1);
-    int frame_size, picture_size, slice_size;
+    int y, i;
+    int frame_size, picture_size;
     int pkt_size, ret;
     uint8_t frame_flags;
 
@@ -999,37 +1039,25 @@ static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
         buf += ctx->slices_per_picture * 2;
 
         // slices
-        if (!ctx->force_quant) {
-            ret = avctx->execute2(avctx, find_quant_thread, NULL, NULL,
-                                  ctx->mb_height);
-            if (ret)
-                return ret;
-        }
+        ret = avctx->execute2(avctx, encode_row_thread, NULL, NULL,
+                              ctx->mb_height);
+        if (ret)
+            return ret;
 
         for (y = 0; y < ctx->mb_height; y++) {
-            int mbs_per_slice = ctx->mbs_per_slice;
-            for (x = mb = 0; x < ctx->mb_width; x += mbs_per_slice, mb++) {
-                q = ctx->force_quant ? ctx->force_quant
-                                     : ctx->slice_q[mb + y * ctx->slices_width];
-
-                while (ctx->mb_width - x < mbs_per_slice)
-                    mbs_per_slice >>= 1;
-
-                bytestream_put_byte(&buf, slice_hdr_size << 3);
-                slice_hdr = buf;
-                buf += slice_hdr_size - 1;
-                init_put_bits(&pb, buf, (pkt_size - (buf - orig_buf)) * 8);
-                encode_slice(avctx, pic, &pb, sizes, x, y, q, mbs_per_slice);
-
-                bytestream_put_byte(&slice_hdr, q);
-                slice_size = slice_hdr_size + sizes[ctx->num_planes - 1];
-                for (i = 0; i < ctx->num_planes - 1; i++) {
-                    bytestream_put_be16(&slice_hdr, sizes[i]);
-                    slice_size += sizes[i];
-                }
-                bytestream_put_be16(&slice_sizes, slice_size);
-                buf += slice_size - slice_hdr_size;
+            ProresRowData *row = ctx->rows + y;
+
+            if (row->size < 0)
+                return row->size;
+            if (row->size > pkt->data + pkt->size - buf) {
+                av_log(avctx, AV_LOG_ERROR, "frame size upper bound exceeded\n");
+                return AVERROR_BUG;
             }
+            for (i = 0; i < ctx->slices_width; i++)
+                bytestream_put_be16(&slice_sizes,
+                                    ctx->slice_sizes[y * ctx->slices_width + i]);
+            memcpy(buf, row->buf, row->size);
+            buf += row->size;
         }
 
         picture_size = buf - (picture_size_pos - 1);
@@ -1050,16 +1078,25 @@ static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
 static av_cold int encode_close(AVCodecContext *avctx)
 {
     ProresContext *ctx = avctx->priv_data;
-    int i;
+    int i, j;
 
     av_freep(&avctx->coded_frame);
 
     if (ctx->tdata) {
-        for (i = 0; i < avctx->thread_count; i++)
+        for (i = 0; i < avctx->thread_count; i++) {
             av_free(ctx->tdata[i].nodes);
+            for (j = 0; j < MAX_PLANES; j++)
+                av_free(ctx->tdata[i].blocks[j]);
+        }
+    }
+    if (ctx->rows) {
+        for (i = 0; i < ctx->mb_height; i++)
+            av_free(ctx->rows[i].buf);
     }
     av_freep(&ctx->tdata);
+    av_freep(&ctx->rows);
     av_freep(&ctx->slice_q);
+    av_freep(&ctx->slice_sizes);
 
     return 0;
 }
@@ -1125,6 +1162,26 @@ static av_cold int encode_init(AVCodecContext *avctx)
         return AVERROR_INVALIDDATA;
     }
 
+    ctx->slice_q     = av_malloc(ctx->slices_per_picture * sizeof(*ctx->slice_q));
+    ctx->slice_sizes = av_malloc(ctx->slices_per_picture *
+                                 sizeof(*ctx->slice_sizes));
+    ctx->rows        = av_mallocz(ctx->mb_height * sizeof(*ctx->rows));
+    ctx->tdata       = av_mallocz(avctx->thread_count * sizeof(*ctx->tdata));
+    if (!ctx->slice_q || !ctx->slice_sizes || !ctx->rows || !ctx->tdata) {
+        encode_close(avctx);
+        return AVERROR(ENOMEM);
+    }
+    for (j = 0; j < avctx->thread_count; j++) {
+        for (i = 0; i < ctx->num_planes; i++) {
+            ctx->tdata[j].blocks[i] = av_malloc(ctx->mb_width * 256 *
+                                                sizeof(**ctx->tdata->blocks));
+            if (!ctx->tdata[j].blocks[i]) {
+                encode_close(avctx);
+                return AVERROR(ENOMEM);
+            }
+        }
+    }
+
     ctx->force_quant = avctx->global_quality / FF_QP2LAMBDA;
     if (!ctx->force_quant) {
         if (!ctx->bits_per_mb) {
@@ -1145,18 +1202,6 @@ static av_cold int encode_init(AVCodecContext *avctx)
                 ctx->quants[i][j] = ctx->quant_mat[j] * i;
         }
 
-        ctx->slice_q = av_malloc(ctx->slices_per_picture * sizeof(*ctx->slice_q));
-        if (!ctx->slice_q) {
-            encode_close(avctx);
-            return AVERROR(ENOMEM);
-        }
-
-        ctx->tdata = av_mallocz(avctx->thread_count * sizeof(*ctx->tdata));
-        if (!ctx->tdata) {
-            encode_close(avctx);
-            return AVERROR(ENOMEM);
-        }
-
         for (j = 0; j < avctx->thread_count; j++) {
             ctx->tdata[j].nodes = av_malloc((ctx->slices_width + 1)
                                             * TRELLIS_WIDTH
@@ -50,7 +50,9 @@ typedef int (action_func)(AVCodecContext *c, void *arg);
 typedef int (action_func2)(AVCodecContext *c, void *arg, int jobnr, int threadnr);
 
 typedef struct ThreadContext {
+    AVCodecContext *avctx;
     pthread_t *workers;
+    int thread_count;               ///< number of workers
     action_func *func;
     action_func2 *func2;
     void *args;
@@ -65,8 +67,35 @@ typedef struct ThreadContext {
     int current_job;
     unsigned int current_execute;
     int done;
+
+    /**
+     * Set when the jobs run on the shared worker pool instead of on
+     * workers of this context. The fields below are protected by pool.lock.
+     */
+    int shared;
+    struct ThreadContext *next;     ///< next context in the pool queue
+    int next_job;                   ///< next job to hand out
+    int finished_jobs;
+    int *free_threadnr;             ///< threadnr values not in use by a running job
+    int nb_free_threadnr;
 } ThreadContext;
 
+/**
+ * Worker pool shared by the contexts which set thread_pool.
+ * It is created by the first of them and destroyed with the last one, in
+ * ff_thread_init() and ff_thread_free(), which run under the codec lock.
+ */
+static struct {
+    pthread_t *workers;
+    int nb_workers;
+    int refcount;
+    int die;
+    pthread_mutex_t lock;
+    pthread_cond_t work_cond;       ///< signaled when jobs are queued, or on exit
+    pthread_cond_t done_cond;       ///< signaled when all the jobs of a context are done
+    ThreadContext *queue;           ///< contexts with jobs left to hand out
+} pool;
+
 /**
  * Context used by codec threads and stored in their AVCodecContext thread_opaque.
  */
@@ -75,6 +104,7 @@ typedef struct PerThreadContext {
 
     pthread_t      thread;
     int            thread_init;
+    ThreadContext *slice_ctx;       ///< Slice threads of this thread, if frame and slice threading are combined.
     pthread_cond_t input_cond;      ///< Used to wait for a new packet from the main thread.
     pthread_cond_t progress_cond;   ///< Used by child threads to wait for progress to change.
     pthread_cond_t output_cond;     ///< Used by the main thread to wait for frames to finish.
@@ -92,6 +122,8 @@ typedef struct PerThreadContext {
     int     got_frame;              ///< The output of got_picture_ptr from the last avcodec_decode_video() call.
     int     result;                 ///< The result of the last codec decode/encode() call.
 
+    int     hwaccel_locked;         ///< Set when the thread holds FrameThreadContext.hwaccel_mutex.
+
     enum {
         STATE_INPUT_READY,          ///< Set when the thread is awaiting a packet.
         STATE_SETTING_UP,           ///< Set before the codec has called ff_thread_finish_setup().
@@ -129,6 +161,7 @@ typedef struct FrameThreadContext {
     PerThreadContext *prev_thread; ///< The last thread submit_packet() was called on.
 
     pthread_mutex_t buffer_mutex;  ///< Mutex used to protect get/release_buffer().
+    pthread_mutex_t hwaccel_mutex; ///< Mutex used to serialize the hwaccel calls of the threads.
 
     int next_decoding;             ///< The next context to submit a packet to.
     int next_finished;             ///< The next context to return output from.
@@ -146,13 +179,24 @@ typedef struct FrameThreadContext {
  * limit the number of threads to 16 for automatic detection */
 #define MAX_AUTO_THREADS 16
 
+/**
+ * Get the slice threading context of avctx. The contexts of frame threads
+ * keep it in their PerThreadContext.
+ */
+static ThreadContext *get_slice_context(AVCodecContext *avctx)
+{
+    if (avctx->active_thread_type & FF_THREAD_FRAME)
+        return ((PerThreadContext *)avctx->thread_opaque)->slice_ctx;
+    return avctx->thread_opaque;
+}
+
 static void* attribute_align_arg worker(void *v)
 {
-    AVCodecContext *avctx = v;
-    ThreadContext *c = avctx->thread_opaque;
+    ThreadContext *c = v;
+    AVCodecContext *avctx = c->avctx;
     int our_job = c->job_count;
     int last_execute = 0;
-    int thread_count = avctx->thread_count;
+    int thread_count = c->thread_count;
     int self_id;
 
     pthread_mutex_lock(&c->current_job_lock);
@@ -189,29 +233,246 @@ static av_always_inline void avcodec_thread_park_workers(ThreadContext *c, int t
     pthread_mutex_unlock(&c->current_job_lock);
 }
 
-static void thread_free(AVCodecContext *avctx)
+/**
+ * Hand out the next job of c. Must be called with pool.lock held.
+ *
+ * @return the job number, or -1 if all the jobs have been handed out
+ */
+static int pool_next_job(ThreadContext *c)
+{
+    ThreadContext **q;
+
+    if (c->next_job >= c->job_count)
+        return -1;
+
+    if (c->next_job + 1 == c->job_count) {
+        for (q = &pool.queue; *q != c; q = &(*q)->next)
+            ;
+        *q = c->next;
+    }
+    return c->next_job++;
+}
+
+/**
+ * Run jobs of c with the given threadnr until all of them have been handed
+ * out, then give threadnr back. Must be called with pool.lock held; it is
+ * released while a job runs.
+ */
+static void pool_run_jobs(ThreadContext *c, int threadnr)
+{
+    AVCodecContext *avctx = c->avctx;
+    int jobnr;
+
+    while ((jobnr = pool_next_job(c)) >= 0) {
+        pthread_mutex_unlock(&pool.lock);
+        c->rets[jobnr%c->rets_count] = c->func ? c->func(avctx, (char*)c->args + jobnr*c->job_size):
+                                                 c->func2(avctx, c->args, jobnr, threadnr);
+        pthread_mutex_lock(&pool.lock);
+        c->finished_jobs++;
+    }
+
+    c->free_threadnr[c->nb_free_threadnr++] = threadnr;
+    if (c->finished_jobs == c->job_count)
+        pthread_cond_broadcast(&pool.done_cond);
+}
+
+static void* attribute_align_arg pool_worker(void *arg)
+{
+    ThreadContext *c;
+
+    pthread_mutex_lock(&pool.lock);
+    while (!pool.die) {
+        /* Contexts leave the queue once their last job is handed out, so
+         * the first one with a free threadnr always has a job to run. */
+        for (c = pool.queue; c; c = c->next)
+            if (c->nb_free_threadnr)
+                break;
+        if (c)
+            pool_run_jobs(c, c->free_threadnr[--c->nb_free_threadnr]);
+        else
+            pthread_cond_wait(&pool.work_cond, &pool.lock);
+    }
+    pthread_mutex_unlock(&pool.lock);
+
+    return NULL;
+}
+
+static void pool_unref(void)
+{
+    int i;
+
+    if (--pool.refcount)
+        return;
+
+    pthread_mutex_lock(&pool.lock);
+    pool.die = 1;
+    pthread_cond_broadcast(&pool.work_cond);
+    pthread_mutex_unlock(&pool.lock);
+
+    for (i = 0; i < pool.nb_workers; i++)
+        pthread_join(pool.workers[i], NULL);
+
+    pthread_mutex_destroy(&pool.lock);
+    pthread_cond_destroy(&pool.work_cond);
+    pthread_cond_destroy(&pool.done_cond);
+    av_freep(&pool.workers);
+    pool.nb_workers = 0;
+    pool.die        = 0;
+    pool.queue      = NULL;
+}
+
+static int pool_ref(void)
+{
+    int i, nb_workers;
+
+    if (pool.refcount++)
+        return 0;
+
+    nb_workers = av_cpu_count();
+    pool.workers = av_mallocz(sizeof(*pool.workers) * nb_workers);
+    if (!pool.workers) {
+        pool.refcount = 0;
+        return AVERROR(ENOMEM);
+    }
+
+    pthread_mutex_init(&pool.lock, NULL);
+    pthread_cond_init(&pool.work_cond, NULL);
+    pthread_cond_init(&pool.done_cond, NULL);
+    for (i = 0; i < nb_workers; i++) {
+        if (pthread_create(&pool.workers[i], NULL, pool_worker, NULL))
+            break;
+        pool.nb_workers++;
+    }
+    if (!pool.nb_workers) {
+        pool_unref();
+        return AVERROR(EAGAIN);
+    }
+
+    return 0;
+}
+
+static int pool_execute(AVCodecContext *avctx, action_func *func, void *arg, int *ret, int job_count, int job_size)
+{
+    ThreadContext *c = get_slice_context(avctx);
+    ThreadContext **q;
+    int dummy_ret;
+
+    if (!(avctx->active_thread_type&FF_THREAD_SLICE) || avctx->thread_count <= 1)
+        return avcodec_default_execute(avctx, func, arg, ret, job_count, job_size);
+
+    if (job_count <= 0)
+        return 0;
+
+    pthread_mutex_lock(&pool.lock);
+
+    c->job_count     = job_count;
+    c->job_size      = job_size;
+    c->args          = arg;
+    c->func          = func;
+    c->next_job      = 0;
+    c->finished_jobs = 0;
+    if (ret) {
+        c->rets = ret;
+        c->rets_count = job_count;
+    } else {
+        c->rets = &dummy_ret;
+        c->rets_count = 1;
+    }
+
+    for (q = &pool.queue; *q; q = &(*q)->next)
+        ;
+    c->next = NULL;
+    *q = c;
+    if (job_count > 1)
+        pthread_cond_broadcast(&pool.work_cond);
+
+    /* The calling thread runs jobs too, so that a busy pool only
+     * slows the context down instead of blocking it. */
+    pool_run_jobs(c, c->free_threadnr[--c->nb_free_threadnr]);
+
+    while (c->finished_jobs < c->job_count)
+        pthread_cond_wait(&pool.done_cond, &pool.lock);
+
+    pthread_mutex_unlock(&pool.lock);
+
+    return 0;
+}
+
+static int pool_execute2(AVCodecContext *avctx, action_func2* func2, void *arg, int *ret, int job_count)
+{
+    ThreadContext *c = get_slice_context(avctx);
+    c->func2 = func2;
+    return pool_execute(avctx, NULL, arg, ret, job_count, 0);
+}
+
+static int pool_thread_init(AVCodecContext *avctx, ThreadContext **pc)
+{
+    ThreadContext *c;
+    int i, err;
+
+    c = av_mallocz(sizeof(ThreadContext));
+    if (!c)
+        return AVERROR(ENOMEM);
+
+    c->free_threadnr = av_malloc(sizeof(*c->free_threadnr) * avctx->thread_count);
+    if (!c->free_threadnr) {
+        av_free(c);
+        return AVERROR(ENOMEM);
+    }
+    for (i = 0; i < avctx->thread_count; i++)
+        c->free_threadnr[i] = avctx->thread_count - 1 - i;
+    c->nb_free_threadnr = avctx->thread_count;
+    c->shared = 1;
+    c->avctx  = avctx;
+
+    err = pool_ref();
+    if (err < 0) {
+        av_free(c->free_threadnr);
+        av_free(c);
+        return err;
+    }
+
+    *pc = c;
+    avctx->execute  = pool_execute;
+    avctx->execute2 = pool_execute2;
+    return 0;
+}
+
+static void slice_thread_free(ThreadContext *c)
 {
-    ThreadContext *c = avctx->thread_opaque;
     int i;
 
+    if (c->shared) {
+        pool_unref();
+        av_free(c->free_threadnr);
+        av_free(c);
+        return;
+    }
+
     pthread_mutex_lock(&c->current_job_lock);
     c->done = 1;
     pthread_cond_broadcast(&c->current_job_cond);
     pthread_mutex_unlock(&c->current_job_lock);
 
-    for (i=0; i<avctx->thread_count; i++)
+    for (i=0; i<c->thread_count; i++)
          pthread_join(c->workers[i], NULL);
 
     pthread_mutex_destroy(&c->current_job_lock);
     pthread_cond_destroy(&c->current_job_cond);
     pthread_cond_destroy(&c->last_job_cond);
     av_free(c->workers);
-    av_freep(&avctx->thread_opaque);
+    av_free(c);
+}
+
+static void thread_free(AVCodecContext *avctx)
+{
+    slice_thread_free(avctx->thread_opaque);
+    avctx->thread_opaque = NULL;
 }
 
 static int avcodec_thread_execute(AVCodecContext *avctx, action_func* func, void *arg, int *ret, int job_count, int job_size)
 {
-    ThreadContext *c= avctx->thread_opaque;
+    ThreadContext *c= get_slice_context(avctx);
     int dummy_ret;
 
     if (!(avctx->active_thread_type&FF_THREAD_SLICE) || avctx->thread_count <= 1)
@@ -222,7 +483,7 @@ static int avcodec_thread_execute(AVCodecContext *avctx, action_func* func, void
 
     pthread_mutex_lock(&c->current_job_lock);
 
-    c->current_job = avctx->thread_count;
+    c->current_job = c->thread_count;
     c->job_count = job_count;
     c->job_size = job_size;
     c->args = arg;
@@ -237,39 +498,29 @@ static int avcodec_thread_execute(AVCodecContext *avctx, action_func* func, void
     c->current_execute++;
     pthread_cond_broadcast(&c->current_job_cond);
 
-    avcodec_thread_park_workers(c, avctx->thread_count);
+    avcodec_thread_park_workers(c, c->thread_count);
 
     return 0;
 }
 
 static int avcodec_thread_execute2(AVCodecContext *avctx, action_func2* func2, void *arg, int *ret, int job_count)
 {
-    ThreadContext *c= avctx->thread_opaque;
+    ThreadContext *c= get_slice_context(avctx);
     c->func2 = func2;
     return avcodec_thread_execute(avctx, NULL, arg, ret, job_count, 0);
 }
 
-static int thread_init(AVCodecContext *avctx)
+/**
+ * Start the slice threads of avctx, or attach it to the shared pool.
+ */
+static int slice_thread_init(AVCodecContext *avctx, ThreadContext **pc)
 {
     int i;
     ThreadContext *c;
     int thread_count = avctx->thread_count;
 
-    if (!thread_count) {
-        int nb_cpus = av_cpu_count();
-        if  (avctx->height)
-            nb_cpus = FFMIN(nb_cpus, (avctx->height+15)/16);
-        // use number of cores + 1 as thread count if there is more than one
-        if (nb_cpus > 1)
-            thread_count = avctx->thread_count = FFMIN(nb_cpus + 1, MAX_AUTO_THREADS);
-        else
-            thread_count = avctx->thread_count = 1;
-    }
-
-    if (thread_count <= 1) {
-        avctx->active_thread_type = 0;
-        return 0;
-    }
+    if (avctx->thread_pool)
+        return pool_thread_init(avctx, pc);
 
     c = av_mallocz(sizeof(ThreadContext));
     if (!c)
@@ -281,7 +532,8 @@ static int thread_init(AVCodecContext *avctx)
         return -1;
     }
 
-    avctx->thread_opaque = c;
+    c->avctx = avctx;
+    c->thread_count = thread_count;
     c->current_job = 0;
     c->job_count = 0;
     c->job_size = 0;
@@ -291,21 +543,52 @@ static int thread_init(AVCodecContext *avctx)
     pthread_mutex_init(&c->current_job_lock, NULL);
     pthread_mutex_lock(&c->current_job_lock);
     for (i=0; i<thread_count; i++) {
-        if(pthread_create(&c->workers[i], NULL, worker, avctx)) {
-           avctx->thread_count = i;
+        if(pthread_create(&c->workers[i], NULL, worker, c)) {
+           c->thread_count = i;
            pthread_mutex_unlock(&c->current_job_lock);
-           ff_thread_free(avctx);
+           slice_thread_free(c);
            return -1;
         }
     }
 
     avcodec_thread_park_workers(c, thread_count);
 
+    *pc = c;
     avctx->execute = avcodec_thread_execute;
     avctx->execute2 = avcodec_thread_execute2;
     return 0;
 }
 
+static int thread_init(AVCodecContext *avctx)
+{
+    ThreadContext *c;
+    int err;
+    int thread_count = avctx->thread_count;
+
+    if (!thread_count) {
+        int nb_cpus = av_cpu_count();
+        if  (avctx->height)
+            nb_cpus = FFMIN(nb_cpus, (avctx->height+15)/16);
+        // use number of cores + 1 as thread count if there is more than one
+        if (nb_cpus > 1)
+            thread_count = avctx->thread_count = FFMIN(nb_cpus + 1, MAX_AUTO_THREADS);
+        else
+            thread_count = avctx->thread_count = 1;
+    }
+
+    if (thread_count <= 1) {
+        avctx->active_thread_type = 0;
+        return 0;
+    }
+
+    err = slice_thread_init(avctx, &c);
+    if (err < 0)
+        return err;
+
+    avctx->thread_opaque = c;
+    return 0;
+}
+
 #define THREAD_SAFE_CALLBACKS(avctx) \
 ((avctx)->thread_safe_callbacks || (!(avctx)->get_buffer && (avctx)->get_buffer2 == avcodec_default_get_buffer2))
 
@@ -343,6 +626,11 @@ static attribute_align_arg void *frame_worker_thread(void *arg)
 
         if (p->state == STATE_SETTING_UP) ff_thread_finish_setup(avctx);
 
+        if (p->hwaccel_locked) {
+            p->hwaccel_locked = 0;
+            pthread_mutex_unlock(&fctx->hwaccel_mutex);
+        }
+
         pthread_mutex_lock(&p->progress_mutex);
 #if 0 //BUFREF-FIXME
         for (i = 0; i < MAX_BUFFERS; i++)
@@ -411,7 +699,7 @@ static int update_context_from_thread(AVCodecContext *dst, AVCodecContext *src,
     }
 
     if (for_user) {
-        dst->delay       = src->thread_count - 1;
+        dst->delay       = dst->thread_count - 1;
         dst->coded_frame = src->coded_frame;
     } else {
         if (dst->codec->update_thread_context)
@@ -434,6 +722,7 @@ static int update_context_from_user(AVCodecContext *dst, AVCodecContext *src)
     dst->flags          = src->flags;
 
     dst->draw_horiz_band= src->draw_horiz_band;
+    dst->decode_progress= src->decode_progress;
     dst->get_buffer2    = src->get_buffer2;
 #if FF_API_GET_BUFFER
     dst->get_buffer     = src->get_buffer;
@@ -521,16 +810,45 @@ static int submit_packet(PerThreadContext *p, AVPacket *avpkt)
     }
 
     av_buffer_unref(&p->avpkt.buf);
+    ff_packet_free_side_data(&p->avpkt);
     p->avpkt = *avpkt;
-    if (avpkt->buf)
+    p->avpkt.side_data       = NULL;
+    p->avpkt.side_data_elems = 0;
+#if FF_API_DESTRUCT_PACKET
+    p->avpkt.destruct        = NULL;
+#endif
+    if (avpkt->buf) {
+        /* Reference the caller's buffer; the data is only read by the
+         * decoding thread, so there is no need to copy it. */
         p->avpkt.buf = av_buffer_ref(avpkt->buf);
-    else {
+        if (!p->avpkt.buf) {
+            pthread_mutex_unlock(&p->mutex);
+            return AVERROR(ENOMEM);
+        }
+    } else {
         av_fast_malloc(&p->buf, &p->allocated_buf_size, avpkt->size + FF_INPUT_BUFFER_PADDING_SIZE);
+        if (!p->buf) {
+            pthread_mutex_unlock(&p->mutex);
+            return AVERROR(ENOMEM);
+        }
         p->avpkt.data = p->buf;
         memcpy(p->buf, avpkt->data, avpkt->size);
         memset(p->buf + avpkt->size, 0, FF_INPUT_BUFFER_PADDING_SIZE);
     }
 
+    /* The side data is owned by the caller and may be freed as soon as
+     * this call returns, while the thread is still decoding the packet. */
+    if (avpkt->side_data_elems) {
+        AVPacket side = { 0 };
+        int err = av_copy_packet_side_data(&side, avpkt);
+        if (err < 0) {
+            pthread_mutex_unlock(&p->mutex);
+            return err;
+        }
+        p->avpkt.side_data       = side.side_data;
+        p->avpkt.side_data_elems = avpkt->side_data_elems;
+    }
+
     p->state = STATE_SETTING_UP;
     pthread_cond_signal(&p->input_cond);
     pthread_mutex_unlock(&p->mutex);
@@ -703,6 +1021,19 @@ void ff_thread_finish_setup(AVCodecContext *avctx) {
     pthread_mutex_unlock(&p->progress_mutex);
 }
 
+void ff_thread_hwaccel_lock(AVCodecContext *avctx)
+{
+    PerThreadContext *p = avctx->thread_opaque;
+
+    if (!(avctx->active_thread_type&FF_THREAD_FRAME) || p->hwaccel_locked)
+        return;
+
+    /* the previous threads release it when their frame is submitted, so
+     * the frames reach the hardware in decoding order */
+    pthread_mutex_lock(&p->parent->hwaccel_mutex);
+    p->hwaccel_locked = 1;
+}
+
 /// Waits for all threads to finish.
 static void park_frame_worker_threads(FrameThreadContext *fctx, int thread_count)
 {
@@ -749,6 +1080,10 @@ static void frame_thread_free(AVCodecContext *avctx, int thread_count)
             pthread_join(p->thread, NULL);
         p->thread_init=0;
 
+        if (p->slice_ctx)
+            slice_thread_free(p->slice_ctx);
+        p->slice_ctx = NULL;
+
         if (codec->close)
             codec->close(p->avctx);
 
@@ -767,6 +1102,7 @@ static void frame_thread_free(AVCodecContext *avctx, int thread_count)
         pthread_cond_destroy(&p->progress_cond);
         pthread_cond_destroy(&p->output_cond);
         av_buffer_unref(&p->avpkt.buf);
+        ff_packet_free_side_data(&p->avpkt);
         av_freep(&p->buf);
         av_freep(&p->released_buffers);
 
@@ -781,12 +1117,24 @@ static void frame_thread_free(AVCodecContext *avctx, int thread_count)
 
     av_freep(&fctx->threads);
     pthread_mutex_destroy(&fctx->buffer_mutex);
+    pthread_mutex_destroy(&fctx->hwaccel_mutex);
     av_freep(&avctx->thread_opaque);
 }
 
+/**
+ * Check if the codec can run slice threads inside its frame threads.
+ */
+static int frame_slice_threading_supported(AVCodecContext *avctx)
+{
+    return avctx->codec->capabilities & CODEC_CAP_SLICE_THREADS &&
+           avctx->thread_type & FF_THREAD_SLICE &&
+           avctx->codec_id == AV_CODEC_ID_H264;
+}
+
 static int frame_thread_init(AVCodecContext *avctx)
 {
     int thread_count = avctx->thread_count;
+    int slice_thread_count = 1;
     const AVCodec *codec = avctx->codec;
     AVCodecContext *src = avctx;
     FrameThreadContext *fctx;
@@ -808,10 +1156,19 @@ static int frame_thread_init(AVCodecContext *avctx)
         return 0;
     }
 
+    if (avctx->frame_thread_delay > 0 &&
+        avctx->frame_thread_delay < thread_count - 1) {
+        int frame_count = avctx->frame_thread_delay + 1;
+        if (frame_slice_threading_supported(avctx))
+            slice_thread_count = thread_count / frame_count;
+        thread_count = avctx->thread_count = frame_count;
+    }
+
     avctx->thread_opaque = fctx = av_mallocz(sizeof(FrameThreadContext));
 
     fctx->threads = av_mallocz(sizeof(PerThreadContext) * thread_count);
     pthread_mutex_init(&fctx->buffer_mutex, NULL);
+    pthread_mutex_init(&fctx->hwaccel_mutex, NULL);
     fctx->delaying = 1;
 
     for (i = 0; i < thread_count; i++) {
@@ -835,6 +1192,10 @@ static int frame_thread_init(AVCodecContext *avctx)
         *copy = *src;
         copy->thread_opaque = p;
         copy->pkt = &p->avpkt;
+        if (slice_thread_count > 1) {
+            copy->thread_count       = slice_thread_count;
+            copy->active_thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+        }
 
         if (!i) {
             src = copy;
@@ -864,6 +1225,10 @@ static int frame_thread_init(AVCodecContext *avctx)
 
         if (err) goto error;
 
+        if (slice_thread_count > 1 &&
+            (err = slice_thread_init(copy, &p->slice_ctx)) < 0)
+            goto error;
+
         err = AVERROR(pthread_create(&p->thread, NULL, frame_worker_thread, p));
         p->thread_init= !err;
         if(!p->thread_init)
@@ -192,6 +192,66 @@ static void av_unused put_bits32(PutBitContext *s, uint32_t value)
 #endif
 }
 
+#ifndef BITSTREAM_WRITER_LE
+/**
+ * Bitstream writer with a 64-bit accumulator, for entropy coding loops
+ * that emit many codes in a row. It borrows the state of a PutBitContext
+ * with init_put_bits64() and must hand it back with sync_put_bits64()
+ * before the PutBitContext is used again.
+ */
+typedef struct PutBitContext64 {
+    uint64_t bit_buf;
+    int bit_left;
+    uint8_t *buf_ptr, *buf_end;
+} PutBitContext64;
+
+static inline void init_put_bits64(PutBitContext64 *s, const PutBitContext *pb)
+{
+    s->bit_buf  = pb->bit_buf;
+    s->bit_left = 32 + pb->bit_left;
+    s->buf_ptr  = pb->buf_ptr;
+    s->buf_end  = pb->buf_end;
+}
+
+/**
+ * Write up to 32 bits into a bitstream.
+ */
+static inline void put_bits64(PutBitContext64 *s, int n, uint32_t value)
+{
+    av_assert2(n <= 32 && (n == 32 || value < (1U << n)));
+
+    if (n < s->bit_left) {
+        s->bit_buf   = (s->bit_buf << n) | value;
+        s->bit_left -= n;
+    } else {
+        av_assert2(s->buf_ptr + 7 < s->buf_end);
+        AV_WB64(s->buf_ptr, (s->bit_buf << s->bit_left) |
+                            ((uint64_t)value >> (n - s->bit_left)));
+        s->buf_ptr  += 8;
+        s->bit_left += 64 - n;
+        s->bit_buf   = value;
+    }
+}
+
+/**
+ * Store the state of s back into pb.
+ */
+static inline void sync_put_bits64(PutBitContext64 *s, PutBitContext *pb)
+{
+    int pending = 64 - s->bit_left;
+
+    while (pending >= 32) {
+        av_assert2(s->buf_ptr + 3 < s->buf_end);
+        AV_WB32(s->buf_ptr, s->bit_buf >> (pending - 32));
+        s->buf_ptr += 4;
+        pending    -= 32;
+    }
+    pb->bit_buf  = s->bit_buf;
+    pb->bit_left = 32 - pending;
+    pb->buf_ptr  = s->buf_ptr;
+}
+#endif
+
 /**
  * Return the pointer to the byte where the bitstream writer will put
  * the next bit.
@@ -0,0 +1,78 @@
+/*
+ * Start code search
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/attributes.h"
+#include "libavutil/intreadwrite.h"
+#include "config.h"
+#include "internal.h"
+#include "startcode.h"
+
+#if HAVE_FAST_64BIT
+#define WORD_SIZE 8
+#define READ_WORD(p) AV_RN64(p)
+#define HAS_ZERO(x)  (((x) - 0x0101010101010101ULL) & ~(x) & 0x8080808080808080ULL)
+#else
+#define WORD_SIZE 4
+#define READ_WORD(p) AV_RN32(p)
+#define HAS_ZERO(x)  (((x) - 0x01010101U) & ~(x) & 0x80808080U)
+#endif
+
+int ff_startcode_find_candidate_c(const uint8_t *buf, int size)
+{
+    int i = 0, j;
+
+#if HAVE_FAST_UNALIGNED
+    /* a word without zero bytes cannot hold the first byte of a pair */
+    for (; i + WORD_SIZE < size; i += WORD_SIZE) {
+        if (!HAS_ZERO(READ_WORD(buf + i)))
+            continue;
+        for (j = i; j < i + WORD_SIZE; j++)
+            if (!buf[j] && !buf[j + 1])
+                return j;
+    }
+#endif
+
+    for (; i + 1 < size; i++)
+        if (!buf[i] && !buf[i + 1])
+            return i;
+
+    return size;
+}
+
+av_cold void ff_startcode_init(StartCodeContext *c)
+{
+    c->find_candidate = ff_startcode_find_candidate_c;
+
+    if (ARCH_X86)
+        ff_startcode_init_x86(c);
+}
+
+int avpriv_startcode_find_candidate(const uint8_t *buf, int size)
+{
+    static int (*find_candidate)(const uint8_t *buf, int size);
+
+    if (!find_candidate) {
+        StartCodeContext c;
+        ff_startcode_init(&c);
+        find_candidate = c.find_candidate;
+    }
+
+    return find_candidate(buf, size);
+}
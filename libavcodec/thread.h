@@ -71,6 +71,17 @@ int ff_thread_decode_frame(AVCodecContext *avctx, AVFrame *picture,
  */
 void ff_thread_finish_setup(AVCodecContext *avctx);
 
+/**
+ * Call this before the first hwaccel call for a frame, so that the
+ * hwaccel calls of the frame threads do not run concurrently and are
+ * made in decoding order. The setup of the next frames can still run
+ * in the other threads meanwhile.
+ * The lock is released when the decode() call of the codec returns.
+ *
+ * @param avctx The context.
+ */
+void ff_thread_hwaccel_lock(AVCodecContext *avctx);
+
 /**
  * Notify later decoding threads when part of their reference picture is ready.
  * Call this when some part of the picture is finished decoding.
@@ -28,6 +28,7 @@
 #include "config.h"
 #include "libavutil/attributes.h"
 #include "libavutil/avassert.h"
+#include "libavutil/atomic.h"
 #include "libavutil/avstring.h"
 #include "libavutil/bprint.h"
 #include "libavutil/channel_layout.h"
@@ -36,6 +37,7 @@
 #include "libavutil/mathematics.h"
 #include "libavutil/pixdesc.h"
 #include "libavutil/imgutils.h"
+#include "libavutil/profile_internal.h"
 #include "libavutil/samplefmt.h"
 #include "libavutil/dict.h"
 #include "libavutil/avassert.h"
@@ -148,12 +150,12 @@ static av_cold void avcodec_init(void)
 
 int av_codec_is_encoder(const AVCodec *codec)
 {
-    return codec && (codec->encode_sub || codec->encode2);
+    return codec && (codec->encode_sub || codec->encode2 || codec->send_frame);
 }
 
 int av_codec_is_decoder(const AVCodec *codec)
 {
-    return codec && codec->decode;
+    return codec && (codec->decode || codec->receive_frame);
 }
 
 av_cold void avcodec_register(AVCodec *codec)
@@ -374,6 +376,86 @@ int avcodec_fill_audio_frame(AVFrame *frame, int nb_channels,
     return ret;
 }
 
+#define SHARED_FRAME_POOLS 32
+
+typedef struct SharedFramePool {
+    int size;
+    AVBufferPool *pool;
+} SharedFramePool;
+
+/**
+ * Video buffer pools shared by the contexts which set shared_frame_pool,
+ * one per buffer size. Slots are filled lock-free as new sizes are needed
+ * and only emptied when the last of these contexts is closed, under the
+ * codec lock.
+ */
+static SharedFramePool *volatile shared_frame_pools[SHARED_FRAME_POOLS];
+static int shared_frame_pools_refcount;
+
+static AVBufferRef *frame_pool_alloc(int size)
+{
+    return CONFIG_MEMORY_POISONING ? av_buffer_alloc(size) : av_buffer_allocz(size);
+}
+
+static AVBufferPool *get_shared_frame_pool(int size)
+{
+    SharedFramePool *entry, *new = NULL;
+    int i;
+
+    for (i = 0; i < SHARED_FRAME_POOLS; i++) {
+        entry = shared_frame_pools[i];
+        if (!entry) {
+            if (!new) {
+                new = av_mallocz(sizeof(*new));
+                if (!new)
+                    return NULL;
+                new->size = size;
+                new->pool = av_buffer_pool_init(size, frame_pool_alloc);
+                if (!new->pool) {
+                    av_free(new);
+                    return NULL;
+                }
+            }
+            entry = avpriv_atomic_ptr_cas((void * volatile *)&shared_frame_pools[i],
+                                          NULL, new);
+            if (!entry)
+                return new->pool;
+        }
+        if (entry->size == size)
+            break;
+    }
+    if (new) {
+        av_buffer_pool_uninit(&new->pool);
+        av_free(new);
+    }
+    return i < SHARED_FRAME_POOLS ? entry->pool : NULL;
+}
+
+static void shared_frame_pools_unref(void)
+{
+    int i;
+
+    if (--shared_frame_pools_refcount)
+        return;
+    for (i = 0; i < SHARED_FRAME_POOLS && shared_frame_pools[i]; i++) {
+        av_buffer_pool_uninit(&shared_frame_pools[i]->pool);
+        av_freep(&shared_frame_pools[i]);
+    }
+}
+
+static void frame_pool_uninit(FramePool *pool)
+{
+    int i;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(pool->pools); i++) {
+        if (pool->shared)
+            pool->pools[i] = NULL;
+        else
+            av_buffer_pool_uninit(&pool->pools[i]);
+    }
+    pool->shared = 0;
+}
+
 static int update_frame_pool(AVCodecContext *avctx, AVFrame *frame)
 {
     FramePool *pool = avctx->internal->pool;
@@ -419,9 +501,23 @@ static int update_frame_pool(AVCodecContext *avctx, AVFrame *frame)
             size[i] = picture.data[i + 1] - picture.data[i];
         size[i] = tmpsize - (picture.data[i] - picture.data[0]);
 
-        for (i = 0; i < 4; i++) {
-            av_buffer_pool_uninit(&pool->pools[i]);
+        frame_pool_uninit(pool);
+        for (i = 0; i < 4; i++)
             pool->linesize[i] = picture.linesize[i];
+
+        if (pool->shared_ref) {
+            for (i = 0; i < 4 && size[i]; i++) {
+                pool->pools[i] = get_shared_frame_pool(size[i] + 16 + STRIDE_ALIGN - 1);
+                if (!pool->pools[i])
+                    break;
+            }
+            pool->shared = 1;
+            /* all the slots are taken, fall back to private pools */
+            if (i < 4 && size[i])
+                frame_pool_uninit(pool);
+        }
+
+        for (i = 0; i < 4 && !pool->shared; i++) {
             if (size[i]) {
                 pool->pools[i] = av_buffer_pool_init(size[i] + 16 + STRIDE_ALIGN - 1,
                                                      CONFIG_MEMORY_POISONING ?
@@ -448,7 +544,7 @@ static int update_frame_pool(AVCodecContext *avctx, AVFrame *frame)
             pool->channels == ch && frame->nb_samples == pool->samples)
             return 0;
 
-        av_buffer_pool_uninit(&pool->pools[0]);
+        frame_pool_uninit(pool);
         ret = av_samples_get_buffer_size(&pool->linesize[0], ch,
                                          frame->nb_samples, frame->format, 0);
         if (ret < 0)
@@ -470,8 +566,7 @@ static int update_frame_pool(AVCodecContext *avctx, AVFrame *frame)
     }
     return 0;
 fail:
-    for (i = 0; i < 4; i++)
-        av_buffer_pool_uninit(&pool->pools[i]);
+    frame_pool_uninit(pool);
     pool->format = -1;
     pool->planes = pool->channels = pool->samples = 0;
     pool->width  = pool->height = 0;
@@ -620,6 +715,23 @@ int avcodec_default_get_buffer2(AVCodecContext *avctx, AVFrame *frame, int flags
     }
 }
 
+static void latency_trace_from_packet(AVFrame *frame, AVPacket *pkt)
+{
+    AVFrameSideData *sd;
+    uint8_t *trace;
+    int size;
+
+    trace = av_packet_get_side_data(pkt, AV_PKT_DATA_LATENCY_TRACE, &size);
+    if (!trace || av_frame_get_side_data(frame, AV_FRAME_DATA_LATENCY_TRACE))
+        return;
+    sd = av_frame_new_side_data(frame, AV_FRAME_DATA_LATENCY_TRACE,
+                                sizeof(AVLatencyTrace));
+    if (sd) {
+        memset(sd->data, 0, sd->size);
+        memcpy(sd->data, trace, FFMIN(size, sd->size));
+    }
+}
+
 int ff_init_buffer_info(AVCodecContext *avctx, AVFrame *frame)
 {
     if (avctx->pkt) {
@@ -627,6 +739,7 @@ int ff_init_buffer_info(AVCodecContext *avctx, AVFrame *frame)
         av_frame_set_pkt_pos     (frame, avctx->pkt->pos);
         av_frame_set_pkt_duration(frame, avctx->pkt->duration);
         av_frame_set_pkt_size    (frame, avctx->pkt->size);
+        latency_trace_from_packet(frame, (AVPacket *)avctx->pkt);
     } else {
         frame->pkt_pts = AV_NOPTS_VALUE;
         av_frame_set_pkt_pos     (frame, -1);
@@ -1092,6 +1205,19 @@ int attribute_align_arg avcodec_open2(AVCodecContext *avctx, const AVCodec *code
         goto free_and_end;
     }
 
+    avctx->internal->buffer_frame = av_frame_alloc();
+    if (!avctx->internal->buffer_frame) {
+        ret = AVERROR(ENOMEM);
+        goto free_and_end;
+    }
+    av_init_packet(&avctx->internal->buffer_pkt);
+    avctx->internal->buffer_pkt.data = NULL;
+    avctx->internal->buffer_pkt.size = 0;
+    if (avctx->shared_frame_pool && avctx->codec_type == AVMEDIA_TYPE_VIDEO) {
+        avctx->internal->pool->shared_ref = 1;
+        shared_frame_pools_refcount++;
+    }
+
     if (codec->priv_data_size > 0) {
         if (!avctx->priv_data) {
             avctx->priv_data = av_mallocz(codec->priv_data_size);
@@ -1306,7 +1432,14 @@ int attribute_align_arg avcodec_open2(AVCodecContext *avctx, const AVCodec *code
 
     if (   avctx->codec->init && (!(avctx->active_thread_type&FF_THREAD_FRAME)
         || avctx->internal->frame_thread_encoder)) {
-        ret = avctx->codec->init(avctx);
+        /* codecs which guard their static tables themselves do not need
+         * the lock, so opening them does not wait for other codecs */
+        if (avctx->codec->caps_internal & FF_CODEC_CAP_INIT_THREADSAFE) {
+            ff_unlock_avcodec();
+            ret = avctx->codec->init(avctx);
+            ff_lock_avcodec(avctx);
+        } else
+            ret = avctx->codec->init(avctx);
         if (ret < 0) {
             goto free_and_end;
         }
@@ -1386,8 +1519,13 @@ end:
 free_and_end:
     av_dict_free(&tmp);
     av_freep(&avctx->priv_data);
-    if (avctx->internal)
+    if (avctx->internal && avctx->internal->pool &&
+        avctx->internal->pool->shared_ref)
+        shared_frame_pools_unref();
+    if (avctx->internal) {
         av_freep(&avctx->internal->pool);
+        av_frame_free(&avctx->internal->buffer_frame);
+    }
     av_freep(&avctx->internal);
     avctx->codec = NULL;
     goto end;
@@ -1481,6 +1619,141 @@ fail:
     return ret;
 }
 
+#define MAX_LATENCY_TRACES 256
+
+/**
+ * Queue the latency trace of a frame sent to the encoder.
+ */
+static void latency_trace_encode_in(AVCodecContext *avctx, const AVFrame *frame)
+{
+    AVCodecInternal *avci = avctx->internal;
+    AVFrameSideData *sd;
+    struct LatencyTraceEntry *entry;
+
+    if (!frame)
+        return;
+    sd = av_frame_get_side_data((AVFrame *)frame, AV_FRAME_DATA_LATENCY_TRACE);
+    if (!sd || sd->size < sizeof(AVLatencyTrace))
+        return;
+
+    /* drop the oldest trace if the encoder never output its packet */
+    if (avci->nb_latency_traces >= MAX_LATENCY_TRACES) {
+        avci->nb_latency_traces--;
+        memmove(avci->latency_traces, avci->latency_traces + 1,
+                avci->nb_latency_traces * sizeof(*avci->latency_traces));
+    } else {
+        entry = av_realloc(avci->latency_traces, (avci->nb_latency_traces + 1) *
+                           sizeof(*avci->latency_traces));
+        if (!entry)
+            return;
+        avci->latency_traces = entry;
+    }
+    entry = &avci->latency_traces[avci->nb_latency_traces++];
+    entry->pts = frame->pts;
+    memcpy(&entry->trace, sd->data, sizeof(entry->trace));
+    av_latency_trace_stamp(&entry->trace, AV_LATENCY_ENCODE_IN);
+}
+
+/**
+ * Attach the latency trace of the frame an encoded packet comes from.
+ * The packet pts identifies the frame; when the encoder changes the
+ * timestamps, the oldest queued trace is used instead.
+ */
+static void latency_trace_encode_out(AVCodecContext *avctx, AVPacket *avpkt)
+{
+    AVCodecInternal *avci = avctx->internal;
+    uint8_t *sd;
+    int i;
+
+    if (!avci->nb_latency_traces)
+        return;
+    for (i = 0; i < avci->nb_latency_traces; i++)
+        if (avci->latency_traces[i].pts == avpkt->pts)
+            break;
+    if (i == avci->nb_latency_traces)
+        i = 0;
+
+    sd = av_packet_new_side_data(avpkt, AV_PKT_DATA_LATENCY_TRACE,
+                                 sizeof(AVLatencyTrace));
+    if (sd) {
+        av_latency_trace_stamp(&avci->latency_traces[i].trace,
+                               AV_LATENCY_ENCODE_OUT);
+        memcpy(sd, &avci->latency_traces[i].trace, sizeof(AVLatencyTrace));
+    }
+    avci->nb_latency_traces--;
+    memmove(avci->latency_traces + i, avci->latency_traces + i + 1,
+            (avci->nb_latency_traces - i) * sizeof(*avci->latency_traces));
+}
+
+FF_PROFILE_COUNTER(encode_audio_counter, "encode_audio");
+FF_PROFILE_COUNTER(encode_video_counter, "encode_video");
+FF_PROFILE_COUNTER(decode_audio_counter, "decode_audio");
+FF_PROFILE_COUNTER(decode_video_counter, "decode_video");
+
+static void reset_buffer_pkt(AVCodecInternal *avci)
+{
+    av_free_packet(&avci->buffer_pkt);
+    av_init_packet(&avci->buffer_pkt);
+    avci->buffer_pkt.data = NULL;
+    avci->buffer_pkt.size = 0;
+}
+
+/*
+ * The old encoding API on top of the send_frame() and receive_packet()
+ * callbacks. One packet is returned per call, so the encoder must accept
+ * a new frame once the packet for the previous one has been read.
+ */
+static int compat_encode(AVCodecContext *avctx, AVPacket *avpkt,
+                         const AVFrame *frame, int *got_packet)
+{
+    AVPacket user_pkt = *avpkt;
+    AVPacket pkt;
+    int ret;
+
+    ret = avcodec_send_frame(avctx, frame);
+    if (ret == AVERROR_EOF && !frame)
+        ret = 0; // already draining
+    if (ret == AVERROR(EAGAIN)) {
+        av_log(avctx, AV_LOG_ERROR, "The encoder did not accept a frame after "
+               "returning a packet, which the old encoding API requires.\n");
+        ret = AVERROR_BUG;
+    }
+    if (ret < 0)
+        goto fail;
+
+    av_init_packet(&pkt);
+    pkt.data = NULL;
+    pkt.size = 0;
+    ret = avcodec_receive_packet(avctx, &pkt);
+    if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
+        ret = 0;
+    if (ret < 0 || !pkt.data && !pkt.side_data_elems)
+        goto fail;
+
+    if (user_pkt.data) {
+        if (user_pkt.size < pkt.size) {
+            av_log(avctx, AV_LOG_ERROR, "Provided packet is too small, needs to be %d\n", pkt.size);
+            av_free_packet(&pkt);
+            ret = AVERROR(EINVAL);
+            goto fail;
+        }
+        memcpy(user_pkt.data, pkt.data, pkt.size);
+        av_buffer_unref(&pkt.buf);
+        pkt.buf      = user_pkt.buf;
+        pkt.data     = user_pkt.data;
+#if FF_API_DESTRUCT_PACKET
+        pkt.destruct = user_pkt.destruct;
+#endif
+    }
+    *avpkt      = pkt;
+    *got_packet = 1;
+    return 0;
+
+fail:
+    av_free_packet(avpkt);
+    return ret;
+}
+
 int attribute_align_arg avcodec_encode_audio2(AVCodecContext *avctx,
                                               AVPacket *avpkt,
                                               const AVFrame *frame,
@@ -1488,12 +1761,16 @@ int attribute_align_arg avcodec_encode_audio2(AVCodecContext *avctx,
 {
     AVFrame tmp;
     AVFrame *padded_frame = NULL;
+    uint64_t prof;
     int ret;
     AVPacket user_pkt = *avpkt;
     int needs_realloc = !user_pkt.data;
 
     *got_packet_ptr = 0;
 
+    if (avctx->codec->send_frame)
+        return compat_encode(avctx, avpkt, frame, got_packet_ptr);
+
     if (!(avctx->codec->capabilities & CODEC_CAP_DELAY) && !frame) {
         av_free_packet(avpkt);
         av_init_packet(avpkt);
@@ -1542,7 +1819,11 @@ int attribute_align_arg avcodec_encode_audio2(AVCodecContext *avctx,
         }
     }
 
+    latency_trace_encode_in(avctx, frame);
+
+    prof = avpriv_profile_start();
     ret = avctx->codec->encode2(avctx, avpkt, frame, got_packet_ptr);
+    avpriv_profile_stop(&encode_audio_counter, prof);
     if (!ret) {
         if (*got_packet_ptr) {
             if (!(avctx->codec->capabilities & CODEC_CAP_DELAY)) {
@@ -1598,6 +1879,8 @@ int attribute_align_arg avcodec_encode_audio2(AVCodecContext *avctx,
      *       here to simplify things */
     avpkt->flags |= AV_PKT_FLAG_KEY;
 
+    latency_trace_encode_out(avctx, avpkt);
+
 end:
     if (padded_frame) {
         av_freep(&padded_frame->data[0]);
@@ -1729,14 +2012,22 @@ int attribute_align_arg avcodec_encode_video2(AVCodecContext *avctx,
                                               int *got_packet_ptr)
 {
     int ret;
+    uint64_t prof;
     AVPacket user_pkt = *avpkt;
     int needs_realloc = !user_pkt.data;
 
     *got_packet_ptr = 0;
 
+    if (avctx->codec->send_frame)
+        return compat_encode(avctx, avpkt, frame, got_packet_ptr);
+
     if(CONFIG_FRAME_THREAD_ENCODER &&
-       avctx->internal->frame_thread_encoder && (avctx->active_thread_type&FF_THREAD_FRAME))
-        return ff_thread_video_encode_frame(avctx, avpkt, frame, got_packet_ptr);
+       avctx->internal->frame_thread_encoder && (avctx->active_thread_type&FF_THREAD_FRAME)) {
+        prof = avpriv_profile_start();
+        ret  = ff_thread_video_encode_frame(avctx, avpkt, frame, got_packet_ptr);
+        avpriv_profile_stop(&encode_video_counter, prof);
+        return ret;
+    }
 
     if ((avctx->flags&CODEC_FLAG_PASS1) && avctx->stats_out)
         avctx->stats_out[0] = '\0';
@@ -1753,7 +2044,11 @@ int attribute_align_arg avcodec_encode_video2(AVCodecContext *avctx,
 
     av_assert0(avctx->codec->encode2);
 
+    latency_trace_encode_in(avctx, frame);
+
+    prof = avpriv_profile_start();
     ret = avctx->codec->encode2(avctx, avpkt, frame, got_packet_ptr);
+    avpriv_profile_stop(&encode_video_counter, prof);
     av_assert0(ret <= 0);
 
     if (avpkt->data && avpkt->data == avctx->internal->byte_buffer) {
@@ -1793,8 +2088,10 @@ int attribute_align_arg avcodec_encode_video2(AVCodecContext *avctx,
 
     if (ret < 0 || !*got_packet_ptr)
         av_free_packet(avpkt);
-    else
+    else {
+        latency_trace_encode_out(avctx, avpkt);
         av_packet_merge_side_data(avpkt);
+    }
 
     emms_c();
     return ret;
@@ -1814,6 +2111,97 @@ int avcodec_encode_subtitle(AVCodecContext *avctx, uint8_t *buf, int buf_size,
     return ret;
 }
 
+/* Encode with the old API into buffer_pkt, to emulate the new API. */
+static int do_encode(AVCodecContext *avctx, const AVFrame *frame)
+{
+    AVCodecInternal *avci = avctx->internal;
+    int got_packet = 0, ret;
+
+    reset_buffer_pkt(avci);
+    avci->buffer_pkt_valid = 0;
+
+    if (avctx->codec_type == AVMEDIA_TYPE_VIDEO)
+        ret = avcodec_encode_video2(avctx, &avci->buffer_pkt, frame, &got_packet);
+    else if (avctx->codec_type == AVMEDIA_TYPE_AUDIO)
+        ret = avcodec_encode_audio2(avctx, &avci->buffer_pkt, frame, &got_packet);
+    else
+        ret = AVERROR(EINVAL);
+
+    if (ret >= 0 && got_packet) {
+        /* the packets returned by the new API are reference counted */
+        if (avci->buffer_pkt.data && !avci->buffer_pkt.buf &&
+            (ret = av_dup_packet(&avci->buffer_pkt)) < 0) {
+            reset_buffer_pkt(avci);
+            return ret;
+        }
+        avci->buffer_pkt_valid = 1;
+    } else
+        reset_buffer_pkt(avci);
+
+    return FFMIN(ret, 0);
+}
+
+int attribute_align_arg avcodec_send_frame(AVCodecContext *avctx, const AVFrame *frame)
+{
+    AVCodecInternal *avci = avctx->internal;
+
+    if (!avcodec_is_open(avctx) || !av_codec_is_encoder(avctx->codec))
+        return AVERROR(EINVAL);
+
+    if (avci->draining)
+        return AVERROR_EOF;
+
+    if (!frame) {
+        avci->draining = 1;
+
+        if (!(avctx->codec->capabilities & CODEC_CAP_DELAY))
+            return 0;
+    }
+
+    if (avctx->codec->send_frame)
+        return avctx->codec->send_frame(avctx, frame);
+
+    /* Emulation on top of encode2(). The frame is encoded here rather than
+     * in avcodec_receive_packet(), so that it does not need to be copied. */
+    if (avci->buffer_pkt_valid)
+        return AVERROR(EAGAIN);
+
+    return do_encode(avctx, frame);
+}
+
+int attribute_align_arg avcodec_receive_packet(AVCodecContext *avctx, AVPacket *avpkt)
+{
+    AVCodecInternal *avci = avctx->internal;
+    int ret;
+
+    av_free_packet(avpkt);
+
+    if (!avcodec_is_open(avctx) || !av_codec_is_encoder(avctx->codec))
+        return AVERROR(EINVAL);
+
+    if (avctx->codec->receive_packet) {
+        if (avci->draining && !(avctx->codec->capabilities & CODEC_CAP_DELAY))
+            return AVERROR_EOF;
+        return avctx->codec->receive_packet(avctx, avpkt);
+    }
+
+    if (!avci->buffer_pkt_valid) {
+        if (!avci->draining)
+            return AVERROR(EAGAIN);
+        if ((ret = do_encode(avctx, NULL)) < 0)
+            return ret;
+        if (!avci->buffer_pkt_valid)
+            return AVERROR_EOF;
+    }
+
+    *avpkt = avci->buffer_pkt;
+    av_init_packet(&avci->buffer_pkt);
+    avci->buffer_pkt.data  = NULL;
+    avci->buffer_pkt.size  = 0;
+    avci->buffer_pkt_valid = 0;
+    return 0;
+}
+
 /**
  * Attempt to guess proper monotonic timestamps for decoded video frames
  * which might have incorrect times. Input timestamps may wrap around, in
@@ -1911,12 +2299,71 @@ end:
     return ret;
 }
 
+/*
+ * The old decoding API on top of the send_packet() and receive_frame()
+ * callbacks. The old API cannot ask for more frames without sending a
+ * packet, so all the frames are read after each packet and only the first
+ * one is returned.
+ */
+static int compat_decode(AVCodecContext *avctx, AVFrame *frame,
+                         int *got_frame, const AVPacket *pkt)
+{
+    AVCodecInternal *avci = avctx->internal;
+    int ret;
+
+    if (!avctx->refcounted_frames)
+        av_frame_unref(&avci->to_free);
+
+    ret = avcodec_send_packet(avctx, pkt);
+    if (ret == AVERROR_EOF)
+        ret = 0; // flushing an already draining decoder
+    if (ret < 0)
+        return ret;
+
+    while (1) {
+        ret = avcodec_receive_frame(avctx, *got_frame ? avci->buffer_frame : frame);
+        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+            ret = 0;
+            break;
+        }
+        if (ret < 0)
+            break;
+
+        if (!*got_frame) {
+            *got_frame = 1;
+        } else {
+            av_frame_unref(avci->buffer_frame);
+            if (!avci->compat_decode_warned) {
+                av_log(avctx, AV_LOG_WARNING, "The old decoding API cannot "
+                       "return all the frames of this decoder, some are "
+                       "dropped. Use avcodec_send_packet() and "
+                       "avcodec_receive_frame() instead.\n");
+                avci->compat_decode_warned = 1;
+            }
+        }
+        /* a single frame per flush packet */
+        if (avci->draining)
+            break;
+    }
+
+    if (*got_frame && !avctx->refcounted_frames) {
+        avci->to_free = *frame;
+        avci->to_free.extended_data = avci->to_free.data;
+        memset(frame->buf, 0, sizeof(frame->buf));
+        frame->extended_buf    = NULL;
+        frame->nb_extended_buf = 0;
+    }
+
+    return ret < 0 ? ret : pkt->size;
+}
+
 int attribute_align_arg avcodec_decode_video2(AVCodecContext *avctx, AVFrame *picture,
                                               int *got_picture_ptr,
                                               const AVPacket *avpkt)
 {
     AVCodecInternal *avci = avctx->internal;
     int ret;
+    uint64_t prof;
     // copy to ensure we do not change avpkt
     AVPacket tmp = *avpkt;
 
@@ -1929,6 +2376,9 @@ int attribute_align_arg avcodec_decode_video2(AVCodecContext *avctx, AVFrame *pi
     if ((avctx->coded_width || avctx->coded_height) && av_image_check_size(avctx->coded_width, avctx->coded_height, 0, avctx))
         return AVERROR(EINVAL);
 
+    if (avctx->codec->receive_frame)
+        return compat_decode(avctx, picture, got_picture_ptr, avpkt);
+
     avcodec_get_frame_defaults(picture);
 
     if (!avctx->refcounted_frames)
@@ -1938,6 +2388,7 @@ int attribute_align_arg avcodec_decode_video2(AVCodecContext *avctx, AVFrame *pi
         int did_split = av_packet_split_side_data(&tmp);
         apply_param_change(avctx, &tmp);
         avctx->pkt = &tmp;
+        prof = avpriv_profile_start();
         if (HAVE_THREADS && avctx->active_thread_type & FF_THREAD_FRAME)
             ret = ff_thread_decode_frame(avctx, picture, got_picture_ptr,
                                          &tmp);
@@ -1958,6 +2409,7 @@ int attribute_align_arg avcodec_decode_video2(AVCodecContext *avctx, AVFrame *pi
                 if (picture->format == AV_PIX_FMT_NONE)   picture->format              = avctx->pix_fmt;
             }
         }
+        avpriv_profile_stop(&decode_video_counter, prof);
         add_metadata_from_side_data(avctx, picture);
 
         emms_c(); //needed to avoid an emms_c() call before every return;
@@ -1980,6 +2432,7 @@ int attribute_align_arg avcodec_decode_video2(AVCodecContext *avctx, AVFrame *pi
             }
 
             avctx->frame_number++;
+            av_frame_latency_trace_stamp(picture, AV_LATENCY_DECODE);
             av_frame_set_best_effort_timestamp(picture,
                                                guess_correct_pts(avctx,
                                                                  picture->pkt_pts,
@@ -2051,6 +2504,7 @@ int attribute_align_arg avcodec_decode_audio4(AVCodecContext *avctx,
 {
     AVCodecInternal *avci = avctx->internal;
     int planar, channels;
+    uint64_t prof;
     int ret = 0;
 
     *got_frame_ptr = 0;
@@ -2064,6 +2518,9 @@ int attribute_align_arg avcodec_decode_audio4(AVCodecContext *avctx,
         return AVERROR(EINVAL);
     }
 
+    if (avctx->codec->receive_frame)
+        return compat_decode(avctx, frame, got_frame_ptr, avpkt);
+
     avcodec_get_frame_defaults(frame);
 
     if (!avctx->refcounted_frames)
@@ -2078,15 +2535,18 @@ int attribute_align_arg avcodec_decode_audio4(AVCodecContext *avctx,
         apply_param_change(avctx, &tmp);
 
         avctx->pkt = &tmp;
+        prof = avpriv_profile_start();
         if (HAVE_THREADS && avctx->active_thread_type & FF_THREAD_FRAME)
             ret = ff_thread_decode_frame(avctx, frame, got_frame_ptr, &tmp);
         else {
             ret = avctx->codec->decode(avctx, frame, got_frame_ptr, &tmp);
             frame->pkt_dts = avpkt->dts;
         }
+        avpriv_profile_stop(&decode_audio_counter, prof);
         if (ret >= 0 && *got_frame_ptr) {
             add_metadata_from_side_data(avctx, frame);
             avctx->frame_number++;
+            av_frame_latency_trace_stamp(frame, AV_LATENCY_DECODE);
             av_frame_set_best_effort_timestamp(frame,
                                                guess_correct_pts(avctx,
                                                                  frame->pkt_pts,
@@ -2170,6 +2630,181 @@ int attribute_align_arg avcodec_decode_audio4(AVCodecContext *avctx,
     return ret;
 }
 
+/**
+ * Make dst a new reference to src, copying the data if src is not
+ * reference counted.
+ */
+static int ref_packet(AVPacket *dst, const AVPacket *src)
+{
+    int ret = av_copy_packet(dst, (AVPacket *)src);
+    if (ret < 0)
+        return ret;
+    /* av_copy_packet() points to the start of the buffer */
+    if (src->buf)
+        dst->data = src->data;
+    return 0;
+}
+
+/* Decode with the old API from pkt into buffer_frame, to emulate the new
+ * API. The part of pkt which is not consumed is kept in buffer_pkt. */
+static int do_decode(AVCodecContext *avctx, const AVPacket *pkt)
+{
+    AVCodecInternal *avci = avctx->internal;
+    int got_frame = 0, ret;
+
+    av_assert0(!avci->buffer_frame->buf[0]);
+
+    /* the frames returned by the new API are reference counted; the field
+     * only exists for the users of the old API */
+    avctx->refcounted_frames = 1;
+
+    /* some decoders do not support being flushed again once drained */
+    if (avci->draining_done)
+        return AVERROR_EOF;
+
+    if (avctx->codec_type == AVMEDIA_TYPE_VIDEO) {
+        ret = avcodec_decode_video2(avctx, avci->buffer_frame, &got_frame, pkt);
+        if (ret >= 0)
+            ret = pkt->size;
+    } else if (avctx->codec_type == AVMEDIA_TYPE_AUDIO) {
+        ret = avcodec_decode_audio4(avctx, avci->buffer_frame, &got_frame, pkt);
+    } else
+        ret = AVERROR(EINVAL);
+
+    if (avci->draining && !got_frame)
+        avci->draining_done = 1;
+
+    if (ret < 0)
+        return ret;
+
+    if (got_frame && !avci->buffer_frame->buf[0]) {
+        AVFrame *tmp = av_frame_alloc();
+
+        if (!tmp || (ret = av_frame_ref(tmp, avci->buffer_frame)) < 0) {
+            av_frame_free(&tmp);
+            av_frame_unref(avci->buffer_frame);
+            return tmp ? ret : AVERROR(ENOMEM);
+        }
+        av_frame_unref(avci->buffer_frame);
+        av_frame_move_ref(avci->buffer_frame, tmp);
+        av_frame_free(&tmp);
+    }
+
+    /* a decoder consuming nothing without output would never progress */
+    if (ret >= pkt->size || !ret && !got_frame) {
+        if (pkt == &avci->buffer_pkt)
+            reset_buffer_pkt(avci);
+    } else {
+        int consumed = ret;
+
+        if (pkt != &avci->buffer_pkt &&
+            (ret = ref_packet(&avci->buffer_pkt, pkt)) < 0)
+            return ret;
+        avci->buffer_pkt.data += consumed;
+        avci->buffer_pkt.size -= consumed;
+        avci->buffer_pkt.pts   = AV_NOPTS_VALUE;
+        avci->buffer_pkt.dts   = AV_NOPTS_VALUE;
+    }
+
+    return 0;
+}
+
+int attribute_align_arg avcodec_send_packet(AVCodecContext *avctx, const AVPacket *avpkt)
+{
+    AVCodecInternal *avci = avctx->internal;
+    int ret;
+
+    if (!avcodec_is_open(avctx) || !av_codec_is_decoder(avctx->codec))
+        return AVERROR(EINVAL);
+
+    if (avci->draining)
+        return AVERROR_EOF;
+
+    if (avpkt && !avpkt->size && avpkt->data)
+        return AVERROR(EINVAL);
+
+    if (!avpkt || !avpkt->size) {
+        avci->draining = 1;
+        avpkt = &avci->buffer_pkt;
+
+        if (!(avctx->codec->capabilities & CODEC_CAP_DELAY) &&
+            !(avctx->active_thread_type & FF_THREAD_FRAME))
+            return 0;
+    }
+
+    if (avctx->codec->send_packet) {
+        AVPacket tmp;
+        int did_split;
+
+        if (avci->draining)
+            return avctx->codec->send_packet(avctx, NULL);
+
+        tmp       = *avpkt;
+        did_split = av_packet_split_side_data(&tmp);
+        apply_param_change(avctx, &tmp);
+        ret = avctx->codec->send_packet(avctx, &tmp);
+        if (did_split)
+            ff_packet_free_side_data(&tmp);
+        return ret;
+    }
+
+    /* Emulation on top of decode(). The first frame of the packet is
+     * decoded here, so that the packet is only copied when it holds
+     * several frames and is not reference counted. */
+    if (avci->buffer_pkt.size || avci->buffer_frame->buf[0])
+        return AVERROR(EAGAIN);
+
+    return do_decode(avctx, avpkt);
+}
+
+int attribute_align_arg avcodec_receive_frame(AVCodecContext *avctx, AVFrame *frame)
+{
+    AVCodecInternal *avci = avctx->internal;
+    int ret;
+
+    av_frame_unref(frame);
+
+    if (!avcodec_is_open(avctx) || !av_codec_is_decoder(avctx->codec))
+        return AVERROR(EINVAL);
+
+    if (avctx->codec->receive_frame) {
+        if (avci->draining && !(avctx->codec->capabilities & CODEC_CAP_DELAY))
+            return AVERROR_EOF;
+        ret = avctx->codec->receive_frame(avctx, frame);
+        if (ret >= 0) {
+            avctx->frame_number++;
+            av_frame_latency_trace_stamp(frame, AV_LATENCY_DECODE);
+            av_frame_set_best_effort_timestamp(frame,
+                                               guess_correct_pts(avctx,
+                                                                 frame->pkt_pts,
+                                                                 frame->pkt_dts));
+        }
+        return ret;
+    }
+
+    if (!avci->buffer_frame->buf[0]) {
+        if (!avci->buffer_pkt.size && !avci->draining)
+            return AVERROR(EAGAIN);
+
+        while (1) {
+            if ((ret = do_decode(avctx, &avci->buffer_pkt)) < 0) {
+                reset_buffer_pkt(avci);
+                return ret;
+            }
+            /* some audio decoders consume part of the packet without
+             * returning a frame */
+            if (avci->buffer_frame->buf[0] || !avci->buffer_pkt.size)
+                break;
+        }
+    }
+
+    if (!avci->buffer_frame->buf[0])
+        return avci->draining ? AVERROR_EOF : AVERROR(EAGAIN);
+
+    av_frame_move_ref(frame, avci->buffer_frame);
+    return 0;
+}
+
 #define UTF8_MAX_BYTES 4 /* 5 and 6 bytes sequences should not be used */
 static int recode_subtitle(AVCodecContext *avctx,
                            AVPacket *outpkt, const AVPacket *inpkt)
@@ -2361,7 +2996,6 @@ av_cold int avcodec_close(AVCodecContext *avctx)
 
     if (avcodec_is_open(avctx)) {
         FramePool *pool = avctx->internal->pool;
-        int i;
         if (CONFIG_FRAME_THREAD_ENCODER &&
             avctx->internal->frame_thread_encoder && avctx->thread_count > 1) {
             ff_unlock_avcodec();
@@ -2375,11 +3009,15 @@ av_cold int avcodec_close(AVCodecContext *avctx)
         avctx->coded_frame = NULL;
         avctx->internal->byte_buffer_size = 0;
         av_freep(&avctx->internal->byte_buffer);
+        av_freep(&avctx->internal->latency_traces);
         if (!avctx->refcounted_frames)
             av_frame_unref(&avctx->internal->to_free);
-        for (i = 0; i < FF_ARRAY_ELEMS(pool->pools); i++)
-            av_buffer_pool_uninit(&pool->pools[i]);
+        frame_pool_uninit(pool);
+        if (pool->shared_ref)
+            shared_frame_pools_unref();
         av_freep(&avctx->internal->pool);
+        av_free_packet(&avctx->internal->buffer_pkt);
+        av_frame_free(&avctx->internal->buffer_frame);
         av_freep(&avctx->internal);
     }
 
@@ -2664,6 +3302,14 @@ const char *avcodec_license(void)
 
 void avcodec_flush_buffers(AVCodecContext *avctx)
 {
+    AVCodecInternal *avci = avctx->internal;
+
+    avci->draining         = 0;
+    avci->draining_done    = 0;
+    avci->buffer_pkt_valid = 0;
+    reset_buffer_pkt(avci);
+    av_frame_unref(avci->buffer_frame);
+
     if (HAVE_THREADS && avctx->active_thread_type & FF_THREAD_FRAME)
         ff_thread_flush(avctx);
     else if (avctx->codec->flush)
@@ -3125,6 +3771,10 @@ void ff_thread_finish_setup(AVCodecContext *avctx)
 {
 }
 
+void ff_thread_hwaccel_lock(AVCodecContext *avctx)
+{
+}
+
 void ff_thread_report_progress(ThreadFrame *f, int progress, int field)
 {
 }
@@ -3200,16 +3850,21 @@ const uint8_t *avpriv_find_start_code(const uint8_t *av_restrict p,
             return p;
     }
 
+    /* p[-3] is the first byte a start code can still begin at */
     while (p < end) {
-        if      (p[-1] > 1      ) p += 3;
-        else if (p[-2]          ) p += 2;
-        else if (p[-3]|(p[-1]-1)) p++;
-        else {
-            p++;
+        const uint8_t *sc = p - 3 +
+            avpriv_startcode_find_candidate(p - 3, end - p + 3);
+
+        if (end - sc < 3) {
+            p = end;
+            break;
+        }
+        if (sc[2] == 1) {
+            p = sc + 4;
             break;
         }
+        p = sc + (sc[2] ? 3 : 1) + 3;
     }
-
     p = FFMIN(p, end) - 4;
     *state = AV_RB32(p);
 
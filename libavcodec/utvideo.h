@@ -30,6 +30,7 @@
 #include "libavutil/common.h"
 #include "avcodec.h"
 #include "dsputil.h"
+#include "get_bits.h"
 
 enum {
     PRED_NONE = 0,
@@ -63,6 +64,15 @@ extern const int ff_ut_pred_order[5];
 /* Order of RGB(A) planes in Ut Video */
 extern const int ff_ut_rgb_order[4];
 
+typedef struct UtvideoPlane {
+    const uint8_t *src;     ///< plane data in the packet
+    uint8_t       *dst;
+    int            step, stride, width, height;
+    int            rmode;   ///< slices of this plane start on even lines
+    int            fsym;    ///< symbol filling the whole plane, or -1
+    VLC            vlc;
+} UtvideoPlane;
+
 typedef struct UtvideoContext {
     AVCodecContext *avctx;
     DSPContext     dsp;
@@ -77,6 +87,9 @@ typedef struct UtvideoContext {
     int      slice_stride;
     uint8_t *slice_bits, *slice_buffer[4];
     int      slice_bits_size;
+    int      max_slice_size;    ///< slice_bits space for each decoding thread
+
+    UtvideoPlane plane[4];
 } UtvideoContext;
 
 typedef struct HuffEntry {
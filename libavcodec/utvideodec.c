@@ -76,108 +76,81 @@ static int build_huff(const uint8_t *src, VLC *vlc, int *fsym)
                               syms,  sizeof(*syms),  sizeof(*syms), 0);
 }
 
-static int decode_plane(UtvideoContext *c, int plane_no,
-                        uint8_t *dst, int step, int stride,
-                        int width, int height,
-                        const uint8_t *src, int use_pred)
+static int decode_slice(UtvideoContext *c, UtvideoPlane *p, int slice,
+                        uint8_t *slice_bits, int use_pred)
 {
-    int i, j, slice, pix;
+    int i, j, pix;
     int sstart, send;
-    VLC vlc;
     GetBitContext gb;
-    int prev, fsym;
-    const int cmask = ~(!plane_no && c->avctx->pix_fmt == AV_PIX_FMT_YUV420P);
+    int prev;
+    const int cmask = ~p->rmode;
+    const uint8_t *src = p->src + 256;
+    uint8_t *dest;
+    int slice_data_start, slice_data_end, slice_size;
 
-    if (build_huff(src, &vlc, &fsym)) {
-        av_log(c->avctx, AV_LOG_ERROR, "Cannot build Huffman codes\n");
-        return AVERROR_INVALIDDATA;
-    }
-    if (fsym >= 0) { // build_huff reported a symbol to fill slices with
-        send = 0;
-        for (slice = 0; slice < c->slices; slice++) {
-            uint8_t *dest;
-
-            sstart = send;
-            send   = (height * (slice + 1) / c->slices) & cmask;
-            dest   = dst + sstart * stride;
-
-            prev = 0x80;
-            for (j = sstart; j < send; j++) {
-                for (i = 0; i < width * step; i += step) {
-                    pix = fsym;
-                    if (use_pred) {
-                        prev += pix;
-                        pix   = prev;
-                    }
-                    dest[i] = pix;
-                }
-                dest += stride;
-            }
-        }
-        return 0;
-    }
-
-    src      += 256;
-
-    send = 0;
-    for (slice = 0; slice < c->slices; slice++) {
-        uint8_t *dest;
-        int slice_data_start, slice_data_end, slice_size;
-
-        sstart = send;
-        send   = (height * (slice + 1) / c->slices) & cmask;
-        dest   = dst + sstart * stride;
-
-        // slice offset and size validation was done earlier
-        slice_data_start = slice ? AV_RL32(src + slice * 4 - 4) : 0;
-        slice_data_end   = AV_RL32(src + slice * 4);
-        slice_size       = slice_data_end - slice_data_start;
-
-        if (!slice_size) {
-            av_log(c->avctx, AV_LOG_ERROR, "Plane has more than one symbol "
-                   "yet a slice has a length of zero.\n");
-            goto fail;
-        }
-
-        memcpy(c->slice_bits, src + slice_data_start + c->slices * 4,
-               slice_size);
-        memset(c->slice_bits + slice_size, 0, FF_INPUT_BUFFER_PADDING_SIZE);
-        c->dsp.bswap_buf((uint32_t *) c->slice_bits, (uint32_t *) c->slice_bits,
-                         (slice_data_end - slice_data_start + 3) >> 2);
-        init_get_bits(&gb, c->slice_bits, slice_size * 8);
+    sstart = (p->height *  slice      / c->slices) & cmask;
+    send   = (p->height * (slice + 1) / c->slices) & cmask;
+    dest   = p->dst + sstart * p->stride;
 
+    if (p->fsym >= 0) { // build_huff reported a symbol to fill slices with
         prev = 0x80;
         for (j = sstart; j < send; j++) {
-            for (i = 0; i < width * step; i += step) {
-                if (get_bits_left(&gb) <= 0) {
-                    av_log(c->avctx, AV_LOG_ERROR,
-                           "Slice decoding ran out of bits\n");
-                    goto fail;
-                }
-                pix = get_vlc2(&gb, vlc.table, vlc.bits, 4);
-                if (pix < 0) {
-                    av_log(c->avctx, AV_LOG_ERROR, "Decoding error\n");
-                    goto fail;
-                }
+            for (i = 0; i < p->width * p->step; i += p->step) {
+                pix = p->fsym;
                 if (use_pred) {
                     prev += pix;
                     pix   = prev;
                 }
                 dest[i] = pix;
             }
-            dest += stride;
+            dest += p->stride;
         }
-        if (get_bits_left(&gb) > 32)
-            av_log(c->avctx, AV_LOG_WARNING,
-                   "%d bits left after decoding slice\n", get_bits_left(&gb));
+        return 0;
     }
 
-    ff_free_vlc(&vlc);
+    // slice offset and size validation was done earlier
+    slice_data_start = slice ? AV_RL32(src + slice * 4 - 4) : 0;
+    slice_data_end   = AV_RL32(src + slice * 4);
+    slice_size       = slice_data_end - slice_data_start;
+
+    if (!slice_size) {
+        av_log(c->avctx, AV_LOG_ERROR, "Plane has more than one symbol "
+               "yet a slice has a length of zero.\n");
+        return AVERROR_INVALIDDATA;
+    }
+
+    memcpy(slice_bits, src + slice_data_start + c->slices * 4, slice_size);
+    memset(slice_bits + slice_size, 0, FF_INPUT_BUFFER_PADDING_SIZE);
+    c->dsp.bswap_buf((uint32_t *) slice_bits, (uint32_t *) slice_bits,
+                     (slice_data_end - slice_data_start + 3) >> 2);
+    init_get_bits(&gb, slice_bits, slice_size * 8);
+
+    prev = 0x80;
+    for (j = sstart; j < send; j++) {
+        for (i = 0; i < p->width * p->step; i += p->step) {
+            if (get_bits_left(&gb) <= 0) {
+                av_log(c->avctx, AV_LOG_ERROR,
+                       "Slice decoding ran out of bits\n");
+                return AVERROR_INVALIDDATA;
+            }
+            pix = get_vlc2(&gb, p->vlc.table, p->vlc.bits, 4);
+            if (pix < 0) {
+                av_log(c->avctx, AV_LOG_ERROR, "Decoding error\n");
+                return AVERROR_INVALIDDATA;
+            }
+            if (use_pred) {
+                prev += pix;
+                pix   = prev;
+            }
+            dest[i] = pix;
+        }
+        dest += p->stride;
+    }
+    if (get_bits_left(&gb) > 32)
+        av_log(c->avctx, AV_LOG_WARNING,
+               "%d bits left after decoding slice\n", get_bits_left(&gb));
 
     return 0;
-fail:
-    ff_free_vlc(&vlc);
-    return AVERROR_INVALIDDATA;
 }
 
 static void restore_rgb_planes(uint8_t *src, int step, int stride, int width,
@@ -199,52 +172,54 @@ static void restore_rgb_planes(uint8_t *src, int step, int stride, int width,
 }
 
 static void restore_median(uint8_t *src, int step, int stride,
-                           int width, int height, int slices, int rmode)
+                           int width, int height, int slices, int slice,
+                           int rmode)
 {
-    int i, j, slice;
+    int i, j;
     int A, B, C;
     uint8_t *bsrc;
     int slice_start, slice_height;
     const int cmask = ~rmode;
 
-    for (slice = 0; slice < slices; slice++) {
-        slice_start  = ((slice * height) / slices) & cmask;
-        slice_height = ((((slice + 1) * height) / slices) & cmask) -
-                       slice_start;
+    slice_start  = ((slice * height) / slices) & cmask;
+    slice_height = ((((slice + 1) * height) / slices) & cmask) -
+                   slice_start;
 
-        bsrc = src + slice_start * stride;
+    if (!slice_height)
+        return;
 
-        // first line - left neighbour prediction
-        bsrc[0] += 0x80;
-        A = bsrc[0];
-        for (i = step; i < width * step; i += step) {
-            bsrc[i] += A;
-            A        = bsrc[i];
-        }
-        bsrc += stride;
-        if (slice_height == 1)
-            continue;
-        // second line - first element has top prediction, the rest uses median
-        C        = bsrc[-stride];
-        bsrc[0] += C;
-        A        = bsrc[0];
-        for (i = step; i < width * step; i += step) {
+    bsrc = src + slice_start * stride;
+
+    // first line - left neighbour prediction
+    bsrc[0] += 0x80;
+    A = bsrc[0];
+    for (i = step; i < width * step; i += step) {
+        bsrc[i] += A;
+        A        = bsrc[i];
+    }
+    bsrc += stride;
+    if (slice_height == 1)
+        return;
+    // second line - first element has top prediction, the rest uses median
+    C        = bsrc[-stride];
+    bsrc[0] += C;
+    A        = bsrc[0];
+    for (i = step; i < width * step; i += step) {
+        B        = bsrc[i - stride];
+        bsrc[i] += mid_pred(A, B, (uint8_t)(A + B - C));
+        C        = B;
+        A        = bsrc[i];
+    }
+    bsrc += stride;
+    // the rest of lines use continuous median prediction
+    for (j = 2; j < slice_height; j++) {
+        for (i = 0; i < width * step; i += step) {
             B        = bsrc[i - stride];
             bsrc[i] += mid_pred(A, B, (uint8_t)(A + B - C));
             C        = B;
             A        = bsrc[i];
         }
         bsrc += stride;
-        // the rest of lines use continuous median prediction
-        for (j = 2; j < slice_height; j++) {
-            for (i = 0; i < width * step; i += step) {
-                B        = bsrc[i - stride];
-                bsrc[i] += mid_pred(A, B, (uint8_t)(A + B - C));
-                C        = B;
-                A        = bsrc[i];
-            }
-            bsrc += stride;
-        }
     }
 }
 
@@ -253,42 +228,60 @@ static void restore_median(uint8_t *src, int step, int stride,
  * two parts of the same "line".
  */
 static void restore_median_il(uint8_t *src, int step, int stride,
-                              int width, int height, int slices, int rmode)
+                              int width, int height, int slices, int slice,
+                              int rmode)
 {
-    int i, j, slice;
+    int i, j;
     int A, B, C;
     uint8_t *bsrc;
     int slice_start, slice_height;
     const int cmask   = ~(rmode ? 3 : 1);
     const int stride2 = stride << 1;
 
-    for (slice = 0; slice < slices; slice++) {
-        slice_start    = ((slice * height) / slices) & cmask;
-        slice_height   = ((((slice + 1) * height) / slices) & cmask) -
-                         slice_start;
-        slice_height >>= 1;
+    slice_start    = ((slice * height) / slices) & cmask;
+    slice_height   = ((((slice + 1) * height) / slices) & cmask) -
+                     slice_start;
+    slice_height >>= 1;
 
-        bsrc = src + slice_start * stride;
+    if (!slice_height)
+        return;
 
-        // first line - left neighbour prediction
-        bsrc[0] += 0x80;
-        A        = bsrc[0];
-        for (i = step; i < width * step; i += step) {
-            bsrc[i] += A;
-            A        = bsrc[i];
-        }
+    bsrc = src + slice_start * stride;
+
+    // first line - left neighbour prediction
+    bsrc[0] += 0x80;
+    A        = bsrc[0];
+    for (i = step; i < width * step; i += step) {
+        bsrc[i] += A;
+        A        = bsrc[i];
+    }
+    for (i = 0; i < width * step; i += step) {
+        bsrc[stride + i] += A;
+        A                 = bsrc[stride + i];
+    }
+    bsrc += stride2;
+    if (slice_height == 1)
+        return;
+    // second line - first element has top prediction, the rest uses median
+    C        = bsrc[-stride2];
+    bsrc[0] += C;
+    A        = bsrc[0];
+    for (i = step; i < width * step; i += step) {
+        B        = bsrc[i - stride2];
+        bsrc[i] += mid_pred(A, B, (uint8_t)(A + B - C));
+        C        = B;
+        A        = bsrc[i];
+    }
+    for (i = 0; i < width * step; i += step) {
+        B                 = bsrc[i - stride];
+        bsrc[stride + i] += mid_pred(A, B, (uint8_t)(A + B - C));
+        C                 = B;
+        A                 = bsrc[stride + i];
+    }
+    bsrc += stride2;
+    // the rest of lines use continuous median prediction
+    for (j = 2; j < slice_height; j++) {
         for (i = 0; i < width * step; i += step) {
-            bsrc[stride + i] += A;
-            A                 = bsrc[stride + i];
-        }
-        bsrc += stride2;
-        if (slice_height == 1)
-            continue;
-        // second line - first element has top prediction, the rest uses median
-        C        = bsrc[-stride2];
-        bsrc[0] += C;
-        A        = bsrc[0];
-        for (i = step; i < width * step; i += step) {
             B        = bsrc[i - stride2];
             bsrc[i] += mid_pred(A, B, (uint8_t)(A + B - C));
             C        = B;
@@ -296,28 +289,58 @@ static void restore_median_il(uint8_t *src, int step, int stride,
         }
         for (i = 0; i < width * step; i += step) {
             B                 = bsrc[i - stride];
-            bsrc[stride + i] += mid_pred(A, B, (uint8_t)(A + B - C));
+            bsrc[i + stride] += mid_pred(A, B, (uint8_t)(A + B - C));
             C                 = B;
-            A                 = bsrc[stride + i];
+            A                 = bsrc[i + stride];
         }
         bsrc += stride2;
-        // the rest of lines use continuous median prediction
-        for (j = 2; j < slice_height; j++) {
-            for (i = 0; i < width * step; i += step) {
-                B        = bsrc[i - stride2];
-                bsrc[i] += mid_pred(A, B, (uint8_t)(A + B - C));
-                C        = B;
-                A        = bsrc[i];
-            }
-            for (i = 0; i < width * step; i += step) {
-                B                 = bsrc[i - stride];
-                bsrc[i + stride] += mid_pred(A, B, (uint8_t)(A + B - C));
-                C                 = B;
-                A                 = bsrc[i + stride];
-            }
-            bsrc += stride2;
+    }
+}
+
+static int decode_slice_thread(AVCodecContext *avctx, void *arg,
+                               int jobnr, int threadnr)
+{
+    UtvideoContext *c = avctx->priv_data;
+    uint8_t *slice_bits = c->slice_bits + threadnr *
+                          (c->max_slice_size + FF_INPUT_BUFFER_PADDING_SIZE);
+
+    return decode_slice(c, &c->plane[jobnr / c->slices], jobnr % c->slices,
+                        slice_bits, c->frame_pred == PRED_LEFT);
+}
+
+static int restore_slice_thread(AVCodecContext *avctx, void *arg,
+                                int jobnr, int threadnr)
+{
+    UtvideoContext *c = avctx->priv_data;
+    AVFrame *frame    = arg;
+    int i;
+
+    if (c->frame_pred == PRED_MEDIAN) {
+        for (i = 0; i < c->planes; i++) {
+            UtvideoPlane *p = &c->plane[i];
+            if (!c->interlaced)
+                restore_median(p->dst, p->step, p->stride, p->width,
+                               p->height, c->slices, jobnr, p->rmode);
+            else
+                restore_median_il(p->dst, p->step, p->stride, p->width,
+                                  p->height, c->slices, jobnr, p->rmode);
         }
     }
+
+    if (avctx->pix_fmt == AV_PIX_FMT_RGB24 ||
+        avctx->pix_fmt == AV_PIX_FMT_RGBA) {
+        /* same line ranges as restore_median_il() for RGB planes */
+        const int cmask = c->interlaced ? ~1 : ~0;
+        int start = (avctx->height *  jobnr      / c->slices) & cmask;
+        int end   = (avctx->height * (jobnr + 1) / c->slices) & cmask;
+        if (jobnr == c->slices - 1)
+            end = avctx->height;
+        restore_rgb_planes(frame->data[0] + start * frame->linesize[0],
+                           c->planes, frame->linesize[0], avctx->width,
+                           end - start);
+    }
+
+    return 0;
 }
 
 static int decode_frame(AVCodecContext *avctx, void *data, int *got_frame,
@@ -327,9 +350,9 @@ static int decode_frame(AVCodecContext *avctx, void *data, int *got_frame,
     int buf_size = avpkt->size;
     UtvideoContext *c = avctx->priv_data;
     int i, j;
-    const uint8_t *plane_start[5];
     int plane_size, max_slice_size = 0, slice_start, slice_end, slice_size;
-    int ret;
+    int ret, nb_threads, nb_jobs;
+    int slice_ret[4 * 256];
     GetByteContext gb;
     ThreadFrame frame = { .f = data };
 
@@ -339,7 +362,7 @@ static int decode_frame(AVCodecContext *avctx, void *data, int *got_frame,
     /* parse plane structure to get frame flags and validate slice offsets */
     bytestream2_init(&gb, buf, buf_size);
     for (i = 0; i < c->planes; i++) {
-        plane_start[i] = gb.buffer;
+        c->plane[i].src = gb.buffer;
         if (bytestream2_get_bytes_left(&gb) < 256 + 4 * c->slices) {
             av_log(avctx, AV_LOG_ERROR, "Insufficient data for a plane\n");
             return AVERROR_INVALIDDATA;
@@ -361,7 +384,6 @@ static int decode_frame(AVCodecContext *avctx, void *data, int *got_frame,
         plane_size = slice_end;
         bytestream2_skipu(&gb, plane_size);
     }
-    plane_start[c->planes] = gb.buffer;
     if (bytestream2_get_bytes_left(&gb) < c->frame_info_size) {
         av_log(avctx, AV_LOG_ERROR, "Not enough data for frame information\n");
         return AVERROR_INVALIDDATA;
@@ -376,83 +398,80 @@ static int decode_frame(AVCodecContext *avctx, void *data, int *got_frame,
         return AVERROR_PATCHWELCOME;
     }
 
+    /* every slice thread unpacks its slices into its own buffer */
+    nb_threads = avctx->active_thread_type & FF_THREAD_SLICE ?
+                 avctx->thread_count : 1;
+    if (max_slice_size > INT_MAX / nb_threads - FF_INPUT_BUFFER_PADDING_SIZE) {
+        av_log(avctx, AV_LOG_ERROR, "Slices are too large\n");
+        return AVERROR_INVALIDDATA;
+    }
+    c->max_slice_size = max_slice_size;
     av_fast_malloc(&c->slice_bits, &c->slice_bits_size,
-                   max_slice_size + FF_INPUT_BUFFER_PADDING_SIZE);
+                   nb_threads * (max_slice_size + FF_INPUT_BUFFER_PADDING_SIZE));
 
     if (!c->slice_bits) {
         av_log(avctx, AV_LOG_ERROR, "Cannot allocate temporary buffer\n");
         return AVERROR(ENOMEM);
     }
 
-    switch (c->avctx->pix_fmt) {
-    case AV_PIX_FMT_RGB24:
-    case AV_PIX_FMT_RGBA:
-        for (i = 0; i < c->planes; i++) {
-            ret = decode_plane(c, i, frame.f->data[0] + ff_ut_rgb_order[i],
-                               c->planes, frame.f->linesize[0], avctx->width,
-                               avctx->height, plane_start[i],
-                               c->frame_pred == PRED_LEFT);
-            if (ret)
-                return ret;
-            if (c->frame_pred == PRED_MEDIAN) {
-                if (!c->interlaced) {
-                    restore_median(frame.f->data[0] + ff_ut_rgb_order[i],
-                                   c->planes, frame.f->linesize[0], avctx->width,
-                                   avctx->height, c->slices, 0);
-                } else {
-                    restore_median_il(frame.f->data[0] + ff_ut_rgb_order[i],
-                                      c->planes, frame.f->linesize[0],
-                                      avctx->width, avctx->height, c->slices,
-                                      0);
-                }
-            }
+    for (i = 0; i < c->planes; i++) {
+        UtvideoPlane *p = &c->plane[i];
+
+        switch (c->avctx->pix_fmt) {
+        case AV_PIX_FMT_RGB24:
+        case AV_PIX_FMT_RGBA:
+            p->dst    = frame.f->data[0] + ff_ut_rgb_order[i];
+            p->step   = c->planes;
+            p->stride = frame.f->linesize[0];
+            p->width  = avctx->width;
+            p->height = avctx->height;
+            p->rmode  = 0;
+            break;
+        case AV_PIX_FMT_YUV420P:
+            p->dst    = frame.f->data[i];
+            p->step   = 1;
+            p->stride = frame.f->linesize[i];
+            p->width  = avctx->width  >> !!i;
+            p->height = avctx->height >> !!i;
+            p->rmode  = !i;
+            break;
+        case AV_PIX_FMT_YUV422P:
+            p->dst    = frame.f->data[i];
+            p->step   = 1;
+            p->stride = frame.f->linesize[i];
+            p->width  = avctx->width >> !!i;
+            p->height = avctx->height;
+            p->rmode  = 0;
+            break;
         }
-        restore_rgb_planes(frame.f->data[0], c->planes, frame.f->linesize[0],
-                           avctx->width, avctx->height);
-        break;
-    case AV_PIX_FMT_YUV420P:
-        for (i = 0; i < 3; i++) {
-            ret = decode_plane(c, i, frame.f->data[i], 1, frame.f->linesize[i],
-                               avctx->width >> !!i, avctx->height >> !!i,
-                               plane_start[i], c->frame_pred == PRED_LEFT);
-            if (ret)
-                return ret;
-            if (c->frame_pred == PRED_MEDIAN) {
-                if (!c->interlaced) {
-                    restore_median(frame.f->data[i], 1, frame.f->linesize[i],
-                                   avctx->width >> !!i, avctx->height >> !!i,
-                                   c->slices, !i);
-                } else {
-                    restore_median_il(frame.f->data[i], 1, frame.f->linesize[i],
-                                      avctx->width  >> !!i,
-                                      avctx->height >> !!i,
-                                      c->slices, !i);
-                }
-            }
+
+        memset(&p->vlc, 0, sizeof(p->vlc));
+        if (build_huff(p->src, &p->vlc, &p->fsym)) {
+            av_log(avctx, AV_LOG_ERROR, "Cannot build Huffman codes\n");
+            ret = AVERROR_INVALIDDATA;
+            goto fail;
         }
-        break;
-    case AV_PIX_FMT_YUV422P:
-        for (i = 0; i < 3; i++) {
-            ret = decode_plane(c, i, frame.f->data[i], 1, frame.f->linesize[i],
-                               avctx->width >> !!i, avctx->height,
-                               plane_start[i], c->frame_pred == PRED_LEFT);
-            if (ret)
-                return ret;
-            if (c->frame_pred == PRED_MEDIAN) {
-                if (!c->interlaced) {
-                    restore_median(frame.f->data[i], 1, frame.f->linesize[i],
-                                   avctx->width >> !!i, avctx->height,
-                                   c->slices, 0);
-                } else {
-                    restore_median_il(frame.f->data[i], 1, frame.f->linesize[i],
-                                      avctx->width >> !!i, avctx->height,
-                                      c->slices, 0);
-                }
-            }
+    }
+
+    /* the slices of all planes are independent */
+    nb_jobs = c->planes * c->slices;
+    avctx->execute2(avctx, decode_slice_thread, NULL, slice_ret, nb_jobs);
+    for (i = 0; i < nb_jobs; i++) {
+        if (slice_ret[i] < 0) {
+            ret = slice_ret[i];
+            goto fail;
         }
-        break;
     }
 
+    /* median prediction stays within a slice, so it can be undone per slice
+     * once all planes are decoded */
+    if (c->frame_pred == PRED_MEDIAN ||
+        avctx->pix_fmt == AV_PIX_FMT_RGB24 || avctx->pix_fmt == AV_PIX_FMT_RGBA)
+        avctx->execute2(avctx, restore_slice_thread, frame.f, NULL, c->slices);
+
+    for (i = 0; i < c->planes; i++)
+        ff_free_vlc(&c->plane[i].vlc);
+
     frame.f->key_frame = 1;
     frame.f->pict_type = AV_PICTURE_TYPE_I;
     frame.f->interlaced_frame = !!c->interlaced;
@@ -461,6 +480,10 @@ static int decode_frame(AVCodecContext *avctx, void *data, int *got_frame,
 
     /* always report that the buffer was completely consumed */
     return buf_size;
+fail:
+    for (i = 0; i < c->planes; i++)
+        ff_free_vlc(&c->plane[i].vlc);
+    return ret;
 }
 
 static av_cold int decode_init(AVCodecContext *avctx)
@@ -550,6 +573,7 @@ AVCodec ff_utvideo_decoder = {
     .init           = decode_init,
     .close          = decode_end,
     .decode         = decode_frame,
-    .capabilities   = CODEC_CAP_DR1 | CODEC_CAP_FRAME_THREADS,
+    .capabilities   = CODEC_CAP_DR1 | CODEC_CAP_FRAME_THREADS |
+                      CODEC_CAP_SLICE_THREADS,
     .long_name      = NULL_IF_CONFIG_SMALL("Ut Video"),
 };
@@ -21,12 +21,50 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include "libavutil/intreadwrite.h"
 #include "avcodec.h"
-#include "bytestream.h"
 #include "internal.h"
+#include "v210enc.h"
+
+#define CLIP(v) av_clip(v, 4, 1019)
+
+#define WRITE_PIXELS(a, b, c)           \
+    do {                                \
+        val =   CLIP(*a++);             \
+        val |= (CLIP(*b++) << 10) |     \
+               (CLIP(*c++) << 20);      \
+        AV_WL32(dst, val);              \
+        dst += 4;                       \
+    } while (0)
+
+static void v210_planar_pack_10_c(const uint16_t *y, const uint16_t *u,
+                                  const uint16_t *v, uint8_t *dst,
+                                  ptrdiff_t width)
+{
+    uint32_t val;
+    int i;
+
+    for (i = 0; i < width - 5; i += 6) {
+        WRITE_PIXELS(u, y, v);
+        WRITE_PIXELS(y, u, y);
+        WRITE_PIXELS(v, y, u);
+        WRITE_PIXELS(y, v, y);
+    }
+}
+
+av_cold void ff_v210enc_init(V210EncContext *s)
+{
+    s->pack_line_10  = v210_planar_pack_10_c;
+    s->sample_factor = 6;
+
+    if (ARCH_X86)
+        ff_v210enc_init_x86(s);
+}
 
 static av_cold int encode_init(AVCodecContext *avctx)
 {
+    V210EncContext *s = avctx->priv_data;
+
     if (avctx->width & 1) {
         av_log(avctx, AV_LOG_ERROR, "v210 needs even width\n");
         return AVERROR(EINVAL);
@@ -42,12 +80,15 @@ static av_cold int encode_init(AVCodecContext *avctx)
 
     avctx->coded_frame->pict_type = AV_PICTURE_TYPE_I;
 
+    ff_v210enc_init(s);
+
     return 0;
 }
 
 static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
                         const AVFrame *pic, int *got_packet)
 {
+    V210EncContext *s = avctx->priv_data;
     int aligned_width = ((avctx->width + 47) / 48) * 48;
     int stride = aligned_width * 8 / 3;
     int line_padding = stride - ((avctx->width * 8 + 11) / 12) * 4;
@@ -55,26 +96,25 @@ static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
     const uint16_t *y = (const uint16_t*)pic->data[0];
     const uint16_t *u = (const uint16_t*)pic->data[1];
     const uint16_t *v = (const uint16_t*)pic->data[2];
-    PutByteContext p;
+    uint8_t *dst;
 
     if ((ret = ff_alloc_packet2(avctx, pkt, avctx->height * stride)) < 0)
         return ret;
 
-    bytestream2_init_writer(&p, pkt->data, pkt->size);
-
-#define CLIP(v) av_clip(v, 4, 1019)
-
-#define WRITE_PIXELS(a, b, c)           \
-    do {                                \
-        val =   CLIP(*a++);             \
-        val |= (CLIP(*b++) << 10) |     \
-               (CLIP(*c++) << 20);      \
-        bytestream2_put_le32u(&p, val); \
-    } while (0)
+    dst = pkt->data;
 
     for (h = 0; h < avctx->height; h++) {
         uint32_t val;
-        for (w = 0; w < avctx->width - 5; w += 6) {
+
+        /* pack_line_10 may read two luma samples past its width */
+        w = FFMAX(avctx->width - 2, 0) / s->sample_factor * s->sample_factor;
+        s->pack_line_10(y, u, v, dst, w);
+        y   += w;
+        u   += w >> 1;
+        v   += w >> 1;
+        dst += w / 6 * 16;
+
+        for (; w < avctx->width - 5; w += 6) {
             WRITE_PIXELS(u, y, v);
             WRITE_PIXELS(y, u, y);
             WRITE_PIXELS(v, y, u);
@@ -84,18 +124,23 @@ static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
             WRITE_PIXELS(u, y, v);
 
             val = CLIP(*y++);
-            if (w == avctx->width - 2)
-                bytestream2_put_le32u(&p, val);
+            if (w == avctx->width - 2) {
+                AV_WL32(dst, val);
+                dst += 4;
+            }
             if (w < avctx->width - 3) {
                 val |= (CLIP(*u++) << 10) | (CLIP(*y++) << 20);
-                bytestream2_put_le32u(&p, val);
+                AV_WL32(dst, val);
+                dst += 4;
 
                 val = CLIP(*v++) | (CLIP(*y++) << 10);
-                bytestream2_put_le32u(&p, val);
+                AV_WL32(dst, val);
+                dst += 4;
             }
         }
 
-        bytestream2_set_buffer(&p, 0, line_padding);
+        memset(dst, 0, line_padding);
+        dst += line_padding;
 
         y += pic->linesize[0] / 2 - avctx->width;
         u += pic->linesize[1] / 2 - avctx->width / 2;
@@ -118,6 +163,7 @@ AVCodec ff_v210_encoder = {
     .name           = "v210",
     .type           = AVMEDIA_TYPE_VIDEO,
     .id             = AV_CODEC_ID_V210,
+    .priv_data_size = sizeof(V210EncContext),
     .init           = encode_init,
     .encode2        = encode_frame,
     .close          = encode_close,
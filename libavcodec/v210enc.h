@@ -0,0 +1,40 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVCODEC_V210ENC_H
+#define AVCODEC_V210ENC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct V210EncContext {
+    /**
+     * Pack width luma and width / 2 of each chroma samples, clipped to
+     * 4..1019, into width / 6 groups of four v210 words.
+     * width is a multiple of sample_factor; the planes may be read up to
+     * two luma and one chroma sample past it.
+     */
+    void (*pack_line_10)(const uint16_t *y, const uint16_t *u,
+                         const uint16_t *v, uint8_t *dst, ptrdiff_t width);
+    int sample_factor;
+} V210EncContext;
+
+void ff_v210enc_init(V210EncContext *s);
+void ff_v210enc_init_x86(V210EncContext *s);
+
+#endif /* AVCODEC_V210ENC_H */
@@ -338,6 +338,36 @@ static void vc1_smooth_overlap_filter_iblk(VC1Context *v)
     }
 }
 
+/**
+ * Wait until the reference picture in direction dir has been decoded
+ * down to luma line y. Interlaced pictures are only tracked as a whole.
+ */
+static void vc1_await_reference(VC1Context *v, int dir, int y)
+{
+    MpegEncContext *s = &v->s;
+    Picture *ref = dir ? s->next_picture_ptr : s->last_picture_ptr;
+    int row;
+
+    if (!HAVE_THREADS || !(s->avctx->active_thread_type & FF_THREAD_FRAME) || !ref)
+        return;
+
+    row = v->fcm == PROGRESSIVE ? av_clip(y >> 4, 0, s->mb_height - 1) : INT_MAX;
+    ff_thread_await_progress(&ref->tf, row, 0);
+}
+
+/**
+ * Report the rows of the current reference picture that are final.
+ * Overlap smoothing and the loop filter still modify the two rows above
+ * the one just decoded, and field pictures are only reported at the end.
+ */
+static void vc1_report_decode_progress(VC1Context *v)
+{
+    MpegEncContext *s = &v->s;
+
+    if (s->pict_type != AV_PICTURE_TYPE_B && !v->field_mode && !s->er.error_occurred)
+        ff_thread_report_progress(&s->current_picture_ptr->tf, s->mb_y - 2, 0);
+}
+
 /** Do motion compensation over 1 macroblock
  * Mostly adapted hpel_motion and qpel_motion from mpegvideo.c
  */
@@ -429,6 +459,9 @@ static void vc1_mc_1mv(VC1Context *v, int dir)
         uvsrc_y = av_clip(uvsrc_y,  -8, s->avctx->coded_height >> 1);
     }
 
+    if (srcY != s->current_picture.f.data[0])
+        vc1_await_reference(v, dir, FFMAX(src_y + 18, 2 * uvsrc_y + 17));
+
     srcY += src_y   * s->linesize   + src_x;
     srcU += uvsrc_y * s->uvlinesize + uvsrc_x;
     srcV += uvsrc_y * s->uvlinesize + uvsrc_x;
@@ -679,6 +712,9 @@ static void vc1_mc_4mv_luma(VC1Context *v, int n, int dir, int avg)
         }
     }
 
+    if (srcY != s->current_picture.f.data[0])
+        vc1_await_reference(v, dir, src_y + 10);
+
     srcY += src_y * s->linesize + src_x;
     if (v->field_mode && v->ref_field_type[dir])
         srcY += s->current_picture_ptr->f.linesize[0];
@@ -892,6 +928,9 @@ static void vc1_mc_4mv_chroma(VC1Context *v, int dir)
     if(!srcU)
         return;
 
+    if (srcU != s->current_picture.f.data[1])
+        vc1_await_reference(v, dir, 2 * uvsrc_y + 17);
+
     srcU += uvsrc_y * s->uvlinesize + uvsrc_x;
     srcV += uvsrc_y * s->uvlinesize + uvsrc_x;
 
@@ -982,6 +1021,10 @@ static void vc1_mc_4mv_chroma4(VC1Context *v, int dir, int dir2, int avg)
     if (s->flags & CODEC_FLAG_GRAY)
         return;
 
+    vc1_await_reference(v, dir, INT_MAX);
+    if (dir2 != dir)
+        vc1_await_reference(v, dir2, INT_MAX);
+
     for (i = 0; i < 4; i++) {
         int d = i < 2 ? dir: dir2;
         tx = s->mv[d][i][0];
@@ -1934,6 +1977,8 @@ static void vc1_interp_mc(VC1Context *v)
         uvsrc_y = av_clip(uvsrc_y,  -8, s->avctx->coded_height >> 1);
     }
 
+    vc1_await_reference(v, 1, FFMAX(src_y + 18, 2 * uvsrc_y + 17));
+
     srcY += src_y   * s->linesize   + src_x;
     srcU += uvsrc_y * s->uvlinesize + uvsrc_x;
     srcV += uvsrc_y * s->uvlinesize + uvsrc_x;
@@ -4855,6 +4900,7 @@ static void vc1_decode_i_blocks(VC1Context *v)
             ff_mpeg_draw_horiz_band(s, s->mb_y * 16, 16);
         else if (s->mb_y)
             ff_mpeg_draw_horiz_band(s, (s->mb_y - 1) * 16, 16);
+        vc1_report_decode_progress(v);
 
         s->first_slice_line = 0;
     }
@@ -4983,6 +5029,7 @@ static void vc1_decode_i_blocks_adv(VC1Context *v)
             ff_mpeg_draw_horiz_band(s, s->mb_y * 16, 16);
         else if (s->mb_y)
             ff_mpeg_draw_horiz_band(s, (s->mb_y-1) * 16, 16);
+        vc1_report_decode_progress(v);
         s->first_slice_line = 0;
     }
 
@@ -5062,6 +5109,7 @@ static void vc1_decode_p_blocks(VC1Context *v)
         memmove(v->is_intra_base, v->is_intra, sizeof(v->is_intra_base[0]) * s->mb_stride);
         memmove(v->luma_mv_base,  v->luma_mv,  sizeof(v->luma_mv_base[0])  * s->mb_stride);
         if (s->mb_y != s->start_mb_y) ff_mpeg_draw_horiz_band(s, (s->mb_y - 1) * 16, 16);
+        vc1_report_decode_progress(v);
         s->first_slice_line = 0;
     }
     if (apply_loop_filter) {
@@ -5111,6 +5159,8 @@ static void vc1_decode_b_blocks(VC1Context *v)
     for (s->mb_y = s->start_mb_y; s->mb_y < s->end_mb_y; s->mb_y++) {
         s->mb_x = 0;
         init_block_index(v);
+        /* direct mode reads the co-located motion vectors of next_picture */
+        vc1_await_reference(v, 1, s->mb_y * 16 + 15);
         for (; s->mb_x < s->mb_width; s->mb_x++) {
             ff_update_block_index(s);
 
@@ -5152,11 +5202,13 @@ static void vc1_decode_skip_blocks(VC1Context *v)
         init_block_index(v);
         ff_update_block_index(s);
         if (s->last_picture.f.data[0]) {
+            vc1_await_reference(v, 0, s->mb_y * 16 + 15);
             memcpy(s->dest[0], s->last_picture.f.data[0] + s->mb_y * 16 * s->linesize,   s->linesize   * 16);
             memcpy(s->dest[1], s->last_picture.f.data[1] + s->mb_y *  8 * s->uvlinesize, s->uvlinesize *  8);
             memcpy(s->dest[2], s->last_picture.f.data[2] + s->mb_y *  8 * s->uvlinesize, s->uvlinesize *  8);
         }
         ff_mpeg_draw_horiz_band(s, s->mb_y * 16, 16);
+        vc1_report_decode_progress(v);
         s->first_slice_line = 0;
     }
     s->pict_type = AV_PICTURE_TYPE_P;
@@ -5573,6 +5625,7 @@ static av_cold int vc1_decode_init(AVCodecContext *avctx)
     v->s.avctx = avctx;
     avctx->flags |= CODEC_FLAG_EMU_EDGE;
     v->s.flags   |= CODEC_FLAG_EMU_EDGE;
+    avctx->internal->allocate_progress = 1;
 
     if (ff_vc1_init_common(v) < 0)
         return -1;
@@ -5730,6 +5783,65 @@ av_cold int ff_vc1_decode_end(AVCodecContext *avctx)
 }
 
 
+#if HAVE_THREADS
+#define copy_fields(to, from, start_field, end_field)                   \
+    memcpy(&to->start_field, &from->start_field,                        \
+           (char *)&to->end_field - (char *)&to->start_field)
+
+static int vc1_decode_update_thread_context(AVCodecContext *dst,
+                                            const AVCodecContext *src)
+{
+    VC1Context *v = dst->priv_data, *v1 = src->priv_data;
+    MpegEncContext *s = &v->s;
+    int init, ret, size;
+
+    if (dst == src || !v1->s.context_initialized)
+        return 0;
+
+    if (s->context_initialized &&
+        (s->width  != v1->s.width ||
+         s->height != v1->s.height))
+        ff_vc1_decode_end(dst);
+
+    init = !s->context_initialized;
+    if ((ret = ff_mpeg_update_thread_context(dst, src)) < 0)
+        return ret;
+    if (init && ff_vc1_decode_init_alloc_tables(v) < 0)
+        return AVERROR(ENOMEM);
+
+    /* sequence and entry point header state */
+    copy_fields(v, v1, res_sprite, mv_mode);
+    s->loop_filter   = v1->s.loop_filter;
+    s->resync_marker = v1->s.resync_marker;
+    s->h_edge_pos    = v1->s.h_edge_pos;
+    s->v_edge_pos    = v1->s.v_edge_pos;
+    v->broken_link   = v1->broken_link;
+    v->closed_entry  = v1->closed_entry;
+    copy_fields(v, v1, range_mapy_flag, dmvrange);
+
+    /* state carried from one picture to the next */
+    copy_fields(v, v1, last_luty, curr_luty);
+    copy_fields(v, v1, last_use_ic, rangeredfrm);
+    v->curr_luty  = v1->curr_luty  == v1->aux_luty  ? v->aux_luty  : v->next_luty;
+    v->curr_lutuv = v1->curr_lutuv == v1->aux_lutuv ? v->aux_lutuv : v->next_lutuv;
+    v->qs_last    = v1->qs_last;
+    v->refdist    = v1->refdist;
+
+    if (v1->interlace) {
+        /* field MV flags of the anchor picture, used by interlaced B fields */
+        size = 2 * (s->b8_stride * (s->mb_height * 2 + 1) +
+                    s->mb_stride * (s->mb_height + 1) * 2);
+        memcpy(v->mv_f[0]      - s->b8_stride - 1,
+               v1->mv_f[0]      - s->b8_stride - 1, size);
+        memcpy(v->mv_f_next[0] - s->b8_stride - 1,
+               v1->mv_f_next[0] - s->b8_stride - 1, size);
+    }
+
+    return 0;
+}
+#endif
+
+
 /** Decode a VC1/WMV3 frame
  * @todo TODO: Handle VC-1 IDUs (Transport level?)
  */
@@ -5993,6 +6105,11 @@ static int vc1_decode_frame(AVCodecContext *avctx, void *data,
     v->s.current_picture_ptr->f.interlaced_frame = (v->fcm != PROGRESSIVE);
     v->s.current_picture_ptr->f.top_field_first  = v->tff;
 
+    /* field pictures parse the second field header while decoding and
+     * update the field MV flags, so they finish setup only at the end */
+    if (!v->field_mode)
+        ff_thread_finish_setup(avctx);
+
     s->me.qpel_put = s->dsp.put_qpel_pixels_tab;
     s->me.qpel_avg = s->dsp.avg_qpel_pixels_tab;
 
@@ -6134,6 +6251,8 @@ static int vc1_decode_frame(AVCodecContext *avctx, void *data,
             ff_er_frame_end(&s->er);
     }
 
+    if (v->field_mode)
+        ff_thread_finish_setup(avctx);
     ff_MPV_frame_end(s);
 
     if (avctx->codec_id == AV_CODEC_ID_WMV3IMAGE || avctx->codec_id == AV_CODEC_ID_VC1IMAGE) {
@@ -6172,6 +6291,8 @@ end:
     return buf_size;
 
 err:
+    if (s->current_picture_ptr)
+        ff_thread_report_progress(&s->current_picture_ptr->tf, INT_MAX, 0);
     av_free(buf2);
     for (i = 0; i < n_slices; i++)
         av_free(slices[i].buf);
@@ -6211,7 +6332,8 @@ AVCodec ff_vc1_decoder = {
     .close          = ff_vc1_decode_end,
     .decode         = vc1_decode_frame,
     .flush          = ff_mpeg_flush,
-    .capabilities   = CODEC_CAP_DR1 | CODEC_CAP_DELAY,
+    .capabilities   = CODEC_CAP_DR1 | CODEC_CAP_DELAY | CODEC_CAP_FRAME_THREADS,
+    .update_thread_context = ONLY_IF_THREADS_ENABLED(vc1_decode_update_thread_context),
     .long_name      = NULL_IF_CONFIG_SMALL("SMPTE VC-1"),
     .pix_fmts       = vc1_hwaccel_pixfmt_list_420,
     .profiles       = NULL_IF_CONFIG_SMALL(profiles)
@@ -6227,7 +6349,8 @@ AVCodec ff_wmv3_decoder = {
     .close          = ff_vc1_decode_end,
     .decode         = vc1_decode_frame,
     .flush          = ff_mpeg_flush,
-    .capabilities   = CODEC_CAP_DR1 | CODEC_CAP_DELAY,
+    .capabilities   = CODEC_CAP_DR1 | CODEC_CAP_DELAY | CODEC_CAP_FRAME_THREADS,
+    .update_thread_context = ONLY_IF_THREADS_ENABLED(vc1_decode_update_thread_context),
     .long_name      = NULL_IF_CONFIG_SMALL("Windows Media Video 9"),
     .pix_fmts       = vc1_hwaccel_pixfmt_list_420,
     .profiles       = NULL_IF_CONFIG_SMALL(profiles)
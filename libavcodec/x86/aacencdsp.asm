@@ -0,0 +1,98 @@
+;******************************************************************************
+;* SIMD optimized AAC encoder DSP functions
+;*
+;* This file is part of FFmpeg.
+;*
+;* FFmpeg is free software; you can redistribute it and/or
+;* modify it under the terms of the GNU Lesser General Public
+;* License as published by the Free Software Foundation; either
+;* version 2.1 of the License, or (at your option) any later version.
+;*
+;* FFmpeg is distributed in the hope that it will be useful,
+;* but WITHOUT ANY WARRANTY; without even the implied warranty of
+;* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+;* Lesser General Public License for more details.
+;*
+;* You should have received a copy of the GNU Lesser General Public
+;* License along with FFmpeg; if not, write to the Free Software
+;* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+;******************************************************************************
+
+%include "libavutil/x86/x86util.asm"
+
+SECTION_RODATA
+
+ps_abs_mask: times 4 dd 0x7fffffff
+pd_rounding: times 2 dq 0.4054
+
+SECTION_TEXT
+
+;*******************************************************************
+;void ff_abs_pow34(float *out, const float *in, int size);
+;*******************************************************************
+INIT_XMM sse
+cglobal abs_pow34, 3, 3, 3, out, in, size
+    mova   m2, [ps_abs_mask]
+    movsxdifnidn sizeq, sized
+    shl    sizeq, 2
+    add    inq, sizeq
+    add    outq, sizeq
+    neg    sizeq
+.loop:
+    movu   m0, [inq+sizeq]
+    andps  m0, m2
+    sqrtps m1, m0
+    mulps  m0, m1
+    sqrtps m0, m0
+    movu   [outq+sizeq], m0
+    add    sizeq, mmsize
+    jl .loop
+    REP_RET
+
+;*******************************************************************
+;void ff_aac_quantize_bands(int *out, const float *in, const float *scaled,
+;                           int size, int is_signed, int maxval, float Q34);
+;*******************************************************************
+; the rounding offset is added and the clipping done in double precision,
+; like the C version does, so that the results are identical
+INIT_XMM sse2
+cglobal aac_quantize_bands, 6, 6, 8, out, in, scaled, size, is_signed, maxval, Q34
+%if UNIX64 == 0
+    movss     m0, Q34m
+%endif
+    shufps    m0, m0, 0
+    cvtsi2sd  m3, maxvald
+    unpcklpd  m3, m3
+    mova      m1, [pd_rounding]
+    pxor      m2, m2
+    neg       is_signedd
+    movd      m7, is_signedd
+    pshufd    m7, m7, 0
+    movsxdifnidn sizeq, sized
+    shl       sizeq, 2
+    add       inq, sizeq
+    add       outq, sizeq
+    add       scaledq, sizeq
+    neg       sizeq
+.loop:
+    movu      m4, [scaledq+sizeq]
+    mulps     m4, m0
+    cvtps2pd  m5, m4
+    movhlps   m4, m4
+    cvtps2pd  m4, m4
+    addpd     m5, m1
+    addpd     m4, m1
+    minpd     m5, m3
+    minpd     m4, m3
+    cvttpd2dq m5, m5
+    cvttpd2dq m4, m4
+    punpcklqdq m5, m4
+    movu      m6, [inq+sizeq]
+    cmpltps   m6, m2
+    pand      m6, m7
+    pxor      m5, m6
+    psubd     m5, m6
+    movu      [outq+sizeq], m5
+    add       sizeq, mmsize
+    jl .loop
+    REP_RET
@@ -0,0 +1,129 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/mem.h"
+#include "libavutil/x86/asm.h"
+#include "libavutil/x86/cpu.h"
+#include "libavcodec/dcadsp.h"
+
+#if HAVE_SSE_INLINE
+/* Transpose the rows in xmm0-3, leaving the columns in xmm0, 2, 4 and 5 */
+#define TRANSPOSE4                                                             \
+    "movaps       %%xmm0, %%xmm4        \n\t"                                  \
+    "unpcklps     %%xmm1, %%xmm0        \n\t"                                  \
+    "unpckhps     %%xmm1, %%xmm4        \n\t"                                  \
+    "movaps       %%xmm2, %%xmm5        \n\t"                                  \
+    "unpcklps     %%xmm3, %%xmm2        \n\t"                                  \
+    "unpckhps     %%xmm3, %%xmm5        \n\t"                                  \
+    "movaps       %%xmm0, %%xmm1        \n\t"                                  \
+    "movlhps      %%xmm2, %%xmm0        \n\t"                                  \
+    "movhlps      %%xmm1, %%xmm2        \n\t"                                  \
+    "movaps       %%xmm4, %%xmm3        \n\t"                                  \
+    "movlhps      %%xmm5, %%xmm4        \n\t"                                  \
+    "movhlps      %%xmm3, %%xmm5        \n\t"
+
+/* Accumulate the columns times the broadcast samples at s0-s3 into acc */
+#define MAC4(s0, s1, s2, s3, acc)                                              \
+    "mulps   "#s0"(%2), %%xmm0          \n\t"                                  \
+    "mulps   "#s1"(%2), %%xmm2          \n\t"                                  \
+    "mulps   "#s2"(%2), %%xmm4          \n\t"                                  \
+    "mulps   "#s3"(%2), %%xmm5          \n\t"                                  \
+    "addps        %%xmm0, "acc"         \n\t"                                  \
+    "addps        %%xmm2, "acc"         \n\t"                                  \
+    "addps        %%xmm4, "acc"         \n\t"                                  \
+    "addps        %%xmm5, "acc"         \n\t"
+
+/* 4 taps of 4 outputs of both halves: the coefficients of the first half
+ * are read forwards from %0, the ones of the second half backwards from %1,
+ * each 4 taps row being reversed */
+#define LFE_TAPS4(n0, n1, n2, n3, r0, r1, r2, r3, s0, s1, s2, s3)             \
+    "movups  "#n0"(%0), %%xmm0          \n\t"                                  \
+    "movups  "#n1"(%0), %%xmm1          \n\t"                                  \
+    "movups  "#n2"(%0), %%xmm2          \n\t"                                  \
+    "movups  "#n3"(%0), %%xmm3          \n\t"                                  \
+    TRANSPOSE4                                                                 \
+    MAC4(s0, s1, s2, s3, "%%xmm6")                                             \
+    "movups  "#r0"(%1), %%xmm0          \n\t"                                  \
+    "movups  "#r1"(%1), %%xmm1          \n\t"                                  \
+    "movups  "#r2"(%1), %%xmm2          \n\t"                                  \
+    "movups  "#r3"(%1), %%xmm3          \n\t"                                  \
+    "shufps $0x1b, %%xmm0, %%xmm0       \n\t"                                  \
+    "shufps $0x1b, %%xmm1, %%xmm1       \n\t"                                  \
+    "shufps $0x1b, %%xmm2, %%xmm2       \n\t"                                  \
+    "shufps $0x1b, %%xmm3, %%xmm3       \n\t"                                  \
+    TRANSPOSE4                                                                 \
+    MAC4(s0, s1, s2, s3, "%%xmm7")
+
+/* The outputs are computed 4 at a time, the taps being summed in the same
+ * order as in C so that the results are identical. */
+#define LFE_FIR(taps, body)                                                    \
+static void lfe_fir ## taps ## _sse(float *out, const float *in,               \
+                                    const float *coefs, float scale)           \
+{                                                                              \
+    DECLARE_ALIGNED(16, float, s)[taps][4];                                    \
+    int decifactor = 256 / taps;                                               \
+    int j, k;                                                                  \
+                                                                               \
+    for (j = 0; j < taps; j++)                                                 \
+        s[j][0] = s[j][1] = s[j][2] = s[j][3] = in[-j];                        \
+                                                                               \
+    for (k = 0; k < decifactor; k += 4) {                                      \
+        __asm__ volatile (                                                     \
+            "xorps        %%xmm6, %%xmm6        \n\t"                          \
+            "xorps        %%xmm7, %%xmm7        \n\t"                          \
+            body                                                               \
+            "movss             %5, %%xmm0       \n\t"                          \
+            "shufps   $0, %%xmm0, %%xmm0        \n\t"                          \
+            "mulps        %%xmm0, %%xmm6        \n\t"                          \
+            "mulps        %%xmm0, %%xmm7        \n\t"                          \
+            "movups       %%xmm6, (%3)          \n\t"                          \
+            "movups       %%xmm7, (%4)          \n\t"                          \
+            :                                                                  \
+            : "r"(coefs + k * taps), "r"(coefs + 252 - k * taps),              \
+              "r"(s), "r"(out + k), "r"(out + decifactor + k), "m"(scale)      \
+            : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4",        \
+                           "%xmm5", "%xmm6", "%xmm7",) "memory"                \
+        );                                                                     \
+    }                                                                          \
+}
+
+LFE_FIR(4, LFE_TAPS4(0, 16, 32, 48, 0, -16, -32, -48, 0, 16, 32, 48))
+LFE_FIR(8, LFE_TAPS4( 0, 32, 64,  96,   0, -32, -64,  -96,  0, 16, 32,  48)
+           LFE_TAPS4(16, 48, 80, 112, -16, -48, -80, -112, 64, 80, 96, 112))
+
+static void lfe_fir_sse(float *out, const float *in, const float *coefs,
+                        int decifactor, float scale)
+{
+    if (decifactor == 64)
+        lfe_fir4_sse(out, in, coefs, scale);
+    else
+        lfe_fir8_sse(out, in, coefs, scale);
+}
+#endif /* HAVE_SSE_INLINE */
+
+av_cold void ff_dcadsp_init_x86(DCADSPContext *s)
+{
+    int cpu_flags = av_get_cpu_flags();
+
+#if HAVE_SSE_INLINE
+    if (INLINE_SSE(cpu_flags))
+        s->lfe_fir = lfe_fir_sse;
+#endif
+}
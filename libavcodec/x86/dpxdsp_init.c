@@ -0,0 +1,175 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/mem.h"
+#include "libavutil/x86/asm.h"
+#include "libavutil/x86/cpu.h"
+#include "libavcodec/dpxdsp.h"
+
+#if HAVE_SSE2_INLINE
+DECLARE_ALIGNED(16, static const uint32_t, dpx_mask_10)[4] = {
+    0x3FF, 0x3FF, 0x3FF, 0x3FF
+};
+DECLARE_ALIGNED(16, static const int8_t, dpx_bswap32)[16] = {
+    3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12
+};
+DECLARE_ALIGNED(16, static const int8_t, dpx_bswap16)[16] = {
+    1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14
+};
+
+/* the big endian versions swap the bytes with pshufb, so need SSSE3 */
+#define BSWAP_NONE(mask, reg)
+#define BSWAP(mask, reg) "pshufb " mask ", " reg "\n\t"
+
+/* 8 pixels per iteration, the remaining ones are done in C */
+#define UNPACK_RGB10(name, bswap, swap_mask, tail)                             \
+static void unpack_rgb10_ ## name(const uint8_t *src, uint16_t *g,             \
+                                  uint16_t *b, uint16_t *r, int width)         \
+{                                                                              \
+    int n = width & ~7;                                                        \
+    x86_reg i = -n;                                                            \
+                                                                               \
+    if (n) {                                                                   \
+        const uint8_t *src_end = src + 4 * n;                                  \
+        uint16_t *g_end = g + n, *b_end = b + n, *r_end = r + n;               \
+                                                                               \
+        __asm__ volatile (                                                     \
+            "movdqa            %5, %%xmm6       \n\t"                          \
+            "movdqa            %6, %%xmm7       \n\t"                          \
+            "1:                                 \n\t"                          \
+            "movdqu   (%1,%0,4), %%xmm0         \n\t"                          \
+            "movdqu 16(%1,%0,4), %%xmm1         \n\t"                          \
+            bswap("%%xmm7", "%%xmm0")                                          \
+            bswap("%%xmm7", "%%xmm1")                                          \
+            "movdqa       %%xmm0, %%xmm2        \n\t"                          \
+            "movdqa       %%xmm1, %%xmm3        \n\t"                          \
+            "psrld           $22, %%xmm2        \n\t"                          \
+            "psrld           $22, %%xmm3        \n\t"                          \
+            "packssdw     %%xmm3, %%xmm2        \n\t"                          \
+            "movdqu       %%xmm2, (%4,%0,2)     \n\t"                          \
+            "movdqa       %%xmm0, %%xmm2        \n\t"                          \
+            "movdqa       %%xmm1, %%xmm3        \n\t"                          \
+            "psrld           $12, %%xmm2        \n\t"                          \
+            "psrld           $12, %%xmm3        \n\t"                          \
+            "pand         %%xmm6, %%xmm2        \n\t"                          \
+            "pand         %%xmm6, %%xmm3        \n\t"                          \
+            "packssdw     %%xmm3, %%xmm2        \n\t"                          \
+            "movdqu       %%xmm2, (%2,%0,2)     \n\t"                          \
+            "psrld            $2, %%xmm0        \n\t"                          \
+            "psrld            $2, %%xmm1        \n\t"                          \
+            "pand         %%xmm6, %%xmm0        \n\t"                          \
+            "pand         %%xmm6, %%xmm1        \n\t"                          \
+            "packssdw     %%xmm1, %%xmm0        \n\t"                          \
+            "movdqu       %%xmm0, (%3,%0,2)     \n\t"                          \
+            "add              $8, %0            \n\t"                          \
+            "jl               1b                \n\t"                          \
+            : "+r"(i)                                                          \
+            : "r"(src_end), "r"(g_end), "r"(b_end), "r"(r_end),                \
+              "m"(dpx_mask_10[0]), "m"(swap_mask[0])                           \
+            : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",                 \
+                           "%xmm6", "%xmm7",) "memory"                         \
+        );                                                                     \
+    }                                                                          \
+    tail(src + 4 * n, g + n, b + n, r + n, width - n);                         \
+}
+
+#define PACK_RGB10(name, bswap, tail)                                          \
+static void pack_rgb10_ ## name(const uint16_t *g, const uint16_t *b,          \
+                                const uint16_t *r, uint8_t *dst, int width)    \
+{                                                                              \
+    int n = width & ~7;                                                        \
+    x86_reg i = -n;                                                            \
+                                                                               \
+    if (n) {                                                                   \
+        uint8_t *dst_end = dst + 4 * n;                                        \
+        const uint16_t *g_end = g + n, *b_end = b + n, *r_end = r + n;         \
+                                                                               \
+        __asm__ volatile (                                                     \
+            "pxor         %%xmm5, %%xmm5        \n\t"                          \
+            "movdqa            %5, %%xmm7       \n\t"                          \
+            "movdqa            %6, %%xmm6       \n\t"                          \
+            "1:                                 \n\t"                          \
+            "movdqu    (%2,%0,2), %%xmm0        \n\t"                          \
+            "movdqu    (%3,%0,2), %%xmm1        \n\t"                          \
+            "movdqu    (%4,%0,2), %%xmm2        \n\t"                          \
+            bswap("%%xmm7", "%%xmm0")                                          \
+            bswap("%%xmm7", "%%xmm1")                                          \
+            bswap("%%xmm7", "%%xmm2")                                          \
+            "movdqa       %%xmm0, %%xmm3        \n\t"                          \
+            "punpcklwd    %%xmm5, %%xmm0        \n\t"                          \
+            "punpckhwd    %%xmm5, %%xmm3        \n\t"                          \
+            "pslld           $12, %%xmm0        \n\t"                          \
+            "pslld           $12, %%xmm3        \n\t"                          \
+            "movdqa       %%xmm1, %%xmm4        \n\t"                          \
+            "punpcklwd    %%xmm5, %%xmm1        \n\t"                          \
+            "punpckhwd    %%xmm5, %%xmm4        \n\t"                          \
+            "pslld            $2, %%xmm1        \n\t"                          \
+            "pslld            $2, %%xmm4        \n\t"                          \
+            "por          %%xmm1, %%xmm0        \n\t"                          \
+            "por          %%xmm4, %%xmm3        \n\t"                          \
+            "movdqa       %%xmm2, %%xmm4        \n\t"                          \
+            "punpcklwd    %%xmm5, %%xmm2        \n\t"                          \
+            "punpckhwd    %%xmm5, %%xmm4        \n\t"                          \
+            "pslld           $22, %%xmm2        \n\t"                          \
+            "pslld           $22, %%xmm4        \n\t"                          \
+            "por          %%xmm2, %%xmm0        \n\t"                          \
+            "por          %%xmm4, %%xmm3        \n\t"                          \
+            bswap("%%xmm6", "%%xmm0")                                          \
+            bswap("%%xmm6", "%%xmm3")                                          \
+            "movdqu       %%xmm0,   (%1,%0,4)   \n\t"                          \
+            "movdqu       %%xmm3, 16(%1,%0,4)   \n\t"                          \
+            "add              $8, %0            \n\t"                          \
+            "jl               1b                \n\t"                          \
+            : "+r"(i)                                                          \
+            : "r"(dst_end), "r"(g_end), "r"(b_end), "r"(r_end),                \
+              "m"(dpx_bswap16[0]), "m"(dpx_bswap32[0])                         \
+            : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4",        \
+                           "%xmm5", "%xmm6", "%xmm7",) "memory"                \
+        );                                                                     \
+    }                                                                          \
+    tail(g + n, b + n, r + n, dst + 4 * n, width - n);                         \
+}
+
+UNPACK_RGB10(le_sse2, BSWAP_NONE, dpx_bswap32, ff_dpx_unpack_rgb10_le)
+PACK_RGB10(le_sse2, BSWAP_NONE, ff_dpx_pack_rgb10_le)
+#endif /* HAVE_SSE2_INLINE */
+
+#if HAVE_SSSE3_INLINE
+UNPACK_RGB10(be_ssse3, BSWAP, dpx_bswap32, ff_dpx_unpack_rgb10_be)
+PACK_RGB10(be_ssse3, BSWAP, ff_dpx_pack_rgb10_be)
+#endif /* HAVE_SSSE3_INLINE */
+
+av_cold void ff_dpxdsp_init_x86(DPXDSPContext *c)
+{
+    int cpu_flags = av_get_cpu_flags();
+
+#if HAVE_SSE2_INLINE
+    if (INLINE_SSE2(cpu_flags)) {
+        c->unpack_rgb10[0] = unpack_rgb10_le_sse2;
+        c->pack_rgb10[0]   = pack_rgb10_le_sse2;
+    }
+#endif
+#if HAVE_SSSE3_INLINE
+    if (INLINE_SSSE3(cpu_flags)) {
+        c->unpack_rgb10[1] = unpack_rgb10_be_ssse3;
+        c->pack_rgb10[1]   = pack_rgb10_be_ssse3;
+    }
+#endif
+}
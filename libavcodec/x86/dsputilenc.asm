@@ -274,6 +274,72 @@ INIT_XMM ssse3
 %define ABS_SUM_8x8 ABS_SUM_8x8_64
 HADAMARD8_DIFF 9
 
+%if HAVE_AVX2_EXTERNAL && ARCH_X86_64
+; %1/%2 = dst/tmp register numbers, %3 = pix1 row, %4 = pix2 row
+; the low lane gets the left 8 pixels of the row, the high lane the right ones
+%macro DIFF_PIXELS_16x1 4
+    vpmovzxbw      m%1, %3
+    vpmovzxbw      m%2, %4
+    psubw          m%1, m%2
+%endmacro
+
+INIT_YMM avx2
+; the two 8x8 blocks of a 16x8 area are transformed side by side, one per
+; 128-bit lane; r1, r2 and r3 are not clobbered, r0 must hold stride*3
+hadamard8x16_diff %+ SUFFIX:
+    lea                          r6, [r1+r3*4]
+    lea                          r7, [r2+r3*4]
+    DIFF_PIXELS_16x1              0, 8, [r1     ], [r2     ]
+    DIFF_PIXELS_16x1              1, 8, [r1+r3  ], [r2+r3  ]
+    DIFF_PIXELS_16x1              2, 8, [r1+r3*2], [r2+r3*2]
+    DIFF_PIXELS_16x1              3, 8, [r1+r0  ], [r2+r0  ]
+    DIFF_PIXELS_16x1              4, 8, [r6     ], [r7     ]
+    DIFF_PIXELS_16x1              5, 8, [r6+r3  ], [r7+r3  ]
+    DIFF_PIXELS_16x1              6, 8, [r6+r3*2], [r7+r3*2]
+    DIFF_PIXELS_16x1              7, 8, [r6+r0  ], [r7+r0  ]
+    HADAMARD8
+    TRANSPOSE8x8W                 0,  1,  2,  3,  4,  5,  6,  7,  8
+    HADAMARD8
+    ABS_SUM_8x8_64              none
+
+    ; saturating sum of each lane separately, so that every 8x8 block is
+    ; clipped exactly like in the single block versions
+    pshufd                       m1, m0, 0xE
+    paddusw                      m0, m1
+    pshuflw                      m1, m0, 0xE
+    paddusw                      m0, m1
+    pshuflw                      m1, m0, 0x1
+    paddusw                      m0, m1
+    vextracti128              xmm10, m0, 1
+    vextracti128              xmm11, m0, 0
+    vmovd                       eax, xmm11
+    vmovd                       r6d, xmm10
+    and                         eax, 0xFFFF
+    and                         r6d, 0xFFFF
+    add                         eax, r6d
+    ret
+
+; int ff_hadamard8_diff16_avx2(void *s, uint8_t *src1, uint8_t *src2,
+;                              int stride, int h)
+cglobal hadamard8_diff16, 5, 8, 12
+    movsxdifnidn                 r3, r3d
+    lea                          r0, [r3*3]
+    call hadamard8x16_diff %+ SUFFIX
+    mov                         r5d, eax
+
+    cmp                         r4d, 16
+    jne .done
+
+    lea                          r1, [r1+r3*8]
+    lea                          r2, [r2+r3*8]
+    call hadamard8x16_diff %+ SUFFIX
+    add                         r5d, eax
+
+.done:
+    mov                         eax, r5d
+    RET
+%endif ; HAVE_AVX2_EXTERNAL && ARCH_X86_64
+
 INIT_XMM sse2
 ; sse16_sse2(void *v, uint8_t * pix1, uint8_t * pix2, int line_size, int h)
 cglobal sse16, 5, 5, 8
@@ -334,6 +400,167 @@ cglobal sse16, 5, 5, 8
     movd     eax, m7         ; return value
     RET
 
+%if HAVE_AVX2_EXTERNAL
+; load two 16 pixel rows into the two lanes of ymm register %1
+%macro LOAD_2ROWS 3
+    movu               xmm%1, %2
+    vinserti128        ymm%1, ymm%1, %3, 1
+%endmacro
+
+; add up the words of the qwords of ymm%1 into eax, ymm%2 is clobbered
+%macro HSUM_Q_AVX2 2
+    vextracti128       xmm%2, ymm%1, 1
+    vpaddw             xmm%1, xmm%1, xmm%2
+    vpunpckhqdq        xmm%2, xmm%1, xmm%1
+    vpaddw             xmm%1, xmm%1, xmm%2
+    vmovd                eax, xmm%1
+%endmacro
+
+INIT_YMM avx2
+; sse16_avx2(void *v, uint8_t * pix1, uint8_t * pix2, int line_size, int h)
+cglobal sse16, 5, 5, 5
+    movsxdifnidn r3, r3d
+    pxor          m0, m0
+    pxor          m4, m4
+
+.next2lines:
+    LOAD_2ROWS     1, [r1], [r1+r3]
+    LOAD_2ROWS     2, [r2], [r2+r3]
+    psubusb       m3, m1, m2
+    psubusb       m2, m1
+    por           m2, m3
+    punpckhbw     m1, m2, m0
+    punpcklbw     m2, m0
+    pmaddwd       m1, m1
+    pmaddwd       m2, m2
+    lea           r1, [r1+r3*2]
+    lea           r2, [r2+r3*2]
+    paddd         m4, m1
+    paddd         m4, m2
+    sub          r4d, 2
+    jg .next2lines
+
+    vextracti128 xmm1, ymm4, 1
+    vpaddd       xmm4, xmm4, xmm1
+    vpshufd      xmm1, xmm4, 0xE
+    vpaddd       xmm4, xmm4, xmm1
+    vpshufd      xmm1, xmm4, 0x1
+    vpaddd       xmm4, xmm4, xmm1
+    vmovd         eax, xmm4
+    RET
+
+; int ff_sad16_avx2(void *v, uint8_t *pix1, uint8_t *pix2, int line_size, int h)
+cglobal sad16, 5, 6, 5
+    movsxdifnidn r3, r3d
+    lea           r5, [r3*3]
+    pxor          m0, m0
+.loop:
+    LOAD_2ROWS     1, [r2     ], [r2+r3]
+    LOAD_2ROWS     2, [r2+r3*2], [r2+r5]
+    LOAD_2ROWS     3, [r1     ], [r1+r3]
+    LOAD_2ROWS     4, [r1+r3*2], [r1+r5]
+    psadbw        m1, m3
+    psadbw        m2, m4
+    lea           r1, [r1+r3*4]
+    lea           r2, [r2+r3*4]
+    paddw         m0, m1
+    paddw         m0, m2
+    sub          r4d, 4
+    jg .loop
+    HSUM_Q_AVX2    0, 1
+    RET
+
+; int ff_sad16_x2_avx2(void *v, uint8_t *pix1, uint8_t *pix2, int line_size, int h)
+; pix2 is interpolated horizontally, rounding up like pavgb does
+cglobal sad16_x2, 5, 5, 5
+    movsxdifnidn r3, r3d
+    pxor          m0, m0
+.loop:
+    LOAD_2ROWS     1, [r2  ], [r2+r3  ]
+    LOAD_2ROWS     2, [r2+1], [r2+r3+1]
+    LOAD_2ROWS     3, [r1  ], [r1+r3  ]
+    pavgb         m1, m2
+    psadbw        m1, m3
+    lea           r1, [r1+r3*2]
+    lea           r2, [r2+r3*2]
+    paddw         m0, m1
+    sub          r4d, 2
+    jg .loop
+    HSUM_Q_AVX2    0, 1
+    RET
+
+; int ff_sad16_y2_avx2(void *v, uint8_t *pix1, uint8_t *pix2, int line_size, int h)
+; pix2 is interpolated vertically, rounding up like pavgb does
+cglobal sad16_y2, 5, 5, 5
+    movsxdifnidn r3, r3d
+    pxor          m0, m0
+.loop:
+    LOAD_2ROWS     1, [r2     ], [r2+r3  ]
+    LOAD_2ROWS     2, [r2+r3  ], [r2+r3*2]
+    LOAD_2ROWS     3, [r1     ], [r1+r3  ]
+    pavgb         m1, m2
+    psadbw        m1, m3
+    lea           r1, [r1+r3*2]
+    lea           r2, [r2+r3*2]
+    paddw         m0, m1
+    sub          r4d, 2
+    jg .loop
+    HSUM_Q_AVX2    0, 1
+    RET
+
+%if ARCH_X86_64
+; void ff_sad16_x4_avx2(uint8_t *pix1, uint8_t *const ref[4], int line_size,
+;                       int h, int *scores)
+; computes the SAD of pix1 against four candidate blocks at once, sharing the
+; pix1 loads between them
+cglobal sad16_x4, 5, 9, 8
+    movsxdifnidn r2, r2d
+    mov           r5, [r1]
+    mov           r6, [r1+gprsize]
+    mov           r7, [r1+gprsize*2]
+    mov           r8, [r1+gprsize*3]
+    pxor          m4, m4
+    pxor          m5, m5
+    pxor          m6, m6
+    pxor          m7, m7
+.loop:
+    LOAD_2ROWS     0, [r0], [r0+r2]
+    LOAD_2ROWS     1, [r5], [r5+r2]
+    LOAD_2ROWS     2, [r6], [r6+r2]
+    psadbw        m1, m0
+    psadbw        m2, m0
+    paddw         m4, m1
+    paddw         m5, m2
+    LOAD_2ROWS     1, [r7], [r7+r2]
+    LOAD_2ROWS     2, [r8], [r8+r2]
+    psadbw        m1, m0
+    psadbw        m2, m0
+    paddw         m6, m1
+    paddw         m7, m2
+    lea           r0, [r0+r2*2]
+    lea           r5, [r5+r2*2]
+    lea           r6, [r6+r2*2]
+    lea           r7, [r7+r2*2]
+    lea           r8, [r8+r2*2]
+    sub          r3d, 2
+    jg .loop
+
+    ; every qword holds a partial sum in its low word, interleave the four
+    ; accumulators into dwords and add up the qwords and lanes
+    pslldq        m5, m5, 4
+    pslldq        m7, m7, 4
+    por           m4, m5         ; a0 b0 a1 b1
+    por           m6, m7         ; c0 d0 c1 d1
+    punpckhqdq    m5, m4, m6
+    punpcklqdq    m4, m6
+    paddd         m4, m5         ; a b c d
+    vextracti128 xmm5, ymm4, 1
+    vpaddd       xmm4, xmm4, xmm5
+    movu        [r4], xmm4
+    RET
+%endif ; ARCH_X86_64
+%endif ; HAVE_AVX2_EXTERNAL
+
 INIT_MMX mmx
 ; get_pixels_mmx(int16_t *block, const uint8_t *pixels, int line_size)
 cglobal get_pixels, 3,4
@@ -932,6 +932,12 @@ static int ssd_int8_vs_int16_mmx(const int8_t *pix1, const int16_t *pix2, int si
 #endif /* HAVE_INLINE_ASM */
 
 int ff_sse16_sse2(void *v, uint8_t * pix1, uint8_t * pix2, int line_size, int h);
+int ff_sse16_avx2(void *v, uint8_t * pix1, uint8_t * pix2, int line_size, int h);
+int ff_sad16_avx2(void *v, uint8_t *pix1, uint8_t *pix2, int line_size, int h);
+int ff_sad16_x2_avx2(void *v, uint8_t *pix1, uint8_t *pix2, int line_size, int h);
+int ff_sad16_y2_avx2(void *v, uint8_t *pix1, uint8_t *pix2, int line_size, int h);
+void ff_sad16_x4_avx2(uint8_t *pix1, uint8_t *const ref[4], int line_size,
+                      int h, int *scores);
 
 #define hadamard_func(cpu) \
 int ff_hadamard8_diff_##cpu  (void *s, uint8_t *src1, uint8_t *src2, \
@@ -943,6 +949,8 @@ hadamard_func(mmx)
 hadamard_func(mmxext)
 hadamard_func(sse2)
 hadamard_func(ssse3)
+int ff_hadamard8_diff16_avx2(void *s, uint8_t *src1, uint8_t *src2,
+                             int stride, int h);
 
 av_cold void ff_dsputilenc_init_mmx(DSPContext *c, AVCodecContext *avctx)
 {
@@ -1058,4 +1066,16 @@ av_cold void ff_dsputilenc_init_mmx(DSPContext *c, AVCodecContext *avctx)
     }
 
     ff_dsputil_init_pix_mmx(c, avctx);
+
+    if (EXTERNAL_AVX2(mm_flags)) {
+        c->sse[0]        = ff_sse16_avx2;
+        c->sad[0]        = ff_sad16_avx2;
+        c->pix_abs[0][0] = ff_sad16_avx2;
+        c->pix_abs[0][1] = ff_sad16_x2_avx2;
+        c->pix_abs[0][2] = ff_sad16_y2_avx2;
+#if ARCH_X86_64
+        c->hadamard8_diff[0] = ff_hadamard8_diff16_avx2;
+        c->sad16_x4          = ff_sad16_x4_avx2;
+#endif
+    }
 }
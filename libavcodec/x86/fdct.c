@@ -583,4 +583,276 @@ void ff_fdct_sse2(int16_t *block)
     fdct_row_sse2(block1, block);
 }
 
+#if HAVE_SSE2_INLINE && ARCH_X86_64
+
+/*
+ * SSE2 version of ff_jpeg_fdct_islow_10(), with the same output.
+ * Each pass does the 1-D transform of all 8 rows or columns at once on
+ * transposed data, forming every rotation as pmaddwd on an interleaved
+ * pair of inputs so the products and sums stay exact 32-bit values.
+ */
+
+#define FIX_0_298631336   2446
+#define FIX_0_390180644   3196
+#define FIX_0_541196100   4433
+#define FIX_0_765366865   6270
+#define FIX_0_899976223   7373
+#define FIX_1_175875602   9633
+#define FIX_1_501321110  12299
+#define FIX_1_847759065  15137
+#define FIX_1_961570560  16069
+#define FIX_2_053119869  16819
+#define FIX_2_562915447  20995
+#define FIX_3_072711026  25172
+
+#define X4(a, b) a, b, a, b, a, b, a, b
+
+DECLARE_ALIGNED(16, static const int16_t, fdct_islow_10_tab)[10][8] = {
+    { X4(2, 2) },                                   // pass 1 even part
+    { X4(1, 1) },                                   // pass 2 even part
+    { X4(FIX_0_541196100 + FIX_0_765366865,         // out2 (tmp13, tmp12)
+         FIX_0_541196100) },
+    { X4(FIX_0_541196100,                           // out6 (tmp13, tmp12)
+         FIX_0_541196100 - FIX_1_847759065) },
+    { X4(FIX_1_175875602 - FIX_1_961570560,         // z3 (z3, z4)
+         FIX_1_175875602) },
+    { X4(FIX_1_175875602,                           // z4 (z3, z4)
+         FIX_1_175875602 - FIX_0_390180644) },
+    { X4(FIX_0_298631336 - FIX_0_899976223,         // out7 (tmp4, tmp7)
+         -FIX_0_899976223) },
+    { X4(-FIX_0_899976223,                          // out1 (tmp4, tmp7)
+         FIX_1_501321110 - FIX_0_899976223) },
+    { X4(FIX_2_053119869 - FIX_2_562915447,         // out5 (tmp5, tmp6)
+         -FIX_2_562915447) },
+    { X4(-FIX_2_562915447,                          // out3 (tmp5, tmp6)
+         FIX_3_072711026 - FIX_2_562915447) },
+};
+
+DECLARE_ALIGNED(16, static const int32_t, fdct_islow_10_rnd)[4][4] = {
+    { 0,       0,       0,       0       },         // pass 1 even part
+    { 1 << 1,  1 << 1,  1 << 1,  1 << 1  },         // pass 2 even part
+    { 1 << 11, 1 << 11, 1 << 11, 1 << 11 },         // pass 1
+    { 1 << 14, 1 << 14, 1 << 14, 1 << 14 },         // pass 2
+};
+
+static av_always_inline void transpose8x8_sse2(const int16_t *in, int16_t *out)
+{
+    __asm__ volatile (
+        "movdqa       (%0), %%xmm0         \n\t"
+        "movdqa     16(%0), %%xmm1         \n\t"
+        "movdqa     32(%0), %%xmm2         \n\t"
+        "movdqa     48(%0), %%xmm3         \n\t"
+        "movdqa     64(%0), %%xmm4         \n\t"
+        "movdqa     80(%0), %%xmm5         \n\t"
+        "movdqa     96(%0), %%xmm6         \n\t"
+        "movdqa    112(%0), %%xmm7         \n\t"
+        "movdqa     %%xmm0, %%xmm8         \n\t"
+        "punpcklwd  %%xmm1, %%xmm0         \n\t"
+        "punpckhwd  %%xmm1, %%xmm8         \n\t"
+        "movdqa     %%xmm2, %%xmm9         \n\t"
+        "punpcklwd  %%xmm3, %%xmm2         \n\t"
+        "punpckhwd  %%xmm3, %%xmm9         \n\t"
+        "movdqa     %%xmm4, %%xmm10        \n\t"
+        "punpcklwd  %%xmm5, %%xmm4         \n\t"
+        "punpckhwd  %%xmm5, %%xmm10        \n\t"
+        "movdqa     %%xmm6, %%xmm11        \n\t"
+        "punpcklwd  %%xmm7, %%xmm6         \n\t"
+        "punpckhwd  %%xmm7, %%xmm11        \n\t"
+        "movdqa     %%xmm0, %%xmm1         \n\t"
+        "punpckldq  %%xmm2, %%xmm0         \n\t"
+        "punpckhdq  %%xmm2, %%xmm1         \n\t"
+        "movdqa     %%xmm8, %%xmm3         \n\t"
+        "punpckldq  %%xmm9, %%xmm8         \n\t"
+        "punpckhdq  %%xmm9, %%xmm3         \n\t"
+        "movdqa     %%xmm4, %%xmm5         \n\t"
+        "punpckldq  %%xmm6, %%xmm4         \n\t"
+        "punpckhdq  %%xmm6, %%xmm5         \n\t"
+        "movdqa    %%xmm10, %%xmm7         \n\t"
+        "punpckldq %%xmm11, %%xmm10        \n\t"
+        "punpckhdq %%xmm11, %%xmm7         \n\t"
+        "movdqa     %%xmm0, %%xmm12        \n\t"
+        "punpcklqdq %%xmm4, %%xmm12        \n\t"
+        "punpckhqdq %%xmm4, %%xmm0         \n\t"
+        "movdqa     %%xmm1, %%xmm13        \n\t"
+        "punpcklqdq %%xmm5, %%xmm13        \n\t"
+        "punpckhqdq %%xmm5, %%xmm1         \n\t"
+        "movdqa     %%xmm8, %%xmm14        \n\t"
+        "punpcklqdq %%xmm10, %%xmm14       \n\t"
+        "punpckhqdq %%xmm10, %%xmm8        \n\t"
+        "movdqa     %%xmm3, %%xmm15        \n\t"
+        "punpcklqdq %%xmm7, %%xmm15        \n\t"
+        "punpckhqdq %%xmm7, %%xmm3         \n\t"
+        "movdqa    %%xmm12,    (%1)        \n\t"
+        "movdqa     %%xmm0,  16(%1)        \n\t"
+        "movdqa    %%xmm13,  32(%1)        \n\t"
+        "movdqa     %%xmm1,  48(%1)        \n\t"
+        "movdqa    %%xmm14,  64(%1)        \n\t"
+        "movdqa     %%xmm8,  80(%1)        \n\t"
+        "movdqa    %%xmm15,  96(%1)        \n\t"
+        "movdqa     %%xmm3, 112(%1)        \n\t"
+        :
+        : "r" (in), "r" (out)
+        : XMM_CLOBBERS("%xmm0",  "%xmm1",  "%xmm2",  "%xmm3",
+                       "%xmm4",  "%xmm5",  "%xmm6",  "%xmm7",
+                       "%xmm8",  "%xmm9",  "%xmm10", "%xmm11",
+                       "%xmm12", "%xmm13", "%xmm14", "%xmm15",)
+          "memory"
+    );
+}
+
+/* pack the rounded and shifted dwords lo/hi (clobbered) into words in lo */
+#define DESCALE_PACK(lo, hi, rnd, shift)             \
+        "paddd    %%xmm"#rnd", %%xmm"#lo"      \n\t" \
+        "paddd    %%xmm"#rnd", %%xmm"#hi"      \n\t" \
+        "psrad    $"S(shift)", %%xmm"#lo"      \n\t" \
+        "psrad    $"S(shift)", %%xmm"#hi"      \n\t" \
+        "packssdw  %%xmm"#hi", %%xmm"#lo"      \n\t"
+
+/*
+ * 1-D transform of the 8 vectors at in, for the 8 lanes in parallel.
+ * even = index of the even part factors and rounding, shift and
+ * even_shift the final shifts; in and out may be the same.
+ */
+#define FDCT_ISLOW_10_1D(name, even, shift, even_shift)                     \
+static av_always_inline void name(const int16_t *in, int16_t *out)          \
+{                                                                           \
+    __asm__ volatile (                                                      \
+        "movdqa       (%0), %%xmm0         \n\t"                            \
+        "movdqa    112(%0), %%xmm7         \n\t"                            \
+        "movdqa     16(%0), %%xmm1         \n\t"                            \
+        "movdqa     96(%0), %%xmm6         \n\t"                            \
+        "movdqa     32(%0), %%xmm2         \n\t"                            \
+        "movdqa     80(%0), %%xmm5         \n\t"                            \
+        "movdqa     48(%0), %%xmm3         \n\t"                            \
+        "movdqa     64(%0), %%xmm4         \n\t"                            \
+        "movdqa     %%xmm0, %%xmm8         \n\t"                            \
+        "paddw      %%xmm7, %%xmm0         \n\t" /* tmp0 */                 \
+        "psubw      %%xmm7, %%xmm8         \n\t" /* tmp7 */                 \
+        "movdqa     %%xmm1, %%xmm9         \n\t"                            \
+        "paddw      %%xmm6, %%xmm1         \n\t" /* tmp1 */                 \
+        "psubw      %%xmm6, %%xmm9         \n\t" /* tmp6 */                 \
+        "movdqa     %%xmm2, %%xmm10        \n\t"                            \
+        "paddw      %%xmm5, %%xmm2         \n\t" /* tmp2 */                 \
+        "psubw      %%xmm5, %%xmm10        \n\t" /* tmp5 */                 \
+        "movdqa     %%xmm3, %%xmm11        \n\t"                            \
+        "paddw      %%xmm4, %%xmm3         \n\t" /* tmp3 */                 \
+        "psubw      %%xmm4, %%xmm11        \n\t" /* tmp4 */                 \
+                                                                            \
+        "movdqa     %%xmm0, %%xmm12        \n\t"                            \
+        "psubw      %%xmm3, %%xmm12        \n\t" /* tmp13 */                \
+        "movdqa     %%xmm1, %%xmm13        \n\t"                            \
+        "psubw      %%xmm2, %%xmm13        \n\t" /* tmp12 */                \
+        "movdqa     %%xmm0, %%xmm4         \n\t"                            \
+        "punpcklwd  %%xmm3, %%xmm4         \n\t"                            \
+        "punpckhwd  %%xmm3, %%xmm0         \n\t"                            \
+        "movdqa     %%xmm1, %%xmm5         \n\t"                            \
+        "punpcklwd  %%xmm2, %%xmm5         \n\t"                            \
+        "punpckhwd  %%xmm2, %%xmm1         \n\t"                            \
+        "movdqa  "#even"*16(%2), %%xmm2    \n\t"                            \
+        "pmaddwd    %%xmm2, %%xmm4         \n\t" /* tmp10 */                \
+        "pmaddwd    %%xmm2, %%xmm0         \n\t"                            \
+        "pmaddwd    %%xmm2, %%xmm5         \n\t" /* tmp11 */                \
+        "pmaddwd    %%xmm2, %%xmm1         \n\t"                            \
+        "movdqa     %%xmm4, %%xmm6         \n\t"                            \
+        "paddd      %%xmm5, %%xmm6         \n\t"                            \
+        "psubd      %%xmm5, %%xmm4         \n\t"                            \
+        "movdqa     %%xmm0, %%xmm7         \n\t"                            \
+        "paddd      %%xmm1, %%xmm7         \n\t"                            \
+        "psubd      %%xmm1, %%xmm0         \n\t"                            \
+        "movdqa  "#even"*16(%3), %%xmm2    \n\t"                            \
+        DESCALE_PACK(6, 7, 2, even_shift)                                   \
+        DESCALE_PACK(4, 0, 2, even_shift)                                   \
+        "movdqa     %%xmm6,    (%1)        \n\t"                            \
+        "movdqa     %%xmm4,  64(%1)        \n\t"                            \
+                                                                            \
+        "movdqa  "#even"*16+32(%3), %%xmm15 \n\t"                           \
+        "movdqa    %%xmm12, %%xmm0         \n\t"                            \
+        "punpcklwd %%xmm13, %%xmm0         \n\t"                            \
+        "punpckhwd %%xmm13, %%xmm12        \n\t"                            \
+        "movdqa     %%xmm0, %%xmm1         \n\t"                            \
+        "movdqa    %%xmm12, %%xmm2         \n\t"                            \
+        "pmaddwd    32(%2), %%xmm0         \n\t"                            \
+        "pmaddwd    32(%2), %%xmm12        \n\t"                            \
+        "pmaddwd    48(%2), %%xmm1         \n\t"                            \
+        "pmaddwd    48(%2), %%xmm2         \n\t"                            \
+        DESCALE_PACK(0, 12, 15, shift)                                      \
+        DESCALE_PACK(1,  2, 15, shift)                                      \
+        "movdqa     %%xmm0,  32(%1)        \n\t"                            \
+        "movdqa     %%xmm1,  96(%1)        \n\t"                            \
+                                                                            \
+        "movdqa    %%xmm11, %%xmm12        \n\t"                            \
+        "paddw      %%xmm9, %%xmm12        \n\t" /* z3 */                   \
+        "movdqa    %%xmm10, %%xmm13        \n\t"                            \
+        "paddw      %%xmm8, %%xmm13        \n\t" /* z4 */                   \
+        "movdqa    %%xmm12, %%xmm0         \n\t"                            \
+        "punpcklwd %%xmm13, %%xmm0         \n\t"                            \
+        "punpckhwd %%xmm13, %%xmm12        \n\t"                            \
+        "movdqa     %%xmm0, %%xmm1         \n\t"                            \
+        "movdqa    %%xmm12, %%xmm2         \n\t"                            \
+        "pmaddwd    64(%2), %%xmm0         \n\t" /* z3 + z5 */              \
+        "pmaddwd    64(%2), %%xmm12        \n\t"                            \
+        "pmaddwd    80(%2), %%xmm1         \n\t" /* z4 + z5 */              \
+        "pmaddwd    80(%2), %%xmm2         \n\t"                            \
+                                                                            \
+        "movdqa    %%xmm11, %%xmm3         \n\t"                            \
+        "punpcklwd  %%xmm8, %%xmm3         \n\t"                            \
+        "punpckhwd  %%xmm8, %%xmm11        \n\t"                            \
+        "movdqa     %%xmm3, %%xmm4         \n\t"                            \
+        "movdqa    %%xmm11, %%xmm5         \n\t"                            \
+        "pmaddwd    96(%2), %%xmm3         \n\t"                            \
+        "pmaddwd    96(%2), %%xmm11        \n\t"                            \
+        "pmaddwd   112(%2), %%xmm4         \n\t"                            \
+        "pmaddwd   112(%2), %%xmm5         \n\t"                            \
+        "paddd      %%xmm0, %%xmm3         \n\t"                            \
+        "paddd     %%xmm12, %%xmm11        \n\t"                            \
+        "paddd      %%xmm1, %%xmm4         \n\t"                            \
+        "paddd      %%xmm2, %%xmm5         \n\t"                            \
+        DESCALE_PACK(3, 11, 15, shift)                                      \
+        DESCALE_PACK(4,  5, 15, shift)                                      \
+        "movdqa     %%xmm3, 112(%1)        \n\t"                            \
+        "movdqa     %%xmm4,  16(%1)        \n\t"                            \
+                                                                            \
+        "movdqa    %%xmm10, %%xmm6         \n\t"                            \
+        "punpcklwd  %%xmm9, %%xmm6         \n\t"                            \
+        "punpckhwd  %%xmm9, %%xmm10        \n\t"                            \
+        "movdqa     %%xmm6, %%xmm7         \n\t"                            \
+        "movdqa    %%xmm10, %%xmm13        \n\t"                            \
+        "pmaddwd   128(%2), %%xmm6         \n\t"                            \
+        "pmaddwd   128(%2), %%xmm10        \n\t"                            \
+        "pmaddwd   144(%2), %%xmm7         \n\t"                            \
+        "pmaddwd   144(%2), %%xmm13        \n\t"                            \
+        "paddd      %%xmm1, %%xmm6         \n\t"                            \
+        "paddd      %%xmm2, %%xmm10        \n\t"                            \
+        "paddd      %%xmm0, %%xmm7         \n\t"                            \
+        "paddd     %%xmm12, %%xmm13        \n\t"                            \
+        DESCALE_PACK(6, 10, 15, shift)                                      \
+        DESCALE_PACK(7, 13, 15, shift)                                      \
+        "movdqa     %%xmm6,  80(%1)        \n\t"                            \
+        "movdqa     %%xmm7,  48(%1)        \n\t"                            \
+        :                                                                   \
+        : "r" (in), "r" (out), "r" (fdct_islow_10_tab),                     \
+          "r" (fdct_islow_10_rnd)                                           \
+        : XMM_CLOBBERS("%xmm0",  "%xmm1",  "%xmm2",  "%xmm3",               \
+                       "%xmm4",  "%xmm5",  "%xmm6",  "%xmm7",               \
+                       "%xmm8",  "%xmm9",  "%xmm10", "%xmm11",              \
+                       "%xmm12", "%xmm13", "%xmm14", "%xmm15",)             \
+          "memory"                                                          \
+    );                                                                      \
+}
+
+FDCT_ISLOW_10_1D(fdct_islow_10_rows_sse2, 0, 12, 0)
+FDCT_ISLOW_10_1D(fdct_islow_10_cols_sse2, 1, 15, 2)
+
+void ff_jpeg_fdct_islow_10_sse2(int16_t *block)
+{
+    DECLARE_ALIGNED(16, int16_t, tmp)[64];
+
+    transpose8x8_sse2(block, tmp);
+    fdct_islow_10_rows_sse2(tmp, tmp);
+    transpose8x8_sse2(tmp, tmp);
+    fdct_islow_10_cols_sse2(tmp, block);
+}
+
+#endif /* HAVE_SSE2_INLINE && ARCH_X86_64 */
+
 #endif /* HAVE_INLINE_ASM */
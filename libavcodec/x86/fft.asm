@@ -863,10 +863,15 @@ INIT_XMM sse
 %macro CMUL 6 ;j, xmm0, xmm1, 3, 4, 5
     mulps      m6, %3, [%5+%1]
     mulps      m7, %2, [%5+%1]
+%if cpuflag(fma3)
+    vfmsub132ps %2, m6, [%6+%1]
+    vfmadd132ps %3, m7, [%6+%1]
+%else
     mulps      %2, %2, [%6+%1]
     mulps      %3, %3, [%6+%1]
     subps      %2, %2, m6
     addps      %3, %3, m7
+%endif
 %endmacro
 
 %macro POSROTATESHUF_AVX 5 ;j, k, z+n8, tcos+n8, tsin+n8
@@ -1052,7 +1057,11 @@ cglobal imdct_half, 3,12,8; FFTContext *s, FFTSample *output, const FFTSample *i
     mov  r0, r1
     mov  r1d, [r5+FFTContext.nbits]
 
+%if cpuflag(fma3)
+    FFT_DISPATCH _avx, r1 ; the FFT itself is shared with the AVX version
+%else
     FFT_DISPATCH SUFFIX, r1
+%endif
 
     mov  r0d, [r5+FFTContext.mdctsize]
     add  r6, r0
@@ -1091,3 +1100,8 @@ INIT_YMM avx
 %if HAVE_AVX_EXTERNAL
 DECL_IMDCT POSROTATESHUF_AVX
 %endif
+
+%if HAVE_FMA3_EXTERNAL
+INIT_YMM fma3
+DECL_IMDCT POSROTATESHUF_AVX
+%endif
@@ -52,6 +52,10 @@ av_cold void ff_fft_init_x86(FFTContext *s)
         s->fft_calc        = ff_fft_calc_avx;
         s->fft_permutation = FF_FFT_PERM_AVX;
     }
+    if (EXTERNAL_FMA3(has_vectors) && s->nbits >= 5) {
+        /* FMA3 for Haswell, uses the AVX FFT */
+        s->imdct_half      = ff_imdct_half_fma3;
+    }
 }
 
 #if CONFIG_DCT
@@ -26,9 +26,14 @@
 
 %include "libavutil/x86/x86util.asm"
 
-SECTION_RODATA
+SECTION_RODATA 32
 
-pw_pixel_max: times 8 dw ((1 << 10)-1)
+pw_pixel_max: times 16 dw ((1 << 10)-1)
+avx2_pw_4:    times 16 dw 4
+avx2_tc_shuf: times 8 db 0
+              times 8 db 1
+              times 8 db 2
+              times 8 db 3
 
 SECTION .text
 
@@ -65,6 +70,10 @@ cextern pw_4
 ; in:  %2=tc reg
 ; out: %1=splatted tc
 %macro LOAD_TC 2
+%if mmsize == 32
+    vpbroadcastd %1, [%2]
+    pshufb      %1, [avx2_tc_shuf]
+%else
     movd        %1, [%2]
     punpcklbw   %1, %1
 %if mmsize == 8
@@ -72,6 +81,7 @@ cextern pw_4
 %else
     pshuflw     %1, %1, 01010000b
     pshufd      %1, %1, 01010000b
+%endif
 %endif
     psraw       %1, 6
 %endmacro
@@ -94,7 +104,11 @@ cextern pw_4
 %macro DEBLOCK_P0_Q0 7
     psubw   %3, %4
     pxor    %7, %7
+%if mmsize == 32
+    paddw   %3, [avx2_pw_4]
+%else
     paddw   %3, [pw_4]
+%endif
     psubw   %7, %5
     psubw   %6, %2, %1
     psllw   %6, 2
@@ -421,6 +435,95 @@ DEBLOCK_LUMA_64
 INIT_XMM avx
 DEBLOCK_LUMA_64
 %endif
+
+%if HAVE_AVX2_EXTERNAL
+; A ymm register holds a whole 16-pixel edge. The horizontal filter puts
+; rows 0-7 in the low lane and rows 8-15 in the high lane, so the SSE2
+; transposes apply unchanged within each lane. m15 is left out of every
+; SWAP and serves to move single lanes in and out through xmm15.
+
+; %1=row register, %2/%3=address of the row in the low/high lane
+%macro LUMA_H_LOAD_AVX2 3
+    vbroadcasti128 %1, [%2-8]
+    vinserti128    %1, %1, [%3-8], 1
+%endmacro
+
+; %1=lane, %2=address of row 0 of the lane, %3=address of row 3 of the lane
+%macro LUMA_H_STORE_AVX2 3
+    vextracti128 xmm15, m0, %1
+    vmovq       [%2-4], xmm15
+    vmovhps     [%2+r1-4], xmm15
+    vextracti128 xmm15, m1, %1
+    vmovq       [%2+r1*2-4], xmm15
+    vmovhps     [%3-4], xmm15
+    vextracti128 xmm15, m2, %1
+    vmovq       [%3+r1-4], xmm15
+    vmovhps     [%3+r1*2-4], xmm15
+    vextracti128 xmm15, m3, %1
+    vmovq       [%3+r2-4], xmm15
+    vmovhps     [%3+r1*4-4], xmm15
+%endmacro
+
+INIT_YMM avx2
+cglobal deblock_v_luma_10, 5,5,15
+    shl        r2d, 2
+    shl        r3d, 2
+    vmovd    xmm12, r2d
+    vmovd    xmm13, r3d
+    vpbroadcastw m12, xmm12
+    vpbroadcastw m13, xmm13
+    mov         r2, r0
+    sub         r0, r1
+    sub         r0, r1
+    sub         r0, r1
+    movu        p2, [r0]
+    movu        p1, [r0+r1]
+    movu        p0, [r0+r1*2]
+    movu        q0, [r2]
+    movu        q1, [r2+r1]
+    movu        q2, [r2+r1*2]
+    DEBLOCK_LUMA_INTER_SSE2
+    movu   [r0+r1], p1
+    movu [r0+r1*2], p0
+    movu      [r2], q0
+    movu   [r2+r1], q1
+    RET
+
+cglobal deblock_h_luma_10, 5,8,16
+    shl        r2d, 2
+    shl        r3d, 2
+    vmovd    xmm12, r2d
+    vmovd    xmm13, r3d
+    vpbroadcastw m12, xmm12
+    vpbroadcastw m13, xmm13
+    lea         r2, [r1*3]
+    lea         r5, [r0+r2]
+    lea         r6, [r0+r1*8]
+    lea         r7, [r5+r1*8]
+    LUMA_H_LOAD_AVX2 m8, r0,      r6
+    LUMA_H_LOAD_AVX2 m0, r0+r1,   r6+r1
+    LUMA_H_LOAD_AVX2 m2, r0+r1*2, r6+r1*2
+    LUMA_H_LOAD_AVX2 m9, r5,      r7
+    LUMA_H_LOAD_AVX2 m5, r5+r1,   r7+r1
+    LUMA_H_LOAD_AVX2 m1, r5+r1*2, r7+r1*2
+    LUMA_H_LOAD_AVX2 m3, r5+r2,   r7+r2
+    LUMA_H_LOAD_AVX2 m7, r5+r1*4, r7+r1*4
+
+    TRANSPOSE4x4W 8, 0, 2, 9, 10
+    TRANSPOSE4x4W 5, 1, 3, 7, 10
+
+    punpckhqdq  m8, m5
+    SBUTTERFLY qdq, 0, 1, 10
+    SBUTTERFLY qdq, 2, 3, 10
+    punpcklqdq  m9, m7
+
+    DEBLOCK_LUMA_INTER_SSE2
+
+    TRANSPOSE4x4W 0, 1, 2, 3, 4
+    LUMA_H_STORE_AVX2 0, r0, r5
+    LUMA_H_STORE_AVX2 1, r6, r7
+    RET
+%endif ; HAVE_AVX2_EXTERNAL
 %endif
 
 %macro SWAPMOVA 2
@@ -631,6 +631,94 @@ INIT_XMM cpuname
     jl .nextblock
     REP_RET
 
+%if HAVE_AVX2_EXTERNAL && ARCH_X86_64
+; The two horizontally adjacent 8x8 blocks of a pair are transformed
+; together, one in each 128-bit lane.
+
+; %1=row register, %2=offset of the row in the left block
+%macro LOAD_ROW_X2 2
+    vbroadcasti128 m%1, [r2+%2]
+    vinserti128    m%1, m%1, [r2+128+%2], 1
+%endmacro
+
+; %1=row of both blocks, %2=tmp, %3=16 destination pixels
+%macro STORE_DIFF_X2 3
+    vpmovzxbw    %2, %3
+    psraw        %1, 6
+    paddsw       %1, %2
+    packuswb     %1, %1
+    vpermq       %1, %1, 0x08
+    vextracti128 %3, %1, 0
+%endmacro
+
+; %1=uint8_t *dst, %2=int stride, %3=tmp
+%macro IDCT8_ADD_X2_AVX2 3
+    LOAD_ROW_X2   7, 112
+    LOAD_ROW_X2   6,  96
+    LOAD_ROW_X2   5,  80
+    LOAD_ROW_X2   3,  48
+    LOAD_ROW_X2   2,  32
+    LOAD_ROW_X2   1,  16
+    LOAD_ROW_X2   8,   0
+    LOAD_ROW_X2   9,  64
+    IDCT8_1D     m8, m9
+    TRANSPOSE8x8W 0, 1, 2, 3, 4, 5, 6, 7, 8
+    vpbroadcastd m8, [pw_32]
+    paddw        m0, m8
+    SWAP          0, 8
+    SWAP          4, 9
+    IDCT8_1D     m8, m9
+    SWAP          6, 8
+    SWAP          7, 9
+
+    lea          %3, [%2*3]
+    STORE_DIFF_X2 m0, m6, [%1     ]
+    STORE_DIFF_X2 m1, m6, [%1+%2  ]
+    STORE_DIFF_X2 m2, m6, [%1+%2*2]
+    STORE_DIFF_X2 m3, m6, [%1+%3  ]
+    SWAP          0, 8
+    SWAP          1, 9
+    pxor         m7, m7
+    movu  [r2+  0], m7
+    movu  [r2+ 32], m7
+    movu  [r2+ 64], m7
+    movu  [r2+ 96], m7
+    movu  [r2+128], m7
+    movu  [r2+160], m7
+    movu  [r2+192], m7
+    movu  [r2+224], m7
+    lea          %1, [%1+%2*4]
+    STORE_DIFF_X2 m4, m6, [%1     ]
+    STORE_DIFF_X2 m5, m6, [%1+%2  ]
+    STORE_DIFF_X2 m0, m6, [%1+%2*2]
+    STORE_DIFF_X2 m1, m6, [%1+%3  ]
+%endmacro
+
+; Blocks without coefficients are all zero and blocks with only a DC
+; coefficient give the same result through the full transform, so a pair
+; is only skipped when both of its blocks are empty.
+; %1=index of the left block, %2/%3=scan8 of the left/right block
+%macro IDCT8_ADD4_PAIR_AVX2 3
+    movzx       r5d, byte [r4+%2]
+    or          r5b, byte [r4+%3]
+    jz .skip%1
+    mov         r5d, dword [r1+%1*4]
+    add          r5, r0
+    IDCT8_ADD_X2_AVX2 r5, r3, r6
+.skip%1:
+%endmacro
+
+INIT_YMM avx2
+; ff_h264_idct8_add4_8_avx2(uint8_t *dst, const int *block_offset,
+;                           int16_t *block, int stride, const uint8_t nnzc[6*8])
+cglobal h264_idct8_add4_8, 5, 7, 10, dst, block_offset, block, stride, nnzc, dst2, stride3
+    movsxdifnidn r3, r3d
+    IDCT8_ADD4_PAIR_AVX2 0, 4+1*8, 6+1*8
+    add          r2, 256
+    IDCT8_ADD4_PAIR_AVX2 8, 4+3*8, 6+3*8
+    RET
+%endif ; HAVE_AVX2_EXTERNAL && ARCH_X86_64
+
 INIT_MMX mmx
 h264_idct_add8_mmx_plane:
 .nextblock:
@@ -404,6 +404,33 @@ H264_MC_816(H264_MC_HV, sse2)
 H264_MC_816(H264_MC_H, ssse3)
 H264_MC_816(H264_MC_HV, ssse3)
 
+#if HAVE_AVX2_EXTERNAL && ARCH_X86_64
+#define DEF_QPEL_AVX2(OPNAME)\
+void ff_ ## OPNAME ## _h264_qpel16_h_lowpass_avx2(uint8_t *dst, uint8_t *src, int dstStride, int srcStride);\
+void ff_ ## OPNAME ## _h264_qpel16_h_lowpass_l2_avx2(uint8_t *dst, uint8_t *src, uint8_t *src2, int dstStride, int src2Stride);\
+void ff_ ## OPNAME ## _h264_qpel16_v_lowpass_avx2(uint8_t *dst, uint8_t *src, int dstStride, int srcStride);\
+void ff_ ## OPNAME ## _h264_qpel16_hv2_lowpass_avx2(uint8_t *dst, int16_t *tmp, int dstStride);\
+static av_always_inline void ff_ ## OPNAME ## _h264_qpel16_hv_lowpass_avx2(uint8_t *dst, int16_t *tmp, uint8_t *src, int dstStride, int tmpStride, int srcStride){\
+    ff_put_h264_qpel16_hv1_lowpass_avx2(src, tmp, srcStride);\
+    ff_ ## OPNAME ## _h264_qpel16_hv2_lowpass_avx2(dst, tmp, dstStride);\
+}
+
+void ff_put_h264_qpel16_hv1_lowpass_avx2(uint8_t *src, int16_t *tmp, int srcStride);
+
+DEF_QPEL_AVX2(avg)
+DEF_QPEL_AVX2(put)
+
+#define ff_put_pixels16_l2_avx2 ff_put_pixels16_l2_mmxext
+#define ff_avg_pixels16_l2_avx2 ff_avg_pixels16_l2_mmxext
+
+H264_MC_V(put_, 16, avx2, 32)
+H264_MC_V(avg_, 16, avx2, 32)
+H264_MC_H(put_, 16, avx2, 32)
+H264_MC_H(avg_, 16, avx2, 32)
+H264_MC_HV(put_, 16, avx2, 32)
+H264_MC_HV(avg_, 16, avx2, 32)
+#endif /* HAVE_AVX2_EXTERNAL && ARCH_X86_64 */
+
 
 //10bit
 #define LUMA_MC_OP(OP, NUM, DEPTH, TYPE, OPT) \
@@ -530,6 +557,12 @@ QPEL16(mmxext)
         c->avg_h264_qpel_pixels_tab[1][x + y * 4] = avg_h264_qpel8_mc  ## x ## y ## _ ## CPU; \
     } while (0)
 
+#define H264_QPEL16_FUNCS(x, y, CPU)                                                          \
+    do {                                                                                      \
+        c->put_h264_qpel_pixels_tab[0][x + y * 4] = put_h264_qpel16_mc ## x ## y ## _ ## CPU; \
+        c->avg_h264_qpel_pixels_tab[0][x + y * 4] = avg_h264_qpel16_mc ## x ## y ## _ ## CPU; \
+    } while (0)
+
 #define H264_QPEL_FUNCS_10(x, y, CPU)                                                               \
     do {                                                                                            \
         c->put_h264_qpel_pixels_tab[0][x + y * 4] = ff_put_h264_qpel16_mc ## x ## y ## _10_ ## CPU; \
@@ -630,5 +663,27 @@ av_cold void ff_h264qpel_init_x86(H264QpelContext *c, int bit_depth)
             H264_QPEL_FUNCS_10(3, 0, sse2);
         }
     }
+
+#if HAVE_AVX2_EXTERNAL && ARCH_X86_64
+    if (EXTERNAL_AVX2(mm_flags)) {
+        if (!high_bit_depth) {
+            H264_QPEL16_FUNCS(1, 0, avx2);
+            H264_QPEL16_FUNCS(2, 0, avx2);
+            H264_QPEL16_FUNCS(3, 0, avx2);
+            H264_QPEL16_FUNCS(0, 1, avx2);
+            H264_QPEL16_FUNCS(1, 1, avx2);
+            H264_QPEL16_FUNCS(2, 1, avx2);
+            H264_QPEL16_FUNCS(3, 1, avx2);
+            H264_QPEL16_FUNCS(0, 2, avx2);
+            H264_QPEL16_FUNCS(1, 2, avx2);
+            H264_QPEL16_FUNCS(2, 2, avx2);
+            H264_QPEL16_FUNCS(3, 2, avx2);
+            H264_QPEL16_FUNCS(0, 3, avx2);
+            H264_QPEL16_FUNCS(1, 3, avx2);
+            H264_QPEL16_FUNCS(2, 3, avx2);
+            H264_QPEL16_FUNCS(3, 3, avx2);
+        }
+    }
+#endif
 #endif
 }
@@ -860,3 +860,197 @@ INIT_XMM ssse3
 QPEL16_H_LOWPASS_L2_OP put
 QPEL16_H_LOWPASS_L2_OP avg
 %endif
+
+%if HAVE_AVX2_EXTERNAL && ARCH_X86_64
+; A whole row of 16 pixels is filtered at once, as words in one ymm register.
+; The taps are read with unaligned loads instead of being shuffled into place,
+; since palignr cannot cross the 128-bit lanes.
+
+; %1 = row address, result packed into the 16 bytes of xmm0
+; m6 = pw_5, m7 = pw_16
+%macro FILT_H16_AVX2 1
+    vpmovzxbw     m0, [%1-2]
+    vpmovzxbw     m5, [%1+3]
+    vpmovzxbw     m1, [%1-1]
+    vpmovzxbw     m4, [%1+2]
+    vpmovzxbw     m2, [%1  ]
+    vpmovzxbw     m3, [%1+1]
+    paddw         m0, m5
+    paddw         m1, m4
+    paddw         m2, m3
+    psllw         m2, 2
+    psubw         m2, m1
+    paddw         m0, m7
+    pmullw        m2, m6
+    paddw         m0, m2
+    psraw         m0, 5
+    vextracti128 xmm1, m0, 1
+    vpackuswb    xmm0, xmm0, xmm1
+%endmacro
+
+; %1 = put/avg, %2 = destination row
+%macro OP16_AVX2 2
+%ifidn %1, avg
+    vpavgb       xmm0, xmm0, %2
+%endif
+    vmovdqu        %2, xmm0
+%endmacro
+
+%macro QPEL16_H_LOWPASS_OP_AVX2 1
+cglobal %1_h264_qpel16_h_lowpass, 4,5,8 ; dst, src, dstStride, srcStride
+    movsxdifnidn  r2, r2d
+    movsxdifnidn  r3, r3d
+    mov          r4d, 16
+    vpbroadcastd  m6, [pw_5]
+    vpbroadcastd  m7, [pw_16]
+.loop:
+    FILT_H16_AVX2 r1
+    OP16_AVX2     %1, [r0]
+    add           r1, r3
+    add           r0, r2
+    dec          r4d
+    jnz        .loop
+    RET
+
+cglobal %1_h264_qpel16_h_lowpass_l2, 5,6,8 ; dst, src, src2, dstStride, src2Stride
+    movsxdifnidn  r3, r3d
+    movsxdifnidn  r4, r4d
+    mov          r5d, 16
+    vpbroadcastd  m6, [pw_5]
+    vpbroadcastd  m7, [pw_16]
+.loop:
+    FILT_H16_AVX2 r1
+    vpavgb       xmm0, xmm0, [r2]
+    OP16_AVX2     %1, [r0]
+    add           r1, r3
+    add           r0, r3
+    add           r2, r4
+    dec          r5d
+    jnz        .loop
+    RET
+%endmacro
+
+; rows -2..3 around the output row in m0..m5, as words
+%macro LOAD_V16_AVX2 0
+    vpmovzxbw     m0, [r1]
+    vpmovzxbw     m1, [r1+r3]
+    lea           r1, [r1+2*r3]
+    vpmovzxbw     m2, [r1]
+    vpmovzxbw     m3, [r1+r3]
+    lea           r1, [r1+2*r3]
+    vpmovzxbw     m4, [r1]
+    add           r1, r3
+%endmacro
+
+; 6-tap filter of m0..m5 into m8 (with the rounding bias of m7 added),
+; then slide the window down by one row
+%macro FILT_V16_AVX2 0
+    vpmovzxbw     m5, [r1]
+    add           r1, r3
+    paddw         m8, m2, m3
+    paddw         m9, m1, m4
+    psllw         m8, 2
+    psubw         m8, m9
+    pmullw        m8, m6
+    paddw         m9, m0, m5
+    paddw         m9, m7
+    paddw         m8, m9
+    mova          m0, m1
+    mova          m1, m2
+    mova          m2, m3
+    mova          m3, m4
+    mova          m4, m5
+%endmacro
+
+%macro QPEL16_V_LOWPASS_OP_AVX2 1
+cglobal %1_h264_qpel16_v_lowpass, 4,5,10 ; dst, src, dstStride, srcStride
+    movsxdifnidn  r2, r2d
+    movsxdifnidn  r3, r3d
+    sub           r1, r3
+    sub           r1, r3
+    mov          r4d, 16
+    vpbroadcastd  m6, [pw_5]
+    vpbroadcastd  m7, [pw_16]
+    LOAD_V16_AVX2
+.loop:
+    FILT_V16_AVX2
+    psraw         m8, 5
+    vextracti128 xmm1, m8, 1
+    vpackuswb    xmm0, xmm8, xmm1
+    OP16_AVX2     %1, [r0]
+    add           r0, r2
+    dec          r4d
+    jnz        .loop
+    RET
+%endmacro
+
+; Vertical pass of the 2D filter: 16 rows of 24 words at a stride of 48 bytes,
+; holding the columns -2..21, in the layout of put_h264_qpel8or16_hv1_lowpass.
+; The second pass covers the columns 6..21 and overlaps the first one.
+%macro QPEL16_HV1_LOWPASS_OP_AVX2 0
+cglobal put_h264_qpel16_hv1_lowpass, 3,6,10 ; src, tmp, srcStride
+    movsxdifnidn  r2, r2d
+    mov           r5, r1
+    mov           r3, r2
+    lea           r4, [r2*2+2]
+    neg           r4
+    add           r4, r0
+    vpbroadcastd  m6, [pw_5]
+    vpbroadcastd  m7, [pw_16]
+    mov           r1, r4
+    LOAD_V16_AVX2
+%assign i 0
+%rep 16
+    FILT_V16_AVX2
+    movu  [r5+i*48], m8
+%assign i i+1
+%endrep
+    lea           r1, [r4+8]
+    LOAD_V16_AVX2
+%assign i 0
+%rep 16
+    FILT_V16_AVX2
+    movu  [r5+i*48+16], m8
+%assign i i+1
+%endrep
+    RET
+%endmacro
+
+; Horizontal pass of the 2D filter, from the output of hv1_lowpass.
+%macro QPEL16_HV2_LOWPASS_OP_AVX2 1
+cglobal %1_h264_qpel16_hv2_lowpass, 3,4,3 ; dst, tmp, dstStride
+    movsxdifnidn  r2, r2d
+    mov          r3d, 16
+.loop:
+    movu          m0, [r1]
+    movu          m1, [r1+2]
+    movu          m2, [r1+4]
+    paddw         m0, [r1+10]
+    paddw         m1, [r1+8]
+    paddw         m2, [r1+6]
+    psubw         m0, m1
+    psraw         m0, 2
+    psubw         m0, m1
+    paddw         m0, m2
+    psraw         m0, 2
+    paddw         m0, m2
+    psraw         m0, 6
+    vextracti128 xmm1, m0, 1
+    vpackuswb    xmm0, xmm0, xmm1
+    OP16_AVX2     %1, [r0]
+    add           r1, 48
+    add           r0, r2
+    dec          r3d
+    jnz        .loop
+    RET
+%endmacro
+
+INIT_YMM avx2
+QPEL16_H_LOWPASS_OP_AVX2 put
+QPEL16_H_LOWPASS_OP_AVX2 avg
+QPEL16_V_LOWPASS_OP_AVX2 put
+QPEL16_V_LOWPASS_OP_AVX2 avg
+QPEL16_HV1_LOWPASS_OP_AVX2
+QPEL16_HV2_LOWPASS_OP_AVX2 put
+QPEL16_HV2_LOWPASS_OP_AVX2 avg
+%endif ; HAVE_AVX2_EXTERNAL && ARCH_X86_64
@@ -54,6 +54,7 @@ void ff_h264_idct ## NUM ## _add ## REP ## _ ## DEPTH ## _ ## OPT       \
 IDCT_ADD_REP_FUNC(8, 4, 8, mmx)
 IDCT_ADD_REP_FUNC(8, 4, 8, mmxext)
 IDCT_ADD_REP_FUNC(8, 4, 8, sse2)
+IDCT_ADD_REP_FUNC(8, 4, 8, avx2)
 IDCT_ADD_REP_FUNC(8, 4, 10, sse2)
 IDCT_ADD_REP_FUNC(8, 4, 10, avx)
 IDCT_ADD_REP_FUNC(, 16, 8, mmx)
@@ -130,6 +131,9 @@ LF_IFUNC(v, chroma_intra, depth, avx)
 LF_FUNCS(uint8_t,   8)
 LF_FUNCS(uint16_t, 10)
 
+LF_FUNC(h, luma, 10, avx2)
+LF_FUNC(v, luma, 10, avx2)
+
 #if ARCH_X86_32 && HAVE_MMXEXT_EXTERNAL
 LF_FUNC(v8, luma, 8, mmxext)
 static void deblock_v_luma_8_mmxext(uint8_t *pix, int stride, int alpha,
@@ -292,6 +296,10 @@ av_cold void ff_h264dsp_init_x86(H264DSPContext *c, const int bit_depth,
                     c->h264_v_loop_filter_luma_intra = ff_deblock_v_luma_intra_8_avx;
                     c->h264_h_loop_filter_luma_intra = ff_deblock_h_luma_intra_8_avx;
                 }
+#if ARCH_X86_64
+                if (EXTERNAL_AVX2(mm_flags))
+                    c->h264_idct8_add4 = ff_h264_idct8_add4_8_avx2;
+#endif /* ARCH_X86_64 */
             }
         }
     } else if (bit_depth == 10) {
@@ -368,6 +376,12 @@ av_cold void ff_h264dsp_init_x86(H264DSPContext *c, const int bit_depth,
                     c->h264_h_loop_filter_luma_intra   = ff_deblock_h_luma_intra_10_avx;
 #endif /* HAVE_ALIGNED_STACK */
                 }
+#if ARCH_X86_64
+                if (EXTERNAL_AVX2(mm_flags)) {
+                    c->h264_v_loop_filter_luma = ff_deblock_v_luma_10_avx2;
+                    c->h264_h_loop_filter_luma = ff_deblock_h_luma_10_avx2;
+                }
+#endif /* ARCH_X86_64 */
             }
         }
     }
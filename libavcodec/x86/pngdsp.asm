@@ -1,5 +1,5 @@
 ;******************************************************************************
-;* x86 optimizations for PNG decoding
+;* x86 optimizations for PNG encoding and decoding
 ;*
 ;* Copyright (c) 2008 Loren Merritt <lorenm@u.washington.edu>
 ;* Copyright (c) 2012 Ronald S. Bultje <rsbultje@gmail.com>
@@ -25,6 +25,7 @@
 
 SECTION_RODATA
 
+cextern pb_1
 cextern pw_255
 
 SECTION_TEXT
@@ -91,10 +92,8 @@ ADD_BYTES_FN 2
 
 %macro ADD_PAETH_PRED_FN 1
 cglobal add_png_paeth_prediction, 5, 7, %1, dst, src, top, w, bpp, end, cntr
-%if ARCH_X86_64
-    movsxd            bppq, bppd
-    movsxd              wq, wd
-%endif
+    movsxdifnidn      bppq, bppd
+    movsxdifnidn        wq, wd
     lea               endq, [dstq+wq-(mmsize/2-1)]
     sub               topq, dstq
     sub               srcq, dstq
@@ -171,3 +170,151 @@ ADD_PAETH_PRED_FN 0
 
 INIT_MMX ssse3
 ADD_PAETH_PRED_FN 0
+
+; the encoder filters do not depend on their own output, so the last
+; (partial) vector of a row is done by recomputing an overlapping one
+; instead of a scalar loop; w has to be at least one vector
+
+;------------------------------------------------------------------------------
+; void ff_sub_png_avg_prediction(uint8_t *dst, const uint8_t *src,
+;                                const uint8_t *top, int w, int bpp)
+;------------------------------------------------------------------------------
+%macro SUB_AVG 0
+    movu                m0, [dstq+bppq]
+    movu                m1, [topq+dstq]
+    mova                m2, m0
+    pxor                m2, m1
+    pand                m2, m4
+    pavgb               m0, m1
+    psubb               m0, m2          ; (left + top) >> 1
+    movu                m1, [srcq+dstq]
+    psubb               m1, m0
+    movu            [dstq], m1
+%endmacro
+
+INIT_XMM sse2
+cglobal sub_png_avg_prediction, 5, 5, 5, dst, src, top, w, bpp
+    movsxdifnidn      bppq, bppd
+    movsxdifnidn        wq, wd
+    mova                m4, [pb_1]
+    sub               topq, dstq
+    sub               srcq, dstq
+    lea                 wq, [dstq+wq-mmsize]
+    neg               bppq
+    add               bppq, srcq        ; left - dst
+    jmp .first
+.loop:
+    SUB_AVG
+    add               dstq, mmsize
+.first:
+    cmp               dstq, wq
+    jb .loop
+    mov               dstq, wq
+    SUB_AVG
+    RET
+
+;------------------------------------------------------------------------------
+; void ff_sub_png_paeth_prediction(uint8_t *dst, const uint8_t *src,
+;                                  const uint8_t *top, int w, int bpp)
+;------------------------------------------------------------------------------
+%macro SUB_PAETH 0
+    movh                m0, [leftq+dstq]
+    movh                m1, [topq+dstq]
+    movh                m2, [tlq+dstq]
+    punpcklbw           m0, m7          ; a
+    punpcklbw           m1, m7          ; b
+    punpcklbw           m2, m7          ; c
+    mova                m3, m1
+    psubw               m3, m2          ; p = b - c
+    mova                m4, m0
+    psubw               m4, m2          ; a - c
+    mova                m5, m3
+    paddw               m5, m4
+    ABS1                m3, m6          ; pa
+    ABS1                m4, m6          ; pb
+    ABS1                m5, m6          ; pc
+    mova                m6, m3
+    pcmpgtw             m6, m4
+    pcmpgtw             m3, m5
+    por                 m3, m6          ; pa > pb || pa > pc
+    pcmpgtw             m4, m5          ; pb > pc
+    pand                m2, m4
+    pandn               m4, m1
+    por                 m2, m4          ; pb > pc ? c : b
+    pand                m2, m3
+    pandn               m3, m0
+    por                 m2, m3          ; predictor
+    packuswb            m2, m2
+    movh                m0, [srcq+dstq]
+    psubb               m0, m2
+    movh            [dstq], m0
+%endmacro
+
+INIT_XMM sse2
+cglobal sub_png_paeth_prediction, 5, 7, 8, dst, src, top, w, bpp, left, tl
+    movsxdifnidn      bppq, bppd
+    movsxdifnidn        wq, wd
+    pxor                m7, m7
+    sub               topq, dstq
+    sub               srcq, dstq
+    mov              leftq, srcq
+    sub              leftq, bppq
+    mov                tlq, topq
+    sub                tlq, bppq
+    lea                 wq, [dstq+wq-mmsize/2]
+    jmp .first
+.loop:
+    SUB_PAETH
+    add               dstq, mmsize/2
+.first:
+    cmp               dstq, wq
+    jb .loop
+    mov               dstq, wq
+    SUB_PAETH
+    RET
+
+;------------------------------------------------------------------------------
+; int ff_png_filter_cost(const uint8_t *buf, int size)
+;------------------------------------------------------------------------------
+INIT_XMM sse2
+cglobal png_filter_cost, 2, 4, 4, buf, size, sum, tmp
+    movsxdifnidn     sizeq, sized
+    pxor                m2, m2
+    pxor                m3, m3
+    xor               sumd, sumd
+    add               bufq, sizeq
+    neg              sizeq
+    jmp .end_v
+.loop_v:
+    movu                m0, [bufq+sizeq]
+    pxor                m1, m1
+    pcmpgtb             m1, m0
+    pxor                m0, m1
+    psubb               m0, m1          ; |x|, 0x80 becomes 128
+    psadbw              m0, m2
+    paddq               m3, m0
+    add              sizeq, mmsize
+.end_v:
+    cmp              sizeq, -mmsize
+    jle .loop_v
+
+    ; scalar loop for leftover
+    jmp .end_s
+.loop_s:
+    movsx             tmpd, byte [bufq+sizeq]
+    test              tmpd, tmpd
+    jns .pos
+    neg               tmpd
+.pos:
+    add               sumd, tmpd
+    inc              sizeq
+.end_s:
+    test             sizeq, sizeq
+    jl .loop_s
+
+    movhlps             m0, m3
+    paddq               m3, m0
+    movd              tmpd, m3
+    add               sumd, tmpd
+    mov                eax, sumd
+    RET
@@ -22,6 +22,7 @@
 #include "libavutil/attributes.h"
 #include "libavutil/common.h"
 #include "libavutil/x86/cpu.h"
+#include "libavcodec/png.h"
 #include "libavcodec/pngdsp.h"
 
 void ff_add_png_paeth_prediction_mmxext(uint8_t *dst, uint8_t *src,
@@ -32,6 +33,32 @@ void ff_add_bytes_l2_mmx (uint8_t *dst, uint8_t *src1,
                           uint8_t *src2, int w);
 void ff_add_bytes_l2_sse2(uint8_t *dst, uint8_t *src1,
                           uint8_t *src2, int w);
+void ff_sub_png_avg_prediction_sse2(uint8_t *dst, const uint8_t *src,
+                                    const uint8_t *top, int w, int bpp);
+void ff_sub_png_paeth_prediction_sse2(uint8_t *dst, const uint8_t *src,
+                                      const uint8_t *top, int w, int bpp);
+int ff_png_filter_cost_sse2(const uint8_t *buf, int size);
+
+#if HAVE_YASM
+/* the SIMD filters need rows of at least one vector */
+static void sub_png_avg_prediction_sse2(uint8_t *dst, const uint8_t *src,
+                                        const uint8_t *top, int w, int bpp)
+{
+    if (w >= 16)
+        ff_sub_png_avg_prediction_sse2(dst, src, top, w, bpp);
+    else
+        ff_sub_png_avg_prediction(dst, src, top, w, bpp);
+}
+
+static void sub_png_paeth_prediction_sse2(uint8_t *dst, const uint8_t *src,
+                                          const uint8_t *top, int w, int bpp)
+{
+    if (w >= 8)
+        ff_sub_png_paeth_prediction_sse2(dst, src, top, w, bpp);
+    else
+        ff_sub_png_paeth_prediction(dst, src, top, w, bpp);
+}
+#endif /* HAVE_YASM */
 
 av_cold void ff_pngdsp_init_x86(PNGDSPContext *dsp)
 {
@@ -43,8 +70,14 @@ av_cold void ff_pngdsp_init_x86(PNGDSPContext *dsp)
 #endif
     if (EXTERNAL_MMXEXT(flags))
         dsp->add_paeth_prediction = ff_add_png_paeth_prediction_mmxext;
-    if (EXTERNAL_SSE2(flags))
+    if (EXTERNAL_SSE2(flags)) {
         dsp->add_bytes_l2         = ff_add_bytes_l2_sse2;
+#if HAVE_YASM
+        dsp->sub_avg_prediction   = sub_png_avg_prediction_sse2;
+        dsp->sub_paeth_prediction = sub_png_paeth_prediction_sse2;
+        dsp->filter_cost          = ff_png_filter_cost_sse2;
+#endif
+    }
     if (EXTERNAL_SSSE3(flags))
         dsp->add_paeth_prediction = ff_add_png_paeth_prediction_ssse3;
 }
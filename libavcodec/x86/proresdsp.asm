@@ -324,3 +324,82 @@ idct_put_fn 16
 %endif
 
 %endif
+
+SECTION_RODATA 32
+
+quant_ac_mask: dw 0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+quant_pw_1:    times 16 dw 1
+
+SECTION .text
+
+; %1 = byte offset of the coefficients, %2 = optional mask for the remainders
+; m6 = 0, m7 = sum of the remainders
+%macro QUANT 1-2
+    movu        m0, [srcq+%1]
+    psraw       m1, m0, 15
+    pxor        m0, m1
+    psubw       m0, m1              ; |src|
+    movu        m2, [qmatq+%1]
+    punpcklwd   m3, m0, m6
+    punpckhwd   m4, m0, m6
+    cvtdq2ps    m3, m3
+    cvtdq2ps    m4, m4
+    punpcklwd   m5, m2, m6
+    cvtdq2ps    m5, m5
+    divps       m3, m5
+    punpckhwd   m5, m2, m6
+    cvtdq2ps    m5, m5
+    divps       m4, m5
+    cvttps2dq   m3, m3
+    cvttps2dq   m4, m4
+    packssdw    m3, m4              ; |src| / qmat
+    pmullw      m2, m3
+    psubw       m0, m2              ; |src| % qmat
+%if %0 > 1
+    pand        m0, %2
+%endif
+    pmaddwd     m0, [quant_pw_1]
+    paddd       m7, m0
+    pxor        m3, m1
+    psubw       m3, m1
+    movu [dstq+%1], m3
+%endmacro
+
+; int ff_prores_quantize(int16_t *dst, const int16_t *src,
+;                        const int16_t *qmat, int nb_blocks)
+; The quotients are exact: both operands are below 2^16, so the single
+; precision division cannot round up to the next integer.
+%macro PRORES_QUANTIZE 0
+cglobal prores_quantize, 4, 4, 8, dst, src, qmat, nb_blocks
+    pxor        m6, m6
+    pxor        m7, m7
+.loop:
+    QUANT       0, [quant_ac_mask]
+%assign i mmsize
+%rep 128 / mmsize - 1
+    QUANT       i
+%assign i i+mmsize
+%endrep
+    add       dstq, 128
+    add       srcq, 128
+    dec nb_blocksd
+    jg .loop
+
+%if mmsize == 32
+    vextracti128 xmm0, ymm7, 1
+    paddd     xmm7, xmm0
+%endif
+    pshufd    xmm0, xmm7, 0xE
+    paddd     xmm7, xmm0
+    pshufd    xmm0, xmm7, 0x1
+    paddd     xmm7, xmm0
+    movd       eax, xmm7
+    RET
+%endmacro
+
+INIT_XMM sse2
+PRORES_QUANTIZE
+%if HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+PRORES_QUANTIZE
+%endif
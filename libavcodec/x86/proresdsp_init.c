@@ -22,6 +22,7 @@
 
 #include "libavutil/attributes.h"
 #include "libavutil/x86/cpu.h"
+#include "libavcodec/dct.h"
 #include "libavcodec/dsputil.h"
 #include "libavcodec/proresdsp.h"
 
@@ -31,12 +32,40 @@ void ff_prores_idct_put_10_sse4(uint16_t *dst, int linesize,
                                 int16_t *block, const int16_t *qmat);
 void ff_prores_idct_put_10_avx (uint16_t *dst, int linesize,
                                 int16_t *block, const int16_t *qmat);
+int ff_prores_quantize_sse2(int16_t *dst, const int16_t *src,
+                            const int16_t *qmat, int nb_blocks);
+int ff_prores_quantize_avx2(int16_t *dst, const int16_t *src,
+                            const int16_t *qmat, int nb_blocks);
+
+#if CONFIG_PRORES_KS_ENCODER && HAVE_SSE2_INLINE && ARCH_X86_64
+static void prores_fdct_sse2(const uint16_t *src, int linesize, int16_t *block)
+{
+    int y;
+
+    for (y = 0; y < 8; y++) {
+        memcpy(block + y * 8, src, 8 * sizeof(*src));
+        src += linesize >> 1;
+    }
+    ff_jpeg_fdct_islow_10_sse2(block);
+}
+#endif
 
 av_cold void ff_proresdsp_x86_init(ProresDSPContext *dsp, AVCodecContext *avctx)
 {
-#if ARCH_X86_64
     int flags = av_get_cpu_flags();
 
+#if CONFIG_PRORES_KS_ENCODER
+#if HAVE_SSE2_INLINE && ARCH_X86_64
+    if (INLINE_SSE2(flags))
+        dsp->fdct     = prores_fdct_sse2;
+#endif
+    if (EXTERNAL_SSE2(flags))
+        dsp->quantize = ff_prores_quantize_sse2;
+    if (EXTERNAL_AVX2(flags))
+        dsp->quantize = ff_prores_quantize_avx2;
+#endif /* CONFIG_PRORES_KS_ENCODER */
+
+#if ARCH_X86_64 && (CONFIG_PRORES_DECODER || CONFIG_PRORES_LGPL_DECODER)
     if(avctx->flags & CODEC_FLAG_BITEXACT)
         return;
 
@@ -0,0 +1,74 @@
+;******************************************************************************
+;* SIMD start code search
+;*
+;* This file is part of FFmpeg.
+;*
+;* FFmpeg is free software; you can redistribute it and/or
+;* modify it under the terms of the GNU Lesser General Public
+;* License as published by the Free Software Foundation; either
+;* version 2.1 of the License, or (at your option) any later version.
+;*
+;* FFmpeg is distributed in the hope that it will be useful,
+;* but WITHOUT ANY WARRANTY; without even the implied warranty of
+;* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+;* Lesser General Public License for more details.
+;*
+;* You should have received a copy of the GNU Lesser General Public
+;* License along with FFmpeg; if not, write to the Free Software
+;* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+;******************************************************************************
+
+%include "libavutil/x86/x86util.asm"
+
+SECTION_TEXT
+
+; int ff_startcode_find_candidate(const uint8_t *buf, int size)
+%macro STARTCODE_FIND_CANDIDATE 0
+cglobal startcode_find_candidate, 2, 4, 3, buf, size, i, mask
+    movsxdifnidn sizeq, sized
+    xor          iq, iq
+    pxor         m0, m0
+    ; the vector loop reads mmsize + 1 bytes
+    sub       sizeq, mmsize
+    jmp .loop_end
+.loop:
+    movu         m1, [bufq+iq]
+    movu         m2, [bufq+iq+1]
+    pcmpeqb      m1, m0
+    pcmpeqb      m2, m0
+    pand         m1, m2
+    pmovmskb  maskd, m1
+    test      maskd, maskd
+    jnz .found
+    add          iq, mmsize
+.loop_end:
+    cmp          iq, sizeq
+    jl .loop
+
+    add       sizeq, mmsize - 1
+    jmp .tail_end
+.tail:
+    cmp   word [bufq+iq], 0
+    je .done
+    inc          iq
+.tail_end:
+    cmp          iq, sizeq
+    jl .tail
+    lea         eax, [sizeq+1]
+    RET
+
+.found:
+    bsf       maskd, maskd
+    add          iq, maskq
+.done:
+    mov         eax, id
+    RET
+%endmacro
+
+INIT_XMM sse2
+STARTCODE_FIND_CANDIDATE
+
+%if HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+STARTCODE_FIND_CANDIDATE
+%endif
@@ -0,0 +1,106 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/x86/asm.h"
+#include "libavutil/x86/cpu.h"
+#include "libavcodec/synth_filter.h"
+
+#if HAVE_SSE_INLINE
+/* Window 4 consecutive outputs of each quarter, starting at output i. The
+ * history is circular, the block of 32 samples used by the window step j
+ * starting at (offset + j) & 511. a, b, c and d are the byte offsets of the
+ * samples read for each quarter in the block, the first and last quarters
+ * going backwards. */
+#define SYNTH_WINDOW4(i, a, b, c, d)                                           \
+    do {                                                                       \
+        x86_reg o = offset, w = -512 * 4, p;                                   \
+                                                                               \
+        __asm__ volatile (                                                     \
+            "movups            %3, %%xmm0       \n\t"                          \
+            "movups            %4, %%xmm1       \n\t"                          \
+            "xorps        %%xmm2, %%xmm2        \n\t"                          \
+            "xorps        %%xmm3, %%xmm3        \n\t"                          \
+            "1:                                 \n\t"                          \
+            "lea       (%7,%0,4), %2            \n\t"                          \
+            "movups    "#a"(%2), %%xmm4         \n\t"                          \
+            "movups    "#b"(%2), %%xmm5         \n\t"                          \
+            "movups    "#c"(%2), %%xmm6         \n\t"                          \
+            "movups    "#d"(%2), %%xmm7         \n\t"                          \
+            "shufps $0x1b, %%xmm4, %%xmm4       \n\t"                          \
+            "shufps $0x1b, %%xmm7, %%xmm7       \n\t"                          \
+            "mulps       (%8,%1), %%xmm4        \n\t"                          \
+            "mulps     64(%8,%1), %%xmm5        \n\t"                          \
+            "mulps    128(%8,%1), %%xmm6        \n\t"                          \
+            "mulps    192(%8,%1), %%xmm7        \n\t"                          \
+            "subps        %%xmm4, %%xmm0        \n\t"                          \
+            "addps        %%xmm5, %%xmm1        \n\t"                          \
+            "addps        %%xmm6, %%xmm2        \n\t"                          \
+            "addps        %%xmm7, %%xmm3        \n\t"                          \
+            "add             $64, %0            \n\t"                          \
+            "and            $511, %0            \n\t"                          \
+            "add            $256, %1            \n\t"                          \
+            "jl               1b                \n\t"                          \
+            "movss             %9, %%xmm4       \n\t"                          \
+            "shufps   $0, %%xmm4, %%xmm4        \n\t"                          \
+            "mulps        %%xmm4, %%xmm0        \n\t"                          \
+            "mulps        %%xmm4, %%xmm1        \n\t"                          \
+            "movups       %%xmm0, %5            \n\t"                          \
+            "movups       %%xmm1, %6            \n\t"                          \
+            "movups       %%xmm2, %3            \n\t"                          \
+            "movups       %%xmm3, %4            \n\t"                          \
+            : "+r"(o), "+r"(w), "=&r"(p),                                      \
+              "+m"(*(xmm_reg *)(synth_buf2 + i)),                              \
+              "+m"(*(xmm_reg *)(synth_buf2 + i + 16)),                         \
+              "=m"(*(xmm_reg *)(out + i)), "=m"(*(xmm_reg *)(out + i + 16))    \
+            : "r"(synth_buf_ptr), "r"(window + 512 + i), "m"(scale)            \
+            : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4",        \
+                           "%xmm5", "%xmm6", "%xmm7",) "memory"                \
+        );                                                                     \
+    } while (0)
+
+/* Same as the C version, the 4 outputs of each quarter computed at once
+ * are summed in the same order, so the output is identical. */
+static void synth_filter_sse(FFTContext *imdct,
+                             float *synth_buf_ptr, int *synth_buf_offset,
+                             float synth_buf2[32], const float window[512],
+                             float out[32], const float in[32], float scale)
+{
+    int offset = *synth_buf_offset;
+
+    imdct->imdct_half(imdct, synth_buf_ptr + offset, in);
+
+    SYNTH_WINDOW4( 0, 48,  0,  64, 112);
+    SYNTH_WINDOW4( 4, 32, 16,  80,  96);
+    SYNTH_WINDOW4( 8, 16, 32,  96,  80);
+    SYNTH_WINDOW4(12,  0, 48, 112,  64);
+
+    *synth_buf_offset = (offset - 32) & 511;
+}
+#endif /* HAVE_SSE_INLINE */
+
+av_cold void ff_synth_filter_init_x86(SynthFilterContext *c)
+{
+    int cpu_flags = av_get_cpu_flags();
+
+#if HAVE_SSE_INLINE
+    if (INLINE_SSE(cpu_flags))
+        c->synth_filter_float = synth_filter_sse;
+#endif
+}
@@ -0,0 +1,165 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/mem.h"
+#include "libavutil/x86/asm.h"
+#include "libavutil/x86/cpu.h"
+#include "libavcodec/v210enc.h"
+
+#if HAVE_SSSE3_INLINE
+/*
+ * Six luma and three samples of each chroma make four v210 words.
+ * The samples are clipped, shifted into place within their 16-bit lanes by
+ * a multiplication, then moved to their bytes in the words by pshufb.
+ * The constants are repeated for the two lanes of AVX2.
+ */
+DECLARE_ALIGNED(32, static const int16_t, v210_enc_min)[16] = {
+    4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4
+};
+DECLARE_ALIGNED(32, static const int16_t, v210_enc_max)[16] = {
+    1019, 1019, 1019, 1019, 1019, 1019, 1019, 1019,
+    1019, 1019, 1019, 1019, 1019, 1019, 1019, 1019
+};
+/* y0 y1 y2 y3 y4 y5 */
+DECLARE_ALIGNED(32, static const int16_t, v210_enc_luma_mult)[16] = {
+    4, 1, 16, 4, 1, 16, 0, 0, 4, 1, 16, 4, 1, 16, 0, 0
+};
+DECLARE_ALIGNED(32, static const int8_t, v210_enc_luma_shuf)[32] = {
+    -1, 0, 1, -1, 2, 3, 4, 5, -1, 6, 7, -1, 8, 9, 10, 11,
+    -1, 0, 1, -1, 2, 3, 4, 5, -1, 6, 7, -1, 8, 9, 10, 11
+};
+/* u0 u1 u2 u3 v0 v1 v2 v3 */
+DECLARE_ALIGNED(32, static const int16_t, v210_enc_chroma_mult)[16] = {
+    1, 4, 16, 0, 16, 1, 4, 0, 1, 4, 16, 0, 16, 1, 4, 0
+};
+DECLARE_ALIGNED(32, static const int8_t, v210_enc_chroma_shuf)[32] = {
+    0, 1, 8, 9, -1, 2, 3, -1, 10, 11, 4, 5, -1, 12, 13, -1,
+    0, 1, 8, 9, -1, 2, 3, -1, 10, 11, 4, 5, -1, 12, 13, -1
+};
+
+static void v210_planar_pack_10_ssse3(const uint16_t *y, const uint16_t *u,
+                                      const uint16_t *v, uint8_t *dst,
+                                      ptrdiff_t width)
+{
+    x86_reg i = -width;
+
+    if (!width)
+        return;
+
+    y += width;
+    u += width >> 1;
+    v += width >> 1;
+
+    __asm__ volatile (
+        "movdqa            %5, %%xmm2       \n\t"
+        "movdqa            %6, %%xmm3       \n\t"
+        "1:                                 \n\t"
+        "movdqu    (%1,%0,2), %%xmm0        \n\t"
+        "movq        (%2,%0), %%xmm1        \n\t"
+        "movhps      (%3,%0), %%xmm1        \n\t"
+        "pmaxsw        %%xmm2, %%xmm0       \n\t"
+        "pminsw        %%xmm3, %%xmm0       \n\t"
+        "pmaxsw        %%xmm2, %%xmm1       \n\t"
+        "pminsw        %%xmm3, %%xmm1       \n\t"
+        "pmullw            %7, %%xmm0       \n\t"
+        "pshufb            %8, %%xmm0       \n\t"
+        "pmullw            %9, %%xmm1       \n\t"
+        "pshufb           %10, %%xmm1       \n\t"
+        "por           %%xmm1, %%xmm0       \n\t"
+        "movdqu        %%xmm0, (%4)         \n\t"
+        "add              $16, %4           \n\t"
+        "add               $6, %0           \n\t"
+        "jl                1b               \n\t"
+        : "+r"(i), "+r"(y), "+r"(u), "+r"(v), "+r"(dst)
+        : "m"(v210_enc_min[0]), "m"(v210_enc_max[0]),
+          "m"(v210_enc_luma_mult[0]), "m"(v210_enc_luma_shuf[0]),
+          "m"(v210_enc_chroma_mult[0]), "m"(v210_enc_chroma_shuf[0])
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",) "memory"
+    );
+}
+#endif /* HAVE_SSSE3_INLINE */
+
+#if HAVE_AVX2_INLINE
+/* two groups of six luma samples per iteration, one in each lane */
+static void v210_planar_pack_10_avx2(const uint16_t *y, const uint16_t *u,
+                                     const uint16_t *v, uint8_t *dst,
+                                     ptrdiff_t width)
+{
+    x86_reg i = -width;
+
+    if (!width)
+        return;
+
+    y += width;
+    u += width >> 1;
+    v += width >> 1;
+
+    __asm__ volatile (
+        "vmovdqa           %5, %%ymm2                   \n\t"
+        "vmovdqa           %6, %%ymm3                   \n\t"
+        "1:                                             \n\t"
+        "vmovdqu   (%1,%0,2), %%xmm0                    \n\t"
+        "vinserti128 $1, 12(%1,%0,2), %%ymm0, %%ymm0    \n\t"
+        "vmovq       (%2,%0), %%xmm1                    \n\t"
+        "vmovhps     (%3,%0), %%xmm1, %%xmm1            \n\t"
+        "vmovq      6(%2,%0), %%xmm4                    \n\t"
+        "vmovhps    6(%3,%0), %%xmm4, %%xmm4            \n\t"
+        "vinserti128 $1, %%xmm4, %%ymm1, %%ymm1         \n\t"
+        "vpmaxsw       %%ymm2, %%ymm0, %%ymm0           \n\t"
+        "vpminsw       %%ymm3, %%ymm0, %%ymm0           \n\t"
+        "vpmaxsw       %%ymm2, %%ymm1, %%ymm1           \n\t"
+        "vpminsw       %%ymm3, %%ymm1, %%ymm1           \n\t"
+        "vpmullw           %7, %%ymm0, %%ymm0           \n\t"
+        "vpshufb           %8, %%ymm0, %%ymm0           \n\t"
+        "vpmullw           %9, %%ymm1, %%ymm1           \n\t"
+        "vpshufb          %10, %%ymm1, %%ymm1           \n\t"
+        "vpor          %%ymm1, %%ymm0, %%ymm0           \n\t"
+        "vmovdqu       %%ymm0, (%4)                     \n\t"
+        "add              $32, %4                       \n\t"
+        "add              $12, %0                       \n\t"
+        "jl                1b                           \n\t"
+        "vzeroupper                                     \n\t"
+        : "+r"(i), "+r"(y), "+r"(u), "+r"(v), "+r"(dst)
+        : "m"(v210_enc_min[0]), "m"(v210_enc_max[0]),
+          "m"(v210_enc_luma_mult[0]), "m"(v210_enc_luma_shuf[0]),
+          "m"(v210_enc_chroma_mult[0]), "m"(v210_enc_chroma_shuf[0])
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4",)
+          "memory"
+    );
+}
+#endif /* HAVE_AVX2_INLINE */
+
+av_cold void ff_v210enc_init_x86(V210EncContext *s)
+{
+    int cpu_flags = av_get_cpu_flags();
+
+#if HAVE_SSSE3_INLINE
+    if (INLINE_SSSE3(cpu_flags)) {
+        s->pack_line_10  = v210_planar_pack_10_ssse3;
+        s->sample_factor = 6;
+    }
+#endif
+#if HAVE_AVX2_INLINE
+    if (INLINE_AVX2(cpu_flags)) {
+        s->pack_line_10  = v210_planar_pack_10_avx2;
+        s->sample_factor = 12;
+    }
+#endif
+}
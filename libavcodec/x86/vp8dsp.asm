@@ -852,6 +852,151 @@ FILTER_BILINEAR_SSSE3 4
 INIT_XMM ssse3
 FILTER_BILINEAR_SSSE3 8
 
+%if HAVE_AVX2_EXTERNAL && ARCH_X86_64
+; 16-pixel wide MC: the low lane of each ymm register works on pixels 0-7
+; and the high lane on pixels 8-15, with the SSSE3 shuffles and taps
+; duplicated in both lanes.
+
+; %1=register, %2=address of the first of the 16 pixels
+%macro LOAD_ROW16_AVX2 2
+    vbroadcasti128 %1, [%2]
+    vinserti128    %1, %1, [%2+8], 1
+%endmacro
+
+; %1=register holding 8 words per lane
+%macro STORE_ROW16_AVX2 1
+    packuswb  %1, %1
+    vpermq    %1, %1, 0x08
+    vextracti128 [dstq], %1, 0
+%endmacro
+
+INIT_YMM avx2
+cglobal put_vp8_epel16_h6, 6, 6 + npicregs, 10, dst, dststride, src, srcstride, height, mx, picreg
+    lea      mxd, [mxq*3]
+    vbroadcasti128 m3, [filter_h6_shuf2]
+    vbroadcasti128 m4, [filter_h6_shuf3]
+    vbroadcasti128 m8, [filter_h6_shuf1]
+    vpbroadcastd   m9, [pw_256]
+%ifdef PIC
+    lea  picregq, [sixtap_filter_hb_m]
+%endif
+    vbroadcasti128 m5, [sixtap_filter_hb+mxq*8-48] ; set up 6tap filter in bytes
+    vbroadcasti128 m6, [sixtap_filter_hb+mxq*8-32]
+    vbroadcasti128 m7, [sixtap_filter_hb+mxq*8-16]
+
+.nextrow:
+    LOAD_ROW16_AVX2 m0, srcq-2
+    pshufb    m1, m0, m3
+    pshufb    m2, m0, m4
+    pshufb    m0, m8
+    pmaddubsw m0, m5
+    pmaddubsw m1, m6
+    pmaddubsw m2, m7
+    paddsw    m0, m1
+    paddsw    m0, m2
+    pmulhrsw  m0, m9
+    STORE_ROW16_AVX2 m0
+
+    ; go to next line
+    add     dstq, dststrideq
+    add     srcq, srcstrideq
+    dec  heightd            ; next row
+    jg .nextrow
+    RET
+
+cglobal put_vp8_epel16_v6, 7, 7, 12, dst, dststride, src, srcstride, height, picreg, my
+    lea      myd, [myq*3]
+%ifdef PIC
+    lea  picregq, [sixtap_filter_hb_m]
+%endif
+    lea      myq, [sixtap_filter_hb+myq*8]
+    vbroadcasti128 m8,  [myq-48]
+    vbroadcasti128 m9,  [myq-32]
+    vbroadcasti128 m10, [myq-16]
+    vpbroadcastd   m11, [pw_256]
+
+    ; read 5 lines
+    sub     srcq, srcstrideq
+    sub     srcq, srcstrideq
+    LOAD_ROW16_AVX2 m0, srcq
+    LOAD_ROW16_AVX2 m1, srcq+srcstrideq
+    LOAD_ROW16_AVX2 m2, srcq+srcstrideq*2
+    lea     srcq, [srcq+srcstrideq*2]
+    add     srcq, srcstrideq
+    LOAD_ROW16_AVX2 m3, srcq
+    LOAD_ROW16_AVX2 m4, srcq+srcstrideq
+
+.nextrow:
+    LOAD_ROW16_AVX2 m5, srcq+srcstrideq*2 ; read new row
+    punpcklbw m6, m0, m5
+    punpcklbw m7, m1, m2
+    pmaddubsw m6, m8
+    pmaddubsw m7, m9
+    paddsw    m6, m7
+    punpcklbw m7, m3, m4
+    pmaddubsw m7, m10
+    paddsw    m6, m7
+    pmulhrsw  m6, m11
+    STORE_ROW16_AVX2 m6
+    mova      m0, m1
+    mova      m1, m2
+    mova      m2, m3
+    mova      m3, m4
+    mova      m4, m5
+
+    ; go to next line
+    add      dstq, dststrideq
+    add      srcq, srcstrideq
+    dec   heightd                          ; next row
+    jg .nextrow
+    RET
+
+cglobal put_vp8_bilinear16_v, 7, 7, 5, dst, dststride, src, srcstride, height, picreg, my
+    shl      myd, 4
+%ifdef PIC
+    lea  picregq, [bilinear_filter_vb_m]
+%endif
+    pxor      m4, m4
+    vbroadcasti128 m3, [bilinear_filter_vb+myq-16]
+    LOAD_ROW16_AVX2 m0, srcq
+.nextrow:
+    add     srcq, srcstrideq
+    LOAD_ROW16_AVX2 m1, srcq
+    punpcklbw m0, m1
+    pmaddubsw m0, m3
+    psraw     m0, 2
+    pavgw     m0, m4
+    STORE_ROW16_AVX2 m0
+    mova      m0, m1
+
+    add     dstq, dststrideq
+    dec  heightd
+    jg .nextrow
+    RET
+
+cglobal put_vp8_bilinear16_h, 6, 6 + npicregs, 5, dst, dststride, src, srcstride, height, mx, picreg
+    shl      mxd, 4
+%ifdef PIC
+    lea  picregq, [bilinear_filter_vb_m]
+%endif
+    pxor      m4, m4
+    vbroadcasti128 m2, [filter_h2_shuf]
+    vbroadcasti128 m3, [bilinear_filter_vb+mxq-16]
+.nextrow:
+    LOAD_ROW16_AVX2 m0, srcq
+    pshufb    m0, m2
+    pmaddubsw m0, m3
+    psraw     m0, 2
+    pavgw     m0, m4
+    STORE_ROW16_AVX2 m0
+
+    add     dstq, dststrideq
+    add     srcq, srcstrideq
+    dec  heightd
+    jg .nextrow
+    RET
+%endif ; HAVE_AVX2_EXTERNAL && ARCH_X86_64
+
 INIT_MMX mmx
 cglobal put_vp8_pixels8, 5, 5, 0, dst, dststride, src, srcstride, height
 .nextrow:
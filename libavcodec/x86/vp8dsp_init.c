@@ -230,6 +230,24 @@ HVBILIN(ssse3, 8,  4,  8)
 HVBILIN(ssse3, 8,  8, 16)
 HVBILIN(ssse3, 8, 16, 16)
 
+#if HAVE_AVX2_EXTERNAL && ARCH_X86_64
+void ff_put_vp8_epel16_h6_avx2     (uint8_t *dst, ptrdiff_t dststride,
+                                    uint8_t *src, ptrdiff_t srcstride,
+                                    int height, int mx, int my);
+void ff_put_vp8_epel16_v6_avx2     (uint8_t *dst, ptrdiff_t dststride,
+                                    uint8_t *src, ptrdiff_t srcstride,
+                                    int height, int mx, int my);
+void ff_put_vp8_bilinear16_h_avx2  (uint8_t *dst, ptrdiff_t dststride,
+                                    uint8_t *src, ptrdiff_t srcstride,
+                                    int height, int mx, int my);
+void ff_put_vp8_bilinear16_v_avx2  (uint8_t *dst, ptrdiff_t dststride,
+                                    uint8_t *src, ptrdiff_t srcstride,
+                                    int height, int mx, int my);
+
+HVTAP(avx2, 32, 6, 6, 16, 16)
+HVBILIN(avx2, 32, 16, 16)
+#endif /* HAVE_AVX2_EXTERNAL && ARCH_X86_64 */
+
 void ff_vp8_idct_dc_add_mmx(uint8_t *dst, int16_t block[16],
                             ptrdiff_t stride);
 void ff_vp8_idct_dc_add_sse4(uint8_t *dst, int16_t block[16],
@@ -436,5 +454,12 @@ av_cold void ff_vp8dsp_init_x86(VP8DSPContext* c)
         c->vp8_h_loop_filter16y       = ff_vp8_h_loop_filter16y_mbedge_sse4;
         c->vp8_h_loop_filter8uv       = ff_vp8_h_loop_filter8uv_mbedge_sse4;
     }
+
+#if HAVE_AVX2_EXTERNAL && ARCH_X86_64
+    if (mm_flags & AV_CPU_FLAG_AVX2) {
+        VP8_LUMA_MC_FUNC(0, 16, avx2);
+        VP8_BILINEAR_MC_FUNC(0, 16, avx2);
+    }
+#endif
 #endif /* HAVE_YASM */
 }
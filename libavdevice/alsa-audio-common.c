@@ -243,6 +243,9 @@ av_cold int ff_alsa_open(AVFormatContext *ctx, snd_pcm_stream_t mode,
 
     snd_pcm_hw_params_get_buffer_size_max(hw_params, &buffer_size);
     buffer_size = FFMIN(buffer_size, ALSA_BUFFER_SIZE_MAX);
+    if (s->user_period_size && s->user_periods)
+        buffer_size = FFMIN(buffer_size,
+                            (snd_pcm_uframes_t)s->user_period_size * s->user_periods);
     /* TODO: maybe use ctx->max_picture_buffer somehow */
     res = snd_pcm_hw_params_set_buffer_size_near(h, hw_params, &buffer_size);
     if (res < 0) {
@@ -251,9 +254,15 @@ av_cold int ff_alsa_open(AVFormatContext *ctx, snd_pcm_stream_t mode,
         goto fail;
     }
 
-    snd_pcm_hw_params_get_period_size_min(hw_params, &period_size, NULL);
-    if (!period_size)
-        period_size = buffer_size / 4;
+    if (s->user_period_size) {
+        period_size = s->user_period_size;
+    } else if (s->user_periods) {
+        period_size = buffer_size / s->user_periods;
+    } else {
+        snd_pcm_hw_params_get_period_size_min(hw_params, &period_size, NULL);
+        if (!period_size)
+            period_size = buffer_size / 4;
+    }
     res = snd_pcm_hw_params_set_period_size_near(h, hw_params, &period_size, NULL);
     if (res < 0) {
         av_log(ctx, AV_LOG_ERROR, "cannot set ALSA period size (%s)\n",
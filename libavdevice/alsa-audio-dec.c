@@ -54,6 +54,34 @@
 #include "avdevice.h"
 #include "alsa-audio.h"
 
+/**
+ * Timestamp the packets with the time they are read at, corrected by the
+ * delay reported by the device and smoothed by a time filter.
+ */
+#define ALSA_TS_DEFAULT 0
+/**
+ * Timestamp the packets with the time of the last hardware pointer update,
+ * when supported by the driver.
+ */
+#define ALSA_TS_HW      1
+
+static int enable_hw_timestamps(AVFormatContext *s1)
+{
+    AlsaData *s = s1->priv_data;
+    snd_pcm_sw_params_t *sw_params;
+    int res;
+
+    res = snd_pcm_sw_params_malloc(&sw_params);
+    if (res < 0)
+        return res;
+    if ((res = snd_pcm_sw_params_current(s->h, sw_params)) >= 0 &&
+        (res = snd_pcm_sw_params_set_tstamp_mode(s->h, sw_params,
+                                                 SND_PCM_TSTAMP_ENABLE)) >= 0)
+        res = snd_pcm_sw_params(s->h, sw_params);
+    snd_pcm_sw_params_free(sw_params);
+    return res;
+}
+
 static av_cold int audio_read_header(AVFormatContext *s1)
 {
     AlsaData *s = s1->priv_data;
@@ -81,6 +109,13 @@ static av_cold int audio_read_header(AVFormatContext *s1)
     st->codec->sample_rate = s->sample_rate;
     st->codec->channels    = s->channels;
     avpriv_set_pts_info(st, 64, 1, 1000000);  /* 64 bits pts in us */
+
+    if (s->ts_mode == ALSA_TS_HW && (ret = enable_hw_timestamps(s1)) < 0) {
+        av_log(s1, AV_LOG_WARNING, "cannot enable hardware timestamps (%s)\n",
+               snd_strerror(ret));
+        s->ts_mode = ALSA_TS_DEFAULT;
+    }
+
     /* microseconds instead of seconds, MHz instead of Hz */
     s->timefilter = ff_timefilter_new(1000000.0 / s->sample_rate,
                                       s->period_size, 1.5E-6);
@@ -121,6 +156,21 @@ static int audio_read_packet(AVFormatContext *s1, AVPacket *pkt)
         ff_timefilter_reset(s->timefilter);
     }
 
+    if (s->ts_mode == ALSA_TS_HW) {
+        snd_pcm_uframes_t avail;
+        snd_htimestamp_t tstamp;
+
+        /* avail frames were captured after the packet, at the time of the
+         * timestamp; it is zero if the driver does not provide any */
+        if (snd_pcm_htimestamp(s->h, &avail, &tstamp) >= 0 &&
+            (tstamp.tv_sec || tstamp.tv_nsec)) {
+            pkt->pts = tstamp.tv_sec * INT64_C(1000000) + tstamp.tv_nsec / 1000 -
+                       av_rescale(avail + res, 1000000, s->sample_rate);
+            pkt->size = res * s->frame_size;
+            return 0;
+        }
+    }
+
     dts = av_gettime();
     snd_pcm_delay(s->h, &delay);
     dts -= av_rescale(delay + res, 1000000, s->sample_rate);
@@ -135,6 +185,11 @@ static int audio_read_packet(AVFormatContext *s1, AVPacket *pkt)
 static const AVOption options[] = {
     { "sample_rate", "", offsetof(AlsaData, sample_rate), AV_OPT_TYPE_INT, {.i64 = 48000}, 1, INT_MAX, AV_OPT_FLAG_DECODING_PARAM },
     { "channels",    "", offsetof(AlsaData, channels),    AV_OPT_TYPE_INT, {.i64 = 2},     1, INT_MAX, AV_OPT_FLAG_DECODING_PARAM },
+    { "period_size", "set period size in frames, 0 for automatic", offsetof(AlsaData, user_period_size), AV_OPT_TYPE_INT, {.i64 = 0}, 0, INT_MAX, AV_OPT_FLAG_DECODING_PARAM },
+    { "periods",     "set number of periods in the buffer, 0 for automatic", offsetof(AlsaData, user_periods), AV_OPT_TYPE_INT, {.i64 = 0}, 0, INT_MAX, AV_OPT_FLAG_DECODING_PARAM },
+    { "timestamps",  "set type of timestamps", offsetof(AlsaData, ts_mode), AV_OPT_TYPE_INT, {.i64 = ALSA_TS_DEFAULT}, 0, 1, AV_OPT_FLAG_DECODING_PARAM, "timestamps" },
+    { "default",     "time of the read, filtered", 0, AV_OPT_TYPE_CONST, {.i64 = ALSA_TS_DEFAULT}, 0, 0, AV_OPT_FLAG_DECODING_PARAM, "timestamps" },
+    { "hw",          "hardware timestamps of the driver", 0, AV_OPT_TYPE_CONST, {.i64 = ALSA_TS_HW}, 0, 0, AV_OPT_FLAG_DECODING_PARAM, "timestamps" },
     { NULL },
 };
 
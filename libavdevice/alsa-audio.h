@@ -52,6 +52,9 @@ typedef struct AlsaData {
     int period_size; ///< preferred size for reads and writes, in frames
     int sample_rate; ///< sample rate set by user
     int channels;    ///< number of channels set by user
+    int user_period_size; ///< period size set by user, in frames, or 0
+    int user_periods;     ///< number of periods set by user, or 0
+    int ts_mode;          ///< timestamps set by user, capture only
     int last_period;
     TimeFilter *timefilter;
     void (*reorder_func)(const void *, void *, int);
@@ -30,6 +30,7 @@
 #include "libavutil/bprint.h"
 #include "libavutil/channel_layout.h"
 #include "libavutil/file.h"
+#include "libavutil/imgutils.h"
 #include "libavutil/log.h"
 #include "libavutil/mem.h"
 #include "libavutil/opt.h"
@@ -232,6 +233,9 @@ av_cold static int lavfi_read_header(AVFormatContext *avctx)
                                                NULL, lavfi->graph);
             if (ret >= 0)
                 ret = av_opt_set_int_list(sink, "pix_fmts", pix_fmts,  AV_PIX_FMT_NONE, AV_OPT_SEARCH_CHILDREN);
+            /* let the packets reference the frames the sink allocates */
+            if (ret >= 0)
+                ret = av_opt_set_int(sink, "contiguous", 1, AV_OPT_SEARCH_CHILDREN);
             if (ret < 0)
                 goto end;
         } else if (type == AVMEDIA_TYPE_AUDIO) {
@@ -310,6 +314,44 @@ end:
     return ret;
 }
 
+/**
+ * Make the packet reference the frame data if it is stored in one buffer
+ * exactly as the packet is laid out.
+ *
+ * @return 1 if the packet was set, 0 if the data must be copied
+ */
+static int wrap_frame_data(AVPacket *pkt, AVFrame *frame, int size)
+{
+    AVBufferRef *buf = frame->buf[0];
+
+    if (!buf || frame->buf[1] || frame->extended_buf ||
+        frame->data[0] < buf->data || frame->data[0] + size > buf->data + buf->size)
+        return 0;
+
+    if (frame->width) {
+        const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(frame->format);
+        uint8_t *data[4] = { NULL };
+        int linesize[4] = { 0 };
+        int i;
+
+        if (desc->flags & (AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_PSEUDOPAL) ||
+            av_image_fill_linesizes(linesize, frame->format, frame->width) < 0 ||
+            av_image_fill_pointers(data, frame->format, frame->height,
+                                   frame->data[0], linesize) < 0)
+            return 0;
+        for (i = 0; i < 4 && data[i]; i++)
+            if (data[i] != frame->data[i] || linesize[i] != frame->linesize[i])
+                return 0;
+    }
+
+    pkt->buf = av_buffer_ref(buf);
+    if (!pkt->buf)
+        return 0;
+    pkt->data = frame->data[0];
+    pkt->size = size;
+    return 1;
+}
+
 static int lavfi_read_packet(AVFormatContext *avctx, AVPacket *pkt)
 {
     LavfiContext *lavfi = avctx->priv_data;
@@ -358,6 +400,8 @@ static int lavfi_read_packet(AVFormatContext *avctx, AVPacket *pkt)
 
     if (frame->width /* FIXME best way of testing a video */) {
         size = avpicture_get_size(frame->format, frame->width, frame->height);
+        if (wrap_frame_data(pkt, frame, size))
+            goto done;
         if ((ret = av_new_packet(pkt, size)) < 0)
             return ret;
 
@@ -369,11 +413,14 @@ static int lavfi_read_packet(AVFormatContext *avctx, AVPacket *pkt)
     } else if (av_frame_get_channels(frame) /* FIXME test audio */) {
         size = frame->nb_samples * av_get_bytes_per_sample(frame->format) *
                                    av_frame_get_channels(frame);
+        if (wrap_frame_data(pkt, frame, size))
+            goto done;
         if ((ret = av_new_packet(pkt, size)) < 0)
             return ret;
         memcpy(pkt->data, frame->data[0], size);
     }
 
+done:
     frame_metadata = av_frame_get_metadata(frame);
     if (frame_metadata) {
         uint8_t *metadata;
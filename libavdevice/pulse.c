@@ -32,6 +32,8 @@
 #include "libavformat/avformat.h"
 #include "libavformat/internal.h"
 #include "libavutil/opt.h"
+#include "libavutil/time.h"
+#include "timefilter.h"
 
 #define DEFAULT_CODEC_ID AV_NE(AV_CODEC_ID_PCM_S16BE, AV_CODEC_ID_PCM_S16LE)
 
@@ -44,9 +46,11 @@ typedef struct PulseData {
     int  channels;
     int  frame_size;
     int  fragment_size;
+    int  wallclock;
     pa_simple *s;
     int64_t pts;
     int64_t frame_duration;
+    TimeFilter *timefilter;
 } PulseData;
 
 static pa_sample_format_t codec_id_to_pulse_format(int codec_id) {
@@ -113,6 +117,15 @@ static av_cold int pulse_read_header(AVFormatContext *s)
     pd->frame_duration = (pd->frame_size * 1000000LL * 8) /
         (pd->sample_rate * pd->channels * av_get_bits_per_sample(codec_id));
 
+    if (pd->wallclock) {
+        /* microseconds instead of seconds, MHz instead of Hz */
+        pd->timefilter = ff_timefilter_new(1, pd->frame_duration, 1.5E-6);
+        if (!pd->timefilter) {
+            pa_simple_free(pd->s);
+            return AVERROR(ENOMEM);
+        }
+    }
+
     return 0;
 }
 
@@ -139,6 +152,13 @@ static int pulse_read_packet(AVFormatContext *s, AVPacket *pkt)
         return AVERROR(EIO);
     }
 
+    if (pd->wallclock) {
+        /* the latency is the time the last sample read waited for */
+        int64_t dts = av_gettime() - (int64_t)latency - pd->frame_duration;
+        pkt->pts = ff_timefilter_update(pd->timefilter, dts, pd->frame_duration);
+        return 0;
+    }
+
     if (pd->pts == AV_NOPTS_VALUE) {
         pd->pts = -latency;
     }
@@ -154,6 +174,8 @@ static av_cold int pulse_close(AVFormatContext *s)
 {
     PulseData *pd = s->priv_data;
     pa_simple_free(pd->s);
+    if (pd->timefilter)
+        ff_timefilter_destroy(pd->timefilter);
     return 0;
 }
 
@@ -168,6 +190,7 @@ static const AVOption options[] = {
     { "channels",      "number of audio channels",                       OFFSET(channels),      AV_OPT_TYPE_INT,    {.i64 = 2},        1, INT_MAX, D },
     { "frame_size",    "number of bytes per frame",                      OFFSET(frame_size),    AV_OPT_TYPE_INT,    {.i64 = 1024},     1, INT_MAX, D },
     { "fragment_size", "buffering size, affects latency and cpu usage",  OFFSET(fragment_size), AV_OPT_TYPE_INT,    {.i64 = -1},      -1, INT_MAX, D },
+    { "wallclock",     "set the timestamps from the wall clock",         OFFSET(wallclock),     AV_OPT_TYPE_INT,    {.i64 = 0},        0, 1, D },
     { NULL },
 };
 
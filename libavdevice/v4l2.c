@@ -31,13 +31,12 @@
  */
 
 #include "v4l2-common.h"
+#include "libavutil/intreadwrite.h"
 
 #if CONFIG_LIBV4L2
 #include <libv4l2.h>
 #endif
 
-static const int desired_video_buffers = 256;
-
 #define V4L_ALLFORMATS  3
 #define V4L_RAWFORMATS  1
 #define V4L_COMPFORMATS 2
@@ -80,6 +79,12 @@ struct video_data {
     volatile int buffers_queued;
     void **buf_start;
     unsigned int *buf_len;
+    int *buf_dmabuf;      /**< exported DMABUF fds, or NULL */
+    int nb_buffers;       /**< Set by a private option. */
+    int nocopy;           /**< Set by a private option. */
+    int dmabuf;           /**< Set by a private option. */
+    int dropping;
+    int64_t dropped;
     char *standard;
     v4l2_std_id std_id;
     int channel;
@@ -336,7 +341,7 @@ static int mmap_init(AVFormatContext *ctx)
     struct video_data *s = ctx->priv_data;
     struct v4l2_requestbuffers req = {
         .type   = V4L2_BUF_TYPE_VIDEO_CAPTURE,
-        .count  = desired_video_buffers,
+        .count  = s->nb_buffers,
         .memory = V4L2_MEMORY_MMAP
     };
 
@@ -362,6 +367,24 @@ static int mmap_init(AVFormatContext *ctx)
         av_free(s->buf_start);
         return AVERROR(ENOMEM);
     }
+    if (s->dmabuf) {
+#ifdef VIDIOC_EXPBUF
+        s->buf_dmabuf = av_malloc(sizeof(int) * s->buffers);
+        if (!s->buf_dmabuf) {
+            av_log(ctx, AV_LOG_ERROR, "Cannot allocate buffer descriptors\n");
+            av_free(s->buf_start);
+            av_free(s->buf_len);
+            return AVERROR(ENOMEM);
+        }
+        for (i = 0; i < s->buffers; i++)
+            s->buf_dmabuf[i] = -1;
+#else
+        av_log(ctx, AV_LOG_ERROR, "DMABUF export is not supported by the kernel headers.\n");
+        av_free(s->buf_start);
+        av_free(s->buf_len);
+        return AVERROR(ENOSYS);
+#endif
+    }
 
     for (i = 0; i < req.count; i++) {
         struct v4l2_buffer buf = {
@@ -391,6 +414,23 @@ static int mmap_init(AVFormatContext *ctx)
             av_log(ctx, AV_LOG_ERROR, "mmap: %s\n", av_err2str(res));
             return res;
         }
+
+#ifdef VIDIOC_EXPBUF
+        if (s->buf_dmabuf) {
+            struct v4l2_exportbuffer expbuf = {
+                .type  = V4L2_BUF_TYPE_VIDEO_CAPTURE,
+                .index = i,
+                .flags = O_RDONLY,
+            };
+            if (v4l2_ioctl(s->fd, VIDIOC_EXPBUF, &expbuf) < 0) {
+                res = AVERROR(errno);
+                av_log(ctx, AV_LOG_ERROR, "ioctl(VIDIOC_EXPBUF): %s\n", av_err2str(res));
+                return res;
+            }
+            s->buf_dmabuf[i] = expbuf.fd;
+            fcntl(expbuf.fd, F_SETFD, FD_CLOEXEC);
+        }
+#endif
     }
 
     return 0;
@@ -493,6 +533,7 @@ static int mmap_read_frame(AVFormatContext *ctx, AVPacket *pkt)
     };
     int res;
 
+retry:
     /* FIXME: Some special treatment might be needed in case of loss of signal... */
     while ((res = v4l2_ioctl(s->fd, VIDIOC_DQBUF, &buf)) < 0 && (errno == EINTR));
     if (res < 0) {
@@ -527,7 +568,28 @@ static int mmap_read_frame(AVFormatContext *ctx, AVPacket *pkt)
     }
 
     /* Image is at s->buff_start[buf.index] */
-    if (avpriv_atomic_int_get(&s->buffers_queued) == FFMAX(s->buffers / 8, 1)) {
+    if (s->nocopy) {
+        /* The user holds all the other buffers: rather than copying, give
+         * this one back to the driver and drop the frame, as the driver
+         * would have done anyway with nothing left to capture into. */
+        if (avpriv_atomic_int_get(&s->buffers_queued) == 1) {
+            if (v4l2_ioctl(s->fd, VIDIOC_QBUF, &buf) < 0) {
+                res = AVERROR(errno);
+                av_log(ctx, AV_LOG_ERROR, "ioctl(VIDIOC_QBUF): %s\n", av_err2str(res));
+                return res;
+            }
+            avpriv_atomic_int_add_and_fetch(&s->buffers_queued, 1);
+            if (!s->dropping)
+                av_log(ctx, AV_LOG_WARNING,
+                       "All buffers are in use, dropping frames\n");
+            s->dropping = 1;
+            s->dropped++;
+            goto retry;
+        }
+        s->dropping = 0;
+    }
+    if (!s->nocopy &&
+        avpriv_atomic_int_get(&s->buffers_queued) == FFMAX(s->buffers / 8, 1)) {
         /* when we start getting low on queued buffers, fall back on copying data */
         res = av_new_packet(pkt, buf.bytesused);
         if (res < 0) {
@@ -577,6 +639,15 @@ static int mmap_read_frame(AVFormatContext *ctx, AVPacket *pkt)
             av_freep(&buf_descriptor);
             return AVERROR(ENOMEM);
         }
+
+        if (s->buf_dmabuf) {
+            uint8_t *side = av_packet_new_side_data(pkt, AV_PKT_DATA_DMABUF, 4);
+            if (!side) {
+                av_free_packet(pkt);
+                return AVERROR(ENOMEM);
+            }
+            AV_WL32(side, s->buf_dmabuf[buf.index]);
+        }
     }
     pkt->pts = buf.timestamp.tv_sec * INT64_C(1000000) + buf.timestamp.tv_usec;
     convert_timestamp(ctx, &pkt->pts);
@@ -627,9 +698,12 @@ static void mmap_close(struct video_data *s)
     v4l2_ioctl(s->fd, VIDIOC_STREAMOFF, &type);
     for (i = 0; i < s->buffers; i++) {
         v4l2_munmap(s->buf_start[i], s->buf_len[i]);
+        if (s->buf_dmabuf && s->buf_dmabuf[i] >= 0)
+            close(s->buf_dmabuf[i]);
     }
     av_free(s->buf_start);
     av_free(s->buf_len);
+    av_freep(&s->buf_dmabuf);
 }
 
 static int v4l2_set_parameters(AVFormatContext *s1)
@@ -966,6 +1040,9 @@ static int v4l2_read_close(AVFormatContext *s1)
     if (avpriv_atomic_int_get(&s->buffers_queued) != s->buffers)
         av_log(s1, AV_LOG_WARNING, "Some buffers are still owned by the caller on "
                "close.\n");
+    if (s->dropped)
+        av_log(s1, AV_LOG_INFO, "%"PRId64" frames dropped with no free buffer\n",
+               s->dropped);
 
     mmap_close(s);
 
@@ -998,6 +1075,9 @@ static const AVOption options[] = {
     { "abs",          "use absolute timestamps (wall clock)",                     OFFSET(ts_mode),      AV_OPT_TYPE_CONST,  {.i64 = V4L_TS_ABS      }, 0, 2, DEC, "timestamps" },
     { "mono2abs",     "force conversion from monotonic to absolute timestamps",   OFFSET(ts_mode),      AV_OPT_TYPE_CONST,  {.i64 = V4L_TS_MONO2ABS }, 0, 2, DEC, "timestamps" },
     { "use_libv4l2",  "use libv4l2 (v4l-utils) convertion functions",             OFFSET(use_libv4l2),  AV_OPT_TYPE_INT,    {.i64 = 0}, 0, 1, DEC },
+    { "buffers",      "set number of capture buffers to request",                 OFFSET(nb_buffers),   AV_OPT_TYPE_INT,    {.i64 = 256}, 2, INT_MAX, DEC },
+    { "nocopy",       "drop frames instead of copying them when buffers run out", OFFSET(nocopy),       AV_OPT_TYPE_INT,    {.i64 = 0}, 0, 1, DEC },
+    { "dmabuf",       "export the capture buffers as DMABUF file descriptors",    OFFSET(dmabuf),       AV_OPT_TYPE_INT,    {.i64 = 0}, 0, 1, DEC },
     { NULL },
 };
 
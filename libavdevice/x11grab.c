@@ -38,6 +38,7 @@
 
 #include "config.h"
 #include "libavformat/internal.h"
+#include "libavutil/atomic.h"
 #include "libavutil/log.h"
 #include "libavutil/opt.h"
 #include "libavutil/parseutils.h"
@@ -53,8 +54,26 @@
 #include <X11/extensions/shape.h>
 #include <X11/extensions/XShm.h>
 #include <X11/extensions/Xfixes.h>
+#if HAVE_XDAMAGECREATE
+#include <X11/extensions/Xdamage.h>
+#endif
 #include "avdevice.h"
 
+#define MAX_SHM_BUFFERS 64
+
+/**
+ * Shared memory segment the frames are grabbed into. The packets reference
+ * it directly; it is only reused once they have all been freed.
+ */
+typedef struct X11GrabBuffer {
+    XImage *image;
+    XShmSegmentInfo shminfo;
+    int attached;            /**< the X server knows the segment */
+    volatile int refs;       /**< 1 for the grabber, +1 while in a packet */
+    uint8_t *dirty;          /**< rows to grab again, one flag per row */
+    int x_off, y_off;        /**< where the content was grabbed from */
+} X11GrabBuffer;
+
 /**
  * X11 Device Demuxer context
  */
@@ -72,11 +91,23 @@ struct x11grab {
     Display *dpy;            /**< X11 display from which x11grab grabs frames */
     XImage *image;           /**< X11 image holding the grab */
     int use_shm;             /**< !0 when using XShm extension */
-    XShmSegmentInfo shminfo; /**< When using XShm, keeps track of XShm infos */
+    X11GrabBuffer *buffers[MAX_SHM_BUFFERS]; /**< When using XShm, the ring of segments */
+    int nb_buffers;          /**< Number of segments allocated so far */
+    int last_buffer;         /**< Segment of the last grab */
     int  draw_mouse;         /**< Set by a private option. */
     int  follow_mouse;       /**< Set by a private option. */
     int  show_region;        /**< set by a private option. */
     char *framerate;         /**< Set by a private option. */
+    int  max_buffers;        /**< Set by a private option. */
+    int  use_damage;         /**< Set by a private option. */
+
+#if HAVE_XDAMAGECREATE
+    Damage damage;           /**< Damage object tracking the root window */
+    XserverRegion damage_region; /**< Scratch region for the damage */
+    int damage_event_base;
+#endif
+
+    XImage fallback_image;   /**< Image header for grabs outside the ring */
 
     Window region_win;       /**< This is used by show_region option. */
 };
@@ -142,6 +173,93 @@ x11grab_region_win_init(struct x11grab *s)
     x11grab_draw_region_win(s);
 }
 
+static void buffer_unref(X11GrabBuffer *buf)
+{
+    if (avpriv_atomic_int_add_and_fetch(&buf->refs, -1))
+        return;
+    if (buf->shminfo.shmaddr != (char *)-1 && buf->shminfo.shmaddr)
+        shmdt(buf->shminfo.shmaddr);
+    if (buf->image) {
+        buf->image->data = NULL;
+        XDestroyImage(buf->image);
+    }
+    av_free(buf->dirty);
+    av_free(buf);
+}
+
+static void packet_release_buffer(void *opaque, uint8_t *data)
+{
+    buffer_unref(opaque);
+}
+
+/**
+ * Allocate a new shared memory segment and add it to the ring.
+ *
+ * @return the segment, or NULL on failure
+ */
+static X11GrabBuffer *
+x11grab_add_buffer(AVFormatContext *s1, Display *dpy)
+{
+    struct x11grab *s = s1->priv_data;
+    int scr = XDefaultScreen(dpy);
+    X11GrabBuffer *buf;
+
+    if (s->nb_buffers >= FFMIN(s->max_buffers, MAX_SHM_BUFFERS))
+        return NULL;
+    buf = av_mallocz(sizeof(*buf));
+    if (!buf)
+        return NULL;
+    buf->refs             = 1;
+    buf->shminfo.shmid    = -1;
+    buf->shminfo.shmaddr  = (char *)-1;
+    buf->dirty = av_malloc(s->height);
+    if (!buf->dirty)
+        goto fail;
+    /* nothing grabbed yet */
+    memset(buf->dirty, 1, s->height);
+
+    buf->image = XShmCreateImage(dpy,
+                                 DefaultVisual(dpy, scr),
+                                 DefaultDepth(dpy, scr),
+                                 ZPixmap,
+                                 NULL,
+                                 &buf->shminfo,
+                                 s->width, s->height);
+    if (!buf->image)
+        goto fail;
+    buf->shminfo.shmid = shmget(IPC_PRIVATE,
+                                buf->image->bytes_per_line * buf->image->height,
+                                IPC_CREAT|0777);
+    if (buf->shminfo.shmid == -1) {
+        av_log(s1, AV_LOG_ERROR, "Fatal: Can't get shared memory!\n");
+        goto fail;
+    }
+    buf->shminfo.shmaddr = buf->image->data = shmat(buf->shminfo.shmid, 0, 0);
+    if (buf->shminfo.shmaddr == (char *)-1) {
+        av_log(s1, AV_LOG_ERROR, "Fatal: Can't attach shared memory!\n");
+        goto fail;
+    }
+    buf->shminfo.readOnly = False;
+
+    if (!XShmAttach(dpy, &buf->shminfo)) {
+        av_log(s1, AV_LOG_ERROR, "Fatal: Failed to attach shared memory!\n");
+        goto fail;
+    }
+    /* make sure the server attached before the segment is removed */
+    XSync(dpy, False);
+    buf->attached = 1;
+    /* the segment is freed once the last user detaches from it */
+    shmctl(buf->shminfo.shmid, IPC_RMID, NULL);
+
+    s->buffers[s->nb_buffers++] = buf;
+    return buf;
+fail:
+    if (buf->shminfo.shmid != -1)
+        shmctl(buf->shminfo.shmid, IPC_RMID, NULL);
+    buffer_unref(buf);
+    return NULL;
+}
+
 /**
  * Initialize the x11 grab device demuxer (public device demuxer API).
  *
@@ -226,31 +344,28 @@ x11grab_read_header(AVFormatContext *s1)
     av_log(s1, AV_LOG_INFO, "shared memory extension%s found\n", use_shm ? "" : " not");
 
     if(use_shm) {
-        int scr = XDefaultScreen(dpy);
-        image = XShmCreateImage(dpy,
-                                DefaultVisual(dpy, scr),
-                                DefaultDepth(dpy, scr),
-                                ZPixmap,
-                                NULL,
-                                &x11grab->shminfo,
-                                x11grab->width, x11grab->height);
-        x11grab->shminfo.shmid = shmget(IPC_PRIVATE,
-                                        image->bytes_per_line * image->height,
-                                        IPC_CREAT|0777);
-        if (x11grab->shminfo.shmid == -1) {
-            av_log(s1, AV_LOG_ERROR, "Fatal: Can't get shared memory!\n");
+        X11GrabBuffer *buf = x11grab_add_buffer(s1, dpy);
+        if (!buf) {
             ret = AVERROR(ENOMEM);
             goto out;
         }
-        x11grab->shminfo.shmaddr = image->data = shmat(x11grab->shminfo.shmid, 0, 0);
-        x11grab->shminfo.readOnly = False;
-
-        if (!XShmAttach(dpy, &x11grab->shminfo)) {
-            av_log(s1, AV_LOG_ERROR, "Fatal: Failed to attach shared memory!\n");
-            /* needs some better error subroutine :) */
-            ret = AVERROR(EIO);
-            goto out;
+        image = buf->image;
+
+#if HAVE_XDAMAGECREATE
+        if (x11grab->use_damage) {
+            int error_base;
+            if (XDamageQueryExtension(dpy, &x11grab->damage_event_base, &error_base)) {
+                x11grab->damage = XDamageCreate(dpy, RootWindow(dpy, screen),
+                                                XDamageReportNonEmpty);
+                x11grab->damage_region = XFixesCreateRegion(dpy, NULL, 0);
+            } else {
+                av_log(s1, AV_LOG_WARNING, "damage extension not found\n");
+            }
         }
+#else
+        if (x11grab->use_damage)
+            av_log(s1, AV_LOG_WARNING, "built without damage extension support\n");
+#endif
     } else {
         image = XGetImage(dpy, RootWindow(dpy, screen),
                           x_off,y_off,
@@ -312,7 +427,7 @@ x11grab_read_header(AVFormatContext *s1)
     x11grab->time_frame = av_gettime() / av_q2d(x11grab->time_base);
     x11grab->x_off = x_off;
     x11grab->y_off = y_off;
-    x11grab->image = image;
+    x11grab->image = use_shm ? NULL : image;
     x11grab->use_shm = use_shm;
 
     st->codec->codec_type = AVMEDIA_TYPE_VIDEO;
@@ -334,9 +449,10 @@ out:
  * @param image image to paint the mouse pointer to
  * @param s context used to retrieve original grabbing rectangle
  *          coordinates
+ * @param dirty if not NULL, flags of the image rows painted over
  */
 static void
-paint_mouse_pointer(XImage *image, struct x11grab *s)
+paint_mouse_pointer(XImage *image, struct x11grab *s, uint8_t *dirty)
 {
     int x_off = s->x_off;
     int y_off = s->y_off;
@@ -374,6 +490,8 @@ paint_mouse_pointer(XImage *image, struct x11grab *s)
     to_line = FFMIN((y + xcim->height), (height + y_off));
     to_column = FFMIN((x + xcim->width), (width + x_off));
 
+    if (dirty && to_line > FFMAX(y, y_off))
+        memset(dirty + FFMAX(y, y_off) - y_off, 1, to_line - FFMAX(y, y_off));
     for (line = FFMAX(y, y_off); line < to_line; line++) {
         for (column = FFMAX(x, x_off); column < to_column; column++) {
             int  xcim_addr = (line - y) * xcim->width + column - x;
@@ -448,6 +566,108 @@ xget_zpixmap(Display *dpy, Drawable d, XImage *image, int x, int y)
     return 1;
 }
 
+/**
+ * Flag the rows damaged since the last call in all the segments.
+ */
+static void
+x11grab_update_damage(struct x11grab *s)
+{
+    int i;
+
+#if HAVE_XDAMAGECREATE
+    if (s->damage) {
+        Display *dpy = s->dpy;
+        XRectangle *rects;
+        XEvent evt;
+        int j, nb_rects;
+
+        while (XCheckTypedEvent(dpy, s->damage_event_base + XDamageNotify, &evt))
+            ;
+        XDamageSubtract(dpy, s->damage, None, s->damage_region);
+        rects = XFixesFetchRegion(dpy, s->damage_region, &nb_rects);
+        for (i = 0; i < nb_rects; i++) {
+            for (j = 0; j < s->nb_buffers; j++) {
+                X11GrabBuffer *buf = s->buffers[j];
+                int y0 = FFMAX(rects[i].y - buf->y_off, 0);
+                int y1 = FFMIN(rects[i].y + rects[i].height - buf->y_off, s->height);
+
+                if (rects[i].x + rects[i].width <= buf->x_off ||
+                    rects[i].x >= buf->x_off + s->width || y0 >= y1)
+                    continue;
+                memset(buf->dirty + y0, 1, y1 - y0);
+            }
+        }
+        if (rects)
+            XFree(rects);
+        return;
+    }
+#endif
+    for (i = 0; i < s->nb_buffers; i++)
+        memset(s->buffers[i]->dirty, 1, s->height);
+}
+
+/**
+ * Grab the dirty rows of a segment, as full width bands since the server
+ * writes them with the stride of the image.
+ *
+ * @return 0 if error, !0 if successful
+ */
+static int
+x11grab_grab_buffer(struct x11grab *s, X11GrabBuffer *buf, Window root,
+                    int x_off, int y_off)
+{
+    XImage band = *buf->image;
+    int y = 0, y1;
+
+    if (buf->x_off != x_off || buf->y_off != y_off) {
+        memset(buf->dirty, 1, s->height);
+        buf->x_off = x_off;
+        buf->y_off = y_off;
+    }
+
+    while (y < s->height) {
+        for (; y < s->height && !buf->dirty[y]; y++)
+            ;
+        for (y1 = y; y1 < s->height && buf->dirty[y1]; y1++)
+            ;
+        if (y == y1)
+            break;
+        band.height = y1 - y;
+        band.data   = buf->image->data + y * buf->image->bytes_per_line;
+        if (!XShmGetImage(s->dpy, root, &band, x_off, y_off + y, AllPlanes))
+            return 0;
+        memset(buf->dirty + y, 0, y1 - y);
+        y = y1;
+    }
+    return 1;
+}
+
+/**
+ * Pick a segment not referenced by any packet, preferably the last one
+ * grabbed as it needs the fewest rows to be grabbed again.
+ *
+ * @return the segment, or NULL if all are in use
+ */
+static X11GrabBuffer *
+x11grab_get_buffer(AVFormatContext *s1)
+{
+    struct x11grab *s = s1->priv_data;
+    int i;
+
+    for (i = 0; i < s->nb_buffers; i++) {
+        int idx = (s->last_buffer + i) % s->nb_buffers;
+        if (avpriv_atomic_int_get(&s->buffers[idx]->refs) == 1) {
+            s->last_buffer = idx;
+            return s->buffers[idx];
+        }
+    }
+    if (x11grab_add_buffer(s1, s->dpy)) {
+        s->last_buffer = s->nb_buffers - 1;
+        return s->buffers[s->last_buffer];
+    }
+    return NULL;
+}
+
 /**
  * Grab a frame from x11 (public device demuxer API).
  *
@@ -490,8 +710,6 @@ x11grab_read_packet(AVFormatContext *s1, AVPacket *pkt)
     }
 
     av_init_packet(pkt);
-    pkt->data = image->data;
-    pkt->size = s->frame_size;
     pkt->pts = curtime;
 
     screen = DefaultScreen(dpy);
@@ -543,17 +761,46 @@ x11grab_read_packet(AVFormatContext *s1, AVPacket *pkt)
     }
 
     if(s->use_shm) {
-        if (!XShmGetImage(dpy, root, image, x_off, y_off, AllPlanes)) {
-            av_log (s1, AV_LOG_INFO, "XShmGetImage() failed\n");
+        X11GrabBuffer *buf;
+
+        x11grab_update_damage(s);
+        buf = x11grab_get_buffer(s1);
+        if (buf) {
+            if (!x11grab_grab_buffer(s, buf, root, x_off, y_off)) {
+                av_log (s1, AV_LOG_INFO, "XShmGetImage() failed\n");
+                memset(buf->dirty, 1, s->height);
+            }
+            if (s->draw_mouse)
+                paint_mouse_pointer(buf->image, s, buf->dirty);
+
+            pkt->buf = av_buffer_create(buf->image->data, s->frame_size,
+                                        packet_release_buffer, buf, 0);
+            if (!pkt->buf)
+                return AVERROR(ENOMEM);
+            avpriv_atomic_int_add_and_fetch(&buf->refs, 1);
+            pkt->data = buf->image->data;
+            pkt->size = s->frame_size;
+            return s->frame_size;
         }
+
+        /* all the segments are held by packets, read into a new packet */
+        if (av_new_packet(pkt, s->frame_size) < 0)
+            return AVERROR(ENOMEM);
+        pkt->pts = curtime;
+        image = &s->fallback_image;
+        *image = *s->buffers[0]->image;
+        image->data = pkt->data;
     } else {
-        if (!xget_zpixmap(dpy, root, image, x_off, y_off)) {
-            av_log (s1, AV_LOG_INFO, "XGetZPixmap() failed\n");
-        }
+        pkt->data = image->data;
+        pkt->size = s->frame_size;
+    }
+
+    if (!xget_zpixmap(dpy, root, image, x_off, y_off)) {
+        av_log (s1, AV_LOG_INFO, "XGetZPixmap() failed\n");
     }
 
     if (s->draw_mouse) {
-        paint_mouse_pointer(image, s);
+        paint_mouse_pointer(image, s, NULL);
     }
 
     return s->frame_size;
@@ -569,13 +816,24 @@ static int
 x11grab_read_close(AVFormatContext *s1)
 {
     struct x11grab *x11grab = s1->priv_data;
+    int i;
 
-    /* Detach cleanly from shared mem */
-    if (x11grab->use_shm) {
-        XShmDetach(x11grab->dpy, &x11grab->shminfo);
-        shmdt(x11grab->shminfo.shmaddr);
-        shmctl(x11grab->shminfo.shmid, IPC_RMID, NULL);
+#if HAVE_XDAMAGECREATE
+    if (x11grab->damage) {
+        XDamageDestroy(x11grab->dpy, x11grab->damage);
+        XFixesDestroyRegion(x11grab->dpy, x11grab->damage_region);
+    }
+#endif
+
+    /* Detach cleanly from shared mem, the segments still referenced by
+     * packets are only freed with the last of them */
+    for (i = 0; i < x11grab->nb_buffers; i++) {
+        X11GrabBuffer *buf = x11grab->buffers[i];
+        if (buf->attached)
+            XShmDetach(x11grab->dpy, &buf->shminfo);
+        buffer_unref(buf);
     }
+    x11grab->nb_buffers = 0;
 
     /* Destroy X11 image */
     if (x11grab->image) {
@@ -605,6 +863,8 @@ static const AVOption options[] = {
     { "framerate",  "set video frame rate",      OFFSET(framerate),   AV_OPT_TYPE_STRING,     {.str = "ntsc"}, 0, 0, DEC },
     { "show_region", "show the grabbing region", OFFSET(show_region), AV_OPT_TYPE_INT,        {.i64 = 0}, 0, 1, DEC },
     { "video_size",  "set video frame size",     OFFSET(width),       AV_OPT_TYPE_IMAGE_SIZE, {.str = "vga"}, 0, 0, DEC },
+    { "shm_buffers", "set maximum number of shared memory segments", OFFSET(max_buffers), AV_OPT_TYPE_INT, {.i64 = 4}, 1, MAX_SHM_BUFFERS, DEC },
+    { "damage",      "only grab the areas reported as changed", OFFSET(use_damage), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1, DEC },
     { NULL },
 };
 
@@ -34,11 +34,11 @@
 #include "libavutil/avstring.h"
 #include "libavutil/channel_layout.h"
 #include "libavutil/common.h"
-#include "libavutil/float_dsp.h"
 #include "libavutil/mathematics.h"
 #include "libavutil/opt.h"
 #include "libavutil/samplefmt.h"
 
+#include "af_amix.h"
 #include "audio.h"
 #include "avfilter.h"
 #include "formats.h"
@@ -56,11 +56,10 @@
 typedef struct FrameInfo {
     int nb_samples;
     int64_t pts;
-    struct FrameInfo *next;
 } FrameInfo;
 
 /**
- * Linked list used to store timestamps and frame sizes of all frames in the
+ * Ring buffer used to store timestamps and frame sizes of all frames in the
  * FIFO for the first input.
  *
  * This is needed to keep timestamps synchronized for the case where multiple
@@ -70,36 +69,46 @@ typedef struct FrameInfo {
 typedef struct FrameList {
     int nb_frames;
     int nb_samples;
-    FrameInfo *list;
-    FrameInfo *end;
+    int head;                   /**< index of the oldest frame */
+    int allocated;              /**< number of entries in frames */
+    FrameInfo *frames;
 } FrameList;
 
+#define FRAME_LIST_INIT_SIZE 16
+
+static int frame_list_init(FrameList *frame_list)
+{
+    frame_list->frames = av_malloc(FRAME_LIST_INIT_SIZE * sizeof(*frame_list->frames));
+    if (!frame_list->frames)
+        return AVERROR(ENOMEM);
+    frame_list->allocated = FRAME_LIST_INIT_SIZE;
+    return 0;
+}
+
 static void frame_list_clear(FrameList *frame_list)
 {
-    if (frame_list) {
-        while (frame_list->list) {
-            FrameInfo *info = frame_list->list;
-            frame_list->list = info->next;
-            av_free(info);
-        }
-        frame_list->nb_frames  = 0;
-        frame_list->nb_samples = 0;
-        frame_list->end        = NULL;
-    }
+    frame_list->nb_frames  = 0;
+    frame_list->nb_samples = 0;
+    frame_list->head       = 0;
+}
+
+static FrameInfo *frame_list_get(FrameList *frame_list, int idx)
+{
+    return &frame_list->frames[(frame_list->head + idx) % frame_list->allocated];
 }
 
 static int frame_list_next_frame_size(FrameList *frame_list)
 {
-    if (!frame_list->list)
+    if (!frame_list->nb_frames)
         return 0;
-    return frame_list->list->nb_samples;
+    return frame_list_get(frame_list, 0)->nb_samples;
 }
 
 static int64_t frame_list_next_pts(FrameList *frame_list)
 {
-    if (!frame_list->list)
+    if (!frame_list->nb_frames)
         return AV_NOPTS_VALUE;
-    return frame_list->list->pts;
+    return frame_list_get(frame_list, 0)->pts;
 }
 
 static void frame_list_remove_samples(FrameList *frame_list, int nb_samples)
@@ -109,16 +118,14 @@ static void frame_list_remove_samples(FrameList *frame_list, int nb_samples)
     } else {
         int samples = nb_samples;
         while (samples > 0) {
-            FrameInfo *info = frame_list->list;
-            av_assert0(info != NULL);
+            FrameInfo *info;
+            av_assert0(frame_list->nb_frames > 0);
+            info = frame_list_get(frame_list, 0);
             if (info->nb_samples <= samples) {
                 samples -= info->nb_samples;
-                frame_list->list = info->next;
-                if (!frame_list->list)
-                    frame_list->end = NULL;
+                frame_list->head = (frame_list->head + 1) % frame_list->allocated;
                 frame_list->nb_frames--;
                 frame_list->nb_samples -= info->nb_samples;
-                av_free(info);
             } else {
                 info->nb_samples       -= samples;
                 info->pts              += samples;
@@ -131,31 +138,34 @@ static void frame_list_remove_samples(FrameList *frame_list, int nb_samples)
 
 static int frame_list_add_frame(FrameList *frame_list, int nb_samples, int64_t pts)
 {
-    FrameInfo *info = av_malloc(sizeof(*info));
-    if (!info)
-        return AVERROR(ENOMEM);
+    FrameInfo *info;
+
+    if (frame_list->nb_frames == frame_list->allocated) {
+        int i, allocated = 2 * frame_list->allocated;
+        FrameInfo *frames = av_malloc_array(allocated, sizeof(*frames));
+        if (!frames)
+            return AVERROR(ENOMEM);
+        for (i = 0; i < frame_list->nb_frames; i++)
+            frames[i] = *frame_list_get(frame_list, i);
+        av_free(frame_list->frames);
+        frame_list->frames    = frames;
+        frame_list->allocated = allocated;
+        frame_list->head      = 0;
+    }
+
+    info = frame_list_get(frame_list, frame_list->nb_frames);
     info->nb_samples = nb_samples;
     info->pts        = pts;
-    info->next       = NULL;
 
-    if (!frame_list->list) {
-        frame_list->list = info;
-        frame_list->end  = info;
-    } else {
-        av_assert0(frame_list->end != NULL);
-        frame_list->end->next = info;
-        frame_list->end       = info;
-    }
     frame_list->nb_frames++;
     frame_list->nb_samples += nb_samples;
 
     return 0;
 }
 
-
 typedef struct MixContext {
     const AVClass *class;       /**< class for AVOptions */
-    AVFloatDSPContext fdsp;
+    AMixDSPContext dsp;
 
     int nb_inputs;              /**< number of inputs */
     int active_inputs;          /**< number of input currently active */
@@ -165,12 +175,23 @@ typedef struct MixContext {
     int nb_channels;            /**< number of channels */
     int sample_rate;            /**< sample rate */
     int planar;
+    enum AVSampleFormat sample_fmt;
+    int bps;                    /**< bytes per sample */
     AVAudioFifo **fifos;        /**< audio fifo for each input */
     uint8_t *input_state;       /**< current state of each input */
     float *input_scale;         /**< mixing scale factor for each input */
     float scale_norm;           /**< normalization factor for all inputs */
     int64_t next_pts;           /**< calculated pts for next output frame */
-    FrameList *frame_list;      /**< list of frame info for the first input */
+    FrameList frame_list;       /**< list of frame info for the first input */
+
+    /* mixing state, allocated for nb_inputs + 1 entries in config_output() */
+    int *mix_inputs;            /**< indexes of the inputs being mixed */
+    void *coefs;                /**< mixing coefficients in the format of dsp.mix() */
+    int shift;                  /**< fixed point precision of s16 coefs */
+    void **in_data;             /**< read pointers, nb_channels per mixed input */
+    const uint8_t **src;        /**< source pointers for one plane */
+    void (*mix_c)(uint8_t *dst, const uint8_t **src, const void *coefs,
+                  int nb_in, int len, int shift);
 } MixContext;
 
 #define OFFSET(x) offsetof(MixContext, x)
@@ -216,6 +237,51 @@ static void calculate_scales(MixContext *s, int nb_samples)
     }
 }
 
+static void mix_float_c(uint8_t *dst, const uint8_t **src, const void *coefs,
+                        int nb_in, int len, int shift)
+{
+    const float *coef = coefs;
+    float *out = (float *)dst;
+    int i, j;
+
+    for (i = 0; i < len; i++) {
+        float sum = ((const float *)src[0])[i] * coef[0];
+        for (j = 1; j < nb_in; j++)
+            sum += ((const float *)src[j])[i] * coef[j];
+        out[i] = sum;
+    }
+}
+
+static void mix_s16_c(uint8_t *dst, const uint8_t **src, const void *coefs,
+                      int nb_in, int len, int shift)
+{
+    const int16_t *coef = coefs;
+    int16_t *out = (int16_t *)dst;
+    int i, j;
+
+    for (i = 0; i < len; i++) {
+        int sum = 1 << (shift - 1);
+        for (j = 0; j < nb_in; j++)
+            sum += ((const int16_t *)src[j])[i] * coef[j];
+        out[i] = av_clip_int16(sum >> shift);
+    }
+}
+
+static void mix_s32_c(uint8_t *dst, const uint8_t **src, const void *coefs,
+                      int nb_in, int len, int shift)
+{
+    const int32_t *coef = coefs;
+    int32_t *out = (int32_t *)dst;
+    int i, j;
+
+    for (i = 0; i < len; i++) {
+        int64_t sum = 1 << 29;
+        for (j = 0; j < nb_in; j++)
+            sum += (int64_t)((const int32_t *)src[j])[i] * coef[j];
+        out[i] = av_clipl_int32(sum >> 30);
+    }
+}
+
 static int config_output(AVFilterLink *outlink)
 {
     AVFilterContext *ctx = outlink->src;
@@ -224,12 +290,13 @@ static int config_output(AVFilterLink *outlink)
     char buf[64];
 
     s->planar          = av_sample_fmt_is_planar(outlink->format);
+    s->sample_fmt      = av_get_packed_sample_fmt(outlink->format);
+    s->bps             = av_get_bytes_per_sample(outlink->format);
     s->sample_rate     = outlink->sample_rate;
     outlink->time_base = (AVRational){ 1, outlink->sample_rate };
     s->next_pts        = AV_NOPTS_VALUE;
 
-    s->frame_list = av_mallocz(sizeof(*s->frame_list));
-    if (!s->frame_list)
+    if (frame_list_init(&s->frame_list) < 0)
         return AVERROR(ENOMEM);
 
     s->fifos = av_mallocz(s->nb_inputs * sizeof(*s->fifos));
@@ -255,6 +322,25 @@ static int config_output(AVFilterLink *outlink)
     s->scale_norm = s->active_inputs;
     calculate_scales(s, 0);
 
+    s->mix_inputs = av_malloc_array(s->nb_inputs + 1, sizeof(*s->mix_inputs));
+    s->coefs      = av_malloc_array(s->nb_inputs + 1, sizeof(int32_t));
+    s->in_data    = av_malloc_array(s->nb_inputs * s->nb_channels, sizeof(*s->in_data));
+    s->src        = av_malloc_array(s->nb_inputs + 1, sizeof(*s->src));
+    if (!s->mix_inputs || !s->coefs || !s->in_data || !s->src)
+        return AVERROR(ENOMEM);
+
+    switch (s->sample_fmt) {
+    case AV_SAMPLE_FMT_FLT: s->mix_c = mix_float_c; break;
+    case AV_SAMPLE_FMT_S16: s->mix_c = mix_s16_c;   break;
+    case AV_SAMPLE_FMT_S32: s->mix_c = mix_s32_c;   break;
+    default:
+        av_assert0(0);
+    }
+    s->dsp.mix           = s->mix_c;
+    s->dsp.samples_align = 1;
+    if (ARCH_X86)
+        ff_amix_init_x86(&s->dsp, s->sample_fmt);
+
     av_get_channel_layout_string(buf, sizeof(buf), -1, outlink->channel_layout);
 
     av_log(ctx, AV_LOG_VERBOSE,
@@ -265,14 +351,71 @@ static int config_output(AVFilterLink *outlink)
 }
 
 /**
- * Read samples from the input FIFOs, mix, and write to the output link.
+ * Fill the list of inputs to mix and their mixing coefficients.
+ *
+ * @return the number of inputs to mix
+ */
+static int setup_mix_inputs(MixContext *s)
+{
+    float max_scale = 0.0f;
+    int i, nb_in = 0;
+
+    for (i = 0; i < s->nb_inputs; i++) {
+        if (s->input_state[i] == INPUT_ON) {
+            s->mix_inputs[nb_in++] = i;
+            max_scale = FFMAX(max_scale, s->input_scale[i]);
+        }
+    }
+
+    switch (s->sample_fmt) {
+    case AV_SAMPLE_FMT_FLT:
+        for (i = 0; i < nb_in; i++)
+            ((float *)s->coefs)[i] = s->input_scale[s->mix_inputs[i]];
+        break;
+    case AV_SAMPLE_FMT_S16:
+        /* Q15 unless a coefficient of 1.0 has to be represented */
+        s->shift = max_scale < 1.0f ? 15 : 14;
+        for (i = 0; i < nb_in; i++)
+            ((int16_t *)s->coefs)[i] = lrintf(s->input_scale[s->mix_inputs[i]] *
+                                              (1 << s->shift));
+        /* the padding input for an odd count gets a zero coefficient */
+        ((int16_t *)s->coefs)[nb_in] = 0;
+        break;
+    case AV_SAMPLE_FMT_S32:
+        for (i = 0; i < nb_in; i++)
+            ((int32_t *)s->coefs)[i] = lrintf(s->input_scale[s->mix_inputs[i]] *
+                                              (1 << 30));
+        break;
+    }
+    return nb_in;
+}
+
+static void mix_plane(MixContext *s, uint8_t *dst, int nb_in, int len)
+{
+    int i, len1 = len & ~(s->dsp.samples_align - 1);
+
+    if (len1)
+        s->dsp.mix(dst, s->src, s->coefs, nb_in, len1, s->shift);
+    if (len1 < len) {
+        for (i = 0; i < nb_in; i++)
+            s->src[i] += len1 * s->bps;
+        s->mix_c(dst + len1 * s->bps, s->src, s->coefs, nb_in, len - len1,
+                 s->shift);
+    }
+}
+
+/**
+ * Mix samples directly from the input FIFOs and write to the output link.
  */
 static int output_frame(AVFilterLink *outlink, int nb_samples)
 {
     AVFilterContext *ctx = outlink->src;
     MixContext      *s = ctx->priv;
-    AVFrame *out_buf, *in_buf;
-    int i;
+    AVFrame *out_buf;
+    int planes = s->planar ? s->nb_channels : 1;
+    int stride = s->bps * (s->planar ? 1 : s->nb_channels);
+    int offset = 0;
+    int i, p, nb_in, nb_mix;
 
     calculate_scales(s, nb_samples);
 
@@ -280,31 +423,37 @@ static int output_frame(AVFilterLink *outlink, int nb_samples)
     if (!out_buf)
         return AVERROR(ENOMEM);
 
-    in_buf = ff_get_audio_buffer(outlink, nb_samples);
-    if (!in_buf) {
-        av_frame_free(&out_buf);
-        return AVERROR(ENOMEM);
-    }
-
-    for (i = 0; i < s->nb_inputs; i++) {
-        if (s->input_state[i] == INPUT_ON) {
-            int planes, plane_size, p;
+    nb_in  = setup_mix_inputs(s);
+    nb_mix = s->sample_fmt == AV_SAMPLE_FMT_S16 ? FFALIGN(nb_in, 2) : nb_in;
 
-            av_audio_fifo_read(s->fifos[i], (void **)in_buf->extended_data,
-                               nb_samples);
+    /* The FIFOs are ring buffers, so mix in segments of samples which are
+     * contiguous in all of them. */
+    while (nb_in && offset < nb_samples) {
+        int len = nb_samples - offset;
 
-            planes     = s->planar ? s->nb_channels : 1;
-            plane_size = nb_samples * (s->planar ? 1 : s->nb_channels);
-            plane_size = FFALIGN(plane_size, 16);
+        for (i = 0; i < nb_in; i++)
+            len = FFMIN(len, av_audio_fifo_get_read_buffer(s->fifos[s->mix_inputs[i]],
+                                                s->in_data + i * s->nb_channels));
+        if (!len)
+            break;
 
-            for (p = 0; p < planes; p++) {
-                s->fdsp.vector_fmac_scalar((float *)out_buf->extended_data[p],
-                                           (float *) in_buf->extended_data[p],
-                                           s->input_scale[i], plane_size);
-            }
+        for (p = 0; p < planes; p++) {
+            for (i = 0; i < nb_in; i++)
+                s->src[i] = s->in_data[i * s->nb_channels + p];
+            for (; i < nb_mix; i++)
+                s->src[i] = s->src[nb_in - 1];
+            mix_plane(s, out_buf->extended_data[p] + offset * stride, nb_mix,
+                      len * (s->planar ? 1 : s->nb_channels));
         }
+
+        for (i = 0; i < nb_in; i++)
+            av_audio_fifo_drain(s->fifos[s->mix_inputs[i]], len);
+        offset += len;
     }
-    av_frame_free(&in_buf);
+    if (offset < nb_samples)
+        av_samples_set_silence(out_buf->extended_data, offset,
+                               nb_samples - offset, s->nb_channels,
+                               outlink->format);
 
     out_buf->pts = s->next_pts;
     if (s->next_pts != AV_NOPTS_VALUE)
@@ -411,7 +560,7 @@ static int request_frame(AVFilterLink *outlink)
         return output_frame(outlink, available_samples);
     }
 
-    if (s->frame_list->nb_frames == 0) {
+    if (s->frame_list.nb_frames == 0) {
         ret = ff_request_frame(ctx->inputs[0]);
         if (ret == AVERROR_EOF) {
             s->input_state[0] = INPUT_OFF;
@@ -422,9 +571,9 @@ static int request_frame(AVFilterLink *outlink)
         } else if (ret < 0)
             return ret;
     }
-    av_assert0(s->frame_list->nb_frames > 0);
+    av_assert0(s->frame_list.nb_frames > 0);
 
-    wanted_samples = frame_list_next_frame_size(s->frame_list);
+    wanted_samples = frame_list_next_frame_size(&s->frame_list);
 
     if (s->active_inputs > 1) {
         ret = request_samples(ctx, wanted_samples);
@@ -445,10 +594,22 @@ static int request_frame(AVFilterLink *outlink)
         available_samples = wanted_samples;
     }
 
-    s->next_pts = frame_list_next_pts(s->frame_list);
-    frame_list_remove_samples(s->frame_list, available_samples);
+    s->next_pts = frame_list_next_pts(&s->frame_list);
+    frame_list_remove_samples(&s->frame_list, available_samples);
+
+    ret = output_frame(outlink, available_samples);
 
-    return output_frame(outlink, available_samples);
+    /* Mix all queued frames of the first input for which the other inputs
+     * already have samples, instead of polling the inputs again for each. */
+    while (ret >= 0 && s->frame_list.nb_frames) {
+        wanted_samples = frame_list_next_frame_size(&s->frame_list);
+        if (s->active_inputs > 1 && get_available_samples(s) < wanted_samples)
+            break;
+        s->next_pts = frame_list_next_pts(&s->frame_list);
+        frame_list_remove_samples(&s->frame_list, wanted_samples);
+        ret = output_frame(outlink, wanted_samples);
+    }
+    return ret;
 }
 
 static int filter_frame(AVFilterLink *inlink, AVFrame *buf)
@@ -470,7 +631,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *buf)
     if (i == 0) {
         int64_t pts = av_rescale_q(buf->pts, inlink->time_base,
                                    outlink->time_base);
-        ret = frame_list_add_frame(s->frame_list, buf->nb_samples, pts);
+        ret = frame_list_add_frame(&s->frame_list, buf->nb_samples, pts);
         if (ret < 0)
             goto fail;
     }
@@ -501,8 +662,6 @@ static av_cold int init(AVFilterContext *ctx)
         ff_insert_inpad(ctx, i, &pad);
     }
 
-    avpriv_float_dsp_init(&s->fdsp, 0);
-
     return 0;
 }
 
@@ -516,10 +675,13 @@ static av_cold void uninit(AVFilterContext *ctx)
             av_audio_fifo_free(s->fifos[i]);
         av_freep(&s->fifos);
     }
-    frame_list_clear(s->frame_list);
-    av_freep(&s->frame_list);
+    av_freep(&s->frame_list.frames);
     av_freep(&s->input_state);
     av_freep(&s->input_scale);
+    av_freep(&s->mix_inputs);
+    av_freep(&s->coefs);
+    av_freep(&s->in_data);
+    av_freep(&s->src);
 
     for (i = 0; i < ctx->nb_inputs; i++)
         av_freep(&ctx->input_pads[i].name);
@@ -530,6 +692,10 @@ static int query_formats(AVFilterContext *ctx)
     AVFilterFormats *formats = NULL;
     ff_add_format(&formats, AV_SAMPLE_FMT_FLT);
     ff_add_format(&formats, AV_SAMPLE_FMT_FLTP);
+    ff_add_format(&formats, AV_SAMPLE_FMT_S16);
+    ff_add_format(&formats, AV_SAMPLE_FMT_S16P);
+    ff_add_format(&formats, AV_SAMPLE_FMT_S32);
+    ff_add_format(&formats, AV_SAMPLE_FMT_S32P);
     ff_set_common_formats(ctx, formats);
     ff_set_common_channel_layouts(ctx, ff_all_channel_layouts());
     ff_set_common_samplerates(ctx, ff_all_samplerates());
@@ -0,0 +1,51 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * audio mix filter
+ */
+
+#ifndef AVFILTER_AF_AMIX_H
+#define AVFILTER_AF_AMIX_H
+
+#include <stdint.h>
+
+#include "libavutil/samplefmt.h"
+
+typedef struct AMixDSPContext {
+    /**
+     * Mix nb_in source buffers into dst.
+     *
+     * dst[i] = sum(src[j][i] * coefs[j]) for j in [0, nb_in).
+     * For floating point formats coefs is an array of float. For s16 it is
+     * an array of int16_t in Q(shift), and nb_in is always even, so inputs
+     * can be processed in pairs. For s32 it is an array of int32_t in Q30.
+     * Integer results are rounded and saturated.
+     *
+     * @param len number of samples in each buffer, a multiple of
+     *            samples_align for the SIMD versions
+     */
+    void (*mix)(uint8_t *dst, const uint8_t **src, const void *coefs,
+                int nb_in, int len, int shift);
+    int samples_align;
+} AMixDSPContext;
+
+void ff_amix_init_x86(AMixDSPContext *dsp, enum AVSampleFormat sample_fmt);
+
+#endif /* AVFILTER_AF_AMIX_H */
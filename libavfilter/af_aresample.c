@@ -37,6 +37,8 @@
 typedef struct {
     const AVClass *class;
     int sample_rate_arg;
+    int frame_size;
+    int low_delay;
     double ratio;
     struct SwrContext *swr;
     int64_t next_pts;
@@ -55,6 +57,10 @@ static av_cold int init_dict(AVFilterContext *ctx, AVDictionary **opts)
         goto end;
     }
 
+    /* a short filter, the user can still override its size */
+    if (aresample->low_delay)
+        av_opt_set_int(aresample->swr, "filter_size", 8, 0);
+
     if (opts) {
         AVDictionaryEntry *e = NULL;
 
@@ -132,6 +138,7 @@ static int config_output(AVFilterLink *outlink)
     uint64_t out_layout;
     enum AVSampleFormat out_format;
     char inchl_buf[128], outchl_buf[128];
+    int64_t delay;
 
     aresample->swr = swr_alloc_set_opts(aresample->swr,
                                         outlink->channel_layout, outlink->format, outlink->sample_rate,
@@ -159,6 +166,18 @@ static int config_output(AVFilterLink *outlink)
 
     aresample->ratio = (double)outlink->sample_rate / inlink->sample_rate;
 
+    if (aresample->frame_size) {
+        outlink->min_samples =
+        outlink->max_samples =
+        outlink->partial_buf_size = aresample->frame_size;
+    }
+
+    delay = swr_get_lookahead(aresample->swr, outlink->sample_rate);
+    if (delay >= 0)
+        av_log(ctx, aresample->low_delay || aresample->frame_size ? AV_LOG_INFO : AV_LOG_VERBOSE,
+               "algorithmic delay:%"PRId64" samples, framing delay:%d samples\n",
+               delay, FFMAX(aresample->frame_size - 1, 0));
+
     av_get_channel_layout_string(inchl_buf,  sizeof(inchl_buf),  inlink ->channels, inlink ->channel_layout);
     av_get_channel_layout_string(outchl_buf, sizeof(outchl_buf), outlink->channels, outlink->channel_layout);
 
@@ -267,6 +286,8 @@ static void *resample_child_next(void *obj, void *prev)
 
 static const AVOption options[] = {
     {"sample_rate", NULL, OFFSET(sample_rate_arg), AV_OPT_TYPE_INT, {.i64=0},  0,        INT_MAX, FLAGS },
+    {"frame_size",  "set the number of samples of the output frames", OFFSET(frame_size), AV_OPT_TYPE_INT, {.i64=0}, 0, INT_MAX, FLAGS },
+    {"low_delay",   "use a short resampling filter", OFFSET(low_delay), AV_OPT_TYPE_INT, {.i64=0}, 0, 1, FLAGS },
     {NULL}
 };
 
@@ -100,17 +100,27 @@ static int push_samples(AVFilterLink *outlink)
     if (!nb_out_samples)
         return 0;
 
-    outsamples = ff_get_audio_buffer(outlink, nb_out_samples);
-    if (!outsamples)
-        return AVERROR(ENOMEM);
+    if (nb_pad_samples) {
+        outsamples = ff_get_audio_buffer(outlink, nb_out_samples);
+        if (!outsamples)
+            return AVERROR(ENOMEM);
 
-    av_audio_fifo_read(asns->fifo,
-                       (void **)outsamples->extended_data, nb_out_samples);
+        av_audio_fifo_read(asns->fifo,
+                           (void **)outsamples->extended_data, nb_out_samples);
 
-    if (nb_pad_samples)
         av_samples_set_silence(outsamples->extended_data, nb_out_samples - nb_pad_samples,
                                nb_pad_samples, av_get_channel_layout_nb_channels(outlink->channel_layout),
                                outlink->format);
+    } else {
+        /* shares the FIFO storage instead of copying when possible */
+        outsamples = av_frame_alloc();
+        if (!outsamples)
+            return AVERROR(ENOMEM);
+        if ((ret = av_audio_fifo_read_frame(asns->fifo, outsamples, nb_out_samples)) < 0) {
+            av_frame_free(&outsamples);
+            return ret;
+        }
+    }
     outsamples->nb_samples     = nb_out_samples;
     outsamples->channel_layout = outlink->channel_layout;
     outsamples->sample_rate    = outlink->sample_rate;
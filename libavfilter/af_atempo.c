@@ -47,6 +47,7 @@
 #include "libavutil/opt.h"
 #include "libavutil/samplefmt.h"
 #include "avfilter.h"
+#include "af_atempo.h"
 #include "audio.h"
 #include "internal.h"
 
@@ -140,6 +141,7 @@ typedef struct {
     RDFTContext *real_to_complex;
     RDFTContext *complex_to_real;
     FFTSample *correlation;
+    ATempoDSPContext dsp;
 
     // for managing AVFilterPad.request_frame and AVFilterPad.filter_frame
     AVFrame *dst_buffer;
@@ -383,15 +385,17 @@ static int yae_set_tempo(AVFilterContext *ctx, const char *arg_tempo)
                     si = FFMIN((FFTSample)scalar_max,                   \
                                (FFTSample)fabsf(ti));                   \
                                                                         \
-                    if (s < si) {                                       \
-                        s   = si;                                       \
-                        max = ti;                                       \
-                    }                                                   \
+                    max = s < si ? ti : max;                            \
+                    s   = FFMAX(s, si);                                 \
                 }                                                       \
                                                                         \
                 *xdat = max;                                            \
             }                                                           \
         }                                                               \
+                                                                        \
+        /* zero-pad the rest of the rDFT input */                       \
+        memset(xdat, 0, (frag->xdat + 2 * atempo->window - xdat) *      \
+               sizeof(*xdat));                                          \
     } while (0)
 
 /**
@@ -403,9 +407,6 @@ static void yae_downmix(ATempoContext *atempo, AudioFragment *frag)
     // shortcuts:
     const uint8_t *src = frag->data;
 
-    // init complex data buffer used for FFT and Correlation:
-    memset(frag->xdat, 0, sizeof(FFTComplex) * atempo->window);
-
     if (atempo->format == AV_SAMPLE_FMT_U8) {
         yae_init_xdat(uint8_t, 127);
     } else if (atempo->format == AV_SAMPLE_FMT_S16) {
@@ -597,6 +598,39 @@ static void yae_advance_to_next_frag(ATempoContext *atempo)
     frag->nsamples    = 0;
 }
 
+static void xcorr_mul_c(FFTComplex *xc, const FFTComplex *xa,
+                        const FFTComplex *xb, int len)
+{
+    int i;
+
+    for (i = 0; i < len; i++, xa++, xb++, xc++) {
+        xc->re = (xa->re * xb->re + xa->im * xb->im);
+        xc->im = (xa->im * xb->re - xa->re * xb->im);
+    }
+}
+
+static int find_peak_c(const FFTSample *xcorr, int len, int drift, int span)
+{
+    FFTSample best_metric = -FLT_MAX;
+    int best = -1;
+    int i;
+
+    for (i = 0; i < len; i++) {
+        FFTSample metric = xcorr[i];
+
+        // normalize:
+        FFTSample drifti = (FFTSample)(drift + i);
+        metric *= drifti * (FFTSample)i * (FFTSample)(span - i);
+
+        if (metric > best_metric) {
+            best_metric = metric;
+            best = i;
+        }
+    }
+
+    return best;
+}
+
 /**
  * Calculate cross-correlation via rDFT.
  *
@@ -605,12 +639,14 @@ static void yae_advance_to_next_frag(ATempoContext *atempo)
  */
 static void yae_xcorr_via_rdft(FFTSample *xcorr,
                                RDFTContext *complex_to_real,
+                               const ATempoDSPContext *dsp,
                                const FFTComplex *xa,
                                const FFTComplex *xb,
                                const int window)
 {
     FFTComplex *xc = (FFTComplex *)xcorr;
-    int i;
+
+    dsp->xcorr_mul(xc, xa, xb, window);
 
     // NOTE: first element requires special care -- Given Y = rDFT(X),
     // Im(Y[0]) and Im(Y[N/2]) are always zero, therefore av_rdft_calc
@@ -618,14 +654,6 @@ static void yae_xcorr_via_rdft(FFTSample *xcorr,
 
     xc->re = xa->re * xb->re;
     xc->im = xa->im * xb->im;
-    xa++;
-    xb++;
-    xc++;
-
-    for (i = 1; i < window; i++, xa++, xb++, xc++) {
-        xc->re = (xa->re * xb->re + xa->im * xb->im);
-        xc->im = (xa->im * xb->re - xa->re * xb->im);
-    }
 
     // apply inverse rDFT:
     av_rdft_calc(complex_to_real, xcorr);
@@ -643,18 +671,18 @@ static int yae_align(AudioFragment *frag,
                      const int delta_max,
                      const int drift,
                      FFTSample *correlation,
-                     RDFTContext *complex_to_real)
+                     RDFTContext *complex_to_real,
+                     const ATempoDSPContext *dsp)
 {
-    int       best_offset = -drift;
-    FFTSample best_metric = -FLT_MAX;
-    FFTSample *xcorr;
+    int best_offset = -drift;
+    int peak;
 
     int i0;
     int i1;
-    int i;
 
     yae_xcorr_via_rdft(correlation,
                        complex_to_real,
+                       dsp,
                        (const FFTComplex *)prev->xdat,
                        (const FFTComplex *)frag->xdat,
                        window);
@@ -667,20 +695,9 @@ static int yae_align(AudioFragment *frag,
     i1 = FFMAX(i1, 0);
 
     // identify cross-correlation peaks within search window:
-    xcorr = correlation + i0;
-
-    for (i = i0; i < i1; i++, xcorr++) {
-        FFTSample metric = *xcorr;
-
-        // normalize:
-        FFTSample drifti = (FFTSample)(drift + i);
-        metric *= drifti * (FFTSample)(i - i0) * (FFTSample)(i1 - i);
-
-        if (metric > best_metric) {
-            best_metric = metric;
-            best_offset = i - window / 2;
-        }
-    }
+    peak = dsp->find_peak(correlation + i0, i1 - i0, drift + i0, i1 - i0);
+    if (peak >= 0)
+        best_offset = i0 + peak - window / 2;
 
     return best_offset;
 }
@@ -712,7 +729,8 @@ static int yae_adjust_position(ATempoContext *atempo)
                                      delta_max,
                                      drift,
                                      atempo->correlation,
-                                     atempo->complex_to_real);
+                                     atempo->complex_to_real,
+                                     &atempo->dsp);
 
     if (correction) {
         // adjust fragment position:
@@ -736,25 +754,32 @@ static int yae_adjust_position(ATempoContext *atempo)
                                                                         \
         scalar_type *out     = (scalar_type *)dst;                      \
         scalar_type *out_end = (scalar_type *)dst_end;                  \
-        int64_t i;                                                      \
+        const int channels   = atempo->channels;                        \
+        const int64_t n      = FFMIN(overlap,                           \
+                                     (out_end - out) / channels);       \
+        int64_t i = FFMIN(FFMAX(-frag->position[0], 0), n);             \
                                                                         \
-        for (i = 0; i < overlap && out < out_end;                       \
-             i++, atempo->position[1]++, wa++, wb++) {                  \
+        /* samples before the start of the stream are copied as is */   \
+        memcpy(out, aaa, i * channels * sizeof(scalar_type));           \
+        aaa += i * channels;                                            \
+        bbb += i * channels;                                            \
+        out += i * channels;                                            \
+        wa  += i;                                                       \
+        wb  += i;                                                       \
+                                                                        \
+        for (; i < n; i++, wa++, wb++) {                                \
             float w0 = *wa;                                             \
             float w1 = *wb;                                             \
             int j;                                                      \
                                                                         \
-            for (j = 0; j < atempo->channels;                           \
-                 j++, aaa++, bbb++, out++) {                            \
+            for (j = 0; j < channels; j++, aaa++, bbb++, out++) {       \
                 float t0 = (float)*aaa;                                 \
                 float t1 = (float)*bbb;                                 \
                                                                         \
-                *out =                                                  \
-                    frag->position[0] + i < 0 ?                         \
-                    *aaa :                                              \
-                    (scalar_type)(t0 * w0 + t1 * w1);                   \
+                *out = (scalar_type)(t0 * w0 + t1 * w1);                \
             }                                                           \
         }                                                               \
+        atempo->position[1] += n;                                       \
         dst = (uint8_t *)out;                                           \
     } while (0)
 
@@ -978,6 +1003,11 @@ static av_cold int init(AVFilterContext *ctx)
     ATempoContext *atempo = ctx->priv;
     atempo->format = AV_SAMPLE_FMT_NONE;
     atempo->state  = YAE_LOAD_FRAGMENT;
+
+    atempo->dsp.xcorr_mul = xcorr_mul_c;
+    atempo->dsp.find_peak = find_peak_c;
+    if (ARCH_X86)
+        ff_atempo_init_x86(&atempo->dsp);
     return 0;
 }
 
@@ -0,0 +1,55 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * tempo scaling audio filter
+ */
+
+#ifndef AVFILTER_AF_ATEMPO_H
+#define AVFILTER_AF_ATEMPO_H
+
+#include "libavcodec/avfft.h"
+
+typedef struct ATempoDSPContext {
+    /**
+     * Multiply xa by the complex conjugate of xb.
+     *
+     * xc[i].re = xa[i].re * xb[i].re + xa[i].im * xb[i].im
+     * xc[i].im = xa[i].im * xb[i].re - xa[i].re * xb[i].im
+     *
+     * @param xc  output, must not overlap the inputs, 16-byte aligned
+     * @param xa  16-byte aligned
+     * @param xb  16-byte aligned
+     * @param len number of complex values, a multiple of 4
+     */
+    void (*xcorr_mul)(FFTComplex *xc, const FFTComplex *xa,
+                      const FFTComplex *xb, int len);
+
+    /**
+     * Find the first peak of the normalized cross-correlation
+     * xcorr[i] * ((drift + i) * i * (span - i)) for i in [0, len).
+     *
+     * @return index of the peak, or -1 if no value exceeds -FLT_MAX
+     */
+    int (*find_peak)(const FFTSample *xcorr, int len, int drift, int span);
+} ATempoDSPContext;
+
+void ff_atempo_init_x86(ATempoDSPContext *dsp);
+
+#endif /* AVFILTER_AF_ATEMPO_H */
@@ -187,6 +187,7 @@ static av_cold void volume_init(VolumeContext *vol)
         break;
     case AV_SAMPLE_FMT_FLT:
         avpriv_float_dsp_init(&vol->fdsp, 0);
+        vol->scale_samples_flt = vol->fdsp.vector_fmul_scalar;
         vol->samples_align = 4;
         break;
     case AV_SAMPLE_FMT_DBL:
@@ -250,9 +251,9 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *buf)
             }
         } else if (av_get_packed_sample_fmt(vol->sample_fmt) == AV_SAMPLE_FMT_FLT) {
             for (p = 0; p < vol->planes; p++) {
-                vol->fdsp.vector_fmul_scalar((float *)out_buf->extended_data[p],
-                                             (const float *)buf->extended_data[p],
-                                             vol->volume, plane_samples);
+                vol->scale_samples_flt((float *)out_buf->extended_data[p],
+                                       (const float *)buf->extended_data[p],
+                                       vol->volume, plane_samples);
             }
         } else {
             for (p = 0; p < vol->planes; p++) {
@@ -47,6 +47,8 @@ typedef struct VolumeContext {
 
     void (*scale_samples)(uint8_t *dst, const uint8_t *src, int nb_samples,
                           int volume);
+    void (*scale_samples_flt)(float *dst, const float *src, float volume,
+                              int nb_samples);
     int samples_align;
 } VolumeContext;
 
@@ -62,6 +62,7 @@ typedef struct {
     double duration;
     uint64_t n;
     double var_values[VAR_VARS_NB];
+    double *n_values, *t_values;    ///< values of n and t for each sample of a frame
 } EvalContext;
 
 #define OFFSET(x) offsetof(EvalContext, x)
@@ -147,6 +148,11 @@ static int init(AVFilterContext *ctx)
     }
     eval->n = 0;
 
+    eval->n_values = av_malloc_array(eval->nb_samples, sizeof(*eval->n_values));
+    eval->t_values = av_malloc_array(eval->nb_samples, sizeof(*eval->t_values));
+    if (!eval->n_values || !eval->t_values)
+        ret = AVERROR(ENOMEM);
+
 end:
     av_free(args1);
     return ret;
@@ -164,6 +170,8 @@ static av_cold void uninit(AVFilterContext *ctx)
     av_freep(&eval->chlayout_str);
     av_freep(&eval->duration_str);
     av_freep(&eval->sample_rate_str);
+    av_freep(&eval->n_values);
+    av_freep(&eval->t_values);
 }
 
 static int config_props(AVFilterLink *outlink)
@@ -205,6 +213,10 @@ static int request_frame(AVFilterLink *outlink)
     AVFrame *samplesref;
     int i, j;
     double t = eval->n * (double)1/eval->sample_rate;
+    const double *var_values[VAR_VARS_NB] = {
+        [VAR_N] = eval->n_values,
+        [VAR_T] = eval->t_values,
+    };
 
     if (eval->duration >= 0 && t >= eval->duration)
         return AVERROR_EOF;
@@ -213,16 +225,14 @@ static int request_frame(AVFilterLink *outlink)
     if (!samplesref)
         return AVERROR(ENOMEM);
 
-    /* evaluate expression for each single sample and for each channel */
+    /* evaluate expression for all the samples of each channel */
     for (i = 0; i < eval->nb_samples; i++, eval->n++) {
-        eval->var_values[VAR_N] = eval->n;
-        eval->var_values[VAR_T] = eval->var_values[VAR_N] * (double)1/eval->sample_rate;
-
-        for (j = 0; j < eval->nb_channels; j++) {
-            *((double *) samplesref->extended_data[j] + i) =
-                av_expr_eval(eval->expr[j], eval->var_values, NULL);
-        }
+        eval->n_values[i] = eval->n;
+        eval->t_values[i] = eval->n_values[i] * (double)1/eval->sample_rate;
     }
+    for (j = 0; j < eval->nb_channels; j++)
+        av_expr_eval_array(eval->expr[j], (double *)samplesref->extended_data[j],
+                           eval->nb_samples, eval->var_values, var_values, NULL);
 
     samplesref->pts = eval->pts;
     samplesref->sample_rate = eval->sample_rate;
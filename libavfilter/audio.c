@@ -26,6 +26,7 @@
 
 #include "audio.h"
 #include "avfilter.h"
+#include "framepool.h"
 #include "internal.h"
 
 int avfilter_ref_get_channels(AVFilterBufferRef *ref)
@@ -38,59 +39,70 @@ AVFrame *ff_null_get_audio_buffer(AVFilterLink *link, int nb_samples)
     return ff_get_audio_buffer(link->dst->outputs[0], nb_samples);
 }
 
+#define BUFFER_ALIGN 0
+
 AVFrame *ff_default_get_audio_buffer(AVFilterLink *link, int nb_samples)
 {
-    AVFrame *frame = av_frame_alloc();
+    AVFrame *frame = NULL;
     int channels = link->channels;
-    int buf_size, ret;
+    int pool_channels = 0;
+    int pool_nb_samples = 0;
+    int pool_align = 0;
+    enum AVSampleFormat pool_format = AV_SAMPLE_FMT_NONE;
 
     av_assert0(channels == av_get_channel_layout_nb_channels(link->channel_layout) || !av_get_channel_layout_nb_channels(link->channel_layout));
 
+    if (!link->frame_pool) {
+        link->frame_pool = ff_frame_pool_audio_init(av_buffer_alloc, channels,
+                                                    nb_samples, link->format, BUFFER_ALIGN);
+        if (!link->frame_pool)
+            return NULL;
+    } else {
+        if (ff_frame_pool_get_audio_config(link->frame_pool,
+                                           &pool_channels, &pool_nb_samples,
+                                           &pool_format, &pool_align) < 0) {
+            return NULL;
+        }
+
+        /* frames smaller than the pooled buffers reuse them */
+        if (pool_channels != channels || pool_nb_samples < nb_samples ||
+            pool_format != link->format || pool_align != BUFFER_ALIGN) {
+
+            ff_frame_pool_uninit((FFFramePool **)&link->frame_pool);
+            link->frame_pool = ff_frame_pool_audio_init(av_buffer_alloc, channels,
+                                                        nb_samples, link->format, BUFFER_ALIGN);
+            if (!link->frame_pool)
+                return NULL;
+        }
+    }
+
+    frame = ff_frame_pool_get(link->frame_pool);
     if (!frame)
         return NULL;
 
-    buf_size = av_samples_get_buffer_size(NULL, channels, nb_samples,
-                                          link->format, 0);
-    if (buf_size < 0)
-        goto fail;
-
-    frame->buf[0] = av_buffer_alloc(buf_size);
-    if (!frame->buf[0])
-        goto fail;
-
     frame->nb_samples = nb_samples;
-    ret = avcodec_fill_audio_frame(frame, channels, link->format,
-                                   frame->buf[0]->data, buf_size, 0);
-    if (ret < 0)
-        goto fail;
-
-    av_samples_set_silence(frame->extended_data, 0, nb_samples, channels,
-                           link->format);
-
-    frame->nb_samples     = nb_samples;
-    frame->format         = link->format;
-    av_frame_set_channels(frame, link->channels);
     frame->channel_layout = link->channel_layout;
-    frame->sample_rate    = link->sample_rate;
+    frame->sample_rate = link->sample_rate;
 
-    return frame;
+    av_samples_set_silence(frame->extended_data, 0, nb_samples, channels, link->format);
 
-fail:
-    av_buffer_unref(&frame->buf[0]);
-    av_frame_free(&frame);
-    return NULL;
+    return frame;
 }
 
 AVFrame *ff_get_audio_buffer(AVFilterLink *link, int nb_samples)
 {
     AVFrame *ret = NULL;
 
-    if (link->dstpad->get_audio_buffer)
+    /* the destination of a link crossing threads is running concurrently */
+    if (link->dstpad->get_audio_buffer && !link->pipe)
         ret = link->dstpad->get_audio_buffer(link, nb_samples);
 
     if (!ret)
         ret = ff_default_get_audio_buffer(link, nb_samples);
 
+    if (ret)
+        ff_filter_stats_add_alloc(link->src, ret);
+
     return ret;
 }
 
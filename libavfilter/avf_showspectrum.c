@@ -30,6 +30,7 @@
 #include "libavcodec/avfft.h"
 #include "libavutil/avassert.h"
 #include "libavutil/channel_layout.h"
+#include "libavutil/float_dsp.h"
 #include "libavutil/opt.h"
 #include "avfilter.h"
 #include "internal.h"
@@ -57,7 +58,12 @@ typedef struct {
     int filled;                 ///< number of samples (per channel) filled in current rdft_buffer
     int consumed;               ///< number of samples (per channel) consumed from the input frame
     float *window_func_lut;     ///< Window function LUT
-    float *combine_buffer;      ///< color combining buffer (3 * h items)
+    float *combine_buffer;      ///< color combining buffer (3 planes of combine_size items)
+    int combine_stride;         ///< channel height rounded up for the float DSP functions
+    int combine_size;           ///< combine_stride items for each channel
+    float *magnitudes;          ///< scaled magnitudes of the current channel (combine_stride items)
+    float (*color_lut)[3];      ///< YUV colors of the intensity coloring (COLOR_LUT_SIZE + 1 items)
+    AVFloatDSPContext fdsp;
 } ShowSpectrumContext;
 
 #define OFFSET(x) offsetof(ShowSpectrumContext, x)
@@ -97,12 +103,48 @@ static const struct {
     {    1,                  1,                  0,                   0 }
 };
 
+/* number of intervals in the color LUT, fine enough to stay well below one
+ * output level from the interpolated table */
+#define COLOR_LUT_SIZE 4096
+
+static void pick_color(float a, float *yuv)
+{
+    int i;
+
+    for (i = 1; i < FF_ARRAY_ELEMS(intensity_color_table) - 1; i++)
+        if (intensity_color_table[i].a >= a)
+            break;
+    // i now is the first item >= the color
+    // now we know to interpolate between item i - 1 and i
+    if (a <= intensity_color_table[i - 1].a) {
+        yuv[0] = intensity_color_table[i - 1].y;
+        yuv[1] = intensity_color_table[i - 1].u;
+        yuv[2] = intensity_color_table[i - 1].v;
+    } else if (a >= intensity_color_table[i].a) {
+        yuv[0] = intensity_color_table[i].y;
+        yuv[1] = intensity_color_table[i].u;
+        yuv[2] = intensity_color_table[i].v;
+    } else {
+        float start = intensity_color_table[i - 1].a;
+        float end = intensity_color_table[i].a;
+        float lerpfrac = (a - start) / (end - start);
+        yuv[0] = intensity_color_table[i - 1].y * (1.0f - lerpfrac)
+               + intensity_color_table[i].y * lerpfrac;
+        yuv[1] = intensity_color_table[i - 1].u * (1.0f - lerpfrac)
+               + intensity_color_table[i].u * lerpfrac;
+        yuv[2] = intensity_color_table[i - 1].v * (1.0f - lerpfrac)
+               + intensity_color_table[i].v * lerpfrac;
+    }
+}
+
 static av_cold void uninit(AVFilterContext *ctx)
 {
     ShowSpectrumContext *showspectrum = ctx->priv;
     int i;
 
     av_freep(&showspectrum->combine_buffer);
+    av_freep(&showspectrum->magnitudes);
+    av_freep(&showspectrum->color_lut);
     av_rdft_end(showspectrum->rdft);
     for (i = 0; i < showspectrum->nb_display_channels; i++)
         av_freep(&showspectrum->rdft_data[i]);
@@ -196,9 +238,9 @@ static int config_output(AVFilterLink *outlink)
         showspectrum->filled = 0;
 
         /* pre-calc windowing function (hann here) */
+        av_freep(&showspectrum->window_func_lut);
         showspectrum->window_func_lut =
-            av_realloc_f(showspectrum->window_func_lut, win_size,
-                         sizeof(*showspectrum->window_func_lut));
+            av_malloc_array(win_size, sizeof(*showspectrum->window_func_lut));
         if (!showspectrum->window_func_lut)
             return AVERROR(ENOMEM);
         for (i = 0; i < win_size; i++)
@@ -221,9 +263,27 @@ static int config_output(AVFilterLink *outlink)
     if (showspectrum->xpos >= outlink->w)
         showspectrum->xpos = 0;
 
-    showspectrum->combine_buffer =
-        av_realloc_f(showspectrum->combine_buffer, outlink->h * 3,
-                     sizeof(*showspectrum->combine_buffer));
+    /* the buffers are aligned and padded for the float DSP functions */
+    showspectrum->combine_stride = FFALIGN(h, 16);
+    showspectrum->combine_size   = showspectrum->combine_stride * inlink->channels;
+    av_freep(&showspectrum->combine_buffer);
+    av_freep(&showspectrum->magnitudes);
+    showspectrum->combine_buffer = av_malloc_array(3 * showspectrum->combine_size,
+                                                   sizeof(*showspectrum->combine_buffer));
+    showspectrum->magnitudes = av_mallocz(showspectrum->combine_stride *
+                                          sizeof(*showspectrum->magnitudes));
+    if (!showspectrum->combine_buffer || !showspectrum->magnitudes)
+        return AVERROR(ENOMEM);
+
+    if (showspectrum->color_mode == INTENSITY && !showspectrum->color_lut) {
+        showspectrum->color_lut = av_malloc_array(COLOR_LUT_SIZE + 1,
+                                                  sizeof(*showspectrum->color_lut));
+        if (!showspectrum->color_lut)
+            return AVERROR(ENOMEM);
+        for (i = 0; i <= COLOR_LUT_SIZE; i++)
+            pick_color(i / (float)COLOR_LUT_SIZE, showspectrum->color_lut[i]);
+    }
+    avpriv_float_dsp_init(&showspectrum->fdsp, 0);
 
     av_log(ctx, AV_LOG_VERBOSE, "s:%dx%d RDFT window size:%d\n",
            showspectrum->w, showspectrum->h, win_size);
@@ -283,7 +343,7 @@ static int plot_spectrum_column(AVFilterLink *inlink, AVFrame *insamples, int nb
 
         p += showspectrum->consumed;
         for (n = 0; n < add_samples; n++)
-            showspectrum->rdft_data[ch][start + n] = p[n] * showspectrum->window_func_lut[start + n];
+            showspectrum->rdft_data[ch][start + n] = p[n];
     }
     showspectrum->filled += add_samples;
 
@@ -293,24 +353,31 @@ static int plot_spectrum_column(AVFilterLink *inlink, AVFrame *insamples, int nb
         /* channel height */
         int h = showspectrum->channel_height;
 
-        /* run RDFT on each samples set */
-        for (ch = 0; ch < showspectrum->nb_display_channels; ch++)
-            av_rdft_calc(showspectrum->rdft, showspectrum->rdft_data[ch]);
-
-        /* fill a new spectrum column */
-#define RE(y, ch) showspectrum->rdft_data[ch][2 * y + 0]
-#define IM(y, ch) showspectrum->rdft_data[ch][2 * y + 1]
-#define MAGNITUDE(y, ch) hypot(RE(y, ch), IM(y, ch))
+        /* apply the window and run RDFT on each samples set */
+        for (ch = 0; ch < showspectrum->nb_display_channels; ch++) {
+            FFTSample *data = showspectrum->rdft_data[ch];
+
+            if (win_size % 16) {
+                for (n = 0; n < win_size; n++)
+                    data[n] *= showspectrum->window_func_lut[n];
+            } else {
+                showspectrum->fdsp.vector_fmul(data, data, showspectrum->window_func_lut,
+                                               win_size);
+            }
+            av_rdft_calc(showspectrum->rdft, data);
+        }
 
         /* initialize buffer for combining to black */
-        for (y = 0; y < outlink->h; y++) {
-            showspectrum->combine_buffer[3 * y    ] = 0;
-            showspectrum->combine_buffer[3 * y + 1] = 127.5;
-            showspectrum->combine_buffer[3 * y + 2] = 127.5;
+        for (plane = 0; plane < 3; plane++) {
+            float *buf = showspectrum->combine_buffer + plane * showspectrum->combine_size;
+            for (n = 0; n < showspectrum->combine_size; n++)
+                buf[n] = plane ? 127.5 : 0;
         }
 
         for (ch = 0; ch < showspectrum->nb_display_channels; ch++) {
-            float yf, uf, vf;
+            const FFTSample *data = showspectrum->rdft_data[ch];
+            float *mag = showspectrum->magnitudes;
+            float yf, uf, vf, *out[3];
 
             /* decide color range */
             switch (showspectrum->mode) {
@@ -354,68 +421,47 @@ static int plot_spectrum_column(AVFilterLink *inlink, AVFrame *insamples, int nb
             uf *= showspectrum->saturation;
             vf *= showspectrum->saturation;
 
-            /* draw the channel */
-            for (y = 0; y < h; y++) {
-                int row = (showspectrum->mode == COMBINED) ? y : ch * h + y;
-                float *out = &showspectrum->combine_buffer[3 * row];
+            /* get the magnitudes */
+            for (y = 0; y < h; y++)
+                mag[y] = w * sqrtf(data[2 * y] * data[2 * y] + data[2 * y + 1] * data[2 * y + 1]);
 
-                /* get magnitude */
-                float a = w * MAGNITUDE(y, ch);
+            /* apply scale */
+            switch (showspectrum->scale) {
+            case LINEAR:
+                break;
+            case SQRT:
+                for (y = 0; y < h; y++)
+                    mag[y] = sqrtf(mag[y]);
+                break;
+            case CBRT:
+                for (y = 0; y < h; y++)
+                    mag[y] = cbrtf(mag[y]);
+                break;
+            case LOG:
+                for (y = 0; y < h; y++) // zero = -120dBFS
+                    mag[y] = 1 - logf(av_clipf(mag[y], 1e-6, 1)) / logf(1e-6);
+                break;
+            default:
+                av_assert0(0);
+            }
 
-                /* apply scale */
-                switch (showspectrum->scale) {
-                case LINEAR:
-                    break;
-                case SQRT:
-                    a = sqrt(a);
-                    break;
-                case CBRT:
-                    a = cbrt(a);
-                    break;
-                case LOG:
-                    a = 1 - log(FFMAX(FFMIN(1, a), 1e-6)) / log(1e-6); // zero = -120dBFS
-                    break;
-                default:
-                    av_assert0(0);
-                }
+            /* draw the channel */
+            for (plane = 0; plane < 3; plane++)
+                out[plane] = showspectrum->combine_buffer + plane * showspectrum->combine_size +
+                             (showspectrum->mode == COMBINED ? 0 : ch * showspectrum->combine_stride);
 
-                if (showspectrum->color_mode == INTENSITY) {
-                    float y, u, v;
-                    int i;
-
-                    for (i = 1; i < sizeof(intensity_color_table) / sizeof(*intensity_color_table) - 1; i++)
-                        if (intensity_color_table[i].a >= a)
-                            break;
-                    // i now is the first item >= the color
-                    // now we know to interpolate between item i - 1 and i
-                    if (a <= intensity_color_table[i - 1].a) {
-                        y = intensity_color_table[i - 1].y;
-                        u = intensity_color_table[i - 1].u;
-                        v = intensity_color_table[i - 1].v;
-                    } else if (a >= intensity_color_table[i].a) {
-                        y = intensity_color_table[i].y;
-                        u = intensity_color_table[i].u;
-                        v = intensity_color_table[i].v;
-                    } else {
-                        float start = intensity_color_table[i - 1].a;
-                        float end = intensity_color_table[i].a;
-                        float lerpfrac = (a - start) / (end - start);
-                        y = intensity_color_table[i - 1].y * (1.0f - lerpfrac)
-                          + intensity_color_table[i].y * lerpfrac;
-                        u = intensity_color_table[i - 1].u * (1.0f - lerpfrac)
-                          + intensity_color_table[i].u * lerpfrac;
-                        v = intensity_color_table[i - 1].v * (1.0f - lerpfrac)
-                          + intensity_color_table[i].v * lerpfrac;
-                    }
-
-                    out[0] += y * yf;
-                    out[1] += u * uf;
-                    out[2] += v * vf;
-                } else {
-                    out[0] += a * yf;
-                    out[1] += a * uf;
-                    out[2] += a * vf;
+            if (showspectrum->color_mode == INTENSITY) {
+                for (y = 0; y < h; y++) {
+                    const float *yuv = showspectrum->color_lut[lrintf(FFMIN(mag[y], 1) * COLOR_LUT_SIZE)];
+
+                    out[0][y] += yuv[0] * yf;
+                    out[1][y] += yuv[1] * uf;
+                    out[2][y] += yuv[2] * vf;
                 }
+            } else {
+                showspectrum->fdsp.vector_fmac_scalar(out[0], mag, yf, showspectrum->combine_stride);
+                showspectrum->fdsp.vector_fmac_scalar(out[1], mag, uf, showspectrum->combine_stride);
+                showspectrum->fdsp.vector_fmac_scalar(out[2], mag, vf, showspectrum->combine_stride);
             }
         }
 
@@ -431,11 +477,18 @@ static int plot_spectrum_column(AVFilterLink *inlink, AVFrame *insamples, int nb
             showspectrum->xpos = outlink->w - 1;
         }
         for (plane = 0; plane < 3; plane++) {
+            const float *buf = showspectrum->combine_buffer + plane * showspectrum->combine_size;
             uint8_t *p = outpicref->data[plane] +
                          (outlink->h - 1) * outpicref->linesize[plane] +
                          showspectrum->xpos;
             for (y = 0; y < outlink->h; y++) {
-                *p = rint(FFMAX(0, FFMIN(showspectrum->combine_buffer[3 * y + plane], 255)));
+                /* in separate mode, channel ch is drawn on rows ch * h to
+                 * ch * h + h - 1, the remaining rows stay black */
+                float v = showspectrum->mode == COMBINED ? buf[y] :
+                          y / h < showspectrum->nb_display_channels ?
+                          buf[y / h * showspectrum->combine_stride + y % h] :
+                          plane ? 127.5 : 0;
+                *p = rint(FFMAX(0, FFMIN(v, 255)));
                 p -= outpicref->linesize[plane];
             }
         }
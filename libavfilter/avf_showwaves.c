@@ -160,6 +160,13 @@ static int request_frame(AVFilterLink *outlink)
 
 #define MAX_INT16 ((1<<15) -1)
 
+/* av_rescale(sample, half_h, MAX_INT16) without its generic 64-bit path */
+static av_always_inline int rescale_sample(int sample, int half_h)
+{
+    return sample >= 0 ?  (( sample * (int64_t)half_h + MAX_INT16 / 2) / MAX_INT16)
+                       : -((-sample * (int64_t)half_h + MAX_INT16 / 2) / MAX_INT16);
+}
+
 static int filter_frame(AVFilterLink *inlink, AVFrame *insamples)
 {
     AVFilterContext *ctx = inlink->dst;
@@ -192,7 +199,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *insamples)
                 memset(outpicref->data[0] + j * linesize, 0, outlink->w);
         }
         for (j = 0; j < nb_channels; j++) {
-            h = showwaves->h/2 - av_rescale(*p++, showwaves->h/2, MAX_INT16);
+            h = showwaves->h/2 - rescale_sample(*p++, showwaves->h/2);
             switch (showwaves->mode) {
             case MODE_POINT:
                 if (h >= 0 && h < outlink->h)
@@ -27,16 +27,21 @@
 #include "libavutil/imgutils.h"
 #include "libavutil/opt.h"
 #include "libavutil/pixdesc.h"
+#include "libavutil/profile_internal.h"
 #include "libavutil/rational.h"
 #include "libavutil/samplefmt.h"
+#include "libavutil/time.h"
 
 #include "audio.h"
 #include "avfilter.h"
 #include "formats.h"
+#include "framepool.h"
 #include "internal.h"
+#include "thread.h"
 #include "audio.h"
 
 static int ff_filter_frame_framed(AVFilterLink *link, AVFrame *frame);
+static int filter_frame_unqueued(AVFilterLink *link, AVFrame *frame);
 
 void ff_tlog_ref(void *ctx, AVFrame *ref, int end)
 {
@@ -153,6 +158,7 @@ void avfilter_link_free(AVFilterLink **link)
         return;
 
     av_frame_free(&(*link)->partial_buf);
+    ff_frame_pool_uninit((FFFramePool**)&(*link)->frame_pool);
 
     av_freep(link);
 }
@@ -320,18 +326,80 @@ void ff_tlog_link(void *ctx, AVFilterLink *link, int end)
     }
 }
 
-int ff_request_frame(AVFilterLink *link)
+static void profile_enter(AVFilterContext *ctx, FFFilterProfile *prof)
+{
+    prof->start  = av_gettime();
+    prof->nested = 0;
+    prof->parent = ctx->internal->profile;
+    ctx->internal->profile = prof;
+}
+
+/* return the time spent in the callback itself */
+static int64_t profile_leave(AVFilterContext *ctx, FFFilterProfile *prof)
+{
+    ctx->internal->profile = prof->parent;
+    return av_gettime() - prof->start - prof->nested;
+}
+
+int ff_call_request_frame(AVFilterLink *link)
+{
+    FFFilterProfile prof;
+    int ret;
+
+    profile_enter(link->src, &prof);
+    ret = link->srcpad->request_frame(link);
+    link->src->internal->stats.request_frame_time += profile_leave(link->src, &prof);
+    return ret;
+}
+
+void ff_filter_stats_add_alloc(AVFilterContext *ctx, const AVFrame *frame)
+{
+    int i;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(frame->buf) && frame->buf[i]; i++)
+        ctx->internal->stats.bytes_allocated += frame->buf[i]->size;
+    for (i = 0; i < frame->nb_extended_buf; i++)
+        ctx->internal->stats.bytes_allocated += frame->extended_buf[i]->size;
+}
+
+const AVFilterStats *avfilter_get_stats(AVFilterContext *filter)
+{
+    AVFilterStats *stats = &filter->internal->stats;
+    int i;
+
+    stats->nb_queued = 0;
+    for (i = 0; i < filter->nb_inputs; i++) {
+        AVFilterLink *link = filter->inputs[i];
+        if (!link)
+            continue;
+        if (link->pipe)
+            stats->nb_queued += FFMAX(ff_pipeline_poll_frame(link), 0);
+        stats->nb_queued += !!link->partial_buf;
+    }
+    return stats;
+}
+
+void avfilter_reset_stats(AVFilterContext *filter)
+{
+    memset(&filter->internal->stats, 0, sizeof(filter->internal->stats));
+}
+
+static int request_frame(AVFilterLink *link)
 {
     int ret = -1;
-    FF_TPRINTF_START(NULL, request_frame); ff_tlog_link(NULL, link, 1);
 
     if (link->closed)
         return AVERROR_EOF;
     av_assert0(!link->frame_requested);
     link->frame_requested = 1;
     while (link->frame_requested) {
-        if (link->srcpad->request_frame)
-            ret = link->srcpad->request_frame(link);
+        if (link->pipe) {
+            AVFrame *frame;
+            ret = ff_pipeline_get_frame(link, &frame);
+            if (ret >= 0)
+                ret = filter_frame_unqueued(link, frame);
+        } else if (link->srcpad->request_frame)
+            ret = ff_call_request_frame(link);
         else if (link->src->inputs[0])
             ret = ff_request_frame(link->src->inputs[0]);
         if (ret == AVERROR_EOF && link->partial_buf) {
@@ -351,10 +419,25 @@ int ff_request_frame(AVFilterLink *link)
     return ret;
 }
 
+int ff_request_frame(AVFilterLink *link)
+{
+    FFFilterProfile *caller = link->dst->internal->profile;
+    int64_t start = caller ? av_gettime() : 0;
+    int ret;
+    FF_TPRINTF_START(NULL, request_frame); ff_tlog_link(NULL, link, 1);
+
+    ret = request_frame(link);
+    if (caller)
+        caller->nested += av_gettime() - start;
+    return ret;
+}
+
 int ff_poll_frame(AVFilterLink *link)
 {
     int i, min = INT_MAX;
 
+    if (link->pipe)
+        return ff_pipeline_poll_frame(link);
     if (link->srcpad->poll_frame)
         return link->srcpad->poll_frame(link);
 
@@ -429,6 +512,18 @@ int avfilter_process_command(AVFilterContext *filter, const char *cmd, const cha
         return 0;
     }else if(!strcmp(cmd, "enable")) {
         return set_enable_expr(filter, arg);
+    }else if(!strcmp(cmd, "profile")) {
+        const AVFilterStats *st = avfilter_get_stats(filter);
+        if (res_len)
+            snprintf(res, res_len, "frames_in:%"PRId64" frames_out:%"PRId64
+                     " filter_frame_time:%"PRId64" request_frame_time:%"PRId64
+                     " bytes_allocated:%"PRId64" queued:%d\n",
+                     st->nb_frames_in, st->nb_frames_out,
+                     st->filter_frame_time, st->request_frame_time,
+                     st->bytes_allocated, st->nb_queued);
+        if (arg && !strcmp(arg, "reset"))
+            avfilter_reset_stats(filter);
+        return 0;
     }else if(filter->filter->process_command) {
         return filter->filter->process_command(filter, cmd, arg, res, res_len, flags);
     }
@@ -803,7 +898,7 @@ int avfilter_init_dict(AVFilterContext *ctx, AVDictionary **options)
         return ret;
     }
 
-    if (ctx->filter->flags & AVFILTER_FLAG_SLICE_THREADS &&
+    if (ctx->filter->flags & AVFILTER_FLAG_SLICE_THREADS && ctx->graph &&
         ctx->thread_type & ctx->graph->thread_type & AVFILTER_THREAD_SLICE &&
         ctx->graph->internal->thread_execute) {
         ctx->thread_type       = AVFILTER_THREAD_SLICE;
@@ -975,6 +1070,7 @@ static int ff_filter_frame_framed(AVFilterLink *link, AVFrame *frame)
     AVFrame *out;
     int ret;
     AVFilterCommand *cmd= link->dst->command_queue;
+    FFFilterProfile prof;
     int64_t pts;
 
     if (link->closed) {
@@ -1044,7 +1140,10 @@ static int ff_filter_frame_framed(AVFilterLink *link, AVFrame *frame)
             (dstctx->filter->flags & AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC))
             filter_frame = default_filter_frame;
     }
+    profile_enter(dstctx, &prof);
     ret = filter_frame(link, out);
+    dstctx->internal->stats.filter_frame_time += profile_leave(dstctx, &prof);
+    dstctx->internal->stats.nb_frames_in++;
     link->frame_count++;
     link->frame_requested = 0;
     ff_update_link_current_pts(link, pts);
@@ -1092,10 +1191,33 @@ static int ff_filter_frame_needs_framing(AVFilterLink *link, AVFrame *frame)
     return ret;
 }
 
+FF_PROFILE_COUNTER(filter_frame_counter, "filter_frame");
+
 int ff_filter_frame(AVFilterLink *link, AVFrame *frame)
 {
+    FFFilterProfile *caller = link->src->internal->profile;
+    int64_t start = caller ? av_gettime() : 0;
+    uint64_t prof = avpriv_profile_start();
+    int ret;
     FF_TPRINTF_START(NULL, filter_frame); ff_tlog_link(NULL, link, 1); ff_tlog(NULL, " "); ff_tlog_ref(NULL, frame, 1);
 
+    link->src->internal->stats.nb_frames_out++;
+
+    /* The destination runs in another thread, it filters the frame when it
+     * requests it */
+    if (link->pipe)
+        ret = ff_pipeline_put_frame(link, frame);
+    else
+        ret = filter_frame_unqueued(link, frame);
+
+    avpriv_profile_stop(&filter_frame_counter, prof);
+    if (caller)
+        caller->nested += av_gettime() - start;
+    return ret;
+}
+
+static int filter_frame_unqueued(AVFilterLink *link, AVFrame *frame)
+{
     /* Consistency checks */
     if (link->type == AVMEDIA_TYPE_VIDEO) {
         if (strcmp(link->dst->filter->name, "scale")) {
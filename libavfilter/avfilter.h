@@ -433,6 +433,13 @@ enum AVMediaType avfilter_pad_get_type(const AVFilterPad *pads, int pad_idx);
  * and processing them concurrently.
  */
 #define AVFILTER_FLAG_SLICE_THREADS         (1 << 2)
+/**
+ * The filter passes frames through without touching their data, so it can
+ * also handle hardware accelerated pixel formats (AV_PIX_FMT_FLAG_HWACCEL,
+ * e.g. VDPAU or VA-API surfaces). Filters setting this flag and relying on
+ * the default query_formats() callback also accept those formats.
+ */
+#define AVFILTER_FLAG_SUPPORT_HWACCEL       (1 << 3)
 /**
  * Some filters support a generic "enable" expression option that can be used
  * to enable or disable a filter in the timeline. Filters supporting this
@@ -613,6 +620,19 @@ typedef struct AVFilter {
      * used for providing binary data.
      */
     int (*init_opaque)(AVFilterContext *ctx, void *opaque);
+
+    /**
+     * Tell whether a frame with the given timestamp, in the time base of
+     * inlink, would be used if it was sent to inlink now. This lets the
+     * application skip decoding frames the filter would drop anyway.
+     *
+     * It may be called from another thread than the one running the
+     * filter, so it must only rely on state that never makes a dropped
+     * frame wanted again.
+     *
+     * @return 0 if the frame would certainly be dropped, 1 otherwise
+     */
+    int (*frame_wanted)(AVFilterLink *inlink, int64_t pts);
 } AVFilter;
 
 /**
@@ -853,6 +873,18 @@ struct AVFilterLink {
      * Number of past frames sent through the link.
      */
     int64_t frame_count;
+
+    /**
+     * Queue of the frames sent through the link by another thread, when the
+     * graph is pipelined. Used internally by the framework.
+     */
+    void *pipe;
+
+    /**
+     * Pool of the buffers allocated for the frames sent through the link.
+     * Used internally by the framework.
+     */
+    void *frame_pool;
 };
 
 /**
@@ -962,6 +994,39 @@ AVFilterBufferRef *avfilter_get_audio_buffer_ref_from_arrays_channels(uint8_t **
  */
 int avfilter_process_command(AVFilterContext *filter, const char *cmd, const char *arg, char *res, int res_len, int flags);
 
+/**
+ * Profiling counters of a filter instance.
+ *
+ * The times are in microseconds and exclude the time spent in the other
+ * filters called from the filter callbacks.
+ *
+ * sizeof(AVFilterStats) is not a part of the public ABI, new fields may be
+ * added to the end of the structure with a minor bump.
+ */
+typedef struct AVFilterStats {
+    int64_t nb_frames_in;       ///< number of frames received on the inputs
+    int64_t nb_frames_out;      ///< number of frames sent on the outputs
+    int64_t filter_frame_time;  ///< time spent filtering the incoming frames
+    int64_t request_frame_time; ///< time spent answering frame requests
+    int64_t bytes_allocated;    ///< size of the buffers of the frames allocated for the outputs
+    int     nb_queued;          ///< number of frames currently queued on the inputs
+} AVFilterStats;
+
+/**
+ * Get the profiling counters of a filter instance.
+ *
+ * The counters are updated while the graph runs; when the graph runs in
+ * several threads, they are only approximately consistent with each other.
+ *
+ * @return  the counters of the filter, valid as long as the filter is
+ */
+const AVFilterStats *avfilter_get_stats(AVFilterContext *filter);
+
+/**
+ * Reset the profiling counters of a filter instance.
+ */
+void avfilter_reset_stats(AVFilterContext *filter);
+
 /** Initialize the filter system. Register all builtin filters. */
 void avfilter_register_all(void);
 
@@ -1181,6 +1246,14 @@ typedef struct AVFilterGraph {
     int sink_links_count;
 
     unsigned disable_auto_convert;
+
+    /**
+     * If set, requests frames from the linear chains of the graph in
+     * separate threads, with up to pipeline_queue_size frames queued between
+     * two threads. Access ONLY through AVOptions.
+     */
+    int pipeline;
+    int pipeline_queue_size;
 } AVFilterGraph;
 
 /**
@@ -1401,7 +1474,9 @@ int avfilter_graph_queue_command(AVFilterGraph *graph, const char *target, const
  * Dump a graph into a human-readable string representation.
  *
  * @param graph    the graph to dump
- * @param options  formatting options; currently ignored
+ * @param options  formatting options; "profile" appends the profiling
+ *                 counters of each filter (see avfilter_get_stats()),
+ *                 other values are currently ignored
  * @return  a string, or NULL in case of memory allocation failure;
  *          the string must be freed using av_free
  */
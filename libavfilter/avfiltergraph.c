@@ -45,6 +45,10 @@ static const AVOption filtergraph_options[] = {
         { "slice", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_SLICE }, .flags = FLAGS, .unit = "thread_type" },
     { "threads",     "Maximum number of threads", OFFSET(nb_threads),
         AV_OPT_TYPE_INT,   { .i64 = 0 }, 0, INT_MAX, FLAGS },
+    { "pipeline",    "Run the linear chains of filters in separate threads", OFFSET(pipeline),
+        AV_OPT_TYPE_INT,   { .i64 = 0 }, 0, 1, FLAGS },
+    { "pipeline_queue_size", "Maximum number of frames queued between two pipeline threads",
+        OFFSET(pipeline_queue_size), AV_OPT_TYPE_INT, { .i64 = 4 }, 1, 1024, FLAGS },
     {"scale_sws_opts"       , "default scale filter options"        , OFFSET(scale_sws_opts)        ,
         AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, FLAGS },
     {"aresample_swr_opts"   , "default aresample filter options"    , OFFSET(aresample_swr_opts)    ,
@@ -71,6 +75,51 @@ int ff_graph_thread_init(AVFilterGraph *graph)
     graph->nb_threads  = 1;
     return 0;
 }
+
+int ff_pipeline_init(AVFilterGraph *graph)
+{
+    return 0;
+}
+
+void ff_pipeline_uninit(AVFilterGraph *graph)
+{
+}
+
+int ff_pipeline_put_frame(AVFilterLink *link, AVFrame *frame)
+{
+    av_assert0(0);
+    return AVERROR_BUG;
+}
+
+int ff_pipeline_get_frame(AVFilterLink *link, AVFrame **frame)
+{
+    av_assert0(0);
+    return AVERROR_BUG;
+}
+
+int ff_pipeline_poll_frame(AVFilterLink *link)
+{
+    av_assert0(0);
+    return AVERROR_BUG;
+}
+
+int ff_pipeline_request_frame_nonblock(AVFilterLink *link)
+{
+    return AVERROR(EAGAIN);
+}
+
+void ff_pipeline_lock(AVFilterContext *ctx)
+{
+}
+
+void ff_pipeline_unlock(AVFilterContext *ctx)
+{
+}
+
+int ff_pipeline_wake(AVFilterContext *ctx)
+{
+    return 0;
+}
 #endif
 
 AVFilterGraph *avfilter_graph_alloc(void)
@@ -109,6 +158,8 @@ void avfilter_graph_free(AVFilterGraph **graph)
     if (!*graph)
         return;
 
+    ff_pipeline_uninit(*graph);
+
     while ((*graph)->nb_filters)
         avfilter_free((*graph)->filters[0]);
 
@@ -360,6 +411,119 @@ static int formats_declared(AVFilterContext *f)
     return 1;
 }
 
+static AVFilterFormats *clone_filter_formats(AVFilterFormats *arg)
+{
+    AVFilterFormats *a = av_memdup(arg, sizeof(*arg));
+    if (a) {
+        a->refcount = 0;
+        a->refs     = NULL;
+        a->formats  = av_memdup(a->formats, sizeof(*a->formats) * a->nb_formats);
+        if (!a->formats && arg->nb_formats)
+            av_freep(&a);
+    }
+    return a;
+}
+
+static void free_filter_formats(AVFilterFormats **f)
+{
+    if (*f) {
+        av_freep(&(*f)->refs);
+        av_freep(&(*f)->formats);
+    }
+    av_freep(f);
+}
+
+/**
+ * Merge private copies of two formats lists, leaving the originals and
+ * their references untouched.
+ * @return  the merged list, to be freed with free_filter_formats(), or NULL
+ *          if the lists can not be merged
+ */
+static AVFilterFormats *merge_formats_copy(AVFilterFormats *a_arg,
+                                           AVFilterFormats *b_arg,
+                                           enum AVMediaType type)
+{
+    AVFilterFormats *a = clone_filter_formats(a_arg);
+    AVFilterFormats *b = clone_filter_formats(b_arg);
+    AVFilterFormats *ret = NULL;
+
+    if (a && b)
+        ret = ff_merge_formats(a, b, type);
+    if (!ret) {
+        free_filter_formats(&a);
+        free_filter_formats(&b);
+    }
+    return ret;
+}
+
+static int can_merge_formats(AVFilterFormats *a, AVFilterFormats *b,
+                             enum AVMediaType type)
+{
+    AVFilterFormats *ret;
+
+    if (a == b)
+        return 1;
+    if (!(ret = merge_formats_copy(a, b, type)))
+        return 0;
+    free_filter_formats(&ret);
+    return 1;
+}
+
+/**
+ * Count the links that could be merged now but would need a conversion
+ * if the formats lists of link were merged.
+ *
+ * Merging two lists restricts every link that shares one of them; when a
+ * single conversion on link saves several conversions around it, the
+ * conversion is better done on link.
+ */
+static int count_merge_conflicts(AVFilterGraph *graph, AVFilterLink *link)
+{
+    AVFilterFormats *merged;
+    int i, j, count = 0;
+
+    if (!(merged = merge_formats_copy(link->in_formats, link->out_formats,
+                                      link->type)))
+        return 0;
+
+    for (i = 0; i < graph->nb_filters; i++) {
+        AVFilterContext *f = graph->filters[i];
+
+        for (j = 0; j < f->nb_inputs; j++) {
+            AVFilterLink *l = f->inputs[j];
+            AVFilterFormats *shared, *other;
+
+            if (!l || l == link || !l->in_formats || !l->out_formats ||
+                l->in_formats == l->out_formats)
+                continue;
+            if (l->in_formats == link->in_formats ||
+                l->in_formats == link->out_formats) {
+                shared = l->in_formats;
+                other  = l->out_formats;
+            } else if (l->out_formats == link->in_formats ||
+                       l->out_formats == link->out_formats) {
+                shared = l->out_formats;
+                other  = l->in_formats;
+            } else {
+                continue;
+            }
+            if (other == link->in_formats || other == link->out_formats)
+                continue;
+            if (!can_merge_formats(merged, other, l->type) &&
+                can_merge_formats(shared, other, l->type))
+                count++;
+        }
+    }
+
+    free_filter_formats(&merged);
+    return count;
+}
+
+static int is_auto_inserted(AVFilterContext *f)
+{
+    return f->name && av_strstart(f->name, "auto-inserted ", NULL);
+}
+
 /**
  * Perform one round of query_formats() and merging formats lists on the
  * filter graph.
@@ -400,6 +564,8 @@ static int query_formats(AVFilterGraph *graph, AVClass *log_ctx)
         for (j = 0; j < filter->nb_inputs; j++) {
             AVFilterLink *link = filter->inputs[j];
             int convert_needed = 0;
+            int conflicts = 0;
+            char reason[128] = "";
 
             if (!link)
                 continue;
@@ -413,23 +579,33 @@ static int query_formats(AVFilterGraph *graph, AVClass *log_ctx)
                 count_merged++;                                              \
                 statement                                                    \
             }
+#define CONVERT_NEEDED(what)                                                 \
+            do {                                                             \
+                av_strlcatf(reason, sizeof(reason), "%s%s",                  \
+                            convert_needed ? ", " : "", what);               \
+                convert_needed = 1;                                          \
+            } while (0)
             MERGE_DISPATCH(formats,
-                if (!ff_merge_formats(link->in_formats, link->out_formats,
+                conflicts = count_merge_conflicts(graph, link);
+                if (conflicts > 1 ||
+                    !ff_merge_formats(link->in_formats, link->out_formats,
                                       link->type))
-                    convert_needed = 1;
+                    CONVERT_NEEDED(link->type == AVMEDIA_TYPE_VIDEO ?
+                                   "pixel formats" : "sample formats");
             )
             if (link->type == AVMEDIA_TYPE_AUDIO) {
                 MERGE_DISPATCH(channel_layouts,
                     if (!ff_merge_channel_layouts(link->in_channel_layouts,
                                                   link->out_channel_layouts))
-                        convert_needed = 1;
+                        CONVERT_NEEDED("channel layouts");
                 )
                 MERGE_DISPATCH(samplerates,
                     if (!ff_merge_samplerates(link->in_samplerates,
                                               link->out_samplerates))
-                        convert_needed = 1;
+                        CONVERT_NEEDED("sample rates");
                 )
             }
+#undef CONVERT_NEEDED
 #undef MERGE_DISPATCH
 
             if (convert_needed) {
@@ -506,6 +682,14 @@ static int query_formats(AVFilterGraph *graph, AVClass *log_ctx)
                            "'%s' and the filter '%s'\n", link->src->name, link->dst->name);
                     return ret;
                 }
+
+                if (conflicts > 1)
+                    av_log(convert, AV_LOG_VERBOSE, "Converting here saves "
+                           "%d conversions on the neighbouring links\n", conflicts);
+                else
+                    av_log(convert, AV_LOG_VERBOSE, "Filters '%s' and '%s' "
+                           "have no common %s\n",
+                           inlink->src->name, outlink->dst->name, reason);
             }
         }
     }
@@ -973,22 +1157,68 @@ static int pick_formats(AVFilterGraph *graph)
                     }
                 }
             }
+            /* pick the input of a conversion filter closest to its output,
+               to make the conversion as cheap as possible */
+            if (is_auto_inserted(filter) && filter->outputs[0]->format >= 0 &&
+                filter->inputs[0]->format < 0) {
+                if ((ret = pick_format(filter->inputs[0], filter->outputs[0])) < 0)
+                    return ret;
+                change = 1;
+            }
         }
     }while(change);
 
     for (i = 0; i < graph->nb_filters; i++) {
         AVFilterContext *filter = graph->filters[i];
+        AVFilterLink *ref = NULL;
 
         for (j = 0; j < filter->nb_inputs; j++)
             if ((ret = pick_format(filter->inputs[j], NULL)) < 0)
                 return ret;
+        if (is_auto_inserted(filter))
+            ref = filter->inputs[0];
         for (j = 0; j < filter->nb_outputs; j++)
-            if ((ret = pick_format(filter->outputs[j], NULL)) < 0)
+            if ((ret = pick_format(filter->outputs[j], ref)) < 0)
                 return ret;
     }
     return 0;
 }
 
+static void log_conversions(AVFilterGraph *graph, AVClass *log_ctx)
+{
+    int i, nb_conversions = 0;
+
+    for (i = 0; i < graph->nb_filters; i++) {
+        AVFilterContext *f = graph->filters[i];
+        AVFilterLink *inlink, *outlink;
+
+        if (!is_auto_inserted(f))
+            continue;
+        inlink  = f->inputs[0];
+        outlink = f->outputs[0];
+        nb_conversions++;
+
+        if (inlink->type == AVMEDIA_TYPE_VIDEO) {
+            av_log(log_ctx, AV_LOG_VERBOSE, "'%s' converts %s to %s\n", f->name,
+                   av_get_pix_fmt_name(inlink->format),
+                   av_get_pix_fmt_name(outlink->format));
+        } else {
+            char inbuf[64], outbuf[64];
+            av_get_channel_layout_string(inbuf, sizeof(inbuf),
+                                         inlink->channels, inlink->channel_layout);
+            av_get_channel_layout_string(outbuf, sizeof(outbuf),
+                                         outlink->channels, outlink->channel_layout);
+            av_log(log_ctx, AV_LOG_VERBOSE, "'%s' converts %s:%dHz:%s to %s:%dHz:%s\n",
+                   f->name,
+                   av_get_sample_fmt_name(inlink->format), inlink->sample_rate, inbuf,
+                   av_get_sample_fmt_name(outlink->format), outlink->sample_rate, outbuf);
+        }
+    }
+    if (nb_conversions)
+        av_log(log_ctx, AV_LOG_VERBOSE, "%d conversion filters auto-inserted\n",
+               nb_conversions);
+}
+
 /**
  * Configure the formats of all the links in the graph.
  */
@@ -1016,6 +1246,8 @@ static int graph_config_formats(AVFilterGraph *graph, AVClass *log_ctx)
     if ((ret = pick_formats(graph)) < 0)
         return ret;
 
+    log_conversions(graph, log_ctx);
+
     return 0;
 }
 
@@ -1113,6 +1345,8 @@ int avfilter_graph_config(AVFilterGraph *graphctx, void *log_ctx)
         return ret;
     if ((ret = ff_avfilter_graph_config_pointers(graphctx, log_ctx)))
         return ret;
+    if (graphctx->pipeline && (ret = ff_pipeline_init(graphctx)) < 0)
+        return ret;
 
     return 0;
 }
@@ -27,7 +27,9 @@
 #include "libavutil/avassert.h"
 #include "libavutil/channel_layout.h"
 #include "libavutil/common.h"
+#include "libavutil/imgutils.h"
 #include "libavutil/mathematics.h"
+#include "libavutil/pixdesc.h"
 #include "libavutil/opt.h"
 
 #include "audio.h"
@@ -43,6 +45,9 @@ typedef struct {
     /* only used for video */
     enum AVPixelFormat *pixel_fmts;           ///< list of accepted pixel formats, must be terminated with -1
     int pixel_fmts_size;
+    int contiguous;                           ///< allocate the planes in one buffer, without padding
+    AVBufferPool *pool;                       ///< pool of the contiguous buffers
+    int pool_size;
 
     /* only used for audio */
     enum AVSampleFormat *sample_fmts;       ///< list of accepted sample formats, terminated by AV_SAMPLE_FMT_NONE
@@ -70,6 +75,8 @@ static av_cold void uninit(AVFilterContext *ctx)
     if (sink->audio_fifo)
         av_audio_fifo_free(sink->audio_fifo);
 
+    av_buffer_pool_uninit(&sink->pool);
+
     if (sink->fifo) {
         while (av_fifo_size(sink->fifo) >= sizeof(AVFilterBufferRef *)) {
             av_fifo_generic_read(sink->fifo, &frame, sizeof(frame), NULL);
@@ -80,6 +87,58 @@ static av_cold void uninit(AVFilterContext *ctx)
     }
 }
 
+/**
+ * Allocate the planes of the frames in one buffer with the layout of
+ * av_image_fill_pointers() for unpadded lines, so that they can be used as
+ * a packed picture without copying. Only done when the unpadded lines are
+ * aligned anyway.
+ */
+static AVFrame *get_video_buffer(AVFilterLink *link, int w, int h)
+{
+    BufferSinkContext *buf = link->dst->priv;
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(link->format);
+    AVFrame *frame;
+    int linesize[4], size, i;
+
+    if (!buf->contiguous ||
+        desc->flags & (AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_PSEUDOPAL) ||
+        av_image_fill_linesizes(linesize, link->format, w) < 0)
+        return NULL;
+    for (i = 0; i < 4; i++)
+        if (linesize[i] % 32)
+            return NULL;
+    size = av_image_fill_pointers((uint8_t *[4]){ NULL }, link->format, h,
+                                  NULL, linesize);
+    if (size < 0)
+        return NULL;
+
+    if (!buf->pool || buf->pool_size != size) {
+        av_buffer_pool_uninit(&buf->pool);
+        buf->pool = av_buffer_pool_init(size + 16, NULL);
+        if (!buf->pool)
+            return NULL;
+        buf->pool_size = size;
+    }
+
+    frame = av_frame_alloc();
+    if (!frame)
+        return NULL;
+    frame->buf[0] = av_buffer_pool_get(buf->pool);
+    if (!frame->buf[0]) {
+        av_frame_free(&frame);
+        return NULL;
+    }
+    frame->width  = w;
+    frame->height = h;
+    frame->format = link->format;
+    av_image_fill_pointers(frame->data, link->format, h, frame->buf[0]->data,
+                           linesize);
+    memcpy(frame->linesize, linesize, sizeof(linesize));
+    frame->extended_data = frame->data;
+
+    return frame;
+}
+
 static int add_buffer_ref(AVFilterContext *ctx, AVFrame *ref)
 {
     BufferSinkContext *buf = ctx->priv;
@@ -132,9 +191,13 @@ int attribute_align_arg av_buffersink_get_frame_flags(AVFilterContext *ctx, AVFr
 
     /* no picref available, fetch it from the filterchain */
     if (!av_fifo_size(buf->fifo)) {
+        /* frames filtered by the threads of a pipelined graph are only
+         * forwarded to the sink when it requests them */
         if (flags & AV_BUFFERSINK_FLAG_NO_REQUEST)
-            return AVERROR(EAGAIN);
-        if ((ret = ff_request_frame(inlink)) < 0)
+            ret = ff_pipeline_request_frame_nonblock(inlink);
+        else
+            ret = ff_request_frame(inlink);
+        if (ret < 0)
             return ret;
     }
 
@@ -150,6 +213,7 @@ int attribute_align_arg av_buffersink_get_frame_flags(AVFilterContext *ctx, AVFr
         av_frame_move_ref(frame, cur_frame);
         av_frame_free(&cur_frame);
     }
+    av_frame_latency_trace_stamp(frame, AV_LATENCY_FILTER_OUT);
 
     return 0;
 }
@@ -493,6 +557,7 @@ static int asink_query_formats(AVFilterContext *ctx)
 #define FLAGS AV_OPT_FLAG_FILTERING_PARAM|AV_OPT_FLAG_VIDEO_PARAM
 static const AVOption buffersink_options[] = {
     { "pix_fmts", "set the supported pixel formats", OFFSET(pixel_fmts), AV_OPT_TYPE_BINARY, .flags = FLAGS },
+    { "contiguous", "allocate the planes in one buffer, without padding", OFFSET(contiguous), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1, FLAGS },
     { NULL },
 };
 #undef FLAGS
@@ -521,6 +586,7 @@ static const AVFilterPad ffbuffersink_inputs[] = {
     {
         .name      = "default",
         .type      = AVMEDIA_TYPE_VIDEO,
+        .get_video_buffer = get_video_buffer,
         .filter_frame = filter_frame,
     },
     { NULL },
@@ -565,6 +631,7 @@ static const AVFilterPad avfilter_vsink_buffer_inputs[] = {
     {
         .name        = "default",
         .type        = AVMEDIA_TYPE_VIDEO,
+        .get_video_buffer = get_video_buffer,
         .filter_frame = filter_frame,
     },
     { NULL }
@@ -37,6 +37,7 @@
 #include "buffersrc.h"
 #include "formats.h"
 #include "internal.h"
+#include "thread.h"
 #include "video.h"
 #include "avcodec.h"
 
@@ -121,12 +122,14 @@ static int attribute_align_arg av_buffersrc_add_frame_internal(AVFilterContext *
 {
     BufferSourceContext *s = ctx->priv;
     AVFrame *copy;
-    int ret;
-
-    s->nb_failed_requests = 0;
+    int ret = 0;
 
     if (!frame) {
+        ff_pipeline_lock(ctx);
+        s->nb_failed_requests = 0;
         s->eof = 1;
+        ff_pipeline_unlock(ctx);
+        ff_pipeline_wake(ctx);
         return 0;
     } else if (s->eof)
         return AVERROR(EINVAL);
@@ -151,21 +154,29 @@ static int attribute_align_arg av_buffersrc_add_frame_internal(AVFilterContext *
 
     }
 
-    if (!av_fifo_space(s->fifo) &&
-        (ret = av_fifo_realloc2(s->fifo, av_fifo_size(s->fifo) +
-                                         sizeof(copy))) < 0)
-        return ret;
-
     if (!(copy = av_frame_alloc()))
         return AVERROR(ENOMEM);
     av_frame_move_ref(copy, frame);
+    av_frame_latency_trace_stamp(copy, AV_LATENCY_FILTER_IN);
 
-    if ((ret = av_fifo_generic_write(s->fifo, &copy, sizeof(copy), NULL)) < 0) {
+    /* the fifo is read by a pipeline thread when the graph is pipelined */
+    ff_pipeline_lock(ctx);
+    s->nb_failed_requests = 0;
+    if (!av_fifo_space(s->fifo))
+        ret = av_fifo_realloc2(s->fifo, av_fifo_size(s->fifo) + sizeof(copy));
+    if (ret >= 0)
+        ret = av_fifo_generic_write(s->fifo, &copy, sizeof(copy), NULL);
+    ff_pipeline_unlock(ctx);
+    if (ret < 0) {
         av_frame_move_ref(frame, copy);
         av_frame_free(&copy);
         return ret;
     }
 
+    /* the pipeline thread requests the frame itself */
+    if (ff_pipeline_wake(ctx))
+        return 0;
+
     if ((flags & AV_BUFFERSRC_FLAG_PUSH))
         if ((ret = ctx->output_pads[0].request_frame(ctx->outputs[0])) < 0)
             return ret;
@@ -198,10 +209,9 @@ int av_buffersrc_add_ref(AVFilterContext *ctx, AVFilterBufferRef *buf,
     AVBufferRef *dummy_buf = NULL;
     int ret = 0, planes, i;
 
-    if (!buf) {
-        s->eof = 1;
-        return 0;
-    } else if (s->eof)
+    if (!buf)
+        return av_buffersrc_add_frame_internal(ctx, NULL, 0);
+    else if (s->eof)
         return AVERROR(EINVAL);
 
     frame = av_frame_alloc();
@@ -313,7 +323,33 @@ static av_cold int init_video(AVFilterContext *ctx)
 
 unsigned av_buffersrc_get_nb_failed_requests(AVFilterContext *buffer_src)
 {
-    return ((BufferSourceContext *)buffer_src->priv)->nb_failed_requests;
+    unsigned nb_failed_requests;
+
+    ff_pipeline_lock(buffer_src);
+    nb_failed_requests = ((BufferSourceContext *)buffer_src->priv)->nb_failed_requests;
+    ff_pipeline_unlock(buffer_src);
+
+    return nb_failed_requests;
+}
+
+int av_buffersrc_frame_wanted(AVFilterContext *buffer_src, int64_t pts)
+{
+    BufferSourceContext *s = buffer_src->priv;
+    AVFilterLink *link = buffer_src->outputs[0];
+    int queued;
+
+    if (!link || !link->dst->filter->frame_wanted)
+        return 1;
+
+    /* the frames still queued will be filtered first and may change what
+     * the next filter wants */
+    ff_pipeline_lock(buffer_src);
+    queued = av_fifo_size(s->fifo);
+    ff_pipeline_unlock(buffer_src);
+    if (queued)
+        return 1;
+
+    return link->dst->filter->frame_wanted(link, pts);
 }
 
 #define OFFSET(x) offsetof(BufferSourceContext, x)
@@ -477,14 +513,21 @@ static int request_frame(AVFilterLink *link)
 {
     BufferSourceContext *c = link->src->priv;
     AVFrame *frame;
+    int ret = 0;
 
+    ff_pipeline_lock(link->src);
     if (!av_fifo_size(c->fifo)) {
-        if (c->eof)
-            return AVERROR_EOF;
-        c->nb_failed_requests++;
-        return AVERROR(EAGAIN);
-    }
-    av_fifo_generic_read(c->fifo, &frame, sizeof(frame), NULL);
+        if (c->eof) {
+            ret = AVERROR_EOF;
+        } else {
+            c->nb_failed_requests++;
+            ret = AVERROR(EAGAIN);
+        }
+    } else
+        av_fifo_generic_read(c->fifo, &frame, sizeof(frame), NULL);
+    ff_pipeline_unlock(link->src);
+    if (ret < 0)
+        return ret;
 
     return ff_filter_frame(link, frame);
 }
@@ -492,8 +535,13 @@ static int request_frame(AVFilterLink *link)
 static int poll_frame(AVFilterLink *link)
 {
     BufferSourceContext *c = link->src->priv;
-    int size = av_fifo_size(c->fifo);
-    if (!size && c->eof)
+    int size, eof;
+
+    ff_pipeline_lock(link->src);
+    size = av_fifo_size(c->fifo);
+    eof  = c->eof;
+    ff_pipeline_unlock(link->src);
+    if (!size && eof)
         return AVERROR_EOF;
     return size/sizeof(AVFrame*);
 }
@@ -77,6 +77,18 @@ int av_buffersrc_add_ref(AVFilterContext *buffer_src,
  */
 unsigned av_buffersrc_get_nb_failed_requests(AVFilterContext *buffer_src);
 
+/**
+ * Tell whether a frame with the given timestamp, in the time base of the
+ * buffer source, would be used if it was added to the buffer source now.
+ *
+ * This only asks the filter directly connected to the buffer source, and
+ * is meant to let the caller skip decoding frames that would be dropped,
+ * e.g. by setting AVCodecContext.skip_frame.
+ *
+ * @return 0 if the frame would certainly be dropped, 1 otherwise
+ */
+int av_buffersrc_frame_wanted(AVFilterContext *buffer_src, int64_t pts);
+
 #if FF_API_AVFILTERBUFFER
 /**
  * Add a buffer to the filtergraph s.
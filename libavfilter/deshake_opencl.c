@@ -46,16 +46,17 @@ int ff_opencl_transform(AVFilterContext *ctx,
 
     opencl_param.ctx = ctx;
     opencl_param.kernel = deshake->opencl_ctx.kernel_env.kernel;
-    ret = av_opencl_buffer_write(deshake->opencl_ctx.cl_matrix_y, (uint8_t *)matrix_y, deshake->opencl_ctx.matrix_size * sizeof(cl_float));
+    ret = avpriv_opencl_buffer_write_async(deshake->opencl_ctx.cl_matrix_y, (const uint8_t *)matrix_y, deshake->opencl_ctx.matrix_size * sizeof(cl_float));
     if (ret < 0)
-        return ret;
-    ret = av_opencl_buffer_write(deshake->opencl_ctx.cl_matrix_uv, (uint8_t *)matrix_uv, deshake->opencl_ctx.matrix_size * sizeof(cl_float));
+        goto fail;
+    ret = avpriv_opencl_buffer_write_async(deshake->opencl_ctx.cl_matrix_uv, (const uint8_t *)matrix_uv, deshake->opencl_ctx.matrix_size * sizeof(cl_float));
     if (ret < 0)
-        return ret;
+        goto fail;
 
     if ((unsigned int)interpolate > INTERPOLATE_BIQUADRATIC) {
         av_log(ctx, AV_LOG_ERROR, "Selected interpolate method is invalid\n");
-        return AVERROR(EINVAL);
+        ret = AVERROR(EINVAL);
+        goto fail;
     }
     ret = ff_opencl_set_parameter(&opencl_param,
                                   FF_OPENCL_PARAM_INFO(deshake->opencl_ctx.cl_inbuf),
@@ -74,21 +75,27 @@ int ff_opencl_transform(AVFilterContext *ctx,
                                   FF_OPENCL_PARAM_INFO(cw),
                                   NULL);
     if (ret < 0)
-        return ret;
+        goto fail;
     status = clEnqueueNDRangeKernel(deshake->opencl_ctx.kernel_env.command_queue,
                                     deshake->opencl_ctx.kernel_env.kernel, 1, NULL,
                                     &global_work_size, NULL, 0, NULL, NULL);
     if (status != CL_SUCCESS) {
         av_log(ctx, AV_LOG_ERROR, "OpenCL run kernel error occurred: %s\n", av_opencl_errstr(status));
-        return AVERROR_EXTERNAL;
+        ret = AVERROR_EXTERNAL;
+        goto fail;
     }
-    clFinish(deshake->opencl_ctx.kernel_env.command_queue);
+    /* the queue is in order, so the blocking read waits for the uploads
+       and the kernel without a separate clFinish() round trip */
     ret = av_opencl_buffer_read_image(out->data, deshake->opencl_ctx.out_plane_size,
                                       deshake->opencl_ctx.plane_num, deshake->opencl_ctx.cl_outbuf,
                                       deshake->opencl_ctx.cl_outbuf_size);
     if (ret < 0)
         return ret;
     return ret;
+fail:
+    /* the input frame and the matrices may still be read by pending uploads */
+    clFinish(deshake->opencl_ctx.kernel_env.command_queue);
+    return ret;
 }
 
 int ff_opencl_deshake_init(AVFilterContext *ctx)
@@ -166,10 +173,11 @@ int ff_opencl_deshake_process_inout_buf(AVFilterContext *ctx, AVFrame *in, AVFra
                 return ret;
         }
     }
-    ret = av_opencl_buffer_write_image(deshake->opencl_ctx.cl_inbuf,
-                                 deshake->opencl_ctx.cl_inbuf_size,
-                                 0, in->data,deshake->opencl_ctx.in_plane_size,
-                                 deshake->opencl_ctx.plane_num);
+    /* the upload runs while the CPU estimates the motion of the frame */
+    ret = avpriv_opencl_buffer_write_image_async(deshake->opencl_ctx.cl_inbuf,
+                                                 deshake->opencl_ctx.cl_inbuf_size,
+                                                 0, in->data, deshake->opencl_ctx.in_plane_size,
+                                                 deshake->opencl_ctx.plane_num);
     if(ret < 0)
         return ret;
     return ret;
@@ -440,6 +440,21 @@ static void blend_line_hv(uint8_t *dst, int dst_delta,
                     right, hband, hsub + vsub, xm);
 }
 
+/* Same as blend_line_hv() for an 8bpp mask on a plane without subsampling,
+   written so that the compiler can vectorize it. */
+static void blend_line_mask8(uint8_t *dst, int dst_delta,
+                             unsigned src, unsigned alpha,
+                             const uint8_t *mask, int w)
+{
+    int x;
+
+    for (x = 0; x < w; x++) {
+        unsigned a = mask[x] * alpha;
+        *dst = ((0x1010101 - a) * *dst + a * src) >> 24;
+        dst += dst_delta;
+    }
+}
+
 void ff_blend_mask(FFDrawContext *draw, FFDrawColor *color,
                    uint8_t *dst[], int dst_linesize[], int dst_w, int dst_h,
                    uint8_t *mask,  int mask_linesize, int mask_w, int mask_h,
@@ -472,6 +487,16 @@ void ff_blend_mask(FFDrawContext *draw, FFDrawColor *color,
                 continue;
             p = p0 + comp;
             m = mask;
+            if (l2depth == 3 && !draw->hsub[plane] && !draw->vsub[plane]) {
+                for (y = 0; y < h_sub; y++) {
+                    blend_line_mask8(p, draw->pixelstep[plane],
+                                     color->comp[plane].u8[comp], alpha,
+                                     m + xm0, w_sub);
+                    p += dst_linesize[plane];
+                    m += mask_linesize;
+                }
+                continue;
+            }
             if (top) {
                 blend_line_hv(p, draw->pixelstep[plane],
                               color->comp[plane].u8[comp], alpha,
@@ -500,6 +525,159 @@ void ff_blend_mask(FFDrawContext *draw, FFDrawColor *color,
     }
 }
 
+#define LAYER_ONE (1 << 15)
+
+void ff_draw_layer_free(FFDrawLayer *layer)
+{
+    int plane;
+
+    for (plane = 0; plane < MAX_PLANES; plane++) {
+        av_freep(&layer->transmit[plane]);
+        av_freep(&layer->color[plane]);
+        av_freep(&layer->row_used[plane]);
+    }
+    layer->w = layer->h = 0;
+}
+
+int ff_draw_layer_init(FFDrawContext *draw, FFDrawLayer *layer,
+                       int dst_w, int dst_h, int x0, int y0, int w, int h)
+{
+    int hmask = (1 << draw->hsub_max) - 1, vmask = (1 << draw->vsub_max) - 1;
+    int plane, i, n, wp, hp;
+
+    ff_draw_layer_free(layer);
+    clip_interval(dst_w, &x0, &w, NULL);
+    clip_interval(dst_h, &y0, &h, NULL);
+    if (w <= 0 || h <= 0)
+        return 0;
+    /* align the layer on the chroma grid, so that each of its samples
+       covers the same pixels as the samples of the image */
+    w += x0 & hmask;
+    h += y0 & vmask;
+    layer->x = x0 & ~hmask;
+    layer->y = y0 & ~vmask;
+    layer->w = FFMIN((w + hmask) & ~hmask, dst_w - layer->x);
+    layer->h = FFMIN((h + vmask) & ~vmask, dst_h - layer->y);
+
+    for (plane = 0; plane < ((draw->nb_planes - 1) | 1); plane++) {
+        wp = FF_CEIL_RSHIFT(layer->w, draw->hsub[plane]);
+        hp = FF_CEIL_RSHIFT(layer->h, draw->vsub[plane]);
+        layer->linesize[plane] = wp * draw->pixelstep[plane];
+        n = layer->linesize[plane] * hp;
+        layer->transmit[plane] = av_malloc(n * sizeof(*layer->transmit[plane]));
+        layer->color[plane]    = av_mallocz(n * sizeof(*layer->color[plane]));
+        layer->row_used[plane] = av_mallocz(hp);
+        if (!layer->transmit[plane] || !layer->color[plane] ||
+            !layer->row_used[plane]) {
+            ff_draw_layer_free(layer);
+            return AVERROR(ENOMEM);
+        }
+        for (i = 0; i < n; i++)
+            layer->transmit[plane][i] = LAYER_ONE;
+    }
+    return 0;
+}
+
+void ff_draw_layer_blend_mask(FFDrawContext *draw, FFDrawLayer *layer,
+                              FFDrawColor *color, const uint8_t *mask,
+                              int mask_linesize, int mask_w, int mask_h,
+                              int x0, int y0)
+{
+    unsigned plane, comp, step, hsub, vsub, t, cov, src;
+    int xs, ys, xs0, ys0, xs1, ys1, cx0, cx1, cy0, cy1, x, y;
+
+    /* restrict the mask to the layer */
+    x0 -= layer->x;
+    y0 -= layer->y;
+    if (x0 < 0) {
+        mask   -= x0;
+        mask_w += x0;
+        x0      = 0;
+    }
+    if (y0 < 0) {
+        mask   -= y0 * mask_linesize;
+        mask_h += y0;
+        y0      = 0;
+    }
+    mask_w = FFMIN(mask_w, layer->w - x0);
+    mask_h = FFMIN(mask_h, layer->h - y0);
+    if (mask_w <= 0 || mask_h <= 0 || !color->rgba[3])
+        return;
+
+    for (plane = 0; plane < ((draw->nb_planes - 1) | 1); plane++) {
+        step = draw->pixelstep[plane];
+        hsub = draw->hsub[plane];
+        vsub = draw->vsub[plane];
+        xs0  = x0 >> hsub;
+        ys0  = y0 >> vsub;
+        xs1  = (x0 + mask_w - 1) >> hsub;
+        ys1  = (y0 + mask_h - 1) >> vsub;
+        for (ys = ys0; ys <= ys1; ys++) {
+            uint16_t *tr = layer->transmit[plane] + ys * layer->linesize[plane];
+            uint32_t *co = layer->color[plane]    + ys * layer->linesize[plane];
+
+            cy0 = FFMAX( ys      << vsub, y0);
+            cy1 = FFMIN((ys + 1) << vsub, y0 + mask_h);
+            layer->row_used[plane][ys] = 1;
+            for (xs = xs0; xs <= xs1; xs++) {
+                cx0 = FFMAX( xs      << hsub, x0);
+                cx1 = FFMIN((xs + 1) << hsub, x0 + mask_w);
+                /* average the mask over the sample like ff_blend_mask() */
+                t = 0;
+                for (y = cy0; y < cy1; y++)
+                    for (x = cx0; x < cx1; x++)
+                        t += mask[(y - y0) * mask_linesize + x - x0];
+                t >>= hsub + vsub;
+                cov = (t * color->rgba[3] * LAYER_ONE + 65025 / 2) / 65025;
+                if (!cov)
+                    continue;
+                for (comp = 0; comp < step; comp++) {
+                    if (!component_used(draw, plane, comp))
+                        continue;
+                    src = color->comp[plane].u8[comp];
+                    tr[xs * step + comp] = (tr[xs * step + comp] * (LAYER_ONE - cov) +
+                                            LAYER_ONE / 2) >> 15;
+                    co[xs * step + comp] = (co[xs * step + comp] * (uint64_t)(LAYER_ONE - cov) +
+                                            LAYER_ONE / 2 >> 15) + src * cov;
+                }
+            }
+        }
+    }
+}
+
+/* dst = dst * (1 - A) + C, written so that the compiler can vectorize it */
+static void apply_layer_line(uint8_t *dst, const uint16_t *transmit,
+                             const uint32_t *color, int n)
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+        dst[i] = (dst[i] * transmit[i] + color[i] + LAYER_ONE / 2) >> 15;
+}
+
+void ff_draw_layer_apply(FFDrawContext *draw, FFDrawLayer *layer,
+                         uint8_t *dst[], int dst_linesize[])
+{
+    unsigned plane;
+    int y, hp;
+    uint8_t *p;
+
+    if (!layer->w || !layer->h)
+        return;
+    for (plane = 0; plane < ((draw->nb_planes - 1) | 1); plane++) {
+        p  = pointer_at(draw, dst, dst_linesize, plane, layer->x, layer->y);
+        hp = FF_CEIL_RSHIFT(layer->h, draw->vsub[plane]);
+        for (y = 0; y < hp; y++) {
+            if (layer->row_used[plane][y])
+                apply_layer_line(p,
+                                 layer->transmit[plane] + y * layer->linesize[plane],
+                                 layer->color[plane]    + y * layer->linesize[plane],
+                                 layer->linesize[plane]);
+            p += dst_linesize[plane];
+        }
+    }
+}
+
 int ff_draw_round_to_sub(FFDrawContext *draw, int sub_dir, int round_dir,
                          int value)
 {
@@ -133,6 +133,50 @@ void ff_blend_mask(FFDrawContext *draw, FFDrawColor *color,
                    uint8_t *mask, int mask_linesize, int mask_w, int mask_h,
                    int l2depth, unsigned endianness, int x0, int y0);
 
+/**
+ * Layer of blended masks, applied to images in one pass.
+ *
+ * It stores, for each sample of a rectangle of the image, the affine
+ * transform resulting from blending several masks in turn, so that the
+ * same overlay can be drawn on many images at the cost of one blend.
+ */
+typedef struct FFDrawLayer {
+    int x, y, w, h;                 ///< rectangle covered by the layer
+    uint16_t *transmit[MAX_PLANES]; ///< remaining weight of the image, 1 << 15 for none blended
+    uint32_t *color[MAX_PLANES];    ///< blended colors, premultiplied, 1 << 15 scale
+    uint8_t *row_used[MAX_PLANES];  ///< whether a mask was blended on each row of samples
+    int linesize[MAX_PLANES];       ///< number of elements per row
+} FFDrawLayer;
+
+/**
+ * Allocate a transparent layer covering the given rectangle, clipped to
+ * the image and aligned to the subsampling.
+ * Any previous content of the layer is freed.
+ * @return 0 for success, < 0 for error
+ */
+int ff_draw_layer_init(FFDrawContext *draw, FFDrawLayer *layer,
+                       int dst_w, int dst_h, int x0, int y0, int w, int h);
+
+/**
+ * Blend an 8 bpp alpha mask with an uniform color on a layer.
+ * The coverage of subsampled planes is computed like ff_blend_mask().
+ */
+void ff_draw_layer_blend_mask(FFDrawContext *draw, FFDrawLayer *layer,
+                              FFDrawColor *color, const uint8_t *mask,
+                              int mask_linesize, int mask_w, int mask_h,
+                              int x0, int y0);
+
+/**
+ * Blend a layer on an image, only on the rows where masks were blended.
+ */
+void ff_draw_layer_apply(FFDrawContext *draw, FFDrawLayer *layer,
+                         uint8_t *dst[], int dst_linesize[]);
+
+/**
+ * Free the buffers of a layer.
+ */
+void ff_draw_layer_free(FFDrawLayer *layer);
+
 /**
  * Round a dimension according to subsampling.
  *
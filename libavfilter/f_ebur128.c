@@ -39,25 +39,12 @@
 #include "libavutil/timestamp.h"
 #include "audio.h"
 #include "avfilter.h"
+#include "f_ebur128.h"
 #include "formats.h"
 #include "internal.h"
 
 #define MAX_CHANNELS 63
 
-/* pre-filter coefficients */
-#define PRE_B0  1.53512485958697
-#define PRE_B1 -2.69169618940638
-#define PRE_B2  1.19839281085285
-#define PRE_A1 -1.69065929318241
-#define PRE_A2  0.73248077421585
-
-/* RLB-filter coefficients */
-#define RLB_B0  1.0
-#define RLB_B1 -2.0
-#define RLB_B2  1.0
-#define RLB_A1 -1.99004745483398
-#define RLB_A2  0.99007225036621
-
 #define ABS_THRES    -70            ///< silence gate: we discard anything below this absolute (LUFS) threshold
 #define ABS_UP_THRES  10            ///< upper loud limit to consider (ABS_THRES being the minimum)
 #define HIST_GRAIN   100            ///< defines histogram precision
@@ -77,9 +64,7 @@ struct hist_entry {
 };
 
 struct integrator {
-    double *cache[MAX_CHANNELS];    ///< window of filtered samples (N ms)
-    int cache_pos;                  ///< focus on the last added bin in the cache array
-    double sum[MAX_CHANNELS];       ///< sum of the last N ms filtered samples (cache content)
+    int cache_pos;                  ///< focus on the last added bin in the cache arrays
     int filled;                     ///< 1 if the cache is completely filled, 0 otherwise
     double rel_threshold;           ///< relative threshold
     double sum_kept_powers;         ///< sum of the powers (weighted sums) above absolute threshold
@@ -109,11 +94,11 @@ typedef struct {
     double *ch_weighting;           ///< channel weighting mapping
     int sample_count;               ///< sample count used for refresh frequency, reset at refresh
 
-    /* Filter caches.
-     * The mult by 3 in the following is for X[i], X[i-1] and X[i-2] */
-    double x[MAX_CHANNELS * 3];     ///< 3 input samples cache for each channel
-    double y[MAX_CHANNELS * 3];     ///< 3 pre-filter samples cache for each channel
-    double z[MAX_CHANNELS * 3];     ///< 3 RLB-filter samples cache for each channel
+    /* filter caches and integration windows */
+    EBUR128Channel channels[MAX_CHANNELS];
+    int weighted[MAX_CHANNELS];     ///< indexes of the channels with a non-zero weighting
+    int nb_weighted;                ///< number of channels in weighted
+    EBUR128DSPContext dsp;
 
 #define I400_BINS  (48000 * 4 / 10)
 #define I3000_BINS (48000 * 3)
@@ -141,6 +126,7 @@ static const AVOption ebur128_options[] = {
     { "framelog", "force frame logging level", OFFSET(loglevel), AV_OPT_TYPE_INT, {.i64 = -1},   INT_MIN, INT_MAX, A|V|F, "level" },
         { "info",    "information logging level", 0, AV_OPT_TYPE_CONST, {.i64 = AV_LOG_INFO},    INT_MIN, INT_MAX, A|V|F, "level" },
         { "verbose", "verbose logging level",     0, AV_OPT_TYPE_CONST, {.i64 = AV_LOG_VERBOSE}, INT_MIN, INT_MAX, A|V|F, "level" },
+        { "quiet",   "no frame logging",          0, AV_OPT_TYPE_CONST, {.i64 = AV_LOG_QUIET},   INT_MIN, INT_MAX, A|V|F, "level" },
     { "metadata", "inject metadata in the filtergraph", OFFSET(metadata), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1, A|V|F },
     { NULL },
 };
@@ -373,11 +359,12 @@ static int config_audio_output(AVFilterLink *outlink)
 
         if (!ebur128->ch_weighting[i])
             continue;
+        ebur128->weighted[ebur128->nb_weighted++] = i;
 
         /* bins buffer for the two integration window (400ms and 3s) */
-        ebur128->i400.cache[i]  = av_calloc(I400_BINS,  sizeof(*ebur128->i400.cache[0]));
-        ebur128->i3000.cache[i] = av_calloc(I3000_BINS, sizeof(*ebur128->i3000.cache[0]));
-        if (!ebur128->i400.cache[i] || !ebur128->i3000.cache[i])
+        ebur128->channels[i].cache400  = av_calloc(I400_BINS,  sizeof(double));
+        ebur128->channels[i].cache3000 = av_calloc(I3000_BINS, sizeof(double));
+        if (!ebur128->channels[i].cache400 || !ebur128->channels[i].cache3000)
             return AVERROR(ENOMEM);
     }
 
@@ -403,13 +390,65 @@ static struct hist_entry *get_histogram(void)
     return h;
 }
 
+/**
+ * Run the K-weighting filters on one channel, and add the powers of the
+ * filtered samples to its integration windows.
+ */
+static void filter_channel(EBUR128Channel *ch, const double *src, int stride,
+                           int nb_samples, int pos400, int pos3000)
+{
+    double x1 = ch->x1, x2 = ch->x2;
+    double y1 = ch->y1, y2 = ch->y2;
+    double z1 = ch->z1, z2 = ch->z2;
+    double sum400 = ch->sum400, sum3000 = ch->sum3000;
+    double *cache400  = ch->cache400  + pos400;
+    double *cache3000 = ch->cache3000 + pos3000;
+    int i;
+
+    for (i = 0; i < nb_samples; i++) {
+        /* Y[i] = X[i]*b0 + X[i-1]*b1 + X[i-2]*b2 - Y[i-1]*a1 - Y[i-2]*a2 */
+        const double x0 = src[i * stride];
+        const double y0 = x0*PRE_B0 + x1*PRE_B1 + x2*PRE_B2 - y1*PRE_A1 - y2*PRE_A2;
+        const double z0 = y0*RLB_B0 + y1*RLB_B1 + y2*RLB_B2 - z1*RLB_A1 - z2*RLB_A2;
+        const double bin = z0 * z0;
+
+        x2 = x1; x1 = x0;
+        y2 = y1; y1 = y0;
+        z2 = z1; z1 = z0;
+
+        /* add the new value, and limit the sum to the cache size (400ms or 3s)
+         * by removing the oldest one */
+        sum400  = sum400  + bin - cache400[i];
+        sum3000 = sum3000 + bin - cache3000[i];
+
+        /* override old cache entry with the new value */
+        cache400[i]  = bin;
+        cache3000[i] = bin;
+    }
+
+    ch->x1 = x1; ch->x2 = x2;
+    ch->y1 = y1; ch->y2 = y2;
+    ch->z1 = z1; ch->z2 = z2;
+    ch->sum400  = sum400;
+    ch->sum3000 = sum3000;
+}
+
+static void filter_channels2_c(EBUR128Channel *ch0, EBUR128Channel *ch1,
+                               const double *src0, const double *src1,
+                               int stride, int nb_samples, int pos400, int pos3000)
+{
+    filter_channel(ch0, src0, stride, nb_samples, pos400, pos3000);
+    filter_channel(ch1, src1, stride, nb_samples, pos400, pos3000);
+}
+
 static av_cold int init(AVFilterContext *ctx)
 {
     EBUR128Context *ebur128 = ctx->priv;
     AVFilterPad pad;
 
     if (ebur128->loglevel != AV_LOG_INFO &&
-        ebur128->loglevel != AV_LOG_VERBOSE) {
+        ebur128->loglevel != AV_LOG_VERBOSE &&
+        ebur128->loglevel != AV_LOG_QUIET) {
         if (ebur128->do_video || ebur128->metadata)
             ebur128->loglevel = AV_LOG_VERBOSE;
         else
@@ -428,6 +467,10 @@ static av_cold int init(AVFilterContext *ctx)
     ebur128->integrated_loudness = ABS_THRES;
     ebur128->loudness_range = 0;
 
+    ebur128->dsp.filter_channels2 = filter_channels2_c;
+    if (ARCH_X86)
+        ff_ebur128_init_x86(&ebur128->dsp);
+
     /* insert output pads */
     if (ebur128->do_video) {
         pad = (AVFilterPad){
@@ -458,12 +501,11 @@ static av_cold int init(AVFilterContext *ctx)
 
 /* loudness and power should be set such as loudness = -0.691 +
  * 10*log10(power), we just avoid doing that calculus two times */
-static int gate_update(struct integrator *integ, double power,
-                       double loudness, int gate_thres)
+static void gate_update(struct integrator *integ, double power,
+                        double loudness, int gate_thres)
 {
     int ipower;
     double relative_threshold;
-    int gate_hist_pos;
 
     /* update powers histograms by incrementing current power count */
     ipower = av_clip(HIST_POS(loudness), 0, HIST_SIZE - 1);
@@ -476,162 +518,171 @@ static int gate_update(struct integrator *integ, double power,
     if (!relative_threshold)
         relative_threshold = 1e-12;
     integ->rel_threshold = LOUDNESS(relative_threshold) + gate_thres;
-    gate_hist_pos = av_clip(HIST_POS(integ->rel_threshold), 0, HIST_SIZE - 1);
-
-    return gate_hist_pos;
 }
 
-static int filter_frame(AVFilterLink *inlink, AVFrame *insamples)
+static void move_cache_pos(struct integrator *integ, int nb_bins, int nb_samples)
 {
-    int i, ch, idx_insample;
-    AVFilterContext *ctx = inlink->dst;
-    EBUR128Context *ebur128 = ctx->priv;
-    const int nb_channels = ebur128->nb_channels;
-    const int nb_samples  = insamples->nb_samples;
-    const double *samples = (double *)insamples->data[0];
-    AVFrame *pic = ebur128->outpicref;
-
-    for (idx_insample = 0; idx_insample < nb_samples; idx_insample++) {
-        const int bin_id_400  = ebur128->i400.cache_pos;
-        const int bin_id_3000 = ebur128->i3000.cache_pos;
-
-#define MOVE_TO_NEXT_CACHED_ENTRY(time) do {                \
-    ebur128->i##time.cache_pos++;                           \
-    if (ebur128->i##time.cache_pos == I##time##_BINS) {     \
-        ebur128->i##time.filled    = 1;                     \
-        ebur128->i##time.cache_pos = 0;                     \
-    }                                                       \
-} while (0)
+    integ->cache_pos += nb_samples;
+    if (integ->cache_pos == nb_bins) {
+        integ->filled    = 1;
+        integ->cache_pos = 0;
+    }
+}
 
-        MOVE_TO_NEXT_CACHED_ENTRY(400);
-        MOVE_TO_NEXT_CACHED_ENTRY(3000);
+/* Integrated loudness */
+#define I_GATE_THRES -10  // initially defined to -8 LU in the first EBU standard
 
-        for (ch = 0; ch < nb_channels; ch++) {
-            double bin;
+/**
+ * Compute integrated loudness by summing the histogram values above the
+ * relative threshold.
+ */
+static void compute_integrated_loudness(EBUR128Context *ebur128)
+{
+    const int gate_hist_pos = av_clip(HIST_POS(ebur128->i400.rel_threshold), 0, HIST_SIZE - 1);
+    double integrated_sum = 0;
+    int i, nb_integrated = 0;
 
-            ebur128->x[ch * 3] = *samples++; // set X[i]
+    if (!ebur128->i400.nb_kept_powers)
+        return;
 
-            if (!ebur128->ch_weighting[ch])
-                continue;
+    for (i = gate_hist_pos; i < HIST_SIZE; i++) {
+        const int nb_v = ebur128->i400.histogram[i].count;
+        nb_integrated  += nb_v;
+        integrated_sum += nb_v * ebur128->i400.histogram[i].energy;
+    }
+    if (nb_integrated)
+        ebur128->integrated_loudness = LOUDNESS(integrated_sum / nb_integrated);
+}
 
-            /* Y[i] = X[i]*b0 + X[i-1]*b1 + X[i-2]*b2 - Y[i-1]*a1 - Y[i-2]*a2 */
-#define FILTER(Y, X, name) do {                                                 \
-            double *dst = ebur128->Y + ch*3;                                    \
-            double *src = ebur128->X + ch*3;                                    \
-            dst[2] = dst[1];                                                    \
-            dst[1] = dst[0];                                                    \
-            dst[0] = src[0]*name##_B0 + src[1]*name##_B1 + src[2]*name##_B2     \
-                                      - dst[1]*name##_A1 - dst[2]*name##_A2;    \
-} while (0)
+/* LRA */
+#define LRA_GATE_THRES -20
+#define LRA_LOWER_PRC   10
+#define LRA_HIGHER_PRC  95
 
-            // TODO: merge both filters in one?
-            FILTER(y, x, PRE);  // apply pre-filter
-            ebur128->x[ch * 3 + 2] = ebur128->x[ch * 3 + 1];
-            ebur128->x[ch * 3 + 1] = ebur128->x[ch * 3    ];
-            FILTER(z, y, RLB);  // apply RLB-filter
+static void compute_loudness_range(EBUR128Context *ebur128)
+{
+    const int gate_hist_pos = av_clip(HIST_POS(ebur128->i3000.rel_threshold), 0, HIST_SIZE - 1);
+    int i, nb_powers = 0;
+
+    if (!ebur128->i3000.nb_kept_powers)
+        return;
+
+    for (i = gate_hist_pos; i < HIST_SIZE; i++)
+        nb_powers += ebur128->i3000.histogram[i].count;
+    if (nb_powers) {
+        int n, nb_pow;
+
+        /* get lower loudness to consider */
+        n = 0;
+        nb_pow = LRA_LOWER_PRC  * nb_powers / 100. + 0.5;
+        for (i = gate_hist_pos; i < HIST_SIZE; i++) {
+            n += ebur128->i3000.histogram[i].count;
+            if (n >= nb_pow) {
+                ebur128->lra_low = ebur128->i3000.histogram[i].loudness;
+                break;
+            }
+        }
 
-            bin = ebur128->z[ch * 3] * ebur128->z[ch * 3];
+        /* get higher loudness to consider */
+        n = nb_powers;
+        nb_pow = LRA_HIGHER_PRC * nb_powers / 100. + 0.5;
+        for (i = HIST_SIZE - 1; i >= 0; i--) {
+            n -= ebur128->i3000.histogram[i].count;
+            if (n < nb_pow) {
+                ebur128->lra_high = ebur128->i3000.histogram[i].loudness;
+                break;
+            }
+        }
 
-            /* add the new value, and limit the sum to the cache size (400ms or 3s)
-             * by removing the oldest one */
-            ebur128->i400.sum [ch] = ebur128->i400.sum [ch] + bin - ebur128->i400.cache [ch][bin_id_400];
-            ebur128->i3000.sum[ch] = ebur128->i3000.sum[ch] + bin - ebur128->i3000.cache[ch][bin_id_3000];
+        // XXX: show low & high on the graph?
+        ebur128->loudness_range = ebur128->lra_high - ebur128->lra_low;
+    }
+}
 
-            /* override old cache entry with the new value */
-            ebur128->i400.cache [ch][bin_id_400 ] = bin;
-            ebur128->i3000.cache[ch][bin_id_3000] = bin;
+static int filter_frame(AVFilterLink *inlink, AVFrame *insamples)
+{
+    int i, ch, idx_insample, nb_block;
+    AVFilterContext *ctx = inlink->dst;
+    EBUR128Context *ebur128 = ctx->priv;
+    const int nb_channels = ebur128->nb_channels;
+    const int nb_samples  = insamples->nb_samples;
+    const double *samples = (double *)insamples->data[0];
+    AVFrame *pic = ebur128->outpicref;
+    /* without video, metadata and frame logging, I and LRA are only needed
+     * for the summary, so they are computed once in uninit() */
+    const int measure_only = !ebur128->do_video && !ebur128->metadata &&
+                             ebur128->loglevel == AV_LOG_QUIET;
+
+    for (idx_insample = 0; idx_insample < nb_samples; idx_insample += nb_block) {
+        /* process blocks which do not cross a 100ms boundary nor the end of
+         * a cache */
+        nb_block = FFMIN(nb_samples - idx_insample, 4800 - ebur128->sample_count);
+        nb_block = FFMIN(nb_block, I400_BINS  - ebur128->i400.cache_pos);
+        nb_block = FFMIN(nb_block, I3000_BINS - ebur128->i3000.cache_pos);
+
+        /* the channels are filtered by pairs, which can be done in SIMD */
+        for (i = 0; i + 1 < ebur128->nb_weighted; i += 2) {
+            const int ch0 = ebur128->weighted[i], ch1 = ebur128->weighted[i + 1];
+            ebur128->dsp.filter_channels2(&ebur128->channels[ch0], &ebur128->channels[ch1],
+                                          samples + ch0, samples + ch1, nb_channels,
+                                          nb_block, ebur128->i400.cache_pos,
+                                          ebur128->i3000.cache_pos);
         }
+        if (i < ebur128->nb_weighted) {
+            ch = ebur128->weighted[i];
+            filter_channel(&ebur128->channels[ch], samples + ch, nb_channels,
+                           nb_block, ebur128->i400.cache_pos,
+                           ebur128->i3000.cache_pos);
+        }
+        move_cache_pos(&ebur128->i400,  I400_BINS,  nb_block);
+        move_cache_pos(&ebur128->i3000, I3000_BINS, nb_block);
+        samples += nb_block * nb_channels;
 
         /* For integrated loudness, gating blocks are 400ms long with 75%
          * overlap (see BS.1770-2 p5), so a re-computation is needed each 100ms
          * (4800 samples at 48kHz). */
-        if (++ebur128->sample_count == 4800) {
+        ebur128->sample_count += nb_block;
+        if (ebur128->sample_count == 4800) {
             double loudness_400, loudness_3000;
             double power_400 = 1e-12, power_3000 = 1e-12;
             AVFilterLink *outlink = ctx->outputs[0];
             const int64_t pts = insamples->pts +
-                av_rescale_q(idx_insample, (AVRational){ 1, inlink->sample_rate },
+                av_rescale_q(idx_insample + nb_block - 1,
+                             (AVRational){ 1, inlink->sample_rate },
                              outlink->time_base);
 
             ebur128->sample_count = 0;
 
-#define COMPUTE_LOUDNESS(m, time) do {                                              \
-    if (ebur128->i##time.filled) {                                                  \
-        /* weighting sum of the last <time> ms */                                   \
-        for (ch = 0; ch < nb_channels; ch++)                                        \
-            power_##time += ebur128->ch_weighting[ch] * ebur128->i##time.sum[ch];   \
-        power_##time /= I##time##_BINS;                                             \
-    }                                                                               \
-    loudness_##time = LOUDNESS(power_##time);                                       \
+#define COMPUTE_LOUDNESS(m, time) do {                                                 \
+    if (ebur128->i##time.filled) {                                                     \
+        /* weighting sum of the last <time> ms */                                      \
+        for (ch = 0; ch < nb_channels; ch++)                                           \
+            power_##time += ebur128->ch_weighting[ch] * ebur128->channels[ch].sum##time; \
+        power_##time /= I##time##_BINS;                                                \
+    }                                                                                  \
+    loudness_##time = LOUDNESS(power_##time);                                          \
 } while (0)
 
             COMPUTE_LOUDNESS(M,  400);
             COMPUTE_LOUDNESS(S, 3000);
 
-            /* Integrated loudness */
-#define I_GATE_THRES -10  // initially defined to -8 LU in the first EBU standard
-
             if (loudness_400 >= ABS_THRES) {
-                double integrated_sum = 0;
-                int nb_integrated = 0;
-                int gate_hist_pos = gate_update(&ebur128->i400, power_400,
-                                                loudness_400, I_GATE_THRES);
-
-                /* compute integrated loudness by summing the histogram values
-                 * above the relative threshold */
-                for (i = gate_hist_pos; i < HIST_SIZE; i++) {
-                    const int nb_v = ebur128->i400.histogram[i].count;
-                    nb_integrated  += nb_v;
-                    integrated_sum += nb_v * ebur128->i400.histogram[i].energy;
-                }
-                if (nb_integrated)
-                    ebur128->integrated_loudness = LOUDNESS(integrated_sum / nb_integrated);
+                gate_update(&ebur128->i400, power_400, loudness_400, I_GATE_THRES);
+                if (!measure_only)
+                    compute_integrated_loudness(ebur128);
             }
 
-            /* LRA */
-#define LRA_GATE_THRES -20
-#define LRA_LOWER_PRC   10
-#define LRA_HIGHER_PRC  95
-
             /* XXX: example code in EBU 3342 is ">=" but formula in BS.1770
              * specs is ">" */
             if (loudness_3000 >= ABS_THRES) {
-                int nb_powers = 0;
-                int gate_hist_pos = gate_update(&ebur128->i3000, power_3000,
-                                                loudness_3000, LRA_GATE_THRES);
-
-                for (i = gate_hist_pos; i < HIST_SIZE; i++)
-                    nb_powers += ebur128->i3000.histogram[i].count;
-                if (nb_powers) {
-                    int n, nb_pow;
-
-                    /* get lower loudness to consider */
-                    n = 0;
-                    nb_pow = LRA_LOWER_PRC  * nb_powers / 100. + 0.5;
-                    for (i = gate_hist_pos; i < HIST_SIZE; i++) {
-                        n += ebur128->i3000.histogram[i].count;
-                        if (n >= nb_pow) {
-                            ebur128->lra_low = ebur128->i3000.histogram[i].loudness;
-                            break;
-                        }
-                    }
-
-                    /* get higher loudness to consider */
-                    n = nb_powers;
-                    nb_pow = LRA_HIGHER_PRC * nb_powers / 100. + 0.5;
-                    for (i = HIST_SIZE - 1; i >= 0; i--) {
-                        n -= ebur128->i3000.histogram[i].count;
-                        if (n < nb_pow) {
-                            ebur128->lra_high = ebur128->i3000.histogram[i].loudness;
-                            break;
-                        }
-                    }
-
-                    // XXX: show low & high on the graph?
-                    ebur128->loudness_range = ebur128->lra_high - ebur128->lra_low;
-                }
+                gate_update(&ebur128->i3000, power_3000, loudness_3000, LRA_GATE_THRES);
+                if (!measure_only)
+                    compute_loudness_range(ebur128);
             }
 
+            if (measure_only)
+                continue;
+
 #define LOG_FMT "M:%6.1f S:%6.1f     I:%6.1f LUFS     LRA:%6.1f LU"
 
             /* push one video frame */
@@ -689,10 +740,11 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *insamples)
                 SET_META("LRA.high", ebur128->lra_high);
             }
 
-            av_log(ctx, ebur128->loglevel, "t: %-10s " LOG_FMT "\n",
-                   av_ts2timestr(pts, &outlink->time_base),
-                   loudness_400, loudness_3000,
-                   ebur128->integrated_loudness, ebur128->loudness_range);
+            if (ebur128->loglevel != AV_LOG_QUIET)
+                av_log(ctx, ebur128->loglevel, "t: %-10s " LOG_FMT "\n",
+                       av_ts2timestr(pts, &outlink->time_base),
+                       loudness_400, loudness_3000,
+                       ebur128->integrated_loudness, ebur128->loudness_range);
         }
     }
 
@@ -749,6 +801,9 @@ static av_cold void uninit(AVFilterContext *ctx)
     int i;
     EBUR128Context *ebur128 = ctx->priv;
 
+    compute_integrated_loudness(ebur128);
+    compute_loudness_range(ebur128);
+
     av_log(ctx, AV_LOG_INFO, "Summary:\n\n"
            "  Integrated loudness:\n"
            "    I:         %5.1f LUFS\n"
@@ -767,8 +822,8 @@ static av_cold void uninit(AVFilterContext *ctx)
     av_freep(&ebur128->i400.histogram);
     av_freep(&ebur128->i3000.histogram);
     for (i = 0; i < ebur128->nb_channels; i++) {
-        av_freep(&ebur128->i400.cache[i]);
-        av_freep(&ebur128->i3000.cache[i]);
+        av_freep(&ebur128->channels[i].cache400);
+        av_freep(&ebur128->channels[i].cache3000);
     }
     for (i = 0; i < ctx->nb_outputs; i++)
         av_freep(&ctx->output_pads[i].name);
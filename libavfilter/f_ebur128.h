@@ -0,0 +1,68 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef AVFILTER_F_EBUR128_H
+#define AVFILTER_F_EBUR128_H
+
+/* pre-filter coefficients */
+#define PRE_B0  1.53512485958697
+#define PRE_B1 -2.69169618940638
+#define PRE_B2  1.19839281085285
+#define PRE_A1 -1.69065929318241
+#define PRE_A2  0.73248077421585
+
+/* RLB-filter coefficients */
+#define RLB_B0  1.0
+#define RLB_B1 -2.0
+#define RLB_B2  1.0
+#define RLB_A1 -1.99004745483398
+#define RLB_A2  0.99007225036621
+
+/**
+ * K-weighting filters and integration windows state of one channel.
+ * The asm code depends on the layout of the first 8 fields.
+ */
+typedef struct EBUR128Channel {
+    double x1, x2;                  ///< X[i-1] and X[i-2] input samples
+    double y1, y2;                  ///< Y[i-1] and Y[i-2] pre-filter samples
+    double z1, z2;                  ///< Z[i-1] and Z[i-2] RLB-filter samples
+    double sum400;                  ///< sum of the powers in cache400
+    double sum3000;                 ///< sum of the powers in cache3000
+    double *cache400;               ///< window of filtered sample powers (400ms)
+    double *cache3000;              ///< window of filtered sample powers (3s)
+} EBUR128Channel;
+
+typedef struct EBUR128DSPContext {
+    /**
+     * Run the K-weighting filters on two channels, and add the powers of the
+     * filtered samples to their 400ms and 3s windows, removing the oldest ones.
+     *
+     * @param src0       first sample of the first channel
+     * @param src1       first sample of the second channel
+     * @param stride     distance between two samples of a channel, in samples
+     * @param pos400     position of the first sample in cache400
+     * @param pos3000    position of the first sample in cache3000
+     */
+    void (*filter_channels2)(EBUR128Channel *ch0, EBUR128Channel *ch1,
+                             const double *src0, const double *src1,
+                             int stride, int nb_samples, int pos400, int pos3000);
+} EBUR128DSPContext;
+
+void ff_ebur128_init_x86(EBUR128DSPContext *dsp);
+
+#endif /* AVFILTER_F_EBUR128_H */
@@ -32,12 +32,9 @@
 #include "audio.h"
 #include "formats.h"
 #include "internal.h"
+#include "scene_sad.h"
 #include "video.h"
 
-#if CONFIG_AVCODEC
-#include "libavcodec/dsputil.h"
-#endif
-
 static const char *const var_names[] = {
     "TB",                ///< timebase
 
@@ -138,30 +135,40 @@ enum var_name {
     VAR_VARS_NB
 };
 
+enum SceneMode {
+    SCENE_MODE_SAD,
+    SCENE_MODE_HIST,
+    SCENE_MODE_NB
+};
+
 typedef struct {
     const AVClass *class;
     char *expr_str;
     AVExpr *expr;
     double var_values[VAR_VARS_NB];
     int do_scene_detect;            ///< 1 if the expression requires scene detection variables, 0 otherwise
-#if CONFIG_AVCODEC
-    AVCodecContext *avctx;          ///< codec context required for the DSPContext (scene detect only)
-    DSPContext c;                   ///< context providing optimized SAD methods   (scene detect only)
+    ff_scene_sad_fn sad;            ///< sum of absolute differences function      (scene detect only)
     double prev_mafd;               ///< previous MAFD                             (scene detect only)
-#endif
     AVFrame *prev_picref; ///< previous frame                            (scene detect only)
+    int scene_scale;                ///< downscaling factor of the luma thumbnails (scene detect only)
+    int scene_mode;                 ///< SceneMode used to compute the score       (scene detect only)
+    int thumb_scale;                ///< actual downscaling factor, clipped to the picture size
+    int thumb_w, thumb_h, thumb_linesize;
+    uint8_t *thumb[2];              ///< current and previous luma thumbnails, NULL if unused
+    int have_thumb;                 ///< 1 if thumb[0] holds the thumbnail of a previous frame
     double select;
     int select_out;                 ///< mark the selected output pad index
     int nb_outputs;
 } SelectContext;
 
 #define OFFSET(x) offsetof(SelectContext, x)
-#define DEFINE_OPTIONS(filt_name, FLAGS)                            \
+#define DEFINE_OPTIONS(filt_name, FLAGS, extra_options)             \
 static const AVOption filt_name##_options[] = {                     \
     { "expr", "set an expression to use for selecting frames", OFFSET(expr_str), AV_OPT_TYPE_STRING, { .str = "1" }, .flags=FLAGS }, \
     { "e",    "set an expression to use for selecting frames", OFFSET(expr_str), AV_OPT_TYPE_STRING, { .str = "1" }, .flags=FLAGS }, \
     { "outputs", "set the number of outputs", OFFSET(nb_outputs), AV_OPT_TYPE_INT, {.i64 = 1}, 1, INT_MAX, .flags=FLAGS }, \
     { "n",       "set the number of outputs", OFFSET(nb_outputs), AV_OPT_TYPE_INT, {.i64 = 1}, 1, INT_MAX, .flags=FLAGS }, \
+    extra_options                                                       \
     { NULL }                                                            \
 }
 
@@ -240,55 +247,128 @@ static int config_input(AVFilterLink *inlink)
     select->var_values[VAR_SAMPLE_RATE] =
         inlink->type == AVMEDIA_TYPE_AUDIO ? inlink->sample_rate : NAN;
 
-#if CONFIG_AVCODEC
     if (select->do_scene_detect) {
-        select->avctx = avcodec_alloc_context3(NULL);
-        if (!select->avctx)
-            return AVERROR(ENOMEM);
-        avpriv_dsputil_init(&select->c, select->avctx);
+        select->sad = ff_scene_sad_get_fn();
+
+        if (select->scene_scale > 1 || select->scene_mode == SCENE_MODE_HIST) {
+            int i;
+
+            select->thumb_scale    = FFMIN3(select->scene_scale, inlink->w, inlink->h);
+            select->thumb_w        = inlink->w / select->thumb_scale;
+            select->thumb_h        = inlink->h / select->thumb_scale;
+            select->thumb_linesize = FFALIGN(select->thumb_w, 32);
+            select->have_thumb     = 0;
+            for (i = 0; i < 2; i++) {
+                av_freep(&select->thumb[i]);
+                select->thumb[i] = av_malloc(select->thumb_linesize * select->thumb_h);
+                if (!select->thumb[i])
+                    return AVERROR(ENOMEM);
+            }
+        }
     }
-#endif
     return 0;
 }
 
-#if CONFIG_AVCODEC
+/**
+ * Downscale the RGB24/BGR24 frame to a luma thumbnail, averaging
+ * (R + 2G + B) / 4 over blocks of thumb_scale x thumb_scale pixels.
+ */
+static void make_thumbnail(SelectContext *select, const AVFrame *frame, uint8_t *dst)
+{
+    const int scale = select->thumb_scale;
+    const int area  = 4 * scale * scale;
+    int x, y, i, j;
+
+    for (y = 0; y < select->thumb_h; y++) {
+        const uint8_t *src = frame->data[0] + y * scale * frame->linesize[0];
+
+        for (x = 0; x < select->thumb_w; x++) {
+            unsigned sum = 0;
+
+            for (j = 0; j < scale; j++) {
+                const uint8_t *p = src + j * frame->linesize[0] + x * scale * 3;
+                for (i = 0; i < scale; i++, p += 3)
+                    sum += p[0] + 2 * p[1] + p[2];
+            }
+            dst[x] = (sum + area / 2) / area;
+        }
+        dst += select->thumb_linesize;
+    }
+}
+
+static double get_hist_score(SelectContext *select)
+{
+    int hist[2][256] = { { 0 } };
+    int64_t diff = 0;
+    int i, x, y;
+
+    for (i = 0; i < 2; i++) {
+        const uint8_t *p = select->thumb[i];
+        for (y = 0; y < select->thumb_h; y++) {
+            for (x = 0; x < select->thumb_w; x++)
+                hist[i][p[x]]++;
+            p += select->thumb_linesize;
+        }
+    }
+    for (i = 0; i < 256; i++)
+        diff += FFABS(hist[0][i] - hist[1][i]);
+    return diff / (2.0 * select->thumb_w * select->thumb_h);
+}
+
+static double get_mafd_score(SelectContext *select, double mafd)
+{
+    double diff = fabs(mafd - select->prev_mafd);
+
+    select->prev_mafd = mafd;
+    return av_clipf(FFMIN(mafd, diff) / 100., 0, 1);
+}
+
 static double get_scene_score(AVFilterContext *ctx, AVFrame *frame)
 {
     double ret = 0;
     SelectContext *select = ctx->priv;
     AVFrame *prev_picref = select->prev_picref;
 
-    if (prev_picref &&
-        frame->height    == prev_picref->height &&
-        frame->width    == prev_picref->width &&
-        frame->linesize[0] == prev_picref->linesize[0]) {
-        int x, y, nb_sad = 0;
-        int64_t sad = 0;
-        double mafd, diff;
-        uint8_t *p1 =      frame->data[0];
-        uint8_t *p2 = prev_picref->data[0];
-        const int linesize = frame->linesize[0];
-
-        for (y = 0; y < frame->height - 8; y += 8) {
-            for (x = 0; x < frame->width*3 - 8; x += 8) {
-                sad += select->c.sad[1](select, p1 + x, p2 + x,
-                                        linesize, 8);
-                nb_sad += 8 * 8;
+    if (select->thumb[0]) {
+        if (frame->width  != ctx->inputs[0]->w ||
+            frame->height != ctx->inputs[0]->h) {
+            select->have_thumb = 0;
+            return 0;
+        }
+        FFSWAP(uint8_t *, select->thumb[0], select->thumb[1]);
+        make_thumbnail(select, frame, select->thumb[0]);
+        if (select->have_thumb) {
+            if (select->scene_mode == SCENE_MODE_HIST) {
+                ret = get_hist_score(select);
+            } else {
+                uint64_t sad = select->sad(select->thumb[0], select->thumb_linesize,
+                                           select->thumb[1], select->thumb_linesize,
+                                           select->thumb_w, select->thumb_h);
+                ret = get_mafd_score(select, (double)sad / (select->thumb_w * select->thumb_h));
             }
-            p1 += 8 * linesize;
-            p2 += 8 * linesize;
         }
-        emms_c();
-        mafd = nb_sad ? sad / nb_sad : 0;
-        diff = fabs(mafd - select->prev_mafd);
-        ret  = av_clipf(FFMIN(mafd, diff) / 100., 0, 1);
-        select->prev_mafd = mafd;
+        select->have_thumb = 1;
+        return ret;
+    }
+
+    if (prev_picref &&
+        frame->height    == prev_picref->height &&
+        frame->width    == prev_picref->width) {
+        /* only whole 8x8 blocks not touching the right and bottom edges
+         * are compared */
+        int nb_x = (frame->width * 3 - 1) / 8;
+        int nb_y = (frame->height    - 1) / 8;
+        int64_t nb_sad = 64LL * nb_x * nb_y;
+        uint64_t sad = select->sad(frame->data[0], frame->linesize[0],
+                                   prev_picref->data[0], prev_picref->linesize[0],
+                                   8 * nb_x, 8 * nb_y);
+
+        ret = get_mafd_score(select, nb_sad ? sad / nb_sad : 0);
         av_frame_free(&prev_picref);
     }
     select->prev_picref = av_frame_clone(frame);
     return ret;
 }
-#endif
 
 #define D2TS(d)  (isnan(d) ? AV_NOPTS_VALUE : (int64_t)(d))
 #define TS2D(ts) ((ts) == AV_NOPTS_VALUE ? NAN : (double)(ts))
@@ -319,7 +399,6 @@ static void select_frame(AVFilterContext *ctx, AVFrame *frame)
             !frame->interlaced_frame ? INTERLACE_TYPE_P :
         frame->top_field_first ? INTERLACE_TYPE_T : INTERLACE_TYPE_B;
         select->var_values[VAR_PICT_TYPE] = frame->pict_type;
-#if CONFIG_AVCODEC
         if (select->do_scene_detect) {
             char buf[32];
             select->var_values[VAR_SCENE] = get_scene_score(ctx, frame);
@@ -327,7 +406,6 @@ static void select_frame(AVFilterContext *ctx, AVFrame *frame)
             snprintf(buf, sizeof(buf), "%f", select->var_values[VAR_SCENE]);
             av_dict_set(avpriv_frame_get_metadatap(frame), "lavfi.scene_score", buf, 0);
         }
-#endif
         break;
     }
 
@@ -418,15 +496,11 @@ static av_cold void uninit(AVFilterContext *ctx)
     for (i = 0; i < ctx->nb_outputs; i++)
         av_freep(&ctx->output_pads[i].name);
 
-#if CONFIG_AVCODEC
     if (select->do_scene_detect) {
         av_frame_free(&select->prev_picref);
-        if (select->avctx) {
-            avcodec_close(select->avctx);
-            av_freep(&select->avctx);
-        }
+        av_freep(&select->thumb[0]);
+        av_freep(&select->thumb[1]);
     }
-#endif
 }
 
 static int query_formats(AVFilterContext *ctx)
@@ -447,7 +521,7 @@ static int query_formats(AVFilterContext *ctx)
 
 #if CONFIG_ASELECT_FILTER
 
-DEFINE_OPTIONS(aselect, AV_OPT_FLAG_AUDIO_PARAM|AV_OPT_FLAG_FILTERING_PARAM);
+DEFINE_OPTIONS(aselect, AV_OPT_FLAG_AUDIO_PARAM|AV_OPT_FLAG_FILTERING_PARAM, );
 AVFILTER_DEFINE_CLASS(aselect);
 
 static av_cold int aselect_init(AVFilterContext *ctx)
@@ -491,24 +565,15 @@ AVFilter avfilter_af_aselect = {
 
 #if CONFIG_SELECT_FILTER
 
-DEFINE_OPTIONS(select, AV_OPT_FLAG_VIDEO_PARAM|AV_OPT_FLAG_FILTERING_PARAM);
-AVFILTER_DEFINE_CLASS(select);
-
-static av_cold int select_init(AVFilterContext *ctx)
-{
-    SelectContext *select = ctx->priv;
-    int ret;
-
-    if ((ret = init(ctx)) < 0)
-        return ret;
+#define VFLAGS AV_OPT_FLAG_VIDEO_PARAM|AV_OPT_FLAG_FILTERING_PARAM
+#define SCENE_OPTIONS                                                   \
+    { "scene_scale", "set the downscaling factor of the pictures compared by scene detection", OFFSET(scene_scale), AV_OPT_TYPE_INT, {.i64 = 1}, 1, 64, .flags=VFLAGS }, \
+    { "scene_mode",  "set the scene detection method", OFFSET(scene_mode), AV_OPT_TYPE_INT, {.i64 = SCENE_MODE_SAD}, 0, SCENE_MODE_NB-1, .flags=VFLAGS, "scene_mode" }, \
+        { "sad",  "mean absolute difference of the pictures",  0, AV_OPT_TYPE_CONST, {.i64 = SCENE_MODE_SAD},  INT_MIN, INT_MAX, VFLAGS, "scene_mode" }, \
+        { "hist", "difference of the luma histograms",         0, AV_OPT_TYPE_CONST, {.i64 = SCENE_MODE_HIST}, INT_MIN, INT_MAX, VFLAGS, "scene_mode" },
 
-    if (select->do_scene_detect && !CONFIG_AVCODEC) {
-        av_log(ctx, AV_LOG_ERROR, "Scene detection is not available without libavcodec.\n");
-        return AVERROR(EINVAL);
-    }
-
-    return 0;
-}
+DEFINE_OPTIONS(select, VFLAGS, SCENE_OPTIONS);
+AVFILTER_DEFINE_CLASS(select);
 
 static const AVFilterPad avfilter_vf_select_inputs[] = {
     {
@@ -524,7 +589,7 @@ static const AVFilterPad avfilter_vf_select_inputs[] = {
 AVFilter avfilter_vf_select = {
     .name      = "select",
     .description = NULL_IF_CONFIG_SMALL("Select video frames to pass in output."),
-    .init      = select_init,
+    .init      = init,
     .uninit    = uninit,
     .query_formats = query_formats,
 
@@ -153,6 +153,8 @@ AVFilter avfilter_vf_settb = {
 
     .inputs    = avfilter_vf_settb_inputs,
     .outputs   = avfilter_vf_settb_outputs,
+
+    .flags     = AVFILTER_FLAG_SUPPORT_HWACCEL,
 };
 #endif
 
@@ -554,8 +554,18 @@ static int default_query_formats_common(AVFilterContext *ctx,
     enum AVMediaType type = ctx->inputs  && ctx->inputs [0] ? ctx->inputs [0]->type :
                             ctx->outputs && ctx->outputs[0] ? ctx->outputs[0]->type :
                             AVMEDIA_TYPE_VIDEO;
+    AVFilterFormats *formats = ff_all_formats(type);
+
+    if (type == AVMEDIA_TYPE_VIDEO &&
+        (ctx->filter->flags & AVFILTER_FLAG_SUPPORT_HWACCEL)) {
+        const AVPixFmtDescriptor *desc = NULL;
+        while ((desc = av_pix_fmt_desc_next(desc)))
+            if (desc->flags & AV_PIX_FMT_FLAG_HWACCEL &&
+                ff_add_format(&formats, av_pix_fmt_desc_get_id(desc)) < 0)
+                break;
+    }
 
-    ff_set_common_formats(ctx, ff_all_formats(type));
+    ff_set_common_formats(ctx, formats);
     if (type == AVMEDIA_TYPE_AUDIO) {
         ff_set_common_channel_layouts(ctx, layouts());
         ff_set_common_samplerates(ctx, ff_all_samplerates());
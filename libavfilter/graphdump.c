@@ -58,7 +58,20 @@ static int print_link_prop(AVBPrint *buf, AVFilterLink *link)
     return buf->len;
 }
 
-static void avfilter_graph_dump_to_buf(AVBPrint *buf, AVFilterGraph *graph)
+static void print_filter_stats(AVBPrint *buf, AVFilterContext *filter)
+{
+    const AVFilterStats *st = avfilter_get_stats(filter);
+
+    av_bprintf(buf, "frames in:%"PRId64" out:%"PRId64
+               " filter_frame:%"PRId64"us request_frame:%"PRId64"us"
+               " allocated:%"PRId64"B queued:%d\n",
+               st->nb_frames_in, st->nb_frames_out,
+               st->filter_frame_time, st->request_frame_time,
+               st->bytes_allocated, st->nb_queued);
+}
+
+static void avfilter_graph_dump_to_buf(AVBPrint *buf, AVFilterGraph *graph,
+                                       int profile)
 {
     unsigned i, j, x, e;
 
@@ -146,6 +159,10 @@ static void avfilter_graph_dump_to_buf(AVBPrint *buf, AVFilterGraph *graph)
         av_bprintf(buf, "+");
         av_bprint_chars(buf, '-', width);
         av_bprintf(buf, "+\n");
+        if (profile) {
+            av_bprint_chars(buf, ' ', in_indent);
+            print_filter_stats(buf, filter);
+        }
         av_bprintf(buf, "\n");
     }
 }
@@ -154,11 +171,12 @@ char *avfilter_graph_dump(AVFilterGraph *graph, const char *options)
 {
     AVBPrint buf;
     char *dump;
+    int profile = options && !strcmp(options, "profile");
 
     av_bprint_init(&buf, 0, 0);
-    avfilter_graph_dump_to_buf(&buf, graph);
+    avfilter_graph_dump_to_buf(&buf, graph, profile);
     av_bprint_init(&buf, buf.len + 1, buf.len + 1);
-    avfilter_graph_dump_to_buf(&buf, graph);
+    avfilter_graph_dump_to_buf(&buf, graph, profile);
     av_bprint_finalize(&buf, &dump);
     return dump;
 }
@@ -146,11 +146,25 @@ struct AVFilterGraphInternal {
     void *thread;
     int (*thread_execute)(AVFilterContext *ctx, action_func *func, void *arg,
                           int *ret, int nb_jobs);
+    void *pipeline;
 };
 
+/**
+ * Timing of a running filter callback, used to exclude the nested calls to
+ * the neighbouring filters from the profiling counters.
+ */
+typedef struct FFFilterProfile {
+    int64_t start;
+    int64_t nested;
+    struct FFFilterProfile *parent;
+} FFFilterProfile;
+
 struct AVFilterInternal {
     int (*execute)(AVFilterContext *ctx, action_func *func, void *arg,
                    int *ret, int nb_jobs);
+
+    AVFilterStats stats;
+    FFFilterProfile *profile; ///< innermost running callback, or NULL
 };
 
 /** default handler for freeing audio/video buffer when there are no references left */
@@ -301,6 +315,18 @@ int ff_poll_frame(AVFilterLink *link);
  */
 int ff_request_frame(AVFilterLink *link);
 
+/**
+ * Call the request_frame() callback of the source pad of a link and
+ * account its time in the profiling counters of the source filter.
+ */
+int ff_call_request_frame(AVFilterLink *link);
+
+/**
+ * Account the buffers of a frame allocated by a filter in its profiling
+ * counters.
+ */
+void ff_filter_stats_add_alloc(AVFilterContext *ctx, const AVFrame *frame);
+
 #define AVFILTER_DEFINE_CLASS(fname)            \
     static const AVClass fname##_class = {      \
         .class_name = #fname,                   \
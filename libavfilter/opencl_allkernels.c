@@ -22,7 +22,9 @@
 #if CONFIG_OPENCL
 #include "libavutil/opencl.h"
 #include "deshake_opencl_kernel.h"
+#include "scale_opencl_kernel.h"
 #include "unsharp_opencl_kernel.h"
+#include "yadif_opencl_kernel.h"
 #endif
 
 #define OPENCL_REGISTER_KERNEL_CODE(X, x)                                              \
@@ -36,6 +38,8 @@ void ff_opencl_register_filter_kernel_code_all(void)
 {
  #if CONFIG_OPENCL
    OPENCL_REGISTER_KERNEL_CODE(DESHAKE,     deshake);
+   OPENCL_REGISTER_KERNEL_CODE(SCALE,       scale);
    OPENCL_REGISTER_KERNEL_CODE(UNSHARP,     unsharp);
+   OPENCL_REGISTER_KERNEL_CODE(YADIF,       yadif);
  #endif
 }
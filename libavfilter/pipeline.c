@@ -0,0 +1,503 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Pipelined execution of filter graphs
+ *
+ * The links of the linear chains of the graph become thread boundaries: the
+ * filters upstream of such a link (up to the previous boundaries) form a
+ * segment which is executed by a worker thread dedicated to the link. The
+ * worker keeps requesting frames from its segment and queues them on the
+ * link, up to the configured queue size. The thread executing the segment
+ * downstream of the link dequeues them when it requests a frame on it, the
+ * segment containing the sinks being executed by the caller of the graph.
+ *
+ * Each segment is thus only ever executed by a single thread, and only the
+ * queues and the sources fed by the caller need to be locked.
+ */
+
+#include "config.h"
+
+#include "libavutil/avassert.h"
+#include "libavutil/fifo.h"
+#include "libavutil/mem.h"
+
+#include "avfilter.h"
+#include "internal.h"
+#include "thread.h"
+
+#if HAVE_PTHREADS
+#include <pthread.h>
+#elif HAVE_OS2THREADS
+#include "compat/os2threads.h"
+#elif HAVE_W32THREADS
+#include "compat/w32pthreads.h"
+#endif
+
+typedef struct Pipeline Pipeline;
+
+typedef struct PipelineLink {
+    Pipeline *p;
+    AVFilterLink *link;
+    pthread_t thread;
+    AVFifoBuffer *queue;
+    int nb_queued;
+    int status;         ///< error returned by the segment, or AVERROR_EOF
+    int starved;        ///< the segment returned AVERROR(EAGAIN)
+    unsigned starved_generation;
+    int frame_received; ///< only accessed by the worker
+    int caller_side;    ///< the link is dequeued by the caller of the graph
+} PipelineLink;
+
+struct Pipeline {
+    PipelineLink *links;
+    int nb_links;
+    int queue_size;
+
+    /* sources executed by the worker threads */
+    AVFilterContext **sources;
+    int nb_sources;
+
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int nb_threads;
+    unsigned generation; ///< incremented each time new input is available
+    int stop;
+    int nonblock;        ///< only accessed by the caller of the graph
+};
+
+/**
+ * Return 1 if the segment upstream of pl is waiting for new input, which
+ * is not the case anymore if any input arrived since it last failed.
+ */
+static int is_starved(PipelineLink *pl)
+{
+    return pl->starved && pl->starved_generation == pl->p->generation;
+}
+
+static int find_segment(int *segment, int i)
+{
+    while (segment[i] != i)
+        i = segment[i] = segment[segment[i]];
+    return i;
+}
+
+static int filter_index(AVFilterGraph *graph, AVFilterContext *f)
+{
+    int i;
+    for (i = 0; i < graph->nb_filters; i++)
+        if (graph->filters[i] == f)
+            return i;
+    av_assert0(0);
+    return -1;
+}
+
+/**
+ * Split the graph in segments delimited by the links selected in boundary,
+ * and store the segment of each filter in segment.
+ */
+static void compute_segments(AVFilterGraph *graph, AVFilterLink **links,
+                             int nb_links, const uint8_t *boundary, int *segment)
+{
+    int i;
+
+    for (i = 0; i < graph->nb_filters; i++)
+        segment[i] = i;
+    for (i = 0; i < nb_links; i++) {
+        int src, dst;
+        if (boundary[i])
+            continue;
+        src = find_segment(segment, filter_index(graph, links[i]->src));
+        dst = find_segment(segment, filter_index(graph, links[i]->dst));
+        segment[src] = dst;
+    }
+    for (i = 0; i < graph->nb_filters; i++)
+        segment[i] = find_segment(segment, i);
+}
+
+/**
+ * Select the links to run in their own thread. A segment must have a single
+ * thread requesting frames from it, so it may have a single output link among
+ * the boundaries and no sink, or no output boundary at all.
+ *
+ * @return the number of selected links
+ */
+static int select_boundaries(AVFilterGraph *graph, AVFilterLink **links,
+                             int nb_links, uint8_t *boundary, int *segment)
+{
+    int *nb_outputs = av_calloc(graph->nb_filters, sizeof(*nb_outputs));
+    int i, changed, nb_boundaries;
+
+    if (!nb_outputs)
+        return AVERROR(ENOMEM);
+
+    /* only consider the links of linear chains, leaving the sources with
+     * the first filter they feed */
+    for (i = 0; i < nb_links; i++)
+        boundary[i] = links[i]->src->nb_outputs == 1 &&
+                      links[i]->src->nb_inputs       &&
+                      links[i]->dst->nb_inputs  == 1;
+
+    do {
+        changed = 0;
+        compute_segments(graph, links, nb_links, boundary, segment);
+        memset(nb_outputs, 0, graph->nb_filters * sizeof(*nb_outputs));
+        /* a sink counts twice so that its segment gets no output boundary */
+        for (i = 0; i < graph->nb_filters; i++)
+            if (!graph->filters[i]->nb_outputs)
+                nb_outputs[segment[i]] += 2;
+        for (i = 0; i < nb_links; i++)
+            if (boundary[i])
+                nb_outputs[segment[filter_index(graph, links[i]->src)]]++;
+        for (i = 0; i < nb_links; i++) {
+            if (boundary[i] &&
+                nb_outputs[segment[filter_index(graph, links[i]->src)]] > 1) {
+                boundary[i] = 0;
+                changed     = 1;
+            }
+        }
+    } while (changed);
+
+    av_free(nb_outputs);
+
+    for (i = nb_boundaries = 0; i < nb_links; i++)
+        nb_boundaries += boundary[i];
+    return nb_boundaries;
+}
+
+static int request_segment(PipelineLink *pl)
+{
+    AVFilterLink *link = pl->link;
+    int ret;
+
+    pl->frame_received = 0;
+    do {
+        if (link->srcpad->request_frame)
+            ret = ff_call_request_frame(link);
+        else if (link->src->inputs[0])
+            ret = ff_request_frame(link->src->inputs[0]);
+        else
+            ret = AVERROR_EOF;
+    } while (ret >= 0 && !pl->frame_received &&
+             link->flags & FF_LINK_FLAG_REQUEST_LOOP);
+
+    return ret;
+}
+
+static void* attribute_align_arg pipeline_worker(void *arg)
+{
+    PipelineLink *pl = arg;
+    Pipeline *p      = pl->p;
+
+    pthread_mutex_lock(&p->lock);
+    while (!p->stop && !pl->status) {
+        unsigned generation;
+        int ret;
+
+        if (pl->starved && !is_starved(pl))
+            pl->starved = 0;
+        if (pl->starved || pl->nb_queued >= p->queue_size) {
+            pthread_cond_wait(&p->cond, &p->lock);
+            continue;
+        }
+
+        generation = p->generation;
+        pthread_mutex_unlock(&p->lock);
+        ret = request_segment(pl);
+        pthread_mutex_lock(&p->lock);
+
+        if (ret == AVERROR(EAGAIN)) {
+            if (generation == p->generation) {
+                pl->starved            = 1;
+                pl->starved_generation = generation;
+            }
+        } else if (ret < 0) {
+            pl->status = ret;
+        }
+        pthread_cond_broadcast(&p->cond);
+    }
+    pthread_mutex_unlock(&p->lock);
+
+    return NULL;
+}
+
+int ff_pipeline_put_frame(AVFilterLink *link, AVFrame *frame)
+{
+    PipelineLink *pl = link->pipe;
+    Pipeline *p      = pl->p;
+    int ret = 0;
+
+    pthread_mutex_lock(&p->lock);
+    while (!p->stop && pl->nb_queued >= p->queue_size)
+        pthread_cond_wait(&p->cond, &p->lock);
+    if (p->stop) {
+        ret = AVERROR_EXIT;
+    } else {
+        av_fifo_generic_write(pl->queue, &frame, sizeof(frame), NULL);
+        pl->nb_queued++;
+        pl->frame_received = 1;
+        p->generation++;
+        pthread_cond_broadcast(&p->cond);
+    }
+    pthread_mutex_unlock(&p->lock);
+
+    if (ret < 0)
+        av_frame_free(&frame);
+    return ret;
+}
+
+int ff_pipeline_get_frame(AVFilterLink *link, AVFrame **frame)
+{
+    PipelineLink *pl = link->pipe;
+    Pipeline *p      = pl->p;
+    int i, ret;
+
+    pthread_mutex_lock(&p->lock);
+    for (;;) {
+        int starved = 0;
+
+        if (pl->nb_queued) {
+            av_fifo_generic_read(pl->queue, frame, sizeof(*frame), NULL);
+            pl->nb_queued--;
+            pthread_cond_broadcast(&p->cond);
+            ret = 0;
+            break;
+        }
+        if (pl->status || p->stop) {
+            ret = p->stop ? AVERROR_EXIT : pl->status;
+            break;
+        }
+        /* Report the graph as waiting for input as soon as one of the
+         * segments needs it, so that the caller can feed the sources while
+         * the other segments are still running. */
+        if (pl->caller_side) {
+            starved = p->nonblock;
+            for (i = 0; i < p->nb_links; i++)
+                starved |= is_starved(&p->links[i]);
+        } else
+            starved = is_starved(pl);
+        if (starved) {
+            ret = AVERROR(EAGAIN);
+            break;
+        }
+        pthread_cond_wait(&p->cond, &p->lock);
+    }
+    pthread_mutex_unlock(&p->lock);
+
+    return ret;
+}
+
+int ff_pipeline_poll_frame(AVFilterLink *link)
+{
+    PipelineLink *pl = link->pipe;
+    Pipeline *p      = pl->p;
+    int ret;
+
+    pthread_mutex_lock(&p->lock);
+    ret = !pl->nb_queued && pl->status == AVERROR_EOF ? AVERROR_EOF : pl->nb_queued;
+    pthread_mutex_unlock(&p->lock);
+
+    return ret;
+}
+
+int ff_pipeline_request_frame_nonblock(AVFilterLink *link)
+{
+    Pipeline *p = link->graph ? link->graph->internal->pipeline : NULL;
+    int ret;
+
+    if (!p)
+        return AVERROR(EAGAIN);
+
+    p->nonblock = 1;
+    ret = ff_request_frame(link);
+    p->nonblock = 0;
+
+    return ret;
+}
+
+void ff_pipeline_lock(AVFilterContext *ctx)
+{
+    Pipeline *p = ctx->graph ? ctx->graph->internal->pipeline : NULL;
+    if (p)
+        pthread_mutex_lock(&p->lock);
+}
+
+void ff_pipeline_unlock(AVFilterContext *ctx)
+{
+    Pipeline *p = ctx->graph ? ctx->graph->internal->pipeline : NULL;
+    if (p)
+        pthread_mutex_unlock(&p->lock);
+}
+
+int ff_pipeline_wake(AVFilterContext *ctx)
+{
+    Pipeline *p = ctx->graph ? ctx->graph->internal->pipeline : NULL;
+    int i;
+
+    if (!p)
+        return 0;
+    for (i = 0; i < p->nb_sources; i++)
+        if (p->sources[i] == ctx)
+            break;
+    if (i == p->nb_sources)
+        return 0;
+
+    pthread_mutex_lock(&p->lock);
+    p->generation++;
+    pthread_cond_broadcast(&p->cond);
+    pthread_mutex_unlock(&p->lock);
+
+    return 1;
+}
+
+void ff_pipeline_uninit(AVFilterGraph *graph)
+{
+    Pipeline *p = graph->internal->pipeline;
+    int i;
+
+    if (!p)
+        return;
+
+    pthread_mutex_lock(&p->lock);
+    p->stop = 1;
+    pthread_cond_broadcast(&p->cond);
+    pthread_mutex_unlock(&p->lock);
+
+    for (i = 0; i < p->nb_threads; i++)
+        pthread_join(p->links[i].thread, NULL);
+
+    for (i = 0; i < p->nb_links; i++) {
+        PipelineLink *pl = &p->links[i];
+        while (pl->queue && av_fifo_size(pl->queue)) {
+            AVFrame *frame;
+            av_fifo_generic_read(pl->queue, &frame, sizeof(frame), NULL);
+            av_frame_free(&frame);
+        }
+        av_fifo_free(pl->queue);
+        pl->link->pipe = NULL;
+    }
+
+    pthread_mutex_destroy(&p->lock);
+    pthread_cond_destroy(&p->cond);
+    av_freep(&p->links);
+    av_freep(&p->sources);
+    av_freep(&graph->internal->pipeline);
+}
+
+int ff_pipeline_init(AVFilterGraph *graph)
+{
+    AVFilterLink **links = NULL;
+    uint8_t *boundary    = NULL;
+    int *segment         = NULL, *has_output = NULL;
+    Pipeline *p;
+    int i, j, nb_links = 0, ret;
+
+    if (graph->internal->pipeline)
+        return 0;
+
+    for (i = 0; i < graph->nb_filters; i++)
+        nb_links += graph->filters[i]->nb_outputs;
+
+    links      = av_calloc(nb_links, sizeof(*links));
+    boundary   = av_calloc(nb_links, sizeof(*boundary));
+    segment    = av_calloc(graph->nb_filters, sizeof(*segment));
+    has_output = av_calloc(graph->nb_filters, sizeof(*has_output));
+    p          = av_mallocz(sizeof(*p));
+    if (!links || !boundary || !segment || !has_output || !p) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+
+    for (i = nb_links = 0; i < graph->nb_filters; i++)
+        for (j = 0; j < graph->filters[i]->nb_outputs; j++)
+            if (graph->filters[i]->outputs[j])
+                links[nb_links++] = graph->filters[i]->outputs[j];
+
+    ret = select_boundaries(graph, links, nb_links, boundary, segment);
+    if (ret <= 0)
+        goto fail;
+
+    p->links   = av_calloc(ret, sizeof(*p->links));
+    p->sources = av_calloc(graph->nb_filters, sizeof(*p->sources));
+    if (!p->links || !p->sources) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+    p->queue_size = graph->pipeline_queue_size;
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_cond_init(&p->cond, NULL);
+
+    for (i = 0; i < nb_links; i++)
+        if (boundary[i])
+            has_output[segment[filter_index(graph, links[i]->src)]] = 1;
+    for (i = 0; i < graph->nb_filters; i++)
+        if (!graph->filters[i]->nb_inputs && has_output[segment[i]])
+            p->sources[p->nb_sources++] = graph->filters[i];
+
+    for (i = 0; i < nb_links; i++) {
+        PipelineLink *pl;
+        if (!boundary[i])
+            continue;
+        pl = &p->links[p->nb_links++];
+        pl->p           = p;
+        pl->link        = links[i];
+        pl->caller_side = !has_output[segment[filter_index(graph, links[i]->dst)]];
+        pl->queue       = av_fifo_alloc(p->queue_size * sizeof(AVFrame*));
+        if (!pl->queue) {
+            ret = AVERROR(ENOMEM);
+            goto fail_uninit;
+        }
+        links[i]->pipe  = pl;
+    }
+
+    graph->internal->pipeline = p;
+    for (i = 0; i < p->nb_links; i++) {
+        ret = pthread_create(&p->links[i].thread, NULL, pipeline_worker, &p->links[i]);
+        if (ret) {
+            ret = AVERROR(ret);
+            goto fail_uninit;
+        }
+        p->nb_threads++;
+    }
+
+    av_log(graph, AV_LOG_VERBOSE, "Running the graph with %d pipeline threads.\n",
+           p->nb_threads);
+
+    av_free(links);
+    av_free(boundary);
+    av_free(segment);
+    av_free(has_output);
+    return 0;
+
+fail_uninit:
+    graph->internal->pipeline = p;
+    ff_pipeline_uninit(graph);
+    p = NULL;
+fail:
+    if (p) {
+        av_free(p->links);
+        av_free(p->sources);
+        av_free(p);
+    }
+    av_free(links);
+    av_free(boundary);
+    av_free(segment);
+    av_free(has_output);
+    return ret;
+}
@@ -0,0 +1,368 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * separable bilinear, bicubic and lanczos scaling with OpenCL
+ */
+
+#include <math.h>
+
+#include "scale_opencl.h"
+#include "libavutil/common.h"
+#include "libavutil/mathematics.h"
+#include "libavutil/mem.h"
+#include "libavutil/opencl_internal.h"
+#include "libswscale/swscale.h"
+
+#define FILTER_BITS 14
+
+enum ScaleMethod {
+    SCALE_BILINEAR,
+    SCALE_BICUBIC,
+    SCALE_LANCZOS,
+};
+
+typedef struct {
+    cl_mem cl_coeffs;       ///< int16_t coefficients, size per output sample
+    cl_mem cl_pos;          ///< int32_t first input sample of each output sample
+    int size;
+} ScaleOpenclFilter;
+
+struct ScaleOpenclContext {
+    int nb_planes;
+    int src_w[4], src_h[4];
+    int dst_w[4], dst_h[4];
+    ScaleOpenclFilter hfilter[2];   ///< luma/alpha and chroma
+    ScaleOpenclFilter vfilter[2];
+    int in_plane_size[4];
+    int out_plane_size[4];
+    cl_mem cl_inbuf;
+    size_t cl_inbuf_size;
+    cl_mem cl_tmpbuf;
+    cl_mem cl_outbuf;
+    size_t cl_outbuf_size;
+    AVOpenCLKernelEnv kernel_h;
+    AVOpenCLKernelEnv kernel_v;
+};
+
+static double filter_radius(enum ScaleMethod method)
+{
+    switch (method) {
+    case SCALE_BILINEAR: return 1;
+    case SCALE_BICUBIC:  return 2;
+    default:             return 3;
+    }
+}
+
+static double filter_kernel(enum ScaleMethod method, double x)
+{
+    x = fabs(x);
+    switch (method) {
+    case SCALE_BILINEAR:
+        return FFMAX(1 - x, 0);
+    case SCALE_BICUBIC: {
+        /* the default libswscale parameters, B = 0, C = 0.6 */
+        const double B = 0, C = 0.6;
+        if (x < 1)
+            return ((12 - 9 * B - 6 * C) * x * x * x +
+                    (-18 + 12 * B + 6 * C) * x * x + (6 - 2 * B)) / 6;
+        if (x < 2)
+            return ((-B - 6 * C) * x * x * x + (6 * B + 30 * C) * x * x +
+                    (-12 * B - 48 * C) * x + (8 * B + 24 * C)) / 6;
+        return 0;
+    }
+    default:
+        if (x == 0)
+            return 1;
+        if (x >= 3)
+            return 0;
+        return 3 * sin(M_PI * x) * sin(M_PI * x / 3) / (M_PI * M_PI * x * x);
+    }
+}
+
+/**
+ * Compute the filter scaling src_size samples to dst_size samples and
+ * upload it. Taps outside of the input are folded onto the edge samples,
+ * so that the kernels never read out of bounds.
+ */
+static int init_filter(ScaleOpenclFilter *f, enum ScaleMethod method,
+                       int src_size, int dst_size)
+{
+    double scale  = (double)src_size / dst_size;
+    double stretch = FFMAX(scale, 1);
+    double radius = filter_radius(method) * stretch;
+    int size = FFMIN((int)ceil(2 * radius) + 1, src_size);
+    int16_t *coeffs = av_mallocz(dst_size * size * sizeof(*coeffs));
+    int32_t *pos    = av_malloc (dst_size * sizeof(*pos));
+    double *tmp     = av_malloc (size * sizeof(*tmp));
+    int i, j, ret;
+
+    if (!coeffs || !pos || !tmp) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    for (i = 0; i < dst_size; i++) {
+        double center = (i + 0.5) * scale - 0.5;
+        int start = ceil(center - radius);
+        int sum_q = 0, max_j = 0;
+        double sum = 0;
+
+        pos[i] = av_clip(start, 0, src_size - size);
+        memset(tmp, 0, size * sizeof(*tmp));
+        for (j = start; j < start + size; j++) {
+            double w = filter_kernel(method, (j - center) / stretch);
+            tmp[av_clip(j, 0, src_size - 1) - pos[i]] += w;
+            sum += w;
+        }
+        for (j = 0; j < size; j++) {
+            int16_t *c = &coeffs[i * size + j];
+            *c = lrint(tmp[j] / sum * (1 << FILTER_BITS));
+            sum_q += *c;
+            if (*c > coeffs[i * size + max_j])
+                max_j = j;
+        }
+        /* make the coefficients sum to exactly 1 << FILTER_BITS */
+        coeffs[i * size + max_j] += (1 << FILTER_BITS) - sum_q;
+    }
+
+    f->size = size;
+    ret = av_opencl_buffer_create(&f->cl_coeffs, dst_size * size * sizeof(*coeffs),
+                                  CL_MEM_READ_ONLY, NULL);
+    if (ret < 0)
+        goto end;
+    ret = av_opencl_buffer_write(f->cl_coeffs, (uint8_t *)coeffs, dst_size * size * sizeof(*coeffs));
+    if (ret < 0)
+        goto end;
+    ret = av_opencl_buffer_create(&f->cl_pos, dst_size * sizeof(*pos), CL_MEM_READ_ONLY, NULL);
+    if (ret < 0)
+        goto end;
+    ret = av_opencl_buffer_write(f->cl_pos, (uint8_t *)pos, dst_size * sizeof(*pos));
+end:
+    av_free(coeffs);
+    av_free(pos);
+    av_free(tmp);
+    return ret;
+}
+
+static void free_filter(ScaleOpenclFilter *f)
+{
+    av_opencl_buffer_release(&f->cl_coeffs);
+    av_opencl_buffer_release(&f->cl_pos);
+}
+
+int ff_opencl_scale_init(AVFilterContext *ctx, ScaleOpenclContext **opencl_ctx,
+                         const AVPixFmtDescriptor *desc, int src_w, int src_h,
+                         int dst_w, int dst_h, int flags)
+{
+    ScaleOpenclContext *s;
+    enum ScaleMethod method;
+    size_t tmp_size = 0;
+    int i, ret;
+
+    switch (flags & (SWS_FAST_BILINEAR | SWS_BILINEAR | SWS_BICUBIC | SWS_X | SWS_POINT |
+                     SWS_AREA | SWS_BICUBLIN | SWS_GAUSS | SWS_SINC | SWS_LANCZOS | SWS_SPLINE)) {
+    case SWS_FAST_BILINEAR:
+    case SWS_BILINEAR: method = SCALE_BILINEAR; break;
+    case SWS_BICUBIC:  method = SCALE_BICUBIC;  break;
+    case SWS_LANCZOS:  method = SCALE_LANCZOS;  break;
+    default:
+        return AVERROR(ENOSYS);
+    }
+    /* one byte per sample, each component in its own plane */
+    if (desc->flags & (AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_PSEUDOPAL |
+                       AV_PIX_FMT_FLAG_BITSTREAM | AV_PIX_FMT_FLAG_HWACCEL))
+        return AVERROR(ENOSYS);
+    for (i = 0; i < desc->nb_components; i++) {
+        const AVComponentDescriptor *comp = &desc->comp[i];
+        if (comp->plane != i || comp->step_minus1 || comp->offset_plus1 != 1 ||
+            comp->shift || comp->depth_minus1 != 7)
+            return AVERROR(ENOSYS);
+    }
+
+    s = av_mallocz(sizeof(*s));
+    if (!s)
+        return AVERROR(ENOMEM);
+    ret = av_opencl_init(NULL);
+    if (ret < 0) {
+        av_free(s);
+        return ret;
+    }
+    *opencl_ctx = s;
+
+    s->nb_planes = desc->nb_components;
+    for (i = 0; i < s->nb_planes; i++) {
+        int chroma = i == 1 || i == 2;
+        s->src_w[i] = chroma ? FF_CEIL_RSHIFT(src_w, desc->log2_chroma_w) : src_w;
+        s->src_h[i] = chroma ? FF_CEIL_RSHIFT(src_h, desc->log2_chroma_h) : src_h;
+        s->dst_w[i] = chroma ? FF_CEIL_RSHIFT(dst_w, desc->log2_chroma_w) : dst_w;
+        s->dst_h[i] = chroma ? FF_CEIL_RSHIFT(dst_h, desc->log2_chroma_h) : dst_h;
+        tmp_size += s->dst_w[i] * s->src_h[i] * sizeof(int32_t);
+    }
+    for (i = 0; i < FFMIN(s->nb_planes, 2); i++) {
+        if ((ret = init_filter(&s->hfilter[i], method, s->src_w[i], s->dst_w[i])) < 0 ||
+            (ret = init_filter(&s->vfilter[i], method, s->src_h[i], s->dst_h[i])) < 0)
+            goto fail;
+    }
+    ret = av_opencl_buffer_create(&s->cl_tmpbuf, tmp_size, CL_MEM_READ_WRITE, NULL);
+    if (ret < 0)
+        goto fail;
+
+    ret = av_opencl_create_kernel(&s->kernel_h, "scale_h");
+    if (ret < 0) {
+        av_log(ctx, AV_LOG_ERROR, "OpenCL failed to create kernel with name 'scale_h'\n");
+        goto fail;
+    }
+    ret = av_opencl_create_kernel(&s->kernel_v, "scale_v");
+    if (ret < 0) {
+        av_log(ctx, AV_LOG_ERROR, "OpenCL failed to create kernel with name 'scale_v'\n");
+        goto fail;
+    }
+    return 0;
+fail:
+    ff_opencl_scale_uninit(opencl_ctx);
+    return ret;
+}
+
+void ff_opencl_scale_uninit(ScaleOpenclContext **opencl_ctx)
+{
+    ScaleOpenclContext *s = *opencl_ctx;
+    int i;
+
+    if (!s)
+        return;
+    for (i = 0; i < 2; i++) {
+        free_filter(&s->hfilter[i]);
+        free_filter(&s->vfilter[i]);
+    }
+    av_opencl_buffer_release(&s->cl_inbuf);
+    av_opencl_buffer_release(&s->cl_tmpbuf);
+    av_opencl_buffer_release(&s->cl_outbuf);
+    av_opencl_release_kernel(&s->kernel_h);
+    av_opencl_release_kernel(&s->kernel_v);
+    av_opencl_uninit();
+    av_freep(opencl_ctx);
+}
+
+static int run_kernel(AVFilterContext *ctx, AVOpenCLKernelEnv *env, int w, int h)
+{
+    const size_t global_work_size[2] = { w, h };
+    cl_int status = clEnqueueNDRangeKernel(env->command_queue, env->kernel, 2, NULL,
+                                           global_work_size, NULL, 0, NULL, NULL);
+    if (status != CL_SUCCESS) {
+        av_log(ctx, AV_LOG_ERROR, "OpenCL run kernel error occurred: %s\n", av_opencl_errstr(status));
+        return AVERROR_EXTERNAL;
+    }
+    return 0;
+}
+
+int ff_opencl_scale(AVFilterContext *ctx, ScaleOpenclContext *s, AVFrame *in, AVFrame *out)
+{
+    size_t in_size = 0, out_size = 0;
+    int i, ret, in_offset = 0, tmp_offset = 0, out_offset = 0;
+
+    for (i = 0; i < s->nb_planes; i++) {
+        if (in->linesize[i] < 0 || out->linesize[i] < 0) {
+            av_log(ctx, AV_LOG_ERROR, "Negative linesizes are not supported with OpenCL\n");
+            return AVERROR(ENOSYS);
+        }
+        s->in_plane_size[i]  = in ->linesize[i] * s->src_h[i];
+        s->out_plane_size[i] = out->linesize[i] * s->dst_h[i];
+        in_size  += s->in_plane_size[i];
+        out_size += s->out_plane_size[i];
+    }
+    if (in_size > s->cl_inbuf_size) {
+        av_opencl_buffer_release(&s->cl_inbuf);
+        s->cl_inbuf_size = 0;
+        ret = av_opencl_buffer_create(&s->cl_inbuf, in_size, CL_MEM_READ_ONLY, NULL);
+        if (ret < 0)
+            return ret;
+        s->cl_inbuf_size = in_size;
+    }
+    if (out_size > s->cl_outbuf_size) {
+        av_opencl_buffer_release(&s->cl_outbuf);
+        s->cl_outbuf_size = 0;
+        ret = av_opencl_buffer_create(&s->cl_outbuf, out_size, CL_MEM_READ_WRITE, NULL);
+        if (ret < 0)
+            return ret;
+        s->cl_outbuf_size = out_size;
+    }
+    ret = avpriv_opencl_buffer_write_image_async(s->cl_inbuf, s->cl_inbuf_size, 0, in->data,
+                                                 s->in_plane_size, s->nb_planes);
+    if (ret < 0)
+        return ret;
+
+    for (i = 0; i < s->nb_planes; i++) {
+        ScaleOpenclFilter *hfilter = &s->hfilter[i == 1 || i == 2];
+        ScaleOpenclFilter *vfilter = &s->vfilter[i == 1 || i == 2];
+        FFOpenclParam param_h = {0}, param_v = {0};
+
+        param_h.ctx    = ctx;
+        param_h.kernel = s->kernel_h.kernel;
+        ret = ff_opencl_set_parameter(&param_h,
+                                      FF_OPENCL_PARAM_INFO(s->cl_tmpbuf),
+                                      FF_OPENCL_PARAM_INFO(s->cl_inbuf),
+                                      FF_OPENCL_PARAM_INFO(hfilter->cl_coeffs),
+                                      FF_OPENCL_PARAM_INFO(hfilter->cl_pos),
+                                      FF_OPENCL_PARAM_INFO(hfilter->size),
+                                      FF_OPENCL_PARAM_INFO(in_offset),
+                                      FF_OPENCL_PARAM_INFO(in->linesize[i]),
+                                      FF_OPENCL_PARAM_INFO(tmp_offset),
+                                      FF_OPENCL_PARAM_INFO(s->dst_w[i]),
+                                      FF_OPENCL_PARAM_INFO(s->src_h[i]),
+                                      NULL);
+        if (ret < 0)
+            goto fail;
+        ret = run_kernel(ctx, &s->kernel_h, s->dst_w[i], s->src_h[i]);
+        if (ret < 0)
+            goto fail;
+
+        param_v.ctx    = ctx;
+        param_v.kernel = s->kernel_v.kernel;
+        ret = ff_opencl_set_parameter(&param_v,
+                                      FF_OPENCL_PARAM_INFO(s->cl_outbuf),
+                                      FF_OPENCL_PARAM_INFO(s->cl_tmpbuf),
+                                      FF_OPENCL_PARAM_INFO(vfilter->cl_coeffs),
+                                      FF_OPENCL_PARAM_INFO(vfilter->cl_pos),
+                                      FF_OPENCL_PARAM_INFO(vfilter->size),
+                                      FF_OPENCL_PARAM_INFO(tmp_offset),
+                                      FF_OPENCL_PARAM_INFO(out_offset),
+                                      FF_OPENCL_PARAM_INFO(out->linesize[i]),
+                                      FF_OPENCL_PARAM_INFO(s->dst_w[i]),
+                                      FF_OPENCL_PARAM_INFO(s->dst_h[i]),
+                                      NULL);
+        if (ret < 0)
+            goto fail;
+        ret = run_kernel(ctx, &s->kernel_v, s->dst_w[i], s->dst_h[i]);
+        if (ret < 0)
+            goto fail;
+
+        in_offset  += s->in_plane_size[i];
+        tmp_offset += s->dst_w[i] * s->src_h[i];
+        out_offset += s->out_plane_size[i];
+    }
+
+    /* the queue is in order, so the blocking read also waits for the
+       upload and both passes */
+    return av_opencl_buffer_read_image(out->data, s->out_plane_size, s->nb_planes,
+                                       s->cl_outbuf, s->cl_outbuf_size);
+fail:
+    /* the input frame may still be read by the pending upload */
+    clFinish(s->kernel_h.command_queue);
+    return ret;
+}
@@ -0,0 +1,44 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFILTER_SCALE_OPENCL_H
+#define AVFILTER_SCALE_OPENCL_H
+
+#include "libavutil/frame.h"
+#include "libavutil/pixdesc.h"
+#include "avfilter.h"
+
+typedef struct ScaleOpenclContext ScaleOpenclContext;
+
+/**
+ * Set up OpenCL scaling of planar 8-bit frames.
+ *
+ * @param flags libswscale flags, selecting the scaling algorithm
+ * @return 0 on success, AVERROR(ENOSYS) if the format or the algorithm
+ *         are not supported, another negative error code on failure
+ */
+int ff_opencl_scale_init(AVFilterContext *ctx, ScaleOpenclContext **opencl_ctx,
+                         const AVPixFmtDescriptor *desc, int src_w, int src_h,
+                         int dst_w, int dst_h, int flags);
+
+void ff_opencl_scale_uninit(ScaleOpenclContext **opencl_ctx);
+
+int ff_opencl_scale(AVFilterContext *ctx, ScaleOpenclContext *opencl_ctx,
+                    AVFrame *in, AVFrame *out);
+
+#endif /* AVFILTER_SCALE_OPENCL_H */
@@ -0,0 +1,74 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFILTER_SCALE_OPENCL_KERNEL_H
+#define AVFILTER_SCALE_OPENCL_KERNEL_H
+
+#include "libavutil/opencl.h"
+
+const char *ff_kernel_scale_opencl = AV_OPENCL_KERNEL(
+kernel void scale_h(global int *dst,
+                    const global unsigned char *src,
+                    const global short *filter,
+                    const global int *filter_pos,
+                    int filter_size,
+                    int src_offset,
+                    int src_linesize,
+                    int dst_offset,
+                    int dst_w,
+                    int h)
+{
+    int x = get_global_id(0);
+    int y = get_global_id(1);
+    int i, sum = 0;
+
+    if (x >= dst_w || y >= h)
+        return;
+    src    += src_offset + y * src_linesize + filter_pos[x];
+    filter += x * filter_size;
+    for (i = 0; i < filter_size; i++)
+        sum += src[i] * filter[i];
+    dst[dst_offset + y * dst_w + x] = (sum + 128) >> 8;
+}
+
+kernel void scale_v(global unsigned char *dst,
+                    const global int *src,
+                    const global short *filter,
+                    const global int *filter_pos,
+                    int filter_size,
+                    int src_offset,
+                    int dst_offset,
+                    int dst_linesize,
+                    int dst_w,
+                    int dst_h)
+{
+    int x = get_global_id(0);
+    int y = get_global_id(1);
+    int i, sum = 0;
+
+    if (x >= dst_w || y >= dst_h)
+        return;
+    src    += src_offset + filter_pos[y] * dst_w + x;
+    filter += y * filter_size;
+    for (i = 0; i < filter_size; i++)
+        sum += src[i * dst_w] * filter[i];
+    dst[dst_offset + y * dst_linesize + x] = clamp((sum + (1 << 19)) >> 20, 0, 255);
+}
+);
+
+#endif /* AVFILTER_SCALE_OPENCL_KERNEL_H */
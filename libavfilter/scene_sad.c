@@ -0,0 +1,47 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+
+#include "config.h"
+#include "libavutil/common.h"
+#include "scene_sad.h"
+
+uint64_t ff_scene_sad_c(const uint8_t *src1, ptrdiff_t stride1,
+                        const uint8_t *src2, ptrdiff_t stride2,
+                        int width, int height)
+{
+    uint64_t sad = 0;
+    int x, y;
+
+    for (y = 0; y < height; y++) {
+        for (x = 0; x < width; x++)
+            sad += FFABS(src1[x] - src2[x]);
+        src1 += stride1;
+        src2 += stride2;
+    }
+    return sad;
+}
+
+ff_scene_sad_fn ff_scene_sad_get_fn(void)
+{
+    ff_scene_sad_fn sad = NULL;
+
+    if (ARCH_X86)
+        sad = ff_scene_sad_get_fn_x86();
+    return sad ? sad : ff_scene_sad_c;
+}
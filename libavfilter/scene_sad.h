@@ -0,0 +1,50 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+
+/**
+ * @file
+ * sum of absolute differences of two pictures, for scene change detection
+ */
+
+#ifndef AVFILTER_SCENE_SAD_H
+#define AVFILTER_SCENE_SAD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Compute the sum of the absolute differences of the bytes of two
+ * width x height pictures.
+ */
+typedef uint64_t (*ff_scene_sad_fn)(const uint8_t *src1, ptrdiff_t stride1,
+                                    const uint8_t *src2, ptrdiff_t stride2,
+                                    int width, int height);
+
+uint64_t ff_scene_sad_c(const uint8_t *src1, ptrdiff_t stride1,
+                        const uint8_t *src2, ptrdiff_t stride2,
+                        int width, int height);
+
+/**
+ * Return the fastest implementation for the current CPU.
+ */
+ff_scene_sad_fn ff_scene_sad_get_fn(void);
+
+ff_scene_sad_fn ff_scene_sad_get_fn_x86(void);
+
+#endif /* AVFILTER_SCENE_SAD_H */
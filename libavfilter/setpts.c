@@ -258,6 +258,8 @@ AVFilter avfilter_vf_setpts = {
 
     .inputs    = avfilter_vf_setpts_inputs,
     .outputs   = avfilter_vf_setpts_outputs,
+
+    .flags     = AVFILTER_FLAG_SUPPORT_HWACCEL,
 };
 #endif /* CONFIG_SETPTS_FILTER */
 
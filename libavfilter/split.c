@@ -127,7 +127,7 @@ AVFilter avfilter_vf_split = {
     .inputs    = avfilter_vf_split_inputs,
     .outputs   = NULL,
 
-    .flags     = AVFILTER_FLAG_DYNAMIC_OUTPUTS,
+    .flags     = AVFILTER_FLAG_DYNAMIC_OUTPUTS | AVFILTER_FLAG_SUPPORT_HWACCEL,
 };
 
 static const AVFilterPad avfilter_af_asplit_inputs[] = {
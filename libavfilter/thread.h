@@ -28,4 +28,53 @@ int ff_graph_thread_init(AVFilterGraph *graph);
 
 void ff_graph_thread_free(AVFilterGraph *graph);
 
+/**
+ * Start the threads of a pipelined graph, once it is configured.
+ */
+int ff_pipeline_init(AVFilterGraph *graph);
+
+/**
+ * Stop the threads of a pipelined graph and free the queued frames.
+ */
+void ff_pipeline_uninit(AVFilterGraph *graph);
+
+/**
+ * Queue a frame on a link crossing threads, blocking while the queue is full.
+ */
+int ff_pipeline_put_frame(AVFilterLink *link, AVFrame *frame);
+
+/**
+ * Dequeue a frame from a link crossing threads, waiting for the upstream
+ * thread if necessary.
+ *
+ * @return 0 on success, AVERROR(EAGAIN) if the graph needs more input first,
+ *         the error returned upstream (e.g. AVERROR_EOF) otherwise
+ */
+int ff_pipeline_get_frame(AVFilterLink *link, AVFrame **frame);
+
+/**
+ * Return the number of frames queued on a link crossing threads.
+ */
+int ff_pipeline_poll_frame(AVFilterLink *link);
+
+/**
+ * Request a frame on link without waiting for the pipeline threads.
+ *
+ * @return AVERROR(EAGAIN) if the graph is not pipelined or no frame is ready
+ */
+int ff_pipeline_request_frame_nonblock(AVFilterLink *link);
+
+/**
+ * Lock the state of a source shared with the pipeline threads.
+ */
+void ff_pipeline_lock(AVFilterContext *ctx);
+void ff_pipeline_unlock(AVFilterContext *ctx);
+
+/**
+ * Notify the pipeline threads that new input was added to a source.
+ *
+ * @return 1 if the source is executed by a pipeline thread, 0 otherwise
+ */
+int ff_pipeline_wake(AVFilterContext *ctx);
+
 #endif /* AVFILTER_THREAD_H */
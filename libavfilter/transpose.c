@@ -0,0 +1,108 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <string.h>
+
+#include "config.h"
+#include "libavutil/common.h"
+#include "libavutil/intreadwrite.h"
+#include "transpose.h"
+
+static void transpose_pixel(uint8_t *dst, const uint8_t *src, int pixstep)
+{
+    switch (pixstep) {
+    case 1: *dst = *src;                break;
+    case 2: AV_WN16(dst, AV_RN16(src)); break;
+    case 3: AV_WB24(dst, AV_RB24(src)); break;
+    case 4: AV_WN32(dst, AV_RN32(src)); break;
+    case 6: AV_WB48(dst, AV_RB48(src)); break;
+    case 8: AV_WN64(dst, AV_RN64(src)); break;
+    default: memcpy(dst, src, pixstep); break;
+    }
+}
+
+#define TRANSPOSE_BLOCK(pixstep)                                               \
+static void transpose_8x8_ ## pixstep ## _c(uint8_t *dst,                      \
+                                            ptrdiff_t dst_linesize,            \
+                                            const uint8_t *src,                \
+                                            ptrdiff_t src_linesize)            \
+{                                                                              \
+    int x, y;                                                                  \
+                                                                               \
+    for (y = 0; y < 8; y++) {                                                  \
+        for (x = 0; x < 8; x++)                                                \
+            transpose_pixel(dst + x * pixstep,                                 \
+                            src + x * src_linesize + y * pixstep, pixstep);    \
+        dst += dst_linesize;                                                   \
+    }                                                                          \
+}
+
+TRANSPOSE_BLOCK(1)
+TRANSPOSE_BLOCK(2)
+TRANSPOSE_BLOCK(3)
+TRANSPOSE_BLOCK(4)
+TRANSPOSE_BLOCK(6)
+TRANSPOSE_BLOCK(8)
+
+ff_transpose_block_fn ff_transpose_get_block_fn(int pixstep)
+{
+    ff_transpose_block_fn block = NULL;
+
+    if (ARCH_X86)
+        block = ff_transpose_get_block_fn_x86(pixstep);
+    if (block)
+        return block;
+
+    switch (pixstep) {
+    case 1: return transpose_8x8_1_c;
+    case 2: return transpose_8x8_2_c;
+    case 3: return transpose_8x8_3_c;
+    case 4: return transpose_8x8_4_c;
+    case 6: return transpose_8x8_6_c;
+    case 8: return transpose_8x8_8_c;
+    }
+    return NULL;
+}
+
+void ff_transpose_plane(ff_transpose_block_fn block, int pixstep,
+                        uint8_t *dst, ptrdiff_t dst_linesize,
+                        const uint8_t *src, ptrdiff_t src_linesize,
+                        int w, int y0, int y1)
+{
+    int x, y, bx, by, bh;
+
+    /* the source columns of a band of 8 lines are read together, so that
+       each source cache line is used by whole blocks */
+    for (by = y0; by < y1; by += 8) {
+        uint8_t *d = dst + by * dst_linesize;
+        const uint8_t *s = src + by * pixstep;
+
+        bh = FFMIN(8, y1 - by);
+        bx = 0;
+        if (bh == 8)
+            for (; bx + 8 <= w; bx += 8)
+                block(d + bx * pixstep, dst_linesize,
+                      s + bx * src_linesize, src_linesize);
+        for (y = 0; y < bh; y++) {
+            for (x = bx; x < w; x++)
+                transpose_pixel(d + x * pixstep,
+                                s + x * src_linesize + y * pixstep, pixstep);
+            d += dst_linesize;
+        }
+    }
+}
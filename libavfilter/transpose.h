@@ -0,0 +1,54 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * cache blocked transposition of image planes
+ */
+
+#ifndef AVFILTER_TRANSPOSE_H
+#define AVFILTER_TRANSPOSE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Transpose a block of 8x8 pixels of pixstep bytes:
+ * pixel x of line y of dst is set to pixel y of line x of src.
+ */
+typedef void (*ff_transpose_block_fn)(uint8_t *dst, ptrdiff_t dst_linesize,
+                                      const uint8_t *src, ptrdiff_t src_linesize);
+
+/**
+ * Return the fastest block function for the current CPU.
+ * @param pixstep number of bytes per pixel: 1, 2, 3, 4, 6 or 8
+ */
+ff_transpose_block_fn ff_transpose_get_block_fn(int pixstep);
+
+ff_transpose_block_fn ff_transpose_get_block_fn_x86(int pixstep);
+
+/**
+ * Transpose lines [y0, y1[ of a w x h destination plane, 8x8 pixels at
+ * a time. The linesizes can be negative to flip the planes.
+ */
+void ff_transpose_plane(ff_transpose_block_fn block, int pixstep,
+                        uint8_t *dst, ptrdiff_t dst_linesize,
+                        const uint8_t *src, ptrdiff_t src_linesize,
+                        int w, int y0, int y1);
+
+#endif /* AVFILTER_TRANSPOSE_H */
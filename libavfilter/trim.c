@@ -220,6 +220,8 @@ AVFilter avfilter_vf_trim = {
 
     .inputs      = trim_inputs,
     .outputs     = trim_outputs,
+
+    .flags       = AVFILTER_FLAG_SUPPORT_HWACCEL,
 };
 #endif // CONFIG_TRIM_FILTER
 
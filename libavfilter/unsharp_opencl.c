@@ -185,18 +185,24 @@ int ff_opencl_apply_unsharp(AVFilterContext *ctx, AVFrame *in, AVFrame *out)
                                   FF_OPENCL_PARAM_INFO(cw),
                                   NULL);
     if (ret < 0)
-        return ret;
+        goto fail;
     status = clEnqueueNDRangeKernel(unsharp->opencl_ctx.kernel_env.command_queue,
                                     unsharp->opencl_ctx.kernel_env.kernel, 1, NULL,
                                     &global_work_size, NULL, 0, NULL, NULL);
     if (status != CL_SUCCESS) {
         av_log(ctx, AV_LOG_ERROR, "OpenCL run kernel error occurred: %s\n", av_opencl_errstr(status));
-        return AVERROR_EXTERNAL;
+        ret = AVERROR_EXTERNAL;
+        goto fail;
     }
-    clFinish(unsharp->opencl_ctx.kernel_env.command_queue);
+    /* the queue is in order, so the blocking read waits for the upload
+       and the kernel without a separate clFinish() round trip */
     return av_opencl_buffer_read_image(out->data, unsharp->opencl_ctx.out_plane_size,
                                        unsharp->opencl_ctx.plane_num, unsharp->opencl_ctx.cl_outbuf,
                                        unsharp->opencl_ctx.cl_outbuf_size);
+fail:
+    /* the input frame may still be read by the pending upload */
+    clFinish(unsharp->opencl_ctx.kernel_env.command_queue);
+    return ret;
 }
 
 int ff_opencl_unsharp_init(AVFilterContext *ctx)
@@ -276,8 +282,8 @@ int ff_opencl_unsharp_process_inout_buf(AVFilterContext *ctx, AVFrame *in, AVFra
                 return ret;
         }
     }
-    return av_opencl_buffer_write_image(unsharp->opencl_ctx.cl_inbuf,
-                                        unsharp->opencl_ctx.cl_inbuf_size,
-                                        0, in->data, unsharp->opencl_ctx.in_plane_size,
-                                        unsharp->opencl_ctx.plane_num);
+    return avpriv_opencl_buffer_write_image_async(unsharp->opencl_ctx.cl_inbuf,
+                                                  unsharp->opencl_ctx.cl_inbuf_size,
+                                                  0, in->data, unsharp->opencl_ctx.in_plane_size,
+                                                  unsharp->opencl_ctx.plane_num);
 }
@@ -70,7 +70,8 @@ typedef struct {
     int hsub, vsub;
     int radius[4];
     int power[4];
-    uint8_t *temp[2]; ///< temporary buffer used in blur_power()
+    uint8_t *temp[2]; ///< temporary buffers used in blur_power(), one pair of lines per slice thread
+    int temp_size;    ///< size of the temporary lines of one slice thread
 } BoxBlurContext;
 
 #define Y 0
@@ -141,8 +142,11 @@ static int config_input(AVFilterLink *inlink)
     char *expr;
     int ret;
 
-    if (!(s->temp[0] = av_malloc(FFMAX(w, h))) ||
-        !(s->temp[1] = av_malloc(FFMAX(w, h))))
+    s->temp_size = FFMAX(w, h);
+    av_freep(&s->temp[0]);
+    av_freep(&s->temp[1]);
+    if (!(s->temp[0] = av_malloc_array(ctx->graph->nb_threads, s->temp_size)) ||
+        !(s->temp[1] = av_malloc_array(ctx->graph->nb_threads, s->temp_size)))
         return AVERROR(ENOMEM);
 
     s->hsub = desc->log2_chroma_w;
@@ -270,41 +274,84 @@ static inline void blur_power(uint8_t *dst, int dst_step, const uint8_t *src, in
 }
 
 static void hblur(uint8_t *dst, int dst_linesize, const uint8_t *src, int src_linesize,
-                  int w, int h, int radius, int power, uint8_t *temp[2])
+                  int w, int slice_start, int slice_end, int radius, int power, uint8_t *temp[2])
 {
     int y;
 
     if (radius == 0 && dst == src)
         return;
 
-    for (y = 0; y < h; y++)
+    for (y = slice_start; y < slice_end; y++)
         blur_power(dst + y*dst_linesize, 1, src + y*src_linesize, 1,
                    w, radius, power, temp);
 }
 
 static void vblur(uint8_t *dst, int dst_linesize, const uint8_t *src, int src_linesize,
-                  int w, int h, int radius, int power, uint8_t *temp[2])
+                  int slice_start, int slice_end, int h, int radius, int power, uint8_t *temp[2])
 {
     int x;
 
     if (radius == 0 && dst == src)
         return;
 
-    for (x = 0; x < w; x++)
+    for (x = slice_start; x < slice_end; x++)
         blur_power(dst + x, dst_linesize, src + x, src_linesize,
                    h, radius, power, temp);
 }
 
+typedef struct ThreadData {
+    AVFrame *in, *out;
+    int w[4], h[4];
+} ThreadData;
+
+/* the horizontal pass is split in bands of rows and the vertical pass in
+ * bands of columns, so no line of a pass depends on another slice */
+static int hblur_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    BoxBlurContext *s = ctx->priv;
+    const ThreadData *td = arg;
+    uint8_t *temp[2] = { s->temp[0] + jobnr * s->temp_size,
+                         s->temp[1] + jobnr * s->temp_size };
+    int plane;
+
+    for (plane = 0; td->in->data[plane] && plane < 4; plane++)
+        hblur(td->out->data[plane], td->out->linesize[plane],
+              td->in ->data[plane], td->in ->linesize[plane],
+              td->w[plane],
+              (td->h[plane] *  jobnr   ) / nb_jobs,
+              (td->h[plane] * (jobnr+1)) / nb_jobs,
+              s->radius[plane], s->power[plane], temp);
+    return 0;
+}
+
+static int vblur_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    BoxBlurContext *s = ctx->priv;
+    const ThreadData *td = arg;
+    uint8_t *temp[2] = { s->temp[0] + jobnr * s->temp_size,
+                         s->temp[1] + jobnr * s->temp_size };
+    int plane;
+
+    for (plane = 0; td->in->data[plane] && plane < 4; plane++)
+        vblur(td->out->data[plane], td->out->linesize[plane],
+              td->out->data[plane], td->out->linesize[plane],
+              (td->w[plane] *  jobnr   ) / nb_jobs,
+              (td->w[plane] * (jobnr+1)) / nb_jobs,
+              td->h[plane], s->radius[plane], s->power[plane], temp);
+    return 0;
+}
+
 static int filter_frame(AVFilterLink *inlink, AVFrame *in)
 {
     AVFilterContext *ctx = inlink->dst;
     BoxBlurContext *s = ctx->priv;
     AVFilterLink *outlink = inlink->dst->outputs[0];
     AVFrame *out;
-    int plane;
     int cw = FF_CEIL_RSHIFT(inlink->w, s->hsub), ch = FF_CEIL_RSHIFT(in->height, s->vsub);
-    int w[4] = { inlink->w, cw, cw, inlink->w };
-    int h[4] = { in->height, ch, ch, in->height };
+    ThreadData td = {
+        .w = { inlink->w, cw, cw, inlink->w },
+        .h = { in->height, ch, ch, in->height },
+    };
 
     out = ff_get_video_buffer(outlink, outlink->w, outlink->h);
     if (!out) {
@@ -313,17 +360,13 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
     }
     av_frame_copy_props(out, in);
 
-    for (plane = 0; in->data[plane] && plane < 4; plane++)
-        hblur(out->data[plane], out->linesize[plane],
-              in ->data[plane], in ->linesize[plane],
-              w[plane], h[plane], s->radius[plane], s->power[plane],
-              s->temp);
+    td.in  = in;
+    td.out = out;
 
-    for (plane = 0; in->data[plane] && plane < 4; plane++)
-        vblur(out->data[plane], out->linesize[plane],
-              out->data[plane], out->linesize[plane],
-              w[plane], h[plane], s->radius[plane], s->power[plane],
-              s->temp);
+    ctx->internal->execute(ctx, hblur_slice, &td, NULL,
+                           FFMIN(ch, ctx->graph->nb_threads));
+    ctx->internal->execute(ctx, vblur_slice, &td, NULL,
+                           FFMIN(cw, ctx->graph->nb_threads));
 
     av_frame_free(&in);
 
@@ -383,5 +426,5 @@ AVFilter avfilter_vf_boxblur = {
 
     .inputs    = avfilter_vf_boxblur_inputs,
     .outputs   = avfilter_vf_boxblur_outputs,
-    .flags     = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC,
+    .flags     = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC | AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -19,31 +19,19 @@
  */
 
 #include "libavutil/opt.h"
+#include "libavutil/pixdesc.h"
 #include "avfilter.h"
 #include "drawutils.h"
 #include "formats.h"
 #include "internal.h"
 #include "video.h"
+#include "vf_colorchannelmixer.h"
 
 #define R 0
 #define G 1
 #define B 2
 #define A 3
 
-typedef struct {
-    const AVClass *class;
-    double rr, rg, rb, ra;
-    double gr, gg, gb, ga;
-    double br, bg, bb, ba;
-    double ar, ag, ab, aa;
-
-    int *lut[4][4];
-
-    int *buffer;
-
-    uint8_t rgba_map[4];
-} ColorChannelMixerContext;
-
 #define OFFSET(x) offsetof(ColorChannelMixerContext, x)
 #define FLAGS AV_OPT_FLAG_FILTERING_PARAM|AV_OPT_FLAG_VIDEO_PARAM
 static const AVOption colorchannelmixer_options[] = {
@@ -85,10 +73,48 @@ static int query_formats(AVFilterContext *ctx)
     return 0;
 }
 
+static void mix_line_4_c(uint8_t *dst, const uint8_t *src, int w,
+                         const int16_t (*coeffs)[2][8])
+{
+    int i, k;
+
+    for (i = 0; i < w; i++) {
+        const int c0 = src[4*i    ], c1 = src[4*i + 1];
+        const int c2 = src[4*i + 2], c3 = src[4*i + 3];
+
+        for (k = 0; k < 4; k++)
+            dst[4*i + k] = av_clip_uint8((coeffs[k][0][0] * c0 + coeffs[k][1][0] * c1 +
+                                          coeffs[k][0][1] * c2 + coeffs[k][1][1] * c3 +
+                                          (1 << 12)) >> 13);
+    }
+}
+
+static void mix_line_3_c(uint8_t *dst, const uint8_t *src, int w,
+                         const int16_t (*coeffs)[2][8])
+{
+    int i, k;
+
+    for (i = 0; i < w; i++) {
+        const int c0 = src[3*i], c1 = src[3*i + 1], c2 = src[3*i + 2];
+
+        for (k = 0; k < 3; k++)
+            dst[3*i + k] = av_clip_uint8((coeffs[k][0][0] * c0 + coeffs[k][1][0] * c1 +
+                                          coeffs[k][0][1] * c2 + (1 << 12)) >> 13);
+    }
+}
+
 static int config_output(AVFilterLink *outlink)
 {
     AVFilterContext *ctx = outlink->src;
     ColorChannelMixerContext *cm = ctx->priv;
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(outlink->format);
+    const double matrix[4][4] = {
+        { cm->rr, cm->rg, cm->rb, cm->ra },
+        { cm->gr, cm->gg, cm->gb, cm->ga },
+        { cm->br, cm->bg, cm->bb, cm->ba },
+        { cm->ar, cm->ag, cm->ab, cm->aa },
+    };
+    const int nb_comp = desc->flags & PIX_FMT_ALPHA ? 4 : 3;
     int i, j, size, *buffer;
 
     ff_fill_rgba_map(cm->rgba_map, outlink->format);
@@ -101,9 +127,27 @@ static int config_output(AVFilterLink *outlink)
         size = 65536;
         break;
     default:
-        size = 256;
+        /* 8-bit components are mixed in 1.13 fixed point, with the
+         * coefficients ordered by the position of the components */
+        memset(cm->coeffs, 0, sizeof(cm->coeffs));
+        for (i = 0; i < nb_comp; i++) {
+            for (j = 0; j < nb_comp; j++) {
+                const int out = cm->rgba_map[i], in = cm->rgba_map[j];
+                int16_t *c = cm->coeffs[out][in & 1];
+                int k;
+
+                for (k = in >> 1; k < 8; k += 2)
+                    c[k] = lrint(matrix[i][j] * (1 << 13));
+            }
+        }
+        cm->mix_line_3 = mix_line_3_c;
+        cm->mix_line_4 = mix_line_4_c;
+        if (ARCH_X86)
+            ff_colorchannelmixer_init_x86(cm);
+        return 0;
     }
 
+    av_freep(&cm->buffer);
     cm->buffer = buffer = av_malloc(16 * size * sizeof(*cm->buffer));
     if (!cm->buffer)
         return AVERROR(ENOMEM);
@@ -112,80 +156,38 @@ static int config_output(AVFilterLink *outlink)
         for (j = 0; j < 4; j++, buffer += size)
             cm->lut[i][j] = buffer;
 
-    for (i = 0; i < size; i++) {
-        cm->lut[R][R][i] = round(i * cm->rr);
-        cm->lut[R][G][i] = round(i * cm->rg);
-        cm->lut[R][B][i] = round(i * cm->rb);
-        cm->lut[R][A][i] = round(i * cm->ra);
-
-        cm->lut[G][R][i] = round(i * cm->gr);
-        cm->lut[G][G][i] = round(i * cm->gg);
-        cm->lut[G][B][i] = round(i * cm->gb);
-        cm->lut[G][A][i] = round(i * cm->ga);
-
-        cm->lut[B][R][i] = round(i * cm->br);
-        cm->lut[B][G][i] = round(i * cm->bg);
-        cm->lut[B][B][i] = round(i * cm->bb);
-        cm->lut[B][A][i] = round(i * cm->ba);
-
-        cm->lut[A][R][i] = round(i * cm->ar);
-        cm->lut[A][G][i] = round(i * cm->ag);
-        cm->lut[A][B][i] = round(i * cm->ab);
-        cm->lut[A][A][i] = round(i * cm->aa);
-    }
+    for (i = 0; i < size; i++)
+        for (j = 0; j < 16; j++)
+            cm->lut[j >> 2][j & 3][i] = round(i * matrix[j >> 2][j & 3]);
 
     return 0;
 }
 
-static int filter_frame(AVFilterLink *inlink, AVFrame *in)
+typedef struct ThreadData {
+    AVFrame *in, *out;
+} ThreadData;
+
+static int filter_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    AVFilterContext *ctx = inlink->dst;
     ColorChannelMixerContext *cm = ctx->priv;
-    AVFilterLink *outlink = ctx->outputs[0];
+    const ThreadData *td = arg;
+    const AVFrame *in  = td->in;
+    const AVFrame *out = td->out;
     const uint8_t roffset = cm->rgba_map[R];
     const uint8_t goffset = cm->rgba_map[G];
     const uint8_t boffset = cm->rgba_map[B];
     const uint8_t aoffset = cm->rgba_map[A];
-    const uint8_t *srcrow = in->data[0];
-    uint8_t *dstrow;
-    AVFrame *out;
+    const int slice_start = (out->height *  jobnr   ) / nb_jobs;
+    const int slice_end   = (out->height * (jobnr+1)) / nb_jobs;
+    const uint8_t *srcrow = in ->data[0] + slice_start * in ->linesize[0];
+    uint8_t       *dstrow = out->data[0] + slice_start * out->linesize[0];
     int i, j;
 
-    if (av_frame_is_writable(in)) {
-        out = in;
-    } else {
-        out = ff_get_video_buffer(outlink, outlink->w, outlink->h);
-        if (!out) {
-            av_frame_free(&in);
-            return AVERROR(ENOMEM);
-        }
-        av_frame_copy_props(out, in);
-    }
-
-    dstrow = out->data[0];
-    switch (outlink->format) {
+    switch (out->format) {
     case AV_PIX_FMT_BGR24:
     case AV_PIX_FMT_RGB24:
-        for (i = 0; i < outlink->h; i++) {
-            const uint8_t *src = srcrow;
-            uint8_t *dst = dstrow;
-
-            for (j = 0; j < outlink->w * 3; j += 3) {
-                const uint8_t rin = src[j + roffset];
-                const uint8_t gin = src[j + goffset];
-                const uint8_t bin = src[j + boffset];
-
-                dst[j + roffset] = av_clip_uint8(cm->lut[R][R][rin] +
-                                                 cm->lut[R][G][gin] +
-                                                 cm->lut[R][B][bin]);
-                dst[j + goffset] = av_clip_uint8(cm->lut[G][R][rin] +
-                                                 cm->lut[G][G][gin] +
-                                                 cm->lut[G][B][bin]);
-                dst[j + boffset] = av_clip_uint8(cm->lut[B][R][rin] +
-                                                 cm->lut[B][G][gin] +
-                                                 cm->lut[B][B][bin]);
-            }
-
+        for (i = slice_start; i < slice_end; i++) {
+            cm->mix_line_3(dstrow, srcrow, out->width, cm->coeffs);
             srcrow += in->linesize[0];
             dstrow += out->linesize[0];
         }
@@ -194,75 +196,23 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
     case AV_PIX_FMT_0RGB:
     case AV_PIX_FMT_BGR0:
     case AV_PIX_FMT_RGB0:
-        for (i = 0; i < outlink->h; i++) {
-            const uint8_t *src = srcrow;
-            uint8_t *dst = dstrow;
-
-            for (j = 0; j < outlink->w * 4; j += 4) {
-                const uint8_t rin = src[j + roffset];
-                const uint8_t gin = src[j + goffset];
-                const uint8_t bin = src[j + boffset];
-
-                dst[j + roffset] = av_clip_uint8(cm->lut[R][R][rin] +
-                                                 cm->lut[R][G][gin] +
-                                                 cm->lut[R][B][bin]);
-                dst[j + goffset] = av_clip_uint8(cm->lut[G][R][rin] +
-                                                 cm->lut[G][G][gin] +
-                                                 cm->lut[G][B][bin]);
-                dst[j + boffset] = av_clip_uint8(cm->lut[B][R][rin] +
-                                                 cm->lut[B][G][gin] +
-                                                 cm->lut[B][B][bin]);
-                if (in != out)
-                    dst[j + aoffset] = 0;
-            }
-
-            srcrow += in->linesize[0];
-            dstrow += out->linesize[0];
-        }
-        break;
     case AV_PIX_FMT_ABGR:
     case AV_PIX_FMT_ARGB:
     case AV_PIX_FMT_BGRA:
     case AV_PIX_FMT_RGBA:
-        for (i = 0; i < outlink->h; i++) {
-            const uint8_t *src = srcrow;
-            uint8_t *dst = dstrow;
-
-            for (j = 0; j < outlink->w * 4; j += 4) {
-                const uint8_t rin = src[j + roffset];
-                const uint8_t gin = src[j + goffset];
-                const uint8_t bin = src[j + boffset];
-                const uint8_t ain = src[j + aoffset];
-
-                dst[j + roffset] = av_clip_uint8(cm->lut[R][R][rin] +
-                                                 cm->lut[R][G][gin] +
-                                                 cm->lut[R][B][bin] +
-                                                 cm->lut[R][A][ain]);
-                dst[j + goffset] = av_clip_uint8(cm->lut[G][R][rin] +
-                                                 cm->lut[G][G][gin] +
-                                                 cm->lut[G][B][bin] +
-                                                 cm->lut[G][A][ain]);
-                dst[j + boffset] = av_clip_uint8(cm->lut[B][R][rin] +
-                                                 cm->lut[B][G][gin] +
-                                                 cm->lut[B][B][bin] +
-                                                 cm->lut[B][A][ain]);
-                dst[j + aoffset] = av_clip_uint8(cm->lut[A][R][rin] +
-                                                 cm->lut[A][G][gin] +
-                                                 cm->lut[A][B][bin] +
-                                                 cm->lut[A][A][ain]);
-            }
-
+        for (i = slice_start; i < slice_end; i++) {
+            cm->mix_line_4(dstrow, srcrow, out->width, cm->coeffs);
             srcrow += in->linesize[0];
             dstrow += out->linesize[0];
         }
         break;
     case AV_PIX_FMT_BGR48:
     case AV_PIX_FMT_RGB48:
-        for (i = 0; i < outlink->h; i++) {
+        for (i = slice_start; i < slice_end; i++) {
             const uint16_t *src = (const uint16_t *)srcrow;
             uint16_t *dst = (uint16_t *)dstrow;
 
-            for (j = 0; j < outlink->w * 3; j += 3) {
+            for (j = 0; j < out->width * 3; j += 3) {
                 const uint16_t rin = src[j + roffset];
                 const uint16_t gin = src[j + goffset];
                 const uint16_t bin = src[j + boffset];
@@ -284,11 +234,11 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
         break;
     case AV_PIX_FMT_BGRA64:
     case AV_PIX_FMT_RGBA64:
-        for (i = 0; i < outlink->h; i++) {
+        for (i = slice_start; i < slice_end; i++) {
             const uint16_t *src = (const uint16_t *)srcrow;
             uint16_t *dst = (uint16_t *)dstrow;
 
-            for (j = 0; j < outlink->w * 4; j += 4) {
+            for (j = 0; j < out->width * 4; j += 4) {
                 const uint16_t rin = src[j + roffset];
                 const uint16_t gin = src[j + goffset];
                 const uint16_t bin = src[j + boffset];
@@ -316,6 +266,31 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
             dstrow += out->linesize[0];
         }
     }
+    return 0;
+}
+
+static int filter_frame(AVFilterLink *inlink, AVFrame *in)
+{
+    AVFilterContext *ctx = inlink->dst;
+    AVFilterLink *outlink = ctx->outputs[0];
+    AVFrame *out;
+    ThreadData td;
+
+    if (av_frame_is_writable(in)) {
+        out = in;
+    } else {
+        out = ff_get_video_buffer(outlink, outlink->w, outlink->h);
+        if (!out) {
+            av_frame_free(&in);
+            return AVERROR(ENOMEM);
+        }
+        av_frame_copy_props(out, in);
+    }
+
+    td.in  = in;
+    td.out = out;
+    ctx->internal->execute(ctx, filter_slice, &td, NULL,
+                           FFMIN(outlink->h, ctx->graph->nb_threads));
 
     if (in != out)
         av_frame_free(&in);
@@ -356,5 +331,5 @@ AVFilter avfilter_vf_colorchannelmixer = {
     .query_formats = query_formats,
     .inputs        = colorchannelmixer_inputs,
     .outputs       = colorchannelmixer_outputs,
-    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC,
+    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC | AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -0,0 +1,60 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFILTER_VF_COLORCHANNELMIXER_H
+#define AVFILTER_VF_COLORCHANNELMIXER_H
+
+#include <stdint.h>
+
+#include "libavutil/mem.h"
+#include "libavutil/opt.h"
+
+typedef struct ColorChannelMixerContext {
+    const AVClass *class;
+    double rr, rg, rb, ra;
+    double gr, gg, gb, ga;
+    double br, bg, bb, ba;
+    double ar, ag, ab, aa;
+
+    int *lut[4][4];
+
+    int *buffer;
+
+    uint8_t rgba_map[4];
+
+    /**
+     * Coefficients of the 8-bit formats in 1.13 fixed point, indexed by
+     * the position of the output component in the pixel, then by the
+     * parity of the position of the input component. Each of the 8 words
+     * alternates between the coefficients of input positions 0 and 2 or
+     * 1 and 3.
+     */
+    DECLARE_ALIGNED(16, int16_t, coeffs)[4][2][8];
+
+    /**
+     * Mix the components of w packed pixels of 3 or 4 bytes. Each output
+     * component is the sum of the input components multiplied by their
+     * coefficients, rounded and clipped.
+     */
+    void (*mix_line_3)(uint8_t *dst, const uint8_t *src, int w, const int16_t (*coeffs)[2][8]);
+    void (*mix_line_4)(uint8_t *dst, const uint8_t *src, int w, const int16_t (*coeffs)[2][8]);
+} ColorChannelMixerContext;
+
+void ff_colorchannelmixer_init_x86(ColorChannelMixerContext *cm);
+
+#endif /* AVFILTER_VF_COLORCHANNELMIXER_H */
@@ -35,13 +35,18 @@
 static const char *const var_names[] = { "c", NULL };
 enum { VAR_C, VAR_VARS_NB };
 
+typedef struct {
+    AVExpr *expr;               // coefficient factor expression
+    double var_values[VAR_VARS_NB];
+    DCTContext *dct, *idct;     // DCT and inverse DCT contexts
+    float *block, *tmp_block;   // two BSIZE x BSIZE block buffers
+} DCTdnoizSlice;
+
 typedef struct {
     const AVClass *class;
 
     /* coefficient factor expression */
     char *expr_str;
-    AVExpr *expr;
-    double var_values[VAR_VARS_NB];
 
     int pr_width, pr_height;    // width and height to process
     float sigma;                // used when no expression are st
@@ -52,8 +57,8 @@ typedef struct {
     int p_linesize;             // line sizes for color and weights
     int overlap;                // number of block overlapping pixels
     int step;                   // block step increment (BSIZE - overlap)
-    DCTContext *dct, *idct;     // DCT and inverse DCT contexts
-    float *block, *tmp_block;   // two BSIZE x BSIZE block buffers
+    DCTdnoizSlice *slices;      // per slice thread transform contexts and buffers
+    int nb_slices;
 } DCTdnoizContext;
 
 #define OFFSET(x) offsetof(DCTdnoizContext, x)
@@ -69,7 +74,7 @@ static const AVOption dctdnoiz_options[] = {
 
 AVFILTER_DEFINE_CLASS(dctdnoiz);
 
-static float *dct_block(DCTdnoizContext *ctx, const float *src, int src_linesize)
+static float *dct_block(DCTdnoizSlice *ctx, const float *src, int src_linesize)
 {
     int x, y;
     float *column;
@@ -106,7 +111,9 @@ static float *dct_block(DCTdnoizContext *ctx, const float *src, int src_linesize
     return ctx->block;
 }
 
-static void idct_block(DCTdnoizContext *ctx, float *dst, int dst_linesize)
+/* only the lines start to end - 1 of the block are added to dst */
+static void idct_block(DCTdnoizSlice *ctx, float *dst, int dst_linesize,
+                       int start, int end)
 {
     int x, y;
     float *block = ctx->block;
@@ -126,7 +133,7 @@ static void idct_block(DCTdnoizContext *ctx, float *dst, int dst_linesize)
         for (x = 1; x < BSIZE; x++)
             tmp[x] = block[x*BSIZE + y] * (1./sqrt(2. / BSIZE));
         av_dct_calc(ctx->idct, tmp);
-        for (x = 0; x < BSIZE; x++)
+        for (x = start; x < end; x++)
             dst[x*dst_linesize + y] += tmp[x];
     }
 }
@@ -182,6 +189,29 @@ static int config_input(AVFilterLink *inlink)
             s->weights[y*linesize + x] = 1. / iweights[y*linesize + x];
     av_free(iweights);
 
+    /* the blocks crossing the slice edges are transformed by both slices,
+     * so keep the slices a few blocks high */
+    s->nb_slices = FFMAX(1, FFMIN(ctx->graph->nb_threads, s->pr_height / (4 * BSIZE)));
+    s->slices = av_calloc(s->nb_slices, sizeof(*s->slices));
+    if (!s->slices)
+        return AVERROR(ENOMEM);
+    for (i = 0; i < s->nb_slices; i++) {
+        DCTdnoizSlice *sl = &s->slices[i];
+
+        if (s->expr_str) {
+            int ret = av_expr_parse(&sl->expr, s->expr_str, var_names,
+                                    NULL, NULL, NULL, NULL, 0, ctx);
+            if (ret < 0)
+                return ret;
+        }
+        sl->dct       = av_dct_init(NBITS, DCT_II);
+        sl->idct      = av_dct_init(NBITS, DCT_III);
+        sl->block     = av_malloc(BSIZE * BSIZE * sizeof(*sl->block));
+        sl->tmp_block = av_malloc(BSIZE * BSIZE * sizeof(*sl->tmp_block));
+        if (!sl->dct || !sl->idct || !sl->tmp_block || !sl->block)
+            return AVERROR(ENOMEM);
+    }
+
     return 0;
 }
 
@@ -190,21 +220,16 @@ static av_cold int init(AVFilterContext *ctx)
     DCTdnoizContext *s = ctx->priv;
 
     if (s->expr_str) {
-        int ret = av_expr_parse(&s->expr, s->expr_str, var_names,
+        AVExpr *expr;
+        int ret = av_expr_parse(&expr, s->expr_str, var_names,
                                 NULL, NULL, NULL, NULL, 0, ctx);
         if (ret < 0)
             return ret;
+        av_expr_free(expr);
     }
 
     s->th   = s->sigma * 3.;
     s->step = BSIZE - s->overlap;
-    s->dct  = av_dct_init(NBITS, DCT_II);
-    s->idct = av_dct_init(NBITS, DCT_III);
-    s->block     = av_malloc(BSIZE * BSIZE * sizeof(*s->block));
-    s->tmp_block = av_malloc(BSIZE * BSIZE * sizeof(*s->tmp_block));
-
-    if (!s->dct || !s->idct || !s->tmp_block || !s->block)
-        return AVERROR(ENOMEM);
 
     return 0;
 }
@@ -267,29 +292,40 @@ static void color_correlation(float dct3ch[3][3], uint8_t *dst, int dst_linesize
     }
 }
 
-static void filter_plane(AVFilterContext *ctx,
+/* Filter the lines slice_start to slice_end - 1 of a plane. All the blocks
+ * covering these lines are transformed and added in the same order as when
+ * filtering the whole plane, so the output does not depend on the slicing. */
+static void filter_plane(AVFilterContext *ctx, DCTdnoizSlice *sl,
                          float *dst, int dst_linesize,
                          const float *src, int src_linesize,
-                         int w, int h)
+                         int w, int h, int slice_start, int slice_end)
 {
     int x, y, bx, by;
     DCTdnoizContext *s = ctx->priv;
-    float *dst0 = dst;
-    const float *weights = s->weights;
+    const float *weights = s->weights + slice_start * dst_linesize;
+    const int nb_blocks = (h - BSIZE) / s->step + 1;
+    const int first = slice_start < BSIZE ? 0 : (slice_start - BSIZE + s->step) / s->step;
+    const int last  = FFMIN((slice_end - 1) / s->step + 1, nb_blocks);
+    int n;
 
     // reset block sums
-    memset(dst, 0, h * dst_linesize * sizeof(*dst));
+    memset(dst + slice_start * dst_linesize, 0,
+           (slice_end - slice_start) * dst_linesize * sizeof(*dst));
 
     // block dct sums
-    for (y = 0; y < h - BSIZE + 1; y += s->step) {
+    for (n = first; n < last; n++) {
+        const int y0 = n * s->step;
+        const int start = FFMAX(slice_start - y0, 0);
+        const int end   = FFMIN(slice_end   - y0, BSIZE);
+
         for (x = 0; x < w - BSIZE + 1; x += s->step) {
-            float *ftb = dct_block(s, src + x, src_linesize);
+            float *ftb = dct_block(sl, src + y0 * src_linesize + x, src_linesize);
 
-            if (s->expr) {
+            if (sl->expr) {
                 for (by = 0; by < BSIZE; by++) {
                     for (bx = 0; bx < BSIZE; bx++) {
-                        s->var_values[VAR_C] = FFABS(*ftb);
-                        *ftb++ *= av_expr_eval(s->expr, s->var_values, s);
+                        sl->var_values[VAR_C] = FFABS(*ftb);
+                        *ftb++ *= av_expr_eval(sl->expr, sl->var_values, s);
                     }
                 }
             } else {
@@ -301,15 +337,13 @@ static void filter_plane(AVFilterContext *ctx,
                     }
                 }
             }
-            idct_block(s, dst + x, dst_linesize);
+            idct_block(sl, dst + y0 * dst_linesize + x, dst_linesize, start, end);
         }
-        src += s->step * src_linesize;
-        dst += s->step * dst_linesize;
     }
 
     // average blocks
-    dst = dst0;
-    for (y = 0; y < h; y++) {
+    dst += slice_start * dst_linesize;
+    for (y = slice_start; y < slice_end; y++) {
         for (x = 0; x < w; x++)
             dst[x] *= weights[x];
         dst += dst_linesize;
@@ -317,12 +351,56 @@ static void filter_plane(AVFilterContext *ctx,
     }
 }
 
+typedef struct ThreadData {
+    AVFrame *in, *out;
+} ThreadData;
+
+static int decorrelation_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    DCTdnoizContext *s = ctx->priv;
+    const ThreadData *td = arg;
+    const int slice_start = (s->pr_height *  jobnr   ) / nb_jobs;
+    const int slice_end   = (s->pr_height * (jobnr+1)) / nb_jobs;
+    const int offset = slice_start * s->p_linesize;
+    float *dst[3] = { s->cbuf[0][0] + offset, s->cbuf[0][1] + offset, s->cbuf[0][2] + offset };
+
+    color_decorrelation(s->color_dct, dst, s->p_linesize,
+                        td->in->data[0] + slice_start * td->in->linesize[0],
+                        td->in->linesize[0], s->pr_width, slice_end - slice_start);
+    return 0;
+}
+
+static int filter_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    DCTdnoizContext *s = ctx->priv;
+    const ThreadData *td = arg;
+    const int slice_start = (s->pr_height *  jobnr   ) / nb_jobs;
+    const int slice_end   = (s->pr_height * (jobnr+1)) / nb_jobs;
+    const int offset = slice_start * s->p_linesize;
+    float *src[3] = { s->cbuf[1][0] + offset, s->cbuf[1][1] + offset, s->cbuf[1][2] + offset };
+    int plane;
+
+    for (plane = 0; plane < 3; plane++)
+        filter_plane(ctx, &s->slices[jobnr],
+                     s->cbuf[1][plane], s->p_linesize,
+                     s->cbuf[0][plane], s->p_linesize,
+                     s->pr_width, s->pr_height, slice_start, slice_end);
+
+    /* the lines of the slice are final once all its blocks were added */
+    color_correlation(s->color_dct,
+                      td->out->data[0] + slice_start * td->out->linesize[0],
+                      td->out->linesize[0], src, s->p_linesize,
+                      s->pr_width, slice_end - slice_start);
+    return 0;
+}
+
 static int filter_frame(AVFilterLink *inlink, AVFrame *in)
 {
     AVFilterContext *ctx = inlink->dst;
     DCTdnoizContext *s = ctx->priv;
     AVFilterLink *outlink = inlink->dst->outputs[0];
-    int direct, plane;
+    ThreadData td;
+    int direct;
     AVFrame *out;
 
     if (av_frame_is_writable(in)) {
@@ -338,14 +416,10 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
         av_frame_copy_props(out, in);
     }
 
-    color_decorrelation(s->color_dct, s->cbuf[0], s->p_linesize,
-                        in->data[0], in->linesize[0], s->pr_width, s->pr_height);
-    for (plane = 0; plane < 3; plane++)
-        filter_plane(ctx, s->cbuf[1][plane], s->p_linesize,
-                          s->cbuf[0][plane], s->p_linesize,
-                          s->pr_width, s->pr_height);
-    color_correlation(s->color_dct, out->data[0], out->linesize[0],
-                      s->cbuf[1], s->p_linesize, s->pr_width, s->pr_height);
+    td.in  = in;
+    td.out = out;
+    ctx->internal->execute(ctx, decorrelation_slice, &td, NULL, s->nb_slices);
+    ctx->internal->execute(ctx, filter_slice,        &td, NULL, s->nb_slices);
 
     if (!direct) {
         int y;
@@ -388,17 +462,22 @@ static av_cold void uninit(AVFilterContext *ctx)
     int i;
     DCTdnoizContext *s = ctx->priv;
 
-    av_dct_end(s->dct);
-    av_dct_end(s->idct);
-    av_free(s->block);
-    av_free(s->tmp_block);
+    if (s->slices) {
+        for (i = 0; i < s->nb_slices; i++) {
+            av_dct_end(s->slices[i].dct);
+            av_dct_end(s->slices[i].idct);
+            av_free(s->slices[i].block);
+            av_free(s->slices[i].tmp_block);
+            av_expr_free(s->slices[i].expr);
+        }
+        av_freep(&s->slices);
+    }
     av_free(s->weights);
     for (i = 0; i < 2; i++) {
         av_free(s->cbuf[i][0]);
         av_free(s->cbuf[i][1]);
         av_free(s->cbuf[i][2]);
     }
-    av_expr_free(s->expr);
 }
 
 static const AVFilterPad dctdnoiz_inputs[] = {
@@ -429,5 +508,5 @@ AVFilter avfilter_vf_dctdnoiz = {
     .inputs        = dctdnoiz_inputs,
     .outputs       = dctdnoiz_outputs,
     .priv_class    = &dctdnoiz_class,
-    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC,
+    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC | AVFILTER_FLAG_SLICE_THREADS,
 };
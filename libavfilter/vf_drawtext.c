@@ -164,6 +164,12 @@ typedef struct {
     AVTimecode  tc;                 ///< timecode context
     int tc24hmax;                   ///< 1 if timecode is wrapped to 24 hours, 0 otherwise
     int reload;                     ///< reload text file for each frame
+    char *laid_out_text;            ///< expanded text the layout and text_mask are valid for
+    int text_w, text_h;             ///< size of the laid out text
+    uint8_t *text_mask;             ///< all the glyphs of the text composited into an 8 bpp mask
+    unsigned int text_mask_size;    ///< allocated size of text_mask
+    int text_mask_x, text_mask_y;   ///< position of text_mask relative to the text
+    int text_mask_w, text_mask_h;   ///< size of text_mask
 } DrawTextContext;
 
 #define OFFSET(x) offsetof(DrawTextContext, x)
@@ -519,6 +525,9 @@ static av_cold void uninit(AVFilterContext *ctx)
     s->x_pexpr = s->y_pexpr = s->draw_pexpr = NULL;
     av_freep(&s->positions);
     s->nb_positions = 0;
+    av_freep(&s->laid_out_text);
+    av_freep(&s->text_mask);
+    s->text_mask_size = 0;
 
 
     av_tree_enumerate(s->glyphs, NULL, NULL, glyph_enu_free);
@@ -770,12 +779,15 @@ static int expand_text(AVFilterContext *ctx)
     return 0;
 }
 
-static int draw_glyphs(DrawTextContext *s, AVFrame *frame,
-                       int width, int height, const uint8_t rgbcolor[4], FFDrawColor *color, int x, int y)
+/**
+ * Composite the glyphs of the expanded text at their positions into
+ * s->text_mask, so that drawing the text only takes one blend per color.
+ */
+static int render_text_mask(DrawTextContext *s)
 {
     char *text = s->expanded_text.str;
     uint32_t code = 0;
-    int i, x1, y1;
+    int i, x, y, x0 = INT_MAX, y0 = INT_MAX, x1 = INT_MIN, y1 = INT_MIN;
     uint8_t *p;
     Glyph *glyph = NULL;
 
@@ -784,7 +796,7 @@ static int draw_glyphs(DrawTextContext *s, AVFrame *frame,
         GET_UTF8(code, *p++, continue;);
 
         /* skip new line chars, just go to new line */
-        if (code == '\n' || code == '\r' || code == '\t')
+        if (is_newline(code) || code == '\t')
             continue;
 
         dummy.code = code;
@@ -794,31 +806,68 @@ static int draw_glyphs(DrawTextContext *s, AVFrame *frame,
             glyph->bitmap.pixel_mode != FT_PIXEL_MODE_GRAY)
             return AVERROR(EINVAL);
 
-        x1 = s->positions[i].x+s->x+x;
-        y1 = s->positions[i].y+s->y+y;
+        x0 = FFMIN(x0, s->positions[i].x);
+        y0 = FFMIN(y0, s->positions[i].y);
+        x1 = FFMAX(x1, s->positions[i].x + glyph->bitmap.width);
+        y1 = FFMAX(y1, s->positions[i].y + glyph->bitmap.rows);
+    }
 
-        ff_blend_mask(&s->dc, color,
-                      frame->data, frame->linesize, width, height,
-                      glyph->bitmap.buffer, glyph->bitmap.pitch,
-                      glyph->bitmap.width, glyph->bitmap.rows,
-                      glyph->bitmap.pixel_mode == FT_PIXEL_MODE_MONO ? 0 : 3,
-                      0, x1, y1);
+    s->text_mask_x = x0;
+    s->text_mask_y = y0;
+    s->text_mask_w = FFMAX(x1 - x0, 0);
+    s->text_mask_h = FFMAX(y1 - y0, 0);
+    if (!s->text_mask_w || !s->text_mask_h)
+        return 0;
+    if (s->text_mask_h > INT_MAX / s->text_mask_w)
+        return AVERROR(EINVAL);
+    if (s->text_mask_w * s->text_mask_h > s->text_mask_size) {
+        av_freep(&s->text_mask);
+        s->text_mask_size = 0;
+        if (!(s->text_mask = av_malloc(s->text_mask_w * s->text_mask_h)))
+            return AVERROR(ENOMEM);
+        s->text_mask_size = s->text_mask_w * s->text_mask_h;
+    }
+    memset(s->text_mask, 0, s->text_mask_w * s->text_mask_h);
+
+    for (i = 0, p = text; *p; i++) {
+        Glyph dummy = { 0 };
+        uint8_t *dst;
+        GET_UTF8(code, *p++, continue;);
+
+        if (is_newline(code) || code == '\t')
+            continue;
+
+        dummy.code = code;
+        glyph = av_tree_find(s->glyphs, &dummy, (void *)glyph_cmp, NULL);
+
+        dst = s->text_mask + (s->positions[i].y - y0) * s->text_mask_w +
+                             (s->positions[i].x - x0);
+        for (y = 0; y < glyph->bitmap.rows; y++) {
+            const uint8_t *src = glyph->bitmap.buffer + y * glyph->bitmap.pitch;
+            for (x = 0; x < glyph->bitmap.width; x++) {
+                unsigned a = glyph->bitmap.pixel_mode == FT_PIXEL_MODE_MONO ?
+                             (src[x >> 3] >> (~x & 7) & 1) * 255 : src[x];
+                /* overlapping glyphs are composited as if blended in turn */
+                dst[x] += a - (dst[x] * a + 127) / 255;
+            }
+            dst += s->text_mask_w;
+        }
     }
 
     return 0;
 }
 
-static int draw_text(AVFilterContext *ctx, AVFrame *frame,
-                     int width, int height)
+/**
+ * Load the glyphs of the expanded text, compute their positions and the
+ * text metrics, and render the text mask.
+ */
+static int layout_text(AVFilterContext *ctx)
 {
     DrawTextContext *s = ctx->priv;
-    AVFilterLink *inlink = ctx->inputs[0];
-
     uint32_t code = 0, prev_code = 0;
     int x = 0, y = 0, i = 0, ret;
     int max_text_line_w = 0, len;
-    int box_w, box_h;
-    char *text = s->text;
+    char *text;
     uint8_t *p;
     int y_min = 32000, y_max = -32000;
     int x_min = 32000, x_max = -32000;
@@ -826,38 +875,6 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame,
     Glyph *glyph = NULL, *prev_glyph = NULL;
     Glyph dummy = { 0 };
 
-    time_t now = time(0);
-    struct tm ltime;
-    AVBPrint *bp = &s->expanded_text;
-
-    av_bprint_clear(bp);
-
-    if(s->basetime != AV_NOPTS_VALUE)
-        now= frame->pts*av_q2d(ctx->inputs[0]->time_base) + s->basetime/1000000;
-
-    switch (s->exp_mode) {
-    case EXP_NONE:
-        av_bprintf(bp, "%s", s->text);
-        break;
-    case EXP_NORMAL:
-        if ((ret = expand_text(ctx)) < 0)
-            return ret;
-        break;
-    case EXP_STRFTIME:
-        localtime_r(&now, &ltime);
-        av_bprint_strftime(bp, s->text, &ltime);
-        break;
-    }
-
-    if (s->tc_opt_string) {
-        char tcbuf[AV_TIMECODE_STR_SIZE];
-        av_timecode_make_string(&s->tc, tcbuf, inlink->frame_count);
-        av_bprint_clear(bp);
-        av_bprintf(bp, "%s%s", s->text, tcbuf);
-    }
-
-    if (!av_bprint_is_complete(bp))
-        return AVERROR(ENOMEM);
     text = s->expanded_text.str;
     if ((len = s->expanded_text.len) > s->nb_positions) {
         if (!(s->positions =
@@ -866,9 +883,6 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame,
         s->nb_positions = len;
     }
 
-    x = 0;
-    y = 0;
-
     /* load and cache glyphs */
     for (i = 0, p = text; *p; i++) {
         GET_UTF8(code, *p++, continue;);
@@ -877,7 +891,8 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame,
         dummy.code = code;
         glyph = av_tree_find(s->glyphs, &dummy, glyph_cmp, NULL);
         if (!glyph) {
-            load_glyph(ctx, &glyph, code);
+            if ((ret = load_glyph(ctx, &glyph, code)) < 0)
+                return ret;
         }
 
         y_min = FFMIN(glyph->bbox.yMin, y_min);
@@ -926,9 +941,11 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame,
     }
 
     max_text_line_w = FFMAX(x, max_text_line_w);
+    s->text_w = max_text_line_w;
+    s->text_h = y + s->max_glyph_h;
 
-    s->var_values[VAR_TW] = s->var_values[VAR_TEXT_W] = max_text_line_w;
-    s->var_values[VAR_TH] = s->var_values[VAR_TEXT_H] = y + s->max_glyph_h;
+    s->var_values[VAR_TW] = s->var_values[VAR_TEXT_W] = s->text_w;
+    s->var_values[VAR_TH] = s->var_values[VAR_TEXT_H] = s->text_h;
 
     s->var_values[VAR_MAX_GLYPH_W] = s->max_glyph_w;
     s->var_values[VAR_MAX_GLYPH_H] = s->max_glyph_h;
@@ -937,6 +954,60 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame,
 
     s->var_values[VAR_LINE_H] = s->var_values[VAR_LH] = s->max_glyph_h;
 
+    return render_text_mask(s);
+}
+
+static int draw_text(AVFilterContext *ctx, AVFrame *frame,
+                     int width, int height)
+{
+    DrawTextContext *s = ctx->priv;
+    AVFilterLink *inlink = ctx->inputs[0];
+
+    int ret;
+    int box_w, box_h;
+
+    time_t now = time(0);
+    struct tm ltime;
+    AVBPrint *bp = &s->expanded_text;
+
+    av_bprint_clear(bp);
+
+    if(s->basetime != AV_NOPTS_VALUE)
+        now= frame->pts*av_q2d(ctx->inputs[0]->time_base) + s->basetime/1000000;
+
+    switch (s->exp_mode) {
+    case EXP_NONE:
+        av_bprintf(bp, "%s", s->text);
+        break;
+    case EXP_NORMAL:
+        if ((ret = expand_text(ctx)) < 0)
+            return ret;
+        break;
+    case EXP_STRFTIME:
+        localtime_r(&now, &ltime);
+        av_bprint_strftime(bp, s->text, &ltime);
+        break;
+    }
+
+    if (s->tc_opt_string) {
+        char tcbuf[AV_TIMECODE_STR_SIZE];
+        av_timecode_make_string(&s->tc, tcbuf, inlink->frame_count);
+        av_bprint_clear(bp);
+        av_bprintf(bp, "%s%s", s->text, tcbuf);
+    }
+
+    if (!av_bprint_is_complete(bp))
+        return AVERROR(ENOMEM);
+
+    /* the layout and the rendered text only depend on the expanded text */
+    if (!s->laid_out_text || strcmp(s->laid_out_text, bp->str)) {
+        av_freep(&s->laid_out_text);
+        if ((ret = layout_text(ctx)) < 0)
+            return ret;
+        if (!(s->laid_out_text = av_strdup(bp->str)))
+            return AVERROR(ENOMEM);
+    }
+
     s->x = s->var_values[VAR_X] = av_expr_eval(s->x_pexpr, s->var_values, &s->prng);
     s->y = s->var_values[VAR_Y] = av_expr_eval(s->y_pexpr, s->var_values, &s->prng);
     s->x = s->var_values[VAR_X] = av_expr_eval(s->x_pexpr, s->var_values, &s->prng);
@@ -945,8 +1016,8 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame,
     if(!s->draw)
         return 0;
 
-    box_w = FFMIN(width - 1 , max_text_line_w);
-    box_h = FFMIN(height - 1, y + s->max_glyph_h);
+    box_w = FFMIN(width - 1 , s->text_w);
+    box_h = FFMIN(height - 1, s->text_h);
 
     /* draw box */
     if (s->draw_box)
@@ -954,15 +1025,22 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame,
                            frame->data, frame->linesize, width, height,
                            s->x, s->y, box_w, box_h);
 
-    if (s->shadowx || s->shadowy) {
-        if ((ret = draw_glyphs(s, frame, width, height, s->shadowcolor.rgba,
-                               &s->shadowcolor, s->shadowx, s->shadowy)) < 0)
-            return ret;
-    }
+    if (!s->text_mask_w || !s->text_mask_h)
+        return 0;
 
-    if ((ret = draw_glyphs(s, frame, width, height, s->fontcolor.rgba,
-                           &s->fontcolor, 0, 0)) < 0)
-        return ret;
+    if (s->shadowx || s->shadowy)
+        ff_blend_mask(&s->dc, &s->shadowcolor,
+                      frame->data, frame->linesize, width, height,
+                      s->text_mask, s->text_mask_w,
+                      s->text_mask_w, s->text_mask_h, 3, 0,
+                      s->x + s->text_mask_x + s->shadowx,
+                      s->y + s->text_mask_y + s->shadowy);
+
+    ff_blend_mask(&s->dc, &s->fontcolor,
+                  frame->data, frame->linesize, width, height,
+                  s->text_mask, s->text_mask_w,
+                  s->text_mask_w, s->text_mask_h, 3, 0,
+                  s->x + s->text_mask_x, s->y + s->text_mask_y);
 
     return 0;
 }
@@ -255,6 +255,19 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *buf)
     return ret;
 }
 
+static int frame_wanted(AVFilterLink *inlink, int64_t pts)
+{
+    FPSContext *s = inlink->dst->priv;
+    int64_t cur_pts = s->pts;
+
+    /* s->pts only increases, and the frames dropped by filter_frame()
+     * do not change the state */
+    if (cur_pts == AV_NOPTS_VALUE || pts == AV_NOPTS_VALUE)
+        return 1;
+    return av_rescale_q_rnd(pts - cur_pts, inlink->time_base,
+                            inlink->dst->outputs[0]->time_base, s->rounding) >= 1;
+}
+
 static const AVFilterPad avfilter_vf_fps_inputs[] = {
     {
         .name        = "default",
@@ -286,4 +299,8 @@ AVFilter avfilter_vf_fps = {
 
     .inputs    = avfilter_vf_fps_inputs,
     .outputs   = avfilter_vf_fps_outputs,
+
+    .flags     = AVFILTER_FLAG_SUPPORT_HWACCEL,
+
+    .frame_wanted = frame_wanted,
 };
@@ -80,25 +80,46 @@ void ff_gradfun_blur_line_c(uint16_t *dc, uint16_t *buf, const uint16_t *buf1, c
     }
 }
 
-static void filter(GradFunContext *ctx, uint8_t *dst, const uint8_t *src, int width, int height, int dst_linesize, int src_linesize, int r)
+static void filter(GradFunContext *ctx, uint16_t *tmp, uint8_t *dst, const uint8_t *src,
+                   int width, int height, int dst_linesize, int src_linesize, int r,
+                   int slice_start, int slice_end)
 {
     int bstride = FFALIGN(width, 16) / 2;
-    int y;
+    int y, cur, q, q0;
     uint32_t dc_factor = (1 << 21) / (r * r);
-    uint16_t *dc = ctx->buf + 16;
-    uint16_t *buf = ctx->buf + bstride + 32;
+    uint16_t *dc = tmp + 16;
+    uint16_t *buf = tmp + bstride + 32;
     int thresh = ctx->thresh;
+    /* the blurred line pairs start at r, the last one ends r lines above the bottom */
+    const int last = r + ((height - 2 * r - 1) & ~1);
 
+    if (slice_start >= slice_end)
+        return;
+
+    /* The ring buffer holds running column sums of the line pairs, only the
+     * difference of two sums r pairs apart is used, so the slice can start
+     * summing from zero r pairs above its first blurred line pair. */
+    cur = av_clip(slice_start & ~1, r, last);
+    q0  = (cur + r) / 2;
     memset(dc, 0, (bstride + 16) * sizeof(*buf));
-    for (y = 0; y < r; y++)
-        ctx->blur_line(dc, buf + y * bstride, buf + (y - 1) * bstride, src + 2 * y * src_linesize, src_linesize, width / 2);
-    for (;;) {
-        if (y < height - r) {
-            int mod = ((y + r) / 2) % r;
-            uint16_t *buf0 = buf + mod * bstride;
-            uint16_t *buf1 = buf + (mod ? mod - 1 : r - 1) * bstride;
-            int x, v;
-            ctx->blur_line(dc, buf0, buf1, src + (y + r) * src_linesize, src_linesize, width / 2);
+    memset(buf + (q0 - 1) % r * bstride, 0, bstride * sizeof(*buf));
+    for (q = q0 - r; q < q0; q++)
+        ctx->blur_line(dc, buf + q % r * bstride, buf + (q + r - 1) % r * bstride,
+                       src + 2 * q * src_linesize, src_linesize, width / 2);
+    cur -= 2;
+
+    for (y = slice_start; y < slice_end; y++) {
+        const int target = av_clip(y & ~1, r, last);
+
+        while (cur < target) {
+            int mod, x, v;
+            uint16_t *buf0, *buf1;
+
+            cur += 2;
+            mod  = ((cur + r) / 2) % r;
+            buf0 = buf + mod * bstride;
+            buf1 = buf + (mod ? mod - 1 : r - 1) * bstride;
+            ctx->blur_line(dc, buf0, buf1, src + (cur + r) * src_linesize, src_linesize, width / 2);
             for (x = v = 0; x < r; x++)
                 v += dc[x];
             for (; x < width / 2; x++) {
@@ -110,14 +131,7 @@ static void filter(GradFunContext *ctx, uint8_t *dst, const uint8_t *src, int wi
             for (x = -r / 2; x < 0; x++)
                 dc[x] = dc[0];
         }
-        if (y == r) {
-            for (y = 0; y < r; y++)
-                ctx->filter_line(dst + y * dst_linesize, src + y * src_linesize, dc - r / 2, width, thresh, dither[y & 7]);
-        }
-        ctx->filter_line(dst + y * dst_linesize, src + y * src_linesize, dc - r / 2, width, thresh, dither[y & 7]);
-        if (++y >= height) break;
         ctx->filter_line(dst + y * dst_linesize, src + y * src_linesize, dc - r / 2, width, thresh, dither[y & 7]);
-        if (++y >= height) break;
     }
 }
 
@@ -169,7 +183,9 @@ static int config_input(AVFilterLink *inlink)
     int vsub = desc->log2_chroma_h;
 
     av_freep(&s->buf);
-    s->buf = av_mallocz((FFALIGN(inlink->w, 16) * (s->radius + 1) / 2 + 32) * sizeof(uint16_t));
+    s->buf_size = FFALIGN(FFALIGN(inlink->w, 16) * (s->radius + 1) / 2 + 32, 8);
+    s->buf = av_mallocz_array(inlink->dst->graph->nb_threads,
+                              s->buf_size * sizeof(uint16_t));
     if (!s->buf)
         return AVERROR(ENOMEM);
 
@@ -180,14 +196,63 @@ static int config_input(AVFilterLink *inlink)
     return 0;
 }
 
+typedef struct ThreadData {
+    AVFrame *in, *out;
+} ThreadData;
+
+static int filter_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    GradFunContext *s = ctx->priv;
+    AVFilterLink *inlink = ctx->inputs[0];
+    const ThreadData *td = arg;
+    AVFrame *in  = td->in;
+    AVFrame *out = td->out;
+    int p;
+
+    for (p = 0; p < 4 && in->data[p]; p++) {
+        int w = inlink->w;
+        int h = inlink->h;
+        int r = s->radius;
+        int bytewidth = av_image_get_linesize(inlink->format, inlink->w, p);
+        int slice_start, slice_end;
+        if (p) {
+            w = s->chroma_w;
+            h = s->chroma_h;
+            r = s->chroma_r;
+        }
+        slice_start = (h *  jobnr   ) / nb_jobs;
+        slice_end   = (h * (jobnr+1)) / nb_jobs;
+
+        if (FFMIN(w, h) > 2 * r)
+            filter(s, s->buf + jobnr * s->buf_size,
+                   out->data[p], in->data[p], w, h, out->linesize[p], in->linesize[p], r,
+                   slice_start, slice_end);
+        else
+            w = 0;
+
+        /* copy what is not filtered, e.g. the V samples of NV12 */
+        if (out->data[p] != in->data[p] && bytewidth > w)
+            av_image_copy_plane(out->data[p] + slice_start * out->linesize[p] + w, out->linesize[p],
+                                in ->data[p] + slice_start * in ->linesize[p] + w, in ->linesize[p],
+                                bytewidth - w, slice_end - slice_start);
+    }
+
+    return 0;
+}
+
 static int filter_frame(AVFilterLink *inlink, AVFrame *in)
 {
-    GradFunContext *s = inlink->dst->priv;
-    AVFilterLink *outlink = inlink->dst->outputs[0];
+    AVFilterContext *ctx = inlink->dst;
+    GradFunContext *s = ctx->priv;
+    AVFilterLink *outlink = ctx->outputs[0];
     AVFrame *out;
-    int p, direct;
+    ThreadData td;
+    int direct;
+    int nb_jobs = FFMIN(s->chroma_h, ctx->graph->nb_threads);
 
-    if (av_frame_is_writable(in)) {
+    /* the slices read the source lines around them, so they can only
+     * filter in place when there is a single one */
+    if (nb_jobs == 1 && av_frame_is_writable(in)) {
         direct = 1;
         out = in;
     } else {
@@ -200,21 +265,9 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
         av_frame_copy_props(out, in);
     }
 
-    for (p = 0; p < 4 && in->data[p]; p++) {
-        int w = inlink->w;
-        int h = inlink->h;
-        int r = s->radius;
-        if (p) {
-            w = s->chroma_w;
-            h = s->chroma_h;
-            r = s->chroma_r;
-        }
-
-        if (FFMIN(w, h) > 2 * r)
-            filter(s, out->data[p], in->data[p], w, h, out->linesize[p], in->linesize[p], r);
-        else if (out->data[p] != in->data[p])
-            av_image_copy_plane(out->data[p], out->linesize[p], in->data[p], in->linesize[p], w, h);
-    }
+    td.in  = in;
+    td.out = out;
+    ctx->internal->execute(ctx, filter_slice, &td, NULL, nb_jobs);
 
     if (!direct)
         av_frame_free(&in);
@@ -261,5 +314,5 @@ AVFilter avfilter_vf_gradfun = {
     .query_formats = query_formats,
     .inputs        = avfilter_vf_gradfun_inputs,
     .outputs       = avfilter_vf_gradfun_outputs,
-    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC,
+    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC | AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -62,6 +62,7 @@ typedef struct {
     int in_histogram [256];        ///< input histogram
     int out_histogram[256];        ///< output histogram
     int LUT[256];                  ///< lookup table derived from histogram[]
+    int *slice_histograms;         ///< input and output histograms of each job
     uint8_t rgba_map[4];           ///< components position
     int bpp;                       ///< bytes per pixel
 } HisteqContext;
@@ -114,9 +115,22 @@ static int config_input(AVFilterLink *inlink)
     histeq->bpp = av_get_bits_per_pixel(pix_desc) / 8;
     ff_fill_rgba_map(histeq->rgba_map, inlink->format);
 
+    av_freep(&histeq->slice_histograms);
+    histeq->slice_histograms = av_malloc_array(ctx->graph->nb_threads,
+                                               2 * 256 * sizeof(*histeq->slice_histograms));
+    if (!histeq->slice_histograms)
+        return AVERROR(ENOMEM);
+
     return 0;
 }
 
+static av_cold void uninit(AVFilterContext *ctx)
+{
+    HisteqContext *histeq = ctx->priv;
+
+    av_freep(&histeq->slice_histograms);
+}
+
 #define R 0
 #define G 1
 #define B 2
@@ -128,77 +142,83 @@ static int config_input(AVFilterLink *inlink)
     b = src[x + map[B]];                       \
 } while (0)
 
-static int filter_frame(AVFilterLink *inlink, AVFrame *inpic)
+/* Return the state of the generator after n steps from x. */
+static unsigned lcg_skip(unsigned x, uint64_t n)
 {
-    AVFilterContext   *ctx     = inlink->dst;
-    HisteqContext     *histeq  = ctx->priv;
-    AVFilterLink      *outlink = ctx->outputs[0];
-    int strength  = histeq->strength  * 1000;
-    int intensity = histeq->intensity * 1000;
-    int x, y, i, luthi, lutlo, lut, luma, oluma, m;
-    AVFrame *outpic;
-    unsigned int r, g, b, jran;
-    uint8_t *src, *dst;
+    uint64_t a = 1, c = 0, ma = LCG_A, mc = LCG_C;
 
-    outpic = ff_get_video_buffer(outlink, outlink->w, outlink->h);
-    if (!outpic) {
-        av_frame_free(&inpic);
-        return AVERROR(ENOMEM);
+    for (; n; n >>= 1) {
+        if (n & 1) {
+            a = (a * ma) % LCG_M;
+            c = (c * ma + mc) % LCG_M;
+        }
+        mc = (mc * ma + mc) % LCG_M;
+        ma = (ma * ma) % LCG_M;
     }
-    av_frame_copy_props(outpic, inpic);
+    return (a * x + c) % LCG_M;
+}
 
-    /* Seed random generator for antibanding. */
-    jran = LCG_SEED;
+typedef struct ThreadData {
+    AVFrame *in, *out;
+} ThreadData;
 
-    /* Calculate and store the luminance and calculate the global histogram
-       based on the luminance. */
-    memset(histeq->in_histogram, 0, sizeof(histeq->in_histogram));
-    src = inpic->data[0];
-    dst = outpic->data[0];
-    for (y = 0; y < inlink->h; y++) {
-        for (x = 0; x < inlink->w * histeq->bpp; x += histeq->bpp) {
+/* Store the luminance and calculate the histogram of a slice. */
+static int luma_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    HisteqContext *histeq = ctx->priv;
+    const ThreadData *td = arg;
+    const AVFrame *in  = td->in;
+    const AVFrame *out = td->out;
+    const int slice_start = (in->height *  jobnr   ) / nb_jobs;
+    const int slice_end   = (in->height * (jobnr+1)) / nb_jobs;
+    const uint8_t *src = in ->data[0] + slice_start * in ->linesize[0];
+    uint8_t       *dst = out->data[0] + slice_start * out->linesize[0];
+    int *histogram = histeq->slice_histograms + jobnr * 2 * 256;
+    unsigned int r, g, b;
+    int x, y, luma;
+
+    memset(histogram, 0, 256 * sizeof(*histogram));
+    for (y = slice_start; y < slice_end; y++) {
+        for (x = 0; x < in->width * histeq->bpp; x += histeq->bpp) {
             GET_RGB_VALUES(r, g, b, src, histeq->rgba_map);
             luma = (55 * r + 182 * g + 19 * b) >> 8;
             dst[x + histeq->rgba_map[A]] = luma;
-            histeq->in_histogram[luma]++;
+            histogram[luma]++;
         }
-        src += inpic->linesize[0];
-        dst += outpic->linesize[0];
+        src += in ->linesize[0];
+        dst += out->linesize[0];
     }
+    return 0;
+}
 
-#ifdef DEBUG
-    for (x = 0; x < 256; x++)
-        av_dlog(ctx, "in[%d]: %u\n", x, histeq->in_histogram[x]);
-#endif
-
-    /* Calculate the lookup table. */
-    histeq->LUT[0] = histeq->in_histogram[0];
-    /* Accumulate */
-    for (x = 1; x < 256; x++)
-        histeq->LUT[x] = histeq->LUT[x-1] + histeq->in_histogram[x];
-
-    /* Normalize */
-    for (x = 0; x < 256; x++)
-        histeq->LUT[x] = (histeq->LUT[x] * intensity) / (inlink->h * inlink->w);
+/* Output the equalized slice. */
+static int equalize_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    HisteqContext *histeq = ctx->priv;
+    const ThreadData *td = arg;
+    const AVFrame *in  = td->in;
+    const AVFrame *out = td->out;
+    const int slice_start = (in->height *  jobnr   ) / nb_jobs;
+    const int slice_end   = (in->height * (jobnr+1)) / nb_jobs;
+    const uint8_t *src = in ->data[0] + slice_start * in ->linesize[0];
+    uint8_t       *dst = out->data[0] + slice_start * out->linesize[0];
+    int *histogram = histeq->slice_histograms + (jobnr * 2 + 1) * 256;
+    int x, y, i, luthi, lutlo, lut, luma, oluma, m;
+    unsigned int r, g, b, jran;
 
-    /* Adjust the LUT based on the selected strength. This is an alpha
-       mix of the calculated LUT and a linear LUT with gain 1. */
-    for (x = 0; x < 256; x++)
-        histeq->LUT[x] = (strength * histeq->LUT[x]) / 255 +
-                         ((255 - strength) * x)      / 255;
+    memset(histogram, 0, 256 * sizeof(*histogram));
+    for (y = slice_start; y < slice_end; y++) {
+        /* Restart the antibanding noise of each line where the sequence
+           would be if every pixel used a number, so that the output does
+           not depend on the slicing. */
+        jran = lcg_skip(LCG_SEED, (uint64_t)y * in->width);
 
-    /* Output the equalized frame. */
-    memset(histeq->out_histogram, 0, sizeof(histeq->out_histogram));
-
-    src = inpic->data[0];
-    dst = outpic->data[0];
-    for (y = 0; y < inlink->h; y++) {
-        for (x = 0; x < inlink->w * histeq->bpp; x += histeq->bpp) {
+        for (x = 0; x < in->width * histeq->bpp; x += histeq->bpp) {
             luma = dst[x + histeq->rgba_map[A]];
             if (luma == 0) {
                 for (i = 0; i < histeq->bpp; ++i)
                     dst[x + i] = 0;
-                histeq->out_histogram[0]++;
+                histogram[0]++;
             } else {
                 lut = histeq->LUT[luma];
                 if (histeq->antibanding != HISTEQ_ANTIBANDING_NONE) {
@@ -236,12 +256,80 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *inpic)
                 dst[x + histeq->rgba_map[G]] = g;
                 dst[x + histeq->rgba_map[B]] = b;
                 oluma = av_clip_uint8((55 * r + 182 * g + 19 * b) >> 8);
-                histeq->out_histogram[oluma]++;
+                histogram[oluma]++;
             }
         }
-        src += inpic->linesize[0];
-        dst += outpic->linesize[0];
+        src += in ->linesize[0];
+        dst += out->linesize[0];
+    }
+    return 0;
+}
+
+/* Sum the histograms of the slices into dst. */
+static void sum_histograms(HisteqContext *histeq, int *dst, int out, int nb_jobs)
+{
+    int i, j;
+
+    memset(dst, 0, 256 * sizeof(*dst));
+    for (i = 0; i < nb_jobs; i++) {
+        const int *histogram = histeq->slice_histograms + (i * 2 + out) * 256;
+        for (j = 0; j < 256; j++)
+            dst[j] += histogram[j];
+    }
+}
+
+static int filter_frame(AVFilterLink *inlink, AVFrame *inpic)
+{
+    AVFilterContext   *ctx     = inlink->dst;
+    HisteqContext     *histeq  = ctx->priv;
+    AVFilterLink      *outlink = ctx->outputs[0];
+    int strength  = histeq->strength  * 1000;
+    int intensity = histeq->intensity * 1000;
+    int nb_jobs   = FFMIN(inlink->h, ctx->graph->nb_threads);
+    int x;
+    AVFrame *outpic;
+    ThreadData td;
+
+    outpic = ff_get_video_buffer(outlink, outlink->w, outlink->h);
+    if (!outpic) {
+        av_frame_free(&inpic);
+        return AVERROR(ENOMEM);
     }
+    av_frame_copy_props(outpic, inpic);
+
+    td.in  = inpic;
+    td.out = outpic;
+
+    /* Calculate and store the luminance and calculate the global histogram
+       based on the luminance. */
+    ctx->internal->execute(ctx, luma_slice, &td, NULL, nb_jobs);
+    sum_histograms(histeq, histeq->in_histogram, 0, nb_jobs);
+
+#ifdef DEBUG
+    for (x = 0; x < 256; x++)
+        av_dlog(ctx, "in[%d]: %u\n", x, histeq->in_histogram[x]);
+#endif
+
+    /* Calculate the lookup table. */
+    histeq->LUT[0] = histeq->in_histogram[0];
+    /* Accumulate */
+    for (x = 1; x < 256; x++)
+        histeq->LUT[x] = histeq->LUT[x-1] + histeq->in_histogram[x];
+
+    /* Normalize */
+    for (x = 0; x < 256; x++)
+        histeq->LUT[x] = (histeq->LUT[x] * intensity) / (inlink->h * inlink->w);
+
+    /* Adjust the LUT based on the selected strength. This is an alpha
+       mix of the calculated LUT and a linear LUT with gain 1. */
+    for (x = 0; x < 256; x++)
+        histeq->LUT[x] = (strength * histeq->LUT[x]) / 255 +
+                         ((255 - strength) * x)      / 255;
+
+    /* Output the equalized frame. */
+    ctx->internal->execute(ctx, equalize_slice, &td, NULL, nb_jobs);
+    sum_histograms(histeq, histeq->out_histogram, 1, nb_jobs);
+
 #ifdef DEBUG
     for (x = 0; x < 256; x++)
         av_dlog(ctx, "out[%d]: %u\n", x, histeq->out_histogram[x]);
@@ -274,10 +362,11 @@ AVFilter avfilter_vf_histeq = {
     .description   = NULL_IF_CONFIG_SMALL("Apply global color histogram equalization."),
     .priv_size     = sizeof(HisteqContext),
     .init          = init,
+    .uninit        = uninit,
     .query_formats = query_formats,
 
     .inputs        = histeq_inputs,
     .outputs       = histeq_outputs,
     .priv_class    = &histeq_class,
-    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC,
+    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC | AVFILTER_FLAG_SLICE_THREADS,
 };
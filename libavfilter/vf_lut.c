@@ -258,17 +258,87 @@ static int config_props(AVFilterLink *inlink)
     return 0;
 }
 
+typedef struct ThreadData {
+    AVFrame *in, *out;
+} ThreadData;
+
+#define LUT_PACKED(nb_comp) do {                                        \
+    for (i = slice_start; i < slice_end; i++) {                         \
+        const uint8_t *inrow  = in ->data[0] + i * in ->linesize[0];    \
+        uint8_t       *outrow = out->data[0] + i * out->linesize[0];    \
+        for (j = 0; j < w; j++) {                                       \
+            switch (nb_comp) {                                          \
+            case 4:  outrow[3] = tab[3][inrow[3]]; /* Fall-through */   \
+            case 3:  outrow[2] = tab[2][inrow[2]]; /* Fall-through */   \
+            case 2:  outrow[1] = tab[1][inrow[1]]; /* Fall-through */   \
+            default: outrow[0] = tab[0][inrow[0]];                      \
+            }                                                           \
+            outrow += nb_comp;                                          \
+            inrow  += nb_comp;                                          \
+        }                                                               \
+    }                                                                   \
+} while (0)
+
+static int lut_packed_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    LutContext *s = ctx->priv;
+    const ThreadData *td = arg;
+    const AVFrame *in  = td->in;
+    AVFrame       *out = td->out;
+    const uint8_t (*tab)[256] = (const uint8_t (*)[256])s->lut;
+    const int w = in->width;
+    const int slice_start = (in->height *  jobnr   ) / nb_jobs;
+    const int slice_end   = (in->height * (jobnr+1)) / nb_jobs;
+    int i, j;
+
+    /* one loop per pixel size, so that the component loop is unrolled */
+    switch (s->step) {
+    case 4:  LUT_PACKED(4); break;
+    case 3:  LUT_PACKED(3); break;
+    case 2:  LUT_PACKED(2); break;
+    default: LUT_PACKED(1); break;
+    }
+
+    return 0;
+}
+
+static int lut_planar_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    LutContext *s = ctx->priv;
+    const ThreadData *td = arg;
+    const AVFrame *in  = td->in;
+    AVFrame       *out = td->out;
+    int i, j, plane;
+
+    for (plane = 0; plane < 4 && in->data[plane]; plane++) {
+        int vsub = plane == 1 || plane == 2 ? s->vsub : 0;
+        int hsub = plane == 1 || plane == 2 ? s->hsub : 0;
+        int h = FF_CEIL_RSHIFT(in->height, vsub);
+        int w = FF_CEIL_RSHIFT(in->width,  hsub);
+        int slice_start = (h *  jobnr   ) / nb_jobs;
+        int slice_end   = (h * (jobnr+1)) / nb_jobs;
+        const uint8_t *tab = s->lut[plane];
+
+        for (i = slice_start; i < slice_end; i++) {
+            const uint8_t *inrow  = in ->data[plane] + i * in ->linesize[plane];
+            uint8_t       *outrow = out->data[plane] + i * out->linesize[plane];
+            for (j = 0; j < w; j++)
+                outrow[j] = tab[inrow[j]];
+        }
+    }
+
+    return 0;
+}
+
 static int filter_frame(AVFilterLink *inlink, AVFrame *in)
 {
     AVFilterContext *ctx = inlink->dst;
     LutContext *s = ctx->priv;
     AVFilterLink *outlink = ctx->outputs[0];
     AVFrame *out;
-    uint8_t *inrow, *outrow, *inrow0, *outrow0;
-    int i, j, plane, direct = 0;
+    ThreadData td;
 
     if (av_frame_is_writable(in)) {
-        direct = 1;
         out = in;
     } else {
         out = ff_get_video_buffer(outlink, outlink->w, outlink->h);
@@ -279,51 +349,12 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
         av_frame_copy_props(out, in);
     }
 
-    if (s->is_rgb) {
-        /* packed */
-        inrow0  = in ->data[0];
-        outrow0 = out->data[0];
-
-        for (i = 0; i < in->height; i ++) {
-            int w = inlink->w;
-            const uint8_t (*tab)[256] = (const uint8_t (*)[256])s->lut;
-            inrow  = inrow0;
-            outrow = outrow0;
-            for (j = 0; j < w; j++) {
-                switch (s->step) {
-                case 4:  outrow[3] = tab[3][inrow[3]]; // Fall-through
-                case 3:  outrow[2] = tab[2][inrow[2]]; // Fall-through
-                case 2:  outrow[1] = tab[1][inrow[1]]; // Fall-through
-                default: outrow[0] = tab[0][inrow[0]];
-                }
-                outrow += s->step;
-                inrow  += s->step;
-            }
-            inrow0  += in ->linesize[0];
-            outrow0 += out->linesize[0];
-        }
-    } else {
-        /* planar */
-        for (plane = 0; plane < 4 && in->data[plane]; plane++) {
-            int vsub = plane == 1 || plane == 2 ? s->vsub : 0;
-            int hsub = plane == 1 || plane == 2 ? s->hsub : 0;
-            int h = FF_CEIL_RSHIFT(inlink->h, vsub);
-            int w = FF_CEIL_RSHIFT(inlink->w, hsub);
-
-            inrow  = in ->data[plane];
-            outrow = out->data[plane];
-
-            for (i = 0; i < h; i++) {
-                const uint8_t *tab = s->lut[plane];
-                for (j = 0; j < w; j++)
-                    outrow[j] = tab[inrow[j]];
-                inrow  += in ->linesize[plane];
-                outrow += out->linesize[plane];
-            }
-        }
-    }
+    td.in  = in;
+    td.out = out;
+    ctx->internal->execute(ctx, s->is_rgb ? lut_packed_slice : lut_planar_slice,
+                           &td, NULL, FFMIN(outlink->h, ctx->graph->nb_threads));
 
-    if (!direct)
+    if (out != in)
         av_frame_free(&in);
 
     return ff_filter_frame(outlink, out);
@@ -356,7 +387,8 @@ static const AVFilterPad outputs[] = {
                                                                         \
         .inputs        = inputs,                                        \
         .outputs       = outputs,                                       \
-        .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC,        \
+        .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC |       \
+                         AVFILTER_FLAG_SLICE_THREADS,                   \
     }
 
 #if CONFIG_LUT_FILTER
@@ -331,9 +331,11 @@ static int config_output(AVFilterLink *outlink)
 /**
  * Blend image in src to destination buffer dst at position (x, y).
  */
+/* blend the rows slice_start to slice_end - 1 of src, slice_start must be
+   a multiple of the chroma subsampling */
 static void blend_image(AVFilterContext *ctx,
                         AVFrame *dst, const AVFrame *src,
-                        int x, int y)
+                        int x, int y, int slice_start, int slice_end)
 {
     OverlayContext *s = ctx->priv;
     int i, imax, j, jmax, k, kmax;
@@ -361,11 +363,11 @@ static void blend_image(AVFilterContext *ctx,
         const int main_has_alpha = s->main_has_alpha;
         uint8_t *s, *sp, *d, *dp;
 
-        i = FFMAX(-y, 0);
+        i = FFMAX(FFMAX(-y, 0), slice_start);
         sp = src->data[0] + i     * src->linesize[0];
         dp = dst->data[0] + (y+i) * dst->linesize[0];
 
-        for (imax = FFMIN(-y + dst_h, src_h); i < imax; i++) {
+        for (imax = FFMIN3(-y + dst_h, src_h, slice_end); i < imax; i++) {
             j = FFMAX(-x, 0);
             s = sp + j     * sstep;
             d = dp + (x+j) * dstep;
@@ -419,11 +421,11 @@ static void blend_image(AVFilterContext *ctx,
             uint8_t alpha;          ///< the amount of overlay to blend on to main
             uint8_t *s, *sa, *d, *da;
 
-            i = FFMAX(-y, 0);
+            i = FFMAX(FFMAX(-y, 0), slice_start);
             sa = src->data[3] + i     * src->linesize[3];
             da = dst->data[3] + (y+i) * dst->linesize[3];
 
-            for (imax = FFMIN(-y + dst_h, src_h); i < imax; i++) {
+            for (imax = FFMIN3(-y + dst_h, src_h, slice_end); i < imax; i++) {
                 j = FFMAX(-x, 0);
                 s = sa + j;
                 d = da + x+j;
@@ -462,12 +464,12 @@ static void blend_image(AVFilterContext *ctx,
             int xp = x>>hsub;
             uint8_t *s, *sp, *d, *dp, *a, *ap;
 
-            j = FFMAX(-yp, 0);
+            j = FFMAX(FFMAX(-yp, 0), slice_start >> vsub);
             sp = src->data[i] + j         * src->linesize[i];
             dp = dst->data[i] + (yp+j)    * dst->linesize[i];
             ap = src->data[3] + (j<<vsub) * src->linesize[3];
 
-            for (jmax = FFMIN(-yp + dst_hp, src_hp); j < jmax; j++) {
+            for (jmax = FFMIN3(-yp + dst_hp, src_hp, FF_CEIL_RSHIFT(slice_end, vsub)); j < jmax; j++) {
                 k = FFMAX(-xp, 0);
                 d = dp + xp+k;
                 s = sp + k;
@@ -519,6 +521,24 @@ static void blend_image(AVFilterContext *ctx,
     }
 }
 
+typedef struct ThreadData {
+    AVFrame *dst;
+    const AVFrame *src;
+} ThreadData;
+
+static int blend_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    OverlayContext *s = ctx->priv;
+    ThreadData *td = arg;
+    int h = td->src->height;
+    int slice_start = FFMIN(FFALIGN(h *  jobnr      / nb_jobs, 1 << s->vsub), h);
+    int slice_end   = FFMIN(FFALIGN(h * (jobnr + 1) / nb_jobs, 1 << s->vsub), h);
+
+    if (slice_start < slice_end)
+        blend_image(ctx, td->dst, td->src, s->x, s->y, slice_start, slice_end);
+    return 0;
+}
+
 static AVFrame *do_blend(AVFilterContext *ctx, AVFrame *mainpic,
                          const AVFrame *second)
 {
@@ -541,7 +561,16 @@ static AVFrame *do_blend(AVFilterContext *ctx, AVFrame *mainpic,
                    s->var_values[VAR_Y], s->y);
         }
 
-    blend_image(ctx, mainpic, second, s->x, s->y);
+    {
+        ThreadData td = { .dst = mainpic, .src = second };
+        int nb_jobs = 1;
+
+        /* the chroma blend of a yuva main reads the next main rows */
+        if (ctx->thread_type & AVFILTER_THREAD_SLICE &&
+            (s->main_is_packed_rgb || !s->main_has_alpha))
+            nb_jobs = FFMIN(second->height >> s->vsub, ctx->graph->nb_threads);
+        ctx->internal->execute(ctx, blend_slice, &td, NULL, FFMAX(nb_jobs, 1));
+    }
     return mainpic;
 }
 
@@ -640,5 +669,6 @@ AVFilter avfilter_vf_overlay = {
 
     .inputs    = avfilter_vf_overlay_inputs,
     .outputs   = avfilter_vf_overlay_outputs,
-    .flags     = AVFILTER_FLAG_SUPPORT_TIMELINE_INTERNAL,
+    .flags     = AVFILTER_FLAG_SUPPORT_TIMELINE_INTERNAL |
+                 AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -25,7 +25,9 @@
  */
 
 #include "libavutil/avassert.h"
+#include "libavutil/imgutils.h"
 #include "libavutil/opt.h"
+#include "libavutil/pixdesc.h"
 #include "internal.h"
 
 #include "libpostproc/postprocess.h"
@@ -36,8 +38,29 @@ typedef struct {
     int mode_id;
     pp_mode *modes[PP_QUALITY_MAX + 1];
     void *pp_ctx;
+    int hsub, vsub;
+
+    /* slice threading: each slice is postprocessed together with its
+     * surroundings by its own context into its own buffer, and only the
+     * slice itself is copied to the output */
+    int nb_slices;
+    void **slice_ctx;
+    uint8_t *(*slice_data)[4];
+    int (*slice_linesize)[4];
 } PPFilterContext;
 
+typedef struct ThreadData {
+    AVFrame *in, *out;
+    const int8_t *qp_table;
+    int qstride, pict_type;
+} ThreadData;
+
+/* lines postprocessed above and below each slice, a multiple of 16 so that
+ * the slices start on macroblock rows; enough for the spatial filters to see
+ * the same neighbourhood as when postprocessing the whole frame */
+#define SLICE_OVERLAP 64
+#define MIN_SLICE_HEIGHT 128
+
 #define OFFSET(x) offsetof(PPFilterContext, x)
 #define FLAGS AV_OPT_FLAG_FILTERING_PARAM|AV_OPT_FLAG_VIDEO_PARAM
 static const AVOption pp_options[] = {
@@ -73,6 +96,29 @@ static int pp_process_command(AVFilterContext *ctx, const char *cmd, const char
     return AVERROR(ENOSYS);
 }
 
+/**
+ * Return 1 if a subfilter with state depending on the whole picture, i.e.
+ * the temporal noise reducer or the automatic brightness correction, is
+ * enabled; postprocessing slices separately would change their output.
+ */
+static int needs_whole_frame(const char *subfilters)
+{
+    static const char *const names[] = { "tn", "tmpnoise", "al", "autolevels" };
+    const char *p = subfilters;
+    int i;
+
+    while (*p) {
+        size_t len  = strcspn(p, ",/");
+        size_t nlen = FFMIN(strcspn(p, ":|"), len);
+
+        for (i = 0; i < FF_ARRAY_ELEMS(names); i++)
+            if (nlen == strlen(names[i]) && !strncmp(p, names[i], nlen))
+                return 1;
+        p += len + !!p[len];
+    }
+    return 0;
+}
+
 static int pp_query_formats(AVFilterContext *ctx)
 {
     static const enum PixelFormat pix_fmts[] = {
@@ -89,7 +135,11 @@ static int pp_query_formats(AVFilterContext *ctx)
 static int pp_config_props(AVFilterLink *inlink)
 {
     int flags = PP_CPU_CAPS_AUTO;
-    PPFilterContext *pp = inlink->dst->priv;
+    AVFilterContext *ctx = inlink->dst;
+    PPFilterContext *pp = ctx->priv;
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(inlink->format);
+    const int aligned_w = FFALIGN(inlink->w, 8);
+    int i, ret;
 
     switch (inlink->format) {
     case AV_PIX_FMT_YUVJ420P:
@@ -102,9 +152,82 @@ static int pp_config_props(AVFilterLink *inlink)
     default: av_assert0(0);
     }
 
-    pp->pp_ctx = pp_get_context(inlink->w, inlink->h, flags);
-    if (!pp->pp_ctx)
+    pp->hsub = desc->log2_chroma_w;
+    pp->vsub = desc->log2_chroma_h;
+
+    pp->nb_slices = av_clip(FFMIN(ctx->graph->nb_threads, inlink->h / MIN_SLICE_HEIGHT), 1, 64);
+    if (needs_whole_frame(pp->subfilters))
+        pp->nb_slices = 1;
+    if (pp->nb_slices == 1) {
+        pp->pp_ctx = pp_get_context(inlink->w, inlink->h, flags);
+        if (!pp->pp_ctx)
+            return AVERROR(ENOMEM);
+        return 0;
+    }
+
+    pp->slice_ctx      = av_mallocz_array(pp->nb_slices, sizeof(*pp->slice_ctx));
+    pp->slice_data     = av_mallocz_array(pp->nb_slices, sizeof(*pp->slice_data));
+    pp->slice_linesize = av_mallocz_array(pp->nb_slices, sizeof(*pp->slice_linesize));
+    if (!pp->slice_ctx || !pp->slice_data || !pp->slice_linesize)
         return AVERROR(ENOMEM);
+    for (i = 0; i < pp->nb_slices; i++) {
+        int h = FFALIGN(inlink->h / pp->nb_slices + 16 + 2 * SLICE_OVERLAP, 8);
+
+        pp->slice_ctx[i] = pp_get_context(inlink->w, h, flags);
+        if (!pp->slice_ctx[i])
+            return AVERROR(ENOMEM);
+        ret = av_image_alloc(pp->slice_data[i], pp->slice_linesize[i],
+                             aligned_w, h, inlink->format, 16);
+        if (ret < 0)
+            return ret;
+    }
+    return 0;
+}
+
+static int slice_start(PPFilterContext *pp, int h, int jobnr)
+{
+    return jobnr == pp->nb_slices ? h : FFALIGN(h * jobnr / pp->nb_slices, 16);
+}
+
+static int pp_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    PPFilterContext *pp = ctx->priv;
+    ThreadData *td = arg;
+    AVFrame *in = td->in, *out = td->out;
+    const int h  = ctx->inputs[0]->h;
+    const int y0 = slice_start(pp, h, jobnr);
+    const int y1 = slice_start(pp, h, jobnr + 1);
+    const int top    = FFMAX(y0 - SLICE_OVERLAP, 0);
+    const int bottom = FFMIN(y1 + SLICE_OVERLAP, h);
+    const uint8_t *src[3];
+    int plane;
+
+    for (plane = 0; plane < 3; plane++) {
+        int vsub = plane ? pp->vsub : 0;
+        src[plane] = in->data[plane] + (top >> vsub) * in->linesize[plane];
+    }
+
+    pp_postprocess(src, in->linesize,
+                   pp->slice_data[jobnr], pp->slice_linesize[jobnr],
+                   FFALIGN(out->width, 8), bottom - top,
+                   td->qp_table ? td->qp_table + (top >> 4) * td->qstride : NULL,
+                   td->qstride,
+                   pp->modes[pp->mode_id],
+                   pp->slice_ctx[jobnr],
+                   td->pict_type);
+
+    for (plane = 0; plane < 3; plane++) {
+        int hsub = plane ? pp->hsub : 0;
+        int vsub = plane ? pp->vsub : 0;
+        int linesize = pp->slice_linesize[jobnr][plane];
+
+        av_image_copy_plane(out->data[plane] + (y0 >> vsub) * out->linesize[plane],
+                            out->linesize[plane],
+                            pp->slice_data[jobnr][plane] + ((y0 - top) >> vsub) * linesize,
+                            linesize,
+                            FF_CEIL_RSHIFT(FFALIGN(out->width, 8), hsub),
+                            FF_CEIL_RSHIFT(y1, vsub) - (y0 >> vsub));
+    }
     return 0;
 }
 
@@ -129,14 +252,25 @@ static int pp_filter_frame(AVFilterLink *inlink, AVFrame *inbuf)
     outbuf->height = inbuf->height;
     qp_table = av_frame_get_qp_table(inbuf, &qstride, &qp_type);
 
-    pp_postprocess((const uint8_t **)inbuf->data, inbuf->linesize,
-                   outbuf->data,                 outbuf->linesize,
-                   aligned_w, outlink->h,
-                   qp_table,
-                   qstride,
-                   pp->modes[pp->mode_id],
-                   pp->pp_ctx,
-                   outbuf->pict_type | (qp_type ? PP_PICT_TYPE_QP2 : 0));
+    if (pp->nb_slices > 1) {
+        ThreadData td = {
+            .in        = inbuf,
+            .out       = outbuf,
+            .qp_table  = qp_table,
+            .qstride   = qstride,
+            .pict_type = outbuf->pict_type | (qp_type ? PP_PICT_TYPE_QP2 : 0),
+        };
+        ctx->internal->execute(ctx, pp_slice, &td, NULL, pp->nb_slices);
+    } else {
+        pp_postprocess((const uint8_t **)inbuf->data, inbuf->linesize,
+                       outbuf->data,                 outbuf->linesize,
+                       aligned_w, outlink->h,
+                       qp_table,
+                       qstride,
+                       pp->modes[pp->mode_id],
+                       pp->pp_ctx,
+                       outbuf->pict_type | (qp_type ? PP_PICT_TYPE_QP2 : 0));
+    }
 
     av_frame_free(&inbuf);
     return ff_filter_frame(outlink, outbuf);
@@ -151,6 +285,15 @@ static av_cold void pp_uninit(AVFilterContext *ctx)
         pp_free_mode(pp->modes[i]);
     if (pp->pp_ctx)
         pp_free_context(pp->pp_ctx);
+    for (i = 0; i < pp->nb_slices && pp->slice_ctx; i++) {
+        if (pp->slice_ctx[i])
+            pp_free_context(pp->slice_ctx[i]);
+        if (pp->slice_data)
+            av_freep(&pp->slice_data[i][0]);
+    }
+    av_freep(&pp->slice_ctx);
+    av_freep(&pp->slice_data);
+    av_freep(&pp->slice_linesize);
 }
 
 static const AVFilterPad pp_inputs[] = {
@@ -182,5 +325,5 @@ AVFilter avfilter_vf_pp = {
     .outputs         = pp_outputs,
     .process_command = pp_process_command,
     .priv_class      = &pp_class,
-    .flags           = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC,
+    .flags           = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC | AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -34,6 +34,7 @@
 #include "avfilter.h"
 #include "drawutils.h"
 #include "internal.h"
+#include "transpose.h"
 #include "video.h"
 
 static const char *var_names[] = {
@@ -73,6 +74,7 @@ typedef struct {
     int use_bilinear;
     uint8_t *line[4];
     int linestep[4];
+    ff_transpose_block_fn transpose_block[4];
     float sinx, cosx;
     double var_values[VAR_VARS_NB];
 } RotContext;
@@ -180,7 +182,7 @@ static int config_props(AVFilterLink *outlink)
     AVFilterLink *inlink = ctx->inputs[0];
     const AVPixFmtDescriptor *pixdesc = av_pix_fmt_desc_get(inlink->format);
     uint8_t rgba_color[4];
-    int is_packed_rgba, ret;
+    int is_packed_rgba, ret, i;
     double res;
     char *expr;
 
@@ -240,6 +242,8 @@ static int config_props(AVFilterLink *outlink)
     memcpy(rgba_color, rot->fillcolor, sizeof(rgba_color));
     ff_fill_line_with_color(rot->line, rot->linestep, outlink->w, rot->fillcolor,
                             outlink->format, rgba_color, &is_packed_rgba, NULL);
+    for (i = 0; i < rot->nb_planes; i++)
+        rot->transpose_block[i] = ff_transpose_get_block_fn(rot->linestep[i]);
     av_log(ctx, AV_LOG_INFO,
            "w:%d h:%d -> w:%d h:%d bgcolor:0x%02X%02X%02X%02X[%s]\n",
            inlink->w, inlink->h, outlink->w, outlink->h,
@@ -305,6 +309,38 @@ static uint8_t *interpolate_bilinear(uint8_t *dst_color,
     return dst_color;
 }
 
+/**
+ * Rotate by a quarter turn, clockwise if clockwise is set, with the input
+ * dimensions swapped in the output: this is a transposition, with a flip.
+ */
+static void rotate_quarter(RotContext *rot, AVFrame *out, AVFrame *in,
+                           int clockwise)
+{
+    int plane;
+
+    for (plane = 0; plane < rot->nb_planes; plane++) {
+        int hsub = plane == 1 || plane == 2 ? rot->hsub : 0;
+        int vsub = plane == 1 || plane == 2 ? rot->vsub : 0;
+        int inh  = FF_CEIL_RSHIFT(in->height,  vsub);
+        int outw = FF_CEIL_RSHIFT(out->width,  hsub);
+        int outh = FF_CEIL_RSHIFT(out->height, vsub);
+        uint8_t *dst = out->data[plane];
+        uint8_t *src = in->data[plane];
+        int dst_linesize = out->linesize[plane];
+        int src_linesize = in->linesize[plane];
+
+        if (clockwise) {
+            src += src_linesize * (inh - 1);
+            src_linesize = -src_linesize;
+        } else {
+            dst += dst_linesize * (outh - 1);
+            dst_linesize = -dst_linesize;
+        }
+        ff_transpose_plane(rot->transpose_block[plane], rot->linestep[plane],
+                           dst, dst_linesize, src, src_linesize, outw, 0, outh);
+    }
+}
+
 #define TS2T(ts, tb) ((ts) == AV_NOPTS_VALUE ? NAN : (double)(ts)*av_q2d(tb))
 
 static int filter_frame(AVFilterLink *inlink, AVFrame *in)
@@ -313,7 +349,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
     AVFilterLink *outlink = ctx->outputs[0];
     AVFrame *out;
     RotContext *rot = ctx->priv;
-    int angle_int, s, c, plane;
+    int angle_int, s, c, plane, quarter;
     double res;
 
     out = ff_get_video_buffer(outlink, outlink->w, outlink->h);
@@ -330,6 +366,16 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
     av_log(ctx, AV_LOG_DEBUG, "n:%f time:%f angle:%f/PI\n",
            rot->var_values[VAR_N], rot->var_values[VAR_T], rot->angle/M_PI);
 
+    /* the generic code below only approximates the sine, handle quarter
+       turns exactly when the output is the input on its side */
+    quarter = lrint(res / (M_PI / 2));
+    if ((quarter & 1) && fabs(res - quarter * M_PI / 2) < 1e-6 &&
+        outlink->w == inlink->h && outlink->h == inlink->w) {
+        rotate_quarter(rot, out, in, (quarter & 3) == 1);
+        av_frame_free(&in);
+        return ff_filter_frame(outlink, out);
+    }
+
     angle_int = res * FIXP;
     s = int_sin(angle_int);
     c = int_sin(angle_int + INT_PI/2);
@@ -29,6 +29,7 @@
 #include "avfilter.h"
 #include "formats.h"
 #include "internal.h"
+#include "scale_opencl.h"
 #include "video.h"
 #include "libavutil/avstring.h"
 #include "libavutil/eval.h"
@@ -71,6 +72,9 @@ typedef struct {
     const AVClass *class;
     struct SwsContext *sws;     ///< software scaler context
     struct SwsContext *isws[2]; ///< software scaler context for interlaced material
+    struct SwsContext **slice_sws; ///< scaler contexts of the other slice threads
+    int nb_slices;              ///< number of slices scaled in parallel
+    int slice_align;            ///< vertical alignment of the slice edges
 
     /**
      * New dimensions. Special values are:
@@ -90,6 +94,9 @@ typedef struct {
     char *w_expr;               ///< width  expression string
     char *h_expr;               ///< height expression string
     char *flags_str;
+
+    int opencl;
+    ScaleOpenclContext *opencl_ctx; ///< set if the frames are scaled with OpenCL
 } ScaleContext;
 
 static av_cold int init(AVFilterContext *ctx)
@@ -137,12 +144,30 @@ static av_cold int init(AVFilterContext *ctx)
             return ret;
     }
 
+    if (!CONFIG_OPENCL && scale->opencl) {
+        av_log(ctx, AV_LOG_ERROR, "OpenCL support was not enabled in this build, cannot be selected\n");
+        return AVERROR(EINVAL);
+    }
+
     return 0;
 }
 
+static void free_slice_contexts(ScaleContext *scale)
+{
+    int i;
+
+    for (i = 0; i < scale->nb_slices - 1; i++)
+        sws_freeContext(scale->slice_sws[i]);
+    av_freep(&scale->slice_sws);
+    scale->nb_slices = 0;
+}
+
 static av_cold void uninit(AVFilterContext *ctx)
 {
     ScaleContext *scale = ctx->priv;
+    if (CONFIG_OPENCL)
+        ff_opencl_scale_uninit(&scale->opencl_ctx);
+    free_slice_contexts(scale);
     sws_freeContext(scale->sws);
     sws_freeContext(scale->isws[0]);
     sws_freeContext(scale->isws[1]);
@@ -258,6 +283,7 @@ static int config_props(AVFilterLink *outlink)
     scale->output_is_pal = av_pix_fmt_desc_get(outfmt)->flags & AV_PIX_FMT_FLAG_PAL ||
                            av_pix_fmt_desc_get(outfmt)->flags & AV_PIX_FMT_FLAG_PSEUDOPAL;
 
+    free_slice_contexts(scale);
     if (scale->sws)
         sws_freeContext(scale->sws);
     if (inlink->w == outlink->w && inlink->h == outlink->h &&
@@ -279,6 +305,45 @@ static int config_props(AVFilterLink *outlink)
                                         scale->flags, NULL, NULL, NULL);
         if (!scale->sws || !scale->isws[0] || !scale->isws[1])
             return AVERROR(EINVAL);
+
+        /* each slice thread needs its own context, the output is the same
+           as with a single one; error diffusion depends on the previous lines */
+        if (ctx->thread_type & AVFILTER_THREAD_SLICE &&
+            !(scale->flags & SWS_ERROR_DIFFUSION)) {
+            const AVPixFmtDescriptor *outdesc = av_pix_fmt_desc_get(outfmt);
+            int i, nb_slices;
+
+            scale->slice_align = 1 << FFMAX(desc->log2_chroma_h, outdesc->log2_chroma_h);
+            nb_slices = FFMIN(ctx->graph->nb_threads, outlink->h / scale->slice_align);
+            if (nb_slices > 1) {
+                scale->slice_sws = av_mallocz((nb_slices - 1) * sizeof(*scale->slice_sws));
+                if (!scale->slice_sws)
+                    return AVERROR(ENOMEM);
+                scale->nb_slices = nb_slices;
+                for (i = 0; i < nb_slices - 1; i++) {
+                    scale->slice_sws[i] = sws_getContext(inlink ->w, inlink ->h, inlink ->format,
+                                                         outlink->w, outlink->h, outfmt,
+                                                         scale->flags, NULL, NULL, NULL);
+                    if (!scale->slice_sws[i])
+                        return AVERROR(EINVAL);
+                }
+            }
+        }
+    }
+
+    if (CONFIG_OPENCL) {
+        ff_opencl_scale_uninit(&scale->opencl_ctx);
+        if (scale->opencl && scale->sws && !scale->interlaced &&
+            inlink->format == outlink->format) {
+            ret = ff_opencl_scale_init(ctx, &scale->opencl_ctx, desc,
+                                       inlink->w, inlink->h, outlink->w, outlink->h,
+                                       scale->flags);
+            if (ret == AVERROR(ENOSYS))
+                av_log(ctx, AV_LOG_WARNING, "OpenCL does not support this format or "
+                       "these flags, falling back to libswscale\n");
+            else if (ret < 0)
+                return ret;
+        }
     }
 
     if (inlink->sample_aspect_ratio.num){
@@ -326,6 +391,25 @@ static int scale_slice(AVFilterLink *link, AVFrame *out_buf, AVFrame *cur_pic, s
                          out,out_stride);
 }
 
+typedef struct ThreadData {
+    AVFrame *in, *out;
+} ThreadData;
+
+static int scale_slice_job(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    ScaleContext *scale = ctx->priv;
+    ThreadData *td = arg;
+    struct SwsContext *sws = jobnr ? scale->slice_sws[jobnr - 1] : scale->sws;
+    int h     = ctx->outputs[0]->h;
+    int start = FFMIN(FFALIGN(h *  jobnr      / nb_jobs, scale->slice_align), h);
+    int end   = FFMIN(FFALIGN(h * (jobnr + 1) / nb_jobs, scale->slice_align), h);
+
+    if (start < end)
+        sws_scale_dst_slice(sws, (const uint8_t *const *)td->in->data, td->in->linesize,
+                            td->out->data, td->out->linesize, start, end - start);
+    return 0;
+}
+
 static int filter_frame(AVFilterLink *link, AVFrame *in)
 {
     ScaleContext *scale = link->dst->priv;
@@ -375,9 +459,19 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
               (int64_t)in->sample_aspect_ratio.den * outlink->w * link->h,
               INT_MAX);
 
-    if(scale->interlaced>0 || (scale->interlaced<0 && in->interlaced_frame)){
+    if (CONFIG_OPENCL && scale->opencl_ctx) {
+        int ret = ff_opencl_scale(link->dst, scale->opencl_ctx, in, out);
+        if (ret < 0) {
+            av_frame_free(&in);
+            av_frame_free(&out);
+            return ret;
+        }
+    }else if(scale->interlaced>0 || (scale->interlaced<0 && in->interlaced_frame)){
         scale_slice(link, out, in, scale->isws[0], 0, (link->h+1)/2, 2, 0);
         scale_slice(link, out, in, scale->isws[1], 0,  link->h   /2, 2, 1);
+    }else if (scale->nb_slices > 1) {
+        ThreadData td = { .in = in, .out = out };
+        link->dst->internal->execute(link->dst, scale_slice_job, &td, NULL, scale->nb_slices);
     }else{
         scale_slice(link, out, in, scale->sws, 0, link->h, 1, 0);
     }
@@ -398,6 +492,7 @@ static const AVOption scale_options[] = {
     { "interl", "set interlacing", OFFSET(interlaced), AV_OPT_TYPE_INT, {.i64 = 0 }, -1, 1, FLAGS },
     { "size",   "set video size",          OFFSET(size_str), AV_OPT_TYPE_STRING, {.str = NULL}, 0, FLAGS },
     { "s",      "set video size",          OFFSET(size_str), AV_OPT_TYPE_STRING, {.str = NULL}, 0, FLAGS },
+    { "opencl", "use OpenCL filtering capabilities", OFFSET(opencl), AV_OPT_TYPE_INT, {.i64 = 0 }, 0, 1, FLAGS },
     { NULL },
 };
 
@@ -435,4 +530,5 @@ AVFilter avfilter_vf_scale = {
 
     .inputs    = avfilter_vf_scale_inputs,
     .outputs   = avfilter_vf_scale_outputs,
+    .flags     = AVFILTER_FLAG_SLICE_THREADS,
 };
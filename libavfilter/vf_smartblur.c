@@ -25,6 +25,7 @@
  * Ported from MPlayer libmpcodecs/vf_smartblur.c by Michael Niedermayer.
  */
 
+#include "libavutil/mem.h"
 #include "libavutil/opt.h"
 #include "libavutil/pixdesc.h"
 #include "libswscale/swscale.h"
@@ -47,7 +48,8 @@ typedef struct {
     float              strength;
     int                threshold;
     float              quality;
-    struct SwsContext *filter_context;
+    struct SwsContext **filter_context; ///< one blur context per slice thread
+    int                nb_contexts;
 } FilterParam;
 
 typedef struct {
@@ -57,6 +59,7 @@ typedef struct {
     int          hsub;
     int          vsub;
     unsigned int sws_flags;
+    int          nb_slices;
 } SmartblurContext;
 
 #define OFFSET(x) offsetof(SmartblurContext, x)
@@ -106,12 +109,22 @@ static av_cold int init(AVFilterContext *ctx)
     return 0;
 }
 
+static void free_sws_contexts(FilterParam *f)
+{
+    int i;
+
+    for (i = 0; i < f->nb_contexts; i++)
+        sws_freeContext(f->filter_context[i]);
+    av_freep(&f->filter_context);
+    f->nb_contexts = 0;
+}
+
 static av_cold void uninit(AVFilterContext *ctx)
 {
     SmartblurContext *sblur = ctx->priv;
 
-    sws_freeContext(sblur->luma.filter_context);
-    sws_freeContext(sblur->chroma.filter_context);
+    free_sws_contexts(&sblur->luma);
+    free_sws_contexts(&sblur->chroma);
 }
 
 static int query_formats(AVFilterContext *ctx)
@@ -129,10 +142,18 @@ static int query_formats(AVFilterContext *ctx)
     return 0;
 }
 
-static int alloc_sws_context(FilterParam *f, int width, int height, unsigned int flags)
+static int alloc_sws_context(FilterParam *f, int width, int height, unsigned int flags,
+                             int nb_contexts)
 {
     SwsVector *vec;
     SwsFilter sws_filter;
+    int i;
+
+    free_sws_contexts(f);
+    f->filter_context = av_mallocz_array(nb_contexts, sizeof(*f->filter_context));
+    if (!f->filter_context)
+        return AVERROR(ENOMEM);
+    f->nb_contexts = nb_contexts;
 
     vec = sws_getGaussianVec(f->radius, f->quality);
 
@@ -143,14 +164,20 @@ static int alloc_sws_context(FilterParam *f, int width, int height, unsigned int
     vec->coeff[vec->length / 2] += 1.0 - f->strength;
     sws_filter.lumH = sws_filter.lumV = vec;
     sws_filter.chrH = sws_filter.chrV = NULL;
-    f->filter_context = sws_getCachedContext(NULL,
-                                             width, height, AV_PIX_FMT_GRAY8,
-                                             width, height, AV_PIX_FMT_GRAY8,
-                                             flags, &sws_filter, NULL, NULL);
+    /* the slice threads output different lines of the same image, so each
+     * of them needs its own context */
+    for (i = 0; i < nb_contexts; i++) {
+        f->filter_context[i] = sws_getCachedContext(NULL,
+                                                    width, height, AV_PIX_FMT_GRAY8,
+                                                    width, height, AV_PIX_FMT_GRAY8,
+                                                    flags, &sws_filter, NULL, NULL);
+        if (!f->filter_context[i])
+            break;
+    }
 
     sws_freeVec(vec);
 
-    if (!f->filter_context)
+    if (i < nb_contexts)
         return AVERROR(EINVAL);
 
     return 0;
@@ -158,25 +185,34 @@ static int alloc_sws_context(FilterParam *f, int width, int height, unsigned int
 
 static int config_props(AVFilterLink *inlink)
 {
-    SmartblurContext *sblur = inlink->dst->priv;
+    AVFilterContext *ctx = inlink->dst;
+    SmartblurContext *sblur = ctx->priv;
     const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(inlink->format);
+    int ret;
 
     sblur->hsub = desc->log2_chroma_w;
     sblur->vsub = desc->log2_chroma_h;
-
-    alloc_sws_context(&sblur->luma, inlink->w, inlink->h, sblur->sws_flags);
-    alloc_sws_context(&sblur->chroma,
-                      FF_CEIL_RSHIFT(inlink->w, sblur->hsub),
-                      FF_CEIL_RSHIFT(inlink->h, sblur->vsub),
-                      sblur->sws_flags);
+    sblur->nb_slices = FFMIN(ctx->graph->nb_threads,
+                             FF_CEIL_RSHIFT(inlink->h, sblur->vsub));
+
+    ret = alloc_sws_context(&sblur->luma, inlink->w, inlink->h,
+                            sblur->sws_flags, sblur->nb_slices);
+    if (ret < 0)
+        return ret;
+    ret = alloc_sws_context(&sblur->chroma,
+                            FF_CEIL_RSHIFT(inlink->w, sblur->hsub),
+                            FF_CEIL_RSHIFT(inlink->h, sblur->vsub),
+                            sblur->sws_flags, sblur->nb_slices);
+    if (ret < 0)
+        return ret;
 
     return 0;
 }
 
 static void blur(uint8_t       *dst, const int dst_linesize,
                  const uint8_t *src, const int src_linesize,
-                 const int w, const int h, const int threshold,
-                 struct SwsContext *filter_context)
+                 const int w, const int slice_start, const int slice_end,
+                 const int threshold, struct SwsContext *filter_context)
 {
     int x, y;
     int orig, filtered;
@@ -187,11 +223,15 @@ static void blur(uint8_t       *dst, const int dst_linesize,
     int src_linesize_array[4] = {src_linesize};
     int dst_linesize_array[4] = {dst_linesize};
 
-    sws_scale(filter_context, src_array, src_linesize_array,
-              0, h, dst_array, dst_linesize_array);
+    if (slice_end <= slice_start)
+        return;
+
+    sws_scale_dst_slice(filter_context, src_array, src_linesize_array,
+                        dst_array, dst_linesize_array,
+                        slice_start, slice_end - slice_start);
 
     if (threshold > 0) {
-        for (y = 0; y < h; ++y) {
+        for (y = slice_start; y < slice_end; ++y) {
             for (x = 0; x < w; ++x) {
                 orig     = src[x + y * src_linesize];
                 filtered = dst[x + y * dst_linesize];
@@ -213,7 +253,7 @@ static void blur(uint8_t       *dst, const int dst_linesize,
             }
         }
     } else if (threshold < 0) {
-        for (y = 0; y < h; ++y) {
+        for (y = slice_start; y < slice_end; ++y) {
             for (x = 0; x < w; ++x) {
                 orig     = src[x + y * src_linesize];
                 filtered = dst[x + y * dst_linesize];
@@ -237,37 +277,59 @@ static void blur(uint8_t       *dst, const int dst_linesize,
     }
 }
 
-static int filter_frame(AVFilterLink *inlink, AVFrame *inpic)
+typedef struct ThreadData {
+    AVFrame *in, *out;
+} ThreadData;
+
+static int blur_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    SmartblurContext  *sblur  = inlink->dst->priv;
-    AVFilterLink *outlink     = inlink->dst->outputs[0];
-    AVFrame *outpic;
+    SmartblurContext *sblur = ctx->priv;
+    AVFilterLink *inlink = ctx->inputs[0];
+    const ThreadData *td = arg;
+    AVFrame *inpic  = td->in;
+    AVFrame *outpic = td->out;
     int cw = FF_CEIL_RSHIFT(inlink->w, sblur->hsub);
     int ch = FF_CEIL_RSHIFT(inlink->h, sblur->vsub);
 
-    outpic = ff_get_video_buffer(outlink, outlink->w, outlink->h);
-    if (!outpic) {
-        av_frame_free(&inpic);
-        return AVERROR(ENOMEM);
-    }
-    av_frame_copy_props(outpic, inpic);
-
     blur(outpic->data[0], outpic->linesize[0],
          inpic->data[0],  inpic->linesize[0],
-         inlink->w, inlink->h, sblur->luma.threshold,
-         sblur->luma.filter_context);
+         inlink->w, (inlink->h *  jobnr   ) / nb_jobs,
+                    (inlink->h * (jobnr+1)) / nb_jobs,
+         sblur->luma.threshold, sblur->luma.filter_context[jobnr]);
 
     if (inpic->data[2]) {
         blur(outpic->data[1], outpic->linesize[1],
              inpic->data[1],  inpic->linesize[1],
-             cw, ch, sblur->chroma.threshold,
-             sblur->chroma.filter_context);
+             cw, (ch * jobnr) / nb_jobs, (ch * (jobnr+1)) / nb_jobs,
+             sblur->chroma.threshold, sblur->chroma.filter_context[jobnr]);
         blur(outpic->data[2], outpic->linesize[2],
              inpic->data[2],  inpic->linesize[2],
-             cw, ch, sblur->chroma.threshold,
-             sblur->chroma.filter_context);
+             cw, (ch * jobnr) / nb_jobs, (ch * (jobnr+1)) / nb_jobs,
+             sblur->chroma.threshold, sblur->chroma.filter_context[jobnr]);
     }
 
+    return 0;
+}
+
+static int filter_frame(AVFilterLink *inlink, AVFrame *inpic)
+{
+    AVFilterContext *ctx      = inlink->dst;
+    SmartblurContext  *sblur  = ctx->priv;
+    AVFilterLink *outlink     = ctx->outputs[0];
+    AVFrame *outpic;
+    ThreadData td;
+
+    outpic = ff_get_video_buffer(outlink, outlink->w, outlink->h);
+    if (!outpic) {
+        av_frame_free(&inpic);
+        return AVERROR(ENOMEM);
+    }
+    av_frame_copy_props(outpic, inpic);
+
+    td.in  = inpic;
+    td.out = outpic;
+    ctx->internal->execute(ctx, blur_slice, &td, NULL, sblur->nb_slices);
+
     av_frame_free(&inpic);
     return ff_filter_frame(outlink, outpic);
 }
@@ -302,5 +364,5 @@ AVFilter avfilter_vf_smartblur = {
     .inputs        = smartblur_inputs,
     .outputs       = smartblur_outputs,
     .priv_class    = &smartblur_class,
-    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC,
+    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC | AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -55,6 +55,8 @@ typedef struct {
     int     pix_step[4];       ///< steps per pixel for each plane of the main output
     int original_w, original_h;
     FFDrawContext draw;
+    FFDrawLayer layer;         ///< images of the last rendered frame, blended together
+    int layer_valid;           ///< the layer can be reused if libass reports no change
 } AssContext;
 
 #define OFFSET(x) offsetof(AssContext, x)
@@ -115,6 +117,7 @@ static av_cold void uninit(AVFilterContext *ctx)
 {
     AssContext *ass = ctx->priv;
 
+    ff_draw_layer_free(&ass->layer);
     if (ass->track)
         ass_free_track(ass->track);
     if (ass->renderer)
@@ -134,6 +137,7 @@ static int config_input(AVFilterLink *inlink)
     AssContext *ass = inlink->dst->priv;
 
     ff_draw_init(&ass->draw, inlink->format, 0);
+    ass->layer_valid = 0;
 
     ass_set_frame_size  (ass->renderer, inlink->w, inlink->h);
     if (ass->original_w && ass->original_h)
@@ -149,19 +153,39 @@ static int config_input(AVFilterLink *inlink)
 #define AB(c)  (((c)>>8) &0xFF)
 #define AA(c)  ((0xFF-c) &0xFF)
 
-static void overlay_ass_image(AssContext *ass, AVFrame *picref,
-                              const ASS_Image *image)
+/**
+ * Blend all the images of a frame on the layer, which is resized to their
+ * bounding box.
+ */
+static int render_ass_layer(AssContext *ass, AVFilterLink *inlink,
+                            const ASS_Image *images)
 {
-    for (; image; image = image->next) {
+    const ASS_Image *image;
+    int x0 = INT_MAX, y0 = INT_MAX, x1 = INT_MIN, y1 = INT_MIN, ret;
+
+    for (image = images; image; image = image->next) {
+        x0 = FFMIN(x0, image->dst_x);
+        y0 = FFMIN(y0, image->dst_y);
+        x1 = FFMAX(x1, image->dst_x + image->w);
+        y1 = FFMAX(y1, image->dst_y + image->h);
+    }
+    if (!images) {
+        ff_draw_layer_free(&ass->layer);
+        return 0;
+    }
+    if ((ret = ff_draw_layer_init(&ass->draw, &ass->layer, inlink->w, inlink->h,
+                                  x0, y0, x1 - x0, y1 - y0)) < 0)
+        return ret;
+
+    for (image = images; image; image = image->next) {
         uint8_t rgba_color[] = {AR(image->color), AG(image->color), AB(image->color), AA(image->color)};
         FFDrawColor color;
         ff_draw_color(&ass->draw, &color, rgba_color);
-        ff_blend_mask(&ass->draw, &color,
-                      picref->data, picref->linesize,
-                      picref->width, picref->height,
-                      image->bitmap, image->stride, image->w, image->h,
-                      3, 0, image->dst_x, image->dst_y);
+        ff_draw_layer_blend_mask(&ass->draw, &ass->layer, &color,
+                                 image->bitmap, image->stride, image->w, image->h,
+                                 image->dst_x, image->dst_y);
     }
+    return 0;
 }
 
 static int filter_frame(AVFilterLink *inlink, AVFrame *picref)
@@ -173,11 +197,20 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *picref)
     double time_ms = picref->pts * av_q2d(inlink->time_base) * 1000;
     ASS_Image *image = ass_render_frame(ass->renderer, ass->track,
                                         time_ms, &detect_change);
+    int ret;
 
     if (detect_change)
         av_log(ctx, AV_LOG_DEBUG, "Change happened at time ms:%f\n", time_ms);
 
-    overlay_ass_image(ass, picref, image);
+    if (detect_change || !ass->layer_valid) {
+        ass->layer_valid = 0;
+        if ((ret = render_ass_layer(ass, inlink, image)) < 0) {
+            av_frame_free(&picref);
+            return ret;
+        }
+        ass->layer_valid = 1;
+    }
+    ff_draw_layer_apply(&ass->draw, &ass->layer, picref->data, picref->linesize);
 
     return ff_filter_frame(outlink, picref);
 }
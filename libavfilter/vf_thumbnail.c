@@ -42,6 +42,9 @@ typedef struct {
     const AVClass *class;
     int n;                      ///< current frame
     int n_frames;               ///< number of frames for analysis
+    int step;                   ///< histogram subsampling step, in pixels and lines
+    int keyframes;              ///< only consider key frames
+    int skipped;                ///< a frame was dropped by the last request
     struct thumb_frame *frames; ///< the n_frames frames
     AVRational tb;              ///< copy of the input timebase to ease access
 } ThumbContext;
@@ -51,6 +54,8 @@ typedef struct {
 
 static const AVOption thumbnail_options[] = {
     { "n", "set the frames batch size", OFFSET(n_frames), AV_OPT_TYPE_INT, {.i64=100}, 2, INT_MAX, FLAGS },
+    { "step", "set the subsampling step of the histograms", OFFSET(step), AV_OPT_TYPE_INT, {.i64=1}, 1, 64, FLAGS },
+    { "keyframes", "only consider key frames", OFFSET(keyframes), AV_OPT_TYPE_INT, {.i64=0}, 0, 1, FLAGS },
     { NULL }
 };
 
@@ -136,18 +141,25 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *frame)
     AVFilterLink *outlink = ctx->outputs[0];
     int *hist = thumb->frames[thumb->n].histogram;
     const uint8_t *p = frame->data[0];
+    const int step = thumb->step;
+
+    if (thumb->keyframes && !frame->key_frame) {
+        av_frame_free(&frame);
+        thumb->skipped = 1;
+        return 0;
+    }
 
     // keep a reference of each frame
     thumb->frames[thumb->n].buf = frame;
 
     // update current frame RGB histogram
-    for (j = 0; j < inlink->h; j++) {
-        for (i = 0; i < inlink->w; i++) {
-            hist[0*256 + p[i*3    ]]++;
-            hist[1*256 + p[i*3 + 1]]++;
-            hist[2*256 + p[i*3 + 2]]++;
+    for (j = 0; j < inlink->h; j += step) {
+        for (i = 0; i < inlink->w * 3; i += step * 3) {
+            hist[0*256 + p[i    ]]++;
+            hist[1*256 + p[i + 1]]++;
+            hist[2*256 + p[i + 2]]++;
         }
-        p += frame->linesize[0];
+        p += frame->linesize[0] * step;
     }
 
     // no selection until the buffer of N frames is filled up
@@ -175,7 +187,10 @@ static int request_frame(AVFilterLink *link)
     /* loop until a frame thumbnail is available (when a frame is queued,
      * thumb->n is reset to zero) */
     do {
-        int ret = ff_request_frame(ctx->inputs[0]);
+        int ret;
+
+        thumb->skipped = 0;
+        ret = ff_request_frame(ctx->inputs[0]);
         if (ret == AVERROR_EOF && thumb->n) {
             ret = ff_filter_frame(link, get_best_frame(ctx));
             if (ret < 0)
@@ -184,7 +199,7 @@ static int request_frame(AVFilterLink *link)
         }
         if (ret < 0)
             return ret;
-    } while (thumb->n);
+    } while (thumb->n || thumb->skipped);
     return 0;
 }
 
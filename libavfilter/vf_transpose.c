@@ -36,6 +36,7 @@
 #include "avfilter.h"
 #include "formats.h"
 #include "internal.h"
+#include "transpose.h"
 #include "video.h"
 
 typedef enum {
@@ -55,6 +56,7 @@ typedef struct {
     const AVClass *class;
     int hsub, vsub;
     int pixsteps[4];
+    ff_transpose_block_fn transpose_block[4];
 
     PassthroughType passthrough; ///< landscape passthrough mode enabled
     enum TransposeDir dir;
@@ -86,6 +88,7 @@ static int config_props_output(AVFilterLink *outlink)
     AVFilterLink *inlink = ctx->inputs[0];
     const AVPixFmtDescriptor *desc_out = av_pix_fmt_desc_get(outlink->format);
     const AVPixFmtDescriptor *desc_in  = av_pix_fmt_desc_get(inlink->format);
+    int i;
 
     if (trans->dir&4) {
         av_log(ctx, AV_LOG_WARNING,
@@ -108,6 +111,8 @@ static int config_props_output(AVFilterLink *outlink)
     trans->vsub = desc_in->log2_chroma_h;
 
     av_image_fill_max_pixsteps(trans->pixsteps, NULL, desc_out);
+    for (i = 0; i < 4; i++)
+        trans->transpose_block[i] = ff_transpose_get_block_fn(trans->pixsteps[i]);
 
     outlink->w = inlink->h;
     outlink->h = inlink->w;
@@ -133,41 +138,35 @@ static AVFrame *get_video_buffer(AVFilterLink *inlink, int w, int h)
         ff_default_get_video_buffer(inlink, w, h);
 }
 
-static int filter_frame(AVFilterLink *inlink, AVFrame *in)
+typedef struct ThreadData {
+    AVFrame *in, *out;
+} ThreadData;
+
+static int filter_slice(AVFilterContext *ctx, void *arg, int jobnr,
+                        int nb_jobs)
 {
-    TransContext *trans = inlink->dst->priv;
-    AVFilterLink *outlink = inlink->dst->outputs[0];
-    AVFrame *out;
+    TransContext *trans = ctx->priv;
+    ThreadData *td = arg;
+    AVFrame *out = td->out;
+    AVFrame *in = td->in;
     int plane;
 
-    if (trans->passthrough)
-        return ff_filter_frame(outlink, in);
-
-    out = ff_get_video_buffer(outlink, outlink->w, outlink->h);
-    if (!out) {
-        av_frame_free(&in);
-        return AVERROR(ENOMEM);
-    }
-
-    out->pts = in->pts;
-
-    if (in->sample_aspect_ratio.num == 0) {
-        out->sample_aspect_ratio = in->sample_aspect_ratio;
-    } else {
-        out->sample_aspect_ratio.num = in->sample_aspect_ratio.den;
-        out->sample_aspect_ratio.den = in->sample_aspect_ratio.num;
-    }
-
     for (plane = 0; out->data[plane]; plane++) {
         int hsub = plane == 1 || plane == 2 ? trans->hsub : 0;
         int vsub = plane == 1 || plane == 2 ? trans->vsub : 0;
         int pixstep = trans->pixsteps[plane];
-        int inh  = in->height  >> vsub;
+        int inh  = FF_CEIL_RSHIFT(in->height, vsub);
         int outw = FF_CEIL_RSHIFT(out->width,  hsub);
         int outh = FF_CEIL_RSHIFT(out->height, vsub);
+        int start = (outh *  jobnr   ) / nb_jobs & ~7;
+        int end   = (outh * (jobnr+1)) / nb_jobs & ~7;
         uint8_t *dst, *src;
         int dstlinesize, srclinesize;
-        int x, y;
+
+        if (!pixstep) /* palette of pseudo-paletted formats */
+            continue;
+        if (jobnr == nb_jobs - 1)
+            end = outh;
 
         dst = out->data[plane];
         dstlinesize = out->linesize[plane];
@@ -184,41 +183,43 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
             dstlinesize *= -1;
         }
 
-        for (y = 0; y < outh; y++) {
-            switch (pixstep) {
-            case 1:
-                for (x = 0; x < outw; x++)
-                    dst[x] = src[x*srclinesize + y];
-                break;
-            case 2:
-                for (x = 0; x < outw; x++)
-                    *((uint16_t *)(dst + 2*x)) = *((uint16_t *)(src + x*srclinesize + y*2));
-                break;
-            case 3:
-                for (x = 0; x < outw; x++) {
-                    int32_t v = AV_RB24(src + x*srclinesize + y*3);
-                    AV_WB24(dst + 3*x, v);
-                }
-                break;
-            case 4:
-                for (x = 0; x < outw; x++)
-                    *((uint32_t *)(dst + 4*x)) = *((uint32_t *)(src + x*srclinesize + y*4));
-                break;
-            case 6:
-                for (x = 0; x < outw; x++) {
-                    int64_t v = AV_RB48(src + x*srclinesize + y*6);
-                    AV_WB48(dst + 6*x, v);
-                }
-                break;
-            case 8:
-                for (x = 0; x < outw; x++)
-                    *((uint64_t *)(dst + 8*x)) = *((uint64_t *)(src + x*srclinesize + y*8));
-                break;
-            }
-            dst += dstlinesize;
-        }
+        ff_transpose_plane(trans->transpose_block[plane], pixstep,
+                           dst, dstlinesize, src, srclinesize,
+                           outw, start, end);
+    }
+
+    return 0;
+}
+
+static int filter_frame(AVFilterLink *inlink, AVFrame *in)
+{
+    AVFilterContext *ctx = inlink->dst;
+    TransContext *trans = ctx->priv;
+    AVFilterLink *outlink = ctx->outputs[0];
+    ThreadData td;
+    AVFrame *out;
+
+    if (trans->passthrough)
+        return ff_filter_frame(outlink, in);
+
+    out = ff_get_video_buffer(outlink, outlink->w, outlink->h);
+    if (!out) {
+        av_frame_free(&in);
+        return AVERROR(ENOMEM);
+    }
+
+    out->pts = in->pts;
+
+    if (in->sample_aspect_ratio.num == 0) {
+        out->sample_aspect_ratio = in->sample_aspect_ratio;
+    } else {
+        out->sample_aspect_ratio.num = in->sample_aspect_ratio.den;
+        out->sample_aspect_ratio.den = in->sample_aspect_ratio.num;
     }
 
+    td.in = in, td.out = out;
+    ctx->internal->execute(ctx, filter_slice, &td, NULL,
+                           FFMIN(FFMAX(outlink->h / 8, 1), ctx->graph->nb_threads));
     av_frame_free(&in);
     return ff_filter_frame(outlink, out);
 }
@@ -274,4 +275,5 @@ AVFilter avfilter_vf_transpose = {
 
     .inputs    = avfilter_vf_transpose_inputs,
     .outputs   = avfilter_vf_transpose_outputs,
+    .flags     = AVFILTER_FLAG_SLICE_THREADS,
 };
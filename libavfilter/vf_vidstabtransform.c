@@ -39,6 +39,7 @@ typedef struct {
     VSTransformations trans;    // transformations
     char *input;                // name of transform file
     int tripod;
+    int planar;                 // the transform can be done in slices
 } TransformContext;
 
 #define OFFSET(x) offsetof(TransformContext, x)
@@ -151,6 +152,8 @@ static int config_input(AVFilterLink *inlink)
         return AVERROR(EINVAL);
     }
 
+    tc->planar = !(desc->flags & AV_PIX_FMT_FLAG_RGB);
+
     // set values that are not initializes by the options
     tc->conf.modName = "vidstabtransform";
     tc->conf.verbose =1;
@@ -208,6 +211,50 @@ static int config_input(AVFilterLink *inlink)
     return 0;
 }
 
+/* Transform a horizontal slice of every plane with the interpolation
+ * function selected by libvidstab, using the same 16.16 fixed-point source
+ * coordinates as its own planar transform, so that the result does not
+ * depend on the number of slices. */
+static int transform_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    TransformContext *tc = ctx->priv;
+    VSTransformData *td = &tc->td;
+    const VSTransform *t = arg;
+    const VSFrameInfo *fi = vsTransformGetSrcFrameInfo(td);
+    double z = 1.0 - t->zoom / 100.0;
+    int32_t zcos_a = z * cos(-t->alpha) * 0xFFFF;
+    int32_t zsin_a = z * sin(-t->alpha) * 0xFFFF;
+    int plane, x, y;
+
+    for (plane = 0; plane < fi->planes; plane++) {
+        int wsub = plane == 1 || plane == 2 ? fi->log2ChromaW : 0;
+        int hsub = plane == 1 || plane == 2 ? fi->log2ChromaH : 0;
+        int w = FF_CEIL_RSHIFT(fi->width,  wsub);
+        int h = FF_CEIL_RSHIFT(fi->height, hsub);
+        int slice_start = (h *  jobnr   ) / nb_jobs;
+        int slice_end   = (h * (jobnr+1)) / nb_jobs;
+        const uint8_t *src = td->src.data[plane];
+        int src_linesize   = td->src.linesize[plane];
+        uint8_t black = plane == 1 || plane == 2 ? 0x80 : 0;
+        int32_t c_tx = ((w / 2) << 16) - ((int32_t)(t->x * 0xFFFF) >> wsub);
+        int32_t c_ty = ((h / 2) << 16) - ((int32_t)(t->y * 0xFFFF) >> hsub);
+
+        for (y = slice_start; y < slice_end; y++) {
+            uint8_t *dst = td->dest.data[plane] + y * td->dest.linesize[plane];
+            int32_t y_d1 = y - h / 2;
+
+            for (x = 0; x < w; x++) {
+                int32_t x_d1 = x - w / 2;
+                int32_t x_s  =  zcos_a * x_d1 + zsin_a * y_d1 + c_tx;
+                int32_t y_s  = -zsin_a * x_d1 + zcos_a * y_d1 + c_ty;
+
+                td->interpolate(&dst[x], x_s, y_s, src, src_linesize, w, h,
+                                tc->conf.crop ? black : dst[x]);
+            }
+        }
+    }
+    return 0;
+}
 
 static int filter_frame(AVFilterLink *inlink, AVFrame *in)
 {
@@ -219,6 +266,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
     int direct = 0;
     AVFrame *out;
     VSFrame inframe;
+    VSTransform t;
     int plane;
 
     if (av_frame_is_writable(in)) {
@@ -248,7 +296,12 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
         vsTransformPrepare(td, &inframe, &outframe);
     }
 
-    vsDoTransform(td, vsGetNextTransform(td, &tc->trans));
+    t = vsGetNextTransform(td, &tc->trans);
+    if (tc->planar && (t.x || t.y || t.alpha || t.zoom))
+        ctx->internal->execute(ctx, transform_slice, &t, NULL,
+                               FFMIN(outlink->h, ctx->graph->nb_threads));
+    else
+        vsDoTransform(td, t);
 
     vsTransformFinish(td);
 
@@ -289,4 +342,5 @@ AVFilter avfilter_vf_vidstabtransform = {
     .inputs        = avfilter_vf_vidstabtransform_inputs,
     .outputs       = avfilter_vf_vidstabtransform_outputs,
     .priv_class    = &vidstabtransform_class,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -27,6 +27,7 @@
 #include "internal.h"
 #include "video.h"
 #include "yadif.h"
+#include "yadif_opencl.h"
 
 #undef NDEBUG
 #include <assert.h>
@@ -111,9 +112,9 @@ static void filter_line_c(void *dst1,
     FILTER(0, w, 1)
 }
 
-#define MAX_ALIGN 8
 static void filter_edges(void *dst1, void *prev1, void *cur1, void *next1,
-                         int w, int prefs, int mrefs, int parity, int mode)
+                         int w, int prefs, int mrefs, int parity, int mode,
+                         int alignment)
 {
     uint8_t *dst  = dst1;
     uint8_t *prev = prev1;
@@ -122,23 +123,23 @@ static void filter_edges(void *dst1, void *prev1, void *cur1, void *next1,
     int x;
     uint8_t *prev2 = parity ? prev : cur ;
     uint8_t *next2 = parity ? cur  : next;
+    int edge = FFMAX(w - (alignment - 1), 3);
 
     /* Only edge pixels need to be processed here.  A constant value of false
      * for is_not_edge should let the compiler ignore the whole branch. */
     FILTER(0, 3, 0)
 
-    dst  = (uint8_t*)dst1  + w - (MAX_ALIGN-1);
-    prev = (uint8_t*)prev1 + w - (MAX_ALIGN-1);
-    cur  = (uint8_t*)cur1  + w - (MAX_ALIGN-1);
-    next = (uint8_t*)next1 + w - (MAX_ALIGN-1);
+    dst  = (uint8_t*)dst1  + edge;
+    prev = (uint8_t*)prev1 + edge;
+    cur  = (uint8_t*)cur1  + edge;
+    next = (uint8_t*)next1 + edge;
     prev2 = (uint8_t*)(parity ? prev : cur);
     next2 = (uint8_t*)(parity ? cur  : next);
 
-    FILTER(w - (MAX_ALIGN-1), w - 3, 1)
+    FILTER(edge, w - 3, 1)
     FILTER(w - 3, w, 0)
 }
 
-
 static void filter_line_c_16bit(void *dst1,
                                 void *prev1, void *cur1, void *next1,
                                 int w, int prefs, int mrefs, int parity,
@@ -158,7 +159,8 @@ static void filter_line_c_16bit(void *dst1,
 }
 
 static void filter_edges_16bit(void *dst1, void *prev1, void *cur1, void *next1,
-                               int w, int prefs, int mrefs, int parity, int mode)
+                               int w, int prefs, int mrefs, int parity, int mode,
+                               int alignment)
 {
     uint16_t *dst  = dst1;
     uint16_t *prev = prev1;
@@ -167,19 +169,20 @@ static void filter_edges_16bit(void *dst1, void *prev1, void *cur1, void *next1,
     int x;
     uint16_t *prev2 = parity ? prev : cur ;
     uint16_t *next2 = parity ? cur  : next;
+    int edge = FFMAX(w - (alignment / 2 - 1), 3);
     mrefs /= 2;
     prefs /= 2;
 
     FILTER(0, 3, 0)
 
-    dst   = (uint16_t*)dst1  + w - (MAX_ALIGN/2-1);
-    prev  = (uint16_t*)prev1 + w - (MAX_ALIGN/2-1);
-    cur   = (uint16_t*)cur1  + w - (MAX_ALIGN/2-1);
-    next  = (uint16_t*)next1 + w - (MAX_ALIGN/2-1);
+    dst   = (uint16_t*)dst1  + edge;
+    prev  = (uint16_t*)prev1 + edge;
+    cur   = (uint16_t*)cur1  + edge;
+    next  = (uint16_t*)next1 + edge;
     prev2 = (uint16_t*)(parity ? prev : cur);
     next2 = (uint16_t*)(parity ? cur  : next);
 
-    FILTER(w - (MAX_ALIGN/2-1), w - 3, 1)
+    FILTER(edge, w - 3, 1)
     FILTER(w - 3, w, 0)
 }
 
@@ -205,14 +208,14 @@ static int filter_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
             uint8_t *dst  = &td->frame->data[td->plane][y * td->frame->linesize[td->plane]];
             int     mode  = y == 1 || y + 2 == td->h ? 2 : s->mode;
             s->filter_line(dst + pix_3, prev + pix_3, cur + pix_3,
-                           next + pix_3, td->w - (3 + MAX_ALIGN/df-1),
+                           next + pix_3, td->w - (3 + s->req_align/df-1),
                            y + 1 < td->h ? refs : -refs,
                            y ? -refs : refs,
                            td->parity ^ td->tff, mode);
             s->filter_edges(dst, prev, cur, next, td->w,
                             y + 1 < td->h ? refs : -refs,
                             y ? -refs : refs,
-                            td->parity ^ td->tff, mode);
+                            td->parity ^ td->tff, mode, s->req_align);
         } else {
             memcpy(&td->frame->data[td->plane][y * td->frame->linesize[td->plane]],
                    &s->cur->data[td->plane][y * refs], td->w * df);
@@ -270,7 +273,14 @@ static int return_frame(AVFilterContext *ctx, int is_second)
         yadif->out->interlaced_frame = 0;
     }
 
-    filter(ctx, yadif->out, tff ^ !is_second, tff);
+    if (CONFIG_OPENCL && yadif->opencl) {
+        ret = ff_opencl_yadif_filter(ctx, yadif->out, tff ^ !is_second, tff);
+        if (ret < 0) {
+            av_frame_free(&yadif->out);
+            return ret;
+        }
+    } else
+        filter(ctx, yadif->out, tff ^ !is_second, tff);
 
     if (is_second) {
         int64_t cur_pts  = yadif->cur->pts;
@@ -304,6 +314,12 @@ static int filter_frame(AVFilterLink *link, AVFrame *frame)
     yadif->cur  = yadif->next;
     yadif->next = frame;
 
+    if (CONFIG_OPENCL && yadif->opencl) {
+        int ret = ff_opencl_yadif_push_frame(ctx, frame);
+        if (ret < 0)
+            return ret;
+    }
+
     if (!yadif->cur)
         return 0;
 
@@ -375,6 +391,9 @@ static av_cold void uninit(AVFilterContext *ctx)
 {
     YADIFContext *yadif = ctx->priv;
 
+    if (CONFIG_OPENCL && yadif->opencl)
+        ff_opencl_yadif_uninit(ctx);
+
     av_frame_free(&yadif->prev);
     av_frame_free(&yadif->cur );
     av_frame_free(&yadif->next);
@@ -447,10 +466,27 @@ static int config_props(AVFilterLink *link)
         s->filter_line  = filter_line_c;
         s->filter_edges = filter_edges;
     }
+    s->req_align = 8;
 
     if (ARCH_X86)
         ff_yadif_init_x86(s);
 
+    if (!CONFIG_OPENCL && s->opencl) {
+        av_log(ctx, AV_LOG_ERROR, "OpenCL support was not enabled in this build, cannot be selected\n");
+        return AVERROR(EINVAL);
+    }
+    if (CONFIG_OPENCL && s->opencl) {
+        if (s->csp->comp[0].depth_minus1 != 7) {
+            av_log(ctx, AV_LOG_WARNING, "OpenCL only supports 8-bit formats, "
+                   "falling back to the C code\n");
+            s->opencl = 0;
+        } else {
+            int ret = ff_opencl_yadif_init(ctx);
+            if (ret < 0)
+                return ret;
+        }
+    }
+
     return 0;
 }
 
@@ -476,6 +512,8 @@ static const AVOption yadif_options[] = {
     CONST("all",        "deinterlace all frames",                       YADIF_DEINT_ALL,         "deint"),
     CONST("interlaced", "only deinterlace frames marked as interlaced", YADIF_DEINT_INTERLACED,  "deint"),
 
+    { "opencl", "use OpenCL filtering capabilities", OFFSET(opencl), AV_OPT_TYPE_INT, {.i64=0}, 0, 1, FLAGS },
+
     {NULL},
 };
 
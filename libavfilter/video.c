@@ -29,6 +29,7 @@
 #include "libavutil/mem.h"
 
 #include "avfilter.h"
+#include "framepool.h"
 #include "internal.h"
 #include "video.h"
 
@@ -37,60 +38,39 @@ AVFrame *ff_null_get_video_buffer(AVFilterLink *link, int w, int h)
     return ff_get_video_buffer(link->dst->outputs[0], w, h);
 }
 
-/* TODO: set the buffer's priv member to a context structure for the whole
- * filter chain.  This will allow for a buffer pool instead of the constant
- * alloc & free cycle currently implemented. */
+#define BUFFER_ALIGN 32
+
 AVFrame *ff_default_get_video_buffer(AVFilterLink *link, int w, int h)
 {
-    AVFrame *frame = av_frame_alloc();
-    int ret;
-
-#if 0 //POOL
-    AVFilterPool *pool = link->pool;
-    if (pool) {
-        for (i = 0; i < POOL_SIZE; i++) {
-            picref = pool->pic[i];
-            if (picref && picref->buf->format == link->format && picref->buf->w == w && picref->buf->h == h) {
-                AVFilterBuffer *pic = picref->buf;
-                pool->pic[i] = NULL;
-                pool->count--;
-                av_assert0(!picref->video->qp_table);
-                picref->video->w = w;
-                picref->video->h = h;
-                picref->perms = full_perms;
-                picref->format = link->format;
-                pic->refcount = 1;
-                memcpy(picref->data,     pic->data,     sizeof(picref->data));
-                memcpy(picref->linesize, pic->linesize, sizeof(picref->linesize));
-                pool->refcount++;
-                return picref;
-            }
-        }
+    int pool_width = 0;
+    int pool_height = 0;
+    int pool_align = 0;
+    enum AVPixelFormat pool_format = AV_PIX_FMT_NONE;
+
+    if (!link->frame_pool) {
+        link->frame_pool = ff_frame_pool_video_init(av_buffer_alloc, w, h,
+                                                    link->format, BUFFER_ALIGN);
+        if (!link->frame_pool)
+            return NULL;
     } else {
-        pool = link->pool = av_mallocz(sizeof(AVFilterPool));
-        pool->refcount = 1;
-    }
-#endif
-    if (!frame)
-        return NULL;
-
-    frame->width  = w;
-    frame->height = h;
-    frame->format = link->format;
-
-    ret = av_frame_get_buffer(frame, 32);
-    if (ret < 0)
-        av_frame_free(&frame);
+        if (ff_frame_pool_get_video_config(link->frame_pool,
+                                           &pool_width, &pool_height,
+                                           &pool_format, &pool_align) < 0) {
+            return NULL;
+        }
 
-#if 0 //POOL
-    memset(data[0], 128, i);
+        if (pool_width != w || pool_height != h ||
+            pool_format != link->format || pool_align != BUFFER_ALIGN) {
 
-    picref->buf->priv = pool;
-    picref->buf->free = NULL;
-    pool->refcount++;
-#endif
+            ff_frame_pool_uninit((FFFramePool **)&link->frame_pool);
+            link->frame_pool = ff_frame_pool_video_init(av_buffer_alloc, w, h,
+                                                        link->format, BUFFER_ALIGN);
+            if (!link->frame_pool)
+                return NULL;
+        }
+    }
 
-    return frame;
+    return ff_frame_pool_get(link->frame_pool);
 }
 
 #if FF_API_AVFILTERBUFFER
@@ -147,11 +127,15 @@ AVFrame *ff_get_video_buffer(AVFilterLink *link, int w, int h)
     av_unused char buf[16];
     FF_TPRINTF_START(NULL, get_video_buffer); ff_tlog_link(NULL, link, 0);
 
-    if (link->dstpad->get_video_buffer)
+    /* the destination of a link crossing threads is running concurrently */
+    if (link->dstpad->get_video_buffer && !link->pipe)
         ret = link->dstpad->get_video_buffer(link, w, h);
 
     if (!ret)
         ret = ff_default_get_video_buffer(link, w, h);
 
+    if (ret)
+        ff_filter_stats_add_alloc(link->src, ret);
+
     return ret;
 }
@@ -43,4 +43,6 @@ AVFilter avfilter_vsink_nullsink = {
 
     .inputs    = avfilter_vsink_nullsink_inputs,
     .outputs   = NULL,
+
+    .flags     = AVFILTER_FLAG_SUPPORT_HWACCEL,
 };
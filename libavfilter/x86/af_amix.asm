@@ -0,0 +1,142 @@
+;*****************************************************************************
+;* x86-optimized functions for amix filter
+;*
+;* This file is part of FFmpeg.
+;*
+;* FFmpeg is free software; you can redistribute it and/or
+;* modify it under the terms of the GNU Lesser General Public
+;* License as published by the Free Software Foundation; either
+;* version 2.1 of the License, or (at your option) any later version.
+;*
+;* FFmpeg is distributed in the hope that it will be useful,
+;* but WITHOUT ANY WARRANTY; without even the implied warranty of
+;* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+;* Lesser General Public License for more details.
+;*
+;* You should have received a copy of the GNU Lesser General Public
+;* License along with FFmpeg; if not, write to the Free Software
+;* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+;******************************************************************************
+
+%include "libavutil/x86/x86util.asm"
+
+SECTION_TEXT
+
+%if ARCH_X86_64
+
+;------------------------------------------------------------------------------
+; void ff_amix_mix_float(uint8_t *dst, const uint8_t **src, const void *coefs,
+;                        int nb_in, int len, int shift)
+;------------------------------------------------------------------------------
+
+%macro AMIX_MIX_FLOAT 0
+cglobal amix_mix_float, 5,8,4, dst, src, coef, nb, len, i, j, ptr
+    movsxdifnidn nbq, nbd
+    movsxdifnidn lenq, lend
+    shl        lenq, 2
+    xor          iq, iq
+.loop:
+    ; dst[i] = src[0][i] * coefs[0] + src[1][i] * coefs[1] + ...
+    mov        ptrq, [srcq]
+    VBROADCASTSS m2, [coefq]
+    movu         m0, [ptrq+iq]
+    movu         m1, [ptrq+iq+mmsize]
+    mulps        m0, m2
+    mulps        m1, m2
+    mov          jq, 1
+    cmp          jq, nbq
+    jge .store
+.inner:
+    mov        ptrq, [srcq+jq*gprsize]
+    VBROADCASTSS m2, [coefq+jq*4]
+    movu         m3, [ptrq+iq]
+    mulps        m3, m2
+    addps        m0, m3
+    movu         m3, [ptrq+iq+mmsize]
+    mulps        m3, m2
+    addps        m1, m3
+    inc          jq
+    cmp          jq, nbq
+    jl .inner
+.store:
+    movu  [dstq+iq], m0
+    movu  [dstq+iq+mmsize], m1
+    add          iq, 2*mmsize
+    cmp          iq, lenq
+    jl .loop
+    RET
+%endmacro
+
+INIT_XMM sse
+AMIX_MIX_FLOAT
+%if HAVE_AVX_EXTERNAL
+INIT_YMM avx
+AMIX_MIX_FLOAT
+%endif
+
+;------------------------------------------------------------------------------
+; void ff_amix_mix_s16(uint8_t *dst, const uint8_t **src, const void *coefs,
+;                      int nb_in, int len, int shift)
+;------------------------------------------------------------------------------
+
+;------------------------------------------------------------------------------
+; void ff_amix_mix_s16(uint8_t *dst, const uint8_t **src, const void *coefs,
+;                      int nb_in, int len, int shift)
+;------------------------------------------------------------------------------
+
+%macro AMIX_MIX_S16 0
+cglobal amix_mix_s16, 6,10,8, dst, src, coef, nb, len, shift, i, j, ptr, ptr2
+    movsxdifnidn nbq, nbd
+    movsxdifnidn lenq, lend
+    shl        lenq, 1
+    movd        xm6, shiftd
+    dec      shiftd
+    movd        xm4, shiftd
+    pcmpeqd      m5, m5
+    psrld        m5, 31
+    pslld        m5, xm4
+    xor          iq, iq
+.loop:
+    ; dst[i] = av_clip_int16((src[0][i] * coefs[0] + src[1][i] * coefs[1] + ...
+    ;                        + (1 << (shift - 1))) >> shift)
+    mova         m0, m5
+    mova         m1, m5
+    xor          jq, jq
+.inner:
+    mov        ptrq, [srcq+jq*gprsize]
+    mov       ptr2q, [srcq+jq*gprsize+gprsize]
+%if cpuflag(avx2)
+    vpbroadcastd m2, [coefq+jq*2]
+%else
+    movd         m2, [coefq+jq*2]
+    pshufd       m2, m2, 0
+%endif
+    movu         m3, [ptrq+iq]
+    movu         m4, [ptr2q+iq]
+    punpckhwd    m7, m3, m4
+    punpcklwd    m3, m4
+    pmaddwd      m3, m2
+    pmaddwd      m7, m2
+    paddd        m0, m3
+    paddd        m1, m7
+    add          jq, 2
+    cmp          jq, nbq
+    jl .inner
+    psrad        m0, xm6
+    psrad        m1, xm6
+    packssdw     m0, m1
+    movu  [dstq+iq], m0
+    add          iq, mmsize
+    cmp          iq, lenq
+    jl .loop
+    RET
+%endmacro
+
+INIT_XMM sse2
+AMIX_MIX_S16
+%if HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+AMIX_MIX_S16
+%endif
+
+%endif ; ARCH_X86_64
@@ -0,0 +1,61 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h"
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/samplefmt.h"
+#include "libavutil/x86/cpu.h"
+#include "libavfilter/af_amix.h"
+
+void ff_amix_mix_float_sse(uint8_t *dst, const uint8_t **src, const void *coefs,
+                           int nb_in, int len, int shift);
+void ff_amix_mix_float_avx(uint8_t *dst, const uint8_t **src, const void *coefs,
+                           int nb_in, int len, int shift);
+
+void ff_amix_mix_s16_sse2(uint8_t *dst, const uint8_t **src, const void *coefs,
+                          int nb_in, int len, int shift);
+void ff_amix_mix_s16_avx2(uint8_t *dst, const uint8_t **src, const void *coefs,
+                          int nb_in, int len, int shift);
+
+av_cold void ff_amix_init_x86(AMixDSPContext *dsp, enum AVSampleFormat sample_fmt)
+{
+#if ARCH_X86_64
+    int mm_flags = av_get_cpu_flags();
+
+    if (sample_fmt == AV_SAMPLE_FMT_FLT) {
+        if (EXTERNAL_SSE(mm_flags)) {
+            dsp->mix           = ff_amix_mix_float_sse;
+            dsp->samples_align = 8;
+        }
+        if (EXTERNAL_AVX(mm_flags)) {
+            dsp->mix           = ff_amix_mix_float_avx;
+            dsp->samples_align = 16;
+        }
+    } else if (sample_fmt == AV_SAMPLE_FMT_S16) {
+        if (EXTERNAL_SSE2(mm_flags)) {
+            dsp->mix           = ff_amix_mix_s16_sse2;
+            dsp->samples_align = 8;
+        }
+        if (EXTERNAL_AVX2(mm_flags)) {
+            dsp->mix           = ff_amix_mix_s16_avx2;
+            dsp->samples_align = 16;
+        }
+    }
+#endif
+}
@@ -0,0 +1,181 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <float.h>
+
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/mem.h"
+#include "libavutil/x86/asm.h"
+#include "libavutil/x86/cpu.h"
+#include "libavfilter/af_atempo.h"
+
+#if HAVE_SSE_INLINE
+
+DECLARE_ALIGNED(16, static const uint32_t, conj_mask)[4] = {
+    0, 0x80000000, 0, 0x80000000
+};
+
+/* Two complex values per register. The products are computed and summed the
+ * same way as in the C version, so the results are identical. */
+static void xcorr_mul_sse(FFTComplex *xc, const FFTComplex *xa,
+                          const FFTComplex *xb, int len)
+{
+    x86_reg i = -(x86_reg)len * sizeof(FFTComplex);
+
+    xc -= i / sizeof(FFTComplex);
+    xa -= i / sizeof(FFTComplex);
+    xb -= i / sizeof(FFTComplex);
+
+    __asm__ volatile(
+        "movaps          %4, %%xmm7       \n\t"
+        "1:                               \n\t"
+        "movaps   (%2,%0), %%xmm0         \n\t" // a
+        "movaps 16(%2,%0), %%xmm1         \n\t"
+        "movaps   (%3,%0), %%xmm2         \n\t" // b
+        "movaps 16(%3,%0), %%xmm3         \n\t"
+        "movaps     %%xmm2, %%xmm4        \n\t"
+        "movaps     %%xmm3, %%xmm5        \n\t"
+        "shufps $0xA0, %%xmm2, %%xmm2     \n\t" // b.re b.re
+        "shufps $0xA0, %%xmm3, %%xmm3     \n\t"
+        "shufps $0xF5, %%xmm4, %%xmm4     \n\t" // b.im b.im
+        "shufps $0xF5, %%xmm5, %%xmm5     \n\t"
+        "mulps      %%xmm0, %%xmm2        \n\t" // a.re*b.re a.im*b.re
+        "mulps      %%xmm1, %%xmm3        \n\t"
+        "shufps $0xB1, %%xmm0, %%xmm0     \n\t" // a.im a.re
+        "shufps $0xB1, %%xmm1, %%xmm1     \n\t"
+        "mulps      %%xmm4, %%xmm0        \n\t" // a.im*b.im a.re*b.im
+        "mulps      %%xmm5, %%xmm1        \n\t"
+        "xorps      %%xmm7, %%xmm0        \n\t"
+        "xorps      %%xmm7, %%xmm1        \n\t"
+        "addps      %%xmm0, %%xmm2        \n\t"
+        "addps      %%xmm1, %%xmm3        \n\t"
+        "movaps     %%xmm2,   (%1,%0)     \n\t"
+        "movaps     %%xmm3, 16(%1,%0)     \n\t"
+        "add           $32, %0            \n\t"
+        "jl 1b                            \n\t"
+        : "+r"(i)
+        : "r"(xc), "r"(xa), "r"(xb), "m"(*conj_mask)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                       "%xmm4", "%xmm5", "%xmm7",)
+          "memory"
+    );
+}
+
+DECLARE_ALIGNED(16, static const float, ramp)[4] = { 0.0, 1.0, 2.0, 3.0 };
+DECLARE_ALIGNED(16, static const float, four)[4]  = { 4.0, 4.0, 4.0, 4.0 };
+
+/* Each lane keeps its own first maximum and its index; the lanes are merged
+ * afterwards, picking the lowest index among equal maxima. The weights are
+ * integers small enough to be exact in single precision, so the metrics are
+ * the same as in the C version. maxps returns its second operand when the
+ * metric is NaN, like the strict comparison of the C version. */
+static int find_peak_sse(const FFTSample *xcorr, int len, int drift, int span)
+{
+    DECLARE_ALIGNED(16, float, best)[4];
+    DECLARE_ALIGNED(16, float, best_idx)[4];
+    DECLARE_ALIGNED(16, float, init)[4][4];
+    FFTSample best_metric = -FLT_MAX;
+    int peak = -1;
+    int i, n = len & ~3;
+
+    if (n > 0) {
+        x86_reg k = -(x86_reg)n * sizeof(FFTSample);
+
+        for (i = 0; i < 4; i++) {
+            init[0][i] = -FLT_MAX;
+            init[1][i] = -1;
+            init[2][i] = drift + i;
+            init[3][i] = span  - i;
+        }
+
+        __asm__ volatile(
+            "movaps    (%[init]), %%xmm0   \n\t" // best metric
+            "movaps  16(%[init]), %%xmm1   \n\t" // best index
+            "movaps     %[ramp], %%xmm2    \n\t" // i
+            "movaps  32(%[init]), %%xmm3   \n\t" // drift + i
+            "movaps  48(%[init]), %%xmm4   \n\t" // span - i
+            "1:                            \n\t"
+            "movups (%[x],%[k]), %%xmm6    \n\t"
+            "movaps    %%xmm3, %%xmm7      \n\t"
+            "mulps     %%xmm2, %%xmm7      \n\t"
+            "mulps     %%xmm4, %%xmm7      \n\t"
+            "mulps     %%xmm7, %%xmm6      \n\t" // metric
+            "movaps    %%xmm0, %%xmm7      \n\t"
+            "cmpltps   %%xmm6, %%xmm7      \n\t" // best < metric
+            "maxps     %%xmm0, %%xmm6      \n\t"
+            "movaps    %%xmm6, %%xmm0      \n\t"
+            "movaps    %%xmm2, %%xmm5      \n\t"
+            "andps     %%xmm7, %%xmm5      \n\t"
+            "andnps    %%xmm1, %%xmm7      \n\t"
+            "orps      %%xmm5, %%xmm7      \n\t"
+            "movaps    %%xmm7, %%xmm1      \n\t"
+            "addps      %[four], %%xmm2    \n\t"
+            "addps      %[four], %%xmm3    \n\t"
+            "subps      %[four], %%xmm4    \n\t"
+            "add           $16, %[k]       \n\t"
+            "jl 1b                         \n\t"
+            "movaps    %%xmm0, (%[best])   \n\t"
+            "movaps    %%xmm1, (%[idx])    \n\t"
+            : [k]"+r"(k)
+            : [x]"r"(xcorr + n), [init]"r"(init),
+              [best]"r"(best), [idx]"r"(best_idx),
+              [ramp]"m"(*ramp), [four]"m"(*four)
+            : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                           "%xmm4", "%xmm5", "%xmm6", "%xmm7",)
+              "memory"
+        );
+
+        for (i = 0; i < 4; i++) {
+            if (best_idx[i] < 0)
+                continue;
+            if (best[i] > best_metric ||
+                best[i] == best_metric && best_idx[i] < peak) {
+                best_metric = best[i];
+                peak        = best_idx[i];
+            }
+        }
+    }
+
+    for (i = FFMAX(n, 0); i < len; i++) {
+        FFTSample metric = xcorr[i];
+        FFTSample drifti = (FFTSample)(drift + i);
+        metric *= drifti * (FFTSample)i * (FFTSample)(span - i);
+
+        if (metric > best_metric) {
+            best_metric = metric;
+            peak = i;
+        }
+    }
+
+    return peak;
+}
+
+#endif /* HAVE_SSE_INLINE */
+
+av_cold void ff_atempo_init_x86(ATempoDSPContext *dsp)
+{
+#if HAVE_SSE_INLINE
+    int cpu_flags = av_get_cpu_flags();
+
+    if (INLINE_SSE(cpu_flags)) {
+        dsp->xcorr_mul = xcorr_mul_sse;
+        dsp->find_peak = find_peak_sse;
+    }
+#endif
+}
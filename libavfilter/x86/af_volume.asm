@@ -31,6 +31,49 @@ pq_128:       times 2 dq 128
 
 SECTION_TEXT
 
+;------------------------------------------------------------------------------
+; void ff_scale_samples_u8(uint8_t *dst, const uint8_t *src, int len,
+;                          int volume)
+;------------------------------------------------------------------------------
+
+INIT_XMM sse2
+cglobal scale_samples_u8, 4,4,8, dst, src, len, volume
+    movd        m0, volumem
+    pshuflw     m0, m0, 0
+    punpcklwd   m0, [pw_128]
+    mova        m1, [pw_1]
+    mova        m4, [pw_128]
+    pxor        m5, m5
+    lea       lenq, [lend-mmsize]
+.loop:
+    ; dst[i] = av_clip_uint8((((src[i] - 128) * volume + 128) >> 8) + 128);
+    mova        m2, [srcq+lenq]
+    punpckhbw   m3, m2, m5
+    punpcklbw   m2, m5
+    psubw       m2, m4
+    psubw       m3, m4
+    punpckhwd   m6, m2, m1
+    punpcklwd   m2, m1
+    punpckhwd   m7, m3, m1
+    punpcklwd   m3, m1
+    pmaddwd     m2, m0
+    pmaddwd     m6, m0
+    pmaddwd     m3, m0
+    pmaddwd     m7, m0
+    psrad       m2, 8
+    psrad       m6, 8
+    psrad       m3, 8
+    psrad       m7, 8
+    packssdw    m2, m6
+    packssdw    m3, m7
+    paddsw      m2, m4
+    paddsw      m3, m4
+    packuswb    m2, m3
+    mova  [dstq+lenq], m2
+    sub       lenq, mmsize
+    jge .loop
+    REP_RET
+
 ;------------------------------------------------------------------------------
 ; void ff_scale_samples_s16(uint8_t *dst, const uint8_t *src, int len,
 ;                           int volume)
@@ -138,3 +181,35 @@ cglobal scale_samples_s32, 4,4,8, dst, src, len, volume
     sub       lenq, mmsize
     jge .loop
     REP_RET
+
+;------------------------------------------------------------------------------
+; void ff_scale_samples_flt(float *dst, const float *src, float volume,
+;                           int len)
+;------------------------------------------------------------------------------
+
+%if HAVE_AVX_EXTERNAL
+INIT_YMM avx
+%if UNIX64
+cglobal scale_samples_flt, 3,3,3, dst, src, len
+%else
+cglobal scale_samples_flt, 4,4,3, dst, src, volume, len
+%endif
+%if ARCH_X86_32
+    vbroadcastss     m0, volumem
+%else
+%if WIN64
+    SWAP 0, 2
+%endif
+    shufps           m0, m0, 0
+    vperm2f128       m0, m0, m0, 0
+%endif
+    lea            lenq, [lend*4-2*mmsize]
+.loop:
+    mulps            m1, m0, [srcq+lenq       ]
+    mulps            m2, m0, [srcq+lenq+mmsize]
+    mova [dstq+lenq       ], m1
+    mova [dstq+lenq+mmsize], m2
+    sub            lenq, 2*mmsize
+    jge .loop
+    REP_RET
+%endif
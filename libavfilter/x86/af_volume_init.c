@@ -23,6 +23,9 @@
 #include "libavutil/x86/cpu.h"
 #include "libavfilter/af_volume.h"
 
+void ff_scale_samples_u8_sse2(uint8_t *dst, const uint8_t *src, int len,
+                              int volume);
+
 void ff_scale_samples_s16_sse2(uint8_t *dst, const uint8_t *src, int len,
                                int volume);
 
@@ -33,12 +36,20 @@ void ff_scale_samples_s32_ssse3_atom(uint8_t *dst, const uint8_t *src, int len,
 void ff_scale_samples_s32_avx(uint8_t *dst, const uint8_t *src, int len,
                               int volume);
 
+void ff_scale_samples_flt_avx(float *dst, const float *src, float volume,
+                              int len);
+
 av_cold void ff_volume_init_x86(VolumeContext *vol)
 {
     int mm_flags = av_get_cpu_flags();
     enum AVSampleFormat sample_fmt = av_get_packed_sample_fmt(vol->sample_fmt);
 
-    if (sample_fmt == AV_SAMPLE_FMT_S16) {
+    if (sample_fmt == AV_SAMPLE_FMT_U8) {
+        if (EXTERNAL_SSE2(mm_flags) && vol->volume_i < 32768) {
+            vol->scale_samples = ff_scale_samples_u8_sse2;
+            vol->samples_align = 16;
+        }
+    } else if (sample_fmt == AV_SAMPLE_FMT_S16) {
         if (EXTERNAL_SSE2(mm_flags) && vol->volume_i < 32768) {
             vol->scale_samples = ff_scale_samples_s16_sse2;
             vol->samples_align = 8;
@@ -56,5 +67,10 @@ av_cold void ff_volume_init_x86(VolumeContext *vol)
             vol->scale_samples = ff_scale_samples_s32_avx;
             vol->samples_align = 8;
         }
+    } else if (sample_fmt == AV_SAMPLE_FMT_FLT) {
+        if (EXTERNAL_AVX(mm_flags)) {
+            vol->scale_samples_flt = ff_scale_samples_flt_avx;
+            vol->samples_align = 16;
+        }
     }
 }
@@ -0,0 +1,148 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/mem.h"
+#include "libavutil/x86/asm.h"
+#include "libavutil/x86/cpu.h"
+#include "libavfilter/f_ebur128.h"
+
+#if HAVE_SSE2_INLINE && ARCH_X86_64
+
+#define COEF(c) { c, c }
+
+DECLARE_ALIGNED(16, static const double, coefs)[8][2] = {
+    COEF(PRE_B0), COEF(PRE_B1), COEF(PRE_B2), COEF(PRE_A1), COEF(PRE_A2),
+    COEF(RLB_B1), COEF(RLB_A1), COEF(RLB_A2),
+};
+
+/* Both channels are filtered in one register, the low half holds the first
+ * one. The operations are done in the same order as in the C version, so the
+ * results are identical. RLB_B0 and RLB_B2 are 1.0 and are not multiplied. */
+static void filter_channels2_sse2(EBUR128Channel *ch0, EBUR128Channel *ch1,
+                                  const double *src0, const double *src1,
+                                  int stride, int nb_samples, int pos400, int pos3000)
+{
+    double *ca0 = ch0->cache400  + pos400,  *ca1 = ch1->cache400  + pos400;
+    double *cb0 = ch0->cache3000 + pos3000, *cb1 = ch1->cache3000 + pos3000;
+    x86_reg i   = 0;
+    x86_reg len = nb_samples * sizeof(double);
+    x86_reg inc = stride * sizeof(double);
+
+    if (!nb_samples)
+        return;
+
+    __asm__ volatile(
+#define LOAD_STATE(off, reg)                           \
+        "movsd   "#off"(%[ch0]), %%"#reg"         \n\t" \
+        "movhpd  "#off"(%[ch1]), %%"#reg"         \n\t"
+#define STORE_STATE(off, reg)                          \
+        "movlpd  %%"#reg", "#off"(%[ch0])         \n\t" \
+        "movhpd  %%"#reg", "#off"(%[ch1])         \n\t"
+        LOAD_STATE( 0, xmm0) // x1
+        LOAD_STATE( 8, xmm1) // x2
+        LOAD_STATE(16, xmm2) // y1
+        LOAD_STATE(24, xmm3) // y2
+        LOAD_STATE(32, xmm4) // z1
+        LOAD_STATE(40, xmm5) // z2
+        LOAD_STATE(48, xmm6) // sum400
+        LOAD_STATE(56, xmm7) // sum3000
+        "1:                                       \n\t"
+        "movsd        (%[src0]), %%xmm8           \n\t" // x0
+        "movhpd       (%[src1]), %%xmm8           \n\t"
+        "add           %[inc], %[src0]            \n\t"
+        "add           %[inc], %[src1]            \n\t"
+        // y0 = x0*b0 + x1*b1 + x2*b2 - y1*a1 - y2*a2
+        "movapd        %%xmm8, %%xmm9             \n\t"
+        "mulpd      0(%[coefs]), %%xmm9           \n\t"
+        "movapd        %%xmm0, %%xmm10            \n\t"
+        "mulpd     16(%[coefs]), %%xmm10          \n\t"
+        "addpd        %%xmm10, %%xmm9             \n\t"
+        "movapd        %%xmm1, %%xmm10            \n\t"
+        "mulpd     32(%[coefs]), %%xmm10          \n\t"
+        "addpd        %%xmm10, %%xmm9             \n\t"
+        "movapd        %%xmm2, %%xmm10            \n\t"
+        "mulpd     48(%[coefs]), %%xmm10          \n\t"
+        "subpd        %%xmm10, %%xmm9             \n\t"
+        "movapd        %%xmm3, %%xmm10            \n\t"
+        "mulpd     64(%[coefs]), %%xmm10          \n\t"
+        "subpd        %%xmm10, %%xmm9             \n\t"
+        // z0 = y0 + y1*b1 + y2 - z1*a1 - z2*a2
+        "movapd        %%xmm2, %%xmm10            \n\t"
+        "mulpd     80(%[coefs]), %%xmm10          \n\t"
+        "addpd         %%xmm9, %%xmm10            \n\t"
+        "addpd         %%xmm3, %%xmm10            \n\t"
+        "movapd        %%xmm4, %%xmm11            \n\t"
+        "mulpd     96(%[coefs]), %%xmm11          \n\t"
+        "subpd        %%xmm11, %%xmm10            \n\t"
+        "movapd        %%xmm5, %%xmm11            \n\t"
+        "mulpd    112(%[coefs]), %%xmm11          \n\t"
+        "subpd        %%xmm11, %%xmm10            \n\t"
+        "movapd        %%xmm0, %%xmm1             \n\t"
+        "movapd        %%xmm8, %%xmm0             \n\t"
+        "movapd        %%xmm2, %%xmm3             \n\t"
+        "movapd        %%xmm9, %%xmm2             \n\t"
+        "movapd        %%xmm4, %%xmm5             \n\t"
+        "movapd       %%xmm10, %%xmm4             \n\t"
+        // bin = z0 * z0, sum = sum + bin - cache[i], cache[i] = bin
+        "mulpd        %%xmm10, %%xmm10            \n\t"
+        "movsd    (%[ca0],%[i]), %%xmm8           \n\t"
+        "movhpd   (%[ca1],%[i]), %%xmm8           \n\t"
+        "movsd    (%[cb0],%[i]), %%xmm9           \n\t"
+        "movhpd   (%[cb1],%[i]), %%xmm9           \n\t"
+        "addpd        %%xmm10, %%xmm6             \n\t"
+        "addpd        %%xmm10, %%xmm7             \n\t"
+        "subpd         %%xmm8, %%xmm6             \n\t"
+        "subpd         %%xmm9, %%xmm7             \n\t"
+        "movlpd       %%xmm10, (%[ca0],%[i])      \n\t"
+        "movhpd       %%xmm10, (%[ca1],%[i])      \n\t"
+        "movlpd       %%xmm10, (%[cb0],%[i])      \n\t"
+        "movhpd       %%xmm10, (%[cb1],%[i])      \n\t"
+        "add                $8, %[i]              \n\t"
+        "cmp            %[len], %[i]              \n\t"
+        "jl 1b                                    \n\t"
+        STORE_STATE( 0, xmm0)
+        STORE_STATE( 8, xmm1)
+        STORE_STATE(16, xmm2)
+        STORE_STATE(24, xmm3)
+        STORE_STATE(32, xmm4)
+        STORE_STATE(40, xmm5)
+        STORE_STATE(48, xmm6)
+        STORE_STATE(56, xmm7)
+        : [i]"+&r"(i), [src0]"+&r"(src0), [src1]"+&r"(src1)
+        : [ch0]"r"(ch0), [ch1]"r"(ch1), [ca0]"r"(ca0), [ca1]"r"(ca1),
+          [cb0]"r"(cb0), [cb1]"r"(cb1), [len]"r"(len), [inc]"r"(inc),
+          [coefs]"r"(coefs)
+        : XMM_CLOBBERS("%xmm0",  "%xmm1",  "%xmm2",  "%xmm3",
+                       "%xmm4",  "%xmm5",  "%xmm6",  "%xmm7",
+                       "%xmm8",  "%xmm9",  "%xmm10", "%xmm11",)
+          "memory"
+    );
+}
+#endif /* HAVE_SSE2_INLINE && ARCH_X86_64 */
+
+av_cold void ff_ebur128_init_x86(EBUR128DSPContext *dsp)
+{
+#if HAVE_SSE2_INLINE && ARCH_X86_64
+    int cpu_flags = av_get_cpu_flags();
+
+    if (INLINE_SSE2(cpu_flags))
+        dsp->filter_channels2 = filter_channels2_sse2;
+#endif
+}
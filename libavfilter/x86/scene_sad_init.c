@@ -0,0 +1,66 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+
+#include "config.h"
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/x86/cpu.h"
+#include "libavfilter/scene_sad.h"
+
+#define SCENE_SAD_FUNC(opt, mmsize)                                            \
+void ff_scene_sad_ ## opt(const uint8_t *src1, ptrdiff_t stride1,              \
+                          const uint8_t *src2, ptrdiff_t stride2,              \
+                          ptrdiff_t width, ptrdiff_t height, uint64_t *sum);   \
+                                                                               \
+static uint64_t scene_sad_ ## opt(const uint8_t *src1, ptrdiff_t stride1,      \
+                                  const uint8_t *src2, ptrdiff_t stride2,      \
+                                  int width, int height)                       \
+{                                                                              \
+    int awidth = width & ~(mmsize - 1);                                        \
+    uint64_t sad = 0;                                                          \
+                                                                               \
+    if (awidth && height > 0)                                                  \
+        ff_scene_sad_ ## opt(src1, stride1, src2, stride2,                     \
+                             awidth, height, &sad);                            \
+    return sad + ff_scene_sad_c(src1 + awidth, stride1, src2 + awidth,         \
+                                stride2, width - awidth, height);              \
+}
+
+#if HAVE_YASM
+SCENE_SAD_FUNC(sse2, 16)
+#if HAVE_AVX2_EXTERNAL
+SCENE_SAD_FUNC(avx2, 32)
+#endif
+#endif
+
+av_cold ff_scene_sad_fn ff_scene_sad_get_fn_x86(void)
+{
+    ff_scene_sad_fn sad = NULL;
+#if HAVE_YASM
+    int cpu_flags = av_get_cpu_flags();
+
+    if (EXTERNAL_SSE2(cpu_flags))
+        sad = scene_sad_sse2;
+#if HAVE_AVX2_EXTERNAL
+    if (EXTERNAL_AVX2(cpu_flags))
+        sad = scene_sad_avx2;
+#endif
+#endif
+    return sad;
+}
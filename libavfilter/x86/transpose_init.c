@@ -0,0 +1,172 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/x86/asm.h"
+#include "libavutil/x86/cpu.h"
+#include "libavfilter/transpose.h"
+
+#if HAVE_SSE2_INLINE
+static void transpose_8x8_1_sse2(uint8_t *dst, ptrdiff_t dst_linesize,
+                                 const uint8_t *src, ptrdiff_t src_linesize)
+{
+    __asm__ volatile (
+        "movq           (%0), %%xmm0    \n\t"
+        "movq        (%0,%2), %%xmm1    \n\t"
+        "lea       (%0,%2,2), %0        \n\t"
+        "movq           (%0), %%xmm2    \n\t"
+        "movq        (%0,%2), %%xmm3    \n\t"
+        "lea       (%0,%2,2), %0        \n\t"
+        "movq           (%0), %%xmm4    \n\t"
+        "movq        (%0,%2), %%xmm5    \n\t"
+        "lea       (%0,%2,2), %0        \n\t"
+        "movq           (%0), %%xmm6    \n\t"
+        "movq        (%0,%2), %%xmm7    \n\t"
+        "punpcklbw    %%xmm1, %%xmm0    \n\t"
+        "punpcklbw    %%xmm3, %%xmm2    \n\t"
+        "punpcklbw    %%xmm5, %%xmm4    \n\t"
+        "punpcklbw    %%xmm7, %%xmm6    \n\t"
+        "movdqa       %%xmm0, %%xmm1    \n\t"
+        "punpcklwd    %%xmm2, %%xmm0    \n\t"
+        "punpckhwd    %%xmm2, %%xmm1    \n\t"
+        "movdqa       %%xmm4, %%xmm5    \n\t"
+        "punpcklwd    %%xmm6, %%xmm4    \n\t"
+        "punpckhwd    %%xmm6, %%xmm5    \n\t"
+        "movdqa       %%xmm0, %%xmm2    \n\t"
+        "punpckldq    %%xmm4, %%xmm0    \n\t"
+        "punpckhdq    %%xmm4, %%xmm2    \n\t"
+        "movdqa       %%xmm1, %%xmm3    \n\t"
+        "punpckldq    %%xmm5, %%xmm1    \n\t"
+        "punpckhdq    %%xmm5, %%xmm3    \n\t"
+        "movq         %%xmm0, (%1)      \n\t"
+        "movhps       %%xmm0, (%1,%3)   \n\t"
+        "lea       (%1,%3,2), %1        \n\t"
+        "movq         %%xmm2, (%1)      \n\t"
+        "movhps       %%xmm2, (%1,%3)   \n\t"
+        "lea       (%1,%3,2), %1        \n\t"
+        "movq         %%xmm1, (%1)      \n\t"
+        "movhps       %%xmm1, (%1,%3)   \n\t"
+        "lea       (%1,%3,2), %1        \n\t"
+        "movq         %%xmm3, (%1)      \n\t"
+        "movhps       %%xmm3, (%1,%3)   \n\t"
+        : "+r"(src), "+r"(dst)
+        : "r"((x86_reg)src_linesize), "r"((x86_reg)dst_linesize)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                       "%xmm4", "%xmm5", "%xmm6", "%xmm7",) "memory"
+    );
+}
+
+/* 4x4 block of 16-bit pixels */
+static void transpose_4x4_2_sse2(uint8_t *dst, ptrdiff_t dst_linesize,
+                                 const uint8_t *src, ptrdiff_t src_linesize)
+{
+    __asm__ volatile (
+        "movq           (%0), %%xmm0    \n\t"
+        "movq        (%0,%2), %%xmm1    \n\t"
+        "lea       (%0,%2,2), %0        \n\t"
+        "movq           (%0), %%xmm2    \n\t"
+        "movq        (%0,%2), %%xmm3    \n\t"
+        "punpcklwd    %%xmm1, %%xmm0    \n\t"
+        "punpcklwd    %%xmm3, %%xmm2    \n\t"
+        "movdqa       %%xmm0, %%xmm1    \n\t"
+        "punpckldq    %%xmm2, %%xmm0    \n\t"
+        "punpckhdq    %%xmm2, %%xmm1    \n\t"
+        "movq         %%xmm0, (%1)      \n\t"
+        "movhps       %%xmm0, (%1,%3)   \n\t"
+        "lea       (%1,%3,2), %1        \n\t"
+        "movq         %%xmm1, (%1)      \n\t"
+        "movhps       %%xmm1, (%1,%3)   \n\t"
+        : "+r"(src), "+r"(dst)
+        : "r"((x86_reg)src_linesize), "r"((x86_reg)dst_linesize)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",) "memory"
+    );
+}
+
+/* 4x4 block of 32-bit pixels */
+static void transpose_4x4_4_sse2(uint8_t *dst, ptrdiff_t dst_linesize,
+                                 const uint8_t *src, ptrdiff_t src_linesize)
+{
+    __asm__ volatile (
+        "movdqu         (%0), %%xmm0    \n\t"
+        "movdqu      (%0,%2), %%xmm1    \n\t"
+        "lea       (%0,%2,2), %0        \n\t"
+        "movdqu         (%0), %%xmm2    \n\t"
+        "movdqu      (%0,%2), %%xmm3    \n\t"
+        "movdqa       %%xmm0, %%xmm4    \n\t"
+        "punpckldq    %%xmm1, %%xmm0    \n\t"
+        "punpckhdq    %%xmm1, %%xmm4    \n\t"
+        "movdqa       %%xmm2, %%xmm5    \n\t"
+        "punpckldq    %%xmm3, %%xmm2    \n\t"
+        "punpckhdq    %%xmm3, %%xmm5    \n\t"
+        "movdqa       %%xmm0, %%xmm1    \n\t"
+        "punpcklqdq   %%xmm2, %%xmm0    \n\t"
+        "punpckhqdq   %%xmm2, %%xmm1    \n\t"
+        "movdqa       %%xmm4, %%xmm3    \n\t"
+        "punpcklqdq   %%xmm5, %%xmm4    \n\t"
+        "punpckhqdq   %%xmm5, %%xmm3    \n\t"
+        "movdqu       %%xmm0, (%1)      \n\t"
+        "movdqu       %%xmm1, (%1,%3)   \n\t"
+        "lea       (%1,%3,2), %1        \n\t"
+        "movdqu       %%xmm4, (%1)      \n\t"
+        "movdqu       %%xmm3, (%1,%3)   \n\t"
+        : "+r"(src), "+r"(dst)
+        : "r"((x86_reg)src_linesize), "r"((x86_reg)dst_linesize)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                       "%xmm4", "%xmm5",) "memory"
+    );
+}
+
+#define TRANSPOSE_8X8_FROM_4X4(pixstep)                                        \
+static void transpose_8x8_ ## pixstep ## _sse2(uint8_t *dst,                   \
+                                               ptrdiff_t dst_linesize,         \
+                                               const uint8_t *src,             \
+                                               ptrdiff_t src_linesize)         \
+{                                                                              \
+    uint8_t *dst2 = dst + 4 * dst_linesize;                                    \
+    const uint8_t *src2 = src + 4 * src_linesize;                              \
+                                                                               \
+    transpose_4x4_ ## pixstep ## _sse2(dst,  dst_linesize,                     \
+                                       src,  src_linesize);                    \
+    transpose_4x4_ ## pixstep ## _sse2(dst  + 4 * pixstep, dst_linesize,       \
+                                       src2, src_linesize);                    \
+    transpose_4x4_ ## pixstep ## _sse2(dst2, dst_linesize,                     \
+                                       src  + 4 * pixstep, src_linesize);      \
+    transpose_4x4_ ## pixstep ## _sse2(dst2 + 4 * pixstep, dst_linesize,       \
+                                       src2 + 4 * pixstep, src_linesize);      \
+}
+
+TRANSPOSE_8X8_FROM_4X4(2)
+TRANSPOSE_8X8_FROM_4X4(4)
+#endif /* HAVE_SSE2_INLINE */
+
+av_cold ff_transpose_block_fn ff_transpose_get_block_fn_x86(int pixstep)
+{
+#if HAVE_SSE2_INLINE
+    int cpu_flags = av_get_cpu_flags();
+
+    if (INLINE_SSE2(cpu_flags)) {
+        switch (pixstep) {
+        case 1: return transpose_8x8_1_sse2;
+        case 2: return transpose_8x8_2_sse2;
+        case 4: return transpose_8x8_4_sse2;
+        }
+    }
+#endif
+    return NULL;
+}
@@ -0,0 +1,99 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/attributes.h"
+#include "libavutil/common.h"
+#include "libavutil/cpu.h"
+#include "libavutil/mem.h"
+#include "libavutil/x86/asm.h"
+#include "libavutil/x86/cpu.h"
+#include "libavfilter/vf_colorchannelmixer.h"
+
+#if HAVE_SSE2_INLINE
+DECLARE_ASM_CONST(16, int32_t, pd_4096)[4] = { 4096, 4096, 4096, 4096 };
+
+/* one output component of 4 pixels: the even components are in xmm0 and
+ * the odd ones in xmm1, as words */
+#define MIX(out, coeffs)                        \
+    "movdqa      %%xmm0, %%"out"        \n\t"   \
+    "movdqa      %%xmm1, %%xmm6         \n\t"   \
+    "pmaddwd   "coeffs", %%"out"        \n\t"   \
+    "pmaddwd 16+"coeffs", %%xmm6        \n\t"   \
+    "paddd       %%xmm6, %%"out"        \n\t"   \
+    "paddd     %4,       %%"out"        \n\t"   \
+    "psrad          $13, %%"out"        \n\t"
+
+static void mix_line_4_sse2(uint8_t *dst, const uint8_t *src, int w,
+                            const int16_t (*coeffs)[2][8])
+{
+    x86_reg i = 0, len = (w & ~3) * 4;
+
+    if (len) {
+        __asm__ volatile (
+            "pcmpeqw     %%xmm7, %%xmm7         \n\t"
+            "psrlw           $8, %%xmm7         \n\t"
+            "1:                                 \n\t"
+            "movdqu     (%1,%0), %%xmm0         \n\t"
+            "movdqa      %%xmm0, %%xmm1         \n\t"
+            "pand        %%xmm7, %%xmm0         \n\t"
+            "psrlw           $8, %%xmm1         \n\t"
+            MIX("xmm2",   "(%3)")
+            MIX("xmm3", "32(%3)")
+            MIX("xmm4", "64(%3)")
+            MIX("xmm5", "96(%3)")
+            /* clip and interleave the components back into pixels */
+            "packssdw    %%xmm4, %%xmm2         \n\t"
+            "packssdw    %%xmm5, %%xmm3         \n\t"
+            "packuswb    %%xmm2, %%xmm2         \n\t"
+            "packuswb    %%xmm3, %%xmm3         \n\t"
+            "punpcklbw   %%xmm3, %%xmm2         \n\t"
+            "pshufd   $0xee, %%xmm2, %%xmm3     \n\t"
+            "punpcklwd   %%xmm3, %%xmm2         \n\t"
+            "movdqu      %%xmm2, (%2,%0)        \n\t"
+            "add            $16, %0             \n\t"
+            "cmp             %5, %0             \n\t"
+            "jl              1b                 \n\t"
+            : "+&r"(i)
+            : "r"(src), "r"(dst), "r"(coeffs), "m"(*pd_4096), "r"(len)
+            : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                           "%xmm4", "%xmm5", "%xmm6", "%xmm7",) "memory"
+        );
+    }
+
+    for (i = w & ~3; i < w; i++) {
+        const int c0 = src[4*i    ], c1 = src[4*i + 1];
+        const int c2 = src[4*i + 2], c3 = src[4*i + 3];
+        int k;
+
+        for (k = 0; k < 4; k++)
+            dst[4*i + k] = av_clip_uint8((coeffs[k][0][0] * c0 + coeffs[k][1][0] * c1 +
+                                          coeffs[k][0][1] * c2 + coeffs[k][1][1] * c3 +
+                                          (1 << 12)) >> 13);
+    }
+}
+#endif /* HAVE_SSE2_INLINE */
+
+av_cold void ff_colorchannelmixer_init_x86(ColorChannelMixerContext *cm)
+{
+#if HAVE_SSE2_INLINE
+    int cpu_flags = av_get_cpu_flags();
+
+    if (INLINE_SSE2(cpu_flags))
+        cm->mix_line_4 = mix_line_4_sse2;
+#endif
+}
@@ -25,8 +25,8 @@
 
 SECTION_RODATA
 
-pb_1: times 16 db 1
-pw_1: times  8 dw 1
+pb_1: times 32 db 1
+pw_1: times 16 dw 1
 
 SECTION .text
 
@@ -39,7 +39,12 @@ SECTION .text
     pavgb     m5, m3
     pand      m4, [pb_1]
     psubusb   m5, m4
-%if mmsize == 16
+%if mmsize == 32
+    ; make each lane hold the 16 bytes its 8 words need, the shifts
+    ; and unpacks below work within lanes
+    vpermq    m5, m5, q2110
+%endif
+%if mmsize >= 16
     psrldq    m5, 1
 %else
     psrlq     m5, 8
@@ -49,9 +54,12 @@ SECTION .text
     psubusb   m2, m3
     psubusb   m3, m4
     pmaxub    m2, m3
+%if mmsize == 32
+    vpermq    m2, m2, q2110
+%endif
     mova      m3, m2
     mova      m4, m2
-%if mmsize == 16
+%if mmsize >= 16
     psrldq    m3, 1
     psrldq    m4, 2
 %else
@@ -90,8 +98,12 @@ SECTION .text
 %endmacro
 
 %macro LOAD 2
+%if mmsize == 32
+    vpmovzxbw %1, %2
+%else
     movh      %1, %2
     punpcklbw %1, m7
+%endif
 %endmacro
 
 %macro FILTER 3
@@ -104,9 +116,9 @@ SECTION .text
     mova         m4, m3
     paddw        m3, m2
     psraw        m3, 1
-    mova   [rsp+ 0], m0
-    mova   [rsp+16], m3
-    mova   [rsp+32], m1
+    mova   [rsp+mmsize*0], m0
+    mova   [rsp+mmsize*1], m3
+    mova   [rsp+mmsize*2], m1
     psubw        m2, m4
     ABS1         m2, m4
     LOAD         m3, [prevq+t1]
@@ -128,7 +140,7 @@ SECTION .text
     paddw        m3, m4
     psrlw        m3, 1
     pmaxsw       m2, m3
-    mova   [rsp+48], m2
+    mova   [rsp+mmsize*3], m2
 
     paddw        m1, m0
     paddw        m0, m0
@@ -142,7 +154,10 @@ SECTION .text
     psubusb      m2, m3
     psubusb      m3, m4
     pmaxub       m2, m3
-%if mmsize == 16
+%if mmsize == 32
+    vpermq       m2, m2, q2110
+%endif
+%if mmsize >= 16
     mova         m3, m2
     psrldq       m3, 2
 %else
@@ -163,7 +178,7 @@ SECTION .text
     CHECK 1, -3
     CHECK2
 
-    mova         m6, [rsp+48]
+    mova         m6, [rsp+mmsize*3]
     cmp   DWORD r8m, 2
     jge .end%1
     LOAD         m2, [%2+t1*2]
@@ -174,9 +189,9 @@ SECTION .text
     paddw        m3, m5
     psrlw        m2, 1
     psrlw        m3, 1
-    mova         m4, [rsp+ 0]
-    mova         m5, [rsp+16]
-    mova         m7, [rsp+32]
+    mova         m4, [rsp+mmsize*0]
+    mova         m5, [rsp+mmsize*1]
+    mova         m7, [rsp+mmsize*2]
     psubw        m2, m4
     psubw        m3, m7
     mova         m0, m5
@@ -195,15 +210,19 @@ SECTION .text
     pmaxsw       m6, m4
 
 .end%1:
-    mova         m2, [rsp+16]
+    mova         m2, [rsp+mmsize*1]
     mova         m3, m2
     psubw        m2, m6
     paddw        m3, m6
     pmaxsw       m1, m2
     pminsw       m1, m3
     packuswb     m1, m1
-
+%if mmsize == 32
+    vpermq       m1, m1, q3120
+    movu     [dstq], xmm1
+%else
     movh     [dstq], m1
+%endif
     add        dstq, mmsize/2
     add       prevq, mmsize/2
     add        curq, mmsize/2
@@ -214,10 +233,10 @@ SECTION .text
 
 %macro YADIF 0
 %if ARCH_X86_32
-cglobal yadif_filter_line, 4, 6, 8, 80, dst, prev, cur, next, w, prefs, \
+cglobal yadif_filter_line, 4, 6, 8, 5*mmsize, dst, prev, cur, next, w, prefs, \
                                         mrefs, parity, mode
 %else
-cglobal yadif_filter_line, 4, 7, 8, 80, dst, prev, cur, next, w, prefs, \
+cglobal yadif_filter_line, 4, 7, 8, 5*mmsize, dst, prev, cur, next, w, prefs, \
                                         mrefs, parity, mode
 %endif
 %if ARCH_X86_32
@@ -242,6 +261,10 @@ cglobal yadif_filter_line, 4, 7, 8, 80, dst, prev, cur, next, w, prefs, \
     RET
 %endmacro
 
+%if HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+YADIF
+%endif
 INIT_XMM ssse3
 YADIF
 INIT_XMM sse2
@@ -34,6 +34,9 @@ void ff_yadif_filter_line_sse2(void *dst, void *prev, void *cur,
 void ff_yadif_filter_line_ssse3(void *dst, void *prev, void *cur,
                                 void *next, int w, int prefs,
                                 int mrefs, int parity, int mode);
+void ff_yadif_filter_line_avx2(void *dst, void *prev, void *cur,
+                               void *next, int w, int prefs,
+                               int mrefs, int parity, int mode);
 
 void ff_yadif_filter_line_16bit_mmxext(void *dst, void *prev, void *cur,
                                        void *next, int w, int prefs,
@@ -47,6 +50,9 @@ void ff_yadif_filter_line_16bit_ssse3(void *dst, void *prev, void *cur,
 void ff_yadif_filter_line_16bit_sse4(void *dst, void *prev, void *cur,
                                      void *next, int w, int prefs,
                                      int mrefs, int parity, int mode);
+void ff_yadif_filter_line_16bit_avx2(void *dst, void *prev, void *cur,
+                                     void *next, int w, int prefs,
+                                     int mrefs, int parity, int mode);
 
 void ff_yadif_filter_line_10bit_mmxext(void *dst, void *prev, void *cur,
                                        void *next, int w, int prefs,
@@ -57,6 +63,9 @@ void ff_yadif_filter_line_10bit_sse2(void *dst, void *prev, void *cur,
 void ff_yadif_filter_line_10bit_ssse3(void *dst, void *prev, void *cur,
                                       void *next, int w, int prefs,
                                       int mrefs, int parity, int mode);
+void ff_yadif_filter_line_10bit_avx2(void *dst, void *prev, void *cur,
+                                     void *next, int w, int prefs,
+                                     int mrefs, int parity, int mode);
 
 av_cold void ff_yadif_init_x86(YADIFContext *yadif)
 {
@@ -76,6 +85,10 @@ av_cold void ff_yadif_init_x86(YADIFContext *yadif)
             yadif->filter_line = ff_yadif_filter_line_16bit_ssse3;
         if (EXTERNAL_SSE4(cpu_flags))
             yadif->filter_line = ff_yadif_filter_line_16bit_sse4;
+        if (EXTERNAL_AVX2(cpu_flags)) {
+            yadif->filter_line = ff_yadif_filter_line_16bit_avx2;
+            yadif->req_align   = 16;
+        }
     } else if ( bit_depth >= 9 && bit_depth <= 14) {
 #if ARCH_X86_32
         if (EXTERNAL_MMXEXT(cpu_flags))
@@ -85,6 +98,11 @@ av_cold void ff_yadif_init_x86(YADIFContext *yadif)
             yadif->filter_line = ff_yadif_filter_line_10bit_sse2;
         if (EXTERNAL_SSSE3(cpu_flags))
             yadif->filter_line = ff_yadif_filter_line_10bit_ssse3;
+        /* processes 14 pixels per iteration but stores 16 */
+        if (EXTERNAL_AVX2(cpu_flags)) {
+            yadif->filter_line = ff_yadif_filter_line_10bit_avx2;
+            yadif->req_align   = 32;
+        }
     } else {
 #if ARCH_X86_32
         if (EXTERNAL_MMXEXT(cpu_flags))
@@ -94,6 +112,10 @@ av_cold void ff_yadif_init_x86(YADIFContext *yadif)
             yadif->filter_line = ff_yadif_filter_line_sse2;
         if (EXTERNAL_SSSE3(cpu_flags))
             yadif->filter_line = ff_yadif_filter_line_ssse3;
+        if (EXTERNAL_AVX2(cpu_flags)) {
+            yadif->filter_line = ff_yadif_filter_line_avx2;
+            yadif->req_align   = 16;
+        }
     }
 #endif /* HAVE_YASM */
 }
@@ -26,7 +26,7 @@
 
 SECTION_RODATA
 
-pw_1: times 8 dw 1
+pw_1: times 16 dw 1
 
 SECTION .text
 
@@ -50,6 +50,18 @@ SECTION .text
 %endif
 %endmacro
 
+; shift a whole register right by %2 bytes, %3 is a temporary register
+%macro PSRLDQ 3
+%if mmsize == 32
+    vperm2i128 %3, %1, %1, 0x81
+    vpalignr   %1, %3, %1, %2
+%elif mmsize == 16
+    psrldq     %1, %2
+%else
+    psrlq      %1, %2*8
+%endif
+%endmacro
+
 %macro CHECK 2
     movu      m2, [curq+t1+%1*2]
     movu      m3, [curq+t0+%2*2]
@@ -59,24 +71,15 @@ SECTION .text
     pavgw     m5, m3
     pand      m4, [pw_1]
     psubusw   m5, m4
-%if mmsize == 16
-    psrldq    m5, 2
-%else
-    psrlq     m5, 16
-%endif
+    PSRLDQ    m5, 2, m4
     mova      m4, m2
     psubusw   m2, m3
     psubusw   m3, m4
     PMAXUW    m2, m3
     mova      m3, m2
     mova      m4, m2
-%if mmsize == 16
-    psrldq    m3, 2
-    psrldq    m4, 4
-%else
-    psrlq     m3, 16
-    psrlq     m4, 32
-%endif
+    PSRLDQ    m3, 2, m7
+    PSRLDQ    m4, 4, m7
     paddw     m2, m3
     paddw     m2, m4
 %endmacro
@@ -136,9 +139,9 @@ SECTION .text
     mova         m4, m3
     paddw        m3, m2
     psraw        m3, 1
-    mova   [rsp+ 0], m0
-    mova   [rsp+16], m3
-    mova   [rsp+32], m1
+    mova   [rsp+mmsize*0], m0
+    mova   [rsp+mmsize*1], m3
+    mova   [rsp+mmsize*2], m1
     psubw        m2, m4
     PABS         m2, m4
     LOAD         m3, [prevq+t1]
@@ -160,7 +163,7 @@ SECTION .text
     paddw        m3, m4
     psrlw        m3, 1
     pmaxsw       m2, m3
-    mova   [rsp+48], m2
+    mova   [rsp+mmsize*3], m2
 
     paddw        m1, m0
     paddw        m0, m0
@@ -174,13 +177,8 @@ SECTION .text
     psubusw      m2, m3
     psubusw      m3, m4
     PMAXUW       m2, m3
-%if mmsize == 16
-    mova         m3, m2
-    psrldq       m3, 4
-%else
     mova         m3, m2
-    psrlq        m3, 32
-%endif
+    PSRLDQ       m3, 4, m4
     paddw        m0, m2
     paddw        m0, m3
     psubw        m0, [pw_1]
@@ -194,7 +192,7 @@ SECTION .text
     CHECK 1, -3
     CHECK2
 
-    mova         m6, [rsp+48]
+    mova         m6, [rsp+mmsize*3]
     cmp   DWORD r8m, 2
     jge .end%1
     LOAD         m2, [%2+t1*2]
@@ -205,9 +203,9 @@ SECTION .text
     paddw        m3, m5
     psrlw        m2, 1
     psrlw        m3, 1
-    mova         m4, [rsp+ 0]
-    mova         m5, [rsp+16]
-    mova         m7, [rsp+32]
+    mova         m4, [rsp+mmsize*0]
+    mova         m5, [rsp+mmsize*1]
+    mova         m7, [rsp+mmsize*2]
     psubw        m2, m4
     psubw        m3, m7
     mova         m0, m5
@@ -226,7 +224,7 @@ SECTION .text
     pmaxsw       m6, m4
 
 .end%1:
-    mova         m2, [rsp+16]
+    mova         m2, [rsp+mmsize*1]
     mova         m3, m2
     psubw        m2, m6
     paddw        m3, m6
@@ -244,10 +242,10 @@ SECTION .text
 
 %macro YADIF 0
 %if ARCH_X86_32
-cglobal yadif_filter_line_10bit, 4, 6, 8, 80, dst, prev, cur, next, w, \
+cglobal yadif_filter_line_10bit, 4, 6, 8, 5*mmsize, dst, prev, cur, next, w, \
                                               prefs, mrefs, parity, mode
 %else
-cglobal yadif_filter_line_10bit, 4, 7, 8, 80, dst, prev, cur, next, w, \
+cglobal yadif_filter_line_10bit, 4, 7, 8, 5*mmsize, dst, prev, cur, next, w, \
                                               prefs, mrefs, parity, mode
 %endif
 %if ARCH_X86_32
@@ -272,6 +270,10 @@ cglobal yadif_filter_line_10bit, 4, 7, 8, 80, dst, prev, cur, next, w, \
     RET
 %endmacro
 
+%if HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+YADIF
+%endif
 INIT_XMM ssse3
 YADIF
 INIT_XMM sse2
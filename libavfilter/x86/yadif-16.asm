@@ -26,10 +26,10 @@
 
 SECTION_RODATA
 
-pw_1:    times 8 dw 1
-pw_8000: times 8 dw 0x8000
-pd_1:    times 4 dd 1
-pd_8000: times 4 dd 0x8000
+pw_1:    times 16 dw 1
+pw_8000: times 16 dw 0x8000
+pd_1:    times 8 dd 1
+pd_8000: times 8 dd 0x8000
 
 SECTION .text
 
@@ -112,7 +112,12 @@ SECTION .text
     pavgw     m5, m3
     pand      m4, [pw_1]
     psubusw   m5, m4
-%if mmsize == 16
+%if mmsize == 32
+    ; make each lane hold the 8 words its 4 dwords need, the shifts
+    ; and unpacks below work within lanes
+    vpermq    m5, m5, q2110
+%endif
+%if mmsize >= 16
     psrldq    m5, 2
 %else
     psrlq     m5, 16
@@ -122,9 +127,12 @@ SECTION .text
     psubusw   m2, m3
     psubusw   m3, m4
     PMAXUW    m2, m3
+%if mmsize == 32
+    vpermq    m2, m2, q2110
+%endif
     mova      m3, m2
     mova      m4, m2
-%if mmsize == 16
+%if mmsize >= 16
     psrldq    m3, 2
     psrldq    m4, 4
 %else
@@ -182,8 +190,12 @@ SECTION .text
 ; %endmacro
 
 %macro LOAD 2
+%if mmsize == 32
+    vpmovzxwd %1, %2
+%else
     movh      %1, %2
     punpcklwd %1, m7
+%endif
 %endmacro
 
 %macro FILTER 3
@@ -196,9 +208,9 @@ SECTION .text
     mova         m4, m3
     paddd        m3, m2
     psrad        m3, 1
-    mova   [rsp+ 0], m0
-    mova   [rsp+16], m3
-    mova   [rsp+32], m1
+    mova   [rsp+mmsize*0], m0
+    mova   [rsp+mmsize*1], m3
+    mova   [rsp+mmsize*2], m1
     psubd        m2, m4
     PABS         m2, m4
     LOAD         m3, [prevq+t1]
@@ -220,7 +232,7 @@ SECTION .text
     paddd        m3, m4
     psrld        m3, 1
     PMAXSD       m2, m3, m6
-    mova   [rsp+48], m2
+    mova   [rsp+mmsize*3], m2
 
     paddd        m1, m0
     paddd        m0, m0
@@ -234,7 +246,10 @@ SECTION .text
     psubusw      m2, m3
     psubusw      m3, m4
     PMAXUW       m2, m3
-%if mmsize == 16
+%if mmsize == 32
+    vpermq       m2, m2, q2110
+%endif
+%if mmsize >= 16
     mova         m3, m2
     psrldq       m3, 4
 %else
@@ -256,7 +271,7 @@ SECTION .text
     CHECK 1, -3
     CHECK2
 
-    mova         m6, [rsp+48]
+    mova         m6, [rsp+mmsize*3]
     cmp   DWORD r8m, 2
     jge .end%1
     LOAD         m2, [%2+t1*2]
@@ -267,9 +282,9 @@ SECTION .text
     paddd        m3, m5
     psrld        m2, 1
     psrld        m3, 1
-    mova         m4, [rsp+ 0]
-    mova         m5, [rsp+16]
-    mova         m7, [rsp+32]
+    mova         m4, [rsp+mmsize*0]
+    mova         m5, [rsp+mmsize*1]
+    mova         m7, [rsp+mmsize*2]
     psubd        m2, m4
     psubd        m3, m7
     mova         m0, m5
@@ -288,15 +303,19 @@ SECTION .text
     PMAXSD       m6, m4, m7
 
 .end%1:
-    mova         m2, [rsp+16]
+    mova         m2, [rsp+mmsize*1]
     mova         m3, m2
     psubd        m2, m6
     paddd        m3, m6
     PMAXSD       m1, m2, m7
     PMINSD       m1, m3, m7
     PACK         m1
-
+%if mmsize == 32
+    vpermq       m1, m1, q3120
+    movu     [dstq], xmm1
+%else
     movh     [dstq], m1
+%endif
     add        dstq, mmsize/2
     add       prevq, mmsize/2
     add        curq, mmsize/2
@@ -307,10 +326,10 @@ SECTION .text
 
 %macro YADIF 0
 %if ARCH_X86_32
-cglobal yadif_filter_line_16bit, 4, 6, 8, 80, dst, prev, cur, next, w, \
+cglobal yadif_filter_line_16bit, 4, 6, 8, 5*mmsize, dst, prev, cur, next, w, \
                                               prefs, mrefs, parity, mode
 %else
-cglobal yadif_filter_line_16bit, 4, 7, 8, 80, dst, prev, cur, next, w, \
+cglobal yadif_filter_line_16bit, 4, 7, 8, 5*mmsize, dst, prev, cur, next, w, \
                                               prefs, mrefs, parity, mode
 %endif
 %if ARCH_X86_32
@@ -335,6 +354,10 @@ cglobal yadif_filter_line_16bit, 4, 7, 8, 80, dst, prev, cur, next, w, \
     RET
 %endmacro
 
+%if HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+YADIF
+%endif
 INIT_XMM sse4
 YADIF
 INIT_XMM ssse3
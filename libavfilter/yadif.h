@@ -19,8 +19,12 @@
 #ifndef AVFILTER_YADIF_H
 #define AVFILTER_YADIF_H
 
+#include "config.h"
 #include "libavutil/pixdesc.h"
 #include "avfilter.h"
+#if CONFIG_OPENCL
+#include "libavutil/opencl.h"
+#endif
 
 enum YADIFMode {
     YADIF_MODE_SEND_FRAME           = 0, ///< send 1 frame for each frame
@@ -40,6 +44,35 @@ enum YADIFDeint {
     YADIF_DEINT_INTERLACED = 1, ///< only deinterlace frames marked as interlaced
 };
 
+#if CONFIG_OPENCL
+
+#define YADIF_OPENCL_FRAMES 3
+
+/**
+ * Device copy of one input frame. The three most recent input frames are
+ * kept on the device, so that each frame is only uploaded once although it
+ * is used as next, cur and prev in turn.
+ */
+typedef struct {
+    cl_mem cl_buf;
+    size_t cl_buf_size;
+    uint8_t *data;          ///< data[0] of the uploaded frame, NULL if unused
+    int linesize[4];
+    int plane_offset[4];
+} YADIFOpenclFrame;
+
+typedef struct {
+    YADIFOpenclFrame frames[YADIF_OPENCL_FRAMES];
+    int newest;             ///< index of the most recently uploaded frame
+    int upload_pending;     ///< an upload was not waited for yet
+    int out_plane_size[4];
+    cl_mem cl_outbuf;
+    size_t cl_outbuf_size;
+    AVOpenCLKernelEnv kernel_env;
+} YADIFOpenclContext;
+
+#endif
+
 typedef struct YADIFContext {
     const AVClass *class;
 
@@ -55,18 +88,25 @@ typedef struct YADIFContext {
     AVFrame *out;
 
     /**
-     * Required alignment for filter_line
+     * Required alignment for filter_line, in bytes
      */
+    int req_align;
     void (*filter_line)(void *dst,
                         void *prev, void *cur, void *next,
                         int w, int prefs, int mrefs, int parity, int mode);
     void (*filter_edges)(void *dst, void *prev, void *cur, void *next,
-                         int w, int prefs, int mrefs, int parity, int mode);
+                         int w, int prefs, int mrefs, int parity, int mode,
+                         int alignment);
 
     const AVPixFmtDescriptor *csp;
     int eof;
     uint8_t *temp_line;
     int temp_line_size;
+
+    int opencl;
+#if CONFIG_OPENCL
+    YADIFOpenclContext opencl_ctx;
+#endif
 } YADIFContext;
 
 void ff_yadif_init_x86(YADIFContext *yadif);
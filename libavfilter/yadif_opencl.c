@@ -0,0 +1,221 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * yadif deinterlacing with OpenCL
+ */
+
+#include "yadif_opencl.h"
+#include "libavutil/common.h"
+#include "libavutil/opencl_internal.h"
+
+static int plane_height(YADIFContext *yadif, int plane, int h)
+{
+    return plane == 1 || plane == 2 ? FF_CEIL_RSHIFT(h, yadif->csp->log2_chroma_h) : h;
+}
+
+static int plane_width(YADIFContext *yadif, int plane, int w)
+{
+    return plane == 1 || plane == 2 ? FF_CEIL_RSHIFT(w, yadif->csp->log2_chroma_w) : w;
+}
+
+/**
+ * Find the device copy of a frame, looking at the most recent uploads
+ * first, as the data pointer of a freed frame may have been reused since.
+ */
+static YADIFOpenclFrame *find_frame(YADIFOpenclContext *opencl_ctx, AVFrame *frame)
+{
+    int i;
+
+    for (i = 0; i < YADIF_OPENCL_FRAMES; i++) {
+        YADIFOpenclFrame *f = &opencl_ctx->frames[(opencl_ctx->newest - i + YADIF_OPENCL_FRAMES) %
+                                                  YADIF_OPENCL_FRAMES];
+        if (f->data && f->data == frame->data[0])
+            return f;
+    }
+    return NULL;
+}
+
+int ff_opencl_yadif_push_frame(AVFilterContext *ctx, AVFrame *frame)
+{
+    YADIFContext *yadif = ctx->priv;
+    YADIFOpenclContext *opencl_ctx = &yadif->opencl_ctx;
+    YADIFOpenclFrame *f = &opencl_ctx->frames[opencl_ctx->newest];
+    int i, ret, plane_size[4];
+    size_t size = 0;
+
+    /* the last frame is duplicated at EOF, it is already on the device */
+    if (f->data && f->data == frame->data[0])
+        return 0;
+
+    /* the caller frees the oldest frame before calling us, so its upload
+       must be done before we start the next one */
+    if (opencl_ctx->upload_pending) {
+        clFinish(opencl_ctx->kernel_env.command_queue);
+        opencl_ctx->upload_pending = 0;
+    }
+
+    opencl_ctx->newest = (opencl_ctx->newest + 1) % YADIF_OPENCL_FRAMES;
+    f = &opencl_ctx->frames[opencl_ctx->newest];
+    f->data = NULL;
+    for (i = 0; i < yadif->csp->nb_components; i++) {
+        if (frame->linesize[i] < 0) {
+            av_log(ctx, AV_LOG_ERROR, "Negative linesizes are not supported with OpenCL\n");
+            return AVERROR(ENOSYS);
+        }
+        f->linesize[i]     = frame->linesize[i];
+        f->plane_offset[i] = size;
+        plane_size[i]      = frame->linesize[i] * plane_height(yadif, i, frame->height);
+        size += plane_size[i];
+    }
+    if (size > f->cl_buf_size) {
+        av_opencl_buffer_release(&f->cl_buf);
+        f->cl_buf_size = 0;
+        ret = av_opencl_buffer_create(&f->cl_buf, size, CL_MEM_READ_ONLY, NULL);
+        if (ret < 0)
+            return ret;
+        f->cl_buf_size = size;
+    }
+    ret = avpriv_opencl_buffer_write_image_async(f->cl_buf, f->cl_buf_size, 0, frame->data,
+                                                 plane_size, yadif->csp->nb_components);
+    if (ret < 0)
+        return ret;
+    f->data = frame->data[0];
+    opencl_ctx->upload_pending = 1;
+    return 0;
+}
+
+int ff_opencl_yadif_filter(AVFilterContext *ctx, AVFrame *dstpic, int parity, int tff)
+{
+    YADIFContext *yadif = ctx->priv;
+    YADIFOpenclContext *opencl_ctx = &yadif->opencl_ctx;
+    YADIFOpenclFrame *prev = find_frame(opencl_ctx, yadif->prev);
+    YADIFOpenclFrame *cur  = find_frame(opencl_ctx, yadif->cur);
+    YADIFOpenclFrame *next = find_frame(opencl_ctx, yadif->next);
+    int i, ret, mode = yadif->mode;
+    size_t size = 0;
+    cl_int status;
+
+    if (!prev || !cur || !next) {
+        av_log(ctx, AV_LOG_ERROR, "Input frame missing on the OpenCL device\n");
+        return AVERROR_BUG;
+    }
+    for (i = 0; i < yadif->csp->nb_components; i++) {
+        opencl_ctx->out_plane_size[i] = dstpic->linesize[i] * plane_height(yadif, i, dstpic->height);
+        size += opencl_ctx->out_plane_size[i];
+    }
+    if (size > opencl_ctx->cl_outbuf_size) {
+        av_opencl_buffer_release(&opencl_ctx->cl_outbuf);
+        opencl_ctx->cl_outbuf_size = 0;
+        ret = av_opencl_buffer_create(&opencl_ctx->cl_outbuf, size, CL_MEM_READ_WRITE, NULL);
+        if (ret < 0)
+            goto fail;
+        opencl_ctx->cl_outbuf_size = size;
+    }
+
+    size = 0;
+    for (i = 0; i < yadif->csp->nb_components; i++) {
+        FFOpenclParam opencl_param = {0};
+        int w = plane_width (yadif, i, dstpic->width);
+        int h = plane_height(yadif, i, dstpic->height);
+        int dst_offset = size;
+        const size_t global_work_size[2] = { w, h };
+
+        opencl_param.ctx    = ctx;
+        opencl_param.kernel = opencl_ctx->kernel_env.kernel;
+        ret = ff_opencl_set_parameter(&opencl_param,
+                                      FF_OPENCL_PARAM_INFO(opencl_ctx->cl_outbuf),
+                                      FF_OPENCL_PARAM_INFO(prev->cl_buf),
+                                      FF_OPENCL_PARAM_INFO(cur->cl_buf),
+                                      FF_OPENCL_PARAM_INFO(next->cl_buf),
+                                      FF_OPENCL_PARAM_INFO(dst_offset),
+                                      FF_OPENCL_PARAM_INFO(prev->plane_offset[i]),
+                                      FF_OPENCL_PARAM_INFO(cur->plane_offset[i]),
+                                      FF_OPENCL_PARAM_INFO(next->plane_offset[i]),
+                                      FF_OPENCL_PARAM_INFO(dstpic->linesize[i]),
+                                      FF_OPENCL_PARAM_INFO(prev->linesize[i]),
+                                      FF_OPENCL_PARAM_INFO(cur->linesize[i]),
+                                      FF_OPENCL_PARAM_INFO(next->linesize[i]),
+                                      FF_OPENCL_PARAM_INFO(w),
+                                      FF_OPENCL_PARAM_INFO(h),
+                                      FF_OPENCL_PARAM_INFO(parity),
+                                      FF_OPENCL_PARAM_INFO(tff),
+                                      FF_OPENCL_PARAM_INFO(mode),
+                                      NULL);
+        if (ret < 0)
+            goto fail;
+        status = clEnqueueNDRangeKernel(opencl_ctx->kernel_env.command_queue,
+                                        opencl_ctx->kernel_env.kernel, 2, NULL,
+                                        global_work_size, NULL, 0, NULL, NULL);
+        if (status != CL_SUCCESS) {
+            av_log(ctx, AV_LOG_ERROR, "OpenCL run kernel error occurred: %s\n", av_opencl_errstr(status));
+            ret = AVERROR_EXTERNAL;
+            goto fail;
+        }
+        size += opencl_ctx->out_plane_size[i];
+    }
+
+    ret = av_opencl_buffer_read_image(dstpic->data, opencl_ctx->out_plane_size,
+                                      yadif->csp->nb_components, opencl_ctx->cl_outbuf,
+                                      opencl_ctx->cl_outbuf_size);
+    if (ret < 0)
+        goto fail;
+    opencl_ctx->upload_pending = 0;
+    return 0;
+fail:
+    clFinish(opencl_ctx->kernel_env.command_queue);
+    opencl_ctx->upload_pending = 0;
+    return ret;
+}
+
+int ff_opencl_yadif_init(AVFilterContext *ctx)
+{
+    int ret;
+    YADIFContext *yadif = ctx->priv;
+
+    if (yadif->opencl_ctx.kernel_env.kernel)
+        return 0;
+    ret = av_opencl_init(NULL);
+    if (ret < 0)
+        return ret;
+    ret = av_opencl_create_kernel(&yadif->opencl_ctx.kernel_env, "yadif");
+    if (ret < 0) {
+        av_log(ctx, AV_LOG_ERROR, "OpenCL failed to create kernel with name 'yadif'\n");
+        av_opencl_uninit();
+        return ret;
+    }
+    return 0;
+}
+
+void ff_opencl_yadif_uninit(AVFilterContext *ctx)
+{
+    YADIFContext *yadif = ctx->priv;
+    YADIFOpenclContext *opencl_ctx = &yadif->opencl_ctx;
+    int i;
+
+    if (!opencl_ctx->kernel_env.kernel)
+        return;
+    if (opencl_ctx->upload_pending)
+        clFinish(opencl_ctx->kernel_env.command_queue);
+    for (i = 0; i < YADIF_OPENCL_FRAMES; i++)
+        av_opencl_buffer_release(&opencl_ctx->frames[i].cl_buf);
+    av_opencl_buffer_release(&opencl_ctx->cl_outbuf);
+    av_opencl_release_kernel(&opencl_ctx->kernel_env);
+    av_opencl_uninit();
+}
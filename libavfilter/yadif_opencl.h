@@ -0,0 +1,35 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFILTER_YADIF_OPENCL_H
+#define AVFILTER_YADIF_OPENCL_H
+
+#include "yadif.h"
+
+int ff_opencl_yadif_init(AVFilterContext *ctx);
+
+void ff_opencl_yadif_uninit(AVFilterContext *ctx);
+
+/**
+ * Upload a new input frame, to be called when it becomes yadif->next.
+ */
+int ff_opencl_yadif_push_frame(AVFilterContext *ctx, AVFrame *frame);
+
+int ff_opencl_yadif_filter(AVFilterContext *ctx, AVFrame *dstpic, int parity, int tff);
+
+#endif /* AVFILTER_YADIF_OPENCL_H */
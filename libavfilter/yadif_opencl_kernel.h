@@ -0,0 +1,140 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFILTER_YADIF_OPENCL_KERNEL_H
+#define AVFILTER_YADIF_OPENCL_KERNEL_H
+
+#include "libavutil/opencl.h"
+
+const char *ff_kernel_yadif_opencl = AV_OPENCL_KERNEL(
+inline int yadif_score(const global unsigned char *cur, int mrefs, int prefs, int j)
+{
+    return abs(cur[mrefs - 1 + j] - cur[prefs - 1 - j]) +
+           abs(cur[mrefs     + j] - cur[prefs     - j]) +
+           abs(cur[mrefs + 1 + j] - cur[prefs + 1 - j]);
+}
+
+kernel void yadif(global unsigned char *dst,
+                  const global unsigned char *prev,
+                  const global unsigned char *cur,
+                  const global unsigned char *next,
+                  int dst_offset,
+                  int prev_offset,
+                  int cur_offset,
+                  int next_offset,
+                  int dst_linesize,
+                  int prev_linesize,
+                  int cur_linesize,
+                  int next_linesize,
+                  int w,
+                  int h,
+                  int parity,
+                  int tff,
+                  int mode)
+{
+    int x = get_global_id(0);
+    int y = get_global_id(1);
+    const global unsigned char *prev2, *next2;
+    int c, d, e, temporal_diff0, temporal_diff1, temporal_diff2, diff, spatial_pred;
+    int mrefs, prefs, prev_mrefs, prev_prefs, next_mrefs, next_prefs, mrefs2, prefs2, nmrefs2, nprefs2;
+
+    if (x >= w || y >= h)
+        return;
+    dst  += dst_offset  + y * dst_linesize  + x;
+    prev += prev_offset + y * prev_linesize + x;
+    cur  += cur_offset  + y * cur_linesize  + x;
+    next += next_offset + y * next_linesize + x;
+
+    if (!((y ^ parity) & 1)) {
+        *dst = *cur;
+        return;
+    }
+
+    mrefs      = y         ? -cur_linesize  : cur_linesize;
+    prefs      = y + 1 < h ?  cur_linesize  : -cur_linesize;
+    prev_mrefs = y         ? -prev_linesize : prev_linesize;
+    prev_prefs = y + 1 < h ?  prev_linesize : -prev_linesize;
+    next_mrefs = y         ? -next_linesize : next_linesize;
+    next_prefs = y + 1 < h ?  next_linesize : -next_linesize;
+    if (parity ^ tff) {
+        prev2  = prev;
+        next2  = cur;
+        mrefs2 = prev_mrefs; prefs2 = prev_prefs;
+        nmrefs2 = mrefs;     nprefs2 = prefs;
+    } else {
+        prev2  = cur;
+        next2  = next;
+        mrefs2 = mrefs;      prefs2 = prefs;
+        nmrefs2 = next_mrefs; nprefs2 = next_prefs;
+    }
+    if (y == 1 || y + 2 == h)
+        mode = 2;
+
+    c = cur[mrefs];
+    d = (prev2[0] + next2[0]) >> 1;
+    e = cur[prefs];
+    temporal_diff0 = abs(prev2[0] - next2[0]);
+    temporal_diff1 = (abs(prev[prev_mrefs] - c) + abs(prev[prev_prefs] - e)) >> 1;
+    temporal_diff2 = (abs(next[next_mrefs] - c) + abs(next[next_prefs] - e)) >> 1;
+    diff = max(max(temporal_diff0 >> 1, temporal_diff1), temporal_diff2);
+    spatial_pred = (c + e) >> 1;
+
+    if (x >= 3 && x < w - 3) {
+        int spatial_score = abs(cur[mrefs - 1] - cur[prefs - 1]) + abs(c - e) +
+                            abs(cur[mrefs + 1] - cur[prefs + 1]) - 1;
+        int score = yadif_score(cur, mrefs, prefs, -1);
+        if (score < spatial_score) {
+            spatial_score = score;
+            spatial_pred  = (cur[mrefs - 1] + cur[prefs + 1]) >> 1;
+            score = yadif_score(cur, mrefs, prefs, -2);
+            if (score < spatial_score) {
+                spatial_score = score;
+                spatial_pred  = (cur[mrefs - 2] + cur[prefs + 2]) >> 1;
+            }
+        }
+        score = yadif_score(cur, mrefs, prefs, 1);
+        if (score < spatial_score) {
+            spatial_score = score;
+            spatial_pred  = (cur[mrefs + 1] + cur[prefs - 1]) >> 1;
+            score = yadif_score(cur, mrefs, prefs, 2);
+            if (score < spatial_score) {
+                spatial_score = score;
+                spatial_pred  = (cur[mrefs + 2] + cur[prefs - 2]) >> 1;
+            }
+        }
+    }
+
+    if (mode < 2) {
+        int b = (prev2[2 * mrefs2] + next2[2 * nmrefs2]) >> 1;
+        int f = (prev2[2 * prefs2] + next2[2 * nprefs2]) >> 1;
+        int maxv = max(max(d - e, d - c), min(b - c, f - e));
+        int minv = min(min(d - e, d - c), max(b - c, f - e));
+
+        diff = max(max(diff, minv), -maxv);
+    }
+
+    if (spatial_pred > d + diff)
+        spatial_pred = d + diff;
+    else if (spatial_pred < d - diff)
+        spatial_pred = d - diff;
+
+    *dst = spatial_pred;
+}
+);
+
+#endif /* AVFILTER_YADIF_OPENCL_KERNEL_H */
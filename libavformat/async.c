@@ -0,0 +1,315 @@
+/*
+ * Asynchronous read-ahead protocol
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Read a nested protocol from a background thread into a ring buffer.
+ *
+ * The ring keeps up to readback_size bytes before the read position, so
+ * that short backward seeks, as done by most demuxers while probing, and
+ * forward seeks into the already read-ahead data are served without going
+ * to the nested protocol. Other seeks are forwarded to the background
+ * thread, which drops the ring content and restarts filling it.
+ */
+
+#include <pthread.h>
+
+#include "libavutil/avassert.h"
+#include "libavutil/avstring.h"
+#include "libavutil/common.h"
+#include "libavutil/mem.h"
+#include "libavutil/opt.h"
+#include "avformat.h"
+#include "url.h"
+
+#define READ_CHUNK_SIZE (64 * 1024)
+
+typedef struct AsyncContext {
+    const AVClass *class;
+    URLContext *inner;
+    int readahead_size;
+    int readback_size;
+
+    uint8_t *ring;
+    int ring_size;
+    int64_t ring_start;         ///< position of the oldest byte in the ring
+    int64_t ring_end;           ///< position after the newest byte in the ring
+    int64_t read_pos;
+    int64_t logical_size;
+
+    int seek_request;
+    int64_t seek_pos;
+    int seek_completed;
+    int64_t seek_ret;
+
+    int io_eof_reached;
+    int io_error;
+    int abort_request;
+
+    AVIOInterruptCB interrupt_callback; ///< of the async URLContext
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond_wakeup_main;
+    pthread_cond_t cond_wakeup_background;
+} AsyncContext;
+
+static int async_check_interrupt(void *arg)
+{
+    URLContext *h    = arg;
+    AsyncContext *c  = h->priv_data;
+
+    return c->abort_request || ff_check_interrupt(&c->interrupt_callback);
+}
+
+static void *async_buffer_task(void *arg)
+{
+    URLContext *h   = arg;
+    AsyncContext *c = h->priv_data;
+
+    pthread_mutex_lock(&c->mutex);
+    while (!c->abort_request) {
+        int64_t keep_from;
+        int offset, size, ret;
+
+        if (c->seek_request) {
+            int64_t pos = c->seek_pos;
+
+            pthread_mutex_unlock(&c->mutex);
+            ret = ffurl_seek(c->inner, pos, SEEK_SET);
+            pthread_mutex_lock(&c->mutex);
+
+            c->seek_request   = 0;
+            c->seek_completed = 1;
+            c->seek_ret       = ret;
+            if (ret >= 0) {
+                c->ring_start     =
+                c->ring_end       =
+                c->read_pos       = ret;
+                c->io_eof_reached = 0;
+                c->io_error       = 0;
+            }
+            pthread_cond_signal(&c->cond_wakeup_main);
+            continue;
+        }
+
+        /* drop what is too far behind the reader to be kept for seeking */
+        keep_from = FFMAX(c->read_pos - c->readback_size, 0);
+        if (c->ring_start < keep_from)
+            c->ring_start = keep_from;
+
+        size   = c->ring_size - (c->ring_end - c->ring_start);
+        offset = c->ring_end % c->ring_size;
+        size   = FFMIN3(size, c->ring_size - offset, READ_CHUNK_SIZE);
+        if (c->io_eof_reached || c->io_error || size <= 0) {
+            pthread_cond_wait(&c->cond_wakeup_background, &c->mutex);
+            continue;
+        }
+
+        /* The reader only accesses [read_pos, ring_end) and ring_start is
+         * only moved by this thread, so the area being filled is ours. */
+        pthread_mutex_unlock(&c->mutex);
+        ret = ffurl_read(c->inner, c->ring + offset, size);
+        pthread_mutex_lock(&c->mutex);
+
+        if (c->seek_request)
+            continue;
+        if (ret > 0)
+            c->ring_end += ret;
+        else if (ret == 0 || ret == AVERROR_EOF)
+            c->io_eof_reached = 1;
+        else
+            c->io_error = ret;
+        pthread_cond_signal(&c->cond_wakeup_main);
+    }
+    pthread_mutex_unlock(&c->mutex);
+
+    return NULL;
+}
+
+static int async_open(URLContext *h, const char *arg, int flags, AVDictionary **options)
+{
+    AsyncContext *c = h->priv_data;
+    AVIOInterruptCB interrupt_callback = { async_check_interrupt, h };
+    int ret;
+
+    if (!av_strstart(arg, "async+", &arg))
+        av_strstart(arg, "async:", &arg);
+
+    if (flags & AVIO_FLAG_WRITE)
+        return AVERROR(ENOSYS);
+
+    c->interrupt_callback = h->interrupt_callback;
+    ret = ffurl_open(&c->inner, arg, flags, &interrupt_callback, options);
+    if (ret < 0) {
+        av_log(h, AV_LOG_ERROR, "Unable to open '%s'\n", arg);
+        return ret;
+    }
+
+    c->ring_size = c->readahead_size + c->readback_size;
+    c->ring      = av_malloc(c->ring_size);
+    if (!c->ring) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+    h->is_streamed  = c->inner->is_streamed;
+    c->logical_size = ffurl_size(c->inner);
+    c->read_pos     =
+    c->ring_start   =
+    c->ring_end     = 0;
+
+    pthread_mutex_init(&c->mutex, NULL);
+    pthread_cond_init(&c->cond_wakeup_main, NULL);
+    pthread_cond_init(&c->cond_wakeup_background, NULL);
+    if ((ret = pthread_create(&c->thread, NULL, async_buffer_task, h))) {
+        av_log(h, AV_LOG_ERROR, "pthread_create failed: %s\n", strerror(ret));
+        ret = AVERROR(ret);
+        pthread_cond_destroy(&c->cond_wakeup_background);
+        pthread_cond_destroy(&c->cond_wakeup_main);
+        pthread_mutex_destroy(&c->mutex);
+        goto fail;
+    }
+
+    return 0;
+fail:
+    av_freep(&c->ring);
+    ffurl_close(c->inner);
+    c->inner = NULL;
+    return ret;
+}
+
+static int async_close(URLContext *h)
+{
+    AsyncContext *c = h->priv_data;
+
+    pthread_mutex_lock(&c->mutex);
+    c->abort_request = 1;
+    pthread_cond_signal(&c->cond_wakeup_background);
+    pthread_mutex_unlock(&c->mutex);
+    pthread_join(c->thread, NULL);
+
+    pthread_cond_destroy(&c->cond_wakeup_background);
+    pthread_cond_destroy(&c->cond_wakeup_main);
+    pthread_mutex_destroy(&c->mutex);
+    av_freep(&c->ring);
+    ffurl_close(c->inner);
+    c->inner = NULL;
+
+    return 0;
+}
+
+static int async_read(URLContext *h, unsigned char *buf, int size)
+{
+    AsyncContext *c = h->priv_data;
+    int ret;
+
+    pthread_mutex_lock(&c->mutex);
+    for (;;) {
+        int64_t avail = c->ring_end - c->read_pos;
+
+        if (avail > 0) {
+            int offset = c->read_pos % c->ring_size;
+
+            ret = FFMIN3(avail, size, c->ring_size - offset);
+            memcpy(buf, c->ring + offset, ret);
+            c->read_pos += ret;
+            pthread_cond_signal(&c->cond_wakeup_background);
+            break;
+        }
+        if (c->io_error) {
+            ret = c->io_error;
+            break;
+        }
+        if (c->io_eof_reached) {
+            ret = AVERROR_EOF;
+            break;
+        }
+        pthread_cond_wait(&c->cond_wakeup_main, &c->mutex);
+    }
+    pthread_mutex_unlock(&c->mutex);
+
+    return ret;
+}
+
+static int64_t async_seek(URLContext *h, int64_t pos, int whence)
+{
+    AsyncContext *c = h->priv_data;
+    int64_t ret;
+
+    whence &= ~AVSEEK_FORCE;
+    if (whence == AVSEEK_SIZE)
+        return c->logical_size;
+    if (whence == SEEK_END) {
+        if (c->logical_size < 0)
+            return AVERROR(ENOSYS);
+        pos += c->logical_size;
+    } else if (whence == SEEK_CUR) {
+        pos += c->read_pos;
+    } else if (whence != SEEK_SET) {
+        return AVERROR(EINVAL);
+    }
+    if (pos < 0)
+        return AVERROR(EINVAL);
+
+    pthread_mutex_lock(&c->mutex);
+    if (pos >= c->ring_start && pos <= c->ring_end) {
+        c->read_pos = pos;
+        pthread_cond_signal(&c->cond_wakeup_background);
+        pthread_mutex_unlock(&c->mutex);
+        return pos;
+    }
+
+    c->seek_request   = 1;
+    c->seek_pos       = pos;
+    c->seek_completed = 0;
+    pthread_cond_signal(&c->cond_wakeup_background);
+    while (!c->seek_completed)
+        pthread_cond_wait(&c->cond_wakeup_main, &c->mutex);
+    ret = c->seek_ret;
+    pthread_mutex_unlock(&c->mutex);
+
+    return ret;
+}
+
+#define OFFSET(x) offsetof(AsyncContext, x)
+#define D AV_OPT_FLAG_DECODING_PARAM
+
+static const AVOption options[] = {
+    { "readahead_size", "size of the data read ahead of the reader", OFFSET(readahead_size), AV_OPT_TYPE_INT, { .i64 = 4 << 20 }, READ_CHUNK_SIZE, INT_MAX / 4, D },
+    { "readback_size",  "size of the data kept behind the reader for seeking back", OFFSET(readback_size), AV_OPT_TYPE_INT, { .i64 = 256 << 10 }, 0, INT_MAX / 4, D },
+    { NULL }
+};
+
+static const AVClass async_context_class = {
+    .class_name = "async",
+    .item_name  = av_default_item_name,
+    .option     = options,
+    .version    = LIBAVUTIL_VERSION_INT,
+};
+
+URLProtocol ff_async_protocol = {
+    .name            = "async",
+    .url_open2       = async_open,
+    .url_read        = async_read,
+    .url_seek        = async_seek,
+    .url_close       = async_close,
+    .priv_data_size  = sizeof(AsyncContext),
+    .priv_data_class = &async_context_class,
+    .flags           = URL_PROTOCOL_FLAG_NESTED_SCHEME,
+};
@@ -881,6 +881,22 @@ typedef struct AVStream {
      */
     int pts_wrap_behavior;
 
+    /**
+     * Delta coded index, used by some demuxers instead of index_entries
+     * for large indexes. av_index_search_timestamp() searches it when set.
+     * NOT PART OF PUBLIC API
+     */
+    struct FFCompactIndex *compact_index;
+
+    /**
+     * Index entries to insert in the middle of index_entries, queued to
+     * be merged in a single pass.
+     * NOT PART OF PUBLIC API
+     */
+    AVIndexEntry *index_hints;
+    int nb_index_hints;
+    unsigned int index_hints_allocated_size;
+
 } AVStream;
 
 AVRational av_stream_get_r_frame_rate(const AVStream *s);
@@ -1040,6 +1056,8 @@ typedef struct AVFormatContext {
 #define AVFMT_FLAG_SORT_DTS    0x10000 ///< try to interleave outputted packets by dts (using this flag can slow demuxing down)
 #define AVFMT_FLAG_PRIV_OPT    0x20000 ///< Enable use of private options by delaying codec open (this could be made default once all code is converted)
 #define AVFMT_FLAG_KEEP_SIDE_DATA 0x40000 ///< Don't merge side data but keep it separate.
+#define AVFMT_FLAG_PKT_POOL    0x80000 ///< Allocate demuxed packets from process-wide buffer pools instead of one malloc per packet
+#define AVFMT_FLAG_LATENCY_TRACE 0x100000 ///< Attach an AV_PKT_DATA_LATENCY_TRACE to the demuxed packets, stamp it in the muxed ones
 
     /**
      * decoding: size of data to probe; encoding: unused.
@@ -1230,6 +1248,23 @@ typedef struct AVFormatContext {
      */
     int flush_packets;
 
+    /**
+     * Maximum wall-clock time (in AV_TIME_BASE units) spent reading and
+     * decoding packets in avformat_find_stream_info(), 0 for no limit.
+     * - encoding: unused
+     * - decoding: Set by user via AVOptions (NO direct access)
+     */
+    int max_analyze_time;
+
+    /**
+     * Number of threads decoding different streams concurrently in
+     * avformat_find_stream_info(). With 1, the packets are decoded as
+     * they are read.
+     * - encoding: unused
+     * - decoding: Set by user via AVOptions (NO direct access)
+     */
+    int probe_threads;
+
     /*****************************************************************
      * All fields below this line are not part of the public API. They
      * may not be used outside of libavformat and can be changed and
@@ -1287,6 +1322,11 @@ typedef struct AVFormatContext {
      * Demuxers can use the flag to detect such changes.
      */
     int io_repositioned;
+
+    /**
+     * Per-stream queues of the packets being interleaved by dts.
+     */
+    struct FFInterleaver *interleaver;
 } AVFormatContext;
 
 /**
@@ -1494,6 +1534,11 @@ AVInputFormat *av_probe_input_format3(AVProbeData *pd, int is_opened, int *score
  * attempt is made. When the maximum probe size is reached, the input format
  * with the highest score is returned.
  *
+ * The demuxers matching the filename extension or the MIME type of the
+ * bytestream are probed first, and accepted without probing the other ones
+ * if they return AVPROBE_SCORE_MAX. The number of probes done is logged at
+ * the debug level.
+ *
  * @param pb the bytestream to probe
  * @param fmt the input format is put here
  * @param filename the filename of the stream
@@ -1733,6 +1778,58 @@ void av_close_input_file(AVFormatContext *s);
  * and set *s to NULL.
  */
 void avformat_close_input(AVFormatContext **s);
+
+/**
+ * @defgroup lavf_fanout Demuxing fan-out
+ * Demux an input once and read its programs from separate contexts.
+ *
+ * Each program of the input, typically a service of an MPEG-TS multiplex,
+ * is read with av_read_frame() from its own AVFormatContext, called a view,
+ * possibly from a different thread for each view. The packets of the
+ * input are read by whichever view runs out of packets first, and queued
+ * to all the views whose program comprises their stream, without copying
+ * their data. The programs no view is opened for are discarded from the
+ * input, which lets the demuxer skip their packets.
+ *
+ * The views add their streams as they appear in the program, with
+ * AVFMTCTX_NOHEADER set. The input context must not be accessed by the
+ * caller anymore until the fan-out is freed.
+ * @{
+ */
+typedef struct AVFormatFanout AVFormatFanout;
+
+/**
+ * Allocate a fan-out reading the opened input ic.
+ *
+ * @param max_queued_packets number of packets queued to a view above which
+ *                           reading the input waits for the view to be read,
+ *                           0 for no limit. It must be 0 if the views are
+ *                           read from a single thread.
+ * @return >= 0 on success, a negative AVERROR on failure
+ */
+int avformat_fanout_alloc(AVFormatFanout **f, AVFormatContext *ic,
+                          int max_queued_packets);
+
+/**
+ * Open a view of a program of the fan-out input.
+ *
+ * @param ps         set to the view, to be closed with avformat_close_input()
+ *                   before freeing the fan-out
+ * @param program_id id of the AVProgram to read, or -1 for all the streams
+ * @return >= 0 on success, a negative AVERROR on failure
+ */
+int avformat_fanout_open_view(AVFormatFanout *f, AVFormatContext **ps,
+                              int program_id);
+
+/**
+ * Free a fan-out and set *f to NULL. All its views must have been closed.
+ * The input context is not closed.
+ */
+void avformat_fanout_free(AVFormatFanout **f);
+
+/**
+ * @}
+ */
 /**
  * @}
  */
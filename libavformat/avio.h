@@ -146,6 +146,13 @@ typedef struct AVIOContext {
      * This field is internal to libavformat and access from outside is not allowed.
      */
     int writeout_count;
+
+    /**
+     * Allocate the payload of packets read with av_get_packet() from the
+     * shared packet buffer pools, see AVFMT_FLAG_PKT_POOL.
+     * This field is internal to libavformat and access from outside is not allowed.
+     */
+    int packet_pool;
 } AVIOContext;
 
 /* unbuffered I/O */
@@ -45,6 +45,19 @@ int ffio_init_context(AVIOContext *s,
  */
 int ffio_read_partial(AVIOContext *s, unsigned char *buf, int size);
 
+/**
+ * Read size bytes from AVIOContext, without copying them if possible.
+ *
+ * If the I/O buffer holds the data, followed by at least
+ * FF_INPUT_BUFFER_PADDING_SIZE bytes, *data is set to point into it,
+ * otherwise the data is read into buf, which must be at least size bytes.
+ * *data is valid until the next operation on the context.
+ *
+ * @return number of bytes read or AVERROR
+ */
+int ffio_read_indirect(AVIOContext *s, unsigned char *buf, int size,
+                       const unsigned char **data);
+
 void ffio_fill(AVIOContext *s, int b, int count);
 
 static av_always_inline void ffio_wfourcc(AVIOContext *pb, const uint8_t *s)
@@ -91,6 +104,27 @@ unsigned long ff_crc04C11DB7_update(unsigned long checksum, const uint8_t *buf,
  */
 int ffio_open_dyn_packet_buf(AVIOContext **s, int max_packet_size);
 
+/**
+ * Open a write only memory stream, stored in a list of fixed size chunks.
+ * Unlike avio_open_dyn_buf(), the data is never moved when the stream grows,
+ * and it is not gathered in a single buffer when the stream is closed.
+ *
+ * @param s new IO context
+ * @return zero if no error.
+ */
+int ffio_open_chunked_dyn_buf(AVIOContext **s);
+
+/**
+ * Write the content of a stream opened with ffio_open_chunked_dyn_buf()
+ * to another IO context, and free it.
+ *
+ * @param s IO context opened with ffio_open_chunked_dyn_buf()
+ * @param dst IO context to write the data to, NULL to discard it
+ * @return the size of the data, or a negative error code if it could
+ *         not be stored
+ */
+int ffio_close_chunked_dyn_buf(AVIOContext *s, AVIOContext *dst);
+
 /**
  * Create and initialize a AVIOContext for accessing the
  * resource referenced by the URLContext h.
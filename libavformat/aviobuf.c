@@ -523,6 +523,19 @@ int avio_read(AVIOContext *s, unsigned char *buf, int size)
     return size1 - size;
 }
 
+int ffio_read_indirect(AVIOContext *s, unsigned char *buf, int size,
+                       const unsigned char **data)
+{
+    if (!s->write_flag &&
+        s->buf_end - s->buf_ptr >= size + FF_INPUT_BUFFER_PADDING_SIZE) {
+        *data = s->buf_ptr;
+        s->buf_ptr += size;
+        return size;
+    }
+    *data = buf;
+    return avio_read(s, buf, size);
+}
+
 int ffio_read_partial(AVIOContext *s, unsigned char *buf, int size)
 {
     int len;
@@ -985,6 +998,102 @@ int ffio_open_dyn_packet_buf(AVIOContext **s, int max_packet_size)
     return url_open_dyn_buf_internal(s, max_packet_size);
 }
 
+/* output in a list of fixed size chunks, never moved once allocated */
+
+#define DYN_CHUNK_SIZE 65536
+
+typedef struct ChunkedDynBuffer {
+    int pos, size;
+    uint8_t **chunks;
+    int nb_chunks, chunks_allocated;
+    uint8_t io_buffer[1024];
+} ChunkedDynBuffer;
+
+static int chunked_dyn_buf_write(void *opaque, uint8_t *buf, int buf_size)
+{
+    ChunkedDynBuffer *d = opaque;
+    int written = 0;
+
+    if (d->pos > INT_MAX - buf_size)
+        return -1;
+
+    while (written < buf_size) {
+        int index  = d->pos / DYN_CHUNK_SIZE;
+        int offset = d->pos % DYN_CHUNK_SIZE;
+        int len    = FFMIN(buf_size - written, DYN_CHUNK_SIZE - offset);
+
+        while (index >= d->nb_chunks) {
+            if (d->nb_chunks == d->chunks_allocated) {
+                int new_allocated = FFMAX(2 * d->chunks_allocated, 8);
+                if (av_reallocp_array(&d->chunks, new_allocated,
+                                      sizeof(*d->chunks)) < 0) {
+                    d->nb_chunks = d->chunks_allocated = 0;
+                    return AVERROR(ENOMEM);
+                }
+                d->chunks_allocated = new_allocated;
+            }
+            if (!(d->chunks[d->nb_chunks] = av_malloc(DYN_CHUNK_SIZE)))
+                return AVERROR(ENOMEM);
+            d->nb_chunks++;
+        }
+        memcpy(d->chunks[index] + offset, buf + written, len);
+        written += len;
+        d->pos  += len;
+    }
+    if (d->pos > d->size)
+        d->size = d->pos;
+    return buf_size;
+}
+
+static int64_t chunked_dyn_buf_seek(void *opaque, int64_t offset, int whence)
+{
+    ChunkedDynBuffer *d = opaque;
+
+    if (whence == SEEK_CUR)
+        offset += d->pos;
+    else if (whence == SEEK_END)
+        offset += d->size;
+    if (offset < 0 || offset > 0x7fffffffLL)
+        return -1;
+    d->pos = offset;
+    return 0;
+}
+
+int ffio_open_chunked_dyn_buf(AVIOContext **s)
+{
+    ChunkedDynBuffer *d = av_mallocz(sizeof(*d));
+
+    if (!d)
+        return AVERROR(ENOMEM);
+    *s = avio_alloc_context(d->io_buffer, sizeof(d->io_buffer), 1, d, NULL,
+                            chunked_dyn_buf_write, chunked_dyn_buf_seek);
+    if (!*s) {
+        av_free(d);
+        return AVERROR(ENOMEM);
+    }
+    return 0;
+}
+
+int ffio_close_chunked_dyn_buf(AVIOContext *s, AVIOContext *dst)
+{
+    ChunkedDynBuffer *d = s->opaque;
+    int i, size, ret;
+
+    avio_flush(s);
+    ret  = s->error;
+    size = d->size;
+    for (i = 0; i < d->nb_chunks; i++) {
+        if (dst && i * DYN_CHUNK_SIZE < size)
+            avio_write(dst, d->chunks[i], FFMIN(size - i * DYN_CHUNK_SIZE,
+                                                DYN_CHUNK_SIZE));
+        av_free(d->chunks[i]);
+    }
+    av_free(d->chunks);
+    av_free(d);
+    av_free(s);
+    return ret < 0 ? ret : size;
+}
+
 int avio_close_dyn_buf(AVIOContext *s, uint8_t **pbuffer)
 {
     DynBuffer *d = s->opaque;
@@ -22,15 +22,27 @@
  */
 
 /**
+ * @file
+ * The data is stored at its own offset in a sparse cache file, and the
+ * ranges which are present are kept in a sorted list. Reads of cached
+ * ranges are served from the file, others seek the inner protocol (which
+ * for HTTP issues a range request) and only fetch up to the next cached
+ * range.
+ *
+ * With the cache_dir option, the file and its list of ranges are kept in
+ * that directory under a name derived from the URL, so that the next
+ * readers of the same URL, including concurrent ones, reuse them.
+ *
  * @TODO
- *      support non continuous caching
- *      support keeping files
  *      support filling with a background thread
  */
 
-#include "libavutil/avassert.h"
 #include "libavutil/avstring.h"
 #include "libavutil/file.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/md5.h"
+#include "libavutil/opt.h"
+#include "libavutil/random_seed.h"
 #include "avformat.h"
 #include <fcntl.h>
 #if HAVE_IO_H
@@ -40,101 +52,357 @@
 #include <unistd.h>
 #endif
 #include <sys/stat.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include "internal.h"
 #include "os_support.h"
 #include "url.h"
 
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+#define INDEX_TAG MKBETAG('F', 'F', 'C', 'I')
+
+typedef struct CacheRange {
+    int64_t start, end;
+} CacheRange;
+
 typedef struct Context {
+    const AVClass *class;
     int fd;
-    int64_t end;
+    int64_t end;                ///< size of the resource, -1 if unknown
     int64_t pos;
+    int64_t inner_pos;
     URLContext *inner;
+
+    CacheRange *ranges;         ///< sorted, non overlapping cached ranges
+    int nb_ranges;
+    unsigned int ranges_size;
+
+    char *cache_dir;
+    char *index_name;
+    int64_t cache_hit, cache_miss;
 } Context;
 
-static int cache_open(URLContext *h, const char *arg, int flags)
+/**
+ * @return index of the last range starting at or before pos, or -1
+ */
+static int find_range(Context *c, int64_t pos)
+{
+    int lo = 0, hi = c->nb_ranges - 1;
+
+    while (lo <= hi) {
+        int mid = (lo + hi) >> 1;
+        if (c->ranges[mid].start <= pos)
+            lo = mid + 1;
+        else
+            hi = mid - 1;
+    }
+    return hi;
+}
+
+static int add_range(Context *c, int64_t start, int64_t end)
 {
+    int i = find_range(c, start);
+
+    if (i >= 0 && c->ranges[i].end >= start) {
+        c->ranges[i].end = FFMAX(c->ranges[i].end, end);
+    } else {
+        CacheRange *ranges = av_fast_realloc(c->ranges, &c->ranges_size,
+                                             (c->nb_ranges + 1) * sizeof(*ranges));
+        if (!ranges)
+            return AVERROR(ENOMEM);
+        c->ranges = ranges;
+        i++;
+        memmove(ranges + i + 1, ranges + i, (c->nb_ranges - i) * sizeof(*ranges));
+        ranges[i].start = start;
+        ranges[i].end   = end;
+        c->nb_ranges++;
+    }
+
+    /* merge the following ranges which are now overlapped */
+    while (i + 1 < c->nb_ranges && c->ranges[i + 1].start <= c->ranges[i].end) {
+        c->ranges[i].end = FFMAX(c->ranges[i].end, c->ranges[i + 1].end);
+        memmove(c->ranges + i + 1, c->ranges + i + 2,
+                (c->nb_ranges - i - 2) * sizeof(*c->ranges));
+        c->nb_ranges--;
+    }
+    return 0;
+}
+
+/**
+ * Add the ranges of the index file to the list, if it was written for a
+ * resource of the same size.
+ */
+static void read_index(URLContext *h)
+{
+    Context *c = h->priv_data;
+    uint8_t buf[16];
+    int fd, i, nb;
+
+    if (c->end < 0 || (fd = open(c->index_name, O_RDONLY | O_BINARY)) < 0)
+        return;
+    if (read(fd, buf, 16) == 16 && AV_RB32(buf) == INDEX_TAG &&
+        AV_RB64(buf + 4) == c->end) {
+        nb = AV_RB32(buf + 12);
+        for (i = 0; i < nb && read(fd, buf, 16) == 16; i++) {
+            int64_t start = AV_RB64(buf), end = AV_RB64(buf + 8);
+            if (start < 0 || end <= start || end > c->end ||
+                add_range(c, start, end) < 0)
+                break;
+        }
+    }
+    close(fd);
+}
+
+static void write_index(URLContext *h)
+{
+    Context *c = h->priv_data;
+    char tmp_name[1024];
+    uint8_t buf[16];
+    int fd, i;
+
+    if (c->end < 0)
+        return;
+    /* keep what has been cached by other readers in the meantime */
+    read_index(h);
+
+    snprintf(tmp_name, sizeof(tmp_name), "%s.%08x", c->index_name,
+             av_get_random_seed());
+    if ((fd = open(tmp_name, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0666)) < 0) {
+        av_log(h, AV_LOG_WARNING, "Failed to write cache index '%s'\n", tmp_name);
+        return;
+    }
+    AV_WB32(buf,      INDEX_TAG);
+    AV_WB64(buf +  4, c->end);
+    AV_WB32(buf + 12, c->nb_ranges);
+    if (write(fd, buf, 16) != 16)
+        i = -1;
+    else
+        for (i = 0; i < c->nb_ranges; i++) {
+            AV_WB64(buf,     c->ranges[i].start);
+            AV_WB64(buf + 8, c->ranges[i].end);
+            if (write(fd, buf, 16) != 16)
+                break;
+        }
+    close(fd);
+
+    /* replace the index atomically, rename() does not replace an existing
+     * file on Windows though */
+    if (i == c->nb_ranges && rename(tmp_name, c->index_name) < 0) {
+        unlink(c->index_name);
+        if (rename(tmp_name, c->index_name) < 0)
+            i = -1;
+    }
+    if (i != c->nb_ranges) {
+        av_log(h, AV_LOG_WARNING, "Failed to write cache index '%s'\n", c->index_name);
+        unlink(tmp_name);
+    }
+}
+
+static int open_cache_file(URLContext *h, const char *url)
+{
+    Context *c = h->priv_data;
     char *buffername;
+    uint8_t md5[16];
+    char hash[33];
+
+    if (!c->cache_dir) {
+        c->fd = av_tempfile("ffcache", &buffername, 0, h);
+        if (c->fd < 0){
+            av_log(h, AV_LOG_ERROR, "Failed to create tempfile\n");
+            return c->fd;
+        }
+
+        unlink(buffername);
+        av_freep(&buffername);
+        return 0;
+    }
+
+    av_md5_sum(md5, url, strlen(url));
+    ff_data_to_hex(hash, md5, sizeof(md5), 1);
+    hash[32] = 0;
+    buffername    = av_asprintf("%s/%s.data", c->cache_dir, hash);
+    c->index_name = av_asprintf("%s/%s.index", c->cache_dir, hash);
+    if (!buffername || !c->index_name) {
+        av_free(buffername);
+        return AVERROR(ENOMEM);
+    }
+    c->fd = open(buffername, O_RDWR | O_CREAT | O_BINARY, 0666);
+    if (c->fd < 0) {
+        int ret = AVERROR(errno);
+        av_log(h, AV_LOG_ERROR, "Failed to open cache file '%s'\n", buffername);
+        av_free(buffername);
+        return ret;
+    }
+    av_free(buffername);
+    return 0;
+}
+
+static int cache_open(URLContext *h, const char *arg, int flags, AVDictionary **options)
+{
     Context *c= h->priv_data;
+    int ret;
 
     av_strstart(arg, "cache:", &arg);
 
-    c->fd = av_tempfile("ffcache", &buffername, 0, h);
-    if (c->fd < 0){
-        av_log(h, AV_LOG_ERROR, "Failed to create tempfile\n");
-        return c->fd;
+    c->fd = -1;
+    if ((ret = ffurl_open(&c->inner, arg, flags, &h->interrupt_callback, options)) < 0)
+        return ret;
+
+    if ((ret = open_cache_file(h, arg)) < 0) {
+        ffurl_close(c->inner);
+        return ret;
     }
 
-    unlink(buffername);
-    av_freep(&buffername);
+    c->end = ffurl_size(c->inner);
+    if (c->end < 0)
+        c->end = -1;
+    if (c->index_name)
+        read_index(h);
+    h->is_streamed = c->inner->is_streamed;
 
-    return ffurl_open(&c->inner, arg, flags, &h->interrupt_callback, NULL);
+    return 0;
 }
 
 static int cache_read(URLContext *h, unsigned char *buf, int size)
 {
     Context *c= h->priv_data;
+    int i = find_range(c, c->pos);
     int r;
 
-    if(c->pos<c->end){
-        r = read(c->fd, buf, FFMIN(size, c->end - c->pos));
-        if(r>0)
+    if (i >= 0 && c->pos < c->ranges[i].end) {
+        size = FFMIN(size, c->ranges[i].end - c->pos);
+        if (lseek(c->fd, c->pos, SEEK_SET) >= 0 &&
+            (r = read(c->fd, buf, size)) > 0) {
             c->pos += r;
-        return (-1 == r)?AVERROR(errno):r;
-    }else{
-        r = ffurl_read(c->inner, buf, size);
-        if(r > 0){
-            int r2= write(c->fd, buf, r);
-            av_assert0(r2==r); // FIXME handle cache failure
-            c->pos += r;
-            c->end += r;
+            c->cache_hit++;
+            return r;
+        }
+        av_log(h, AV_LOG_ERROR, "Failed to read from cache\n");
+        return AVERROR(EIO);
+    }
+
+    if (c->end >= 0 && c->pos >= c->end)
+        return AVERROR_EOF;
+
+    c->cache_miss++;
+    if (c->inner_pos != c->pos) {
+        int64_t pos = ffurl_seek(c->inner, c->pos, SEEK_SET);
+        if (pos < 0) {
+            av_log(h, AV_LOG_ERROR, "Failed to seek to %"PRId64" in the input\n", c->pos);
+            return pos;
         }
+        c->inner_pos = pos;
+    }
+
+    /* do not fetch again what follows */
+    if (i + 1 < c->nb_ranges)
+        size = FFMIN(size, c->ranges[i + 1].start - c->pos);
+
+    r = ffurl_read(c->inner, buf, size);
+    if (r == 0 || r == AVERROR_EOF) {
+        if (c->end < 0)
+            c->end = c->pos;
         return r;
     }
+    if (r < 0)
+        return r;
+
+    if (lseek(c->fd, c->pos, SEEK_SET) < 0 || write(c->fd, buf, r) != r)
+        av_log(h, AV_LOG_WARNING, "Failed to write to cache\n");
+    else
+        add_range(c, c->pos, c->pos + r);
+    c->pos       += r;
+    c->inner_pos += r;
+    return r;
 }
 
 static int64_t cache_seek(URLContext *h, int64_t pos, int whence)
 {
     Context *c= h->priv_data;
+    int i;
 
     if (whence == AVSEEK_SIZE) {
+        if (c->end >= 0)
+            return c->end;
         pos= ffurl_seek(c->inner, pos, whence);
         if(pos <= 0){
             pos= ffurl_seek(c->inner, -1, SEEK_END);
-            ffurl_seek(c->inner, c->end, SEEK_SET);
+            if (ffurl_seek(c->inner, c->inner_pos, SEEK_SET) < 0)
+                c->inner_pos = -1;
             if(pos <= 0)
-                return c->end;
+                return AVERROR(ENOSYS);
         }
-        return pos;
+        return c->end = pos;
     }
 
-    pos= lseek(c->fd, pos, whence);
-    if(pos<0){
-        return pos;
-    }else if(pos <= c->end){
-        c->pos= pos;
+    whence &= ~AVSEEK_FORCE;
+    if (whence == SEEK_CUR) {
+        pos += c->pos;
+    } else if (whence == SEEK_END) {
+        if (c->end < 0)
+            return AVERROR(ENOSYS);
+        pos += c->end;
+    } else if (whence != SEEK_SET) {
+        return AVERROR(EINVAL);
+    }
+    if (pos < 0)
+        return AVERROR(EINVAL);
+
+    /* cached data, or data the input can give without seeking */
+    i = find_range(c, pos);
+    if ((i >= 0 && pos < c->ranges[i].end) || pos == c->inner_pos ||
+        (c->end >= 0 && pos >= c->end)) {
+        c->pos = pos;
         return pos;
-    }else{
-        if(lseek(c->fd, c->pos, SEEK_SET) < 0) {
-            av_log(h, AV_LOG_ERROR, "Failure to seek in cache\n");
-        }
-        return AVERROR(EPIPE);
     }
+
+    pos = ffurl_seek(c->inner, pos, SEEK_SET);
+    if (pos >= 0)
+        c->pos = c->inner_pos = pos;
+    return pos;
 }
 
 static int cache_close(URLContext *h)
 {
     Context *c= h->priv_data;
+
+    av_log(h, AV_LOG_DEBUG, "Statistics, cache hits:%"PRId64" cache misses:%"PRId64"\n",
+           c->cache_hit, c->cache_miss);
+
+    if (c->index_name)
+        write_index(h);
     close(c->fd);
     ffurl_close(c->inner);
+    av_freep(&c->ranges);
+    av_freep(&c->index_name);
 
     return 0;
 }
 
+#define OFFSET(x) offsetof(Context, x)
+#define D AV_OPT_FLAG_DECODING_PARAM
+
+static const AVOption options[] = {
+    { "cache_dir", "directory where the cached data is kept and shared", OFFSET(cache_dir), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, D },
+    { NULL }
+};
+
+static const AVClass cache_context_class = {
+    .class_name = "Cache",
+    .item_name  = av_default_item_name,
+    .option     = options,
+    .version    = LIBAVUTIL_VERSION_INT,
+};
+
 URLProtocol ff_cache_protocol = {
     .name                = "cache",
-    .url_open            = cache_open,
+    .url_open2           = cache_open,
     .url_read            = cache_read,
     .url_seek            = cache_seek,
     .url_close           = cache_close,
     .priv_data_size      = sizeof(Context),
+    .priv_data_class     = &cache_context_class,
 };
@@ -0,0 +1,317 @@
+/*
+ * Compact stream index
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Delta coded storage for large, append-only stream indexes.
+ *
+ * The entries are grouped in blocks of CINDEX_BLOCK_SIZE. Each block keeps
+ * the position and timestamp of its first entry uncoded, so that a search
+ * can bisect the blocks without decoding them. Inside a block, each entry
+ * is stored as four variable length fields, predicted from the previous
+ * entry: the next position is expected right after the previous sample,
+ * the next timestamp one previous duration later, the size and the
+ * distance to the keyframe are coded as differences. A typical entry takes
+ * 4 to 6 bytes instead of sizeof(AVIndexEntry).
+ *
+ * The entries of the last accessed block are kept decoded, so that
+ * sequential accesses only decode each block once.
+ */
+
+#include "libavutil/avassert.h"
+#include "libavutil/mem.h"
+#include "avformat.h"
+#include "internal.h"
+
+#define CINDEX_BLOCK_BITS 6
+#define CINDEX_BLOCK_SIZE (1 << CINDEX_BLOCK_BITS)
+#define CINDEX_MAX_ENTRY_SIZE 40 ///< 4 fields of at most 10 bytes
+
+typedef struct CIndexBlock {
+    int64_t pos;
+    int64_t timestamp;
+    unsigned offset;            ///< offset of the first entry in data
+} CIndexBlock;
+
+typedef struct FFCompactIndex {
+    CIndexBlock *blocks;
+    unsigned blocks_allocated_size;
+    uint8_t *data;
+    unsigned data_size;
+    unsigned data_allocated_size;
+    int nb_entries;
+
+    AVIndexEntry last;          ///< last appended entry
+    int64_t last_duration;
+
+    int cache_block;            ///< block held in cache, -1 if none
+    AVIndexEntry cache[CINDEX_BLOCK_SIZE];
+} FFCompactIndex;
+
+static inline uint64_t zigzag(int64_t v)
+{
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static inline int64_t unzigzag(uint64_t v)
+{
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static uint8_t *put_v(uint8_t *p, uint64_t v)
+{
+    while (v >= 0x80) {
+        *p++ = v | 0x80;
+        v >>= 7;
+    }
+    *p++ = v;
+    return p;
+}
+
+static const uint8_t *get_v(const uint8_t *p, uint64_t *v)
+{
+    uint64_t val = 0;
+    int shift = 0;
+
+    do {
+        val |= (uint64_t)(*p & 0x7F) << shift;
+        shift += 7;
+    } while (*p++ & 0x80);
+    *v = val;
+    return p;
+}
+
+/**
+ * Reset the prediction state at the start of a block.
+ */
+static void block_start(const CIndexBlock *b, AVIndexEntry *prev,
+                        int64_t *duration)
+{
+    prev->pos          = b->pos;
+    prev->timestamp    = b->timestamp;
+    prev->size         = 0;
+    prev->min_distance = -1;
+    prev->flags        = 0;
+    *duration          = 0;
+}
+
+int ff_compact_index_add(AVStream *st, int64_t pos, int64_t timestamp,
+                         int size, int distance, int flags)
+{
+    FFCompactIndex *ci = st->compact_index;
+    AVIndexEntry *prev;
+    uint8_t *p;
+    void *tmp;
+
+    if (!ci) {
+        ci = av_mallocz(sizeof(*ci));
+        if (!ci)
+            return AVERROR(ENOMEM);
+        ci->cache_block   = -1;
+        st->compact_index = ci;
+    }
+    if (ci->nb_entries == INT_MAX ||
+        ci->data_size > UINT_MAX - CINDEX_MAX_ENTRY_SIZE - 1)
+        return AVERROR(ENOMEM);
+
+    if (!(ci->nb_entries & (CINDEX_BLOCK_SIZE - 1))) {
+        int nb_blocks = ci->nb_entries >> CINDEX_BLOCK_BITS;
+        CIndexBlock *b;
+
+        if (nb_blocks + 1 >= UINT_MAX / sizeof(*ci->blocks))
+            return AVERROR(ENOMEM);
+        tmp = av_fast_realloc(ci->blocks, &ci->blocks_allocated_size,
+                              (nb_blocks + 1) * sizeof(*ci->blocks));
+        if (!tmp)
+            return AVERROR(ENOMEM);
+        ci->blocks = tmp;
+        b = &ci->blocks[nb_blocks];
+        b->pos       = pos;
+        b->timestamp = timestamp;
+        b->offset    = ci->data_size;
+        block_start(b, &ci->last, &ci->last_duration);
+    }
+
+    tmp = av_fast_realloc(ci->data, &ci->data_allocated_size,
+                          ci->data_size + CINDEX_MAX_ENTRY_SIZE);
+    if (!tmp)
+        return AVERROR(ENOMEM);
+    ci->data = tmp;
+
+    /* Differences are taken modulo 2^64 so that any input is coded losslessly. */
+    prev = &ci->last;
+    p = ci->data + ci->data_size;
+    p = put_v(p, zigzag((int64_t)((uint64_t)distance - prev->min_distance - 1)) << 2 |
+                 (flags & 3));
+    p = put_v(p, zigzag((int64_t)((uint64_t)pos - prev->pos - prev->size)));
+    p = put_v(p, zigzag((int64_t)((uint64_t)timestamp - prev->timestamp -
+                                  ci->last_duration)));
+    p = put_v(p, zigzag((int64_t)size - prev->size));
+    ci->data_size = p - ci->data;
+
+    ci->last_duration  = (uint64_t)timestamp - prev->timestamp;
+    prev->pos          = pos;
+    prev->timestamp    = timestamp;
+    prev->size         = size;
+    prev->min_distance = distance;
+    prev->flags        = flags;
+
+    if ((ci->nb_entries >> CINDEX_BLOCK_BITS) == ci->cache_block)
+        ci->cache[ci->nb_entries & (CINDEX_BLOCK_SIZE - 1)] = *prev;
+
+    return ci->nb_entries++;
+}
+
+static void decode_block(FFCompactIndex *ci, int block)
+{
+    const CIndexBlock *b = &ci->blocks[block];
+    const uint8_t *p = ci->data + b->offset;
+    int n = FFMIN(ci->nb_entries - (block << CINDEX_BLOCK_BITS), CINDEX_BLOCK_SIZE);
+    AVIndexEntry prev;
+    int64_t duration;
+    uint64_t v;
+    int i;
+
+    block_start(b, &prev, &duration);
+    for (i = 0; i < n; i++) {
+        AVIndexEntry *e = &ci->cache[i];
+
+        p = get_v(p, &v);
+        e->flags        = v & 3;
+        e->min_distance = (uint64_t)prev.min_distance + 1 + unzigzag(v >> 2);
+        p = get_v(p, &v);
+        e->pos          = (uint64_t)prev.pos + prev.size + unzigzag(v);
+        p = get_v(p, &v);
+        e->timestamp    = (uint64_t)prev.timestamp + duration + unzigzag(v);
+        p = get_v(p, &v);
+        e->size         = prev.size + unzigzag(v);
+
+        duration = (uint64_t)e->timestamp - prev.timestamp;
+        prev     = *e;
+    }
+    ci->cache_block = block;
+}
+
+int ff_compact_index_count(const AVStream *st)
+{
+    return st->compact_index ? st->compact_index->nb_entries : 0;
+}
+
+const AVIndexEntry *ff_compact_index_get(AVStream *st, int index)
+{
+    FFCompactIndex *ci = st->compact_index;
+    int block;
+
+    av_assert1(ci && index >= 0 && index < ci->nb_entries);
+
+    block = index >> CINDEX_BLOCK_BITS;
+    if (block != ci->cache_block)
+        decode_block(ci, block);
+    return &ci->cache[index & (CINDEX_BLOCK_SIZE - 1)];
+}
+
+static int64_t entry_timestamp(AVStream *st, int index)
+{
+    if (!(index & (CINDEX_BLOCK_SIZE - 1)))
+        return st->compact_index->blocks[index >> CINDEX_BLOCK_BITS].timestamp;
+    return ff_compact_index_get(st, index)->timestamp;
+}
+
+int ff_compact_index_search_timestamp(AVStream *st, int64_t wanted_timestamp,
+                                      int flags)
+{
+    FFCompactIndex *ci = st->compact_index;
+    int nb_entries = ff_compact_index_count(st);
+    int a, b, m;
+    int64_t timestamp;
+
+    if (!nb_entries)
+        return -1;
+
+    /* Bisect the block heads first, this leaves a single block to decode.
+     * The bounds are those of ff_index_search_timestamp(): entry a is not
+     * after the wanted timestamp, entry b is not before it. */
+    if (ci->last.timestamp < wanted_timestamp) {
+        a = nb_entries - 1;
+        b = nb_entries;
+    } else {
+        int lo = -1, hi = ((nb_entries - 1) >> CINDEX_BLOCK_BITS) + 1;
+        while (hi - lo > 1) {
+            m = (lo + hi) >> 1;
+            if (ci->blocks[m].timestamp <= wanted_timestamp)
+                lo = m;
+            else
+                hi = m;
+        }
+        a = lo < 0 ? -1 : lo << CINDEX_BLOCK_BITS;
+        b = FFMIN(hi << CINDEX_BLOCK_BITS, nb_entries);
+        if (a >= 0 && ci->blocks[lo].timestamp == wanted_timestamp)
+            b = a;
+    }
+
+    while (b - a > 1) {
+        m = (a + b) >> 1;
+        timestamp = entry_timestamp(st, m);
+        if (timestamp >= wanted_timestamp)
+            b = m;
+        if (timestamp <= wanted_timestamp)
+            a = m;
+    }
+    m = (flags & AVSEEK_FLAG_BACKWARD) ? a : b;
+
+    if (!(flags & AVSEEK_FLAG_ANY)) {
+        while (m >= 0 && m < nb_entries &&
+               !(ff_compact_index_get(st, m)->flags & AVINDEX_KEYFRAME)) {
+            m += (flags & AVSEEK_FLAG_BACKWARD) ? -1 : 1;
+        }
+    }
+
+    if (m == nb_entries)
+        return -1;
+    return m;
+}
+
+int ff_compact_index_expand(AVStream *st)
+{
+    int i, ret, nb_entries = ff_compact_index_count(st);
+
+    for (i = 0; i < nb_entries; i++) {
+        const AVIndexEntry *e = ff_compact_index_get(st, i);
+        ret = ff_add_index_entry(&st->index_entries, &st->nb_index_entries,
+                                 &st->index_entries_allocated_size,
+                                 e->pos, e->timestamp, e->size,
+                                 e->min_distance, e->flags);
+        if (ret < 0)
+            return ret;
+    }
+    ff_compact_index_free(st);
+    return 0;
+}
+
+void ff_compact_index_free(AVStream *st)
+{
+    FFCompactIndex *ci = st->compact_index;
+
+    if (!ci)
+        return;
+    av_freep(&ci->blocks);
+    av_freep(&ci->data);
+    av_freep(&st->compact_index);
+}
@@ -18,6 +18,11 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include "config.h"
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
 #include "libavutil/avstring.h"
 #include "libavutil/opt.h"
 #include "libavutil/parseutils.h"
@@ -38,6 +43,17 @@ typedef struct {
     AVFormatContext *avf;
     int safe;
     int seekable;
+    int preopen;
+    int trust_params;
+#if HAVE_PTHREADS
+    pthread_t preopen_thread;
+    int preopen_running;
+#endif
+    unsigned preopen_fileno;
+    AVFormatContext *preopen_avf;
+    int preopen_abort;
+    int64_t first_start;    ///< start time of the first file
+    int64_t file_end;       ///< end of the last packet read from the current file
 } ConcatContext;
 
 static int concat_probe(AVProbeData *probe)
@@ -123,24 +139,117 @@ fail:
     return ret;
 }
 
+static int preopen_interrupt_cb(void *opaque)
+{
+    ConcatContext *cat = opaque;
+    return cat->preopen_abort;
+}
+
+static int open_input(ConcatContext *cat, unsigned fileno,
+                      AVFormatContext **avf, int background)
+{
+    int ret;
+
+    if (!(*avf = avformat_alloc_context()))
+        return AVERROR(ENOMEM);
+    if (background) {
+        (*avf)->interrupt_callback.callback = preopen_interrupt_cb;
+        (*avf)->interrupt_callback.opaque   = cat;
+    }
+    if ((ret = avformat_open_input(avf, cat->files[fileno].url, NULL, NULL)) < 0)
+        return ret;
+    if (!(fileno && cat->trust_params) &&
+        (ret = avformat_find_stream_info(*avf, NULL)) < 0) {
+        avformat_close_input(avf);
+        return ret;
+    }
+    return 0;
+}
+
+#if HAVE_PTHREADS
+static void *preopen_thread(void *arg)
+{
+    ConcatContext *cat = arg;
+
+    if (open_input(cat, cat->preopen_fileno, &cat->preopen_avf, 1) < 0)
+        cat->preopen_avf = NULL;
+    return NULL;
+}
+#endif
+
+/**
+ * Start opening the file fileno in the background.
+ */
+static void preopen_start(AVFormatContext *avf, unsigned fileno)
+{
+#if HAVE_PTHREADS
+    ConcatContext *cat = avf->priv_data;
+
+    if (!cat->preopen || cat->preopen_running || fileno >= cat->nb_files)
+        return;
+    cat->preopen_fileno = fileno;
+    cat->preopen_avf    = NULL;
+    cat->preopen_abort  = 0;
+    if (pthread_create(&cat->preopen_thread, NULL, preopen_thread, cat)) {
+        av_log(avf, AV_LOG_WARNING, "Could not start pre-opening '%s'\n",
+               cat->files[fileno].url);
+        return;
+    }
+    cat->preopen_running = 1;
+#endif
+}
+
+/**
+ * Wait for the file being opened in the background.
+ *
+ * @param abort interrupt the opening instead of waiting for it to finish
+ * @return the opened file if it is fileno, NULL otherwise
+ */
+static AVFormatContext *preopen_finish(ConcatContext *cat, unsigned fileno,
+                                       int abort)
+{
+    AVFormatContext *ret = NULL;
+
+#if HAVE_PTHREADS
+    if (!cat->preopen_running)
+        return NULL;
+    cat->preopen_abort = abort;
+    pthread_join(cat->preopen_thread, NULL);
+    cat->preopen_running = 0;
+    if (!abort && cat->preopen_fileno == fileno)
+        FFSWAP(AVFormatContext *, ret, cat->preopen_avf);
+    if (cat->preopen_avf)
+        avformat_close_input(&cat->preopen_avf);
+#endif
+    return ret;
+}
+
 static int open_file(AVFormatContext *avf, unsigned fileno)
 {
     ConcatContext *cat = avf->priv_data;
     ConcatFile *file = &cat->files[fileno];
+    AVFormatContext *new_avf;
     int ret;
 
-    if (cat->avf)
+    if (!(new_avf = preopen_finish(cat, fileno, 0))) {
+        if (cat->avf)
+            avformat_close_input(&cat->avf);
+        if ((ret = open_input(cat, fileno, &new_avf, 0)) < 0) {
+            av_log(avf, AV_LOG_ERROR, "Impossible to open '%s'\n", file->url);
+            return ret;
+        }
+    } else if (cat->avf)
         avformat_close_input(&cat->avf);
-    if ((ret = avformat_open_input(&cat->avf, file->url, NULL, NULL)) < 0 ||
-        (ret = avformat_find_stream_info(cat->avf, NULL)) < 0) {
-        av_log(avf, AV_LOG_ERROR, "Impossible to open '%s'\n", file->url);
-        return ret;
-    }
+    cat->avf = new_avf;
     cat->cur_file = file;
+    cat->file_end = AV_NOPTS_VALUE;
+    if (!fileno)
+        cat->first_start = new_avf->start_time;
     if (file->start_time == AV_NOPTS_VALUE)
         file->start_time = !fileno ? 0 :
                            cat->files[fileno - 1].start_time +
                            cat->files[fileno - 1].duration;
+    preopen_start(avf, fileno + 1);
     return 0;
 }
 
@@ -149,6 +258,7 @@ static int concat_read_close(AVFormatContext *avf)
     ConcatContext *cat = avf->priv_data;
     unsigned i;
 
+    preopen_finish(cat, 0, 1);
     if (cat->avf)
         avformat_close_input(&cat->avf);
     for (i = 0; i < cat->nb_files; i++)
@@ -254,6 +364,30 @@ fail:
     return ret;
 }
 
+/**
+ * Start time of the current file. Without avformat_find_stream_info(), it
+ * is assumed to be the same as for the first file.
+ */
+static int64_t file_start_time(ConcatContext *cat)
+{
+    if (cat->avf->start_time != AV_NOPTS_VALUE)
+        return cat->avf->start_time;
+    return cat->first_start != AV_NOPTS_VALUE ? cat->first_start : 0;
+}
+
+static void update_file_times(ConcatContext *cat, AVPacket *pkt)
+{
+    AVRational tb = cat->avf->streams[pkt->stream_index]->time_base;
+    int64_t ts = pkt->dts != AV_NOPTS_VALUE ? pkt->dts : pkt->pts;
+
+    if (ts == AV_NOPTS_VALUE)
+        return;
+    ts = av_rescale_q(ts, tb, AV_TIME_BASE_Q) +
+         av_rescale_q(pkt->duration, tb, AV_TIME_BASE_Q);
+    if (cat->file_end == AV_NOPTS_VALUE || ts > cat->file_end)
+        cat->file_end = ts;
+}
+
 static int open_next_file(AVFormatContext *avf)
 {
     ConcatContext *cat = avf->priv_data;
@@ -261,6 +395,9 @@ static int open_next_file(AVFormatContext *avf)
 
     if (cat->cur_file->duration == AV_NOPTS_VALUE)
         cat->cur_file->duration = cat->avf->duration;
+    if (cat->cur_file->duration == AV_NOPTS_VALUE &&
+        cat->file_end != AV_NOPTS_VALUE)
+        cat->cur_file->duration = cat->file_end - file_start_time(cat);
 
     if (++fileno >= cat->nb_files)
         return AVERROR_EOF;
@@ -278,7 +415,10 @@ static int concat_read_packet(AVFormatContext *avf, AVPacket *pkt)
             (ret = open_next_file(avf)) < 0)
             break;
     }
-    delta = av_rescale_q(cat->cur_file->start_time - cat->avf->start_time,
+    if (ret < 0)
+        return ret;
+    update_file_times(cat, pkt);
+    delta = av_rescale_q(cat->cur_file->start_time - file_start_time(cat),
                          AV_TIME_BASE_Q,
                          cat->avf->streams[pkt->stream_index]->time_base);
     if (pkt->pts != AV_NOPTS_VALUE)
@@ -302,7 +442,7 @@ static int try_seek(AVFormatContext *avf, int stream,
                     int64_t min_ts, int64_t ts, int64_t max_ts, int flags)
 {
     ConcatContext *cat = avf->priv_data;
-    int64_t t0 = cat->cur_file->start_time - cat->avf->start_time;
+    int64_t t0 = cat->cur_file->start_time - file_start_time(cat);
 
     ts -= t0;
     min_ts = min_ts == INT64_MIN ? INT64_MIN : min_ts - t0;
@@ -383,6 +523,10 @@ static int concat_seek(AVFormatContext *avf, int stream,
 static const AVOption options[] = {
     { "safe", "enable safe mode",
       OFFSET(safe), AV_OPT_TYPE_INT, {.i64 = -1}, -1, 1, DEC },
+    { "preopen", "open the next file in the background",
+      OFFSET(preopen), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1, DEC },
+    { "trust_params", "use the stream parameters of the first file instead of probing the next ones",
+      OFFSET(trust_params), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1, DEC },
     { NULL }
 };
 
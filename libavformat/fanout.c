@@ -0,0 +1,474 @@
+/*
+ * Demuxing fan-out
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Read the packets of an input once and queue them to several views, each
+ * a demuxer context returning the packets of one program of the input.
+ *
+ * There is no thread of its own: a view whose queue is empty takes the
+ * right to read the input, reads one packet and queues it to the views
+ * it belongs to. The same right is taken to access the input for opening
+ * and closing the views, so that the input is only used by one thread at
+ * a time.
+ */
+
+#include "config.h"
+
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
+#include "libavutil/avassert.h"
+#include "libavutil/avstring.h"
+#include "libavutil/time.h"
+#include "avformat.h"
+#include "internal.h"
+#include "url.h"
+
+/** stream of the input to add to a view */
+typedef struct FanoutStream {
+    AVCodecContext *codec;
+    AVRational time_base;
+    int id;
+    int disposition;
+    AVDictionary *metadata;
+    struct FanoutStream *next;
+} FanoutStream;
+
+typedef struct FanoutView {
+    AVFormatFanout *fanout;
+    AVFormatContext *ctx;
+    int program_id;
+    int *stream_map;            ///< view stream index of each input stream, or -1
+    int nb_stream_map;
+    int nb_streams;             ///< number of streams added or pending
+    FanoutStream *new_streams;  ///< streams to add before returning packets
+    FanoutStream **new_streams_end;
+    AVPacketList *queue, *queue_end;
+    int nb_queued;
+    int closed;
+} FanoutView;
+
+struct AVFormatFanout {
+    AVFormatContext *ic;
+    int max_queued;
+    FanoutView **views;
+    int nb_views;
+    int views_changed;          ///< the programs to discard must be updated
+    int nb_programs;            ///< number of input programs when last updated
+    int input_busy;             ///< the input is being accessed by a thread
+    int error;                  ///< error or EOF reading the input
+#if HAVE_PTHREADS
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+#endif
+};
+
+static void fanout_lock(AVFormatFanout *f)
+{
+#if HAVE_PTHREADS
+    pthread_mutex_lock(&f->mutex);
+#endif
+}
+
+static void fanout_unlock(AVFormatFanout *f)
+{
+#if HAVE_PTHREADS
+    pthread_mutex_unlock(&f->mutex);
+#endif
+}
+
+static void fanout_signal(AVFormatFanout *f)
+{
+#if HAVE_PTHREADS
+    pthread_cond_broadcast(&f->cond);
+#endif
+}
+
+/**
+ * Wait for a change signaled by another thread, at most 100 ms so that
+ * the caller can check its interrupt callback.
+ */
+static void fanout_wait(AVFormatFanout *f)
+{
+#if HAVE_PTHREADS
+    int64_t t = av_gettime() + 100000;
+    struct timespec tv = { t / 1000000, (t % 1000000) * 1000 };
+    pthread_cond_timedwait(&f->cond, &f->mutex, &tv);
+#endif
+}
+
+/** Take the right to access the input, with the lock held. */
+static void acquire_input(AVFormatFanout *f)
+{
+    while (f->input_busy)
+        fanout_wait(f);
+    f->input_busy = 1;
+}
+
+static void release_input(AVFormatFanout *f)
+{
+    f->input_busy = 0;
+    fanout_signal(f);
+}
+
+static void free_stream(FanoutStream *fs)
+{
+    av_freep(&fs->codec->extradata);
+    av_freep(&fs->codec->subtitle_header);
+    av_freep(&fs->codec);
+    av_dict_free(&fs->metadata);
+    av_free(fs);
+}
+
+static int view_has_stream(AVFormatFanout *f, FanoutView *v, int index)
+{
+    AVFormatContext *ic = f->ic;
+    int i, j;
+
+    if (v->program_id < 0)
+        return 1;
+    for (i = 0; i < ic->nb_programs; i++) {
+        AVProgram *p = ic->programs[i];
+        if (p->id != v->program_id)
+            continue;
+        for (j = 0; j < p->nb_stream_indexes; j++)
+            if (p->stream_index[j] == index)
+                return 1;
+    }
+    return 0;
+}
+
+/**
+ * Get the view stream index of an input stream, queuing the stream to be
+ * added to the view the first time.
+ */
+static int map_stream(AVFormatFanout *f, FanoutView *v, int index)
+{
+    AVStream *st = f->ic->streams[index];
+    FanoutStream *fs;
+
+    if (index >= v->nb_stream_map) {
+        int i, *map = av_realloc(v->stream_map, f->ic->nb_streams * sizeof(*map));
+        if (!map)
+            return AVERROR(ENOMEM);
+        for (i = v->nb_stream_map; i < f->ic->nb_streams; i++)
+            map[i] = -1;
+        v->stream_map    = map;
+        v->nb_stream_map = f->ic->nb_streams;
+    }
+    if (v->stream_map[index] >= 0)
+        return v->stream_map[index];
+
+    if (!(fs = av_mallocz(sizeof(*fs))))
+        return AVERROR(ENOMEM);
+    if (!(fs->codec = avcodec_alloc_context3(NULL)) ||
+        avcodec_copy_context(fs->codec, st->codec) < 0) {
+        av_free(fs->codec);
+        av_free(fs);
+        return AVERROR(ENOMEM);
+    }
+    fs->time_base   = st->time_base;
+    fs->id          = st->id;
+    fs->disposition = st->disposition;
+    av_dict_copy(&fs->metadata, st->metadata, 0);
+    *v->new_streams_end = fs;
+    v->new_streams_end  = &fs->next;
+    return v->stream_map[index] = v->nb_streams++;
+}
+
+/** Discard the programs of the input no view is reading. */
+static void update_discard(AVFormatFanout *f)
+{
+    AVFormatContext *ic = f->ic;
+    int i, j, all = 0;
+
+    for (i = 0; i < f->nb_views; i++)
+        all |= f->views[i]->program_id < 0;
+    for (i = 0; i < ic->nb_programs; i++) {
+        AVProgram *p = ic->programs[i];
+        int used = all;
+        for (j = 0; j < f->nb_views && !used; j++)
+            used = f->views[j]->program_id == p->id;
+        p->discard = used ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+    }
+    f->nb_programs   = ic->nb_programs;
+    f->views_changed = 0;
+}
+
+/**
+ * Read a packet from the input and queue it to the views, with the right
+ * to access the input taken and the lock held.
+ */
+static int read_input(AVFormatFanout *f)
+{
+    AVPacket pkt;
+    int i, ret;
+
+    fanout_unlock(f);
+    ret = av_read_frame(f->ic, &pkt);
+    if (ret >= 0)
+        ret = av_dup_packet(&pkt);
+    fanout_lock(f);
+    if (ret < 0)
+        return ret;
+
+    if (f->views_changed || f->nb_programs != f->ic->nb_programs)
+        update_discard(f);
+
+    for (i = 0; i < f->nb_views; i++) {
+        FanoutView *v = f->views[i];
+        AVPacketList *pktl;
+        int index;
+
+        if (!view_has_stream(f, v, pkt.stream_index))
+            continue;
+        if ((index = map_stream(f, v, pkt.stream_index)) < 0) {
+            ret = index;
+            break;
+        }
+#if HAVE_PTHREADS
+        while (f->max_queued && v->nb_queued >= f->max_queued && !v->closed)
+            fanout_wait(f);
+        if (v->closed)
+            continue;
+#endif
+        if (!(pktl = av_mallocz(sizeof(*pktl))) ||
+            av_copy_packet(&pktl->pkt, &pkt) < 0) {
+            av_free(pktl);
+            ret = AVERROR(ENOMEM);
+            break;
+        }
+        pktl->pkt.stream_index = index;
+        if (v->queue_end)
+            v->queue_end->next = pktl;
+        else
+            v->queue = pktl;
+        v->queue_end = pktl;
+        v->nb_queued++;
+    }
+    av_free_packet(&pkt);
+    fanout_signal(f);
+    return ret;
+}
+
+static int add_new_streams(FanoutView *v)
+{
+    while (v->new_streams) {
+        FanoutStream *fs = v->new_streams;
+        AVStream *st = avformat_new_stream(v->ctx, NULL);
+        if (!st || avcodec_copy_context(st->codec, fs->codec) < 0)
+            return AVERROR(ENOMEM);
+        avpriv_set_pts_info(st, 64, fs->time_base.num, fs->time_base.den);
+        st->id          = fs->id;
+        st->disposition = fs->disposition;
+        av_dict_copy(&st->metadata, fs->metadata, 0);
+
+        if (!(v->new_streams = fs->next))
+            v->new_streams_end = &v->new_streams;
+        free_stream(fs);
+    }
+    return 0;
+}
+
+static int fanout_read_packet(AVFormatContext *s, AVPacket *pkt)
+{
+    FanoutView *v = *(FanoutView **)s->priv_data;
+    AVFormatFanout *f = v->fanout;
+    int ret;
+
+    fanout_lock(f);
+    for (;;) {
+        if ((ret = add_new_streams(v)) < 0)
+            break;
+        if (v->queue) {
+            AVPacketList *pktl = v->queue;
+            *pkt = pktl->pkt;
+            if (!(v->queue = pktl->next))
+                v->queue_end = NULL;
+            v->nb_queued--;
+            av_free(pktl);
+            fanout_signal(f);
+            break;
+        }
+        if (f->error) {
+            ret = f->error;
+            break;
+        }
+        if (!f->input_busy) {
+            f->input_busy = 1;
+            ret = read_input(f);
+            release_input(f);
+            if (ret < 0 && ret != AVERROR(EAGAIN))
+                f->error = ret;
+            if (ret == AVERROR(EAGAIN) && !v->queue)
+                break;
+            continue;
+        }
+        if (ff_check_interrupt(&s->interrupt_callback)) {
+            ret = AVERROR_EXIT;
+            break;
+        }
+        fanout_wait(f);
+    }
+    fanout_unlock(f);
+
+    return ret;
+}
+
+static int fanout_read_close(AVFormatContext *s)
+{
+    FanoutView *v = *(FanoutView **)s->priv_data;
+    AVFormatFanout *f = v->fanout;
+    int i;
+
+    fanout_lock(f);
+    /* wake up a reader waiting for room in the queue of this view */
+    v->closed = 1;
+    fanout_signal(f);
+    acquire_input(f);
+    for (i = 0; i < f->nb_views; i++) {
+        if (f->views[i] == v) {
+            f->views[i] = f->views[--f->nb_views];
+            break;
+        }
+    }
+    f->views_changed = 1;
+    release_input(f);
+    fanout_unlock(f);
+
+    while (v->queue) {
+        AVPacketList *pktl = v->queue;
+        v->queue = pktl->next;
+        av_free_packet(&pktl->pkt);
+        av_free(pktl);
+    }
+    while (v->new_streams) {
+        FanoutStream *fs = v->new_streams;
+        v->new_streams = fs->next;
+        free_stream(fs);
+    }
+    av_free(v->stream_map);
+    av_free(v);
+    return 0;
+}
+
+static AVInputFormat fanout_demuxer = {
+    .name           = "fanout",
+    .long_name      = NULL_IF_CONFIG_SMALL("Demuxing fan-out view"),
+    .priv_data_size = sizeof(FanoutView *),
+    .read_packet    = fanout_read_packet,
+    .read_close     = fanout_read_close,
+    .flags          = AVFMT_NOFILE,
+};
+
+int avformat_fanout_alloc(AVFormatFanout **pf, AVFormatContext *ic,
+                          int max_queued_packets)
+{
+    AVFormatFanout *f;
+
+    *pf = NULL;
+    if (!(f = av_mallocz(sizeof(*f))))
+        return AVERROR(ENOMEM);
+    f->ic         = ic;
+    f->max_queued = max_queued_packets;
+#if HAVE_PTHREADS
+    pthread_mutex_init(&f->mutex, NULL);
+    pthread_cond_init(&f->cond, NULL);
+#endif
+    *pf = f;
+    return 0;
+}
+
+int avformat_fanout_open_view(AVFormatFanout *f, AVFormatContext **ps,
+                              int program_id)
+{
+    AVFormatContext *s;
+    FanoutView *v;
+    FanoutView **views;
+    int i, ret = 0;
+
+    *ps = NULL;
+    if (!(s = avformat_alloc_context()))
+        return AVERROR(ENOMEM);
+    if (!(v = av_mallocz(sizeof(*v))) ||
+        !(s->priv_data = av_mallocz(sizeof(FanoutView *)))) {
+        av_free(v);
+        avformat_free_context(s);
+        return AVERROR(ENOMEM);
+    }
+    *(FanoutView **)s->priv_data = v;
+    s->iformat     = &fanout_demuxer;
+    s->ctx_flags  |= AVFMTCTX_NOHEADER;
+    s->duration    = s->start_time = AV_NOPTS_VALUE;
+    s->raw_packet_buffer_remaining_size = RAW_PACKET_BUFFER_SIZE;
+    av_strlcpy(s->filename, f->ic->filename, sizeof(s->filename));
+
+    v->fanout          = f;
+    v->ctx             = s;
+    v->program_id      = program_id;
+    v->new_streams_end = &v->new_streams;
+
+    fanout_lock(f);
+    acquire_input(f);
+    views = av_realloc(f->views, (f->nb_views + 1) * sizeof(*views));
+    if (views) {
+        f->views = views;
+        f->views[f->nb_views++] = v;
+        f->views_changed = 1;
+        /* add the streams the program already has */
+        for (i = 0; i < f->ic->nb_streams && ret >= 0; i++)
+            if (view_has_stream(f, v, i))
+                ret = map_stream(f, v, i);
+        if (ret >= 0)
+            ret = add_new_streams(v);
+    } else {
+        ret = AVERROR(ENOMEM);
+    }
+    release_input(f);
+    fanout_unlock(f);
+
+    if (ret < 0) {
+        if (views)
+            fanout_read_close(s);
+        else
+            av_free(v);
+        avformat_free_context(s);
+        return ret;
+    }
+    *ps = s;
+    return 0;
+}
+
+void avformat_fanout_free(AVFormatFanout **pf)
+{
+    AVFormatFanout *f = *pf;
+
+    if (!f)
+        return;
+    av_assert0(!f->nb_views);
+#if HAVE_PTHREADS
+    pthread_cond_destroy(&f->cond);
+    pthread_mutex_destroy(&f->mutex);
+#endif
+    av_free(f->views);
+    av_freep(pf);
+}
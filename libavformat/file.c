@@ -19,10 +19,15 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#define _GNU_SOURCE     /* Needed for O_DIRECT and fallocate() */
+
 #include "libavutil/avstring.h"
 #include "libavutil/opt.h"
 #include "avformat.h"
 #include <fcntl.h>
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
 #if HAVE_IO_H
 #include <io.h>
 #endif
@@ -31,6 +36,9 @@
 #endif
 #include <sys/stat.h>
 #include <stdlib.h>
+#if HAVE_MMAP
+#include <sys/mman.h>
+#endif
 #include "os_support.h"
 #include "url.h"
 
@@ -43,16 +51,52 @@
 #  endif
 #endif
 
+#define DIRECT_IO_ALIGN          4096
+#define DEFAULT_WRITE_BLOCK_SIZE (4 << 20)
+
 /* standard file protocol */
 
 typedef struct FileContext {
     const AVClass *class;
     int fd;
     int trunc;
+    int use_mmap;
+    uint8_t *map;               ///< whole file mapped in memory, or NULL
+    int64_t map_size;
+    int64_t map_pos;
+
+    int write_block_size;
+    int direct;
+    int64_t prealloc_size;
+    int write_thread;
+
+    uint8_t *block_mem;         ///< allocation holding the write blocks, or NULL
+    uint8_t *block[2];          ///< one block is filled while the other is written
+    int cur_block;              ///< index of the block being filled
+    int block_fill;
+    int64_t write_pos;          ///< file position after the written blocks
+    int64_t prealloc_end;       ///< end of the space reserved with fallocate()
+    int write_error;            ///< first error of the background writes
+#if HAVE_PTHREADS
+    int thread_started;
+    int pending_size;           ///< size of the block being written by the thread
+    int quit;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+#endif
 } FileContext;
 
+#define OFFSET(x) offsetof(FileContext, x)
+#define E AV_OPT_FLAG_ENCODING_PARAM
+
 static const AVOption file_options[] = {
     { "truncate", "Truncate existing files on write", offsetof(FileContext, trunc), AV_OPT_TYPE_INT, { .i64 = 1 }, 0, 1, AV_OPT_FLAG_ENCODING_PARAM },
+    { "mmap", "Map regular files in memory instead of reading them", offsetof(FileContext, use_mmap), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
+    { "write_block_size", "Gather the written data in blocks of this size", OFFSET(write_block_size), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, INT_MAX / 2 - DIRECT_IO_ALIGN, E },
+    { "direct", "Write the blocks bypassing the system cache (O_DIRECT)", OFFSET(direct), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1, E },
+    { "prealloc_size", "Reserve the disk space ahead of the written data by this many bytes", OFFSET(prealloc_size), AV_OPT_TYPE_INT64, { .i64 = 0 }, 0, INT64_MAX / 2, E },
+    { "write_thread", "Write the blocks from a background thread", OFFSET(write_thread), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1, E },
     { NULL }
 };
 
@@ -66,14 +110,96 @@ static const AVClass file_class = {
 static int file_read(URLContext *h, unsigned char *buf, int size)
 {
     FileContext *c = h->priv_data;
-    int r = read(c->fd, buf, size);
+    int r;
+
+    if (c->map) {
+        if (c->map_pos >= c->map_size)
+            return 0;
+        size = FFMIN(size, c->map_size - c->map_pos);
+        memcpy(buf, c->map + c->map_pos, size);
+        c->map_pos += size;
+        return size;
+    }
+    r = read(c->fd, buf, size);
     return (-1 == r)?AVERROR(errno):r;
 }
 
+static int write_block(FileContext *c, const uint8_t *buf, int size)
+{
+#if HAVE_FALLOCATE && defined(FALLOC_FL_KEEP_SIZE)
+    if (c->prealloc_size && c->write_pos + size > c->prealloc_end) {
+        int64_t end = c->write_pos + size + c->prealloc_size;
+        /* Not supported by all filesystems, only reserving is lost then. */
+        if (fallocate(c->fd, FALLOC_FL_KEEP_SIZE, c->prealloc_end,
+                      end - c->prealloc_end) < 0)
+            c->prealloc_size = 0;
+        else
+            c->prealloc_end = end;
+    }
+#endif
+    while (size > 0) {
+        int r = write(c->fd, buf, size);
+        if (r < 0) {
+            if (errno == EINTR)
+                continue;
+            return AVERROR(errno);
+        }
+        buf  += r;
+        size -= r;
+        c->write_pos += r;
+    }
+    return 0;
+}
+
+static int submit_block(FileContext *c)
+{
+    int size = c->block_fill;
+
+    c->block_fill = 0;
+#if HAVE_PTHREADS
+    if (c->thread_started) {
+        int ret;
+
+        pthread_mutex_lock(&c->mutex);
+        while (c->pending_size)
+            pthread_cond_wait(&c->cond, &c->mutex);
+        ret = c->write_error;
+        if (!ret) {
+            c->cur_block   ^= 1;
+            c->pending_size = size;
+            pthread_cond_signal(&c->cond);
+        }
+        pthread_mutex_unlock(&c->mutex);
+        return ret;
+    }
+#endif
+    return write_block(c, c->block[c->cur_block], size);
+}
+
 static int file_write(URLContext *h, const unsigned char *buf, int size)
 {
     FileContext *c = h->priv_data;
-    int r = write(c->fd, buf, size);
+    int r;
+
+    if (c->block_mem) {
+        int written = 0;
+
+        while (size > 0) {
+            int len = FFMIN(size, c->write_block_size - c->block_fill);
+
+            memcpy(c->block[c->cur_block] + c->block_fill, buf, len);
+            c->block_fill += len;
+            buf           += len;
+            size          -= len;
+            written       += len;
+            if (c->block_fill == c->write_block_size &&
+                (r = submit_block(c)) < 0)
+                return r;
+        }
+        return written;
+    }
+
+    r = write(c->fd, buf, size);
     return (-1 == r)?AVERROR(errno):r;
 }
 
@@ -109,6 +235,129 @@ static int file_check(URLContext *h, int mask)
 
 #if CONFIG_FILE_PROTOCOL
 
+#if HAVE_PTHREADS
+static void *file_write_task(void *arg)
+{
+    FileContext *c = arg;
+
+    pthread_mutex_lock(&c->mutex);
+    for (;;) {
+        uint8_t *buf;
+        int size, ret;
+
+        if (!c->pending_size) {
+            if (c->quit)
+                break;
+            pthread_cond_wait(&c->cond, &c->mutex);
+            continue;
+        }
+        buf  = c->block[!c->cur_block];
+        size = c->pending_size;
+        pthread_mutex_unlock(&c->mutex);
+        ret = write_block(c, buf, size);
+        pthread_mutex_lock(&c->mutex);
+
+        if (ret < 0 && !c->write_error)
+            c->write_error = ret;
+        c->pending_size = 0;
+        pthread_cond_signal(&c->cond);
+    }
+    pthread_mutex_unlock(&c->mutex);
+
+    return NULL;
+}
+#endif
+
+/**
+ * Wait for the background write to complete.
+ * @return the first error of the background writes, or 0
+ */
+static int wait_block(FileContext *c)
+{
+#if HAVE_PTHREADS
+    if (c->thread_started) {
+        pthread_mutex_lock(&c->mutex);
+        while (c->pending_size)
+            pthread_cond_wait(&c->cond, &c->mutex);
+        pthread_mutex_unlock(&c->mutex);
+    }
+#endif
+    return c->write_error;
+}
+
+static void disable_direct(URLContext *h)
+{
+#ifdef O_DIRECT
+    FileContext *c = h->priv_data;
+    int flags = fcntl(c->fd, F_GETFL);
+
+    if (c->direct && flags != -1 && fcntl(c->fd, F_SETFL, flags & ~O_DIRECT) != -1)
+        av_log(h, AV_LOG_DEBUG, "Unaligned write, not bypassing the cache anymore\n");
+    c->direct = 0;
+#endif
+}
+
+/**
+ * Write all the gathered data, so that the file position matches the
+ * position of the caller.
+ */
+static int flush_blocks(URLContext *h)
+{
+    FileContext *c = h->priv_data;
+    int size = c->block_fill;
+    int ret  = wait_block(c);
+
+    if (ret < 0 || !size)
+        return ret;
+    if (size % DIRECT_IO_ALIGN)
+        disable_direct(h);
+    c->block_fill = 0;
+    return write_block(c, c->block[c->cur_block], size);
+}
+
+static int open_write_blocks(URLContext *h)
+{
+    FileContext *c = h->priv_data;
+    int nb_blocks  = 1;
+
+    if (!c->write_block_size)
+        c->write_block_size = DEFAULT_WRITE_BLOCK_SIZE;
+    if (c->direct)
+        c->write_block_size = FFALIGN(c->write_block_size, DIRECT_IO_ALIGN);
+    if (c->write_thread) {
+#if HAVE_PTHREADS
+        nb_blocks = 2;
+#else
+        av_log(h, AV_LOG_WARNING,
+               "Threads are not available, writing from the calling thread\n");
+#endif
+    }
+
+    c->block_mem = av_malloc(nb_blocks * c->write_block_size + DIRECT_IO_ALIGN);
+    if (!c->block_mem)
+        return AVERROR(ENOMEM);
+    c->block[0] = (uint8_t *)FFALIGN((uintptr_t)c->block_mem, DIRECT_IO_ALIGN);
+    c->block[1] = c->block[0] + (nb_blocks - 1) * c->write_block_size;
+
+#if HAVE_PTHREADS
+    if (nb_blocks > 1) {
+        int ret;
+
+        pthread_mutex_init(&c->mutex, NULL);
+        pthread_cond_init(&c->cond, NULL);
+        if ((ret = pthread_create(&c->thread, NULL, file_write_task, c))) {
+            av_log(h, AV_LOG_ERROR, "pthread_create failed: %s\n", strerror(ret));
+            pthread_cond_destroy(&c->cond);
+            pthread_mutex_destroy(&c->mutex);
+            av_freep(&c->block_mem);
+            return AVERROR(ret);
+        }
+        c->thread_started = 1;
+    }
+#endif
+    return 0;
+}
+
 static int file_open(URLContext *h, const char *filename, int flags)
 {
     FileContext *c = h->priv_data;
@@ -132,13 +381,53 @@ static int file_open(URLContext *h, const char *filename, int flags)
 #ifdef O_BINARY
     access |= O_BINARY;
 #endif
+    if (flags & AVIO_FLAG_READ)
+        c->write_block_size = c->direct = c->write_thread = c->prealloc_size = 0;
+#ifdef O_DIRECT
+    if (c->direct) {
+        fd = open(filename, access | O_DIRECT, 0666);
+        if (fd != -1 || errno != EINVAL)
+            goto opened;
+        av_log(h, AV_LOG_WARNING,
+               "Cannot bypass the cache for %s, writing it normally\n", filename);
+    }
+#endif
+    c->direct = 0;
     fd = open(filename, access, 0666);
+#ifdef O_DIRECT
+opened:
+#endif
     if (fd == -1)
         return AVERROR(errno);
     c->fd = fd;
 
     h->is_streamed = !fstat(fd, &st) && S_ISFIFO(st.st_mode);
 
+    if (c->write_block_size || c->direct || c->prealloc_size || c->write_thread) {
+        int ret = open_write_blocks(h);
+        if (ret < 0) {
+            close(fd);
+            return ret;
+        }
+    }
+
+#if HAVE_MMAP
+    if (c->use_mmap && !(flags & AVIO_FLAG_WRITE) && !h->is_streamed &&
+        S_ISREG(st.st_mode) && st.st_size > 0 && st.st_size == (size_t)st.st_size) {
+        void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (map == MAP_FAILED) {
+            av_log(h, AV_LOG_WARNING, "Cannot map %s, reading it instead\n", filename);
+        } else {
+#ifdef MADV_SEQUENTIAL
+            madvise(map, st.st_size, MADV_SEQUENTIAL);
+#endif
+            c->map      = map;
+            c->map_size = st.st_size;
+            c->map_pos  = 0;
+        }
+    }
+#endif
+
     return 0;
 }
 
@@ -150,11 +439,44 @@ static int64_t file_seek(URLContext *h, int64_t pos, int whence)
 
     if (whence == AVSEEK_SIZE) {
         struct stat st;
+        /* Account for the gathered data without flushing it, to keep the
+         * writes aligned. */
+        if (c->block_mem && (ret = wait_block(c)) < 0)
+            return ret;
         ret = fstat(c->fd, &st);
+        if (ret >= 0 && c->block_mem)
+            st.st_size = FFMAX(st.st_size, c->write_pos + c->block_fill);
         return ret < 0 ? AVERROR(errno) : (S_ISFIFO(st.st_mode) ? 0 : st.st_size);
     }
 
+    if (c->block_mem) {
+        if ((ret = wait_block(c)) < 0)
+            return ret;
+        /* Seeking to the current position does not need the blocks to be
+         * interrupted. */
+        if ((whence == SEEK_SET && pos == c->write_pos + c->block_fill) ||
+            (whence == SEEK_CUR && !pos))
+            return c->write_pos + c->block_fill;
+        if ((ret = flush_blocks(h)) < 0)
+            return ret;
+        disable_direct(h);
+    }
+
+    if (c->map) {
+        if (whence == SEEK_CUR)
+            pos += c->map_pos;
+        else if (whence == SEEK_END)
+            pos += c->map_size;
+        else if (whence != SEEK_SET)
+            return AVERROR(EINVAL);
+        if (pos < 0)
+            return AVERROR(EINVAL);
+        return c->map_pos = pos;
+    }
+
     ret = lseek(c->fd, pos, whence);
+    if (ret >= 0)
+        c->write_pos = ret;
 
     return ret < 0 ? AVERROR(errno) : ret;
 }
@@ -162,7 +484,38 @@ static int64_t file_seek(URLContext *h, int64_t pos, int whence)
 static int file_close(URLContext *h)
 {
     FileContext *c = h->priv_data;
-    return close(c->fd);
+    int ret = 0;
+
+#if HAVE_MMAP
+    if (c->map)
+        munmap(c->map, c->map_size);
+#endif
+    if (c->block_mem) {
+        ret = flush_blocks(h);
+#if HAVE_PTHREADS
+        if (c->thread_started) {
+            pthread_mutex_lock(&c->mutex);
+            c->quit = 1;
+            pthread_cond_signal(&c->cond);
+            pthread_mutex_unlock(&c->mutex);
+            pthread_join(c->thread, NULL);
+            pthread_cond_destroy(&c->cond);
+            pthread_mutex_destroy(&c->mutex);
+        }
+#endif
+        av_freep(&c->block_mem);
+    }
+#if HAVE_FALLOCATE
+    /* Release the space reserved beyond the end of the file */
+    if (c->prealloc_end) {
+        struct stat st;
+        if (!fstat(c->fd, &st) && S_ISREG(st.st_mode))
+            ftruncate(c->fd, st.st_size);
+    }
+#endif
+    if (close(c->fd) < 0 && !ret)
+        ret = AVERROR(errno);
+    return ret;
 }
 
 URLProtocol ff_file_protocol = {
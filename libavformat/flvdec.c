@@ -29,6 +29,7 @@
 #include "libavutil/dict.h"
 #include "libavutil/opt.h"
 #include "libavutil/intfloat.h"
+#include "libavutil/intreadwrite.h"
 #include "libavutil/mathematics.h"
 #include "libavcodec/bytestream.h"
 #include "libavcodec/mpeg4audio.h"
@@ -54,6 +55,8 @@ typedef struct {
     int validate_next;
     int validate_count;
     int searched_for_end;
+    int scan_index;     ///< scan the tags for keyframes on the first seek
+    int full_index;     ///< the index covers the whole file
 } FLVContext;
 
 static int flv_probe(AVProbeData *p)
@@ -316,6 +319,7 @@ static int parse_keyframes_index(AVFormatContext *s, AVIOContext *ioc, AVStream
                 flv->validate_count = i + 1;
             }
         }
+        flv->full_index = 1;
     } else {
 invalid:
         av_log(s, AV_LOG_WARNING, "Invalid keyframes object, skipping.\n");
@@ -575,8 +579,10 @@ static int flv_queue_extradata(FLVContext *flv, AVIOContext *pb, int stream,
 
 static void clear_index_entries(AVFormatContext *s, int64_t pos)
 {
+    FLVContext *flv = s->priv_data;
     int i, j, out;
     av_log(s, AV_LOG_WARNING, "Found invalid index entries, clearing the index.\n");
+    flv->full_index = 0;
     for (i = 0; i < s->nb_streams; i++) {
         AVStream *st = s->streams[i];
         /* Remove all index entries that point to >= pos */
@@ -751,6 +757,8 @@ static int flv_read_packet(AVFormatContext *s, AVPacket *pkt)
 
     }
     av_dlog(s, "%d %X %d \n", stream_type, flags, st->discard);
+    if ((flags & FLV_VIDEO_FRAMETYPE_MASK) == FLV_FRAME_KEY || stream_type == FLV_STREAM_TYPE_AUDIO)
+        av_add_index_entry(st, pos, dts, size, 0, AVINDEX_KEYFRAME);
     if(  (st->discard >= AVDISCARD_NONKEY && !((flags & FLV_VIDEO_FRAMETYPE_MASK) == FLV_FRAME_KEY || (stream_type == FLV_STREAM_TYPE_AUDIO)))
        ||(st->discard >= AVDISCARD_BIDIR  &&  ((flags & FLV_VIDEO_FRAMETYPE_MASK) == FLV_FRAME_DISP_INTER && (stream_type == FLV_STREAM_TYPE_VIDEO)))
        || st->discard >= AVDISCARD_ALL
@@ -758,8 +766,6 @@ static int flv_read_packet(AVFormatContext *s, AVPacket *pkt)
         avio_seek(s->pb, next, SEEK_SET);
         continue;
     }
-    if ((flags & FLV_VIDEO_FRAMETYPE_MASK) == FLV_FRAME_KEY || stream_type == FLV_STREAM_TYPE_AUDIO)
-        av_add_index_entry(st, pos, dts, size, 0, AVINDEX_KEYFRAME);
     break;
  }
 
@@ -896,11 +902,138 @@ leave:
     return ret;
 }
 
+typedef struct FLVScanEntry {
+    int64_t pos;
+    int64_t dts;
+    int size;
+    int stream_type;
+} FLVScanEntry;
+
+#define FLV_SCAN_CHUNK_SIZE 65536
+
+typedef struct FLVScanBuffer {
+    uint8_t data[FLV_SCAN_CHUNK_SIZE];
+    int64_t start;                  ///< file position of data[0]
+    int size;
+} FLVScanBuffer;
+
+/**
+ * Get n bytes at pos, reading the file backward by chunks, so that the
+ * headers of small tags are found in the chunk already read.
+ */
+static const uint8_t *flv_scan_get(AVIOContext *pb, FLVScanBuffer *buf,
+                                   int64_t pos, int n, int64_t min_pos)
+{
+    int64_t start;
+
+    if (pos < buf->start || pos + n > buf->start + buf->size) {
+        start = FFMAX(pos + n - FLV_SCAN_CHUNK_SIZE, min_pos);
+        if (avio_seek(pb, start, SEEK_SET) < 0)
+            return NULL;
+        buf->start = start;
+        buf->size  = avio_read(pb, buf->data, pos + n - start);
+        if (buf->size < pos + n - start)
+            return NULL;
+    }
+    return buf->data + pos - buf->start;
+}
+
+/**
+ * Index the keyframes of the whole file by walking the tags backward from
+ * the end, following their PreviousTagSize field. Only the tag headers are
+ * used, so this is much cheaper than demuxing the file.
+ */
+static void flv_scan_index(AVFormatContext *s)
+{
+    FLVContext *flv = s->priv_data;
+    AVIOContext *pb = s->pb;
+    AVStream *streams[FLV_STREAM_TYPE_NB] = { NULL };
+    FLVScanBuffer *buf;
+    FLVScanEntry *entries = NULL, *e;
+    unsigned int entries_allocated_size = 0;
+    int i, nb_entries = 0;
+    int64_t orig_pos = avio_tell(pb);
+    int64_t pos = avio_size(pb);
+
+    flv->full_index = 1;
+
+    for (i = 0; i < s->nb_streams; i++) {
+        AVStream *st = s->streams[i];
+        if (st->codec->codec_type == AVMEDIA_TYPE_VIDEO && !streams[FLV_STREAM_TYPE_VIDEO])
+            streams[FLV_STREAM_TYPE_VIDEO] = st;
+        else if (st->codec->codec_type == AVMEDIA_TYPE_AUDIO && !streams[FLV_STREAM_TYPE_AUDIO])
+            streams[FLV_STREAM_TYPE_AUDIO] = st;
+    }
+
+    if (!(buf = av_mallocz(sizeof(*buf))))
+        return;
+
+    while (pos > s->data_offset) {
+        const uint8_t *p;
+        int size, stream_type;
+        uint32_t prev_size;
+
+        if (!(p = flv_scan_get(pb, buf, pos - 4, 4, s->data_offset)))
+            break;
+        prev_size = AV_RB32(p);
+        if (prev_size < 11 || pos - 4 - prev_size < s->data_offset)
+            break;
+        pos -= 4 + prev_size;
+
+        if (!(p = flv_scan_get(pb, buf, pos, 12, s->data_offset)))
+            break;
+        size = AV_RB24(p + 1);
+        if (size + 11 != prev_size)
+            break;
+
+        if (p[0] == FLV_TAG_TYPE_VIDEO &&
+            (p[11] & FLV_VIDEO_FRAMETYPE_MASK) == FLV_FRAME_KEY)
+            stream_type = FLV_STREAM_TYPE_VIDEO;
+        else if (p[0] == FLV_TAG_TYPE_AUDIO)
+            stream_type = FLV_STREAM_TYPE_AUDIO;
+        else
+            continue;
+        if (!streams[stream_type] || size <= 1)
+            continue;
+
+        e = av_fast_realloc(entries, &entries_allocated_size,
+                            (nb_entries + 1) * sizeof(*entries));
+        if (!e)
+            break;
+        entries = e;
+        e = &entries[nb_entries++];
+        e->pos         = pos;
+        e->dts         = AV_RB24(p + 4) | (p[7] << 24);
+        e->size        = size - 1;
+        e->stream_type = stream_type;
+    }
+
+    if (pos > s->data_offset)
+        av_log(s, AV_LOG_WARNING, "Could not scan the whole file for keyframes, "
+               "stopped at %"PRId64"\n", pos);
+    else
+        av_log(s, AV_LOG_VERBOSE, "Scanned %d keyframes\n", nb_entries);
+
+    /* The tags were found from the end, add them in file order. */
+    for (i = nb_entries - 1; i >= 0; i--) {
+        e = &entries[i];
+        av_add_index_entry(streams[e->stream_type], e->pos, e->dts, e->size,
+                           0, AVINDEX_KEYFRAME);
+    }
+
+    av_free(entries);
+    av_free(buf);
+    avio_seek(pb, orig_pos, SEEK_SET);
+}
+
 static int flv_read_seek(AVFormatContext *s, int stream_index,
     int64_t ts, int flags)
 {
     FLVContext *flv = s->priv_data;
     flv->validate_count = 0;
+    if (flv->scan_index && !flv->full_index && s->pb->seekable &&
+        !(s->flags & AVFMT_FLAG_IGNIDX))
+        flv_scan_index(s);
     return avio_seek_time(s->pb, stream_index, ts, flags);
 }
 
@@ -908,6 +1041,7 @@ static int flv_read_seek(AVFormatContext *s, int stream_index,
 #define VD AV_OPT_FLAG_VIDEO_PARAM | AV_OPT_FLAG_DECODING_PARAM
 static const AVOption options[] = {
     { "flv_metadata", "Allocate streams according the onMetaData array",      OFFSET(trust_metadata), AV_OPT_TYPE_INT,    { .i64 = 0 }, 0, 1, VD},
+    { "flv_scan_index", "Index the keyframes from the tag headers on the first seek", OFFSET(scan_index), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1, VD},
     { NULL }
 };
 
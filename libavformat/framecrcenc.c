@@ -21,21 +21,28 @@
 
 #include "libavutil/adler32.h"
 #include "libavutil/avstring.h"
+#include "libavutil/opt.h"
 #include "avformat.h"
 #include "internal.h"
 
-static int framecrc_write_packet(struct AVFormatContext *s, AVPacket *pkt)
+typedef struct FrameCRCContext {
+    const AVClass *class;
+    FFFrameHashPool *pool;
+    int threads;
+} FrameCRCContext;
+
+static void framecrc_hash_packet(AVFormatContext *s, int thread,
+                                 AVPacket *pkt, char *buf, int size)
 {
     uint32_t crc = av_adler32_update(0, pkt->data, pkt->size);
-    char buf[256];
 
-    snprintf(buf, sizeof(buf), "%d, %10"PRId64", %10"PRId64", %8d, %8d, 0x%08x",
+    snprintf(buf, size, "%d, %10"PRId64", %10"PRId64", %8d, %8d, 0x%08x",
              pkt->stream_index, pkt->dts, pkt->pts, pkt->duration, pkt->size, crc);
     if (pkt->flags != AV_PKT_FLAG_KEY)
-        av_strlcatf(buf, sizeof(buf), ", F=0x%0X", pkt->flags);
+        av_strlcatf(buf, size, ", F=0x%0X", pkt->flags);
     if (pkt->side_data_elems) {
         int i, j;
-        av_strlcatf(buf, sizeof(buf), ", S=%d", pkt->side_data_elems);
+        av_strlcatf(buf, size, ", S=%d", pkt->side_data_elems);
 
         for (i=0; i<pkt->side_data_elems; i++) {
             uint32_t side_data_crc = 0;
@@ -50,21 +57,59 @@ static int framecrc_write_packet(struct AVFormatContext *s, AVPacket *pkt)
                                                   pkt->side_data[i].data,
                                                   pkt->side_data[i].size);
             }
-            av_strlcatf(buf, sizeof(buf), ", %8d, 0x%08x", pkt->side_data[i].size, side_data_crc);
+            av_strlcatf(buf, size, ", %8d, 0x%08x", pkt->side_data[i].size, side_data_crc);
         }
     }
-    av_strlcatf(buf, sizeof(buf), "\n");
-    avio_write(s->pb, buf, strlen(buf));
+    av_strlcatf(buf, size, "\n");
+}
+
+static int framecrc_write_header(struct AVFormatContext *s)
+{
+    FrameCRCContext *c = s->priv_data;
+    int ret = ff_framehash_pool_init(&c->pool, s, framecrc_hash_packet,
+                                     c->threads);
+    if (ret < 0)
+        return ret;
+    return ff_framehash_write_header(s);
+}
+
+static int framecrc_write_packet(struct AVFormatContext *s, AVPacket *pkt)
+{
+    FrameCRCContext *c = s->priv_data;
+    return ff_framehash_pool_write(c->pool, pkt);
+}
+
+static int framecrc_write_trailer(struct AVFormatContext *s)
+{
+    FrameCRCContext *c = s->priv_data;
+    ff_framehash_pool_close(&c->pool);
     return 0;
 }
 
+#define OFFSET(x) offsetof(FrameCRCContext, x)
+#define ENC AV_OPT_FLAG_ENCODING_PARAM
+static const AVOption framecrc_options[] = {
+    { "hash_threads", "set the number of threads hashing the packets, 0 for one per CPU", OFFSET(threads), AV_OPT_TYPE_INT, {.i64 = 1}, 0, INT_MAX, ENC },
+    { NULL },
+};
+
+static const AVClass framecrc_class = {
+    .class_name = "framecrc muxer",
+    .item_name  = av_default_item_name,
+    .option     = framecrc_options,
+    .version    = LIBAVUTIL_VERSION_INT,
+};
+
 AVOutputFormat ff_framecrc_muxer = {
     .name              = "framecrc",
     .long_name         = NULL_IF_CONFIG_SMALL("framecrc testing"),
+    .priv_data_size    = sizeof(FrameCRCContext),
     .audio_codec       = AV_CODEC_ID_PCM_S16LE,
     .video_codec       = AV_CODEC_ID_RAWVIDEO,
-    .write_header      = ff_framehash_write_header,
+    .write_header      = framecrc_write_header,
     .write_packet      = framecrc_write_packet,
+    .write_trailer     = framecrc_write_trailer,
     .flags             = AVFMT_VARIABLE_FPS | AVFMT_TS_NONSTRICT |
                          AVFMT_TS_NEGATIVE,
+    .priv_class        = &framecrc_class,
 };
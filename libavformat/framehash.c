@@ -18,8 +18,20 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include "config.h"
+
+#include <string.h>
+
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
+#include "libavutil/cpu.h"
+#include "libavutil/mem.h"
 #include "internal.h"
 
+#define LINE_SIZE 256
+
 int ff_framehash_write_header(AVFormatContext *s)
 {
     int i;
@@ -31,3 +43,217 @@ int ff_framehash_write_header(AVFormatContext *s)
     }
     return 0;
 }
+
+typedef struct FrameHashJob {
+    AVPacket pkt;
+    char line[LINE_SIZE];
+    int done;
+} FrameHashJob;
+
+struct FFFrameHashPool {
+    AVFormatContext *s;
+    FFFrameHashFunc hash;
+    int nb_threads;
+#if HAVE_PTHREADS
+    pthread_t *threads;
+    pthread_mutex_t mutex;
+    pthread_cond_t job_cond;        ///< signaled when a job is added
+    pthread_cond_t done_cond;       ///< signaled when a job is done
+    FrameHashJob *jobs;             ///< ring of jobs, in packet order
+    int nb_jobs;
+    int first;                      ///< oldest job not written yet
+    int count;                      ///< jobs in the ring
+    int taken;                      ///< jobs from the first taken by a thread
+    int nb_started;
+    int quit;
+#endif
+};
+
+#if HAVE_PTHREADS
+typedef struct FrameHashThread {
+    FFFrameHashPool *pool;
+    int index;
+} FrameHashThread;
+
+static void *frame_hash_thread(void *arg)
+{
+    FFFrameHashPool *pool = ((FrameHashThread *)arg)->pool;
+    int index = ((FrameHashThread *)arg)->index;
+
+    av_free(arg);
+    pthread_mutex_lock(&pool->mutex);
+    for (;;) {
+        FrameHashJob *job;
+
+        while (!pool->quit && pool->taken == pool->count)
+            pthread_cond_wait(&pool->job_cond, &pool->mutex);
+        if (pool->quit)
+            break;
+        job = &pool->jobs[(pool->first + pool->taken++) % pool->nb_jobs];
+        pthread_mutex_unlock(&pool->mutex);
+
+        pool->hash(pool->s, index, &job->pkt, job->line, LINE_SIZE);
+
+        pthread_mutex_lock(&pool->mutex);
+        job->done = 1;
+        pthread_cond_signal(&pool->done_cond);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    return NULL;
+}
+
+/* Write the lines of the jobs done in order, until at least min_free jobs
+ * are free. */
+static void write_done_jobs(FFFrameHashPool *pool, int min_free)
+{
+    pthread_mutex_lock(&pool->mutex);
+    for (;;) {
+        while (pool->count && pool->jobs[pool->first].done) {
+            FrameHashJob *job = &pool->jobs[pool->first];
+
+            /* the threads do not touch the jobs done */
+            pthread_mutex_unlock(&pool->mutex);
+            avio_write(pool->s->pb, job->line, strlen(job->line));
+            av_free_packet(&job->pkt);
+            job->done = 0;
+            pthread_mutex_lock(&pool->mutex);
+            pool->first = (pool->first + 1) % pool->nb_jobs;
+            pool->count--;
+            pool->taken--;
+        }
+        if (pool->nb_jobs - pool->count >= min_free)
+            break;
+        pthread_cond_wait(&pool->done_cond, &pool->mutex);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+}
+#endif /* HAVE_PTHREADS */
+
+int ff_framehash_pool_init(FFFrameHashPool **ppool, AVFormatContext *s,
+                           FFFrameHashFunc hash, int nb_threads)
+{
+    FFFrameHashPool *pool = av_mallocz(sizeof(*pool));
+
+    if (!pool)
+        return AVERROR(ENOMEM);
+    pool->s          = s;
+    pool->hash       = hash;
+    pool->nb_threads = 1;
+    *ppool = pool;
+
+    if (!nb_threads)
+        nb_threads = av_cpu_count();
+#if HAVE_PTHREADS
+    if (nb_threads > 1) {
+        int i, ret;
+
+        /* enough jobs queued for the threads to stay busy while the line
+         * of the oldest one is waited for */
+        pool->nb_jobs = 4 * nb_threads;
+        pool->jobs    = av_mallocz(pool->nb_jobs * sizeof(*pool->jobs));
+        pool->threads = av_mallocz(nb_threads * sizeof(*pool->threads));
+        if (!pool->jobs || !pool->threads) {
+            av_freep(&pool->jobs);
+            av_freep(&pool->threads);
+            av_freep(ppool);
+            return AVERROR(ENOMEM);
+        }
+        pthread_mutex_init(&pool->mutex, NULL);
+        pthread_cond_init(&pool->job_cond, NULL);
+        pthread_cond_init(&pool->done_cond, NULL);
+        pool->nb_threads = nb_threads;
+
+        for (i = 0; i < nb_threads; i++) {
+            FrameHashThread *arg = av_malloc(sizeof(*arg));
+
+            if (!arg) {
+                ff_framehash_pool_close(ppool);
+                return AVERROR(ENOMEM);
+            }
+            arg->pool  = pool;
+            arg->index = i;
+            if ((ret = pthread_create(&pool->threads[i], NULL,
+                                      frame_hash_thread, arg))) {
+                av_log(s, AV_LOG_ERROR, "pthread_create failed: %s\n",
+                       strerror(ret));
+                av_free(arg);
+                ff_framehash_pool_close(ppool);
+                return AVERROR(ret);
+            }
+            pool->nb_started++;
+        }
+    }
+#else
+    if (nb_threads > 1)
+        av_log(s, AV_LOG_WARNING,
+               "Threads not supported, hashing the packets in one thread\n");
+#endif
+    return 0;
+}
+
+int ff_framehash_pool_threads(FFFrameHashPool *pool)
+{
+    return pool->nb_threads;
+}
+
+int ff_framehash_pool_write(FFFrameHashPool *pool, AVPacket *pkt)
+{
+#if HAVE_PTHREADS
+    if (pool->threads) {
+        FrameHashJob *job;
+        int ret;
+
+        write_done_jobs(pool, 1);
+
+        /* only this thread adds jobs, so the free one is not taken */
+        job = &pool->jobs[(pool->first + pool->count) % pool->nb_jobs];
+        if ((ret = av_copy_packet(&job->pkt, pkt)) < 0)
+            return ret;
+        /* the data can be at an offset in the referenced buffer */
+        if (pkt->buf)
+            job->pkt.data = pkt->data;
+
+        pthread_mutex_lock(&pool->mutex);
+        pool->count++;
+        pthread_cond_signal(&pool->job_cond);
+        pthread_mutex_unlock(&pool->mutex);
+        return 0;
+    }
+#endif
+    {
+        char line[LINE_SIZE];
+
+        pool->hash(pool->s, 0, pkt, line, sizeof(line));
+        avio_write(pool->s->pb, line, strlen(line));
+    }
+    return 0;
+}
+
+void ff_framehash_pool_close(FFFrameHashPool **ppool)
+{
+    FFFrameHashPool *pool = *ppool;
+
+    if (!pool)
+        return;
+#if HAVE_PTHREADS
+    if (pool->threads) {
+        int i;
+
+        write_done_jobs(pool, pool->nb_jobs);
+
+        pthread_mutex_lock(&pool->mutex);
+        pool->quit = 1;
+        pthread_cond_broadcast(&pool->job_cond);
+        pthread_mutex_unlock(&pool->mutex);
+        for (i = 0; i < pool->nb_started; i++)
+            pthread_join(pool->threads[i], NULL);
+
+        pthread_cond_destroy(&pool->done_cond);
+        pthread_cond_destroy(&pool->job_cond);
+        pthread_mutex_destroy(&pool->mutex);
+    }
+    av_freep(&pool->threads);
+    av_freep(&pool->jobs);
+#endif
+    av_freep(ppool);
+}
@@ -34,9 +34,17 @@
 #include "avformat.h"
 #include "internal.h"
 #include "avio_internal.h"
+#include "http.h"
 #include "url.h"
 
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
 #define INITIAL_BUFFER_SIZE 32768
+#define MAX_IDLE_CONNECTIONS 8
+#define MAX_PREFETCH_SEGMENTS 16
+#define PREFETCH_CHUNK_SIZE (64 * 1024)
 
 /*
  * An apple http stream consists of a playlist with media segment files,
@@ -63,6 +71,8 @@ struct segment {
     uint8_t iv[16];
 };
 
+struct prefetch;
+
 /*
  * Each variant has its own demuxer. If it currently is active,
  * it has an open AVIOContext too, and potentially an AVPacket
@@ -91,9 +101,18 @@ struct variant {
 
     char key_url[MAX_URL_SIZE];
     uint8_t key[16];
+
+    /* segments downloaded in the background, indexed by seq_no modulo
+     * the number of prefetched segments, and the one being read */
+    struct prefetch *prefetches[MAX_PREFETCH_SEGMENTS];
+    struct prefetch *cur_prefetch;
+    volatile int prefetch_abort;
 };
 
 typedef struct HLSContext {
+    const AVClass *class;
+    int prefetch_segments;
+    int prefetch_buffer_size;
     int n_variants;
     struct variant **variants;
     int cur_seq_no;
@@ -105,6 +124,8 @@ typedef struct HLSContext {
     AVIOInterruptCB *interrupt_callback;
     char *user_agent;                    ///< holds HTTP user agent set as an AVOption to the HTTP protocol context
     char *cookies;                       ///< holds HTTP cookie values set in either the initial response or as an AVOption to the HTTP protocol context
+    URLContext *idle_connections[MAX_IDLE_CONNECTIONS]; ///< HTTP connections kept alive for the next requests
+    int n_idle_connections;
 } HLSContext;
 
 static int read_chomp_line(AVIOContext *s, char *buf, int maxlen)
@@ -115,6 +136,229 @@ static int read_chomp_line(AVIOContext *s, char *buf, int maxlen)
     return len;
 }
 
+/*
+ * Playlists, keys and segments are opened through open_url() and closed
+ * through close_url(), which keeps the HTTP connections whose response has
+ * been read entirely, and reuses them for the next requests to the same
+ * server.
+ */
+static int open_url(HLSContext *c, URLContext **uc, const char *url,
+                    AVDictionary *opts)
+{
+    AVDictionary *tmp = NULL;
+    int i, ret;
+
+    for (i = 0; i < c->n_idle_connections; i++) {
+        URLContext *idle = c->idle_connections[i];
+        if (!ff_http_can_reuse_connection(idle, url))
+            continue;
+        c->idle_connections[i] = c->idle_connections[--c->n_idle_connections];
+        if (ff_http_do_new_request(idle, url) >= 0) {
+            *uc = idle;
+            return 0;
+        }
+        /* the server has most likely closed it in the meantime */
+        ffurl_close(idle);
+        break;
+    }
+
+    av_dict_copy(&tmp, opts, 0);
+    av_dict_set(&tmp, "multiple_requests", "1", 0);
+    ret = ffurl_open(uc, url, AVIO_FLAG_READ, c->interrupt_callback, &tmp);
+    av_dict_free(&tmp);
+    return ret;
+}
+
+static void close_url(HLSContext *c, URLContext **uc)
+{
+    if (!*uc)
+        return;
+    if (ff_http_can_reuse_connection(*uc, NULL)) {
+        if (c->n_idle_connections == MAX_IDLE_CONNECTIONS)
+            ffurl_close(c->idle_connections[--c->n_idle_connections]);
+        memmove(c->idle_connections + 1, c->idle_connections,
+                c->n_idle_connections * sizeof(*c->idle_connections));
+        c->idle_connections[0] = *uc;
+        c->n_idle_connections++;
+    } else {
+        ffurl_close(*uc);
+    }
+    *uc = NULL;
+}
+
+#if HAVE_PTHREADS
+/*
+ * With the prefetch_segments option, the next segments of each active
+ * variant are downloaded by background threads, on their own connections,
+ * up to prefetch_buffer_size bytes each. When a prefetched segment becomes
+ * the current one, its buffered data is read first, then the rest of it is
+ * read from the connection of the thread.
+ */
+struct prefetch {
+    struct variant *var;
+    int seq_no;
+    char url[MAX_URL_SIZE];
+    AVDictionary *opts;
+    URLContext *input;
+    uint8_t *buf;
+    int buf_size, size, pos;
+    int ret;
+    pthread_t thread;
+};
+
+static int prefetch_check_interrupt(void *opaque)
+{
+    struct variant *v = opaque;
+    return v->prefetch_abort || ff_check_interrupt(&v->parent->interrupt_callback);
+}
+
+static void *prefetch_task(void *arg)
+{
+    struct prefetch *p = arg;
+    AVIOInterruptCB interrupt_callback = { prefetch_check_interrupt, p->var };
+    int ret;
+
+    ret = ffurl_open(&p->input, p->url, AVIO_FLAG_READ, &interrupt_callback,
+                     &p->opts);
+    while (ret >= 0 && p->size < p->buf_size) {
+        int size = FFMIN(p->buf_size - p->size, PREFETCH_CHUNK_SIZE);
+        ret = ffurl_read(p->input, p->buf + p->size, size);
+        if (ret <= 0)
+            break;
+        p->size += ret;
+    }
+    p->ret = ret == AVERROR_EOF ? 0 : FFMIN(ret, 0);
+
+    return NULL;
+}
+
+static void free_prefetch(struct prefetch **pp)
+{
+    struct prefetch *p = *pp;
+
+    if (!p)
+        return;
+    if (p->input)
+        ffurl_close(p->input);
+    av_dict_free(&p->opts);
+    av_free(p->buf);
+    av_freep(pp);
+}
+
+static void cancel_prefetches(struct variant *v)
+{
+    int i;
+
+    v->prefetch_abort = 1;
+    for (i = 0; i < MAX_PREFETCH_SEGMENTS; i++) {
+        if (!v->prefetches[i])
+            continue;
+        pthread_join(v->prefetches[i]->thread, NULL);
+        free_prefetch(&v->prefetches[i]);
+    }
+    v->prefetch_abort = 0;
+    free_prefetch(&v->cur_prefetch);
+}
+
+static void start_prefetches(HLSContext *c, struct variant *v)
+{
+    int i;
+
+    for (i = 1; i <= c->prefetch_segments; i++) {
+        int seq_no = v->cur_seq_no + i;
+        struct prefetch **slot = &v->prefetches[seq_no % c->prefetch_segments];
+        struct segment *seg;
+        struct prefetch *p;
+
+        if (seq_no >= v->start_seq_no + v->n_segments)
+            break;
+        seg = v->segments[seq_no - v->start_seq_no];
+        if (seg->key_type != KEY_NONE)
+            break;
+        if (*slot)
+            continue;
+
+        if (!(p = av_mallocz(sizeof(*p))) ||
+            !(p->buf = av_malloc(c->prefetch_buffer_size))) {
+            av_free(p);
+            break;
+        }
+        p->var      = v;
+        p->seq_no   = seq_no;
+        p->buf_size = c->prefetch_buffer_size;
+        av_strlcpy(p->url, seg->url, sizeof(p->url));
+        av_dict_set(&p->opts, "user-agent", c->user_agent, 0);
+        av_dict_set(&p->opts, "cookies", c->cookies, 0);
+        av_dict_set(&p->opts, "seekable", "0", 0);
+        av_dict_set(&p->opts, "multiple_requests", "1", 0);
+        if (pthread_create(&p->thread, NULL, prefetch_task, p)) {
+            free_prefetch(&p);
+            break;
+        }
+        *slot = p;
+    }
+}
+
+/**
+ * Make the prefetched segment cur_seq_no the current one, if there is one.
+ * @return 1 if it was, 0 if the segment must be opened directly
+ */
+static int use_prefetch(HLSContext *c, struct variant *v)
+{
+    struct prefetch **slot = &v->prefetches[v->cur_seq_no % c->prefetch_segments];
+    int i;
+
+    /* the playback jumped, throw away everything */
+    for (i = 0; i < MAX_PREFETCH_SEGMENTS; i++) {
+        struct prefetch *p = v->prefetches[i];
+        if (p && (p->seq_no < v->cur_seq_no ||
+                  p->seq_no > v->cur_seq_no + c->prefetch_segments)) {
+            cancel_prefetches(v);
+            return 0;
+        }
+    }
+    if (!*slot || (*slot)->seq_no != v->cur_seq_no)
+        return 0;
+
+    pthread_join((*slot)->thread, NULL);
+    v->cur_prefetch = *slot;
+    *slot = NULL;
+    if (v->cur_prefetch->ret < 0 && !v->cur_prefetch->size) {
+        free_prefetch(&v->cur_prefetch);
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * Read from the current prefetched segment. Once its buffer is exhausted,
+ * its connection becomes the input of the variant.
+ */
+static int read_prefetch(HLSContext *c, struct variant *v, uint8_t *buf, int buf_size)
+{
+    struct prefetch *p = v->cur_prefetch;
+    int ret;
+
+    if (p->pos < p->size) {
+        ret = FFMIN(buf_size, p->size - p->pos);
+        memcpy(buf, p->buf + p->pos, ret);
+        p->pos += ret;
+        return ret;
+    }
+    ret = p->ret;
+    if (ret >= 0) {
+        v->input = p->input;
+        p->input = NULL;
+    }
+    free_prefetch(&v->cur_prefetch);
+    return ret;
+}
+#else
+static void cancel_prefetches(struct variant *v)
+{
+}
+#endif
+
 static void free_segment_list(struct variant *var)
 {
     int i;
@@ -132,8 +376,8 @@ static void free_variant_list(HLSContext *c)
         free_segment_list(var);
         av_free_packet(&var->pkt);
         av_free(var->pb.buffer);
-        if (var->input)
-            ffurl_close(var->input);
+        cancel_prefetches(var);
+        close_url(c, &var->input);
         if (var->ctx) {
             var->ctx->pb = NULL;
             avformat_close_input(&var->ctx);
@@ -144,6 +388,9 @@ static void free_variant_list(HLSContext *c)
     av_freep(&c->cookies);
     av_freep(&c->user_agent);
     c->n_variants = 0;
+    for (i = 0; i < c->n_idle_connections; i++)
+        ffurl_close(c->idle_connections[i]);
+    c->n_idle_connections = 0;
 }
 
 /*
@@ -214,6 +461,7 @@ static int parse_playlist(HLSContext *c, const char *url,
     char line[1024];
     const char *ptr;
     int close_in = 0;
+    URLContext *uc = NULL;
 
     if (!in) {
         AVDictionary *opts = NULL;
@@ -225,11 +473,14 @@ static int parse_playlist(HLSContext *c, const char *url,
         av_dict_set(&opts, "user-agent", c->user_agent, 0);
         av_dict_set(&opts, "cookies", c->cookies, 0);
 
-        ret = avio_open2(&in, url, AVIO_FLAG_READ,
-                         c->interrupt_callback, &opts);
+        ret = open_url(c, &uc, url, opts);
         av_dict_free(&opts);
         if (ret < 0)
             return ret;
+        if ((ret = ffio_fdopen(&in, uc)) < 0) {
+            ffurl_close(uc);
+            return ret;
+        }
     }
 
     read_chomp_line(in, line, sizeof(line));
@@ -332,8 +583,12 @@ static int parse_playlist(HLSContext *c, const char *url,
         var->last_load_time = av_gettime();
 
 fail:
-    if (close_in)
-        avio_close(in);
+    if (close_in) {
+        /* free the AVIOContext but keep uc, which may be reused */
+        av_free(in->buffer);
+        av_free(in);
+        close_url(c, &uc);
+    }
     return ret;
 }
 
@@ -343,27 +598,34 @@ static int open_input(HLSContext *c, struct variant *var)
     int ret;
     struct segment *seg = var->segments[var->cur_seq_no - var->start_seq_no];
 
+#if HAVE_PTHREADS
+    if (c->prefetch_segments) {
+        int prefetched = use_prefetch(c, var);
+        start_prefetches(c, var);
+        if (prefetched)
+            return 0;
+    }
+#endif
+
     // broker prior HTTP options that should be consistent across requests
     av_dict_set(&opts, "user-agent", c->user_agent, 0);
     av_dict_set(&opts, "cookies", c->cookies, 0);
     av_dict_set(&opts, "seekable", "0", 0);
 
     if (seg->key_type == KEY_NONE) {
-        ret = ffurl_open(&var->input, seg->url, AVIO_FLAG_READ,
-                          &var->parent->interrupt_callback, &opts);
+        ret = open_url(c, &var->input, seg->url, opts);
         goto cleanup;
     } else if (seg->key_type == KEY_AES_128) {
         char iv[33], key[33], url[MAX_URL_SIZE];
         if (strcmp(seg->key, var->key_url)) {
             URLContext *uc;
-            if (ffurl_open(&uc, seg->key, AVIO_FLAG_READ,
-                           &var->parent->interrupt_callback, &opts) == 0) {
+            if (open_url(c, &uc, seg->key, opts) == 0) {
                 if (ffurl_read_complete(uc, var->key, sizeof(var->key))
                     != sizeof(var->key)) {
                     av_log(NULL, AV_LOG_ERROR, "Unable to read key file %s\n",
                            seg->key);
                 }
-                ffurl_close(uc);
+                close_url(c, &uc);
             } else {
                 av_log(NULL, AV_LOG_ERROR, "Unable to open key file %s\n",
                        seg->key);
@@ -407,7 +669,7 @@ static int read_data(void *opaque, uint8_t *buf, int buf_size)
     int ret, i;
 
 restart:
-    if (!v->input) {
+    if (!v->input && !v->cur_prefetch) {
         /* If this is a live stream and the reload interval has elapsed since
          * the last playlist reload, reload the variant playlists now. */
         int64_t reload_interval = v->n_segments > 0 ?
@@ -447,11 +709,19 @@ reload:
         if (ret < 0)
             return ret;
     }
-    ret = ffurl_read(v->input, buf, buf_size);
-    if (ret > 0)
-        return ret;
-    ffurl_close(v->input);
-    v->input = NULL;
+#if HAVE_PTHREADS
+    if (v->cur_prefetch) {
+        ret = read_prefetch(c, v, buf, buf_size);
+        if (ret > 0)
+            return ret;
+    }
+#endif
+    if (v->input) {
+        ret = ffurl_read(v->input, buf, buf_size);
+        if (ret > 0)
+            return ret;
+    }
+    close_url(c, &v->input);
     v->cur_seq_no++;
 
     c->end_of_segment = 1;
@@ -640,9 +910,8 @@ static int recheck_discard_flags(AVFormatContext *s, int first)
             v->pb.eof_reached = 0;
             av_log(s, AV_LOG_INFO, "Now receiving variant %d\n", i);
         } else if (first && !v->cur_needed && v->needed) {
-            if (v->input)
-                ffurl_close(v->input);
-            v->input = NULL;
+            cancel_prefetches(v);
+            close_url(c, &v->input);
             v->needed = 0;
             changed = 1;
             av_log(s, AV_LOG_INFO, "No longer receiving variant %d\n", i);
@@ -775,10 +1044,8 @@ static int hls_read_seek(AVFormatContext *s, int stream_index,
                                s->streams[stream_index]->time_base.den :
                                AV_TIME_BASE, flags & AVSEEK_FLAG_BACKWARD ?
                                AV_ROUND_DOWN : AV_ROUND_UP);
-         if (var->input) {
-            ffurl_close(var->input);
-            var->input = NULL;
-        }
+        cancel_prefetches(var);
+        close_url(c, &var->input);
         av_free_packet(&var->pkt);
         reset_packet(&var->pkt);
         var->pb.eof_reached = 0;
@@ -816,6 +1083,23 @@ static int hls_probe(AVProbeData *p)
     return 0;
 }
 
+#define OFFSET(x) offsetof(HLSContext, x)
+#define FLAGS AV_OPT_FLAG_DECODING_PARAM
+static const AVOption hls_options[] = {
+    { "prefetch_segments", "number of segments downloaded in the background ahead of the current one",
+      OFFSET(prefetch_segments), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, MAX_PREFETCH_SEGMENTS, FLAGS },
+    { "prefetch_buffer_size", "maximum amount of data buffered for each prefetched segment",
+      OFFSET(prefetch_buffer_size), AV_OPT_TYPE_INT, { .i64 = 4 << 20 }, PREFETCH_CHUNK_SIZE, INT_MAX, FLAGS },
+    { NULL }
+};
+
+static const AVClass hls_class = {
+    .class_name = "hls demuxer",
+    .item_name  = av_default_item_name,
+    .option     = hls_options,
+    .version    = LIBAVUTIL_VERSION_INT,
+};
+
 AVInputFormat ff_hls_demuxer = {
     .name           = "hls,applehttp",
     .long_name      = NULL_IF_CONFIG_SMALL("Apple HTTP Live Streaming"),
@@ -825,4 +1109,5 @@ AVInputFormat ff_hls_demuxer = {
     .read_packet    = hls_read_packet,
     .read_close     = hls_close,
     .read_seek      = hls_read_seek,
+    .priv_class     = &hls_class,
 };
@@ -29,6 +29,7 @@
 
 #include "avformat.h"
 #include "internal.h"
+#include "ioqueue.h"
 
 typedef struct ListEntry {
     char  name[1024];
@@ -45,6 +46,7 @@ typedef struct HLSContext {
     float time;            // Set by a private option.
     int  size;             // Set by a private option.
     int  wrap;             // Set by a private option.
+    int  async_queue_size; // Set by a private option.
     int64_t recording_time;
     int has_video;
     int64_t start_pts;
@@ -54,7 +56,7 @@ typedef struct HLSContext {
     ListEntry *list;
     ListEntry *end_list;
     char *basename;
-    AVIOContext *pb;
+    IOQueue *io_queue;     ///< finishes the segments and writes the playlist
 } HLSContext;
 
 static int hls_mux_init(AVFormatContext *s)
@@ -126,36 +128,37 @@ static void free_entries(HLSContext *hls)
 static int hls_window(AVFormatContext *s, int last)
 {
     HLSContext *hls = s->priv_data;
+    AVIOContext *pb;
     ListEntry *en;
+    uint8_t *buf;
     int target_duration = 0;
-    int ret = 0;
+    int ret, size;
 
-    if ((ret = avio_open2(&hls->pb, s->filename, AVIO_FLAG_WRITE,
-                          &s->interrupt_callback, NULL)) < 0)
-        goto fail;
+    if ((ret = avio_open_dyn_buf(&pb)) < 0)
+        return ret;
 
     for (en = hls->list; en; en = en->next) {
         if (target_duration < en->duration)
             target_duration = en->duration;
     }
 
-    avio_printf(hls->pb, "#EXTM3U\n");
-    avio_printf(hls->pb, "#EXT-X-VERSION:3\n");
-    avio_printf(hls->pb, "#EXT-X-TARGETDURATION:%d\n", target_duration);
-    avio_printf(hls->pb, "#EXT-X-MEDIA-SEQUENCE:%"PRId64"\n",
+    avio_printf(pb, "#EXTM3U\n");
+    avio_printf(pb, "#EXT-X-VERSION:3\n");
+    avio_printf(pb, "#EXT-X-TARGETDURATION:%d\n", target_duration);
+    avio_printf(pb, "#EXT-X-MEDIA-SEQUENCE:%"PRId64"\n",
                 FFMAX(0, hls->sequence - hls->size));
 
     for (en = hls->list; en; en = en->next) {
-        avio_printf(hls->pb, "#EXTINF:%d,\n", en->duration);
-        avio_printf(hls->pb, "%s\n", en->name);
+        avio_printf(pb, "#EXTINF:%d,\n", en->duration);
+        avio_printf(pb, "%s\n", en->name);
     }
 
     if (last)
-        avio_printf(hls->pb, "#EXT-X-ENDLIST\n");
+        avio_printf(pb, "#EXT-X-ENDLIST\n");
 
-fail:
-    avio_closep(&hls->pb);
-    return ret;
+    size = avio_close_dyn_buf(pb, &buf);
+    return ff_ioqueue_write_url(hls->io_queue, s->filename,
+                                &s->interrupt_callback, buf, size);
 }
 
 static int hls_start(AVFormatContext *s)
@@ -226,6 +229,10 @@ static int hls_write_header(AVFormatContext *s)
 
     av_strlcat(hls->basename, pattern, basename_size);
 
+    if (hls->async_queue_size &&
+        (ret = ff_ioqueue_alloc(&hls->io_queue, hls->async_queue_size, s)) < 0)
+        goto fail;
+
     if ((ret = hls_mux_init(s)) < 0)
         goto fail;
 
@@ -241,6 +248,7 @@ fail:
         av_free(hls->basename);
         if (hls->avf)
             avformat_free_context(hls->avf);
+        ff_ioqueue_free(&hls->io_queue);
     }
     return ret;
 }
@@ -281,7 +289,10 @@ static int hls_write_packet(AVFormatContext *s, AVPacket *pkt)
         hls->duration = 0;
 
         av_write_frame(oc, NULL); /* Flush any buffered data */
-        avio_close(oc->pb);
+        ret = ff_ioqueue_close(hls->io_queue, oc->pb);
+        oc->pb = NULL;
+        if (ret < 0)
+            return ret;
 
         ret = hls_start(s);
 
@@ -305,15 +316,15 @@ static int hls_write_trailer(struct AVFormatContext *s)
     AVFormatContext *oc = hls->avf;
 
     av_write_trailer(oc);
-    avio_closep(&oc->pb);
+    ff_ioqueue_close(hls->io_queue, oc->pb);
+    oc->pb = NULL;
     avformat_free_context(oc);
     av_free(hls->basename);
     append_entry(hls, hls->duration);
     hls_window(s, 1);
 
     free_entries(hls);
-    avio_close(hls->pb);
-    return 0;
+    return ff_ioqueue_free(&hls->io_queue);
 }
 
 #define OFFSET(x) offsetof(HLSContext, x)
@@ -323,6 +334,7 @@ static const AVOption options[] = {
     {"hls_time",      "set segment length in seconds",           OFFSET(time),    AV_OPT_TYPE_FLOAT,  {.dbl = 2},     0, FLT_MAX, E},
     {"hls_list_size", "set maximum number of playlist entries",  OFFSET(size),    AV_OPT_TYPE_INT,    {.i64 = 5},     0, INT_MAX, E},
     {"hls_wrap",      "set number after which the index wraps",  OFFSET(wrap),    AV_OPT_TYPE_INT,    {.i64 = 0},     0, INT_MAX, E},
+    {"hls_async_queue", "set number of segment and playlist writes done in the background", OFFSET(async_queue_size), AV_OPT_TYPE_INT, {.i64 = 0}, 0, INT_MAX, E},
     { NULL },
 };
 
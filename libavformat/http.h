@@ -45,4 +45,17 @@ void ff_http_init_auth_state(URLContext *dest, const URLContext *src);
  */
 int ff_http_do_new_request(URLContext *h, const char *uri);
 
+/**
+ * Check if the connection of an HTTP URLContext can be used for a new
+ * request with ff_http_do_new_request(). This is the case when h was opened
+ * with the multiple_requests option, its response has been read entirely,
+ * and the server did not ask to close the connection.
+ *
+ * @param h   URLContext of any protocol
+ * @param uri uri of the new request, it must use the same scheme, host and
+ *            port as the current one. May be NULL to skip this check.
+ * @return 1 if the connection can be reused, 0 otherwise
+ */
+int ff_http_can_reuse_connection(URLContext *h, const char *uri);
+
 #endif /* AVFORMAT_HTTP_H */
@@ -22,12 +22,17 @@
 
 #include <sys/stat.h>
 #include "libavutil/avstring.h"
+#include "libavutil/buffer.h"
 #include "libavutil/log.h"
 #include "libavutil/opt.h"
 #include "libavutil/pixdesc.h"
 #include "libavutil/parseutils.h"
 #include "avformat.h"
 #include "internal.h"
+#include "url.h"
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
 #if HAVE_GLOB
 #include <glob.h>
 
@@ -42,6 +47,15 @@
 
 #endif /* HAVE_GLOB */
 
+typedef struct {
+    int number;             /**< image number of the file */
+    int done;               /**< set once the file has been read */
+    int ret;
+    int first_size;
+    int64_t mtime;
+    AVPacket pkt;
+} PrefetchFile;
+
 typedef struct {
     const AVClass *class;  /**< Class for private options. */
     int img_first;
@@ -65,6 +79,21 @@ typedef struct {
     int start_number_range;
     int frame_size;
     int ts_from_file;
+    int prefetch;           /**< number of files read ahead, set by a private option */
+#if HAVE_PTHREADS
+    PrefetchFile *files;    /**< ring of the files read ahead */
+    pthread_t *threads;
+    int nb_threads;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int64_t queue_head;     /**< index of the oldest queued file */
+    int64_t queue_tail;     /**< index after the newest queued file */
+    int64_t next_job;       /**< index of the next file for the threads to read */
+    int next_number;        /**< image number after the newest queued file */
+    int abort;
+    AVBufferPool *pool;
+    int pool_size;
+#endif
 } VideoDemuxData;
 
 static const int sizes[][2] = {
@@ -177,6 +206,285 @@ fail:
     return -1;
 }
 
+#if HAVE_PTHREADS
+static AVBufferRef *prefetch_get_buffer(VideoDemuxData *s, int size)
+{
+    AVBufferRef *buf = NULL;
+
+    pthread_mutex_lock(&s->mutex);
+    if (s->pool_size < size) {
+        /* the buffers still in use stay valid until they are released */
+        av_buffer_pool_uninit(&s->pool);
+        s->pool_size = 0;
+        if ((s->pool = av_buffer_pool_init(size, NULL)))
+            s->pool_size = size;
+    }
+    if (s->pool)
+        buf = av_buffer_pool_get(s->pool);
+    pthread_mutex_unlock(&s->mutex);
+    return buf;
+}
+#endif
+
+/**
+ * Read the image file(s) with the given number into pkt.
+ *
+ * @param first_size set to the size of the first file, used to infer the
+ *                   dimensions of raw video
+ * @param mtime      set to the modification time of the first file if
+ *                   ts_from_file is set
+ * @param pooled     take the packet buffer from the prefetch buffer pool
+ */
+static int read_image(AVFormatContext *s1, int number, AVPacket *pkt,
+                      int *first_size, int64_t *mtime,
+                      AVIOInterruptCB *int_cb, int pooled)
+{
+    VideoDemuxData *s = s1->priv_data;
+    char filename[1024];
+    int i, res = 0;
+    int size[3]       = { 0 }, ret[3] = { 0 };
+    AVIOContext *f[3] = { NULL };
+
+    av_init_packet(pkt);
+    pkt->data = NULL;
+    pkt->size = 0;
+
+    if (s->use_glob) {
+#if HAVE_GLOB
+        /* copied, as the name is modified for split planes */
+        av_strlcpy(filename, s->globstate.gl_pathv[number], sizeof(filename));
+#endif
+    } else if (av_get_frame_filename(filename, sizeof(filename),
+                                     s->path, number) < 0 && number > 1)
+        return AVERROR(EIO);
+
+    for (i = 0; i < 3; i++) {
+        if (avio_open2(&f[i], filename, AVIO_FLAG_READ, int_cb, NULL) < 0) {
+            if (i >= 1)
+                break;
+            if (!ff_check_interrupt(int_cb))
+                av_log(s1, AV_LOG_ERROR, "Could not open file : %s\n",
+                       filename);
+            return AVERROR(EIO);
+        }
+        size[i] = avio_size(f[i]);
+
+        if (!i && s->ts_from_file) {
+            struct stat img_stat;
+            if (stat(filename, &img_stat)) {
+                res = AVERROR(EIO);
+                goto end;
+            }
+            *mtime = (int64_t)img_stat.st_mtime;
+        }
+
+        if (!s->split_planes)
+            break;
+        filename[strlen(filename) - 1] = 'U' + i;
+    }
+    *first_size = size[0];
+
+#if HAVE_PTHREADS
+    if (pooled) {
+        int total = size[0] + size[1] + size[2];
+
+        if (total >= 0 && total < INT_MAX - FF_INPUT_BUFFER_PADDING_SIZE)
+            pkt->buf = prefetch_get_buffer(s, total + FF_INPUT_BUFFER_PADDING_SIZE);
+        if (!pkt->buf) {
+            res = AVERROR(ENOMEM);
+            goto end;
+        }
+        pkt->data = pkt->buf->data;
+    } else
+#endif
+    if (av_new_packet(pkt, size[0] + size[1] + size[2]) < 0) {
+        res = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    pkt->size = 0;
+    for (i = 0; i < 3; i++) {
+        if (f[i]) {
+            ret[i] = avio_read(f[i], pkt->data + pkt->size, size[i]);
+            if (ret[i] > 0)
+                pkt->size += ret[i];
+        }
+    }
+    memset(pkt->data + pkt->size, 0, FF_INPUT_BUFFER_PADDING_SIZE);
+
+    if (ret[0] <= 0 || ret[1] < 0 || ret[2] < 0) {
+        av_free_packet(pkt);
+        res = AVERROR(EIO); /* signal EOF */
+    }
+
+end:
+    for (i = 0; i < 3; i++)
+        avio_close(f[i]);
+    return res;
+}
+
+#if HAVE_PTHREADS
+static int prefetch_interrupt_cb(void *opaque)
+{
+    AVFormatContext *s1 = opaque;
+    VideoDemuxData *s   = s1->priv_data;
+
+    return s->abort || ff_check_interrupt(&s1->interrupt_callback);
+}
+
+static void *prefetch_thread(void *arg)
+{
+    AVFormatContext *s1    = arg;
+    VideoDemuxData *s      = s1->priv_data;
+    AVIOInterruptCB int_cb = { prefetch_interrupt_cb, s1 };
+
+    pthread_mutex_lock(&s->mutex);
+    while (!s->abort) {
+        PrefetchFile *file;
+        AVPacket pkt;
+        int number, first_size = 0, ret;
+        int64_t mtime = 0;
+
+        if (s->next_job == s->queue_tail) {
+            pthread_cond_wait(&s->cond, &s->mutex);
+            continue;
+        }
+        file   = &s->files[s->next_job++ % s->prefetch];
+        number = file->number;
+        pthread_mutex_unlock(&s->mutex);
+
+        ret = read_image(s1, number, &pkt, &first_size, &mtime, &int_cb, 1);
+
+        pthread_mutex_lock(&s->mutex);
+        file->pkt        = pkt;
+        file->ret        = ret;
+        file->first_size = first_size;
+        file->mtime      = mtime;
+        file->done       = 1;
+        pthread_cond_broadcast(&s->cond);
+    }
+    pthread_mutex_unlock(&s->mutex);
+    return NULL;
+}
+
+/**
+ * Queue the next files for the threads to read, up to prefetch files.
+ * Must be called with the mutex locked.
+ */
+static void prefetch_queue(VideoDemuxData *s)
+{
+    while (s->queue_tail - s->queue_head < s->prefetch) {
+        PrefetchFile *file;
+
+        if (s->next_number > s->img_last) {
+            if (!s->loop)
+                break;
+            s->next_number = s->img_first;
+        }
+        file = &s->files[s->queue_tail++ % s->prefetch];
+        file->number = s->next_number++;
+        file->done   = 0;
+    }
+    pthread_cond_broadcast(&s->cond);
+}
+
+/**
+ * Drop the queued files, waiting for those being read.
+ * Must be called with the mutex locked.
+ */
+static void prefetch_flush(VideoDemuxData *s)
+{
+    s->queue_tail = s->next_job;
+    while (s->queue_head != s->queue_tail) {
+        PrefetchFile *file = &s->files[s->queue_head % s->prefetch];
+
+        if (!file->done) {
+            pthread_cond_wait(&s->cond, &s->mutex);
+            continue;
+        }
+        av_free_packet(&file->pkt);
+        s->queue_head++;
+    }
+}
+
+static int prefetch_read(AVFormatContext *s1, AVPacket *pkt,
+                         int *first_size, int64_t *mtime)
+{
+    VideoDemuxData *s = s1->priv_data;
+    PrefetchFile *file;
+    int ret;
+
+    pthread_mutex_lock(&s->mutex);
+    /* after a seek, the queued files are not the wanted ones anymore */
+    if (s->queue_head != s->queue_tail &&
+        s->files[s->queue_head % s->prefetch].number != s->img_number)
+        prefetch_flush(s);
+    if (s->queue_head == s->queue_tail)
+        s->next_number = s->img_number;
+    prefetch_queue(s);
+
+    file = &s->files[s->queue_head % s->prefetch];
+    while (!file->done)
+        pthread_cond_wait(&s->cond, &s->mutex);
+    *pkt        = file->pkt;
+    ret         = file->ret;
+    *first_size = file->first_size;
+    *mtime      = file->mtime;
+    s->queue_head++;
+    prefetch_queue(s);
+    pthread_mutex_unlock(&s->mutex);
+
+    return ret;
+}
+
+static void prefetch_stop(VideoDemuxData *s)
+{
+    int i;
+
+    if (!s->files)
+        return;
+    pthread_mutex_lock(&s->mutex);
+    s->abort = 1;
+    prefetch_flush(s);
+    pthread_cond_broadcast(&s->cond);
+    pthread_mutex_unlock(&s->mutex);
+    for (i = 0; i < s->nb_threads; i++)
+        pthread_join(s->threads[i], NULL);
+    s->nb_threads = 0;
+    pthread_cond_destroy(&s->cond);
+    pthread_mutex_destroy(&s->mutex);
+    av_buffer_pool_uninit(&s->pool);
+    av_freep(&s->threads);
+    av_freep(&s->files);
+}
+
+static int prefetch_start(AVFormatContext *s1)
+{
+    VideoDemuxData *s = s1->priv_data;
+    int i, ret;
+
+    s->files   = av_mallocz(s->prefetch * sizeof(*s->files));
+    s->threads = av_malloc(s->prefetch * sizeof(*s->threads));
+    if (!s->files || !s->threads) {
+        av_freep(&s->files);
+        av_freep(&s->threads);
+        return AVERROR(ENOMEM);
+    }
+    pthread_mutex_init(&s->mutex, NULL);
+    pthread_cond_init(&s->cond, NULL);
+
+    for (i = 0; i < s->prefetch; i++) {
+        if ((ret = pthread_create(&s->threads[i], NULL, prefetch_thread, s1))) {
+            av_log(s1, AV_LOG_WARNING, "Could not start all the read-ahead "
+                   "threads: %s\n", strerror(ret));
+            break;
+        }
+        s->nb_threads++;
+    }
+    return 0;
+}
+#endif
+
 static int img_read_probe(AVProbeData *p)
 {
     if (p->filename && ff_guess_image2_codec(p->filename)) {
@@ -325,104 +633,92 @@ static int img_read_header(AVFormatContext *s1)
         pix_fmt != AV_PIX_FMT_NONE)
         st->codec->pix_fmt = pix_fmt;
 
+#if HAVE_PTHREADS
+    if (!s->is_pipe && s->prefetch > 0) {
+        int ret = prefetch_start(s1);
+        if (ret < 0) {
+#if HAVE_GLOB
+            if (s->use_glob)
+                globfree(&s->globstate);
+#endif
+            return ret;
+        }
+    }
+#endif
+
     return 0;
 }
 
 static int img_read_packet(AVFormatContext *s1, AVPacket *pkt)
 {
     VideoDemuxData *s = s1->priv_data;
-    char filename_bytes[1024];
-    char *filename = filename_bytes;
-    int i;
-    int size[3]           = { 0 }, ret[3] = { 0 };
-    AVIOContext *f[3]     = { NULL };
+    int size = 0, ret;
     AVCodecContext *codec = s1->streams[0]->codec;
 
     if (!s->is_pipe) {
+        int64_t mtime = 0;
+
         /* loop over input */
         if (s->loop && s->img_number > s->img_last) {
             s->img_number = s->img_first;
         }
         if (s->img_number > s->img_last)
             return AVERROR_EOF;
-        if (s->use_glob) {
-#if HAVE_GLOB
-            filename = s->globstate.gl_pathv[s->img_number];
-#endif
-        } else {
-        if (av_get_frame_filename(filename_bytes, sizeof(filename_bytes),
-                                  s->path,
-                                  s->img_number) < 0 && s->img_number > 1)
-            return AVERROR(EIO);
-        }
-        for (i = 0; i < 3; i++) {
-            if (avio_open2(&f[i], filename, AVIO_FLAG_READ,
-                           &s1->interrupt_callback, NULL) < 0) {
-                if (i >= 1)
-                    break;
-                av_log(s1, AV_LOG_ERROR, "Could not open file : %s\n",
-                       filename);
-                return AVERROR(EIO);
-            }
-            size[i] = avio_size(f[i]);
 
-            if (!s->split_planes)
-                break;
-            filename[strlen(filename) - 1] = 'U' + i;
-        }
+#if HAVE_PTHREADS
+        if (s->nb_threads)
+            ret = prefetch_read(s1, pkt, &size, &mtime);
+        else
+#endif
+        ret = read_image(s1, s->img_number, pkt, &size, &mtime,
+                         &s1->interrupt_callback, 0);
+        if (ret < 0)
+            return ret;
 
         if (codec->codec_id == AV_CODEC_ID_RAWVIDEO && !codec->width)
-            infer_size(&codec->width, &codec->height, size[0]);
+            infer_size(&codec->width, &codec->height, size);
+
+        if (s->ts_from_file) {
+            pkt->pts = mtime;
+            av_add_index_entry(s1->streams[0], s->img_number, pkt->pts, 0, 0, AVINDEX_KEYFRAME);
+        } else {
+            pkt->pts = s->pts;
+        }
     } else {
-        f[0] = s1->pb;
-        if (url_feof(f[0]))
+        AVIOContext *f = s1->pb;
+
+        if (url_feof(f))
             return AVERROR(EIO);
         if (s->frame_size > 0) {
-            size[0] = s->frame_size;
+            size = s->frame_size;
         } else {
-            size[0] = 4096;
+            size = 4096;
         }
-    }
 
-    if (av_new_packet(pkt, size[0] + size[1] + size[2]) < 0)
-        return AVERROR(ENOMEM);
-    pkt->stream_index = 0;
-    pkt->flags       |= AV_PKT_FLAG_KEY;
-    if (s->ts_from_file) {
-        struct stat img_stat;
-        if (stat(filename, &img_stat))
-            return AVERROR(EIO);
-        pkt->pts = (int64_t)img_stat.st_mtime;
-        av_add_index_entry(s1->streams[0], s->img_number, pkt->pts, 0, 0, AVINDEX_KEYFRAME);
-    } else if (!s->is_pipe) {
-        pkt->pts      = s->pts;
-    }
-
-    pkt->size = 0;
-    for (i = 0; i < 3; i++) {
-        if (f[i]) {
-            ret[i] = avio_read(f[i], pkt->data + pkt->size, size[i]);
-            if (!s->is_pipe)
-                avio_close(f[i]);
-            if (ret[i] > 0)
-                pkt->size += ret[i];
+        if (av_new_packet(pkt, size) < 0)
+            return AVERROR(ENOMEM);
+        ret = avio_read(f, pkt->data, size);
+        if (ret <= 0) {
+            av_free_packet(pkt);
+            return AVERROR(EIO); /* signal EOF */
         }
+        pkt->size = ret;
     }
 
-    if (ret[0] <= 0 || ret[1] < 0 || ret[2] < 0) {
-        av_free_packet(pkt);
-        return AVERROR(EIO); /* signal EOF */
-    } else {
-        s->img_count++;
-        s->img_number++;
-        s->pts++;
-        return 0;
-    }
+    pkt->stream_index = 0;
+    pkt->flags       |= AV_PKT_FLAG_KEY;
+    s->img_count++;
+    s->img_number++;
+    s->pts++;
+    return 0;
 }
 
 static int img_read_close(struct AVFormatContext* s1)
 {
     VideoDemuxData *s = s1->priv_data;
+#if HAVE_PTHREADS
+    prefetch_stop(s);
+#endif
 #if HAVE_GLOB
     if (s->use_glob) {
         globfree(&s->globstate);
@@ -468,6 +764,7 @@ static const AVOption options[] = {
     { "video_size",   "set video size",                      OFFSET(width),        AV_OPT_TYPE_IMAGE_SIZE, {.str = NULL}, 0, 0,   DEC },
     { "frame_size",   "force frame size in bytes",           OFFSET(frame_size),   AV_OPT_TYPE_INT,    {.i64 = 0   }, 0, INT_MAX, DEC },
     { "ts_from_file", "set frame timestamp from file's one", OFFSET(ts_from_file), AV_OPT_TYPE_INT,    {.i64 = 0   }, 0, 1,       DEC },
+    { "prefetch",     "set number of files read ahead in parallel", OFFSET(prefetch), AV_OPT_TYPE_INT, {.i64 = 0   }, 0, 64,      DEC },
     { NULL },
 };
 
@@ -81,8 +81,23 @@ void ff_program_add_stream_index(AVFormatContext *ac, int progid, unsigned int i
 int ff_interleave_add_packet(AVFormatContext *s, AVPacket *pkt,
                               int (*compare)(AVFormatContext *, AVPacket *, AVPacket *));
 
+/**
+ * Free the per-stream interleaving queues of a muxer, and the packets
+ * left in them.
+ */
+void ff_interleaver_free(AVFormatContext *s);
+
 void ff_read_frame_flush(AVFormatContext *s);
 
+/**
+ * Get a packet payload buffer from the process-wide packet buffer pools.
+ * The buffer holds at least size + FF_INPUT_BUFFER_PADDING_SIZE bytes,
+ * the padding is not cleared.
+ * @return the buffer, or NULL if size is too large to be pooled or on
+ *         allocation failure
+ */
+AVBufferRef *ff_packet_pool_get(int size);
+
 #define NTP_OFFSET 2208988800ULL
 #define NTP_OFFSET_US (NTP_OFFSET * 1000000ULL)
 
@@ -219,6 +234,59 @@ int ff_add_index_entry(AVIndexEntry **index_entries,
                        unsigned int *index_entries_allocated_size,
                        int64_t pos, int64_t timestamp, int size, int distance, int flags);
 
+/**
+ * Add an index entry found while reading or searching the file, reducing
+ * the index first if needed, like ff_reduce_index() and
+ * av_add_index_entry() would. Entries which fall in the middle of the
+ * index are queued and merged together, at the latest before the index
+ * is searched or a seek is done.
+ *
+ * @return >= 0 on success, a negative value otherwise
+ */
+int ff_add_index_hint(AVFormatContext *s, int stream_index, int64_t pos,
+                      int64_t timestamp, int size, int distance, int flags);
+
+/**
+ * Merge the queued index hints of st into its index_entries.
+ */
+int ff_flush_index_hints(AVStream *st);
+
+/**
+ * Append an entry to the compact index of a stream, allocating it on first
+ * use. The entries must be added in timestamp order; the compact index
+ * stores them in about a fifth of the memory of AVStream.index_entries,
+ * for demuxers which know the whole index of huge files upfront.
+ *
+ * @return the index of the new entry, or a negative AVERROR code
+ */
+int ff_compact_index_add(AVStream *st, int64_t pos, int64_t timestamp,
+                         int size, int distance, int flags);
+
+/**
+ * @return the number of entries of the compact index of st
+ */
+int ff_compact_index_count(const AVStream *st);
+
+/**
+ * Get an entry of the compact index. The returned entry is only valid
+ * until the next call to one of the ff_compact_index functions.
+ */
+const AVIndexEntry *ff_compact_index_get(AVStream *st, int index);
+
+/**
+ * Same as ff_index_search_timestamp(), on the compact index of st.
+ */
+int ff_compact_index_search_timestamp(AVStream *st, int64_t wanted_timestamp,
+                                      int flags);
+
+/**
+ * Move the entries of the compact index to AVStream.index_entries and
+ * free the compact index.
+ */
+int ff_compact_index_expand(AVStream *st);
+
+void ff_compact_index_free(AVStream *st);
+
 /**
  * Add a new chapter.
  *
@@ -320,6 +388,46 @@ int ff_add_param_change(AVPacket *pkt, int32_t channels,
  */
 int ff_framehash_write_header(AVFormatContext *s);
 
+/**
+ * Hash one packet of a frame hash muxer into a line of the output.
+ *
+ * @param thread index of the calling thread, from 0 to the number of
+ *               threads of the pool - 1, for the per thread hash contexts
+ */
+typedef void (*FFFrameHashFunc)(AVFormatContext *s, int thread,
+                                AVPacket *pkt, char *line, int size);
+
+typedef struct FFFrameHashPool FFFrameHashPool;
+
+/**
+ * Create the pool of threads hashing the packets of a frame hash muxer.
+ * The packets are independent, so they are hashed in parallel, the lines
+ * being written in the order of the packets.
+ *
+ * @param nb_threads number of threads, 0 for one per CPU, the packets
+ *                   being hashed by the caller if 1 or if threads are
+ *                   not supported
+ */
+int ff_framehash_pool_init(FFFrameHashPool **ppool, AVFormatContext *s,
+                           FFFrameHashFunc hash, int nb_threads);
+
+/**
+ * Return the number of threads of the pool, the hash function being
+ * called with thread indexes lower than that.
+ */
+int ff_framehash_pool_threads(FFFrameHashPool *pool);
+
+/**
+ * Hash a packet with the pool, writing the lines of the packets hashed so
+ * far. The packet is referenced, so it can be freed by the caller.
+ */
+int ff_framehash_pool_write(FFFrameHashPool *pool, AVPacket *pkt);
+
+/**
+ * Write the lines of all the packets and free the pool.
+ */
+void ff_framehash_pool_close(FFFrameHashPool **ppool);
+
 /**
  * Read a transport packet from a media file.
  *
@@ -392,4 +500,13 @@ void ff_generate_avci_extradata(AVStream *st);
 
 int ff_http_match_no_proxy(const char *no_proxy, const char *hostname);
 
+/**
+ * Stamp a stage of the latency trace carried by a packet, see
+ * AVFMT_FLAG_LATENCY_TRACE. Side data merged into the packet data is handled.
+ *
+ * @param create add a trace to packets which do not carry one
+ */
+int ff_packet_latency_trace_stamp(AVPacket *pkt, enum AVLatencyStage stage,
+                                  int create);
+
 #endif /* AVFORMAT_INTERNAL_H */
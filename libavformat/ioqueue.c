@@ -0,0 +1,231 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
+#include "libavutil/log.h"
+#include "libavutil/mem.h"
+#include "avformat.h"
+#include "ioqueue.h"
+
+typedef struct IOJob {
+    AVIOContext *pb;            ///< context to write data to, or to close
+    char *url;                  ///< resource to replace by data
+    AVIOInterruptCB int_cb;
+    uint8_t *data;
+    int size;
+    int (*func)(void *opaque);  ///< custom operation
+    void *opaque;
+} IOJob;
+
+struct IOQueue {
+    void *log_ctx;
+    IOJob *jobs;
+    int max_jobs;
+    int first_job, nb_jobs;
+    int error;                  ///< first error of the completed jobs
+    int quit;
+#if HAVE_PTHREADS
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+#endif
+};
+
+static int run_job(IOJob *job, void *log_ctx)
+{
+    AVIOContext *pb = job->pb;
+    int ret = 0;
+
+    if (job->func) {
+        ret = job->func(job->opaque);
+        return FFMIN(ret, 0);
+    }
+    if (job->url) {
+        ret = avio_open2(&pb, job->url, AVIO_FLAG_WRITE, &job->int_cb, NULL);
+        if (ret < 0)
+            av_log(log_ctx, AV_LOG_ERROR, "Could not open '%s'\n", job->url);
+    }
+    if (pb && ret >= 0) {
+        if (job->data) {
+            avio_write(pb, job->data, job->size);
+            avio_flush(pb);
+            ret = pb->error;
+        }
+        if (!job->data || job->url) {
+            int err = avio_close(pb);
+            ret = ret < 0 ? ret : err;
+        }
+    }
+    av_free(job->url);
+    av_free(job->data);
+    return FFMIN(ret, 0);
+}
+
+#if HAVE_PTHREADS
+static void *ioqueue_thread(void *arg)
+{
+    IOQueue *q = arg;
+
+    pthread_mutex_lock(&q->mutex);
+    for (;;) {
+        IOJob job;
+        int ret;
+
+        if (!q->nb_jobs) {
+            if (q->quit)
+                break;
+            pthread_cond_wait(&q->cond, &q->mutex);
+            continue;
+        }
+        job = q->jobs[q->first_job];
+        pthread_mutex_unlock(&q->mutex);
+        ret = run_job(&job, q->log_ctx);
+        pthread_mutex_lock(&q->mutex);
+
+        if (ret < 0 && !q->error)
+            q->error = ret;
+        q->first_job = (q->first_job + 1) % q->max_jobs;
+        q->nb_jobs--;
+        pthread_cond_broadcast(&q->cond);
+    }
+    pthread_mutex_unlock(&q->mutex);
+
+    return NULL;
+}
+#endif
+
+int ff_ioqueue_alloc(IOQueue **pq, int max_jobs, void *log_ctx)
+{
+#if HAVE_PTHREADS
+    IOQueue *q;
+    int ret;
+
+    *pq = NULL;
+    if (!(q = av_mallocz(sizeof(*q))))
+        return AVERROR(ENOMEM);
+    if (!(q->jobs = av_mallocz(max_jobs * sizeof(*q->jobs)))) {
+        av_free(q);
+        return AVERROR(ENOMEM);
+    }
+    q->log_ctx  = log_ctx;
+    q->max_jobs = max_jobs;
+
+    pthread_mutex_init(&q->mutex, NULL);
+    pthread_cond_init(&q->cond, NULL);
+    if ((ret = pthread_create(&q->thread, NULL, ioqueue_thread, q))) {
+        av_log(log_ctx, AV_LOG_ERROR, "pthread_create failed: %s\n", strerror(ret));
+        pthread_cond_destroy(&q->cond);
+        pthread_mutex_destroy(&q->mutex);
+        av_free(q->jobs);
+        av_free(q);
+        return AVERROR(ret);
+    }
+    *pq = q;
+#else
+    *pq = NULL;
+    av_log(log_ctx, AV_LOG_WARNING,
+           "Threads are not available, output operations will be synchronous\n");
+#endif
+    return 0;
+}
+
+int ff_ioqueue_free(IOQueue **pq)
+{
+    IOQueue *q = *pq;
+    int ret = 0;
+
+    if (!q)
+        return 0;
+#if HAVE_PTHREADS
+    pthread_mutex_lock(&q->mutex);
+    q->quit = 1;
+    pthread_cond_broadcast(&q->cond);
+    pthread_mutex_unlock(&q->mutex);
+    pthread_join(q->thread, NULL);
+
+    pthread_cond_destroy(&q->cond);
+    pthread_mutex_destroy(&q->mutex);
+#endif
+    ret = q->error;
+    av_free(q->jobs);
+    av_freep(pq);
+    return ret;
+}
+
+static int queue_job(IOQueue *q, IOJob *job)
+{
+#if HAVE_PTHREADS
+    int ret;
+
+    if (q) {
+        pthread_mutex_lock(&q->mutex);
+        while (q->nb_jobs == q->max_jobs)
+            pthread_cond_wait(&q->cond, &q->mutex);
+        q->jobs[(q->first_job + q->nb_jobs++) % q->max_jobs] = *job;
+        pthread_cond_broadcast(&q->cond);
+        ret = q->error;
+        pthread_mutex_unlock(&q->mutex);
+        return ret;
+    }
+#endif
+    return run_job(job, q ? q->log_ctx : NULL);
+}
+
+int ff_ioqueue_close(IOQueue *q, AVIOContext *pb)
+{
+    IOJob job = { pb };
+
+    if (!pb)
+        return 0;
+    return queue_job(q, &job);
+}
+
+int ff_ioqueue_write(IOQueue *q, AVIOContext *pb, uint8_t *data, int size)
+{
+    IOJob job = { pb, NULL, { NULL }, data, size };
+
+    return queue_job(q, &job);
+}
+
+int ff_ioqueue_run(IOQueue *q, int (*func)(void *opaque), void *opaque)
+{
+    IOJob job = { NULL };
+
+    job.func   = func;
+    job.opaque = opaque;
+    return queue_job(q, &job);
+}
+
+int ff_ioqueue_write_url(IOQueue *q, const char *url,
+                         const AVIOInterruptCB *int_cb, uint8_t *data, int size)
+{
+    IOJob job = { NULL, av_strdup(url), { NULL }, data, size };
+
+    if (!job.url) {
+        av_free(data);
+        return AVERROR(ENOMEM);
+    }
+    if (int_cb)
+        job.int_cb = *int_cb;
+    return queue_job(q, &job);
+}
@@ -0,0 +1,81 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Background queue of output operations, used by the segmenting muxers to
+ * finish segments and update playlists without blocking the muxing thread.
+ *
+ * The operations are run in the order they were queued, by a single thread.
+ * All the functions accept a NULL queue, in which case the operation is run
+ * immediately, so that the callers need only one code path.
+ */
+
+#ifndef AVFORMAT_IOQUEUE_H
+#define AVFORMAT_IOQUEUE_H
+
+#include <stdint.h>
+
+#include "avio.h"
+
+typedef struct IOQueue IOQueue;
+
+/**
+ * Allocate a queue and start its thread.
+ *
+ * @param q        set to the queue, or NULL if threads are not available
+ * @param max_jobs number of pending operations after which queuing a new
+ *                 one waits for the oldest to complete
+ */
+int ff_ioqueue_alloc(IOQueue **q, int max_jobs, void *log_ctx);
+
+/**
+ * Run all the pending operations, stop the thread and free the queue.
+ *
+ * @return the first error of the queued operations, or 0
+ */
+int ff_ioqueue_free(IOQueue **q);
+
+/**
+ * Queue avio_close() of pb, which must not be accessed by the caller anymore.
+ *
+ * @return the first error of the previously queued operations, or 0
+ */
+int ff_ioqueue_close(IOQueue *q, AVIOContext *pb);
+
+/**
+ * Queue writing size bytes of data to pb, and flushing it. The queue takes
+ * ownership of data, which must have been allocated with av_malloc().
+ * pb must only be accessed through the queue afterwards.
+ */
+int ff_ioqueue_write(IOQueue *q, AVIOContext *pb, uint8_t *data, int size);
+
+/**
+ * Queue replacing the content of the resource url by size bytes of data.
+ * The queue takes ownership of data, as for ff_ioqueue_write().
+ */
+int ff_ioqueue_write_url(IOQueue *q, const char *url,
+                         const AVIOInterruptCB *int_cb, uint8_t *data, int size);
+
+/**
+ * Queue calling func(opaque). func takes ownership of opaque, and its
+ * negative return value is reported as an error of the queue.
+ */
+int ff_ioqueue_run(IOQueue *q, int (*func)(void *opaque), void *opaque);
+
+#endif /* AVFORMAT_IOQUEUE_H */
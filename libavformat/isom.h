@@ -53,6 +53,20 @@ typedef struct MOVStsc {
     int id;
 } MOVStsc;
 
+/**
+ * Position in the sample tables of a track, for resolving the samples on
+ * demand instead of building the index.
+ */
+typedef struct MOVSampleCursor {
+    unsigned sample;
+    unsigned chunk;
+    unsigned stsc_index;
+    unsigned chunk_sample;  ///< number of the sample in its chunk
+    unsigned stts_index;
+    unsigned stts_sample;
+    AVIndexEntry entry;     ///< position, dts, size and flags of the sample
+} MOVSampleCursor;
+
 typedef struct MOVDref {
     uint32_t type;
     char *path;
@@ -142,6 +156,11 @@ typedef struct MOVStreamContext {
     int start_pad;        ///< amount of samples to skip due to enc-dec delay
     unsigned int rap_group_count;
     MOVSbgp *rap_group;
+    int lazy_index;       ///< samples are resolved from the sample tables on demand
+    unsigned lazy_nb_samples;
+    int lazy_key_off;
+    int64_t lazy_start_dts;
+    MOVSampleCursor lazy_cursor;
 } MOVStreamContext;
 
 typedef struct MOVContext {
@@ -162,6 +181,8 @@ typedef struct MOVContext {
     int use_absolute_path;
     int ignore_editlist;
     int64_t next_root_atom; ///< offset of the next root atom
+    int compact_index;
+    int lazy_index;
 } MOVContext;
 
 int ff_mp4_read_descr_len(AVIOContext *pb);
@@ -39,6 +39,7 @@
 #include "matroska.h"
 #include "libavcodec/bytestream.h"
 #include "libavcodec/mpeg4audio.h"
+#include "libavutil/arena.h"
 #include "libavutil/base64.h"
 #include "libavutil/intfloat.h"
 #include "libavutil/intreadwrite.h"
@@ -87,6 +88,7 @@ typedef struct {
     int      size;
     uint8_t *data;
     int64_t  pos;
+    AVBufferRef *buf;   ///< set if data is refcounted, as for blocks
 } EbmlBin;
 
 typedef struct {
@@ -281,6 +283,15 @@ typedef struct {
 
     /* File has SSA subtitles which prevent incremental cluster parsing. */
     int contains_ssa;
+
+    /* Clusters are only scanned for keyframes, block payloads are skipped. */
+    int scanning;
+
+    /* sizes of the laces of the block being parsed */
+    uint32_t lace_size[256];
+
+    /* EBML strings, all freed with the context */
+    FFArena *strings;
 } MatroskaDemuxContext;
 
 typedef struct {
@@ -772,20 +783,18 @@ static int ebml_read_float(AVIOContext *pb, int size, double *num)
  * Read the next element as an ASCII string.
  * 0 is success, < 0 is failure.
  */
-static int ebml_read_ascii(AVIOContext *pb, int size, char **str)
+static int ebml_read_ascii(MatroskaDemuxContext *matroska, AVIOContext *pb,
+                           int size, char **str)
 {
     char *res;
 
     /* EBML strings are usually not 0-terminated, so we allocate one
      * byte more, read the string and NULL-terminate it ourselves. */
-    if (!(res = av_malloc(size + 1)))
+    if (!(res = avpriv_arena_alloc(&matroska->strings, size + 1)))
         return AVERROR(ENOMEM);
-    if (avio_read(pb, (uint8_t *) res, size) != size) {
-        av_free(res);
+    if (avio_read(pb, (uint8_t *) res, size) != size)
         return AVERROR(EIO);
-    }
     (res)[size] = '\0';
-    av_free(*str);
     *str = res;
 
     return 0;
@@ -812,6 +821,70 @@ static int ebml_read_binary(AVIOContext *pb, int length, EbmlBin *bin)
     return 0;
 }
 
+/*
+ * Read a Block or SimpleBlock. The payload of blocks which will not be
+ * demuxed is skipped instead of read: blocks of discarded tracks are left
+ * empty, and while scanning clusters for keyframes only the block header is
+ * kept. Any block which cannot be identified is read entirely, so that
+ * matroska_parse_block() reports it.
+ * 0 is success, < 0 is failure.
+ */
+static int matroska_read_block(MatroskaDemuxContext *matroska, AVIOContext *pb,
+                               int length, EbmlBin *bin)
+{
+    MatroskaTrack *tracks = matroska->tracks.elem;
+    AVStream *st = NULL;
+    uint8_t header[8 + 4];
+    int64_t pos = avio_tell(pb);
+    int i, n = 0, hlen, keep = length;
+    uint64_t num = 0;
+
+    hlen = FFMIN(length, sizeof(header));
+    if (avio_read(pb, header, hlen) != hlen)
+        return AVERROR(EIO);
+
+    if (hlen && header[0]) {
+        n   = 8 - av_log2(header[0]);
+        num = header[0] & (0xff >> n);
+        for (i = 1; i < n && i < hlen; i++)
+            num = (num << 8) | header[i];
+    }
+    if (n && n < hlen) {
+        for (i = 0; i < matroska->tracks.nb_elem; i++)
+            if (tracks[i].num == num) {
+                st = tracks[i].stream;
+                break;
+            }
+    }
+    if (st && st->discard >= AVDISCARD_ALL)
+        keep = 0;
+    else if (st && matroska->scanning)
+        keep = FFMIN(hlen, n + 4);
+
+    bin->buf = av_buffer_alloc(FFMAX(keep, hlen) + FF_INPUT_BUFFER_PADDING_SIZE);
+    if (!bin->buf)
+        return AVERROR(ENOMEM);
+    bin->data = bin->buf->data;
+    bin->size = keep;
+    bin->pos  = pos;
+    memcpy(bin->data, header, hlen);
+
+    if (keep > hlen) {
+        if (avio_read(pb, bin->data + hlen, keep - hlen) != keep - hlen) {
+            av_buffer_unref(&bin->buf);
+            bin->data = NULL;
+            bin->size = 0;
+            return AVERROR(EIO);
+        }
+    } else if (length > hlen) {
+        if (avio_skip(pb, length - hlen) < 0)
+            return AVERROR(EIO);
+    }
+    memset(bin->data + keep, 0, FF_INPUT_BUFFER_PADDING_SIZE);
+
+    return 0;
+}
+
 /*
  * Read the next element, but only the header. The contents
  * are supposed to be sub-elements which can be read separately.
@@ -916,7 +989,7 @@ static int ebml_parse_nest(MatroskaDemuxContext *matroska, EbmlSyntax *syntax,
             break;
         case EBML_STR:
         case EBML_UTF8:
-            *(char    **)((char *)data+syntax[i].data_offset) = av_strdup(syntax[i].def.s);
+            *(char    **)((char *)data+syntax[i].data_offset) = avpriv_arena_strdup(&matroska->strings, syntax[i].def.s);
             break;
         }
 
@@ -973,8 +1046,12 @@ static int ebml_parse_elem(MatroskaDemuxContext *matroska,
     case EBML_UINT:  res = ebml_read_uint  (pb, length, data);  break;
     case EBML_FLOAT: res = ebml_read_float (pb, length, data);  break;
     case EBML_STR:
-    case EBML_UTF8:  res = ebml_read_ascii (pb, length, data);  break;
-    case EBML_BIN:   res = ebml_read_binary(pb, length, data);  break;
+    case EBML_UTF8:  res = ebml_read_ascii (matroska, pb, length, data); break;
+    case EBML_BIN:   if (id == MATROSKA_ID_BLOCK || id == MATROSKA_ID_SIMPLEBLOCK)
+                         res = matroska_read_block(matroska, pb, length, data);
+                     else
+                         res = ebml_read_binary(pb, length, data);
+                     break;
     case EBML_NEST:  if ((res=ebml_read_master(matroska, length)) < 0)
                          return res;
                      if (id == MATROSKA_ID_SEGMENT)
@@ -1000,9 +1077,15 @@ static void ebml_free(EbmlSyntax *syntax, void *data)
     for (i=0; syntax[i].id; i++) {
         void *data_off = (char *)data + syntax[i].data_offset;
         switch (syntax[i].type) {
-        case EBML_STR:
-        case EBML_UTF8:  av_freep(data_off);                      break;
-        case EBML_BIN:   av_freep(&((EbmlBin *)data_off)->data);  break;
+        case EBML_STR:   /* the strings are in matroska->strings */
+        case EBML_UTF8:  *(char **)data_off = NULL;               break;
+        case EBML_BIN:
+            if (((EbmlBin *)data_off)->buf) {
+                av_buffer_unref(&((EbmlBin *)data_off)->buf);
+                ((EbmlBin *)data_off)->data = NULL;
+            } else
+                av_freep(&((EbmlBin *)data_off)->data);
+            break;
         case EBML_NEST:
             if (syntax[i].list_elem_size) {
                 EbmlList *list = data_off;
@@ -1508,6 +1591,7 @@ static int matroska_read_header(AVFormatContext *s)
                "(EBML version %"PRIu64", doctype %s, doc version %"PRIu64")\n",
                ebml.version, ebml.doctype, ebml.doctype_version);
         ebml_free(ebml_syntax, &ebml);
+        avpriv_arena_free(&matroska->strings);
         return AVERROR_PATCHWELCOME;
     } else if (ebml.doctype_version == 3) {
         av_log(matroska->ctx, AV_LOG_WARNING,
@@ -1969,20 +2053,15 @@ static void matroska_clear_queue(MatroskaDemuxContext *matroska)
 }
 
 static int matroska_parse_laces(MatroskaDemuxContext *matroska, uint8_t **buf,
-                                int* buf_size, int type,
-                                uint32_t **lace_buf, int *laces)
+                                int* buf_size, int type, int *laces)
 {
     int res = 0, n, size = *buf_size;
     uint8_t *data = *buf;
-    uint32_t *lace_size;
+    uint32_t *lace_size = matroska->lace_size;
 
     if (!type) {
         *laces = 1;
-        *lace_buf = av_mallocz(sizeof(int));
-        if (!*lace_buf)
-            return AVERROR(ENOMEM);
-
-        *lace_buf[0] = size;
+        lace_size[0] = size;
         return 0;
     }
 
@@ -1990,9 +2069,7 @@ static int matroska_parse_laces(MatroskaDemuxContext *matroska, uint8_t **buf,
     *laces = *data + 1;
     data += 1;
     size -= 1;
-    lace_size = av_mallocz(*laces * sizeof(int));
-    if (!lace_size)
-        return AVERROR(ENOMEM);
+    memset(lace_size, 0, *laces * sizeof(*lace_size));
 
     switch (type) {
     case 0x1: /* Xiph lacing */ {
@@ -2069,7 +2146,6 @@ static int matroska_parse_laces(MatroskaDemuxContext *matroska, uint8_t **buf,
     }
 
     *buf      = data;
-    *lace_buf = lace_size;
     *buf_size = size;
 
     return res;
@@ -2228,7 +2304,7 @@ fail:
 
 static int matroska_parse_frame(MatroskaDemuxContext *matroska,
                                 MatroskaTrack *track,
-                                AVStream *st,
+                                AVStream *st, AVBufferRef *buf,
                                 uint8_t *data, int pkt_size,
                                 uint64_t timecode, uint64_t lace_duration,
                                 int64_t pos, int is_keyframe,
@@ -2261,20 +2337,38 @@ static int matroska_parse_frame(MatroskaDemuxContext *matroska,
         offset = 8;
 
     pkt = av_mallocz(sizeof(AVPacket));
-    /* XXX: prevent data copy... */
-    if (av_new_packet(pkt, pkt_size + offset) < 0) {
-        av_free(pkt);
+    if (!pkt) {
         res = AVERROR(ENOMEM);
         goto fail;
     }
 
-    if (st->codec->codec_id == AV_CODEC_ID_PRORES) {
-        uint8_t *buf = pkt->data;
-        bytestream_put_be32(&buf, pkt_size);
-        bytestream_put_be32(&buf, MKBETAG('i', 'c', 'p', 'f'));
-    }
+    /* Frames stored as is reference the block buffer. SSA packets are
+     * rewritten in place, so they still get their own copy. */
+    if (buf && pkt_data == data && !offset &&
+        st->codec->codec_id != AV_CODEC_ID_SSA) {
+        av_init_packet(pkt);
+        pkt->buf = av_buffer_ref(buf);
+        if (!pkt->buf) {
+            av_free(pkt);
+            return AVERROR(ENOMEM);
+        }
+        pkt->data = data;
+        pkt->size = pkt_size;
+    } else {
+        if (av_new_packet(pkt, pkt_size + offset) < 0) {
+            av_free(pkt);
+            res = AVERROR(ENOMEM);
+            goto fail;
+        }
+
+        if (st->codec->codec_id == AV_CODEC_ID_PRORES) {
+            uint8_t *hdr = pkt->data;
+            bytestream_put_be32(&hdr, pkt_size);
+            bytestream_put_be32(&hdr, MKBETAG('i', 'c', 'p', 'f'));
+        }
 
-    memcpy(pkt->data + offset, pkt_data, pkt_size);
+        memcpy(pkt->data + offset, pkt_data, pkt_size);
+    }
 
     if (pkt_data != data)
         av_freep(&pkt_data);
@@ -2350,8 +2444,9 @@ fail:
     return res;
 }
 
-static int matroska_parse_block(MatroskaDemuxContext *matroska, uint8_t *data,
-                                int size, int64_t pos, uint64_t cluster_time,
+static int matroska_parse_block(MatroskaDemuxContext *matroska, AVBufferRef *buf,
+                                uint8_t *data, int size, int64_t pos,
+                                uint64_t cluster_time,
                                 uint64_t block_duration, int is_keyframe,
                                 uint8_t *additional, uint64_t additional_id, int additional_size,
                                 int64_t cluster_pos)
@@ -2361,7 +2456,7 @@ static int matroska_parse_block(MatroskaDemuxContext *matroska, uint8_t *data,
     int res = 0;
     AVStream *st;
     int16_t block_time;
-    uint32_t *lace_size = NULL;
+    uint32_t *lace_size = matroska->lace_size;
     int n, flags, laces = 0;
     uint64_t num;
 
@@ -2401,6 +2496,10 @@ static int matroska_parse_block(MatroskaDemuxContext *matroska, uint8_t *data,
             av_add_index_entry(st, cluster_pos, timecode, 0,0,AVINDEX_KEYFRAME);
     }
 
+    /* Only the header of the block was read, to find the keyframes. */
+    if (matroska->scanning)
+        return res;
+
     if (matroska->skip_to_keyframe && track->type != MATROSKA_TRACK_TYPE_SUBTITLE) {
         if (timecode < matroska->skip_to_timecode)
             return res;
@@ -2413,10 +2512,9 @@ static int matroska_parse_block(MatroskaDemuxContext *matroska, uint8_t *data,
     }
 
     res = matroska_parse_laces(matroska, &data, &size, (flags & 0x06) >> 1,
-                               &lace_size, &laces);
-
+                               &laces);
     if (res)
-        goto end;
+        return res;
 
     if (!block_duration)
         block_duration = track->default_duration * laces / matroska->time_scale;
@@ -2443,15 +2541,15 @@ static int matroska_parse_block(MatroskaDemuxContext *matroska, uint8_t *data,
                                           lace_size[n],
                                           timecode, pos);
             if (res)
-                goto end;
+                return res;
 
         } else {
-            res = matroska_parse_frame(matroska, track, st, data, lace_size[n],
+            res = matroska_parse_frame(matroska, track, st, buf, data, lace_size[n],
                                       timecode, lace_duration,
                                       pos, !n? is_keyframe : 0,
                                       additional, additional_id, additional_size);
             if (res)
-                goto end;
+                return res;
         }
 
         if (timecode != AV_NOPTS_VALUE)
@@ -2460,8 +2558,6 @@ static int matroska_parse_block(MatroskaDemuxContext *matroska, uint8_t *data,
         size -= lace_size[n];
     }
 
-end:
-    av_free(lace_size);
     return res;
 }
 
@@ -2509,7 +2605,7 @@ static int matroska_parse_cluster_incremental(MatroskaDemuxContext *matroska)
                                     blocks[i].additional.data : NULL;
             if (!blocks[i].non_simple)
                 blocks[i].duration = 0;
-            res = matroska_parse_block(matroska,
+            res = matroska_parse_block(matroska, blocks[i].bin.buf,
                                        blocks[i].bin.data, blocks[i].bin.size,
                                        blocks[i].bin.pos,
                                        matroska->current_cluster.timecode,
@@ -2542,7 +2638,7 @@ static int matroska_parse_cluster(MatroskaDemuxContext *matroska)
     for (i=0; i<blocks_list->nb_elem; i++)
         if (blocks[i].bin.size > 0 && blocks[i].bin.data) {
             int is_keyframe = blocks[i].non_simple ? !blocks[i].reference : -1;
-            res=matroska_parse_block(matroska,
+            res=matroska_parse_block(matroska, blocks[i].bin.buf,
                                      blocks[i].bin.data, blocks[i].bin.size,
                                      blocks[i].bin.pos,  cluster.timecode,
                                      blocks[i].duration, is_keyframe, NULL, 0, 0,
@@ -2588,11 +2684,13 @@ static int matroska_read_seek(AVFormatContext *s, int stream_index,
     if ((index = av_index_search_timestamp(st, timestamp, flags)) < 0) {
         avio_seek(s->pb, st->index_entries[st->nb_index_entries-1].pos, SEEK_SET);
         matroska->current_id = 0;
+        matroska->scanning = 1;
         while ((index = av_index_search_timestamp(st, timestamp, flags)) < 0) {
             matroska_clear_queue(matroska);
             if (matroska_parse_cluster(matroska) < 0)
                 break;
         }
+        matroska->scanning = 0;
     }
 
     matroska_clear_queue(matroska);
@@ -2655,6 +2753,7 @@ static int matroska_read_close(AVFormatContext *s)
             av_free(tracks[n].audio.buf);
     ebml_free(matroska_cluster, &matroska->current_cluster);
     ebml_free(matroska_segment, matroska);
+    avpriv_arena_free(&matroska->strings);
 
     return 0;
 }
@@ -20,6 +20,7 @@
  */
 
 #include "avc.h"
+#include "avio_internal.h"
 #include "avformat.h"
 #include "avlanguage.h"
 #include "flacenc.h"
@@ -103,6 +104,8 @@ typedef struct MatroskaMuxContext {
 
     int reserve_cues_space;
     int64_t cues_pos;
+
+    int live;           ///< write unknown size clusters to non-seekable output
 } MatroskaMuxContext;
 
 
@@ -1309,15 +1312,11 @@ static int mkv_write_srt_blocks(AVFormatContext *s, AVIOContext *pb, AVPacket *p
 static void mkv_flush_dynbuf(AVFormatContext *s)
 {
     MatroskaMuxContext *mkv = s->priv_data;
-    int bufsize;
-    uint8_t *dyn_buf;
 
     if (!mkv->dyn_bc)
         return;
 
-    bufsize = avio_close_dyn_buf(mkv->dyn_bc, &dyn_buf);
-    avio_write(s->pb, dyn_buf, bufsize);
-    av_free(dyn_buf);
+    ffio_close_chunked_dyn_buf(mkv->dyn_bc, s->pb);
     mkv->dyn_bc = NULL;
 }
 
@@ -1336,9 +1335,9 @@ static int mkv_write_packet_internal(AVFormatContext *s, AVPacket *pkt)
         return AVERROR(EINVAL);
     }
 
-    if (!s->pb->seekable) {
+    if (!s->pb->seekable && !mkv->live) {
         if (!mkv->dyn_bc) {
-            if ((ret = avio_open_dyn_buf(&mkv->dyn_bc)) < 0) {
+            if ((ret = ffio_open_chunked_dyn_buf(&mkv->dyn_bc)) < 0) {
                 av_log(s, AV_LOG_ERROR, "Failed to open dynamic buffer\n");
                 return ret;
             }
@@ -1384,11 +1383,11 @@ static int mkv_write_packet_internal(AVFormatContext *s, AVPacket *pkt)
 static int mkv_write_packet(AVFormatContext *s, AVPacket *pkt)
 {
     MatroskaMuxContext *mkv = s->priv_data;
-    AVIOContext *pb = s->pb->seekable ? s->pb : mkv->dyn_bc;
+    AVIOContext *pb = mkv->dyn_bc ? mkv->dyn_bc : s->pb;
     AVCodecContext *codec = s->streams[pkt->stream_index]->codec;
     int ret, keyframe = !!(pkt->flags & AV_PKT_FLAG_KEY);
     int64_t ts = mkv->tracks[pkt->stream_index].write_dts ? pkt->dts : pkt->pts;
-    int cluster_size = avio_tell(pb) - (s->pb->seekable ? mkv->cluster_pos : 0);
+    int cluster_size = avio_tell(pb) - (mkv->dyn_bc ? 0 : mkv->cluster_pos);
 
     // start a new cluster every 5 MB or 5 sec, or 32k / 1 sec for streaming or
     // after 4k and on a keyframe
@@ -1398,7 +1397,9 @@ static int mkv_write_packet(AVFormatContext *s, AVPacket *pkt)
          || (codec->codec_type == AVMEDIA_TYPE_VIDEO && keyframe && cluster_size > 4*1024))) {
         av_log(s, AV_LOG_DEBUG, "Starting new cluster at offset %" PRIu64
                " bytes, pts %" PRIu64 "\n", avio_tell(pb), ts);
-        end_ebml_master(pb, mkv->cluster);
+        /* live clusters keep their unknown size */
+        if (pb->seekable || mkv->dyn_bc)
+            end_ebml_master(pb, mkv->cluster);
         mkv->cluster_pos = -1;
         if (mkv->dyn_bc)
             mkv_flush_dynbuf(s);
@@ -1445,7 +1446,7 @@ static int mkv_write_trailer(AVFormatContext *s)
     if (mkv->dyn_bc) {
         end_ebml_master(mkv->dyn_bc, mkv->cluster);
         mkv_flush_dynbuf(s);
-    } else if (mkv->cluster_pos != -1) {
+    } else if (mkv->cluster_pos != -1 && pb->seekable) {
         end_ebml_master(pb, mkv->cluster);
     }
 
@@ -1545,6 +1546,8 @@ const AVCodecTag additional_video_tags[] = {
 static const AVOption options[] = {
     { "reserve_index_space", "Reserve a given amount of space (in bytes) at the beginning "
         "of the file for the index (cues).", OFFSET(reserve_cues_space), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, INT_MAX, FLAGS },
+    { "live", "Write the clusters straight to non-seekable output, with an unknown size, "
+        "instead of buffering them.", OFFSET(live), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1, FLAGS },
     { NULL },
 };
 
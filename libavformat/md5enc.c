@@ -22,6 +22,7 @@
 #include "libavutil/avassert.h"
 #include "libavutil/avstring.h"
 #include "libavutil/hash.h"
+#include "libavutil/mem.h"
 #include "libavutil/opt.h"
 #include "avformat.h"
 #include "internal.h"
@@ -30,25 +31,27 @@ struct MD5Context {
     const AVClass *avclass;
     struct AVHashContext *hash;
     char *hash_name;
+    FFFrameHashPool *pool;
+    struct AVHashContext **hashes;  ///< one per thread of the pool
+    int nb_hashes;
+    int threads;
 };
 
-static void md5_finish(struct AVFormatContext *s, char *buf)
+/* Append the hash and a newline to buf, which must have room for 64 more
+ * characters. */
+static void hash_finish(struct AVHashContext *hash, char *buf)
 {
-    struct MD5Context *c = s->priv_data;
     uint8_t md5[32];
     int i, offset = strlen(buf);
-    int len = av_hash_get_size(c->hash);
+    int len = av_hash_get_size(hash);
     av_assert0(len > 0 && len <= sizeof(md5));
-    av_hash_final(c->hash, md5);
+    av_hash_final(hash, md5);
     for (i = 0; i < len; i++) {
         snprintf(buf + offset, 3, "%02"PRIx8, md5[i]);
         offset += 2;
     }
     buf[offset] = '\n';
     buf[offset+1] = 0;
-
-    avio_write(s->pb, buf, strlen(buf));
-    avio_flush(s->pb);
 }
 
 #define OFFSET(x) offsetof(struct MD5Context, x)
@@ -66,6 +69,15 @@ static const AVClass md5enc_class = {
 };
 
 #if CONFIG_MD5_MUXER
+static void md5_finish(struct AVFormatContext *s, char *buf)
+{
+    struct MD5Context *c = s->priv_data;
+
+    hash_finish(c->hash, buf);
+    avio_write(s->pb, buf, strlen(buf));
+    avio_flush(s->pb);
+}
+
 static int write_header(struct AVFormatContext *s)
 {
     struct MD5Context *c = s->priv_data;
@@ -111,39 +123,75 @@ AVOutputFormat ff_md5_muxer = {
 #endif
 
 #if CONFIG_FRAMEMD5_MUXER
-static int framemd5_write_header(struct AVFormatContext *s)
+static void framemd5_hash_packet(struct AVFormatContext *s, int thread,
+                                 AVPacket *pkt, char *buf, int size)
 {
     struct MD5Context *c = s->priv_data;
-    int res = av_hash_alloc(&c->hash, c->hash_name);
-    if (res < 0)
-        return res;
-    return ff_framehash_write_header(s);
+    struct AVHashContext *hash = c->hashes[thread];
+    av_hash_init(hash);
+    av_hash_update(hash, pkt->data, pkt->size);
+
+    snprintf(buf, size - 64, "%d, %10"PRId64", %10"PRId64", %8d, %8d, ",
+             pkt->stream_index, pkt->dts, pkt->pts, pkt->duration, pkt->size);
+    hash_finish(hash, buf);
 }
 
-static int framemd5_write_packet(struct AVFormatContext *s, AVPacket *pkt)
+static int framemd5_write_trailer(struct AVFormatContext *s)
 {
     struct MD5Context *c = s->priv_data;
-    char buf[256];
-    av_hash_init(c->hash);
-    av_hash_update(c->hash, pkt->data, pkt->size);
+    int i;
 
-    snprintf(buf, sizeof(buf) - 64, "%d, %10"PRId64", %10"PRId64", %8d, %8d, ",
-             pkt->stream_index, pkt->dts, pkt->pts, pkt->duration, pkt->size);
-    md5_finish(s, buf);
+    ff_framehash_pool_close(&c->pool);
+    for (i = 0; i < c->nb_hashes; i++)
+        av_hash_freep(&c->hashes[i]);
+    av_freep(&c->hashes);
+    c->nb_hashes = 0;
     return 0;
 }
 
-static int framemd5_write_trailer(struct AVFormatContext *s)
+static int framemd5_write_header(struct AVFormatContext *s)
 {
     struct MD5Context *c = s->priv_data;
-    av_hash_freep(&c->hash);
-    return 0;
+    int i, nb_threads, res;
+
+    res = ff_framehash_pool_init(&c->pool, s, framemd5_hash_packet,
+                                 c->threads);
+    if (res < 0)
+        return res;
+    nb_threads = ff_framehash_pool_threads(c->pool);
+    c->hashes  = av_mallocz(nb_threads * sizeof(*c->hashes));
+    if (!c->hashes) {
+        framemd5_write_trailer(s);
+        return AVERROR(ENOMEM);
+    }
+    for (i = 0; i < nb_threads; i++) {
+        res = av_hash_alloc(&c->hashes[i], c->hash_name);
+        if (res < 0) {
+            c->nb_hashes = i;
+            framemd5_write_trailer(s);
+            return res;
+        }
+    }
+    c->nb_hashes = nb_threads;
+    return ff_framehash_write_header(s);
+}
+
+static int framemd5_write_packet(struct AVFormatContext *s, AVPacket *pkt)
+{
+    struct MD5Context *c = s->priv_data;
+    return ff_framehash_pool_write(c->pool, pkt);
 }
 
+static const AVOption framemd5_options[] = {
+    { "hash", "set hash to use", OFFSET(hash_name), AV_OPT_TYPE_STRING, {.str = "md5"}, 0, 0, ENC },
+    { "hash_threads", "set the number of threads hashing the packets, 0 for one per CPU", OFFSET(threads), AV_OPT_TYPE_INT, {.i64 = 1}, 0, INT_MAX, ENC },
+    { NULL },
+};
+
 static const AVClass framemd5_class = {
     .class_name = "frame hash encoder class",
     .item_name  = av_default_item_name,
-    .option     = hash_options,
+    .option     = framemd5_options,
     .version    = LIBAVUTIL_VERSION_INT,
 };
 
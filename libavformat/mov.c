@@ -28,6 +28,7 @@
 //#define MOV_EXPORT_ALL_METADATA
 
 #include "libavutil/attributes.h"
+#include "libavutil/avassert.h"
 #include "libavutil/channel_layout.h"
 #include "libavutil/intreadwrite.h"
 #include "libavutil/intfloat.h"
@@ -1942,6 +1943,349 @@ static int mov_read_sbgp(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     return pb->eof_reached ? AVERROR_EOF : 0;
 }
 
+static unsigned mov_lazy_sample_size(const MOVStreamContext *sc, unsigned sample)
+{
+    return sc->stsz_sample_size > 0 ? sc->stsz_sample_size : sc->sample_sizes[sample];
+}
+
+/**
+ * @return the index of the first element of the sorted table tab not
+ *         lower than val
+ */
+static unsigned mov_lower_bound(const unsigned *tab, unsigned count, unsigned val)
+{
+    unsigned lo = 0, hi = count;
+
+    while (lo < hi) {
+        unsigned mid = lo + (hi - lo) / 2;
+        if (tab[mid] < val)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static int mov_lazy_is_keyframe(const MOVStreamContext *sc, unsigned sample)
+{
+    unsigned val = sample + sc->lazy_key_off, k;
+
+    if (!sc->keyframe_absent) {
+        const unsigned *keyframes = (const unsigned *)sc->keyframes;
+        if (!sc->keyframe_count)
+            return 1;
+        k = mov_lower_bound(keyframes, sc->keyframe_count, val);
+        if (k < sc->keyframe_count && keyframes[k] == val)
+            return 1;
+    }
+    if (sc->stps_count) {
+        k = mov_lower_bound(sc->stps_data, sc->stps_count, val);
+        if (k < sc->stps_count && sc->stps_data[k] == val)
+            return 1;
+    }
+    return 0;
+}
+
+static void mov_lazy_fill_entry(MOVStreamContext *sc)
+{
+    MOVSampleCursor *c = &sc->lazy_cursor;
+
+    c->entry.size         = mov_lazy_sample_size(sc, c->sample);
+    c->entry.flags        = mov_lazy_is_keyframe(sc, c->sample) ? AVINDEX_KEYFRAME : 0;
+    c->entry.min_distance = 0;
+}
+
+/**
+ * Move the cursor to any sample, walking the chunk runs of stsc and the
+ * duration runs of stts the same way mov_build_index() does.
+ */
+static void mov_lazy_seek_sample(MOVStreamContext *sc, unsigned sample)
+{
+    MOVSampleCursor *c = &sc->lazy_cursor;
+    unsigned chunk = 0, stsc_index = 0, first = 0, count, i;
+    int64_t dts = sc->lazy_start_dts;
+    int64_t pos;
+
+    av_assert1(sample < sc->lazy_nb_samples);
+
+    for (;;) {
+        int64_t next = stsc_index + 1 < sc->stsc_count ?
+                       sc->stsc_data[stsc_index + 1].first - 1LL : -1;
+        unsigned end = next >= chunk && next < sc->chunk_count ? next : sc->chunk_count;
+        uint64_t run;
+
+        count = sc->stsc_data[stsc_index].count;
+        run   = (uint64_t)(end - chunk) * count;
+        if (sample - first < run)
+            break;
+        first += run;
+        chunk  = end;
+        stsc_index++;
+    }
+    chunk += (sample - first) / count;
+    c->chunk        = chunk;
+    c->stsc_index   = stsc_index;
+    c->chunk_sample = (sample - first) % count;
+
+    pos = sc->chunk_offsets[chunk];
+    if (sc->stsz_sample_size > 0) {
+        pos += (int64_t)c->chunk_sample * sc->stsz_sample_size;
+    } else {
+        for (i = sample - c->chunk_sample; i < sample; i++)
+            pos += sc->sample_sizes[i];
+    }
+
+    first = 0;
+    for (i = 0; i + 1 < sc->stts_count && sc->stts_data[i].count &&
+                sample - first >= sc->stts_data[i].count; i++) {
+        dts   += (int64_t)sc->stts_data[i].count * sc->stts_data[i].duration;
+        first += sc->stts_data[i].count;
+    }
+    dts += (int64_t)(sample - first) * sc->stts_data[i].duration;
+    c->stts_index  = i;
+    c->stts_sample = sample - first;
+
+    c->sample          = sample;
+    c->entry.pos       = pos;
+    c->entry.timestamp = dts;
+    mov_lazy_fill_entry(sc);
+}
+
+static void mov_lazy_next_sample(MOVStreamContext *sc)
+{
+    MOVSampleCursor *c = &sc->lazy_cursor;
+
+    c->entry.pos       += mov_lazy_sample_size(sc, c->sample);
+    c->entry.timestamp += sc->stts_data[c->stts_index].duration;
+    if (c->stts_index + 1 < sc->stts_count &&
+        ++c->stts_sample == sc->stts_data[c->stts_index].count) {
+        c->stts_sample = 0;
+        c->stts_index++;
+    }
+    c->sample++;
+
+    if (++c->chunk_sample >= (unsigned)sc->stsc_data[c->stsc_index].count) {
+        do {
+            c->chunk++;
+            while (c->stsc_index + 1 < sc->stsc_count &&
+                   c->chunk + 1 == sc->stsc_data[c->stsc_index + 1].first)
+                c->stsc_index++;
+        } while (c->chunk < sc->chunk_count && !sc->stsc_data[c->stsc_index].count);
+        c->chunk_sample = 0;
+        if (c->chunk < sc->chunk_count)
+            c->entry.pos = sc->chunk_offsets[c->chunk];
+    }
+
+    if (c->sample < sc->lazy_nb_samples)
+        mov_lazy_fill_entry(sc);
+}
+
+static const AVIndexEntry *mov_lazy_entry(MOVStreamContext *sc, unsigned sample)
+{
+    if (sample == sc->lazy_cursor.sample + 1)
+        mov_lazy_next_sample(sc);
+    else if (sample != sc->lazy_cursor.sample)
+        mov_lazy_seek_sample(sc, sample);
+    return &sc->lazy_cursor.entry;
+}
+
+/**
+ * Find the nearest keyframe not after (backward) or not before sample.
+ * @return the keyframe, -1 or lazy_nb_samples if there is none
+ */
+static int64_t mov_lazy_find_keyframe(const MOVStreamContext *sc, unsigned sample,
+                                      int backward)
+{
+    const unsigned *tabs[2] = { sc->keyframe_absent ? NULL : (const unsigned *)sc->keyframes,
+                                sc->stps_data };
+    unsigned counts[2] = { sc->keyframe_absent ? 0 : sc->keyframe_count,
+                           sc->stps_count };
+    unsigned val = sample + sc->lazy_key_off;
+    int64_t best = backward ? -1 : (int64_t)sc->lazy_nb_samples;
+    int i;
+
+    if (!sc->keyframe_absent && !sc->keyframe_count)
+        return sample;
+
+    for (i = 0; i < 2; i++) {
+        unsigned k = mov_lower_bound(tabs[i], counts[i], val);
+        if (backward) {
+            if (k < counts[i] && tabs[i][k] == val)
+                return sample;
+            if (k > 0 && tabs[i][k - 1] >= sc->lazy_key_off)
+                best = FFMAX(best, tabs[i][k - 1] - sc->lazy_key_off);
+        } else if (k < counts[i]) {
+            best = FFMIN(best, (int64_t)tabs[i][k] - sc->lazy_key_off);
+        }
+    }
+    return best;
+}
+
+/**
+ * Same as av_index_search_timestamp(), on the sample tables.
+ */
+static int mov_lazy_search_timestamp(const MOVStreamContext *sc,
+                                     int64_t wanted_timestamp, int flags)
+{
+    unsigned nb_samples = sc->lazy_nb_samples, first = 0, i;
+    int64_t dts = sc->lazy_start_dts;
+    int64_t a, b = nb_samples, m;
+
+    for (i = 0; i < sc->stts_count && first < nb_samples; i++) {
+        unsigned count  = sc->stts_data[i].count;
+        int duration    = sc->stts_data[i].duration;
+
+        /* the last run, like a run of 0 samples, continues until the end */
+        if (i + 1 == sc->stts_count || !count || count > nb_samples - first)
+            count = nb_samples - first;
+        if (dts + (count - 1) * (int64_t)duration >= wanted_timestamp) {
+            int64_t n = dts >= wanted_timestamp ? 0 :
+                        (wanted_timestamp - dts + duration - 1) / duration;
+            b   = first + n;
+            dts = dts + n * duration;
+            break;
+        }
+        dts   += count * (int64_t)duration;
+        first += count;
+    }
+    a = b < nb_samples && dts == wanted_timestamp ? b : b - 1;
+
+    m = (flags & AVSEEK_FLAG_BACKWARD) ? a : b;
+    if (!(flags & AVSEEK_FLAG_ANY) && m >= 0 && m < nb_samples)
+        m = mov_lazy_find_keyframe(sc, m, flags & AVSEEK_FLAG_BACKWARD);
+
+    if (m == nb_samples)
+        return -1;
+    return m;
+}
+
+/**
+ * Check that the sample tables can be walked on demand, and set up the
+ * cursor at the first sample.
+ * @return 0 if the samples are resolved on demand, < 0 if the index must
+ *         be built
+ */
+static int mov_lazy_index_init(MOVContext *mov, AVStream *st, int64_t start_dts)
+{
+    MOVStreamContext *sc = st->priv_data;
+    unsigned chunk = 0, stsc_index = 0, i;
+    uint64_t nb_samples = 0, stream_size = 0;
+
+    if ((st->codec->codec_type != AVMEDIA_TYPE_VIDEO &&
+         st->codec->codec_type != AVMEDIA_TYPE_AUDIO) ||
+        sc->rap_group_count ||
+        !sc->chunk_count || !sc->stsc_count || !sc->stts_count ||
+        (!sc->stsz_sample_size && !sc->sample_sizes))
+        return AVERROR(ENOSYS);
+    /* mov_build_index() overrides inconsistent stsz sample sizes per chunk */
+    if (sc->sample_size > 0 && sc->stsz_sample_size > 0 &&
+        sc->sample_size != sc->stsz_sample_size)
+        return AVERROR(ENOSYS);
+    /* only skips samples when several sample descriptions are used */
+    if (sc->pseudo_stream_id != -1)
+        for (i = 0; i < sc->stsc_count; i++)
+            if (sc->stsc_data[i].id - 1 != sc->pseudo_stream_id)
+                return AVERROR(ENOSYS);
+    /* and expects increasing sync sample numbers */
+    for (i = 1; i < sc->keyframe_count; i++)
+        if ((unsigned)sc->keyframes[i] <= (unsigned)sc->keyframes[i - 1])
+            return AVERROR(ENOSYS);
+    for (i = 1; i < sc->stps_count; i++)
+        if (sc->stps_data[i] <= sc->stps_data[i - 1])
+            return AVERROR(ENOSYS);
+
+    while (chunk < sc->chunk_count && nb_samples < sc->sample_count) {
+        int64_t next = stsc_index + 1 < sc->stsc_count ?
+                       sc->stsc_data[stsc_index + 1].first - 1LL : -1;
+        unsigned end = next >= chunk && next < sc->chunk_count ? next : sc->chunk_count;
+
+        nb_samples += (uint64_t)(end - chunk) * (unsigned)sc->stsc_data[stsc_index].count;
+        chunk = end;
+        stsc_index++;
+    }
+    if (nb_samples > sc->sample_count) {
+        av_log(mov->fc, AV_LOG_ERROR, "wrong sample count\n");
+        nb_samples = sc->sample_count;
+    }
+    if (!nb_samples)
+        return AVERROR(ENOSYS);
+
+    if (sc->stsz_sample_size > 0) {
+        stream_size = nb_samples * sc->stsz_sample_size;
+    } else {
+        for (i = 0; i < nb_samples; i++)
+            stream_size += sc->sample_sizes[i];
+    }
+    if (st->duration > 0)
+        st->codec->bit_rate = stream_size*8*sc->time_scale/st->duration;
+
+    sc->lazy_index      = 1;
+    sc->lazy_nb_samples = nb_samples;
+    sc->lazy_key_off    = (sc->keyframe_count && sc->keyframes[0] > 0) ||
+                          (sc->stps_count && sc->stps_data[0] > 0);
+    sc->lazy_start_dts  = start_dts;
+    mov_lazy_seek_sample(sc, 0);
+    return 0;
+}
+
+/**
+ * Build the index of a track whose samples were resolved on demand, and
+ * free its sample tables.
+ */
+static int mov_lazy_index_expand(AVStream *st)
+{
+    MOVStreamContext *sc = st->priv_data;
+    unsigned distance = 0, i;
+    AVIndexEntry *mem;
+
+    if (sc->lazy_nb_samples >= UINT_MAX / sizeof(*st->index_entries) - st->nb_index_entries)
+        return AVERROR(ENOMEM);
+    mem = av_realloc(st->index_entries, (st->nb_index_entries + sc->lazy_nb_samples) * sizeof(*st->index_entries));
+    if (!mem)
+        return AVERROR(ENOMEM);
+    st->index_entries = mem;
+    st->index_entries_allocated_size = (st->nb_index_entries + sc->lazy_nb_samples) * sizeof(*st->index_entries);
+
+    for (i = 0; i < sc->lazy_nb_samples; i++) {
+        AVIndexEntry *e = &st->index_entries[st->nb_index_entries++];
+        *e = *mov_lazy_entry(sc, i);
+        if (e->flags & AVINDEX_KEYFRAME)
+            distance = 0;
+        e->min_distance = distance++;
+    }
+
+    sc->lazy_index = 0;
+    av_freep(&sc->chunk_offsets);
+    av_freep(&sc->stsc_data);
+    av_freep(&sc->sample_sizes);
+    av_freep(&sc->keyframes);
+    av_freep(&sc->stts_data);
+    av_freep(&sc->stps_data);
+    return 0;
+}
+
+static int mov_index_count(const AVStream *st)
+{
+    const MOVStreamContext *sc = st->priv_data;
+
+    if (sc->lazy_index)
+        return sc->lazy_nb_samples;
+    return st->compact_index ? ff_compact_index_count(st) : st->nb_index_entries;
+}
+
+/**
+ * Get a sample of the index of st, the returned entry is only valid until
+ * the next access to the index of st.
+ */
+static const AVIndexEntry *mov_index_entry(AVStream *st, int index)
+{
+    MOVStreamContext *sc = st->priv_data;
+
+    if (sc->lazy_index)
+        return mov_lazy_entry(sc, index);
+    return st->compact_index ? ff_compact_index_get(st, index) : &st->index_entries[index];
+}
+
 static void mov_build_index(MOVContext *mov, AVStream *st)
 {
     MOVStreamContext *sc = st->priv_data;
@@ -1986,13 +2330,17 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
 
         if (!sc->sample_count || st->nb_index_entries)
             return;
-        if (sc->sample_count >= UINT_MAX / sizeof(*st->index_entries) - st->nb_index_entries)
-            return;
-        mem = av_realloc(st->index_entries, (st->nb_index_entries + sc->sample_count) * sizeof(*st->index_entries));
-        if (!mem)
+        if (mov->lazy_index && mov_lazy_index_init(mov, st, current_dts) >= 0)
             return;
-        st->index_entries = mem;
-        st->index_entries_allocated_size = (st->nb_index_entries + sc->sample_count) * sizeof(*st->index_entries);
+        if (!mov->compact_index) {
+            if (sc->sample_count >= UINT_MAX / sizeof(*st->index_entries) - st->nb_index_entries)
+                return;
+            mem = av_realloc(st->index_entries, (st->nb_index_entries + sc->sample_count) * sizeof(*st->index_entries));
+            if (!mem)
+                return;
+            st->index_entries = mem;
+            st->index_entries_allocated_size = (st->nb_index_entries + sc->sample_count) * sizeof(*st->index_entries);
+        }
 
         for (i = 0; i < sc->chunk_count; i++) {
             int64_t next_offset = i+1 < sc->chunk_count ? sc->chunk_offsets[i+1] : INT64_MAX;
@@ -2040,12 +2388,20 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
                 sample_size = sc->stsz_sample_size > 0 ? sc->stsz_sample_size : sc->sample_sizes[current_sample];
                 if (sc->pseudo_stream_id == -1 ||
                    sc->stsc_data[stsc_index].id - 1 == sc->pseudo_stream_id) {
-                    AVIndexEntry *e = &st->index_entries[st->nb_index_entries++];
-                    e->pos = current_offset;
-                    e->timestamp = current_dts;
-                    e->size = sample_size;
-                    e->min_distance = distance;
-                    e->flags = keyframe ? AVINDEX_KEYFRAME : 0;
+                    if (mov->compact_index) {
+                        if (ff_compact_index_add(st, current_offset, current_dts, sample_size,
+                                                 distance, keyframe ? AVINDEX_KEYFRAME : 0) < 0) {
+                            ff_compact_index_free(st);
+                            return;
+                        }
+                    } else {
+                        AVIndexEntry *e = &st->index_entries[st->nb_index_entries++];
+                        e->pos = current_offset;
+                        e->timestamp = current_dts;
+                        e->size = sample_size;
+                        e->min_distance = distance;
+                        e->flags = keyframe ? AVINDEX_KEYFRAME : 0;
+                    }
                     av_dlog(mov->fc, "AVIndex stream %d, sample %d, offset %"PRIx64", dts %"PRId64", "
                             "size %d, distance %d, keyframe %d\n", st->index, current_sample,
                             current_offset, current_dts, sample_size, distance, keyframe);
@@ -2298,12 +2654,14 @@ static int mov_read_trak(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     }
 
     /* Do not need those anymore. */
-    av_freep(&sc->chunk_offsets);
-    av_freep(&sc->stsc_data);
-    av_freep(&sc->sample_sizes);
-    av_freep(&sc->keyframes);
-    av_freep(&sc->stts_data);
-    av_freep(&sc->stps_data);
+    if (!sc->lazy_index) {
+        av_freep(&sc->chunk_offsets);
+        av_freep(&sc->stsc_data);
+        av_freep(&sc->sample_sizes);
+        av_freep(&sc->keyframes);
+        av_freep(&sc->stts_data);
+        av_freep(&sc->stps_data);
+    }
     av_freep(&sc->rap_group);
 
     return 0;
@@ -2507,7 +2865,7 @@ static int mov_read_trun(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     int64_t dts;
     int data_offset = 0;
     unsigned entries, first_sample_flags = frag->flags;
-    int flags, distance, i, found_keyframe = 0;
+    int flags, distance, i, found_keyframe = 0, ret;
 
     for (i = 0; i < c->fc->nb_streams; i++) {
         if (c->fc->streams[i]->id == frag->track_id) {
@@ -2522,6 +2880,11 @@ static int mov_read_trun(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     sc = st->priv_data;
     if (sc->pseudo_stream_id+1 != frag->stsd_id)
         return 0;
+    /* fragment samples may be inserted anywhere, only in index_entries */
+    if (sc->lazy_index && (ret = mov_lazy_index_expand(st)) < 0)
+        return ret;
+    if (st->compact_index && (ret = ff_compact_index_expand(st)) < 0)
+        return ret;
     avio_r8(pb); /* version */
     flags = avio_rb24(pb);
     entries = avio_rb32(pb);
@@ -2983,9 +3346,9 @@ static void mov_read_chapters(AVFormatContext *s)
     sc = st->priv_data;
     cur_pos = avio_tell(sc->pb);
 
-    for (i = 0; i < st->nb_index_entries; i++) {
-        AVIndexEntry *sample = &st->index_entries[i];
-        int64_t end = i+1 < st->nb_index_entries ? st->index_entries[i+1].timestamp : st->duration;
+    for (i = 0; i < mov_index_count(st); i++) {
+        int64_t end = i+1 < mov_index_count(st) ? mov_index_entry(st, i+1)->timestamp : st->duration;
+        const AVIndexEntry *sample = mov_index_entry(st, i);
         uint8_t *title;
         uint16_t ch;
         int len, title_len;
@@ -3052,10 +3415,10 @@ static int mov_read_timecode_track(AVFormatContext *s, AVStream *st)
     int64_t cur_pos = avio_tell(sc->pb);
     uint32_t value;
 
-    if (!st->nb_index_entries)
+    if (!mov_index_count(st))
         return -1;
 
-    avio_seek(sc->pb, st->index_entries->pos, SEEK_SET);
+    avio_seek(sc->pb, mov_index_entry(st, 0)->pos, SEEK_SET);
     value = avio_rb32(s->pb);
 
     if (sc->tmcd_flags & 0x0001) flags |= AV_TIMECODE_FLAG_DROPFRAME;
@@ -3224,16 +3587,16 @@ static int mov_read_header(AVFormatContext *s)
     return 0;
 }
 
-static AVIndexEntry *mov_find_next_sample(AVFormatContext *s, AVStream **st)
+static const AVIndexEntry *mov_find_next_sample(AVFormatContext *s, AVStream **st)
 {
-    AVIndexEntry *sample = NULL;
+    const AVIndexEntry *sample = NULL;
     int64_t best_dts = INT64_MAX;
     int i;
     for (i = 0; i < s->nb_streams; i++) {
         AVStream *avst = s->streams[i];
         MOVStreamContext *msc = avst->priv_data;
-        if (msc->pb && msc->current_sample < avst->nb_index_entries) {
-            AVIndexEntry *current_sample = &avst->index_entries[msc->current_sample];
+        if (msc->pb && msc->current_sample < mov_index_count(avst)) {
+            const AVIndexEntry *current_sample = mov_index_entry(avst, msc->current_sample);
             int64_t dts = av_rescale(current_sample->timestamp, AV_TIME_BASE, msc->time_scale);
             av_dlog(s, "stream %d, sample %d, dts %"PRId64"\n", i, msc->current_sample, dts);
             if (!sample || (!s->pb->seekable && current_sample->pos < sample->pos) ||
@@ -3254,13 +3617,14 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
 {
     MOVContext *mov = s->priv_data;
     MOVStreamContext *sc;
-    AVIndexEntry *sample;
+    const AVIndexEntry *next;
+    AVIndexEntry entry, *sample = &entry;
     AVStream *st = NULL;
     int ret;
     mov->fc = s;
  retry:
-    sample = mov_find_next_sample(s, &st);
-    if (!sample) {
+    next = mov_find_next_sample(s, &st);
+    if (!next) {
         mov->found_mdat = 0;
         if (!mov->next_root_atom)
             return AVERROR_EOF;
@@ -3272,6 +3636,8 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
         av_dlog(s, "read fragments, offset 0x%"PRIx64"\n", avio_tell(s->pb));
         goto retry;
     }
+    /* the compact index only keeps one block of entries decoded */
+    entry = *next;
     sc = st->priv_data;
     /* must be done just before reading, to avoid infinite loop on sample */
     sc->current_sample++;
@@ -3327,8 +3693,8 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
         if (sc->wrong_dts)
             pkt->dts = AV_NOPTS_VALUE;
     } else {
-        int64_t next_dts = (sc->current_sample < st->nb_index_entries) ?
-            st->index_entries[sc->current_sample].timestamp : st->duration;
+        int64_t next_dts = (sc->current_sample < mov_index_count(st)) ?
+            mov_index_entry(st, sc->current_sample)->timestamp : st->duration;
         pkt->duration = next_dts - pkt->dts;
         pkt->pts = pkt->dts;
     }
@@ -3347,9 +3713,12 @@ static int mov_seek_stream(AVFormatContext *s, AVStream *st, int64_t timestamp,
     int sample, time_sample;
     int i;
 
-    sample = av_index_search_timestamp(st, timestamp, flags);
+    if (sc->lazy_index)
+        sample = mov_lazy_search_timestamp(sc, timestamp, flags);
+    else
+        sample = av_index_search_timestamp(st, timestamp, flags);
     av_dlog(s, "stream %d, timestamp %"PRId64", sample %d\n", st->index, timestamp, sample);
-    if (sample < 0 && st->nb_index_entries && timestamp < st->index_entries[0].timestamp)
+    if (sample < 0 && mov_index_count(st) && timestamp < mov_index_entry(st, 0)->timestamp)
         sample = 0;
     if (sample < 0) /* not sure what to do */
         return AVERROR_INVALIDDATA;
@@ -3387,7 +3756,7 @@ static int mov_read_seek(AVFormatContext *s, int stream_index, int64_t sample_ti
         return sample;
 
     /* adjust seek timestamp to found sample timestamp */
-    seek_timestamp = st->index_entries[sample].timestamp;
+    seek_timestamp = mov_index_entry(st, sample)->timestamp;
 
     for (i = 0; i < s->nb_streams; i++) {
         MOVStreamContext *sc = s->streams[i]->priv_data;
@@ -3410,6 +3779,14 @@ static const AVOption options[] = {
         0, 1, AV_OPT_FLAG_VIDEO_PARAM|AV_OPT_FLAG_DECODING_PARAM},
     {"ignore_editlist", "", offsetof(MOVContext, ignore_editlist), FF_OPT_TYPE_INT, {.i64 = 0},
         0, 1, AV_OPT_FLAG_VIDEO_PARAM|AV_OPT_FLAG_DECODING_PARAM},
+    {"compact_index",
+        "keep the sample index delta coded instead of in AVStream.index_entries, for long files",
+        offsetof(MOVContext, compact_index), FF_OPT_TYPE_INT, {.i64 = 0},
+        0, 1, AV_OPT_FLAG_VIDEO_PARAM|AV_OPT_FLAG_DECODING_PARAM},
+    {"lazy_index",
+        "resolve the audio and video samples from the sample tables on demand instead of building the index",
+        offsetof(MOVContext, lazy_index), FF_OPT_TYPE_INT, {.i64 = 0},
+        0, 1, AV_OPT_FLAG_VIDEO_PARAM|AV_OPT_FLAG_DECODING_PARAM},
     {NULL}
 };
 
@@ -53,6 +53,8 @@ static const AVOption options[] = {
     { "frag_custom", "Flush fragments on caller requests", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_FRAG_CUSTOM}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
     { "isml", "Create a live smooth streaming feed (for pushing to a publishing point)", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_ISML}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
     { "faststart", "Run a second pass to put the moov at the beginning of the file", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_FASTSTART}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
+    { "omit_tfra", "Omit the tfra index of the fragments, so that fragmented files are muxed in constant memory", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_OMIT_TFRA}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
+    { "faststart_reserve", "space to reserve for the moov with faststart, avoiding the second pass if it fits", offsetof(MOVMuxContext, faststart_reserve), AV_OPT_TYPE_INT, {.i64 = 0}, 0, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM },
     FF_RTP_FLAG_OPTS(MOVMuxContext, rtp_flags),
     { "skip_iods", "Skip writing iods atom.", offsetof(MOVMuxContext, iods_skip), AV_OPT_TYPE_INT, {.i64 = 1}, 0, 1, AV_OPT_FLAG_ENCODING_PARAM},
     { "iods_audio_profile", "iods audio profile atom.", offsetof(MOVMuxContext, iods_audio_profile), AV_OPT_TYPE_INT, {.i64 = -1}, -1, 255, AV_OPT_FLAG_ENCODING_PARAM},
@@ -2759,7 +2761,7 @@ static int mov_write_mfra_tag(AVIOContext *pb, MOVMuxContext *mov)
 
     for (i = 0; i < mov->nb_streams; i++) {
         MOVTrack *track = &mov->tracks[i];
-        if (track->nb_frag_info)
+        if (track->nb_frag_info && !(mov->flags & FF_MOV_FLAG_OMIT_TFRA))
             mov_write_tfra_tag(pb, track);
     }
 
@@ -3011,8 +3013,7 @@ static int mov_flush_fragment(AVFormatContext *s)
 
     if (!(mov->flags & FF_MOV_FLAG_EMPTY_MOOV) && mov->fragments == 0) {
         int64_t pos = avio_tell(s->pb);
-        uint8_t *buf;
-        int buf_size, moov_size;
+        int moov_size;
 
         for (i = 0; i < mov->nb_streams; i++)
             if (!mov->tracks[i].entry)
@@ -3027,12 +3028,10 @@ static int mov_flush_fragment(AVFormatContext *s)
 
         mov_write_moov_tag(s->pb, mov, s);
 
-        buf_size = avio_close_dyn_buf(mov->mdat_buf, &buf);
-        mov->mdat_buf = NULL;
-        avio_wb32(s->pb, buf_size + 8);
+        avio_wb32(s->pb, avio_tell(mov->mdat_buf) + 8);
         ffio_wfourcc(s->pb, "mdat");
-        avio_write(s->pb, buf, buf_size);
-        av_free(buf);
+        ffio_close_chunked_dyn_buf(mov->mdat_buf, s->pb);
+        mov->mdat_buf = NULL;
 
         mov->fragments++;
         mov->mdat_size = 0;
@@ -3065,8 +3064,7 @@ static int mov_flush_fragment(AVFormatContext *s)
 
     for (i = 0; i < mov->nb_streams; i++) {
         MOVTrack *track = &mov->tracks[i];
-        int buf_size, write_moof = 1, moof_tracks = -1;
-        uint8_t *buf;
+        int write_moof = 1, moof_tracks = -1;
         int64_t duration = 0;
 
         if (track->entry)
@@ -3084,6 +3082,14 @@ static int mov_flush_fragment(AVFormatContext *s)
         if (write_moof) {
             MOVFragmentInfo *info;
             avio_flush(s->pb);
+            /* Without the tfra, only the fragments referenced by the tfrf
+             * of the next one are needed. */
+            if (mov->flags & (FF_MOV_FLAG_ISML | FF_MOV_FLAG_OMIT_TFRA) &&
+                track->nb_frag_info > mov->ism_lookahead) {
+                track->nb_frag_info--;
+                memmove(track->frag_info, track->frag_info + 1,
+                        track->nb_frag_info * sizeof(*track->frag_info));
+            }
             track->nb_frag_info++;
             if (track->nb_frag_info >= track->frag_info_capacity) {
                 unsigned new_capacity = track->nb_frag_info + MOV_FRAG_INFO_ALLOC_INCREMENT;
@@ -3112,11 +3118,8 @@ static int mov_flush_fragment(AVFormatContext *s)
         track->entry = 0;
         if (!track->mdat_buf)
             continue;
-        buf_size = avio_close_dyn_buf(track->mdat_buf, &buf);
+        ffio_close_chunked_dyn_buf(track->mdat_buf, s->pb);
         track->mdat_buf = NULL;
-
-        avio_write(s->pb, buf, buf_size);
-        av_free(buf);
     }
 
     mov->mdat_size = 0;
@@ -3139,13 +3142,13 @@ int ff_mov_write_packet(AVFormatContext *s, AVPacket *pkt)
         int ret;
         if (mov->fragments > 0) {
             if (!trk->mdat_buf) {
-                if ((ret = avio_open_dyn_buf(&trk->mdat_buf)) < 0)
+                if ((ret = ffio_open_chunked_dyn_buf(&trk->mdat_buf)) < 0)
                     return ret;
             }
             pb = trk->mdat_buf;
         } else {
             if (!mov->mdat_buf) {
-                if ((ret = avio_open_dyn_buf(&mov->mdat_buf)) < 0)
+                if ((ret = ffio_open_chunked_dyn_buf(&mov->mdat_buf)) < 0)
                     return ret;
             }
             pb = mov->mdat_buf;
@@ -3704,6 +3707,13 @@ static int mov_write_header(AVFormatContext *s)
         mov->reserved_moov_pos= avio_tell(pb);
         if (mov->reserved_moov_size > 0)
             avio_skip(pb, mov->reserved_moov_size);
+        else if (mov->faststart_reserve) {
+            /* a valid free atom, in case the second pass is needed anyway */
+            mov->faststart_reserve = FFMAX(mov->faststart_reserve, 8);
+            avio_wb32(pb, mov->faststart_reserve);
+            ffio_wfourcc(pb, "free");
+            ffio_fill(pb, 0, mov->faststart_reserve - 8);
+        }
     }
 
     if (!(mov->flags & FF_MOV_FLAG_FRAGMENT))
@@ -3857,6 +3867,41 @@ end:
     return ret;
 }
 
+/**
+ * Write the moov in the space reserved by faststart_reserve, with a free
+ * atom over the rest of it. The chunk offsets do not change since the data
+ * is already after the reserved space.
+ *
+ * @return 1 if the moov was written, 0 if it does not fit and the data has
+ *         to be shifted, a negative error code otherwise
+ */
+static int write_reserved_moov(AVFormatContext *s)
+{
+    MOVMuxContext *mov = s->priv_data;
+    int moov_size, size;
+
+    if (!mov->faststart_reserve)
+        return 0;
+    moov_size = get_moov_size(s);
+    if (moov_size < 0)
+        return moov_size;
+    size = mov->faststart_reserve - moov_size;
+    if (size != 0 && size < 8) {
+        av_log(s, AV_LOG_INFO, "faststart_reserve is too small, needed %d bytes\n",
+               moov_size);
+        return 0;
+    }
+
+    avio_seek(s->pb, mov->reserved_moov_pos, SEEK_SET);
+    mov_write_moov_tag(s->pb, mov, s);
+    if (size) {
+        avio_wb32(s->pb, size);
+        ffio_wfourcc(s->pb, "free");
+        ffio_fill(s->pb, 0, size - 8);
+    }
+    return 1;
+}
+
 static int mov_write_trailer(AVFormatContext *s)
 {
     MOVMuxContext *mov = s->priv_data;
@@ -3897,11 +3942,17 @@ static int mov_write_trailer(AVFormatContext *s)
         avio_seek(pb, mov->reserved_moov_size > 0 ? mov->reserved_moov_pos : moov_pos, SEEK_SET);
 
         if (mov->reserved_moov_size == -1) {
-            av_log(s, AV_LOG_INFO, "Starting second pass: moving header on top of the file\n");
-            res = shift_data(s);
-            if (res == 0) {
-                avio_seek(s->pb, mov->reserved_moov_pos, SEEK_SET);
-                mov_write_moov_tag(pb, mov, s);
+            res = write_reserved_moov(s);
+            if (res > 0) {
+                res = 0;
+                avio_seek(pb, moov_pos, SEEK_SET);
+            } else if (res == 0) {
+                av_log(s, AV_LOG_INFO, "Starting second pass: moving header on top of the file\n");
+                res = shift_data(s);
+                if (res == 0) {
+                    avio_seek(s->pb, mov->reserved_moov_pos, SEEK_SET);
+                    mov_write_moov_tag(pb, mov, s);
+                }
             }
         } else if (mov->reserved_moov_size > 0) {
             int64_t size;
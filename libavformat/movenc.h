@@ -158,6 +158,7 @@ typedef struct MOVMuxContext {
     int rtp_flags;
     int reserved_moov_size; ///< 0 for disabled, -1 for automatic, size otherwise
     int64_t reserved_moov_pos;
+    int faststart_reserve;  ///< space reserved for the moov with faststart, 0 for none
 
     int iods_skip;
     int iods_video_profile;
@@ -182,6 +183,7 @@ typedef struct MOVMuxContext {
 #define FF_MOV_FLAG_FRAG_CUSTOM 32
 #define FF_MOV_FLAG_ISML 64
 #define FF_MOV_FLAG_FASTSTART 128
+#define FF_MOV_FLAG_OMIT_TFRA 256
 
 int ff_mov_write_packet(AVFormatContext *s, AVPacket *pkt);
 
@@ -429,8 +429,7 @@ static int mpegps_read_pes_header(AVFormatContext *s,
         for(i=0; i<s->nb_streams; i++){
             if(startcode == s->streams[i]->id &&
                s->pb->seekable /* index useless on streams anyway */) {
-                ff_reduce_index(s, i);
-                av_add_index_entry(s->streams[i], *ppos, dts, 0, 0, AVINDEX_KEYFRAME /* FIXME keyframe? */);
+                ff_add_index_hint(s, i, *ppos, dts, 0, 0, AVINDEX_KEYFRAME /* FIXME keyframe? */);
             }
         }
     }
@@ -129,6 +129,14 @@ struct MpegTSContext {
     /** filters for various streams specified by PMT + for the PAT and PMT */
     MpegTSFilter *pids[NB_PID_MAX];
     int current_pid;
+
+    /** pids comprised only in discarded programs, one bit per pid */
+    uint8_t discard_pids[NB_PID_MAX / 8];
+    /** false if discard_pids must be recomputed from the programs */
+    int discard_pids_valid;
+    /** AVProgram discard settings discard_pids was computed with */
+    uint8_t *prg_discard;
+    unsigned int prg_discard_size;
 };
 
 static const AVOption options[] = {
@@ -205,12 +213,14 @@ static void clear_program(MpegTSContext *ts, unsigned int programid)
     for(i=0; i<ts->nb_prg; i++)
         if(ts->prg[i].id == programid)
             ts->prg[i].nb_pids = 0;
+    ts->discard_pids_valid = 0;
 }
 
 static void clear_programs(MpegTSContext *ts)
 {
     av_freep(&ts->prg);
     ts->nb_prg=0;
+    ts->discard_pids_valid = 0;
 }
 
 static void add_pat_entry(MpegTSContext *ts, unsigned int programid)
@@ -224,6 +234,7 @@ static void add_pat_entry(MpegTSContext *ts, unsigned int programid)
     p->id = programid;
     p->nb_pids = 0;
     ts->nb_prg++;
+    ts->discard_pids_valid = 0;
 }
 
 static void add_pid_to_pmt(MpegTSContext *ts, unsigned int programid, unsigned int pid)
@@ -242,6 +253,7 @@ static void add_pid_to_pmt(MpegTSContext *ts, unsigned int programid, unsigned i
     if(p->nb_pids >= MAX_PIDS_PER_PROGRAM)
         return;
     p->pids[p->nb_pids++] = pid;
+    ts->discard_pids_valid = 0;
 }
 
 static void set_pcr_pid(AVFormatContext *s, unsigned int programid, unsigned int pid)
@@ -288,6 +300,43 @@ static int discard_pid(MpegTSContext *ts, unsigned int pid)
     return !used && discarded;
 }
 
+/**
+ * Recompute the discard_pids map if the programs or their discard
+ * settings changed, so that discarding a pid is a single lookup.
+ */
+static void update_discard_pids(MpegTSContext *ts)
+{
+    AVFormatContext *s = ts->stream;
+    int i, j;
+
+    if (ts->discard_pids_valid && ts->prg_discard_size == s->nb_programs) {
+        for (i = 0; i < s->nb_programs; i++)
+            if (ts->prg_discard[i] != (s->programs[i]->discard == AVDISCARD_ALL))
+                break;
+        if (i == s->nb_programs)
+            return;
+    }
+
+    av_fast_malloc(&ts->prg_discard, &ts->prg_discard_size, s->nb_programs);
+    if (!ts->prg_discard) {
+        ts->prg_discard_size = 0;
+        return;
+    }
+    ts->prg_discard_size = s->nb_programs;
+    for (i = 0; i < s->nb_programs; i++)
+        ts->prg_discard[i] = s->programs[i]->discard == AVDISCARD_ALL;
+
+    memset(ts->discard_pids, 0, sizeof(ts->discard_pids));
+    for (i = 0; i < ts->nb_prg; i++) {
+        for (j = 0; j < ts->prg[i].nb_pids; j++) {
+            unsigned int pid = ts->prg[i].pids[j];
+            if (pid < NB_PID_MAX && discard_pid(ts, pid))
+                ts->discard_pids[pid >> 3] |= 1 << (pid & 7);
+        }
+    }
+    ts->discard_pids_valid = 1;
+}
+
 /**
  *  Assemble PES packets out of TS packets, and then call the "section_cb"
  *  function when they are complete.
@@ -698,6 +747,16 @@ static int mpegts_set_stream_info(AVStream *st, PESContext *pes,
     return 0;
 }
 
+static AVBufferRef *alloc_pes_buffer(PESContext *pes, int size)
+{
+    AVBufferRef *buf = NULL;
+
+    if (pes->stream->flags & AVFMT_FLAG_PKT_POOL)
+        buf = ff_packet_pool_get(size);
+
+    return buf ? buf : av_buffer_alloc(size + FF_INPUT_BUFFER_PADDING_SIZE);
+}
+
 static void new_pes_packet(PESContext *pes, AVPacket *pkt)
 {
     av_init_packet(pkt);
@@ -868,8 +927,7 @@ static int mpegts_push_data(MpegTSFilter *filter,
                         pes->total_size = MAX_PES_PAYLOAD;
 
                     /* allocate pes buffer */
-                    pes->buffer = av_buffer_alloc(pes->total_size +
-                                                  FF_INPUT_BUFFER_PADDING_SIZE);
+                    pes->buffer = alloc_pes_buffer(pes, pes->total_size);
                     if (!pes->buffer)
                         return AVERROR(ENOMEM);
 
@@ -971,7 +1029,7 @@ static int mpegts_push_data(MpegTSFilter *filter,
                 if (pes->data_index > 0 && pes->data_index+buf_size > pes->total_size) {
                     new_pes_packet(pes, ts->pkt);
                     pes->total_size = MAX_PES_PAYLOAD;
-                    pes->buffer = av_buffer_alloc(pes->total_size + FF_INPUT_BUFFER_PADDING_SIZE);
+                    pes->buffer = alloc_pes_buffer(pes, pes->total_size);
                     if (!pes->buffer)
                         return AVERROR(ENOMEM);
                     ts->stop_parse = 1;
@@ -1737,7 +1795,9 @@ static int handle_packet(MpegTSContext *ts, const uint8_t *packet)
     int64_t pos;
 
     pid = AV_RB16(packet + 1) & 0x1fff;
-    if(pid && discard_pid(ts, pid))
+    if (!ts->discard_pids_valid)
+        update_discard_pids(ts);
+    if (pid && ts->discard_pids[pid >> 3] & (1 << (pid & 7)))
         return 0;
     is_start = packet[1] & 0x40;
     tss = ts->pids[pid];
@@ -1835,8 +1895,21 @@ static int mpegts_resync(AVFormatContext *s)
     AVIOContext *pb = s->pb;
     int c, i;
 
-    for(i = 0;i < MAX_RESYNC_SIZE; i++) {
+    for(i = 0;i < MAX_RESYNC_SIZE; ) {
+        /* scan the buffered data at once, refill it a byte at a time */
+        int len = FFMIN(pb->buf_end - pb->buf_ptr, MAX_RESYNC_SIZE - i);
+        if (len > 0) {
+            const uint8_t *p = memchr(pb->buf_ptr, 0x47, len);
+            if (p) {
+                pb->buf_ptr = (uint8_t *)p;
+                return 0;
+            }
+            pb->buf_ptr += len;
+            i += len;
+            continue;
+        }
         c = avio_r8(pb);
+        i++;
         if (url_feof(pb))
             return -1;
         if (c == 0x47) {
@@ -1849,18 +1922,26 @@ static int mpegts_resync(AVFormatContext *s)
     return -1;
 }
 
-/* return -1 if error or EOF. Return 0 if OK. */
-static int read_packet(AVFormatContext *s, uint8_t *buf, int raw_packet_size)
+/**
+ * Read a TS packet, in place in the I/O buffer if possible.
+ * finished_reading_packet() must be called once *data is not used anymore.
+ * @param buf  buffer of TS_PACKET_SIZE bytes, followed by padding if the
+ *             packet is to be parsed, used if it cannot be accessed in place
+ * @param data set to the packet
+ * @return -1 if error or EOF. Return 0 if OK.
+ */
+static int read_packet(AVFormatContext *s, uint8_t *buf, int raw_packet_size,
+                       const uint8_t **data)
 {
     AVIOContext *pb = s->pb;
-    int skip, len;
+    int len;
 
     for(;;) {
-        len = avio_read(pb, buf, TS_PACKET_SIZE);
+        len = ffio_read_indirect(pb, buf, TS_PACKET_SIZE, data);
         if (len != TS_PACKET_SIZE)
             return len < 0 ? len : AVERROR_EOF;
         /* check packet sync byte */
-        if (buf[0] != 0x47) {
+        if ((*data)[0] != 0x47) {
             /* find a new packet start */
             avio_seek(pb, -TS_PACKET_SIZE, SEEK_CUR);
             if (mpegts_resync(s) < 0)
@@ -1868,19 +1949,24 @@ static int read_packet(AVFormatContext *s, uint8_t *buf, int raw_packet_size)
             else
                 continue;
         } else {
-            skip = raw_packet_size - TS_PACKET_SIZE;
-            if (skip > 0)
-                avio_skip(pb, skip);
             break;
         }
     }
     return 0;
 }
 
+static void finished_reading_packet(AVFormatContext *s, int raw_packet_size)
+{
+    int skip = raw_packet_size - TS_PACKET_SIZE;
+    if (skip > 0)
+        avio_skip(s->pb, skip);
+}
+
 static int handle_packets(MpegTSContext *ts, int nb_packets)
 {
     AVFormatContext *s = ts->stream;
     uint8_t packet[TS_PACKET_SIZE + FF_INPUT_BUFFER_PADDING_SIZE];
+    const uint8_t *data;
     int packet_num, ret = 0;
 
     if (avio_tell(s->pb) != ts->last_pos) {
@@ -1900,6 +1986,9 @@ static int handle_packets(MpegTSContext *ts, int nb_packets)
         }
     }
 
+    /* the user may have changed the programs to discard */
+    update_discard_pids(ts);
+
     ts->stop_parse = 0;
     packet_num = 0;
     memset(packet + TS_PACKET_SIZE, 0, FF_INPUT_BUFFER_PADDING_SIZE);
@@ -1913,10 +2002,11 @@ static int handle_packets(MpegTSContext *ts, int nb_packets)
         if (ts->stop_parse > 0)
             break;
 
-        ret = read_packet(s, packet, ts->raw_packet_size);
+        ret = read_packet(s, packet, ts->raw_packet_size, &data);
         if (ret != 0)
             break;
-        ret = handle_packet(ts, packet);
+        ret = handle_packet(ts, data);
+        finished_reading_packet(s, ts->raw_packet_size);
         if (ret != 0)
             break;
     }
@@ -2029,10 +2119,11 @@ static int mpegts_read_header(AVFormatContext *s)
         s->ctx_flags |= AVFMTCTX_NOHEADER;
     } else {
         AVStream *st;
-        int pcr_pid, pid, nb_packets, nb_pcrs, ret, pcr_l;
+        int pcr_pid, pid, nb_packets, nb_pcrs, ret, pcr_l, is_pcr;
         int64_t pcrs[2], pcr_h;
         int packet_count[2];
         uint8_t packet[TS_PACKET_SIZE];
+        const uint8_t *data;
 
         /* only read packets */
 
@@ -2048,12 +2139,14 @@ static int mpegts_read_header(AVFormatContext *s)
         nb_pcrs = 0;
         nb_packets = 0;
         for(;;) {
-            ret = read_packet(s, packet, ts->raw_packet_size);
+            ret = read_packet(s, packet, ts->raw_packet_size, &data);
             if (ret < 0)
                 return -1;
-            pid = AV_RB16(packet + 1) & 0x1fff;
-            if ((pcr_pid == -1 || pcr_pid == pid) &&
-                parse_pcr(&pcr_h, &pcr_l, packet) == 0) {
+            pid = AV_RB16(data + 1) & 0x1fff;
+            is_pcr = (pcr_pid == -1 || pcr_pid == pid) &&
+                     parse_pcr(&pcr_h, &pcr_l, data) == 0;
+            finished_reading_packet(s, ts->raw_packet_size);
+            if (is_pcr) {
                 pcr_pid = pid;
                 packet_count[nb_pcrs] = nb_packets;
                 pcrs[nb_pcrs] = pcr_h * 300 + pcr_l;
@@ -2091,15 +2184,19 @@ static int mpegts_raw_read_packet(AVFormatContext *s,
     int64_t pcr_h, next_pcr_h, pos;
     int pcr_l, next_pcr_l;
     uint8_t pcr_buf[12];
+    const uint8_t *data;
 
     if (av_new_packet(pkt, TS_PACKET_SIZE) < 0)
         return AVERROR(ENOMEM);
     pkt->pos= avio_tell(s->pb);
-    ret = read_packet(s, pkt->data, ts->raw_packet_size);
+    ret = read_packet(s, pkt->data, ts->raw_packet_size, &data);
     if (ret < 0) {
         av_free_packet(pkt);
         return ret;
     }
+    if (data != pkt->data)
+        memcpy(pkt->data, data, TS_PACKET_SIZE);
+    finished_reading_packet(s, ts->raw_packet_size);
     if (ts->mpeg2ts_compute_pcr) {
         /* compute exact PCR for each packet */
         if (parse_pcr(&pcr_h, &pcr_l, pkt->data) == 0) {
@@ -2162,6 +2259,7 @@ static void mpegts_free(MpegTSContext *ts)
     int i;
 
     clear_programs(ts);
+    av_freep(&ts->prg_discard);
 
     for(i=0;i<NB_PID_MAX;i++)
         if (ts->pids[i]) mpegts_close_filter(ts, ts->pids[i]);
@@ -2222,8 +2320,7 @@ static int64_t mpegts_get_dts(AVFormatContext *s, int stream_index,
             return AV_NOPTS_VALUE;
         av_free_packet(&pkt);
         if(pkt.dts != AV_NOPTS_VALUE && pkt.pos >= 0){
-            ff_reduce_index(s, pkt.stream_index);
-            av_add_index_entry(s->streams[pkt.stream_index], pkt.pos, pkt.dts, 0, 0, AVINDEX_KEYFRAME /* FIXME keyframe? */);
+            ff_add_index_hint(s, pkt.stream_index, pkt.pos, pkt.dts, 0, 0, AVINDEX_KEYFRAME /* FIXME keyframe? */);
             if(pkt.stream_index == stream_index){
                 *ppos= pkt.pos;
                 return pkt.dts;
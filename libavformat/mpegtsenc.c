@@ -33,6 +33,11 @@
 
 #define PCR_TIME_BASE 27000000
 
+/* we retransmit the SI info at this rate */
+#define SDT_RETRANS_TIME 500
+#define PAT_RETRANS_TIME 100
+#define PCR_RETRANS_TIME 20
+
 /* write DVB SI sections */
 
 /*********************************************/
@@ -53,6 +58,8 @@ typedef struct MpegTSService {
     int pcr_pid;
     int pcr_packet_count;
     int pcr_packet_period;
+    AVStream *pcr_st;
+    int64_t last_pcr;  ///< last PCR written in CBR mode
 } MpegTSService;
 
 typedef struct MpegTSWrite {
@@ -85,6 +92,7 @@ typedef struct MpegTSWrite {
 #define MPEGTS_FLAG_AAC_LATM        0x02
     int flags;
     int copyts;
+    int pcr_period;    ///< interval between PCRs in CBR mode, in ms
 } MpegTSWrite;
 
 /* a PES packet header is generated every DEFAULT_PES_HEADER_FREQ packets */
@@ -121,6 +129,8 @@ static const AVOption options[] = {
       offsetof(MpegTSWrite, reemit_pat_pmt), AV_OPT_TYPE_INT, {.i64 = 0}, 0, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM},
     { "mpegts_copyts", "dont offset dts/pts",
       offsetof(MpegTSWrite, copyts), AV_OPT_TYPE_INT, {.i64=-1}, -1, 1, AV_OPT_FLAG_ENCODING_PARAM},
+    { "pcr_period", "PCR retransmission time in milliseconds, with muxrate",
+      offsetof(MpegTSWrite, pcr_period), AV_OPT_TYPE_INT, {.i64 = PCR_RETRANS_TIME}, 1, 100, AV_OPT_FLAG_ENCODING_PARAM},
     { NULL },
 };
 
@@ -220,11 +230,6 @@ static int mpegts_write_section1(MpegTSSection *s, int tid, int id,
 #define DEFAULT_PROVIDER_NAME   "FFmpeg"
 #define DEFAULT_SERVICE_NAME    "Service01"
 
-/* we retransmit the SI info at this rate */
-#define SDT_RETRANS_TIME 500
-#define PAT_RETRANS_TIME 100
-#define PCR_RETRANS_TIME 20
-
 typedef struct MpegTSWriteStream {
     struct MpegTSService *service;
     int pid; /* stream associated pid */
@@ -634,9 +639,11 @@ static int mpegts_write_header(AVFormatContext *s)
         ts_st = pcr_st->priv_data;
         service->pcr_pid = ts_st->pid;
     }
+    service->pcr_st   = pcr_st;
+    service->last_pcr = AV_NOPTS_VALUE;
 
     if (ts->mux_rate > 1) {
-        service->pcr_packet_period = (ts->mux_rate * PCR_RETRANS_TIME) /
+        service->pcr_packet_period = (ts->mux_rate * ts->pcr_period) /
             (TS_PACKET_SIZE * 8 * 1000);
         ts->sdt_packet_period      = (ts->mux_rate * SDT_RETRANS_TIME) /
             (TS_PACKET_SIZE * 8 * 1000);
@@ -778,7 +785,8 @@ static void mpegts_insert_pcr_only(AVFormatContext *s, AVStream *st)
     *q++ = 0x10;               /* Adaptation flags: PCR present */
 
     /* PCR coded into 6 bytes */
-    q += write_pcr_bits(q, get_pcr(ts, s->pb));
+    ts_st->service->last_pcr = get_pcr(ts, s->pb);
+    q += write_pcr_bits(q, ts_st->service->last_pcr);
 
     /* stuffing bytes */
     memset(q, 0xFF, TS_PACKET_SIZE - (q - buf));
@@ -858,8 +866,21 @@ static void mpegts_write_pes(AVFormatContext *s, AVStream *st,
         force_pat = 0;
 
         write_pcr = 0;
-        if (ts_st->pid == ts_st->service->pcr_pid) {
-            if (ts->mux_rate > 1 || is_start) // VBR pcr period is based on frames
+        if (ts->mux_rate > 1) {
+            /* CBR: the PCR is due every pcr_period of output, whichever
+             * stream is being written */
+            MpegTSService *service = ts_st->service;
+            if (service->last_pcr == AV_NOPTS_VALUE ||
+                get_pcr(ts, s->pb) - service->last_pcr >=
+                (int64_t)ts->pcr_period * (PCR_TIME_BASE / 1000)) {
+                if (ts_st->pid != service->pcr_pid) {
+                    mpegts_insert_pcr_only(s, service->pcr_st);
+                    continue;
+                }
+                write_pcr = 1;
+            }
+        } else if (ts_st->pid == ts_st->service->pcr_pid) {
+            if (is_start) // VBR pcr period is based on frames
                 ts_st->service->pcr_packet_count++;
             if (ts_st->service->pcr_packet_count >=
                 ts_st->service->pcr_packet_period) {
@@ -878,6 +899,22 @@ static void mpegts_write_pes(AVFormatContext *s, AVStream *st,
             continue; /* recalculate write_pcr and possibly retransmit si_info */
         }
 
+        if (!is_start && !write_pcr && payload_size >= TS_PACKET_SIZE - 4) {
+            /* full payload packet: only the continuity counter changes in
+             * the header, and the payload is written from the source */
+            ts_st->cc = (ts_st->cc + 1) & 0xf;
+            buf[0] = 0x47;
+            buf[1] = ts_st->pid >> 8;
+            buf[2] = ts_st->pid;
+            buf[3] = 0x10 | ts_st->cc;
+            mpegts_prefix_m2ts_header(s);
+            avio_write(s->pb, buf, 4);
+            avio_write(s->pb, payload, TS_PACKET_SIZE - 4);
+            payload      += TS_PACKET_SIZE - 4;
+            payload_size -= TS_PACKET_SIZE - 4;
+            continue;
+        }
+
         /* prepare packet header */
         q = buf;
         *q++ = 0x47;
@@ -900,7 +937,7 @@ static void mpegts_write_pes(AVFormatContext *s, AVStream *st,
             q = get_ts_payload_start(buf);
             // add 11, pcr references the last byte of program clock reference base
             if (ts->mux_rate > 1)
-                pcr = get_pcr(ts, s->pb);
+                pcr = ts_st->service->last_pcr = get_pcr(ts, s->pb);
             else
                 pcr = (dts - delay)*300;
             if (dts != AV_NOPTS_VALUE && dts < pcr / 300)
@@ -1050,7 +1087,6 @@ static void mpegts_write_pes(AVFormatContext *s, AVStream *st,
         mpegts_prefix_m2ts_header(s);
         avio_write(s->pb, buf, TS_PACKET_SIZE);
     }
-    avio_flush(s->pb);
     ts_st->prev_payload_key = key;
 }
 
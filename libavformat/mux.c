@@ -34,6 +34,7 @@
 #include "libavutil/avstring.h"
 #include "libavutil/mathematics.h"
 #include "libavutil/parseutils.h"
+#include "libavutil/profile_internal.h"
 #include "libavutil/time.h"
 #include "riff.h"
 #include "audiointerleave.h"
@@ -552,6 +553,10 @@ int av_write_frame(AVFormatContext *s, AVPacket *pkt)
         return 1;
     }
 
+    if (s->flags & AVFMT_FLAG_LATENCY_TRACE &&
+        (ret = ff_packet_latency_trace_stamp(pkt, AV_LATENCY_MUX, 0)) < 0)
+        return ret;
+
     ret = compute_pkt_fields2(s, s->streams[pkt->stream_index], pkt);
 
     if (ret < 0 && !(s->oformat->flags & AVFMT_NOTIMESTAMPS))
@@ -723,6 +728,222 @@ int ff_interleave_packet_per_dts(AVFormatContext *s, AVPacket *out,
     }
 }
 
+/**
+ * Packets waiting to be interleaved by dts, as a FIFO per stream and a
+ * min-heap of the streams ordered by the packet at the head of their FIFO.
+ * Outputting a packet takes O(log(number of streams)) comparisons instead
+ * of the walk of the single sorted list done by ff_interleave_add_packet().
+ */
+typedef struct InterleaveStream {
+    AVPacketList *head;
+    AVPacketList *tail;
+} InterleaveStream;
+
+typedef struct FFInterleaver {
+    InterleaveStream *streams;
+    int nb_streams;
+    int *heap;                  ///< indexes of the streams with queued packets
+    int nb_subtitles;           ///< subtitle streams with queued packets
+    int nb_subtitle_streams;
+    int64_t max_dts;            ///< largest dts queued, in AV_TIME_BASE units
+    AVPacketList *free_nodes;   ///< nodes kept for reuse
+    int heap_size;
+} FFInterleaver;
+
+static int heap_before(AVFormatContext *s, FFInterleaver *il, int a, int b)
+{
+    return interleave_compare_dts(s, &il->streams[b].head->pkt,
+                                     &il->streams[a].head->pkt);
+}
+
+static void heap_sift_up(AVFormatContext *s, FFInterleaver *il, int i)
+{
+    while (i > 0) {
+        int parent = (i - 1) >> 1;
+        if (!heap_before(s, il, il->heap[i], il->heap[parent]))
+            break;
+        FFSWAP(int, il->heap[i], il->heap[parent]);
+        i = parent;
+    }
+}
+
+static void heap_sift_down(AVFormatContext *s, FFInterleaver *il, int i)
+{
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= il->heap_size)
+            break;
+        if (child + 1 < il->heap_size &&
+            heap_before(s, il, il->heap[child + 1], il->heap[child]))
+            child++;
+        if (!heap_before(s, il, il->heap[child], il->heap[i]))
+            break;
+        FFSWAP(int, il->heap[i], il->heap[child]);
+        i = child;
+    }
+}
+
+static int interleaver_init(AVFormatContext *s)
+{
+    FFInterleaver *il = s->interleaver;
+    int i;
+
+    if (il && il->nb_streams == s->nb_streams)
+        return 0;
+    if (!il) {
+        if (!(il = av_mallocz(sizeof(*il))))
+            return AVERROR(ENOMEM);
+        s->interleaver = il;
+    }
+    /* Streams may only be added, and only before their first packet. */
+    if (av_reallocp_array(&il->streams, s->nb_streams, sizeof(*il->streams)) < 0 ||
+        av_reallocp_array(&il->heap,    s->nb_streams, sizeof(*il->heap))    < 0) {
+        il->nb_streams = 0;
+        il->heap_size  = 0;
+        return AVERROR(ENOMEM);
+    }
+    for (i = il->nb_streams; i < s->nb_streams; i++) {
+        il->streams[i].head = il->streams[i].tail = NULL;
+        if (s->streams[i]->codec->codec_type == AVMEDIA_TYPE_SUBTITLE)
+            il->nb_subtitle_streams++;
+    }
+    il->nb_streams = s->nb_streams;
+    return 0;
+}
+
+static int interleaver_add(AVFormatContext *s, AVPacket *pkt)
+{
+    FFInterleaver *il;
+    InterleaveStream *ist;
+    AVPacketList *node;
+    AVStream *st = s->streams[pkt->stream_index];
+    int64_t dts;
+    int ret;
+
+    if ((ret = interleaver_init(s)) < 0)
+        return ret;
+    il = s->interleaver;
+
+    if ((node = il->free_nodes)) {
+        il->free_nodes = node->next;
+    } else if (!(node = av_malloc(sizeof(*node)))) {
+        return AVERROR(ENOMEM);
+    }
+    node->pkt  = *pkt;
+    node->next = NULL;
+#if FF_API_DESTRUCT_PACKET
+    pkt->destruct  = NULL;           // do not free original but only the copy
+#endif
+    pkt->buf       = NULL;
+    av_dup_packet(&node->pkt);       // duplicate the packet if it uses non-allocated memory
+    av_copy_packet_side_data(&node->pkt, &node->pkt); // copy side data
+
+    dts = av_rescale_q(pkt->dts, st->time_base, AV_TIME_BASE_Q);
+    if (!il->heap_size || dts > il->max_dts)
+        il->max_dts = dts;
+
+    ist = &il->streams[pkt->stream_index];
+    if (ist->tail) {
+        ist->tail->next = node;
+        ist->tail       = node;
+    } else {
+        ist->head = ist->tail = node;
+        if (st->codec->codec_type == AVMEDIA_TYPE_SUBTITLE)
+            il->nb_subtitles++;
+        il->heap[il->heap_size] = pkt->stream_index;
+        heap_sift_up(s, il, il->heap_size++);
+    }
+    return 0;
+}
+
+/**
+ * Same as ff_interleave_packet_per_dts(), with the packets queued in the
+ * FFInterleaver.
+ */
+static int interleave_packet_per_dts_heap(AVFormatContext *s, AVPacket *out,
+                                          AVPacket *pkt, int flush)
+{
+    FFInterleaver *il;
+    InterleaveStream *ist;
+    AVPacketList *node;
+    int ret;
+
+    if (pkt && (ret = interleaver_add(s, pkt)) < 0)
+        return ret;
+    il = s->interleaver;
+
+    if (!il || !il->heap_size) {
+        av_init_packet(out);
+        return 0;
+    }
+
+    if (il->heap_size == s->nb_streams) {
+        flush = 1;
+    } else if (!flush) {
+        /* All the streams without queued packets are subtitles, and the
+         * queued packets span more than 20 seconds. Since the dts of each
+         * stream are increasing, the largest dts queued is the one of the
+         * last packet of one of the streams. */
+        AVPacket *first = &il->streams[il->heap[0]].head->pkt;
+        int noninterleaved_count = il->nb_subtitle_streams - il->nb_subtitles;
+        int64_t delta_dts_max = il->max_dts -
+            av_rescale_q(first->dts, s->streams[first->stream_index]->time_base,
+                         AV_TIME_BASE_Q);
+
+        if (s->nb_streams == il->heap_size + noninterleaved_count &&
+            delta_dts_max > 20*AV_TIME_BASE) {
+            av_log(s, AV_LOG_DEBUG, "flushing with %d noninterleaved\n", noninterleaved_count);
+            flush = 1;
+        }
+    }
+    if (!flush) {
+        av_init_packet(out);
+        return 0;
+    }
+
+    ist  = &il->streams[il->heap[0]];
+    node = ist->head;
+    *out = node->pkt;
+    ist->head      = node->next;
+    node->next     = il->free_nodes;
+    il->free_nodes = node;
+
+    if (ist->head) {
+        heap_sift_down(s, il, 0);
+    } else {
+        ist->tail = NULL;
+        if (s->streams[out->stream_index]->codec->codec_type == AVMEDIA_TYPE_SUBTITLE)
+            il->nb_subtitles--;
+        il->heap[0] = il->heap[--il->heap_size];
+        heap_sift_down(s, il, 0);
+    }
+    return 1;
+}
+
+void ff_interleaver_free(AVFormatContext *s)
+{
+    FFInterleaver *il = s->interleaver;
+    AVPacketList *node;
+    int i;
+
+    if (!il)
+        return;
+    for (i = 0; i < il->nb_streams; i++) {
+        while ((node = il->streams[i].head)) {
+            il->streams[i].head = node->next;
+            av_free_packet(&node->pkt);
+            av_free(node);
+        }
+    }
+    while ((node = il->free_nodes)) {
+        il->free_nodes = node->next;
+        av_free(node);
+    }
+    av_freep(&il->streams);
+    av_freep(&il->heap);
+    av_freep(&s->interleaver);
+}
+
 /**
  * Interleave an AVPacket correctly so it can be muxed.
  * @param out the interleaved packet will be output here
@@ -739,11 +960,13 @@ static int interleave_packet(AVFormatContext *s, AVPacket *out, AVPacket *in, in
         if (in)
             av_free_packet(in);
         return ret;
-    } else
+    } else if (s->max_chunk_size || s->max_chunk_duration)
         return ff_interleave_packet_per_dts(s, out, in, flush);
+    else
+        return interleave_packet_per_dts_heap(s, out, in, flush);
 }
 
-int av_interleaved_write_frame(AVFormatContext *s, AVPacket *pkt)
+static int interleaved_write_frame(AVFormatContext *s, AVPacket *pkt)
 {
     int ret, flush = 0;
 
@@ -786,6 +1009,22 @@ int av_interleaved_write_frame(AVFormatContext *s, AVPacket *pkt)
     }
 }
 
+FF_PROFILE_COUNTER(interleaved_write_frame_counter, "interleaved_write_frame");
+
+int av_interleaved_write_frame(AVFormatContext *s, AVPacket *pkt)
+{
+    uint64_t prof = avpriv_profile_start();
+    int ret = 0;
+
+    if (pkt && s->flags & AVFMT_FLAG_LATENCY_TRACE)
+        ret = ff_packet_latency_trace_stamp(pkt, AV_LATENCY_MUX, 0);
+    if (ret >= 0)
+        ret = interleaved_write_frame(s, pkt);
+
+    avpriv_profile_stop(&interleaved_write_frame_counter, prof);
+    return ret;
+}
+
 int av_write_trailer(AVFormatContext *s)
 {
     int ret, i;
@@ -825,6 +1064,7 @@ fail:
     if (s->oformat->priv_class)
         av_opt_free(s->priv_data);
     av_freep(&s->priv_data);
+    ff_interleaver_free(s);
     return ret;
 }
 
@@ -48,6 +48,8 @@ static const AVOption options[]={
 {"keepside", "dont merge side data", 0, AV_OPT_TYPE_CONST, {.i64 = AVFMT_FLAG_KEEP_SIDE_DATA }, INT_MIN, INT_MAX, D, "fflags"},
 {"latm", "enable RTP MP4A-LATM payload", 0, AV_OPT_TYPE_CONST, {.i64 = AVFMT_FLAG_MP4A_LATM }, INT_MIN, INT_MAX, E, "fflags"},
 {"nobuffer", "reduce the latency introduced by optional buffering", 0, AV_OPT_TYPE_CONST, {.i64 = AVFMT_FLAG_NOBUFFER }, 0, INT_MAX, D, "fflags"},
+{"pktpool", "allocate packets from shared buffer pools", 0, AV_OPT_TYPE_CONST, {.i64 = AVFMT_FLAG_PKT_POOL }, INT_MIN, INT_MAX, D, "fflags"},
+{"latencytrace", "trace the latency of the packets through the processing chain", 0, AV_OPT_TYPE_CONST, {.i64 = AVFMT_FLAG_LATENCY_TRACE }, INT_MIN, INT_MAX, D|E, "fflags"},
 {"seek2any", "forces seeking to enable seek to any mode", OFFSET(seek2any), AV_OPT_TYPE_INT, {.i64 = 0 }, 0, 1, D},
 {"analyzeduration", "specify how many microseconds are analyzed to probe the input", OFFSET(max_analyze_duration), AV_OPT_TYPE_INT, {.i64 = 5*AV_TIME_BASE }, 0, INT_MAX, D},
 {"cryptokey", "decryption key", OFFSET(key), AV_OPT_TYPE_BINARY, {.dbl = 0}, 0, 0, D},
@@ -76,6 +78,8 @@ static const AVOption options[]={
 {"skip_initial_bytes", "skip initial bytes", OFFSET(skip_initial_bytes), AV_OPT_TYPE_INT, {.i64 = 0}, 0, INT_MAX-1, D},
 {"correct_ts_overflow", "correct single timestamp overflows", OFFSET(correct_ts_overflow), AV_OPT_TYPE_INT, {.i64 = 1}, 0, 1, D},
 {"flush_packets", "enable flushing of the I/O context after each packet", OFFSET(flush_packets), AV_OPT_TYPE_INT, {.i64 = 1}, 0, 1, E},
+{"max_analyze_time", "specify how many microseconds of wall-clock time may be spent probing the input", OFFSET(max_analyze_time), AV_OPT_TYPE_INT, {.i64 = 0}, 0, INT_MAX, D},
+{"probe_threads", "number of streams decoded concurrently while probing the input", OFFSET(probe_threads), AV_OPT_TYPE_INT, {.i64 = 1}, 1, INT_MAX, D},
 {NULL},
 };
 
@@ -148,6 +148,7 @@ int ff_rtmp_packet_read_internal(URLContext *h, RTMPPacket *p, int chunk_size,
     int channel_id, timestamp, data_size, offset = 0;
     uint32_t extra = 0;
     enum RTMPPacketType type;
+    RTMPPacket *prev;
     int size = 0;
     int ret;
 
@@ -198,31 +199,38 @@ int ff_rtmp_packet_read_internal(URLContext *h, RTMPPacket *p, int chunk_size,
     if (hdr != RTMP_PS_TWELVEBYTES)
         timestamp += prev_pkt[channel_id].timestamp;
 
-    if ((ret = ff_rtmp_packet_create(p, channel_id, type, timestamp,
-                                     data_size)) < 0)
-        return ret;
-    p->extra = extra;
+    /* reassemble the chunks in the buffer kept for the channel */
+    prev = &prev_pkt[channel_id];
+    av_fast_malloc(&prev->data, &prev->alloc_size, data_size);
+    if (!prev->data && data_size) {
+        prev->alloc_size = 0;
+        return AVERROR(ENOMEM);
+    }
+    p->data       = prev->data;
+    p->data_size  = data_size;
+    p->channel_id = channel_id;
+    p->type       = type;
+    p->timestamp  = timestamp;
+    p->extra      = extra;
+    p->ts_delta   = 0;
+    p->alloc_size = 0;
     // save history
-    prev_pkt[channel_id].channel_id = channel_id;
-    prev_pkt[channel_id].type       = type;
-    prev_pkt[channel_id].data_size  = data_size;
-    prev_pkt[channel_id].ts_delta   = timestamp - prev_pkt[channel_id].timestamp;
-    prev_pkt[channel_id].timestamp  = timestamp;
-    prev_pkt[channel_id].extra      = extra;
+    prev->channel_id = channel_id;
+    prev->type       = type;
+    prev->data_size  = data_size;
+    prev->ts_delta   = timestamp - prev->timestamp;
+    prev->timestamp  = timestamp;
+    prev->extra      = extra;
     while (data_size > 0) {
         int toread = FFMIN(data_size, chunk_size);
-        if (ffurl_read_complete(h, p->data + offset, toread) != toread) {
-            ff_rtmp_packet_destroy(p);
+        if (ffurl_read_complete(h, p->data + offset, toread) != toread)
             return AVERROR(EIO);
-        }
         data_size -= chunk_size;
         offset    += chunk_size;
         size      += chunk_size;
         if (data_size > 0) {
-            if ((ret = ffurl_read_complete(h, &t, 1)) < 0) { // marker
-                ff_rtmp_packet_destroy(p);
+            if ((ret = ffurl_read_complete(h, &t, 1)) < 0) // marker
                 return ret;
-            }
             size++;
             if (t != (0xC0 + channel_id))
                 return -1;
@@ -334,6 +342,15 @@ void ff_rtmp_packet_destroy(RTMPPacket *pkt)
     pkt->data_size = 0;
 }
 
+void ff_rtmp_packet_history_free(RTMPPacket *prev_pkt)
+{
+    int i;
+
+    for (i = 0; i < RTMP_CHANNELS; i++)
+        av_freep(&prev_pkt[i].data);
+    memset(prev_pkt, 0, RTMP_CHANNELS * sizeof(*prev_pkt));
+}
+
 int ff_amf_tag_size(const uint8_t *data, const uint8_t *data_end)
 {
     const uint8_t *base = data;
@@ -82,6 +82,7 @@ typedef struct RTMPPacket {
     uint32_t       extra;      ///< probably an additional channel ID used during streaming data
     uint8_t        *data;      ///< packet payload
     int            data_size;  ///< packet payload size
+    unsigned int   alloc_size; ///< allocated size of data, in the packet history only
 } RTMPPacket;
 
 /**
@@ -104,9 +105,21 @@ int ff_rtmp_packet_create(RTMPPacket *pkt, int channel_id, RTMPPacketType type,
  */
 void ff_rtmp_packet_destroy(RTMPPacket *pkt);
 
+/**
+ * Free the buffers kept in a packet history and reset it.
+ *
+ * @param prev_pkt packet history for all channels
+ */
+void ff_rtmp_packet_history_free(RTMPPacket *prev_pkt);
+
 /**
  * Read RTMP packet sent by the server.
  *
+ * The chunks are reassembled in a buffer kept in prev_pkt for the packet
+ * channel and reused by the following packets, so p->data is only valid
+ * until the next packet is read on the same channel, and p must not be
+ * freed with ff_rtmp_packet_destroy().
+ *
  * @param h          reader context
  * @param p          packet
  * @param chunk_size current chunk size
@@ -118,6 +131,7 @@ int ff_rtmp_packet_read(URLContext *h, RTMPPacket *p,
                         int chunk_size, RTMPPacket *prev_pkt);
 /**
  * Read internal RTMP packet sent by the server.
+ * The packet data is owned by prev_pkt, as in ff_rtmp_packet_read().
  *
  * @param h          reader context
  * @param p          packet
@@ -87,6 +87,9 @@ typedef struct RTMPContext {
     uint8_t*      flv_data;                   ///< buffer with data for demuxer
     int           flv_size;                   ///< current buffer size
     int           flv_off;                    ///< number of bytes read from current buffer
+    const uint8_t *flv_payload;               ///< media payload returned after flv_payload_off bytes of flv_data, pointing into the packet read buffer
+    int           flv_payload_size;           ///< number of bytes of flv_payload not read yet
+    int           flv_payload_off;            ///< position in flv_data where flv_payload is inserted
     int           flv_nb_packets;             ///< number of flv packets published
     RTMPPacket    out_pkt;                    ///< rtmp packet, created from flv a/v or metadata (for output)
     uint32_t      client_report_size;         ///< number of bytes after which client should report to server
@@ -407,12 +410,10 @@ static int read_connect(URLContext *s, RTMPContext *rt)
     bytestream2_init(&gbc, cp, pkt.data_size);
     if (ff_amf_read_string(&gbc, command, sizeof(command), &stringlen)) {
         av_log(s, AV_LOG_ERROR, "Unable to read command string\n");
-        ff_rtmp_packet_destroy(&pkt);
         return AVERROR_INVALIDDATA;
     }
     if (strcmp(command, "connect")) {
         av_log(s, AV_LOG_ERROR, "Expecting connect, got %s\n", command);
-        ff_rtmp_packet_destroy(&pkt);
         return AVERROR_INVALIDDATA;
     }
     ret = ff_amf_read_number(&gbc, &seqnum);
@@ -427,7 +428,6 @@ static int read_connect(URLContext *s, RTMPContext *rt)
     if (!ret && strcmp(tmpstr, rt->app))
         av_log(s, AV_LOG_WARNING, "App field don't match up: %s <-> %s\n",
                tmpstr, rt->app);
-    ff_rtmp_packet_destroy(&pkt);
 
     // Send Window Acknowledgement Size (as defined in speficication)
     if ((ret = ff_rtmp_packet_create(&pkt, RTMP_NETWORK_CHANNEL,
@@ -2148,48 +2148,42 @@ static int get_packet(URLContext *s, int for_header)
         }
 
         ret = rtmp_parse_result(s, rt, &rpkt);
-        if (ret < 0) {//serious error in current packet
-            ff_rtmp_packet_destroy(&rpkt);
+        if (ret < 0) //serious error in current packet
             return ret;
-        }
-        if (rt->do_reconnect && for_header) {
-            ff_rtmp_packet_destroy(&rpkt);
+        if (rt->do_reconnect && for_header)
             return 0;
-        }
-        if (rt->state == STATE_STOPPED) {
-            ff_rtmp_packet_destroy(&rpkt);
+        if (rt->state == STATE_STOPPED)
             return AVERROR_EOF;
-        }
         if (for_header && (rt->state == STATE_PLAYING    ||
                            rt->state == STATE_PUBLISHING ||
-                           rt->state == STATE_RECEIVING)) {
-            ff_rtmp_packet_destroy(&rpkt);
+                           rt->state == STATE_RECEIVING))
             return 0;
-        }
-        if (!rpkt.data_size || !rt->is_input) {
-            ff_rtmp_packet_destroy(&rpkt);
+        if (!rpkt.data_size || !rt->is_input)
             continue;
-        }
         if (rpkt.type == RTMP_PT_VIDEO || rpkt.type == RTMP_PT_AUDIO ||
            (rpkt.type == RTMP_PT_NOTIFY && !memcmp("\002\000\012onMetaData", rpkt.data, 13))) {
             ts = rpkt.timestamp;
 
-            // generate packet header and put data into buffer for FLV demuxer
+            // generate packet header for FLV demuxer, the payload is read
+            // from the packet buffer, which is kept until the next packet
             rt->flv_off  = 0;
-            rt->flv_size = rpkt.data_size + 15;
-            rt->flv_data = p = av_realloc(rt->flv_data, rt->flv_size);
+            rt->flv_size = 15;
+            p = av_realloc(rt->flv_data, rt->flv_size);
+            if (!p)
+                return AVERROR(ENOMEM);
+            rt->flv_data = p;
             bytestream_put_byte(&p, rpkt.type);
             bytestream_put_be24(&p, rpkt.data_size);
             bytestream_put_be24(&p, ts);
             bytestream_put_byte(&p, ts >> 24);
             bytestream_put_be24(&p, 0);
-            bytestream_put_buffer(&p, rpkt.data, rpkt.data_size);
             bytestream_put_be32(&p, 0);
-            ff_rtmp_packet_destroy(&rpkt);
+            rt->flv_payload      = rpkt.data;
+            rt->flv_payload_size = rpkt.data_size;
+            rt->flv_payload_off  = 11;
             return 0;
         } else if (rpkt.type == RTMP_PT_NOTIFY) {
             ret = handle_notify(s, &rpkt);
-            ff_rtmp_packet_destroy(&rpkt);
             if (ret) {
                 av_log(s, AV_LOG_ERROR, "Handle notify error\n");
                 return ret;
@@ -2198,8 +2192,7 @@ static int get_packet(URLContext *s, int for_header)
         } else if (rpkt.type == RTMP_PT_METADATA) {
             // we got raw FLV data, make it available for FLV demuxer
             rt->flv_off  = 0;
-            rt->flv_size = rpkt.data_size;
-            rt->flv_data = av_realloc(rt->flv_data, rt->flv_size);
+            rt->flv_size = 0;
             /* rewrite timestamps */
             next = rpkt.data;
             ts = rpkt.timestamp;
@@ -2217,11 +2210,11 @@ static int get_packet(URLContext *s, int for_header)
                 bytestream_put_byte(&p, ts >> 24);
                 next += data_size + 3 + 4;
             }
-            memcpy(rt->flv_data, rpkt.data, rpkt.data_size);
-            ff_rtmp_packet_destroy(&rpkt);
+            rt->flv_payload      = rpkt.data;
+            rt->flv_payload_size = rpkt.data_size;
+            rt->flv_payload_off  = 0;
             return 0;
         }
-        ff_rtmp_packet_destroy(&rpkt);
     }
 }
 
@@ -2241,6 +2234,8 @@ static int rtmp_close(URLContext *h)
         ret = gen_delete_stream(h, rt);
 
     free_tracked_methods(rt);
+    ff_rtmp_packet_history_free(rt->prev_pkt[0]);
+    ff_rtmp_packet_history_free(rt->prev_pkt[1]);
     av_freep(&rt->flv_data);
     ffurl_close(rt->stream);
     return ret;
@@ -2457,7 +2452,8 @@ reconnect:
         rt->stream       = NULL;
         rt->do_reconnect = 0;
         rt->nb_invokes   = 0;
-        memset(rt->prev_pkt, 0, sizeof(rt->prev_pkt));
+        ff_rtmp_packet_history_free(rt->prev_pkt[0]);
+        ff_rtmp_packet_history_free(rt->prev_pkt[1]);
         free_tracked_methods(rt);
         goto reconnect;
     }
@@ -2492,8 +2488,17 @@ static int rtmp_read(URLContext *s, uint8_t *buf, int size)
     int ret;
 
     while (size > 0) {
-        int data_left = rt->flv_size - rt->flv_off;
-
+        int data_left;
+
+        if (rt->flv_payload_size && rt->flv_off == rt->flv_payload_off) {
+            int len = FFMIN(size, rt->flv_payload_size);
+            memcpy(buf, rt->flv_payload, len);
+            rt->flv_payload      += len;
+            rt->flv_payload_size -= len;
+            return len;
+        }
+        data_left = (rt->flv_payload_size ? rt->flv_payload_off : rt->flv_size) -
+                    rt->flv_off;
         if (data_left >= size) {
             memcpy(buf, rt->flv_data + rt->flv_off, size);
             rt->flv_off += size;
@@ -2503,7 +2508,7 @@ static int rtmp_read(URLContext *s, uint8_t *buf, int size)
             memcpy(buf, rt->flv_data + rt->flv_off, data_left);
             buf  += data_left;
             size -= data_left;
-            rt->flv_off = rt->flv_size;
+            rt->flv_off += data_left;
             return data_left;
         }
         if ((ret = get_packet(s, 0)) < 0)
@@ -2617,8 +2622,6 @@ static int rtmp_write(URLContext *s, const uint8_t *buf, int size)
 
         if ((ret = rtmp_parse_result(s, rt, &rpkt)) < 0)
             return ret;
-
-        ff_rtmp_packet_destroy(&rpkt);
     }
 
     return size;
@@ -30,6 +30,8 @@
 #include "rtpdec.h"
 #include "rtpdec_formats.h"
 
+#define RTP_QUEUE_SPAN_FACTOR 4
+
 #define MIN_FEEDBACK_INTERVAL 200000 /* 200 ms in us */
 
 static RTPDynamicProtocolHandler realmedia_mp3_dynamic_handler = {
@@ -387,28 +389,28 @@ void ff_rtp_send_punch_packets(URLContext *rtp_handle)
     av_free(buf);
 }
 
+static RTPPacket *queue_slot(RTPDemuxContext *s, uint16_t seq)
+{
+    return &s->queue[(s->queue_first + (uint16_t)(seq - s->queue_head)) %
+                     s->queue_slots];
+}
+
 static int find_missing_packets(RTPDemuxContext *s, uint16_t *first_missing,
                                 uint16_t *missing_mask)
 {
     int i;
     uint16_t next_seq = s->seq + 1;
-    RTPPacket *pkt = s->queue;
 
-    if (!pkt || pkt->seq == next_seq)
+    if (!s->queue_len || s->queue_head == next_seq)
         return 0;
 
     *missing_mask = 0;
     for (i = 1; i <= 16; i++) {
         uint16_t missing_seq = next_seq + i;
-        while (pkt) {
-            int16_t diff = pkt->seq - missing_seq;
-            if (diff >= 0)
-                break;
-            pkt = pkt->next;
-        }
-        if (!pkt)
+        int16_t diff = missing_seq - s->queue_head;
+        if ((int16_t)(missing_seq - s->queue_last) > 0)
             break;
-        if (pkt->seq == missing_seq)
+        if (diff >= 0 && queue_slot(s, missing_seq)->buf)
             continue;
         *missing_mask |= 1 << (i - 1);
     }
@@ -499,6 +501,16 @@ RTPDemuxContext *ff_rtp_parse_open(AVFormatContext *s1, AVStream *st,
     s->ic                  = s1;
     s->st                  = st;
     s->queue_size          = queue_size;
+    if (queue_size > 1) {
+        /* Leave room for the gaps of the lost or late packets, but keep
+         * the span unambiguous within the 16 bit sequence numbers. */
+        s->queue_slots = FFMIN(queue_size, 1 << 11) * RTP_QUEUE_SPAN_FACTOR;
+        s->queue = av_mallocz(s->queue_slots * sizeof(*s->queue));
+        if (!s->queue) {
+            av_free(s);
+            return NULL;
+        }
+    }
     rtp_init_statistics(&s->statistics, 0);
     if (st) {
         switch (st->codec->codec_id) {
@@ -655,72 +667,120 @@ static int rtp_parse_packet_internal(RTPDemuxContext *s, AVPacket *pkt,
 
 void ff_rtp_reset_packet_queue(RTPDemuxContext *s)
 {
-    while (s->queue) {
-        RTPPacket *next = s->queue->next;
-        av_free(s->queue->buf);
-        av_free(s->queue);
-        s->queue = next;
+    int i;
+
+    for (i = 0; s->queue && i < s->queue_slots; i++)
+        av_freep(&s->queue[i].buf);
+    av_freep(&s->queue_overflow.buf);
+    s->seq         = 0;
+    s->queue_first = 0;
+    s->queue_len   = 0;
+    s->prev_ret    = 0;
+}
+
+static void store_packet(RTPDemuxContext *s, RTPPacket *packet)
+{
+    if (!s->queue_len) {
+        s->queue_head = s->queue_last = packet->seq;
+    } else if ((int16_t)(packet->seq - s->queue_head) < 0) {
+        int shift = (uint16_t)(s->queue_head - packet->seq);
+        s->queue_first = (s->queue_first - shift % s->queue_slots +
+                          s->queue_slots) % s->queue_slots;
+        s->queue_head  = packet->seq;
+    } else if ((int16_t)(packet->seq - s->queue_last) > 0) {
+        s->queue_last  = packet->seq;
     }
-    s->seq       = 0;
-    s->queue_len = 0;
-    s->prev_ret  = 0;
+    *queue_slot(s, packet->seq) = *packet;
+    s->queue_len++;
 }
 
-static void enqueue_packet(RTPDemuxContext *s, uint8_t *buf, int len)
+/**
+ * Remove the oldest packet from the queue, parsing it if pkt is set,
+ * and move the overflowing packet into the queue once it fits.
+ */
+static int dequeue_packet(RTPDemuxContext *s, AVPacket *pkt)
 {
-    uint16_t seq   = AV_RB16(buf + 2);
-    RTPPacket **cur = &s->queue, *packet;
+    RTPPacket *packet = &s->queue[s->queue_first];
+    int rv = -1;
+
+    if (pkt)
+        rv = rtp_parse_packet_internal(s, pkt, packet->buf, packet->len);
+    av_freep(&packet->buf);
+    if (--s->queue_len) {
+        do {
+            s->queue_first = (s->queue_first + 1) % s->queue_slots;
+            s->queue_head++;
+        } while (!s->queue[s->queue_first].buf);
+    }
 
-    /* Find the correct place in the queue to insert the packet */
-    while (*cur) {
-        int16_t diff = seq - (*cur)->seq;
-        if (diff < 0)
-            break;
-        cur = &(*cur)->next;
+    if (s->queue_overflow.buf &&
+        (!s->queue_len ||
+         (uint16_t)(s->queue_overflow.seq - s->queue_head) < s->queue_slots)) {
+        store_packet(s, &s->queue_overflow);
+        s->queue_overflow.buf = NULL;
     }
+    return rv;
+}
 
-    packet = av_mallocz(sizeof(*packet));
-    if (!packet)
-        return;
-    packet->recvtime = av_gettime();
-    packet->seq      = seq;
-    packet->len      = len;
-    packet->buf      = buf;
-    packet->next     = *cur;
-    *cur = packet;
-    s->queue_len++;
+/**
+ * Insert a packet in the reordering queue.
+ *
+ * @return 0 if the packet was queued, 1 if it is older than the queued
+ *         packets but too old to fit with them, and should be parsed
+ *         immediately, or a negative value if it is a duplicate
+ */
+static int enqueue_packet(RTPDemuxContext *s, uint8_t *buf, int len)
+{
+    RTPPacket packet = { AV_RB16(buf + 2), buf, len, av_gettime() };
+
+    if (s->queue_len) {
+        int16_t diff = packet.seq - s->queue_head;
+        if (diff < 0 && (uint16_t)(s->queue_last - packet.seq) >= s->queue_slots)
+            return 1;
+        if (diff >= 0 && diff < s->queue_slots) {
+            if (queue_slot(s, packet.seq)->buf)
+                return -1;
+        } else if (diff >= s->queue_slots) {
+            if (s->queue_overflow.buf) {
+                /* The caller did not drain the queue after the previous
+                 * overflow: make room for it by dropping the oldest packets. */
+                av_log(s->st ? s->st->codec : NULL, AV_LOG_WARNING,
+                       "RTP: reordering queue overflow, dropping packets\n");
+                while (s->queue_overflow.buf)
+                    dequeue_packet(s, NULL);
+                return enqueue_packet(s, buf, len);
+            }
+            /* Kept aside until the oldest packets have been returned */
+            s->queue_overflow = packet;
+            return 0;
+        }
+    }
+    store_packet(s, &packet);
+    return 0;
 }
 
 static int has_next_packet(RTPDemuxContext *s)
 {
-    return s->queue && s->queue->seq == (uint16_t) (s->seq + 1);
+    return s->queue_len && (s->queue_head == (uint16_t) (s->seq + 1) ||
+                            s->queue_overflow.buf);
 }
 
 int64_t ff_rtp_queued_packet_time(RTPDemuxContext *s)
 {
-    return s->queue ? s->queue->recvtime : 0;
+    return s->queue_len ? s->queue[s->queue_first].recvtime : 0;
 }
 
 static int rtp_parse_queued_packet(RTPDemuxContext *s, AVPacket *pkt)
 {
-    int rv;
-    RTPPacket *next;
-
     if (s->queue_len <= 0)
         return -1;
 
-    if (!has_next_packet(s))
+    if (s->queue_head != (uint16_t) (s->seq + 1))
         av_log(s->st ? s->st->codec : NULL, AV_LOG_WARNING,
-               "RTP: missed %d packets\n", s->queue->seq - s->seq - 1);
+               "RTP: missed %d packets\n", (uint16_t) (s->queue_head - s->seq - 1));
 
     /* Parse the first packet in the queue, and dequeue it */
-    rv   = rtp_parse_packet_internal(s, pkt, s->queue->buf, s->queue->len);
-    next = s->queue->next;
-    av_free(s->queue->buf);
-    av_free(s->queue);
-    s->queue = next;
-    s->queue_len--;
-    return rv;
+    return dequeue_packet(s, pkt);
 }
 
 static int rtp_parse_one_packet(RTPDemuxContext *s, AVPacket *pkt,
@@ -769,7 +829,7 @@ static int rtp_parse_one_packet(RTPDemuxContext *s, AVPacket *pkt,
         rtcp_update_jitter(&s->statistics, timestamp, arrival_ts);
     }
 
-    if ((s->seq == 0 && !s->queue) || s->queue_size <= 1) {
+    if ((s->seq == 0 && !s->queue_len) || s->queue_size <= 1) {
         /* First packet, or no reordering */
         return rtp_parse_packet_internal(s, pkt, buf, len);
     } else {
@@ -786,11 +846,18 @@ static int rtp_parse_one_packet(RTPDemuxContext *s, AVPacket *pkt,
             return rv;
         } else {
             /* Still missing some packet, enqueue this one. */
-            enqueue_packet(s, buf, len);
+            rv = enqueue_packet(s, buf, len);
+            if (rv < 0) {
+                av_log(s->st ? s->st->codec : NULL, AV_LOG_WARNING,
+                       "RTP: dropping duplicate packet\n");
+                return -1;
+            } else if (rv > 0) {
+                return rtp_parse_packet_internal(s, pkt, buf, len);
+            }
             *bufptr = NULL;
             /* Return the first enqueued packet if the queue is full,
              * even if we're missing something */
-            if (s->queue_len >= s->queue_size)
+            if (s->queue_len >= s->queue_size || s->queue_overflow.buf)
                 return rtp_parse_queued_packet(s, pkt);
             return -1;
         }
@@ -822,6 +889,7 @@ int ff_rtp_parse_packet(RTPDemuxContext *s, AVPacket *pkt,
 void ff_rtp_parse_close(RTPDemuxContext *s)
 {
     ff_rtp_reset_packet_queue(s);
+    av_free(s->queue);
     ff_srtp_free(&s->srtp);
     av_free(s);
 }
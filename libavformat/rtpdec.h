@@ -142,10 +142,9 @@ struct RTPDynamicProtocolHandler {
 
 typedef struct RTPPacket {
     uint16_t seq;
-    uint8_t *buf;
+    uint8_t *buf;     ///< NULL if the slot is empty
     int len;
     int64_t recvtime;
-    struct RTPPacket *next;
 } RTPPacket;
 
 struct RTPDemuxContext {
@@ -171,9 +170,16 @@ struct RTPDemuxContext {
 
     /** Fields for packet reordering @{ */
     int prev_ret;     ///< The return value of the actual parsing of the previous packet
-    RTPPacket* queue; ///< A sorted queue of buffered packets not yet returned
-    int queue_len;    ///< The number of packets in queue
-    int queue_size;   ///< The size of queue, or 0 if reordering is disabled
+    /** Ring of queue_slots slots for the buffered packets not yet returned,
+     *  indexed by the distance of their sequence number from queue_head */
+    RTPPacket *queue;
+    int queue_slots;          ///< The span of sequence numbers the queue can hold
+    int queue_first;          ///< The slot of the oldest queued packet
+    uint16_t queue_head;      ///< The sequence number of the oldest queued packet
+    uint16_t queue_last;      ///< The sequence number of the newest queued packet
+    int queue_len;            ///< The number of packets in queue
+    int queue_size;           ///< The size of queue, or 0 if reordering is disabled
+    RTPPacket queue_overflow; ///< Packet too far ahead to fit in the queue yet
     /*@}*/
 
     /* rtcp sender statistics receive */
@@ -79,6 +79,13 @@ typedef struct RTPMuxContext RTPMuxContext;
     { "h264_mode0", "Use mode 0 for H264 in RTP", 0, AV_OPT_TYPE_CONST, {.i64 = FF_RTP_FLAG_H264_MODE0}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "rtpflags" } \
 
 void ff_rtp_send_data(AVFormatContext *s1, const uint8_t *buf1, int len, int m);
+/**
+ * Send an RTP packet whose payload is prefix followed by buf1, without
+ * gathering them in a single buffer first.
+ */
+void ff_rtp_send_data_prefixed(AVFormatContext *s1,
+                               const uint8_t *prefix, int prefix_len,
+                               const uint8_t *buf1, int len, int m);
 
 void ff_rtp_send_h264(AVFormatContext *s1, const uint8_t *buf1, int size);
 void ff_rtp_send_h263(AVFormatContext *s1, const uint8_t *buf1, int size);
@@ -54,6 +54,7 @@ static void nal_send(AVFormatContext *s1, const uint8_t *buf, int size, int last
     } else {
         uint8_t type = buf[0] & 0x1F;
         uint8_t nri = buf[0] & 0x60;
+        uint8_t fu_header[2];
 
         if (s->flags & FF_RTP_FLAG_H264_MODE0) {
             av_log(s1, AV_LOG_ERROR,
@@ -62,22 +63,22 @@ static void nal_send(AVFormatContext *s1, const uint8_t *buf, int size, int last
             return;
         }
         av_log(s1, AV_LOG_DEBUG, "NAL size %d > %d\n", size, s->max_payload_size);
-        s->buf[0] = 28;        /* FU Indicator; Type = 28 ---> FU-A */
-        s->buf[0] |= nri;
-        s->buf[1] = type;
-        s->buf[1] |= 1 << 7;
+        /* the fragments are sent from the packet, after the FU header */
+        fu_header[0] = 28;        /* FU Indicator; Type = 28 ---> FU-A */
+        fu_header[0] |= nri;
+        fu_header[1] = type;
+        fu_header[1] |= 1 << 7;
         buf += 1;
         size -= 1;
         while (size + 2 > s->max_payload_size) {
-            memcpy(&s->buf[2], buf, s->max_payload_size - 2);
-            ff_rtp_send_data(s1, s->buf, s->max_payload_size, 0);
+            ff_rtp_send_data_prefixed(s1, fu_header, 2,
+                                      buf, s->max_payload_size - 2, 0);
             buf += s->max_payload_size - 2;
             size -= s->max_payload_size - 2;
-            s->buf[1] &= ~(1 << 7);
+            fu_header[1] &= ~(1 << 7);
         }
-        s->buf[1] |= 1 << 6;
-        memcpy(&s->buf[2], buf, size);
-        ff_rtp_send_data(s1, s->buf, size + 2, last);
+        fu_header[1] |= 1 << 6;
+        ff_rtp_send_data_prefixed(s1, fu_header, 2, buf, size, last);
     }
 }
 
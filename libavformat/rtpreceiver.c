@@ -0,0 +1,520 @@
+/*
+ * Receive thread shared by the RTP sessions of a process
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#define _GNU_SOURCE     /* Needed for recvmmsg() */
+
+#include "config.h"
+#include "libavutil/atomic.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/log.h"
+#include "libavutil/mem.h"
+#include "libavutil/spsc_fifo.h"
+#include "avformat.h"
+#include "network.h"
+#include "rtpdec.h"
+#include "rtpreceiver.h"
+
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
+#if HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#elif HAVE_POLL_H
+#include <poll.h>
+#endif
+
+#if HAVE_PTHREADS && (HAVE_SYS_EPOLL_H || HAVE_POLL_H)
+
+#define POLL_TIMEOUT_MS 100
+#define RECV_BATCH      16
+#define MAX_EVENTS      64
+#define CTL_INDEX       0xff
+#define HEADER_SIZE     8       ///< datagram size and stream index
+
+struct RTPReceiverSession {
+    struct RTPReceiver *receiver;
+    void *logctx;
+    FFSPSCFifo *fifo;
+    int fds[CTL_INDEX];
+    int streams[CTL_INDEX];
+    int nb_fds;
+    int ctl_fd;
+    volatile int ctl_ready;     ///< set by the receive thread
+    int ctl_rearm;
+    int slot;
+    uint32_t generation;
+    int overruns;
+};
+
+typedef struct RTPReceiver {
+    pthread_t thread;
+    int quit;
+    /* The sockets are registered with a key made of the slot and the
+     * generation of their session, so that the events which were already
+     * returned for a closed session are ignored. */
+    RTPReceiverSession **sessions;
+    int nb_sessions;
+    int nb_slots;
+    uint32_t generation;
+#if HAVE_SYS_EPOLL_H
+    int epoll_fd;
+#else
+    struct pollfd *pfds;
+    uint64_t *keys;
+    int nb_pfds_alloc;
+#endif
+#if HAVE_RECVMMSG
+    struct mmsghdr msgs[RECV_BATCH];
+    struct iovec iov[RECV_BATCH];
+#endif
+    uint8_t buf[RECV_BATCH][RTP_MAX_PACKET_LENGTH];
+} RTPReceiver;
+
+/* The receive thread processes the events with the lock held, so that the
+ * sessions cannot be closed meanwhile. */
+static pthread_mutex_t receiver_lock = PTHREAD_MUTEX_INITIALIZER;
+static RTPReceiver *receiver;
+
+static uint64_t make_key(RTPReceiverSession *s, int index)
+{
+    return (uint64_t)s->generation << 32 | s->slot << 8 | index;
+}
+
+static RTPReceiverSession *get_session(RTPReceiver *r, uint64_t key)
+{
+    int slot = (key >> 8) & 0xffffff;
+
+    if (slot >= r->nb_slots || !r->sessions[slot] ||
+        r->sessions[slot]->generation != key >> 32)
+        return NULL;
+    return r->sessions[slot];
+}
+
+static int recv_datagrams(RTPReceiver *r, int fd, int *lens)
+{
+    int n;
+
+#if HAVE_RECVMMSG
+    int i;
+
+    n = recvmmsg(fd, r->msgs, RECV_BATCH, MSG_DONTWAIT, NULL);
+    if (n >= 0 || errno != ENOSYS) {
+        for (i = 0; i < n; i++)
+            lens[i] = r->msgs[i].msg_len;
+        return n;
+    }
+#endif
+    n = lens[0] = recv(fd, r->buf[0], sizeof(r->buf[0]), MSG_DONTWAIT);
+    return n < 0 ? n : 1;
+}
+
+static void read_socket(RTPReceiver *r, RTPReceiverSession *s, int index)
+{
+    int lens[RECV_BATCH];
+    int i, n, space, overruns = 0;
+
+    if (index == CTL_INDEX) {
+        /* the demuxer reads the control connection itself */
+        avpriv_atomic_int_set(&s->ctl_ready, 1);
+        avpriv_spsc_fifo_wake(s->fifo);
+        return;
+    }
+
+    n = recv_datagrams(r, s->fds[index], lens);
+    if (n <= 0)
+        return;
+    space = avpriv_spsc_fifo_space(s->fifo);
+    for (i = 0; i < n; i++) {
+        uint8_t hdr[HEADER_SIZE];
+
+        if (lens[i] <= 0)
+            continue;
+        if (space < lens[i] + HEADER_SIZE) {
+            overruns++;
+            continue;
+        }
+        AV_WL32(hdr,     lens[i]);
+        AV_WL32(hdr + 4, s->streams[index]);
+        avpriv_spsc_fifo_write(s->fifo, hdr, HEADER_SIZE);
+        avpriv_spsc_fifo_write(s->fifo, r->buf[i], lens[i]);
+        space -= lens[i] + HEADER_SIZE;
+    }
+    avpriv_spsc_fifo_publish(s->fifo);
+
+    if (overruns) {
+        if (!s->overruns)
+            av_log(s->logctx, AV_LOG_WARNING, "Receive queue full, "
+                   "dropping packets\n");
+        s->overruns += overruns;
+    }
+}
+
+#if HAVE_SYS_EPOLL_H
+static void *receiver_thread(void *arg)
+{
+    RTPReceiver *r = arg;
+    struct epoll_event events[MAX_EVENTS];
+    int i, n;
+
+    for (;;) {
+        n = epoll_wait(r->epoll_fd, events, MAX_EVENTS, POLL_TIMEOUT_MS);
+        pthread_mutex_lock(&receiver_lock);
+        if (r->quit)
+            break;
+        for (i = 0; i < n; i++) {
+            RTPReceiverSession *s = get_session(r, events[i].data.u64);
+            if (s)
+                read_socket(r, s, events[i].data.u64 & 0xff);
+        }
+        pthread_mutex_unlock(&receiver_lock);
+    }
+    pthread_mutex_unlock(&receiver_lock);
+    return NULL;
+}
+
+static int watch_fd(RTPReceiver *r, int fd, uint64_t key, int op, int oneshot)
+{
+    struct epoll_event ev = { 0 };
+
+    ev.events   = EPOLLIN | (oneshot ? EPOLLONESHOT : 0);
+    ev.data.u64 = key;
+    if (epoll_ctl(r->epoll_fd, op, fd, &ev) < 0)
+        return AVERROR(errno);
+    return 0;
+}
+
+static int add_session_fds(RTPReceiver *r, RTPReceiverSession *s)
+{
+    int i, ret;
+
+    for (i = 0; i < s->nb_fds; i++)
+        if ((ret = watch_fd(r, s->fds[i], make_key(s, i), EPOLL_CTL_ADD, 0)) < 0)
+            return ret;
+    if (s->ctl_fd >= 0)
+        return watch_fd(r, s->ctl_fd, make_key(s, CTL_INDEX), EPOLL_CTL_ADD, 1);
+    return 0;
+}
+
+static void remove_session_fds(RTPReceiver *r, RTPReceiverSession *s)
+{
+    struct epoll_event ev = { 0 };
+    int i;
+
+    for (i = 0; i < s->nb_fds; i++)
+        epoll_ctl(r->epoll_fd, EPOLL_CTL_DEL, s->fds[i], &ev);
+    if (s->ctl_fd >= 0)
+        epoll_ctl(r->epoll_fd, EPOLL_CTL_DEL, s->ctl_fd, &ev);
+}
+
+static void rearm_ctl_fd(RTPReceiver *r, RTPReceiverSession *s)
+{
+    watch_fd(r, s->ctl_fd, make_key(s, CTL_INDEX), EPOLL_CTL_MOD, 1);
+}
+
+static int init_receiver(RTPReceiver *r)
+{
+    r->epoll_fd = epoll_create(MAX_EVENTS);
+    return r->epoll_fd < 0 ? AVERROR(errno) : 0;
+}
+
+static void uninit_receiver(RTPReceiver *r)
+{
+    close(r->epoll_fd);
+}
+#else
+/* Without epoll, the poll() array is rebuilt from the registered sessions
+ * at each iteration. */
+static int grow_poll_array(RTPReceiver *r, int size)
+{
+    struct pollfd *pfds;
+    uint64_t *keys;
+
+    if (size <= r->nb_pfds_alloc)
+        return 0;
+    size = FFMAX(size, 2 * r->nb_pfds_alloc);
+    if (!(pfds = av_realloc(r->pfds, size * sizeof(*pfds))))
+        return AVERROR(ENOMEM);
+    r->pfds = pfds;
+    if (!(keys = av_realloc(r->keys, size * sizeof(*keys))))
+        return AVERROR(ENOMEM);
+    r->keys = keys;
+    r->nb_pfds_alloc = size;
+    return 0;
+}
+
+static int build_poll_array(RTPReceiver *r)
+{
+    int i, j, n = 0;
+
+    for (i = 0; i < r->nb_slots; i++) {
+        RTPReceiverSession *s = r->sessions[i];
+        if (!s)
+            continue;
+        if (grow_poll_array(r, n + s->nb_fds + 1) < 0)
+            return n;
+        for (j = 0; j < s->nb_fds; j++) {
+            r->pfds[n].fd     = s->fds[j];
+            r->pfds[n].events = POLLIN;
+            r->keys[n++]      = make_key(s, j);
+        }
+        if (s->ctl_fd >= 0 && !avpriv_atomic_int_get(&s->ctl_ready)) {
+            r->pfds[n].fd     = s->ctl_fd;
+            r->pfds[n].events = POLLIN;
+            r->keys[n++]      = make_key(s, CTL_INDEX);
+        }
+    }
+    return n;
+}
+
+static void *receiver_thread(void *arg)
+{
+    RTPReceiver *r = arg;
+    int i, n;
+
+    pthread_mutex_lock(&receiver_lock);
+    while (!r->quit) {
+        n = build_poll_array(r);
+        pthread_mutex_unlock(&receiver_lock);
+        if (poll(r->pfds, n, POLL_TIMEOUT_MS) < 0)
+            n = 0;
+        pthread_mutex_lock(&receiver_lock);
+        if (r->quit)
+            break;
+        for (i = 0; i < n; i++) {
+            RTPReceiverSession *s;
+            if (!(r->pfds[i].revents & (POLLIN | POLLERR | POLLHUP)))
+                continue;
+            if ((s = get_session(r, r->keys[i])))
+                read_socket(r, s, r->keys[i] & 0xff);
+        }
+    }
+    pthread_mutex_unlock(&receiver_lock);
+    return NULL;
+}
+
+static int  add_session_fds(RTPReceiver *r, RTPReceiverSession *s) { return 0; }
+static void remove_session_fds(RTPReceiver *r, RTPReceiverSession *s) { }
+static void rearm_ctl_fd(RTPReceiver *r, RTPReceiverSession *s) { }
+static int  init_receiver(RTPReceiver *r) { return 0; }
+
+static void uninit_receiver(RTPReceiver *r)
+{
+    av_freep(&r->pfds);
+    av_freep(&r->keys);
+}
+#endif
+
+static int start_receiver(void)
+{
+    RTPReceiver *r;
+    int ret;
+
+    if (!(r = av_mallocz(sizeof(*r))))
+        return AVERROR(ENOMEM);
+    if ((ret = init_receiver(r)) < 0) {
+        av_free(r);
+        return ret;
+    }
+#if HAVE_RECVMMSG
+    {
+        int i;
+        for (i = 0; i < RECV_BATCH; i++) {
+            r->iov[i].iov_base = r->buf[i];
+            r->iov[i].iov_len  = sizeof(r->buf[i]);
+            r->msgs[i].msg_hdr.msg_iov    = &r->iov[i];
+            r->msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+    }
+#endif
+    if ((ret = pthread_create(&r->thread, NULL, receiver_thread, r))) {
+        uninit_receiver(r);
+        av_free(r);
+        return AVERROR(ret);
+    }
+    receiver = r;
+    return 0;
+}
+
+/* called with the lock held, the lock is released */
+static void stop_receiver_unlock(void)
+{
+    RTPReceiver *r = receiver;
+
+    r->quit  = 1;
+    receiver = NULL;
+    pthread_mutex_unlock(&receiver_lock);
+
+    pthread_join(r->thread, NULL);
+    uninit_receiver(r);
+    av_free(r->sessions);
+    av_free(r);
+}
+
+int ff_rtp_receiver_open(RTPReceiverSession **ps, void *logctx,
+                         const int *fds, const int *streams, int nb_fds,
+                         int ctl_fd, int fifo_size)
+{
+    RTPReceiverSession *s;
+    RTPReceiver *r;
+    int i, ret;
+
+    *ps = NULL;
+    if (nb_fds > CTL_INDEX - 1)
+        return AVERROR(EINVAL);
+    if (!(s = av_mallocz(sizeof(*s))))
+        return AVERROR(ENOMEM);
+    if (!(s->fifo = avpriv_spsc_fifo_alloc(fifo_size))) {
+        av_free(s);
+        return AVERROR(ENOMEM);
+    }
+    s->logctx = logctx;
+    s->nb_fds = nb_fds;
+    s->ctl_fd = ctl_fd;
+    memcpy(s->fds,     fds,     nb_fds * sizeof(*fds));
+    memcpy(s->streams, streams, nb_fds * sizeof(*streams));
+
+    pthread_mutex_lock(&receiver_lock);
+    if (!receiver && (ret = start_receiver()) < 0)
+        goto fail;
+    r = receiver;
+
+    for (i = 0; i < r->nb_slots && r->sessions[i]; i++)
+        ;
+    if (i == r->nb_slots) {
+        RTPReceiverSession **sessions;
+        if (r->nb_slots >= 1 << 24 ||
+            !(sessions = av_realloc(r->sessions, (r->nb_slots + 1) * sizeof(*sessions)))) {
+            ret = AVERROR(ENOMEM);
+            goto fail_stop;
+        }
+        r->sessions = sessions;
+        r->sessions[r->nb_slots++] = NULL;
+    }
+    s->receiver   = r;
+    s->slot       = i;
+    s->generation = ++r->generation;
+    if ((ret = add_session_fds(r, s)) < 0) {
+        remove_session_fds(r, s);
+        goto fail_stop;
+    }
+    r->sessions[i] = s;
+    r->nb_sessions++;
+    pthread_mutex_unlock(&receiver_lock);
+
+    *ps = s;
+    return 0;
+
+fail_stop:
+    if (!r->nb_sessions) {
+        stop_receiver_unlock();
+        goto fail_free;
+    }
+fail:
+    pthread_mutex_unlock(&receiver_lock);
+fail_free:
+    avpriv_spsc_fifo_freep(&s->fifo);
+    av_free(s);
+    return ret;
+}
+
+int ff_rtp_receiver_read(RTPReceiverSession *s, uint8_t *buf, int size,
+                         int *stream, int64_t timeout)
+{
+    uint8_t hdr[HEADER_SIZE];
+    int len;
+
+    if (s->ctl_rearm) {
+        s->ctl_rearm = 0;
+        avpriv_atomic_int_set(&s->ctl_ready, 0);
+        rearm_ctl_fd(s->receiver, s);
+    }
+    /* the control connection goes first, it could starve otherwise */
+    if (avpriv_atomic_int_get(&s->ctl_ready)) {
+        s->ctl_rearm = 1;
+        *stream = -1;
+        return 0;
+    }
+    if (avpriv_spsc_fifo_size(s->fifo) < HEADER_SIZE) {
+        if (!timeout ||
+            avpriv_spsc_fifo_wait_size(s->fifo, HEADER_SIZE, timeout) < 0) {
+            if (avpriv_atomic_int_get(&s->ctl_ready)) {
+                s->ctl_rearm = 1;
+                *stream = -1;
+                return 0;
+            }
+            return AVERROR(EAGAIN);
+        }
+    }
+
+    avpriv_spsc_fifo_read(s->fifo, hdr, HEADER_SIZE);
+    len     = AV_RL32(hdr);
+    *stream = AV_RL32(hdr + 4);
+    avpriv_spsc_fifo_read(s->fifo, buf, FFMIN(len, size));
+    if (len > size)
+        avpriv_spsc_fifo_read(s->fifo, NULL, len - size);
+    avpriv_spsc_fifo_release(s->fifo);
+    return FFMIN(len, size);
+}
+
+void ff_rtp_receiver_close(RTPReceiverSession **ps)
+{
+    RTPReceiverSession *s = *ps;
+    RTPReceiver *r;
+
+    if (!s)
+        return;
+
+    pthread_mutex_lock(&receiver_lock);
+    r = s->receiver;
+    remove_session_fds(r, s);
+    r->sessions[s->slot] = NULL;
+    if (!--r->nb_sessions)
+        stop_receiver_unlock();
+    else
+        pthread_mutex_unlock(&receiver_lock);
+
+    if (s->overruns)
+        av_log(s->logctx, AV_LOG_WARNING, "%d packets dropped because the "
+               "receive queue was full\n", s->overruns);
+    avpriv_spsc_fifo_freep(&s->fifo);
+    av_freep(ps);
+}
+
+#else
+
+int ff_rtp_receiver_open(RTPReceiverSession **ps, void *logctx,
+                         const int *fds, const int *streams, int nb_fds,
+                         int ctl_fd, int fifo_size)
+{
+    *ps = NULL;
+    return AVERROR(ENOSYS);
+}
+
+int ff_rtp_receiver_read(RTPReceiverSession *s, uint8_t *buf, int size,
+                         int *stream, int64_t timeout)
+{
+    return AVERROR(ENOSYS);
+}
+
+void ff_rtp_receiver_close(RTPReceiverSession **ps)
+{
+}
+
+#endif
@@ -0,0 +1,76 @@
+/*
+ * Receive thread shared by the RTP sessions of a process
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFORMAT_RTPRECEIVER_H
+#define AVFORMAT_RTPRECEIVER_H
+
+#include <stdint.h>
+
+/**
+ * The sockets of one session, registered with the receive thread.
+ * The thread reads all the sockets of all the sessions, with epoll()
+ * where available, and queues the datagrams in a FIFO per session, so
+ * that the demuxers do not have to poll their own sockets.
+ */
+typedef struct RTPReceiverSession RTPReceiverSession;
+
+/**
+ * Register the sockets of a session, starting the receive thread if no
+ * other session uses it.
+ *
+ * @param ps        set to the new session
+ * @param logctx    context for logging, also from the receive thread
+ * @param fds       datagram sockets to read
+ * @param streams   stream index returned with the datagrams of each socket
+ * @param nb_fds    number of sockets, at most 254
+ * @param ctl_fd    control socket which is only watched for readability,
+ *                  and read by the caller, or -1
+ * @param fifo_size bytes of datagrams which can be queued for the
+ *                  session, the datagrams received when it is full are
+ *                  dropped
+ * @return 0 on success, a negative AVERROR code on failure, in particular
+ *         AVERROR(ENOSYS) if the receive thread is not supported
+ */
+int ff_rtp_receiver_open(RTPReceiverSession **ps, void *logctx,
+                         const int *fds, const int *streams, int nb_fds,
+                         int ctl_fd, int fifo_size);
+
+/**
+ * Get the next datagram received for a session.
+ *
+ * @param buf     where to store the datagram, truncated to size bytes
+ * @param stream  set to the stream index of the socket of the datagram,
+ *                or to -1 if the control socket is readable, after
+ *                which it is watched again at the next call
+ * @param timeout maximum time to wait in microseconds, 0 not to wait
+ * @return the datagram size, 0 for the control socket, or
+ *         AVERROR(EAGAIN) if nothing was received before the timeout
+ */
+int ff_rtp_receiver_read(RTPReceiverSession *s, uint8_t *buf, int size,
+                         int *stream, int64_t timeout);
+
+/**
+ * Unregister the sockets of a session and free it. This must be done
+ * before the sockets are closed. The receive thread is stopped when the
+ * last session is closed.
+ */
+void ff_rtp_receiver_close(RTPReceiverSession **ps);
+
+#endif /* AVFORMAT_RTPRECEIVER_H */
@@ -47,6 +47,7 @@
 #include "rtpenc_chain.h"
 #include "url.h"
 #include "rtpenc.h"
+#include "rtpreceiver.h"
 #include "mpegts.h"
 
 /* Timeout values for socket poll, in ms,
@@ -56,6 +57,7 @@
 #define MAX_TIMEOUTS READ_PACKET_TIMEOUT_S * 1000 / POLL_TIMEOUT_MS
 #define SDP_MAX_SIZE 16384
 #define RECVBUF_SIZE 10 * RTP_MAX_PACKET_LENGTH
+#define RECEIVER_FIFO_SIZE (1 << 20)
 #define DEFAULT_REORDERING_DELAY 100000
 
 #define OFFSET(x) offsetof(RTSPState, x)
@@ -65,7 +67,8 @@
 #define RTSP_FLAG_OPTS(name, longname) \
     { name, longname, OFFSET(rtsp_flags), AV_OPT_TYPE_FLAGS, {.i64 = 0}, INT_MIN, INT_MAX, DEC, "rtsp_flags" }, \
     { "filter_src", "Only receive packets from the negotiated peer IP", 0, AV_OPT_TYPE_CONST, {.i64 = RTSP_FLAG_FILTER_SRC}, 0, 0, DEC, "rtsp_flags" }, \
-    { "listen", "Wait for incoming connections", 0, AV_OPT_TYPE_CONST, {.i64 = RTSP_FLAG_LISTEN}, 0, 0, DEC, "rtsp_flags" }
+    { "listen", "Wait for incoming connections", 0, AV_OPT_TYPE_CONST, {.i64 = RTSP_FLAG_LISTEN}, 0, 0, DEC, "rtsp_flags" }, \
+    { "shared_recv", "Receive the UDP packets in a thread shared by all the sessions", 0, AV_OPT_TYPE_CONST, {.i64 = RTSP_FLAG_SHARED_RECV}, 0, 0, DEC, "rtsp_flags" }
 
 #define RTSP_MEDIATYPE_OPTS(name, longname) \
     { name, longname, OFFSET(media_type_mask), AV_OPT_TYPE_FLAGS, { .i64 = (1 << (AVMEDIA_TYPE_DATA+1)) - 1 }, INT_MIN, INT_MAX, DEC, "allowed_media_types" }, \
@@ -569,6 +572,10 @@ void ff_rtsp_undo_setup(AVFormatContext *s)
     RTSPState *rt = s->priv_data;
     int i;
 
+    /* before the sockets are closed */
+    if (CONFIG_RTPDEC)
+        ff_rtp_receiver_close(&rt->receiver);
+
     for (i = 0; i < rt->nb_rtsp_streams; i++) {
         RTSPStream *rtsp_st = rt->rtsp_streams[i];
         if (!rtsp_st)
@@ -1472,6 +1479,9 @@ fail:
 void ff_rtsp_close_connections(AVFormatContext *s)
 {
     RTSPState *rt = s->priv_data;
+    /* the receive thread may watch the control connection */
+    if (CONFIG_RTPDEC)
+        ff_rtp_receiver_close(&rt->receiver);
     if (rt->rtsp_hd_out != rt->rtsp_hd) ffurl_close(rt->rtsp_hd_out);
     ffurl_close(rt->rtsp_hd);
     rt->rtsp_hd = rt->rtsp_hd_out = NULL;
@@ -1715,6 +1725,111 @@ redirect:
 #endif /* CONFIG_RTSP_DEMUXER || CONFIG_RTSP_MUXER */
 
 #if CONFIG_RTPDEC
+/**
+ * Handle the data received on the RTSP connection while waiting for packets.
+ * @return 1 to keep waiting, otherwise the value to return for the packet
+ */
+static int read_control_data(AVFormatContext *s)
+{
+#if CONFIG_RTSP_DEMUXER
+    RTSPState *rt = s->priv_data;
+    int ret;
+
+    if (rt->rtsp_flags & RTSP_FLAG_LISTEN) {
+        if (rt->state == RTSP_STATE_STREAMING) {
+            if (!ff_rtsp_parse_streaming_commands(s))
+                return AVERROR_EOF;
+            else
+                av_log(s, AV_LOG_WARNING,
+                       "Unable to answer to TEARDOWN\n");
+        } else
+            return 0;
+    } else {
+        RTSPMessageHeader reply;
+        ret = ff_rtsp_read_reply(s, &reply, NULL, 0, NULL);
+        if (ret < 0)
+            return ret;
+        /* XXX: parse message */
+        if (rt->state != RTSP_STATE_STREAMING)
+            return 0;
+    }
+#endif
+    return 1;
+}
+
+static int open_receiver(AVFormatContext *s)
+{
+    RTSPState *rt = s->priv_data;
+    int *fds, *streams, *handles, nb_handles, nb_fds = 0;
+    int i, j, ret;
+
+    fds     = av_malloc(2 * rt->nb_rtsp_streams * sizeof(*fds));
+    streams = av_malloc(2 * rt->nb_rtsp_streams * sizeof(*streams));
+    if (!fds || !streams) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    for (i = 0; i < rt->nb_rtsp_streams; i++) {
+        RTSPStream *rtsp_st = rt->rtsp_streams[i];
+        if (!rtsp_st->rtp_handle)
+            continue;
+        if ((ret = ffurl_get_multi_file_handle(rtsp_st->rtp_handle,
+                                               &handles, &nb_handles)) < 0)
+            goto end;
+        for (j = 0; j < FFMIN(nb_handles, 2); j++) {
+            fds[nb_fds]       = handles[j];
+            streams[nb_fds++] = i;
+        }
+        av_free(handles);
+    }
+    ret = ff_rtp_receiver_open(&rt->receiver, s, fds, streams, nb_fds,
+                               rt->rtsp_hd ? ffurl_get_file_handle(rt->rtsp_hd) : -1,
+                               RECEIVER_FIFO_SIZE);
+end:
+    av_free(fds);
+    av_free(streams);
+    return ret;
+}
+
+/* udp_read_packet() with the packets received by the shared thread */
+static int receiver_read_packet(AVFormatContext *s, RTSPStream **prtsp_st,
+                                uint8_t *buf, int buf_size, int64_t wait_end)
+{
+    RTSPState *rt = s->priv_data;
+    int ret, stream, timeout_cnt = 0;
+
+    for (;;) {
+        int64_t timeout = POLL_TIMEOUT_MS * 1000;
+
+        if (ff_check_interrupt(&s->interrupt_callback))
+            return AVERROR_EXIT;
+        if (wait_end) {
+            int64_t left = wait_end - av_gettime();
+            if (left < 0)
+                return AVERROR(EAGAIN);
+            timeout = FFMIN(timeout, left);
+        }
+        if (s->flags & AVFMT_FLAG_NONBLOCK)
+            timeout = 0;
+
+        ret = ff_rtp_receiver_read(rt->receiver, buf, buf_size, &stream,
+                                   timeout);
+        if (ret > 0) {
+            *prtsp_st = rt->rtsp_streams[stream];
+            return ret;
+        } else if (ret == 0) {
+            /* the reply may have been read by a command sent meanwhile */
+            struct pollfd p = { ffurl_get_file_handle(rt->rtsp_hd), POLLIN, 0 };
+            if (poll(&p, 1, 0) > 0 && (ret = read_control_data(s)) <= 0)
+                return ret;
+        } else if (ret != AVERROR(EAGAIN) || s->flags & AVFMT_FLAG_NONBLOCK) {
+            return ret;
+        } else if (++timeout_cnt >= MAX_TIMEOUTS) {
+            return AVERROR(ETIMEDOUT);
+        }
+    }
+}
+
 static int udp_read_packet(AVFormatContext *s, RTSPStream **prtsp_st,
                            uint8_t *buf, int buf_size, int64_t wait_end)
 {
@@ -1725,6 +1840,17 @@ static int udp_read_packet(AVFormatContext *s, RTSPStream **prtsp_st,
     struct pollfd *p = rt->p;
     int *fds = NULL, fdsnum, fdsidx;
 
+    if (rt->rtsp_flags & RTSP_FLAG_SHARED_RECV) {
+        if (!rt->receiver && (ret = open_receiver(s)) < 0) {
+            if (ret != AVERROR(ENOSYS))
+                return ret;
+            av_log(s, AV_LOG_WARNING, "The shared receive thread is not "
+                   "supported, polling the sockets of the session\n");
+            rt->rtsp_flags &= ~RTSP_FLAG_SHARED_RECV;
+        } else
+            return receiver_read_packet(s, prtsp_st, buf, buf_size, wait_end);
+    }
+
     for (;;) {
         if (ff_check_interrupt(&s->interrupt_callback))
             return AVERROR_EXIT;
@@ -1775,28 +1901,10 @@ static int udp_read_packet(AVFormatContext *s, RTSPStream **prtsp_st,
                     j+=2;
                 }
             }
-#if CONFIG_RTSP_DEMUXER
             if (tcp_fd != -1 && p[0].revents & POLLIN) {
-                if (rt->rtsp_flags & RTSP_FLAG_LISTEN) {
-                    if (rt->state == RTSP_STATE_STREAMING) {
-                        if (!ff_rtsp_parse_streaming_commands(s))
-                            return AVERROR_EOF;
-                        else
-                            av_log(s, AV_LOG_WARNING,
-                                   "Unable to answer to TEARDOWN\n");
-                    } else
-                        return 0;
-                } else {
-                    RTSPMessageHeader reply;
-                    ret = ff_rtsp_read_reply(s, &reply, NULL, 0, NULL);
-                    if (ret < 0)
-                        return ret;
-                    /* XXX: parse message */
-                    if (rt->state != RTSP_STATE_STREAMING)
-                        return 0;
-                }
+                if ((ret = read_control_data(s)) <= 0)
+                    return ret;
             }
-#endif
         } else if (n == 0 && ++timeout_cnt >= MAX_TIMEOUTS) {
             return AVERROR(ETIMEDOUT);
         } else if (n < 0 && errno != EINTR)
@@ -399,6 +399,11 @@ typedef struct RTSPState {
      * Size of RTP packet reordering queue.
      */
     int reordering_queue_size;
+
+    /**
+     * Session of the shared receive thread, if RTSP_FLAG_SHARED_RECV is set.
+     */
+    struct RTPReceiverSession *receiver;
 } RTSPState;
 
 #define RTSP_FLAG_FILTER_SRC  0x1    /**< Filter incoming UDP packets -
@@ -406,6 +411,9 @@ typedef struct RTSPState {
                                           source address and port. */
 #define RTSP_FLAG_LISTEN      0x2    /**< Wait for incoming connections. */
 #define RTSP_FLAG_CUSTOM_IO   0x4    /**< Do all IO via the AVIOContext. */
+#define RTSP_FLAG_SHARED_RECV 0x8    /**< Receive the UDP packets with the
+                                          receive thread shared by all the
+                                          sessions of the process. */
 
 /**
  * Describe a single stream, as identified by a single m= line block in the
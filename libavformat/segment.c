@@ -30,6 +30,7 @@
 
 #include "avformat.h"
 #include "internal.h"
+#include "ioqueue.h"
 
 #include "libavutil/avassert.h"
 #include "libavutil/log.h"
@@ -99,8 +100,20 @@ typedef struct {
     SegmentListEntry *segment_list_entries_end;
 
     int is_first_pkt;      ///< tells if it is the first packet in the segment
+
+    int async_queue_size;  ///< number of output operations done in the background
+    IOQueue *io_queue;     ///< finishes the segments and writes the list
+
+    int mux_async;         ///< mux each segment in the background once complete
+    AVPacketList *pkt_list, *pkt_list_end; ///< packets of the current segment
 } SegmentContext;
 
+typedef struct SegmentMuxJob {
+    AVFormatContext *s;    ///< segment muxer, giving the time base of the packets
+    AVFormatContext *oc;   ///< context of the segment, header not written yet
+    AVPacketList *pkts;
+} SegmentMuxJob;
+
 static void print_csv_escaped_str(AVIOContext *ctx, const char *str)
 {
     int needs_quoting = !!str[strcspn(str, "\",\n\r")];
@@ -117,6 +130,49 @@ static void print_csv_escaped_str(AVIOContext *ctx, const char *str)
         avio_w8(ctx, '"');
 }
 
+static void free_pkt_list(AVPacketList *pktl)
+{
+    while (pktl) {
+        AVPacketList *next = pktl->next;
+        av_free_packet(&pktl->pkt);
+        av_free(pktl);
+        pktl = next;
+    }
+}
+
+/**
+ * Write a whole segment, run by the I/O queue in segment_mux_async mode.
+ */
+static int segment_mux_job(void *opaque)
+{
+    SegmentMuxJob *job = opaque;
+    AVFormatContext *oc = job->oc;
+    AVPacketList *pktl;
+    int ret, err;
+
+    ret = avio_open2(&oc->pb, oc->filename, AVIO_FLAG_WRITE,
+                     &job->s->interrupt_callback, NULL);
+    if (ret >= 0) {
+        if ((ret = avformat_write_header(oc, NULL)) >= 0) {
+            for (pktl = job->pkts; pktl && ret >= 0; pktl = pktl->next)
+                ret = ff_write_chained(oc, pktl->pkt.stream_index, &pktl->pkt, job->s);
+            err = av_write_trailer(oc);
+            ret = ret < 0 ? ret : err;
+        }
+        err = avio_close(oc->pb);
+        oc->pb = NULL;
+        ret = ret < 0 ? ret : err;
+    }
+    if (ret < 0)
+        av_log(job->s, AV_LOG_ERROR, "Failure occurred when writing segment '%s'\n",
+               oc->filename);
+
+    free_pkt_list(job->pkts);
+    avformat_free_context(oc);
+    av_free(job);
+    return ret;
+}
+
 static int segment_mux_init(AVFormatContext *s)
 {
     SegmentContext *seg = s->priv_data;
@@ -188,14 +244,15 @@ static int segment_start(AVFormatContext *s, int write_header)
         return err;
     seg->segment_count++;
 
-    if ((err = avio_open2(&oc->pb, oc->filename, AVIO_FLAG_WRITE,
+    if (!seg->mux_async &&
+        (err = avio_open2(&oc->pb, oc->filename, AVIO_FLAG_WRITE,
                           &s->interrupt_callback, NULL)) < 0)
         return err;
 
     if (oc->oformat->priv_class && oc->priv_data)
         av_opt_set(oc->priv_data, "resend_headers", "1", 0); /* mpegts specific */
 
-    if (write_header) {
+    if (write_header && !seg->mux_async) {
         if ((err = avformat_write_header(oc, NULL)) < 0)
             return err;
     }
@@ -204,32 +261,37 @@ static int segment_start(AVFormatContext *s, int write_header)
     return 0;
 }
 
-static int segment_list_open(AVFormatContext *s)
+static void segment_list_print_header(SegmentContext *seg, AVIOContext *pb)
 {
-    SegmentContext *seg = s->priv_data;
-    int ret;
-
-    ret = avio_open2(&seg->list_pb, seg->list, AVIO_FLAG_WRITE,
-                     &s->interrupt_callback, NULL);
-    if (ret < 0)
-        return ret;
-
     if (seg->list_type == LIST_TYPE_M3U8 && seg->segment_list_entries) {
         SegmentListEntry *entry;
         double max_duration = 0;
 
-        avio_printf(seg->list_pb, "#EXTM3U\n");
-        avio_printf(seg->list_pb, "#EXT-X-VERSION:3\n");
-        avio_printf(seg->list_pb, "#EXT-X-MEDIA-SEQUENCE:%d\n", seg->segment_list_entries->index);
-        avio_printf(seg->list_pb, "#EXT-X-ALLOW-CACHE:%s\n",
+        avio_printf(pb, "#EXTM3U\n");
+        avio_printf(pb, "#EXT-X-VERSION:3\n");
+        avio_printf(pb, "#EXT-X-MEDIA-SEQUENCE:%d\n", seg->segment_list_entries->index);
+        avio_printf(pb, "#EXT-X-ALLOW-CACHE:%s\n",
                     seg->list_flags & SEGMENT_LIST_FLAG_CACHE ? "YES" : "NO");
 
         for (entry = seg->segment_list_entries; entry; entry = entry->next)
             max_duration = FFMAX(max_duration, entry->end_time - entry->start_time);
-        avio_printf(seg->list_pb, "#EXT-X-TARGETDURATION:%"PRId64"\n", (int64_t)ceil(max_duration));
+        avio_printf(pb, "#EXT-X-TARGETDURATION:%"PRId64"\n", (int64_t)ceil(max_duration));
     } else if (seg->list_type == LIST_TYPE_FFCONCAT) {
-        avio_printf(seg->list_pb, "ffconcat version 1.0\n");
+        avio_printf(pb, "ffconcat version 1.0\n");
     }
+}
+
+static int segment_list_open(AVFormatContext *s)
+{
+    SegmentContext *seg = s->priv_data;
+    int ret;
+
+    ret = avio_open2(&seg->list_pb, seg->list, AVIO_FLAG_WRITE,
+                     &s->interrupt_callback, NULL);
+    if (ret < 0)
+        return ret;
+
+    segment_list_print_header(seg, seg->list_pb);
 
     return ret;
 }
@@ -273,17 +335,36 @@ static int segment_end(AVFormatContext *s, int write_trailer, int is_last)
 {
     SegmentContext *seg = s->priv_data;
     AVFormatContext *oc = seg->avf;
-    int ret = 0;
+    int ret = 0, err = 0;
 
-    av_write_frame(oc, NULL); /* Flush any buffered data (fragmented mp4) */
-    if (write_trailer)
-        ret = av_write_trailer(oc);
+    if (seg->mux_async) {
+        /* the job owns the context and the packets from now on */
+        SegmentMuxJob *job = av_mallocz(sizeof(*job));
+        if (!job)
+            return AVERROR(ENOMEM);
+        job->s    = s;
+        job->oc   = oc;
+        job->pkts = seg->pkt_list;
+        seg->avf  = oc = NULL;
+        seg->pkt_list = seg->pkt_list_end = NULL;
+        ret = ff_ioqueue_run(seg->io_queue, segment_mux_job, job);
+    } else {
+        av_write_frame(oc, NULL); /* Flush any buffered data (fragmented mp4) */
+        if (write_trailer)
+            ret = av_write_trailer(oc);
 
-    if (ret < 0)
-        av_log(s, AV_LOG_ERROR, "Failure occurred when ending segment '%s'\n",
-               oc->filename);
+        if (ret < 0)
+            av_log(s, AV_LOG_ERROR, "Failure occurred when ending segment '%s'\n",
+                   oc->filename);
+    }
 
+    /* The list is printed to a buffer which is written by the I/O queue,
+     * which also owns list_pb once the header has been written. */
     if (seg->list) {
+        AVIOContext *pb;
+        uint8_t *buf;
+        int size;
+
         if (seg->list_size || seg->list_type == LIST_TYPE_M3U8) {
             SegmentListEntry *entry = av_mallocz(sizeof(*entry));
             if (!entry) {
@@ -306,23 +387,35 @@ static int segment_end(AVFormatContext *s, int write_trailer, int is_last)
                 av_freep(&entry);
             }
 
-            avio_close(seg->list_pb);
-            if ((ret = segment_list_open(s)) < 0)
+            if ((ret = avio_open_dyn_buf(&pb)) < 0)
                 goto end;
+            segment_list_print_header(seg, pb);
             for (entry = seg->segment_list_entries; entry; entry = entry->next)
-                segment_list_print_entry(seg->list_pb, seg->list_type, entry, s);
+                segment_list_print_entry(pb, seg->list_type, entry, s);
             if (seg->list_type == LIST_TYPE_M3U8 && is_last)
-                avio_printf(seg->list_pb, "#EXT-X-ENDLIST\n");
+                avio_printf(pb, "#EXT-X-ENDLIST\n");
+            size = avio_close_dyn_buf(pb, &buf);
+
+            ff_ioqueue_close(seg->io_queue, seg->list_pb);
+            seg->list_pb = NULL;
+            ret = ff_ioqueue_write_url(seg->io_queue, seg->list,
+                                       &s->interrupt_callback, buf, size);
         } else {
-            segment_list_print_entry(seg->list_pb, seg->list_type, &seg->cur_entry, s);
+            if ((ret = avio_open_dyn_buf(&pb)) < 0)
+                goto end;
+            segment_list_print_entry(pb, seg->list_type, &seg->cur_entry, s);
+            size = avio_close_dyn_buf(pb, &buf);
+            ret = ff_ioqueue_write(seg->io_queue, seg->list_pb, buf, size);
         }
-        avio_flush(seg->list_pb);
     }
 
 end:
-    avio_close(oc->pb);
+    if (oc) {
+        err = ff_ioqueue_close(seg->io_queue, oc->pb);
+        oc->pb = NULL;
+    }
 
-    return ret;
+    return ret < 0 ? ret : err;
 }
 
 static int parse_times(void *log_ctx, int64_t **times, int *nb_times,
@@ -529,6 +622,12 @@ static int seg_write_header(AVFormatContext *s)
     if (!seg->write_header_trailer)
         seg->individual_header_trailer = 0;
 
+    if (seg->mux_async && !seg->individual_header_trailer) {
+        av_log(s, AV_LOG_ERROR,
+               "segment_mux_async requires individual_header_trailer\n");
+        return AVERROR(EINVAL);
+    }
+
     if (!!seg->time_str + !!seg->times_str + !!seg->frames_str > 1) {
         av_log(s, AV_LOG_ERROR,
                "segment_time, segment_times, and segment_frames options "
@@ -563,6 +662,10 @@ static int seg_write_header(AVFormatContext *s)
         }
     }
 
+    if (seg->async_queue_size &&
+        (ret = ff_ioqueue_alloc(&seg->io_queue, seg->async_queue_size, s)) < 0)
+        return ret;
+
     if (seg->list) {
         if (seg->list_type == LIST_TYPE_UNDEFINED) {
             if      (av_match_ext(seg->list, "csv" )) seg->list_type = LIST_TYPE_CSV;
@@ -604,7 +707,7 @@ static int seg_write_header(AVFormatContext *s)
         goto fail;
     seg->segment_count++;
 
-    if (seg->write_header_trailer) {
+    if (seg->write_header_trailer && !seg->mux_async) {
         if ((ret = avio_open2(&oc->pb, oc->filename, AVIO_FLAG_WRITE,
                               &s->interrupt_callback, NULL)) < 0)
             goto fail;
@@ -622,7 +725,19 @@ static int seg_write_header(AVFormatContext *s)
     if (oc->avoid_negative_ts > 0 && s->avoid_negative_ts < 0)
         s->avoid_negative_ts = 1;
 
-    if (!seg->write_header_trailer) {
+    if (seg->mux_async) {
+        /* The header was only written to check the parameters, each
+         * segment is muxed from scratch by segment_mux_job(). */
+        av_write_trailer(oc);
+        close_null_ctx(oc->pb);
+        oc->pb = NULL;
+        avformat_free_context(oc);
+        seg->avf = NULL;
+        if ((ret = segment_mux_init(s)) < 0)
+            goto fail;
+        av_strlcpy(seg->avf->filename, seg->cur_entry.filename,
+                   sizeof(seg->avf->filename));
+    } else if (!seg->write_header_trailer) {
         close_null_ctx(oc->pb);
         if ((ret = avio_open2(&oc->pb, oc->filename, AVIO_FLAG_WRITE,
                               &s->interrupt_callback, NULL)) < 0)
@@ -631,6 +746,7 @@ static int seg_write_header(AVFormatContext *s)
 
 fail:
     if (ret) {
+        ff_ioqueue_free(&seg->io_queue);
         if (seg->list)
             avio_close(seg->list_pb);
         if (seg->avf)
@@ -712,16 +828,34 @@ static int seg_write_packet(AVFormatContext *s, AVPacket *pkt)
                av_ts2str(pkt->dts), av_ts2timestr(pkt->dts, &st->time_base));
     }
 
-    ret = ff_write_chained(oc, pkt->stream_index, pkt, s);
+    if (seg->mux_async) {
+        AVPacketList *pktl = av_mallocz(sizeof(*pktl));
+        if (!pktl || (ret = av_copy_packet(&pktl->pkt, pkt)) < 0) {
+            av_free(pktl);
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+        if (seg->pkt_list_end)
+            seg->pkt_list_end->next = pktl;
+        else
+            seg->pkt_list = pktl;
+        seg->pkt_list_end = pktl;
+    } else {
+        ret = ff_write_chained(oc, pkt->stream_index, pkt, s);
+    }
 
 fail:
     if (pkt->stream_index == seg->reference_stream_index)
         seg->frame_count++;
 
     if (ret < 0) {
+        ff_ioqueue_free(&seg->io_queue);
         if (seg->list)
             avio_close(seg->list_pb);
-        avformat_free_context(oc);
+        free_pkt_list(seg->pkt_list);
+        seg->pkt_list = seg->pkt_list_end = NULL;
+        avformat_free_context(seg->avf);
+        seg->avf = NULL;
     }
 
     return ret;
@@ -733,7 +867,7 @@ static int seg_write_trailer(struct AVFormatContext *s)
     AVFormatContext *oc = seg->avf;
     SegmentListEntry *cur, *next;
 
-    int ret;
+    int ret, err;
     if (!seg->write_header_trailer) {
         if ((ret = segment_end(s, 0, 1)) < 0)
             goto fail;
@@ -744,6 +878,9 @@ static int seg_write_trailer(struct AVFormatContext *s)
         ret = segment_end(s, 1, 1);
     }
 fail:
+    err = ff_ioqueue_free(&seg->io_queue);
+    if (ret >= 0)
+        ret = err;
     if (seg->list)
         avio_close(seg->list_pb);
 
@@ -758,7 +895,8 @@ fail:
         cur = next;
     }
 
-    avformat_free_context(oc);
+    free_pkt_list(seg->pkt_list);
+    avformat_free_context(seg->avf);
     return ret;
 }
 
@@ -793,6 +931,8 @@ static const AVOption options[] = {
     { "individual_header_trailer", "write header/trailer to each segment", OFFSET(individual_header_trailer), AV_OPT_TYPE_INT, {.i64 = 1}, 0, 1, E },
     { "write_header_trailer", "write a header to the first segment and a trailer to the last one", OFFSET(write_header_trailer), AV_OPT_TYPE_INT, {.i64 = 1}, 0, 1, E },
     { "reset_timestamps", "reset timestamps at the begin of each segment", OFFSET(reset_timestamps), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1, E },
+    { "segment_async_queue", "set number of segment and list writes done in the background", OFFSET(async_queue_size), AV_OPT_TYPE_INT, {.i64 = 0}, 0, INT_MAX, E },
+    { "segment_mux_async", "mux each segment in the background once it is complete", OFFSET(mux_async), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1, E },
     { NULL },
 };
 
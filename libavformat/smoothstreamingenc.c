@@ -38,8 +38,6 @@
 #include "libavutil/intreadwrite.h"
 
 typedef struct {
-    char file[1024];
-    char infofile[1024];
     int64_t start_time, duration;
     int n;
     int64_t start_pos, size;
@@ -77,6 +75,13 @@ typedef struct {
     int nb_fragments;
 } SmoothStreamingContext;
 
+static void get_fragment_filenames(OutputStream *os, Fragment *frag,
+                                   char *file, char *infofile, int size)
+{
+    snprintf(file, size, "%s/Fragments(%s=%"PRIu64")", os->dirname, os->stream_type_tag, frag->start_time);
+    snprintf(infofile, size, "%s/FragmentInfo(%s=%"PRIu64")", os->dirname, os->stream_type_tag, frag->start_time);
+}
+
 static int ism_write(void *opaque, uint8_t *buf, int buf_size)
 {
     OutputStream *os = opaque;
@@ -118,9 +123,11 @@ static int64_t ism_seek(void *opaque, int64_t offset, int whence)
         if (offset >= frag->start_pos && offset < frag->start_pos + frag->size) {
             int ret;
             AVDictionary *opts = NULL;
+            char file[1024], infofile[1024];
+            get_fragment_filenames(os, frag, file, infofile, sizeof(file));
             os->tail_out = os->out;
             av_dict_set(&opts, "truncate", "0", 0);
-            ret = ffurl_open(&os->out, frag->file, AVIO_FLAG_READ_WRITE, &os->ctx->interrupt_callback, &opts);
+            ret = ffurl_open(&os->out, file, AVIO_FLAG_READ_WRITE, &os->ctx->interrupt_callback, &opts);
             av_dict_free(&opts);
             if (ret < 0) {
                 os->out = os->tail_out;
@@ -128,7 +135,7 @@ static int64_t ism_seek(void *opaque, int64_t offset, int whence)
                 return ret;
             }
             av_dict_set(&opts, "truncate", "0", 0);
-            ffurl_open(&os->out2, frag->infofile, AVIO_FLAG_READ_WRITE, &os->ctx->interrupt_callback, &opts);
+            ffurl_open(&os->out2, infofile, AVIO_FLAG_READ_WRITE, &os->ctx->interrupt_callback, &opts);
             av_dict_free(&opts);
             ffurl_seek(os->out, offset - frag->start_pos, SEEK_SET);
             if (os->out2)
@@ -399,14 +406,10 @@ fail:
     return ret;
 }
 
-static int parse_fragment(AVFormatContext *s, const char *filename, int64_t *start_ts, int64_t *duration, int64_t *moof_size, int64_t size)
+static int parse_fragment(AVIOContext *in, int64_t *start_ts, int64_t *duration, int64_t *moof_size, int64_t size)
 {
-    AVIOContext *in;
-    int ret;
+    int ret = AVERROR(EIO);
     uint32_t len;
-    if ((ret = avio_open2(&in, filename, AVIO_FLAG_READ, &s->interrupt_callback, NULL)) < 0)
-        return ret;
-    ret = AVERROR(EIO);
     *moof_size = avio_rb32(in);
     if (*moof_size < 8 || *moof_size > size)
         goto fail;
@@ -445,11 +448,10 @@ static int parse_fragment(AVFormatContext *s, const char *filename, int64_t *sta
         avio_seek(in, end, SEEK_SET);
     }
 fail:
-    avio_close(in);
     return ret;
 }
 
-static int add_fragment(OutputStream *os, const char *file, const char *infofile, int64_t start_time, int64_t duration, int64_t start_pos, int64_t size)
+static int add_fragment(OutputStream *os, int64_t start_time, int64_t duration, int64_t start_pos, int64_t size)
 {
     Fragment *frag;
     if (os->nb_fragments >= os->fragments_size) {
@@ -461,8 +463,6 @@ static int add_fragment(OutputStream *os, const char *file, const char *infofile
     frag = av_mallocz(sizeof(*frag));
     if (!frag)
         return AVERROR(ENOMEM);
-    av_strlcpy(frag->file, file, sizeof(frag->file));
-    av_strlcpy(frag->infofile, infofile, sizeof(frag->infofile));
     frag->start_time = start_time;
     frag->duration = duration;
     frag->start_pos = start_pos;
@@ -473,16 +473,14 @@ static int add_fragment(OutputStream *os, const char *file, const char *infofile
     return 0;
 }
 
-static int copy_moof(AVFormatContext *s, const char* infile, const char *outfile, int64_t size)
+static int copy_moof(AVFormatContext *s, AVIOContext *in, const char *outfile, int64_t size)
 {
-    AVIOContext *in, *out;
+    AVIOContext *out;
     int ret = 0;
-    if ((ret = avio_open2(&in, infile, AVIO_FLAG_READ, &s->interrupt_callback, NULL)) < 0)
-        return ret;
-    if ((ret = avio_open2(&out, outfile, AVIO_FLAG_WRITE, &s->interrupt_callback, NULL)) < 0) {
-        avio_close(in);
+    if (avio_seek(in, 0, SEEK_SET) < 0)
+        return AVERROR(EIO);
+    if ((ret = avio_open2(&out, outfile, AVIO_FLAG_WRITE, &s->interrupt_callback, NULL)) < 0)
         return ret;
-    }
     while (size > 0) {
         uint8_t buf[8192];
         int n = FFMIN(size, sizeof(buf));
@@ -496,7 +494,6 @@ static int copy_moof(AVFormatContext *s, const char* infile, const char *outfile
     }
     avio_flush(out);
     avio_close(out);
-    avio_close(in);
     return ret;
 }
 
@@ -510,6 +507,7 @@ static int ism_flush(AVFormatContext *s, int final)
         char filename[1024], target_filename[1024], header_filename[1024];
         int64_t start_pos = os->tail_pos, size;
         int64_t start_ts, duration, moof_size;
+        AVIOContext *in;
         if (!os->packets_written)
             continue;
 
@@ -527,13 +525,23 @@ static int ism_flush(AVFormatContext *s, int final)
         ffurl_close(os->out);
         os->out = NULL;
         size = os->tail_pos - start_pos;
-        if ((ret = parse_fragment(s, filename, &start_ts, &duration, &moof_size, size)) < 0)
+        /* the moof is parsed and copied to the fragment info file in one go */
+        if ((ret = avio_open2(&in, filename, AVIO_FLAG_READ, &s->interrupt_callback, NULL)) < 0)
             break;
-        snprintf(header_filename, sizeof(header_filename), "%s/FragmentInfo(%s=%"PRIu64")", os->dirname, os->stream_type_tag, start_ts);
-        snprintf(target_filename, sizeof(target_filename), "%s/Fragments(%s=%"PRIu64")", os->dirname, os->stream_type_tag, start_ts);
-        copy_moof(s, filename, header_filename, moof_size);
+        if ((ret = parse_fragment(in, &start_ts, &duration, &moof_size, size)) < 0) {
+            avio_close(in);
+            break;
+        }
+        if ((ret = add_fragment(os, start_ts, duration, start_pos, size)) < 0) {
+            avio_close(in);
+            break;
+        }
+        get_fragment_filenames(os, os->fragments[os->nb_fragments - 1],
+                               target_filename, header_filename,
+                               sizeof(target_filename));
+        copy_moof(s, in, header_filename, moof_size);
+        avio_close(in);
         rename(filename, target_filename);
-        add_fragment(os, target_filename, header_filename, start_ts, duration, start_pos, size);
     }
 
     if (c->window_size || (final && c->remove_at_exit)) {
@@ -545,8 +553,10 @@ static int ism_flush(AVFormatContext *s, int final)
                 remove = os->nb_fragments;
             if (remove > 0) {
                 for (j = 0; j < remove; j++) {
-                    unlink(os->fragments[j]->file);
-                    unlink(os->fragments[j]->infofile);
+                    char file[1024], infofile[1024];
+                    get_fragment_filenames(os, os->fragments[j], file, infofile, sizeof(file));
+                    unlink(file);
+                    unlink(infofile);
                     av_free(os->fragments[j]);
                 }
                 os->nb_fragments -= remove;
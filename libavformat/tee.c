@@ -20,17 +20,49 @@
  */
 
 
+#include "config.h"
 #include "libavutil/avutil.h"
 #include "libavutil/avstring.h"
+#include "libavutil/fifo.h"
 #include "libavutil/opt.h"
 #include "avformat.h"
 
+#if HAVE_THREADS
+#if HAVE_PTHREADS
+#include <pthread.h>
+#elif HAVE_OS2THREADS
+#include "compat/os2threads.h"
+#else
+#include "compat/w32pthreads.h"
+#endif
+#endif
+
 #define MAX_SLAVES 16
 
+typedef struct TeeSlave {
+    AVFormatContext *avf;
+    int queue_size;             /* 0 to write synchronously */
+    int drop;                   /* drop packets rather than block when the queue is full */
+
+#if HAVE_THREADS
+    /* Packets are rescaled to the slave time bases and queued to a thread
+     * writing them, so that a slow slave does not stall the others. */
+    AVFifoBuffer *queue;        /* AVPackets; NULL when not threaded */
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int eof;                    /* no more packets will be queued */
+    int error;                  /* first error returned by the slave muxer */
+    uint8_t *need_key;          /* per stream: drop until the next keyframe */
+    int dropping;
+    unsigned nb_dropped;
+#endif
+} TeeSlave;
+
 typedef struct TeeContext {
     const AVClass *class;
     unsigned nb_slaves;
-    AVFormatContext *slaves[MAX_SLAVES];
+    TeeSlave slaves[MAX_SLAVES];
 } TeeContext;
 
 static const char *const slave_delim     = "|";
@@ -82,7 +114,132 @@ fail:
     return ret;
 }
 
-static int open_slave(AVFormatContext *avf, char *slave, AVFormatContext **ravf)
+#if HAVE_THREADS
+static void *slave_thread(void *arg)
+{
+    TeeSlave *tee_slave = arg;
+    AVPacket pkt;
+    int ret;
+
+    pthread_mutex_lock(&tee_slave->mutex);
+    for (;;) {
+        while (!av_fifo_size(tee_slave->queue) && !tee_slave->eof)
+            pthread_cond_wait(&tee_slave->cond, &tee_slave->mutex);
+        if (!av_fifo_size(tee_slave->queue))
+            break;
+        av_fifo_generic_read(tee_slave->queue, &pkt, sizeof(pkt), NULL);
+        pthread_cond_signal(&tee_slave->cond);
+
+        if (tee_slave->error) {
+            av_free_packet(&pkt);
+            continue;
+        }
+        pthread_mutex_unlock(&tee_slave->mutex);
+        ret = av_interleaved_write_frame(tee_slave->avf, &pkt);
+        pthread_mutex_lock(&tee_slave->mutex);
+        if (ret < 0)
+            tee_slave->error = ret;
+    }
+    pthread_mutex_unlock(&tee_slave->mutex);
+
+    return NULL;
+}
+
+static int start_slave_thread(TeeSlave *tee_slave)
+{
+    int ret;
+
+    tee_slave->queue    = av_fifo_alloc(tee_slave->queue_size * sizeof(AVPacket));
+    tee_slave->need_key = av_mallocz(tee_slave->avf->nb_streams);
+    if (!tee_slave->queue || !tee_slave->need_key) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+    pthread_mutex_init(&tee_slave->mutex, NULL);
+    pthread_cond_init(&tee_slave->cond, NULL);
+    if ((ret = pthread_create(&tee_slave->thread, NULL, slave_thread, tee_slave))) {
+        pthread_mutex_destroy(&tee_slave->mutex);
+        pthread_cond_destroy(&tee_slave->cond);
+        ret = AVERROR(ret);
+        goto fail;
+    }
+    return 0;
+
+fail:
+    av_fifo_free(tee_slave->queue);
+    tee_slave->queue = NULL;
+    av_freep(&tee_slave->need_key);
+    return ret;
+}
+
+/* Let the thread of the slave write its queued packets and exit. */
+static void stop_slave_thread(TeeSlave *tee_slave)
+{
+    AVPacket pkt;
+
+    if (!tee_slave->queue)
+        return;
+
+    pthread_mutex_lock(&tee_slave->mutex);
+    tee_slave->eof = 1;
+    pthread_cond_signal(&tee_slave->cond);
+    pthread_mutex_unlock(&tee_slave->mutex);
+    pthread_join(tee_slave->thread, NULL);
+
+    while (av_fifo_size(tee_slave->queue)) {
+        av_fifo_generic_read(tee_slave->queue, &pkt, sizeof(pkt), NULL);
+        av_free_packet(&pkt);
+    }
+    av_fifo_free(tee_slave->queue);
+    tee_slave->queue = NULL;
+    av_freep(&tee_slave->need_key);
+    pthread_mutex_destroy(&tee_slave->mutex);
+    pthread_cond_destroy(&tee_slave->cond);
+}
+
+/* Queue pkt for the thread of the slave, which takes ownership of it. */
+static int queue_slave_packet(AVFormatContext *avf, TeeSlave *tee_slave,
+                              AVPacket *pkt)
+{
+    int ret;
+
+    pthread_mutex_lock(&tee_slave->mutex);
+    if ((ret = tee_slave->error) < 0)
+        goto drop;
+
+    if (tee_slave->need_key[pkt->stream_index]) {
+        if (!(pkt->flags & AV_PKT_FLAG_KEY))
+            goto drop;
+        tee_slave->need_key[pkt->stream_index] = 0;
+    }
+    if (!av_fifo_space(tee_slave->queue) && tee_slave->drop) {
+        /* restart every stream on a keyframe to avoid decoding errors */
+        memset(tee_slave->need_key, 1, tee_slave->avf->nb_streams);
+        if (!tee_slave->dropping)
+            av_log(avf, AV_LOG_WARNING, "Slave '%s': queue full, dropping packets\n",
+                   tee_slave->avf->filename);
+        tee_slave->dropping = 1;
+        goto drop;
+    }
+    while (!av_fifo_space(tee_slave->queue))
+        pthread_cond_wait(&tee_slave->cond, &tee_slave->mutex);
+
+    tee_slave->dropping = 0;
+    av_fifo_generic_write(tee_slave->queue, pkt, sizeof(*pkt), NULL);
+    pthread_cond_signal(&tee_slave->cond);
+    pthread_mutex_unlock(&tee_slave->mutex);
+    return 0;
+
+drop:
+    if (!ret)
+        tee_slave->nb_dropped++;
+    pthread_mutex_unlock(&tee_slave->mutex);
+    av_free_packet(pkt);
+    return ret;
+}
+#endif
+
+static int open_slave(AVFormatContext *avf, char *slave, TeeSlave *tee_slave)
 {
     int i, ret;
     AVDictionary *options = NULL;
@@ -99,6 +256,25 @@ static int open_slave(AVFormatContext *avf, char *slave, AVFormatContext **ravf)
         entry->value = NULL; /* prevent it from being freed */
         av_dict_set(&options, "f", NULL, 0);
     }
+    if ((entry = av_dict_get(options, "queue_size", NULL, 0))) {
+        tee_slave->queue_size = strtol(entry->value, NULL, 10);
+        av_dict_set(&options, "queue_size", NULL, 0);
+        if (!HAVE_THREADS && tee_slave->queue_size > 0)
+            av_log(avf, AV_LOG_WARNING,
+                   "Slave '%s': 'queue_size' option was set but it is not supported "
+                   "on this build (thread support is required)\n", slave);
+    }
+    if ((entry = av_dict_get(options, "overflow", NULL, 0))) {
+        if (!strcmp(entry->value, "drop")) {
+            tee_slave->drop = 1;
+        } else if (strcmp(entry->value, "block")) {
+            av_log(avf, AV_LOG_ERROR, "Slave '%s': invalid overflow policy '%s'\n",
+                   slave, entry->value);
+            ret = AVERROR(EINVAL);
+            goto fail;
+        }
+        av_dict_set(&options, "overflow", NULL, 0);
+    }
 
     ret = avformat_alloc_output_context2(&avf2, NULL, format, filename);
     if (ret < 0)
@@ -146,7 +322,11 @@ static int open_slave(AVFormatContext *avf, char *slave, AVFormatContext **ravf)
         goto fail;
     }
 
-    *ravf = avf2;
+    tee_slave->avf = avf2;
+#if HAVE_THREADS
+    if (tee_slave->queue_size > 0 && (ret = start_slave_thread(tee_slave)) < 0)
+        return ret;
+#endif
     return 0;
 
 fail:
@@ -161,11 +341,15 @@ static void close_slaves(AVFormatContext *avf)
     unsigned i;
 
     for (i = 0; i < tee->nb_slaves; i++) {
-        avf2 = tee->slaves[i];
+#if HAVE_THREADS
+        stop_slave_thread(&tee->slaves[i]);
+#endif
+        if (!(avf2 = tee->slaves[i].avf))
+            continue;
         avio_close(avf2->pb);
         avf2->pb = NULL;
         avformat_free_context(avf2);
-        tee->slaves[i] = NULL;
+        tee->slaves[i].avf = NULL;
     }
 }
 
@@ -193,8 +377,10 @@ static int tee_write_header(AVFormatContext *avf)
     }
 
     for (i = 0; i < nb_slaves; i++) {
-        if ((ret = open_slave(avf, slaves[i], &tee->slaves[i])) < 0)
+        if ((ret = open_slave(avf, slaves[i], &tee->slaves[i])) < 0) {
+            tee->nb_slaves = i + 1;
             goto fail;
+        }
         av_freep(&slaves[i]);
     }
 
@@ -216,7 +402,17 @@ static int tee_write_trailer(AVFormatContext *avf)
     unsigned i;
 
     for (i = 0; i < tee->nb_slaves; i++) {
-        avf2 = tee->slaves[i];
+        avf2 = tee->slaves[i].avf;
+#if HAVE_THREADS
+        if (tee->slaves[i].queue) {
+            stop_slave_thread(&tee->slaves[i]);
+            if (tee->slaves[i].nb_dropped)
+                av_log(avf, AV_LOG_WARNING, "Slave '%s': %u packets dropped\n",
+                       avf2->filename, tee->slaves[i].nb_dropped);
+            if ((ret = tee->slaves[i].error) < 0 && !ret_all)
+                ret_all = ret;
+        }
+#endif
         if ((ret = av_write_trailer(avf2)) < 0)
             if (!ret_all)
                 ret_all = ret;
@@ -235,34 +431,43 @@ static int tee_write_packet(AVFormatContext *avf, AVPacket *pkt)
 {
     TeeContext *tee = avf->priv_data;
     AVFormatContext *avf2;
-    AVPacket pkt2;
+    AVPacket ref, pkt2;
     int ret_all = 0, ret;
     unsigned i, s;
     AVRational tb, tb2;
 
+    /* make the data refcounted once, the slaves only get references to it */
+    if ((ret = av_copy_packet(&ref, pkt)) < 0)
+        return ret;
+
     for (i = 0; i < tee->nb_slaves; i++) {
-        avf2 = tee->slaves[i];
+        avf2 = tee->slaves[i].avf;
         s = pkt->stream_index;
         if (s >= avf2->nb_streams) {
             if (!ret_all)
                 ret_all = AVERROR(EINVAL);
             continue;
         }
-        if ((ret = av_copy_packet(&pkt2, pkt)) < 0 ||
-            (ret = av_dup_packet(&pkt2))< 0)
-            if (!ret_all) {
-                ret = ret_all;
-                continue;
-            }
+        if ((ret = av_copy_packet(&pkt2, &ref)) < 0) {
+            if (!ret_all)
+                ret_all = ret;
+            continue;
+        }
         tb  = avf ->streams[s]->time_base;
         tb2 = avf2->streams[s]->time_base;
         pkt2.pts      = av_rescale_q(pkt->pts,      tb, tb2);
         pkt2.dts      = av_rescale_q(pkt->dts,      tb, tb2);
         pkt2.duration = av_rescale_q(pkt->duration, tb, tb2);
-        if ((ret = av_interleaved_write_frame(avf2, &pkt2)) < 0)
-            if (!ret_all)
-                ret_all = ret;
+#if HAVE_THREADS
+        if (tee->slaves[i].queue)
+            ret = queue_slave_packet(avf, &tee->slaves[i], &pkt2);
+        else
+#endif
+        ret = av_interleaved_write_frame(avf2, &pkt2);
+        if (ret < 0 && !ret_all)
+            ret_all = ret;
     }
+    av_free_packet(&ref);
     return ret_all;
 }
 
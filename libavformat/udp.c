@@ -25,11 +25,13 @@
  */
 
 #define _BSD_SOURCE     /* Needed for using struct ip_mreq with recent glibc */
+#define _GNU_SOURCE     /* Needed for recvmmsg() and sendmmsg() */
 
 #include "avformat.h"
 #include "avio_internal.h"
 #include "libavutil/parseutils.h"
-#include "libavutil/fifo.h"
+#include "libavutil/atomic.h"
+#include "libavutil/spsc_fifo.h"
 #include "libavutil/intreadwrite.h"
 #include "libavutil/avstring.h"
 #include "libavutil/opt.h"
@@ -55,6 +57,14 @@
 
 #define UDP_TX_BUF_SIZE 32768
 #define UDP_MAX_PKT_SIZE 65536
+#define UDP_MAX_AUTO_RX_BUF_SIZE (8 * 1024 * 1024)
+
+#if HAVE_PTHREAD_CANCEL && HAVE_RECVMMSG
+#define UDP_RECV_BATCH 16
+#else
+#define UDP_RECV_BATCH 1
+#endif
+#define UDP_SEND_BATCH 16
 
 typedef struct {
     const AVClass *class;
@@ -71,19 +81,31 @@ typedef struct {
 
     /* Circular Buffer variables for use in UDP receive code */
     int circular_buffer_size;
-    AVFifoBuffer *fifo;
+    FFSPSCFifo *fifo;
     int circular_buffer_error;
 #if HAVE_PTHREAD_CANCEL
     pthread_t circular_buffer_thread;
-    pthread_mutex_t mutex;
-    pthread_cond_t cond;
     int thread_started;
+    int close_req;
+#endif
+#if HAVE_PTHREAD_CANCEL && HAVE_RECVMMSG
+    /* datagrams received together by the circular buffer thread */
+    struct mmsghdr recv_msgs[UDP_RECV_BATCH];
+    struct iovec recv_iov[UDP_RECV_BATCH];
+    uint8_t *recv_buf;
+#endif
+#if HAVE_PTHREAD_CANCEL
+    uint8_t *send_buf;     ///< datagrams sent together by the pacing thread
+    int send_slot_size;
+    int no_sendmmsg;
 #endif
     uint8_t tmp[UDP_MAX_PKT_SIZE+4];
     int remaining_in_dg;
     char *local_addr;
     int packet_size;
     int timeout;
+    int64_t bitrate;       ///< rate at which the output is paced, in bits per second
+    int64_t burst_bits;
 } UDPContext;
 
 #define OFFSET(x) offsetof(UDPContext, x)
@@ -98,7 +120,9 @@ static const AVOption options[] = {
 {"ttl", "Set the time to live value (for multicast only)", OFFSET(ttl), AV_OPT_TYPE_INT, {.i64 = 16}, 0, INT_MAX, E },
 {"connect", "Should connect() be called on socket", OFFSET(is_connected), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1, D|E },
 /* TODO 'sources', 'block' option */
-{"fifo_size", "Set the UDP receiving circular buffer size, expressed as a number of packets with size of 188 bytes", OFFSET(circular_buffer_size), AV_OPT_TYPE_INT, {.i64 = 7*4096}, 0, INT_MAX, D },
+{"fifo_size", "Set the UDP circular buffer size, expressed as a number of packets with size of 188 bytes", OFFSET(circular_buffer_size), AV_OPT_TYPE_INT, {.i64 = 7*4096}, 0, INT_MAX, D|E },
+{"bitrate", "Pace the output at this rate, in bits per second", OFFSET(bitrate), AV_OPT_TYPE_INT64, {.i64 = 0}, 0, INT64_MAX, E },
+{"burst_bits", "Maximum number of bits sent in a burst when pacing the output", OFFSET(burst_bits), AV_OPT_TYPE_INT64, {.i64 = 0}, 0, INT64_MAX, E },
 {"overrun_nonfatal", "Survive in case of UDP receiving circular buffer overrun", OFFSET(overrun_nonfatal), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1, D },
 {"timeout", "In read mode: if no data arrived in more than this time interval, raise error", OFFSET(timeout), AV_OPT_TYPE_INT, {.i64 = 0}, 0, INT_MAX, D },
 {NULL}
@@ -436,60 +460,225 @@ static int udp_get_file_handle(URLContext *h)
 }
 
 #if HAVE_PTHREAD_CANCEL
+/**
+ * Receive as many datagrams as available, waiting for at least one.
+ * @return number of datagrams, or a negative value on error
+ */
+static int recv_datagrams(UDPContext *s, uint8_t **bufs, int *lens)
+{
+    int n;
+
+#if HAVE_RECVMMSG
+    if (s->recv_buf) {
+        int i;
+
+        n = recvmmsg(s->udp_fd, s->recv_msgs, UDP_RECV_BATCH, MSG_WAITFORONE, NULL);
+        if (n >= 0 || errno != ENOSYS) {
+            for (i = 0; i < n; i++) {
+                bufs[i] = s->recv_iov[i].iov_base;
+                lens[i] = s->recv_msgs[i].msg_len;
+            }
+            return n;
+        }
+        /* not supported by the kernel */
+        av_freep(&s->recv_buf);
+    }
+#endif
+    bufs[0] = s->tmp;
+    n = lens[0] = recv(s->udp_fd, s->tmp, sizeof(s->tmp), 0);
+    return n < 0 ? n : 1;
+}
+
 static void *circular_buffer_task( void *_URLContext)
 {
     URLContext *h = _URLContext;
     UDPContext *s = h->priv_data;
-    int old_cancelstate;
+    int old_cancelstate, err = 0;
 
     pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_cancelstate);
-    pthread_mutex_lock(&s->mutex);
     if (ff_socket_nonblock(s->udp_fd, 0) < 0) {
         av_log(h, AV_LOG_ERROR, "Failed to set blocking mode");
-        s->circular_buffer_error = AVERROR(EIO);
+        err = AVERROR(EIO);
         goto end;
     }
     while(1) {
-        int len;
+        uint8_t *bufs[UDP_RECV_BATCH];
+        int lens[UDP_RECV_BATCH];
+        int i, n, space;
 
-        pthread_mutex_unlock(&s->mutex);
         /* Blocking operations are always cancellation points;
            see "General Information" / "Thread Cancelation Overview"
            in Single Unix. */
         pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &old_cancelstate);
-        len = recv(s->udp_fd, s->tmp+4, sizeof(s->tmp)-4, 0);
+        n = recv_datagrams(s, bufs, lens);
         pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_cancelstate);
-        pthread_mutex_lock(&s->mutex);
-        if (len < 0) {
+        if (n < 0) {
             if (ff_neterrno() != AVERROR(EAGAIN) && ff_neterrno() != AVERROR(EINTR)) {
-                s->circular_buffer_error = ff_neterrno();
+                err = ff_neterrno();
                 goto end;
             }
             continue;
         }
-        AV_WL32(s->tmp, len);
 
-        if(av_fifo_space(s->fifo) < len + 4) {
-            /* No Space left */
-            if (s->overrun_nonfatal) {
-                av_log(h, AV_LOG_WARNING, "Circular buffer overrun. "
-                        "Surviving due to overrun_nonfatal option\n");
-                continue;
-            } else {
-                av_log(h, AV_LOG_ERROR, "Circular buffer overrun. "
-                        "To avoid, increase fifo_size URL option. "
-                        "To survive in such case, use overrun_nonfatal option\n");
-                s->circular_buffer_error = AVERROR(EIO);
-                goto end;
+        space = avpriv_spsc_fifo_space(s->fifo);
+        for (i = 0; i < n; i++) {
+            uint8_t len[4];
+
+            if (space < lens[i] + 4)
+                space = avpriv_spsc_fifo_space(s->fifo);
+            if (space < lens[i] + 4) {
+                /* No Space left */
+                if (s->overrun_nonfatal) {
+                    av_log(h, AV_LOG_WARNING, "Circular buffer overrun. "
+                            "Surviving due to overrun_nonfatal option\n");
+                    continue;
+                } else {
+                    av_log(h, AV_LOG_ERROR, "Circular buffer overrun. "
+                            "To avoid, increase fifo_size URL option. "
+                            "To survive in such case, use overrun_nonfatal option\n");
+                    err = AVERROR(EIO);
+                    goto end;
+                }
             }
+            AV_WL32(len, lens[i]);
+            avpriv_spsc_fifo_write(s->fifo, len, 4);
+            avpriv_spsc_fifo_write(s->fifo, bufs[i], lens[i]);
+            space -= lens[i] + 4;
         }
-        av_fifo_generic_write(s->fifo, s->tmp, len+4, NULL);
-        pthread_cond_signal(&s->cond);
+        /* one release store for the whole batch, no lock taken unless
+           udp_read() is waiting */
+        avpriv_spsc_fifo_publish(s->fifo);
     }
 
 end:
-    pthread_cond_signal(&s->cond);
-    pthread_mutex_unlock(&s->mutex);
+    avpriv_spsc_fifo_publish(s->fifo);
+    avpriv_atomic_int_set(&s->circular_buffer_error, err);
+    avpriv_spsc_fifo_wake(s->fifo);
+    return NULL;
+}
+
+static int send_datagrams(UDPContext *s, uint8_t **bufs, int *lens, int n)
+{
+    struct sockaddr *dest_addr = s->is_connected ? NULL : (struct sockaddr *)&s->dest_addr;
+    int i, ret;
+
+#if HAVE_SENDMMSG
+    if (!s->no_sendmmsg) {
+        struct mmsghdr msgs[UDP_SEND_BATCH];
+        struct iovec iov[UDP_SEND_BATCH];
+
+        memset(msgs, 0, n * sizeof(*msgs));
+        for (i = 0; i < n; i++) {
+            iov[i].iov_base = bufs[i];
+            iov[i].iov_len  = lens[i];
+            msgs[i].msg_hdr.msg_name    = dest_addr;
+            msgs[i].msg_hdr.msg_namelen = dest_addr ? s->dest_addr_len : 0;
+            msgs[i].msg_hdr.msg_iov     = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen  = 1;
+        }
+        for (i = 0; i < n; i += ret) {
+            ret = sendmmsg(s->udp_fd, msgs + i, n - i, 0);
+            if (ret < 0) {
+                if (ff_neterrno() == AVERROR(EINTR)) {
+                    ret = 0;
+                    continue;
+                }
+                if (errno != ENOSYS)
+                    return ff_neterrno();
+                /* not supported by the kernel */
+                s->no_sendmmsg = 1;
+                break;
+            }
+        }
+        if (i == n)
+            return 0;
+        bufs += i;
+        lens += i;
+        n    -= i;
+    }
+#endif
+    for (i = 0; i < n; i++) {
+        if (dest_addr)
+            ret = sendto(s->udp_fd, bufs[i], lens[i], 0, dest_addr, s->dest_addr_len);
+        else
+            ret = send(s->udp_fd, bufs[i], lens[i], 0);
+        if (ret < 0) {
+            if (ff_neterrno() == AVERROR(EINTR)) {
+                i--;
+                continue;
+            }
+            return ff_neterrno();
+        }
+    }
+    return 0;
+}
+
+/**
+ * Send the datagrams queued by udp_write() at the configured bitrate,
+ * allowing bursts of burst_bits, or of one datagram if it is larger.
+ */
+static void *circular_buffer_task_tx(void *_URLContext)
+{
+    URLContext *h = _URLContext;
+    UDPContext *s = h->priv_data;
+    int64_t burst = FFMAX(s->burst_bits, 8LL * s->send_slot_size);
+    int64_t tokens = 0, last = av_gettime();
+    int next_len = -1;
+
+    if (ff_socket_nonblock(s->udp_fd, 0) < 0)
+        av_log(h, AV_LOG_WARNING, "Failed to set blocking mode\n");
+
+    for (;;) {
+        uint8_t *bufs[UDP_SEND_BATCH];
+        int lens[UDP_SEND_BATCH];
+        int n = 0, ret;
+        int64_t now;
+
+        if (next_len < 0 && !avpriv_spsc_fifo_size(s->fifo)) {
+            if (avpriv_atomic_int_get(&s->close_req))
+                break;
+            avpriv_spsc_fifo_wait_size(s->fifo, 1, -1);
+            continue;
+        }
+
+        now    = av_gettime();
+        tokens = FFMIN(tokens + (now - last) * s->bitrate / 1000000, burst);
+        last   = now;
+        while (n < UDP_SEND_BATCH) {
+            if (next_len < 0) {
+                uint8_t len[4];
+                if (!avpriv_spsc_fifo_size(s->fifo))
+                    break;
+                avpriv_spsc_fifo_read(s->fifo, len, 4);
+                next_len = AV_RL32(len);
+            }
+            if (8LL * next_len > tokens)
+                break;
+            tokens -= 8LL * next_len;
+            bufs[n] = s->send_buf + n * s->send_slot_size;
+            lens[n] = next_len;
+            avpriv_spsc_fifo_read(s->fifo, bufs[n], next_len);
+            next_len = -1;
+            n++;
+        }
+        if (!n) {
+            int64_t wait = (8LL * next_len - tokens) * 1000000 / s->bitrate;
+
+            avpriv_spsc_fifo_release(s->fifo);
+            av_usleep(FFMAX(wait, 1));
+            continue;
+        }
+        /* there is room for udp_write() again */
+        avpriv_spsc_fifo_release(s->fifo);
+
+        ret = send_datagrams(s, bufs, lens, n);
+        if (ret < 0) {
+            avpriv_atomic_int_set(&s->circular_buffer_error, ret);
+            break;
+        }
+    }
+    avpriv_spsc_fifo_wake(s->fifo);
+
     return NULL;
 }
 #endif
@@ -513,8 +702,6 @@ static int udp_open(URLContext *h, const char *uri, int flags)
     h->is_streamed = 1;
 
     is_output = !(flags & AVIO_FLAG_READ);
-    if (!s->buffer_size) /* if not set explicitly */
-        s->buffer_size = is_output ? UDP_TX_BUF_SIZE : UDP_MAX_PKT_SIZE;
 
     p = strchr(uri, '?');
     if (p) {
@@ -583,9 +770,29 @@ static int udp_open(URLContext *h, const char *uri, int flags)
         }
         if (!is_output && av_find_info_tag(buf, sizeof(buf), "timeout", p))
             s->timeout = strtol(buf, NULL, 10);
+        if (is_output && av_find_info_tag(buf, sizeof(buf), "bitrate", p)) {
+            s->bitrate = strtoll(buf, NULL, 10);
+            if (!HAVE_PTHREAD_CANCEL)
+                av_log(h, AV_LOG_WARNING,
+                       "'bitrate' option was set but it is not supported "
+                       "on this build (pthread support is required)\n");
+        }
+        if (is_output && av_find_info_tag(buf, sizeof(buf), "burst_bits", p))
+            s->burst_bits = strtoll(buf, NULL, 10);
     }
     /* handling needed to support options picking from both AVOption and URL */
     s->circular_buffer_size *= 188;
+    if (!s->buffer_size) { /* if not set explicitly */
+        if (is_output)
+            s->buffer_size = UDP_TX_BUF_SIZE;
+        else if (HAVE_PTHREAD_CANCEL && s->circular_buffer_size)
+            /* let the kernel absorb the bursts received while the circular
+             * buffer thread is not running */
+            s->buffer_size = av_clip(s->circular_buffer_size, UDP_MAX_PKT_SIZE,
+                                     UDP_MAX_AUTO_RX_BUF_SIZE);
+        else
+            s->buffer_size = UDP_MAX_PKT_SIZE;
+    }
     h->max_packet_size = s->packet_size;
     h->rw_timeout = s->timeout;
 
@@ -676,6 +883,11 @@ static int udp_open(URLContext *h, const char *uri, int flags)
         if (setsockopt(udp_fd, SOL_SOCKET, SO_RCVBUF, &tmp, sizeof(tmp)) < 0) {
             log_net_error(h, AV_LOG_WARNING, "setsockopt(SO_RECVBUF)");
         }
+        len = sizeof(tmp);
+        if (!getsockopt(udp_fd, SOL_SOCKET, SO_RCVBUF, &tmp, &len) &&
+            tmp < s->buffer_size)
+            av_log(h, AV_LOG_VERBOSE, "Socket receive buffer limited to %d "
+                   "bytes instead of %d by the system\n", tmp, s->buffer_size);
         /* make the socket non-blocking */
         ff_socket_nonblock(udp_fd, 1);
     }
@@ -692,41 +904,50 @@ static int udp_open(URLContext *h, const char *uri, int flags)
     s->udp_fd = udp_fd;
 
 #if HAVE_PTHREAD_CANCEL
-    if (!is_output && s->circular_buffer_size) {
+    if ((!is_output || s->bitrate) && s->circular_buffer_size) {
         int ret;
 
-        /* start the task going */
-        s->fifo = av_fifo_alloc(s->circular_buffer_size);
-        ret = pthread_mutex_init(&s->mutex, NULL);
-        if (ret != 0) {
-            av_log(h, AV_LOG_ERROR, "pthread_mutex_init failed : %s\n", strerror(ret));
-            goto fail;
+        if (is_output) {
+            s->send_slot_size = s->packet_size ? s->packet_size : UDP_MAX_PKT_SIZE;
+            if (!(s->send_buf = av_malloc(UDP_SEND_BATCH * s->send_slot_size)))
+                goto fail;
         }
-        ret = pthread_cond_init(&s->cond, NULL);
-        if (ret != 0) {
-            av_log(h, AV_LOG_ERROR, "pthread_cond_init failed : %s\n", strerror(ret));
-            goto cond_fail;
+#if HAVE_RECVMMSG
+        else if ((s->recv_buf = av_malloc(UDP_RECV_BATCH * UDP_MAX_PKT_SIZE))) {
+            for (i = 0; i < UDP_RECV_BATCH; i++) {
+                s->recv_iov[i].iov_base = s->recv_buf + i * UDP_MAX_PKT_SIZE;
+                s->recv_iov[i].iov_len  = UDP_MAX_PKT_SIZE;
+                s->recv_msgs[i].msg_hdr.msg_iov    = &s->recv_iov[i];
+                s->recv_msgs[i].msg_hdr.msg_iovlen = 1;
+            }
         }
-        ret = pthread_create(&s->circular_buffer_thread, NULL, circular_buffer_task, h);
+#endif
+
+        /* start the task going */
+        s->fifo = avpriv_spsc_fifo_alloc(s->circular_buffer_size);
+        if (!s->fifo)
+            goto fail;
+        ret = pthread_create(&s->circular_buffer_thread, NULL,
+                             is_output ? circular_buffer_task_tx : circular_buffer_task, h);
         if (ret != 0) {
             av_log(h, AV_LOG_ERROR, "pthread_create failed : %s\n", strerror(ret));
-            goto thread_fail;
+            goto fail;
         }
         s->thread_started = 1;
     }
 #endif
 
     return 0;
-#if HAVE_PTHREAD_CANCEL
- thread_fail:
-    pthread_cond_destroy(&s->cond);
- cond_fail:
-    pthread_mutex_destroy(&s->mutex);
-#endif
  fail:
     if (udp_fd >= 0)
         closesocket(udp_fd);
-    av_fifo_free(s->fifo);
+    avpriv_spsc_fifo_freep(&s->fifo);
+#if HAVE_PTHREAD_CANCEL
+    av_freep(&s->send_buf);
+#if HAVE_RECVMMSG
+    av_freep(&s->recv_buf);
+#endif
+#endif
     for (i = 0; i < num_sources; i++)
         av_freep(&sources[i]);
     return AVERROR(EIO);
@@ -740,41 +961,29 @@ static int udp_read(URLContext *h, uint8_t *buf, int size)
 
 #if HAVE_PTHREAD_CANCEL
     if (s->fifo) {
-        pthread_mutex_lock(&s->mutex);
         do {
-            avail = av_fifo_size(s->fifo);
+            avail = avpriv_spsc_fifo_size(s->fifo);
             if (avail) { // >=size) {
                 uint8_t tmp[4];
 
-                av_fifo_generic_read(s->fifo, tmp, 4, NULL);
+                avpriv_spsc_fifo_read(s->fifo, tmp, 4);
                 avail= AV_RL32(tmp);
                 if(avail > size){
                     av_log(h, AV_LOG_WARNING, "Part of datagram lost due to insufficient buffer size\n");
                     avail= size;
                 }
 
-                av_fifo_generic_read(s->fifo, buf, avail, NULL);
-                av_fifo_drain(s->fifo, AV_RL32(tmp) - avail);
-                pthread_mutex_unlock(&s->mutex);
+                avpriv_spsc_fifo_read(s->fifo, buf, avail);
+                avpriv_spsc_fifo_read(s->fifo, NULL, AV_RL32(tmp) - avail);
+                avpriv_spsc_fifo_release(s->fifo);
                 return avail;
-            } else if(s->circular_buffer_error){
-                int err = s->circular_buffer_error;
-                pthread_mutex_unlock(&s->mutex);
-                return err;
+            } else if ((ret = avpriv_atomic_int_get(&s->circular_buffer_error))) {
+                return ret;
             } else if(nonblock) {
-                pthread_mutex_unlock(&s->mutex);
                 return AVERROR(EAGAIN);
             }
             else {
-                /* FIXME: using the monotonic clock would be better,
-                   but it does not exist on all supported platforms. */
-                int64_t t = av_gettime() + 100000;
-                struct timespec tv = { .tv_sec  =  t / 1000000,
-                                       .tv_nsec = (t % 1000000) * 1000 };
-                if (pthread_cond_timedwait(&s->cond, &s->mutex, &tv) < 0) {
-                    pthread_mutex_unlock(&s->mutex);
-                    return AVERROR(errno == ETIMEDOUT ? EAGAIN : errno);
-                }
+                avpriv_spsc_fifo_wait_size(s->fifo, 1, 100000);
                 nonblock = 1;
             }
         } while( 1);
@@ -796,6 +1005,30 @@ static int udp_write(URLContext *h, const uint8_t *buf, int size)
     UDPContext *s = h->priv_data;
     int ret;
 
+#if HAVE_PTHREAD_CANCEL
+    if (s->fifo) {
+        uint8_t len[4];
+
+        if (size > s->send_slot_size)
+            return AVERROR(EINVAL);
+
+        while (!(ret = avpriv_atomic_int_get(&s->circular_buffer_error)) &&
+               avpriv_spsc_fifo_space(s->fifo) < size + 4) {
+            if (h->flags & AVIO_FLAG_NONBLOCK)
+                return AVERROR(EAGAIN);
+            avpriv_spsc_fifo_wait_space(s->fifo, size + 4, -1);
+        }
+        if (ret >= 0) {
+            AV_WL32(len, size);
+            avpriv_spsc_fifo_write(s->fifo, len, 4);
+            avpriv_spsc_fifo_write(s->fifo, buf, size);
+            avpriv_spsc_fifo_publish(s->fifo);
+            ret = size;
+        }
+        return ret;
+    }
+#endif
+
     if (!(h->flags & AVIO_FLAG_NONBLOCK)) {
         ret = ff_network_wait_fd(s->udp_fd, 1);
         if (ret < 0)
@@ -819,18 +1052,26 @@ static int udp_close(URLContext *h)
 
     if (s->is_multicast && (h->flags & AVIO_FLAG_READ))
         udp_leave_multicast_group(s->udp_fd, (struct sockaddr *)&s->dest_addr);
-    closesocket(s->udp_fd);
 #if HAVE_PTHREAD_CANCEL
     if (s->thread_started) {
-        pthread_cancel(s->circular_buffer_thread);
+        if (h->flags & AVIO_FLAG_READ) {
+            pthread_cancel(s->circular_buffer_thread);
+        } else {
+            /* let the pacing thread send what is left */
+            avpriv_atomic_int_set(&s->close_req, 1);
+            avpriv_spsc_fifo_wake(s->fifo);
+        }
         ret = pthread_join(s->circular_buffer_thread, NULL);
         if (ret != 0)
             av_log(h, AV_LOG_ERROR, "pthread_join(): %s\n", strerror(ret));
-        pthread_mutex_destroy(&s->mutex);
-        pthread_cond_destroy(&s->cond);
     }
+    av_freep(&s->send_buf);
+#if HAVE_RECVMMSG
+    av_freep(&s->recv_buf);
 #endif
-    av_fifo_free(s->fifo);
+#endif
+    closesocket(s->udp_fd);
+    avpriv_spsc_fifo_freep(&s->fifo);
     return 0;
 }
 
@@ -26,6 +26,7 @@
 #include "libavcodec/raw.h"
 #include "libavcodec/bytestream.h"
 #include "libavutil/avassert.h"
+#include "libavutil/atomic.h"
 #include "libavutil/opt.h"
 #include "libavutil/dict.h"
 #include "libavutil/pixdesc.h"
@@ -35,6 +36,7 @@
 #include "libavutil/avstring.h"
 #include "libavutil/mathematics.h"
 #include "libavutil/parseutils.h"
+#include "libavutil/profile_internal.h"
 #include "libavutil/time.h"
 #include "libavutil/timestamp.h"
 #include "riff.h"
@@ -44,6 +46,9 @@
 #if CONFIG_NETWORK
 #include "network.h"
 #endif
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
 
 #undef NDEBUG
 #include <assert.h>
@@ -276,6 +281,62 @@ int ffio_limit(AVIOContext *s, int size)
     return size;
 }
 
+/* packet pools hold buffers of 1 << PACKET_POOL_MIN_BITS up to
+ * 1 << (PACKET_POOL_MIN_BITS + PACKET_POOL_CLASSES - 1) bytes */
+#define PACKET_POOL_MIN_BITS 9
+#define PACKET_POOL_CLASSES  12
+
+static AVBufferPool *packet_pools[PACKET_POOL_CLASSES];
+
+AVBufferRef *ff_packet_pool_get(int size)
+{
+    AVBufferPool *pool;
+    int bucket;
+
+    if (size <= 0)
+        return NULL;
+    bucket = FFMAX(av_log2(size - 1) + 1 - PACKET_POOL_MIN_BITS, 0);
+    if (bucket >= PACKET_POOL_CLASSES)
+        return NULL;
+
+    pool = packet_pools[bucket];
+    if (!pool) {
+        AVBufferPool *new_pool =
+            av_buffer_pool_init((1 << (bucket + PACKET_POOL_MIN_BITS)) +
+                                FF_INPUT_BUFFER_PADDING_SIZE, NULL);
+        if (!new_pool)
+            return NULL;
+        pool = avpriv_atomic_ptr_cas((void * volatile *)&packet_pools[bucket],
+                                     NULL, new_pool);
+        if (pool)
+            av_buffer_pool_uninit(&new_pool);
+        else
+            pool = new_pool;
+    }
+
+    return av_buffer_pool_get(pool);
+}
+
+/* Read into the pooled buffer already set in pkt->buf. */
+static int read_pooled_packet(AVIOContext *s, AVPacket *pkt, int size)
+{
+    int ret;
+
+    pkt->data = pkt->buf->data;
+
+    ret = avio_read(s, pkt->data, size);
+    if (ret <= 0) {
+        av_free_packet(pkt);
+        return ret;
+    }
+    if (ret < size)
+        pkt->flags |= AV_PKT_FLAG_CORRUPT;
+    pkt->size = ret;
+    memset(pkt->data + ret, 0, FF_INPUT_BUFFER_PADDING_SIZE);
+
+    return ret;
+}
+
 /*
  * Read the data in sane-sized chunks and append to pkt.
  * Return the number of bytes read or an error.
@@ -330,6 +391,9 @@ int av_get_packet(AVIOContext *s, AVPacket *pkt, int size)
     pkt->size = 0;
     pkt->pos  = avio_tell(s);
 
+    if (s->packet_pool && (pkt->buf = ff_packet_pool_get(size)))
+        return read_pooled_packet(s, pkt, size);
+
     return append_packet_chunked(s, pkt, size);
 }
 
@@ -347,7 +411,16 @@ int av_filename_number_test(const char *filename)
     return filename && (av_get_frame_filename(buf, sizeof(buf), filename, 1)>=0);
 }
 
-AVInputFormat *av_probe_input_format3(AVProbeData *pd, int is_opened, int *score_ret)
+/**
+ * Probe the demuxers, or with hint_only only the ones matching the file name
+ * extension and the ones in hint_fmts, which can be NULL.
+ *
+ * @param nb_probes incremented by the number of demuxers probed
+ */
+static AVInputFormat *probe_input_format(AVProbeData *pd, int is_opened,
+                                         int *score_ret, int hint_only,
+                                         AVInputFormat *hint_fmts[2],
+                                         int *nb_probes)
 {
     AVProbeData lpd = *pd;
     AVInputFormat *fmt1 = NULL, *fmt;
@@ -370,9 +443,13 @@ AVInputFormat *av_probe_input_format3(AVProbeData *pd, int is_opened, int *score
     while ((fmt1 = av_iformat_next(fmt1))) {
         if (!is_opened == !(fmt1->flags & AVFMT_NOFILE))
             continue;
+        if (hint_only && fmt1 != hint_fmts[0] && fmt1 != hint_fmts[1] &&
+            !(fmt1->extensions && av_match_ext(lpd.filename, fmt1->extensions)))
+            continue;
         score = 0;
         if (fmt1->read_probe) {
             score = fmt1->read_probe(&lpd);
+            (*nb_probes)++;
             if(fmt1->extensions && av_match_ext(lpd.filename, fmt1->extensions))
                 score = FFMAX(score, nodat ? AVPROBE_SCORE_EXTENSION / 2 - 1 : 1);
         } else if (fmt1->extensions) {
@@ -393,6 +470,12 @@ AVInputFormat *av_probe_input_format3(AVProbeData *pd, int is_opened, int *score
     return fmt;
 }
 
+AVInputFormat *av_probe_input_format3(AVProbeData *pd, int is_opened, int *score_ret)
+{
+    int nb_probes = 0;
+    return probe_input_format(pd, is_opened, score_ret, 0, NULL, &nb_probes);
+}
+
 AVInputFormat *av_probe_input_format2(AVProbeData *pd, int is_opened, int *score_max)
 {
     int score_ret;
@@ -473,7 +556,10 @@ int av_probe_input_buffer(AVIOContext *pb, AVInputFormat **fmt,
     AVProbeData pd = { filename ? filename : "", NULL, -offset };
     unsigned char *buf = NULL;
     uint8_t *mime_type;
-    int ret = 0, probe_size, buf_offset = 0;
+    AVInputFormat *hint_fmts[2] = { NULL };
+    AVOutputFormat *ofmt;
+    int ret = 0, probe_size, buf_offset = 0, nb_probes = 0;
+    int64_t probe_time = av_gettime();
 
     if (!max_probe_size) {
         max_probe_size = PROBE_BUF_MAX;
@@ -492,9 +578,16 @@ int av_probe_input_buffer(AVIOContext *pb, AVInputFormat **fmt,
     if (!*fmt && pb->av_class && av_opt_get(pb, "mime_type", AV_OPT_SEARCH_CHILDREN, &mime_type) >= 0 && mime_type) {
         if (!av_strcasecmp(mime_type, "audio/aacp")) {
             *fmt = av_find_input_format("aac");
+        } else if ((ofmt = av_guess_format(NULL, NULL, mime_type))) {
+            hint_fmts[0] = av_find_input_format(ofmt->name);
         }
         av_freep(&mime_type);
     }
+    /* the demuxers of the common formats have no extensions, as they are
+     * always detected, so use the ones of the muxers */
+    if (!*fmt && pd.filename[0] &&
+        (ofmt = av_guess_format(NULL, pd.filename, NULL)))
+        hint_fmts[1] = av_find_input_format(ofmt->name);
 
     for(probe_size= PROBE_BUF_MIN; probe_size<=max_probe_size && !*fmt;
         probe_size = FFMIN(probe_size<<1, FFMAX(max_probe_size, probe_size+1))) {
@@ -526,13 +619,33 @@ int av_probe_input_buffer(AVIOContext *pb, AVInputFormat **fmt,
 
         memset(pd.buf + pd.buf_size, 0, AVPROBE_PADDING_SIZE);
 
-        /* guess file format */
-        *fmt = av_probe_input_format2(&pd, 1, &score);
+        /* guess file format, trying the demuxers matching the file name or
+         * the MIME type first, as no other one can beat a maximal score */
+        if (pd.filename[0] || hint_fmts[0]) {
+            int hint_score;
+            AVInputFormat *hint = probe_input_format(&pd, 1, &hint_score, 1,
+                                                     hint_fmts, &nb_probes);
+            if (hint && hint_score >= AVPROBE_SCORE_MAX) {
+                *fmt  = hint;
+                score = hint_score;
+            }
+        }
+        if (!*fmt) {
+            int probe_score;
+            *fmt = probe_input_format(&pd, 1, &probe_score, 0, NULL,
+                                      &nb_probes);
+            if (probe_score > score)
+                score = probe_score;
+            else
+                *fmt = NULL;
+        }
         if(*fmt){
             if(score <= AVPROBE_SCORE_RETRY){ //this can only be true in the last iteration
                 av_log(logctx, AV_LOG_WARNING, "Format %s detected only with low score of %d, misdetection possible!\n", (*fmt)->name, score);
             }else
                 av_log(logctx, AV_LOG_DEBUG, "Format %s probed with size=%d and score=%d\n", (*fmt)->name, probe_size, score);
+            av_log(logctx, AV_LOG_DEBUG, "Probing called %d demuxer probe functions in %"PRId64" us\n",
+                   nb_probes, av_gettime() - probe_time);
         }
     }
 
@@ -634,6 +747,8 @@ int avformat_open_input(AVFormatContext **ps, const char *filename, AVInputForma
     if ((ret = init_input(s, filename, &tmp)) < 0)
         goto fail;
     avio_skip(s->pb, s->skip_initial_bytes);
+    if (s->pb && (s->flags & AVFMT_FLAG_PKT_POOL))
+        s->pb->packet_pool = 1;
 
     /* check filename in case an image number is expected */
     if (s->iformat->flags & AVFMT_NEEDNUMBER) {
@@ -1391,6 +1506,19 @@ static int parse_packet(AVFormatContext *s, AVPacket *pkt, int stream_index)
             out_pkt.destruct = pkt->destruct;
             pkt->destruct = NULL;
 #endif
+        } else if (pkt->buf && out_pkt.data >= pkt->data &&
+                   out_pkt.data + out_pkt.size <= pkt->data + pkt->size) {
+            /* the frame lies in the input packet, reference it */
+            out_pkt.buf = av_buffer_ref(pkt->buf);
+            if (!out_pkt.buf) {
+                ret = AVERROR(ENOMEM);
+                goto fail;
+            }
+        } else {
+            /* the frame was combined by the parser from several packets,
+             * take over its buffer if possible */
+            out_pkt.buf = avpriv_parser_ref_output(st->parser, out_pkt.data,
+                                                   out_pkt.size);
         }
         if ((ret = av_dup_packet(&out_pkt)) < 0)
             goto fail;
@@ -1497,10 +1625,8 @@ static int read_frame_internal(AVFormatContext *s, AVPacket *pkt)
             *pkt = cur_pkt;
             compute_pkt_fields(s, st, NULL, pkt);
             if ((s->iformat->flags & AVFMT_GENERIC_INDEX) &&
-                (pkt->flags & AV_PKT_FLAG_KEY) && pkt->dts != AV_NOPTS_VALUE) {
-                ff_reduce_index(s, st->index);
-                av_add_index_entry(st, pkt->pos, pkt->dts, 0, 0, AVINDEX_KEYFRAME);
-            }
+                (pkt->flags & AV_PKT_FLAG_KEY) && pkt->dts != AV_NOPTS_VALUE)
+                ff_add_index_hint(s, st->index, pkt->pos, pkt->dts, 0, 0, AVINDEX_KEYFRAME);
             got_packet = 1;
         } else if (st->discard < AVDISCARD_ALL) {
             if ((ret = parse_packet(s, &cur_pkt, cur_pkt.stream_index)) < 0)
@@ -1535,7 +1661,7 @@ static int read_frame_internal(AVFormatContext *s, AVPacket *pkt)
     return ret;
 }
 
-int av_read_frame(AVFormatContext *s, AVPacket *pkt)
+static int read_frame(AVFormatContext *s, AVPacket *pkt)
 {
     const int genpts = s->flags & AVFMT_FLAG_GENPTS;
     int          eof = 0;
@@ -1619,10 +1745,8 @@ return_packet:
         st->skip_samples = 0;
     }
 
-    if ((s->iformat->flags & AVFMT_GENERIC_INDEX) && pkt->flags & AV_PKT_FLAG_KEY) {
-        ff_reduce_index(s, st->index);
-        av_add_index_entry(st, pkt->pos, pkt->dts, 0, 0, AVINDEX_KEYFRAME);
-    }
+    if ((s->iformat->flags & AVFMT_GENERIC_INDEX) && pkt->flags & AV_PKT_FLAG_KEY)
+        ff_add_index_hint(s, st->index, pkt->pos, pkt->dts, 0, 0, AVINDEX_KEYFRAME);
 
     if (is_relative(pkt->dts))
         pkt->dts -= RELATIVE_TS_BASE;
@@ -1632,6 +1756,62 @@ return_packet:
     return ret;
 }
 
+FF_PROFILE_COUNTER(read_frame_counter, "read_frame");
+
+int ff_packet_latency_trace_stamp(AVPacket *pkt, enum AVLatencyStage stage,
+                                  int create)
+{
+    AVLatencyTrace trace = { { 0 } };
+    uint8_t *sd;
+    int size, merged, ret;
+
+    /* the trace may have been merged into the packet data */
+    merged = av_packet_split_side_data(pkt);
+    if (merged < 0)
+        return merged;
+
+    sd = av_packet_get_side_data(pkt, AV_PKT_DATA_LATENCY_TRACE, &size);
+    if (sd) {
+        memcpy(&trace, sd, FFMIN(size, sizeof(trace)));
+        av_latency_trace_stamp(&trace, stage);
+        memcpy(sd, &trace, FFMIN(size, sizeof(trace)));
+    } else if (create) {
+        sd = av_packet_new_side_data(pkt, AV_PKT_DATA_LATENCY_TRACE,
+                                     sizeof(trace));
+        if (!sd)
+            return AVERROR(ENOMEM);
+        av_latency_trace_stamp(&trace, stage);
+        memcpy(sd, &trace, sizeof(trace));
+    }
+
+    if (merged && (ret = av_packet_merge_side_data(pkt)) < 0)
+        return ret;
+    return 0;
+}
+
+int av_read_frame(AVFormatContext *s, AVPacket *pkt)
+{
+    uint64_t prof = avpriv_profile_start();
+    int ret = read_frame(s, pkt);
+
+    if (ret >= 0 && (s->flags & AVFMT_FLAG_LATENCY_TRACE)) {
+        int merge = !(s->flags & AVFMT_FLAG_KEEP_SIDE_DATA) &&
+                    !pkt->side_data_elems;
+        int err = ff_packet_latency_trace_stamp(pkt, AV_LATENCY_DEMUX, 1);
+
+        /* keep the side data merged as the other packets are */
+        if (err >= 0 && merge && pkt->side_data_elems)
+            err = av_packet_merge_side_data(pkt);
+        if (err < 0) {
+            av_free_packet(pkt);
+            ret = err;
+        }
+    }
+
+    avpriv_profile_stop(&read_frame_counter, prof);
+    return ret;
+}
+
 /* XXX: suppress the packet queue */
 static void flush_packet_queue(AVFormatContext *s)
 {
@@ -1713,6 +1893,8 @@ void ff_reduce_index(AVFormatContext *s, int stream_index)
     AVStream *st= s->streams[stream_index];
     unsigned int max_entries= s->max_index_size / sizeof(AVIndexEntry);
 
+    ff_flush_index_hints(st);
+
     if((unsigned)st->nb_index_entries >= max_entries){
         int i;
         for(i=0; 2*i<st->nb_index_entries; i++)
@@ -1721,6 +1903,126 @@ void ff_reduce_index(AVFormatContext *s, int stream_index)
     }
 }
 
+/* minimum number of queued index hints before they are merged */
+#define MAX_INDEX_HINTS_MIN 64
+
+typedef struct IndexHint {
+    AVIndexEntry e;
+    int order;
+} IndexHint;
+
+static int index_hint_cmp(const void *a, const void *b)
+{
+    const IndexHint *ha = a, *hb = b;
+
+    if (ha->e.timestamp != hb->e.timestamp)
+        return ha->e.timestamp > hb->e.timestamp ? 1 : -1;
+    return ha->order - hb->order;
+}
+
+int ff_flush_index_hints(AVStream *st)
+{
+    IndexHint *hints;
+    AVIndexEntry *entries;
+    int i, j, k, n = st->nb_index_hints;
+
+    if (!n)
+        return 0;
+    st->nb_index_hints = 0;
+
+    hints = av_malloc(n * sizeof(*hints));
+    if (!hints)
+        return AVERROR(ENOMEM);
+    for (i = 0; i < n; i++) {
+        hints[i].e     = st->index_hints[i];
+        hints[i].order = i;
+    }
+    qsort(hints, n, sizeof(*hints), index_hint_cmp);
+
+    /* Fold the hints of a same timestamp as ff_add_index_entry() would. */
+    for (i = 1, k = 0; i < n; i++) {
+        if (hints[i].e.timestamp == hints[k].e.timestamp) {
+            if (hints[i].e.pos == hints[k].e.pos &&
+                hints[i].e.min_distance < hints[k].e.min_distance)
+                hints[i].e.min_distance = hints[k].e.min_distance;
+        } else {
+            k++;
+        }
+        hints[k] = hints[i];
+    }
+    n = k + 1;
+
+    if ((unsigned)st->nb_index_entries + n >= UINT_MAX / sizeof(AVIndexEntry) ||
+        !(entries = av_fast_realloc(st->index_entries,
+                                    &st->index_entries_allocated_size,
+                                    (st->nb_index_entries + n) *
+                                    sizeof(AVIndexEntry)))) {
+        av_free(hints);
+        return AVERROR(ENOMEM);
+    }
+    st->index_entries = entries;
+
+    /* Merge from the end, no hint has the timestamp of an entry. */
+    i = st->nb_index_entries - 1;
+    j = n - 1;
+    for (k = st->nb_index_entries + n - 1; j >= 0; k--) {
+        if (i >= 0 && entries[i].timestamp > hints[j].e.timestamp)
+            entries[k] = entries[i--];
+        else
+            entries[k] = hints[j--].e;
+    }
+    st->nb_index_entries += n;
+
+    av_free(hints);
+    return 0;
+}
+
+int ff_add_index_hint(AVFormatContext *s, int stream_index, int64_t pos,
+                      int64_t timestamp, int size, int distance, int flags)
+{
+    AVStream *st = s->streams[stream_index];
+    unsigned int max_entries = s->max_index_size / sizeof(AVIndexEntry);
+    AVIndexEntry *ie;
+    int index;
+
+    timestamp = wrap_timestamp(st, timestamp);
+    if (timestamp == AV_NOPTS_VALUE)
+        return AVERROR(EINVAL);
+    if (is_relative(timestamp))
+        timestamp -= RELATIVE_TS_BASE;
+
+    if ((unsigned)st->nb_index_entries + st->nb_index_hints >= max_entries)
+        ff_reduce_index(s, stream_index);
+
+    index = ff_index_search_timestamp(st->index_entries, st->nb_index_entries,
+                                      timestamp, AVSEEK_FLAG_ANY);
+    if (index < 0 || st->index_entries[index].timestamp == timestamp)
+        return ff_add_index_entry(&st->index_entries, &st->nb_index_entries,
+                                  &st->index_entries_allocated_size, pos,
+                                  timestamp, size, distance, flags);
+
+    /* Inserting in the middle moves all the following entries: queue the
+     * entry, the queue is merged in a single pass once it holds a fraction
+     * of the index. */
+    if ((unsigned)st->nb_index_hints + 1 >= UINT_MAX / sizeof(AVIndexEntry))
+        return -1;
+    ie = av_fast_realloc(st->index_hints, &st->index_hints_allocated_size,
+                         (st->nb_index_hints + 1) * sizeof(AVIndexEntry));
+    if (!ie)
+        return AVERROR(ENOMEM);
+    st->index_hints = ie;
+    ie = &st->index_hints[st->nb_index_hints++];
+    ie->pos          = pos;
+    ie->timestamp    = timestamp;
+    ie->min_distance = distance;
+    ie->size         = size;
+    ie->flags        = flags;
+
+    if (st->nb_index_hints >= FFMAX(MAX_INDEX_HINTS_MIN, st->nb_index_entries / 16))
+        return ff_flush_index_hints(st);
+    return 0;
+}
+
 int ff_add_index_entry(AVIndexEntry **index_entries,
                        int *nb_index_entries,
                        unsigned int *index_entries_allocated_size,
@@ -1777,6 +2079,7 @@ int av_add_index_entry(AVStream *st,
                        int64_t pos, int64_t timestamp, int size, int distance, int flags)
 {
     timestamp = wrap_timestamp(st, timestamp);
+    ff_flush_index_hints(st);
     return ff_add_index_entry(&st->index_entries, &st->nb_index_entries,
                               &st->index_entries_allocated_size, pos,
                               timestamp, size, distance, flags);
@@ -1819,6 +2122,9 @@ int ff_index_search_timestamp(const AVIndexEntry *entries, int nb_entries,
 int av_index_search_timestamp(AVStream *st, int64_t wanted_timestamp,
                               int flags)
 {
+    if (st->compact_index)
+        return ff_compact_index_search_timestamp(st, wanted_timestamp, flags);
+    ff_flush_index_hints(st);
     return ff_index_search_timestamp(st->index_entries, st->nb_index_entries,
                                      wanted_timestamp, flags);
 }
@@ -1854,7 +2160,8 @@ int ff_seek_frame_binary(AVFormatContext *s, int stream_index, int64_t target_ts
     if(st->index_entries){
         AVIndexEntry *e;
 
-        index= av_index_search_timestamp(st, target_ts, flags | AVSEEK_FLAG_BACKWARD); //FIXME whole func must be checked for non-keyframe entries in index case, especially read_timestamp()
+        index= ff_index_search_timestamp(st->index_entries, st->nb_index_entries,
+                                         target_ts, flags | AVSEEK_FLAG_BACKWARD); //FIXME whole func must be checked for non-keyframe entries in index case, especially read_timestamp()
         index= FFMAX(index, 0);
         e= &st->index_entries[index];
 
@@ -1867,7 +2174,8 @@ int ff_seek_frame_binary(AVFormatContext *s, int stream_index, int64_t target_ts
             av_assert1(index==0);
         }
 
-        index= av_index_search_timestamp(st, target_ts, flags & ~AVSEEK_FLAG_BACKWARD);
+        index= ff_index_search_timestamp(st->index_entries, st->nb_index_entries,
+                                         target_ts, flags & ~AVSEEK_FLAG_BACKWARD);
         av_assert0(index < st->nb_index_entries);
         if(index >= 0){
             e= &st->index_entries[index];
@@ -2043,7 +2351,8 @@ static int seek_frame_generic(AVFormatContext *s,
 
     st = s->streams[stream_index];
 
-    index = av_index_search_timestamp(st, timestamp, flags);
+    index = ff_index_search_timestamp(st->index_entries, st->nb_index_entries,
+                                      timestamp, flags);
 
     if(index < 0 && st->nb_index_entries && timestamp < st->index_entries[0].timestamp)
         return -1;
@@ -2079,7 +2388,8 @@ static int seek_frame_generic(AVFormatContext *s,
                 }
             }
         }
-        index = av_index_search_timestamp(st, timestamp, flags);
+        index = ff_index_search_timestamp(st->index_entries, st->nb_index_entries,
+                                          timestamp, flags);
     }
     if (index < 0)
         return -1;
@@ -2141,10 +2451,20 @@ static int seek_frame_internal(AVFormatContext *s, int stream_index,
         return -1;
 }
 
+static void flush_index_hints(AVFormatContext *s)
+{
+    int i;
+
+    for (i = 0; i < s->nb_streams; i++)
+        ff_flush_index_hints(s->streams[i]);
+}
+
 int av_seek_frame(AVFormatContext *s, int stream_index, int64_t timestamp, int flags)
 {
     int ret;
 
+    flush_index_hints(s);
+
     if (s->iformat->read_seek2 && !s->iformat->read_seek) {
         int64_t min_ts = INT64_MIN, max_ts = INT64_MAX;
         if ((flags & AVSEEK_FLAG_BACKWARD))
@@ -2170,6 +2490,8 @@ int avformat_seek_file(AVFormatContext *s, int stream_index, int64_t min_ts, int
     if (stream_index < -1 || stream_index >= (int)s->nb_streams)
         return AVERROR(EINVAL);
 
+    flush_index_hints(s);
+
     if(s->seek2any>0)
         flags |= AVSEEK_FLAG_ANY;
     flags &= ~AVSEEK_FLAG_BACKWARD;
@@ -2540,16 +2862,10 @@ static int has_codec_parameters(AVStream *st, const char **errmsg_ptr)
 }
 
 /* returns 1 or 0 if or if not decoded data was returned, or a negative error */
-static int try_decode_frame(AVStream *st, AVPacket *avpkt, AVDictionary **options)
+static int open_probe_decoder(AVStream *st, AVDictionary **options)
 {
     const AVCodec *codec;
-    int got_picture = 1, ret = 0;
-    AVFrame *frame = avcodec_alloc_frame();
-    AVSubtitle subtitle;
-    AVPacket pkt = *avpkt;
-
-    if (!frame)
-        return AVERROR(ENOMEM);
+    int ret;
 
     if (!avcodec_is_open(st->codec) && !st->info->found_decoder) {
         AVDictionary *thread_opt = NULL;
@@ -2559,8 +2875,7 @@ static int try_decode_frame(AVStream *st, AVPacket *avpkt, AVDictionary **option
 
         if (!codec) {
             st->info->found_decoder = -1;
-            ret = -1;
-            goto fail;
+            return -1;
         }
 
         /* force thread count to 1 since the h264 decoder will not extract SPS
@@ -2571,22 +2886,41 @@ static int try_decode_frame(AVStream *st, AVPacket *avpkt, AVDictionary **option
             av_dict_free(&thread_opt);
         if (ret < 0) {
             st->info->found_decoder = -1;
-            goto fail;
+            return ret;
         }
         st->info->found_decoder = 1;
     } else if (!st->info->found_decoder)
         st->info->found_decoder = 1;
 
-    if (st->info->found_decoder < 0) {
-        ret = -1;
+    return st->info->found_decoder < 0 ? -1 : 0;
+}
+
+/**
+ * Decode a packet during probing, until the codec parameters are found.
+ *
+ * @param first_frame nonzero if the packet is the first one of the stream,
+ *                    decoders with CODEC_CAP_CHANNEL_CONF then always
+ *                    decode a frame
+ */
+static int try_decode_frame(AVStream *st, AVPacket *avpkt, AVDictionary **options,
+                            int first_frame)
+{
+    int got_picture = 1, ret = 0;
+    AVFrame *frame = avcodec_alloc_frame();
+    AVSubtitle subtitle;
+    AVPacket pkt = *avpkt;
+
+    if (!frame)
+        return AVERROR(ENOMEM);
+
+    if ((ret = open_probe_decoder(st, options)) < 0)
         goto fail;
-    }
 
     while ((pkt.size > 0 || (!pkt.data && got_picture)) &&
            ret >= 0 &&
            (!has_codec_parameters(st, NULL)   ||
            !has_decode_delay_been_guessed(st) ||
-           (!st->codec_info_nb_frames && st->codec->codec->capabilities & CODEC_CAP_CHANNEL_CONF))) {
+           (first_frame && st->codec->codec->capabilities & CODEC_CAP_CHANNEL_CONF))) {
         got_picture = 0;
         avcodec_get_frame_defaults(frame);
         switch(st->codec->codec_type) {
@@ -2766,12 +3100,134 @@ int av_find_stream_info(AVFormatContext *ic)
 }
 #endif
 
+/**
+ * Packet queued for decoding by avformat_find_stream_info(), when the
+ * streams are decoded concurrently.
+ */
+typedef struct ProbeDecodeJob {
+    AVStream *st;
+    AVPacket *pkt;
+    AVDictionary **options;
+    int first_frame;
+} ProbeDecodeJob;
+
+typedef struct ProbeDecodeQueue {
+    ProbeDecodeJob *jobs;
+    int nb_jobs;
+    unsigned int jobs_allocated_size;
+    AVStream **streams;             ///< streams with queued packets
+    int nb_streams;
+    unsigned int streams_allocated_size;
+    int next_stream;                ///< next stream to be taken by a worker
+#if HAVE_PTHREADS
+    pthread_mutex_t lock;
+#endif
+} ProbeDecodeQueue;
+
+static int queue_probe_packet(ProbeDecodeQueue *q, AVStream *st, AVPacket *pkt,
+                              AVDictionary **options)
+{
+    ProbeDecodeJob *jobs;
+    AVStream **streams;
+    int i;
+
+    jobs = av_fast_realloc(q->jobs, &q->jobs_allocated_size,
+                           (q->nb_jobs + 1) * sizeof(*q->jobs));
+    if (!jobs)
+        return AVERROR(ENOMEM);
+    q->jobs = jobs;
+    jobs[q->nb_jobs].st          = st;
+    jobs[q->nb_jobs].pkt         = pkt;
+    jobs[q->nb_jobs].options     = options;
+    jobs[q->nb_jobs].first_frame = !st->codec_info_nb_frames;
+    q->nb_jobs++;
+
+    for (i = 0; i < q->nb_streams; i++)
+        if (q->streams[i] == st)
+            return 0;
+    streams = av_fast_realloc(q->streams, &q->streams_allocated_size,
+                              (q->nb_streams + 1) * sizeof(*q->streams));
+    if (!streams)
+        return AVERROR(ENOMEM);
+    q->streams = streams;
+    q->streams[q->nb_streams++] = st;
+    return 0;
+}
+
+static void decode_probe_stream(ProbeDecodeQueue *q, AVStream *st)
+{
+    int i;
+
+    for (i = 0; i < q->nb_jobs; i++)
+        if (q->jobs[i].st == st)
+            try_decode_frame(st, q->jobs[i].pkt, q->jobs[i].options,
+                             q->jobs[i].first_frame);
+}
+
+#if HAVE_PTHREADS
+static void *probe_decode_worker(void *arg)
+{
+    ProbeDecodeQueue *q = arg;
+    int i;
+
+    for (;;) {
+        pthread_mutex_lock(&q->lock);
+        i = q->next_stream++;
+        pthread_mutex_unlock(&q->lock);
+        if (i >= q->nb_streams)
+            break;
+        decode_probe_stream(q, q->streams[i]);
+    }
+    return NULL;
+}
+#endif
+
+/**
+ * Decode the queued packets, each stream in its own thread. The packets
+ * of a stream are decoded in order, so the result is the same as if they
+ * were decoded as they were read.
+ */
+static void flush_probe_queue(AVFormatContext *ic, ProbeDecodeQueue *q)
+{
+    int i, nb_threads = FFMIN(ic->probe_threads, q->nb_streams);
+
+    /* avcodec_open2() may not be called concurrently without a lock manager,
+     * so the decoders are opened beforehand. */
+    for (i = 0; i < q->nb_jobs; i++)
+        open_probe_decoder(q->jobs[i].st, q->jobs[i].options);
+
+#if HAVE_PTHREADS
+    if (nb_threads > 1) {
+        pthread_t *threads = av_malloc((nb_threads - 1) * sizeof(*threads));
+        int nb_created = 0;
+
+        q->next_stream = 0;
+        pthread_mutex_init(&q->lock, NULL);
+        while (threads && nb_created < nb_threads - 1 &&
+               !pthread_create(&threads[nb_created], NULL, probe_decode_worker, q))
+            nb_created++;
+        probe_decode_worker(q);
+        for (i = 0; i < nb_created; i++)
+            pthread_join(threads[i], NULL);
+        pthread_mutex_destroy(&q->lock);
+        av_free(threads);
+    } else
+#endif
+    for (i = 0; i < q->nb_streams; i++)
+        decode_probe_stream(q, q->streams[i]);
+
+    q->nb_jobs    = 0;
+    q->nb_streams = 0;
+}
+
 int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
 {
     int i, count, ret, j;
     int64_t read_size;
     AVStream *st;
     AVPacket pkt1, *pkt;
+    ProbeDecodeQueue queue = { 0 };
+    int64_t start_time = av_gettime();
     int64_t old_offset = avio_tell(ic->pb);
     int orig_nb_streams = ic->nb_streams;        // new streams might appear, no options for those
     int flush_codecs = ic->probesize > 0;
@@ -2898,6 +3354,13 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
                            "consider increasing probesize\n", i);
             break;
         }
+        /* we did not get all the codec info, but we took too much time */
+        if (ic->max_analyze_time > 0 &&
+            av_gettime() - start_time >= ic->max_analyze_time) {
+            ret = count;
+            av_log(ic, AV_LOG_WARNING, "Probe time limit of %d microseconds reached\n", ic->max_analyze_time);
+            break;
+        }
 
         /* NOTE: a new stream can be added there if no header in file
            (AVFMTCTX_NOHEADER) */
@@ -3008,8 +3471,10 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
             if (i > 0 && i < FF_MAX_EXTRADATA_SIZE) {
                 st->codec->extradata_size= i;
                 st->codec->extradata= av_malloc(st->codec->extradata_size + FF_INPUT_BUFFER_PADDING_SIZE);
-                if (!st->codec->extradata)
-                    return AVERROR(ENOMEM);
+                if (!st->codec->extradata) {
+                    ret = AVERROR(ENOMEM);
+                    goto find_stream_info_err;
+                }
                 memcpy(st->codec->extradata, pkt->data, st->codec->extradata_size);
                 memset(st->codec->extradata + i, 0, FF_INPUT_BUFFER_PADDING_SIZE);
             }
@@ -3024,12 +3489,24 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
            least one frame of codec data, this makes sure the codec initializes
            the channel configuration and does not only trust the values from the container.
         */
-        try_decode_frame(st, pkt, (options && i < orig_nb_streams ) ? &options[i] : NULL);
+        if (ic->probe_threads > 1 && pkt != &pkt1) {
+            ret = queue_probe_packet(&queue, st, pkt,
+                                     (options && st->index < orig_nb_streams) ?
+                                     &options[st->index] : NULL);
+            if (ret < 0)
+                goto find_stream_info_err;
+            if (queue.nb_jobs >= 2 * ic->probe_threads)
+                flush_probe_queue(ic, &queue);
+        } else
+            try_decode_frame(st, pkt, (options && i < orig_nb_streams ) ? &options[i] : NULL,
+                             !st->codec_info_nb_frames);
 
         st->codec_info_nb_frames++;
         count++;
     }
 
+    flush_probe_queue(ic, &queue);
+
     if (flush_codecs) {
         AVPacket empty_pkt = { 0 };
         int err = 0;
@@ -3046,7 +3523,8 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
                 do {
                     err = try_decode_frame(st, &empty_pkt,
                                             (options && i < orig_nb_streams) ?
-                                            &options[i] : NULL);
+                                            &options[i] : NULL,
+                                            !st->codec_info_nb_frames);
                 } while (err > 0 && !has_codec_parameters(st, NULL));
 
                 if (err < 0) {
@@ -3177,6 +3655,8 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
     compute_chapters_end(ic);
 
  find_stream_info_err:
+    av_freep(&queue.jobs);
+    av_freep(&queue.streams);
     for (i=0; i < ic->nb_streams; i++) {
         st = ic->streams[i];
         if (ic->streams[i]->codec && ic->streams[i]->codec->codec_type != AVMEDIA_TYPE_AUDIO)
@@ -3299,6 +3779,8 @@ void ff_free_stream(AVFormatContext *s, AVStream *st){
     av_dict_free(&st->metadata);
     av_freep(&st->probe_data.buf);
     av_freep(&st->index_entries);
+    av_freep(&st->index_hints);
+    ff_compact_index_free(st);
     av_freep(&st->codec->extradata);
     av_freep(&st->codec->subtitle_header);
     av_freep(&st->codec);
@@ -3336,6 +3818,7 @@ void avformat_free_context(AVFormatContext *s)
     }
     av_freep(&s->chapters);
     av_dict_free(&s->metadata);
+    ff_interleaver_free(s);
     av_freep(&s->streams);
     av_free(s);
 }
@@ -0,0 +1,48 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVUTIL_AES_INTERNAL_H
+#define AVUTIL_AES_INTERNAL_H
+
+#include <stdint.h>
+
+typedef union {
+    uint64_t u64[2];
+    uint32_t u32[4];
+    uint8_t u8x4[4][4];
+    uint8_t u8[16];
+} av_aes_block;
+
+typedef struct AVAES {
+    // Note: round_key[16] is accessed in the init code, but this only
+    // overwrites state, which does not matter (see also commit ba554c0).
+    av_aes_block round_key[15];
+    av_aes_block state[2];
+    int rounds;
+    /**
+     * Encrypt or decrypt count blocks, as selected by av_aes_init().
+     * The round keys are stored in the order they are applied, starting
+     * from round_key[rounds], and are the same for all implementations.
+     */
+    void (*crypt)(struct AVAES *a, uint8_t *dst, const uint8_t *src,
+                  int count, uint8_t *iv, int rounds);
+} AVAES;
+
+void ff_init_aes_x86(AVAES *a, int decrypt);
+
+#endif /* AVUTIL_AES_INTERNAL_H */
@@ -0,0 +1,92 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "arena.h"
+#include "common.h"
+#include "mem.h"
+
+#define ARENA_ALIGN      16
+#define ARENA_BLOCK_SIZE 4096
+
+/* The arena is the list of its memory blocks, the first one is the one
+ * being filled. */
+struct FFArena {
+    struct FFArena *next;
+    size_t size;                ///< usable size of the block
+    size_t used;
+};
+
+#define BLOCK_HEADER_SIZE FFALIGN(sizeof(FFArena), ARENA_ALIGN)
+
+void *avpriv_arena_alloc(FFArena **arena, size_t size)
+{
+    FFArena *blk = *arena;
+    uint8_t *ptr;
+
+    if (size > SIZE_MAX - BLOCK_HEADER_SIZE - ARENA_BLOCK_SIZE)
+        return NULL;
+    size = FFALIGN(FFMAX(size, 1), ARENA_ALIGN);
+
+    if (!blk || blk->size - blk->used < size) {
+        size_t blk_size = FFMAX(size, ARENA_BLOCK_SIZE);
+        FFArena *new = av_malloc(BLOCK_HEADER_SIZE + blk_size);
+
+        if (!new)
+            return NULL;
+        new->size = blk_size;
+        new->used = 0;
+        if (blk && blk->size - blk->used >= blk_size - size) {
+            /* the current block has more room left, keep filling it */
+            new->next = blk->next;
+            blk->next = new;
+        } else {
+            new->next = blk;
+            *arena    = new;
+        }
+        blk = new;
+    }
+
+    ptr = (uint8_t *)blk + BLOCK_HEADER_SIZE + blk->used;
+    blk->used += size;
+    return ptr;
+}
+
+char *avpriv_arena_strdup(FFArena **arena, const char *s)
+{
+    size_t len;
+    char *ptr;
+
+    if (!s)
+        return NULL;
+    len = strlen(s) + 1;
+    if ((ptr = avpriv_arena_alloc(arena, len)))
+        memcpy(ptr, s, len);
+    return ptr;
+}
+
+void avpriv_arena_free(FFArena **arena)
+{
+    while (*arena) {
+        FFArena *next = (*arena)->next;
+        av_free(*arena);
+        *arena = next;
+    }
+}
@@ -0,0 +1,58 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Arena allocator, for many small allocations which all share the
+ * lifetime of a context.
+ */
+
+#ifndef AVUTIL_ARENA_H
+#define AVUTIL_ARENA_H
+
+#include <stddef.h>
+
+/**
+ * A set of allocations freed all at once. It is created by the first
+ * allocation, a NULL pointer is an empty arena.
+ */
+typedef struct FFArena FFArena;
+
+/**
+ * Allocate a block of memory from an arena. It is aligned like the
+ * allocations of av_malloc() up to 16 bytes, and cannot be freed on its
+ * own.
+ *
+ * @param arena pointer to the arena, which is created if it is NULL
+ * @return the allocated memory, or NULL on failure
+ */
+void *avpriv_arena_alloc(FFArena **arena, size_t size);
+
+/**
+ * Duplicate a string into an arena.
+ *
+ * @return the copy, or NULL if s is NULL or on failure
+ */
+char *avpriv_arena_strdup(FFArena **arena, const char *s);
+
+/**
+ * Free all the memory allocated from an arena and set it to NULL.
+ */
+void avpriv_arena_free(FFArena **arena);
+
+#endif /* AVUTIL_ARENA_H */
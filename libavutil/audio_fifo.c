@@ -24,44 +24,153 @@
  * Audio FIFO
  */
 
+#include "config.h"
 #include "avutil.h"
 #include "audio_fifo.h"
+#include "buffer.h"
 #include "common.h"
-#include "fifo.h"
+#include "frame.h"
 #include "mem.h"
 #include "samplefmt.h"
 
+/* alignment of the read position for av_audio_fifo_read_frame() to share
+ * the FIFO storage, the same one av_malloc() gives to frame buffers */
+#define FIFO_ALIGN (HAVE_AVX ? 32 : 16)
+
+/* extra bytes at the end of each buffer so that SIMD code overreading a
+ * frame that ends at the end of the storage stays within the allocation */
+#define FIFO_PADDING 64
+
 struct AVAudioFifo {
-    AVFifoBuffer **buf;             /**< single buffer for interleaved, per-channel buffers for planar */
+    AVBufferRef **buf;              /**< single buffer for interleaved, per-channel buffers for planar */
     int nb_buffers;                 /**< number of buffers */
     int nb_samples;                 /**< number of samples currently in the FIFO */
     int allocated_samples;          /**< current allocated size, in samples */
+    int read_pos;                   /**< position of the first sample in the buffers, in samples */
+
+    int64_t nb_read;                /**< total number of samples read or drained */
+    int64_t pin_pos;                /**< value of nb_read when the buffers were first shared with a frame */
 
     int channels;                   /**< number of channels */
     enum AVSampleFormat sample_fmt; /**< sample format */
     int sample_size;                /**< size, in bytes, of one sample in a buffer */
 };
 
+static void free_buffers(AVBufferRef **buf, int nb_buffers)
+{
+    int i;
+
+    for (i = 0; i < nb_buffers; i++)
+        av_buffer_unref(&buf[i]);
+    av_free(buf);
+}
+
 void av_audio_fifo_free(AVAudioFifo *af)
 {
     if (af) {
-        if (af->buf) {
-            int i;
-            for (i = 0; i < af->nb_buffers; i++) {
-                if (af->buf[i])
-                    av_fifo_free(af->buf[i]);
-            }
-            av_free(af->buf);
-        }
+        if (af->buf)
+            free_buffers(af->buf, af->nb_buffers);
         av_free(af);
     }
 }
 
+/**
+ * Copy the first nb_samples of the FIFO to data, without removing them.
+ */
+static void copy_from_fifo(AVAudioFifo *af, uint8_t **data, int nb_samples)
+{
+    int pos  = af->read_pos;
+    int len1 = FFMIN(nb_samples, af->allocated_samples - pos);
+    int i;
+
+    for (i = 0; i < af->nb_buffers; i++) {
+        memcpy(data[i], af->buf[i]->data + pos * af->sample_size,
+               len1 * af->sample_size);
+        memcpy(data[i] + len1 * af->sample_size, af->buf[i]->data,
+               (nb_samples - len1) * af->sample_size);
+    }
+}
+
+/**
+ * Move the FIFO content to newly allocated buffers of nb_samples.
+ * The old buffers stay alive as long as frames reference them.
+ */
+static int move_buffers(AVAudioFifo *af, int nb_samples)
+{
+    uint8_t *data[AV_NUM_DATA_POINTERS], **datap = data;
+    AVBufferRef **buf;
+    int i, ret, buf_size;
+
+    if ((ret = av_samples_get_buffer_size(&buf_size, af->channels, nb_samples,
+                                          af->sample_fmt, 1)) < 0)
+        return ret;
+    if (buf_size > INT_MAX - FIFO_PADDING)
+        return AVERROR(EINVAL);
+
+    buf = av_mallocz(af->nb_buffers * sizeof(*buf));
+    if (!buf)
+        return AVERROR(ENOMEM);
+    if (af->nb_buffers > AV_NUM_DATA_POINTERS) {
+        datap = av_malloc(af->nb_buffers * sizeof(*datap));
+        if (!datap) {
+            av_free(buf);
+            return AVERROR(ENOMEM);
+        }
+    }
+
+    for (i = 0; i < af->nb_buffers; i++) {
+        buf[i] = av_buffer_alloc(buf_size + FIFO_PADDING);
+        if (!buf[i]) {
+            free_buffers(buf, af->nb_buffers);
+            if (datap != data)
+                av_free(datap);
+            return AVERROR(ENOMEM);
+        }
+        datap[i] = buf[i]->data;
+    }
+
+    if (af->buf) {
+        copy_from_fifo(af, datap, af->nb_samples);
+        free_buffers(af->buf, af->nb_buffers);
+    }
+    if (datap != data)
+        av_free(datap);
+
+    af->buf               = buf;
+    af->read_pos          = 0;
+    af->allocated_samples = nb_samples;
+    return 0;
+}
+
+/**
+ * Make sure nb_samples can be written after the FIFO content, without
+ * overwriting samples still referenced by frames.
+ */
+static int make_space(AVAudioFifo *af, int nb_samples)
+{
+    /* automatically reallocate buffers if needed */
+    if (av_audio_fifo_space(af) < nb_samples) {
+        int current_size = av_audio_fifo_size(af);
+        /* check for integer overflow in new size calculation */
+        if (INT_MAX / 2 - current_size < nb_samples)
+            return AVERROR(EINVAL);
+        return move_buffers(af, 2 * (current_size + nb_samples));
+    }
+
+    /* frames returned by av_audio_fifo_read_frame() hold the samples read
+     * since pin_pos, writing may not wrap around into them */
+    if (!av_buffer_is_writable(af->buf[0]) &&
+        af->nb_read + af->nb_samples + nb_samples > af->pin_pos + af->allocated_samples)
+        return move_buffers(af, af->allocated_samples);
+
+    return 0;
+}
+
 AVAudioFifo *av_audio_fifo_alloc(enum AVSampleFormat sample_fmt, int channels,
                                  int nb_samples)
 {
     AVAudioFifo *af;
-    int buf_size, i;
+    int buf_size;
 
     /* get channel buffer size (also validates parameters) */
     if (av_samples_get_buffer_size(&buf_size, channels, nb_samples, sample_fmt, 1) < 0)
@@ -76,69 +185,92 @@ AVAudioFifo *av_audio_fifo_alloc(enum AVSampleFormat sample_fmt, int channels,
     af->sample_size = buf_size / nb_samples;
     af->nb_buffers  = av_sample_fmt_is_planar(sample_fmt) ? channels : 1;
 
-    af->buf = av_mallocz(af->nb_buffers * sizeof(*af->buf));
-    if (!af->buf)
-        goto error;
-
-    for (i = 0; i < af->nb_buffers; i++) {
-        af->buf[i] = av_fifo_alloc(buf_size);
-        if (!af->buf[i])
-            goto error;
+    if (move_buffers(af, nb_samples) < 0) {
+        av_audio_fifo_free(af);
+        return NULL;
     }
-    af->allocated_samples = nb_samples;
 
     return af;
-
-error:
-    av_audio_fifo_free(af);
-    return NULL;
 }
 
 int av_audio_fifo_realloc(AVAudioFifo *af, int nb_samples)
 {
-    int i, ret, buf_size;
+    if (nb_samples <= af->allocated_samples)
+        return 0;
+    return move_buffers(af, nb_samples);
+}
 
-    if ((ret = av_samples_get_buffer_size(&buf_size, af->channels, nb_samples,
-                                          af->sample_fmt, 1)) < 0)
+int av_audio_fifo_write(AVAudioFifo *af, void **data, int nb_samples)
+{
+    int i, ret, pos, len1;
+
+    if ((ret = make_space(af, nb_samples)) < 0)
         return ret;
 
+    pos  = (af->read_pos + af->nb_samples) % af->allocated_samples;
+    len1 = FFMIN(nb_samples, af->allocated_samples - pos);
     for (i = 0; i < af->nb_buffers; i++) {
-        if ((ret = av_fifo_realloc2(af->buf[i], buf_size)) < 0)
-            return ret;
+        memcpy(af->buf[i]->data + pos * af->sample_size, data[i],
+               len1 * af->sample_size);
+        memcpy(af->buf[i]->data, (uint8_t *)data[i] + len1 * af->sample_size,
+               (nb_samples - len1) * af->sample_size);
     }
-    af->allocated_samples = nb_samples;
-    return 0;
+    af->nb_samples += nb_samples;
+
+    return nb_samples;
 }
 
-int av_audio_fifo_write(AVAudioFifo *af, void **data, int nb_samples)
+int av_audio_fifo_get_write_buffer(AVAudioFifo *af, void **data, int nb_samples)
 {
-    int i, ret, size;
+    int i, ret, pos;
 
-    /* automatically reallocate buffers if needed */
-    if (av_audio_fifo_space(af) < nb_samples) {
-        int current_size = av_audio_fifo_size(af);
-        /* check for integer overflow in new size calculation */
-        if (INT_MAX / 2 - current_size < nb_samples)
-            return AVERROR(EINVAL);
-        /* reallocate buffers */
-        if ((ret = av_audio_fifo_realloc(af, 2 * (current_size + nb_samples))) < 0)
-            return ret;
-    }
+    if (nb_samples <= 0)
+        return AVERROR(EINVAL);
+    if ((ret = make_space(af, nb_samples)) < 0)
+        return ret;
 
-    size = nb_samples * af->sample_size;
-    for (i = 0; i < af->nb_buffers; i++) {
-        ret = av_fifo_generic_write(af->buf[i], data[i], size, NULL);
-        if (ret != size)
-            return AVERROR_BUG;
-    }
+    pos = (af->read_pos + af->nb_samples) % af->allocated_samples;
+    for (i = 0; i < af->nb_buffers; i++)
+        data[i] = af->buf[i]->data + pos * af->sample_size;
+
+    return FFMIN(nb_samples, af->allocated_samples - pos);
+}
+
+int av_audio_fifo_commit_write(AVAudioFifo *af, int nb_samples)
+{
+    if (nb_samples < 0 || nb_samples > av_audio_fifo_space(af))
+        return AVERROR(EINVAL);
     af->nb_samples += nb_samples;
+    return 0;
+}
+
+int av_audio_fifo_read(AVAudioFifo *af, void **data, int nb_samples)
+{
+    if (nb_samples < 0)
+        return AVERROR(EINVAL);
+    nb_samples = FFMIN(nb_samples, af->nb_samples);
+    if (!nb_samples)
+        return 0;
+
+    copy_from_fifo(af, (uint8_t **)data, nb_samples);
+    av_audio_fifo_drain(af, nb_samples);
 
     return nb_samples;
 }
 
-int av_audio_fifo_read(AVAudioFifo *af, void **data, int nb_samples)
+int av_audio_fifo_get_read_buffer(AVAudioFifo *af, void **data)
+{
+    int i;
+
+    for (i = 0; i < af->nb_buffers; i++)
+        data[i] = af->buf[i]->data + af->read_pos * af->sample_size;
+
+    return FFMIN(af->nb_samples, af->allocated_samples - af->read_pos);
+}
+
+int av_audio_fifo_read_frame(AVAudioFifo *af, AVFrame *frame, int nb_samples)
 {
-    int i, ret, size;
+    int i, offset, copy;
 
     if (nb_samples < 0)
         return AVERROR(EINVAL);
@@ -146,41 +278,73 @@ int av_audio_fifo_read(AVAudioFifo *af, void **data, int nb_samples)
     if (!nb_samples)
         return 0;
 
-    size = nb_samples * af->sample_size;
+    /* share the FIFO storage if the samples do not wrap around and the
+     * frame data is as aligned as freshly allocated buffers */
+    offset = af->read_pos * af->sample_size;
+    copy   = af->read_pos + nb_samples > af->allocated_samples ||
+             offset % FIFO_ALIGN;
+
+    if (af->nb_buffers > AV_NUM_DATA_POINTERS) {
+        frame->extended_data = av_mallocz(af->nb_buffers *
+                                          sizeof(*frame->extended_data));
+        frame->extended_buf  = av_mallocz((af->nb_buffers - AV_NUM_DATA_POINTERS) *
+                                          sizeof(*frame->extended_buf));
+        if (!frame->extended_data || !frame->extended_buf) {
+            av_freep(&frame->extended_data);
+            av_freep(&frame->extended_buf);
+            return AVERROR(ENOMEM);
+        }
+        frame->nb_extended_buf = af->nb_buffers - AV_NUM_DATA_POINTERS;
+    } else
+        frame->extended_data = frame->data;
+
+    if (!copy && av_buffer_is_writable(af->buf[0]))
+        af->pin_pos = af->nb_read;
+
     for (i = 0; i < af->nb_buffers; i++) {
-        if ((ret = av_fifo_generic_read(af->buf[i], data[i], size, NULL)) < 0)
-            return AVERROR_BUG;
+        AVBufferRef *ref = copy ? av_buffer_alloc(nb_samples * af->sample_size + FIFO_PADDING)
+                                : av_buffer_ref(af->buf[i]);
+        if (!ref) {
+            av_frame_unref(frame);
+            return AVERROR(ENOMEM);
+        }
+        if (i < AV_NUM_DATA_POINTERS) {
+            frame->buf[i]  = ref;
+            frame->data[i] = ref->data + (copy ? 0 : offset);
+        } else
+            frame->extended_buf[i - AV_NUM_DATA_POINTERS] = ref;
+        frame->extended_data[i] = ref->data + (copy ? 0 : offset);
     }
-    af->nb_samples -= nb_samples;
+    if (copy)
+        copy_from_fifo(af, frame->extended_data, nb_samples);
+
+    frame->format      = af->sample_fmt;
+    frame->nb_samples  = nb_samples;
+    frame->linesize[0] = nb_samples * af->sample_size;
+    av_frame_set_channels(frame, af->channels);
+
+    av_audio_fifo_drain(af, nb_samples);
 
     return nb_samples;
 }
 
 int av_audio_fifo_drain(AVAudioFifo *af, int nb_samples)
 {
-    int i, size;
-
     if (nb_samples < 0)
         return AVERROR(EINVAL);
     nb_samples = FFMIN(nb_samples, af->nb_samples);
 
     if (nb_samples) {
-        size = nb_samples * af->sample_size;
-        for (i = 0; i < af->nb_buffers; i++)
-            av_fifo_drain(af->buf[i], size);
+        af->read_pos    = (af->read_pos + nb_samples) % af->allocated_samples;
         af->nb_samples -= nb_samples;
+        af->nb_read    += nb_samples;
     }
     return 0;
 }
 
 void av_audio_fifo_reset(AVAudioFifo *af)
 {
-    int i;
-
-    for (i = 0; i < af->nb_buffers; i++)
-        av_fifo_reset(af->buf[i]);
-
-    af->nb_samples = 0;
+    av_audio_fifo_drain(af, af->nb_samples);
 }
 
 int av_audio_fifo_size(AVAudioFifo *af)
@@ -29,6 +29,7 @@
 
 #include "avutil.h"
 #include "fifo.h"
+#include "frame.h"
 #include "samplefmt.h"
 
 /**
@@ -42,6 +43,8 @@
  * - Operates at the sample level rather than the byte level.
  * - Supports multiple channels with either planar or packed sample format.
  * - Automatic reallocation when writing to a full buffer.
+ * - Direct access to the FIFO storage, and reading into reference-counted
+ *   frames which share it when possible.
  */
 typedef struct AVAudioFifo AVAudioFifo;
 
@@ -106,6 +109,74 @@ int av_audio_fifo_write(AVAudioFifo *af, void **data, int nb_samples);
  */
 int av_audio_fifo_read(AVAudioFifo *af, void **data, int nb_samples);
 
+/**
+ * Read data from an AVAudioFifo into a reference-counted frame.
+ *
+ * If the samples are contiguous and suitably aligned in the FIFO, the frame
+ * references the FIFO storage and no data is copied. Otherwise new buffers
+ * are allocated for the frame and the samples are copied into them. The
+ * FIFO never overwrites samples which are still referenced by a frame.
+ *
+ * The format, nb_samples and channels fields of the frame are set, the
+ * caller is responsible for the other properties such as channel_layout,
+ * sample_rate and pts.
+ *
+ * @param af          AVAudioFifo to read from
+ * @param frame       frame without any data, e.g. freshly allocated or
+ *                    unreferenced
+ * @param nb_samples  number of samples to read
+ * @return            number of samples actually read, or negative AVERROR code
+ *                    on failure. The number of samples actually read will not
+ *                    be greater than nb_samples, and will only be less than
+ *                    nb_samples if av_audio_fifo_size is less than nb_samples.
+ */
+int av_audio_fifo_read_frame(AVAudioFifo *af, AVFrame *frame, int nb_samples);
+
+/**
+ * Get direct access to the oldest samples of an AVAudioFifo.
+ *
+ * The samples are not removed from the FIFO, av_audio_fifo_drain() must be
+ * called once the caller is done with them. The pointers are valid until
+ * the next call modifying the FIFO, other than av_audio_fifo_drain().
+ *
+ * @param af          AVAudioFifo to read from
+ * @param data        set to the audio data plane pointers
+ * @return            number of samples available contiguously at data, which
+ *                    is less than av_audio_fifo_size if the data wraps around
+ *                    the end of the FIFO storage
+ */
+int av_audio_fifo_get_read_buffer(AVAudioFifo *af, void **data);
+
+/**
+ * Get direct access to the free space of an AVAudioFifo.
+ *
+ * The AVAudioFifo will be reallocated automatically if the available space
+ * is less than nb_samples. Once the samples have been written to data, they
+ * must be added to the FIFO with av_audio_fifo_commit_write(). The pointers
+ * are valid until the next call modifying the FIFO.
+ *
+ * @param af          AVAudioFifo to write to
+ * @param data        set to the audio data plane pointers
+ * @param nb_samples  number of samples the caller wants to write
+ * @return            number of samples which can be written contiguously at
+ *                    data, at most nb_samples, or negative AVERROR code on
+ *                    failure. If it is less than nb_samples, the remaining
+ *                    samples can be written after the commit with another
+ *                    call to this function.
+ */
+int av_audio_fifo_get_write_buffer(AVAudioFifo *af, void **data, int nb_samples);
+
+/**
+ * Add samples written through av_audio_fifo_get_write_buffer() to an
+ * AVAudioFifo.
+ *
+ * @param af          AVAudioFifo to write to
+ * @param nb_samples  number of samples written, at most the value returned
+ *                    by av_audio_fifo_get_write_buffer()
+ * @return            0 if OK, or negative AVERROR code on failure
+ */
+int av_audio_fifo_commit_write(AVAudioFifo *af, int nb_samples);
+
 /**
  * Drain data from an AVAudioFifo.
  *
@@ -22,6 +22,7 @@
 #include <stdint.h>
 
 #include "buffer.h"
+#include "thread.h"
 
 /**
  * The buffer is always treated as read-only.
@@ -68,11 +69,12 @@ typedef struct BufferPoolEntry {
     void (*free)(void *opaque, uint8_t *data);
 
     AVBufferPool *pool;
-    struct BufferPoolEntry * volatile next;
+    struct BufferPoolEntry *next;
 } BufferPoolEntry;
 
 struct AVBufferPool {
-    BufferPoolEntry * volatile pool;
+    AVMutex mutex;
+    BufferPoolEntry *pool;      ///< free buffers, protected by mutex
 
     /*
      * This is used to track when the pool is to be freed.
@@ -85,7 +87,9 @@ struct AVBufferPool {
      */
     volatile int refcount;
 
-    volatile int nb_allocated;
+    /* statistics, protected by mutex */
+    int nb_reused;              ///< requests served from the free list
+    int nb_allocated;           ///< requests which allocated a new buffer
 
     int size;
     AVBufferRef* (*alloc)(int size);
@@ -22,6 +22,7 @@
 #include "common.h"
 #include "bswap.h"
 #include "crc.h"
+#include "thread.h"
 
 #if CONFIG_HARDCODED_TABLES
 static const AVCRC av_crc_table[AV_CRC_MAX][257] = {
@@ -228,6 +229,49 @@ static struct {
     [AV_CRC_32_IEEE_LE] = { 1, 32, 0xEDB88320 },
 };
 static AVCRC av_crc_table[AV_CRC_MAX][CRC_TABLE_SIZE];
+#if !CONFIG_SMALL
+/* 4 more slices for the standard tables, so that they are processed
+ * 8 bytes at a time. User tables are limited to the 1024 entries
+ * of the public API. */
+static AVCRC av_crc_table_ext[AV_CRC_MAX][4 * 256];
+#endif
+
+static void crc_init_table(AVCRCId crc_id)
+{
+    AVCRC *ctx = av_crc_table[crc_id];
+#if !CONFIG_SMALL
+    int i, j;
+#endif
+
+    av_crc_init(ctx, av_crc_table_params[crc_id].le,
+                av_crc_table_params[crc_id].bits,
+                av_crc_table_params[crc_id].poly, sizeof(av_crc_table[crc_id]));
+#if !CONFIG_SMALL
+    for (i = 0; i < 256; i++) {
+        AVCRC *ext = av_crc_table_ext[crc_id];
+
+        ext[i] = (ctx[3 * 256 + i] >> 8) ^ ctx[ctx[3 * 256 + i] & 0xFF];
+        for (j = 1; j < 4; j++)
+            ext[256 * j + i] = (ext[256 * (j - 1) + i] >> 8) ^
+                               ctx[ext[256 * (j - 1) + i] & 0xFF];
+    }
+#endif
+}
+
+#define DECLARE_CRC_INIT_TABLE_ONCE(id)                 \
+static AVOnce id ## _once = AV_ONCE_INIT;               \
+static void id ## _init_table_once(void)                \
+{                                                       \
+    crc_init_table(id);                                 \
+}
+
+DECLARE_CRC_INIT_TABLE_ONCE(AV_CRC_8_ATM)
+DECLARE_CRC_INIT_TABLE_ONCE(AV_CRC_16_ANSI)
+DECLARE_CRC_INIT_TABLE_ONCE(AV_CRC_16_CCITT)
+DECLARE_CRC_INIT_TABLE_ONCE(AV_CRC_32_IEEE)
+DECLARE_CRC_INIT_TABLE_ONCE(AV_CRC_32_IEEE_LE)
+
+#define CRC_INIT_TABLE_ONCE(id) ff_thread_once(&id ## _once, id ## _init_table_once)
 #endif
 
 int av_crc_init(AVCRC *ctx, int le, int bits, uint32_t poly, int ctx_size)
@@ -266,13 +310,14 @@ int av_crc_init(AVCRC *ctx, int le, int bits, uint32_t poly, int ctx_size)
 const AVCRC *av_crc_get_table(AVCRCId crc_id)
 {
 #if !CONFIG_HARDCODED_TABLES
-    if (!av_crc_table[crc_id][FF_ARRAY_ELEMS(av_crc_table[crc_id]) - 1])
-        if (av_crc_init(av_crc_table[crc_id],
-                        av_crc_table_params[crc_id].le,
-                        av_crc_table_params[crc_id].bits,
-                        av_crc_table_params[crc_id].poly,
-                        sizeof(av_crc_table[crc_id])) < 0)
-            return NULL;
+    switch (crc_id) {
+    case AV_CRC_8_ATM:      CRC_INIT_TABLE_ONCE(AV_CRC_8_ATM);      break;
+    case AV_CRC_16_ANSI:    CRC_INIT_TABLE_ONCE(AV_CRC_16_ANSI);    break;
+    case AV_CRC_16_CCITT:   CRC_INIT_TABLE_ONCE(AV_CRC_16_CCITT);   break;
+    case AV_CRC_32_IEEE:    CRC_INIT_TABLE_ONCE(AV_CRC_32_IEEE);    break;
+    case AV_CRC_32_IEEE_LE: CRC_INIT_TABLE_ONCE(AV_CRC_32_IEEE_LE); break;
+    default: return NULL;
+    }
 #endif
     return av_crc_table[crc_id];
 }
@@ -287,6 +332,25 @@ uint32_t av_crc(const AVCRC *ctx, uint32_t crc,
         while (((intptr_t) buffer & 3) && buffer < end)
             crc = ctx[((uint8_t) crc) ^ *buffer++] ^ (crc >> 8);
 
+#if !CONFIG_HARDCODED_TABLES
+        if (ctx >= av_crc_table[0] && ctx < av_crc_table[AV_CRC_MAX]) {
+            const AVCRC *ext = av_crc_table_ext[(ctx - av_crc_table[0]) / CRC_TABLE_SIZE];
+
+            while (buffer < end - 7) {
+                uint32_t next = av_le2ne32(*(const uint32_t *)(buffer + 4));
+                crc ^= av_le2ne32(*(const uint32_t *) buffer); buffer += 8;
+                crc = ext[3 * 256 + ( crc        & 0xFF)] ^
+                      ext[2 * 256 + ((crc >> 8 ) & 0xFF)] ^
+                      ext[1 * 256 + ((crc >> 16) & 0xFF)] ^
+                      ext[0 * 256 + ((crc >> 24)       )] ^
+                      ctx[3 * 256 + ( next       & 0xFF)] ^
+                      ctx[2 * 256 + ((next >> 8 ) & 0xFF)] ^
+                      ctx[1 * 256 + ((next >> 16) & 0xFF)] ^
+                      ctx[0 * 256 + ((next >> 24)       )];
+            }
+        }
+#endif
+
         while (buffer < end - 3) {
             crc ^= av_le2ne32(*(const uint32_t *) buffer); buffer += 4;
             crc = ctx[3 * 256 + ( crc        & 0xFF)] ^
@@ -25,11 +25,86 @@
 #include "internal.h"
 #include "mem.h"
 
+/* Exact key lookups use a hash index once the dictionary has that many
+ * entries. It is built on the first such lookup, the entries themselves
+ * stay in the array in insertion order. */
+#define DICT_HASH_MIN_COUNT 8
+
 struct AVDictionary {
     int count;
     AVDictionaryEntry *elems;
+    unsigned *hash_heads;   ///< index + 1 of the first entry of each bucket
+    unsigned *hash_next;    ///< index + 1 of the next entry in the bucket
+    unsigned hash_size;     ///< number of buckets, 0 if there is no index
 };
 
+/* case insensitive, so that it can serve both kinds of lookups */
+static unsigned dict_hash(const char *key)
+{
+    unsigned h = 0;
+
+    while (*key)
+        h = h * 31 + av_toupper(*key++);
+    return h;
+}
+
+static void hash_free(AVDictionary *m)
+{
+    av_freep(&m->hash_heads);
+    av_freep(&m->hash_next);
+    m->hash_size = 0;
+}
+
+static void hash_insert(AVDictionary *m, int i)
+{
+    unsigned b = dict_hash(m->elems[i].key) & (m->hash_size - 1);
+
+    m->hash_next[i]  = m->hash_heads[b];
+    m->hash_heads[b] = i + 1;
+}
+
+static void hash_remove(AVDictionary *m, int i)
+{
+    unsigned b  = dict_hash(m->elems[i].key) & (m->hash_size - 1);
+    unsigned *p = &m->hash_heads[b];
+
+    while (*p != i + 1)
+        p = &m->hash_next[*p - 1];
+    *p = m->hash_next[i];
+}
+
+static int hash_build(AVDictionary *m)
+{
+    unsigned size = 16;
+    int i;
+
+    while (size < 2U * m->count)
+        size <<= 1;
+    m->hash_heads = av_mallocz(size * sizeof(*m->hash_heads));
+    m->hash_next  = av_malloc (size * sizeof(*m->hash_next));
+    if (!m->hash_heads || !m->hash_next) {
+        hash_free(m);
+        return AVERROR(ENOMEM);
+    }
+    m->hash_size = size;
+    for (i = 0; i < m->count; i++)
+        hash_insert(m, i);
+    return 0;
+}
+
+static int key_matches(const char *s, const char *key, int flags)
+{
+    int j;
+
+    if(flags & AV_DICT_MATCH_CASE) for(j=0;            s[j]  ==            key[j]  && key[j]; j++);
+    else                           for(j=0; av_toupper(s[j]) == av_toupper(key[j]) && key[j]; j++);
+    if(key[j])
+        return 0;
+    if(s[j] && !(flags & AV_DICT_IGNORE_SUFFIX))
+        return 0;
+    return 1;
+}
+
 int av_dict_count(const AVDictionary *m)
 {
     return m ? m->count : 0;
@@ -38,23 +113,30 @@ int av_dict_count(const AVDictionary *m)
 AVDictionaryEntry *
 av_dict_get(AVDictionary *m, const char *key, const AVDictionaryEntry *prev, int flags)
 {
-    unsigned int i, j;
+    unsigned int i;
 
     if(!m)
         return NULL;
 
+    if (!prev && !(flags & AV_DICT_IGNORE_SUFFIX) &&
+        m->count >= DICT_HASH_MIN_COUNT &&
+        (m->hash_size || hash_build(m) >= 0)) {
+        /* the chains are not ordered, keep the first match of the array */
+        unsigned best = 0;
+
+        i = m->hash_heads[dict_hash(key) & (m->hash_size - 1)];
+        for (; i; i = m->hash_next[i - 1])
+            if ((!best || i < best) && key_matches(m->elems[i - 1].key, key, flags))
+                best = i;
+        return best ? &m->elems[best - 1] : NULL;
+    }
+
     if(prev) i= prev - m->elems + 1;
     else     i= 0;
 
     for(; i<m->count; i++){
-        const char *s= m->elems[i].key;
-        if(flags & AV_DICT_MATCH_CASE) for(j=0;            s[j]  ==            key[j]  && key[j]; j++);
-        else                           for(j=0; av_toupper(s[j]) == av_toupper(key[j]) && key[j]; j++);
-        if(key[j])
-            continue;
-        if(s[j] && !(flags & AV_DICT_IGNORE_SUFFIX))
-            continue;
-        return &m->elems[i];
+        if (key_matches(m->elems[i].key, key, flags))
+            return &m->elems[i];
     }
     return NULL;
 }
@@ -75,8 +157,15 @@ int av_dict_set(AVDictionary **pm, const char *key, const char *value, int flags
             oldval = tag->value;
         else
             av_free(tag->value);
+        if (m->hash_size) {
+            hash_remove(m, tag - m->elems);
+            if (tag != &m->elems[m->count - 1])
+                hash_remove(m, m->count - 1);
+        }
         av_free(tag->key);
         *tag = m->elems[--m->count];
+        if (m->hash_size && tag != &m->elems[m->count])
+            hash_insert(m, tag - m->elems);
     } else {
         AVDictionaryEntry *tmp = av_realloc(m->elems, (m->count+1) * sizeof(*m->elems));
         if(tmp) {
@@ -102,9 +191,14 @@ int av_dict_set(AVDictionary **pm, const char *key, const char *value, int flags
             m->elems[m->count].value = newval;
         } else
             m->elems[m->count].value = av_strdup(value);
+        if (m->hash_size && m->count + 1 > m->hash_size / 2)
+            hash_free(m); /* rebuilt larger on the next lookup */
+        if (m->hash_size)
+            hash_insert(m, m->count);
         m->count++;
     }
     if (!m->count) {
+        hash_free(m);
         av_free(m->elems);
         av_freep(pm);
     }
@@ -168,6 +262,7 @@ void av_dict_free(AVDictionary **pm)
             av_free(m->elems[m->count].key);
             av_free(m->elems[m->count].value);
         }
+        hash_free(m);
         av_free(m->elems);
     }
     av_freep(pm);
@@ -180,3 +275,62 @@ void av_dict_copy(AVDictionary **dst, AVDictionary *src, int flags)
     while ((t = av_dict_get(src, "", t, AV_DICT_IGNORE_SUFFIX)))
         av_dict_set(dst, t->key, t->value, flags);
 }
+
+#ifdef TEST
+
+static AVDictionaryEntry *linear_get(AVDictionary *m, const char *key, int flags)
+{
+    int i;
+
+    for (i = 0; m && i < m->count; i++)
+        if (key_matches(m->elems[i].key, key, flags))
+            return &m->elems[i];
+    return NULL;
+}
+
+int main(void)
+{
+    static const int set_flags[] = {
+        0, AV_DICT_MATCH_CASE, AV_DICT_DONT_OVERWRITE, AV_DICT_APPEND,
+    };
+    AVDictionary *dict = NULL;
+    unsigned seed = 1;
+    char key[16], value[16];
+    int i, errors = 0;
+
+    for (i = 0; i < 20000; i++) {
+        int flags, k;
+
+        seed = seed * 1664525 + 1013904223;
+        k     = (seed >> 8) % 64;
+        flags = set_flags[(seed >> 16) % 4];
+        snprintf(key, sizeof(key), (seed >> 20) & 1 ? "Key%d" : "kEY%d", k);
+        snprintf(value, sizeof(value), "%d", i % 10);
+        av_dict_set(&dict, key, (seed >> 24) % 5 ? value : NULL, flags);
+
+        for (k = 0; k < 64; k++) {
+            snprintf(key, sizeof(key), "key%d", k);
+            if (av_dict_get(dict, key, NULL, 0) != linear_get(dict, key, 0))
+                errors++;
+            snprintf(key, sizeof(key), "Key%d", k);
+            if (av_dict_get(dict, key, NULL, AV_DICT_MATCH_CASE) !=
+                linear_get(dict, key, AV_DICT_MATCH_CASE))
+                errors++;
+        }
+    }
+    printf("count: %d, lookup errors: %d\n", av_dict_count(dict), errors);
+    av_dict_free(&dict);
+
+    av_dict_set(&dict, "a", "1", 0);
+    av_dict_set(&dict, "A", "2", AV_DICT_MATCH_CASE);
+    av_dict_set(&dict, "abc", "3", 0);
+    printf("a: %s, A: %s, ab*: %s\n",
+           av_dict_get(dict, "a", NULL, AV_DICT_MATCH_CASE)->value,
+           av_dict_get(dict, "A", NULL, 0)->value,
+           av_dict_get(dict, "ab", NULL, AV_DICT_IGNORE_SUFFIX)->value);
+    av_dict_free(&dict);
+
+    return errors != 0;
+}
+
+#endif
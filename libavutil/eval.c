@@ -156,8 +156,18 @@ struct AVExpr {
     } a;
     struct AVExpr *param[3];
     double *var;
+
+    /* only set in the root node */
+    struct AVExpr **code;       ///< nodes in postfix order, NULL if not compiled
+    int code_len;
+    int scalar_code;            ///< code can be used for av_expr_eval()
+    int nb_consts;
+    double *consts;             ///< scratch copy of the constants
 };
 
+#define ROW_SIZE  32
+#define MAX_DEPTH 64
+
 static double etime(double v)
 {
     return av_gettime() * 0.000001;
@@ -297,6 +307,241 @@ static double eval_expr(Parser *p, AVExpr *e)
     return NAN;
 }
 
+/**
+ * Return 1 if evaluating e depends on or changes the state kept in the
+ * variables, or on the time.
+ */
+static int has_state(AVExpr *e)
+{
+    if (!e)
+        return 0;
+    switch (e->type) {
+    case e_ld: case e_st: case e_random: case e_print:
+    case e_while: case e_taylor: case e_root:
+        return 1;
+    case e_func0:
+        if (e->a.func0 == etime)
+            return 1;
+    }
+    return has_state(e->param[0]) || has_state(e->param[1]) || has_state(e->param[2]);
+}
+
+static int has_user_funcs(AVExpr *e)
+{
+    if (!e)
+        return 0;
+    return e->type == e_func1 || e->type == e_func2 ||
+           has_user_funcs(e->param[0]) || has_user_funcs(e->param[1]) ||
+           has_user_funcs(e->param[2]);
+}
+
+/**
+ * Return 1 if a user function may be called in a branch of if() or
+ * ifnot() which is not taken.
+ */
+static int has_conditional_funcs(AVExpr *e)
+{
+    if (!e)
+        return 0;
+    if ((e->type == e_if || e->type == e_ifnot) &&
+        (has_user_funcs(e->param[1]) || has_user_funcs(e->param[2])))
+        return 1;
+    return has_conditional_funcs(e->param[0]) ||
+           has_conditional_funcs(e->param[1]) ||
+           has_conditional_funcs(e->param[2]);
+}
+
+/**
+ * Replace the subexpressions which only depend on numbers by their value.
+ */
+static void fold_constants(AVExpr *e)
+{
+    Parser p = { 0 };
+    int i;
+
+    for (i = 0; i < 3; i++) {
+        if (e->param[i])
+            fold_constants(e->param[i]);
+    }
+    if (e->type == e_value || e->type == e_const ||
+        e->type == e_func1 || e->type == e_func2 || has_state(e))
+        return;
+    for (i = 0; i < 3; i++) {
+        if (e->param[i] && e->param[i]->type != e_value)
+            return;
+    }
+    e->value = eval_expr(&p, e);
+    e->type  = e_value;
+    for (i = 0; i < 3; i++) {
+        av_expr_free(e->param[i]);
+        e->param[i] = NULL;
+    }
+}
+
+static int nb_params(AVExpr *e)
+{
+    return !!e->param[0] + !!e->param[1] + !!e->param[2];
+}
+
+static void emit_code(AVExpr *root, AVExpr *e, int *depth, int *max_depth)
+{
+    int i;
+
+    for (i = 0; i < 3; i++) {
+        if (e->param[i])
+            emit_code(root, e->param[i], depth, max_depth);
+    }
+    root->code[root->code_len++] = e;
+    *depth += 1 - nb_params(e);
+    *max_depth = FFMAX(*max_depth, *depth);
+}
+
+static int count_nodes(AVExpr *e)
+{
+    return e ? 1 + count_nodes(e->param[0]) + count_nodes(e->param[1]) +
+                   count_nodes(e->param[2]) : 0;
+}
+
+/**
+ * Flatten the tree of an expression without state into a postfix
+ * program, which evaluates every node for a row of values at once.
+ */
+static int compile_expr(AVExpr *e)
+{
+    int depth = 0, max_depth = 0;
+
+    if (has_state(e))
+        return 0;
+    e->code = av_malloc(count_nodes(e) * sizeof(*e->code));
+    if (!e->code)
+        return AVERROR(ENOMEM);
+    emit_code(e, e, &depth, &max_depth);
+    if (max_depth > MAX_DEPTH) {
+        av_freep(&e->code);
+        e->code_len = 0;
+        return 0;
+    }
+    e->scalar_code = !has_conditional_funcs(e);
+    return 0;
+}
+
+#define UNARY(expr)                                     \
+    for (i = 0; i < len; i++) {                         \
+        double d = a[i];                                \
+        a[i] = expr;                                    \
+    }                                                   \
+    break
+#define BINARY(expr)                                    \
+    for (i = 0; i < len; i++) {                         \
+        double d = a[i], d2 = b[i];                     \
+        a[i] = expr;                                    \
+    }                                                   \
+    break
+
+/**
+ * Evaluate the compiled expression for n sets of values, row_size at a
+ * time. The stack is kept local so that several threads can evaluate
+ * the same expression.
+ */
+static av_always_inline void eval_code(AVExpr *root, double *res, int n,
+                                       const double *const_values,
+                                       const double * const *var_values,
+                                       void *opaque, int row_size)
+{
+    double stack[MAX_DEPTH * ROW_SIZE];
+    int start, i, k;
+
+    for (start = 0; start < n; start += row_size) {
+        int len = FFMIN(n - start, row_size);
+        int sp = -1;
+
+        for (k = 0; k < root->code_len; k++) {
+            AVExpr *e = root->code[k];
+            double v = e->value, *a, *b, *c;
+
+            sp -= nb_params(e) - 1;
+            a = stack +  sp      * row_size;
+            b = stack + (sp + 1) * row_size;
+            c = stack + (sp + 2) * row_size;
+            switch (e->type) {
+            case e_value:
+                for (i = 0; i < len; i++)
+                    a[i] = v;
+                break;
+            case e_const:
+                if (var_values && var_values[e->a.const_index]) {
+                    const double *src = var_values[e->a.const_index] + start;
+                    for (i = 0; i < len; i++)
+                        a[i] = v * src[i];
+                } else {
+                    double d = v * const_values[e->a.const_index];
+                    for (i = 0; i < len; i++)
+                        a[i] = d;
+                }
+                break;
+            case e_func0:  UNARY(v * e->a.func0(d));
+            case e_func1:  UNARY(v * e->a.func1(opaque, d));
+            case e_func2:  BINARY(v * e->a.func2(opaque, d, d2));
+            case e_squish: UNARY(1/(1+exp(4*d)));
+            case e_gauss:  UNARY(exp(-d*d/2)/sqrt(2*M_PI));
+            case e_isnan:  UNARY(v * !!isnan(d));
+            case e_isinf:  UNARY(v * !!isinf(d));
+            case e_floor:  UNARY(v * floor(d));
+            case e_ceil:   UNARY(v * ceil (d));
+            case e_trunc:  UNARY(v * trunc(d));
+            case e_sqrt:   UNARY(v * sqrt (d));
+            case e_not:    UNARY(v * (d == 0));
+            case e_if:
+                if (e->param[2]) {
+                    for (i = 0; i < len; i++)
+                        a[i] = v * (a[i] ? b[i] : c[i]);
+                } else {
+                    for (i = 0; i < len; i++)
+                        a[i] = v * (a[i] ? b[i] : 0);
+                }
+                break;
+            case e_ifnot:
+                if (e->param[2]) {
+                    for (i = 0; i < len; i++)
+                        a[i] = v * (!a[i] ? b[i] : c[i]);
+                } else {
+                    for (i = 0; i < len; i++)
+                        a[i] = v * (!a[i] ? b[i] : 0);
+                }
+                break;
+            case e_between:
+                for (i = 0; i < len; i++)
+                    a[i] = v * (a[i] >= b[i] && a[i] <= c[i]);
+                break;
+            case e_mod: BINARY(v * (d - floor((!CONFIG_FTRAPV || d2) ? d / d2 : d * INFINITY) * d2));
+            case e_gcd: BINARY(v * av_gcd(d,d2));
+            case e_max: BINARY(v * (d >  d2 ?   d : d2));
+            case e_min: BINARY(v * (d <  d2 ?   d : d2));
+            case e_eq:  BINARY(v * (d == d2 ? 1.0 : 0.0));
+            case e_gt:  BINARY(v * (d >  d2 ? 1.0 : 0.0));
+            case e_gte: BINARY(v * (d >= d2 ? 1.0 : 0.0));
+            case e_lt:  BINARY(v * (d <  d2 ? 1.0 : 0.0));
+            case e_lte: BINARY(v * (d <= d2 ? 1.0 : 0.0));
+            case e_pow: BINARY(v * pow(d, d2));
+            case e_mul: BINARY(v * (d * d2));
+            case e_div: BINARY(v * ((!CONFIG_FTRAPV || d2 ) ? (d / d2) : d * INFINITY));
+            case e_add: BINARY(v * (d + d2));
+            case e_last:
+                for (i = 0; i < len; i++)
+                    a[i] = v * b[i];
+                break;
+            case e_hypot:BINARY(v * (sqrt(d*d + d2*d2)));
+            case e_bitand: BINARY(isnan(d) || isnan(d2) ? NAN : v * ((long int)d & (long int)d2));
+            case e_bitor:  BINARY(isnan(d) || isnan(d2) ? NAN : v * ((long int)d | (long int)d2));
+            default:
+                for (i = 0; i < len; i++)
+                    a[i] = NAN;
+            }
+        }
+        memcpy(res + start, stack, len * sizeof(*res));
+    }
+}
+
 static int parse_expr(AVExpr **e, Parser *p);
 
 void av_expr_free(AVExpr *e)
@@ -306,6 +551,8 @@ void av_expr_free(AVExpr *e)
     av_expr_free(e->param[1]);
     av_expr_free(e->param[2]);
     av_freep(&e->var);
+    av_freep(&e->code);
+    av_freep(&e->consts);
     av_freep(&e);
 }
 
@@ -681,7 +928,17 @@ int av_expr_parse(AVExpr **expr, const char *s,
         ret = AVERROR(EINVAL);
         goto end;
     }
-    e->var= av_mallocz(sizeof(double) *VARS);
+    fold_constants(e);
+    while (const_names && const_names[e->nb_consts])
+        e->nb_consts++;
+    e->var    = av_mallocz(sizeof(double) *VARS);
+    e->consts = av_malloc_array(e->nb_consts, sizeof(*e->consts));
+    if (!e->var || (e->nb_consts && !e->consts) ||
+        (ret = compile_expr(e)) < 0) {
+        av_expr_free(e);
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
     *expr = e;
 end:
     av_free(w);
@@ -691,6 +948,13 @@ end:
 double av_expr_eval(AVExpr *e, const double *const_values, void *opaque)
 {
     Parser p = { 0 };
+    double d;
+
+    if (e->scalar_code) {
+        eval_code(e, &d, 1, const_values, NULL, opaque, 1);
+        return d;
+    }
+
     p.var= e->var;
 
     p.const_values = const_values;
@@ -698,6 +962,28 @@ double av_expr_eval(AVExpr *e, const double *const_values, void *opaque)
     return eval_expr(&p, e);
 }
 
+void av_expr_eval_array(AVExpr *e, double *res, int n,
+                        const double *const_values,
+                        const double * const *var_values, void *opaque)
+{
+    int i, j;
+
+    if (e->code) {
+        eval_code(e, res, n, const_values, var_values, opaque, ROW_SIZE);
+        return;
+    }
+
+    /* the state must be updated in order, evaluate one by one */
+    if (e->nb_consts)
+        memcpy(e->consts, const_values, e->nb_consts * sizeof(*e->consts));
+    for (i = 0; i < n; i++) {
+        for (j = 0; var_values && j < e->nb_consts; j++)
+            if (var_values[j])
+                e->consts[j] = var_values[j][i];
+        res[i] = av_expr_eval(e, e->consts, opaque);
+    }
+}
+
 int av_expr_parse_and_eval(double *d, const char *s,
                            const char * const *const_names, const double *const_values,
                            const char * const *func1_names, double (* const *funcs1)(void *, double),
@@ -831,6 +1117,12 @@ int main(int argc, char **argv)
         "between(1,2)",
         NULL
     };
+    static const char *const array_exprs[] = {
+        "if(gt(X,0), X*Y, between(X,-5,-2)) + max(-1, mod(X, 7)) - 2^3",
+        "ifnot(X, 1/X, sqrt(Y)) * bitor(X, 5) + hypot(X, Y) / floor(X/3)",
+        "st(0, ld(0) + X); ld(0)",
+        NULL
+    };
 
     for (expr = exprs; *expr; expr++) {
         printf("Evaluating '%s'\n", *expr);
@@ -852,6 +1144,29 @@ int main(int argc, char **argv)
                            NULL, NULL, NULL, NULL, NULL, 0, NULL);
     printf("%f == 0.931322575\n", d);
 
+    for (expr = array_exprs; *expr; expr++) {
+        static const char *const names[] = { "X", "Y", NULL };
+        double values[] = { 0, 3 }, xs[100], res[100];
+        const double *var_values[] = { xs, NULL };
+        AVExpr *e;
+        int mismatches = 0;
+
+        for (i = 0; i < 100; i++)
+            xs[i] = i - 50;
+        av_expr_parse(&e, *expr, names, NULL, NULL, NULL, NULL, 0, NULL);
+        av_expr_eval_array(e, res, 100, values, var_values, NULL);
+        av_expr_free(e);
+        av_expr_parse(&e, *expr, names, NULL, NULL, NULL, NULL, 0, NULL);
+        for (i = 0; i < 100; i++) {
+            values[0] = xs[i];
+            d = av_expr_eval(e, values, NULL);
+            mismatches += memcmp(&d, &res[i], sizeof(d)) != 0;
+        }
+        av_expr_free(e);
+        printf("'%s' for X in [-50,49] -> %f .. %f, %d mismatches\n",
+               *expr, res[0], res[99], mismatches);
+    }
+
     if (argc > 1 && !strcmp(argv[1], "-t")) {
         for (i = 0; i < 1050; i++) {
             START_TIMER;
@@ -86,6 +86,25 @@ int av_expr_parse(AVExpr **expr, const char *s,
  */
 double av_expr_eval(AVExpr *e, const double *const_values, void *opaque);
 
+/**
+ * Evaluate a previously parsed expression for n sets of values at once,
+ * which is much faster than calling av_expr_eval() n times.
+ *
+ * The functions passed to av_expr_parse() may be called for the branches
+ * of if() and ifnot() which are not taken, so they must not have side
+ * effects.
+ *
+ * @param res an array where to store the n results
+ * @param const_values a zero terminated array of values for the identifiers from av_expr_parse() const_names
+ * @param var_values NULL, or an array with one entry per identifier from
+ * av_expr_parse() const_names: if var_values[i] is not NULL, it is an
+ * array of n values which replace const_values[i] in each evaluation
+ * @param opaque a pointer which will be passed to all functions from funcs1 and funcs2
+ */
+void av_expr_eval_array(AVExpr *e, double *res, int n,
+                        const double *const_values,
+                        const double * const *var_values, void *opaque);
+
 /**
  * Free a parsed expression previously created with av_expr_parse().
  */
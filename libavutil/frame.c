@@ -26,6 +26,7 @@
 #include "imgutils.h"
 #include "mem.h"
 #include "samplefmt.h"
+#include "time.h"
 
 #define MAKE_ACCESSORS(str, name, type, field) \
     type av_##name##_get_##field(const str *s) { return s->field; } \
@@ -564,3 +565,33 @@ AVFrameSideData *av_frame_get_side_data(AVFrame *frame,
     }
     return NULL;
 }
+
+void av_latency_trace_stamp(AVLatencyTrace *trace, enum AVLatencyStage stage)
+{
+    if ((unsigned)stage < AV_LATENCY_NB && !trace->stamp[stage])
+        trace->stamp[stage] = av_gettime_relative();
+}
+
+void av_frame_latency_trace_stamp(AVFrame *frame, enum AVLatencyStage stage)
+{
+    AVFrameSideData *sd = av_frame_get_side_data(frame, AV_FRAME_DATA_LATENCY_TRACE);
+
+    if (sd && sd->size >= sizeof(AVLatencyTrace))
+        av_latency_trace_stamp((AVLatencyTrace *)sd->data, stage);
+}
+
+const char *av_latency_stage_name(enum AVLatencyStage stage)
+{
+    static const char *const names[AV_LATENCY_NB] = {
+        [AV_LATENCY_DEMUX]      = "demux",
+        [AV_LATENCY_DECODE]     = "decode",
+        [AV_LATENCY_FILTER_IN]  = "filter_in",
+        [AV_LATENCY_FILTER_OUT] = "filter_out",
+        [AV_LATENCY_ENCODE_IN]  = "encode_in",
+        [AV_LATENCY_ENCODE_OUT] = "encode_out",
+        [AV_LATENCY_MUX]        = "mux",
+    };
+    if ((unsigned)stage >= AV_LATENCY_NB)
+        return NULL;
+    return names[stage];
+}
@@ -35,8 +35,46 @@ enum AVFrameSideDataType {
      * The data is the AVPanScan struct defined in libavcodec.
      */
     AV_FRAME_DATA_PANSCAN,
+    /**
+     * The data is the AVLatencyTrace struct, carried over from the
+     * AV_PKT_DATA_LATENCY_TRACE side data of the packet the frame was decoded
+     * from.
+     */
+    AV_FRAME_DATA_LATENCY_TRACE,
+};
+
+/**
+ * The stages of the processing chain at which a latency trace is stamped.
+ * New stages may be appended with a minor bump.
+ */
+enum AVLatencyStage {
+    AV_LATENCY_DEMUX,       ///< packet returned by av_read_frame()
+    AV_LATENCY_DECODE,      ///< frame returned by the decoder
+    AV_LATENCY_FILTER_IN,   ///< frame sent to a buffer source
+    AV_LATENCY_FILTER_OUT,  ///< frame returned by a buffer sink
+    AV_LATENCY_ENCODE_IN,   ///< frame sent to the encoder
+    AV_LATENCY_ENCODE_OUT,  ///< packet returned by the encoder
+    AV_LATENCY_MUX,         ///< packet sent to the muxer
+    AV_LATENCY_NB           ///< Number of stages, not part of the ABI
 };
 
+/**
+ * Monotonic timestamps of a packet or frame going through the processing
+ * chain, exported as the AV_PKT_DATA_LATENCY_TRACE and
+ * AV_FRAME_DATA_LATENCY_TRACE side data.
+ *
+ * The trace is created by the demuxer when the AVFMT_FLAG_LATENCY_TRACE flag
+ * is set, and follows the data through decoders, filters, encoders and
+ * muxers, each of them stamping its own stage.
+ */
+typedef struct AVLatencyTrace {
+    /**
+     * av_gettime_relative() time at which each stage was reached, 0 for the
+     * stages which were not reached (yet).
+     */
+    int64_t stamp[AV_LATENCY_NB];
+} AVLatencyTrace;
+
 typedef struct AVFrameSideData {
     enum AVFrameSideDataType type;
     uint8_t *data;
@@ -604,4 +642,21 @@ AVFrameSideData *av_frame_new_side_data(AVFrame *frame,
 AVFrameSideData *av_frame_get_side_data(AVFrame *frame,
                                         enum AVFrameSideDataType type);
 
+/**
+ * Stamp a stage of a latency trace with the current time, unless it was
+ * already stamped.
+ */
+void av_latency_trace_stamp(AVLatencyTrace *trace, enum AVLatencyStage stage);
+
+/**
+ * Stamp a stage of the AV_FRAME_DATA_LATENCY_TRACE side data of a frame,
+ * if it carries one.
+ */
+void av_frame_latency_trace_stamp(AVFrame *frame, enum AVLatencyStage stage);
+
+/**
+ * @return a string describing the given latency stage, NULL if it is unknown
+ */
+const char *av_latency_stage_name(enum AVLatencyStage stage);
+
 #endif /* AVUTIL_FRAME_H */
@@ -24,6 +24,7 @@
 #include "avassert.h"
 #include "common.h"
 #include "imgutils.h"
+#include "imgutils_internal.h"
 #include "internal.h"
 #include "intreadwrite.h"
 #include "log.h"
@@ -239,14 +240,23 @@ int av_image_check_size(unsigned int w, unsigned int h, int log_offset, void *lo
     return AVERROR(EINVAL);
 }
 
-void av_image_copy_plane(uint8_t       *dst, int dst_linesize,
-                         const uint8_t *src, int src_linesize,
-                         int bytewidth, int height)
+/* Planes of at least this size are copied with non-temporal stores: they
+   would evict most of the cache, and the next stage will not find them
+   there anyway. */
+#define NT_COPY_THRESHOLD (8 << 20)
+
+static void image_copy_plane(uint8_t       *dst, int dst_linesize,
+                             const uint8_t *src, int src_linesize,
+                             int bytewidth, int height, int uc_src)
 {
     if (!dst || !src)
         return;
     av_assert0(abs(src_linesize) >= bytewidth);
     av_assert0(abs(dst_linesize) >= bytewidth);
+    if (ARCH_X86 && (uc_src || (int64_t)bytewidth * height >= NT_COPY_THRESHOLD) &&
+        ff_image_copy_plane_x86(dst, dst_linesize, src, src_linesize,
+                                bytewidth, height, uc_src) >= 0)
+        return;
     for (;height > 0; height--) {
         memcpy(dst, src, bytewidth);
         dst += dst_linesize;
@@ -254,9 +264,24 @@ void av_image_copy_plane(uint8_t       *dst, int dst_linesize,
     }
 }
 
-void av_image_copy(uint8_t *dst_data[4], int dst_linesizes[4],
-                   const uint8_t *src_data[4], const int src_linesizes[4],
-                   enum AVPixelFormat pix_fmt, int width, int height)
+void av_image_copy_plane(uint8_t       *dst, int dst_linesize,
+                         const uint8_t *src, int src_linesize,
+                         int bytewidth, int height)
+{
+    image_copy_plane(dst, dst_linesize, src, src_linesize, bytewidth, height, 0);
+}
+
+void av_image_copy_plane_uc_from(uint8_t       *dst, int dst_linesize,
+                                 const uint8_t *src, int src_linesize,
+                                 int bytewidth, int height)
+{
+    image_copy_plane(dst, dst_linesize, src, src_linesize, bytewidth, height, 1);
+}
+
+static void image_copy(uint8_t *dst_data[4], int dst_linesizes[4],
+                       const uint8_t *src_data[4], const int src_linesizes[4],
+                       enum AVPixelFormat pix_fmt, int width, int height,
+                       int uc_src)
 {
     const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(pix_fmt);
 
@@ -265,9 +290,9 @@ void av_image_copy(uint8_t *dst_data[4], int dst_linesizes[4],
 
     if (desc->flags & AV_PIX_FMT_FLAG_PAL ||
         desc->flags & AV_PIX_FMT_FLAG_PSEUDOPAL) {
-        av_image_copy_plane(dst_data[0], dst_linesizes[0],
-                            src_data[0], src_linesizes[0],
-                            width, height);
+        image_copy_plane(dst_data[0], dst_linesizes[0],
+                         src_data[0], src_linesizes[0],
+                         width, height, uc_src);
         /* copy the palette */
         memcpy(dst_data[1], src_data[1], 4*256);
     } else {
@@ -286,13 +311,29 @@ void av_image_copy(uint8_t *dst_data[4], int dst_linesizes[4],
             if (i == 1 || i == 2) {
                 h = FF_CEIL_RSHIFT(height, desc->log2_chroma_h);
             }
-            av_image_copy_plane(dst_data[i], dst_linesizes[i],
-                                src_data[i], src_linesizes[i],
-                                bwidth, h);
+            image_copy_plane(dst_data[i], dst_linesizes[i],
+                             src_data[i], src_linesizes[i],
+                             bwidth, h, uc_src);
         }
     }
 }
 
+void av_image_copy(uint8_t *dst_data[4], int dst_linesizes[4],
+                   const uint8_t *src_data[4], const int src_linesizes[4],
+                   enum AVPixelFormat pix_fmt, int width, int height)
+{
+    image_copy(dst_data, dst_linesizes, src_data, src_linesizes,
+               pix_fmt, width, height, 0);
+}
+
+void av_image_copy_uc_from(uint8_t *dst_data[4], int dst_linesizes[4],
+                           const uint8_t *src_data[4], const int src_linesizes[4],
+                           enum AVPixelFormat pix_fmt, int width, int height)
+{
+    image_copy(dst_data, dst_linesizes, src_data, src_linesizes,
+               pix_fmt, width, height, 1);
+}
+
 int av_image_fill_arrays(uint8_t *dst_data[4], int dst_linesize[4],
                          const uint8_t *src,
                          enum AVPixelFormat pix_fmt, int width, int height, int align)
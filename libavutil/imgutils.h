@@ -119,6 +119,25 @@ void av_image_copy(uint8_t *dst_data[4], int dst_linesizes[4],
                    const uint8_t *src_data[4], const int src_linesizes[4],
                    enum AVPixelFormat pix_fmt, int width, int height);
 
+/**
+ * Copy image plane from src to dst, like av_image_copy_plane(), but for
+ * a source in uncacheable, write-combining memory, such as a mapped
+ * hardware surface, which is very slow to read with normal loads.
+ */
+void av_image_copy_plane_uc_from(uint8_t       *dst, int dst_linesize,
+                                 const uint8_t *src, int src_linesize,
+                                 int bytewidth, int height);
+
+/**
+ * Copy image in src_data to dst_data, like av_image_copy(), but for a
+ * source in uncacheable, write-combining memory.
+ *
+ * @see av_image_copy_plane_uc_from()
+ */
+void av_image_copy_uc_from(uint8_t *dst_data[4], int dst_linesizes[4],
+                           const uint8_t *src_data[4], const int src_linesizes[4],
+                           enum AVPixelFormat pix_fmt, int width, int height);
+
 /**
  * Setup the data pointers and linesizes based on the specified image
  * parameters and the provided array.
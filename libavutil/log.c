@@ -38,9 +38,26 @@
 #include "common.h"
 #include "internal.h"
 #include "log.h"
+#include "thread.h"
+#include "time.h"
 
 #define LINE_SZ 1024
 
+/* AV_LOG_RATE_LIMIT: messages printed per call site and period */
+#define RATE_LIMIT_SITES  64
+#define RATE_LIMIT_BURST  10
+#define RATE_LIMIT_PERIOD 1000000
+
+typedef struct LogSite {
+    const char *fmt;
+    int64_t start;      ///< start of the current period
+    int count;          ///< messages printed in the current period
+    int dropped;        ///< messages dropped since the last one printed
+} LogSite;
+
+static AVMutex log_lock = AV_MUTEX_INITIALIZER;
+static LogSite log_sites[RATE_LIMIT_SITES];
+
 static int av_log_level = AV_LOG_INFO;
 static int flags;
 
@@ -202,18 +219,59 @@ void av_log_format_line(void *ptr, int level, const char *fmt, va_list vl,
     snprintf(line, line_size, "%s%s%s", part[0], part[1], part[2]);
 }
 
+/**
+ * Check whether a message starting a line is over the rate limit of its
+ * call site, and return the number of messages dropped before it otherwise.
+ */
+static int rate_limit(const char *fmt, int *dropped)
+{
+    LogSite *site = &log_sites[((uintptr_t)fmt >> 3) % RATE_LIMIT_SITES];
+    int64_t now = av_gettime();
+
+    if (site->fmt != fmt || now - site->start >= RATE_LIMIT_PERIOD) {
+        if (site->fmt != fmt)
+            site->dropped = 0;
+        site->fmt   = fmt;
+        site->start = now;
+        site->count = 0;
+    }
+    if (site->count >= RATE_LIMIT_BURST) {
+        site->dropped++;
+        return 1;
+    }
+    site->count++;
+    *dropped = site->dropped;
+    site->dropped = 0;
+    return 0;
+}
+
 void av_log_default_callback(void* ptr, int level, const char* fmt, va_list vl)
 {
     static int print_prefix = 1;
     static int count;
+    static int skip_line;
     static char prev[LINE_SZ];
     char part[3][LINE_SZ];
     char line[LINE_SZ];
     static int is_atty;
     int type[2];
+    int dropped = 0;
 
     if (level > av_log_level)
         return;
+
+    ff_mutex_lock(&log_lock);
+    if ((flags & AV_LOG_RATE_LIMIT) && level > AV_LOG_FATAL && level <= AV_LOG_WARNING) {
+        /* only whole lines are dropped, without formatting them */
+        if (print_prefix)
+            skip_line = rate_limit(fmt, &dropped);
+        if (skip_line) {
+            size_t len = strlen(fmt);
+            print_prefix = len && fmt[len - 1] == '\n';
+            skip_line    = !print_prefix;
+            goto end;
+        }
+    }
     format_line(ptr, level, fmt, vl, part, sizeof(part[0]), &print_prefix, type);
     snprintf(line, sizeof(line), "%s%s%s", part[0], part[1], part[2]);
 
@@ -226,12 +284,23 @@ void av_log_default_callback(void* ptr, int level, const char* fmt, va_list vl)
         count++;
         if (is_atty == 1)
             fprintf(stderr, "    Last message repeated %d times\r", count);
-        return;
+        goto end;
     }
     if (count > 0) {
         fprintf(stderr, "    Last message repeated %d times\n", count);
         count = 0;
     }
+    if (level == AV_LOG_QUIET) {
+        /* flush the counts of the messages still dropped */
+        int i;
+        for (i = 0; i < RATE_LIMIT_SITES; i++) {
+            dropped += log_sites[i].dropped;
+            log_sites[i].dropped = 0;
+        }
+        if (dropped > 0)
+            fprintf(stderr, "    %d messages suppressed by the rate limit\n", dropped);
+    } else if (dropped > 0)
+        fprintf(stderr, "    %d messages like the next one suppressed\n", dropped);
     strcpy(prev, line);
     sanitize(part[0]);
     colored_fputs(type[0], part[0]);
@@ -239,6 +308,8 @@ void av_log_default_callback(void* ptr, int level, const char* fmt, va_list vl)
     colored_fputs(type[1], part[1]);
     sanitize(part[2]);
     colored_fputs(av_clip(level >> 3, 0, 6), part[2]);
+end:
+    ff_mutex_unlock(&log_lock);
 }
 
 static void (*av_log_callback)(void*, int, const char*, va_list) =
@@ -217,6 +217,13 @@ void av_log_format_line(void *ptr, int level, const char *fmt, va_list vl,
  * call av_log(NULL, AV_LOG_QUIET, "%s", ""); at the end
  */
 #define AV_LOG_SKIP_REPEATED 1
+/**
+ * Limit the rate of the warning and error messages printed from each call
+ * site, identified by its format string. Messages over the limit are
+ * dropped without being formatted, and their number is printed with the
+ * next message from the same call site once the limit is lifted.
+ */
+#define AV_LOG_RATE_LIMIT 2
 void av_log_set_flags(int arg);
 
 #endif /* AVUTIL_LOG_H */
@@ -20,10 +20,14 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include <stdio.h>
+
 #include "opencl.h"
+#include "opencl_internal.h"
 #include "avstring.h"
 #include "log.h"
 #include "avassert.h"
+#include "md5.h"
 #include "opt.h"
 
 #if HAVE_PTHREADS
@@ -42,12 +46,20 @@ static pthread_mutex_t atomic_opencl_lock = PTHREAD_MUTEX_INITIALIZER;
 
 #define MAX_KERNEL_NUM 500
 #define MAX_KERNEL_CODE_NUM 200
+#define MAX_POOLED_BUFFERS 16
+#define MAX_PROGRAM_BINARY_SIZE (64 << 20)
 
 typedef struct {
     int is_compiled;
     const char *kernel_string;
 } KernelCode;
 
+typedef struct {
+    cl_mem buffer;
+    size_t size;
+    cl_mem_flags flags;
+} PooledBuffer;
+
 typedef struct {
     const AVClass *class;
     int log_offset;
@@ -62,6 +74,7 @@ typedef struct {
     int platform_idx;
     int device_idx;
     char *build_options;
+    char *binary_cache_dir;
     cl_platform_id platform_id;
     cl_device_type device_type;
     cl_context context;
@@ -73,6 +86,12 @@ typedef struct {
     KernelCode kernel_code[MAX_KERNEL_CODE_NUM];
     int kernel_count;
     AVOpenCLDeviceList device_list;
+    /**
+     * buffers released while the environment is in use, handed out again
+     * by av_opencl_buffer_create() instead of allocating device memory
+     */
+    int pooled_buffer_count;
+    PooledBuffer pooled_buffers[MAX_POOLED_BUFFERS];
 } OpenclContext;
 
 #define OFFSET(x) offsetof(OpenclContext, x)
@@ -81,6 +100,7 @@ static const AVOption opencl_options[] = {
      { "platform_idx",        "set platform index value",  OFFSET(platform_idx),  AV_OPT_TYPE_INT,    {.i64=-1}, -1, INT_MAX},
      { "device_idx",          "set device index value",    OFFSET(device_idx),    AV_OPT_TYPE_INT,    {.i64=-1}, -1, INT_MAX},
      { "build_options",       "build options of opencl",   OFFSET(build_options), AV_OPT_TYPE_STRING, {.str="-I."},  CHAR_MIN, CHAR_MAX},
+     { "binary_cache_dir",    "directory where to cache the compiled kernels", OFFSET(binary_cache_dir), AV_OPT_TYPE_STRING, {.str=NULL}, CHAR_MIN, CHAR_MAX},
      { NULL }
 };
 
@@ -542,10 +562,155 @@ static int init_opencl_env(OpenclContext *opencl_ctx, AVOpenCLExternalEnv *ext_o
     return ret;
 }
 
+/**
+ * Build the name of the file caching the binary of the program made of
+ * the given kernel code, for the current device, driver and build options.
+ */
+static int get_binary_cache_path(OpenclContext *opencl_ctx, char *path, int path_size,
+                                 const char **kernel_code, int kernel_code_count)
+{
+    static const cl_device_info infos[] = { CL_DEVICE_NAME, CL_DEVICE_VERSION, CL_DRIVER_VERSION };
+    struct AVMD5 *md5 = av_md5_alloc();
+    uint8_t digest[16];
+    char info[256];
+    int i;
+
+    if (!md5)
+        return AVERROR(ENOMEM);
+    av_md5_init(md5);
+    for (i = 0; i < FF_ARRAY_ELEMS(infos); i++) {
+        if (clGetDeviceInfo(opencl_ctx->device_id, infos[i], sizeof(info), info, NULL) != CL_SUCCESS)
+            info[0] = 0;
+        info[sizeof(info) - 1] = 0;
+        av_md5_update(md5, info, strlen(info) + 1);
+    }
+    if (opencl_ctx->build_options)
+        av_md5_update(md5, opencl_ctx->build_options, strlen(opencl_ctx->build_options));
+    av_md5_update(md5, "", 1);
+    for (i = 0; i < kernel_code_count; i++)
+        av_md5_update(md5, kernel_code[i], strlen(kernel_code[i]) + 1);
+    av_md5_final(md5, digest);
+    av_free(md5);
+
+    snprintf(path, path_size, "%s/ffmpeg-opencl-", opencl_ctx->binary_cache_dir);
+    for (i = 0; i < 16; i++)
+        av_strlcatf(path, path_size, "%02x", digest[i]);
+    av_strlcat(path, ".bin", path_size);
+    return 0;
+}
+
+/**
+ * Create and build the program from the binary cached in path.
+ *
+ * @return the program, or NULL if there is no usable binary in the cache
+ */
+static cl_program load_program_binary(OpenclContext *opencl_ctx, const char *path)
+{
+    cl_program program = NULL;
+    cl_int status, binary_status;
+    unsigned char *binary = NULL;
+    long pos;
+    size_t size;
+    FILE *f = fopen(path, "rb");
+
+    if (!f)
+        return NULL;
+    if (fseek(f, 0, SEEK_END) < 0 || (pos = ftell(f)) <= 0 ||
+        pos > MAX_PROGRAM_BINARY_SIZE || fseek(f, 0, SEEK_SET) < 0)
+        goto end;
+    size   = pos;
+    binary = av_malloc(size);
+    if (!binary || fread(binary, 1, size, f) != size)
+        goto end;
+    program = clCreateProgramWithBinary(opencl_ctx->context, 1, &opencl_ctx->device_id,
+                                        &size, (const unsigned char **)&binary,
+                                        &binary_status, &status);
+    if (status != CL_SUCCESS || binary_status != CL_SUCCESS) {
+        program = NULL;
+        goto end;
+    }
+    status = clBuildProgram(program, 1, &opencl_ctx->device_id,
+                            opencl_ctx->build_options, NULL, NULL);
+    if (status != CL_SUCCESS) {
+        clReleaseProgram(program);
+        program = NULL;
+        goto end;
+    }
+    av_log(opencl_ctx, AV_LOG_VERBOSE, "Loaded OpenCL program binary from %s\n", path);
+end:
+    if (!program)
+        av_log(opencl_ctx, AV_LOG_VERBOSE, "No usable OpenCL program binary in %s\n", path);
+    av_free(binary);
+    fclose(f);
+    return program;
+}
+
+/**
+ * Store the binary of a built program in path. Failures are not fatal,
+ * the kernels are then simply compiled again the next time.
+ */
+static void save_program_binary(OpenclContext *opencl_ctx, cl_program program, const char *path)
+{
+    cl_uint i, device_num;
+    cl_device_id *devices = NULL;
+    size_t *sizes = NULL;
+    unsigned char **binaries = NULL;
+    char tmp_path[1024];
+    FILE *f;
+
+    if (clGetProgramInfo(program, CL_PROGRAM_NUM_DEVICES, sizeof(device_num), &device_num, NULL) != CL_SUCCESS ||
+        !device_num)
+        return;
+    devices  = av_mallocz(device_num * sizeof(*devices));
+    sizes    = av_mallocz(device_num * sizeof(*sizes));
+    binaries = av_mallocz(device_num * sizeof(*binaries));
+    if (!devices || !sizes || !binaries)
+        goto end;
+    if (clGetProgramInfo(program, CL_PROGRAM_DEVICES, device_num * sizeof(*devices), devices, NULL) != CL_SUCCESS ||
+        clGetProgramInfo(program, CL_PROGRAM_BINARY_SIZES, device_num * sizeof(*sizes), sizes, NULL) != CL_SUCCESS)
+        goto end;
+    for (i = 0; i < device_num; i++)
+        if (devices[i] == opencl_ctx->device_id)
+            break;
+    if (i == device_num || !sizes[i] || sizes[i] > MAX_PROGRAM_BINARY_SIZE)
+        goto end;
+    /* binaries are only returned for the devices with a non-NULL pointer */
+    binaries[i] = av_malloc(sizes[i]);
+    if (!binaries[i] ||
+        clGetProgramInfo(program, CL_PROGRAM_BINARIES, device_num * sizeof(*binaries), binaries, NULL) != CL_SUCCESS)
+        goto end;
+
+    /* write to a temporary file first, so that another process never
+       reads a partially written binary */
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    f = fopen(tmp_path, "wb");
+    if (!f)
+        goto end;
+    if (fwrite(binaries[i], 1, sizes[i], f) != sizes[i]) {
+        fclose(f);
+        remove(tmp_path);
+        goto end;
+    }
+    fclose(f);
+    if (rename(tmp_path, path) < 0)
+        remove(tmp_path);
+    else
+        av_log(opencl_ctx, AV_LOG_VERBOSE, "Saved OpenCL program binary to %s\n", path);
+end:
+    if (binaries)
+        for (i = 0; i < device_num; i++)
+            av_free(binaries[i]);
+    av_free(binaries);
+    av_free(sizes);
+    av_free(devices);
+}
+
 static int compile_kernel_file(OpenclContext *opencl_ctx)
 {
     cl_int status;
-    int i, kernel_code_count = 0;
+    cl_program program = NULL;
+    char cache_path[1024];
+    int i, kernel_code_count = 0, use_cache = 0;
     const char *kernel_code[MAX_KERNEL_CODE_NUM] = {NULL};
     size_t kernel_code_len[MAX_KERNEL_CODE_NUM] = {0};
 
@@ -559,6 +724,16 @@ static int compile_kernel_file(OpenclContext *opencl_ctx)
     }
     if (!kernel_code_count)
         return 0;
+    if (opencl_ctx->binary_cache_dir && *opencl_ctx->binary_cache_dir) {
+        use_cache = get_binary_cache_path(opencl_ctx, cache_path, sizeof(cache_path),
+                                          kernel_code, kernel_code_count) >= 0;
+        if (use_cache)
+            program = load_program_binary(opencl_ctx, cache_path);
+    }
+    if (program) {
+        opencl_ctx->programs[opencl_ctx->program_count++] = program;
+        return 0;
+    }
     /* create a CL program using the kernel source */
     opencl_ctx->programs[opencl_ctx->program_count] = clCreateProgramWithSource(opencl_ctx->context,
                                                                                 kernel_code_count,
@@ -581,6 +756,8 @@ static int compile_kernel_file(OpenclContext *opencl_ctx)
                "Could not compile OpenCL kernel: %s\n", av_opencl_errstr(status));
         return AVERROR_EXTERNAL;
     }
+    if (use_cache)
+        save_program_binary(opencl_ctx, opencl_ctx->programs[opencl_ctx->program_count], cache_path);
     opencl_ctx->program_count++;
     return 0;
 }
@@ -614,12 +791,29 @@ end:
     return ret;
 }
 
+static void free_pooled_buffers(OpenclContext *opencl_ctx)
+{
+    cl_int status;
+    int i;
+
+    for (i = 0; i < opencl_ctx->pooled_buffer_count; i++) {
+        status = clReleaseMemObject(opencl_ctx->pooled_buffers[i].buffer);
+        if (status != CL_SUCCESS) {
+            av_log(opencl_ctx, AV_LOG_ERROR,
+                   "Could not release OpenCL buffer: %s\n", av_opencl_errstr(status));
+        }
+    }
+    opencl_ctx->pooled_buffer_count = 0;
+}
+
 void av_opencl_uninit(void)
 {
     cl_int status;
     int i;
     LOCK_OPENCL;
     opencl_ctx.init_count--;
+    if (opencl_ctx.init_count <= 0)
+        free_pooled_buffers(&opencl_ctx);
     if (opencl_ctx.is_user_created)
         goto end;
     if (opencl_ctx.init_count > 0 || opencl_ctx.kernel_count > 0)
@@ -660,6 +854,21 @@ end:
 int av_opencl_buffer_create(cl_mem *cl_buf, size_t cl_buf_size, int flags, void *host_ptr)
 {
     cl_int status;
+    int i;
+
+    if (!host_ptr) {
+        LOCK_OPENCL;
+        for (i = 0; i < opencl_ctx.pooled_buffer_count; i++) {
+            PooledBuffer *pooled = &opencl_ctx.pooled_buffers[i];
+            if (pooled->size == cl_buf_size && pooled->flags == flags) {
+                *cl_buf = pooled->buffer;
+                *pooled = opencl_ctx.pooled_buffers[--opencl_ctx.pooled_buffer_count];
+                UNLOCK_OPENCL;
+                return 0;
+            }
+        }
+        UNLOCK_OPENCL;
+    }
     *cl_buf = clCreateBuffer(opencl_ctx.context, flags, cl_buf_size, host_ptr, &status);
     if (status != CL_SUCCESS) {
         av_log(&opencl_ctx, AV_LOG_ERROR, "Could not create OpenCL buffer: %s\n", av_opencl_errstr(status));
@@ -671,8 +880,25 @@ int av_opencl_buffer_create(cl_mem *cl_buf, size_t cl_buf_size, int flags, void
 void av_opencl_buffer_release(cl_mem *cl_buf)
 {
     cl_int status = 0;
-    if (!cl_buf)
+    PooledBuffer pooled;
+    if (!cl_buf || !*cl_buf)
         return;
+    /* keep buffers not tied to host memory for the next
+       av_opencl_buffer_create() of the same size, e.g. from the next
+       instance of a filter when the graph is reconfigured */
+    if (clGetMemObjectInfo(*cl_buf, CL_MEM_SIZE,  sizeof(pooled.size),  &pooled.size,  NULL) == CL_SUCCESS &&
+        clGetMemObjectInfo(*cl_buf, CL_MEM_FLAGS, sizeof(pooled.flags), &pooled.flags, NULL) == CL_SUCCESS &&
+        !(pooled.flags & (CL_MEM_USE_HOST_PTR | CL_MEM_COPY_HOST_PTR))) {
+        LOCK_OPENCL;
+        if (opencl_ctx.init_count > 0 && opencl_ctx.pooled_buffer_count < MAX_POOLED_BUFFERS) {
+            pooled.buffer = *cl_buf;
+            opencl_ctx.pooled_buffers[opencl_ctx.pooled_buffer_count++] = pooled;
+            UNLOCK_OPENCL;
+            *cl_buf = NULL;
+            return;
+        }
+        UNLOCK_OPENCL;
+    }
     status = clReleaseMemObject(*cl_buf);
     if (status != CL_SUCCESS) {
         av_log(&opencl_ctx, AV_LOG_ERROR,
@@ -810,3 +1036,45 @@ int av_opencl_buffer_read_image(uint8_t **dst_data, int *plane_size, int plane_n
     }
     return 0;
 }
+
+int avpriv_opencl_buffer_write_async(cl_mem dst_cl_buf, const uint8_t *src_buf, size_t buf_size)
+{
+    cl_int status = clEnqueueWriteBuffer(opencl_ctx.command_queue, dst_cl_buf, CL_FALSE,
+                                         0, buf_size, src_buf, 0, NULL, NULL);
+    if (status != CL_SUCCESS) {
+        av_log(&opencl_ctx, AV_LOG_ERROR,
+               "Could not write OpenCL buffer: %s\n", av_opencl_errstr(status));
+        return AVERROR_EXTERNAL;
+    }
+    return 0;
+}
+
+int avpriv_opencl_buffer_write_image_async(cl_mem dst_cl_buf, size_t cl_buffer_size, int dst_cl_offset,
+                                           uint8_t **src_data, int *plane_size, int plane_num)
+{
+    int i, buffer_size = 0;
+    size_t offset = dst_cl_offset;
+    cl_int status;
+    if ((unsigned int)plane_num > 8) {
+        return AVERROR(EINVAL);
+    }
+    for (i = 0; i < plane_num; i++) {
+        buffer_size += plane_size[i];
+    }
+    if (buffer_size > cl_buffer_size) {
+        av_log(&opencl_ctx, AV_LOG_ERROR,
+               "Cannot write image to OpenCL buffer: buffer too small\n");
+        return AVERROR(EINVAL);
+    }
+    for (i = 0; i < plane_num; i++) {
+        status = clEnqueueWriteBuffer(opencl_ctx.command_queue, dst_cl_buf, CL_FALSE,
+                                      offset, plane_size[i], src_data[i], 0, NULL, NULL);
+        if (status != CL_SUCCESS) {
+            av_log(&opencl_ctx, AV_LOG_ERROR,
+                   "Could not write OpenCL buffer: %s\n", av_opencl_errstr(status));
+            return AVERROR_EXTERNAL;
+        }
+        offset += plane_size[i];
+    }
+    return 0;
+}
@@ -110,6 +110,9 @@ void av_opencl_free_device_list(AVOpenCLDeviceList **device_list);
  * - build_options: set options to compile registered kernels code
  * - platform: set index of platform in device list
  * - device: set index of device in device list
+ * - binary_cache_dir: set directory where the binaries of the compiled
+ *   kernels are cached, so that they are not compiled again by the next
+ *   av_opencl_init() with the same kernel code, build options and device
  *
  * See reference "OpenCL Specification Version: 1.2 chapter 5.6.4".
  *
@@ -199,6 +202,8 @@ int av_opencl_create_kernel(AVOpenCLKernelEnv *env, const char *kernel_name);
  * The buffer is used to save the data used or created by an OpenCL
  * kernel.
  * The created buffer must be released with av_opencl_buffer_release().
+ * Buffers without host_ptr may be recycled from the ones released before,
+ * so their initial content is undefined.
  *
  * See clCreateBuffer() function reference for more information about
  * the parameters.
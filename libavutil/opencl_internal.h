@@ -31,3 +31,23 @@ typedef struct {
 } FFOpenclParam;
 
 int ff_opencl_set_parameter(FFOpenclParam *opencl_param, ...);
+
+/**
+ * Enqueue a write of src_buf to an OpenCL buffer and return without
+ * waiting for it, like av_opencl_buffer_write() otherwise.
+ *
+ * The command queue is in order, so the write is done before any
+ * kernel enqueued afterwards runs; src_buf must however stay valid
+ * until a later blocking call, e.g. av_opencl_buffer_read_image(), on
+ * the queue returns.
+ */
+int avpriv_opencl_buffer_write_async(cl_mem dst_cl_buf, const uint8_t *src_buf, size_t buf_size);
+
+/**
+ * Enqueue a write of image planes to an OpenCL buffer and return without
+ * waiting for it, like av_opencl_buffer_write_image() otherwise.
+ *
+ * @see avpriv_opencl_buffer_write_async()
+ */
+int avpriv_opencl_buffer_write_image_async(cl_mem dst_cl_buf, size_t cl_buffer_size, int dst_cl_offset,
+                                           uint8_t **src_data, int *plane_size, int plane_num);
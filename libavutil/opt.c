@@ -26,6 +26,7 @@
  */
 
 #include "avutil.h"
+#include "atomic.h"
 #include "avstring.h"
 #include "common.h"
 #include "opt.h"
@@ -38,6 +39,7 @@
 #include "samplefmt.h"
 
 #include <float.h>
+#include <stdlib.h>
 
 #if FF_API_FIND_OPT
 //FIXME order them and do a bin search
@@ -1243,6 +1245,124 @@ const AVOption *av_opt_find(void *obj, const char *name, const char *unit,
     return av_opt_find2(obj, name, unit, opt_flags, search_flags, NULL);
 }
 
+/* Option arrays with at least that many entries are searched through a
+ * sorted index. The indexes are built on the first lookup and shared by
+ * all the objects of a class, so the arrays are expected to be static. */
+#define OPT_INDEX_MIN_COUNT 16
+#define OPT_INDEX_SLOTS     1024
+
+typedef struct OptionIndex {
+    const AVOption *options;
+    const AVOption **sorted;    ///< by name then by position, NULL if too few
+    int nb_options;
+} OptionIndex;
+
+static OptionIndex * volatile option_indexes[OPT_INDEX_SLOTS];
+
+static int compare_options(const void *a, const void *b)
+{
+    const AVOption *oa = *(const AVOption * const *)a;
+    const AVOption *ob = *(const AVOption * const *)b;
+    int cmp = strcmp(oa->name, ob->name);
+
+    return cmp ? cmp : (oa > ob) - (oa < ob);
+}
+
+static OptionIndex *build_option_index(const AVOption *options)
+{
+    OptionIndex *idx = av_mallocz(sizeof(*idx));
+    int i;
+
+    if (!idx)
+        return NULL;
+    idx->options = options;
+    while (options[idx->nb_options].name)
+        idx->nb_options++;
+    if (idx->nb_options >= OPT_INDEX_MIN_COUNT) {
+        idx->sorted = av_malloc(idx->nb_options * sizeof(*idx->sorted));
+        if (!idx->sorted) {
+            av_free(idx);
+            return NULL;
+        }
+        for (i = 0; i < idx->nb_options; i++)
+            idx->sorted[i] = &options[i];
+        qsort(idx->sorted, idx->nb_options, sizeof(*idx->sorted), compare_options);
+    }
+    return idx;
+}
+
+/**
+ * Get the index of an option array, building it if needed.
+ *
+ * @return the index, or NULL if it could not be built
+ */
+static OptionIndex *get_option_index(const AVOption *options)
+{
+    unsigned slot = ((uintptr_t)options >> 4) & (OPT_INDEX_SLOTS - 1);
+    OptionIndex *idx, *new_idx = NULL;
+    int i;
+
+    for (i = 0; i < OPT_INDEX_SLOTS; i++) {
+        idx = option_indexes[slot];
+        if (!idx) {
+            if (!new_idx && !(new_idx = build_option_index(options)))
+                return NULL;
+            idx = avpriv_atomic_ptr_cas((void * volatile *)&option_indexes[slot],
+                                        NULL, new_idx);
+            if (!idx)
+                return new_idx;
+        }
+        if (idx->options == options)
+            break;
+        slot = (slot + 1) & (OPT_INDEX_SLOTS - 1);
+    }
+    /* another thread was first, or the table is full */
+    if (new_idx) {
+        av_free(new_idx->sorted);
+        av_free(new_idx);
+    }
+    return i < OPT_INDEX_SLOTS ? idx : NULL;
+}
+
+static int option_matches(const AVOption *o, const char *name, const char *unit,
+                          int opt_flags)
+{
+    return !strcmp(o->name, name) && (o->flags & opt_flags) == opt_flags &&
+           ((!unit && o->type != AV_OPT_TYPE_CONST) ||
+            (unit  && o->type == AV_OPT_TYPE_CONST && o->unit && !strcmp(o->unit, unit)));
+}
+
+static const AVOption *find_option(void *obj, const char *name, const char *unit,
+                                   int opt_flags)
+{
+    const AVClass *c = *(AVClass**)obj;
+    const AVOption *o = NULL;
+    OptionIndex *idx;
+
+    if (c && c->option && c->option[0].name &&
+        (idx = get_option_index(c->option)) && idx->sorted) {
+        int lo = 0, hi = idx->nb_options;
+
+        while (lo < hi) {
+            int mid = (lo + hi) >> 1;
+            if (strcmp(idx->sorted[mid]->name, name) < 0)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        /* equal names are in array order, so this is the first match */
+        for (; lo < idx->nb_options && !strcmp(idx->sorted[lo]->name, name); lo++)
+            if (option_matches(idx->sorted[lo], name, unit, opt_flags))
+                return idx->sorted[lo];
+        return NULL;
+    }
+
+    while (o = av_opt_next(obj, o))
+        if (option_matches(o, name, unit, opt_flags))
+            return o;
+    return NULL;
+}
+
 const AVOption *av_opt_find2(void *obj, const char *name, const char *unit,
                              int opt_flags, int search_flags, void **target_obj)
 {
@@ -1268,20 +1388,15 @@ const AVOption *av_opt_find2(void *obj, const char *name, const char *unit,
         }
     }
 
-    while (o = av_opt_next(obj, o)) {
-        if (!strcmp(o->name, name) && (o->flags & opt_flags) == opt_flags &&
-            ((!unit && o->type != AV_OPT_TYPE_CONST) ||
-             (unit  && o->type == AV_OPT_TYPE_CONST && o->unit && !strcmp(o->unit, unit)))) {
-            if (target_obj) {
-                if (!(search_flags & AV_OPT_SEARCH_FAKE_OBJ))
-                    *target_obj = obj;
-                else
-                    *target_obj = NULL;
-            }
-            return o;
+    if (o = find_option(obj, name, unit, opt_flags)) {
+        if (target_obj) {
+            if (!(search_flags & AV_OPT_SEARCH_FAKE_OBJ))
+                *target_obj = obj;
+            else
+                *target_obj = NULL;
         }
     }
-    return NULL;
+    return o;
 }
 
 void *av_opt_child_next(void *obj, void *prev)
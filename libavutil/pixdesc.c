@@ -26,10 +26,73 @@
 #include "common.h"
 #include "pixfmt.h"
 #include "pixdesc.h"
+#include "pixdesc_internal.h"
 
 #include "intreadwrite.h"
 #include "avstring.h"
 
+/* The loops below are instantiated with constant is_8bit, be and own, so
+   that each pixel format family gets its own simple loop instead of
+   deciding the sample layout again for every pixel. */
+static av_always_inline void read_line(uint16_t *dst, const uint8_t *p,
+                                       int step, int shift, int mask, int w,
+                                       int is_8bit, int be)
+{
+    while (w--) {
+        int val = is_8bit ? *p : be ? AV_RB16(p) : AV_RL16(p);
+        *dst++ = (val >> shift) & mask;
+        p += step;
+    }
+}
+
+static av_always_inline void write_line(const uint16_t *src, uint8_t *p,
+                                        int step, int shift, int w,
+                                        int is_8bit, int be, int own)
+{
+    while (w--) {
+        if (is_8bit) {
+            *p = (own ? 0 : *p) | (*src++ << shift);
+        } else if (be) {
+            uint16_t val = (own ? 0 : AV_RB16(p)) | (*src++ << shift);
+            AV_WB16(p, val);
+        } else {
+            uint16_t val = (own ? 0 : AV_RL16(p)) | (*src++ << shift);
+            AV_WL16(p, val);
+        }
+        p += step;
+    }
+}
+
+/* Return the first byte of the unit (byte or 16-bit word) holding
+   component c in its plane, and set *size to the size of the unit. */
+static int comp_unit(const AVPixFmtDescriptor *desc, int c, int *size)
+{
+    const AVComponentDescriptor *comp = &desc->comp[c];
+    int is_8bit = comp->shift + comp->depth_minus1 + 1 <= 8;
+
+    *size = 2 - is_8bit;
+    return comp->offset_plus1 - 1 +
+           (is_8bit && (desc->flags & AV_PIX_FMT_FLAG_BE));
+}
+
+/**
+ * Return 1 if no other component of desc shares the bytes of component c,
+ * so that they can be stored instead of ORed into the zeroed image.
+ */
+static int owns_bytes(const AVPixFmtDescriptor *desc, int c)
+{
+    int size, start = comp_unit(desc, c, &size);
+    int i;
+
+    for (i = 0; i < desc->nb_components; i++) {
+        int size_i, start_i = comp_unit(desc, i, &size_i);
+        if (i != c && desc->comp[i].plane == desc->comp[c].plane &&
+            start_i < start + size && start < start_i + size_i)
+            return 0;
+    }
+    return 1;
+}
+
 void av_read_image_line(uint16_t *dst,
                         const uint8_t *data[4], const int linesize[4],
                         const AVPixFmtDescriptor *desc,
@@ -63,18 +126,34 @@ void av_read_image_line(uint16_t *dst,
                            x * step + comp.offset_plus1 - 1;
         int is_8bit = shift + depth <= 8;
 
+        int be = !!(flags & AV_PIX_FMT_FLAG_BE);
+
         if (is_8bit)
-            p += !!(flags & AV_PIX_FMT_FLAG_BE);
+            p += be;
 
-        while (w--) {
-            int val = is_8bit ? *p :
-                flags & AV_PIX_FMT_FLAG_BE ? AV_RB16(p) : AV_RL16(p);
-            val = (val >> shift) & mask;
-            if (read_pal_component)
-                val = data[1][4 * val + c];
-            p += step;
-            *dst++ = val;
+        if (read_pal_component) {
+            while (w--) {
+                int val = is_8bit ? *p : be ? AV_RB16(p) : AV_RL16(p);
+                val = (val >> shift) & mask;
+                *dst++ = data[1][4 * val + c];
+                p += step;
+            }
+            return;
+        }
+
+        if (ARCH_X86 && step == 2 - is_8bit) {
+            int done = ff_read_image_line_x86(dst, p, w, shift, mask,
+                                              is_8bit, be);
+            dst += done;
+            p   += done * step;
+            w   -= done;
         }
+        if (is_8bit)
+            read_line(dst, p, step, shift, mask, w, 1, 0);
+        else if (be)
+            read_line(dst, p, step, shift, mask, w, 0, 1);
+        else
+            read_line(dst, p, step, shift, mask, w, 0, 0);
     }
 }
 
@@ -105,23 +184,34 @@ void av_write_image_line(const uint16_t *src,
         uint8_t *p = data[plane] + y * linesize[plane] +
                      x * step + comp.offset_plus1 - 1;
 
-        if (shift + depth <= 8) {
-            p += !!(flags & AV_PIX_FMT_FLAG_BE);
-            while (w--) {
-                *p |= (*src++ << shift);
-                p += step;
-            }
+        int is_8bit = shift + depth <= 8;
+        int be  = !!(flags & AV_PIX_FMT_FLAG_BE);
+        int own = owns_bytes(desc, c);
+
+        if (is_8bit)
+            p += be;
+
+        if (ARCH_X86 && own && step == 2 - is_8bit) {
+            int done = ff_write_image_line_x86(src, p, w, shift, is_8bit, be);
+            src += done;
+            p   += done * step;
+            w   -= done;
+        }
+        if (is_8bit) {
+            if (own)
+                write_line(src, p, step, shift, w, 1, 0, 1);
+            else
+                write_line(src, p, step, shift, w, 1, 0, 0);
+        } else if (be) {
+            if (own)
+                write_line(src, p, step, shift, w, 0, 1, 1);
+            else
+                write_line(src, p, step, shift, w, 0, 1, 0);
         } else {
-            while (w--) {
-                if (flags & AV_PIX_FMT_FLAG_BE) {
-                    uint16_t val = AV_RB16(p) | (*src++ << shift);
-                    AV_WB16(p, val);
-                } else {
-                    uint16_t val = AV_RL16(p) | (*src++ << shift);
-                    AV_WL16(p, val);
-                }
-                p += step;
-            }
+            if (own)
+                write_line(src, p, step, shift, w, 0, 0, 1);
+            else
+                write_line(src, p, step, shift, w, 0, 0, 0);
         }
     }
 }
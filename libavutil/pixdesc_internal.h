@@ -0,0 +1,41 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVUTIL_PIXDESC_INTERNAL_H
+#define AVUTIL_PIXDESC_INTERNAL_H
+
+#include <stdint.h>
+
+/**
+ * Read the start of a line of contiguous 8-bit (is_8bit set) or 16-bit
+ * samples into dst, as av_read_image_line() does.
+ * @return the number of samples read, the caller handles the rest
+ */
+int ff_read_image_line_x86(uint16_t *dst, const uint8_t *src, int w,
+                           int shift, int mask, int is_8bit, int be);
+
+/**
+ * Store the start of a line of contiguous 8-bit (is_8bit set) or 16-bit
+ * samples from src, as av_write_image_line() does for samples which do
+ * not share their bytes with another component.
+ * @return the number of samples written, the caller handles the rest
+ */
+int ff_write_image_line_x86(const uint16_t *src, uint8_t *dst, int w,
+                            int shift, int is_8bit, int be);
+
+#endif /* AVUTIL_PIXDESC_INTERNAL_H */
@@ -0,0 +1,91 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include "atomic.h"
+#include "profile.h"
+#include "profile_internal.h"
+#include "thread.h"
+#include "time.h"
+#include "timer.h"
+
+static volatile int profile_enabled;
+static AVMutex profile_lock = AV_MUTEX_INITIALIZER;
+static AVProfileCounter *counters, **counters_tail = &counters;
+
+static uint64_t profile_time(void)
+{
+#ifdef AV_READ_TIME
+    return AV_READ_TIME();
+#else
+    return av_gettime();
+#endif
+}
+
+void av_profile_enable(int enable)
+{
+    avpriv_atomic_int_set(&profile_enabled, !!enable);
+}
+
+const AVProfileCounter *av_profile_next(const AVProfileCounter *prev)
+{
+    const AVProfileCounter *next;
+
+    ff_mutex_lock(&profile_lock);
+    next = prev ? prev->next : counters;
+    ff_mutex_unlock(&profile_lock);
+    return next;
+}
+
+void av_profile_reset(void)
+{
+    AVProfileCounter *c;
+
+    ff_mutex_lock(&profile_lock);
+    for (c = counters; c; c = c->next)
+        c->count = c->time = 0;
+    ff_mutex_unlock(&profile_lock);
+}
+
+uint64_t avpriv_profile_start(void)
+{
+    if (!avpriv_atomic_int_get(&profile_enabled))
+        return 0;
+    /* 0 means not counted */
+    return profile_time() | 1;
+}
+
+void avpriv_profile_stop(AVProfileCounter *counter, uint64_t start)
+{
+    uint64_t end;
+
+    if (!start || !avpriv_atomic_int_get(&profile_enabled))
+        return;
+    end = profile_time();
+
+    ff_mutex_lock(&profile_lock);
+    /* counters are registered on their first timed call */
+    if (!counter->next && counters_tail != &counter->next) {
+        *counters_tail = counter;
+        counters_tail  = &counter->next;
+    }
+    counter->count++;
+    counter->time += end > start ? end - start : 0;
+    ff_mutex_unlock(&profile_lock);
+}
@@ -0,0 +1,81 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * @ingroup lavu_profile
+ * Runtime profiling counters
+ */
+
+#ifndef AVUTIL_PROFILE_H
+#define AVUTIL_PROFILE_H
+
+#include <stdint.h>
+
+/**
+ * @defgroup lavu_profile Profiling counters
+ * @ingroup lavu_misc
+ *
+ * Named counters accumulating the time spent in some hot paths of the
+ * libraries, such as decoding, encoding, filtering, demuxing and muxing
+ * calls. Counting is disabled by default, and only costs a function
+ * call per instrumented call when disabled. Times are inclusive: a
+ * counted call that triggers other counted calls (e.g. a filter
+ * feeding the next one) includes their time.
+ *
+ * @{
+ */
+
+typedef struct AVProfileCounter {
+    const char *name;
+    uint64_t count;     ///< number of timed calls
+    /**
+     * Time spent in the timed calls, in the units of the cycle counter of
+     * the CPU where there is one, in microseconds otherwise.
+     */
+    uint64_t time;
+    struct AVProfileCounter *next;  ///< private, next registered counter
+} AVProfileCounter;
+
+/**
+ * Enable or disable the accumulation of profiling counters.
+ * Calls in progress when the state changes are not counted.
+ */
+void av_profile_enable(int enable);
+
+/**
+ * Iterate over the counters, in the order of their first timed call.
+ * The values of a counter may change while it is read if counting is
+ * enabled.
+ *
+ * @param prev the counter returned by the previous call, NULL to get
+ *             the first one
+ * @return the next counter, NULL after the last one
+ */
+const AVProfileCounter *av_profile_next(const AVProfileCounter *prev);
+
+/**
+ * Reset the values of all the counters.
+ */
+void av_profile_reset(void);
+
+/**
+ * @}
+ */
+
+#endif /* AVUTIL_PROFILE_H */
@@ -0,0 +1,44 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVUTIL_PROFILE_INTERNAL_H
+#define AVUTIL_PROFILE_INTERNAL_H
+
+#include <stdint.h>
+
+#include "profile.h"
+
+/**
+ * Define a static counter for timing a call site.
+ */
+#define FF_PROFILE_COUNTER(var, name) static AVProfileCounter var = { name }
+
+/**
+ * Start timing a call.
+ *
+ * @return the value to pass to avpriv_profile_stop(), 0 if counting is
+ *         disabled
+ */
+uint64_t avpriv_profile_start(void);
+
+/**
+ * Account the call started by avpriv_profile_start() to counter.
+ */
+void avpriv_profile_stop(AVProfileCounter *counter, uint64_t start);
+
+#endif /* AVUTIL_PROFILE_INTERNAL_H */
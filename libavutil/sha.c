@@ -27,19 +27,10 @@
 #include "avutil.h"
 #include "bswap.h"
 #include "sha.h"
+#include "sha_internal.h"
 #include "intreadwrite.h"
 #include "mem.h"
 
-/** hash context */
-typedef struct AVSHA {
-    uint8_t  digest_len;  ///< digest length in 32-bit words
-    uint64_t count;       ///< number of bytes in buffer
-    uint8_t  buffer[64];  ///< 512-bit buffer of input values used in hash updating
-    uint32_t state[8];    ///< current hash value
-    /** function used to update hash for 512-bit input block */
-    void     (*transform)(uint32_t *state, const uint8_t buffer[64]);
-} AVSHA;
-
 const int av_sha_size = sizeof(AVSHA);
 
 struct AVSHA *av_sha_alloc(void)
@@ -288,6 +279,8 @@ av_cold int av_sha_init(AVSHA *ctx, int bits)
     default:
         return -1;
     }
+    if (ARCH_X86)
+        ff_sha_init_x86(ctx, bits);
     ctx->count = 0;
     return 0;
 }
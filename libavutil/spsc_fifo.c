@@ -0,0 +1,315 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <string.h>
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
+#include "atomic.h"
+#include "common.h"
+#include "error.h"
+#include "mem.h"
+#include "spsc_fifo.h"
+#include "time.h"
+
+struct FFSPSCFifo {
+    uint8_t *buffer;
+    int len;                ///< size of buffer, one more than the capacity
+
+    /* the positions written by each thread are kept in separate cache
+       lines, so that they do not bounce between the cores for nothing */
+    uint8_t pad0[64];
+    volatile int wpos;      ///< write position published to the consumer
+    int wpos_staged;        ///< write position of the producer
+    uint8_t pad1[64];
+    volatile int rpos;      ///< read position published to the producer
+    int rpos_staged;        ///< read position of the consumer
+    uint8_t pad2[64];
+
+    volatile int waiting[2];///< the producer/consumer is in wait_for()
+    volatile int woken;     ///< set by avpriv_spsc_fifo_wake()
+#if HAVE_PTHREADS
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+#endif
+};
+
+/* avpriv_atomic_int_get() is a full barrier followed by a load, and
+   avpriv_atomic_int_set() a store followed by a full barrier; add the
+   missing barrier to get acquire loads and release stores. */
+static inline int load_acquire(volatile int *ptr)
+{
+    int val = avpriv_atomic_int_get(ptr);
+    avpriv_atomic_int_get(ptr);
+    return val;
+}
+
+static inline void store_release(volatile int *ptr, int val)
+{
+    avpriv_atomic_int_get(ptr);
+    avpriv_atomic_int_set(ptr, val);
+}
+
+FFSPSCFifo *avpriv_spsc_fifo_alloc(unsigned int size)
+{
+    FFSPSCFifo *f;
+
+    if (size >= INT_MAX)
+        return NULL;
+    f = av_mallocz(sizeof(*f));
+    if (!f)
+        return NULL;
+    f->len    = size + 1;
+    f->buffer = av_malloc(f->len);
+    if (!f->buffer)
+        goto fail;
+#if HAVE_PTHREADS
+    if (pthread_mutex_init(&f->mutex, NULL))
+        goto fail;
+    if (pthread_cond_init(&f->cond, NULL)) {
+        pthread_mutex_destroy(&f->mutex);
+        goto fail;
+    }
+#endif
+    return f;
+fail:
+    av_free(f->buffer);
+    av_free(f);
+    return NULL;
+}
+
+void avpriv_spsc_fifo_freep(FFSPSCFifo **f)
+{
+    if (!*f)
+        return;
+#if HAVE_PTHREADS
+    pthread_cond_destroy(&(*f)->cond);
+    pthread_mutex_destroy(&(*f)->mutex);
+#endif
+    av_free((*f)->buffer);
+    av_freep(f);
+}
+
+static void wake_waiter(FFSPSCFifo *f, int consumer)
+{
+#if HAVE_PTHREADS
+    if (avpriv_atomic_int_get(&f->waiting[consumer])) {
+        pthread_mutex_lock(&f->mutex);
+        pthread_cond_broadcast(&f->cond);
+        pthread_mutex_unlock(&f->mutex);
+    }
+#endif
+}
+
+int avpriv_spsc_fifo_space(FFSPSCFifo *f)
+{
+    int used = f->wpos_staged - load_acquire(&f->rpos);
+
+    if (used < 0)
+        used += f->len;
+    return f->len - 1 - used;
+}
+
+void avpriv_spsc_fifo_write(FFSPSCFifo *f, const void *src, int size)
+{
+    const uint8_t *buf = src;
+    int len = FFMIN(size, f->len - f->wpos_staged);
+
+    memcpy(f->buffer + f->wpos_staged, buf, len);
+    memcpy(f->buffer, buf + len, size - len);
+    f->wpos_staged += size;
+    if (f->wpos_staged >= f->len)
+        f->wpos_staged -= f->len;
+}
+
+void avpriv_spsc_fifo_publish(FFSPSCFifo *f)
+{
+    store_release(&f->wpos, f->wpos_staged);
+    wake_waiter(f, 1);
+}
+
+int avpriv_spsc_fifo_size(FFSPSCFifo *f)
+{
+    int size = load_acquire(&f->wpos) - f->rpos_staged;
+
+    if (size < 0)
+        size += f->len;
+    return size;
+}
+
+void avpriv_spsc_fifo_read(FFSPSCFifo *f, void *dest, int size)
+{
+    uint8_t *buf = dest;
+    int len = FFMIN(size, f->len - f->rpos_staged);
+
+    if (buf) {
+        memcpy(buf, f->buffer + f->rpos_staged, len);
+        memcpy(buf + len, f->buffer, size - len);
+    }
+    f->rpos_staged += size;
+    if (f->rpos_staged >= f->len)
+        f->rpos_staged -= f->len;
+}
+
+void avpriv_spsc_fifo_release(FFSPSCFifo *f)
+{
+    store_release(&f->rpos, f->rpos_staged);
+    wake_waiter(f, 0);
+}
+
+static int level(FFSPSCFifo *f, int consumer)
+{
+    return consumer ? avpriv_spsc_fifo_size(f) : avpriv_spsc_fifo_space(f);
+}
+
+static int wait_for(FFSPSCFifo *f, int consumer, int min, int64_t timeout)
+{
+    int64_t end = timeout >= 0 ? av_gettime() + timeout : 0;
+    int ready;
+
+#if HAVE_PTHREADS
+    pthread_mutex_lock(&f->mutex);
+    /* The other thread checks waiting after publishing its position, and
+       we check the position after setting waiting, so that either it
+       sees us waiting or we see its update. */
+    avpriv_atomic_int_set(&f->waiting[consumer], 1);
+    while (!(ready = level(f, consumer) >= min) && !f->woken) {
+        if (timeout < 0) {
+            pthread_cond_wait(&f->cond, &f->mutex);
+        } else {
+            struct timespec ts = { .tv_sec  =  end / 1000000,
+                                   .tv_nsec = (end % 1000000) * 1000 };
+            if (pthread_cond_timedwait(&f->cond, &f->mutex, &ts) == ETIMEDOUT) {
+                ready = level(f, consumer) >= min;
+                break;
+            }
+        }
+    }
+    f->woken = 0;
+    avpriv_atomic_int_set(&f->waiting[consumer], 0);
+    pthread_mutex_unlock(&f->mutex);
+#else
+    while (!(ready = level(f, consumer) >= min) &&
+           !avpriv_atomic_int_get(&f->woken)) {
+        if (timeout >= 0 && av_gettime() >= end)
+            break;
+        av_usleep(1000);
+    }
+    avpriv_atomic_int_set(&f->woken, 0);
+#endif
+    return ready ? 0 : AVERROR(EAGAIN);
+}
+
+int avpriv_spsc_fifo_wait_size(FFSPSCFifo *f, int min_size, int64_t timeout)
+{
+    return wait_for(f, 1, min_size, timeout);
+}
+
+int avpriv_spsc_fifo_wait_space(FFSPSCFifo *f, int min_space, int64_t timeout)
+{
+    return wait_for(f, 0, min_space, timeout);
+}
+
+void avpriv_spsc_fifo_wake(FFSPSCFifo *f)
+{
+#if HAVE_PTHREADS
+    pthread_mutex_lock(&f->mutex);
+    f->woken = 1;
+    pthread_cond_broadcast(&f->cond);
+    pthread_mutex_unlock(&f->mutex);
+#else
+    avpriv_atomic_int_set(&f->woken, 1);
+#endif
+}
+
+#ifdef TEST
+#include "avassert.h"
+
+#define RECORDS 100000
+
+#if HAVE_PTHREADS
+static void *producer(void *arg)
+{
+    FFSPSCFifo *f = arg;
+    uint8_t buf[256];
+    int i, j;
+
+    for (i = 0; i < RECORDS; i++) {
+        int len = i % 251 + 1;
+
+        for (j = 0; j < len; j++)
+            buf[j] = i + j;
+        if (avpriv_spsc_fifo_space(f) < len + 1)
+            avpriv_spsc_fifo_publish(f);
+        while (avpriv_spsc_fifo_space(f) < len + 1)
+            avpriv_spsc_fifo_wait_space(f, len + 1, -1);
+        buf[len] = len;
+        avpriv_spsc_fifo_write(f, buf + len, 1);
+        avpriv_spsc_fifo_write(f, buf, len);
+        if (i % 3 != 1)
+            avpriv_spsc_fifo_publish(f);
+    }
+    avpriv_spsc_fifo_publish(f);
+    return NULL;
+}
+#endif
+
+int main(void)
+{
+#if HAVE_PTHREADS
+    FFSPSCFifo *f = avpriv_spsc_fifo_alloc(1000);
+    pthread_t thread;
+    uint8_t buf[256];
+    int i, j;
+
+    av_assert0(f);
+    av_assert0(avpriv_spsc_fifo_wait_size(f, 1, 1000) == AVERROR(EAGAIN));
+    avpriv_spsc_fifo_wake(f);
+    av_assert0(avpriv_spsc_fifo_wait_size(f, 1, -1) == AVERROR(EAGAIN));
+
+    av_assert0(!pthread_create(&thread, NULL, producer, f));
+    for (i = 0; i < RECORDS; i++) {
+        int len;
+
+        if (!avpriv_spsc_fifo_size(f))
+            avpriv_spsc_fifo_release(f);
+        while (!avpriv_spsc_fifo_size(f))
+            avpriv_spsc_fifo_wait_size(f, 1, -1);
+        avpriv_spsc_fifo_read(f, buf, 1);
+        len = buf[0];
+        av_assert0(len == i % 251 + 1);
+        av_assert0(avpriv_spsc_fifo_size(f) >= len);
+        avpriv_spsc_fifo_read(f, buf, len);
+        for (j = 0; j < len; j++)
+            av_assert0(buf[j] == (uint8_t)(i + j));
+        if (i & 1)
+            avpriv_spsc_fifo_release(f);
+    }
+    avpriv_spsc_fifo_release(f);
+    pthread_join(thread, NULL);
+    av_assert0(!avpriv_spsc_fifo_size(f));
+    av_assert0(avpriv_spsc_fifo_space(f) == 1000);
+    avpriv_spsc_fifo_freep(&f);
+#endif
+    return 0;
+}
+#endif
@@ -0,0 +1,110 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * lock-free single producer, single consumer byte FIFO
+ *
+ * One thread may call the producer functions and one other thread the
+ * consumer functions concurrently without any locking. Writes are staged
+ * and only become visible to the consumer on avpriv_spsc_fifo_publish(),
+ * so several writes forming one record are always seen together; reads
+ * likewise only give the space back to the producer on
+ * avpriv_spsc_fifo_release().
+ */
+
+#ifndef AVUTIL_SPSC_FIFO_H
+#define AVUTIL_SPSC_FIFO_H
+
+#include <stdint.h>
+
+typedef struct FFSPSCFifo FFSPSCFifo;
+
+/**
+ * Allocate a FIFO able to hold size bytes.
+ * @return the FIFO, or NULL on failure
+ */
+FFSPSCFifo *avpriv_spsc_fifo_alloc(unsigned int size);
+
+/**
+ * Free a FIFO and set the pointer to NULL. No thread may use it anymore.
+ */
+void avpriv_spsc_fifo_freep(FFSPSCFifo **f);
+
+/**
+ * Return the number of bytes the producer can still write.
+ */
+int avpriv_spsc_fifo_space(FFSPSCFifo *f);
+
+/**
+ * Write size bytes, at most avpriv_spsc_fifo_space() of them, without
+ * making them visible to the consumer yet.
+ */
+void avpriv_spsc_fifo_write(FFSPSCFifo *f, const void *src, int size);
+
+/**
+ * Make all the data written so far visible to the consumer, and wake it
+ * up if it is waiting.
+ */
+void avpriv_spsc_fifo_publish(FFSPSCFifo *f);
+
+/**
+ * Return the number of published bytes the consumer can still read.
+ */
+int avpriv_spsc_fifo_size(FFSPSCFifo *f);
+
+/**
+ * Read size bytes, at most avpriv_spsc_fifo_size() of them, without
+ * giving the space back to the producer yet.
+ * @param dest where to copy the data, or NULL to discard it
+ */
+void avpriv_spsc_fifo_read(FFSPSCFifo *f, void *dest, int size);
+
+/**
+ * Give the space of all the data read so far back to the producer, and
+ * wake it up if it is waiting.
+ */
+void avpriv_spsc_fifo_release(FFSPSCFifo *f);
+
+/**
+ * Wait as the consumer until at least min_size bytes can be read.
+ * Reads not released yet do not count, so the consumer should release
+ * them first, as the producer may be waiting for that space.
+ * @param timeout maximum time to wait in microseconds, or negative to wait
+ *                until the condition is met or avpriv_spsc_fifo_wake()
+ *                is called
+ * @return 0 if the condition is met, AVERROR(EAGAIN) otherwise
+ */
+int avpriv_spsc_fifo_wait_size(FFSPSCFifo *f, int min_size, int64_t timeout);
+
+/**
+ * Wait as the producer until at least min_space bytes can be written.
+ * The producer should publish its writes first, as the consumer may be
+ * waiting for that data.
+ * @see avpriv_spsc_fifo_wait_size()
+ */
+int avpriv_spsc_fifo_wait_space(FFSPSCFifo *f, int min_space, int64_t timeout);
+
+/**
+ * Interrupt the current or next wait on the FIFO, so that the waiter can
+ * check for conditions other than the FIFO fill level, e.g. an error of
+ * the other thread.
+ */
+void avpriv_spsc_fifo_wake(FFSPSCFifo *f);
+
+#endif /* AVUTIL_SPSC_FIFO_H */
@@ -0,0 +1,107 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * internal one-time initialization and locking helpers
+ */
+
+#ifndef AVUTIL_THREAD_H
+#define AVUTIL_THREAD_H
+
+#include "config.h"
+
+#if HAVE_PTHREADS
+
+#include <pthread.h>
+
+#define AVOnce pthread_once_t
+#define AV_ONCE_INIT PTHREAD_ONCE_INIT
+
+#define ff_thread_once(control, routine) pthread_once(control, routine)
+
+#define AVMutex pthread_mutex_t
+#define AV_MUTEX_INITIALIZER PTHREAD_MUTEX_INITIALIZER
+
+#define ff_mutex_init(mutex)    pthread_mutex_init(mutex, NULL)
+#define ff_mutex_destroy(mutex) pthread_mutex_destroy(mutex)
+#define ff_mutex_lock(mutex)    pthread_mutex_lock(mutex)
+#define ff_mutex_unlock(mutex)  pthread_mutex_unlock(mutex)
+
+#else
+
+#include "atomic.h"
+
+#define AVOnce volatile int
+#define AV_ONCE_INIT 0
+
+#define AV_ONCE_DONE (1 << 30)
+
+/**
+ * Call routine exactly once for a given control, which must be a static
+ * AVOnce initialized to AV_ONCE_INIT. Callers racing with the first one
+ * wait until routine has returned.
+ */
+static inline int ff_thread_once(AVOnce *control, void (*routine)(void))
+{
+    if (avpriv_atomic_int_get(control) >= AV_ONCE_DONE)
+        return 0;
+    if (avpriv_atomic_int_add_and_fetch(control, 1) == 1) {
+        routine();
+        avpriv_atomic_int_add_and_fetch(control, AV_ONCE_DONE);
+    } else {
+        while (avpriv_atomic_int_get(control) < AV_ONCE_DONE)
+            ;
+    }
+    return 0;
+}
+
+#define AVMutex void * volatile
+#define AV_MUTEX_INITIALIZER NULL
+
+/**
+ * Lock a static AVMutex initialized to AV_MUTEX_INITIALIZER. This is a
+ * spinlock, only meant for short critical sections.
+ */
+static inline int ff_mutex_lock(AVMutex *mutex)
+{
+    while (avpriv_atomic_ptr_cas(mutex, NULL, (void *)mutex))
+        ;
+    return 0;
+}
+
+static inline int ff_mutex_unlock(AVMutex *mutex)
+{
+    avpriv_atomic_ptr_cas(mutex, (void *)mutex, NULL);
+    return 0;
+}
+
+static inline int ff_mutex_init(AVMutex *mutex)
+{
+    *mutex = AV_MUTEX_INITIALIZER;
+    return 0;
+}
+
+static inline int ff_mutex_destroy(AVMutex *mutex)
+{
+    return 0;
+}
+
+#endif
+
+#endif /* AVUTIL_THREAD_H */
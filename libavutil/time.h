@@ -28,6 +28,14 @@
  */
 int64_t av_gettime(void);
 
+/**
+ * Get the current time in microseconds since some unspecified starting point.
+ * On platforms that support it, the time comes from a monotonic clock, which
+ * makes it suitable for measuring durations; otherwise it is the same as
+ * av_gettime().
+ */
+int64_t av_gettime_relative(void);
+
 /**
  * Sleep for a period of time.  Although the duration is expressed in
  * microseconds, the actual delay may be rounded to the precision of the
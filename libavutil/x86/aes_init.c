@@ -0,0 +1,171 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <string.h>
+
+#include "config.h"
+
+#include "libavutil/aes_internal.h"
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/intreadwrite.h"
+#include "cpu.h"
+#include "asm.h"
+
+#if HAVE_AESNI_INLINE
+
+/* key points to round_key[rounds - 1]; round_key[rounds] is applied first
+ * and round_key[0] by the last round. */
+#define AESNI_CRYPT(name, op)                                               \
+static void name ## 1(const av_aes_block *key, int rounds,                  \
+                      uint8_t *dst, const uint8_t *src)                     \
+{                                                                           \
+    x86_reg i = rounds - 1;                                                 \
+                                                                            \
+    __asm__ volatile (                                                      \
+        "movdqu      (%3), %%xmm0       \n\t"                               \
+        "movdqu    16(%1), %%xmm1       \n\t"                               \
+        "pxor      %%xmm1, %%xmm0       \n\t"                               \
+        "1:                             \n\t"                               \
+        "movdqu      (%1), %%xmm1       \n\t"                               \
+        op "       %%xmm1, %%xmm0       \n\t"                               \
+        "sub          $16, %1           \n\t"                               \
+        "dec           %0               \n\t"                               \
+        "jnz           1b               \n\t"                               \
+        "movdqu      (%1), %%xmm1       \n\t"                               \
+        op "last   %%xmm1, %%xmm0       \n\t"                               \
+        "movdqu    %%xmm0, (%2)         \n\t"                               \
+        : "+&r"(i), "+&r"(key)                                              \
+        : "r"(dst), "r"(src)                                                \
+        : XMM_CLOBBERS("%xmm0", "%xmm1",) "memory"                          \
+    );                                                                      \
+}                                                                           \
+                                                                            \
+static void name ## 4(const av_aes_block *key, int rounds,                  \
+                      uint8_t *dst, const uint8_t *src)                     \
+{                                                                           \
+    x86_reg i = rounds - 1;                                                 \
+                                                                            \
+    __asm__ volatile (                                                      \
+        "movdqu    16(%1), %%xmm4       \n\t"                               \
+        "movdqu      (%3), %%xmm0       \n\t"                               \
+        "movdqu    16(%3), %%xmm1       \n\t"                               \
+        "movdqu    32(%3), %%xmm2       \n\t"                               \
+        "movdqu    48(%3), %%xmm3       \n\t"                               \
+        "pxor      %%xmm4, %%xmm0       \n\t"                               \
+        "pxor      %%xmm4, %%xmm1       \n\t"                               \
+        "pxor      %%xmm4, %%xmm2       \n\t"                               \
+        "pxor      %%xmm4, %%xmm3       \n\t"                               \
+        "1:                             \n\t"                               \
+        "movdqu      (%1), %%xmm4       \n\t"                               \
+        op "       %%xmm4, %%xmm0       \n\t"                               \
+        op "       %%xmm4, %%xmm1       \n\t"                               \
+        op "       %%xmm4, %%xmm2       \n\t"                               \
+        op "       %%xmm4, %%xmm3       \n\t"                               \
+        "sub          $16, %1           \n\t"                               \
+        "dec           %0               \n\t"                               \
+        "jnz           1b               \n\t"                               \
+        "movdqu      (%1), %%xmm4       \n\t"                               \
+        op "last   %%xmm4, %%xmm0       \n\t"                               \
+        op "last   %%xmm4, %%xmm1       \n\t"                               \
+        op "last   %%xmm4, %%xmm2       \n\t"                               \
+        op "last   %%xmm4, %%xmm3       \n\t"                               \
+        "movdqu    %%xmm0,   (%2)       \n\t"                               \
+        "movdqu    %%xmm1, 16(%2)       \n\t"                               \
+        "movdqu    %%xmm2, 32(%2)       \n\t"                               \
+        "movdqu    %%xmm3, 48(%2)       \n\t"                               \
+        : "+&r"(i), "+&r"(key)                                              \
+        : "r"(dst), "r"(src)                                                \
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4",)        \
+          "memory"                                                          \
+    );                                                                      \
+}
+
+AESNI_CRYPT(aesenc, "aesenc")
+AESNI_CRYPT(aesdec, "aesdec")
+
+static inline void xor16(uint8_t *dst, const uint8_t *a, const uint8_t *b)
+{
+    AV_WN64(dst,     AV_RN64(a)     ^ AV_RN64(b));
+    AV_WN64(dst + 8, AV_RN64(a + 8) ^ AV_RN64(b + 8));
+}
+
+static void aes_encrypt_aesni(AVAES *a, uint8_t *dst, const uint8_t *src,
+                              int count, uint8_t *iv, int rounds)
+{
+    const av_aes_block *key = &a->round_key[rounds - 1];
+
+    if (iv) {
+        /* CBC encryption is serial, one block at a time */
+        for (; count > 0; count--, src += 16, dst += 16) {
+            uint8_t tmp[16];
+
+            xor16(tmp, src, iv);
+            aesenc1(key, rounds, dst, tmp);
+            memcpy(iv, dst, 16);
+        }
+        return;
+    }
+    for (; count >= 4; count -= 4, src += 64, dst += 64)
+        aesenc4(key, rounds, dst, src);
+    for (; count > 0; count--, src += 16, dst += 16)
+        aesenc1(key, rounds, dst, src);
+}
+
+static void aes_decrypt_aesni(AVAES *a, uint8_t *dst, const uint8_t *src,
+                              int count, uint8_t *iv, int rounds)
+{
+    const av_aes_block *key = &a->round_key[rounds - 1];
+    uint8_t tmp[64];
+
+    if (!iv) {
+        for (; count >= 4; count -= 4, src += 64, dst += 64)
+            aesdec4(key, rounds, dst, src);
+        for (; count > 0; count--, src += 16, dst += 16)
+            aesdec1(key, rounds, dst, src);
+        return;
+    }
+    /* the ciphertext is copied first as dst may be equal to src */
+    for (; count >= 4; count -= 4, src += 64, dst += 64) {
+        memcpy(tmp, src, 64);
+        aesdec4(key, rounds, dst, src);
+        xor16(dst,      dst,      iv);
+        xor16(dst + 16, dst + 16, tmp);
+        xor16(dst + 32, dst + 32, tmp + 16);
+        xor16(dst + 48, dst + 48, tmp + 32);
+        memcpy(iv, tmp + 48, 16);
+    }
+    for (; count > 0; count--, src += 16, dst += 16) {
+        memcpy(tmp, src, 16);
+        aesdec1(key, rounds, dst, src);
+        xor16(dst, dst, iv);
+        memcpy(iv, tmp, 16);
+    }
+}
+
+#endif /* HAVE_AESNI_INLINE */
+
+av_cold void ff_init_aes_x86(AVAES *a, int decrypt)
+{
+#if HAVE_AESNI_INLINE
+    int cpu_flags = av_get_cpu_flags();
+
+    if (INLINE_AESNI(cpu_flags))
+        a->crypt = decrypt ? aes_decrypt_aesni : aes_encrypt_aesni;
+#endif /* HAVE_AESNI_INLINE */
+}
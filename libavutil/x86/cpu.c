@@ -44,7 +44,7 @@
         "cpuid                       \n\t"                      \
         "xchg   %%"REG_b", %%"REG_S                             \
         : "=a" (eax), "=S" (ebx), "=c" (ecx), "=d" (edx)        \
-        : "0" (index))
+        : "0" (index), "2" (0))
 
 #define xgetbv(index, eax, edx)                                 \
     __asm__ (".byte 0x0f, 0x01, 0xd0" : "=a"(eax), "=d"(edx) : "c" (index))
@@ -125,17 +125,38 @@ int ff_get_cpu_flags_x86(void)
             rval |= AV_CPU_FLAG_SSE4;
         if (ecx & 0x00100000 )
             rval |= AV_CPU_FLAG_SSE42;
+        if (ecx & 0x02000000 )
+            rval |= AV_CPU_FLAG_AESNI;
 #if HAVE_AVX
         /* Check OXSAVE and AVX bits */
         if ((ecx & 0x18000000) == 0x18000000) {
             /* Check for OS support */
             xgetbv(0, eax, edx);
-            if ((eax & 0x6) == 0x6)
+            if ((eax & 0x6) == 0x6) {
                 rval |= AV_CPU_FLAG_AVX;
+                if (ecx & 0x00001000)
+                    rval |= AV_CPU_FLAG_FMA3;
+            }
         }
 #endif /* HAVE_AVX */
 #endif /* HAVE_SSE */
     }
+#if HAVE_AVX2
+    /* AVX2 is reported in the structured extended feature flags; like AVX,
+     * it is only usable when the OS saves the YMM state. */
+    if (max_std_level >= 7 && rval & AV_CPU_FLAG_AVX) {
+        cpuid(7, eax, ebx, ecx, edx);
+        if (ebx & 0x00000020)
+            rval |= AV_CPU_FLAG_AVX2;
+    }
+#endif /* HAVE_AVX2 */
+#if HAVE_SHANI
+    if (max_std_level >= 7 && rval & AV_CPU_FLAG_SSE42) {
+        cpuid(7, eax, ebx, ecx, edx);
+        if (ebx & 0x20000000)
+            rval |= AV_CPU_FLAG_SHANI;
+    }
+#endif /* HAVE_SHANI */
 
     cpuid(0x80000000, max_ext_level, ebx, ecx, edx);
 
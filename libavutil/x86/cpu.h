@@ -38,7 +38,11 @@
 #define EXTERNAL_SSSE3(flags)       CPUEXT(flags, _EXTERNAL, SSSE3)
 #define EXTERNAL_SSE4(flags)        CPUEXT(flags, _EXTERNAL, SSE4)
 #define EXTERNAL_SSE42(flags)       CPUEXT(flags, _EXTERNAL, SSE42)
+#define EXTERNAL_AESNI(flags)       CPUEXT(flags, _EXTERNAL, AESNI)
+#define EXTERNAL_SHANI(flags)       CPUEXT(flags, _EXTERNAL, SHANI)
 #define EXTERNAL_AVX(flags)         CPUEXT(flags, _EXTERNAL, AVX)
+#define EXTERNAL_AVX2(flags)        CPUEXT(flags, _EXTERNAL, AVX2)
+#define EXTERNAL_FMA3(flags)        CPUEXT(flags, _EXTERNAL, FMA3)
 #define EXTERNAL_FMA4(flags)        CPUEXT(flags, _EXTERNAL, FMA4)
 
 #define INLINE_AMD3DNOW(flags)      CPUEXT(flags, _INLINE, AMD3DNOW)
@@ -51,7 +55,11 @@
 #define INLINE_SSSE3(flags)         CPUEXT(flags, _INLINE, SSSE3)
 #define INLINE_SSE4(flags)          CPUEXT(flags, _INLINE, SSE4)
 #define INLINE_SSE42(flags)         CPUEXT(flags, _INLINE, SSE42)
+#define INLINE_AESNI(flags)         CPUEXT(flags, _INLINE, AESNI)
+#define INLINE_SHANI(flags)         CPUEXT(flags, _INLINE, SHANI)
 #define INLINE_AVX(flags)           CPUEXT(flags, _INLINE, AVX)
+#define INLINE_AVX2(flags)          CPUEXT(flags, _INLINE, AVX2)
+#define INLINE_FMA3(flags)          CPUEXT(flags, _INLINE, FMA3)
 #define INLINE_FMA4(flags)          CPUEXT(flags, _INLINE, FMA4)
 
 void ff_cpu_cpuid(int index, int *eax, int *ebx, int *ecx, int *edx);
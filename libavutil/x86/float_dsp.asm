@@ -74,10 +74,17 @@ cglobal vector_fmac_scalar, 4,4,3, dst, src, mul, len
 %endif
     lea    lenq, [lend*4-2*mmsize]
 .loop:
+%if cpuflag(fma3)
+    mova     m1,     [dstq+lenq       ]
+    mova     m2,     [dstq+lenq+mmsize]
+    vfmadd231ps m1, m0, [srcq+lenq       ]
+    vfmadd231ps m2, m0, [srcq+lenq+mmsize]
+%else
     mulps    m1, m0, [srcq+lenq       ]
     mulps    m2, m0, [srcq+lenq+mmsize]
     addps    m1, m1, [dstq+lenq       ]
     addps    m2, m2, [dstq+lenq+mmsize]
+%endif
     mova  [dstq+lenq       ], m1
     mova  [dstq+lenq+mmsize], m2
     sub    lenq, 2*mmsize
@@ -91,6 +98,10 @@ VECTOR_FMAC_SCALAR
 INIT_YMM avx
 VECTOR_FMAC_SCALAR
 %endif
+%if HAVE_FMA3_EXTERNAL
+INIT_YMM fma3
+VECTOR_FMAC_SCALAR
+%endif
 
 ;------------------------------------------------------------------------------
 ; void ff_vector_fmul_scalar(float *dst, const float *src, float mul, int len)
@@ -174,16 +185,23 @@ VECTOR_DMUL_SCALAR
 ;                 const float *src2, int len)
 ;-----------------------------------------------------------------------------
 %macro VECTOR_FMUL_ADD 0
-cglobal vector_fmul_add, 5,5,2, dst, src0, src1, src2, len
+cglobal vector_fmul_add, 5,5,4, dst, src0, src1, src2, len
     lea       lenq, [lend*4 - 2*mmsize]
 ALIGN 16
 .loop:
     mova    m0,   [src0q + lenq]
     mova    m1,   [src0q + lenq + mmsize]
+%if cpuflag(fma3)
+    mova    m2,   [src1q + lenq]
+    mova    m3,   [src1q + lenq + mmsize]
+    vfmadd213ps m0, m2, [src2q + lenq]
+    vfmadd213ps m1, m3, [src2q + lenq + mmsize]
+%else
     mulps   m0, m0, [src1q + lenq]
     mulps   m1, m1, [src1q + lenq + mmsize]
     addps   m0, m0, [src2q + lenq]
     addps   m1, m1, [src2q + lenq + mmsize]
+%endif
     mova    [dstq + lenq], m0
     mova    [dstq + lenq + mmsize], m1
 
@@ -198,6 +216,10 @@ VECTOR_FMUL_ADD
 INIT_YMM avx
 VECTOR_FMUL_ADD
 %endif
+%if HAVE_FMA3_EXTERNAL
+INIT_YMM fma3
+VECTOR_FMUL_ADD
+%endif
 
 ;-----------------------------------------------------------------------------
 ; void vector_fmul_reverse(float *dst, const float *src0, const float *src1,
@@ -0,0 +1,127 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "config.h"
+
+#include "libavutil/common.h"
+#include "libavutil/cpu.h"
+#include "libavutil/error.h"
+#include "libavutil/imgutils_internal.h"
+#include "cpu.h"
+#include "asm.h"
+
+#if HAVE_SSE2_INLINE
+/* dst must be 16-byte aligned and len a multiple of 64 */
+static void copy_nt_stores_sse2(uint8_t *dst, const uint8_t *src, x86_reg len)
+{
+    __asm__ volatile (
+        "1:                             \n\t"
+        "movdqu      (%1), %%xmm0       \n\t"
+        "movdqu    16(%1), %%xmm1       \n\t"
+        "movdqu    32(%1), %%xmm2       \n\t"
+        "movdqu    48(%1), %%xmm3       \n\t"
+        "movntdq   %%xmm0,   (%0)       \n\t"
+        "movntdq   %%xmm1, 16(%0)       \n\t"
+        "movntdq   %%xmm2, 32(%0)       \n\t"
+        "movntdq   %%xmm3, 48(%0)       \n\t"
+        "add          $64, %1           \n\t"
+        "add          $64, %0           \n\t"
+        "sub          $64, %2           \n\t"
+        "jg            1b               \n\t"
+        : "+r"(dst), "+r"(src), "+r"(len)
+        :
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",) "memory"
+    );
+}
+#endif /* HAVE_SSE2_INLINE */
+
+#if HAVE_SSE4_INLINE
+/* src must be 16-byte aligned and len a multiple of 64 */
+static void copy_nt_loads_sse4(uint8_t *dst, const uint8_t *src, x86_reg len)
+{
+    __asm__ volatile (
+        "1:                             \n\t"
+        "movntdqa    (%1), %%xmm0       \n\t"
+        "movntdqa  16(%1), %%xmm1       \n\t"
+        "movntdqa  32(%1), %%xmm2       \n\t"
+        "movntdqa  48(%1), %%xmm3       \n\t"
+        "movdqu    %%xmm0,   (%0)       \n\t"
+        "movdqu    %%xmm1, 16(%0)       \n\t"
+        "movdqu    %%xmm2, 32(%0)       \n\t"
+        "movdqu    %%xmm3, 48(%0)       \n\t"
+        "add          $64, %1           \n\t"
+        "add          $64, %0           \n\t"
+        "sub          $64, %2           \n\t"
+        "jg            1b               \n\t"
+        : "+r"(dst), "+r"(src), "+r"(len)
+        :
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",) "memory"
+    );
+}
+#endif /* HAVE_SSE4_INLINE */
+
+/**
+ * Copy each line with memcpy() up to the point where the pointer selected
+ * by align_src is 16-byte aligned, then 64 bytes at a time with copy,
+ * then the rest with memcpy().
+ */
+static void copy_plane(uint8_t *dst, ptrdiff_t dst_linesize,
+                       const uint8_t *src, ptrdiff_t src_linesize,
+                       ptrdiff_t bytewidth, int height, int align_src,
+                       void (*copy)(uint8_t *dst, const uint8_t *src, x86_reg len))
+{
+    for (; height > 0; height--) {
+        ptrdiff_t head = FFMIN(-(intptr_t)(align_src ? src : dst) & 15, bytewidth);
+        ptrdiff_t body = (bytewidth - head) & ~63;
+
+        memcpy(dst, src, head);
+        if (body)
+            copy(dst + head, src + head, body);
+        memcpy(dst + head + body, src + head + body, bytewidth - head - body);
+        dst += dst_linesize;
+        src += src_linesize;
+    }
+}
+
+int ff_image_copy_plane_x86(uint8_t *dst, ptrdiff_t dst_linesize,
+                            const uint8_t *src, ptrdiff_t src_linesize,
+                            ptrdiff_t bytewidth, int height, int uc_src)
+{
+    int cpu_flags = av_get_cpu_flags();
+
+#if HAVE_SSE4_INLINE
+    if (uc_src && INLINE_SSE4(cpu_flags)) {
+        copy_plane(dst, dst_linesize, src, src_linesize, bytewidth, height,
+                   1, copy_nt_loads_sse4);
+        return 0;
+    }
+#endif
+#if HAVE_SSE2_INLINE
+    if (!uc_src && INLINE_SSE2(cpu_flags)) {
+        copy_plane(dst, dst_linesize, src, src_linesize, bytewidth, height,
+                   0, copy_nt_stores_sse2);
+        /* the non-temporal stores are weakly ordered */
+        __asm__ volatile ("sfence" ::: "memory");
+        return 0;
+    }
+#endif
+    return AVERROR(ENOSYS);
+}
@@ -0,0 +1,209 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdint.h>
+
+#include "config.h"
+
+#include "libavutil/cpu.h"
+#include "libavutil/pixdesc_internal.h"
+#include "cpu.h"
+#include "asm.h"
+
+#if HAVE_SSE2_INLINE
+/* swap the bytes of the words of xmm0, using xmm1 */
+#define BSWAP_XMM0                      \
+    "movdqa    %%xmm0, %%xmm1       \n\t" \
+    "psllw        $8,  %%xmm0       \n\t" \
+    "psrlw        $8,  %%xmm1       \n\t" \
+    "por       %%xmm1, %%xmm0       \n\t"
+
+/* put shift in xmm6 and mask in all the words of xmm7 */
+#define LOAD_SHIFT_MASK(shift, mask)    \
+    "movd        " shift ", %%xmm6  \n\t" \
+    "movd        " mask  ", %%xmm7  \n\t" \
+    "pshuflw  $0, %%xmm7, %%xmm7    \n\t" \
+    "punpcklqdq   %%xmm7, %%xmm7    \n\t"
+
+static void read_line_8_sse2(uint16_t *dst, const uint8_t *src, x86_reg len,
+                             int shift, int mask)
+{
+    __asm__ volatile (
+        LOAD_SHIFT_MASK("%3", "%4")
+        "pxor         %%xmm5, %%xmm5    \n\t"
+        "1:                             \n\t"
+        "movdqu          (%1), %%xmm0   \n\t"
+        "movdqa       %%xmm0, %%xmm1    \n\t"
+        "punpcklbw    %%xmm5, %%xmm0    \n\t"
+        "punpckhbw    %%xmm5, %%xmm1    \n\t"
+        "psrlw        %%xmm6, %%xmm0    \n\t"
+        "psrlw        %%xmm6, %%xmm1    \n\t"
+        "pand         %%xmm7, %%xmm0    \n\t"
+        "pand         %%xmm7, %%xmm1    \n\t"
+        "movdqu       %%xmm0,   (%0)    \n\t"
+        "movdqu       %%xmm1, 16(%0)    \n\t"
+        "add             $16, %1        \n\t"
+        "add             $32, %0        \n\t"
+        "sub             $16, %2        \n\t"
+        "jg               1b            \n\t"
+        : "+r"(dst), "+r"(src), "+r"(len)
+        : "r"(shift), "r"(mask)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm5", "%xmm6", "%xmm7",) "memory"
+    );
+}
+
+static void read_line_16_sse2(uint16_t *dst, const uint8_t *src, x86_reg len,
+                              int shift, int mask, int be)
+{
+    if (be) {
+        __asm__ volatile (
+            LOAD_SHIFT_MASK("%3", "%4")
+            "1:                         \n\t"
+            "movdqu      (%1), %%xmm0   \n\t"
+            BSWAP_XMM0
+            "psrlw    %%xmm6, %%xmm0    \n\t"
+            "pand     %%xmm7, %%xmm0    \n\t"
+            "movdqu   %%xmm0, (%0)      \n\t"
+            "add         $16, %1        \n\t"
+            "add         $16, %0        \n\t"
+            "sub          $8, %2        \n\t"
+            "jg           1b            \n\t"
+            : "+r"(dst), "+r"(src), "+r"(len)
+            : "r"(shift), "r"(mask)
+            : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm6", "%xmm7",) "memory"
+        );
+    } else {
+        __asm__ volatile (
+            LOAD_SHIFT_MASK("%3", "%4")
+            "1:                         \n\t"
+            "movdqu      (%1), %%xmm0   \n\t"
+            "psrlw    %%xmm6, %%xmm0    \n\t"
+            "pand     %%xmm7, %%xmm0    \n\t"
+            "movdqu   %%xmm0, (%0)      \n\t"
+            "add         $16, %1        \n\t"
+            "add         $16, %0        \n\t"
+            "sub          $8, %2        \n\t"
+            "jg           1b            \n\t"
+            : "+r"(dst), "+r"(src), "+r"(len)
+            : "r"(shift), "r"(mask)
+            : XMM_CLOBBERS("%xmm0", "%xmm6", "%xmm7",) "memory"
+        );
+    }
+}
+
+static void write_line_8_sse2(const uint16_t *src, uint8_t *dst, x86_reg len,
+                              int shift)
+{
+    __asm__ volatile (
+        LOAD_SHIFT_MASK("%3", "%4")
+        "1:                             \n\t"
+        "movdqu          (%1), %%xmm0   \n\t"
+        "movdqu        16(%1), %%xmm1   \n\t"
+        "psllw        %%xmm6, %%xmm0    \n\t"
+        "psllw        %%xmm6, %%xmm1    \n\t"
+        "pand         %%xmm7, %%xmm0    \n\t"
+        "pand         %%xmm7, %%xmm1    \n\t"
+        "packuswb     %%xmm1, %%xmm0    \n\t"
+        "movdqu       %%xmm0, (%0)      \n\t"
+        "add             $32, %1        \n\t"
+        "add             $16, %0        \n\t"
+        "sub             $16, %2        \n\t"
+        "jg               1b            \n\t"
+        : "+r"(dst), "+r"(src), "+r"(len)
+        : "r"(shift), "r"(0xff)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm6", "%xmm7",) "memory"
+    );
+}
+
+static void write_line_16_sse2(const uint16_t *src, uint8_t *dst, x86_reg len,
+                               int shift, int be)
+{
+    if (be) {
+        __asm__ volatile (
+            "movd         %3, %%xmm6    \n\t"
+            "1:                         \n\t"
+            "movdqu      (%1), %%xmm0   \n\t"
+            "psllw    %%xmm6, %%xmm0    \n\t"
+            BSWAP_XMM0
+            "movdqu   %%xmm0, (%0)      \n\t"
+            "add         $16, %1        \n\t"
+            "add         $16, %0        \n\t"
+            "sub          $8, %2        \n\t"
+            "jg           1b            \n\t"
+            : "+r"(dst), "+r"(src), "+r"(len)
+            : "r"(shift)
+            : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm6",) "memory"
+        );
+    } else {
+        __asm__ volatile (
+            "movd         %3, %%xmm6    \n\t"
+            "1:                         \n\t"
+            "movdqu      (%1), %%xmm0   \n\t"
+            "psllw    %%xmm6, %%xmm0    \n\t"
+            "movdqu   %%xmm0, (%0)      \n\t"
+            "add         $16, %1        \n\t"
+            "add         $16, %0        \n\t"
+            "sub          $8, %2        \n\t"
+            "jg           1b            \n\t"
+            : "+r"(dst), "+r"(src), "+r"(len)
+            : "r"(shift)
+            : XMM_CLOBBERS("%xmm0", "%xmm6",) "memory"
+        );
+    }
+}
+#endif /* HAVE_SSE2_INLINE */
+
+int ff_read_image_line_x86(uint16_t *dst, const uint8_t *src, int w,
+                           int shift, int mask, int is_8bit, int be)
+{
+    int cpu_flags = av_get_cpu_flags();
+    int len = w & (is_8bit ? ~15 : ~7);
+
+    if (!len)
+        return 0;
+#if HAVE_SSE2_INLINE
+    if (INLINE_SSE2(cpu_flags)) {
+        if (is_8bit)
+            read_line_8_sse2(dst, src, len, shift, mask);
+        else
+            read_line_16_sse2(dst, src, len, shift, mask, be);
+        return len;
+    }
+#endif
+    return 0;
+}
+
+int ff_write_image_line_x86(const uint16_t *src, uint8_t *dst, int w,
+                            int shift, int is_8bit, int be)
+{
+    int cpu_flags = av_get_cpu_flags();
+    int len = w & (is_8bit ? ~15 : ~7);
+
+    if (!len)
+        return 0;
+#if HAVE_SSE2_INLINE
+    if (INLINE_SSE2(cpu_flags)) {
+        if (is_8bit)
+            write_line_8_sse2(src, dst, len, shift);
+        else
+            write_line_16_sse2(src, dst, len, shift, be);
+        return len;
+    }
+#endif
+    return 0;
+}
@@ -0,0 +1,206 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/mem.h"
+#include "libavutil/sha_internal.h"
+#include "cpu.h"
+#include "asm.h"
+
+#if HAVE_SHANI_INLINE
+
+/* Message schedule registers, xmm0-xmm2 hold the working state. */
+#define W0 "%%xmm3"
+#define W1 "%%xmm4"
+#define W2 "%%xmm5"
+#define W3 "%%xmm6"
+#define EA "%%xmm1"
+#define EB "%%xmm2"
+
+DECLARE_ALIGNED(16, static const uint8_t, sha1_shuffle)[16] = {
+    15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0
+};
+
+#define SHA1_LOAD(off, w)                                                   \
+    "movdqu    " #off "(%1), " w "     \n\t"                                \
+    "pshufb       (%2), " w "         \n\t"
+
+/* 4 rounds with ABCD in xmm0; e holds E of these rounds, o receives the
+ * ABCD used to derive E of the next ones */
+#define SHA1_ROUNDS_FIRST(w, e, o)                                          \
+    "paddd       " w ", " e "          \n\t"                                \
+    "movdqa    %%xmm0, " o "           \n\t"                                \
+    "sha1rnds4     $0, " e ", %%xmm0   \n\t"
+
+#define SHA1_ROUNDS(f, w, e, o)                                             \
+    "sha1nexte   " w ", " e "          \n\t"                                \
+    "movdqa    %%xmm0, " o "           \n\t"                                \
+    "sha1rnds4  $" #f ", " e ", %%xmm0  \n\t"
+
+#define SHA1_MSG1(w, dst) "sha1msg1    " w ", " dst "          \n\t"
+#define SHA1_MSG2(w, dst) "sha1msg2    " w ", " dst "          \n\t"
+#define SHA1_XOR(w, dst)  "pxor        " w ", " dst "          \n\t"
+
+static void sha1_transform_shani(uint32_t state[5], const uint8_t buffer[64])
+{
+    __asm__ volatile (
+        "movdqu      (%0), %%xmm0       \n\t"
+        "pshufd    $0x1B, %%xmm0, %%xmm0 \n\t"
+        "movd      16(%0), " EA "       \n\t"
+        "pslldq      $12, " EA "        \n\t"
+        SHA1_LOAD(0, W0) SHA1_ROUNDS_FIRST(W0, EA, EB)
+        SHA1_LOAD(16, W1) SHA1_ROUNDS(0, W1, EB, EA) SHA1_MSG1(W1, W0)
+        SHA1_LOAD(32, W2) SHA1_ROUNDS(0, W2, EA, EB) SHA1_MSG1(W2, W1) SHA1_XOR(W2, W0)
+        SHA1_LOAD(48, W3) SHA1_ROUNDS(0, W3, EB, EA) SHA1_MSG2(W3, W0) SHA1_MSG1(W3, W2) SHA1_XOR(W3, W1)
+        SHA1_ROUNDS(0, W0, EA, EB) SHA1_MSG2(W0, W1) SHA1_MSG1(W0, W3) SHA1_XOR(W0, W2)
+        SHA1_ROUNDS(1, W1, EB, EA) SHA1_MSG2(W1, W2) SHA1_MSG1(W1, W0) SHA1_XOR(W1, W3)
+        SHA1_ROUNDS(1, W2, EA, EB) SHA1_MSG2(W2, W3) SHA1_MSG1(W2, W1) SHA1_XOR(W2, W0)
+        SHA1_ROUNDS(1, W3, EB, EA) SHA1_MSG2(W3, W0) SHA1_MSG1(W3, W2) SHA1_XOR(W3, W1)
+        SHA1_ROUNDS(1, W0, EA, EB) SHA1_MSG2(W0, W1) SHA1_MSG1(W0, W3) SHA1_XOR(W0, W2)
+        SHA1_ROUNDS(1, W1, EB, EA) SHA1_MSG2(W1, W2) SHA1_MSG1(W1, W0) SHA1_XOR(W1, W3)
+        SHA1_ROUNDS(2, W2, EA, EB) SHA1_MSG2(W2, W3) SHA1_MSG1(W2, W1) SHA1_XOR(W2, W0)
+        SHA1_ROUNDS(2, W3, EB, EA) SHA1_MSG2(W3, W0) SHA1_MSG1(W3, W2) SHA1_XOR(W3, W1)
+        SHA1_ROUNDS(2, W0, EA, EB) SHA1_MSG2(W0, W1) SHA1_MSG1(W0, W3) SHA1_XOR(W0, W2)
+        SHA1_ROUNDS(2, W1, EB, EA) SHA1_MSG2(W1, W2) SHA1_MSG1(W1, W0) SHA1_XOR(W1, W3)
+        SHA1_ROUNDS(2, W2, EA, EB) SHA1_MSG2(W2, W3) SHA1_MSG1(W2, W1) SHA1_XOR(W2, W0)
+        SHA1_ROUNDS(3, W3, EB, EA) SHA1_MSG2(W3, W0) SHA1_MSG1(W3, W2) SHA1_XOR(W3, W1)
+        SHA1_ROUNDS(3, W0, EA, EB) SHA1_MSG2(W0, W1) SHA1_MSG1(W0, W3) SHA1_XOR(W0, W2)
+        SHA1_ROUNDS(3, W1, EB, EA) SHA1_MSG2(W1, W2) SHA1_XOR(W1, W3)
+        SHA1_ROUNDS(3, W2, EA, EB) SHA1_MSG2(W2, W3)
+        SHA1_ROUNDS(3, W3, EB, EA)
+        /* add the input state back */
+        "movd      16(%0), " W0 "       \n\t"
+        "pslldq      $12, " W0 "        \n\t"
+        "sha1nexte " W0 ", " EA "       \n\t"
+        "movdqu      (%0), " W1 "       \n\t"
+        "pshufd    $0x1B, " W1 ", " W1 " \n\t"
+        "paddd     " W1 ", %%xmm0       \n\t"
+        "pshufd    $0x1B, %%xmm0, %%xmm0 \n\t"
+        "movdqu    %%xmm0, (%0)         \n\t"
+        "psrldq      $12, " EA "        \n\t"
+        "movd      " EA ", 16(%0)       \n\t"
+        :
+        : "r"(state), "r"(buffer), "r"(sha1_shuffle)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                       "%xmm4", "%xmm5", "%xmm6",) "memory"
+    );
+}
+
+DECLARE_ALIGNED(16, static const uint8_t, sha256_shuffle)[16] = {
+    3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12
+};
+
+DECLARE_ALIGNED(16, static const uint32_t, sha256_k)[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+    0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+    0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+    0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+    0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+    0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define SHA256_LOAD(off, w)                                                 \
+    "movdqu    " #off "(%1), " w "     \n\t"                                \
+    "pshufb       (%2), " w "         \n\t"
+
+/* 4 rounds with ABEF in xmm1 and CDGH in xmm2 */
+#define SHA256_ROUNDS(off, w)                                               \
+    "movdqa    " #off "(%3), %%xmm0    \n\t"                                \
+    "paddd       " w ", %%xmm0         \n\t"                                \
+    "sha256rnds2 %%xmm0, %%xmm1, %%xmm2 \n\t"                               \
+    "pshufd     $0x0E, %%xmm0, %%xmm0  \n\t"                                \
+    "sha256rnds2 %%xmm0, %%xmm2, %%xmm1 \n\t"
+
+#define SHA256_MSG1(w, dst) "sha256msg1  " w ", " dst "          \n\t"
+#define SHA256_MSG2(w, prev, dst)                                           \
+    "movdqa      " w ", %%xmm7         \n\t"                                \
+    "palignr       $4, " prev ", %%xmm7 \n\t"                               \
+    "paddd     %%xmm7, " dst "         \n\t"                                \
+    "sha256msg2  " w ", " dst "          \n\t"
+
+static void sha256_transform_shani(uint32_t *state, const uint8_t buffer[64])
+{
+    __asm__ volatile (
+        /* ABCD EFGH -> ABEF CDGH */
+        "movdqu      (%0), %%xmm7       \n\t"
+        "movdqu    16(%0), %%xmm2       \n\t"
+        "pshufd    $0xB1, %%xmm7, %%xmm7 \n\t"
+        "pshufd    $0x1B, %%xmm2, %%xmm2 \n\t"
+        "movdqa    %%xmm7, %%xmm1       \n\t"
+        "palignr      $8, %%xmm2, %%xmm1 \n\t"
+        "pblendw   $0xF0, %%xmm7, %%xmm2 \n\t"
+        SHA256_LOAD(0, W0) SHA256_ROUNDS(  0, W0)
+        SHA256_LOAD(16, W1) SHA256_ROUNDS( 16, W1) SHA256_MSG1(W1, W0)
+        SHA256_LOAD(32, W2) SHA256_ROUNDS( 32, W2) SHA256_MSG1(W2, W1)
+        SHA256_LOAD(48, W3) SHA256_ROUNDS( 48, W3) SHA256_MSG2(W3, W2, W0) SHA256_MSG1(W3, W2)
+        SHA256_ROUNDS( 64, W0) SHA256_MSG2(W0, W3, W1) SHA256_MSG1(W0, W3)
+        SHA256_ROUNDS( 80, W1) SHA256_MSG2(W1, W0, W2) SHA256_MSG1(W1, W0)
+        SHA256_ROUNDS( 96, W2) SHA256_MSG2(W2, W1, W3) SHA256_MSG1(W2, W1)
+        SHA256_ROUNDS(112, W3) SHA256_MSG2(W3, W2, W0) SHA256_MSG1(W3, W2)
+        SHA256_ROUNDS(128, W0) SHA256_MSG2(W0, W3, W1) SHA256_MSG1(W0, W3)
+        SHA256_ROUNDS(144, W1) SHA256_MSG2(W1, W0, W2) SHA256_MSG1(W1, W0)
+        SHA256_ROUNDS(160, W2) SHA256_MSG2(W2, W1, W3) SHA256_MSG1(W2, W1)
+        SHA256_ROUNDS(176, W3) SHA256_MSG2(W3, W2, W0) SHA256_MSG1(W3, W2)
+        SHA256_ROUNDS(192, W0) SHA256_MSG2(W0, W3, W1) SHA256_MSG1(W0, W3)
+        SHA256_ROUNDS(208, W1) SHA256_MSG2(W1, W0, W2)
+        SHA256_ROUNDS(224, W2) SHA256_MSG2(W2, W1, W3)
+        SHA256_ROUNDS(240, W3)
+        /* ABEF CDGH -> ABCD EFGH, and add the input state back */
+        "pshufd    $0x1B, %%xmm1, %%xmm7 \n\t"
+        "pshufd    $0xB1, %%xmm2, %%xmm2 \n\t"
+        "movdqa    %%xmm7, %%xmm1       \n\t"
+        "pblendw   $0xF0, %%xmm2, %%xmm1 \n\t"
+        "palignr      $8, %%xmm7, %%xmm2 \n\t"
+        "movdqu      (%0), %%xmm7       \n\t"
+        "paddd     %%xmm7, %%xmm1       \n\t"
+        "movdqu    %%xmm1, (%0)         \n\t"
+        "movdqu    16(%0), %%xmm7       \n\t"
+        "paddd     %%xmm7, %%xmm2       \n\t"
+        "movdqu    %%xmm2, 16(%0)       \n\t"
+        :
+        : "r"(state), "r"(buffer), "r"(sha256_shuffle), "r"(sha256_k)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                       "%xmm4", "%xmm5", "%xmm6", "%xmm7",) "memory"
+    );
+}
+
+#endif /* HAVE_SHANI_INLINE */
+
+av_cold void ff_sha_init_x86(AVSHA *ctx, int bits)
+{
+#if HAVE_SHANI_INLINE
+    int cpu_flags = av_get_cpu_flags();
+
+    if (INLINE_SHANI(cpu_flags))
+        ctx->transform = bits == 160 ? sha1_transform_shani
+                                     : sha256_transform_shani;
+#endif /* HAVE_SHANI_INLINE */
+}
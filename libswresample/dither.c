@@ -99,6 +99,9 @@ int swri_dither_init(SwrContext *s, enum AVSampleFormat out_fmt, enum AVSampleFo
         scale *= 1<<(32-s->dither.output_sample_bits);
 
     s->dither.ns_pos = 0;
+    s->dither.noise_shaping_2ch = NULL;
+    if (ARCH_X86)
+        swri_dither_init_x86(s, av_get_planar_sample_fmt(in_fmt));
     s->dither.noise_scale=   scale;
     s->dither.ns_scale   =   scale;
     s->dither.ns_scale_1 = scale ? 1/scale : 0;
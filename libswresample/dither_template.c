@@ -33,7 +33,36 @@ void RENAME(swri_noise_shaping)(SwrContext *s, AudioData *dsts, const AudioData
     av_assert2((taps&3) != 2);
     av_assert2((taps&3) != 3 || s->dither.ns_coeffs[taps] == 0);
 
-    for (ch=0; ch<srcs->ch_count; ch++) {
+    ch = 0;
+    if (s->dither.noise_shaping_2ch) {
+        DECLARE_ALIGNED(16, float, coeffs)[2*(NS_TAPS+4)];
+        DECLARE_ALIGNED(16, float, errors)[2*2*NS_TAPS];
+
+        for (j=0; j<NS_TAPS+4; j++)
+            coeffs[2*j] = coeffs[2*j + 1] = j < taps ? s->dither.ns_coeffs[j] : 0;
+
+        for (; ch+1<srcs->ch_count; ch+=2) {
+            const float *noise0 = ((const float *)noises->ch[ch    ]) + s->dither.noise_pos;
+            const float *noise1 = ((const float *)noises->ch[ch + 1]) + s->dither.noise_pos;
+            float *ns_errors0 = s->dither.ns_errors[ch    ];
+            float *ns_errors1 = s->dither.ns_errors[ch + 1];
+
+            for (j=0; j<2*taps; j++) {
+                errors[2*j    ] = ns_errors0[j];
+                errors[2*j + 1] = ns_errors1[j];
+            }
+            pos = s->dither.noise_shaping_2ch(dsts->ch[ch], dsts->ch[ch + 1],
+                                              srcs->ch[ch], srcs->ch[ch + 1],
+                                              noise0, noise1, errors, coeffs,
+                                              taps, s->dither.ns_pos, count, S, S_1);
+            for (j=0; j<2*taps; j++) {
+                ns_errors0[j] = errors[2*j    ];
+                ns_errors1[j] = errors[2*j + 1];
+            }
+        }
+    }
+
+    for (; ch<srcs->ch_count; ch++) {
         const float *noise = ((const float *)noises->ch[ch]) + s->dither.noise_pos;
         const DELEM *src = (const DELEM*)srcs->ch[ch];
         DELEM *dst = (DELEM*)dsts->ch[ch];
@@ -308,29 +308,123 @@ static int set_compensation(ResampleContext *c, int sample_delta, int compensati
 #undef TEMPLATE_RESAMPLE_S16_SSSE3
 #endif
 
+#if HAVE_AVX2_INLINE
+#define TEMPLATE_RESAMPLE_S16_AVX2
+#include "resample_template.c"
+#undef TEMPLATE_RESAMPLE_S16_AVX2
+#endif
+
+#if HAVE_SSE_INLINE
+#define TEMPLATE_RESAMPLE_FLT_SSE
+#include "resample_template.c"
+#undef TEMPLATE_RESAMPLE_FLT_SSE
+#endif
+
+#if HAVE_SSE2_INLINE
+#define TEMPLATE_RESAMPLE_DBL_SSE2
+#include "resample_template.c"
+#undef TEMPLATE_RESAMPLE_DBL_SSE2
+#endif
+
+#if HAVE_AVX_INLINE
+#define TEMPLATE_RESAMPLE_FLT_AVX
+#include "resample_template.c"
+#undef TEMPLATE_RESAMPLE_FLT_AVX
+
+#define TEMPLATE_RESAMPLE_DBL_AVX
+#include "resample_template.c"
+#undef TEMPLATE_RESAMPLE_DBL_AVX
+#endif
+
+#if HAVE_FMA3_INLINE
+#define TEMPLATE_RESAMPLE_FLT_FMA3
+#include "resample_template.c"
+#undef TEMPLATE_RESAMPLE_FLT_FMA3
+
+#define TEMPLATE_RESAMPLE_DBL_FMA3
+#include "resample_template.c"
+#undef TEMPLATE_RESAMPLE_DBL_FMA3
+#endif
+
 #endif // HAVE_MMXEXT_INLINE
 
-static int multiple_resample(ResampleContext *c, AudioData *dst, int dst_size, AudioData *src, int src_size, int *consumed){
-    int i, ret= -1;
-    int av_unused mm_flags = av_get_cpu_flags();
-    int need_emms= 0;
+static int resample_channel(ResampleContext *c, AudioData *dst, int dst_size, AudioData *src, int src_size, int *consumed,
+                            int i, int update_ctx, int mm_flags, int *need_emms){
+    int ret= -1;
 
-    for(i=0; i<dst->ch_count; i++){
 #if HAVE_MMXEXT_INLINE
+    /* the float and double cores need at least one full register of taps */
+#if HAVE_FMA3_INLINE
+         if(c->format == AV_SAMPLE_FMT_FLTP && (mm_flags&AV_CPU_FLAG_FMA3) && c->filter_length >= 8) ret= swri_resample_float_fma3 (c, (float  *)dst->ch[i], (const float  *)src->ch[i], consumed, src_size, dst_size, update_ctx);
+    else if(c->format == AV_SAMPLE_FMT_DBLP && (mm_flags&AV_CPU_FLAG_FMA3) && c->filter_length >= 4) ret= swri_resample_double_fma3(c, (double *)dst->ch[i], (const double *)src->ch[i], consumed, src_size, dst_size, update_ctx);
+    else
+#endif
+#if HAVE_AVX_INLINE
+         if(c->format == AV_SAMPLE_FMT_FLTP && (mm_flags&AV_CPU_FLAG_AVX ) && c->filter_length >= 8) ret= swri_resample_float_avx  (c, (float  *)dst->ch[i], (const float  *)src->ch[i], consumed, src_size, dst_size, update_ctx);
+    else if(c->format == AV_SAMPLE_FMT_DBLP && (mm_flags&AV_CPU_FLAG_AVX ) && c->filter_length >= 4) ret= swri_resample_double_avx (c, (double *)dst->ch[i], (const double *)src->ch[i], consumed, src_size, dst_size, update_ctx);
+    else
+#endif
+#if HAVE_SSE_INLINE
+         if(c->format == AV_SAMPLE_FMT_FLTP && (mm_flags&AV_CPU_FLAG_SSE ) && c->filter_length >= 4) ret= swri_resample_float_sse  (c, (float  *)dst->ch[i], (const float  *)src->ch[i], consumed, src_size, dst_size, update_ctx);
+    else
+#endif
+#if HAVE_SSE2_INLINE
+         if(c->format == AV_SAMPLE_FMT_DBLP && (mm_flags&AV_CPU_FLAG_SSE2) && c->filter_length >= 2) ret= swri_resample_double_sse2(c, (double *)dst->ch[i], (const double *)src->ch[i], consumed, src_size, dst_size, update_ctx);
+    else
+#endif
+#if HAVE_AVX2_INLINE
+         if(c->format == AV_SAMPLE_FMT_S16P && (mm_flags&AV_CPU_FLAG_AVX2)) ret= swri_resample_int16_avx2 (c, (int16_t*)dst->ch[i], (const int16_t*)src->ch[i], consumed, src_size, dst_size, update_ctx);
+    else
+#endif
 #if HAVE_SSSE3_INLINE
-             if(c->format == AV_SAMPLE_FMT_S16P && (mm_flags&AV_CPU_FLAG_SSSE3)) ret= swri_resample_int16_ssse3(c, (int16_t*)dst->ch[i], (const int16_t*)src->ch[i], consumed, src_size, dst_size, i+1==dst->ch_count);
-        else
+         if(c->format == AV_SAMPLE_FMT_S16P && (mm_flags&AV_CPU_FLAG_SSSE3)) ret= swri_resample_int16_ssse3(c, (int16_t*)dst->ch[i], (const int16_t*)src->ch[i], consumed, src_size, dst_size, update_ctx);
+    else
 #endif
-             if(c->format == AV_SAMPLE_FMT_S16P && (mm_flags&AV_CPU_FLAG_MMX2 )){
-                 ret= swri_resample_int16_mmx2 (c, (int16_t*)dst->ch[i], (const int16_t*)src->ch[i], consumed, src_size, dst_size, i+1==dst->ch_count);
-                 need_emms= 1;
-             } else
+         if(c->format == AV_SAMPLE_FMT_S16P && (mm_flags&AV_CPU_FLAG_MMX2 )){
+             ret= swri_resample_int16_mmx2 (c, (int16_t*)dst->ch[i], (const int16_t*)src->ch[i], consumed, src_size, dst_size, update_ctx);
+             *need_emms= 1;
+         } else
 #endif
-             if(c->format == AV_SAMPLE_FMT_S16P) ret= swri_resample_int16(c, (int16_t*)dst->ch[i], (const int16_t*)src->ch[i], consumed, src_size, dst_size, i+1==dst->ch_count);
-        else if(c->format == AV_SAMPLE_FMT_S32P) ret= swri_resample_int32(c, (int32_t*)dst->ch[i], (const int32_t*)src->ch[i], consumed, src_size, dst_size, i+1==dst->ch_count);
-        else if(c->format == AV_SAMPLE_FMT_FLTP) ret= swri_resample_float(c, (float  *)dst->ch[i], (const float  *)src->ch[i], consumed, src_size, dst_size, i+1==dst->ch_count);
-        else if(c->format == AV_SAMPLE_FMT_DBLP) ret= swri_resample_double(c,(double *)dst->ch[i], (const double *)src->ch[i], consumed, src_size, dst_size, i+1==dst->ch_count);
+         if(c->format == AV_SAMPLE_FMT_S16P) ret= swri_resample_int16(c, (int16_t*)dst->ch[i], (const int16_t*)src->ch[i], consumed, src_size, dst_size, update_ctx);
+    else if(c->format == AV_SAMPLE_FMT_S32P) ret= swri_resample_int32(c, (int32_t*)dst->ch[i], (const int32_t*)src->ch[i], consumed, src_size, dst_size, update_ctx);
+    else if(c->format == AV_SAMPLE_FMT_FLTP) ret= swri_resample_float(c, (float  *)dst->ch[i], (const float  *)src->ch[i], consumed, src_size, dst_size, update_ctx);
+    else if(c->format == AV_SAMPLE_FMT_DBLP) ret= swri_resample_double(c,(double *)dst->ch[i], (const double *)src->ch[i], consumed, src_size, dst_size, update_ctx);
+    return ret;
+}
+
+typedef struct ThreadData {
+    ResampleContext *c;
+    AudioData *dst, *src;
+    int dst_size, src_size;
+} ThreadData;
+
+static int resample_channel_thread(SwrContext *s, void *arg, int jobnr, int nb_jobs){
+    ThreadData *td = arg;
+    int consumed, need_emms= 0;
+    int ret= resample_channel(td->c, td->dst, td->dst_size, td->src, td->src_size, &consumed,
+                              jobnr, 0, av_get_cpu_flags(), &need_emms);
+    if(need_emms)
+        emms_c();
+    return ret;
+}
+
+static int multiple_resample(SwrContext *s, AudioData *dst, int dst_size, AudioData *src, int src_size, int *consumed){
+    ResampleContext *c = s->resample;
+    int i= 0, ret= -1;
+    int mm_flags = av_get_cpu_flags();
+    int need_emms= 0;
+
+    /* Only the last channel updates the context, so all others can run in
+     * parallel on the unmodified state before it. */
+    if(HAVE_THREADS && s->thread && dst->ch_count > 2){
+        ThreadData td = { c, dst, src, dst_size, src_size };
+        int rets[SWR_CH_MAX];
+        swri_thread_execute(s, resample_channel_thread, &td, rets, dst->ch_count - 1);
+        i= dst->ch_count - 1;
     }
+
+    for(; i<dst->ch_count; i++)
+        ret= resample_channel(c, dst, dst_size, src, src_size, consumed, i, i+1==dst->ch_count, mm_flags, &need_emms);
     if(need_emms)
         emms_c();
     return ret;
@@ -346,6 +440,11 @@ static int64_t get_delay(struct SwrContext *s, int64_t base){
     return av_rescale(num, base, s->in_sample_rate*(int64_t)c->src_incr << c->phase_shift);
 }
 
+static int64_t get_lookahead(struct SwrContext *s, int64_t base){
+    ResampleContext *c = s->resample;
+    return av_rescale(c->filter_length/2, base, s->in_sample_rate);
+}
+
 static int resample_flush(struct SwrContext *s) {
     AudioData *a= &s->in_buffer;
     int i, j, ret;
@@ -369,4 +468,5 @@ struct Resampler const swri_resampler={
   resample_flush,
   set_compensation,
   get_delay,
+  get_lookahead,
 };
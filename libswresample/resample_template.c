@@ -25,8 +25,11 @@
  * @author Michael Niedermayer <michaelni@gmx.at>
  */
 
-#if defined(TEMPLATE_RESAMPLE_DBL)
-#    define RENAME(N) N ## _double
+#if    defined(TEMPLATE_RESAMPLE_DBL)      \
+    || defined(TEMPLATE_RESAMPLE_DBL_SSE2) \
+    || defined(TEMPLATE_RESAMPLE_DBL_AVX)  \
+    || defined(TEMPLATE_RESAMPLE_DBL_FMA3)
+
 #    define FILTER_SHIFT 0
 #    define DELEM  double
 #    define FELEM  double
@@ -34,8 +37,24 @@
 #    define FELEML double
 #    define OUT(d, v) d = v
 
-#elif defined(TEMPLATE_RESAMPLE_FLT)
-#    define RENAME(N) N ## _float
+#    if defined(TEMPLATE_RESAMPLE_DBL)
+#        define RENAME(N) N ## _double
+#    elif defined(TEMPLATE_RESAMPLE_DBL_SSE2)
+#        define COMMON_CORE COMMON_CORE_DBL_SSE2
+#        define RENAME(N) N ## _double_sse2
+#    elif defined(TEMPLATE_RESAMPLE_DBL_AVX)
+#        define COMMON_CORE COMMON_CORE_DBL_AVX
+#        define RENAME(N) N ## _double_avx
+#    elif defined(TEMPLATE_RESAMPLE_DBL_FMA3)
+#        define COMMON_CORE COMMON_CORE_DBL_FMA3
+#        define RENAME(N) N ## _double_fma3
+#    endif
+
+#elif    defined(TEMPLATE_RESAMPLE_FLT)      \
+      || defined(TEMPLATE_RESAMPLE_FLT_SSE)  \
+      || defined(TEMPLATE_RESAMPLE_FLT_AVX)  \
+      || defined(TEMPLATE_RESAMPLE_FLT_FMA3)
+
 #    define FILTER_SHIFT 0
 #    define DELEM  float
 #    define FELEM  float
@@ -43,6 +62,19 @@
 #    define FELEML float
 #    define OUT(d, v) d = v
 
+#    if defined(TEMPLATE_RESAMPLE_FLT)
+#        define RENAME(N) N ## _float
+#    elif defined(TEMPLATE_RESAMPLE_FLT_SSE)
+#        define COMMON_CORE COMMON_CORE_FLT_SSE
+#        define RENAME(N) N ## _float_sse
+#    elif defined(TEMPLATE_RESAMPLE_FLT_AVX)
+#        define COMMON_CORE COMMON_CORE_FLT_AVX
+#        define RENAME(N) N ## _float_avx
+#    elif defined(TEMPLATE_RESAMPLE_FLT_FMA3)
+#        define COMMON_CORE COMMON_CORE_FLT_FMA3
+#        define RENAME(N) N ## _float_fma3
+#    endif
+
 #elif defined(TEMPLATE_RESAMPLE_S32)
 #    define RENAME(N) N ## _int32
 #    define FILTER_SHIFT 30
@@ -57,7 +89,8 @@
 
 #elif    defined(TEMPLATE_RESAMPLE_S16)      \
       || defined(TEMPLATE_RESAMPLE_S16_MMX2) \
-      || defined(TEMPLATE_RESAMPLE_S16_SSSE3)
+      || defined(TEMPLATE_RESAMPLE_S16_SSSE3) \
+      || defined(TEMPLATE_RESAMPLE_S16_AVX2)
 
 #    define FILTER_SHIFT 15
 #    define DELEM  int16_t
@@ -77,6 +110,9 @@
 #    elif defined(TEMPLATE_RESAMPLE_S16_SSSE3)
 #        define COMMON_CORE COMMON_CORE_INT16_SSSE3
 #        define RENAME(N) N ## _int16_ssse3
+#    elif defined(TEMPLATE_RESAMPLE_S16_AVX2)
+#        define COMMON_CORE COMMON_CORE_INT16_AVX2
+#        define RENAME(N) N ## _int16_avx2
 #    endif
 
 #endif
@@ -72,8 +72,9 @@ static int flush(struct SwrContext *s){
 }
 
 static int process(
-        struct ResampleContext * c, AudioData *dst, int dst_size,
+        struct SwrContext *s, AudioData *dst, int dst_size,
         AudioData *src, int src_size, int *consumed){
+    struct ResampleContext *c = s->resample;
     size_t idone, odone;
     soxr_error_t error = soxr_set_error((soxr_t)c, soxr_set_num_channels((soxr_t)c, src->ch_count));
     error = soxr_process((soxr_t)c, src->ch, (size_t)src_size,
@@ -89,5 +90,6 @@ static int64_t get_delay(struct SwrContext *s, int64_t base){
 
 struct Resampler const soxr_resampler={
     create, destroy, process, flush, NULL /* set_compensation */, get_delay,
+    NULL /* get_lookahead */,
 };
 
@@ -23,6 +23,7 @@
 #include "audioconvert.h"
 #include "libavutil/avassert.h"
 #include "libavutil/channel_layout.h"
+#include "libavutil/cpu.h"
 
 #include <float.h>
 
@@ -128,6 +129,8 @@ static const AVOption options[]={
 { "kaiser_beta"         , "set swr Kaiser Window Beta"  , OFFSET(kaiser_beta)    , AV_OPT_TYPE_INT  , {.i64=9                     }, 2      , 16        , PARAM },
 
 { "output_sample_bits"  , "set swr number of output sample bits", OFFSET(dither.output_sample_bits), AV_OPT_TYPE_INT  , {.i64=0   }, 0      , 64        , PARAM },
+
+{ "threads"             , "set number of threads"       , OFFSET(nb_threads)     , AV_OPT_TYPE_INT  , {.i64=1                     }, 0      , INT_MAX   , PARAM },
 {0}
 };
 
@@ -234,6 +237,8 @@ av_cold void swr_free(SwrContext **ss){
         if (s->resampler)
             s->resampler->free(&s->resample);
         swri_rematrix_free(s);
+        if (HAVE_THREADS)
+            swri_thread_free(s);
     }
 
     av_freep(ss);
@@ -258,6 +263,8 @@ av_cold int swr_init(struct SwrContext *s){
     swri_audio_convert_free(&s->out_convert);
     swri_audio_convert_free(&s->full_convert);
     swri_rematrix_free(s);
+    if (HAVE_THREADS)
+        swri_thread_free(s);
 
     s->flushed = 0;
 
@@ -432,6 +439,14 @@ av_assert0(s->out.ch_count);
         set_audiodata_fmt(&s->in_buffer, s->int_sample_fmt);
     }
 
+    if(HAVE_THREADS && s->resample && s->resampler == &swri_resampler && s->nb_threads != 1){
+        int nb_threads = s->nb_threads ? s->nb_threads : av_cpu_count();
+        /* the last channel is resampled by the calling thread */
+        nb_threads = FFMIN(nb_threads, s->in_buffer.ch_count - 1);
+        if(nb_threads > 1 && (ret = swri_thread_init(s, nb_threads)) < 0)
+            return ret;
+    }
+
     if ((ret = swri_dither_init(s, s->out_sample_fmt, s->int_sample_fmt)) < 0)
         return ret;
 
@@ -545,7 +560,7 @@ static int resample(SwrContext *s, AudioData *out_param, int out_count,
         int ret, size, consumed;
         if(!s->resample_in_constraint && s->in_buffer_count){
             buf_set(&tmp, &s->in_buffer, s->in_buffer_index);
-            ret= s->resampler->multiple_resample(s->resample, &out, out_count, &tmp, s->in_buffer_count, &consumed);
+            ret= s->resampler->multiple_resample(s, &out, out_count, &tmp, s->in_buffer_count, &consumed);
             out_count -= ret;
             ret_sum += ret;
             buf_set(&out, &out, ret);
@@ -565,7 +580,7 @@ static int resample(SwrContext *s, AudioData *out_param, int out_count,
 
         if((s->flushed || in_count) && !s->in_buffer_count){
             s->in_buffer_index=0;
-            ret= s->resampler->multiple_resample(s->resample, &out, out_count, &in, in_count, &consumed);
+            ret= s->resampler->multiple_resample(s, &out, out_count, &in, in_count, &consumed);
             out_count -= ret;
             ret_sum += ret;
             buf_set(&out, &out, ret);
@@ -878,6 +893,15 @@ int64_t swr_get_delay(struct SwrContext *s, int64_t base){
     }
 }
 
+int64_t swr_get_lookahead(struct SwrContext *s, int64_t base){
+    if (s->resampler && s->resample){
+        if (!s->resampler->get_lookahead)
+            return AVERROR(ENOSYS);
+        return s->resampler->get_lookahead(s, base);
+    }
+    return 0;
+}
+
 int swr_set_compensation(struct SwrContext *s, int sample_delta, int compensation_distance){
     int ret;
 
@@ -289,6 +289,23 @@ int swr_inject_silence(struct SwrContext *s, int count);
  */
 int64_t swr_get_delay(struct SwrContext *s, int64_t base);
 
+/**
+ * Gets the algorithmic delay of the resampling filter.
+ *
+ * This is how far ahead of an output sample the input must have been
+ * provided before swr_convert() can return that output sample. It does not
+ * change during the conversion, unlike swr_get_delay(), and is 0 if no
+ * sample rate conversion is done. Output timestamps computed with
+ * swr_next_pts() are not affected by it.
+ *
+ * @param s     initialized swr context
+ * @param base  timebase in which the returned delay will be, as in
+ *              swr_get_delay()
+ * @returns     the delay in 1/base units, AVERROR(ENOSYS) if the resampling
+ *              engine does not support this query.
+ */
+int64_t swr_get_lookahead(struct SwrContext *s, int64_t base);
+
 /**
  * Return the LIBSWRESAMPLE_VERSION_INT constant.
  */
@@ -39,6 +39,22 @@ typedef void (mix_1_1_func_type)(void *out, const void *in, void *coeffp, intege
 typedef void (mix_2_1_func_type)(void *out, const void *in1, const void *in2, void *coeffp, integer index1, integer index2, integer len);
 
 typedef void (mix_any_func_type)(uint8_t **out, const uint8_t **in1, void *coeffp, integer len);
+typedef void (mix_n_1_func_type)(void *out, const void **in, void *coeffp, integer nb_in, integer len);
+
+/**
+ * Noise shape two planar channels at once.
+ *
+ * @param errors interleaved errors of the two channels, 2*taps pairs
+ * @param coeffs filter coefficients, each repeated twice, zero padded to a
+ *               multiple of 4 pairs
+ * @return the noise shaping position after the last sample
+ */
+typedef int (noise_shaping_2ch_func_type)(uint8_t *dst0, uint8_t *dst1,
+                                          const uint8_t *src0, const uint8_t *src1,
+                                          const float *noise0, const float *noise1,
+                                          float *errors, const float *coeffs,
+                                          int taps, int pos, int count,
+                                          float scale, float scale_1);
 
 typedef struct AudioData{
     uint8_t *ch[SWR_CH_MAX];    ///< samples buffer per channel
@@ -61,6 +77,7 @@ struct DitherContext {
     int ns_pos;                                     ///< Noise shaping dither position
     float ns_coeffs[NS_TAPS];                       ///< Noise shaping filter coefficients
     float ns_errors[SWR_CH_MAX][2*NS_TAPS];
+    noise_shaping_2ch_func_type *noise_shaping_2ch; ///< SIMD noise shaping of channel pairs, may be NULL
     AudioData noise;                                ///< noise used for dithering
     AudioData temp;                                 ///< temporary storage when writing into the input buffer isnt possible
     int output_sample_bits;                         ///< the number of used output bits, needed to scale dither correctly
@@ -130,12 +147,15 @@ struct SwrContext {
     struct AudioConvert *full_convert;              ///< full conversion context (single conversion for input and output)
     struct ResampleContext *resample;               ///< resampling context
     struct Resampler const *resampler;              ///< resampler virtual function table
+    int nb_threads;                                 ///< number of threads requested by the user, 0 for automatic
+    struct SwrThreadContext *thread;                ///< worker threads resampling channels in parallel
 
     float matrix[SWR_CH_MAX][SWR_CH_MAX];           ///< floating point rematrixing coefficients
     uint8_t *native_matrix;
     uint8_t *native_one;
     uint8_t *native_simd_one;
     uint8_t *native_simd_matrix;
+    uint8_t *native_simd_n_matrix;                  ///< coefficients of the nonzero inputs of each output channel for mix_n_1_simd
     int32_t matrix32[SWR_CH_MAX][SWR_CH_MAX];       ///< 17.15 fixed point rematrixing coefficients
     uint8_t matrix_ch[SWR_CH_MAX][SWR_CH_MAX+1];    ///< Lists of input channels per output channel that have non zero rematrixing coefficients
     mix_1_1_func_type *mix_1_1_f;
@@ -146,16 +166,19 @@ struct SwrContext {
 
     mix_any_func_type *mix_any_f;
 
+    mix_n_1_func_type *mix_n_1_simd;                ///< mixes any number of inputs into one output channel
+
     /* TODO: callbacks for ASM optimizations */
 };
 
 typedef struct ResampleContext * (* resample_init_func)(struct ResampleContext *c, int out_rate, int in_rate, int filter_size, int phase_shift, int linear,
                                     double cutoff, enum AVSampleFormat format, enum SwrFilterType filter_type, int kaiser_beta, double precision, int cheby);
 typedef void    (* resample_free_func)(struct ResampleContext **c);
-typedef int     (* multiple_resample_func)(struct ResampleContext *c, AudioData *dst, int dst_size, AudioData *src, int src_size, int *consumed);
+typedef int     (* multiple_resample_func)(struct SwrContext *s, AudioData *dst, int dst_size, AudioData *src, int src_size, int *consumed);
 typedef int     (* resample_flush_func)(struct SwrContext *c);
 typedef int     (* set_compensation_func)(struct ResampleContext *c, int sample_delta, int compensation_distance);
 typedef int64_t (* get_delay_func)(struct SwrContext *s, int64_t base);
+typedef int64_t (* get_lookahead_func)(struct SwrContext *s, int64_t base);
 
 struct Resampler {
   resample_init_func            init;
@@ -164,6 +187,7 @@ struct Resampler {
   resample_flush_func           flush;
   set_compensation_func         set_compensation;
   get_delay_func                get_delay;
+  get_lookahead_func            get_lookahead;
 };
 
 extern struct Resampler const swri_resampler;
@@ -185,8 +209,26 @@ int swri_rematrix(SwrContext *s, AudioData *out, AudioData *in, int len, int mus
 void swri_rematrix_init_x86(struct SwrContext *s);
 
 void swri_get_dither(SwrContext *s, void *dst, int len, unsigned seed, enum AVSampleFormat noise_fmt);
+void swri_dither_init_x86(SwrContext *s, enum AVSampleFormat fmt);
 int swri_dither_init(SwrContext *s, enum AVSampleFormat out_fmt, enum AVSampleFormat in_fmt);
 
+typedef struct SwrThreadContext SwrThreadContext;
+typedef int (swri_thread_func)(SwrContext *s, void *arg, int jobnr, int nb_jobs);
+
+/**
+ * Start nb_threads worker threads for swri_thread_execute().
+ */
+int swri_thread_init(SwrContext *s, int nb_threads);
+
+/**
+ * Run func for the jobs 0 to nb_jobs - 1 on the worker threads and wait
+ * for all of them, the return value of each job is stored in rets.
+ */
+int swri_thread_execute(SwrContext *s, swri_thread_func *func,
+                        void *arg, int *rets, int nb_jobs);
+
+void swri_thread_free(SwrContext *s);
+
 void swri_audio_convert_init_arm(struct AudioConvert *ac,
                                  enum AVSampleFormat out_fmt,
                                  enum AVSampleFormat in_fmt,
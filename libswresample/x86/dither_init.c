@@ -0,0 +1,201 @@
+/*
+ * This file is part of libswresample
+ *
+ * libswresample is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libswresample is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libswresample; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/mem.h"
+#include "libavutil/x86/asm.h"
+#include "libavutil/x86/cpu.h"
+#include "libswresample/swresample_internal.h"
+
+#if HAVE_SSE4_INLINE && ARCH_X86_64
+
+/*
+ * Noise shaping of two channels at once, the low half of each register holds
+ * the first one. errors and coeffs hold interleaved pairs of values, for the
+ * two channels. The operations are done in the same order and precision as
+ * in the C version, so the results are identical.
+ */
+
+#define LOAD_INT16                                 \
+    "pxor          %%xmm0, %%xmm0           \n\t"  \
+    "pinsrw    $0, %[ia],  %%xmm0           \n\t"  \
+    "pinsrw    $2, %[ib],  %%xmm0           \n\t"  \
+    "pslld        $16,     %%xmm0           \n\t"  \
+    "psrad        $16,     %%xmm0           \n\t"  \
+    "cvtdq2ps      %%xmm0, %%xmm0           \n\t"  \
+    "mulps         %[s_1], %%xmm0           \n\t"  \
+    "cvtps2pd      %%xmm0, %%xmm0           \n\t"
+
+#define LOAD_INT32                                 \
+    "movd          %[ia],  %%xmm0           \n\t"  \
+    "pinsrd    $1, %[ib],  %%xmm0           \n\t"  \
+    "cvtdq2ps      %%xmm0, %%xmm0           \n\t"  \
+    "mulps         %[s_1], %%xmm0           \n\t"  \
+    "cvtps2pd      %%xmm0, %%xmm0           \n\t"
+
+#define LOAD_FLOAT                                 \
+    "movss         %[ia],  %%xmm0           \n\t"  \
+    "insertps $0x10, %[ib], %%xmm0          \n\t"  \
+    "mulps         %[s_1], %%xmm0           \n\t"  \
+    "cvtps2pd      %%xmm0, %%xmm0           \n\t"
+
+#define LOAD_DOUBLE                                \
+    "movsd         %[ia],  %%xmm0           \n\t"  \
+    "movhpd        %[ib],  %%xmm0           \n\t"  \
+    "mulpd         %[s_1], %%xmm0           \n\t"
+
+/* clip like FFMAX(FFMIN(v, max), min), including for NaN */
+#define CLIP                                       \
+    "movapd        %[max], %%xmm7           \n\t"  \
+    "minpd         %%xmm5, %%xmm7           \n\t"  \
+    "maxpd         %[min], %%xmm7           \n\t"  \
+    "cvttpd2dq     %%xmm7, %%xmm7           \n\t"
+
+#define STORE_INT16                                \
+    CLIP                                           \
+    "pextrw    $0, %%xmm7, %[oa]            \n\t"  \
+    "pextrw    $2, %%xmm7, %[ob]            \n\t"
+
+#define STORE_INT32                                \
+    CLIP                                           \
+    "movd          %%xmm7, %[oa]            \n\t"  \
+    "pextrd    $1, %%xmm7, %[ob]            \n\t"
+
+#define STORE_FLOAT                                \
+    "cvtpd2ps      %%xmm5, %%xmm5           \n\t"  \
+    "movss         %%xmm5, %[oa]            \n\t"  \
+    "extractps $1, %%xmm5, %[ob]            \n\t"
+
+#define STORE_DOUBLE                               \
+    "movlpd        %%xmm5, %[oa]            \n\t"  \
+    "movhpd        %%xmm5, %[ob]            \n\t"
+
+#define NOISE_SHAPING_2CH(name, type, stype, LOAD, STORE, minv, maxv)        \
+static int noise_shaping_2ch_ ## name ## _sse4(uint8_t *dst0, uint8_t *dst1,  \
+                                               const uint8_t *src0,           \
+                                               const uint8_t *src1,           \
+                                               const float *noise0,           \
+                                               const float *noise1,           \
+                                               float *errors,                 \
+                                               const float *coeffs,           \
+                                               int taps, int pos, int count,  \
+                                               float scale, float scale_1)    \
+{                                                                             \
+    DECLARE_ALIGNED(16, stype,  s_1)[16 / sizeof(stype)];                     \
+    DECLARE_ALIGNED(16, double, s)[2]   = { scale, scale };                   \
+    DECLARE_ALIGNED(16, double, min)[2] = { minv, minv };                     \
+    DECLARE_ALIGNED(16, double, max)[2] = { maxv, maxv };                     \
+    const type *a = (const type *)src0, *b = (const type *)src1;              \
+    type *da = (type *)dst0, *db = (type *)dst1;                              \
+    x86_reg groups = (taps + 1) / 4, tail = groups * 4 < taps;                \
+    int i;                                                                    \
+                                                                              \
+    for (i = 0; i < 16 / sizeof(stype); i++)                                  \
+        s_1[i] = scale_1;                                                     \
+                                                                              \
+    for (i = 0; i < count; i++) {                                             \
+        const float *cp = coeffs;                                             \
+        const float *ep = errors + 2 * pos;                                   \
+        x86_reg g = groups;                                                   \
+                                                                              \
+        pos = pos ? pos - 1 : taps - 1;                                       \
+                                                                              \
+        __asm__ volatile(                                                     \
+            LOAD                                                              \
+            "1:                                     \n\t"                     \
+            "movsd       (%[cp]), %%xmm2            \n\t"                     \
+            "movsd       (%[ep]), %%xmm3            \n\t"                     \
+            "mulps        %%xmm3, %%xmm2            \n\t"                     \
+            "movsd      8(%[cp]), %%xmm3            \n\t"                     \
+            "movsd      8(%[ep]), %%xmm4            \n\t"                     \
+            "mulps        %%xmm4, %%xmm3            \n\t"                     \
+            "addps        %%xmm3, %%xmm2            \n\t"                     \
+            "movsd     16(%[cp]), %%xmm3            \n\t"                     \
+            "movsd     16(%[ep]), %%xmm4            \n\t"                     \
+            "mulps        %%xmm4, %%xmm3            \n\t"                     \
+            "addps        %%xmm3, %%xmm2            \n\t"                     \
+            "movsd     24(%[cp]), %%xmm3            \n\t"                     \
+            "movsd     24(%[ep]), %%xmm4            \n\t"                     \
+            "mulps        %%xmm4, %%xmm3            \n\t"                     \
+            "addps        %%xmm3, %%xmm2            \n\t"                     \
+            "cvtps2pd     %%xmm2, %%xmm2            \n\t"                     \
+            "subpd        %%xmm2, %%xmm0            \n\t"                     \
+            "add             $32, %[cp]             \n\t"                     \
+            "add             $32, %[ep]             \n\t"                     \
+            "sub              $1, %[g]              \n\t"                     \
+            "jg 1b                                  \n\t"                     \
+            "test       %[tail], %[tail]            \n\t"                     \
+            "jz 2f                                  \n\t"                     \
+            "movsd       (%[cp]), %%xmm2            \n\t"                     \
+            "movsd       (%[ep]), %%xmm3            \n\t"                     \
+            "mulps        %%xmm3, %%xmm2            \n\t"                     \
+            "cvtps2pd     %%xmm2, %%xmm2            \n\t"                     \
+            "subpd        %%xmm2, %%xmm0            \n\t"                     \
+            "2:                                     \n\t"                     \
+            "movss        %[n0],  %%xmm5            \n\t"                     \
+            "insertps $0x10, %[n1], %%xmm5          \n\t"                     \
+            "cvtps2pd     %%xmm5, %%xmm5            \n\t"                     \
+            "addpd        %%xmm0, %%xmm5            \n\t"                     \
+            "roundpd  $4, %%xmm5, %%xmm5            \n\t" /* rint() */        \
+            "movapd       %%xmm5, %%xmm6            \n\t"                     \
+            "subpd        %%xmm0, %%xmm6            \n\t"                     \
+            "cvtpd2ps     %%xmm6, %%xmm6            \n\t"                     \
+            "movsd        %%xmm6, %[e0]             \n\t"                     \
+            "movsd        %%xmm6, %[e1]             \n\t"                     \
+            "mulpd        %[s],   %%xmm5            \n\t"                     \
+            STORE                                                             \
+            : [cp]"+&r"(cp), [ep]"+&r"(ep), [g]"+&r"(g),                      \
+              [oa]"=m"(da[i]), [ob]"=m"(db[i]),                               \
+              [e0]"=m"(*(double *)(errors + 2 * pos)),                        \
+              [e1]"=m"(*(double *)(errors + 2 * (pos + taps)))                \
+            : [tail]"r"(tail), [s_1]"m"(*s_1), [s]"m"(*s),                    \
+              [min]"m"(*min), [max]"m"(*max),                                 \
+              [n0]"m"(noise0[i]), [n1]"m"(noise1[i]),                         \
+              [ia]"m"(a[i]), [ib]"m"(b[i])                                    \
+            : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",                \
+                           "%xmm4", "%xmm5", "%xmm6", "%xmm7",)               \
+              "memory"                                                        \
+        );                                                                    \
+    }                                                                         \
+                                                                              \
+    return pos;                                                               \
+}
+
+NOISE_SHAPING_2CH(int16,  int16_t, float,  LOAD_INT16,  STORE_INT16,  INT16_MIN, INT16_MAX)
+NOISE_SHAPING_2CH(int32,  int32_t, float,  LOAD_INT32,  STORE_INT32,  INT32_MIN, INT32_MAX)
+NOISE_SHAPING_2CH(float,  float,   float,  LOAD_FLOAT,  STORE_FLOAT,  0, 0)
+NOISE_SHAPING_2CH(double, double,  double, LOAD_DOUBLE, STORE_DOUBLE, 0, 0)
+
+#endif /* HAVE_SSE4_INLINE && ARCH_X86_64 */
+
+av_cold void swri_dither_init_x86(SwrContext *s, enum AVSampleFormat fmt)
+{
+#if HAVE_SSE4_INLINE && ARCH_X86_64
+    int mm_flags = av_get_cpu_flags();
+
+    if (INLINE_SSE4(mm_flags)) {
+        switch (fmt) {
+        case AV_SAMPLE_FMT_S16P: s->dither.noise_shaping_2ch = noise_shaping_2ch_int16_sse4;  break;
+        case AV_SAMPLE_FMT_S32P: s->dither.noise_shaping_2ch = noise_shaping_2ch_int32_sse4;  break;
+        case AV_SAMPLE_FMT_FLTP: s->dither.noise_shaping_2ch = noise_shaping_2ch_float_sse4;  break;
+        case AV_SAMPLE_FMT_DBLP: s->dither.noise_shaping_2ch = noise_shaping_2ch_double_sse4; break;
+        }
+    }
+#endif
+}
@@ -223,6 +223,80 @@ mix_2_1_int16_u_int %+ SUFFIX
 %endif
 %endmacro
 
+%if ARCH_X86_64
+; Mix the nb_in channels in[] into out, with the coefficients of coeffp.
+; The accumulation is done in registers, so every output sample is written
+; once whatever the number of inputs.
+%macro MIXN_FLT 0
+cglobal mix_n_1_float, 5, 8, 4, out, in, coeffp, n, len, off, j, ptr
+    shl        lenq, 2
+    xor        offq, offq
+.next:
+    xorps        m0, m0
+    xorps        m1, m1
+    xor          jq, jq
+.inner:
+    mov        ptrq, [inq + 8*jq]
+    VBROADCASTSS m2, [coeffpq + 4*jq]
+    movu         m3, [ptrq + offq         ]
+    mulps        m3, m3, m2
+    addps        m0, m0, m3
+    movu         m3, [ptrq + offq + mmsize]
+    mulps        m3, m3, m2
+    addps        m1, m1, m3
+    add          jq, 1
+    cmp          jq, nq
+        jl .inner
+    movu  [outq + offq         ], m0
+    movu  [outq + offq + mmsize], m1
+    add        offq, mmsize*2
+    cmp        offq, lenq
+        jl .next
+    REP_RET
+%endmacro
+
+; coeffp[0] is the right shift, followed by one pair of 16 bit coefficients
+; per pair of inputs. An odd nb_in is padded with a zero coefficient.
+%macro MIXN_INT16 0
+cglobal mix_n_1_int16, 5, 8, 8, out, in, coeffp, n, len, off, j, ptr
+    movd         m7, [coeffpq]
+    mova         m6, [dw1]
+    pslld        m6, m7
+    psrld        m6, 1
+    add        lenq, lenq
+    xor        offq, offq
+.next:
+    mova         m0, m6
+    mova         m1, m6
+    xor          jq, jq
+.inner:
+    mov        ptrq, [inq + 8*jq    ]
+    movu         m2, [ptrq + offq]
+    mov        ptrq, [inq + 8*jq + 8]
+    movu         m3, [ptrq + offq]
+    movd         m4, [coeffpq + 2*jq + 4]
+    pshufd       m4, m4, 0
+    mova         m5, m2
+    punpcklwd    m2, m3
+    punpckhwd    m5, m3
+    pmaddwd      m2, m4
+    pmaddwd      m5, m4
+    paddd        m0, m2
+    paddd        m1, m5
+    add          jq, 2
+    cmp          jq, nq
+        jl .inner
+    psrad        m0, m7
+    psrad        m1, m7
+    packssdw     m0, m1
+    movu  [outq + offq], m0
+    add        offq, mmsize
+    cmp        offq, lenq
+        jl .next
+    REP_RET
+%endmacro
+%endif
+
 
 INIT_MMX mmx
 MIX1_INT16 u
@@ -235,12 +309,18 @@ MIX2_FLT u
 MIX2_FLT a
 MIX1_FLT u
 MIX1_FLT a
+%if ARCH_X86_64
+MIXN_FLT
+%endif
 
 INIT_XMM sse2
 MIX1_INT16 u
 MIX1_INT16 a
 MIX2_INT16 u
 MIX2_INT16 a
+%if ARCH_X86_64
+MIXN_INT16
+%endif
 
 %if HAVE_AVX_EXTERNAL
 INIT_YMM avx
@@ -248,4 +328,7 @@ MIX2_FLT u
 MIX2_FLT a
 MIX1_FLT u
 MIX1_FLT a
+%if ARCH_X86_64
+MIXN_FLT
+%endif
 %endif
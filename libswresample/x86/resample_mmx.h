@@ -24,6 +24,13 @@
 
 int swri_resample_int16_mmx2 (struct ResampleContext *c, int16_t *dst, const int16_t *src, int *consumed, int src_size, int dst_size, int update_ctx);
 int swri_resample_int16_ssse3(struct ResampleContext *c, int16_t *dst, const int16_t *src, int *consumed, int src_size, int dst_size, int update_ctx);
+int swri_resample_int16_avx2 (struct ResampleContext *c, int16_t *dst, const int16_t *src, int *consumed, int src_size, int dst_size, int update_ctx);
+int swri_resample_float_sse  (struct ResampleContext *c, float   *dst, const float   *src, int *consumed, int src_size, int dst_size, int update_ctx);
+int swri_resample_float_avx  (struct ResampleContext *c, float   *dst, const float   *src, int *consumed, int src_size, int dst_size, int update_ctx);
+int swri_resample_float_fma3 (struct ResampleContext *c, float   *dst, const float   *src, int *consumed, int src_size, int dst_size, int update_ctx);
+int swri_resample_double_sse2(struct ResampleContext *c, double  *dst, const double  *src, int *consumed, int src_size, int dst_size, int update_ctx);
+int swri_resample_double_avx (struct ResampleContext *c, double  *dst, const double  *src, int *consumed, int src_size, int dst_size, int update_ctx);
+int swri_resample_double_fma3(struct ResampleContext *c, double  *dst, const double  *src, int *consumed, int src_size, int dst_size, int update_ctx);
 
 DECLARE_ALIGNED(16, const uint64_t, ff_resample_int16_rounder)[2]    = { 0x0000000000004000ULL, 0x0000000000000000ULL};
 
@@ -68,3 +75,161 @@ __asm__ volatile(\
       "r" (((uint8_t*)filter)-len),\
       "r" (dst+dst_index)\
 );
+
+/* Whole ymm registers of 16 taps, then xmm registers of 8 taps. Like the
+ * SSSE3 version, the last xmm load may read past filter_length; the taps
+ * there are zero. */
+#define COMMON_CORE_INT16_AVX2 \
+    x86_reg len= -2*c->filter_length;\
+__asm__ volatile(\
+    "vmovdqa "MANGLE(ff_resample_int16_rounder)", %%xmm0 \n\t"\
+    "cmp     $-32, %0                      \n\t"\
+    " jg 2f                                \n\t"\
+    "1:                                    \n\t"\
+    "vmovdqu  (%1, %0), %%ymm1             \n\t"\
+    "vpmaddwd (%2, %0), %%ymm1, %%ymm1     \n\t"\
+    "vpaddd   %%ymm1, %%ymm0, %%ymm0       \n\t"\
+    "add      $32, %0                      \n\t"\
+    "cmp     $-32, %0                      \n\t"\
+    " jle 1b                               \n\t"\
+    "2:                                    \n\t"\
+    "test      %0, %0                      \n\t"\
+    " jns 3f                               \n\t"\
+    "vmovdqu  (%1, %0), %%xmm1             \n\t"\
+    "vpmaddwd (%2, %0), %%xmm1, %%xmm1     \n\t"\
+    "vpaddd   %%ymm1, %%ymm0, %%ymm0       \n\t"\
+    "add      $16, %0                      \n\t"\
+    " jmp 2b                               \n\t"\
+    "3:                                    \n\t"\
+    "vextracti128 $1, %%ymm0, %%xmm1       \n\t"\
+    "vpaddd   %%xmm1, %%xmm0, %%xmm0       \n\t"\
+    "vphaddd  %%xmm0, %%xmm0, %%xmm0       \n\t"\
+    "vphaddd  %%xmm0, %%xmm0, %%xmm0       \n\t"\
+    "vpsrad   $15, %%xmm0, %%xmm0          \n\t"\
+    "vpackssdw %%xmm0, %%xmm0, %%xmm0      \n\t"\
+    "vpextrw  $0, %%xmm0, (%3)             \n\t"\
+    "vzeroupper                            \n\t"\
+    : "+r" (len)\
+    : "r" (((uint8_t*)(src+sample_index))-len),\
+      "r" (((uint8_t*)filter)-len),\
+      "r" (dst+dst_index)\
+    XMM_CLOBBERS_ONLY("%xmm0", "%xmm1")\
+);
+
+/* The float and double cores only run over whole registers, the remaining
+ * taps are added in C so that nothing past the end of src is read. They
+ * need filter_length to be at least one register wide. */
+#define COMMON_CORE_FLT_SSE \
+    x86_reg len= -4*(c->filter_length & ~3);\
+    float val;\
+__asm__ volatile(\
+    "xorps     %%xmm0, %%xmm0     \n\t"\
+    "1:                           \n\t"\
+    "movups  (%2, %0), %%xmm1     \n\t"\
+    "mulps   (%3, %0), %%xmm1     \n\t"\
+    "addps   %%xmm1, %%xmm0       \n\t"\
+    "add       $16, %0            \n\t"\
+    " js 1b                       \n\t"\
+    "movhlps   %%xmm0, %%xmm1     \n\t"\
+    "addps     %%xmm1, %%xmm0     \n\t"\
+    "movss     %%xmm0, %%xmm1     \n\t"\
+    "shufps $1, %%xmm0, %%xmm0    \n\t"\
+    "addss     %%xmm1, %%xmm0     \n\t"\
+    "movss     %%xmm0, %1         \n\t"\
+    : "+r" (len), "=m" (val)\
+    : "r" (((uint8_t*)(src+sample_index))-len),\
+      "r" (((uint8_t*)filter)-len)\
+    XMM_CLOBBERS_ONLY("%xmm0", "%xmm1")\
+);\
+    for(i = c->filter_length & ~3; i < c->filter_length; i++)\
+        val += src[sample_index + i] * filter[i];\
+    dst[dst_index] = val;
+
+#define COMMON_CORE_FLT_AVX_LOOP(mac) \
+    x86_reg len= -4*(c->filter_length & ~7);\
+    float val;\
+__asm__ volatile(\
+    "vxorps    %%ymm0, %%ymm0, %%ymm0   \n\t"\
+    "1:                                 \n\t"\
+    "vmovups  (%2, %0), %%ymm1          \n\t"\
+    mac\
+    "add       $32, %0                  \n\t"\
+    " js 1b                             \n\t"\
+    "vextractf128 $1, %%ymm0, %%xmm1    \n\t"\
+    "vaddps    %%xmm1, %%xmm0, %%xmm0   \n\t"\
+    "vmovhlps  %%xmm0, %%xmm1, %%xmm1   \n\t"\
+    "vaddps    %%xmm1, %%xmm0, %%xmm0   \n\t"\
+    "vshufps $1, %%xmm0, %%xmm0, %%xmm1 \n\t"\
+    "vaddss    %%xmm1, %%xmm0, %%xmm0   \n\t"\
+    "vmovss    %%xmm0, %1               \n\t"\
+    "vzeroupper                         \n\t"\
+    : "+r" (len), "=m" (val)\
+    : "r" (((uint8_t*)(src+sample_index))-len),\
+      "r" (((uint8_t*)filter)-len)\
+    XMM_CLOBBERS_ONLY("%xmm0", "%xmm1")\
+);\
+    for(i = c->filter_length & ~7; i < c->filter_length; i++)\
+        val += src[sample_index + i] * filter[i];\
+    dst[dst_index] = val;
+
+#define COMMON_CORE_FLT_AVX COMMON_CORE_FLT_AVX_LOOP(\
+    "vmulps   (%3, %0), %%ymm1, %%ymm1  \n\t"\
+    "vaddps    %%ymm1, %%ymm0, %%ymm0   \n\t")
+
+#define COMMON_CORE_FLT_FMA3 COMMON_CORE_FLT_AVX_LOOP(\
+    "vfmadd231ps (%3, %0), %%ymm1, %%ymm0 \n\t")
+
+#define COMMON_CORE_DBL_SSE2 \
+    x86_reg len= -8*(c->filter_length & ~1);\
+    double val;\
+__asm__ volatile(\
+    "xorpd     %%xmm0, %%xmm0     \n\t"\
+    "1:                           \n\t"\
+    "movupd  (%2, %0), %%xmm1     \n\t"\
+    "mulpd   (%3, %0), %%xmm1     \n\t"\
+    "addpd   %%xmm1, %%xmm0       \n\t"\
+    "add       $16, %0            \n\t"\
+    " js 1b                       \n\t"\
+    "movhlps   %%xmm0, %%xmm1     \n\t"\
+    "addsd     %%xmm1, %%xmm0     \n\t"\
+    "movsd     %%xmm0, %1         \n\t"\
+    : "+r" (len), "=m" (val)\
+    : "r" (((uint8_t*)(src+sample_index))-len),\
+      "r" (((uint8_t*)filter)-len)\
+    XMM_CLOBBERS_ONLY("%xmm0", "%xmm1")\
+);\
+    for(i = c->filter_length & ~1; i < c->filter_length; i++)\
+        val += src[sample_index + i] * filter[i];\
+    dst[dst_index] = val;
+
+#define COMMON_CORE_DBL_AVX_LOOP(mac) \
+    x86_reg len= -8*(c->filter_length & ~3);\
+    double val;\
+__asm__ volatile(\
+    "vxorpd    %%ymm0, %%ymm0, %%ymm0   \n\t"\
+    "1:                                 \n\t"\
+    "vmovupd  (%2, %0), %%ymm1          \n\t"\
+    mac\
+    "add       $32, %0                  \n\t"\
+    " js 1b                             \n\t"\
+    "vextractf128 $1, %%ymm0, %%xmm1    \n\t"\
+    "vaddpd    %%xmm1, %%xmm0, %%xmm0   \n\t"\
+    "vmovhlps  %%xmm0, %%xmm1, %%xmm1   \n\t"\
+    "vaddsd    %%xmm1, %%xmm0, %%xmm0   \n\t"\
+    "vmovsd    %%xmm0, %1               \n\t"\
+    "vzeroupper                         \n\t"\
+    : "+r" (len), "=m" (val)\
+    : "r" (((uint8_t*)(src+sample_index))-len),\
+      "r" (((uint8_t*)filter)-len)\
+    XMM_CLOBBERS_ONLY("%xmm0", "%xmm1")\
+);\
+    for(i = c->filter_length & ~3; i < c->filter_length; i++)\
+        val += src[sample_index + i] * filter[i];\
+    dst[dst_index] = val;
+
+#define COMMON_CORE_DBL_AVX COMMON_CORE_DBL_AVX_LOOP(\
+    "vmulpd   (%3, %0), %%ymm1, %%ymm1  \n\t"\
+    "vaddpd    %%ymm1, %%ymm0, %%ymm0   \n\t")
+
+#define COMMON_CORE_DBL_FMA3 COMMON_CORE_DBL_AVX_LOOP(\
+    "vfmadd231pd (%3, %0), %%ymm1, %%ymm0 \n\t")
@@ -29,6 +29,8 @@ PROTO4()
 PROTO4(_pack_2ch)
 PROTO4(_pack_6ch)
 PROTO4(_unpack_2ch)
+PROTO(, int32, double, sse2)
+PROTO(, double, int32, sse2)
 
 av_cold void swri_audio_convert_init_x86(struct AudioConvert *ac,
                                  enum AVSampleFormat out_fmt,
@@ -67,6 +69,10 @@ MULTI_CAPS_FUNC(AV_CPU_FLAG_SSE2, sse2)
             ac->simd_f =  ff_float_to_int32_a_sse2;
         if(   out_fmt == AV_SAMPLE_FMT_S16  && in_fmt == AV_SAMPLE_FMT_FLT || out_fmt == AV_SAMPLE_FMT_S16P && in_fmt == AV_SAMPLE_FMT_FLTP)
             ac->simd_f =  ff_float_to_int16_a_sse2;
+        if(   out_fmt == AV_SAMPLE_FMT_DBL  && in_fmt == AV_SAMPLE_FMT_S32 || out_fmt == AV_SAMPLE_FMT_DBLP && in_fmt == AV_SAMPLE_FMT_S32P)
+            ac->simd_f =  ff_int32_to_double_a_sse2;
+        if(   out_fmt == AV_SAMPLE_FMT_S32  && in_fmt == AV_SAMPLE_FMT_DBL || out_fmt == AV_SAMPLE_FMT_S32P && in_fmt == AV_SAMPLE_FMT_DBLP)
+            ac->simd_f =  ff_double_to_int32_a_sse2;
 
         if(channels == 2) {
             if(   out_fmt == AV_SAMPLE_FMT_FLT  && in_fmt == AV_SAMPLE_FMT_FLTP || out_fmt == AV_SAMPLE_FMT_S32 && in_fmt == AV_SAMPLE_FMT_S32P)
@@ -148,6 +154,10 @@ D(float, avx)
 D(int16, mmx)
 D(int16, sse2)
 
+mix_n_1_func_type ff_mix_n_1_float_sse;
+mix_n_1_func_type ff_mix_n_1_float_avx;
+mix_n_1_func_type ff_mix_n_1_int16_sse2;
+
 
 av_cold void swri_rematrix_init_x86(struct SwrContext *s){
     int mm_flags = av_get_cpu_flags();
@@ -158,6 +168,7 @@ av_cold void swri_rematrix_init_x86(struct SwrContext *s){
 
     s->mix_1_1_simd = NULL;
     s->mix_2_1_simd = NULL;
+    s->mix_n_1_simd = NULL;
 
     if (s->midbuf.fmt == AV_SAMPLE_FMT_S16P){
         if(mm_flags & AV_CPU_FLAG_MMX) {
@@ -168,9 +179,13 @@ av_cold void swri_rematrix_init_x86(struct SwrContext *s){
             s->mix_1_1_simd = ff_mix_1_1_a_int16_sse2;
             s->mix_2_1_simd = ff_mix_2_1_a_int16_sse2;
         }
-        s->native_simd_matrix = av_mallocz(2 * num * sizeof(int16_t));
-        s->native_simd_one    = av_mallocz(2 * sizeof(int16_t));
+        if(ARCH_X86_64 && mm_flags & AV_CPU_FLAG_SSE2)
+            s->mix_n_1_simd = ff_mix_n_1_int16_sse2;
+        s->native_simd_matrix   = av_mallocz(2 * num * sizeof(int16_t));
+        s->native_simd_one      = av_mallocz(2 * sizeof(int16_t));
+        s->native_simd_n_matrix = av_mallocz(nb_out * (SWR_CH_MAX + 1) * sizeof(int32_t));
         for(i=0; i<nb_out; i++){
+            int32_t *coeffs = (int32_t*)s->native_simd_n_matrix + i * (SWR_CH_MAX + 1);
             int sh = 0;
             for(j=0; j<nb_in; j++)
                 sh = FFMAX(sh, FFABS(((int*)s->native_matrix)[i * nb_in + j]));
@@ -180,6 +195,10 @@ av_cold void swri_rematrix_init_x86(struct SwrContext *s){
                 ((int16_t*)s->native_simd_matrix)[2*(i * nb_in + j)] =
                     ((((int*)s->native_matrix)[i * nb_in + j]) + (1<<sh>>1)) >> sh;
             }
+            /* shift, then the coefficients of the nonzero inputs as 16 bit pairs */
+            coeffs[0] = 15 - sh;
+            for(j=0; j<s->matrix_ch[i][0]; j++)
+                ((int16_t*)(coeffs + 1))[j] = ((int16_t*)s->native_simd_matrix)[2*(i * nb_in + s->matrix_ch[i][1+j])];
         }
         ((int16_t*)s->native_simd_one)[1] = 14;
         ((int16_t*)s->native_simd_one)[0] = 16384;
@@ -192,9 +211,17 @@ av_cold void swri_rematrix_init_x86(struct SwrContext *s){
             s->mix_1_1_simd = ff_mix_1_1_a_float_avx;
             s->mix_2_1_simd = ff_mix_2_1_a_float_avx;
         }
+        if(ARCH_X86_64 && mm_flags & AV_CPU_FLAG_SSE)
+            s->mix_n_1_simd = ff_mix_n_1_float_sse;
+        if(ARCH_X86_64 && HAVE_AVX_EXTERNAL && mm_flags & AV_CPU_FLAG_AVX)
+            s->mix_n_1_simd = ff_mix_n_1_float_avx;
         s->native_simd_matrix = av_mallocz(num * sizeof(float));
         memcpy(s->native_simd_matrix, s->native_matrix, num * sizeof(float));
         s->native_simd_one = av_mallocz(sizeof(float));
         memcpy(s->native_simd_one, s->native_one, sizeof(float));
+        s->native_simd_n_matrix = av_mallocz(nb_out * (SWR_CH_MAX + 1) * sizeof(float));
+        for(i=0; i<nb_out; i++)
+            for(j=0; j<s->matrix_ch[i][0]; j++)
+                ((float*)s->native_simd_n_matrix)[i * (SWR_CH_MAX + 1) + j] = s->matrix[i][s->matrix_ch[i][1+j]];
     }
 }
@@ -84,6 +84,10 @@ int main(int argc, char **argv)
             FUNC(4, 2, rgb32tobgr16),
             FUNC(4, 3, rgb32tobgr24),
             FUNC(4, 4, shuffle_bytes_2103), /* rgb32tobgr32 */
+            FUNC(4, 4, shuffle_bytes_0321),
+            FUNC(4, 4, shuffle_bytes_1230),
+            FUNC(4, 4, shuffle_bytes_3012),
+            FUNC(4, 4, shuffle_bytes_3210),
             FUNC(6, 6, rgb48tobgr48_nobswap),
             FUNC(6, 6, rgb48tobgr48_bswap),
             FUNC(8, 6, rgb64to48_nobswap),
@@ -33,9 +33,11 @@
 #include "swscale_internal.h"
 
 void (*rgb32tobgr24)(const uint8_t *src, uint8_t *dst, int src_size);
+void (*rgb32to24)(const uint8_t *src, uint8_t *dst, int src_size);
 void (*rgb32tobgr16)(const uint8_t *src, uint8_t *dst, int src_size);
 void (*rgb32tobgr15)(const uint8_t *src, uint8_t *dst, int src_size);
 void (*rgb24tobgr32)(const uint8_t *src, uint8_t *dst, int src_size);
+void (*rgb24to32)(const uint8_t *src, uint8_t *dst, int src_size);
 void (*rgb24tobgr24)(const uint8_t *src, uint8_t *dst, int src_size);
 void (*rgb24tobgr16)(const uint8_t *src, uint8_t *dst, int src_size);
 void (*rgb24tobgr15)(const uint8_t *src, uint8_t *dst, int src_size);
@@ -51,7 +53,11 @@ void (*rgb16to15)(const uint8_t *src, uint8_t *dst, int src_size);
 void (*rgb15to16)(const uint8_t *src, uint8_t *dst, int src_size);
 void (*rgb15to32)(const uint8_t *src, uint8_t *dst, int src_size);
 
+void (*shuffle_bytes_0321)(const uint8_t *src, uint8_t *dst, int src_size);
+void (*shuffle_bytes_1230)(const uint8_t *src, uint8_t *dst, int src_size);
 void (*shuffle_bytes_2103)(const uint8_t *src, uint8_t *dst, int src_size);
+void (*shuffle_bytes_3012)(const uint8_t *src, uint8_t *dst, int src_size);
+void (*shuffle_bytes_3210)(const uint8_t *src, uint8_t *dst, int src_size);
 
 void (*yv12toyuy2)(const uint8_t *ysrc, const uint8_t *usrc,
                    const uint8_t *vsrc, uint8_t *dst,
@@ -80,6 +86,12 @@ void (*ff_rgb24toyv12)(const uint8_t *src, uint8_t *ydst,
                        int32_t *rgb2yuv);
 void (*planar2x)(const uint8_t *src, uint8_t *dst, int width, int height,
                  int srcStride, int dstStride);
+void (*planar_downscale2x)(const uint8_t *src, uint8_t *dst,
+                           int width, int height,
+                           int srcStride, int dstStride);
+void (*planar_downscale4x)(const uint8_t *src, uint8_t *dst,
+                           int width, int height,
+                           int srcStride, int dstStride);
 void (*interleaveBytes)(const uint8_t *src1, const uint8_t *src2, uint8_t *dst,
                         int width, int height, int src1Stride,
                         int src2Stride, int dstStride);
@@ -133,44 +145,6 @@ av_cold void sws_rgb2rgb_init(void)
         rgb2rgb_init_x86();
 }
 
-void rgb32to24(const uint8_t *src, uint8_t *dst, int src_size)
-{
-    int i, num_pixels = src_size >> 2;
-
-    for (i = 0; i < num_pixels; i++) {
-#if HAVE_BIGENDIAN
-        /* RGB32 (= A,B,G,R) -> BGR24 (= B,G,R) */
-        dst[3 * i + 0] = src[4 * i + 1];
-        dst[3 * i + 1] = src[4 * i + 2];
-        dst[3 * i + 2] = src[4 * i + 3];
-#else
-        dst[3 * i + 0] = src[4 * i + 2];
-        dst[3 * i + 1] = src[4 * i + 1];
-        dst[3 * i + 2] = src[4 * i + 0];
-#endif
-    }
-}
-
-void rgb24to32(const uint8_t *src, uint8_t *dst, int src_size)
-{
-    int i;
-
-    for (i = 0; 3 * i < src_size; i++) {
-#if HAVE_BIGENDIAN
-        /* RGB24 (= R, G, B) -> BGR32 (= A, R, G, B) */
-        dst[4 * i + 0] = 255;
-        dst[4 * i + 1] = src[3 * i + 0];
-        dst[4 * i + 2] = src[3 * i + 1];
-        dst[4 * i + 3] = src[3 * i + 2];
-#else
-        dst[4 * i + 0] = src[3 * i + 2];
-        dst[4 * i + 1] = src[3 * i + 1];
-        dst[4 * i + 2] = src[3 * i + 0];
-        dst[4 * i + 3] = 255;
-#endif
-    }
-}
-
 void rgb16tobgr32(const uint8_t *src, uint8_t *dst, int src_size)
 {
     uint8_t *d          = dst;
@@ -316,25 +290,6 @@ void rgb12tobgr12(const uint8_t *src, uint8_t *dst, int src_size)
 }
 
 
-#define DEFINE_SHUFFLE_BYTES(a, b, c, d)                                \
-void shuffle_bytes_ ## a ## b ## c ## d(const uint8_t *src,             \
-                                        uint8_t *dst, int src_size)     \
-{                                                                       \
-    int i;                                                              \
-                                                                        \
-    for (i = 0; i < src_size; i += 4) {                                 \
-        dst[i + 0] = src[i + a];                                        \
-        dst[i + 1] = src[i + b];                                        \
-        dst[i + 2] = src[i + c];                                        \
-        dst[i + 3] = src[i + d];                                        \
-    }                                                                   \
-}
-
-DEFINE_SHUFFLE_BYTES(0, 3, 2, 1)
-DEFINE_SHUFFLE_BYTES(1, 2, 3, 0)
-DEFINE_SHUFFLE_BYTES(3, 0, 1, 2)
-DEFINE_SHUFFLE_BYTES(3, 2, 1, 0)
-
 #define DEFINE_RGB48TOBGR48(need_bswap, swap)                           \
 void rgb48tobgr48_ ## need_bswap(const uint8_t *src,                    \
                                  uint8_t *dst, int src_size)            \
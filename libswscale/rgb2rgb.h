@@ -33,9 +33,11 @@
 
 /* A full collection of RGB to RGB(BGR) converters */
 extern void (*rgb24tobgr32)(const uint8_t *src, uint8_t *dst, int src_size);
+extern void (*rgb24to32)(const uint8_t *src, uint8_t *dst, int src_size);
 extern void (*rgb24tobgr16)(const uint8_t *src, uint8_t *dst, int src_size);
 extern void (*rgb24tobgr15)(const uint8_t *src, uint8_t *dst, int src_size);
 extern void (*rgb32tobgr24)(const uint8_t *src, uint8_t *dst, int src_size);
+extern void (*rgb32to24)(const uint8_t *src, uint8_t *dst, int src_size);
 extern void    (*rgb32to16)(const uint8_t *src, uint8_t *dst, int src_size);
 extern void    (*rgb32to15)(const uint8_t *src, uint8_t *dst, int src_size);
 extern void    (*rgb15to16)(const uint8_t *src, uint8_t *dst, int src_size);
@@ -50,7 +52,11 @@ extern void    (*rgb24to15)(const uint8_t *src, uint8_t *dst, int src_size);
 extern void (*rgb32tobgr16)(const uint8_t *src, uint8_t *dst, int src_size);
 extern void (*rgb32tobgr15)(const uint8_t *src, uint8_t *dst, int src_size);
 
+extern void (*shuffle_bytes_0321)(const uint8_t *src, uint8_t *dst, int src_size);
+extern void (*shuffle_bytes_1230)(const uint8_t *src, uint8_t *dst, int src_size);
 extern void (*shuffle_bytes_2103)(const uint8_t *src, uint8_t *dst, int src_size);
+extern void (*shuffle_bytes_3012)(const uint8_t *src, uint8_t *dst, int src_size);
+extern void (*shuffle_bytes_3210)(const uint8_t *src, uint8_t *dst, int src_size);
 
 void rgb64tobgr48_nobswap(const uint8_t *src, uint8_t *dst, int src_size);
 void   rgb64tobgr48_bswap(const uint8_t *src, uint8_t *dst, int src_size);
@@ -58,8 +64,6 @@ void rgb48tobgr48_nobswap(const uint8_t *src, uint8_t *dst, int src_size);
 void   rgb48tobgr48_bswap(const uint8_t *src, uint8_t *dst, int src_size);
 void    rgb64to48_nobswap(const uint8_t *src, uint8_t *dst, int src_size);
 void      rgb64to48_bswap(const uint8_t *src, uint8_t *dst, int src_size);
-void    rgb24to32(const uint8_t *src, uint8_t *dst, int src_size);
-void    rgb32to24(const uint8_t *src, uint8_t *dst, int src_size);
 void rgb16tobgr32(const uint8_t *src, uint8_t *dst, int src_size);
 void    rgb16to24(const uint8_t *src, uint8_t *dst, int src_size);
 void rgb16tobgr16(const uint8_t *src, uint8_t *dst, int src_size);
@@ -71,11 +75,6 @@ void rgb15tobgr15(const uint8_t *src, uint8_t *dst, int src_size);
 void rgb12tobgr12(const uint8_t *src, uint8_t *dst, int src_size);
 void    rgb12to15(const uint8_t *src, uint8_t *dst, int src_size);
 
-void shuffle_bytes_0321(const uint8_t *src, uint8_t *dst, int src_size);
-void shuffle_bytes_1230(const uint8_t *src, uint8_t *dst, int src_size);
-void shuffle_bytes_3012(const uint8_t *src, uint8_t *dst, int src_size);
-void shuffle_bytes_3210(const uint8_t *src, uint8_t *dst, int src_size);
-
 void ff_rgb24toyv12_c(const uint8_t *src, uint8_t *ydst, uint8_t *udst,
                       uint8_t *vdst, int width, int height, int lumStride,
                       int chromStride, int srcStride, int32_t *rgb2yuv);
@@ -131,6 +130,18 @@ extern void (*ff_rgb24toyv12)(const uint8_t *src, uint8_t *ydst, uint8_t *udst,
 extern void (*planar2x)(const uint8_t *src, uint8_t *dst, int width, int height,
                         int srcStride, int dstStride);
 
+/**
+ * Downscale a plane by exactly 2 (or 4) in both directions, each output
+ * pixel being the rounded average of the 2x2 (or 4x4) source pixels.
+ * width and height are the destination dimensions.
+ */
+extern void (*planar_downscale2x)(const uint8_t *src, uint8_t *dst,
+                                  int width, int height,
+                                  int srcStride, int dstStride);
+extern void (*planar_downscale4x)(const uint8_t *src, uint8_t *dst,
+                                  int width, int height,
+                                  int srcStride, int dstStride);
+
 extern void (*interleaveBytes)(const uint8_t *src1, const uint8_t *src2, uint8_t *dst,
                                int width, int height, int src1Stride,
                                int src2Stride, int dstStride);
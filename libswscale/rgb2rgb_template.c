@@ -76,6 +76,46 @@ static inline void rgb32tobgr24_c(const uint8_t *src, uint8_t *dst,
     }
 }
 
+static inline void rgb32to24_c(const uint8_t *src, uint8_t *dst,
+                               int src_size)
+{
+    int i, num_pixels = src_size >> 2;
+
+    for (i = 0; i < num_pixels; i++) {
+#if HAVE_BIGENDIAN
+        /* RGB32 (= A,B,G,R) -> BGR24 (= B,G,R) */
+        dst[3 * i + 0] = src[4 * i + 1];
+        dst[3 * i + 1] = src[4 * i + 2];
+        dst[3 * i + 2] = src[4 * i + 3];
+#else
+        dst[3 * i + 0] = src[4 * i + 2];
+        dst[3 * i + 1] = src[4 * i + 1];
+        dst[3 * i + 2] = src[4 * i + 0];
+#endif
+    }
+}
+
+static inline void rgb24to32_c(const uint8_t *src, uint8_t *dst,
+                               int src_size)
+{
+    int i;
+
+    for (i = 0; 3 * i < src_size; i++) {
+#if HAVE_BIGENDIAN
+        /* RGB24 (= R, G, B) -> BGR32 (= A, R, G, B) */
+        dst[4 * i + 0] = 255;
+        dst[4 * i + 1] = src[3 * i + 0];
+        dst[4 * i + 2] = src[3 * i + 1];
+        dst[4 * i + 3] = src[3 * i + 2];
+#else
+        dst[4 * i + 0] = src[3 * i + 2];
+        dst[4 * i + 1] = src[3 * i + 1];
+        dst[4 * i + 2] = src[3 * i + 0];
+        dst[4 * i + 3] = 255;
+#endif
+    }
+}
+
 /*
  * original by Strepto/Astral
  * ported to gcc & bugfixed: A'rpi
@@ -328,6 +368,24 @@ static inline void shuffle_bytes_2103_c(const uint8_t *src, uint8_t *dst,
     }
 }
 
+#define DEFINE_SHUFFLE_BYTES(name, a, b, c, d)                          \
+static inline void name(const uint8_t *src, uint8_t *dst, int src_size) \
+{                                                                       \
+    int i;                                                              \
+                                                                        \
+    for (i = 0; i < src_size; i += 4) {                                 \
+        dst[i + 0] = src[i + a];                                        \
+        dst[i + 1] = src[i + b];                                        \
+        dst[i + 2] = src[i + c];                                        \
+        dst[i + 3] = src[i + d];                                        \
+    }                                                                   \
+}
+
+DEFINE_SHUFFLE_BYTES(shuffle_bytes_0321_c, 0, 3, 2, 1)
+DEFINE_SHUFFLE_BYTES(shuffle_bytes_1230_c, 1, 2, 3, 0)
+DEFINE_SHUFFLE_BYTES(shuffle_bytes_3012_c, 3, 0, 1, 2)
+DEFINE_SHUFFLE_BYTES(shuffle_bytes_3210_c, 3, 2, 1, 0)
+
 static inline void rgb24tobgr24_c(const uint8_t *src, uint8_t *dst, int src_size)
 {
     unsigned i;
@@ -526,6 +584,44 @@ static inline void yuy2toyv12_c(const uint8_t *src, uint8_t *ydst,
     }
 }
 
+static void planar_downscale2x_c(const uint8_t *src, uint8_t *dst,
+                                 int width, int height,
+                                 int srcStride, int dstStride)
+{
+    int x, y;
+
+    for (y = 0; y < height; y++) {
+        const uint8_t *s0 = src;
+        const uint8_t *s1 = src + srcStride;
+
+        for (x = 0; x < width; x++)
+            dst[x] = (s0[2 * x] + s0[2 * x + 1] +
+                      s1[2 * x] + s1[2 * x + 1] + 2) >> 2;
+        src += 2 * srcStride;
+        dst += dstStride;
+    }
+}
+
+static void planar_downscale4x_c(const uint8_t *src, uint8_t *dst,
+                                 int width, int height,
+                                 int srcStride, int dstStride)
+{
+    int x, y, i;
+
+    for (y = 0; y < height; y++) {
+        for (x = 0; x < width; x++) {
+            const uint8_t *s = src + 4 * x;
+            int sum = 8;
+
+            for (i = 0; i < 4; i++, s += srcStride)
+                sum += s[0] + s[1] + s[2] + s[3];
+            dst[x] = sum >> 4;
+        }
+        src += 4 * srcStride;
+        dst += dstStride;
+    }
+}
+
 static inline void planar2x_c(const uint8_t *src, uint8_t *dst, int srcWidth,
                               int srcHeight, int srcStride, int dstStride)
 {
@@ -905,13 +1001,19 @@ static av_cold void rgb2rgb_init_c(void)
     rgb24tobgr16       = rgb24tobgr16_c;
     rgb24tobgr15       = rgb24tobgr15_c;
     rgb24tobgr32       = rgb24tobgr32_c;
+    rgb24to32          = rgb24to32_c;
     rgb32to16          = rgb32to16_c;
     rgb32to15          = rgb32to15_c;
     rgb32tobgr24       = rgb32tobgr24_c;
+    rgb32to24          = rgb32to24_c;
     rgb24to15          = rgb24to15_c;
     rgb24to16          = rgb24to16_c;
     rgb24tobgr24       = rgb24tobgr24_c;
+    shuffle_bytes_0321 = shuffle_bytes_0321_c;
+    shuffle_bytes_1230 = shuffle_bytes_1230_c;
     shuffle_bytes_2103 = shuffle_bytes_2103_c;
+    shuffle_bytes_3012 = shuffle_bytes_3012_c;
+    shuffle_bytes_3210 = shuffle_bytes_3210_c;
     rgb32tobgr16       = rgb32tobgr16_c;
     rgb32tobgr15       = rgb32tobgr15_c;
     yv12toyuy2         = yv12toyuy2_c;
@@ -920,6 +1022,8 @@ static av_cold void rgb2rgb_init_c(void)
     yuv422ptouyvy      = yuv422ptouyvy_c;
     yuy2toyv12         = yuy2toyv12_c;
     planar2x           = planar2x_c;
+    planar_downscale2x = planar_downscale2x_c;
+    planar_downscale4x = planar_downscale4x_c;
     ff_rgb24toyv12     = ff_rgb24toyv12_c;
     interleaveBytes    = interleaveBytes_c;
     vu9_to_vu12        = vu9_to_vu12_c;
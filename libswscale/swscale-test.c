@@ -27,10 +27,13 @@
 #undef HAVE_AV_CONFIG_H
 #include "libavutil/imgutils.h"
 #include "libavutil/mem.h"
+#include "libavutil/avstring.h"
 #include "libavutil/avutil.h"
+#include "libavutil/cpu.h"
 #include "libavutil/crc.h"
 #include "libavutil/pixdesc.h"
 #include "libavutil/lfg.h"
+#include "libavutil/time.h"
 #include "swscale.h"
 
 /* HACK Duplicated from swscale_internal.h.
@@ -338,6 +341,164 @@ static int fileTest(uint8_t *ref[4], int refStride[4], int w, int h, FILE *fp,
     return 0;
 }
 
+// measure init time and throughput of src -> dst with the current cpu flags
+static int benchOne(enum AVPixelFormat srcFormat, enum AVPixelFormat dstFormat,
+                    int srcW, int srcH, int dstW, int dstH, int flags,
+                    const char *cpuflags, int json, int *nb_results)
+{
+    uint8_t *ref[4] = { NULL }, *src[4] = { NULL }, *dst[4] = { NULL };
+    int refStride[4], srcStride[4], dstStride[4];
+    struct SwsContext *srcContext = NULL, *dstContext = NULL;
+    int64_t start, init_time, elapsed;
+    int i, size, frames = 0, res = -1;
+    AVLFG rand;
+
+    if (av_image_alloc(ref, refStride, srcW, srcH, AV_PIX_FMT_YUVA420P, 16) < 0 ||
+        av_image_alloc(src, srcStride, srcW, srcH, srcFormat, 16) < 0 ||
+        av_image_alloc(dst, dstStride, dstW, dstH, dstFormat, 16) < 0) {
+        perror("Malloc");
+        goto end;
+    }
+
+    /* scale something looking like real content rather than a flat image */
+    av_lfg_init(&rand, 1);
+    size = av_image_get_buffer_size(AV_PIX_FMT_YUVA420P, srcW, srcH, 16);
+    for (i = 0; i < size; i++)
+        ref[0][i] = av_lfg_get(&rand);
+    srcContext = sws_getContext(srcW, srcH, AV_PIX_FMT_YUVA420P, srcW, srcH,
+                                srcFormat, SWS_POINT, NULL, NULL, NULL);
+    if (!srcContext)
+        goto end;
+    sws_scale(srcContext, (const uint8_t * const*)ref, refStride, 0, srcH,
+              src, srcStride);
+
+    start      = av_gettime();
+    dstContext = sws_getContext(srcW, srcH, srcFormat, dstW, dstH, dstFormat,
+                                flags, NULL, NULL, NULL);
+    init_time  = av_gettime() - start;
+    if (!dstContext) {
+        fprintf(stderr, "Failed to get %s ---> %s\n",
+                av_get_pix_fmt_name(srcFormat), av_get_pix_fmt_name(dstFormat));
+        goto end;
+    }
+
+    /* warm up the caches, then run for at least a quarter of a second */
+    sws_scale(dstContext, (const uint8_t * const*)src, srcStride, 0, srcH,
+              dst, dstStride);
+    start = av_gettime();
+    do {
+        sws_scale(dstContext, (const uint8_t * const*)src, srcStride, 0, srcH,
+                  dst, dstStride);
+        frames++;
+        elapsed = av_gettime() - start;
+    } while (elapsed < 250000 || frames < 3);
+
+    if (json)
+        printf("%s  { \"cpuflags\": \"%s\", \"src\": \"%s\", \"dst\": \"%s\", "
+               "\"srcw\": %d, \"srch\": %d, \"dstw\": %d, \"dsth\": %d, "
+               "\"flags\": %d, \"init_us\": %"PRId64", \"mpixels_per_s\": %.2f }",
+               *nb_results ? ",\n" : "", cpuflags,
+               av_get_pix_fmt_name(srcFormat), av_get_pix_fmt_name(dstFormat),
+               srcW, srcH, dstW, dstH, flags, init_time,
+               (double)dstW * dstH * frames / elapsed);
+    else
+        printf("%s,%s,%s,%d,%d,%d,%d,%d,%"PRId64",%.2f\n", cpuflags,
+               av_get_pix_fmt_name(srcFormat), av_get_pix_fmt_name(dstFormat),
+               srcW, srcH, dstW, dstH, flags, init_time,
+               (double)dstW * dstH * frames / elapsed);
+    fflush(stdout);
+    (*nb_results)++;
+    res = 0;
+
+end:
+    sws_freeContext(srcContext);
+    sws_freeContext(dstContext);
+    av_freep(&ref[0]);
+    av_freep(&src[0]);
+    av_freep(&dst[0]);
+
+    return res;
+}
+
+/**
+ * Benchmark a matrix of conversions for each of the comma separated cpu
+ * flag sets in cpuflags_list, or with the detected cpu flags if NULL.
+ */
+static int benchTest(enum AVPixelFormat srcFormat_in,
+                     enum AVPixelFormat dstFormat_in,
+                     const char *cpuflags_list, int json)
+{
+    static const enum AVPixelFormat formats[] = {
+        AV_PIX_FMT_YUV420P, AV_PIX_FMT_NV12, AV_PIX_FMT_YUYV422,
+        AV_PIX_FMT_YUV420P10LE, AV_PIX_FMT_RGB24, AV_PIX_FMT_BGRA,
+        AV_PIX_FMT_NONE
+    };
+    static const struct {
+        int srcW, srcH, dstW, dstH;
+    } sizes[] = {
+        { 1920, 1080, 1280,  720 },
+        { 1280,  720, 1920, 1080 },
+        { 1920, 1080,  320,  180 },
+    };
+    const int flags[] = { SWS_FAST_BILINEAR, SWS_BILINEAR, SWS_BICUBIC,
+                          SWS_LANCZOS, 0 };
+    char *list = av_strdup(cpuflags_list ? cpuflags_list : "auto");
+    char *cpuflags, *saveptr = NULL;
+    int i, j, k, l, nb_results = 0, res = 0;
+
+    if (!list)
+        return -1;
+
+    if (json)
+        printf("[\n");
+    else
+        printf("cpuflags,src,dst,srcw,srch,dstw,dsth,flags,init_us,mpixels_per_s\n");
+
+    for (cpuflags = av_strtok(list, ",", &saveptr); cpuflags && !res;
+         cpuflags = av_strtok(NULL, ",", &saveptr)) {
+        unsigned cpu_flags = 0;
+
+        av_force_cpu_flags(-1);
+        if (cpuflags_list) {
+            if (av_parse_cpu_caps(&cpu_flags, cpuflags) < 0) {
+                fprintf(stderr, "invalid cpu flags %s\n", cpuflags);
+                res = -1;
+                break;
+            }
+            /* never enable more than what the cpu has */
+            av_force_cpu_flags(cpu_flags & av_get_cpu_flags());
+        }
+
+        for (i = 0; formats[i] != AV_PIX_FMT_NONE && !res; i++) {
+            enum AVPixelFormat srcFormat = formats[i];
+            if (srcFormat_in != AV_PIX_FMT_NONE)
+                srcFormat = srcFormat_in;
+            for (j = 0; formats[j] != AV_PIX_FMT_NONE && !res; j++) {
+                enum AVPixelFormat dstFormat = formats[j];
+                if (dstFormat_in != AV_PIX_FMT_NONE)
+                    dstFormat = dstFormat_in;
+                for (k = 0; k < FF_ARRAY_ELEMS(sizes) && !res; k++)
+                    for (l = 0; flags[l] && !res; l++)
+                        res = benchOne(srcFormat, dstFormat,
+                                       sizes[k].srcW, sizes[k].srcH,
+                                       sizes[k].dstW, sizes[k].dstH,
+                                       flags[l], cpuflags, json, &nb_results);
+                if (dstFormat_in != AV_PIX_FMT_NONE)
+                    break;
+            }
+            if (srcFormat_in != AV_PIX_FMT_NONE)
+                break;
+        }
+    }
+
+    if (json)
+        printf("\n]\n");
+
+    av_force_cpu_flags(-1);
+    av_free(list);
+    return res;
+}
+
 #define W 96
 #define H 96
 
@@ -357,6 +518,8 @@ int main(int argc, char **argv)
     int res = -1;
     int i;
     FILE *fp = NULL;
+    const char *bench    = NULL;
+    const char *cpuflags = NULL;
 
     if (!rgb_data || !data)
         return -1;
@@ -382,6 +545,14 @@ int main(int argc, char **argv)
                 fprintf(stderr, "invalid pixel format %s\n", argv[i + 1]);
                 return -1;
             }
+        } else if (!strcmp(argv[i], "-bench")) {
+            bench = argv[i + 1];
+            if (strcmp(bench, "csv") && strcmp(bench, "json")) {
+                fprintf(stderr, "invalid benchmark output format %s\n", bench);
+                goto error;
+            }
+        } else if (!strcmp(argv[i], "-cpuflags")) {
+            cpuflags = argv[i + 1];
         } else {
 bad_option:
             fprintf(stderr, "bad option or argument missing (%s)\n", argv[i]);
@@ -401,7 +572,11 @@ bad_option:
     sws_freeContext(sws);
     av_free(rgb_data);
 
-    if(fp) {
+    if (bench) {
+        res = benchTest(srcFormat, dstFormat, cpuflags, !strcmp(bench, "json"));
+        if (fp)
+            fclose(fp);
+    } else if(fp) {
         res = fileTest(src, stride, W, H, fp, srcFormat, dstFormat);
         fclose(fp);
     } else {
@@ -28,6 +28,7 @@
 #include "libavutil/avutil.h"
 #include "libavutil/bswap.h"
 #include "libavutil/cpu.h"
+#include "libavutil/imgutils.h"
 #include "libavutil/intreadwrite.h"
 #include "libavutil/mathematics.h"
 #include "libavutil/pixdesc.h"
@@ -62,9 +63,9 @@ static av_always_inline void fillPlane(uint8_t *plane, int stride, int width,
     }
 }
 
-static void hScale16To19_c(SwsContext *c, int16_t *_dst, int dstW,
-                           const uint8_t *_src, const int16_t *filter,
-                           const int32_t *filterPos, int filterSize)
+static av_always_inline void hscale16to19(SwsContext *c, int16_t *_dst, int dstW,
+                                          const uint8_t *_src, const int16_t *filter,
+                                          const int32_t *filterPos, int filterSize)
 {
     const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(c->srcFormat);
     int i;
@@ -89,9 +90,9 @@ static void hScale16To19_c(SwsContext *c, int16_t *_dst, int dstW,
     }
 }
 
-static void hScale16To15_c(SwsContext *c, int16_t *dst, int dstW,
-                           const uint8_t *_src, const int16_t *filter,
-                           const int32_t *filterPos, int filterSize)
+static av_always_inline void hscale16to15(SwsContext *c, int16_t *dst, int dstW,
+                                          const uint8_t *_src, const int16_t *filter,
+                                          const int32_t *filterPos, int filterSize)
 {
     const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(c->srcFormat);
     int i;
@@ -115,9 +116,9 @@ static void hScale16To15_c(SwsContext *c, int16_t *dst, int dstW,
 }
 
 // bilinear / bicubic scaling
-static void hScale8To15_c(SwsContext *c, int16_t *dst, int dstW,
-                          const uint8_t *src, const int16_t *filter,
-                          const int32_t *filterPos, int filterSize)
+static av_always_inline void hscale8to15(SwsContext *c, int16_t *dst, int dstW,
+                                         const uint8_t *src, const int16_t *filter,
+                                         const int32_t *filterPos, int filterSize)
 {
     int i;
     for (i = 0; i < dstW; i++) {
@@ -131,9 +132,9 @@ static void hScale8To15_c(SwsContext *c, int16_t *dst, int dstW,
     }
 }
 
-static void hScale8To19_c(SwsContext *c, int16_t *_dst, int dstW,
-                          const uint8_t *src, const int16_t *filter,
-                          const int32_t *filterPos, int filterSize)
+static av_always_inline void hscale8to19(SwsContext *c, int16_t *_dst, int dstW,
+                                         const uint8_t *src, const int16_t *filter,
+                                         const int32_t *filterPos, int filterSize)
 {
     int i;
     int32_t *dst = (int32_t *) _dst;
@@ -148,6 +149,92 @@ static void hScale8To19_c(SwsContext *c, int16_t *_dst, int dstW,
     }
 }
 
+/* The filter sizes are padded to a multiple of 4 on x86, so 4 and 8 are
+ * the most common ones; with a constant size the compiler fully unrolls
+ * and vectorizes the inner loop. */
+#define HSCALE_FUNC(name, size, filtersize)                                  \
+static void name ## _ ## size ## _c(SwsContext *c, int16_t *dst, int dstW,   \
+                                    const uint8_t *src, const int16_t *filter, \
+                                    const int32_t *filterPos, int filterSize)  \
+{                                                                            \
+    name(c, dst, dstW, src, filter, filterPos, filtersize);                  \
+}
+
+#define HSCALE_FUNCS(name)          \
+    HSCALE_FUNC(name, 4, 4)         \
+    HSCALE_FUNC(name, 8, 8)         \
+    HSCALE_FUNC(name, X, filterSize)
+
+HSCALE_FUNCS(hscale8to15)
+HSCALE_FUNCS(hscale8to19)
+HSCALE_FUNCS(hscale16to15)
+HSCALE_FUNCS(hscale16to19)
+
+/* NV12/NV21 chroma, read without deinterleaving it first */
+static av_always_inline void hscale8to15nv(SwsContext *c, int16_t *dstU,
+                                           int16_t *dstV, int dstW,
+                                           const uint8_t *src, const int16_t *filter,
+                                           const int32_t *filterPos, int filterSize)
+{
+    int i;
+    for (i = 0; i < dstW; i++) {
+        int j;
+        const uint8_t *s = src + 2 * filterPos[i];
+        int valU = 0, valV = 0;
+        for (j = 0; j < filterSize; j++) {
+            valU += s[2 * j    ] * filter[filterSize * i + j];
+            valV += s[2 * j + 1] * filter[filterSize * i + j];
+        }
+        dstU[i] = FFMIN(valU >> 7, (1 << 15) - 1);
+        dstV[i] = FFMIN(valV >> 7, (1 << 15) - 1);
+    }
+}
+
+static av_always_inline void hscale8to19nv(SwsContext *c, int16_t *_dstU,
+                                           int16_t *_dstV, int dstW,
+                                           const uint8_t *src, const int16_t *filter,
+                                           const int32_t *filterPos, int filterSize)
+{
+    int i;
+    int32_t *dstU = (int32_t *) _dstU;
+    int32_t *dstV = (int32_t *) _dstV;
+    for (i = 0; i < dstW; i++) {
+        int j;
+        const uint8_t *s = src + 2 * filterPos[i];
+        int valU = 0, valV = 0;
+        for (j = 0; j < filterSize; j++) {
+            valU += s[2 * j    ] * filter[filterSize * i + j];
+            valV += s[2 * j + 1] * filter[filterSize * i + j];
+        }
+        dstU[i] = FFMIN(valU >> 3, (1 << 19) - 1);
+        dstV[i] = FFMIN(valV >> 3, (1 << 19) - 1);
+    }
+}
+
+#define HSCALE_NV_FUNC(name, size, filtersize)                               \
+static void name ## _ ## size ## _c(SwsContext *c, int16_t *dstU,            \
+                                    int16_t *dstV, int dstW,                 \
+                                    const uint8_t *src, const int16_t *filter, \
+                                    const int32_t *filterPos, int filterSize)  \
+{                                                                            \
+    name(c, dstU, dstV, dstW, src, filter, filterPos, filtersize);           \
+}
+
+#define HSCALE_NV_FUNCS(name)          \
+    HSCALE_NV_FUNC(name, 4, 4)         \
+    HSCALE_NV_FUNC(name, 8, 8)         \
+    HSCALE_NV_FUNC(name, X, filterSize)
+
+HSCALE_NV_FUNCS(hscale8to15nv)
+HSCALE_NV_FUNCS(hscale8to19nv)
+
+#define ASSIGN_HSCALE_FUNC(hscalefn, filtersize, name) \
+    switch (filtersize) {                              \
+    case 4:  hscalefn = name ## _4_c; break;           \
+    case 8:  hscalefn = name ## _8_c; break;           \
+    default: hscalefn = name ## _X_c; break;           \
+    }
+
 // FIXME all pal and rgb srcFormats could do this conversion as well
 // FIXME all scalers more complex than bilinear could do half of this transform
 static void chrRangeToJpeg_c(int16_t *dstU, int16_t *dstV, int width)
@@ -301,6 +388,15 @@ static av_always_inline void hcscale(SwsContext *c, int16_t *dst1,
                                      uint8_t *formatConvBuffer, uint32_t *pal)
 {
     const uint8_t *src1 = src_in[1], *src2 = src_in[2];
+    if (c->hcScaleNV && !c->hcscale_fast) {
+        if (c->srcFormat == AV_PIX_FMT_NV21)
+            FFSWAP(int16_t *, dst1, dst2);
+        c->hcScaleNV(c, dst1, dst2, dstWidth, src1, hChrFilter, hChrFilterPos,
+                     hChrFilterSize);
+        if (c->chrConvertRange)
+            c->chrConvertRange(dst1, dst2, dstWidth);
+        return;
+    }
     if (c->chrToYV12) {
         uint8_t *buf2 = formatConvBuffer +
                         FFALIGN(srcW*2+78, 16);
@@ -377,7 +473,7 @@ static int swScale(SwsContext *c, const uint8_t *src[],
     const int chrSrcSliceH           = FF_CEIL_RSHIFT(srcSliceH,   c->chrSrcVSubSample);
     int should_dither                = is9_OR_10BPS(c->srcFormat) ||
                                        is16BPS(c->srcFormat);
-    int lastDstY;
+    int lastDstY, dstEnd = dstH;
 
     /* vars which will change and which we need to store back in the context */
     int dstY         = c->dstY;
@@ -448,12 +544,18 @@ static int swScale(SwsContext *c, const uint8_t *src[],
         lastInChrBuf = -1;
     }
 
+    /* the lines above dstSliceY are skipped like holes */
+    if (c->dstSliceH) {
+        dstY   = c->dstSliceY;
+        dstEnd = c->dstSliceY + c->dstSliceH;
+    }
+
     if (!should_dither) {
         c->chrDither8 = c->lumDither8 = ff_sws_pb_64;
     }
     lastDstY = dstY;
 
-    for (; dstY < dstH; dstY++) {
+    for (; dstY < dstEnd; dstY++) {
         const int chrDstY = dstY >> c->chrDstVSubSample;
         uint8_t *dest[4]  = {
             dst[0] + dstStride[0] * dstY,
@@ -717,17 +819,29 @@ static av_cold void sws_init_swScale_c(SwsContext *c)
 
     if (c->srcBpc == 8) {
         if (c->dstBpc <= 14) {
-            c->hyScale = c->hcScale = hScale8To15_c;
+            ASSIGN_HSCALE_FUNC(c->hyScale, c->hLumFilterSize, hscale8to15);
+            ASSIGN_HSCALE_FUNC(c->hcScale, c->hChrFilterSize, hscale8to15);
             if (c->flags & SWS_FAST_BILINEAR) {
                 c->hyscale_fast = hyscale_fast_c;
                 c->hcscale_fast = hcscale_fast_c;
             }
         } else {
-            c->hyScale = c->hcScale = hScale8To19_c;
+            ASSIGN_HSCALE_FUNC(c->hyScale, c->hLumFilterSize, hscale8to19);
+            ASSIGN_HSCALE_FUNC(c->hcScale, c->hChrFilterSize, hscale8to19);
         }
+        if (srcFormat == AV_PIX_FMT_NV12 || srcFormat == AV_PIX_FMT_NV21) {
+            if (c->dstBpc <= 14) {
+                ASSIGN_HSCALE_FUNC(c->hcScaleNV, c->hChrFilterSize, hscale8to15nv);
+            } else {
+                ASSIGN_HSCALE_FUNC(c->hcScaleNV, c->hChrFilterSize, hscale8to19nv);
+            }
+        }
+    } else if (c->dstBpc > 14) {
+        ASSIGN_HSCALE_FUNC(c->hyScale, c->hLumFilterSize, hscale16to19);
+        ASSIGN_HSCALE_FUNC(c->hcScale, c->hChrFilterSize, hscale16to19);
     } else {
-        c->hyScale = c->hcScale = c->dstBpc > 14 ? hScale16To19_c
-                                                 : hScale16To15_c;
+        ASSIGN_HSCALE_FUNC(c->hyScale, c->hLumFilterSize, hscale16to15);
+        ASSIGN_HSCALE_FUNC(c->hcScale, c->hChrFilterSize, hscale16to15);
     }
 
     if (c->srcRange != c->dstRange && !isAnyRGB(c->dstFormat)) {
@@ -757,13 +871,22 @@ static av_cold void sws_init_swScale_c(SwsContext *c)
 
 SwsFunc ff_getSwsFunc(SwsContext *c)
 {
+    void (*hcScale_c)(SwsContext *c, int16_t *dst, int dstW,
+                      const uint8_t *src, const int16_t *filter,
+                      const int32_t *filterPos, int filterSize);
+
     sws_init_swScale_c(c);
+    hcScale_c = c->hcScale;
 
     if (HAVE_MMX)
         ff_sws_init_swScale_mmx(c);
     if (HAVE_ALTIVEC)
         ff_sws_init_swScale_altivec(c);
 
+    /* SIMD deinterleaving and scaling beats the fused C semi-planar reader */
+    if (c->hcScale != hcScale_c)
+        c->hcScaleNV = NULL;
+
     return swScale;
 }
 
@@ -850,6 +973,40 @@ static void xyz12Torgb48(struct SwsContext *c, uint16_t *dst,
     }
 }
 
+typedef struct SliceThreadData {
+    const uint8_t *const *src;
+    const int *srcStride;
+    uint8_t *const *dst;
+    const int *dstStride;
+} SliceThreadData;
+
+static int scale_slice(SwsContext *c, void *arg, int jobnr, int nb_jobs)
+{
+    const SliceThreadData *td = arg;
+    SwsContext *s = jobnr ? c->slice_ctx[jobnr - 1] : c;
+    int start = FFMIN(FFALIGN(c->dstH *  jobnr      / nb_jobs, c->slice_align), c->dstH);
+    int end   = FFMIN(FFALIGN(c->dstH * (jobnr + 1) / nb_jobs, c->slice_align), c->dstH);
+
+    if (start >= end)
+        return 0;
+    return sws_scale_dst_slice(s, td->src, td->srcStride, td->dst, td->dstStride,
+                               start, end - start);
+}
+
+static int scale_threaded(SwsContext *c, const uint8_t *const src[],
+                          const int srcStride[], uint8_t *const dst[],
+                          const int dstStride[])
+{
+    SliceThreadData td = { src, srcStride, dst, dstStride };
+    int i, nb_jobs = c->nb_slice_ctx + 1;
+
+    ff_sws_thread_execute(c, scale_slice, &td, c->slice_ret, nb_jobs);
+    for (i = 0; i < nb_jobs; i++)
+        if (c->slice_ret[i] < 0)
+            return c->slice_ret[i];
+    return c->dstH;
+}
+
 /**
  * swscale wrapper, so we don't need to export the SwsContext.
  * Assumes planar YUV to be in YUV order instead of YVU.
@@ -885,6 +1042,12 @@ int attribute_align_arg sws_scale(struct SwsContext *c,
         return 0;
     }
 
+    /* whole images are split between the slice threads, the slice contexts
+     * and sws_scale_dst_slice() calls on this one take the usual path */
+    if (HAVE_THREADS && c->nb_slice_ctx && !c->dstSliceH && c->sliceDir == 0 &&
+        srcSliceY == 0 && srcSliceH == c->srcH)
+        return scale_threaded(c, srcSlice, srcStride, dst, dstStride);
+
     if (c->sliceDir == 0 && srcSliceY != 0 && srcSliceY + srcSliceH != c->srcH) {
         av_log(c, AV_LOG_ERROR, "Slices start in the middle!\n");
         return 0;
@@ -1050,3 +1213,136 @@ int attribute_align_arg sws_scale(struct SwsContext *c,
     return ret;
 }
 
+int attribute_align_arg sws_scale_dst_slice(struct SwsContext *c,
+                                            const uint8_t *const src[],
+                                            const int srcStride[],
+                                            uint8_t *const dst[],
+                                            const int dstStride[],
+                                            int dstSliceY, int dstSliceH)
+{
+    int i, ret;
+
+    if (dstSliceY < 0 || dstSliceH <= 0 || dstSliceY + dstSliceH > c->dstH ||
+        (c->flags & SWS_ERROR_DIFFUSION))
+        return AVERROR(EINVAL);
+
+    if (c->swScale != swScale) {
+        /* unscaled conversions output the lines of the same source slice,
+         * scaled down by 1 << downscale_shift for planarDownscaleWrapper() */
+        const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(c->srcFormat);
+        const uint8_t *src2[4];
+        int srcSliceY = dstSliceY << c->downscale_shift;
+        int srcSliceH = dstSliceH << c->downscale_shift;
+
+        for (i = 0; i < 4; i++) {
+            int vsub = i == 1 || i == 2 ? desc->log2_chroma_h : 0;
+            src2[i] = src[i];
+            if (src[i] && !(i == 1 && usePal(c->srcFormat)))
+                src2[i] += (srcSliceY >> vsub) * srcStride[i];
+        }
+        c->sliceDir = 1;
+        ret = sws_scale(c, src2, srcStride, srcSliceY, srcSliceH, dst, dstStride);
+        c->sliceDir = 0;
+        return ret;
+    }
+
+    c->sliceDir  = 0;
+    c->dstSliceY = dstSliceY;
+    c->dstSliceH = dstSliceH;
+    ret = sws_scale(c, src, srcStride, 0, c->srcH, dst, dstStride);
+    c->dstSliceH = 0;
+    return ret;
+}
+
+/* same layout as av_frame_get_buffer() */
+static int get_frame_buffer(SwsContext *c, AVFrame *frame)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(c->dstFormat);
+    int i, ret;
+
+    if (!c->frame_pool[0]) {
+        ret = av_image_fill_linesizes(c->frame_linesize, c->dstFormat, c->dstW);
+        if (ret < 0)
+            return ret;
+
+        for (i = 0; i < 4 && c->frame_linesize[i]; i++) {
+            int h = FFALIGN(c->dstH, 32);
+            if (i == 1 || i == 2)
+                h = FF_CEIL_RSHIFT(h, desc->log2_chroma_h);
+
+            c->frame_linesize[i] = FFALIGN(c->frame_linesize[i], 32);
+            c->frame_pool[i] = av_buffer_pool_init(c->frame_linesize[i] * h + 16,
+                                                   NULL);
+            if (!c->frame_pool[i])
+                goto fail;
+        }
+
+        if (desc->flags & AV_PIX_FMT_FLAG_PAL ||
+            desc->flags & AV_PIX_FMT_FLAG_PSEUDOPAL) {
+            av_buffer_pool_uninit(&c->frame_pool[1]);
+            c->frame_pool[1] = av_buffer_pool_init(1024, NULL);
+            if (!c->frame_pool[1])
+                goto fail;
+        }
+    }
+
+    for (i = 0; i < 4 && c->frame_pool[i]; i++) {
+        frame->buf[i] = av_buffer_pool_get(c->frame_pool[i]);
+        if (!frame->buf[i]) {
+            av_frame_unref(frame);
+            return AVERROR(ENOMEM);
+        }
+        frame->data[i]     = frame->buf[i]->data;
+        frame->linesize[i] = c->frame_linesize[i];
+    }
+    frame->extended_data = frame->data;
+    frame->width         = c->dstW;
+    frame->height        = c->dstH;
+    frame->format        = c->dstFormat;
+
+    return 0;
+fail:
+    for (i = 0; i < 4; i++)
+        av_buffer_pool_uninit(&c->frame_pool[i]);
+    return AVERROR(ENOMEM);
+}
+
+int sws_scale_frame(struct SwsContext *c, AVFrame *dst, const AVFrame *src)
+{
+    int ret, allocated = 0;
+
+    if (src->width != c->srcW || src->height != c->srcH ||
+        src->format != c->srcFormat) {
+        av_log(c, AV_LOG_ERROR, "The source frame does not match the context\n");
+        return AVERROR(EINVAL);
+    }
+
+    if (!dst->buf[0] && !dst->data[0]) {
+        if (c->is_copy && src->buf[0])
+            return av_frame_ref(dst, (AVFrame *)src);
+
+        if ((ret = get_frame_buffer(c, dst)) < 0)
+            return ret;
+        allocated = 1;
+    } else if (dst->width != c->dstW || dst->height != c->dstH ||
+               dst->format != c->dstFormat) {
+        av_log(c, AV_LOG_ERROR, "The destination frame does not match the context\n");
+        return AVERROR(EINVAL);
+    }
+
+    if ((ret = av_frame_copy_props(dst, src)) < 0)
+        goto fail;
+
+    ret = sws_scale(c, (const uint8_t * const *)src->data, src->linesize,
+                    0, src->height, dst->data, dst->linesize);
+    if (ret != c->dstH) {
+        ret = ret < 0 ? ret : AVERROR(EINVAL);
+        goto fail;
+    }
+
+    return 0;
+fail:
+    if (allocated)
+        av_frame_unref(dst);
+    return ret;
+}
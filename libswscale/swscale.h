@@ -35,6 +35,7 @@
 #include <stdint.h>
 
 #include "libavutil/avutil.h"
+#include "libavutil/frame.h"
 #include "libavutil/log.h"
 #include "libavutil/pixfmt.h"
 #include "version.h"
@@ -227,6 +228,54 @@ int sws_scale(struct SwsContext *c, const uint8_t *const srcSlice[],
               const int srcStride[], int srcSliceY, int srcSliceH,
               uint8_t *const dst[], const int dstStride[]);
 
+/**
+ * Scale the whole image in src, but only compute and write the rows
+ * dstSliceY to dstSliceY + dstSliceH - 1 of the image in dst.
+ *
+ * The result is the same as with sws_scale() on the whole image, so
+ * the destination can be split between contexts created with the same
+ * parameters, which may run concurrently.
+ *
+ * @param c         the scaling context previously created with
+ *                  sws_getContext()
+ * @param src       the array containing the pointers to the planes of
+ *                  the source image
+ * @param srcStride the array containing the strides for each plane of
+ *                  the source image
+ * @param dst       the array containing the pointers to the planes of
+ *                  the destination image
+ * @param dstStride the array containing the strides for each plane of
+ *                  the destination image
+ * @param dstSliceY the first row to output, it must be a multiple of the
+ *                  vertical chroma subsampling of the source and
+ *                  destination formats
+ * @param dstSliceH the number of rows to output
+ * @return          the height of the output slice, AVERROR(EINVAL) if the
+ *                  slice is invalid or SWS_ERROR_DIFFUSION was set
+ */
+int sws_scale_dst_slice(struct SwsContext *c, const uint8_t *const src[],
+                        const int srcStride[], uint8_t *const dst[],
+                        const int dstStride[], int dstSliceY, int dstSliceH);
+
+/**
+ * Scale the whole image in src and store the result in dst.
+ *
+ * If dst has no buffers, they are taken from buffer pools owned by c and
+ * the width, height and format of dst are set. When the conversion is a
+ * plain copy (same size and format) and src is reference counted, dst
+ * becomes a new reference to src instead and no data is copied.
+ * Otherwise dst must already have the destination size and format of c.
+ *
+ * The properties of src are copied to dst with av_frame_copy_props().
+ *
+ * @param c   the scaling context previously created with sws_getContext()
+ * @param dst the destination frame
+ * @param src the source frame, its size and format must be the source
+ *            size and format of c
+ * @return    0 on success, a negative AVERROR code on failure
+ */
+int sws_scale_frame(struct SwsContext *c, AVFrame *dst, const AVFrame *src);
+
 /**
  * @param dstRange flag indicating the while-black range of the output (1=jpeg / 0=mpeg)
  * @param srcRange flag indicating the while-black range of the input (1=jpeg / 0=mpeg)
@@ -29,6 +29,7 @@
 
 #include "libavutil/avassert.h"
 #include "libavutil/avutil.h"
+#include "libavutil/buffer.h"
 #include "libavutil/common.h"
 #include "libavutil/intreadwrite.h"
 #include "libavutil/log.h"
@@ -342,6 +343,11 @@ typedef struct SwsContext {
     int hChrFilterSize;           ///< Horizontal filter size for chroma     pixels.
     int vLumFilterSize;           ///< Vertical   filter size for luma/alpha pixels.
     int vChrFilterSize;           ///< Vertical   filter size for chroma     pixels.
+    /**
+     * Shared filter cache entries the above coefficients and positions belong
+     * to, in the hLum, hChr, vLum, vChr order, NULL if owned by this context.
+     */
+    struct SwsFilterCacheEntry *filter_cache[4];
     //@}
 
     int lumMmxextFilterCodeSize;  ///< Runtime-generated MMXEXT horizontal fast bilinear scaler code size for luma/alpha planes.
@@ -352,6 +358,27 @@ typedef struct SwsContext {
     int canMMXEXTBeUsed;
 
     int dstY;                     ///< Last destination vertical line output from last slice.
+    int dstSliceY;                ///< First destination line to output, see sws_scale_dst_slice().
+    int dstSliceH;                ///< Number of destination lines to output, 0 for the whole image.
+
+    /**
+     * @name Slice threading
+     * A whole image passed to sws_scale() is split in bands of destination
+     * lines, each one output by its own context with sws_scale_dst_slice().
+     */
+    //@{
+    int nb_threads;               ///< Number of threads requested by the user, 0 for automatic.
+    struct SwsContext **slice_ctx; ///< Contexts of the bands after the first one, which this context outputs.
+    int nb_slice_ctx;             ///< Number of contexts in slice_ctx.
+    int slice_align;              ///< Vertical alignment of the bands.
+    int *slice_ret;               ///< Return values of the bands.
+    struct SwsThreadContext *thread;
+    //@}
+
+    int is_copy;                  ///< The conversion is a plain copy of the source image.
+    int downscale_shift;          ///< log2 of the exact downscale factor of planarDownscaleWrapper(), 0 if unused.
+    AVBufferPool *frame_pool[4];  ///< Pools of the destination planes allocated by sws_scale_frame().
+    int frame_linesize[4];        ///< Linesizes of the frames allocated by sws_scale_frame().
     int flags;                    ///< Flags passed by the user to select scaler algorithm, optimizations, subsampling, etc...
     void *yuvTable;             // pointer to the yuv->rgb table start so it can be freed()
     uint8_t *table_rV[256 + 2*YUVRGB_TABLE_HEADROOM];
@@ -578,6 +605,13 @@ typedef struct SwsContext {
     void (*hcScale)(struct SwsContext *c, int16_t *dst, int dstW,
                     const uint8_t *src, const int16_t *filter,
                     const int32_t *filterPos, int filterSize);
+    /**
+     * Scale the interleaved chroma of semi-planar input directly into the
+     * U and V buffers. If set, it replaces chrToYV12() and hcScale().
+     */
+    void (*hcScaleNV)(struct SwsContext *c, int16_t *dstU, int16_t *dstV,
+                      int dstW, const uint8_t *src, const int16_t *filter,
+                      const int32_t *filterPos, int filterSize);
     /** @} */
 
     /// Color range conversion function for luma plane if needed.
@@ -585,6 +619,27 @@ typedef struct SwsContext {
     /// Color range conversion function for chroma planes if needed.
     void (*chrConvertRange)(int16_t *dst1, int16_t *dst2, int width);
 
+    /**
+     * Row kernels of the planar bit depth conversions of the unscaled
+     * converter, the C loops are used if they are not set.
+     * The src_bswap and dst_bswap arguments are set if the input or output
+     * words are not in native byte order.
+     */
+    /** @{ */
+    /// dst = (src + dither[j & 7]) * scale >> shift
+    void (*dither_copy8)(uint8_t *dst, const uint16_t *src, int width,
+                         const uint8_t *dither, int scale, int shift,
+                         int src_bswap);
+    void (*dither_copy16)(uint16_t *dst, const uint16_t *src, int width,
+                          const uint8_t *dither, int scale, int shift,
+                          int src_bswap, int dst_bswap);
+    /// dst = src << lshift | src >> rshift, an rshift of 16 only shifts left
+    void (*shift_copy16)(uint16_t *dst, const uint16_t *src, int width,
+                         int lshift, int rshift, int src_bswap, int dst_bswap);
+    void (*shift_copy8to16)(uint16_t *dst, const uint8_t *src, int width,
+                            int lshift, int rshift, int dst_bswap);
+    /** @} */
+
     int needs_hcscale; ///< Set if there are chroma planes to be converted.
 } SwsContext;
 //FIXME check init (where 0)
@@ -604,6 +659,7 @@ SwsFunc ff_yuv2rgb_init_vis(SwsContext *c);
 SwsFunc ff_yuv2rgb_init_altivec(SwsContext *c);
 SwsFunc ff_yuv2rgb_get_func_ptr_bfin(SwsContext *c);
 void ff_bfin_get_unscaled_swscale(SwsContext *c);
+void ff_get_unscaled_swscale_mmx(SwsContext *c);
 
 #if FF_API_SWS_FORMAT_NAME
 /**
@@ -807,6 +863,12 @@ extern const AVClass sws_context_class;
  */
 void ff_get_unscaled_swscale(SwsContext *c);
 
+/**
+ * Set c->swScale to a box filter downscaler if the image is scaled down by
+ * exactly 2 or 4 in both directions without any format conversion.
+ */
+void ff_get_downscale_swscale(SwsContext *c);
+
 void ff_swscale_get_unscaled_altivec(SwsContext *c);
 
 /**
@@ -815,6 +877,23 @@ void ff_swscale_get_unscaled_altivec(SwsContext *c);
  */
 SwsFunc ff_getSwsFunc(SwsContext *c);
 
+typedef struct SwsThreadContext SwsThreadContext;
+typedef int (ff_sws_slice_func)(SwsContext *c, void *arg, int jobnr, int nb_jobs);
+
+/**
+ * Start nb_threads worker threads for ff_sws_thread_execute().
+ */
+int ff_sws_thread_init(SwsContext *c, int nb_threads);
+
+/**
+ * Run func for the jobs 0 to nb_jobs - 1 on the worker threads and wait
+ * for all of them, the return value of each job is stored in rets.
+ */
+int ff_sws_thread_execute(SwsContext *c, ff_sws_slice_func *func,
+                          void *arg, int *rets, int nb_jobs);
+
+void ff_sws_thread_free(SwsContext *c);
+
 void ff_sws_init_input_funcs(SwsContext *c);
 void ff_sws_init_output_funcs(SwsContext *c,
                               yuv2planar1_fn *yuv2plane1,
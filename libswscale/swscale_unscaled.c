@@ -941,6 +941,32 @@ static int yvu9ToYv12Wrapper(SwsContext *c, const uint8_t *src[],
     return srcSliceH;
 }
 
+static int planarDownscaleWrapper(SwsContext *c, const uint8_t *src[],
+                                  int srcStride[], int srcSliceY, int srcSliceH,
+                                  uint8_t *dst[], int dstStride[])
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(c->srcFormat);
+    int shift  = c->downscale_shift;
+    int dstY   = srcSliceY >> shift;
+    int dstH   = srcSliceH >> shift;
+    int planes = av_pix_fmt_count_planes(c->srcFormat);
+    int plane;
+
+    for (plane = 0; plane < planes; plane++) {
+        int chroma = plane == 1 || plane == 2;
+        int vsub   = chroma ? desc->log2_chroma_h : 0;
+        int w      = chroma ? c->chrDstW : c->dstW;
+        int h      = -((-dstH) >> vsub);
+        uint8_t *d = dst[plane] + (dstY >> vsub) * dstStride[plane];
+
+        if (shift == 1)
+            planar_downscale2x(src[plane], d, w, h, srcStride[plane], dstStride[plane]);
+        else
+            planar_downscale4x(src[plane], d, w, h, srcStride[plane], dstStride[plane]);
+    }
+    return dstH;
+}
+
 /* unscaled copy like stuff (assumes nearly identical formats) */
 static int packedCopyWrapper(SwsContext *c, const uint8_t *src[],
                              int srcStride[], int srcSliceY, int srcSliceH,
@@ -1027,12 +1053,30 @@ static int planarCopyWrapper(SwsContext *c, const uint8_t *src[],
                 const uint16_t *srcPtr2 = (const uint16_t *) srcPtr;
                 uint16_t *dstPtr2 = (uint16_t*)dstPtr;
 
-                if (dst_depth == 8) {
+                if (dst_depth == 8 && src_depth < 16 && c->dither_copy8) {
+                    uint16_t scale = dither_scale[dst_depth-1][src_depth-1];
+                    int shift = src_depth-dst_depth + dither_scale[src_depth-2][dst_depth-1];
+                    for (i = 0; i < height; i++) {
+                        c->dither_copy8(dstPtr, srcPtr2, length,
+                                        dithers[src_depth-9][i&7], scale, shift,
+                                        isBE(c->srcFormat) != HAVE_BIGENDIAN);
+                        dstPtr  += dstStride[plane];
+                        srcPtr2 += srcStride[plane]/2;
+                    }
+                } else if (dst_depth == 8) {
                     if(isBE(c->srcFormat) == HAVE_BIGENDIAN){
                         DITHER_COPY(dstPtr, dstStride[plane], srcPtr2, srcStride[plane]/2, , )
                     } else {
                         DITHER_COPY(dstPtr, dstStride[plane], srcPtr2, srcStride[plane]/2, av_bswap16, )
                     }
+                } else if (src_depth == 8 && c->shift_copy8to16) {
+                    for (i = 0; i < height; i++) {
+                        c->shift_copy8to16(dstPtr2, srcPtr, length, dst_depth - 8,
+                                           shiftonly ? 16 : 16 - dst_depth,
+                                           isBE(c->dstFormat) != HAVE_BIGENDIAN);
+                        dstPtr2 += dstStride[plane]/2;
+                        srcPtr  += srcStride[plane];
+                    }
                 } else if (src_depth == 8) {
                     for (i = 0; i < height; i++) {
                         #define COPY816(w)\
@@ -1052,28 +1096,36 @@ static int planarCopyWrapper(SwsContext *c, const uint8_t *src[],
                         dstPtr2 += dstStride[plane]/2;
                         srcPtr  += srcStride[plane];
                     }
+                } else if (src_depth <= dst_depth && c->shift_copy16) {
+                    for (i = 0; i < height; i++) {
+                        c->shift_copy16(dstPtr2, srcPtr2, length, dst_depth - src_depth,
+                                        shiftonly ? 16 : 2*src_depth - dst_depth,
+                                        isBE(c->srcFormat) != HAVE_BIGENDIAN,
+                                        isBE(c->dstFormat) != HAVE_BIGENDIAN);
+                        dstPtr2 += dstStride[plane]/2;
+                        srcPtr2 += srcStride[plane]/2;
+                    }
                 } else if (src_depth <= dst_depth) {
-                    int orig_length = length;
                     for (i = 0; i < height; i++) {
+                        int start = 0;
                         if(isBE(c->srcFormat) == HAVE_BIGENDIAN &&
                            isBE(c->dstFormat) == HAVE_BIGENDIAN &&
                            shiftonly) {
                              unsigned shift = dst_depth - src_depth;
-                             length = orig_length;
 #if HAVE_FAST_64BIT
 #define FAST_COPY_UP(shift) \
     for (j = 0; j < length - 3; j += 4) { \
         uint64_t v = AV_RN64A(srcPtr2 + j); \
         AV_WN64A(dstPtr2 + j, v << shift); \
     } \
-    length &= 3;
+    start = j;
 #else
 #define FAST_COPY_UP(shift) \
     for (j = 0; j < length - 1; j += 2) { \
         uint32_t v = AV_RN32A(srcPtr2 + j); \
         AV_WN32A(dstPtr2 + j, v << shift); \
     } \
-    length &= 1;
+    start = j;
 #endif
                              switch (shift)
                              {
@@ -1083,12 +1135,12 @@ static int planarCopyWrapper(SwsContext *c, const uint8_t *src[],
                         }
 #define COPY_UP(r,w) \
     if(shiftonly){\
-        for (j = 0; j < length; j++){ \
+        for (j = start; j < length; j++){ \
             unsigned int v= r(&srcPtr2[j]);\
             w(&dstPtr2[j], v<<(dst_depth-src_depth));\
         }\
     }else{\
-        for (j = 0; j < length; j++){ \
+        for (j = start; j < length; j++){ \
             unsigned int v= r(&srcPtr2[j]);\
             w(&dstPtr2[j], (v<<(dst_depth-src_depth)) | \
                         (v>>(2*src_depth-dst_depth)));\
@@ -1110,6 +1162,17 @@ static int planarCopyWrapper(SwsContext *c, const uint8_t *src[],
                         dstPtr2 += dstStride[plane]/2;
                         srcPtr2 += srcStride[plane]/2;
                     }
+                } else if (src_depth < 16 && c->dither_copy16) {
+                    uint16_t scale = dither_scale[dst_depth-1][src_depth-1];
+                    int shift = src_depth-dst_depth + dither_scale[src_depth-2][dst_depth-1];
+                    for (i = 0; i < height; i++) {
+                        c->dither_copy16(dstPtr2, srcPtr2, length,
+                                         dithers[src_depth-9][i&7], scale, shift,
+                                         isBE(c->srcFormat) != HAVE_BIGENDIAN,
+                                         isBE(c->dstFormat) != HAVE_BIGENDIAN);
+                        dstPtr2 += dstStride[plane]/2;
+                        srcPtr2 += srcStride[plane]/2;
+                    }
                 } else {
                     if(isBE(c->srcFormat) == HAVE_BIGENDIAN){
                         if(isBE(c->dstFormat) == HAVE_BIGENDIAN){
@@ -1129,6 +1192,10 @@ static int planarCopyWrapper(SwsContext *c, const uint8_t *src[],
                       isBE(c->srcFormat) != isBE(c->dstFormat)) {
 
                 for (i = 0; i < height; i++) {
+                    if (c->shift_copy16)
+                        c->shift_copy16((uint16_t *) dstPtr, (const uint16_t *) srcPtr,
+                                        length, 0, 16, 1, 0);
+                    else
                     for (j = 0; j < length; j++)
                         ((uint16_t *) dstPtr)[j] = av_bswap16(((const uint16_t *) srcPtr)[j]);
                     srcPtr += srcStride[plane];
@@ -1316,14 +1383,40 @@ void ff_get_unscaled_swscale(SwsContext *c)
             c->swScale = packedCopyWrapper;
         else /* Planar YUV or gray */
             c->swScale = planarCopyWrapper;
+        c->is_copy = srcFormat == dstFormat;
     }
 
     if (ARCH_BFIN)
         ff_bfin_get_unscaled_swscale(c);
+    if (HAVE_MMX)
+        ff_get_unscaled_swscale_mmx(c);
     if (HAVE_ALTIVEC)
         ff_swscale_get_unscaled_altivec(c);
 }
 
+void ff_get_downscale_swscale(SwsContext *c)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(c->srcFormat);
+    int shift;
+
+    if (c->srcFormat != c->dstFormat || c->srcRange != c->dstRange ||
+        !(isPlanarYUV(c->srcFormat) || isGray(c->srcFormat)) ||
+        isPacked(c->srcFormat) || desc->comp[0].depth_minus1 != 7 ||
+        c->srcFormat == AV_PIX_FMT_NV12 || c->srcFormat == AV_PIX_FMT_NV21)
+        return;
+
+    for (shift = 1; shift <= 2; shift++)
+        if (c->srcW == c->dstW << shift && c->srcH == c->dstH << shift)
+            break;
+    if (shift > 2 ||
+        c->dstW & ((1 << desc->log2_chroma_w) - 1) ||
+        c->dstH & ((1 << desc->log2_chroma_h) - 1))
+        return;
+
+    c->downscale_shift = shift;
+    c->swScale         = planarDownscaleWrapper;
+}
+
 /* Convert the palette to the same packed 32-bit format as the palette */
 void sws_convertPalette8ToPacked32(const uint8_t *src, uint8_t *dst,
                                    int num_pixels, const uint8_t *palette)
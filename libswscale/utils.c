@@ -26,6 +26,9 @@
 #include <math.h>
 #include <stdio.h>
 #include <string.h>
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
 #if HAVE_SYS_MMAN_H
 #include <sys/mman.h>
 #if defined(MAP_ANON) && !defined(MAP_ANONYMOUS)
@@ -641,6 +644,125 @@ fail:
     return ret;
 }
 
+/**
+ * Filter coefficients and positions shared read-only by all the contexts
+ * built with the same parameters, so they are computed only once.
+ */
+typedef struct SwsFilterCacheEntry {
+    int xInc, srcW, dstW, filterAlign, one, flags, cpu_flags;
+    double param[2];
+
+    int16_t *filter;
+    int32_t *filterPos;
+    int filterSize;
+
+    int refcount;
+    struct SwsFilterCacheEntry *next;
+} SwsFilterCacheEntry;
+
+#if HAVE_PTHREADS
+static pthread_mutex_t filter_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static SwsFilterCacheEntry *filter_cache;
+#endif
+
+/**
+ * Like initFilter(), but get the filter from the shared cache when no
+ * user filter vector is applied to it.
+ */
+static av_cold int get_filter(SwsFilterCacheEntry **entry, int16_t **outFilter,
+                              int32_t **filterPos, int *outFilterSize,
+                              int xInc, int srcW, int dstW, int filterAlign,
+                              int one, int flags, int cpu_flags,
+                              SwsVector *srcFilter, SwsVector *dstFilter,
+                              double param[2])
+{
+#if HAVE_PTHREADS
+    SwsFilterCacheEntry *e;
+
+    if (srcFilter || dstFilter)
+        goto uncached;
+
+    /* SWS_PRINT_INFO only makes initFilter() more verbose */
+    flags &= ~SWS_PRINT_INFO;
+
+    pthread_mutex_lock(&filter_cache_lock);
+    for (e = filter_cache; e; e = e->next)
+        if (e->xInc        == xInc        && e->srcW      == srcW      &&
+            e->dstW        == dstW        && e->one       == one       &&
+            e->filterAlign == filterAlign && e->flags     == flags     &&
+            e->cpu_flags   == cpu_flags   &&
+            e->param[0]    == param[0]    && e->param[1]  == param[1])
+            break;
+
+    if (!e) {
+        e = av_mallocz(sizeof(*e));
+        if (!e ||
+            initFilter(&e->filter, &e->filterPos, &e->filterSize, xInc, srcW,
+                       dstW, filterAlign, one, flags, cpu_flags, NULL, NULL,
+                       param) < 0) {
+            pthread_mutex_unlock(&filter_cache_lock);
+            if (e) {
+                av_free(e->filter);
+                av_free(e->filterPos);
+                av_free(e);
+            }
+            return -1;
+        }
+        e->xInc        = xInc;
+        e->srcW        = srcW;
+        e->dstW        = dstW;
+        e->filterAlign = filterAlign;
+        e->one         = one;
+        e->flags       = flags;
+        e->cpu_flags   = cpu_flags;
+        e->param[0]    = param[0];
+        e->param[1]    = param[1];
+        e->next        = filter_cache;
+        filter_cache   = e;
+    }
+    e->refcount++;
+    pthread_mutex_unlock(&filter_cache_lock);
+
+    *entry         = e;
+    *outFilter     = e->filter;
+    *filterPos     = e->filterPos;
+    *outFilterSize = e->filterSize;
+    return 0;
+
+uncached:
+#endif
+    return initFilter(outFilter, filterPos, outFilterSize, xInc, srcW, dstW,
+                      filterAlign, one, flags, cpu_flags, srcFilter, dstFilter,
+                      param);
+}
+
+static av_cold void free_filter(SwsFilterCacheEntry **entry, int16_t **filter,
+                                int32_t **filterPos)
+{
+#if HAVE_PTHREADS
+    SwsFilterCacheEntry **e;
+
+    if (*entry) {
+        pthread_mutex_lock(&filter_cache_lock);
+        if (!--(*entry)->refcount) {
+            for (e = &filter_cache; *e != *entry; e = &(*e)->next)
+                ;
+            *e = (*entry)->next;
+            av_free((*entry)->filter);
+            av_free((*entry)->filterPos);
+            av_free(*entry);
+        }
+        pthread_mutex_unlock(&filter_cache_lock);
+        *entry     = NULL;
+        *filter    = NULL;
+        *filterPos = NULL;
+        return;
+    }
+#endif
+    av_freep(filter);
+    av_freep(filterPos);
+}
+
 #if HAVE_MMXEXT_INLINE
 static av_cold int init_hscaler_mmxext(int dstW, int xInc, uint8_t *filterCode,
                                        int16_t *filter, int32_t *filterPos,
@@ -939,6 +1061,12 @@ int sws_setColorspaceDetails(struct SwsContext *c, const int inv_table[4],
 {
     const AVPixFmtDescriptor *desc_dst = av_pix_fmt_desc_get(c->dstFormat);
     const AVPixFmtDescriptor *desc_src = av_pix_fmt_desc_get(c->srcFormat);
+    int i;
+
+    for (i = 0; i < c->nb_slice_ctx; i++)
+        sws_setColorspaceDetails(c->slice_ctx[i], inv_table, srcRange, table,
+                                 dstRange, brightness, contrast, saturation);
+
     memcpy(c->srcColorspaceTable, inv_table, sizeof(int) * 4);
     memcpy(c->dstColorspaceTable, table, sizeof(int) * 4);
 
@@ -1049,8 +1177,8 @@ SwsContext *sws_alloc_context(void)
     return c;
 }
 
-av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
-                             SwsFilter *dstFilter)
+static av_cold int init_context(SwsContext *c, SwsFilter *srcFilter,
+                                SwsFilter *dstFilter)
 {
     int i, j;
     int usesVFilter, usesHFilter;
@@ -1254,6 +1382,20 @@ av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
         }
     }
 
+    /* exact 1/2 and 1/4 downscales, averaging the source pixels */
+    if ((flags & (SWS_AREA | SWS_FAST_BILINEAR)) &&
+        !usesHFilter && !usesVFilter) {
+        ff_get_downscale_swscale(c);
+
+        if (c->swScale) {
+            if (flags & SWS_PRINT_INFO)
+                av_log(c, AV_LOG_INFO,
+                       "using 1/%d box downscaler for %s\n",
+                       1 << c->downscale_shift, av_get_pix_fmt_name(srcFormat));
+            return 0;
+        }
+    }
+
     c->srcBpc = 1 + desc_src->comp[0].depth_minus1;
     if (c->srcBpc < 8)
         c->srcBpc = 8;
@@ -1369,14 +1511,16 @@ av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
                 (HAVE_ALTIVEC && cpu_flags & AV_CPU_FLAG_ALTIVEC) ? 8 :
                 1;
 
-            if (initFilter(&c->hLumFilter, &c->hLumFilterPos,
+            if (get_filter(&c->filter_cache[0],
+                           &c->hLumFilter, &c->hLumFilterPos,
                            &c->hLumFilterSize, c->lumXInc,
                            srcW, dstW, filterAlign, 1 << 14,
                            (flags & SWS_BICUBLIN) ? (flags | SWS_BICUBIC) : flags,
                            cpu_flags, srcFilter->lumH, dstFilter->lumH,
                            c->param) < 0)
                 goto fail;
-            if (initFilter(&c->hChrFilter, &c->hChrFilterPos,
+            if (get_filter(&c->filter_cache[1],
+                           &c->hChrFilter, &c->hChrFilterPos,
                            &c->hChrFilterSize, c->chrXInc,
                            c->chrSrcW, c->chrDstW, filterAlign, 1 << 14,
                            (flags & SWS_BICUBLIN) ? (flags | SWS_BILINEAR) : flags,
@@ -1393,13 +1537,15 @@ av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
             (HAVE_ALTIVEC && cpu_flags & AV_CPU_FLAG_ALTIVEC) ? 8 :
             1;
 
-        if (initFilter(&c->vLumFilter, &c->vLumFilterPos, &c->vLumFilterSize,
+        if (get_filter(&c->filter_cache[2], &c->vLumFilter,
+                       &c->vLumFilterPos, &c->vLumFilterSize,
                        c->lumYInc, srcH, dstH, filterAlign, (1 << 12),
                        (flags & SWS_BICUBLIN) ? (flags | SWS_BICUBIC) : flags,
                        cpu_flags, srcFilter->lumV, dstFilter->lumV,
                        c->param) < 0)
             goto fail;
-        if (initFilter(&c->vChrFilter, &c->vChrFilterPos, &c->vChrFilterSize,
+        if (get_filter(&c->filter_cache[3], &c->vChrFilter,
+                       &c->vChrFilterPos, &c->vChrFilterSize,
                        c->chrYInc, c->chrSrcH, c->chrDstH,
                        filterAlign, (1 << 12),
                        (flags & SWS_BICUBLIN) ? (flags | SWS_BILINEAR) : flags,
@@ -1558,6 +1704,87 @@ fail: // FIXME replace things by appropriate error codes
     return -1;
 }
 
+static av_cold int init_slice_threads(SwsContext *c, SwsFilter *srcFilter,
+                                      SwsFilter *dstFilter)
+{
+    int i, ret, nb_threads = c->nb_threads;
+
+    if (!nb_threads)
+        nb_threads = av_cpu_count();
+
+    /* planar2x() interpolates the chroma across the slice boundaries */
+    if (c->srcFormat == AV_PIX_FMT_YUV410P && !(c->flags & SWS_BITEXACT) &&
+        (c->dstFormat == AV_PIX_FMT_YUV420P || c->dstFormat == AV_PIX_FMT_YUVA420P) &&
+        c->srcW == c->dstW && c->srcH == c->dstH)
+        return 0;
+
+    /* the unscaled converters restart their 8-line dither pattern on
+     * every slice */
+    c->slice_align = FFMAX(8, 1 << FFMAX(c->chrSrcVSubSample, c->chrDstVSubSample));
+    nb_threads = FFMIN(nb_threads, c->dstH / c->slice_align);
+    if (nb_threads <= 1)
+        return 0;
+
+    c->slice_ctx = av_mallocz((nb_threads - 1) * sizeof(*c->slice_ctx));
+    c->slice_ret = av_mallocz(nb_threads * sizeof(*c->slice_ret));
+    if (!c->slice_ctx || !c->slice_ret)
+        return AVERROR(ENOMEM);
+
+    /* the slice contexts must output exactly the same lines as this one */
+    for (i = 0; i < nb_threads - 1; i++) {
+        SwsContext *s = sws_alloc_context();
+        if (!s)
+            return AVERROR(ENOMEM);
+        c->slice_ctx[c->nb_slice_ctx++] = s;
+
+        s->srcW      = c->srcW;
+        s->srcH      = c->srcH;
+        s->srcRange  = c->srcRange;
+        s->src0Alpha = c->src0Alpha;
+        s->srcXYZ    = c->srcXYZ;
+        s->srcFormat = c->srcFormat;
+        s->dstW      = c->dstW;
+        s->dstH      = c->dstH;
+        s->dstRange  = c->dstRange;
+        s->dst0Alpha = c->dst0Alpha;
+        s->dstXYZ    = c->dstXYZ;
+        s->dstFormat = c->dstFormat;
+        s->flags     = c->flags & ~SWS_PRINT_INFO;
+        s->param[0]  = c->param[0];
+        s->param[1]  = c->param[1];
+        /* the details are unset when sws_setColorspaceDetails() was never called */
+        if (c->contrast)
+            sws_setColorspaceDetails(s, c->srcColorspaceTable, c->srcRange,
+                                     c->dstColorspaceTable, c->dstRange,
+                                     c->brightness, c->contrast, c->saturation);
+        ret = init_context(s, srcFilter, dstFilter);
+        if (ret < 0)
+            return ret;
+        /* fill_rgb2yuv_table() special-cases the default table by address */
+        memcpy(s->input_rgb2yuv_table, c->input_rgb2yuv_table,
+               sizeof(c->input_rgb2yuv_table));
+    }
+
+    return ff_sws_thread_init(c, nb_threads);
+}
+
+av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
+                             SwsFilter *dstFilter)
+{
+    int ret = init_context(c, srcFilter, dstFilter);
+    if (ret < 0)
+        return ret;
+
+    /* error diffusion carries the error over to the next line */
+    if (HAVE_THREADS && c->nb_threads != 1 && !(c->flags & SWS_ERROR_DIFFUSION)) {
+        ret = init_slice_threads(c, srcFilter, dstFilter);
+        if (ret < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
 #if FF_API_SWS_GETCONTEXT
 SwsContext *sws_getContext(int srcW, int srcH, enum AVPixelFormat srcFormat,
                            int dstW, int dstH, enum AVPixelFormat dstFormat,
@@ -1925,6 +2152,13 @@ void sws_freeContext(SwsContext *c)
     if (!c)
         return;
 
+    if (HAVE_THREADS)
+        ff_sws_thread_free(c);
+    for (i = 0; i < c->nb_slice_ctx; i++)
+        sws_freeContext(c->slice_ctx[i]);
+    av_freep(&c->slice_ctx);
+    av_freep(&c->slice_ret);
+
     if (c->lumPixBuf) {
         for (i = 0; i < c->vLumBufSize; i++)
             av_freep(&c->lumPixBuf[i]);
@@ -1947,20 +2181,18 @@ void sws_freeContext(SwsContext *c)
     for (i = 0; i < 4; i++)
         av_freep(&c->dither_error[i]);
 
-    av_freep(&c->vLumFilter);
-    av_freep(&c->vChrFilter);
-    av_freep(&c->hLumFilter);
-    av_freep(&c->hChrFilter);
+    for (i = 0; i < 4; i++)
+        av_buffer_pool_uninit(&c->frame_pool[i]);
+
+    free_filter(&c->filter_cache[0], &c->hLumFilter, &c->hLumFilterPos);
+    free_filter(&c->filter_cache[1], &c->hChrFilter, &c->hChrFilterPos);
+    free_filter(&c->filter_cache[2], &c->vLumFilter, &c->vLumFilterPos);
+    free_filter(&c->filter_cache[3], &c->vChrFilter, &c->vChrFilterPos);
 #if HAVE_ALTIVEC
     av_freep(&c->vYCoeffsBank);
     av_freep(&c->vCCoeffsBank);
 #endif
 
-    av_freep(&c->vLumFilterPos);
-    av_freep(&c->vChrFilterPos);
-    av_freep(&c->hLumFilterPos);
-    av_freep(&c->hChrFilterPos);
-
 #if HAVE_MMX_INLINE
 #if USE_MMAP
     if (c->lumMmxextFilterCode)
@@ -1996,6 +2228,7 @@ struct SwsContext *sws_getCachedContext(struct SwsContext *context, int srcW,
 {
     static const double default_param[2] = { SWS_PARAM_DEFAULT,
                                              SWS_PARAM_DEFAULT };
+    int nb_threads = context ? context->nb_threads : 1;
 
     if (!param)
         param = default_param;
@@ -2032,6 +2265,7 @@ struct SwsContext *sws_getCachedContext(struct SwsContext *context, int srcW,
         context->flags     = flags;
         context->param[0]  = param[0];
         context->param[1]  = param[1];
+        context->nb_threads = nb_threads;
         sws_setColorspaceDetails(context, ff_yuv2rgb_coeffs[SWS_CS_DEFAULT],
                                  context->srcRange,
                                  ff_yuv2rgb_coeffs[SWS_CS_DEFAULT] /* FIXME*/,
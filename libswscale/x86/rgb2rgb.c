@@ -122,6 +122,402 @@ DECLARE_ASM_CONST(8, uint64_t, mul16_mid)    = 0x2080208020802080ULL;
 #define RENAME(a) a ## _3DNOW
 #include "rgb2rgb_template.c"
 
+#if HAVE_SSE2_INLINE
+/* sum the pairs of bytes of xmm"a" into its words, xmm"t" is clobbered
+ * and xmm7 holds 0x00FF in each word */
+#define SUM_PAIRS(a, t)                             \
+    "movdqa        %%xmm"a", %%xmm"t"        \n\t"  \
+    "psrlw            $8, %%xmm"a"           \n\t"  \
+    "pand          %%xmm7, %%xmm"t"          \n\t"  \
+    "paddw         %%xmm"t", %%xmm"a"        \n\t"  \
+
+static void planar_downscale2x_SSE2(const uint8_t *src, uint8_t *dst,
+                                    int width, int height,
+                                    int srcStride, int dstStride)
+{
+    int x, y;
+
+    for (y = 0; y < height; y++) {
+        const uint8_t *s = src;
+        uint8_t *d       = dst;
+        x86_reg blocks   = width >> 4;
+
+        if (blocks)
+            __asm__ volatile(
+                "pcmpeqw       %%xmm7, %%xmm7        \n\t"
+                "movdqa        %%xmm7, %%xmm6        \n\t"
+                "psrlw            $8, %%xmm7         \n\t"
+                "psrlw           $15, %%xmm6         \n\t"
+                "psllw            $1, %%xmm6         \n\t"
+                ".p2align         4                  \n\t"
+                "1:                                  \n\t"
+                "movdqu          (%0), %%xmm0        \n\t"
+                "movdqu        16(%0), %%xmm1        \n\t"
+                "movdqu      (%0, %3), %%xmm2        \n\t"
+                "movdqu    16(%0, %3), %%xmm3        \n\t"
+                SUM_PAIRS("0", "4")
+                SUM_PAIRS("1", "5")
+                SUM_PAIRS("2", "4")
+                SUM_PAIRS("3", "5")
+                "paddw         %%xmm2, %%xmm0        \n\t"
+                "paddw         %%xmm3, %%xmm1        \n\t"
+                "paddw         %%xmm6, %%xmm0        \n\t"
+                "paddw         %%xmm6, %%xmm1        \n\t"
+                "psrlw            $2, %%xmm0         \n\t"
+                "psrlw            $2, %%xmm1         \n\t"
+                "packuswb      %%xmm1, %%xmm0        \n\t"
+                "movdqu        %%xmm0, (%1)          \n\t"
+                "add             $32, %0             \n\t"
+                "add             $16, %1             \n\t"
+                "sub              $1, %2             \n\t"
+                "jnz             1b                  \n\t"
+                : "+r"(s), "+r"(d), "+r"(blocks)
+                : "r"((x86_reg)srcStride)
+                : XMM_CLOBBERS("xmm0", "xmm1", "xmm2", "xmm3",
+                               "xmm4", "xmm5", "xmm6", "xmm7",) "memory");
+
+        for (x = width & ~15; x < width; x++)
+            dst[x] = (src[2 * x] + src[2 * x + 1] +
+                      src[2 * x + srcStride] + src[2 * x + 1 + srcStride] + 2) >> 2;
+        src += 2 * srcStride;
+        dst += dstStride;
+    }
+}
+
+static void planar_downscale4x_SSE2(const uint8_t *src, uint8_t *dst,
+                                    int width, int height,
+                                    int srcStride, int dstStride)
+{
+    int x, y, i;
+
+    for (y = 0; y < height; y++) {
+        const uint8_t *s = src;
+        uint8_t *d       = dst;
+        x86_reg blocks   = width >> 3;
+
+        if (blocks)
+            __asm__ volatile(
+                "pcmpeqw       %%xmm7, %%xmm7        \n\t"
+                "movdqa        %%xmm7, %%xmm6        \n\t"
+                "psrlw            $8, %%xmm7         \n\t"
+                "psrlw           $15, %%xmm6         \n\t"
+                ".p2align         4                  \n\t"
+                "1:                                  \n\t"
+                "movdqu          (%0), %%xmm4        \n\t"
+                "movdqu        16(%0), %%xmm5        \n\t"
+                "movdqu      (%0, %3), %%xmm0        \n\t"
+                "movdqu    16(%0, %3), %%xmm1        \n\t"
+                SUM_PAIRS("4", "2")
+                SUM_PAIRS("5", "3")
+                SUM_PAIRS("0", "2")
+                SUM_PAIRS("1", "3")
+                "paddw         %%xmm0, %%xmm4        \n\t"
+                "paddw         %%xmm1, %%xmm5        \n\t"
+                "movdqu   (%0, %3, 2), %%xmm0        \n\t"
+                "movdqu 16(%0, %3, 2), %%xmm1        \n\t"
+                SUM_PAIRS("0", "2")
+                SUM_PAIRS("1", "3")
+                "paddw         %%xmm0, %%xmm4        \n\t"
+                "paddw         %%xmm1, %%xmm5        \n\t"
+                "movdqu      (%0, %4), %%xmm0        \n\t"
+                "movdqu    16(%0, %4), %%xmm1        \n\t"
+                SUM_PAIRS("0", "2")
+                SUM_PAIRS("1", "3")
+                "paddw         %%xmm0, %%xmm4        \n\t"
+                "paddw         %%xmm1, %%xmm5        \n\t"
+                "pmaddwd       %%xmm6, %%xmm4        \n\t"
+                "pmaddwd       %%xmm6, %%xmm5        \n\t"
+                "packssdw      %%xmm5, %%xmm4        \n\t"
+                "movdqa        %%xmm6, %%xmm0        \n\t"
+                "psllw            $3, %%xmm0         \n\t"
+                "paddw         %%xmm0, %%xmm4        \n\t"
+                "psrlw            $4, %%xmm4         \n\t"
+                "packuswb      %%xmm4, %%xmm4        \n\t"
+                "movq          %%xmm4, (%1)          \n\t"
+                "add             $32, %0             \n\t"
+                "add              $8, %1             \n\t"
+                "sub              $1, %2             \n\t"
+                "jnz             1b                  \n\t"
+                : "+r"(s), "+r"(d), "+r"(blocks)
+                : "r"((x86_reg)srcStride), "r"((x86_reg)srcStride * 3)
+                : XMM_CLOBBERS("xmm0", "xmm1", "xmm2", "xmm3",
+                               "xmm4", "xmm5", "xmm6", "xmm7",) "memory");
+
+        for (x = width & ~7; x < width; x++) {
+            const uint8_t *p = src + 4 * x;
+            int sum = 8;
+
+            for (i = 0; i < 4; i++, p += srcStride)
+                sum += p[0] + p[1] + p[2] + p[3];
+            dst[x] = sum >> 4;
+        }
+        src += 4 * srcStride;
+        dst += dstStride;
+    }
+}
+#endif /* HAVE_SSE2_INLINE */
+
+#if HAVE_SSSE3_INLINE
+/* packed RGB conversions that are pure byte permutations, done with pshufb
+ * 16 pixels at a time */
+
+#define SHUF_MASK32(a, b, c, d) \
+    { a, b, c, d, 4 + a, 4 + b, 4 + c, 4 + d, \
+      8 + a, 8 + b, 8 + c, 8 + d, 12 + a, 12 + b, 12 + c, 12 + d }
+
+DECLARE_ALIGNED(16, static const uint8_t, shuf_0321)[16] = SHUF_MASK32(0, 3, 2, 1);
+DECLARE_ALIGNED(16, static const uint8_t, shuf_1230)[16] = SHUF_MASK32(1, 2, 3, 0);
+DECLARE_ALIGNED(16, static const uint8_t, shuf_2103)[16] = SHUF_MASK32(2, 1, 0, 3);
+DECLARE_ALIGNED(16, static const uint8_t, shuf_3012)[16] = SHUF_MASK32(3, 0, 1, 2);
+DECLARE_ALIGNED(16, static const uint8_t, shuf_3210)[16] = SHUF_MASK32(3, 2, 1, 0);
+
+DECLARE_ALIGNED(16, static const uint8_t, shuf_24to32)[16] = {
+    0, 1, 2, 0x80, 3, 4, 5, 0x80, 6, 7, 8, 0x80, 9, 10, 11, 0x80
+};
+DECLARE_ALIGNED(16, static const uint8_t, shuf_24to32_swap)[16] = {
+    2, 1, 0, 0x80, 5, 4, 3, 0x80, 8, 7, 6, 0x80, 11, 10, 9, 0x80
+};
+DECLARE_ALIGNED(16, static const uint8_t, shuf_32to24)[16] = {
+    0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, 0x80, 0x80, 0x80, 0x80
+};
+DECLARE_ALIGNED(16, static const uint8_t, shuf_32to24_swap)[16] = {
+    2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, 0x80, 0x80, 0x80, 0x80
+};
+DECLARE_ASM_CONST(16, uint8_t, shuf_24swap)[16] = {
+    2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 0x80, 0x80, 0x80, 0x80
+};
+DECLARE_ASM_CONST(16, uint32_t, alpha_32)[4] = {
+    0xFF000000, 0xFF000000, 0xFF000000, 0xFF000000
+};
+
+/* split 48 bytes of 24-bit pixels in xmm0-xmm2 into 4 registers holding
+ * 4 pixels each in their low 12 bytes: xmm0, xmm3, xmm4, xmm2 */
+#define SPLIT24                                 \
+    "movdqa        %%xmm1, %%xmm3        \n\t"  \
+    "movdqa        %%xmm2, %%xmm4        \n\t"  \
+    "palignr  $12, %%xmm0, %%xmm3        \n\t"  \
+    "palignr   $8, %%xmm1, %%xmm4        \n\t"  \
+    "psrldq    $4, %%xmm2                \n\t"  \
+
+/* join the low 12 bytes of xmm0, xmm3, xmm4, xmm2 into xmm0, xmm3, xmm4 */
+#define JOIN24                                  \
+    "movdqa        %%xmm3, %%xmm5        \n\t"  \
+    "pslldq   $12, %%xmm5                \n\t"  \
+    "por           %%xmm5, %%xmm0        \n\t"  \
+    "psrldq    $4, %%xmm3                \n\t"  \
+    "movdqa        %%xmm4, %%xmm5        \n\t"  \
+    "pslldq    $8, %%xmm5                \n\t"  \
+    "por           %%xmm5, %%xmm3        \n\t"  \
+    "psrldq    $8, %%xmm4                \n\t"  \
+    "pslldq    $4, %%xmm2                \n\t"  \
+    "por           %%xmm2, %%xmm4        \n\t"  \
+
+static av_always_inline void shuffle_bytes_ssse3(const uint8_t *src, uint8_t *dst,
+                                                 int src_size, const uint8_t *mask)
+{
+    x86_reg blocks = src_size >> 5;
+    int i;
+
+    if (blocks)
+        __asm__ volatile(
+            "movdqa          (%3), %%xmm7        \n\t"
+            ".p2align           4                \n\t"
+            "1:                                  \n\t"
+            "movdqu          (%0), %%xmm0        \n\t"
+            "movdqu        16(%0), %%xmm1        \n\t"
+            "pshufb        %%xmm7, %%xmm0        \n\t"
+            "pshufb        %%xmm7, %%xmm1        \n\t"
+            "movdqu        %%xmm0,   (%1)        \n\t"
+            "movdqu        %%xmm1, 16(%1)        \n\t"
+            "add              $32, %0            \n\t"
+            "add              $32, %1            \n\t"
+            "sub               $1, %2            \n\t"
+            "jnz               1b                \n\t"
+            : "+r"(src), "+r"(dst), "+r"(blocks)
+            : "r"(mask)
+            : XMM_CLOBBERS("xmm0", "xmm1", "xmm7",) "memory");
+
+    for (i = 0; i < (src_size & 31); i += 4) {
+        dst[i + 0] = src[i + mask[0]];
+        dst[i + 1] = src[i + mask[1]];
+        dst[i + 2] = src[i + mask[2]];
+        dst[i + 3] = src[i + mask[3]];
+    }
+}
+
+#define DEFINE_SHUFFLE_BYTES_SSSE3(name)                                \
+static void shuffle_bytes_ ## name ## _SSSE3(const uint8_t *src,        \
+                                             uint8_t *dst, int src_size) \
+{                                                                       \
+    shuffle_bytes_ssse3(src, dst, src_size, shuf_ ## name);             \
+}
+
+DEFINE_SHUFFLE_BYTES_SSSE3(0321)
+DEFINE_SHUFFLE_BYTES_SSSE3(1230)
+DEFINE_SHUFFLE_BYTES_SSSE3(2103)
+DEFINE_SHUFFLE_BYTES_SSSE3(3012)
+DEFINE_SHUFFLE_BYTES_SSSE3(3210)
+
+static void rgb24tobgr24_SSSE3(const uint8_t *src, uint8_t *dst, int src_size)
+{
+    x86_reg blocks = src_size / 48;
+    int i;
+
+    if (blocks)
+        __asm__ volatile(
+            "movdqa "MANGLE(shuf_24swap)", %%xmm7 \n\t"
+            ".p2align           4                \n\t"
+            "1:                                  \n\t"
+            "movdqu          (%0), %%xmm0        \n\t"
+            "movdqu        16(%0), %%xmm1        \n\t"
+            "movdqu        32(%0), %%xmm2        \n\t"
+            SPLIT24
+            "pshufb        %%xmm7, %%xmm0        \n\t"
+            "pshufb        %%xmm7, %%xmm3        \n\t"
+            "pshufb        %%xmm7, %%xmm4        \n\t"
+            "pshufb        %%xmm7, %%xmm2        \n\t"
+            JOIN24
+            "movdqu        %%xmm0,   (%1)        \n\t"
+            "movdqu        %%xmm3, 16(%1)        \n\t"
+            "movdqu        %%xmm4, 32(%1)        \n\t"
+            "add              $48, %0            \n\t"
+            "add              $48, %1            \n\t"
+            "sub               $1, %2            \n\t"
+            "jnz               1b                \n\t"
+            : "+r"(src), "+r"(dst), "+r"(blocks)
+            :
+            : XMM_CLOBBERS("xmm0", "xmm1", "xmm2", "xmm3",
+                           "xmm4", "xmm5", "xmm7",) "memory");
+
+    for (i = 0; i < src_size % 48; i += 3) {
+        uint8_t x  = src[i + 2];
+        dst[i + 1] = src[i + 1];
+        dst[i + 2] = src[i + 0];
+        dst[i + 0] = x;
+    }
+}
+
+static av_always_inline void rgb24to32_ssse3(const uint8_t *src, uint8_t *dst,
+                                             int src_size, const uint8_t *mask)
+{
+    x86_reg blocks = src_size / 48;
+    int i;
+
+    if (blocks)
+        __asm__ volatile(
+            "movdqa          (%3), %%xmm7        \n\t"
+            "movdqa "MANGLE(alpha_32)", %%xmm6   \n\t"
+            ".p2align           4                \n\t"
+            "1:                                  \n\t"
+            "movdqu          (%0), %%xmm0        \n\t"
+            "movdqu        16(%0), %%xmm1        \n\t"
+            "movdqu        32(%0), %%xmm2        \n\t"
+            SPLIT24
+            "pshufb        %%xmm7, %%xmm0        \n\t"
+            "pshufb        %%xmm7, %%xmm3        \n\t"
+            "pshufb        %%xmm7, %%xmm4        \n\t"
+            "pshufb        %%xmm7, %%xmm2        \n\t"
+            "por           %%xmm6, %%xmm0        \n\t"
+            "por           %%xmm6, %%xmm3        \n\t"
+            "por           %%xmm6, %%xmm4        \n\t"
+            "por           %%xmm6, %%xmm2        \n\t"
+            "movdqu        %%xmm0,   (%1)        \n\t"
+            "movdqu        %%xmm3, 16(%1)        \n\t"
+            "movdqu        %%xmm4, 32(%1)        \n\t"
+            "movdqu        %%xmm2, 48(%1)        \n\t"
+            "add              $48, %0            \n\t"
+            "add              $64, %1            \n\t"
+            "sub               $1, %2            \n\t"
+            "jnz               1b                \n\t"
+            : "+r"(src), "+r"(dst), "+r"(blocks)
+            : "r"(mask)
+            : XMM_CLOBBERS("xmm0", "xmm1", "xmm2", "xmm3",
+                           "xmm4", "xmm6", "xmm7",) "memory");
+
+    for (i = 0; i < src_size % 48; i += 3) {
+        *dst++ = src[i + mask[0]];
+        *dst++ = src[i + mask[1]];
+        *dst++ = src[i + mask[2]];
+        *dst++ = 255;
+    }
+}
+
+static av_always_inline void rgb32to24_ssse3(const uint8_t *src, uint8_t *dst,
+                                             int src_size, const uint8_t *mask)
+{
+    x86_reg blocks = src_size >> 6;
+    int i;
+
+    if (blocks)
+        __asm__ volatile(
+            "movdqa          (%3), %%xmm7        \n\t"
+            ".p2align           4                \n\t"
+            "1:                                  \n\t"
+            "movdqu          (%0), %%xmm0        \n\t"
+            "movdqu        16(%0), %%xmm3        \n\t"
+            "movdqu        32(%0), %%xmm4        \n\t"
+            "movdqu        48(%0), %%xmm2        \n\t"
+            "pshufb        %%xmm7, %%xmm0        \n\t"
+            "pshufb        %%xmm7, %%xmm3        \n\t"
+            "pshufb        %%xmm7, %%xmm4        \n\t"
+            "pshufb        %%xmm7, %%xmm2        \n\t"
+            JOIN24
+            "movdqu        %%xmm0,   (%1)        \n\t"
+            "movdqu        %%xmm3, 16(%1)        \n\t"
+            "movdqu        %%xmm4, 32(%1)        \n\t"
+            "add              $64, %0            \n\t"
+            "add              $48, %1            \n\t"
+            "sub               $1, %2            \n\t"
+            "jnz               1b                \n\t"
+            : "+r"(src), "+r"(dst), "+r"(blocks)
+            : "r"(mask)
+            : XMM_CLOBBERS("xmm0", "xmm2", "xmm3",
+                           "xmm4", "xmm5", "xmm7",) "memory");
+
+    for (i = 0; i < (src_size & 63); i += 4) {
+        *dst++ = src[i + mask[0]];
+        *dst++ = src[i + mask[1]];
+        *dst++ = src[i + mask[2]];
+    }
+}
+
+/* rgb24tobgr32/rgb32tobgr24 only add/drop the padding byte on little endian,
+ * rgb24to32/rgb32to24 also swap R and B */
+static void rgb24tobgr32_SSSE3(const uint8_t *src, uint8_t *dst, int src_size)
+{
+    rgb24to32_ssse3(src, dst, src_size, shuf_24to32);
+}
+
+static void rgb24to32_SSSE3(const uint8_t *src, uint8_t *dst, int src_size)
+{
+    rgb24to32_ssse3(src, dst, src_size, shuf_24to32_swap);
+}
+
+static void rgb32tobgr24_SSSE3(const uint8_t *src, uint8_t *dst, int src_size)
+{
+    rgb32to24_ssse3(src, dst, src_size, shuf_32to24);
+}
+
+static void rgb32to24_SSSE3(const uint8_t *src, uint8_t *dst, int src_size)
+{
+    rgb32to24_ssse3(src, dst, src_size, shuf_32to24_swap);
+}
+
+static av_cold void rgb2rgb_init_SSSE3(void)
+{
+    rgb24tobgr32       = rgb24tobgr32_SSSE3;
+    rgb24to32          = rgb24to32_SSSE3;
+    rgb32tobgr24       = rgb32tobgr24_SSSE3;
+    rgb32to24          = rgb32to24_SSSE3;
+    rgb24tobgr24       = rgb24tobgr24_SSSE3;
+    shuffle_bytes_0321 = shuffle_bytes_0321_SSSE3;
+    shuffle_bytes_1230 = shuffle_bytes_1230_SSSE3;
+    shuffle_bytes_2103 = shuffle_bytes_2103_SSSE3;
+    shuffle_bytes_3012 = shuffle_bytes_3012_SSSE3;
+    shuffle_bytes_3210 = shuffle_bytes_3210_SSSE3;
+}
+#endif /* HAVE_SSSE3_INLINE */
+
 /*
  RGB15->RGB16 original by Strepto/Astral
  ported to gcc & bugfixed : A'rpi
@@ -144,5 +540,15 @@ av_cold void rgb2rgb_init_x86(void)
         rgb2rgb_init_MMXEXT();
     if (INLINE_SSE2(cpu_flags))
         rgb2rgb_init_SSE2();
+#if HAVE_SSE2_INLINE
+    if (INLINE_SSE2(cpu_flags)) {
+        planar_downscale2x = planar_downscale2x_SSE2;
+        planar_downscale4x = planar_downscale4x_SSE2;
+    }
+#endif
+#if HAVE_SSSE3_INLINE
+    if (INLINE_SSSE3(cpu_flags))
+        rgb2rgb_init_SSSE3();
+#endif
 #endif /* HAVE_INLINE_ASM */
 }
@@ -24,6 +24,7 @@
 #include "libswscale/swscale_internal.h"
 #include "libavutil/attributes.h"
 #include "libavutil/avassert.h"
+#include "libavutil/bswap.h"
 #include "libavutil/intreadwrite.h"
 #include "libavutil/x86/asm.h"
 #include "libavutil/x86/cpu.h"
@@ -271,6 +272,230 @@ static void yuv2yuvX_sse3(const int16_t *filter, int filterSize,
 }
 #endif
 
+#if HAVE_SSE2_INLINE
+/* Kernels of the bit depth conversions of planarCopyWrapper(), 16 pixels
+ * per iteration. xmm0 and xmm2 hold the pixels, xmm1 is a temporary. */
+
+#define BSWAP_W(r)                              \
+    "movdqa     %%xmm"r", %%xmm1         \n\t"  \
+    "psllw          $8, %%xmm"r"         \n\t"  \
+    "psrlw          $8, %%xmm1           \n\t"  \
+    "por        %%xmm1, %%xmm"r"         \n\t"  \
+
+#define NO_BSWAP(r)
+
+#define STORE8(bswap)                           \
+    "packuswb   %%xmm2, %%xmm0           \n\t"  \
+    "movdqu     %%xmm0, (%0)             \n\t"  \
+    "add           $16, %0               \n\t"  \
+
+#define STORE16(bswap)                          \
+    bswap("0")                                  \
+    bswap("2")                                  \
+    "movdqu     %%xmm0,   (%0)           \n\t"  \
+    "movdqu     %%xmm2, 16(%0)           \n\t"  \
+    "add           $32, %0               \n\t"  \
+
+/* dst = ((src + dither) * mul >> 16) >> rshift */
+#define DITHER_FUNC(name, type, in, store, out)                             \
+static void name(type *dst, const uint16_t *src, x86_reg blocks,           \
+                 const uint8_t *dither, int mul, int rshift)               \
+{                                                                          \
+    __asm__ volatile(                                                      \
+        "pxor       %%xmm1, %%xmm1           \n\t"                         \
+        "movq         (%3), %%xmm7           \n\t"                         \
+        "punpcklbw  %%xmm1, %%xmm7           \n\t"                         \
+        "movd           %4, %%xmm6           \n\t"                         \
+        "pshuflw $0, %%xmm6, %%xmm6          \n\t"                         \
+        "punpcklqdq %%xmm6, %%xmm6           \n\t"                         \
+        "movd           %5, %%xmm5           \n\t"                         \
+        ".p2align        4                   \n\t"                         \
+        "1:                                  \n\t"                         \
+        "movdqu       (%1), %%xmm0           \n\t"                         \
+        "movdqu     16(%1), %%xmm2           \n\t"                         \
+        in("0")                                                            \
+        in("2")                                                            \
+        "paddw      %%xmm7, %%xmm0           \n\t"                         \
+        "paddw      %%xmm7, %%xmm2           \n\t"                         \
+        "pmulhuw    %%xmm6, %%xmm0           \n\t"                         \
+        "pmulhuw    %%xmm6, %%xmm2           \n\t"                         \
+        "psrlw      %%xmm5, %%xmm0           \n\t"                         \
+        "psrlw      %%xmm5, %%xmm2           \n\t"                         \
+        store(out)                                                         \
+        "add           $32, %1               \n\t"                         \
+        "sub            $1, %2               \n\t"                         \
+        "jnz            1b                   \n\t"                         \
+        : "+r"(dst), "+r"(src), "+r"(blocks)                               \
+        : "r"(dither), "m"(mul), "m"(rshift)                               \
+        : XMM_CLOBBERS("xmm0", "xmm1", "xmm2", "xmm5", "xmm6", "xmm7",)    \
+          "memory");                                                       \
+}
+
+DITHER_FUNC(dither_to8_sse2,         uint8_t,  NO_BSWAP, STORE8,  NO_BSWAP)
+DITHER_FUNC(dither_to8_ibswap_sse2,   uint8_t,  BSWAP_W,  STORE8,  NO_BSWAP)
+DITHER_FUNC(dither_to16_sse2,        uint16_t, NO_BSWAP, STORE16, NO_BSWAP)
+DITHER_FUNC(dither_to16_ibswap_sse2,  uint16_t, BSWAP_W,  STORE16, NO_BSWAP)
+DITHER_FUNC(dither_to16_obswap_sse2, uint16_t, NO_BSWAP, STORE16, BSWAP_W)
+DITHER_FUNC(dither_to16_iobswap_sse2, uint16_t, BSWAP_W,  STORE16, BSWAP_W)
+
+#define LOAD16                                  \
+    "movdqu       (%1), %%xmm0           \n\t"  \
+    "movdqu     16(%1), %%xmm2           \n\t"  \
+    "add           $32, %1               \n\t"  \
+
+#define LOAD8                                   \
+    "movdqu       (%1), %%xmm0           \n\t"  \
+    "movdqa     %%xmm0, %%xmm2           \n\t"  \
+    "punpcklbw  %%xmm7, %%xmm0           \n\t"  \
+    "punpckhbw  %%xmm7, %%xmm2           \n\t"  \
+    "add           $16, %1               \n\t"  \
+
+/* dst = src << lshift | src >> rshift */
+#define SHIFT_FUNC(name, type, load, in, out)                               \
+static void name(uint16_t *dst, const type *src, x86_reg blocks,           \
+                 int lshift, int rshift)                                   \
+{                                                                          \
+    __asm__ volatile(                                                      \
+        "pxor       %%xmm7, %%xmm7           \n\t"                         \
+        "movd           %3, %%xmm4           \n\t"                         \
+        "movd           %4, %%xmm3           \n\t"                         \
+        ".p2align        4                   \n\t"                         \
+        "1:                                  \n\t"                         \
+        load                                                               \
+        in("0")                                                            \
+        in("2")                                                            \
+        "movdqa     %%xmm0, %%xmm5           \n\t"                         \
+        "movdqa     %%xmm2, %%xmm6           \n\t"                         \
+        "psllw      %%xmm4, %%xmm0           \n\t"                         \
+        "psllw      %%xmm4, %%xmm2           \n\t"                         \
+        "psrlw      %%xmm3, %%xmm5           \n\t"                         \
+        "psrlw      %%xmm3, %%xmm6           \n\t"                         \
+        "por        %%xmm5, %%xmm0           \n\t"                         \
+        "por        %%xmm6, %%xmm2           \n\t"                         \
+        STORE16(out)                                                       \
+        "sub            $1, %2               \n\t"                         \
+        "jnz            1b                   \n\t"                         \
+        : "+r"(dst), "+r"(src), "+r"(blocks)                               \
+        : "m"(lshift), "m"(rshift)                                         \
+        : XMM_CLOBBERS("xmm0", "xmm1", "xmm2", "xmm3",                     \
+                       "xmm4", "xmm5", "xmm6", "xmm7",)                    \
+          "memory");                                                       \
+}
+
+SHIFT_FUNC(shift16_sse2,         uint16_t, LOAD16, NO_BSWAP, NO_BSWAP)
+SHIFT_FUNC(shift16_ibswap_sse2,   uint16_t, LOAD16, BSWAP_W,  NO_BSWAP)
+SHIFT_FUNC(shift16_obswap_sse2,  uint16_t, LOAD16, NO_BSWAP, BSWAP_W)
+SHIFT_FUNC(shift16_iobswap_sse2,  uint16_t, LOAD16, BSWAP_W,  BSWAP_W)
+SHIFT_FUNC(shift8_sse2,          uint8_t,  LOAD8,  NO_BSWAP, NO_BSWAP)
+SHIFT_FUNC(shift8_obswap_sse2,   uint8_t,  LOAD8,  NO_BSWAP, BSWAP_W)
+
+/* the kernels compute (x * scale) >> shift as a pmulhuw followed by a
+ * shift, this is exact as long as the multiplier fits in 16 bits */
+static void dither_params(int scale, int shift, int *mul, int *rshift)
+{
+    if (shift >= 16) {
+        *mul    = scale;
+        *rshift = shift - 16;
+    } else {
+        *mul    = scale << (16 - shift);
+        *rshift = 0;
+    }
+}
+
+static void dither_copy8_sse2(uint8_t *dst, const uint16_t *src, int width,
+                              const uint8_t *dither, int scale, int shift,
+                              int src_bswap)
+{
+    x86_reg blocks = width >> 4;
+    int j, mul, rshift;
+
+    dither_params(scale, shift, &mul, &rshift);
+    if (blocks && mul < 0x10000) {
+        if (src_bswap)
+            dither_to8_ibswap_sse2(dst, src, blocks, dither, mul, rshift);
+        else
+            dither_to8_sse2(dst, src, blocks, dither, mul, rshift);
+    } else
+        blocks = 0;
+
+    for (j = blocks << 4; j < width; j++) {
+        unsigned v = src_bswap ? av_bswap16(src[j]) : src[j];
+        dst[j] = (v + dither[j & 7]) * scale >> shift;
+    }
+}
+
+static void dither_copy16_sse2(uint16_t *dst, const uint16_t *src, int width,
+                               const uint8_t *dither, int scale, int shift,
+                               int src_bswap, int dst_bswap)
+{
+    x86_reg blocks = width >> 4;
+    int j, mul, rshift;
+
+    dither_params(scale, shift, &mul, &rshift);
+    if (blocks && mul < 0x10000) {
+        if (src_bswap && dst_bswap)
+            dither_to16_iobswap_sse2(dst, src, blocks, dither, mul, rshift);
+        else if (src_bswap)
+            dither_to16_ibswap_sse2(dst, src, blocks, dither, mul, rshift);
+        else if (dst_bswap)
+            dither_to16_obswap_sse2(dst, src, blocks, dither, mul, rshift);
+        else
+            dither_to16_sse2(dst, src, blocks, dither, mul, rshift);
+    } else
+        blocks = 0;
+
+    for (j = blocks << 4; j < width; j++) {
+        unsigned v = src_bswap ? av_bswap16(src[j]) : src[j];
+        v = (v + dither[j & 7]) * scale >> shift;
+        dst[j] = dst_bswap ? av_bswap16(v) : v;
+    }
+}
+
+static void shift_copy16_sse2(uint16_t *dst, const uint16_t *src, int width,
+                              int lshift, int rshift, int src_bswap,
+                              int dst_bswap)
+{
+    x86_reg blocks = width >> 4;
+    int j;
+
+    if (blocks) {
+        if (src_bswap && dst_bswap)
+            shift16_iobswap_sse2(dst, src, blocks, lshift, rshift);
+        else if (src_bswap)
+            shift16_ibswap_sse2(dst, src, blocks, lshift, rshift);
+        else if (dst_bswap)
+            shift16_obswap_sse2(dst, src, blocks, lshift, rshift);
+        else
+            shift16_sse2(dst, src, blocks, lshift, rshift);
+    }
+
+    for (j = blocks << 4; j < width; j++) {
+        unsigned v = src_bswap ? av_bswap16(src[j]) : src[j];
+        v = (v << lshift | v >> rshift) & 0xFFFF;
+        dst[j] = dst_bswap ? av_bswap16(v) : v;
+    }
+}
+
+static void shift_copy8to16_sse2(uint16_t *dst, const uint8_t *src, int width,
+                                 int lshift, int rshift, int dst_bswap)
+{
+    x86_reg blocks = width >> 4;
+    int j;
+
+    if (blocks) {
+        if (dst_bswap)
+            shift8_obswap_sse2(dst, src, blocks, lshift, rshift);
+        else
+            shift8_sse2(dst, src, blocks, lshift, rshift);
+    }
+
+    for (j = blocks << 4; j < width; j++) {
+        unsigned v = (src[j] << lshift | src[j] >> rshift) & 0xFFFF;
+        dst[j] = dst_bswap ? av_bswap16(v) : v;
+    }
+}
+#endif /* HAVE_SSE2_INLINE */
+
 #endif /* HAVE_INLINE_ASM */
 
 #define SCALE_FUNC(filter_n, from_bpc, to_bpc, opt) \
@@ -578,3 +803,17 @@ switch(c->dstBpc){ \
         }
     }
 }
+
+av_cold void ff_get_unscaled_swscale_mmx(SwsContext *c)
+{
+#if HAVE_SSE2_INLINE
+    int cpu_flags = av_get_cpu_flags();
+
+    if (INLINE_SSE2(cpu_flags)) {
+        c->dither_copy8     = dither_copy8_sse2;
+        c->dither_copy16    = dither_copy16_sse2;
+        c->shift_copy16     = shift_copy16_sse2;
+        c->shift_copy8to16  = shift_copy8to16_sse2;
+    }
+#endif
+}
@@ -67,6 +67,296 @@ DECLARE_ASM_CONST(8, uint64_t, pb_07) = 0x0707070707070707ULL;
 #include "yuv2rgb_template.c"
 #endif /* HAVE_MMXEXT_INLINE */
 
+/* SSE2/SSSE3 versions, 16 pixels per iteration like the MMX ones do 8, with
+ * all the coefficients kept in xmm8-xmm15 */
+#if HAVE_SSE2_INLINE && HAVE_MMX_INLINE && ARCH_X86_64
+
+DECLARE_ASM_CONST(16, uint8_t, pb_pack24)[16] = {
+    0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, 0x80, 0x80, 0x80, 0x80
+};
+
+#define LOAD_COEFF_SSE(offset, reg)                \
+    "movq       "offset"(%4), %%"reg"\n\t"          \
+    "punpcklqdq %%"reg",     %%"reg"\n\t"          \
+
+#define YUV2RGB_LOOP_SSE(depth, fallback)                            \
+    h_size = (c->dstW + 15) & ~15;                                   \
+    if (h_size * depth > FFABS(dstStride[0]) ||                      \
+        h_size > FFABS(srcStride[0]))                                \
+        return fallback(c, src, srcStride, srcSliceY, srcSliceH,     \
+                        dst, dstStride);                             \
+                                                                     \
+    vshift = c->srcFormat != AV_PIX_FMT_YUV422P;                     \
+                                                                     \
+    for (y = 0; y < srcSliceH; y++) {                                \
+        uint8_t *image    = dst[0] + (y + srcSliceY) * dstStride[0]; \
+        const uint8_t *py = src[0] +               y * srcStride[0]; \
+        const uint8_t *pu = src[1] +   (y >> vshift) * srcStride[1]; \
+        const uint8_t *pv = src[2] +   (y >> vshift) * srcStride[2]; \
+        x86_reg index = -h_size / 2;                                 \
+
+#define YUV2RGB_INITIAL_LOAD_SSE                   \
+    __asm__ volatile (                             \
+        LOAD_COEFF_SSE(Y_OFFSET, "xmm8")           \
+        LOAD_COEFF_SSE(U_OFFSET, "xmm9")           \
+        LOAD_COEFF_SSE(V_OFFSET, "xmm10")          \
+        LOAD_COEFF_SSE(UG_COEFF, "xmm11")          \
+        LOAD_COEFF_SSE(VG_COEFF, "xmm12")          \
+        LOAD_COEFF_SSE(Y_COEFF,  "xmm13")          \
+        LOAD_COEFF_SSE(UB_COEFF, "xmm14")          \
+        LOAD_COEFF_SSE(VR_COEFF, "xmm15")          \
+        "pxor      %%xmm4, %%xmm4\n\t"              \
+        "1: \n\t"                                  \
+        "movdqu (%5, %0, 2), %%xmm6\n\t"            \
+        "movq      (%2, %0), %%xmm0\n\t"            \
+        "movq      (%3, %0), %%xmm1\n\t"            \
+
+/* same as YUV2RGB, on xmm registers
+ * Output: xmm1 - R, xmm2 - G, xmm0 - B after RGB_PACK_INTERLEAVE_SSE */
+#define YUV2RGB_SSE                              \
+    "movdqa    %%xmm6,  %%xmm7\n\t"               \
+    "punpcklbw %%xmm4,  %%xmm0\n\t"               \
+    "punpcklbw %%xmm4,  %%xmm1\n\t"               \
+    "psllw     $8,      %%xmm6\n\t"               \
+    "psrlw     $8,      %%xmm7\n\t"               \
+    "psrlw     $8,      %%xmm6\n\t"               \
+    "psllw     $3,      %%xmm0\n\t"               \
+    "psllw     $3,      %%xmm1\n\t"               \
+    "psllw     $3,      %%xmm6\n\t"               \
+    "psllw     $3,      %%xmm7\n\t"               \
+    "psubsw    %%xmm9,  %%xmm0\n\t"               \
+    "psubsw    %%xmm10, %%xmm1\n\t"               \
+    "psubw     %%xmm8,  %%xmm6\n\t"               \
+    "psubw     %%xmm8,  %%xmm7\n\t"               \
+    "movdqa    %%xmm0,  %%xmm2\n\t"               \
+    "movdqa    %%xmm1,  %%xmm3\n\t"               \
+    "pmulhw    %%xmm11, %%xmm2\n\t"               \
+    "pmulhw    %%xmm12, %%xmm3\n\t"               \
+    "pmulhw    %%xmm13, %%xmm6\n\t"               \
+    "pmulhw    %%xmm13, %%xmm7\n\t"               \
+    "pmulhw    %%xmm14, %%xmm0\n\t"               \
+    "pmulhw    %%xmm15, %%xmm1\n\t"               \
+    "paddsw    %%xmm3,  %%xmm2\n\t"               \
+    "movdqa    %%xmm7,  %%xmm3\n\t"               \
+    "movdqa    %%xmm7,  %%xmm5\n\t"               \
+    "paddsw    %%xmm0,  %%xmm3\n\t"               \
+    "paddsw    %%xmm1,  %%xmm5\n\t"               \
+    "paddsw    %%xmm2,  %%xmm7\n\t"               \
+    "paddsw    %%xmm6,  %%xmm0\n\t"               \
+    "paddsw    %%xmm6,  %%xmm1\n\t"               \
+    "paddsw    %%xmm6,  %%xmm2\n\t"               \
+
+#define RGB_PACK_INTERLEAVE_SSE                  \
+    "packuswb  %%xmm1,  %%xmm0\n\t"               \
+    "packuswb  %%xmm5,  %%xmm3\n\t"               \
+    "packuswb  %%xmm2,  %%xmm2\n\t"               \
+    "movdqa    %%xmm0,  %%xmm1\n\t"               \
+    "packuswb  %%xmm7,  %%xmm7\n\t"               \
+    "punpcklbw %%xmm3,  %%xmm0\n\t"               \
+    "punpckhbw %%xmm3,  %%xmm1\n\t"               \
+    "punpcklbw %%xmm7,  %%xmm2\n\t"               \
+
+/* interleave to 4 registers of 4 32-bit pixels: blue, green, xmm5, alpha */
+#define RGB_INTERLEAVE32_SSE(red, green, blue, alpha) \
+    "movdqa    %%xmm"blue",  %%xmm5\n\t"          \
+    "movdqa    %%xmm"red",   %%xmm6\n\t"          \
+    "punpckhbw %%xmm"green", %%xmm5\n\t"          \
+    "punpcklbw %%xmm"green", %%xmm"blue"\n\t"     \
+    "punpckhbw %%xmm"alpha", %%xmm6\n\t"          \
+    "punpcklbw %%xmm"alpha", %%xmm"red"\n\t"      \
+    "movdqa    %%xmm"blue",  %%xmm"green"\n\t"    \
+    "movdqa    %%xmm5,       %%xmm"alpha"\n\t"    \
+    "punpcklwd %%xmm"red",   %%xmm"blue"\n\t"     \
+    "punpckhwd %%xmm"red",   %%xmm"green"\n\t"    \
+    "punpcklwd %%xmm6,       %%xmm5\n\t"          \
+    "punpckhwd %%xmm6,       %%xmm"alpha"\n\t"    \
+
+#define RGB_PACK32_SSE(red, green, blue, alpha)  \
+    RGB_INTERLEAVE32_SSE(red, green, blue, alpha) \
+    "movdqu    %%xmm"blue",   0(%1)\n\t"         \
+    "movdqu    %%xmm"green", 16(%1)\n\t"         \
+    "movdqu    %%xmm5,       32(%1)\n\t"         \
+    "movdqu    %%xmm"alpha", 48(%1)\n\t"         \
+
+/* drop the 4th byte of each pixel and store the 48 remaining ones */
+#define RGB_PACK24_SSSE3(red, blue)                           \
+    RGB_INTERLEAVE32_SSE(red, REG_GREEN, blue, REG_ALPHA)     \
+    "pshufb "MANGLE(pb_pack24)", %%xmm"blue"\n\t"             \
+    "pshufb "MANGLE(pb_pack24)", %%xmm"REG_GREEN"\n\t"        \
+    "pshufb "MANGLE(pb_pack24)", %%xmm5\n\t"                  \
+    "pshufb "MANGLE(pb_pack24)", %%xmm"REG_ALPHA"\n\t"        \
+    "movdqa    %%xmm"REG_GREEN", %%xmm6\n\t"                  \
+    "pslldq    $12,              %%xmm6\n\t"                  \
+    "por       %%xmm6,           %%xmm"blue"\n\t"             \
+    "psrldq    $4,               %%xmm"REG_GREEN"\n\t"        \
+    "movdqa    %%xmm5,           %%xmm6\n\t"                  \
+    "pslldq    $8,               %%xmm6\n\t"                  \
+    "por       %%xmm6,           %%xmm"REG_GREEN"\n\t"        \
+    "psrldq    $8,               %%xmm5\n\t"                  \
+    "pslldq    $4,               %%xmm"REG_ALPHA"\n\t"        \
+    "por       %%xmm"REG_ALPHA", %%xmm5\n\t"                  \
+    "movdqu    %%xmm"blue",       0(%1)\n\t"                  \
+    "movdqu    %%xmm"REG_GREEN", 16(%1)\n\t"                  \
+    "movdqu    %%xmm5,           32(%1)\n\t"                  \
+
+#define YUV2RGB_ENDLOOP_SSE(depth)               \
+    "add $"AV_STRINGIFY(depth * 16)", %1\n\t"    \
+    "add  $8, %0\n\t"                            \
+    "js   1b\n\t"                                \
+
+#define XMM_CLOBBERS_YUV2RGB                                        \
+    XMM_CLOBBERS("xmm0",  "xmm1",  "xmm2",  "xmm3",  "xmm4",  "xmm5",  \
+                 "xmm6",  "xmm7",  "xmm8",  "xmm9",  "xmm10", "xmm11", \
+                 "xmm12", "xmm13", "xmm14", "xmm15",)
+
+#define YUV2RGB_OPERANDS_SSE                                      \
+        : "+r" (index), "+r" (image)                              \
+        : "r" (pu - index), "r" (pv - index), "r"(&c->redDither), \
+          "r" (py - 2*index)                                      \
+        : XMM_CLOBBERS_YUV2RGB "memory"                           \
+        );                                                        \
+    }                                                             \
+
+#define YUV2RGB_OPERANDS_ALPHA_SSE                                \
+        : "+r" (index), "+r" (image)                              \
+        : "r" (pu - index), "r" (pv - index), "r"(&c->redDither), \
+          "r" (py - 2*index), "r" (pa - 2*index)                  \
+        : XMM_CLOBBERS_YUV2RGB "memory"                           \
+        );                                                        \
+    }                                                             \
+
+#define SET_EMPTY_ALPHA_SSE                                              \
+    "pcmpeqd   %%xmm"REG_ALPHA", %%xmm"REG_ALPHA"\n\t" /* set alpha to 0xFF */ \
+
+#define LOAD_ALPHA_SSE                                   \
+    "movdqu    (%6, %0, 2),     %%xmm"REG_ALPHA"\n\t"      \
+
+static inline int yuv420_rgb32_SSE2(SwsContext *c, const uint8_t *src[],
+                                    int srcStride[],
+                                    int srcSliceY, int srcSliceH,
+                                    uint8_t *dst[], int dstStride[])
+{
+    int y, h_size, vshift;
+
+    YUV2RGB_LOOP_SSE(4, yuv420_rgb32_MMX)
+
+        YUV2RGB_INITIAL_LOAD_SSE
+        YUV2RGB_SSE
+        RGB_PACK_INTERLEAVE_SSE
+        SET_EMPTY_ALPHA_SSE
+        RGB_PACK32_SSE(REG_RED, REG_GREEN, REG_BLUE, REG_ALPHA)
+
+    YUV2RGB_ENDLOOP_SSE(4)
+    YUV2RGB_OPERANDS_SSE
+    return srcSliceH;
+}
+
+static inline int yuv420_bgr32_SSE2(SwsContext *c, const uint8_t *src[],
+                                    int srcStride[],
+                                    int srcSliceY, int srcSliceH,
+                                    uint8_t *dst[], int dstStride[])
+{
+    int y, h_size, vshift;
+
+    YUV2RGB_LOOP_SSE(4, yuv420_bgr32_MMX)
+
+        YUV2RGB_INITIAL_LOAD_SSE
+        YUV2RGB_SSE
+        RGB_PACK_INTERLEAVE_SSE
+        SET_EMPTY_ALPHA_SSE
+        RGB_PACK32_SSE(REG_BLUE, REG_GREEN, REG_RED, REG_ALPHA)
+
+    YUV2RGB_ENDLOOP_SSE(4)
+    YUV2RGB_OPERANDS_SSE
+    return srcSliceH;
+}
+
+#if CONFIG_SWSCALE_ALPHA
+static inline int yuva420_rgb32_SSE2(SwsContext *c, const uint8_t *src[],
+                                     int srcStride[],
+                                     int srcSliceY, int srcSliceH,
+                                     uint8_t *dst[], int dstStride[])
+{
+    int y, h_size, vshift;
+
+    YUV2RGB_LOOP_SSE(4, yuva420_rgb32_MMX)
+
+        const uint8_t *pa = src[3] + y * srcStride[3];
+        YUV2RGB_INITIAL_LOAD_SSE
+        YUV2RGB_SSE
+        RGB_PACK_INTERLEAVE_SSE
+        LOAD_ALPHA_SSE
+        RGB_PACK32_SSE(REG_RED, REG_GREEN, REG_BLUE, REG_ALPHA)
+
+    YUV2RGB_ENDLOOP_SSE(4)
+    YUV2RGB_OPERANDS_ALPHA_SSE
+    return srcSliceH;
+}
+
+static inline int yuva420_bgr32_SSE2(SwsContext *c, const uint8_t *src[],
+                                     int srcStride[],
+                                     int srcSliceY, int srcSliceH,
+                                     uint8_t *dst[], int dstStride[])
+{
+    int y, h_size, vshift;
+
+    YUV2RGB_LOOP_SSE(4, yuva420_bgr32_MMX)
+
+        const uint8_t *pa = src[3] + y * srcStride[3];
+        YUV2RGB_INITIAL_LOAD_SSE
+        YUV2RGB_SSE
+        RGB_PACK_INTERLEAVE_SSE
+        LOAD_ALPHA_SSE
+        RGB_PACK32_SSE(REG_BLUE, REG_GREEN, REG_RED, REG_ALPHA)
+
+    YUV2RGB_ENDLOOP_SSE(4)
+    YUV2RGB_OPERANDS_ALPHA_SSE
+    return srcSliceH;
+}
+#endif /* CONFIG_SWSCALE_ALPHA */
+
+#if HAVE_SSSE3_INLINE
+static inline int yuv420_rgb24_SSSE3(SwsContext *c, const uint8_t *src[],
+                                     int srcStride[],
+                                     int srcSliceY, int srcSliceH,
+                                     uint8_t *dst[], int dstStride[])
+{
+    int y, h_size, vshift;
+
+    YUV2RGB_LOOP_SSE(3, yuv420_rgb24_MMX)
+
+        YUV2RGB_INITIAL_LOAD_SSE
+        YUV2RGB_SSE
+        RGB_PACK_INTERLEAVE_SSE
+        RGB_PACK24_SSSE3(REG_BLUE, REG_RED)
+
+    YUV2RGB_ENDLOOP_SSE(3)
+    YUV2RGB_OPERANDS_SSE
+    return srcSliceH;
+}
+
+static inline int yuv420_bgr24_SSSE3(SwsContext *c, const uint8_t *src[],
+                                     int srcStride[],
+                                     int srcSliceY, int srcSliceH,
+                                     uint8_t *dst[], int dstStride[])
+{
+    int y, h_size, vshift;
+
+    YUV2RGB_LOOP_SSE(3, yuv420_bgr24_MMX)
+
+        YUV2RGB_INITIAL_LOAD_SSE
+        YUV2RGB_SSE
+        RGB_PACK_INTERLEAVE_SSE
+        RGB_PACK24_SSSE3(REG_RED, REG_BLUE)
+
+    YUV2RGB_ENDLOOP_SSE(3)
+    YUV2RGB_OPERANDS_SSE
+    return srcSliceH;
+}
+#endif /* HAVE_SSSE3_INLINE */
+
+#endif /* HAVE_SSE2_INLINE && HAVE_MMX_INLINE && ARCH_X86_64 */
+
 #endif /* HAVE_INLINE_ASM */
 
 av_cold SwsFunc ff_yuv2rgb_init_mmx(SwsContext *c)
@@ -74,6 +364,38 @@ av_cold SwsFunc ff_yuv2rgb_init_mmx(SwsContext *c)
 #if HAVE_INLINE_ASM
     int cpu_flags = av_get_cpu_flags();
 
+#if HAVE_SSE2_INLINE && HAVE_MMX_INLINE && ARCH_X86_64
+#if HAVE_SSSE3_INLINE
+    if (cpu_flags & AV_CPU_FLAG_SSSE3) {
+        switch (c->dstFormat) {
+        case AV_PIX_FMT_RGB24:
+            return yuv420_rgb24_SSSE3;
+        case AV_PIX_FMT_BGR24:
+            return yuv420_bgr24_SSSE3;
+        }
+    }
+#endif
+
+    if (cpu_flags & AV_CPU_FLAG_SSE2) {
+        switch (c->dstFormat) {
+        case AV_PIX_FMT_RGB32:
+            if (c->srcFormat == AV_PIX_FMT_YUVA420P) {
+#if CONFIG_SWSCALE_ALPHA
+                return yuva420_rgb32_SSE2;
+#endif
+                break;
+            } else return yuv420_rgb32_SSE2;
+        case AV_PIX_FMT_BGR32:
+            if (c->srcFormat == AV_PIX_FMT_YUVA420P) {
+#if CONFIG_SWSCALE_ALPHA
+                return yuva420_bgr32_SSE2;
+#endif
+                break;
+            } else return yuv420_bgr32_SSE2;
+        }
+    }
+#endif
+
 #if HAVE_MMXEXT_INLINE
     if (cpu_flags & AV_CPU_FLAG_MMXEXT) {
         switch (c->dstFormat) {
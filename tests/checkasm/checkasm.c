@@ -0,0 +1,420 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "checkasm.h"
+#include "libavutil/avstring.h"
+#include "libavutil/common.h"
+#include "libavutil/cpu.h"
+#include "libavutil/intfloat.h"
+#include "libavutil/mem.h"
+
+#undef printf
+#undef fprintf
+
+static const struct {
+    const char *name;
+    void (*func)(void);
+} tests[] = {
+#if CONFIG_AVCODEC
+#if CONFIG_DCA_DECODER
+    { "dcadsp",      checkasm_check_dcadsp },
+#endif
+#if CONFIG_DPX_DECODER
+    { "dpxdsp",      checkasm_check_dpxdsp },
+#endif
+#if CONFIG_DSPUTIL
+    { "dsputil",     checkasm_check_dsputil },
+#endif
+    { "fmtconvert",  checkasm_check_fmtconvert },
+#if CONFIG_H264DSP
+    { "h264dsp",     checkasm_check_h264dsp },
+#endif
+#if CONFIG_H264QPEL
+    { "h264qpel",    checkasm_check_h264qpel },
+#endif
+#if CONFIG_HPELDSP
+    { "hpeldsp",     checkasm_check_hpeldsp },
+#endif
+#if CONFIG_V210_ENCODER
+    { "v210enc",     checkasm_check_v210enc },
+#endif
+#if CONFIG_VP8_DECODER
+    { "vp8dsp",      checkasm_check_vp8dsp },
+#endif
+#endif
+    { "float_dsp",   checkasm_check_float_dsp },
+#if CONFIG_SWRESAMPLE
+    { "swresample",  checkasm_check_swresample },
+#endif
+#if CONFIG_SWSCALE
+    { "swscale",     checkasm_check_swscale },
+#endif
+};
+
+/* Each set adds its flag to all the previous ones */
+static const struct {
+    const char *suffix;
+    int flag;
+} cpus[] = {
+    { "c",        0 },
+#if   ARCH_ARM
+    { "armv5te",  AV_CPU_FLAG_ARMV5TE },
+    { "armv6",    AV_CPU_FLAG_ARMV6 },
+    { "armv6t2",  AV_CPU_FLAG_ARMV6T2 },
+    { "vfp",      AV_CPU_FLAG_VFP },
+    { "vfpv3",    AV_CPU_FLAG_VFPV3 },
+    { "neon",     AV_CPU_FLAG_NEON },
+#elif ARCH_PPC
+    { "altivec",  AV_CPU_FLAG_ALTIVEC },
+#elif ARCH_X86
+    { "mmx",      AV_CPU_FLAG_MMX },
+    { "mmxext",   AV_CPU_FLAG_MMXEXT },
+    { "3dnow",    AV_CPU_FLAG_3DNOW },
+    { "3dnowext", AV_CPU_FLAG_3DNOWEXT },
+    { "sse",      AV_CPU_FLAG_SSE },
+    { "sse2",     AV_CPU_FLAG_SSE2 },
+    { "sse3",     AV_CPU_FLAG_SSE3 },
+    { "ssse3",    AV_CPU_FLAG_SSSE3 },
+    { "sse4",     AV_CPU_FLAG_SSE4 },
+    { "sse42",    AV_CPU_FLAG_SSE42 },
+    { "avx",      AV_CPU_FLAG_AVX },
+    { "xop",      AV_CPU_FLAG_XOP },
+    { "fma4",     AV_CPU_FLAG_FMA4 },
+    { "fma3",     AV_CPU_FLAG_FMA3 },
+    { "avx2",     AV_CPU_FLAG_AVX2 },
+#endif
+};
+
+/* Flags describing the host rather than an instruction set, kept in all
+ * the sets */
+#if ARCH_X86
+#define QUIRK_FLAGS (AV_CPU_FLAG_SSE2SLOW | AV_CPU_FLAG_SSE3SLOW | \
+                     AV_CPU_FLAG_ATOM | AV_CPU_FLAG_CMOV)
+#else
+#define QUIRK_FLAGS 0
+#endif
+
+typedef struct CheckasmFuncVersion {
+    struct CheckasmFuncVersion *next;
+    void *func;
+    int ok;
+    int cpu;
+    int iterations;
+    uint64_t cycles;
+} CheckasmFuncVersion;
+
+typedef struct CheckasmFunc {
+    struct CheckasmFunc *next;
+    CheckasmFuncVersion versions;
+    int nb_versions;
+    char name[64];
+} CheckasmFunc;
+
+static struct {
+    CheckasmFunc *funcs, **funcs_tail;
+    CheckasmFunc *current_func;
+    CheckasmFuncVersion *current_func_ver;
+    const char *current_test_name;
+    int cpu;
+    int cpu_flag;
+    int bench;
+    const char *test_name;
+    int num_checked;
+    int num_failed;
+    unsigned int seed;
+} state;
+
+AVLFG checkasm_lfg;
+
+int checkasm_float_near_ulp(float a, float b, unsigned max_ulp)
+{
+    union av_intfloat32 x, y;
+
+    x.f = a;
+    y.f = b;
+
+    if (signbit(a) != signbit(b))
+        return a == b;
+
+    return FFABS((int32_t)(x.i - y.i)) <= max_ulp;
+}
+
+int checkasm_float_near_abs_eps(float a, float b, float eps)
+{
+    return fabsf(a - b) <= eps;
+}
+
+static CheckasmFunc *get_func(const char *name)
+{
+    CheckasmFunc *f;
+
+    for (f = state.funcs; f; f = f->next)
+        if (!strcmp(f->name, name))
+            return f;
+
+    f = av_mallocz(sizeof(*f));
+    if (!f) {
+        fprintf(stderr, "checkasm: out of memory\n");
+        exit(1);
+    }
+    av_strlcpy(f->name, name, sizeof(f->name));
+    *state.funcs_tail = f;
+    state.funcs_tail  = &f->next;
+    return f;
+}
+
+static CheckasmFuncVersion *add_version(CheckasmFunc *f, void *func)
+{
+    CheckasmFuncVersion *v = &f->versions;
+
+    if (f->nb_versions++) {
+        while (v->next)
+            v = v->next;
+        v = v->next = av_mallocz(sizeof(*v));
+        if (!v) {
+            fprintf(stderr, "checkasm: out of memory\n");
+            exit(1);
+        }
+    }
+    v->func = func;
+    v->ok   = 1;
+    v->cpu  = state.cpu;
+    state.current_func     = f;
+    state.current_func_ver = v;
+    state.num_checked++;
+    return v;
+}
+
+void *checkasm_check_func(void *func, const char *name, ...)
+{
+    char name_buf[64];
+    CheckasmFunc *f;
+    CheckasmFuncVersion *v;
+    va_list arg;
+
+    va_start(arg, name);
+    vsnprintf(name_buf, sizeof(name_buf), name, arg);
+    va_end(arg);
+
+    state.current_func     = NULL;
+    state.current_func_ver = NULL;
+    if (!func)
+        return NULL;
+
+    f = get_func(name_buf);
+    /* The C pass is always the first one, and defines the reference */
+    if (!state.cpu) {
+        add_version(f, func);
+        return func;
+    }
+    if (!f->versions.func)
+        return NULL;
+    for (v = &f->versions; v; v = v->next)
+        if (v->func == func)
+            return NULL;
+    add_version(f, func);
+    return f->versions.func;
+}
+
+int checkasm_check_api(const char *name, ...)
+{
+    char name_buf[64];
+    va_list arg;
+
+    va_start(arg, name);
+    vsnprintf(name_buf, sizeof(name_buf), name, arg);
+    va_end(arg);
+
+    /* No way to know which code the flags changed, so every set with a
+     * new flag is tested */
+    add_version(get_func(name_buf), NULL);
+    return 1;
+}
+
+int checkasm_bench_func(void)
+{
+    return state.bench && state.current_func_ver;
+}
+
+void checkasm_fail_func(const char *msg, ...)
+{
+    if (state.current_func_ver && state.current_func_ver->ok) {
+        va_list arg;
+
+        fprintf(stderr, "   %s_%s (", state.current_func->name,
+                cpus[state.cpu].suffix);
+        va_start(arg, msg);
+        vfprintf(stderr, msg, arg);
+        va_end(arg);
+        fprintf(stderr, ")\n");
+
+        state.current_func_ver->ok = 0;
+        state.num_failed++;
+    }
+}
+
+void checkasm_update_bench(int iterations, uint64_t cycles)
+{
+    state.current_func_ver->iterations += iterations;
+    state.current_func_ver->cycles     += cycles;
+}
+
+void checkasm_report(const char *name, ...)
+{
+    static int prev_checked, prev_failed;
+
+    if (state.num_checked > prev_checked) {
+        char name_buf[64], full_name[96];
+        va_list arg;
+
+        va_start(arg, name);
+        vsnprintf(name_buf, sizeof(name_buf), name, arg);
+        va_end(arg);
+
+        snprintf(full_name, sizeof(full_name), "%s.%s",
+                 state.current_test_name, name_buf);
+        printf(" - %-40s [%s]\n", full_name,
+               state.num_failed == prev_failed ? "OK" : "FAILED");
+    }
+    prev_checked = state.num_checked;
+    prev_failed  = state.num_failed;
+}
+
+static void print_benchs(void)
+{
+    CheckasmFunc *f;
+
+    printf("\n%-44s %12s %8s\n", "function", "cycles/call", "speedup");
+    for (f = state.funcs; f; f = f->next) {
+        CheckasmFuncVersion *v;
+        double ref = 0;
+
+        for (v = &f->versions; v; v = v->next) {
+            char name[96];
+            double cycles;
+
+            if (!v->iterations)
+                continue;
+            cycles = (double)v->cycles / v->iterations;
+            if (!v->cpu)
+                ref = cycles;
+            snprintf(name, sizeof(name), "%s_%s", f->name, cpus[v->cpu].suffix);
+            if (ref > 0 && v->cpu)
+                printf("%-44s %12.1f %7.2fx%s\n", name, cycles, ref / cycles,
+                       v->ok ? "" : " FAILED");
+            else
+                printf("%-44s %12.1f%s\n", name, cycles,
+                       v->ok ? "" : "          FAILED");
+        }
+    }
+}
+
+static void free_funcs(void)
+{
+    while (state.funcs) {
+        CheckasmFunc *f = state.funcs;
+        CheckasmFuncVersion *v = f->versions.next;
+
+        while (v) {
+            CheckasmFuncVersion *next = v->next;
+            av_free(v);
+            v = next;
+        }
+        state.funcs = f->next;
+        av_free(f);
+    }
+}
+
+static void check_cpu_flag(int cpu)
+{
+    int i;
+
+    state.cpu = cpu;
+    av_force_cpu_flags(state.cpu_flag);
+    for (i = 0; i < FF_ARRAY_ELEMS(tests); i++) {
+        if (state.test_name && strcmp(state.test_name, tests[i].name))
+            continue;
+        /* the same data in every set, as the API tests compare the
+         * output of the sets */
+        av_lfg_init(&checkasm_lfg, state.seed);
+        state.current_test_name = tests[i].name;
+        tests[i].func();
+    }
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [--bench] [--test=<name>] [seed]\n", name);
+    exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+    int i, host_flags, flags = 0;
+
+    state.seed = 0x5eed;
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--bench")) {
+#ifdef AV_READ_TIME
+            state.bench = 1;
+#else
+            fprintf(stderr, "checkasm: no timer available on this platform\n");
+            return 1;
+#endif
+        } else if (!strncmp(argv[i], "--test=", 7)) {
+            state.test_name = argv[i] + 7;
+        } else if (argv[i][0] >= '0' && argv[i][0] <= '9') {
+            state.seed = strtoul(argv[i], NULL, 10);
+        } else {
+            usage(argv[0]);
+        }
+    }
+
+    state.funcs_tail = &state.funcs;
+
+    host_flags = av_get_cpu_flags();
+    for (i = 0; i < FF_ARRAY_ELEMS(cpus); i++) {
+        flags |= cpus[i].flag;
+        /* skip the sets that would test the same code as the previous one */
+        if (i && !(host_flags & cpus[i].flag))
+            continue;
+        state.cpu_flag = (flags & host_flags) | (host_flags & QUIRK_FLAGS);
+        if (!i)
+            state.cpu_flag = 0;
+        printf("%s:\n", cpus[i].suffix);
+        check_cpu_flag(i);
+    }
+    av_force_cpu_flags(-1);
+
+    if (state.num_failed)
+        fprintf(stderr, "checkasm: %d of %d functions FAILED (seed %u)\n",
+                state.num_failed, state.num_checked, state.seed);
+    else
+        printf("checkasm: all %d functions tested OK\n", state.num_checked);
+    if (state.bench)
+        print_benchs();
+    free_funcs();
+
+    return !!state.num_failed;
+}
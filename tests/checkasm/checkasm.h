@@ -0,0 +1,130 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * checkasm: test the optimized DSP functions against the C ones and
+ * measure their speed.
+ *
+ * The tests are run once per CPU flag set, starting with the C functions
+ * alone and adding one instruction set at a time. A test initializes its
+ * DSP context and calls check_func() for each function pointer; that
+ * returns the C version of the function if the pointer changed since the
+ * previous set, so the test should call both and compare the results:
+ *
+ *     declare_func(void, uint8_t *dst, const uint8_t *src, int len);
+ *
+ *     if (check_func(c.func, "func")) {
+ *         call_ref(dst0, src, len);
+ *         call_new(dst1, src, len);
+ *         if (memcmp(dst0, dst1, len))
+ *             fail();
+ *         bench_new(dst1, src, len);
+ *     }
+ *     report("func");
+ */
+
+#ifndef TESTS_CHECKASM_CHECKASM_H
+#define TESTS_CHECKASM_CHECKASM_H
+
+#include <stdint.h>
+
+#include "config.h"
+#include "libavutil/attributes.h"
+#include "libavutil/lfg.h"
+#include "libavutil/timer.h"
+
+void checkasm_check_dcadsp(void);
+void checkasm_check_dpxdsp(void);
+void checkasm_check_dsputil(void);
+void checkasm_check_float_dsp(void);
+void checkasm_check_fmtconvert(void);
+void checkasm_check_h264dsp(void);
+void checkasm_check_h264qpel(void);
+void checkasm_check_hpeldsp(void);
+void checkasm_check_swresample(void);
+void checkasm_check_swscale(void);
+void checkasm_check_v210enc(void);
+void checkasm_check_vp8dsp(void);
+
+void *checkasm_check_func(void *func, const char *name, ...) av_printf_format(2, 3);
+int checkasm_check_api(const char *name, ...) av_printf_format(1, 2);
+int checkasm_bench_func(void);
+void checkasm_fail_func(const char *msg, ...) av_printf_format(1, 2);
+void checkasm_update_bench(int iterations, uint64_t cycles);
+void checkasm_report(const char *name, ...) av_printf_format(1, 2);
+
+int checkasm_float_near_ulp(float a, float b, unsigned max_ulp);
+int checkasm_float_near_abs_eps(float a, float b, float eps);
+
+extern AVLFG checkasm_lfg;
+#define rnd() av_lfg_get(&checkasm_lfg)
+
+static av_unused void *func_ref, *func_new;
+
+/* Declare the type of the function being tested */
+#define declare_func(ret, ...) typedef ret func_type(__VA_ARGS__)
+
+/* Return the C version of func if func is to be tested, NULL otherwise */
+#define check_func(func, ...) \
+    (func_ref = checkasm_check_func((func_new = func), __VA_ARGS__))
+
+/* Return nonzero if code reached through a public API is to be tested, for
+ * modules whose optimized functions are not reachable through a context */
+#define check_api(...) checkasm_check_api(__VA_ARGS__)
+
+#define call_ref(...) ((func_type *)func_ref)(__VA_ARGS__)
+#define call_new(...) ((func_type *)func_new)(__VA_ARGS__)
+
+/* Mark the function being tested as failing */
+#define fail() checkasm_fail_func("%s:%d", __FILE__, __LINE__)
+
+/* Print the results of the functions tested since the previous report */
+#define report checkasm_report
+
+#ifdef AV_READ_TIME
+/* Benchmark a call, discarding the runs taking more than four times the
+ * average as interrupted */
+#define BENCH_RUNS 1000
+#define bench_call(func, ...)                                               \
+    do {                                                                    \
+        if (checkasm_bench_func()) {                                        \
+            uint64_t tsum = 0;                                              \
+            int ti, tcount = 0;                                             \
+            for (ti = 0; ti < BENCH_RUNS; ti++) {                           \
+                uint64_t t = AV_READ_TIME();                                \
+                func(__VA_ARGS__);                                          \
+                func(__VA_ARGS__);                                          \
+                func(__VA_ARGS__);                                          \
+                func(__VA_ARGS__);                                          \
+                t = AV_READ_TIME() - t;                                     \
+                if (t * tcount <= tsum * 4 && ti > 0) {                     \
+                    tsum += t;                                              \
+                    tcount++;                                               \
+                }                                                           \
+            }                                                               \
+            checkasm_update_bench(tcount * 4, tsum);                        \
+        }                                                                   \
+    } while (0)
+#else
+#define bench_call(func, ...) while (0)
+#endif
+
+#define bench_new(...) bench_call(((func_type *)func_new), __VA_ARGS__)
+
+#endif /* TESTS_CHECKASM_CHECKASM_H */
@@ -0,0 +1,121 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <string.h>
+
+#include "checkasm.h"
+#include "libavcodec/dcadsp.h"
+#include "libavcodec/fft.h"
+#include "libavcodec/synth_filter.h"
+#include "libavutil/internal.h"
+#include "libavutil/mem.h"
+
+static void randomize_float(float *buf, int len)
+{
+    int i;
+
+    for (i = 0; i < len; i++)
+        buf[i] = (float)rnd() / UINT32_MAX - 0.5f;
+}
+
+static void check_lfe_fir(void)
+{
+    LOCAL_ALIGNED_16(float, coefs, [256]);
+    LOCAL_ALIGNED_16(float, in,    [8]);
+    LOCAL_ALIGNED_16(float, out0,  [128]);
+    LOCAL_ALIGNED_16(float, out1,  [128]);
+    DCADSPContext c;
+    int i;
+    declare_func(void, float *out, const float *in, const float *coefs,
+                 int decifactor, float scale);
+
+    ff_dcadsp_init(&c);
+
+    for (i = 0; i < 2; i++) {
+        int decifactor = i ? 32 : 64;
+
+        if (check_func(c.lfe_fir, "dca_lfe_fir%d", decifactor)) {
+            float scale = (float)rnd() / UINT32_MAX * 4;
+
+            randomize_float(coefs, 256);
+            randomize_float(in, 8);
+            call_ref(out0, in + 7, coefs, decifactor, scale);
+            call_new(out1, in + 7, coefs, decifactor, scale);
+            if (memcmp(out0, out1, 2 * decifactor * sizeof(*out0)))
+                fail();
+            bench_new(out1, in + 7, coefs, decifactor, scale);
+        }
+    }
+    report("lfe_fir");
+}
+
+static void check_synth_filter(void)
+{
+    LOCAL_ALIGNED_16(float, window,   [512]);
+    LOCAL_ALIGNED_16(float, in,       [32]);
+    LOCAL_ALIGNED_16(float, out0,     [32]);
+    LOCAL_ALIGNED_16(float, out1,     [32]);
+    LOCAL_ALIGNED_16(float, buf0,     [512]);
+    LOCAL_ALIGNED_16(float, buf1,     [512]);
+    LOCAL_ALIGNED_16(float, buf2_0,   [32]);
+    LOCAL_ALIGNED_16(float, buf2_1,   [32]);
+    SynthFilterContext c;
+    FFTContext imdct;
+    declare_func(void, FFTContext *imdct,
+                 float *synth_buf_ptr, int *synth_buf_offset,
+                 float synth_buf2[32], const float window[512],
+                 float out[32], const float in[32], float scale);
+
+    ff_synth_filter_init(&c);
+    if (ff_mdct_init(&imdct, 6, 1, 1.0) < 0)
+        return;
+
+    if (check_func(c.synth_filter_float, "synth_filter_float")) {
+        float scale = (float)rnd() / UINT32_MAX * 4;
+        int i, offset0 = 0, offset1 = 0;
+
+        randomize_float(window, 512);
+        randomize_float(buf0, 512);
+        randomize_float(buf2_0, 32);
+        memcpy(buf1, buf0, 512 * sizeof(*buf0));
+        memcpy(buf2_1, buf2_0, 32 * sizeof(*buf2_0));
+
+        /* go around the whole history, so that it wraps at each offset */
+        for (i = 0; i < 16; i++) {
+            randomize_float(in, 32);
+            call_ref(&imdct, buf0, &offset0, buf2_0, window, out0, in, scale);
+            call_new(&imdct, buf1, &offset1, buf2_1, window, out1, in, scale);
+            if (offset0 != offset1 ||
+                memcmp(out0, out1, 32 * sizeof(*out0)) ||
+                memcmp(buf0, buf1, 512 * sizeof(*buf0)) ||
+                memcmp(buf2_0, buf2_1, 32 * sizeof(*buf2_0))) {
+                fail();
+                break;
+            }
+        }
+        bench_new(&imdct, buf1, &offset1, buf2_1, window, out1, in, scale);
+    }
+    ff_mdct_end(&imdct);
+    report("synth_filter");
+}
+
+void checkasm_check_dcadsp(void)
+{
+    check_lfe_fir();
+    check_synth_filter();
+}
@@ -0,0 +1,83 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+#include <string.h>
+
+#include "checkasm.h"
+#include "libavcodec/dpxdsp.h"
+#include "libavutil/internal.h"
+#include "libavutil/mem.h"
+
+/* not a multiple of the SIMD width, to test the tails */
+#define WIDTH 67
+
+void checkasm_check_dpxdsp(void)
+{
+    LOCAL_ALIGNED_16(uint8_t, words, [WIDTH * 4]);
+    LOCAL_ALIGNED_16(uint8_t, dst0, [WIDTH * 4]);
+    LOCAL_ALIGNED_16(uint8_t, dst1, [WIDTH * 4]);
+    LOCAL_ALIGNED_16(uint16_t, planes, [3 * WIDTH]);
+    LOCAL_ALIGNED_16(uint16_t, planes0, [3 * WIDTH]);
+    LOCAL_ALIGNED_16(uint16_t, planes1, [3 * WIDTH]);
+    DPXDSPContext c;
+    int i;
+
+    ff_dpxdsp_init(&c);
+
+    for (i = 0; i < WIDTH * 4; i++)
+        words[i] = rnd();
+    /* any 16-bit values, the packing does not clip */
+    for (i = 0; i < 3 * WIDTH; i++)
+        planes[i] = rnd();
+
+    for (i = 0; i < 2; i++) {
+        const char *endian = i ? "be" : "le";
+
+        {
+            declare_func(void, const uint8_t *src, uint16_t *g, uint16_t *b,
+                         uint16_t *r, int width);
+
+            if (check_func(c.unpack_rgb10[i], "dpx_unpack_rgb10_%s", endian)) {
+                memset(planes0, 0, 3 * WIDTH * sizeof(*planes0));
+                memset(planes1, 0, 3 * WIDTH * sizeof(*planes1));
+                call_ref(words, planes0, planes0 + WIDTH, planes0 + 2 * WIDTH,
+                         WIDTH);
+                call_new(words, planes1, planes1 + WIDTH, planes1 + 2 * WIDTH,
+                         WIDTH);
+                if (memcmp(planes0, planes1, 3 * WIDTH * sizeof(*planes0)))
+                    fail();
+                bench_new(words, planes1, planes1 + WIDTH, planes1 + 2 * WIDTH,
+                          WIDTH);
+            }
+        }
+        {
+            declare_func(void, const uint16_t *g, const uint16_t *b,
+                         const uint16_t *r, uint8_t *dst, int width);
+
+            if (check_func(c.pack_rgb10[i], "dpx_pack_rgb10_%s", endian)) {
+                memset(dst0, 0, WIDTH * 4);
+                memset(dst1, 0, WIDTH * 4);
+                call_ref(planes, planes + WIDTH, planes + 2 * WIDTH, dst0, WIDTH);
+                call_new(planes, planes + WIDTH, planes + 2 * WIDTH, dst1, WIDTH);
+                if (memcmp(dst0, dst1, WIDTH * 4))
+                    fail();
+                bench_new(planes, planes + WIDTH, planes + 2 * WIDTH, dst1, WIDTH);
+            }
+        }
+    }
+    report("rgb10");
+}
@@ -0,0 +1,284 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <string.h>
+
+#include "checkasm.h"
+#include "libavcodec/avcodec.h"
+#include "libavcodec/dsputil.h"
+#include "libavutil/internal.h"
+#include "libavutil/mem.h"
+
+#define STRIDE   64
+#define BUF_SIZE (STRIDE * 17)
+
+static void randomize_buffer(uint8_t *buf, int size)
+{
+    int i;
+
+    for (i = 0; i < size; i++)
+        buf[i] = rnd();
+}
+
+static void randomize_block(int16_t *block, int size, int range)
+{
+    int i;
+
+    for (i = 0; i < size; i++)
+        block[i] = (int)(rnd() % (2 * range + 1)) - range;
+}
+
+static void check_pixels(DSPContext *c)
+{
+    LOCAL_ALIGNED_16(uint8_t, src0, [BUF_SIZE]);
+    LOCAL_ALIGNED_16(uint8_t, src1, [BUF_SIZE]);
+    LOCAL_ALIGNED_16(uint8_t, dst0, [BUF_SIZE]);
+    LOCAL_ALIGNED_16(uint8_t, dst1, [BUF_SIZE]);
+    LOCAL_ALIGNED_16(int16_t, block0, [64]);
+    LOCAL_ALIGNED_16(int16_t, block1, [64]);
+    int i;
+
+    randomize_buffer(src0, BUF_SIZE);
+    randomize_buffer(src1, BUF_SIZE);
+
+    {
+        declare_func(void, int16_t *block, const uint8_t *pixels, int line_size);
+
+        if (check_func(c->get_pixels, "get_pixels")) {
+            call_ref(block0, src0, STRIDE);
+            call_new(block1, src0, STRIDE);
+            if (memcmp(block0, block1, 64 * sizeof(*block0)))
+                fail();
+            bench_new(block1, src0, STRIDE);
+        }
+    }
+    {
+        declare_func(void, int16_t *block, const uint8_t *s1, const uint8_t *s2,
+                     int stride);
+
+        if (check_func(c->diff_pixels, "diff_pixels")) {
+            call_ref(block0, src0, src1, STRIDE);
+            call_new(block1, src0, src1, STRIDE);
+            if (memcmp(block0, block1, 64 * sizeof(*block0)))
+                fail();
+            bench_new(block1, src0, src1, STRIDE);
+        }
+    }
+    {
+        declare_func(void, const int16_t *block, uint8_t *pixels, int line_size);
+        static const char *const names[3] = {
+            "put_pixels_clamped", "put_signed_pixels_clamped",
+            "add_pixels_clamped",
+        };
+        void *funcs[3] = {
+            c->put_pixels_clamped, c->put_signed_pixels_clamped,
+            c->add_pixels_clamped,
+        };
+
+        for (i = 0; i < 3; i++) {
+            if (check_func(funcs[i], "%s", names[i])) {
+                /* out of the pixel range, to test the clamping */
+                randomize_block(block0, 64, 300);
+                randomize_buffer(dst0, BUF_SIZE);
+                memcpy(dst1, dst0, BUF_SIZE);
+                call_ref(block0, dst0, STRIDE);
+                call_new(block0, dst1, STRIDE);
+                if (memcmp(dst0, dst1, BUF_SIZE))
+                    fail();
+                bench_new(block0, dst1, STRIDE);
+            }
+        }
+    }
+    {
+        declare_func(void, int16_t *block);
+
+        if (check_func(c->clear_block, "clear_block")) {
+            randomize_block(block0, 64, 1000);
+            memcpy(block1, block0, 64 * sizeof(*block0));
+            call_ref(block0);
+            call_new(block1);
+            if (memcmp(block0, block1, 64 * sizeof(*block0)))
+                fail();
+            bench_new(block1);
+        }
+    }
+    {
+        declare_func(int, uint8_t *pix, int line_size);
+
+        if (check_func(c->pix_sum, "pix_sum")) {
+            if (call_ref(src0, STRIDE) != call_new(src0, STRIDE))
+                fail();
+            bench_new(src0, STRIDE);
+        }
+        if (check_func(c->pix_norm1, "pix_norm1")) {
+            if (call_ref(src0, STRIDE) != call_new(src0, STRIDE))
+                fail();
+            bench_new(src0, STRIDE);
+        }
+    }
+    report("pixels");
+}
+
+static void check_cmp(DSPContext *c)
+{
+    LOCAL_ALIGNED_16(uint8_t, src0, [BUF_SIZE]);
+    LOCAL_ALIGNED_16(uint8_t, src1, [BUF_SIZE]);
+    int i, j;
+    declare_func(int, void *s, uint8_t *blk1, uint8_t *blk2, int line_size,
+                 int h);
+
+    randomize_buffer(src0, BUF_SIZE);
+    randomize_buffer(src1, BUF_SIZE);
+
+    for (i = 0; i < 2; i++) {
+        int size = 16 >> i;
+        static const char *const pix_abs_names[4] = { "", "_x2", "_y2", "_xy2" };
+
+        for (j = 0; j < 4; j++) {
+            if (check_func(c->pix_abs[i][j], "pix_abs%d%s", size, pix_abs_names[j])) {
+                if (call_ref(NULL, src0, src1 + 1, STRIDE, size) !=
+                    call_new(NULL, src0, src1 + 1, STRIDE, size))
+                    fail();
+                bench_new(NULL, src0, src1 + 1, STRIDE, size);
+            }
+        }
+        if (check_func(c->sse[i], "sse%d", size)) {
+            if (call_ref(NULL, src0, src1 + 1, STRIDE, size) !=
+                call_new(NULL, src0, src1 + 1, STRIDE, size))
+                fail();
+            bench_new(NULL, src0, src1 + 1, STRIDE, size);
+        }
+        if (check_func(c->hadamard8_diff[i], "hadamard8_diff%d", size)) {
+            if (call_ref(NULL, src0, src1 + 1, STRIDE, size) !=
+                call_new(NULL, src0, src1 + 1, STRIDE, size))
+                fail();
+            bench_new(NULL, src0, src1 + 1, STRIDE, size);
+        }
+        if (check_func(c->vsad[i], "vsad%d", size)) {
+            if (call_ref(NULL, src0, src1 + 1, STRIDE, size) !=
+                call_new(NULL, src0, src1 + 1, STRIDE, size))
+                fail();
+            bench_new(NULL, src0, src1 + 1, STRIDE, size);
+        }
+        report("cmp%d", size);
+    }
+}
+
+static void check_bytes(DSPContext *c)
+{
+    LOCAL_ALIGNED_16(uint8_t, src0, [BUF_SIZE]);
+    LOCAL_ALIGNED_16(uint8_t, src1, [BUF_SIZE]);
+    LOCAL_ALIGNED_16(uint8_t, dst0, [BUF_SIZE]);
+    LOCAL_ALIGNED_16(uint8_t, dst1, [BUF_SIZE]);
+    /* not a multiple of the SIMD width, to test the tail handling */
+    const int w = BUF_SIZE - 13;
+
+    randomize_buffer(src0, BUF_SIZE);
+    randomize_buffer(src1, BUF_SIZE);
+
+    {
+        declare_func(void, uint8_t *dst, uint8_t *src, int w);
+
+        if (check_func(c->add_bytes, "add_bytes")) {
+            memcpy(dst0, src1, BUF_SIZE);
+            memcpy(dst1, src1, BUF_SIZE);
+            call_ref(dst0, src0, w);
+            call_new(dst1, src0, w);
+            if (memcmp(dst0, dst1, BUF_SIZE))
+                fail();
+            bench_new(dst1, src0, w);
+        }
+    }
+    {
+        declare_func(void, uint8_t *dst, const uint8_t *src1,
+                     const uint8_t *src2, int w);
+
+        if (check_func(c->diff_bytes, "diff_bytes")) {
+            memset(dst0, 0, BUF_SIZE);
+            memset(dst1, 0, BUF_SIZE);
+            call_ref(dst0, src0, src1 + 1, w - 1);
+            call_new(dst1, src0, src1 + 1, w - 1);
+            if (memcmp(dst0, dst1, BUF_SIZE))
+                fail();
+            bench_new(dst1, src0, src1 + 1, w - 1);
+        }
+    }
+    {
+        declare_func(void, uint32_t *dst, const uint32_t *src, int w);
+
+        if (check_func(c->bswap_buf, "bswap_buf")) {
+            memset(dst0, 0, BUF_SIZE);
+            memset(dst1, 0, BUF_SIZE);
+            call_ref((uint32_t *)dst0, (const uint32_t *)src0, w / 4);
+            call_new((uint32_t *)dst1, (const uint32_t *)src0, w / 4);
+            if (memcmp(dst0, dst1, BUF_SIZE))
+                fail();
+            bench_new((uint32_t *)dst1, (const uint32_t *)src0, w / 4);
+        }
+    }
+    {
+        declare_func(void, int32_t *dst, const int32_t *src, int32_t min,
+                     int32_t max, unsigned int len);
+
+        if (check_func(c->vector_clip_int32, "vector_clip_int32")) {
+            call_ref((int32_t *)dst0, (const int32_t *)src0, -(1 << 20), 1 << 20,
+                     BUF_SIZE / 4 & ~31);
+            call_new((int32_t *)dst1, (const int32_t *)src0, -(1 << 20), 1 << 20,
+                     BUF_SIZE / 4 & ~31);
+            if (memcmp(dst0, dst1, (BUF_SIZE / 4 & ~31) * 4))
+                fail();
+            bench_new((int32_t *)dst1, (const int32_t *)src0, -(1 << 20), 1 << 20,
+                      BUF_SIZE / 4 & ~31);
+        }
+    }
+    {
+        LOCAL_ALIGNED_16(int16_t, v1, [256]);
+        LOCAL_ALIGNED_16(int16_t, v2, [256]);
+        declare_func(int32_t, const int16_t *v1, const int16_t *v2, int len);
+
+        if (check_func(c->scalarproduct_int16, "scalarproduct_int16")) {
+            /* small enough not to overflow the sum */
+            randomize_block(v1, 256, 1024);
+            randomize_block(v2, 256, 1024);
+            if (call_ref(v1, v2, 256) != call_new(v1, v2, 256))
+                fail();
+            bench_new(v1, v2, 256);
+        }
+    }
+    report("bytes");
+}
+
+void checkasm_check_dsputil(void)
+{
+    AVCodecContext *avctx = avcodec_alloc_context3(NULL);
+    DSPContext c = { 0 };
+
+    if (!avctx)
+        return;
+    /* some optimized functions are only used if inexact results are fine */
+    avctx->flags |= CODEC_FLAG_BITEXACT;
+    ff_dsputil_static_init();
+    ff_dsputil_init(&c, avctx);
+
+    check_pixels(&c);
+    check_cmp(&c);
+    check_bytes(&c);
+
+    avcodec_close(avctx);
+    av_free(avctx);
+}
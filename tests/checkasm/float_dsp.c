@@ -0,0 +1,168 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "checkasm.h"
+#include "libavutil/float_dsp.h"
+#include "libavutil/internal.h"
+#include "libavutil/mem.h"
+
+#define LEN 256
+
+static void fill_float(float *buf, int len)
+{
+    int i;
+
+    for (i = 0; i < len; i++)
+        buf[i] = (rnd() / (float)UINT32_MAX) * 2.0f - 1.0f;
+}
+
+static void check_float(const float *a, const float *b, int len, float eps)
+{
+    int i;
+
+    for (i = 0; i < len; i++)
+        if (!checkasm_float_near_abs_eps(a[i], b[i], eps)) {
+            fail();
+            break;
+        }
+}
+
+void checkasm_check_float_dsp(void)
+{
+    LOCAL_ALIGNED(32, float, src0, [LEN]);
+    LOCAL_ALIGNED(32, float, src1, [LEN]);
+    LOCAL_ALIGNED(32, float, src2, [LEN]);
+    LOCAL_ALIGNED(32, float, dst0, [LEN]);
+    LOCAL_ALIGNED(32, float, dst1, [LEN]);
+    LOCAL_ALIGNED(32, double, dsrc, [LEN]);
+    LOCAL_ALIGNED(32, double, ddst0, [LEN]);
+    LOCAL_ALIGNED(32, double, ddst1, [LEN]);
+    AVFloatDSPContext fdsp = { 0 };
+    float mul;
+    int i;
+
+    avpriv_float_dsp_init(&fdsp, 1);
+    fill_float(src0, LEN);
+    fill_float(src1, LEN);
+    fill_float(src2, LEN);
+    for (i = 0; i < LEN; i++)
+        dsrc[i] = src0[i];
+    mul = src2[0];
+
+    {
+        declare_func(void, float *dst, const float *src0, const float *src1,
+                     int len);
+
+        if (check_func(fdsp.vector_fmul, "vector_fmul")) {
+            call_ref(dst0, src0, src1, LEN);
+            call_new(dst1, src0, src1, LEN);
+            check_float(dst0, dst1, LEN, 0);
+            bench_new(dst1, src0, src1, LEN);
+        }
+        if (check_func(fdsp.vector_fmul_reverse, "vector_fmul_reverse")) {
+            call_ref(dst0, src0, src1, LEN);
+            call_new(dst1, src0, src1, LEN);
+            check_float(dst0, dst1, LEN, 0);
+            bench_new(dst1, src0, src1, LEN);
+        }
+    }
+    {
+        declare_func(void, float *dst, const float *src, float mul, int len);
+
+        if (check_func(fdsp.vector_fmac_scalar, "vector_fmac_scalar")) {
+            memcpy(dst0, src1, LEN * sizeof(*dst0));
+            memcpy(dst1, src1, LEN * sizeof(*dst1));
+            call_ref(dst0, src0, mul, LEN);
+            call_new(dst1, src0, mul, LEN);
+            check_float(dst0, dst1, LEN, 1e-6);
+            bench_new(dst1, src0, mul, LEN);
+        }
+        if (check_func(fdsp.vector_fmul_scalar, "vector_fmul_scalar")) {
+            call_ref(dst0, src0, mul, LEN);
+            call_new(dst1, src0, mul, LEN);
+            check_float(dst0, dst1, LEN, 0);
+            bench_new(dst1, src0, mul, LEN);
+        }
+    }
+    {
+        declare_func(void, double *dst, const double *src, double mul, int len);
+
+        if (check_func(fdsp.vector_dmul_scalar, "vector_dmul_scalar")) {
+            call_ref(ddst0, dsrc, mul, LEN);
+            call_new(ddst1, dsrc, mul, LEN);
+            if (memcmp(ddst0, ddst1, LEN * sizeof(*ddst0)))
+                fail();
+            bench_new(ddst1, dsrc, mul, LEN);
+        }
+    }
+    {
+        declare_func(void, float *dst, const float *src0, const float *src1,
+                     const float *win, int len);
+
+        if (check_func(fdsp.vector_fmul_window, "vector_fmul_window")) {
+            call_ref(dst0, src0, src1, src2, LEN / 2);
+            call_new(dst1, src0, src1, src2, LEN / 2);
+            check_float(dst0, dst1, LEN, 1e-6);
+            bench_new(dst1, src0, src1, src2, LEN / 2);
+        }
+    }
+    {
+        declare_func(void, float *dst, const float *src0, const float *src1,
+                     const float *src2, int len);
+
+        if (check_func(fdsp.vector_fmul_add, "vector_fmul_add")) {
+            call_ref(dst0, src0, src1, src2, LEN);
+            call_new(dst1, src0, src1, src2, LEN);
+            check_float(dst0, dst1, LEN, 1e-6);
+            bench_new(dst1, src0, src1, src2, LEN);
+        }
+    }
+    {
+        LOCAL_ALIGNED(32, float, v2_0, [LEN]);
+        LOCAL_ALIGNED(32, float, v2_1, [LEN]);
+        declare_func(void, float *v1, float *v2, int len);
+
+        if (check_func(fdsp.butterflies_float, "butterflies_float")) {
+            memcpy(dst0, src0, LEN * sizeof(*dst0));
+            memcpy(dst1, src0, LEN * sizeof(*dst1));
+            memcpy(v2_0, src1, LEN * sizeof(*v2_0));
+            memcpy(v2_1, src1, LEN * sizeof(*v2_1));
+            call_ref(dst0, v2_0, LEN);
+            call_new(dst1, v2_1, LEN);
+            check_float(dst0, dst1, LEN, 0);
+            check_float(v2_0, v2_1, LEN, 0);
+            bench_new(dst1, v2_1, LEN);
+        }
+    }
+    {
+        declare_func(float, const float *v1, const float *v2, int len);
+
+        if (check_func(fdsp.scalarproduct_float, "scalarproduct_float")) {
+            float r0 = call_ref(src0, src1, LEN);
+            float r1 = call_new(src0, src1, LEN);
+            /* the sum may be done in a different order */
+            if (!checkasm_float_near_abs_eps(r0, r1, 1e-4))
+                fail();
+            bench_new(src0, src1, LEN);
+        }
+    }
+    report("float_dsp");
+}
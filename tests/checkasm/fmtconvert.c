@@ -0,0 +1,99 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <string.h>
+
+#include "checkasm.h"
+#include "libavcodec/avcodec.h"
+#include "libavcodec/fmtconvert.h"
+#include "libavutil/internal.h"
+#include "libavutil/mem.h"
+
+#define LEN      256
+#define CHANNELS 6
+
+void checkasm_check_fmtconvert(void)
+{
+    LOCAL_ALIGNED_16(int32_t, isrc, [LEN]);
+    LOCAL_ALIGNED_16(float, fsrc, [CHANNELS * LEN]);
+    LOCAL_ALIGNED_16(float, fdst0, [CHANNELS * LEN]);
+    LOCAL_ALIGNED_16(float, fdst1, [CHANNELS * LEN]);
+    LOCAL_ALIGNED_16(int16_t, sdst0, [CHANNELS * LEN]);
+    LOCAL_ALIGNED_16(int16_t, sdst1, [CHANNELS * LEN]);
+    const float *fsrcs[CHANNELS];
+    AVCodecContext avctx = { 0 };
+    FmtConvertContext c = { 0 };
+    int i, ch;
+
+    ff_fmt_convert_init(&c, &avctx);
+    for (i = 0; i < LEN; i++)
+        isrc[i] = (int32_t)rnd();
+    /* slightly out of the int16 range, to test the clipping */
+    for (i = 0; i < CHANNELS * LEN; i++)
+        fsrc[i] = (int)(rnd() % 80001) - 40000 + (rnd() & 0xff) / 256.0f;
+    for (ch = 0; ch < CHANNELS; ch++)
+        fsrcs[ch] = fsrc + ch * LEN;
+
+    {
+        declare_func(void, float *dst, const int32_t *src, float mul, int len);
+
+        if (check_func(c.int32_to_float_fmul_scalar, "int32_to_float_fmul_scalar")) {
+            call_ref(fdst0, isrc, 1.0f / (1 << 24), LEN);
+            call_new(fdst1, isrc, 1.0f / (1 << 24), LEN);
+            if (memcmp(fdst0, fdst1, LEN * sizeof(*fdst0)))
+                fail();
+            bench_new(fdst1, isrc, 1.0f / (1 << 24), LEN);
+        }
+    }
+    {
+        declare_func(void, int16_t *dst, const float *src, long len);
+
+        if (check_func(c.float_to_int16, "float_to_int16")) {
+            call_ref(sdst0, fsrc, LEN);
+            call_new(sdst1, fsrc, LEN);
+            if (memcmp(sdst0, sdst1, LEN * sizeof(*sdst0)))
+                fail();
+            bench_new(sdst1, fsrc, LEN);
+        }
+    }
+    for (ch = 1; ch <= CHANNELS; ch++) {
+        declare_func(void, int16_t *dst, const float **src, long len,
+                     int channels);
+
+        if (check_func(c.float_to_int16_interleave, "float_to_int16_interleave_%d", ch)) {
+            call_ref(sdst0, fsrcs, LEN, ch);
+            call_new(sdst1, fsrcs, LEN, ch);
+            if (memcmp(sdst0, sdst1, ch * LEN * sizeof(*sdst0)))
+                fail();
+            bench_new(sdst1, fsrcs, LEN, ch);
+        }
+    }
+    for (ch = 1; ch <= CHANNELS; ch++) {
+        declare_func(void, float *dst, const float **src, unsigned int len,
+                     int channels);
+
+        if (check_func(c.float_interleave, "float_interleave_%d", ch)) {
+            call_ref(fdst0, fsrcs, LEN, ch);
+            call_new(fdst1, fsrcs, LEN, ch);
+            if (memcmp(fdst0, fdst1, ch * LEN * sizeof(*fdst0)))
+                fail();
+            bench_new(fdst1, fsrcs, LEN, ch);
+        }
+    }
+    report("fmtconvert");
+}
@@ -0,0 +1,217 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <string.h>
+
+#include "checkasm.h"
+#include "libavcodec/h264dsp.h"
+#include "libavutil/common.h"
+#include "libavutil/internal.h"
+#include "libavutil/mem.h"
+
+#define STRIDE   64
+#define BUF_SIZE (STRIDE * 32)
+#define PIX_OFF  (STRIDE * 8 + 16)
+
+static void randomize_buffer(uint8_t *buf, int size)
+{
+    int i;
+
+    for (i = 0; i < size; i++)
+        buf[i] = rnd();
+}
+
+/* Pixels close enough to each other for the filters to modify them */
+static void randomize_edge(uint8_t *buf, int size)
+{
+    int i, base = 64 + rnd() % 128;
+
+    for (i = 0; i < size; i++)
+        buf[i] = base + (int)(rnd() % 17) - 8;
+}
+
+/* Coefficients small enough to keep the 16 bit intermediates exact */
+static void randomize_coeffs(int16_t *block, int size)
+{
+    int i;
+
+    memset(block, 0, size * sizeof(*block));
+    for (i = 0; i < size; i++)
+        if (!(rnd() & 3))
+            block[i] = (int)(rnd() % 511) - 255;
+}
+
+static void check_idct(void)
+{
+    LOCAL_ALIGNED_16(uint8_t, dst0, [BUF_SIZE]);
+    LOCAL_ALIGNED_16(uint8_t, dst1, [BUF_SIZE]);
+    LOCAL_ALIGNED_16(int16_t, block0, [64]);
+    LOCAL_ALIGNED_16(int16_t, block1, [64]);
+    H264DSPContext h = { { 0 } };
+    int i;
+    declare_func(void, uint8_t *dst, int16_t *block, int stride);
+
+    ff_h264dsp_init(&h, 8, 1);
+
+    for (i = 0; i < 4; i++) {
+        static const char *const names[4] = {
+            "h264_idct_add", "h264_idct8_add",
+            "h264_idct_dc_add", "h264_idct8_dc_add",
+        };
+        void (*funcs[4])(uint8_t *, int16_t *, int) = {
+            h.h264_idct_add, h.h264_idct8_add,
+            h.h264_idct_dc_add, h.h264_idct8_dc_add,
+        };
+        int size = i & 1 ? 64 : 16;
+
+        if (check_func(funcs[i], "%s", names[i])) {
+            randomize_buffer(dst0, BUF_SIZE);
+            memcpy(dst1, dst0, BUF_SIZE);
+            randomize_coeffs(block0, size);
+            memcpy(block1, block0, size * sizeof(*block0));
+            call_ref(dst0, block0, STRIDE);
+            call_new(dst1, block1, STRIDE);
+            if (memcmp(dst0, dst1, BUF_SIZE) ||
+                memcmp(block0, block1, size * sizeof(*block0)))
+                fail();
+            bench_new(dst1, block1, STRIDE);
+        }
+    }
+    report("idct");
+}
+
+static void check_loop_filter(void)
+{
+    LOCAL_ALIGNED_16(uint8_t, dst0, [BUF_SIZE]);
+    LOCAL_ALIGNED_16(uint8_t, dst1, [BUF_SIZE]);
+    int8_t tc0[4];
+    H264DSPContext h = { { 0 } };
+    int i, alpha, beta;
+
+    ff_h264dsp_init(&h, 8, 1);
+
+    for (i = 0; i < 4; i++)
+        tc0[i] = (int)(rnd() % 5) - 1;
+    alpha = 20 + rnd() % 30;
+    beta  =  8 + rnd() % 10;
+
+    {
+        declare_func(void, uint8_t *pix, int stride, int alpha, int beta,
+                     int8_t *tc0);
+        static const char *const names[4] = {
+            "h264_v_loop_filter_luma",   "h264_h_loop_filter_luma",
+            "h264_v_loop_filter_chroma", "h264_h_loop_filter_chroma",
+        };
+        void (*funcs[4])(uint8_t *, int, int, int, int8_t *) = {
+            h.h264_v_loop_filter_luma,   h.h264_h_loop_filter_luma,
+            h.h264_v_loop_filter_chroma, h.h264_h_loop_filter_chroma,
+        };
+
+        for (i = 0; i < 4; i++) {
+            if (check_func(funcs[i], "%s", names[i])) {
+                randomize_edge(dst0, BUF_SIZE);
+                memcpy(dst1, dst0, BUF_SIZE);
+                call_ref(dst0 + PIX_OFF, STRIDE, alpha, beta, tc0);
+                call_new(dst1 + PIX_OFF, STRIDE, alpha, beta, tc0);
+                if (memcmp(dst0, dst1, BUF_SIZE))
+                    fail();
+                bench_new(dst1 + PIX_OFF, STRIDE, alpha, beta, tc0);
+            }
+        }
+    }
+    {
+        declare_func(void, uint8_t *pix, int stride, int alpha, int beta);
+        static const char *const names[4] = {
+            "h264_v_loop_filter_luma_intra",   "h264_h_loop_filter_luma_intra",
+            "h264_v_loop_filter_chroma_intra", "h264_h_loop_filter_chroma_intra",
+        };
+        void (*funcs[4])(uint8_t *, int, int, int) = {
+            h.h264_v_loop_filter_luma_intra,   h.h264_h_loop_filter_luma_intra,
+            h.h264_v_loop_filter_chroma_intra, h.h264_h_loop_filter_chroma_intra,
+        };
+
+        for (i = 0; i < 4; i++) {
+            if (check_func(funcs[i], "%s", names[i])) {
+                randomize_edge(dst0, BUF_SIZE);
+                memcpy(dst1, dst0, BUF_SIZE);
+                call_ref(dst0 + PIX_OFF, STRIDE, alpha, beta);
+                call_new(dst1 + PIX_OFF, STRIDE, alpha, beta);
+                if (memcmp(dst0, dst1, BUF_SIZE))
+                    fail();
+                bench_new(dst1 + PIX_OFF, STRIDE, alpha, beta);
+            }
+        }
+    }
+    report("loop_filter");
+}
+
+static void check_weight(void)
+{
+    LOCAL_ALIGNED_16(uint8_t, src, [BUF_SIZE]);
+    LOCAL_ALIGNED_16(uint8_t, dst0, [BUF_SIZE]);
+    LOCAL_ALIGNED_16(uint8_t, dst1, [BUF_SIZE]);
+    H264DSPContext h = { { 0 } };
+    int i, log2_denom, weightd, weights, offset;
+
+    ff_h264dsp_init(&h, 8, 1);
+
+    log2_denom = rnd() % 8;
+    weightd    = (int)(rnd() % 256) - 128;
+    weights    = (int)(rnd() % 256) - 128;
+    offset     = (int)(rnd() % 256) - 128;
+    randomize_buffer(src, BUF_SIZE);
+
+    for (i = 0; i < 4; i++) {
+        int width = 16 >> i;
+        declare_func(void, uint8_t *block, int stride, int height,
+                     int log2_denom, int weight, int offset);
+
+        if (check_func(h.weight_h264_pixels_tab[i], "weight_h264_pixels%d", width)) {
+            randomize_buffer(dst0, BUF_SIZE);
+            memcpy(dst1, dst0, BUF_SIZE);
+            call_ref(dst0, STRIDE, width, log2_denom, weightd, offset);
+            call_new(dst1, STRIDE, width, log2_denom, weightd, offset);
+            if (memcmp(dst0, dst1, BUF_SIZE))
+                fail();
+            bench_new(dst1, STRIDE, width, log2_denom, weightd, offset);
+        }
+    }
+    for (i = 0; i < 4; i++) {
+        int width = 16 >> i;
+        declare_func(void, uint8_t *dst, uint8_t *src, int stride, int height,
+                     int log2_denom, int weightd, int weights, int offset);
+
+        if (check_func(h.biweight_h264_pixels_tab[i], "biweight_h264_pixels%d", width)) {
+            randomize_buffer(dst0, BUF_SIZE);
+            memcpy(dst1, dst0, BUF_SIZE);
+            call_ref(dst0, src, STRIDE, width, log2_denom, weightd, weights, offset);
+            call_new(dst1, src, STRIDE, width, log2_denom, weightd, weights, offset);
+            if (memcmp(dst0, dst1, BUF_SIZE))
+                fail();
+            bench_new(dst1, src, STRIDE, width, log2_denom, weightd, weights, offset);
+        }
+    }
+    report("weight");
+}
+
+void checkasm_check_h264dsp(void)
+{
+    check_idct();
+    check_loop_filter();
+    check_weight();
+}
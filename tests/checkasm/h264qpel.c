@@ -0,0 +1,74 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <string.h>
+
+#include "checkasm.h"
+#include "libavcodec/h264qpel.h"
+#include "libavutil/internal.h"
+#include "libavutil/mem.h"
+
+#define STRIDE   64
+/* the 6-tap filter reads 2 pixels before and 3 after the block */
+#define BUF_SIZE (STRIDE * (16 + 5))
+#define SRC_OFF  (STRIDE * 2 + 8)
+
+static void randomize_buffer(uint8_t *buf, int size)
+{
+    int i;
+
+    for (i = 0; i < size; i++)
+        buf[i] = rnd();
+}
+
+void checkasm_check_h264qpel(void)
+{
+    LOCAL_ALIGNED_16(uint8_t, src,  [BUF_SIZE]);
+    LOCAL_ALIGNED_16(uint8_t, dst0, [BUF_SIZE]);
+    LOCAL_ALIGNED_16(uint8_t, dst1, [BUF_SIZE]);
+    H264QpelContext h = { { { 0 } } };
+    int op, i, j;
+    declare_func(void, uint8_t *dst, uint8_t *src, ptrdiff_t stride);
+
+    ff_h264qpel_init(&h, 8);
+    randomize_buffer(src, BUF_SIZE);
+
+    for (op = 0; op < 2; op++) {
+        qpel_mc_func (*tab)[16] = op ? h.avg_h264_qpel_pixels_tab
+                                     : h.put_h264_qpel_pixels_tab;
+        const char *op_name = op ? "avg" : "put";
+
+        for (i = 0; i < 4; i++) {
+            int size = 16 >> i;
+
+            for (j = 0; j < 16; j++) {
+                if (check_func(tab[i][j], "%s_h264_qpel%d_mc%d%d",
+                               op_name, size, j & 3, j >> 2)) {
+                    randomize_buffer(dst0, BUF_SIZE);
+                    memcpy(dst1, dst0, BUF_SIZE);
+                    call_ref(dst0, src + SRC_OFF, STRIDE);
+                    call_new(dst1, src + SRC_OFF, STRIDE);
+                    if (memcmp(dst0, dst1, BUF_SIZE))
+                        fail();
+                    bench_new(dst1, src + SRC_OFF, STRIDE);
+                }
+            }
+            report("%s%d", op_name, size);
+        }
+    }
+}
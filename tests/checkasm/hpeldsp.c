@@ -0,0 +1,81 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <string.h>
+
+#include "checkasm.h"
+#include "libavcodec/avcodec.h"
+#include "libavcodec/hpeldsp.h"
+#include "libavutil/internal.h"
+#include "libavutil/mem.h"
+
+#define STRIDE     64
+#define BUF_SIZE   (STRIDE * 17)
+
+static void randomize_buffer(uint8_t *buf, int size)
+{
+    int i;
+
+    for (i = 0; i < size; i++)
+        buf[i] = rnd();
+}
+
+static void check_op(op_pixels_func func, const char *op, int size, int pos,
+                     const uint8_t *src, uint8_t *dst0, uint8_t *dst1)
+{
+    static const char *const pos_names[4] = { "", "_x2", "_y2", "_xy2" };
+    declare_func(void, uint8_t *block, const uint8_t *pixels,
+                 ptrdiff_t line_size, int h);
+
+    if (check_func(func, "%s_pixels%d%s", op, size, pos_names[pos])) {
+        randomize_buffer(dst0, BUF_SIZE);
+        memcpy(dst1, dst0, BUF_SIZE);
+        call_ref(dst0, src + 1, STRIDE, size);
+        call_new(dst1, src + 1, STRIDE, size);
+        if (memcmp(dst0, dst1, BUF_SIZE))
+            fail();
+        bench_new(dst1, src + 1, STRIDE, size);
+    }
+}
+
+void checkasm_check_hpeldsp(void)
+{
+    LOCAL_ALIGNED_16(uint8_t, src,  [BUF_SIZE + 16]);
+    LOCAL_ALIGNED_16(uint8_t, dst0, [BUF_SIZE]);
+    LOCAL_ALIGNED_16(uint8_t, dst1, [BUF_SIZE]);
+    HpelDSPContext h = { { { 0 } } };
+    int i, j;
+
+    /* the inexact no_rnd versions are only used without bitexact */
+    ff_hpeldsp_init(&h, CODEC_FLAG_BITEXACT);
+    randomize_buffer(src, BUF_SIZE + 16);
+
+    for (i = 0; i < 4; i++) {
+        for (j = 0; j < 4; j++) {
+            check_op(h.put_pixels_tab[i][j], "put", 16 >> i, j, src, dst0, dst1);
+            check_op(h.avg_pixels_tab[i][j], "avg", 16 >> i, j, src, dst0, dst1);
+            if (i < 2)
+                check_op(h.put_no_rnd_pixels_tab[i][j], "put_no_rnd", 16 >> i,
+                         j, src, dst0, dst1);
+        }
+        report("%dx%d", 16 >> i, 16 >> i);
+    }
+    for (j = 0; j < 4; j++)
+        check_op(h.avg_no_rnd_pixels_tab[j], "avg_no_rnd", 16, j, src, dst0, dst1);
+    report("avg_no_rnd");
+}
@@ -0,0 +1,163 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * As for swscale, the optimized conversion and resampling functions are
+ * tested through the public API, against the output of the C pass.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "checkasm.h"
+#include "libavutil/channel_layout.h"
+#include "libavutil/common.h"
+#include "libavutil/mem.h"
+#include "libavutil/samplefmt.h"
+#include "libswresample/swresample.h"
+
+#define SAMPLES 1024
+
+static const struct {
+    enum AVSampleFormat in_fmt, out_fmt;
+    int64_t in_layout, out_layout;
+    int in_rate, out_rate;
+    int max_diff;
+} tests[] = {
+    { AV_SAMPLE_FMT_S16,  AV_SAMPLE_FMT_FLT,  AV_CH_LAYOUT_STEREO, AV_CH_LAYOUT_STEREO, 48000, 48000, 0 },
+    { AV_SAMPLE_FMT_FLT,  AV_SAMPLE_FMT_S16,  AV_CH_LAYOUT_STEREO, AV_CH_LAYOUT_STEREO, 48000, 48000, 1 },
+    { AV_SAMPLE_FMT_S16P, AV_SAMPLE_FMT_S16,  AV_CH_LAYOUT_STEREO, AV_CH_LAYOUT_STEREO, 48000, 48000, 0 },
+    { AV_SAMPLE_FMT_FLTP, AV_SAMPLE_FMT_FLTP, AV_CH_LAYOUT_5POINT1, AV_CH_LAYOUT_STEREO, 48000, 48000, 1 },
+    { AV_SAMPLE_FMT_S16,  AV_SAMPLE_FMT_S16,  AV_CH_LAYOUT_STEREO, AV_CH_LAYOUT_STEREO, 48000, 44100, 1 },
+    { AV_SAMPLE_FMT_FLT,  AV_SAMPLE_FMT_FLT,  AV_CH_LAYOUT_STEREO, AV_CH_LAYOUT_STEREO, 48000, 44100, 1 },
+};
+
+static uint8_t *ref_data[FF_ARRAY_ELEMS(tests)];
+static int ref_size[FF_ARRAY_ELEMS(tests)];
+
+/* The difference in units of the last place of the integer formats, or
+ * of 2^-15 for the float formats */
+static int max_diff(enum AVSampleFormat fmt, const uint8_t *a, const uint8_t *b,
+                    int size)
+{
+    int i, diff = 0;
+
+    switch (av_get_packed_sample_fmt(fmt)) {
+    case AV_SAMPLE_FMT_S16:
+        for (i = 0; i < size / 2; i++)
+            diff = FFMAX(diff, abs(((const int16_t *)a)[i] - ((const int16_t *)b)[i]));
+        break;
+    case AV_SAMPLE_FMT_FLT:
+        for (i = 0; i < size / 4; i++)
+            diff = FFMAX(diff, lrintf(fabsf(((const float *)a)[i] -
+                                            ((const float *)b)[i]) * (1 << 15)));
+        break;
+    default:
+        diff = !!memcmp(a, b, size);
+    }
+    return diff;
+}
+
+static void fill_samples(enum AVSampleFormat fmt, uint8_t *buf, int size)
+{
+    int i;
+
+    switch (av_get_packed_sample_fmt(fmt)) {
+    case AV_SAMPLE_FMT_S16:
+        for (i = 0; i < size / 2; i++)
+            ((int16_t *)buf)[i] = rnd();
+        break;
+    case AV_SAMPLE_FMT_FLT:
+        for (i = 0; i < size / 4; i++)
+            ((float *)buf)[i] = ((int16_t)rnd()) / 32768.0f;
+        break;
+    default:
+        for (i = 0; i < size; i++)
+            buf[i] = rnd();
+    }
+}
+
+static struct SwrContext *alloc_context(int t)
+{
+    struct SwrContext *swr = swr_alloc_set_opts(NULL,
+                                                tests[t].out_layout, tests[t].out_fmt, tests[t].out_rate,
+                                                tests[t].in_layout,  tests[t].in_fmt,  tests[t].in_rate,
+                                                0, NULL);
+
+    if (swr && swr_init(swr) < 0)
+        swr_free(&swr);
+    return swr;
+}
+
+static void check_convert(int t)
+{
+    uint8_t **in = NULL, **out = NULL;
+    int in_ch  = av_get_channel_layout_nb_channels(tests[t].in_layout);
+    int out_ch = av_get_channel_layout_nb_channels(tests[t].out_layout);
+    int out_samples = SAMPLES * 2;
+    int in_size, out_size, ret;
+    struct SwrContext *swr = NULL;
+
+    in_size  = av_samples_alloc_array_and_samples(&in, NULL, in_ch, SAMPLES,
+                                                  tests[t].in_fmt, 0);
+    out_size = av_samples_alloc_array_and_samples(&out, NULL, out_ch, out_samples,
+                                                  tests[t].out_fmt, 0);
+    if (in_size < 0 || out_size < 0)
+        goto end;
+    fill_samples(tests[t].in_fmt, in[0], in_size);
+
+    swr = alloc_context(t);
+    if (swr && check_api("%s_%dch_%d_%s_%dch_%d",
+                         av_get_sample_fmt_name(tests[t].in_fmt), in_ch, tests[t].in_rate,
+                         av_get_sample_fmt_name(tests[t].out_fmt), out_ch, tests[t].out_rate)) {
+        memset(out[0], 0, out_size);
+        ret = swr_convert(swr, out, out_samples, (const uint8_t **)in, SAMPLES);
+        if (ret < 0) {
+            fail();
+        } else if (!ref_data[t]) {
+            /* the C pass always comes first */
+            ref_data[t] = av_malloc(out_size);
+            ref_size[t] = ret;
+            if (ref_data[t])
+                memcpy(ref_data[t], out[0], out_size);
+        } else if (ret != ref_size[t] ||
+                   max_diff(tests[t].out_fmt, ref_data[t], out[0], out_size) > tests[t].max_diff) {
+            fail();
+        }
+        bench_call(swr_convert, swr, out, out_samples, (const uint8_t **)in, SAMPLES);
+    }
+
+end:
+    swr_free(&swr);
+    if (in)
+        av_freep(&in[0]);
+    av_freep(&in);
+    if (out)
+        av_freep(&out[0]);
+    av_freep(&out);
+}
+
+void checkasm_check_swresample(void)
+{
+    int t;
+
+    for (t = 0; t < FF_ARRAY_ELEMS(tests); t++)
+        check_convert(t);
+    report("swr_convert");
+}
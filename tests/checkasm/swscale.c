@@ -0,0 +1,112 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * The optimized swscale functions are chosen in sws_init_context() and
+ * are not reachable from outside, so whole conversions are tested and
+ * compared to the ones of the C pass.
+ */
+
+#include <stdlib.h>
+
+#include "checkasm.h"
+#include "libavutil/common.h"
+#include "libavutil/imgutils.h"
+#include "libavutil/mem.h"
+#include "libavutil/pixdesc.h"
+#include "libswscale/swscale.h"
+
+#define WIDTH  320
+#define HEIGHT 32
+
+static const struct {
+    enum AVPixelFormat src_fmt, dst_fmt;
+    int dst_w, dst_h;
+    int flags;
+    int max_diff;
+} tests[] = {
+    { AV_PIX_FMT_YUV420P, AV_PIX_FMT_YUV420P, WIDTH / 2, HEIGHT / 2, SWS_BICUBIC,  2 },
+    { AV_PIX_FMT_YUV420P, AV_PIX_FMT_YUV420P, WIDTH * 2, HEIGHT,     SWS_BILINEAR, 2 },
+    { AV_PIX_FMT_YUV420P, AV_PIX_FMT_BGRA,    WIDTH,     HEIGHT,     SWS_BILINEAR, 4 },
+    { AV_PIX_FMT_RGB24,   AV_PIX_FMT_YUV420P, WIDTH,     HEIGHT,     SWS_BILINEAR, 2 },
+    { AV_PIX_FMT_YUYV422, AV_PIX_FMT_YUV420P, WIDTH,     HEIGHT,     SWS_BILINEAR, 2 },
+};
+
+static uint8_t *ref_data[FF_ARRAY_ELEMS(tests)];
+
+static int max_abs_diff(const uint8_t *a, const uint8_t *b, int size)
+{
+    int i, diff = 0;
+
+    for (i = 0; i < size; i++)
+        diff = FFMAX(diff, abs(a[i] - b[i]));
+    return diff;
+}
+
+static void check_scale(int t)
+{
+    uint8_t *src[4], *dst[4];
+    int src_stride[4], dst_stride[4];
+    int i, size, dst_size;
+    struct SwsContext *sws;
+
+    size = av_image_alloc(src, src_stride, WIDTH, HEIGHT, tests[t].src_fmt, 16);
+    if (size < 0)
+        return;
+    dst_size = av_image_alloc(dst, dst_stride, tests[t].dst_w, tests[t].dst_h,
+                              tests[t].dst_fmt, 16);
+    if (dst_size < 0) {
+        av_freep(&src[0]);
+        return;
+    }
+    for (i = 0; i < size; i++)
+        src[0][i] = rnd();
+
+    sws = sws_getContext(WIDTH, HEIGHT, tests[t].src_fmt,
+                         tests[t].dst_w, tests[t].dst_h, tests[t].dst_fmt,
+                         tests[t].flags, NULL, NULL, NULL);
+    if (sws && check_api("%s_%dx%d_%s_%dx%d", av_get_pix_fmt_name(tests[t].src_fmt),
+                         WIDTH, HEIGHT, av_get_pix_fmt_name(tests[t].dst_fmt),
+                         tests[t].dst_w, tests[t].dst_h)) {
+        memset(dst[0], 0, dst_size);
+        sws_scale(sws, (const uint8_t * const *)src, src_stride, 0, HEIGHT,
+                  dst, dst_stride);
+        if (!ref_data[t]) {
+            /* the C pass always comes first */
+            ref_data[t] = av_malloc(dst_size);
+            if (ref_data[t])
+                memcpy(ref_data[t], dst[0], dst_size);
+        } else if (max_abs_diff(ref_data[t], dst[0], dst_size) > tests[t].max_diff) {
+            fail();
+        }
+        bench_call(sws_scale, sws, (const uint8_t * const *)src, src_stride,
+                   0, HEIGHT, dst, dst_stride);
+    }
+    sws_freeContext(sws);
+    av_freep(&src[0]);
+    av_freep(&dst[0]);
+}
+
+void checkasm_check_swscale(void)
+{
+    int t;
+
+    for (t = 0; t < FF_ARRAY_ELEMS(tests); t++)
+        check_scale(t);
+    report("sws_scale");
+}
@@ -0,0 +1,61 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+#include <string.h>
+
+#include "checkasm.h"
+#include "libavcodec/v210enc.h"
+#include "libavutil/internal.h"
+#include "libavutil/mem.h"
+
+/* a multiple of all the sample factors, plus the samples read past it */
+#define WIDTH 240
+#define PAD   8
+
+void checkasm_check_v210enc(void)
+{
+    LOCAL_ALIGNED_16(uint16_t, y, [WIDTH + PAD]);
+    LOCAL_ALIGNED_16(uint16_t, u, [WIDTH / 2 + PAD]);
+    LOCAL_ALIGNED_16(uint16_t, v, [WIDTH / 2 + PAD]);
+    LOCAL_ALIGNED_16(uint8_t, dst0, [WIDTH / 6 * 16]);
+    LOCAL_ALIGNED_16(uint8_t, dst1, [WIDTH / 6 * 16]);
+    V210EncContext s;
+    int i;
+    declare_func(void, const uint16_t *y, const uint16_t *u,
+                 const uint16_t *v, uint8_t *dst, ptrdiff_t width);
+
+    ff_v210enc_init(&s);
+
+    /* the whole 10-bit range, to test the clipping */
+    for (i = 0; i < WIDTH + PAD; i++)
+        y[i] = rnd() & 0x3FF;
+    for (i = 0; i < WIDTH / 2 + PAD; i++) {
+        u[i] = rnd() & 0x3FF;
+        v[i] = rnd() & 0x3FF;
+    }
+
+    if (check_func(s.pack_line_10, "v210_planar_pack_10")) {
+        memset(dst0, 0, WIDTH / 6 * 16);
+        memset(dst1, 0, WIDTH / 6 * 16);
+        call_ref(y, u, v, dst0, WIDTH);
+        call_new(y, u, v, dst1, WIDTH);
+        if (memcmp(dst0, dst1, WIDTH / 6 * 16))
+            fail();
+        bench_new(y, u, v, dst1, WIDTH);
+    }
+    report("v210_planar_pack_10");
+}
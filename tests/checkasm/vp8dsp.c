@@ -0,0 +1,222 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <string.h>
+
+#include "checkasm.h"
+#include "libavcodec/vp8dsp.h"
+#include "libavutil/internal.h"
+#include "libavutil/mem.h"
+
+#define STRIDE   64
+#define BUF_SIZE (STRIDE * 32)
+#define PIX_OFF  (STRIDE * 8 + 16)
+
+static void randomize_buffer(uint8_t *buf, int size)
+{
+    int i;
+
+    for (i = 0; i < size; i++)
+        buf[i] = rnd();
+}
+
+/* Pixels close enough to each other for the filters to modify them */
+static void randomize_edge(uint8_t *buf, int size)
+{
+    int i, base = 64 + rnd() % 128;
+
+    for (i = 0; i < size; i++)
+        buf[i] = base + (int)(rnd() % 17) - 8;
+}
+
+static void check_idct(void)
+{
+    LOCAL_ALIGNED_16(uint8_t, dst0, [BUF_SIZE]);
+    LOCAL_ALIGNED_16(uint8_t, dst1, [BUF_SIZE]);
+    LOCAL_ALIGNED_16(int16_t, block0, [4 * 16]);
+    LOCAL_ALIGNED_16(int16_t, block1, [4 * 16]);
+    VP8DSPContext d = { 0 };
+    int i;
+
+    ff_vp8dsp_init(&d);
+
+    for (i = 0; i < 4; i++) {
+        static const char *const names[4] = {
+            "vp8_idct_add", "vp8_idct_dc_add",
+            "vp8_idct_dc_add4y", "vp8_idct_dc_add4uv",
+        };
+        void *funcs[4] = {
+            d.vp8_idct_add, d.vp8_idct_dc_add,
+            d.vp8_idct_dc_add4y, d.vp8_idct_dc_add4uv,
+        };
+        declare_func(void, uint8_t *dst, int16_t *block, ptrdiff_t stride);
+        int j, size = i < 2 ? 16 : 4 * 16;
+
+        if (check_func(funcs[i], "%s", names[i])) {
+            randomize_buffer(dst0, BUF_SIZE);
+            memcpy(dst1, dst0, BUF_SIZE);
+            for (j = 0; j < size; j++)
+                block0[j] = (int)(rnd() % 1023) - 511;
+            memcpy(block1, block0, size * sizeof(*block0));
+            call_ref(dst0 + PIX_OFF, block0, STRIDE);
+            call_new(dst1 + PIX_OFF, block1, STRIDE);
+            if (memcmp(dst0, dst1, BUF_SIZE) ||
+                memcmp(block0, block1, size * sizeof(*block0)))
+                fail();
+            bench_new(dst1 + PIX_OFF, block1, STRIDE);
+        }
+    }
+    report("idct");
+}
+
+static void check_mc(void)
+{
+    LOCAL_ALIGNED_16(uint8_t, src,  [BUF_SIZE]);
+    LOCAL_ALIGNED_16(uint8_t, dst0, [BUF_SIZE]);
+    LOCAL_ALIGNED_16(uint8_t, dst1, [BUF_SIZE]);
+    VP8DSPContext d = { 0 };
+    int type, i, dy, dx;
+    declare_func(void, uint8_t *dst, ptrdiff_t dst_stride, uint8_t *src,
+                 ptrdiff_t src_stride, int h, int mx, int my);
+
+    ff_vp8dsp_init(&d);
+    randomize_buffer(src, BUF_SIZE);
+
+    for (type = 0; type < 2; type++) {
+        vp8_mc_func (*tab)[3][3] = type ? d.put_vp8_bilinear_pixels_tab
+                                        : d.put_vp8_epel_pixels_tab;
+        const char *type_name = type ? "bilinear" : "epel";
+
+        for (i = 0; i < 3; i++) {
+            int size = 16 >> i;
+
+            for (dy = 0; dy < 3; dy++) {
+                for (dx = 0; dx < 3; dx++) {
+                    /* filter index 1 is the 4-tap filter for the odd
+                     * positions, 2 the 6-tap one for the even ones */
+                    int mx = dx ? (rnd() % 3 + 1) * 2 - (dx & 1) : 0;
+                    int my = dy ? (rnd() % 3 + 1) * 2 - (dy & 1) : 0;
+
+                    if (check_func(tab[i][dy][dx], "put_vp8_%s%d_h%dv%d",
+                                   type_name, size, dx, dy)) {
+                        randomize_buffer(dst0, BUF_SIZE);
+                        memcpy(dst1, dst0, BUF_SIZE);
+                        call_ref(dst0, STRIDE, src + PIX_OFF, STRIDE, size, mx, my);
+                        call_new(dst1, STRIDE, src + PIX_OFF, STRIDE, size, mx, my);
+                        if (memcmp(dst0, dst1, BUF_SIZE))
+                            fail();
+                        bench_new(dst1, STRIDE, src + PIX_OFF, STRIDE, size, mx, my);
+                    }
+                }
+            }
+            report("%s%d", type_name, size);
+        }
+    }
+}
+
+static void check_loop_filter(void)
+{
+    LOCAL_ALIGNED_16(uint8_t, dst0, [BUF_SIZE]);
+    LOCAL_ALIGNED_16(uint8_t, dst1, [BUF_SIZE]);
+    VP8DSPContext d = { 0 };
+    int i, flim_e, flim_i, hev_thresh;
+
+    ff_vp8dsp_init(&d);
+
+    flim_e     = 20 + rnd() % 40;
+    flim_i     =  5 + rnd() % 15;
+    hev_thresh = rnd() % 4;
+
+    {
+        static const char *const names[4] = {
+            "vp8_v_loop_filter16y",       "vp8_h_loop_filter16y",
+            "vp8_v_loop_filter16y_inner", "vp8_h_loop_filter16y_inner",
+        };
+        void *funcs[4] = {
+            d.vp8_v_loop_filter16y,       d.vp8_h_loop_filter16y,
+            d.vp8_v_loop_filter16y_inner, d.vp8_h_loop_filter16y_inner,
+        };
+        declare_func(void, uint8_t *dst, ptrdiff_t stride,
+                     int flim_E, int flim_I, int hev_thresh);
+
+        for (i = 0; i < 4; i++) {
+            if (check_func(funcs[i], "%s", names[i])) {
+                randomize_edge(dst0, BUF_SIZE);
+                memcpy(dst1, dst0, BUF_SIZE);
+                call_ref(dst0 + PIX_OFF, STRIDE, flim_e, flim_i, hev_thresh);
+                call_new(dst1 + PIX_OFF, STRIDE, flim_e, flim_i, hev_thresh);
+                if (memcmp(dst0, dst1, BUF_SIZE))
+                    fail();
+                bench_new(dst1 + PIX_OFF, STRIDE, flim_e, flim_i, hev_thresh);
+            }
+        }
+    }
+    {
+        static const char *const names[4] = {
+            "vp8_v_loop_filter8uv",       "vp8_h_loop_filter8uv",
+            "vp8_v_loop_filter8uv_inner", "vp8_h_loop_filter8uv_inner",
+        };
+        void *funcs[4] = {
+            d.vp8_v_loop_filter8uv,       d.vp8_h_loop_filter8uv,
+            d.vp8_v_loop_filter8uv_inner, d.vp8_h_loop_filter8uv_inner,
+        };
+        declare_func(void, uint8_t *dst_u, uint8_t *dst_v, ptrdiff_t stride,
+                     int flim_E, int flim_I, int hev_thresh);
+
+        for (i = 0; i < 4; i++) {
+            if (check_func(funcs[i], "%s", names[i])) {
+                randomize_edge(dst0, BUF_SIZE);
+                memcpy(dst1, dst0, BUF_SIZE);
+                call_ref(dst0 + PIX_OFF, dst0 + PIX_OFF + 24, STRIDE,
+                         flim_e, flim_i, hev_thresh);
+                call_new(dst1 + PIX_OFF, dst1 + PIX_OFF + 24, STRIDE,
+                         flim_e, flim_i, hev_thresh);
+                if (memcmp(dst0, dst1, BUF_SIZE))
+                    fail();
+                bench_new(dst1 + PIX_OFF, dst1 + PIX_OFF + 24, STRIDE,
+                          flim_e, flim_i, hev_thresh);
+            }
+        }
+    }
+    {
+        declare_func(void, uint8_t *dst, ptrdiff_t stride, int flim);
+
+        for (i = 0; i < 2; i++) {
+            void *func = i ? d.vp8_h_loop_filter_simple
+                           : d.vp8_v_loop_filter_simple;
+
+            if (check_func(func, "vp8_%c_loop_filter_simple", i ? 'h' : 'v')) {
+                randomize_edge(dst0, BUF_SIZE);
+                memcpy(dst1, dst0, BUF_SIZE);
+                call_ref(dst0 + PIX_OFF, STRIDE, flim_e);
+                call_new(dst1 + PIX_OFF, STRIDE, flim_e);
+                if (memcmp(dst0, dst1, BUF_SIZE))
+                    fail();
+                bench_new(dst1 + PIX_OFF, STRIDE, flim_e);
+            }
+        }
+    }
+    report("loop_filter");
+}
+
+void checkasm_check_vp8dsp(void)
+{
+    check_idct();
+    check_mc();
+    check_loop_filter();
+}
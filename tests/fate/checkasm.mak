@@ -0,0 +1,7 @@
+FATE_CHECKASM += fate-checkasm
+fate-checkasm: tests/checkasm/checkasm$(EXESUF)
+fate-checkasm: CMD = run tests/checkasm/checkasm
+fate-checkasm: CMP = null
+fate-checkasm: REF = /dev/null
+
+FATE-$(CONFIG_STATIC) += $(FATE_CHECKASM)
@@ -29,5 +29,9 @@ FATE_FFPROBE += fate-ffprobe_xml
 fate-ffprobe_xml: $(FFPROBE_TEST_FILE)
 fate-ffprobe_xml: CMD = run $(FFPROBE_COMMAND) -of xml
 
+FATE_FFPROBE += fate-ffprobe_parse_frames
+fate-ffprobe_parse_frames: $(FFPROBE_TEST_FILE)
+fate-ffprobe_parse_frames: CMD = run ffprobe$(EXESUF) -show_frames -parse_frames -bitexact $(FFPROBE_TEST_FILE) -of compact
+
 fate-ffprobe: $(FATE_FFPROBE)
 
@@ -53,6 +53,9 @@ fate-filter-interlace: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf interlace
 FATE_FILTER_VSYNTH-$(call ALLYES, NEGATE_FILTER PERMS_FILTER) += fate-filter-negate
 fate-filter-negate: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf perms=random,negate
 
+FATE_FILTER_VSYNTH-$(call ALLYES, BOXBLUR_FILTER HFLIP_FILTER NEGATE_FILTER VFLIP_FILTER) += fate-filter-pipeline
+fate-filter-pipeline: CMD = framecrc -filter_pipeline -c:v pgmyuv -i $(SRC) -vf boxblur=2:1,hflip,negate,vflip
+
 FATE_FILTER_VSYNTH-$(CONFIG_HISTOGRAM_FILTER) += fate-filter-histogram-levels
 fate-filter-histogram-levels: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf histogram -flags +bitexact -sws_flags +accurate_rnd+bitexact
 
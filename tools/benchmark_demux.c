@@ -0,0 +1,330 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Measure the open, demux, parse and decode throughput of a file.
+ *
+ * The file is opened once per pass, so that each pass measures its own
+ * stage from the start of the file:
+ * - demux:  av_read_frame() with the parsers disabled
+ * - parse:  av_read_frame() with the parsers the demuxer asks for
+ * - decode: the parse pass, plus decoding all the streams
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if HAVE_UNISTD_H
+#include <unistd.h>             /* getopt */
+#endif
+#if HAVE_SYS_RESOURCE_H
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/resource.h>
+#endif
+
+#include "libavutil/dict.h"
+#include "libavutil/frame.h"
+#include "libavutil/time.h"
+#include "libavcodec/avcodec.h"
+#include "libavformat/avformat.h"
+
+#if !HAVE_GETOPT
+#include "compat/getopt.c"
+#endif
+
+enum Pass {
+    PASS_DEMUX,
+    PASS_PARSE,
+    PASS_DECODE,
+};
+
+static const char *const pass_names[] = { "demux", "parse", "decode" };
+
+typedef struct Stats {
+    int64_t packets;
+    int64_t bytes;
+    int64_t frames;
+    int64_t wall;               ///< wall clock time in microseconds
+    int64_t cpu;                ///< user + system time in microseconds
+} Stats;
+
+static int64_t get_cpu_time(void)
+{
+#if HAVE_GETRUSAGE
+    struct rusage rusage;
+
+    getrusage(RUSAGE_SELF, &rusage);
+    return rusage.ru_utime.tv_sec * 1000000LL + rusage.ru_utime.tv_usec +
+           rusage.ru_stime.tv_sec * 1000000LL + rusage.ru_stime.tv_usec;
+#else
+    return av_gettime();
+#endif
+}
+
+#if HAVE_GETRUSAGE && HAVE_STRUCT_RUSAGE_RU_MAXRSS
+static int64_t get_max_rss(void)
+{
+    struct rusage rusage;
+
+    getrusage(RUSAGE_SELF, &rusage);
+    return (int64_t)rusage.ru_maxrss * 1024;
+}
+#endif
+
+static int open_file(AVFormatContext **fctx, const char *filename,
+                     int parse, Stats *open_stats)
+{
+    int64_t wall = av_gettime(), cpu = get_cpu_time();
+    int ret;
+
+    *fctx = avformat_alloc_context();
+    if (!*fctx)
+        return AVERROR(ENOMEM);
+    if (!parse)
+        (*fctx)->flags |= AVFMT_FLAG_NOPARSE | AVFMT_FLAG_NOFILLIN;
+
+    ret = avformat_open_input(fctx, filename, NULL, NULL);
+    if (ret < 0) {
+        fprintf(stderr, "%s: cannot open: %s\n", filename, av_err2str(ret));
+        return ret;
+    }
+    ret = avformat_find_stream_info(*fctx, NULL);
+    if (ret < 0) {
+        fprintf(stderr, "%s: cannot find stream info: %s\n", filename,
+                av_err2str(ret));
+        avformat_close_input(fctx);
+        return ret;
+    }
+    if (open_stats) {
+        open_stats->wall = av_gettime()  - wall;
+        open_stats->cpu  = get_cpu_time() - cpu;
+    }
+    return 0;
+}
+
+static int open_decoders(AVFormatContext *fctx, int threads)
+{
+    int i, ret;
+
+    for (i = 0; i < fctx->nb_streams; i++) {
+        AVCodecContext *avctx = fctx->streams[i]->codec;
+        AVCodec *codec;
+        AVDictionary *opts = NULL;
+        char buf[16];
+
+        if (avctx->codec_type != AVMEDIA_TYPE_VIDEO &&
+            avctx->codec_type != AVMEDIA_TYPE_AUDIO)
+            continue;
+        codec = avcodec_find_decoder(avctx->codec_id);
+        if (!codec) {
+            fprintf(stderr, "stream %d: no decoder for %s, skipped\n", i,
+                    avcodec_get_name(avctx->codec_id));
+            continue;
+        }
+        snprintf(buf, sizeof(buf), "%d", threads);
+        av_dict_set(&opts, "threads", buf, 0);
+        ret = avcodec_open2(avctx, codec, &opts);
+        av_dict_free(&opts);
+        if (ret < 0) {
+            fprintf(stderr, "stream %d: cannot open the %s decoder: %s\n", i,
+                    codec->name, av_err2str(ret));
+            return ret;
+        }
+    }
+    return 0;
+}
+
+static int decode_packet(AVCodecContext *avctx, AVFrame *frame, AVPacket *pkt,
+                         Stats *stats)
+{
+    AVPacket pkt2 = *pkt;
+    int got_frame, ret;
+
+    /* audio packets may hold several frames */
+    do {
+        got_frame = 0;
+        if (avctx->codec_type == AVMEDIA_TYPE_VIDEO)
+            ret = avcodec_decode_video2(avctx, frame, &got_frame, &pkt2);
+        else
+            ret = avcodec_decode_audio4(avctx, frame, &got_frame, &pkt2);
+        if (ret < 0)
+            return ret;
+        if (got_frame)
+            stats->frames++;
+        if (avctx->codec_type == AVMEDIA_TYPE_VIDEO)
+            ret = pkt2.size;
+        pkt2.data += ret;
+        pkt2.size -= ret;
+    } while (pkt2.size > 0 && (ret || got_frame));
+    return got_frame;
+}
+
+static int run_pass(const char *filename, enum Pass pass, int threads,
+                    Stats *stats)
+{
+    AVFormatContext *fctx = NULL;
+    AVFrame *frame = NULL;
+    AVPacket pkt;
+    int64_t wall, cpu;
+    int i, ret;
+
+    memset(stats, 0, sizeof(*stats));
+    ret = open_file(&fctx, filename, pass != PASS_DEMUX, NULL);
+    if (ret < 0)
+        return ret;
+    if (pass == PASS_DECODE) {
+        frame = av_frame_alloc();
+        if (!frame) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        ret = open_decoders(fctx, threads);
+        if (ret < 0)
+            goto end;
+    }
+
+    wall = av_gettime();
+    cpu  = get_cpu_time();
+
+    av_init_packet(&pkt);
+    while ((ret = av_read_frame(fctx, &pkt)) >= 0) {
+        AVCodecContext *avctx = fctx->streams[pkt.stream_index]->codec;
+
+        stats->packets++;
+        stats->bytes += pkt.size;
+        if (pass == PASS_DECODE && avcodec_is_open(avctx)) {
+            /* decoding errors are not fatal, as in ffmpeg */
+            decode_packet(avctx, frame, &pkt, stats);
+        }
+        av_free_packet(&pkt);
+    }
+    if (ret != AVERROR_EOF)
+        fprintf(stderr, "%s: error while reading: %s\n", filename,
+                av_err2str(ret));
+
+    if (pass == PASS_DECODE) {
+        /* flush the frames delayed by the decoders */
+        for (i = 0; i < fctx->nb_streams; i++) {
+            AVCodecContext *avctx = fctx->streams[i]->codec;
+
+            if (!avcodec_is_open(avctx) ||
+                !(avctx->codec->capabilities & CODEC_CAP_DELAY))
+                continue;
+            pkt.data = NULL;
+            pkt.size = 0;
+            while (decode_packet(avctx, frame, &pkt, stats) > 0)
+                ;
+        }
+    }
+
+    stats->wall = av_gettime()  - wall;
+    stats->cpu  = get_cpu_time() - cpu;
+    ret = 0;
+
+end:
+    av_frame_free(&frame);
+    if (fctx) {
+        for (i = 0; i < fctx->nb_streams; i++)
+            avcodec_close(fctx->streams[i]->codec);
+        avformat_close_input(&fctx);
+    }
+    return ret;
+}
+
+static void print_stats(const char *name, const Stats *stats)
+{
+    double secs = FFMAX(stats->wall, 1) / 1000000.0;
+
+    printf("%-7s %10"PRId64" packets %10.3f MB in %8.3f s (cpu %8.3f s): "
+           "%10.1f packets/s %9.2f MB/s",
+           name, stats->packets, stats->bytes / 1048576.0, secs,
+           stats->cpu / 1000000.0, stats->packets / secs,
+           stats->bytes / 1048576.0 / secs);
+    if (stats->frames)
+        printf(" %10.1f frames/s", stats->frames / secs);
+    printf("\n");
+}
+
+static void usage(void)
+{
+    fprintf(stderr,
+            "usage: benchmark_demux [-t threads] [-p passes] input\n"
+            "measure the open time, the demux, parse and decode throughput,\n"
+            "and the peak memory use for a file\n"
+            "-t threads  number of decoding threads, 0 for auto (default 1)\n"
+            "-p passes   passes to run among demux, parse and decode,\n"
+            "            separated by commas (default all)\n");
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    const char *passes = "demux,parse,decode";
+    AVFormatContext *fctx = NULL;
+    int threads = 1;
+    Stats stats;
+    int c, i;
+
+    while ((c = getopt(argc, argv, "t:p:h")) != -1) {
+        switch (c) {
+        case 't':
+            threads = atoi(optarg);
+            break;
+        case 'p':
+            passes = optarg;
+            break;
+        default:
+            usage();
+        }
+    }
+    if (optind != argc - 1)
+        usage();
+
+    av_register_all();
+    av_log_set_level(AV_LOG_ERROR);
+
+    /* the first open also pays for reading the file from the disk, as in
+     * real use */
+    if (open_file(&fctx, argv[optind], 1, &stats) < 0)
+        return 1;
+    avformat_close_input(&fctx);
+    printf("%-7s %.3f ms (cpu %.3f ms)\n", "open",
+           stats.wall / 1000.0, stats.cpu / 1000.0);
+
+    for (i = 0; i < FF_ARRAY_ELEMS(pass_names); i++) {
+        const char *p = strstr(passes, pass_names[i]);
+        int len = strlen(pass_names[i]);
+
+        if (!p || (p[len] && p[len] != ','))
+            continue;
+        if (run_pass(argv[optind], i, threads, &stats) < 0)
+            return 1;
+        print_stats(pass_names[i], &stats);
+        if (i == PASS_DECODE)
+            printf("%-7s %d\n", "threads", threads);
+    }
+#if HAVE_GETRUSAGE && HAVE_STRUCT_RUSAGE_RU_MAXRSS
+    printf("%-7s %"PRId64" kB\n", "maxrss", get_max_rss() / 1024);
+#endif
+
+    return 0;
+}
@@ -190,9 +190,6 @@ static int read_tfra(struct Tracks *tracks, int start_index, AVIOContext *f)
             track->offsets[i - 1].duration = track->offsets[i].time -
                                              track->offsets[i - 1].time;
     }
-    if (track->chunks > 0)
-        track->offsets[track->chunks - 1].duration = track->duration -
-                                                     track->offsets[track->chunks - 1].time;
     ret = 0;
 
 fail:
@@ -200,12 +197,117 @@ fail:
     return ret;
 }
 
+/**
+ * Read the fragment duration from the tfxd box of the traf, as written
+ * in Smooth Streaming files.
+ *
+ * @return 1 if found, 0 otherwise
+ */
+static int read_tfxd(AVIOContext *f, int64_t end, int64_t *duration)
+{
+    static const uint8_t tfxd[] = {
+        0x6d, 0x1d, 0x9b, 0x05, 0x42, 0xd5, 0x44, 0xe6,
+        0x80, 0xe2, 0x14, 0x1d, 0xaf, 0xf7, 0x57, 0xb2
+    };
+
+    while (avio_tell(f) + 8 <= end && !url_feof(f)) {
+        int64_t pos   = avio_tell(f);
+        uint32_t size = avio_rb32(f);
+        uint32_t tag  = avio_rb32(f);
+        uint8_t uuid[16];
+
+        if (size < 8 || pos + size > end)
+            break;
+        if (tag == MKBETAG('t', 'r', 'a', 'f'))
+            continue; /* look at the children */
+        if (tag == MKBETAG('u', 'u', 'i', 'd') && size >= 8 + 16 + 4 + 8 &&
+            avio_read(f, uuid, 16) == 16 && !memcmp(uuid, tfxd, 16)) {
+            int version = avio_r8(f);
+            avio_rb24(f);
+            if (version == 1) {
+                avio_rb64(f); /* time */
+                *duration = avio_rb64(f);
+            } else {
+                avio_rb32(f);
+                *duration = avio_rb32(f);
+            }
+            return 1;
+        }
+        avio_seek(f, pos + size, SEEK_SET);
+    }
+    return 0;
+}
+
+/**
+ * Compute the bitrate and end time of a track from the headers of the
+ * fragments listed in its tfra, without parsing them.
+ *
+ * @return 1 if the track duration could be found, 0 if not, or a negative
+ *         error if the fragments are not laid out as expected
+ */
+static int read_fragment_sizes(struct Track *track, AVIOContext *f)
+{
+    int64_t data_size = 0, duration = 0;
+    int i, found = 0;
+
+    for (i = 0; i < track->chunks; i++) {
+        int64_t offset = track->offsets[i].offset;
+        uint32_t moof_size, mdat_size;
+
+        if (avio_seek(f, offset, SEEK_SET) < 0)
+            return AVERROR(EIO);
+        moof_size = avio_rb32(f);
+        if (avio_rb32(f) != MKBETAG('m', 'o', 'o', 'f') || moof_size < 8)
+            return AVERROR_INVALIDDATA;
+        if (i == track->chunks - 1)
+            found = read_tfxd(f, offset + moof_size, &duration);
+        if (avio_seek(f, offset + moof_size, SEEK_SET) < 0)
+            return AVERROR(EIO);
+        mdat_size = avio_rb32(f);
+        if (avio_rb32(f) != MKBETAG('m', 'd', 'a', 't') || mdat_size < 8)
+            return AVERROR_INVALIDDATA;
+        data_size += mdat_size - 8;
+    }
+    if (!found || track->chunks <= 0)
+        return 0;
+
+    track->duration = track->offsets[track->chunks - 1].time + duration;
+    if (track->duration > 0)
+        track->bitrate = data_size * 8 * track->timescale / track->duration;
+    return 1;
+}
+
+/**
+ * Get the bitrates and the duration from the demuxer, which reads all the
+ * fragments of the file.
+ */
+static int read_stream_info(struct Tracks *tracks, int start_index,
+                            const char *file, int64_t *duration)
+{
+    AVFormatContext *ctx = NULL;
+    int err, i, j;
+
+    if ((err = avformat_open_input(&ctx, file, NULL, NULL)) < 0)
+        return err;
+    if ((err = avformat_find_stream_info(ctx, NULL)) >= 0) {
+        for (i = start_index; i < tracks->nb_tracks; i++)
+            for (j = 0; j < ctx->nb_streams; j++)
+                if (ctx->streams[j]->id == tracks->tracks[i]->track_id)
+                    tracks->tracks[i]->bitrate = ctx->streams[j]->codec->bit_rate;
+        *duration = ctx->duration;
+        err = 0;
+    }
+    avformat_close_input(&ctx);
+    return err;
+}
+
 static int read_mfra(struct Tracks *tracks, int start_index,
                      const char *file, int split)
 {
-    int err = 0;
+    int err = 0, ret = 0, i;
     AVIOContext *f = NULL;
     int32_t mfra_size;
+    int64_t duration = 0;
 
     if ((err = avio_open2(&f, file, AVIO_FLAG_READ, NULL, NULL)) < 0)
         goto fail;
@@ -224,6 +326,31 @@ static int read_mfra(struct Tracks *tracks, int start_index,
         /* Empty */
     }
 
+    for (i = start_index; i < tracks->nb_tracks; i++) {
+        struct Track *track = tracks->tracks[i];
+        if ((ret = read_fragment_sizes(track, f)) <= 0)
+            break;
+        duration = FFMAX(duration, av_rescale(track->duration, AV_TIME_BASE,
+                                              track->timescale));
+    }
+    if (ret <= 0) {
+        /* Not written with tfxd boxes, let the demuxer go through the
+         * whole file instead. */
+        if ((err = read_stream_info(tracks, start_index, file, &duration)) < 0)
+            goto fail;
+    }
+    if (!tracks->duration)
+        tracks->duration = duration;
+
+    for (i = start_index; i < tracks->nb_tracks; i++) {
+        struct Track *track = tracks->tracks[i];
+        track->duration = av_rescale_rnd(duration, track->timescale,
+                                         AV_TIME_BASE, AV_ROUND_UP);
+        if (track->chunks > 0)
+            track->offsets[track->chunks - 1].duration = track->duration -
+                                                         track->offsets[track->chunks - 1].time;
+    }
+
     if (split)
         err = write_fragments(tracks, start_index, f);
 
@@ -284,6 +411,11 @@ static int handle_file(struct Tracks *tracks, const char *file, int split)
     char errbuf[50], *ptr;
     struct Track *track;
 
+    /* Only the first fragments are needed to identify the streams, the
+     * others are looked up through the mfra atom afterwards. */
+    if (!(ctx = avformat_alloc_context()))
+        return 1;
+    ctx->flags |= AVFMT_FLAG_IGNIDX;
     err = avformat_open_input(&ctx, file, NULL, NULL);
     if (err < 0) {
         av_strerror(err, errbuf, sizeof(errbuf));
@@ -302,8 +434,6 @@ static int handle_file(struct Tracks *tracks, const char *file, int split)
         fprintf(stderr, "No streams found in %s\n", file);
         goto fail;
     }
-    if (!tracks->duration)
-        tracks->duration = ctx->duration;
 
     for (i = 0; i < ctx->nb_streams; i++) {
         struct Track **temp;
@@ -327,11 +457,8 @@ static int handle_file(struct Tracks *tracks, const char *file, int split)
         if ((ptr = strrchr(file, '/')) != NULL)
             track->name = ptr + 1;
 
-        track->bitrate   = st->codec->bit_rate;
         track->track_id  = st->id;
         track->timescale = st->time_base.den;
-        track->duration  = av_rescale_rnd(ctx->duration, track->timescale,
-                                          AV_TIME_BASE, AV_ROUND_UP);
         track->is_audio  = st->codec->codec_type == AVMEDIA_TYPE_AUDIO;
         track->is_video  = st->codec->codec_type == AVMEDIA_TYPE_VIDEO;
 
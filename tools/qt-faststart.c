@@ -15,6 +15,8 @@
  * guaranteed, particularly on 64-bit platforms.
  * Invoke the program with:
  *  qt-faststart <infile.mov> <outfile.mov>
+ * or, to rewrite the file in place, with:
+ *  qt-faststart <file.mov>
  *
  * Notes: Quicktime files can come in many configurations of top-level
  * atoms. This utility stipulates that the very last atom in the file needs
@@ -22,6 +24,10 @@
  * the top-level atoms by shifting the moov atom from the back of the file
  * to the front, and patch the chunk offsets along the way. This utility
  * presently only operates on uncompressed moov atoms.
+ *
+ * In place, the moov atom is written over a free atom preceding the
+ * mdat atom, which needs to be large enough for it, and the file is
+ * truncated. The data does not move, so no chunk offset is patched.
  */
 
 #include <stdio.h>
@@ -29,6 +35,17 @@
 #include <inttypes.h>
 #include <string.h>
 
+#ifdef _WIN32
+#include <io.h>
+#define ftruncate(x, y) _chsize_s(x, y)
+#else
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <errno.h>
+#include <sys/sendfile.h>
+#endif
+
 #ifdef __MINGW32__
 #define fseeko(x, y, z) fseeko64(x, y, z)
 #define ftello(x)       ftello64(x)
@@ -80,6 +97,56 @@
 
 #define ATOM_PREAMBLE_SIZE    8
 #define COPY_BUFFER_SIZE   33554432
+#define SENDFILE_MAX_SIZE  0x7ffff000
+
+/* Copy size bytes of infile, from offset, to the current position of
+ * outfile. On Linux, the data is copied by the kernel with sendfile(),
+ * without going through a user space buffer. */
+static int copy_data(FILE *infile, FILE *outfile, uint64_t offset,
+                     uint64_t size)
+{
+    unsigned char *copy_buffer;
+    int bytes_to_copy;
+
+#ifdef __linux__
+    if (fflush(outfile))
+        return -1;
+    while (size) {
+        off_t pos = offset;
+        ssize_t ret = sendfile(fileno(outfile), fileno(infile), &pos,
+                               FFMIN(size, SENDFILE_MAX_SIZE));
+        if (ret < 0 && (errno == EINVAL || errno == ENOSYS))
+            break;  /* not supported between these files, copy below */
+        if (ret <= 0)
+            return -1;
+        offset += ret;
+        size   -= ret;
+    }
+    if (!size)
+        return 0;
+#endif
+
+    if (fseeko(infile, offset, SEEK_SET))
+        return -1;
+    bytes_to_copy = FFMIN(COPY_BUFFER_SIZE, size);
+    copy_buffer = malloc(bytes_to_copy);
+    if (!copy_buffer) {
+        printf("could not allocate %d bytes for copy_buffer\n", bytes_to_copy);
+        return -1;
+    }
+    while (size) {
+        bytes_to_copy = FFMIN(bytes_to_copy, size);
+
+        if (fread(copy_buffer, bytes_to_copy, 1, infile) != 1 ||
+            fwrite(copy_buffer, bytes_to_copy, 1, outfile) != 1) {
+            free(copy_buffer);
+            return -1;
+        }
+        size -= bytes_to_copy;
+    }
+    free(copy_buffer);
+    return 0;
+}
 
 int main(int argc, char *argv[])
 {
@@ -98,20 +165,22 @@ int main(int argc, char *argv[])
     uint32_t offset_count;
     uint64_t current_offset;
     int64_t start_offset = 0;
-    unsigned char *copy_buffer = NULL;
-    int bytes_to_copy;
+    uint64_t free_offset = 0, free_size = 0;
+    int in_place = argc == 2;
+    int mdat_found = 0;
 
-    if (argc != 3) {
-        printf("Usage: qt-faststart <infile.mov> <outfile.mov>\n");
+    if (argc != 2 && argc != 3) {
+        printf("Usage: qt-faststart <infile.mov> <outfile.mov>\n"
+               "       qt-faststart <file.mov>\n");
         return 0;
     }
 
-    if (!strcmp(argv[1], argv[2])) {
+    if (!in_place && !strcmp(argv[1], argv[2])) {
         fprintf(stderr, "input and output files need to be different\n");
         return 1;
     }
 
-    infile = fopen(argv[1], "rb");
+    infile = fopen(argv[1], in_place ? "r+b" : "rb");
     if (!infile) {
         perror(argv[1]);
         goto error_out;
@@ -179,6 +248,15 @@ int main(int argc, char *argv[])
             printf("encountered non-QT top-level atom (is this a QuickTime file?)\n");
             break;
         }
+        /* keep the largest free space before the data for the in place
+         * rewrite */
+        if (atom_type == MDAT_ATOM)
+            mdat_found = 1;
+        if ((atom_type == FREE_ATOM || atom_type == SKIP_ATOM) &&
+            !mdat_found && atom_size > free_size) {
+            free_offset = atom_offset;
+            free_size   = atom_size;
+        }
         atom_offset += atom_size;
 
         /* The atom header is 8 (or 16 bytes), if the atom size (which
@@ -220,6 +298,46 @@ int main(int argc, char *argv[])
         goto error_out;
     }
 
+    if (in_place) {
+        /* the rest of the free atom, if any, needs to be a free atom */
+        if (free_offset < start_offset ||
+            (free_size != moov_atom_size &&
+             (free_size < moov_atom_size + ATOM_PREAMBLE_SIZE ||
+              free_size - moov_atom_size > UINT32_MAX))) {
+            printf("no free atom large enough for the moov atom before the "
+                   "mdat atom, the file needs to be copied\n");
+            goto error_out;
+        }
+
+        printf(" writing moov atom over free atom at %"PRIu64"...\n",
+               free_offset);
+        if (fseeko(infile, free_offset, SEEK_SET) ||
+            fwrite(moov_atom, moov_atom_size, 1, infile) != 1) {
+            perror(argv[1]);
+            goto error_out;
+        }
+        if (free_size > moov_atom_size) {
+            uint32_t size = free_size - moov_atom_size;
+            unsigned char free_atom[ATOM_PREAMBLE_SIZE] = {
+                size >> 24, size >> 16, size >> 8, size, 'f', 'r', 'e', 'e'
+            };
+            if (fwrite(free_atom, ATOM_PREAMBLE_SIZE, 1, infile) != 1) {
+                perror(argv[1]);
+                goto error_out;
+            }
+        }
+        /* only drop the old moov atom once the new one is written */
+        if (fflush(infile) || ftruncate(fileno(infile), last_offset)) {
+            perror(argv[1]);
+            goto error_out;
+        }
+
+        fclose(infile);
+        free(moov_atom);
+        free(ftyp_atom);
+        return 0;
+    }
+
     /* close; will be re-opened later */
     fclose(infile);
     infile = NULL;
@@ -315,32 +433,21 @@ int main(int argc, char *argv[])
     }
 
     /* copy the remainder of the infile, from offset 0 -> last_offset - 1 */
-    bytes_to_copy = FFMIN(COPY_BUFFER_SIZE, last_offset);
-    copy_buffer = malloc(bytes_to_copy);
-    if (!copy_buffer) {
-        printf("could not allocate %d bytes for copy_buffer\n", bytes_to_copy);
-        goto error_out;
-    }
     printf(" copying rest of file...\n");
-    while (last_offset) {
-        bytes_to_copy = FFMIN(bytes_to_copy, last_offset);
-
-        if (fread(copy_buffer, bytes_to_copy, 1, infile) != 1) {
-            perror(argv[1]);
-            goto error_out;
-        }
-        if (fwrite(copy_buffer, bytes_to_copy, 1, outfile) != 1) {
-            perror(argv[2]);
-            goto error_out;
-        }
-        last_offset -= bytes_to_copy;
+    if (copy_data(infile, outfile, start_offset, last_offset)) {
+        perror(argv[2]);
+        goto error_out;
     }
 
     fclose(infile);
-    fclose(outfile);
+    infile = NULL;
+    if (fclose(outfile)) {
+        outfile = NULL;
+        perror(argv[2]);
+        goto error_out;
+    }
     free(moov_atom);
     free(ftyp_atom);
-    free(copy_buffer);
 
     return 0;
 
@@ -351,6 +458,5 @@ error_out:
         fclose(outfile);
     free(moov_atom);
     free(ftyp_atom);
-    free(copy_buffer);
     return 1;
 }